@@ -0,0 +1,34 @@
+/*
+ * ActuatorCommand.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef ACTUATORCOMMAND_H_
+#define ACTUATORCOMMAND_H_
+
+#include <stdint.h>
+
+//Every actuator output of one control cycle, applied at once by
+//CommitActuators (DriveByWireIO.h). Duty cycles are [0, 1] as the Set*
+//calls take them, flags are non-zero for on.
+typedef struct actuator_command_t
+{
+	float acceleration;
+	float front_brake;
+	//the motor while steering_rate_control is 0, the rate loop's otherwise
+	float steering_torque;
+	uint8_t steer_right;
+	//with STEERING_RATE_LOOP, the loop drives the motor toward steering_rate
+	uint8_t steering_rate_control;
+	float steering_rate;
+	//a DMA channel writes the output's compare value every period
+	//(Excitation.h), only its enable pin and the direction are set here
+	uint8_t steering_torque_by_dma;
+	uint8_t acceleration_by_dma;
+	//safety light 2 follows the gear
+	uint8_t reverse;
+	uint8_t safety_light_1;
+} actuator_command_t;
+
+#endif /* ACTUATORCOMMAND_H_ */
@@ -0,0 +1,123 @@
+/*
+ * ActuatorFault.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "ActuatorFault.h"
+#include "EventLog.h"
+#include "FastCode.h"
+
+#define WINDOW_MASK (ACTUATOR_FAULT_WINDOW - 1)
+//predicted motion is kept in millionths
+#define MICRO 1000000.0f
+
+#if (ACTUATOR_FAULT_WINDOW & WINDOW_MASK) != 0
+#error ACTUATOR_FAULT_WINDOW must be a power of two
+#endif
+
+void ActuatorFaultInit(actuator_fault_t* detector, float dt)
+{
+	memset(detector, 0, sizeof(*detector));
+	detector->dt = dt;
+}
+
+//Pushes the cycle's prediction and measurement into channel's window and
+//judges it. A forward channel's motion is missing when it fell short of the
+//prediction whatever its size, any other's only in the direction of a
+//prediction of least or more. Returns whether the window has shown too
+//little of the motion for ACTUATOR_FAULT_CONFIRM cycles or more.
+FAST_CODE static uint8_t Judge(actuator_fault_channel_t* channel, uint32_t index, float predicted, float measured,
+	uint8_t driven, float least, uint8_t forward)
+{
+	int32_t increment = (int32_t)(predicted * MICRO);
+	channel->predicted_sum += increment - channel->predicted[index];
+	channel->predicted[index] = increment;
+	//the oldest value, ACTUATOR_FAULT_WINDOW cycles back
+	float moved = measured - channel->measured[index];
+	channel->measured[index] = measured;
+
+	if( !driven )
+	{
+		channel->driven = 0;
+		channel->over = 0;
+		return 0;
+	}
+	if( ++channel->driven < ACTUATOR_FAULT_WINDOW )
+		return 0;
+	channel->driven = ACTUATOR_FAULT_WINDOW;
+
+	float expected = channel->predicted_sum / MICRO;
+	float missing = expected - moved;
+	float scale = expected;
+	if( expected < 0.0f && !forward )
+	{
+		missing = -missing;
+		scale = -expected;
+	}
+	if( scale < least )
+	{
+		if( !forward )
+		{
+			channel->over = 0;
+			return 0;
+		}
+		scale = least;
+	}
+	float residual = missing / scale;
+	channel->residual = residual > 1.0f ? 1.0f : residual < 0.0f ? 0.0f : residual;
+	if( residual <= 1.0f - ACTUATOR_FAULT_RESPONSE_SHARE )
+	{
+		channel->over = 0;
+		return 0;
+	}
+	if( channel->over < ACTUATOR_FAULT_CONFIRM )
+		channel->over++;
+	return channel->over == ACTUATOR_FAULT_CONFIRM;
+}
+
+FAST_CODE uint8_t ActuatorFaultStep(actuator_fault_t* detector, const actuator_command_t* out, float steering_angle,
+	float vehicle_speed, uint8_t estop)
+{
+	if( estop )
+		detector->faults = 0;
+	uint32_t index = detector->cycle++ & WINDOW_MASK;
+	float dt = detector->dt;
+	uint8_t raised = 0;
+
+	//the rate loop steers to its rate from the encoder, the model is the
+	//commanded rate itself
+	if( out->steering_rate_control )
+		detector->steering_rate = out->steering_rate;
+	else
+	{
+		float torque = out->steer_right ? -out->steering_torque : out->steering_torque;
+		detector->steering_rate += (ACTUATOR_FAULT_STEERING_RATE * torque - detector->steering_rate) * dt
+			/ ACTUATOR_FAULT_STEERING_TAU;
+	}
+	uint8_t steering_driven = !out->steering_torque_by_dma && steering_angle < ACTUATOR_FAULT_STEERING_STOP
+		&& steering_angle > -ACTUATOR_FAULT_STEERING_STOP;
+	if( Judge(&detector->steering, index, detector->steering_rate * dt, steering_angle, steering_driven,
+		ACTUATOR_FAULT_STEERING_MIN, 0) )
+		raised |= ACTUATOR_FAULT_STEERING;
+
+	//forward on the throttle alone, the brake and the gear have their own
+	//models that are not checked here. A cruise whose throttle is lost does
+	//not predict much motion, the speed falling off this model's is the
+	//fault.
+	float acceleration = (ACTUATOR_FAULT_SPEED_GAIN * out->acceleration - vehicle_speed) / ACTUATOR_FAULT_SPEED_TAU;
+	uint8_t throttle_driven = !out->acceleration_by_dma && !out->reverse && out->front_brake <= 0.0f
+		&& out->acceleration > 0.0f;
+	if( Judge(&detector->throttle, index, acceleration * dt, vehicle_speed, throttle_driven, ACTUATOR_FAULT_SPEED_MIN,
+		1) )
+		raised |= ACTUATOR_FAULT_THROTTLE;
+
+	raised &= ~detector->faults;
+	if( raised & ACTUATOR_FAULT_STEERING )
+		EventLogWrite(EVENT_LOG_ACTUATOR_FAULT, ACTUATOR_FAULT_STEERING, (uint32_t)(detector->steering.residual * 1000.0f));
+	if( raised & ACTUATOR_FAULT_THROTTLE )
+		EventLogWrite(EVENT_LOG_ACTUATOR_FAULT, ACTUATOR_FAULT_THROTTLE, (uint32_t)(detector->throttle.residual * 1000.0f));
+	detector->faults |= raised;
+	return raised;
+}
@@ -0,0 +1,131 @@
+/*
+ * ActuatorFault.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef ACTUATORFAULT_H_
+#define ACTUATORFAULT_H_
+
+#include <stdint.h>
+#include "ActuatorCommand.h"
+#include "ControlScheduler.h"
+
+//Model based detection of a steering motor that does not move the wheels
+//and a throttle that does not drive the cart: a stalled or unplugged
+//motor, a loose PWM wire, a blown driver. The loops would push more duty
+//into either without ever noticing.
+//
+//Every cycle the detector runs the last committed outputs through a
+//first-order model of each actuator, the ones PlantModel.c simulates:
+//
+//	steering	the rate follows ACTUATOR_FAULT_STEERING_RATE times the torque
+//				with ACTUATOR_FAULT_STEERING_TAU, with STEERING_RATE_LOOP
+//				the rate is the commanded one
+//	throttle	the speed heads for ACTUATOR_FAULT_SPEED_GAIN times the duty
+//				with ACTUATOR_FAULT_SPEED_TAU, from the measured speed
+//
+//and keeps the motion each model predicts per cycle in a ring of
+//ACTUATOR_FAULT_WINDOW cycles next to the measured angle and speed. The
+//residual is the share of the window's predicted motion that the
+//measurement did not show, a running sum in and one out per cycle, the same
+//few dozen instructions every cycle whatever the window. A window that
+//showed less than ACTUATOR_FAULT_RESPONSE_SHARE of the prediction for
+//ACTUATOR_FAULT_CONFIRM cycles in a row raises the fault.
+//
+//An actuator is only judged over a window it was driven through all the
+//way: not while the steering is at its stops or the throttle is braked
+//against, in reverse or played by an excitation run. A steering window
+//that predicts less than ACTUATOR_FAULT_STEERING_MIN of motion is not
+//judged, the measurement's noise is as large as the motion. A throttle
+//window is judged against ACTUATOR_FAULT_SPEED_MIN at the least, a cruise
+//predicts next to no change of speed and a lost throttle shows as the
+//speed falling off the model's (the drag), faster than a slope of about
+//12% would make it. A fault of an actuator that is judged is raised at
+//most ACTUATOR_FAULT_DETECTION_BOUND cycles after it started, the window
+//and the confirmation. host/FaultInject.c measures it against the plant
+//models.
+//
+//A fault is an EVENT_LOG_ACTUATOR_FAULT entry and stays latched until the
+//estop is pressed. While latched the mode state machine (VehicleMode.h)
+//drops autonomous, park, test and calibrate to Disabled and keeps them out.
+//Tele operation stays, the operator can still steer or drive the cart off.
+
+#ifndef ACTUATOR_FAULT_ENABLE
+#define ACTUATOR_FAULT_ENABLE 1
+#endif
+
+//cycles, a power of two, about 128 ms at every CONTROL_RATE_HZ
+#ifndef ACTUATOR_FAULT_WINDOW
+#define ACTUATOR_FAULT_WINDOW (CONTROL_CYCLES_PER_MS >= 4 ? 512 : 128 * CONTROL_CYCLES_PER_MS)
+#endif
+
+//cycles the residual stays over before the fault is raised, 32 ms
+#ifndef ACTUATOR_FAULT_CONFIRM
+#define ACTUATOR_FAULT_CONFIRM (32 * CONTROL_CYCLES_PER_MS)
+#endif
+
+//share of the predicted motion below which the actuator counts as not
+//responding, low enough for a cart on a slope or with scrubbing tyres
+#ifndef ACTUATOR_FAULT_RESPONSE_SHARE
+#define ACTUATOR_FAULT_RESPONSE_SHARE 0.25f
+#endif
+
+//The models, the host plant's figures until fitted to the cart
+//deg/s at full steering torque, and s
+#define ACTUATOR_FAULT_STEERING_RATE 60.0f
+#define ACTUATOR_FAULT_STEERING_TAU 0.05f
+//m/s at full throttle, and s
+#define ACTUATOR_FAULT_SPEED_GAIN 6.0f
+#define ACTUATOR_FAULT_SPEED_TAU 1.5f
+
+//Least predicted motion over a window that is judged, deg and m/s
+#define ACTUATOR_FAULT_STEERING_MIN 2.0f
+#define ACTUATOR_FAULT_SPEED_MIN 0.2f
+//deg either side beyond which the steering is at its stops
+#define ACTUATOR_FAULT_STEERING_STOP 45.0f
+
+#define ACTUATOR_FAULT_DETECTION_BOUND (ACTUATOR_FAULT_WINDOW + ACTUATOR_FAULT_CONFIRM)
+
+//Bits of faults, the arg of EVENT_LOG_ACTUATOR_FAULT
+#define ACTUATOR_FAULT_STEERING 0x01
+#define ACTUATOR_FAULT_THROTTLE 0x02
+
+typedef struct actuator_fault_channel_t
+{
+	//motion the model predicted each cycle, millionths of a deg or m/s,
+	//integers so that the running sum never drifts
+	int32_t predicted[ACTUATOR_FAULT_WINDOW];
+	int32_t predicted_sum;
+	//the measured value of each cycle
+	float measured[ACTUATOR_FAULT_WINDOW];
+	//cycles in a row the actuator was driven, and the residual was over
+	uint32_t driven;
+	uint32_t over;
+	//of the last window judged, 0 none of the motion missing, 1 all of it
+	float residual;
+} actuator_fault_channel_t;
+
+typedef struct actuator_fault_t
+{
+	actuator_fault_channel_t steering;
+	actuator_fault_channel_t throttle;
+	//cycles stepped, the rings' position
+	uint32_t cycle;
+	//deg/s of the steering model
+	float steering_rate;
+	float dt;
+	//ACTUATOR_FAULT_* latched
+	uint8_t faults;
+} actuator_fault_t;
+
+//dt in s, no faults
+void ActuatorFaultInit(actuator_fault_t* detector, float dt);
+
+//One cycle: out is what was committed the cycle before, the angle in deg
+//and the speed in m/s what it brought. A press of the estop clears the
+//faults. Returns the ACTUATOR_FAULT_* bits raised by this step.
+uint8_t ActuatorFaultStep(actuator_fault_t* detector, const actuator_command_t* out, float steering_angle,
+	float vehicle_speed, uint8_t estop);
+
+#endif /* ACTUATORFAULT_H_ */
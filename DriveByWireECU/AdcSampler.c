@@ -0,0 +1,467 @@
+/*
+ * AdcSampler.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hpl_dma.h>
+#include <hpl_adc_dma.h>
+#include <irq_config.h>
+#include "AdcSampler.h"
+#include "TccPwm.h"
+#include "FastCode.h"
+#include "DmaService.h"
+#include "driver_init.h"
+#include "Peripherals.h"
+
+//Channel numbers and triggers must match config/hpl_dmac_config.h
+#define ADC_SAMPLER_RESULT_DMA 0	//ADC1 result ready -> history, 16 bit beats
+#define ADC_SAMPLER_SEQUENCE_DMA 1	//scan table -> ADC1 DSEQDATA, 32 bit beats
+
+//The sequencer takes the registers in DSEQCTRL in register order, one
+//32 bit beat each, the window limits after AVGCTRL
+#if ADC_SAMPLER_WINDOW_TRIP
+#define ADC_SAMPLER_SEQUENCE_WORDS 5
+#define ADC_SAMPLER_SEQUENCE_REGISTERS (ADC_DSEQCTRL_INPUTCTRL | ADC_DSEQCTRL_CTRLB | ADC_DSEQCTRL_AVGCTRL \
+	| ADC_DSEQCTRL_WINLT | ADC_DSEQCTRL_WINUT)
+#else
+#define ADC_SAMPLER_SEQUENCE_WORDS 3
+#define ADC_SAMPLER_SEQUENCE_REGISTERS (ADC_DSEQCTRL_INPUTCTRL | ADC_DSEQCTRL_CTRLB | ADC_DSEQCTRL_AVGCTRL)
+#endif
+
+typedef struct adc_sampler_mode_info_t
+{
+	uint8_t ressel;
+	uint8_t samplenum;
+	uint8_t adjres;
+	uint8_t bits;
+} adc_sampler_mode_info_t;
+
+//In adc_sampler_mode_t order. Past 16 conversions the ADC shifts the sum
+//to 16 bits itself, ADJRES takes the rest.
+static const adc_sampler_mode_info_t adc_sampler_modes[] =
+{
+	{ ADC_CTRLB_RESSEL_12BIT_Val, 0, 0, 12 },
+	{ ADC_CTRLB_RESSEL_16BIT_Val, 2, 2, 12 },
+	{ ADC_CTRLB_RESSEL_16BIT_Val, 4, 4, 12 },
+	{ ADC_CTRLB_RESSEL_16BIT_Val, 6, 4, 12 },
+	{ ADC_CTRLB_RESSEL_16BIT_Val, 2, 1, 13 },
+	{ ADC_CTRLB_RESSEL_16BIT_Val, 4, 2, 14 },
+	{ ADC_CTRLB_RESSEL_16BIT_Val, 6, 1, 15 },
+	{ ADC_CTRLB_RESSEL_16BIT_Val, 8, 0, 16 },
+};
+
+//What trips a channel, as CTRLB WINMODE
+#define ADC_SAMPLER_WINDOW_NONE ADC_CTRLB_WINMODE_DISABLE_Val
+#define ADC_SAMPLER_WINDOW_ABOVE ADC_CTRLB_WINMODE_MODE1_Val	//above the low limit
+#define ADC_SAMPLER_WINDOW_OUTSIDE ADC_CTRLB_WINMODE_MODE4_Val	//outside both limits
+
+typedef struct adc_sampler_input_t
+{
+	uint8_t muxpos;
+	adc_sampler_mode_t mode;
+	//safe window in 12 bit codes, the ADC compares at the channel's resolution
+	uint8_t window;
+	uint16_t window_low;
+	uint16_t window_high;
+} adc_sampler_input_t;
+
+//Input, mode and safe window of each channel, in adc_sampler_channel_t order
+static const adc_sampler_input_t adc_sampler_inputs[ADC_SAMPLER_CHANNEL_COUNT] =
+{
+	//PB08 ADC1 AIN0, steering potentiometer
+	{ 0, ADC_SAMPLER_STEERING_MODE, ADC_SAMPLER_WINDOW_OUTSIDE, ADC_SAMPLER_STEERING_WINDOW_LOW, ADC_SAMPLER_STEERING_WINDOW_HIGH },
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+	//PB04 ADC1 AIN6, front brake pressure. No window, a trip cuts the
+	//steering, the brake loop handles a bad reading itself.
+	{ 6, ADC_SAMPLER_BRAKE_MODE, ADC_SAMPLER_WINDOW_NONE, 0, ADC_SAMPLER_FULL_SCALE },
+#endif
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+	//PC02 ADC1 AIN4, supply voltage divider. No window either, a sagging
+	//battery is no reason to cut the steering.
+	{ 4, ADC_SAMPLER_SUPPLY_MODE, ADC_SAMPLER_WINDOW_NONE, 0, ADC_SAMPLER_FULL_SCALE },
+#endif
+#if ADC_SAMPLER_DUAL
+	//PA02 ADC0 AIN0, steering motor current sense, in the mode of its
+	//partner, the pair has to finish together
+	{ 0, ADC_SAMPLER_STEERING_MODE, ADC_SAMPLER_WINDOW_ABOVE, ADC_SAMPLER_CURRENT_LIMIT, ADC_SAMPLER_FULL_SCALE },
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+	//PA02 ADC0 AIN0 again, partner of the brake pressure
+	{ 0, ADC_SAMPLER_BRAKE_MODE, ADC_SAMPLER_WINDOW_ABOVE, ADC_SAMPLER_CURRENT_LIMIT, ADC_SAMPLER_FULL_SCALE },
+#endif
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+	//PA02 ADC0 AIN0 again, partner of the supply voltage
+	{ 0, ADC_SAMPLER_SUPPLY_MODE, ADC_SAMPLER_WINDOW_ABOVE, ADC_SAMPLER_CURRENT_LIMIT, ADC_SAMPLER_FULL_SCALE },
+#endif
+#endif
+};
+
+//ADC1 and with ADC_SAMPLER_DUAL ADC0, in adc_sampler_channel_t order
+#define ADC_SAMPLER_ADCS (ADC_SAMPLER_DUAL ? 2 : 1)
+
+//INPUTCTRL, CTRLB, AVGCTRL and the window of each channel, built from the
+//inputs
+static uint32_t adc_sampler_sequence[ADC_SAMPLER_CHANNEL_COUNT][ADC_SAMPLER_SEQUENCE_WORDS];
+//result bits of each channel
+static uint8_t adc_sampler_bits[ADC_SAMPLER_CHANNEL_COUNT];
+
+//EVSYS channels, 0 and 1 belong to WheelSpeed
+#define ADC_SAMPLER_PWM_EVSYS 2		//TC4 or TCC0 overflow -> TC7 retrigger
+#define ADC_SAMPLER_START_EVSYS 3	//TC7 overflow -> start of the master ADC
+//4 belongs to TccPwm
+#define ADC_SAMPLER_TRIP_EVSYS 5	//window monitor -> TCC0 fault
+
+//one row per scan and ADC, each result DMA wraps back to row 0 after the
+//last one. Row n of both ADCs is the same scan.
+static volatile uint16_t adc_sampler_history[ADC_SAMPLER_ADCS][ADC_SAMPLER_HISTORY][ADC_SAMPLER_SCAN_LENGTH];
+
+static struct _adc_dma_device adc_sampler_device;
+
+#if ADC_SAMPLER_WINDOW_TRIP
+typedef struct adc_sampler_trip_t
+{
+	void (*on_trip)();
+	//channel bits of each ADC, written by its interrupt while that is on
+	//and by AdcSamplerTripRelease while it is off
+	volatile uint32_t tripped[2];
+	volatile uint32_t trips;
+} adc_sampler_trip_t;
+
+static adc_sampler_trip_t adc_sampler_trip;
+
+//ADC1 and ADC0, as adc_sampler_history
+static Adc* const adc_sampler_adcs[2] = { ADC1, ADC0 };
+
+//The monitor does not say which conversion of the scan was outside, the
+//trip latches every channel of the ADC with a window. The interrupt is off
+//until AdcSamplerTripRelease rearms it, a result outside sets the flag on
+//every conversion.
+FAST_CODE static void WindowTrip(uint8_t adc)
+{
+	Adc* hw = adc_sampler_adcs[adc];
+	hri_adc_clear_INTEN_WINMON_bit(hw);
+	hri_adc_clear_INTFLAG_WINMON_bit(hw);
+
+	adc_sampler_trip.on_trip();
+	uint32_t tripped = 0;
+	for(int i = adc * ADC_SAMPLER_SCAN_LENGTH; i < (adc + 1) * ADC_SAMPLER_SCAN_LENGTH; ++i)
+	{
+		if( adc_sampler_inputs[i].window != ADC_SAMPLER_WINDOW_NONE )
+			tripped |= 1UL << i;
+	}
+	adc_sampler_trip.tripped[adc] = tripped;
+	adc_sampler_trip.trips++;
+}
+
+FAST_CODE void ADC1_0_Handler()
+{
+	WindowTrip(0);
+}
+
+#if ADC_SAMPLER_DUAL
+FAST_CODE void ADC0_0_Handler()
+{
+	WindowTrip(1);
+}
+#endif
+
+//Interrupt of one ADC, and with fault_event its window event to the TCC0
+//fault. TccPwmInit has the TCC0 side set up already.
+static void InitWindowTrip(uint8_t adc, uint8_t fault_event)
+{
+	Adc* hw = adc_sampler_adcs[adc];
+	IRQn_Type irq = adc ? ADC0_0_IRQn : ADC1_0_IRQn;
+
+#if TCC_PWM_ENABLE
+	if( fault_event )
+	{
+		//EVCTRL is enable protected, the ADC is still off
+		hri_adc_set_EVCTRL_WINMONEO_bit(hw);
+		hri_mclk_set_APBBMASK_EVSYS_bit(MCLK);
+		hri_evsys_write_CHANNEL_reg(EVSYS, ADC_SAMPLER_TRIP_EVSYS,
+			EVSYS_CHANNEL_EVGEN(adc ? EVSYS_ID_GEN_ADC0_WINMON : EVSYS_ID_GEN_ADC1_WINMON) | EVSYS_CHANNEL_PATH_ASYNCHRONOUS);
+		hri_evsys_write_USER_reg(EVSYS, EVSYS_ID_USER_TCC0_EV_0, ADC_SAMPLER_TRIP_EVSYS + 1);
+	}
+#else
+	(void)fault_event;
+#endif
+
+	hri_adc_clear_INTFLAG_WINMON_bit(hw);
+	hri_adc_set_INTEN_WINMON_bit(hw);
+	NVIC_SetPriority(irq, IRQ_PRIORITY_ADC_WINDOW);
+	NVIC_ClearPendingIRQ(irq);
+	NVIC_EnableIRQ(irq);
+}
+#endif
+
+#if ADC_SAMPLER_DUAL
+#define ADC_SAMPLER_PARTNER_PIN GPIO(GPIO_PORTA, 2)
+
+//ADC0 result ready -> its history
+static const dma_channel_config_t adc_sampler_partner_result_config =
+{
+	ADC0_DMAC_ID_RESRDY, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_HWORD_Val, 0, 1, 1, 0
+};
+//its part of the scan table -> ADC0 DSEQDATA
+static const dma_channel_config_t adc_sampler_partner_sequence_config =
+{
+	ADC0_DMAC_ID_SEQ, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_WORD_Val, 1, 0, 1, 0
+};
+
+//Clocks ADC0 like ADC1, which START set up, and starts its DMA. ADC0 is
+//not in the START configuration, it is set up by hand. 0 if there are no
+//DMA channels for it, ADC1 then scans alone and the partners read 0.
+static uint8_t InitPartnerAdc()
+{
+	hri_mclk_set_APBDMASK_ADC0_bit(MCLK);
+	hri_gclk_write_PCHCTRL_reg(GCLK, ADC0_GCLK_ID, CONF_GCLK_ADC1_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	gpio_set_pin_direction(ADC_SAMPLER_PARTNER_PIN, GPIO_DIRECTION_OFF);
+	gpio_set_pin_function(ADC_SAMPLER_PARTNER_PIN, PINMUX_PA02B_ADC0_AIN0);
+
+	hri_adc_write_CTRLA_reg(ADC0, ADC_CTRLA_SWRST);
+	hri_adc_wait_for_sync(ADC0, ADC_SYNCBUSY_SWRST);
+	hri_adc_write_REFCTRL_reg(ADC0, hri_adc_read_REFCTRL_reg(ADC1));
+	hri_adc_write_SAMPCTRL_reg(ADC0, hri_adc_read_SAMPCTRL_reg(ADC1));
+	hri_adc_write_CTRLA_reg(ADC0, hri_adc_read_CTRLA_reg(ADC1) & ~ADC_CTRLA_ENABLE);
+
+	int8_t result = DmaAllocate(&adc_sampler_partner_result_config, NULL, NULL);
+	int8_t sequence = DmaAllocate(&adc_sampler_partner_sequence_config, NULL, NULL);
+	if( result < 0 || sequence < 0 )
+	{
+		if( result >= 0 )
+			DmaFree(result);
+		if( sequence >= 0 )
+			DmaFree(sequence);
+		return 0;
+	}
+	DmaSetBlock(result, NULL, &ADC0->RESULT.reg, adc_sampler_history[1],
+		ADC_SAMPLER_HISTORY * ADC_SAMPLER_SCAN_LENGTH, DmaFirstBlock(result));
+	DmaSetBlock(sequence, NULL, adc_sampler_sequence[ADC_SAMPLER_SCAN_LENGTH], &ADC0->DSEQDATA.reg,
+		ADC_SAMPLER_SCAN_LENGTH * ADC_SAMPLER_SEQUENCE_WORDS, DmaFirstBlock(sequence));
+	DmaStart(result);
+	DmaStart(sequence);
+	return 1;
+}
+#endif
+
+#if ADC_SAMPLER_PWM_TRIGGER
+static void InitPWMTrigger(uint8_t master_start)
+{
+	hri_mclk_set_APBBMASK_EVSYS_bit(MCLK);
+	hri_mclk_set_APBDMASK_TC7_bit(MCLK);
+	//TC7 shares its peripheral clock channel with TC6, PWM_3 may never come up
+	hri_gclk_write_PCHCTRL_reg(GCLK, TC7_GCLK_ID, CONF_GCLK_TC6_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+#if TCC_PWM_ENABLE
+	//the steering PWM is on TCC0, which has its overflow event on already
+	uint8_t pwm_overflow = EVSYS_ID_GEN_TCC0_OVF;
+#else
+	//TC4 is not running yet, SetPWMDuty enables it on first use, so its
+	//enable protected EVCTRL can still be written
+	hri_tc_set_EVCTRL_OVFEO_bit(TC4);
+	uint8_t pwm_overflow = EVSYS_ID_GEN_TC4_OVF;
+#endif
+
+	//Every TC4 overflow restarts TC7, which counts up to CC0 once and stops.
+	//Its overflow is the delayed trigger.
+	hri_tc_write_CTRLA_reg(TC7, TC_CTRLA_SWRST);
+	hri_tc_write_WAVE_reg(TC7, TC_WAVE_WAVEGEN_MFRQ);
+	hri_tccount16_write_CC_reg(TC7, 0, ADC_SAMPLER_TRIGGER_DELAY);
+	hri_tc_set_CTRLB_ONESHOT_bit(TC7);
+	hri_tc_write_EVCTRL_reg(TC7, TC_EVCTRL_TCEI | TC_EVCTRL_EVACT_RETRIGGER | TC_EVCTRL_OVFEO);
+	hri_tc_write_CTRLA_reg(TC7, TC_CTRLA_MODE_COUNT16 | TC_CTRLA_ENABLE);
+
+	hri_evsys_write_CHANNEL_reg(EVSYS, ADC_SAMPLER_PWM_EVSYS,
+		EVSYS_CHANNEL_EVGEN(pwm_overflow) | EVSYS_CHANNEL_PATH_ASYNCHRONOUS);
+	hri_evsys_write_USER_reg(EVSYS, EVSYS_ID_USER_TC7_EVU, ADC_SAMPLER_PWM_EVSYS + 1);
+	hri_evsys_write_CHANNEL_reg(EVSYS, ADC_SAMPLER_START_EVSYS,
+		EVSYS_CHANNEL_EVGEN(EVSYS_ID_GEN_TC7_OVF) | EVSYS_CHANNEL_PATH_ASYNCHRONOUS);
+	//the master's start starts its slave as well
+	hri_evsys_write_USER_reg(EVSYS, master_start, ADC_SAMPLER_START_EVSYS + 1);
+}
+#endif
+
+void AdcSamplerInit(void (*on_trip)())
+{
+	memset((void*)adc_sampler_history, 0, sizeof(adc_sampler_history));
+#if ADC_SAMPLER_WINDOW_TRIP
+	adc_sampler_trip.on_trip = on_trip;
+	adc_sampler_trip.tripped[0] = 0;
+	adc_sampler_trip.tripped[1] = 0;
+	adc_sampler_trip.trips = 0;
+#else
+	(void)on_trip;
+#endif
+
+	PeripheralRequire(PERIPHERAL_ADC_0);
+
+	//Same START configuration adc_sync_init applied, the ADC is left disabled
+	_adc_dma_init(&adc_sampler_device, ADC_0.device.hw);
+
+	//the sequencer rewrites CTRLB for every channel, all but the resolution
+	//and the window mode stay as configured
+	uint32_t ctrlb = hri_adc_read_CTRLB_reg(adc_sampler_device.hw) & ~(ADC_CTRLB_RESSEL_Msk | ADC_CTRLB_WINMODE_Msk);
+	for(int i = 0; i < ADC_SAMPLER_CHANNEL_COUNT; ++i)
+	{
+		const adc_sampler_input_t* input = &adc_sampler_inputs[i];
+		const adc_sampler_mode_info_t* mode = &adc_sampler_modes[input->mode];
+		adc_sampler_sequence[i][0] = ADC_INPUTCTRL_MUXPOS(input->muxpos);
+		adc_sampler_sequence[i][1] = ctrlb | ADC_CTRLB_RESSEL(mode->ressel);
+		adc_sampler_sequence[i][2] = ADC_AVGCTRL_SAMPLENUM(mode->samplenum) | ADC_AVGCTRL_ADJRES(mode->adjres);
+		adc_sampler_bits[i] = mode->bits;
+#if ADC_SAMPLER_WINDOW_TRIP
+		//the limits scaled like the results they are compared with
+		adc_sampler_sequence[i][1] |= ADC_CTRLB_WINMODE(input->window);
+		adc_sampler_sequence[i][3] = (uint32_t)input->window_low << (mode->bits - 12);
+		adc_sampler_sequence[i][4] = (uint32_t)input->window_high << (mode->bits - 12);
+#endif
+	}
+
+	//Both descriptors link back to themselves so the transfers never end.
+	//Each result beat is paired with the sequence beat that selected its input,
+	//so row/column in the history always matches scan/channel.
+	_dma_set_source_address(ADC_SAMPLER_RESULT_DMA, (void*)_adc_get_source_for_dma(&adc_sampler_device));
+	_dma_set_destination_address(ADC_SAMPLER_RESULT_DMA, (void*)adc_sampler_history[0]);
+	_dma_set_data_amount(ADC_SAMPLER_RESULT_DMA, ADC_SAMPLER_HISTORY * ADC_SAMPLER_SCAN_LENGTH);
+	_dma_set_next_descriptor(ADC_SAMPLER_RESULT_DMA, ADC_SAMPLER_RESULT_DMA);
+	_dma_enable_transaction(ADC_SAMPLER_RESULT_DMA, false);
+
+	_dma_set_source_address(ADC_SAMPLER_SEQUENCE_DMA, adc_sampler_sequence);
+	_dma_set_destination_address(ADC_SAMPLER_SEQUENCE_DMA, (void*)&((Adc*)adc_sampler_device.hw)->DSEQDATA.reg);
+	_dma_set_data_amount(ADC_SAMPLER_SEQUENCE_DMA, ADC_SAMPLER_SCAN_LENGTH * ADC_SAMPLER_SEQUENCE_WORDS);
+	_dma_set_next_descriptor(ADC_SAMPLER_SEQUENCE_DMA, ADC_SAMPLER_SEQUENCE_DMA);
+	_dma_enable_transaction(ADC_SAMPLER_SEQUENCE_DMA, false);
+
+	//ADC1 starts its own conversions, or as a slave with ADC0's
+	void* master = adc_sampler_device.hw;
+	uint8_t master_start = EVSYS_ID_USER_ADC1_START;
+#if ADC_SAMPLER_DUAL
+	if( InitPartnerAdc() )
+	{
+		//both load their channel's registers for every conversion, the
+		//slave's sequencer only never starts one
+		hri_adc_write_DSEQCTRL_reg(adc_sampler_device.hw, ADC_SAMPLER_SEQUENCE_REGISTERS);
+		hri_adc_set_CTRLA_SLAVEEN_bit(adc_sampler_device.hw);
+		master = ADC0;
+		master_start = EVSYS_ID_USER_ADC0_START;
+	}
+#endif
+
+#if ADC_SAMPLER_PWM_TRIGGER
+	//The channel's registers are loaded by DMA ahead of every conversion, and
+	//the conversion waits for the start event. One channel is converted per
+	//PWM period.
+	hri_adc_write_DSEQCTRL_reg(master, ADC_SAMPLER_SEQUENCE_REGISTERS);
+	hri_adc_set_EVCTRL_STARTEI_bit(master);
+	InitPWMTrigger(master_start);
+#else
+	//The channel's registers are loaded by DMA ahead of every conversion, and
+	//the conversion starts as soon as they are written. This keeps the scan
+	//running back to back.
+	hri_adc_write_DSEQCTRL_reg(master, ADC_SAMPLER_SEQUENCE_REGISTERS | ADC_DSEQCTRL_AUTOSTART);
+	(void)master_start;
+#endif
+#if ADC_SAMPLER_WINDOW_TRIP
+	//the steering current on ADC0 sends the fault event if it is scanned,
+	//the steering position on ADC1 otherwise
+	uint8_t partner = master != adc_sampler_device.hw;
+	InitWindowTrip(0, !partner);
+	if( partner )
+		InitWindowTrip(1, 1);
+#endif
+	//enabling the master enables its slave
+	hri_adc_set_CTRLA_ENABLE_bit(master);
+}
+
+//Sum of the channel's history, at its own resolution
+FAST_CODE static uint32_t SumHistory(adc_sampler_channel_t channel)
+{
+	//The DMA may be writing a row while this runs. Each element is a single
+	//halfword store, so every value summed is a complete result.
+	const volatile uint16_t (*history)[ADC_SAMPLER_SCAN_LENGTH] = adc_sampler_history[channel / ADC_SAMPLER_SCAN_LENGTH];
+	uint8_t column = channel % ADC_SAMPLER_SCAN_LENGTH;
+	uint32_t sum = 0;
+	for(int i = 0; i < ADC_SAMPLER_HISTORY; ++i)
+		sum += history[i][column];
+	return sum;
+}
+
+FAST_CODE uint16_t AdcSamplerRead(adc_sampler_channel_t channel)
+{
+	if( channel >= ADC_SAMPLER_CHANNEL_COUNT )
+		return 0;
+
+	return (uint16_t)((SumHistory(channel) / ADC_SAMPLER_HISTORY) >> (adc_sampler_bits[channel] - 12));
+}
+
+FAST_CODE uint16_t AdcSamplerReadFine(adc_sampler_channel_t channel)
+{
+	if( channel >= ADC_SAMPLER_CHANNEL_COUNT )
+		return 0;
+
+	//the sum shifted up is at most 16 bits times the history, well within 32
+	return (uint16_t)((SumHistory(channel) << (16 - adc_sampler_bits[channel])) / ADC_SAMPLER_HISTORY);
+}
+
+#if ADC_SAMPLER_WINDOW_TRIP
+FAST_CODE uint32_t AdcSamplerTripped()
+{
+	return adc_sampler_trip.tripped[0] | adc_sampler_trip.tripped[1];
+}
+
+FAST_CODE uint32_t AdcSamplerTrips()
+{
+	return adc_sampler_trip.trips;
+}
+
+//Against the window in 12 bit codes, as the history averages it
+static uint8_t InsideWindow(adc_sampler_channel_t channel)
+{
+	const adc_sampler_input_t* input = &adc_sampler_inputs[channel];
+	uint16_t value = AdcSamplerRead(channel);
+	if( input->window == ADC_SAMPLER_WINDOW_ABOVE )
+		return value <= input->window_low;
+	return value >= input->window_low && value <= input->window_high;
+}
+
+void AdcSamplerTripRelease()
+{
+	for(int adc = 0; adc < ADC_SAMPLER_ADCS; ++adc)
+	{
+		uint32_t tripped = adc_sampler_trip.tripped[adc];
+		if( !tripped )
+			continue;
+		uint8_t inside = 1;
+		for(int i = 0; i < ADC_SAMPLER_CHANNEL_COUNT; ++i)
+		{
+			if( tripped & (1UL << i) )
+				inside &= InsideWindow((adc_sampler_channel_t)i);
+		}
+		if( !inside )
+			continue;
+
+		//the interrupt is off while the bits are set
+		adc_sampler_trip.tripped[adc] = 0;
+		hri_adc_clear_INTFLAG_WINMON_bit(adc_sampler_adcs[adc]);
+		hri_adc_set_INTEN_WINMON_bit(adc_sampler_adcs[adc]);
+	}
+}
+
+#else
+
+uint32_t AdcSamplerTripped()
+{
+	return 0;
+}
+
+uint32_t AdcSamplerTrips()
+{
+	return 0;
+}
+
+void AdcSamplerTripRelease()
+{
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * AdcSampler.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef ADCSAMPLER_H_
+#define ADCSAMPLER_H_
+
+#include <stdint.h>
+
+//Free running scan of the analog inputs on ADC_0.
+//DMAC channel 1 feeds the input of each conversion to the ADC sequencer and
+//DMAC channel 0 copies every result into a circular history, both without
+//CPU involvement. Reads only average the history, they never wait on the ADC.
+//
+//Every channel has its own conversion mode, loaded by the sequencer with
+//its input: one plain 12 bit conversion, N conversions averaged in hardware
+//to 12 bits, or N conversions accumulated into 13 to 16 bits. A conversion
+//takes about 2.2 us at the 6MHz ADC clock, a mode of N conversions makes
+//the scan N times as long for that channel and its result that much older
+//on average, before the history averages further. Noise that is not
+//correlated between conversions drops by the square root of N.
+//
+//	mode						conversions	bits	scan time
+//	ADC_SAMPLER_MODE_SINGLE			1		12		2.2 us
+//	ADC_SAMPLER_MODE_AVERAGE_4		4		12		8.7 us
+//	ADC_SAMPLER_MODE_AVERAGE_16		16		12		35 us
+//	ADC_SAMPLER_MODE_AVERAGE_64		64		12		139 us
+//	ADC_SAMPLER_MODE_13BIT			4		13		8.7 us
+//	ADC_SAMPLER_MODE_14BIT			16		14		35 us
+//	ADC_SAMPLER_MODE_15BIT			64		15		139 us
+//	ADC_SAMPLER_MODE_16BIT			256		16		555 us
+//
+//With ADC_SAMPLER_PWM_TRIGGER every channel's conversions have to fit in
+//one PWM period, 33 us at 30kHz, or triggers are lost while they run.
+//
+//With ADC_SAMPLER_DUAL, ADC0 scans in step with ADC_0, which is ADC1. ADC1
+//runs as ADC0's slave: every conversion start, from the sequencer or the
+//PWM trigger, starts both at the same instant, so each ADC1 channel has a
+//partner on ADC0 sampled with it, steering position with steering motor
+//current. A pair converts in the same mode, and its results land in the
+//same row of the two histories, each ADC's by its own DMA channels. A
+//scan of N pairs takes as long as one of N channels.
+//
+//With ADC_SAMPLER_WINDOW_TRIP, the ADC window monitor checks every result
+//of a channel with a safe window against it as the conversion completes,
+//the sequencer loads the window with the channel's input. A result outside
+//trips the steering actuator off with no comparison in software: the
+//window event goes through EVSYS to TCC0 as a non-recoverable fault, which
+//forces the steering PWM low a few tens of ns after the conversion, and the
+//window interrupt at IRQ_PRIORITY_ADC_WINDOW (irq_config.h) calls the
+//function given to AdcSamplerInit and latches the trip. Without
+//TCC_PWM_ENABLE the steering PWM is on TC4, which has no fault input, and
+//the interrupt alone cuts it, about a microsecond after the conversion.
+//From the window to the cut-off there is one conversion at most, the
+//channel's mode decides how long that is, the table above. The event only
+//comes from the ADC of the steering current when there is one, EVSYS has
+//one fault input on TCC0 left, the interrupts come from both.
+//
+//To add a sensor, add its channel here, its AIN number and mode to the scan
+//table in AdcSampler.c and its pin mux to ADC_0_PORT_init, or to
+//InitPartnerAdc for a partner on ADC0.
+
+//1 scans ADC0 together with ADC1, as above
+#ifndef ADC_SAMPLER_DUAL
+#define ADC_SAMPLER_DUAL 0
+#endif
+
+//1 scans the front brake pressure sensor on ADC1 as well, for the brake
+//pressure loop (ControlCore.h)
+#ifndef ADC_SAMPLER_BRAKE_FEEDBACK
+#define ADC_SAMPLER_BRAKE_FEEDBACK 0
+#endif
+
+//1 scans the supply voltage through its divider on ADC1 as well, for the
+//supply compensation of the actuator outputs (DriveByWireIO.h)
+#ifndef ADC_SAMPLER_SUPPLY_VOLTAGE
+#define ADC_SAMPLER_SUPPLY_VOLTAGE 0
+#endif
+
+//Conversions per scan on each ADC, the ADC1 channels. With ADC_SAMPLER_DUAL
+//their ADC0 partners follow them in adc_sampler_channel_t, in the same order.
+#define ADC_SAMPLER_SCAN_LENGTH (1 + ADC_SAMPLER_BRAKE_FEEDBACK + ADC_SAMPLER_SUPPLY_VOLTAGE)
+
+typedef enum adc_sampler_channel_t
+{
+	//ADC1
+	ADC_SAMPLER_STEERING_POSITION = 0,
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+	ADC_SAMPLER_BRAKE_PRESSURE,
+#endif
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+	ADC_SAMPLER_SUPPLY,
+#endif
+#if ADC_SAMPLER_DUAL
+	//ADC0, partners of the ADC1 channels in their order
+	ADC_SAMPLER_STEERING_CURRENT,
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+	//the steering current again, ADC0 has nothing else to convert with the
+	//brake pressure
+	ADC_SAMPLER_BRAKE_PARTNER,
+#endif
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+	//and with the supply voltage
+	ADC_SAMPLER_SUPPLY_PARTNER,
+#endif
+#endif
+	ADC_SAMPLER_CHANNEL_COUNT
+} adc_sampler_channel_t;
+
+typedef enum adc_sampler_mode_t
+{
+	ADC_SAMPLER_MODE_SINGLE = 0,
+	ADC_SAMPLER_MODE_AVERAGE_4,
+	ADC_SAMPLER_MODE_AVERAGE_16,
+	ADC_SAMPLER_MODE_AVERAGE_64,
+	ADC_SAMPLER_MODE_13BIT,
+	ADC_SAMPLER_MODE_14BIT,
+	ADC_SAMPLER_MODE_15BIT,
+	ADC_SAMPLER_MODE_16BIT,
+} adc_sampler_mode_t;
+
+//Steering potentiometer. 4 conversions halve its noise and still fit a
+//PWM period for ADC_SAMPLER_PWM_TRIGGER.
+#ifndef ADC_SAMPLER_STEERING_MODE
+#define ADC_SAMPLER_STEERING_MODE ADC_SAMPLER_MODE_AVERAGE_4
+#endif
+
+//Brake pressure sensor, as the steering potentiometer. With
+//ADC_SAMPLER_DUAL its partner converts in the same mode.
+#ifndef ADC_SAMPLER_BRAKE_MODE
+#define ADC_SAMPLER_BRAKE_MODE ADC_SAMPLER_MODE_AVERAGE_4
+#endif
+
+//12 bit codes of the brake pressure sensor at no pressure and at the full
+//pressure of the front brake
+#ifndef ADC_SAMPLER_BRAKE_ZERO
+#define ADC_SAMPLER_BRAKE_ZERO 410
+#endif
+#ifndef ADC_SAMPLER_BRAKE_FULL
+#define ADC_SAMPLER_BRAKE_FULL 3685
+#endif
+
+//Supply voltage divider. It moves slowly, the history and 4 conversions
+//average out the motor switching on it and still fit a PWM period.
+#ifndef ADC_SAMPLER_SUPPLY_MODE
+#define ADC_SAMPLER_SUPPLY_MODE ADC_SAMPLER_MODE_AVERAGE_4
+#endif
+
+//Volts at the divider's input that read full scale, 3.3 V at the pin
+//through a 1:20 divider
+#ifndef ADC_SAMPLER_SUPPLY_FULL_SCALE_VOLTS
+#define ADC_SAMPLER_SUPPLY_FULL_SCALE_VOLTS 66.0f
+#endif
+
+//1 trips the steering actuator off when a channel leaves its safe window,
+//as above
+#ifndef ADC_SAMPLER_WINDOW_TRIP
+#define ADC_SAMPLER_WINDOW_TRIP 0
+#endif
+
+//Safe window of the steering potentiometer in 12 bit codes, past the
+//steering stops. Outside is a broken wire or a short.
+#ifndef ADC_SAMPLER_STEERING_WINDOW_LOW
+#define ADC_SAMPLER_STEERING_WINDOW_LOW 100
+#endif
+#ifndef ADC_SAMPLER_STEERING_WINDOW_HIGH
+#define ADC_SAMPLER_STEERING_WINDOW_HIGH 3995
+#endif
+
+//Steering motor current sense in 12 bit codes above which the motor is
+//overloaded or stalled. Only an upper limit.
+#ifndef ADC_SAMPLER_CURRENT_LIMIT
+#define ADC_SAMPLER_CURRENT_LIMIT 3500
+#endif
+
+//Number of scans kept per channel. Reads return the mean of all of them.
+#ifndef ADC_SAMPLER_HISTORY
+#define ADC_SAMPLER_HISTORY 8
+#endif
+
+//1 starts every scan on a fixed phase of the steering PWM (TC4, TCC0 with
+//TCC_PWM_ENABLE) instead of back to back. TC4's overflow goes through EVSYS to TC7, a one-shot delay,
+//and TC7's overflow through EVSYS to the ADC start input, so sampling keeps
+//clear of the motor switching without any CPU involvement.
+//The scan then only runs while PWM_SteeringTorque does.
+#ifndef ADC_SAMPLER_PWM_TRIGGER
+#define ADC_SAMPLER_PWM_TRIGGER 0
+#endif
+
+//12MHz ticks from the start of the PWM period to the start of a scan.
+//200 is midway through the 30kHz steering period.
+#ifndef ADC_SAMPLER_TRIGGER_DELAY
+#define ADC_SAMPLER_TRIGGER_DELAY 200
+#endif
+
+//Full scale of a 12 bit result
+#define ADC_SAMPLER_FULL_SCALE 0xFFF
+//Full scale of AdcSamplerReadFine, whatever the channel's resolution
+#define ADC_SAMPLER_FINE_FULL_SCALE 0xFFFF
+
+//Takes ADC_0 over from the adc_sync driver and starts the scan.
+//Must be called once after atmel_start_init. adc_sync_read_channel must not
+//be used on ADC_0 afterwards. With ADC_SAMPLER_WINDOW_TRIP on_trip runs from
+//the window interrupt, it must make no RTOS calls. Call once the outputs
+//on_trip writes are running.
+void AdcSamplerInit(void (*on_trip)());
+
+//Filtered raw value of the channel, 0 to ADC_SAMPLER_FULL_SCALE whatever
+//its mode. The history starts zeroed, so reads in the first few
+//microseconds after AdcSamplerInit are low.
+uint16_t AdcSamplerRead(adc_sampler_channel_t channel);
+
+//As AdcSamplerRead, scaled to 16 bits, with the bits an oversampling mode
+//and the history average add below the 12 of AdcSamplerRead.
+uint16_t AdcSamplerReadFine(adc_sampler_channel_t channel);
+
+//Bit n set from a trip of channel n until AdcSamplerTripRelease clears it,
+//0 without ADC_SAMPLER_WINDOW_TRIP. Any context.
+uint32_t AdcSamplerTripped();
+
+//Trips since boot
+uint32_t AdcSamplerTrips();
+
+//Clears the latch of every tripped channel that reads back inside its
+//window and rearms its interrupt. From the control loop, after it has acted
+//on the trip.
+void AdcSamplerTripRelease();
+
+#endif /* ADCSAMPLER_H_ */
@@ -0,0 +1,483 @@
+/*
+ * BenchImage.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <compiler.h>
+#include "BenchImage.h"
+
+#if BENCH_IMAGE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/netif.h"
+#include "lwip/inet_chksum.h"
+#include "DriveByWireIO.h"
+#include "ControlProtocol.h"
+#include "PIDBenchmark.h"
+#include "NetMem.h"
+#include "Crc32.h"
+#include "BenchNetwork.h"
+#include "WcetCampaign.h"
+#include "Log.h"
+
+#if !LWIP_HAVE_LOOPIF
+#error BENCH_IMAGE needs LWIP_HAVE_LOOPIF for the loopback case, the Bench configuration sets it
+#endif
+
+//ms a loopback datagram may take before it counts as lost
+#define BENCH_IMAGE_LOOPBACK_TIMEOUT 10
+#define BENCH_IMAGE_LOOPBACK_SIZE 64
+
+//Largest memcpy and inet_chksum, a full UDP payload
+#define BENCH_IMAGE_BUFFER_SIZE 1472
+
+typedef struct bench_case_t
+{
+	const char* name;
+	bench_call_t call;
+	uint32_t iterations;
+} bench_case_t;
+
+typedef struct bench_state_t
+{
+	TaskHandle_t task;
+	PIDController pid;
+	control_protocol_t protocol;
+	control_command_info_t info;
+	control_command_t command;
+	uint8_t command_frame[CONTROL_COMMAND_FRAME_SIZE];
+	uint8_t telemetry_frame[CONTROL_TELEMETRY_MAX_FRAME_SIZE];
+	uint32_t telemetry_values[CONTROL_TELEMETRY_FIELD_COUNT];
+	QueueHandle_t queue;
+	SemaphoreHandle_t semaphore;
+	struct udp_pcb* pcb;
+	ip_addr_t loopback;
+	uint8_t src[BENCH_IMAGE_BUFFER_SIZE] __attribute__((aligned(4)));
+	uint8_t dst[BENCH_IMAGE_BUFFER_SIZE] __attribute__((aligned(4)));
+} bench_state_t;
+
+static bench_state_t bench;
+
+static uint8_t BenchEmpty()
+{
+	return 1;
+}
+
+static uint8_t BenchPidTick()
+{
+	tick(&bench.pid);
+	return 1;
+}
+
+static uint8_t BenchReadSteeringPosition()
+{
+	volatile float position = ReadSteeringPosition();
+	(void)position;
+	return 1;
+}
+
+//Every output at its off value, what the outputs sit at anyway
+static uint8_t BenchSetAcceleration()
+{
+	SetAcceleration(0.0f);
+	return 1;
+}
+
+static uint8_t BenchSetSteeringTorque()
+{
+	SetSteeringTorque(0.0f);
+	return 1;
+}
+
+static uint8_t BenchSetSteerDirection()
+{
+	SetSteerDirection(0);
+	return 1;
+}
+
+static uint8_t BenchSetFrontBrake()
+{
+	SetFrontBrake(0.0f);
+	return 1;
+}
+
+static uint8_t BenchSetReverseDrive()
+{
+	SetReverseDrive(0);
+	return 1;
+}
+
+static uint8_t BenchSetSafetyLight()
+{
+	SetSafetyLight1On(0);
+	return 1;
+}
+
+static uint8_t BenchCheckCommand()
+{
+	control_command_info_t info;
+	return ControlProtocolCheckCommand(&bench.protocol, bench.command_frame, sizeof(bench.command_frame), &info);
+}
+
+static uint8_t BenchDecodeCommand()
+{
+	ControlProtocolDecodeCommand(&bench.protocol, bench.command_frame, &bench.info, 0, &bench.command);
+	return 1;
+}
+
+static uint8_t BenchEncodeTelemetry()
+{
+	return ControlProtocolEncodeTelemetry(&bench.protocol, bench.telemetry_frame, CONTROL_TELEMETRY_GROUP_STATUS,
+		ControlProtocolGroupFields(CONTROL_TELEMETRY_GROUP_STATUS), bench.telemetry_values, 0) != 0;
+}
+
+static uint8_t BenchMemcpy16()
+{
+	memcpy(bench.dst, bench.src, 16);
+	return 1;
+}
+
+static uint8_t BenchMemcpy64()
+{
+	memcpy(bench.dst, bench.src, 64);
+	return 1;
+}
+
+static uint8_t BenchMemcpy256()
+{
+	memcpy(bench.dst, bench.src, 256);
+	return 1;
+}
+
+static uint8_t BenchMemcpy1024()
+{
+	memcpy(bench.dst, bench.src, 1024);
+	return 1;
+}
+
+static uint8_t BenchMemcpy1472()
+{
+	memcpy(bench.dst, bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	return 1;
+}
+
+//NetMem.h, against the memcpy ones above. The frame copies of hpl_gmac.c
+//start 2 bytes apart, ETH_PAD_SIZE, hence the unaligned one.
+static uint8_t BenchNetMemcpy64()
+{
+	NetMemcpy(bench.dst, bench.src, 64);
+	return 1;
+}
+
+static uint8_t BenchNetMemcpy256()
+{
+	NetMemcpy(bench.dst, bench.src, 256);
+	return 1;
+}
+
+static uint8_t BenchNetMemcpy1024()
+{
+	NetMemcpy(bench.dst, bench.src, 1024);
+	return 1;
+}
+
+static uint8_t BenchNetMemcpy1472()
+{
+	NetMemcpy(bench.dst, bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	return 1;
+}
+
+static uint8_t BenchNetMemcpyUnaligned1024()
+{
+	NetMemcpy(bench.dst, bench.src + 2, 1024);
+	return 1;
+}
+
+static uint8_t BenchMemcpyUnaligned1024()
+{
+	memcpy(bench.dst, bench.src + 2, 1024);
+	return 1;
+}
+
+static uint8_t BenchChecksum64()
+{
+	volatile u16_t sum = inet_chksum(bench.src, 64);
+	(void)sum;
+	return 1;
+}
+
+static uint8_t BenchChecksum1472()
+{
+	volatile u16_t sum = inet_chksum(bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	(void)sum;
+	return 1;
+}
+
+static uint8_t BenchNetChecksum64()
+{
+	volatile uint16_t sum = NetChecksum(bench.src, 64);
+	(void)sum;
+	return 1;
+}
+
+static uint8_t BenchNetChecksum1472()
+{
+	volatile uint16_t sum = NetChecksum(bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	(void)sum;
+	return 1;
+}
+
+static uint8_t BenchCrc32Table64()
+{
+	volatile uint32_t crc = Crc32Table(bench.src, 64);
+	(void)crc;
+	return 1;
+}
+
+static uint8_t BenchCrc32Table1472()
+{
+	volatile uint32_t crc = Crc32Table(bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	(void)crc;
+	return 1;
+}
+
+//on the DSU
+static uint8_t BenchCrc32Dsu64()
+{
+	volatile uint32_t crc = Crc32(bench.src, 64);
+	(void)crc;
+	return 1;
+}
+
+static uint8_t BenchCrc32Dsu1472()
+{
+	volatile uint32_t crc = Crc32(bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	(void)crc;
+	return 1;
+}
+
+//what Crc32Copy saves, against crc32_dma_copy_1472
+static uint8_t BenchCrc32AfterCopy1472()
+{
+	NetMemcpy(bench.dst, bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	volatile uint32_t crc = Crc32(bench.dst, BENCH_IMAGE_BUFFER_SIZE);
+	(void)crc;
+	return 1;
+}
+
+static uint8_t BenchCrc32DmaCopy1472()
+{
+	volatile uint32_t crc = Crc32Copy(bench.dst, bench.src, BENCH_IMAGE_BUFFER_SIZE);
+	(void)crc;
+	return 1;
+}
+
+static uint8_t BenchQueue()
+{
+	uint32_t value = 1;
+	if( xQueueSend(bench.queue, &value, 0) != pdTRUE )
+		return 0;
+	return xQueueReceive(bench.queue, &value, 0) == pdTRUE;
+}
+
+static uint8_t BenchSemaphore()
+{
+	if( xSemaphoreGive(bench.semaphore) != pdTRUE )
+		return 0;
+	return xSemaphoreTake(bench.semaphore, 0) == pdTRUE;
+}
+
+static uint8_t BenchTaskNotify()
+{
+	xTaskNotifyGive(bench.task);
+	return ulTaskNotifyTake(pdTRUE, 0) != 0;
+}
+
+//From the tcpip thread, the datagram made it back
+static void BenchLoopbackReceive(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	pbuf_free(p);
+	xTaskNotifyGive(bench.task);
+}
+
+//Out through udp_sendto and the loopback netif, back through the tcpip
+//thread's netif_poll and the receive callback, the whole UDP stack both
+//ways without the MAC
+static uint8_t BenchUdpLoopback()
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, BENCH_IMAGE_LOOPBACK_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return 0;
+	memcpy(p->payload, bench.src, BENCH_IMAGE_LOOPBACK_SIZE);
+
+	LOCK_TCPIP_CORE();
+	err_t err = udp_sendto(bench.pcb, p, &bench.loopback, BENCH_IMAGE_LOOPBACK_PORT);
+	UNLOCK_TCPIP_CORE();
+	pbuf_free(p);
+	if( err != ERR_OK )
+		return 0;
+
+	return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BENCH_IMAGE_LOOPBACK_TIMEOUT)) != 0;
+}
+
+static const bench_case_t bench_cases[] =
+{
+	{ "empty", BenchEmpty, BENCH_IMAGE_ITERATIONS },
+	{ "pid_tick", BenchPidTick, BENCH_IMAGE_ITERATIONS },
+	{ "read_steering_position", BenchReadSteeringPosition, BENCH_IMAGE_ITERATIONS },
+	{ "set_acceleration", BenchSetAcceleration, BENCH_IMAGE_ITERATIONS },
+	{ "set_steering_torque", BenchSetSteeringTorque, BENCH_IMAGE_ITERATIONS },
+	{ "set_steer_direction", BenchSetSteerDirection, BENCH_IMAGE_ITERATIONS },
+	{ "set_front_brake", BenchSetFrontBrake, BENCH_IMAGE_ITERATIONS },
+	{ "set_reverse_drive", BenchSetReverseDrive, BENCH_IMAGE_ITERATIONS },
+	{ "set_safety_light", BenchSetSafetyLight, BENCH_IMAGE_ITERATIONS },
+	{ "check_command", BenchCheckCommand, BENCH_IMAGE_ITERATIONS },
+	{ "decode_command", BenchDecodeCommand, BENCH_IMAGE_ITERATIONS },
+	{ "encode_telemetry", BenchEncodeTelemetry, BENCH_IMAGE_ITERATIONS },
+	{ "memcpy_16", BenchMemcpy16, BENCH_IMAGE_ITERATIONS },
+	{ "memcpy_64", BenchMemcpy64, BENCH_IMAGE_ITERATIONS },
+	{ "memcpy_256", BenchMemcpy256, BENCH_IMAGE_ITERATIONS },
+	{ "memcpy_1024", BenchMemcpy1024, BENCH_IMAGE_ITERATIONS },
+	{ "memcpy_1472", BenchMemcpy1472, BENCH_IMAGE_ITERATIONS },
+	{ "memcpy_unaligned_1024", BenchMemcpyUnaligned1024, BENCH_IMAGE_ITERATIONS },
+	{ "net_memcpy_64", BenchNetMemcpy64, BENCH_IMAGE_ITERATIONS },
+	{ "net_memcpy_256", BenchNetMemcpy256, BENCH_IMAGE_ITERATIONS },
+	{ "net_memcpy_1024", BenchNetMemcpy1024, BENCH_IMAGE_ITERATIONS },
+	{ "net_memcpy_1472", BenchNetMemcpy1472, BENCH_IMAGE_ITERATIONS },
+	{ "net_memcpy_unaligned_1024", BenchNetMemcpyUnaligned1024, BENCH_IMAGE_ITERATIONS },
+	{ "inet_chksum_64", BenchChecksum64, BENCH_IMAGE_ITERATIONS },
+	{ "inet_chksum_1472", BenchChecksum1472, BENCH_IMAGE_ITERATIONS },
+	{ "net_chksum_64", BenchNetChecksum64, BENCH_IMAGE_ITERATIONS },
+	{ "net_chksum_1472", BenchNetChecksum1472, BENCH_IMAGE_ITERATIONS },
+	{ "crc32_table_64", BenchCrc32Table64, BENCH_IMAGE_ITERATIONS },
+	{ "crc32_table_1472", BenchCrc32Table1472, BENCH_IMAGE_ITERATIONS },
+	{ "crc32_dsu_64", BenchCrc32Dsu64, BENCH_IMAGE_ITERATIONS },
+	{ "crc32_dsu_1472", BenchCrc32Dsu1472, BENCH_IMAGE_ITERATIONS },
+	{ "crc32_after_copy_1472", BenchCrc32AfterCopy1472, BENCH_IMAGE_ITERATIONS },
+	{ "crc32_dma_copy_1472", BenchCrc32DmaCopy1472, BENCH_IMAGE_ITERATIONS },
+	{ "queue_send_receive", BenchQueue, BENCH_IMAGE_ITERATIONS },
+	{ "semaphore_give_take", BenchSemaphore, BENCH_IMAGE_ITERATIONS },
+	{ "task_notify", BenchTaskNotify, BENCH_IMAGE_ITERATIONS },
+	{ "udp_loopback", BenchUdpLoopback, BENCH_IMAGE_LOOPBACK_ITERATIONS },
+};
+
+#define BENCH_CASE_COUNT (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+//Kept for mem_peek.py once the log has scrolled by
+static bench_result_t bench_results[BENCH_CASE_COUNT];
+
+static void BenchSetup()
+{
+	bench.task = xTaskGetCurrentTaskHandle();
+	//turns the cycle counter on as well
+	BenchmarkPIDInit(&bench.pid);
+
+	for(uint32_t i = 0; i < sizeof(bench.src); ++i)
+		bench.src[i] = (uint8_t)(i * 37);
+
+	//a command of nothing, the frame the PC sends most
+	uint8_t* frame = bench.command_frame;
+	ControlProtocolInit(&bench.protocol);
+	memset(frame, 0, sizeof(bench.command_frame));
+	frame[0] = CONTROL_PROTOCOL_VERSION;
+	frame[1] = CONTROL_FRAME_COMMAND;
+	frame[2] = CONTROL_COMMAND_PAYLOAD_SIZE;
+	frame[4] = 1;
+	frame[CONTROL_HEADER_SIZE + 4] = 0xFF;
+	frame[CONTROL_HEADER_SIZE + 5] = 0x7F;
+	uint32_t crc = ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + CONTROL_COMMAND_PAYLOAD_SIZE);
+	for(int i = 0; i < CONTROL_CRC_SIZE; ++i)
+		frame[CONTROL_HEADER_SIZE + CONTROL_COMMAND_PAYLOAD_SIZE + i] = (uint8_t)(crc >> (8 * i));
+	ControlProtocolCheckCommand(&bench.protocol, frame, sizeof(bench.command_frame), &bench.info);
+
+	bench.queue = xQueueCreate(1, sizeof(uint32_t));
+	bench.semaphore = xSemaphoreCreateBinary();
+
+	IP4_ADDR(&bench.loopback, 127, 0, 0, 1);
+	LOCK_TCPIP_CORE();
+	bench.pcb = udp_new();
+	if( bench.pcb != NULL )
+	{
+		udp_bind(bench.pcb, IP_ADDR_ANY, BENCH_IMAGE_LOOPBACK_PORT);
+		udp_recv(bench.pcb, BenchLoopbackReceive, NULL);
+	}
+	UNLOCK_TCPIP_CORE();
+}
+
+void BenchImageRun(bench_call_t call, uint32_t iterations, bench_result_t* result)
+{
+	uint32_t min = UINT32_MAX;
+	uint32_t max = 0;
+	uint64_t total = 0;
+	uint32_t completed = 0;
+	result->failed = 0;
+
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		uint32_t start = DWT->CYCCNT;
+		uint8_t ok = call();
+		uint32_t cycles = DWT->CYCCNT - start;
+		if( !ok )
+		{
+			result->failed++;
+			continue;
+		}
+		completed++;
+		total += cycles;
+		if( cycles < min )
+			min = cycles;
+		if( cycles > max )
+			max = cycles;
+	}
+
+	result->min = completed ? min : 0;
+	result->mean = completed ? (uint32_t)(total / completed) : 0;
+	result->max = max;
+}
+
+void BenchImageRemoveOverhead(bench_result_t* result, uint32_t overhead)
+{
+	result->min = result->min > overhead ? result->min - overhead : 0;
+	result->mean = result->mean > overhead ? result->mean - overhead : 0;
+	result->max = result->max > overhead ? result->max - overhead : 0;
+}
+
+void BenchImageTask(void* p)
+{
+	//lwIP is up once the ethernet thread has added its interface
+	while( netif_default == NULL )
+		vTaskDelay(pdMS_TO_TICKS(BENCH_IMAGE_LOG_PERIOD));
+
+	BenchSetup();
+	for(uint32_t i = 0; i < BENCH_CASE_COUNT; ++i)
+		BenchImageRun(bench_cases[i].call, bench_cases[i].iterations, &bench_results[i]);
+
+	//what timing a call costs, taken off every case
+	uint32_t overhead = bench_results[0].min;
+	LOG("bench overhead %lu cycles, %lu cases", overhead, BENCH_CASE_COUNT - 1);
+	for(uint32_t i = 1; i < BENCH_CASE_COUNT; ++i)
+	{
+		bench_result_t* result = &bench_results[i];
+		BenchImageRemoveOverhead(result, overhead);
+		if( result->failed )
+			LOG("bench %s %lu %lu %lu failed %lu", bench_cases[i].name, result->min, result->mean, result->max, result->failed);
+		else
+			LOG("bench %s %lu %lu %lu", bench_cases[i].name, result->min, result->mean, result->max);
+		vTaskDelay(pdMS_TO_TICKS(BENCH_IMAGE_LOG_PERIOD));
+	}
+	BenchNetworkRun(overhead);
+	LOG("bench done");
+	WcetCampaignRun((struct main_context_t*)p);
+
+	while( 1 )
+		vTaskDelay(portMAX_DELAY);
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * BenchImage.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef BENCHIMAGE_H_
+#define BENCHIMAGE_H_
+
+#include <stdint.h>
+
+//The microbenchmark catalogue of the Bench configuration, a firmware image
+//of its own that runs in place of main_task.
+//
+//PID_BENCHMARK, FILTER_BENCHMARK and SYS_ARCH_BENCHMARK each time one
+//module in the normal image, and only as an average. The Bench image times
+//everything the control cycle is made of, one call at a time with the DWT
+//cycle counter: tick(), ReadSteeringPosition, the Set* calls, command
+//decode and telemetry encode, memcpy and inet_chksum at the sizes the
+//network path copies and sums, CRC-32 on each engine (Crc32.h), the
+//FreeRTOS handoffs and a UDP round trip through lwIP's loopback interface.
+//BenchNetwork.h follows with UDP and TCP through the loopback interface at
+//a range of sizes. Each case keeps its minimum, mean and maximum, less the
+//minimum of an empty call, and logs one line per case:
+//
+//  bench <name> <min> <mean> <max>
+//
+//PythonTestScripts/bench_compare.py reads those lines from the log, saves
+//them as a baseline and fails on a regression against one.
+//
+//The Set* cases drive the real outputs at their off values, the estop
+//interrupt still cuts them. The watchdog is off in the configuration, the
+//control loop it watches never runs, and so is anything else that needs
+//main_task.
+
+#ifndef BENCH_IMAGE
+#define BENCH_IMAGE 0
+#endif
+
+//Timed calls per case, the loopback round trip makes fewer
+#ifndef BENCH_IMAGE_ITERATIONS
+#define BENCH_IMAGE_ITERATIONS 1000
+#endif
+#ifndef BENCH_IMAGE_LOOPBACK_ITERATIONS
+#define BENCH_IMAGE_LOOPBACK_ITERATIONS 100
+#endif
+
+//UDP port the loopback case sends to itself on
+#define BENCH_IMAGE_LOOPBACK_PORT 12093
+
+//ms between two result lines, so the log ring never fills
+#define BENCH_IMAGE_LOG_PERIOD 20
+
+typedef struct bench_result_t
+{
+	//core cycles of one call, less the empty call's minimum
+	uint32_t min;
+	uint32_t mean;
+	uint32_t max;
+	//calls that did not complete, for the loopback case lost datagrams
+	uint32_t failed;
+} bench_result_t;
+
+//One call under test, 0 if it did not complete
+typedef uint8_t (*bench_call_t)();
+
+//Times iterations calls, result in raw cycles
+void BenchImageRun(bench_call_t call, uint32_t iterations, bench_result_t* result);
+
+//Takes what timing an empty call costs off result
+void BenchImageRemoveOverhead(bench_result_t* result, uint32_t overhead);
+
+//The task main() starts instead of main_task in the Bench image. Waits for
+//the network, runs the catalogue once, logs it and then idles.
+void BenchImageTask(void* p);
+
+#endif /* BENCHIMAGE_H_ */
@@ -0,0 +1,503 @@
+/*
+ * BenchNetwork.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <peripheral_clk_config.h>
+#include "BenchImage.h"
+#include "BenchNetwork.h"
+
+#if BENCH_IMAGE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/tcp.h"
+#include "lwip/api.h"
+#include "lwip/sockets.h"
+#include "Log.h"
+
+#if !LWIP_SO_RCVTIMEO
+#error BENCH_IMAGE needs LWIP_SO_RCVTIMEO for the netconn and socket cases, the Bench configuration sets it
+#endif
+
+typedef enum bench_network_api_t
+{
+	BENCH_NETWORK_RAW = 0,
+	BENCH_NETWORK_NETCONN,
+	BENCH_NETWORK_SOCKET,
+	BENCH_NETWORK_API_COUNT
+} bench_network_api_t;
+
+//One protocol through one API
+typedef struct bench_network_case_t
+{
+	const char* name;
+	bench_network_api_t api;
+	//set up the receiving and the sending end, 0 if they are not
+	uint8_t (*setup)(u16_t port);
+	//one packet of bench_network.size across
+	bench_call_t packet;
+	void (*teardown)();
+} bench_network_case_t;
+
+static const uint16_t bench_network_sizes[] = BENCH_NETWORK_SIZES;
+
+static struct
+{
+	TaskHandle_t task;
+	ip_addr_t loopback;
+	struct sockaddr_in address;
+	//payload bytes of the case that runs
+	uint16_t size;
+
+	struct udp_pcb* udp;
+	//for the TCP error callback, which clears the one that went
+	struct tcp_pcb* listener;
+	struct tcp_pcb* client;
+	struct tcp_pcb* server;
+	uint8_t connected;
+	//bytes the raw server has received of the packet, tcpip thread
+	uint32_t received;
+
+	struct netconn* conn;
+	struct netconn* listen_conn;
+	struct netconn* server_conn;
+
+	int socket;
+	int listen_socket;
+	int server_socket;
+
+	uint8_t payload[BENCH_NETWORK_MAX_SIZE] __attribute__((aligned(4)));
+	uint8_t sink[BENCH_NETWORK_MAX_SIZE] __attribute__((aligned(4)));
+} bench_network;
+
+static uint8_t BenchNetworkWait()
+{
+	return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BENCH_NETWORK_TIMEOUT)) != 0;
+}
+
+//UDP, raw
+
+static void BenchUdpRawReceive(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	pbuf_free(p);
+	xTaskNotifyGive(bench_network.task);
+}
+
+static uint8_t BenchUdpRawOpen(u16_t port)
+{
+	LOCK_TCPIP_CORE();
+	bench_network.udp = udp_new();
+	if( bench_network.udp != NULL )
+	{
+		udp_bind(bench_network.udp, IP_ADDR_ANY, port);
+		udp_recv(bench_network.udp, BenchUdpRawReceive, NULL);
+	}
+	UNLOCK_TCPIP_CORE();
+	return bench_network.udp != NULL;
+}
+
+static uint8_t BenchUdpRawPacket()
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, bench_network.size, PBUF_RAM);
+	if( p == NULL )
+		return 0;
+	memcpy(p->payload, bench_network.payload, bench_network.size);
+
+	LOCK_TCPIP_CORE();
+	err_t err = udp_sendto(bench_network.udp, p, &bench_network.loopback, bench_network.udp->local_port);
+	UNLOCK_TCPIP_CORE();
+	pbuf_free(p);
+	if( err != ERR_OK )
+		return 0;
+	return BenchNetworkWait();
+}
+
+static void BenchUdpRawClose()
+{
+	LOCK_TCPIP_CORE();
+	udp_remove(bench_network.udp);
+	UNLOCK_TCPIP_CORE();
+	bench_network.udp = NULL;
+}
+
+//UDP, netconn
+
+static uint8_t BenchUdpNetconnOpen(u16_t port)
+{
+	bench_network.conn = netconn_new(NETCONN_UDP);
+	if( bench_network.conn == NULL )
+		return 0;
+	netconn_set_recvtimeout(bench_network.conn, BENCH_NETWORK_TIMEOUT);
+	return netconn_bind(bench_network.conn, IP_ADDR_ANY, port) == ERR_OK;
+}
+
+//By reference, as the socket build's SendDatagram (EthernetIO.c)
+static uint8_t BenchUdpNetconnPacket()
+{
+	struct netbuf datagram;
+	memset(&datagram, 0, sizeof(datagram));
+	err_t err = netbuf_ref(&datagram, bench_network.payload, bench_network.size);
+	if( err == ERR_OK )
+		err = netconn_sendto(bench_network.conn, &datagram, &bench_network.loopback,
+			bench_network.conn->pcb.udp->local_port);
+	netbuf_free(&datagram);
+	if( err != ERR_OK )
+		return 0;
+
+	struct netbuf* received;
+	if( netconn_recv(bench_network.conn, &received) != ERR_OK )
+		return 0;
+	uint8_t ok = netbuf_copy(received, bench_network.sink, sizeof(bench_network.sink)) == bench_network.size;
+	netbuf_delete(received);
+	return ok;
+}
+
+static void BenchUdpNetconnClose()
+{
+	if( bench_network.conn != NULL )
+		netconn_delete(bench_network.conn);
+	bench_network.conn = NULL;
+}
+
+//UDP, socket
+
+static void BenchSocketClose(int* s)
+{
+	if( *s >= 0 )
+		lwip_close(*s);
+	*s = -1;
+}
+
+static uint8_t BenchSocketTimeout(int s)
+{
+	int timeout = BENCH_NETWORK_TIMEOUT;
+	return lwip_setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+static uint8_t BenchUdpSocketOpen(u16_t port)
+{
+	bench_network.address.sin_port = htons(port);
+	bench_network.socket = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+	if( bench_network.socket < 0 || !BenchSocketTimeout(bench_network.socket) )
+		return 0;
+
+	struct sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_len = sizeof(local);
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	return lwip_bind(bench_network.socket, (struct sockaddr*)&local, sizeof(local)) == 0;
+}
+
+static uint8_t BenchUdpSocketPacket()
+{
+	if( lwip_sendto(bench_network.socket, bench_network.payload, bench_network.size, 0,
+		(struct sockaddr*)&bench_network.address, sizeof(bench_network.address)) != bench_network.size )
+		return 0;
+	return lwip_recv(bench_network.socket, bench_network.sink, sizeof(bench_network.sink), 0) == bench_network.size;
+}
+
+static void BenchUdpSocketClose()
+{
+	BenchSocketClose(&bench_network.socket);
+}
+
+//TCP, raw
+
+static void BenchTcpRawError(void *arg, err_t err)
+{
+	//lwIP frees the pcb itself
+	*(struct tcp_pcb**)arg = NULL;
+	xTaskNotifyGive(bench_network.task);
+}
+
+static err_t BenchTcpRawReceive(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	//the client closed
+	if( p == NULL )
+		return ERR_OK;
+	bench_network.received += p->tot_len;
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+	if( bench_network.received >= bench_network.size )
+		xTaskNotifyGive(bench_network.task);
+	return ERR_OK;
+}
+
+static err_t BenchTcpRawAccept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	tcp_accepted(bench_network.listener);
+	bench_network.server = pcb;
+	tcp_arg(pcb, &bench_network.server);
+	tcp_err(pcb, BenchTcpRawError);
+	tcp_recv(pcb, BenchTcpRawReceive);
+	xTaskNotifyGive(bench_network.task);
+	return ERR_OK;
+}
+
+static err_t BenchTcpRawConnected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	bench_network.connected = 1;
+	xTaskNotifyGive(bench_network.task);
+	return ERR_OK;
+}
+
+static void BenchTcpRawClosePcb(struct tcp_pcb** pcb)
+{
+	if( *pcb == NULL )
+		return;
+	tcp_arg(*pcb, NULL);
+	tcp_err(*pcb, NULL);
+	tcp_recv(*pcb, NULL);
+	if( tcp_close(*pcb) != ERR_OK )
+		tcp_abort(*pcb);
+	*pcb = NULL;
+}
+
+static uint8_t BenchTcpRawOpen(u16_t port)
+{
+	uint8_t ok = 0;
+	bench_network.connected = 0;
+	LOCK_TCPIP_CORE();
+	struct tcp_pcb* pcb = tcp_new();
+	if( pcb != NULL && tcp_bind(pcb, IP_ADDR_ANY, port) == ERR_OK )
+	{
+		bench_network.listener = tcp_listen(pcb);
+		pcb = bench_network.listener != NULL ? NULL : pcb;
+	}
+	if( pcb != NULL )
+		tcp_close(pcb);
+	if( bench_network.listener != NULL )
+	{
+		tcp_accept(bench_network.listener, BenchTcpRawAccept);
+		bench_network.client = tcp_new();
+	}
+	if( bench_network.client != NULL )
+	{
+		tcp_nagle_disable(bench_network.client);
+		tcp_arg(bench_network.client, &bench_network.client);
+		tcp_err(bench_network.client, BenchTcpRawError);
+		ok = tcp_connect(bench_network.client, &bench_network.loopback, port, BenchTcpRawConnected) == ERR_OK;
+	}
+	UNLOCK_TCPIP_CORE();
+
+	//the connected and the accept callbacks, in either order
+	while( ok && !(bench_network.connected && bench_network.server != NULL) )
+		ok = BenchNetworkWait() && bench_network.client != NULL;
+	return ok;
+}
+
+static uint8_t BenchTcpRawPacket()
+{
+	LOCK_TCPIP_CORE();
+	bench_network.received = 0;
+	err_t err = ERR_CONN;
+	if( bench_network.client != NULL && bench_network.server != NULL )
+		err = tcp_write(bench_network.client, bench_network.payload, bench_network.size, TCP_WRITE_FLAG_COPY);
+	if( err == ERR_OK )
+		err = tcp_output(bench_network.client);
+	UNLOCK_TCPIP_CORE();
+	if( err != ERR_OK )
+		return 0;
+	return BenchNetworkWait() && bench_network.received >= bench_network.size;
+}
+
+static void BenchTcpRawClose()
+{
+	LOCK_TCPIP_CORE();
+	BenchTcpRawClosePcb(&bench_network.client);
+	BenchTcpRawClosePcb(&bench_network.server);
+	if( bench_network.listener != NULL )
+		tcp_close(bench_network.listener);
+	bench_network.listener = NULL;
+	UNLOCK_TCPIP_CORE();
+}
+
+//TCP, netconn
+
+static uint8_t BenchTcpNetconnOpen(u16_t port)
+{
+	bench_network.listen_conn = netconn_new(NETCONN_TCP);
+	bench_network.conn = netconn_new(NETCONN_TCP);
+	if( bench_network.listen_conn == NULL || bench_network.conn == NULL )
+		return 0;
+	netconn_set_recvtimeout(bench_network.listen_conn, BENCH_NETWORK_TIMEOUT);
+	if( netconn_bind(bench_network.listen_conn, IP_ADDR_ANY, port) != ERR_OK
+		|| netconn_listen(bench_network.listen_conn) != ERR_OK
+		|| netconn_connect(bench_network.conn, &bench_network.loopback, port) != ERR_OK )
+		return 0;
+	LOCK_TCPIP_CORE();
+	tcp_nagle_disable(bench_network.conn->pcb.tcp);
+	UNLOCK_TCPIP_CORE();
+
+	if( netconn_accept(bench_network.listen_conn, &bench_network.server_conn) != ERR_OK )
+		return 0;
+	netconn_set_recvtimeout(bench_network.server_conn, BENCH_NETWORK_TIMEOUT);
+	return 1;
+}
+
+static uint8_t BenchTcpNetconnPacket()
+{
+	if( netconn_write(bench_network.conn, bench_network.payload, bench_network.size, NETCONN_COPY) != ERR_OK )
+		return 0;
+	//pbufs rather than netbufs, netconn_recv_tcp_pbuf acknowledges them
+	uint32_t received = 0;
+	while( received < bench_network.size )
+	{
+		struct pbuf* p;
+		if( netconn_recv_tcp_pbuf(bench_network.server_conn, &p) != ERR_OK )
+			return 0;
+		received += p->tot_len;
+		pbuf_free(p);
+	}
+	return 1;
+}
+
+static void BenchTcpNetconnClose()
+{
+	if( bench_network.conn != NULL )
+		netconn_delete(bench_network.conn);
+	if( bench_network.server_conn != NULL )
+		netconn_delete(bench_network.server_conn);
+	if( bench_network.listen_conn != NULL )
+		netconn_delete(bench_network.listen_conn);
+	bench_network.conn = NULL;
+	bench_network.server_conn = NULL;
+	bench_network.listen_conn = NULL;
+}
+
+//TCP, socket
+
+static uint8_t BenchTcpSocketOpen(u16_t port)
+{
+	bench_network.address.sin_port = htons(port);
+	bench_network.listen_socket = lwip_socket(AF_INET, SOCK_STREAM, 0);
+	bench_network.socket = lwip_socket(AF_INET, SOCK_STREAM, 0);
+	if( bench_network.listen_socket < 0 || bench_network.socket < 0 || !BenchSocketTimeout(bench_network.listen_socket) )
+		return 0;
+
+	struct sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_len = sizeof(local);
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	int nodelay = 1;
+	if( lwip_bind(bench_network.listen_socket, (struct sockaddr*)&local, sizeof(local)) != 0
+		|| lwip_listen(bench_network.listen_socket, 1) != 0
+		|| lwip_setsockopt(bench_network.socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) != 0
+		|| lwip_connect(bench_network.socket, (struct sockaddr*)&bench_network.address, sizeof(bench_network.address)) != 0 )
+		return 0;
+
+	bench_network.server_socket = lwip_accept(bench_network.listen_socket, NULL, NULL);
+	return bench_network.server_socket >= 0 && BenchSocketTimeout(bench_network.server_socket);
+}
+
+static uint8_t BenchTcpSocketPacket()
+{
+	if( lwip_send(bench_network.socket, bench_network.payload, bench_network.size, 0) != bench_network.size )
+		return 0;
+	int received = 0;
+	while( received < bench_network.size )
+	{
+		int length = lwip_recv(bench_network.server_socket, bench_network.sink + received, bench_network.size - received, 0);
+		if( length <= 0 )
+			return 0;
+		received += length;
+	}
+	return 1;
+}
+
+static void BenchTcpSocketClose()
+{
+	BenchSocketClose(&bench_network.socket);
+	BenchSocketClose(&bench_network.server_socket);
+	BenchSocketClose(&bench_network.listen_socket);
+}
+
+static const bench_network_case_t bench_network_cases[] =
+{
+	{ "udp_raw", BENCH_NETWORK_RAW, BenchUdpRawOpen, BenchUdpRawPacket, BenchUdpRawClose },
+	{ "udp_netconn", BENCH_NETWORK_NETCONN, BenchUdpNetconnOpen, BenchUdpNetconnPacket, BenchUdpNetconnClose },
+	{ "udp_socket", BENCH_NETWORK_SOCKET, BenchUdpSocketOpen, BenchUdpSocketPacket, BenchUdpSocketClose },
+	{ "tcp_raw", BENCH_NETWORK_RAW, BenchTcpRawOpen, BenchTcpRawPacket, BenchTcpRawClose },
+	{ "tcp_netconn", BENCH_NETWORK_NETCONN, BenchTcpNetconnOpen, BenchTcpNetconnPacket, BenchTcpNetconnClose },
+	{ "tcp_socket", BENCH_NETWORK_SOCKET, BenchTcpSocketOpen, BenchTcpSocketPacket, BenchTcpSocketClose },
+};
+
+#define BENCH_NETWORK_CASE_COUNT (sizeof(bench_network_cases) / sizeof(bench_network_cases[0]))
+#define BENCH_NETWORK_SIZE_COUNT (sizeof(bench_network_sizes) / sizeof(bench_network_sizes[0]))
+
+//Kept for mem_peek.py once the log has scrolled by
+static bench_result_t bench_network_results[BENCH_NETWORK_CASE_COUNT][BENCH_NETWORK_SIZE_COUNT];
+
+//kbit/s of one packet of size every mean cycles
+static uint32_t BenchNetworkRate(uint16_t size, uint32_t mean)
+{
+	if( mean == 0 )
+		return 0;
+	return (uint32_t)((uint64_t)size * 8 * (CONF_CPU_FREQUENCY / 1000) / mean);
+}
+
+static void BenchNetworkLog(const bench_network_case_t* bench_case, uint16_t size, bench_result_t* result)
+{
+	if( result->failed )
+		LOG("bench %s_%u %lu %lu %lu failed %lu", bench_case->name, size, result->min, result->mean, result->max,
+			result->failed);
+	else
+		LOG("bench %s_%u %lu %lu %lu", bench_case->name, size, result->min, result->mean, result->max);
+	LOG("net %s_%u %lu kbit/s", bench_case->name, size, BenchNetworkRate(size, result->mean));
+	vTaskDelay(pdMS_TO_TICKS(BENCH_IMAGE_LOG_PERIOD));
+}
+
+void BenchNetworkRun(uint32_t overhead)
+{
+	bench_network.task = xTaskGetCurrentTaskHandle();
+	bench_network.socket = -1;
+	bench_network.listen_socket = -1;
+	bench_network.server_socket = -1;
+	for(uint32_t i = 0; i < sizeof(bench_network.payload); ++i)
+		bench_network.payload[i] = (uint8_t)(i * 37);
+	IP4_ADDR(&bench_network.loopback, 127, 0, 0, 1);
+	memset(&bench_network.address, 0, sizeof(bench_network.address));
+	bench_network.address.sin_len = sizeof(bench_network.address);
+	bench_network.address.sin_family = AF_INET;
+	bench_network.address.sin_addr.s_addr = bench_network.loopback.addr;
+
+	for(uint32_t i = 0; i < BENCH_NETWORK_CASE_COUNT; ++i)
+	{
+		const bench_network_case_t* bench_case = &bench_network_cases[i];
+		//nothing the last case left behind wakes this one
+		ulTaskNotifyTake(pdTRUE, 0);
+		uint8_t ready = bench_case->setup(BENCH_NETWORK_PORT + bench_case->api);
+		for(uint32_t n = 0; n < BENCH_NETWORK_SIZE_COUNT; ++n)
+		{
+			bench_result_t* result = &bench_network_results[i][n];
+			bench_network.size = bench_network_sizes[n];
+			if( ready )
+			{
+				BenchImageRun(bench_case->packet, BENCH_NETWORK_ITERATIONS, result);
+				BenchImageRemoveOverhead(result, overhead);
+			}
+			else
+			{
+				//every packet of a case that could not set up fails
+				memset(result, 0, sizeof(*result));
+				result->failed = BENCH_NETWORK_ITERATIONS;
+			}
+			BenchNetworkLog(bench_case, bench_network.size, result);
+		}
+		bench_case->teardown();
+		//lets the closes play out in the tcpip thread
+		vTaskDelay(pdMS_TO_TICKS(BENCH_NETWORK_TIMEOUT));
+	}
+	LOG("bench network %lu cases", BENCH_NETWORK_CASE_COUNT * BENCH_NETWORK_SIZE_COUNT);
+}
+
+#endif
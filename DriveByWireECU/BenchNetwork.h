@@ -0,0 +1,57 @@
+/*
+ * BenchNetwork.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef BENCHNETWORK_H_
+#define BENCHNETWORK_H_
+
+#include <stdint.h>
+
+//The network half of the Bench image (BenchImage.h): what lwIP costs per
+//packet apart from the wire, the GMAC and the PHY, on a board with nothing
+//plugged in.
+//
+//UDP and TCP through the raw, netconn and socket APIs, each at every size
+//of BENCH_NETWORK_SIZES, out to 127.0.0.1 and back in through the loopback
+//netif (LWIP_HAVE_LOOPIF and LWIP_NETIF_LOOPBACK, both set by the Bench
+//configuration). The Bench task is the sender and the receiver at once. One
+//packet is timed from the send call until the receiving end holds all of
+//it: for the raw API the receive callback in the tcpip thread, for the
+//others the netconn_recv or lwip_recv that returns it. TCP runs on one
+//connection per API, set up before and closed after the sizes, with Nagle
+//off so every write goes out as one segment.
+//
+//Each case logs a bench line as the catalogue does, named
+//<protocol>_<api>_<size>, and one line of what its mean comes to as a rate:
+//
+//  bench udp_netconn_256 <min> <mean> <max>
+//  net udp_netconn_256 <kbit/s> kbit/s
+//
+//A packet that does not arrive in BENCH_NETWORK_TIMEOUT counts as failed.
+//The Bench configuration also sets LWIP_SO_RCVTIMEO for the netconn and
+//socket receives and more 1600 byte pool elements for the full size
+//segments in flight.
+
+//Timed packets per case
+#ifndef BENCH_NETWORK_ITERATIONS
+#define BENCH_NETWORK_ITERATIONS 100
+#endif
+
+//Payload bytes, the largest a TCP_MSS segment and a UDP datagram share
+#define BENCH_NETWORK_SIZES { 16, 64, 256, 1024, 1460 }
+#define BENCH_NETWORK_MAX_SIZE 1460
+
+//ms a packet, a connect or an accept may take before it counts as failed
+#define BENCH_NETWORK_TIMEOUT 10
+
+//First of the ports the cases listen on, one per API so that no TCP case
+//waits for the last one's connection to go
+#define BENCH_NETWORK_PORT 12095
+
+//Runs every case and logs it, overhead taken off as for the catalogue.
+//From the Bench task, once lwIP is up.
+void BenchNetworkRun(uint32_t overhead);
+
+#endif /* BENCHNETWORK_H_ */
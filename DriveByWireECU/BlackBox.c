@@ -0,0 +1,436 @@
+/*
+ * BlackBox.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "BlackBox.h"
+#include "QspiFlash.h"
+#include "TccPwm.h"
+#include "FastCode.h"
+#include "Log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Service.h"
+
+#if BLACK_BOX_ENABLE
+
+#if TCC_PWM_ENABLE
+#error BLACK_BOX_ENABLE needs PA08 and PB10, TCC_PWM_ENABLE has them
+#endif
+
+#if (BLACK_BOX_FIRST_SECTOR + BLACK_BOX_SECTORS) * QSPI_FLASH_SECTOR_SIZE > QSPI_FLASH_SIZE
+#error The black box does not fit in the flash
+#endif
+
+#define BLACK_BOX_PAGE_ENTRIES (QSPI_FLASH_PAGE_SIZE / sizeof(black_box_entry_t))
+#define BLACK_BOX_QUEUE_MASK (BLACK_BOX_QUEUE - 1)
+
+typedef struct black_box_t
+{
+	//black_box_state_t, only the black box service changes it
+	uint8_t state;
+	//the tcpip thread's: downloads in progress, and a rearm for the service
+	uint8_t holders;
+	uint8_t rearm;
+	//main_task's
+	uint32_t decimation;
+	uint32_t queue_head;
+	uint32_t queue_dropped;
+	black_box_entry_t queue[BLACK_BOX_QUEUE];
+	//the service's
+	uint32_t queue_tail;
+	uint32_t next_event;
+	//ring index of the sector being written, its next entry and sequence
+	uint32_t sector;
+	uint32_t entry;
+	uint32_t sequence;
+	uint32_t session;
+	TickType_t trigger_tick;
+	event_log_entry_t cause;
+	uint32_t failures;
+	//while frozen: ring index of the oldest sector, and how many there are
+	uint32_t oldest;
+	uint32_t sectors;
+	//the page being filled, erased where nothing is in it yet
+	black_box_entry_t page[BLACK_BOX_PAGE_ENTRIES];
+} black_box_t;
+
+static black_box_t black_box;
+
+static uint32_t EntryAddress(uint32_t sector, uint32_t entry)
+{
+	return (BLACK_BOX_FIRST_SECTOR + sector) * QSPI_FLASH_SECTOR_SIZE + entry * sizeof(black_box_entry_t);
+}
+
+static const black_box_entry_t* MappedEntry(uint32_t sector, uint32_t entry)
+{
+	return (const black_box_entry_t*)QspiFlashMapped(EntryAddress(sector, entry));
+}
+
+//The sector's header if it is one of ours
+static const black_box_entry_t* SectorHeader(uint32_t sector)
+{
+	const black_box_entry_t* header = MappedEntry(sector, 0);
+	if( header->type != BLACK_BOX_SECTOR || header->sector.magic != BLACK_BOX_MAGIC )
+		return NULL;
+	return header;
+}
+
+static void Failed(const char* what)
+{
+	if( black_box.failures++ == 0 )
+		LOG("Black box: %s of sector %lu failed", what, black_box.sector);
+}
+
+static void ProgramPage()
+{
+	uint32_t first = (black_box.entry - 1) / BLACK_BOX_PAGE_ENTRIES * BLACK_BOX_PAGE_ENTRIES;
+	if( !QspiFlashProgram(EntryAddress(black_box.sector, first), black_box.page, sizeof(black_box.page)) )
+		Failed("program");
+	memset(black_box.page, BLACK_BOX_ERASED, sizeof(black_box.page));
+}
+
+//Erases the sector and programs its header on its own, so the sector is
+//part of the ring from here on even if nothing follows
+static void OpenSector(uint32_t sector)
+{
+	black_box.sector = sector;
+	black_box.entry = 1;
+	black_box.sequence++;
+	memset(black_box.page, BLACK_BOX_ERASED, sizeof(black_box.page));
+	if( !QspiFlashErase(EntryAddress(sector, 0)) )
+		Failed("erase");
+
+	black_box_entry_t header;
+	memset(&header, 0, sizeof(header));
+	header.type = BLACK_BOX_SECTOR;
+	header.tick = xTaskGetTickCount();
+	header.sector.magic = BLACK_BOX_MAGIC;
+	header.sector.sequence = black_box.sequence;
+	header.sector.session = black_box.session;
+	if( !QspiFlashProgram(EntryAddress(sector, 0), &header, sizeof(header)) )
+		Failed("program");
+}
+
+//The next sector is only opened for the entry that needs it, a freeze
+//entry in the last slot still ends the newest sector
+static void Add(const black_box_entry_t* entry)
+{
+	if( black_box.entry == BLACK_BOX_SECTOR_ENTRIES )
+		OpenSector((black_box.sector + 1) % BLACK_BOX_SECTORS);
+	black_box.page[black_box.entry % BLACK_BOX_PAGE_ENTRIES] = *entry;
+	black_box.entry++;
+	if( black_box.entry % BLACK_BOX_PAGE_ENTRIES == 0 )
+		ProgramPage();
+}
+
+//Walks back from the newest sector for as long as the sequence numbers do
+static void FindOldest()
+{
+	uint32_t sector = black_box.sector;
+	uint32_t sequence = black_box.sequence;
+	black_box.sectors = 1;
+	while( black_box.sectors < BLACK_BOX_SECTORS )
+	{
+		uint32_t previous = (sector + BLACK_BOX_SECTORS - 1) % BLACK_BOX_SECTORS;
+		const black_box_entry_t* header = SectorHeader(previous);
+		if( header == NULL || header->sector.sequence != sequence - 1 )
+			break;
+		sector = previous;
+		sequence--;
+		black_box.sectors++;
+	}
+	black_box.oldest = sector;
+}
+
+//With the post trigger time over: the freeze entry, whatever is left of
+//the page, and the window made to match the flash again. The last also
+//empties a way FAST_CODE_CACHE_LOCK locked, the control path then runs
+//from the unlocked ways until the next boot.
+static void Freeze()
+{
+	black_box_entry_t entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.type = BLACK_BOX_FREEZE;
+	entry.tick = xTaskGetTickCount();
+	entry.event = black_box.cause;
+	Add(&entry);
+	if( black_box.entry % BLACK_BOX_PAGE_ENTRIES != 0 )
+		ProgramPage();
+
+	FindOldest();
+	QspiFlashInvalidate();
+	__atomic_store_n(&black_box.state, BLACK_BOX_FROZEN, __ATOMIC_RELEASE);
+	LOG("Black box frozen by event %u, %lu sectors", black_box.cause.id, black_box.sectors);
+}
+
+static void Trigger(const event_log_entry_t* event)
+{
+	if( black_box.state != BLACK_BOX_RECORDING || !(BLACK_BOX_FREEZE_EVENTS & (1UL << event->id)) )
+		return;
+	if( event->id == EVENT_LOG_ESTOP && event->arg == 0 )
+		return;
+	black_box.cause = *event;
+	black_box.trigger_tick = xTaskGetTickCount();
+	__atomic_store_n(&black_box.state, BLACK_BOX_TRIGGERED, __ATOMIC_RELEASE);
+}
+
+static void TakeEvents()
+{
+	uint32_t next = EventLogNext();
+	if( next - black_box.next_event > EVENT_LOG_DEPTH )
+		black_box.next_event = next - EVENT_LOG_DEPTH;
+
+	black_box_entry_t entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.type = BLACK_BOX_EVENT;
+	while( black_box.next_event != next )
+	{
+		//one being written is there next time
+		if( !EventLogRead(black_box.next_event, &entry.event) )
+			break;
+		black_box.next_event++;
+		entry.tick = entry.event.tick;
+		Add(&entry);
+		Trigger(&entry.event);
+	}
+}
+
+static void TakeQueue()
+{
+	uint32_t head = __atomic_load_n(&black_box.queue_head, __ATOMIC_ACQUIRE);
+	while( black_box.queue_tail != head )
+	{
+		Add(&black_box.queue[black_box.queue_tail & BLACK_BOX_QUEUE_MASK]);
+		__atomic_store_n(&black_box.queue_tail, black_box.queue_tail + 1, __ATOMIC_RELEASE);
+	}
+}
+
+static service_t black_box_service;
+
+static service_result_t BlackBoxService(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	if( black_box.state == BLACK_BOX_FROZEN )
+		LOG("Black box frozen since before the reset, by event %u", black_box.cause.id);
+	else
+		OpenSector((black_box.sector + 1) % BLACK_BOX_SECTORS);
+
+	while(1)
+	{
+		SERVICE_DELAY(service, BLACK_BOX_POLL_PERIOD);
+
+		if( black_box.state == BLACK_BOX_FROZEN )
+		{
+			if( !__atomic_load_n(&black_box.rearm, __ATOMIC_ACQUIRE) )
+				continue;
+			//nothing from before the freeze
+			black_box.next_event = EventLogNext();
+			black_box.queue_tail = black_box.queue_head;
+			OpenSector((black_box.sector + 1) % BLACK_BOX_SECTORS);
+			__atomic_store_n(&black_box.state, BLACK_BOX_RECORDING, __ATOMIC_RELEASE);
+			__atomic_store_n(&black_box.rearm, 0, __ATOMIC_RELEASE);
+			LOG("Black box rearmed");
+			continue;
+		}
+
+		TakeEvents();
+		TakeQueue();
+		if( black_box.state == BLACK_BOX_TRIGGERED
+			&& xTaskGetTickCount() - black_box.trigger_tick >= pdMS_TO_TICKS(BLACK_BOX_POST_TRIGGER) )
+			Freeze();
+	}
+	SERVICE_END(service);
+}
+
+//Events from this boot on, the log has those from before the reset too
+static uint32_t BootEvent()
+{
+	uint32_t next = EventLogNext();
+	event_log_entry_t event;
+	for(uint32_t back = 1; back <= EVENT_LOG_DEPTH && back <= next; ++back)
+	{
+		if( EventLogRead(next - back, &event) && event.id == EVENT_LOG_BOOT )
+			return next - back;
+	}
+	return next;
+}
+
+//The newest sector of the ring, and whether its last entry froze it
+static void FindNewest()
+{
+	uint8_t found = 0;
+	for(uint32_t sector = 0; sector < BLACK_BOX_SECTORS; ++sector)
+	{
+		const black_box_entry_t* header = SectorHeader(sector);
+		if( header != NULL && (!found || (int32_t)(header->sector.sequence - black_box.sequence) > 0) )
+		{
+			black_box.sector = sector;
+			black_box.sequence = header->sector.sequence;
+			found = 1;
+		}
+	}
+	if( !found )
+	{
+		//the service opens sector 0 first
+		black_box.sector = BLACK_BOX_SECTORS - 1;
+		return;
+	}
+
+	const black_box_entry_t* last = NULL;
+	for(uint32_t entry = 1; entry < BLACK_BOX_SECTOR_ENTRIES; ++entry)
+	{
+		const black_box_entry_t* candidate = MappedEntry(black_box.sector, entry);
+		if( candidate->type != BLACK_BOX_ERASED )
+			last = candidate;
+	}
+	if( last != NULL && last->type == BLACK_BOX_FREEZE )
+	{
+		black_box.cause = last->event;
+		FindOldest();
+		black_box.state = BLACK_BOX_FROZEN;
+	}
+}
+
+void BlackBoxStart()
+{
+	memset(&black_box, 0, sizeof(black_box));
+	if( !QspiFlashInit() )
+		return;
+
+	black_box.session = EventLogBootCount();
+	black_box.next_event = BootEvent();
+	black_box.state = BLACK_BOX_RECORDING;
+	FindNewest();
+	ServiceAdd(&black_box_service, "BlackBox", BlackBoxService);
+}
+
+FAST_CODE void BlackBoxRecord(const main_context_t* ctx)
+{
+	uint8_t state = __atomic_load_n(&black_box.state, __ATOMIC_ACQUIRE);
+	if( state != BLACK_BOX_RECORDING && state != BLACK_BOX_TRIGGERED )
+		return;
+	if( ++black_box.decimation < BLACK_BOX_DECIMATION )
+		return;
+	black_box.decimation = 0;
+
+	uint32_t head = black_box.queue_head;
+	if( head - __atomic_load_n(&black_box.queue_tail, __ATOMIC_ACQUIRE) >= BLACK_BOX_QUEUE )
+	{
+		black_box.queue_dropped++;
+		return;
+	}
+
+	black_box_entry_t* entry = &black_box.queue[head & BLACK_BOX_QUEUE_MASK];
+	entry->type = BLACK_BOX_CONTROL;
+	entry->flags = (ctx->estop_in ? 0x01 : 0) | (ctx->autonomous_mode ? 0x02 : 0) | (ctx->tele_operation_enabled ? 0x04 : 0)
+		| (ctx->actuators.reverse ? 0x08 : 0) | (ctx->actuators.steer_right ? 0x10 : 0);
+	float brake = ctx->actuators.front_brake;
+	entry->arg = brake <= 0.0f ? 0 : brake >= 1.0f ? 0xFFFF : (uint16_t)(brake * 65535.0f);
+	entry->tick = xTaskGetTickCount();
+	entry->control.vehicle_speed = ctx->vehicle_speed;
+	entry->control.steering_angle = ctx->steering_angle;
+	entry->control.vehicle_speed_commanded = ctx->vehicle_speed_commanded;
+	entry->control.steering_angle_commanded = ctx->steering_angle_commanded;
+	entry->control.acceleration = ctx->actuators.acceleration;
+	entry->control.steering_torque = ctx->actuators.steering_torque;
+	__atomic_store_n(&black_box.queue_head, head + 1, __ATOMIC_RELEASE);
+}
+
+black_box_state_t BlackBoxState()
+{
+	return (black_box_state_t)__atomic_load_n(&black_box.state, __ATOMIC_ACQUIRE);
+}
+
+const event_log_entry_t* BlackBoxCause()
+{
+	return &black_box.cause;
+}
+
+uint8_t BlackBoxHold()
+{
+	if( BlackBoxState() != BLACK_BOX_FROZEN || black_box.rearm || black_box.holders == UINT8_MAX )
+		return 0;
+	black_box.holders++;
+	return 1;
+}
+
+void BlackBoxRelease()
+{
+	if( black_box.holders > 0 )
+		black_box.holders--;
+}
+
+uint32_t BlackBoxEntries()
+{
+	return black_box.sectors * BLACK_BOX_SECTOR_ENTRIES;
+}
+
+uint32_t BlackBoxSpan(uint32_t index, const black_box_entry_t** first)
+{
+	uint32_t sector = (black_box.oldest + index / BLACK_BOX_SECTOR_ENTRIES) % BLACK_BOX_SECTORS;
+	uint32_t entry = index % BLACK_BOX_SECTOR_ENTRIES;
+	*first = MappedEntry(sector, entry);
+	//to the end of the download or of the ring, whichever is first
+	uint32_t to_end = BlackBoxEntries() - index;
+	uint32_t to_wrap = (BLACK_BOX_SECTORS - sector) * BLACK_BOX_SECTOR_ENTRIES - entry;
+	return to_end < to_wrap ? to_end : to_wrap;
+}
+
+uint8_t BlackBoxRearm()
+{
+	if( BlackBoxState() != BLACK_BOX_FROZEN || black_box.holders > 0 )
+		return 0;
+	__atomic_store_n(&black_box.rearm, 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+#else
+
+void BlackBoxStart()
+{
+}
+
+void BlackBoxRecord(const main_context_t* ctx)
+{
+}
+
+black_box_state_t BlackBoxState()
+{
+	return BLACK_BOX_OFF;
+}
+
+const event_log_entry_t* BlackBoxCause()
+{
+	static const event_log_entry_t none;
+	return &none;
+}
+
+uint8_t BlackBoxHold()
+{
+	return 0;
+}
+
+void BlackBoxRelease()
+{
+}
+
+uint32_t BlackBoxEntries()
+{
+	return 0;
+}
+
+uint32_t BlackBoxSpan(uint32_t index, const black_box_entry_t** first)
+{
+	*first = NULL;
+	return 0;
+}
+
+uint8_t BlackBoxRearm()
+{
+	return 0;
+}
+
+#endif
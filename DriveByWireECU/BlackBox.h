@@ -0,0 +1,164 @@
+/*
+ * BlackBox.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef BLACKBOX_H_
+#define BLACKBOX_H_
+
+#include <stdint.h>
+#include "main_context.h"
+#include "EventLog.h"
+#include "QspiFlash.h"
+
+//Crash recorder on the QSPI flash (QspiFlash.h): the last few minutes of
+//control state and every event, kept through resets and power cycles, and
+//frozen when the estop is pressed or something fails.
+//
+//main_task queues every BLACK_BOX_DECIMATION-th cycle as an entry, a copy
+//of 32 bytes. The black box service (Service.h) takes those and the new
+//events of the EventLog and programs them a page at a time. The flash is
+//a ring of BLACK_BOX_SECTORS sectors, each with a header entry first: the
+//sector after the newest is erased when the newest is full, so the oldest
+//sector's worth of history goes at once. At the defaults that is about
+//5 minutes of history, and with 100k erases a sector about 9000 hours of
+//recording before the flash wears out.
+//
+//An event in BLACK_BOX_FREEZE_EVENTS, an estop press, an expired deadline
+//or an actuator fault, triggers the recorder. It goes on for BLACK_BOX_POST_TRIGGER ms
+//so the reaction to it is in there as well, then writes a freeze entry and
+//stops. A black box that was frozen stays frozen across resets until it
+//is rearmed. Through the bulk channel (BulkChannel.h) the PC downloads it
+//straight out of the memory mapped flash, oldest sector first, and rearms
+//it.
+//
+//Needs BLACK_BOX_ENABLE and a flash wired to the QSPI. Its pins are those
+//of TCC_PWM_ENABLE's steering output, the two do not go together.
+
+#ifndef BLACK_BOX_ENABLE
+#define BLACK_BOX_ENABLE 0
+#endif
+
+//Where in the flash, in sectors
+#ifndef BLACK_BOX_FIRST_SECTOR
+#define BLACK_BOX_FIRST_SECTOR 0
+#endif
+#ifndef BLACK_BOX_SECTORS
+#define BLACK_BOX_SECTORS 256
+#endif
+
+//Control cycles per entry, 100 Hz at the default
+#ifndef BLACK_BOX_DECIMATION
+#define BLACK_BOX_DECIMATION (10 * CONTROL_CYCLES_PER_MS)
+#endif
+
+//ms recorded after the trigger
+#ifndef BLACK_BOX_POST_TRIGGER
+#define BLACK_BOX_POST_TRIGGER 1000
+#endif
+
+//event_log_id_t bits that freeze the black box. Estops only on the press.
+#ifndef BLACK_BOX_FREEZE_EVENTS
+#define BLACK_BOX_FREEZE_EVENTS ((1UL << EVENT_LOG_ESTOP) | (1UL << EVENT_LOG_DEADLINE) | (1UL << EVENT_LOG_RAM_ECC) \
+	| (1UL << EVENT_LOG_ACTUATOR_FAULT))
+#endif
+
+//Entries between main_task and the black box service, a power of two
+#ifndef BLACK_BOX_QUEUE
+#define BLACK_BOX_QUEUE 64
+#endif
+
+//ms between the black box service's looks at the queue and the event log
+#define BLACK_BOX_POLL_PERIOD 10
+
+#define BLACK_BOX_MAGIC 0x58424244	//"DBBX"
+
+typedef enum black_box_entry_type_t
+{
+	//first of every sector
+	BLACK_BOX_SECTOR = 1,
+	BLACK_BOX_CONTROL,
+	BLACK_BOX_EVENT,
+	//last before the black box froze
+	BLACK_BOX_FREEZE,
+	//not programmed. Whatever is left of a page when the black box freezes.
+	BLACK_BOX_ERASED = 0xFF,
+} black_box_entry_type_t;
+
+typedef enum black_box_state_t
+{
+	//no flash, or BLACK_BOX_ENABLE is off
+	BLACK_BOX_OFF = 0,
+	BLACK_BOX_RECORDING,
+	//recording what follows the trigger
+	BLACK_BOX_TRIGGERED,
+	BLACK_BOX_FROZEN,
+} black_box_state_t;
+
+//Entries are little endian as in RAM, 8 to a page
+typedef struct black_box_entry_t
+{
+	uint8_t type;
+	//control: bit 0 estop, 1 autonomous, 2 tele operation, 3 reverse, 4 steer
+	//right, as sd_log_record_t
+	uint8_t flags;
+	//control: front brake duty in 1/65535
+	uint16_t arg;
+	//RTOS tick it was recorded at
+	uint32_t tick;
+	union
+	{
+		struct
+		{
+			float vehicle_speed;
+			float steering_angle;
+			float vehicle_speed_commanded;
+			float steering_angle_commanded;
+			float acceleration;
+			float steering_torque;
+		} control;
+		//the event, or for a freeze the event that triggered it
+		event_log_entry_t event;
+		struct
+		{
+			uint32_t magic;
+			//counts up through the ring, the download goes by it
+			uint32_t sequence;
+			//EventLogBootCount of the boot that opened the sector
+			uint32_t session;
+		} sector;
+	};
+} black_box_entry_t;
+
+#define BLACK_BOX_SECTOR_ENTRIES (QSPI_FLASH_SECTOR_SIZE / sizeof(black_box_entry_t))
+
+//Brings up the flash and finds where the ring left off, then adds the
+//black box service. Before the scheduler starts.
+void BlackBoxStart();
+
+//From main_task, once per cycle after ControlCoreStep
+void BlackBoxRecord(const main_context_t* ctx);
+
+black_box_state_t BlackBoxState();
+
+//What froze the black box, while it is frozen
+const event_log_entry_t* BlackBoxCause();
+
+//The frozen black box stays frozen and in the window until BlackBoxRelease,
+//at most 255 holds. 0 if it is not frozen. From the tcpip thread.
+uint8_t BlackBoxHold();
+void BlackBoxRelease();
+
+//Entries in the frozen black box, whole sectors
+uint32_t BlackBoxEntries();
+
+//Entries stored contiguously from entry index, oldest first, and the first
+//of them in *first. While held.
+uint32_t BlackBoxSpan(uint32_t index, const black_box_entry_t** first);
+
+//Starts recording again, unless it is held or not frozen. Non-zero if it
+//will. From the tcpip thread.
+uint8_t BlackBoxRearm();
+
+#endif /* BLACKBOX_H_ */
@@ -0,0 +1,98 @@
+/*
+ * BootProfile.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <compiler.h>
+#include <hri_rstc_e54.h>
+#include "BootProfile.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Log.h"
+
+//In boot_stage_t order, for the log
+static const char* const stage_names[BOOT_STAGE_COUNT] =
+{
+	"main",
+	"mcu",
+	"pins",
+	"adc",
+	"target io",
+	"pwm",
+	"can",
+	"mac",
+	"phy",
+	"stdio",
+	"io",
+	"control",
+	"scheduler",
+	"first cycle",
+	"network",
+	"link up",
+	"first command",
+};
+
+typedef struct boot_profile_state_t
+{
+	//Each stage is written once by one task with a single store, readers
+	//see either the time or BOOT_PROFILE_NOT_REACHED
+	boot_profile_t profile;
+
+	//Times count from the last clock switch or the scheduler start. Only
+	//written before the scheduler runs.
+	uint32_t anchor_cycles;
+	uint32_t anchor_us;
+	uint32_t cycles_per_us;
+	uint8_t scheduler_started;
+} boot_profile_state_t;
+
+static boot_profile_state_t boot_profile;
+
+void BootProfileInit()
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	boot_profile.profile.reset_cause = hri_rstc_read_RCAUSE_reg(RSTC);
+	for(int i = 0; i < BOOT_STAGE_COUNT; ++i)
+		boot_profile.profile.stage_us[i] = BOOT_PROFILE_NOT_REACHED;
+
+	boot_profile.anchor_cycles = 0;
+	boot_profile.anchor_us = 0;
+	boot_profile.cycles_per_us = BOOT_PROFILE_RESET_CLOCK_HZ / 1000000;
+	boot_profile.scheduler_started = 0;
+
+	BootProfileMark(BOOT_STAGE_MAIN);
+}
+
+void BootProfileMark(boot_stage_t stage)
+{
+	if( stage >= BOOT_STAGE_COUNT || boot_profile.profile.stage_us[stage] != BOOT_PROFILE_NOT_REACHED )
+		return;
+
+	uint32_t now = DWT->CYCCNT;
+	uint32_t us;
+	//the tick starts at 0 with the scheduler, at the last anchor
+	if( boot_profile.scheduler_started && xTaskGetTickCount() >= pdMS_TO_TICKS(BOOT_PROFILE_TICK_FALLBACK) )
+		us = boot_profile.anchor_us + xTaskGetTickCount() * portTICK_PERIOD_MS * 1000;
+	else
+		us = boot_profile.anchor_us + (now - boot_profile.anchor_cycles) / boot_profile.cycles_per_us;
+	boot_profile.profile.stage_us[stage] = us;
+
+	if( stage == BOOT_STAGE_MCU || stage == BOOT_STAGE_SCHEDULER )
+	{
+		boot_profile.anchor_cycles = now;
+		boot_profile.anchor_us = us;
+		boot_profile.cycles_per_us = configCPU_CLOCK_HZ / 1000000;
+		boot_profile.scheduler_started = stage == BOOT_STAGE_SCHEDULER;
+	}
+
+	LOG("boot %s at %lu us", stage_names[stage], us);
+}
+
+void BootProfileRead(boot_profile_t* profile)
+{
+	*profile = boot_profile.profile;
+}
@@ -0,0 +1,97 @@
+/*
+ * BootProfile.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef BOOTPROFILE_H_
+#define BOOTPROFILE_H_
+
+#include <stdint.h>
+
+//Time from reset to a running control loop and network, stage by stage.
+//
+//Every stage records the time it finished, in us since main was entered,
+//from the DWT cycle counter. The startup code before main (copying .data,
+//zeroing .bss) is not counted. Stages are logged as they are reached and
+//the control channel sends them all with the boot request
+//(ControlProtocol.h).
+//
+//The core runs from the 48 MHz DFLL out of reset until init_mcu switches it
+//to configCPU_CLOCK_HZ, cycles up to BOOT_STAGE_MCU are counted at the
+//reset clock. The counter wraps after 35 s at 120 MHz, stages later than
+//BOOT_PROFILE_TICK_FALLBACK ms into the scheduler are timed by the RTOS
+//tick instead.
+
+//Core clock out of reset
+#define BOOT_PROFILE_RESET_CLOCK_HZ 48000000
+
+#ifndef BOOT_PROFILE_TICK_FALLBACK
+#define BOOT_PROFILE_TICK_FALLBACK 30000
+#endif
+
+//In boot order, except that the network stages can finish before or after
+//the first control cycle, and that the peripherals' stages are marked as
+//their owners first use them (Peripherals.h): the PWMs with the IO, the
+//MAC and PHY after it, one never used is never reached. Append new stages
+//where they run in boot and keep BOOT_STAGE_COUNT last.
+typedef enum boot_stage_t
+{
+	//main entered, always 0
+	BOOT_STAGE_MAIN = 0,
+	//init_mcu: clocks, flash wait states
+	BOOT_STAGE_MCU,
+	//the GPIO setup of system_init
+	BOOT_STAGE_PINS,
+	BOOT_STAGE_ADC,
+	BOOT_STAGE_TARGET_IO,
+	//the first PWM timer
+	BOOT_STAGE_PWM,
+	BOOT_STAGE_CAN,
+	//the GMAC
+	BOOT_STAGE_MAC,
+	//ethernet_phys_init, the PHY reset and registers, not the link
+	BOOT_STAGE_PHY,
+	//end of atmel_start_init
+	BOOT_STAGE_STDIO,
+	//InitializeDriveByWireIO, the actuators are safe from here on
+	BOOT_STAGE_IO,
+	//ControlCoreInit and the parameters loaded from NVM
+	BOOT_STAGE_CONTROL,
+	//tasks created, right before vTaskStartScheduler
+	BOOT_STAGE_SCHEDULER,
+	//the first main_task cycle finished
+	BOOT_STAGE_FIRST_CYCLE,
+	//lwIP and the interface are up, sockets can be bound
+	BOOT_STAGE_NETWORK,
+	//the PHY reported the first link
+	BOOT_STAGE_LINK_UP,
+	//the first valid command frame was accepted
+	BOOT_STAGE_FIRST_COMMAND,
+	BOOT_STAGE_COUNT
+} boot_stage_t;
+
+//Time of a stage that has not been reached
+#define BOOT_PROFILE_NOT_REACHED UINT32_MAX
+
+typedef struct boot_profile_t
+{
+	//RSTC RCAUSE of this boot
+	uint8_t reset_cause;
+	//us since main, BOOT_PROFILE_NOT_REACHED for stages still to come
+	uint32_t stage_us[BOOT_STAGE_COUNT];
+} boot_profile_t;
+
+//Starts the cycle counter and records BOOT_STAGE_MAIN. First thing in main.
+void BootProfileInit();
+
+//Records that stage just finished. Only the first time counts, so a link
+//that comes back later keeps the time of the first. BOOT_STAGE_MCU also
+//switches the count to configCPU_CLOCK_HZ. From any task at or after the
+//stage it marks, never from an interrupt.
+void BootProfileMark(boot_stage_t stage);
+
+//Copies the stages recorded so far, safe from any task
+void BootProfileRead(boot_profile_t* profile);
+
+#endif /* BOOTPROFILE_H_ */
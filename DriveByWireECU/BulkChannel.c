@@ -0,0 +1,455 @@
+/*
+ * BulkChannel.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <peripheral_clk_config.h>
+#include "lwip/tcp.h"
+#include "FreeRTOS.h"
+#include "BulkChannel.h"
+#include "main_context.h"
+#include "EventLog.h"
+#include "BlackBox.h"
+#include "DeltaCodec.h"
+#include "RtosTrace.h"
+#include "Excitation.h"
+#include "Log.h"
+#include "ByteOrder.h"
+
+#if BULK_CHANNEL_ENABLE && LWIP_TCP
+
+//tcp_poll interval, in units of the 500 ms TCP coarse timer
+#define BULK_POLL_INTERVAL 2
+
+//bytes of a packed trace packed ahead of tcp, per connection
+#define BULK_PACK_SIZE 512
+#define BULK_SAMPLE_WORDS (sizeof(pid_trace_sample_t) / 4)
+
+typedef struct bulk_connection_t
+{
+	struct tcp_pcb* pcb;
+	//BULK_REQUEST_*, 0 until the request byte is in
+	uint8_t request;
+	//the trace or the black box is held by this connection
+	uint8_t holding;
+	uint8_t idle_polls;
+	uint8_t header[BULK_HEADER_SIZE];
+	uint16_t entry_size;
+	//header and entries
+	uint32_t total;
+	uint32_t written;
+	uint32_t acked;
+	//events: sequence of entry 0, and the entry being written
+	uint32_t first_sequence;
+	uint32_t entry_index;
+	event_log_entry_t entry;
+	//packed trace: the next sample to pack, and the offset in the entries
+	//of packed[0]
+	uint16_t pack_next;
+	uint16_t pack_length;
+	uint32_t pack_start;
+	delta_codec_t codec;
+	uint8_t packed[BULK_PACK_SIZE];
+} bulk_connection_t;
+
+typedef struct bulk_channel_t
+{
+	main_context_t* ctx;
+	struct tcp_pcb* listen_pcb;
+	bulk_connection_t connections[BULK_MAX_CONNECTIONS];
+} bulk_channel_t;
+
+static bulk_channel_t bulk_channel;
+
+static void WriteHeader(bulk_connection_t* connection, uint32_t count, uint32_t reference, uint8_t reason, uint8_t state)
+{
+	uint8_t* header = connection->header;
+	memcpy(header, "DBWB", 4);
+	header[4] = BULK_VERSION;
+	header[5] = connection->request;
+	PutLE16(&header[6], connection->entry_size);
+	PutLE32(&header[8], count);
+	PutLE32(&header[12], reference);
+	header[16] = reason;
+	header[17] = state;
+	header[18] = 0;
+	header[19] = 0;
+	connection->total = BULK_HEADER_SIZE + count * connection->entry_size;
+}
+
+static void StartTrace(bulk_connection_t* connection, uint8_t packed)
+{
+	pid_trace_t* trace = &bulk_channel.ctx->trace;
+	connection->entry_size = packed ? 0 : sizeof(pid_trace_sample_t);
+	connection->holding = PIDTraceHold(trace);
+	if( connection->holding )
+		WriteHeader(connection, trace->count, trace->trigger_tick, trace->trigger_reason, PID_TRACE_FROZEN);
+	else
+		WriteHeader(connection, 0, 0, 0, PIDTraceState(trace));
+
+	if( packed && connection->holding )
+	{
+		//the size is known once the last sample is packed
+		connection->total = UINT32_MAX;
+		connection->pack_next = 0;
+		connection->pack_length = 0;
+		connection->pack_start = 0;
+		DeltaCodecReset(&connection->codec, BULK_SAMPLE_WORDS);
+	}
+}
+
+//Packs the samples that follow what packed held, once that was all sent
+static void PackTrace(bulk_connection_t* connection)
+{
+	pid_trace_t* trace = &bulk_channel.ctx->trace;
+	connection->pack_start += connection->pack_length;
+	connection->pack_length = 0;
+	while( connection->pack_next < trace->count &&
+		connection->pack_length + DELTA_CODEC_MAX_BYTES(BULK_SAMPLE_WORDS) <= BULK_PACK_SIZE )
+	{
+		const pid_trace_sample_t* sample;
+		PIDTraceSpan(trace, connection->pack_next++, &sample);
+		connection->pack_length += DeltaCodecEncode(&connection->codec, (const uint32_t*)sample,
+			&connection->packed[connection->pack_length]);
+	}
+	if( connection->pack_next == trace->count )
+		connection->total = BULK_HEADER_SIZE + connection->pack_start + connection->pack_length;
+}
+
+static void StartEvents(bulk_connection_t* connection)
+{
+	uint32_t next = EventLogNext();
+	connection->first_sequence = next > EVENT_LOG_DEPTH ? next - EVENT_LOG_DEPTH : 0;
+	//one past the last, nothing is read yet
+	connection->entry_index = UINT32_MAX;
+	connection->entry_size = sizeof(event_log_entry_t);
+	WriteHeader(connection, next - connection->first_sequence, connection->first_sequence, 0, 0);
+}
+
+static void StartBlackBox(bulk_connection_t* connection)
+{
+	const event_log_entry_t* cause = BlackBoxCause();
+	connection->entry_size = sizeof(black_box_entry_t);
+	connection->holding = BlackBoxHold();
+	if( connection->holding )
+		WriteHeader(connection, BlackBoxEntries(), cause->sequence, cause->id, BLACK_BOX_FROZEN);
+	else
+		WriteHeader(connection, 0, 0, 0, BlackBoxState());
+}
+
+static void StartBlackBoxRearm(bulk_connection_t* connection)
+{
+	connection->entry_size = sizeof(black_box_entry_t);
+	WriteHeader(connection, 0, 0, 0, BlackBoxRearm() ? BLACK_BOX_RECORDING : BlackBoxState());
+}
+
+static void StartRtosTrace(bulk_connection_t* connection)
+{
+	connection->entry_size = sizeof(rtos_trace_event_t);
+	uint32_t count = RtosTraceHold();
+	connection->holding = RTOS_TRACE_ENABLE;
+	uint32_t event_cycles = RtosTraceEventCycles();
+	WriteHeader(connection, count, CONF_CPU_FREQUENCY, event_cycles < 255 ? event_cycles : 255, RTOS_TRACE_ENABLE);
+	PutLE16(&connection->header[18], configTICK_RATE_HZ);
+}
+
+static void StartExcitation(bulk_connection_t* connection)
+{
+	excitation_status_t run;
+	connection->entry_size = sizeof(excitation_sample_t);
+	connection->holding = ExcitationHold(&run);
+	if( connection->holding )
+		WriteHeader(connection, run.samples, (uint32_t)(run.sample_rate * 1000.0f + 0.5f), run.output, run.result);
+	else
+		WriteHeader(connection, 0, 0, 0, EXCITATION_NONE);
+}
+
+static void Release(bulk_connection_t* connection)
+{
+	if( connection->holding )
+	{
+		if( connection->request == BULK_REQUEST_BLACK_BOX )
+			BlackBoxRelease();
+		else if( connection->request == BULK_REQUEST_RTOS_TRACE )
+			RtosTraceRelease();
+		else if( connection->request == BULK_REQUEST_EXCITATION )
+			ExcitationRelease();
+		else
+			PIDTraceRelease(&bulk_channel.ctx->trace);
+		connection->holding = 0;
+	}
+}
+
+//Returns ERR_ABRT if the connection had to be aborted
+static err_t CloseConnection(bulk_connection_t* connection)
+{
+	struct tcp_pcb* pcb = connection->pcb;
+	Release(connection);
+	connection->pcb = NULL;
+	tcp_arg(pcb, NULL);
+	tcp_recv(pcb, NULL);
+	tcp_sent(pcb, NULL);
+	tcp_err(pcb, NULL);
+	tcp_poll(pcb, NULL, 0);
+	if( tcp_close(pcb) == ERR_OK )
+		return ERR_OK;
+	tcp_abort(pcb);
+	return ERR_ABRT;
+}
+
+//Where the next bytes of the entries come from, at most length of them.
+//Trace and RTOS trace bytes are in their rings, black box bytes in the
+//flash and excitation samples in their buffer, all stay there. Packed trace
+//bytes are packed as they are needed. Event bytes are copied out of the log first and have to be copied again
+//by tcp.
+static const uint8_t* EntryBytes(bulk_connection_t* connection, uint32_t offset, uint16_t* length, uint8_t* flags)
+{
+	//packed bytes are copied by tcp, so packed is free again once written
+	if( connection->request == BULK_REQUEST_TRACE_PACKED )
+	{
+		if( offset >= connection->pack_start + connection->pack_length )
+			PackTrace(connection);
+		uint16_t available = connection->pack_start + connection->pack_length - offset;
+		if( *length > available )
+			*length = available;
+		*flags = TCP_WRITE_FLAG_COPY;
+		return &connection->packed[offset - connection->pack_start];
+	}
+
+	uint32_t index = offset / connection->entry_size;
+	uint16_t within = offset % connection->entry_size;
+
+	if( connection->request == BULK_REQUEST_TRACE )
+	{
+		const pid_trace_sample_t* first;
+		uint16_t span = PIDTraceSpan(&bulk_channel.ctx->trace, index, &first);
+		uint32_t available = (uint32_t)span * connection->entry_size - within;
+		if( *length > available )
+			*length = available;
+		*flags = 0;
+		return (const uint8_t*)first + within;
+	}
+
+	if( connection->request == BULK_REQUEST_RTOS_TRACE )
+	{
+		const rtos_trace_event_t* first;
+		uint32_t available = RtosTraceSpan(index, &first) * connection->entry_size - within;
+		if( *length > available )
+			*length = available;
+		*flags = 0;
+		return (const uint8_t*)first + within;
+	}
+
+	if( connection->request == BULK_REQUEST_EXCITATION )
+	{
+		uint32_t available = connection->total - BULK_HEADER_SIZE - offset;
+		if( *length > available )
+			*length = available;
+		*flags = 0;
+		return (const uint8_t*)ExcitationSamples() + offset;
+	}
+
+	if( connection->request == BULK_REQUEST_BLACK_BOX )
+	{
+		const black_box_entry_t* first;
+		uint32_t available = BlackBoxSpan(index, &first) * connection->entry_size - within;
+		if( *length > available )
+			*length = available;
+		*flags = 0;
+		return (const uint8_t*)first + within;
+	}
+
+	if( connection->entry_index != index )
+	{
+		connection->entry_index = index;
+		if( !EventLogRead(connection->first_sequence + index, &connection->entry) )
+			memset(&connection->entry, 0, sizeof(connection->entry));
+	}
+	if( *length > connection->entry_size - within )
+		*length = connection->entry_size - within;
+	*flags = TCP_WRITE_FLAG_COPY;
+	return (const uint8_t*)&connection->entry + within;
+}
+
+//Hands tcp what fits in flight. The rest goes as the PC acknowledges.
+static void Pump(bulk_connection_t* connection)
+{
+	while( connection->written < connection->total )
+	{
+		uint32_t room = BULK_MAX_IN_FLIGHT - (connection->written - connection->acked);
+		if( room > tcp_sndbuf(connection->pcb) )
+			room = tcp_sndbuf(connection->pcb);
+		if( room > connection->total - connection->written )
+			room = connection->total - connection->written;
+		//the queue runs out before the buffer with many short writes
+		if( room == 0 || tcp_sndqueuelen(connection->pcb) >= TCP_SND_QUEUELEN - 2 )
+			break;
+
+		uint16_t length = room;
+		uint8_t flags;
+		const uint8_t* data;
+		if( connection->written < BULK_HEADER_SIZE )
+		{
+			data = &connection->header[connection->written];
+			if( length > BULK_HEADER_SIZE - connection->written )
+				length = BULK_HEADER_SIZE - connection->written;
+			flags = TCP_WRITE_FLAG_COPY;
+		}
+		else
+			data = EntryBytes(connection, connection->written - BULK_HEADER_SIZE, &length, &flags);
+
+		if( tcp_write(connection->pcb, data, length, flags | TCP_WRITE_FLAG_MORE) != ERR_OK )
+			//out of segments or pbufs, tcp_sent comes back for the rest
+			break;
+		connection->written += length;
+	}
+	tcp_output(connection->pcb);
+}
+
+static err_t BulkReceive(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err)
+{
+	bulk_connection_t* connection = (bulk_connection_t*)arg;
+	if( p == NULL )
+	{
+		//a PC that shuts its side down after the request still gets the dump
+		if( connection->request == 0 )
+			return CloseConnection(connection);
+		return ERR_OK;
+	}
+
+	tcp_recved(pcb, p->tot_len);
+	//anything after the request byte is dropped
+	if( connection->request == 0 )
+	{
+		connection->request = *(const uint8_t*)p->payload;
+		connection->idle_polls = 0;
+		if( connection->request == BULK_REQUEST_TRACE || connection->request == BULK_REQUEST_TRACE_PACKED )
+			StartTrace(connection, connection->request == BULK_REQUEST_TRACE_PACKED);
+		else if( connection->request == BULK_REQUEST_EVENTS )
+			StartEvents(connection);
+		else if( connection->request == BULK_REQUEST_BLACK_BOX )
+			StartBlackBox(connection);
+		else if( connection->request == BULK_REQUEST_BLACK_BOX_REARM )
+			StartBlackBoxRearm(connection);
+		else if( connection->request == BULK_REQUEST_RTOS_TRACE )
+			StartRtosTrace(connection);
+		else if( connection->request == BULK_REQUEST_EXCITATION )
+			StartExcitation(connection);
+		else
+		{
+			pbuf_free(p);
+			return CloseConnection(connection);
+		}
+		Pump(connection);
+	}
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+static err_t BulkSent(void* arg, struct tcp_pcb* pcb, u16_t length)
+{
+	bulk_connection_t* connection = (bulk_connection_t*)arg;
+	connection->idle_polls = 0;
+	connection->acked += length;
+	//the traces and the black box stay held until here, lwIP resends out of
+	//them until then
+	if( connection->acked >= connection->total )
+		return CloseConnection(connection);
+	Pump(connection);
+	return ERR_OK;
+}
+
+static err_t BulkPoll(void* arg, struct tcp_pcb* pcb)
+{
+	bulk_connection_t* connection = (bulk_connection_t*)arg;
+	if( ++connection->idle_polls * BULK_POLL_INTERVAL / 2 >= BULK_IDLE_TIMEOUT )
+	{
+		Release(connection);
+		connection->pcb = NULL;
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+	if( connection->request != 0 )
+		Pump(connection);
+	return ERR_OK;
+}
+
+//lwIP has freed the pcb already, and with it every reference to the trace
+//or the black box
+static void BulkError(void* arg, err_t err)
+{
+	bulk_connection_t* connection = (bulk_connection_t*)arg;
+	if( connection != NULL )
+	{
+		Release(connection);
+		connection->pcb = NULL;
+	}
+}
+
+static err_t BulkAccept(void* arg, struct tcp_pcb* pcb, err_t err)
+{
+	tcp_accepted(bulk_channel.listen_pcb);
+
+	bulk_connection_t* connection = NULL;
+	for(int i = 0; i < BULK_MAX_CONNECTIONS; ++i)
+	{
+		if( bulk_channel.connections[i].pcb == NULL )
+		{
+			connection = &bulk_channel.connections[i];
+			break;
+		}
+	}
+	if( err != ERR_OK || connection == NULL )
+	{
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	connection->pcb = pcb;
+	connection->request = 0;
+	connection->holding = 0;
+	connection->idle_polls = 0;
+	connection->total = 0;
+	connection->written = 0;
+	connection->acked = 0;
+	//dumps never get ahead of the control channel
+	tcp_setprio(pcb, TCP_PRIO_MIN);
+	tcp_arg(pcb, connection);
+	tcp_recv(pcb, BulkReceive);
+	tcp_sent(pcb, BulkSent);
+	tcp_err(pcb, BulkError);
+	tcp_poll(pcb, BulkPoll, BULK_POLL_INTERVAL);
+	return ERR_OK;
+}
+
+void BulkChannelStart(void* ctx)
+{
+	bulk_channel.ctx = (main_context_t*)ctx;
+
+	struct tcp_pcb* pcb = tcp_new();
+	if( pcb == NULL || tcp_bind(pcb, IP_ADDR_ANY, BULK_PORT) != ERR_OK )
+	{
+		LOG("Bulk channel bind error");
+		if( pcb != NULL )
+			tcp_close(pcb);
+		return;
+	}
+	bulk_channel.listen_pcb = tcp_listen(pcb);
+	if( bulk_channel.listen_pcb == NULL )
+	{
+		LOG("Bulk channel listen error");
+		tcp_close(pcb);
+		return;
+	}
+	tcp_accept(bulk_channel.listen_pcb, BulkAccept);
+}
+
+#else
+
+void BulkChannelStart(void* ctx)
+{
+}
+
+#endif
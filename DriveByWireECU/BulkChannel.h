@@ -0,0 +1,110 @@
+/*
+ * BulkChannel.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef BULKCHANNEL_H_
+#define BULKCHANNEL_H_
+
+#include <stdint.h>
+#include "lwip/opt.h"
+
+//Dumps of the frozen PID trace, the event log, the frozen black box
+//(BlackBox.h), the RTOS trace (RtosTrace.h) and the excitation samples
+//(Excitation.h) over TCP, for captures too long to pull a frame at a time
+//over the control channel.
+//
+//The PC connects, sends one request byte and reads until the ECU closes:
+//a BULK_HEADER_SIZE header, then count entries of entry_size bytes each.
+//
+//	0	"DBWB"
+//	4	BULK_VERSION
+//	5	BULK_REQUEST_*
+//	6	entry_size, LE16
+//	8	count, LE32
+//	12	trace: trigger tick, events: sequence of the first entry, black
+//		box: sequence of the event that froze it, RTOS trace: core
+//		clock Hz, excitation: sample rate mHz. LE32
+//	16	trace: trigger reason, black box: event_log_id_t that froze it,
+//		RTOS trace: core cycles an event costs, excitation:
+//		excitation_output_t
+//	17	trace: pid_trace_state_t, black box: black_box_state_t, RTOS
+//		trace: 1 if RTOS_TRACE_ENABLE is built in, excitation:
+//		excitation_result_t
+//	18	RTOS trace: tick rate Hz, LE16, otherwise 0, 0
+//
+//Trace entries are pid_trace_sample_t as they are in RAM, little endian,
+//in the order of the control channel's trace data frames. They are sent
+//straight out of the ring, nothing is copied on the way: the trace is held
+//(PIDTrace.h) until the PC has acknowledged the last byte, a rearm request
+//waits until then. A trace that is not frozen is sent as its header with
+//count 0. The packed trace request sends the same samples packed by
+//DeltaCodec.h, each as its 17 words, in a quarter of the bytes or less for
+//a trace that settles: the header has entry_size 0 and count samples, and
+//the packed bytes run to the end of the dump. Event entries are
+//event_log_entry_t, those that were overwritten
+//before they were sent are all zero.
+//
+//Black box entries are black_box_entry_t, whole sectors oldest first, sent
+//straight out of the memory mapped flash the same way: the black box is
+//held frozen until the last byte is acknowledged. One that is not frozen
+//is sent as its header with count 0. The rearm request is answered with
+//just the header, count 0 and the state after it: recording if the black
+//box was rearmed, frozen if a dump still holds it.
+//
+//RTOS trace entries are rtos_trace_event_t, oldest first, also sent
+//straight out of the ring. Recording stops for the dump and starts over
+//once the last byte is acknowledged, so two dumps in a row hold what
+//happened in between.
+//
+//Excitation entries are excitation_sample_t, those of the last run that was
+//done (Excitation.h), held until the last byte is acknowledged so no run
+//overwrites them. Without such a run the header goes out with count 0.
+//
+//Runs on the raw TCP API in the tcpip thread and never waits on anyone,
+//main_task included. At most BULK_MAX_IN_FLIGHT bytes are unacknowledged,
+//which keeps the dump to about half of the GMAC transmit descriptors and
+//leaves the rest to the control channel.
+//
+//Needs LWIP_TCP, the production profile leaves it out (feature_config.h).
+
+#ifndef BULK_CHANNEL_ENABLE
+#define BULK_CHANNEL_ENABLE 1
+#endif
+
+#ifndef BULK_PORT
+#define BULK_PORT 12092
+#endif
+
+#define BULK_VERSION 1
+#define BULK_HEADER_SIZE 20
+
+#define BULK_REQUEST_TRACE 1
+#define BULK_REQUEST_EVENTS 2
+#define BULK_REQUEST_BLACK_BOX 3
+#define BULK_REQUEST_BLACK_BOX_REARM 4
+#define BULK_REQUEST_TRACE_PACKED 5
+#define BULK_REQUEST_RTOS_TRACE 6
+#define BULK_REQUEST_EXCITATION 7
+
+#ifndef BULK_MAX_CONNECTIONS
+#define BULK_MAX_CONNECTIONS 2
+#endif
+
+//bytes sent but not yet acknowledged, per connection
+#ifndef BULK_MAX_IN_FLIGHT
+#define BULK_MAX_IN_FLIGHT (4 * TCP_MSS)
+#endif
+
+//s without an acknowledgment after which a dump is dropped
+#ifndef BULK_IDLE_TIMEOUT
+#define BULK_IDLE_TIMEOUT 5
+#endif
+
+//Accepts dump requests on BULK_PORT. Trace dumps are sent from, and hold,
+//the trace in ctx, the main_context_t. Runs in the tcpip thread, queued
+//with tcpip_callback.
+void BulkChannelStart(void* ctx);
+
+#endif /* BULKCHANNEL_H_ */
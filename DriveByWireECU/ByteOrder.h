@@ -0,0 +1,40 @@
+/*
+ * ByteOrder.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef BYTEORDER_H_
+#define BYTEORDER_H_
+
+#include <stdint.h>
+
+//Little endian fields of the frames, records and datagrams the ECU sends
+//and receives. Read and written a byte at a time, so buffers need no
+//alignment and never go through a struct copy.
+
+static inline uint16_t GetLE16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t GetLE32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void PutLE16(uint8_t* p, uint16_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+}
+
+static inline void PutLE32(uint8_t* p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+#endif /* BYTEORDER_H_ */
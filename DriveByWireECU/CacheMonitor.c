@@ -0,0 +1,121 @@
+/*
+ * CacheMonitor.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hpl_cmcc.h>
+#include "CacheMonitor.h"
+#include "Profiler.h"
+#include "FastCode.h"
+#include "Seqlock.h"
+
+#define NO_OWNER 0xFF
+
+//Written only by the task that runs the section, stats are read under
+//sequence (Seqlock.h).
+typedef struct cache_monitor_slot_t
+{
+	uint32_t sequence;
+	cache_monitor_stats_t stats;
+	//section state while a sample is running
+	uint8_t event;
+	uint8_t spoiled;
+	uint32_t start;
+	//set by CacheMonitorRequestReset, taken by the section's task
+	uint8_t reset_request;
+} cache_monitor_slot_t;
+
+static cache_monitor_slot_t cache_slots[CACHE_MONITOR_SECTION_COUNT];
+//section that has the counter, NO_OWNER if none
+static uint8_t counter_owner = NO_OWNER;
+
+static const enum conf_cache_monitor monitor_modes[CACHE_MONITOR_EVENT_COUNT] =
+{
+	IHIT_COUNT,
+	DHIT_COUNT,
+};
+
+#if CACHE_MONITOR_ENABLE
+FAST_CODE void CacheMonitorBegin(cache_monitor_section_t section)
+{
+	cache_monitor_slot_t* slot = &cache_slots[section];
+	uint8_t expected = NO_OWNER;
+
+	//cleared first, a section preempting us right after the exchange spoils it
+	slot->spoiled = 0;
+	if( !__atomic_compare_exchange_n(&counter_owner, &expected, (uint8_t)section, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) )
+	{
+		//the section counting now was preempted, its count includes ours
+		cache_slots[expected].spoiled = 1;
+		slot->spoiled = 1;
+		return;
+	}
+
+	slot->event = (slot->event + 1) % CACHE_MONITOR_EVENT_COUNT;
+	_cmcc_disable_monitor(CMCC);
+	_cmcc_configure_monitor(CMCC, monitor_modes[slot->event]);
+	_cmcc_reset_monitor(CMCC);
+	_cmcc_enable_monitor(CMCC);
+	slot->start = ProfilerStart();
+}
+
+FAST_CODE void CacheMonitorEnd(cache_monitor_section_t section)
+{
+	cache_monitor_slot_t* slot = &cache_slots[section];
+	uint32_t hits = 0;
+	uint32_t cycles = 0;
+
+	if( __atomic_load_n(&counter_owner, __ATOMIC_RELAXED) == section )
+	{
+		hits = _cmcc_get_monitor_event_count(CMCC);
+		cycles = ProfilerStart() - slot->start;
+		_cmcc_disable_monitor(CMCC);
+		__atomic_store_n(&counter_owner, NO_OWNER, __ATOMIC_RELEASE);
+	}
+	else
+	{
+		slot->spoiled = 1;
+	}
+
+	SeqlockWriteBegin(&slot->sequence);
+	if( __atomic_exchange_n(&slot->reset_request, 0, __ATOMIC_ACQUIRE) )
+		memset(&slot->stats, 0, sizeof(slot->stats));
+	if( slot->spoiled )
+	{
+		slot->stats.skipped++;
+	}
+	else
+	{
+		slot->stats.samples[slot->event]++;
+		slot->stats.hits[slot->event] += hits;
+		slot->stats.cycles[slot->event] += cycles;
+	}
+	SeqlockWriteEnd(&slot->sequence);
+}
+#endif
+
+void CacheMonitorRead(cache_monitor_section_t section, cache_monitor_stats_t* stats)
+{
+	if( section >= CACHE_MONITOR_SECTION_COUNT )
+	{
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	cache_monitor_slot_t* slot = &cache_slots[section];
+	uint32_t sequence;
+
+	do
+	{
+		sequence = SeqlockReadBegin(&slot->sequence);
+		*stats = slot->stats;
+	} while( SeqlockReadRetry(&slot->sequence, sequence) );
+}
+
+void CacheMonitorRequestReset()
+{
+	for(int i = 0; i < CACHE_MONITOR_SECTION_COUNT; ++i)
+		__atomic_store_n(&cache_slots[i].reset_request, 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,75 @@
+/*
+ * CacheMonitor.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CACHEMONITOR_H_
+#define CACHEMONITOR_H_
+
+#include <stdint.h>
+
+//CMCC cache hits per control cycle and per network burst.
+//The CMCC has a single event counter that counts either instruction or data
+//hits, never misses. Each sample of a section resets it, counts one event
+//kind over the section and adds the hits together with the core cycles the
+//section took. Sections alternate between instruction and data hits, so
+//both fill up over time. Hits per core cycle is the figure to compare
+//between layouts and clock settings, a miss shows up as a stall that adds
+//cycles without a hit.
+//
+//There is only one counter, so a section that starts while another one is
+//being counted spoils both samples, they are dropped and counted as skipped.
+//The stats are read out with the profile data frame (ControlProtocol.h).
+
+//Set to 1 to count cache hits, 0 compiles the probes out
+#ifndef CACHE_MONITOR_ENABLE
+#define CACHE_MONITOR_ENABLE 0
+#endif
+
+typedef enum cache_monitor_section_t
+{
+	//main_task, one control cycle
+	CACHE_MONITOR_CONTROL = 0,
+	//control channel, one received frame or one telemetry send pass
+	CACHE_MONITOR_NETWORK,
+	CACHE_MONITOR_SECTION_COUNT
+} cache_monitor_section_t;
+
+typedef enum cache_monitor_event_t
+{
+	CACHE_MONITOR_INSTRUCTION_HITS = 0,
+	CACHE_MONITOR_DATA_HITS,
+	CACHE_MONITOR_EVENT_COUNT
+} cache_monitor_event_t;
+
+typedef struct cache_monitor_stats_t
+{
+	//per event kind, samples taken and their summed hits and core cycles
+	uint32_t samples[CACHE_MONITOR_EVENT_COUNT];
+	uint64_t hits[CACHE_MONITOR_EVENT_COUNT];
+	uint64_t cycles[CACHE_MONITOR_EVENT_COUNT];
+	//samples dropped because another section had the counter
+	uint32_t skipped;
+} cache_monitor_stats_t;
+
+#if CACHE_MONITOR_ENABLE
+//Call around each section, from the one task that runs it
+void CacheMonitorBegin(cache_monitor_section_t section);
+void CacheMonitorEnd(cache_monitor_section_t section);
+#else
+static inline void CacheMonitorBegin(cache_monitor_section_t section)
+{
+}
+static inline void CacheMonitorEnd(cache_monitor_section_t section)
+{
+}
+#endif
+
+//Clears the stats, taken at the next end of each section
+void CacheMonitorRequestReset();
+
+//Consistent copy of a section's stats, safe from any task
+void CacheMonitorRead(cache_monitor_section_t section, cache_monitor_stats_t* stats);
+
+#endif /* CACHEMONITOR_H_ */
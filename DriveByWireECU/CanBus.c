@@ -0,0 +1,507 @@
+/*
+ * CanBus.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hal_atomic.h>
+#include <hpl_can_config.h>
+#include <peripheral_clk_config.h>
+#include "CanBus.h"
+#include "driver_init.h"
+#include "Peripherals.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Profiler.h"
+#include "Ptp.h"
+#include "TimeBase.h"
+#include "Seqlock.h"
+
+//Nominal bit rate, the unit of the timestamp counter with a prescaler of 1
+#define CAN_BUS_BIT_RATE (CONF_GCLK_CAN1_FREQUENCY / (CONF_CAN1_BTP_BRP * (1 + CONF_CAN1_BTP_TSEG1 + CONF_CAN1_BTP_TSEG2)))
+#define CAN_BUS_DATA_BIT_RATE (CONF_GCLK_CAN1_FREQUENCY / (CONF_CAN1_DBTP_DBRP * (1 + CONF_CAN1_DBTP_DTSEG1 + CONF_CAN1_DBTP_DTSEG2)))
+//ns per timestamp counter increment. Frames are dated at most half the
+//counter's range back, which 32 bits hold times this down to 33 kbit/s.
+#define CAN_BUS_TIMESTAMP_NS ((uint32_t)(1000000000ULL * CONF_CAN1_TSCC_TCP / CAN_BUS_BIT_RATE))
+#define CAN_BUS_BIT_NS (1000000000UL / CAN_BUS_BIT_RATE)
+#define CAN_BUS_DATA_BIT_NS (CONF_CAN1_CCCR_BRSE ? 1000000000UL / CAN_BUS_DATA_BIT_RATE : CAN_BUS_BIT_NS)
+
+typedef struct can_bus_mailbox_config_t
+{
+	uint32_t id;
+	enum can_format fmt;
+	uint8_t fifo;
+} can_bus_mailbox_config_t;
+
+//ID and RX FIFO of each mailbox, in can_bus_mailbox_t order
+static const can_bus_mailbox_config_t can_bus_mailboxes[CAN_BUS_MAILBOX_COUNT] =
+{
+	{ CAN_BUS_EPS_STATUS_ID, CAN_FMT_STDID, 0 },	//EPS motor controller status
+	{ CAN_BUS_WHEEL_SPEED_ID, CAN_FMT_STDID, 1 },	//wheel speed sensors
+	{ CAN_BUS_REDUNDANCY_ID, CAN_FMT_STDID, 1 },	//redundant ECU, node ids with the low bit 0
+	{ CAN_BUS_REDUNDANCY_ID + 1, CAN_FMT_STDID, 1 },	//and 1
+	{ CAN_BUS_SELF_TEST_ID, CAN_FMT_STDID, 0 },	//loopback test
+};
+
+//Written only by the CAN interrupt, message is read under sequence
+//(Seqlock.h).
+typedef struct can_bus_slot_t
+{
+	uint32_t sequence;
+	can_bus_message_t message;
+} can_bus_slot_t;
+
+static can_bus_slot_t can_bus_slots[CAN_BUS_MAILBOX_COUNT];
+static can_bus_stats_t can_bus_stats;
+//timestamp counter at CanBusSend, by the TX FIFO element the frame went
+//into, which the TX event is marked with
+static uint16_t can_bus_tx_queued[CONF_CAN1_TXBC_TFQS];
+static uint32_t can_bus_tx_wait_max;
+//set while the controller is in internal loopback, what the echo calls
+static volatile uint8_t can_bus_loopback;
+static void (* volatile can_bus_on_echo)(uint8_t intact);
+static volatile can_bus_tap_t can_bus_tap;
+static void (* volatile can_bus_on_tx_done)();
+//filters of the mailboxes in each list, CanBusSetFilters' follow
+static uint8_t can_bus_std_mailboxes;
+static uint8_t can_bus_ext_mailboxes;
+static uint8_t can_bus_std_used;
+static uint8_t can_bus_ext_used;
+//payload of the loopback frame, every bit both ways
+static const uint8_t can_bus_loopback_pattern[8] = { 0x55, 0xAA, 0x00, 0xFF, 0x01, 0x02, 0x04, 0x08 };
+
+static int FindMailbox(const struct can_message* msg)
+{
+	for(int i = 0; i < CAN_BUS_MAILBOX_COUNT; ++i)
+	{
+		if( can_bus_mailboxes[i].id == msg->id && can_bus_mailboxes[i].fmt == msg->fmt )
+			return i;
+	}
+	return -1;
+}
+
+//ns a frame of len data bytes keeps the bus busy, interframe space
+//included. Up to 8 bytes a classic frame, over that CAN FD with its data
+//phase at the data bit rate.
+static uint32_t FrameNs(enum can_format fmt, uint8_t len)
+{
+	uint8_t extended = fmt == CAN_FMT_EXTID;
+	if( len <= 8 )
+		return ((extended ? 67 : 47) + 8 * len) * CAN_BUS_BIT_NS;
+
+	//arbitration to BRS, then CRC delimiter, ACK, EOF and IFS at the nominal
+	//rate, ESI, DLC, data, stuff count and CRC at the data rate
+	uint32_t nominal = (extended ? 36 : 17) + 13;
+	uint32_t data = 1 + 4 + 8 * len + 4 + (len <= 16 ? 17 : 21);
+	return nominal * CAN_BUS_BIT_NS + data * CAN_BUS_DATA_BIT_NS;
+}
+
+static void StoreMessage(can_bus_slot_t* slot, const struct can_message* msg, uint32_t tick, uint32_t time, uint8_t ptp)
+{
+	uint8_t len = msg->len < CAN_BUS_MAX_DATA ? msg->len : CAN_BUS_MAX_DATA;
+
+	SeqlockWriteBegin(&slot->sequence);
+	slot->message.len = len;
+	memcpy(slot->message.data, msg->data, len);
+	slot->message.rx_tick = tick;
+	slot->message.rx_time = time;
+	slot->message.rx_ptp = ptp;
+	slot->message.count++;
+	SeqlockWriteEnd(&slot->sequence);
+}
+
+//CAN interrupt, RX FIFO 0 or 1 got a new message
+static void CanBusReceive(struct can_async_descriptor* const descr)
+{
+	uint8_t data[CAN_BUS_MAX_DATA];
+	struct can_message msg;
+	uint32_t start = ProfilerStart();
+	uint32_t tick = xTaskGetTickCountFromISR();
+	can_bus_tap_t tap = can_bus_tap;
+	//the counter and the clock read together, every frame is dated back
+	//from them by how far the counter moved since its start of frame
+	uint16_t counter = (uint16_t)hri_can_read_TSCV_TSC_bf(CAN1);
+	uint32_t now = PtpTimeUs();
+	uint8_t ptp = now != 0;
+	if( !ptp )
+		now = (uint32_t)TimeBaseUs();
+
+	msg.data = data;
+	for(uint8_t fifo = 0; fifo < 2; ++fifo)
+	{
+		//drain completely, only the newest message per mailbox is kept
+		while( can_async_read_fifo(descr, fifo, &msg) == ERR_NONE )
+		{
+			can_bus_stats.rx_frames++;
+			can_bus_stats.busy_ns += FrameNs(msg.fmt, msg.type == CAN_TYPE_DATA ? msg.len : 0);
+			if( msg.type != CAN_TYPE_DATA )
+				continue;
+
+			//a frame that came in during the drain is newer than the reading
+			int16_t age = (int16_t)(counter - msg.timestamp);
+			if( age < 0 )
+				age = 0;
+			uint32_t time = now - (uint32_t)age * CAN_BUS_TIMESTAMP_NS / 1000;
+
+			int mailbox = FindMailbox(&msg);
+			uint8_t tapped = tap ? tap(&msg, time, ptp) : 0;
+			if( mailbox < 0 )
+			{
+				if( !tapped )
+					can_bus_stats.rx_unmatched++;
+			}
+			else
+				StoreMessage(&can_bus_slots[mailbox], &msg, tick, time, ptp);
+			if( mailbox == CAN_BUS_SELF_TEST && can_bus_on_echo )
+				can_bus_on_echo(msg.len == sizeof(can_bus_loopback_pattern)
+					&& memcmp(data, can_bus_loopback_pattern, sizeof(can_bus_loopback_pattern)) == 0);
+		}
+	}
+	ProfilerEnd(PROFILER_STAGE_CAN_RECEIVE, start);
+}
+
+//CAN interrupt, a frame left the TX FIFO
+static void CanBusTransmitted(struct can_async_descriptor* const descr)
+{
+	struct can_tx_event event;
+	while( can_async_read_tx_event(descr, &event) == ERR_NONE )
+	{
+		can_bus_stats.tx_frames++;
+		can_bus_stats.busy_ns += FrameNs(event.fmt, event.len);
+		if( event.marker < CONF_CAN1_TXBC_TFQS )
+		{
+			uint32_t wait = (uint16_t)(event.timestamp - can_bus_tx_queued[event.marker]) * CAN_BUS_TIMESTAMP_NS / 1000;
+			can_bus_stats.tx_wait_total += wait;
+			if( wait > can_bus_stats.tx_wait_max )
+				can_bus_stats.tx_wait_max = wait;
+			if( wait > can_bus_tx_wait_max )
+				can_bus_tx_wait_max = wait;
+		}
+	}
+
+	void (*on_tx_done)() = can_bus_on_tx_done;
+	if( on_tx_done )
+		on_tx_done();
+}
+
+//CAN interrupt, error state changes and overruns
+static void CanBusError(struct can_async_descriptor* const descr, enum can_async_interrupt_type type)
+{
+	switch(type)
+	{
+	case CAN_IRQ_DO:
+		can_bus_stats.rx_overrun++;
+		break;
+	case CAN_IRQ_EP:
+		can_bus_stats.error_passive++;
+		break;
+	case CAN_IRQ_BO:
+		//Bus off puts the controller in init mode. Leaving it starts the
+		//recovery, the controller rejoins after 128 idle periods on the bus.
+		can_bus_stats.bus_off++;
+		can_async_enable(descr);
+		break;
+	default:
+		break;
+	}
+}
+
+void CanBusInit()
+{
+	PeripheralRequire(PERIPHERAL_CAN_0);
+	memset(can_bus_slots, 0, sizeof(can_bus_slots));
+	memset(&can_bus_stats, 0, sizeof(can_bus_stats));
+
+	//Standard and extended IDs have their own filter lists. Non-matching
+	//frames are rejected in hardware (CONF_CAN1_GFC_ANFS/ANFE).
+	uint8_t std_index = 0;
+	uint8_t ext_index = 0;
+	for(int i = 0; i < CAN_BUS_MAILBOX_COUNT; ++i)
+	{
+		const can_bus_mailbox_config_t* config = &can_bus_mailboxes[i];
+		struct can_filter filter;
+		uint8_t index;
+
+		if( config->fmt == CAN_FMT_STDID )
+		{
+			if( std_index >= CONF_CAN1_SIDFC_LSS )
+				continue;
+			index = std_index++;
+			filter.mask = 0x7FF;
+		}
+		else
+		{
+			if( ext_index >= CONF_CAN1_XIDFC_LSS )
+				continue;
+			index = ext_index++;
+			filter.mask = 0x1FFFFFFF;
+		}
+		filter.id = config->id;
+		can_async_set_filter_fifo(&CAN_0, index, config->fmt, &filter, config->fifo);
+	}
+	can_bus_std_mailboxes = can_bus_std_used = std_index;
+	can_bus_ext_mailboxes = can_bus_ext_used = ext_index;
+
+	//The receive callback reads the RTOS tick, so it has to stay inside
+	//configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+	NVIC_SetPriority(CAN1_IRQn, IRQ_PRIORITY_CAN);
+	can_async_register_callback(&CAN_0, CAN_ASYNC_RX_CB, (FUNC_PTR)CanBusReceive);
+	can_async_register_callback(&CAN_0, CAN_ASYNC_IRQ_CB, (FUNC_PTR)CanBusError);
+	can_async_register_callback(&CAN_0, CAN_ASYNC_TX_CB, (FUNC_PTR)CanBusTransmitted);
+	can_async_enable(&CAN_0);
+}
+
+uint8_t CanBusRead(can_bus_mailbox_t mailbox, can_bus_message_t* message)
+{
+	if( mailbox >= CAN_BUS_MAILBOX_COUNT )
+		return 0;
+
+	can_bus_slot_t* slot = &can_bus_slots[mailbox];
+	uint32_t sequence;
+
+	do
+	{
+		sequence = SeqlockReadBegin(&slot->sequence);
+		*message = slot->message;
+	} while( SeqlockReadRetry(&slot->sequence, sequence) );
+
+	return message->count != 0;
+}
+
+uint8_t CanBusLastReceived(can_bus_mailbox_t mailbox, uint32_t* rx_tick)
+{
+	if( mailbox >= CAN_BUS_MAILBOX_COUNT )
+		return 0;
+
+	can_bus_slot_t* slot = &can_bus_slots[mailbox];
+	uint32_t sequence;
+	uint32_t count;
+
+	do
+	{
+		sequence = SeqlockReadBegin(&slot->sequence);
+		*rx_tick = slot->message.rx_tick;
+		count = slot->message.count;
+	} while( SeqlockReadRetry(&slot->sequence, sequence) );
+
+	return count != 0;
+}
+
+int32_t CanBusSend(uint32_t id, enum can_format fmt, const uint8_t* data, uint8_t len)
+{
+	struct can_message msg;
+	int32_t result;
+
+	//without FD the controller can only send classic frames
+	if( len > (CONF_CAN1_CCCR_FDOE ? CAN_BUS_MAX_DATA : 8) )
+		return ERR_INVALID_ARG;
+
+	msg.id = id;
+	msg.fmt = fmt;
+	msg.type = CAN_TYPE_DATA;
+	msg.data = (uint8_t*)data;
+	msg.len = len;
+
+	//the TX FIFO put index is shared by all senders
+	CRITICAL_SECTION_ENTER();
+	uint8_t put = (uint8_t)hri_can_read_TXFQS_TFQPI_bf(CAN1);
+	//a frame sent in loopback would only come back as if from a peer
+	if( can_bus_loopback && id != CAN_BUS_SELF_TEST_ID )
+		result = ERR_DENIED;
+	else
+	{
+		if( put < CONF_CAN1_TXBC_TFQS )
+			can_bus_tx_queued[put] = (uint16_t)hri_can_read_TSCV_TSC_bf(CAN1);
+		result = can_async_write(&CAN_0, &msg);
+	}
+	if( result != ERR_NONE )
+		can_bus_stats.tx_dropped++;
+	CRITICAL_SECTION_LEAVE();
+
+	return result;
+}
+
+void CanBusGetStats(can_bus_stats_t* stats)
+{
+	CRITICAL_SECTION_ENTER();
+	//one read, CEL clears on it. can_async_get_rxerr and _txerr would
+	//read ECR once each and lose what CEL counted in between.
+	uint32_t ecr = hri_can_read_ECR_reg(CAN1);
+	can_bus_stats.errors += (ecr & CAN_ECR_CEL_Msk) >> CAN_ECR_CEL_Pos;
+	can_bus_stats.tx_error_counter = (ecr & CAN_ECR_TEC_Msk) >> CAN_ECR_TEC_Pos;
+	can_bus_stats.rx_error_counter = (ecr & CAN_ECR_REC_Msk) >> CAN_ECR_REC_Pos;
+	*stats = can_bus_stats;
+	CRITICAL_SECTION_LEAVE();
+}
+
+uint32_t CanBusTakeTxWaitMax()
+{
+	CRITICAL_SECTION_ENTER();
+	uint32_t wait = can_bus_tx_wait_max;
+	can_bus_tx_wait_max = 0;
+	CRITICAL_SECTION_LEAVE();
+	return wait;
+}
+
+uint8_t CanBusSetFilters(const can_bus_filter_t* filters, uint8_t count)
+{
+	//off first, an element being rewritten matches nothing
+	for(uint8_t i = can_bus_std_mailboxes; i < can_bus_std_used; ++i)
+		can_async_set_filter_fifo(&CAN_0, i, CAN_FMT_STDID, NULL, 1);
+	for(uint8_t i = can_bus_ext_mailboxes; i < can_bus_ext_used; ++i)
+		can_async_set_filter_fifo(&CAN_0, i, CAN_FMT_EXTID, NULL, 1);
+	can_bus_std_used = can_bus_std_mailboxes;
+	can_bus_ext_used = can_bus_ext_mailboxes;
+
+	uint8_t installed = 0;
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		struct can_filter filter;
+		uint8_t index;
+		if( filters[i].fmt == CAN_FMT_STDID )
+		{
+			if( can_bus_std_used >= CONF_CAN1_SIDFC_LSS )
+				continue;
+			index = can_bus_std_used++;
+			filter.id = filters[i].id & 0x7FF;
+			filter.mask = filters[i].mask & 0x7FF;
+		}
+		else
+		{
+			if( can_bus_ext_used >= CONF_CAN1_XIDFC_LSS )
+				continue;
+			index = can_bus_ext_used++;
+			filter.id = filters[i].id & 0x1FFFFFFF;
+			filter.mask = filters[i].mask & 0x1FFFFFFF;
+		}
+		can_async_set_filter_fifo(&CAN_0, index, filters[i].fmt, &filter, 1);
+		++installed;
+	}
+	return installed;
+}
+
+void CanBusSetTap(can_bus_tap_t tap)
+{
+	can_bus_tap = tap;
+}
+
+uint8_t CanBusTxFree()
+{
+	return (uint8_t)hri_can_read_TXFQS_TFFL_bf(CAN1);
+}
+
+void CanBusSetTxDone(void (*on_tx_done)())
+{
+	can_bus_on_tx_done = on_tx_done;
+}
+
+//Configuration changes need the controller in init mode, which also takes
+//it off the bus. A frame being sent is finished first, a few us at most.
+static void SetLoopback(uint8_t on)
+{
+	hri_can_set_CCCR_INIT_bit(CAN1);
+	while( !hri_can_get_CCCR_INIT_bit(CAN1) )
+		;
+	hri_can_set_CCCR_CCE_bit(CAN1);
+	if( on )
+	{
+		//MON keeps the TX pin recessive, the bus never sees the test frame
+		hri_can_set_CCCR_TEST_bit(CAN1);
+		hri_can_set_CCCR_MON_bit(CAN1);
+		hri_can_set_TEST_LBCK_bit(CAN1);
+	}
+	else
+	{
+		//clearing TEST resets the test register and with it LBCK
+		hri_can_clear_CCCR_MON_bit(CAN1);
+		hri_can_clear_CCCR_TEST_bit(CAN1);
+	}
+	//CCE clears with INIT
+	hri_can_clear_CCCR_INIT_bit(CAN1);
+}
+
+uint8_t CanBusLoopbackBegin(void (*on_echo)(uint8_t intact))
+{
+	can_bus_loopback = 1;
+	can_bus_on_echo = on_echo;
+	SetLoopback(1);
+	return CanBusSend(CAN_BUS_SELF_TEST_ID, CAN_FMT_STDID, can_bus_loopback_pattern,
+		sizeof(can_bus_loopback_pattern)) == ERR_NONE;
+}
+
+void CanBusLoopbackEnd()
+{
+	SetLoopback(0);
+	can_bus_on_echo = NULL;
+	can_bus_loopback = 0;
+}
+
+//bytes spanned by signal
+static inline uint8_t SignalEnd(const can_bus_signal_t* signal)
+{
+	return (signal->start_bit + signal->length + 7) >> 3;
+}
+
+uint32_t CanBusUnpackSignal(const uint8_t* data, uint8_t len, const can_bus_signal_t* signal)
+{
+	if( signal->length == 0 || signal->length > 32 || SignalEnd(signal) > len )
+		return 0;
+
+	const uint8_t* p = data + (signal->start_bit >> 3);
+	uint8_t shift = signal->start_bit & 7;
+	uint8_t bytes = SignalEnd(signal) - (signal->start_bit >> 3);
+	uint64_t bits = 0;
+
+	for(int i = 0; i < bytes; ++i)
+		bits |= (uint64_t)p[i] << (8 * i);
+
+	uint32_t raw = (uint32_t)(bits >> shift);
+	if( signal->length < 32 )
+	{
+		uint32_t mask = (1UL << signal->length) - 1;
+		raw &= mask;
+		if( signal->is_signed && (raw & (1UL << (signal->length - 1))) )
+			raw |= ~mask;
+	}
+	return raw;
+}
+
+void CanBusPackSignal(uint8_t* data, const can_bus_signal_t* signal, uint32_t raw)
+{
+	if( signal->length == 0 || signal->length > 32 )
+		return;
+
+	uint8_t* p = data + (signal->start_bit >> 3);
+	uint8_t shift = signal->start_bit & 7;
+	uint8_t bytes = SignalEnd(signal) - (signal->start_bit >> 3);
+	uint64_t mask = (((uint64_t)1 << signal->length) - 1) << shift;
+	uint64_t bits = ((uint64_t)raw << shift) & mask;
+
+	for(int i = 0; i < bytes; ++i)
+		p[i] = (p[i] & ~(uint8_t)(mask >> (8 * i))) | (uint8_t)(bits >> (8 * i));
+}
+
+void CanBusFrameInit(can_bus_frame_t* frame, uint32_t id, enum can_format fmt)
+{
+	frame->id = id;
+	frame->fmt = fmt;
+	frame->len = 0;
+	memset(frame->data, 0, sizeof(frame->data));
+}
+
+void CanBusFramePack(can_bus_frame_t* frame, const can_bus_signal_t* signal, uint32_t raw)
+{
+	uint8_t end = SignalEnd(signal);
+	if( end > CAN_BUS_MAX_DATA )
+		return;
+
+	CanBusPackSignal(frame->data, signal, raw);
+	if( end > frame->len )
+		frame->len = end;
+}
+
+int32_t CanBusSendFrame(const can_bus_frame_t* frame)
+{
+	return CanBusSend(frame->id, frame->fmt, frame->data, frame->len);
+}
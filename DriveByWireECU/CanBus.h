@@ -0,0 +1,224 @@
+/*
+ * CanBus.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CANBUS_H_
+#define CANBUS_H_
+
+#include <stdint.h>
+#include <hal_can_async.h>
+
+//CAN actuators and sensors on CAN_0 (CAN1 peripheral, PB12/PB13).
+//Every message the ECU listens to has a mailbox. The hardware acceptance
+//filters only let those IDs in, the CAN interrupt drains both RX FIFOs and
+//keeps the newest message of each mailbox. Tasks read the latest value
+//without locking and never touch the bus, and sends only queue into the
+//TX FIFO so they never wait for the bus either.
+//
+//High rate sensor traffic goes to RX FIFO 1 and everything else to FIFO 0,
+//so a burst of sensor frames can not push out an actuator's reply.
+//
+//The bus runs CAN FD with bit rate switching, and classic CAN nodes share
+//it: frames of up to 8 bytes go out as classic CAN, longer ones as CAN FD
+//at the data phase rate. Several signals can be packed into one frame with
+//can_bus_signal_t, so a sensor sends all of its values in a single frame.
+//
+//To add a message, add its mailbox here and its ID and FIFO to the mailbox
+//table in CanBus.c.
+//
+//Frames no mailbox listens to can be let in as well (CanBusSetFilters),
+//into RX FIFO 1, and every frame received is offered to a tap
+//(CanBusSetTap) with the time it started on the bus, from the controller's
+//timestamp counter. CanGateway.h forwards them that way.
+//
+//Every frame sent is logged by the controller in its TX event FIFO with
+//the time it started on the bus, the CAN interrupt reads it back for the
+//stats: how long frames waited in the TX FIFO for arbitration, and with
+//the frames received, how busy the bus was. CanHealth.h turns the stats
+//into signals.
+typedef enum can_bus_mailbox_t
+{
+	CAN_BUS_EPS_STATUS = 0,
+	CAN_BUS_WHEEL_SPEED,
+	//state frames of the two ECUs of a redundant pair, by the low bit of
+	//the node id (Redundancy.h)
+	CAN_BUS_REDUNDANCY_0,
+	CAN_BUS_REDUNDANCY_1,
+	//the frame of the loopback test, only ever received from the ECU itself
+	CAN_BUS_SELF_TEST,
+	CAN_BUS_MAILBOX_COUNT
+} can_bus_mailbox_t;
+
+//Standard IDs, placeholders until the EPS controller and the wheel speed
+//sensors are programmed
+#ifndef CAN_BUS_EPS_STATUS_ID
+#define CAN_BUS_EPS_STATUS_ID 0x110
+#endif
+#ifndef CAN_BUS_WHEEL_SPEED_ID
+#define CAN_BUS_WHEEL_SPEED_ID 0x120
+#endif
+//+0 and +1, the two of a redundant pair. Above the sensors, so their
+//frames win arbitration over the replication
+#ifndef CAN_BUS_REDUNDANCY_ID
+#define CAN_BUS_REDUNDANCY_ID 0x150
+#endif
+//Lowest priority there is, it never reaches the bus anyway
+#ifndef CAN_BUS_SELF_TEST_ID
+#define CAN_BUS_SELF_TEST_ID 0x7FF
+#endif
+
+//Largest payload, CAN FD
+#define CAN_BUS_MAX_DATA 64
+
+typedef struct can_bus_message_t
+{
+	uint8_t len;
+	uint8_t data[CAN_BUS_MAX_DATA];
+	//RTOS tick the message was received at
+	uint32_t rx_tick;
+	//us the frame started on the bus, as a tap's time (can_bus_tap_t)
+	uint32_t rx_time;
+	uint8_t rx_ptp;
+	//messages received in this mailbox so far, 0 if none yet
+	uint32_t count;
+} can_bus_message_t;
+
+typedef struct can_bus_stats_t
+{
+	//accepted by a filter but matching no mailbox
+	uint32_t rx_unmatched;
+	//RX FIFO full, messages lost in hardware
+	uint32_t rx_overrun;
+	//TX FIFO full, message not sent
+	uint32_t tx_dropped;
+	uint32_t error_passive;
+	uint32_t bus_off;
+	//data and remote frames the filters let in, frames sent
+	uint32_t rx_frames;
+	uint32_t tx_frames;
+	//ns the frames above kept the bus busy, from their length and the bit
+	//rates, stuff bits not counted. Wraps every 4.2 s, the difference of
+	//two reads closer than that is right.
+	uint32_t busy_ns;
+	//us from CanBusSend to the start of frame on the bus, summed over
+	//tx_frames, and the most
+	uint32_t tx_wait_total;
+	uint32_t tx_wait_max;
+	//error counter increments, from the controller's error log, which
+	//saturates at 255 between two CanBusGetStats
+	uint32_t errors;
+	//the transmit and receive error counters as read, 128 and more is
+	//error passive
+	uint8_t tx_error_counter;
+	uint8_t rx_error_counter;
+} can_bus_stats_t;
+
+//Acceptance of frames besides the mailboxes', a frame passes if
+//(id & mask) == (filter id & mask)
+typedef struct can_bus_filter_t
+{
+	uint32_t id;
+	uint32_t mask;
+	enum can_format fmt;
+} can_bus_filter_t;
+
+//Gets every data frame the controller received, from the CAN interrupt.
+//time is the us the frame started on the bus: PTP us, low 32 bits, when ptp
+//is set, TimeBaseUs otherwise. Returns non-zero if it took the frame. Must
+//not block and should return within a few us, it runs for every frame.
+typedef uint8_t (*can_bus_tap_t)(const struct can_message* msg, uint32_t time, uint8_t ptp);
+
+//An integer value inside a frame's payload, Intel (little-endian) layout
+//as in a DBC file: start_bit is the position of the least significant
+//bit, bit 0 being the low bit of byte 0.
+typedef struct can_bus_signal_t
+{
+	uint16_t start_bit;
+	//1 to 32
+	uint8_t length;
+	//sign extend when unpacking
+	uint8_t is_signed;
+} can_bus_signal_t;
+
+//A frame being built for CanBusSendFrame
+typedef struct can_bus_frame_t
+{
+	uint32_t id;
+	enum can_format fmt;
+	//grows to cover every signal packed so far
+	uint8_t len;
+	uint8_t data[CAN_BUS_MAX_DATA];
+} can_bus_frame_t;
+
+//Installs the mailbox filters and starts CAN_0.
+//Must be called once after atmel_start_init.
+void CanBusInit();
+
+//Newest message of mailbox. Returns 0 if nothing was received yet.
+//Safe from any task, it never blocks.
+uint8_t CanBusRead(can_bus_mailbox_t mailbox, can_bus_message_t* message);
+
+//Just the rx_tick of the newest message, without copying the payload.
+//Returns 0 if nothing was received yet.
+uint8_t CanBusLastReceived(can_bus_mailbox_t mailbox, uint32_t* rx_tick);
+
+//Queues a data frame for transmission. Returns ERR_NO_RESOURCE right away
+//when the TX FIFO is full, the message is then dropped. A len that is not
+//a CAN FD length is padded with zeros up to the next one.
+int32_t CanBusSend(uint32_t id, enum can_format fmt, const uint8_t* data, uint8_t len);
+
+//Raw value of signal in a received payload of len bytes, sign extended if
+//the signal is signed. 0 if the signal lies past len.
+uint32_t CanBusUnpackSignal(const uint8_t* data, uint8_t len, const can_bus_signal_t* signal);
+//Writes the low signal->length bits of raw into data, leaving the
+//other bits alone.
+void CanBusPackSignal(uint8_t* data, const can_bus_signal_t* signal, uint32_t raw);
+
+//Empty payload, every bit zero
+void CanBusFrameInit(can_bus_frame_t* frame, uint32_t id, enum can_format fmt);
+//Adds a signal and grows the frame to cover it. Signals past
+//CAN_BUS_MAX_DATA are ignored.
+void CanBusFramePack(can_bus_frame_t* frame, const can_bus_signal_t* signal, uint32_t raw);
+//CanBusSend for a built frame
+int32_t CanBusSendFrame(const can_bus_frame_t* frame);
+
+//Reads the error counters as well. Any task.
+void CanBusGetStats(can_bus_stats_t* stats);
+
+//Most us a frame waited to be sent since the last call, 0 with none sent.
+//For one reader, CanHealth.h.
+uint32_t CanBusTakeTxWaitMax();
+
+//Filters for frames no mailbox listens to, after the mailboxes' in the
+//hardware lists, into RX FIFO 1 with the sensor traffic so they can not push
+//out an actuator's reply. Replaces the filters set before, a count of 0
+//removes them. Returns how many were installed, the lists have room for
+//CONF_CAN1_SIDFC_LSS standard and CONF_CAN1_XIDFC_LSS extended filters,
+//the mailboxes' included. From a task.
+uint8_t CanBusSetFilters(const can_bus_filter_t* filters, uint8_t count);
+
+//Installs tap, NULL removes it. The frames it takes are not counted as
+//unmatched.
+void CanBusSetTap(can_bus_tap_t tap);
+
+//Free TX FIFO elements, a sender with several frames queues that many and
+//waits for on_tx_done for the rest
+uint8_t CanBusTxFree();
+
+//Runs from the CAN interrupt every time a frame has been sent, NULL for none
+void CanBusSetTxDone(void (*on_tx_done)());
+
+//Loopback test of the controller, for the self test (SelfTest.h). The
+//controller goes off the bus into internal loopback and sends a frame of
+//CAN_BUS_SELF_TEST_ID to itself, on_echo runs from the CAN interrupt once
+//the frame is received back, intact if its payload is what was sent. Until CanBusLoopbackEnd nothing else is sent
+//or received, sends are refused, a frame time or two at boot. Returns 0
+//if the frame could not be queued. From a task.
+uint8_t CanBusLoopbackBegin(void (*on_echo)(uint8_t intact));
+
+//Back on the bus, sends are taken again
+void CanBusLoopbackEnd();
+
+#endif /* CANBUS_H_ */
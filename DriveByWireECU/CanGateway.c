@@ -0,0 +1,378 @@
+/*
+ * CanGateway.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "CanGateway.h"
+
+#if CAN_GATEWAY_ENABLE
+
+#include <hal_atomic.h>
+#include <hal_can_async.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "CanBus.h"
+#include "Log.h"
+#include "ByteOrder.h"
+
+//A frame as the interrupt left it, in the RX batch's layout but for the data
+typedef struct can_gateway_frame_t
+{
+	uint32_t time;
+	//CAN_GATEWAY_ID_* flags in the top bits
+	uint32_t id;
+	uint8_t len;
+	uint8_t data[CAN_BUS_MAX_DATA];
+} can_gateway_frame_t;
+
+typedef struct can_gateway_tx_t
+{
+	uint32_t id;
+	enum can_format fmt;
+	uint8_t len;
+	uint8_t data[CAN_BUS_MAX_DATA];
+} can_gateway_tx_t;
+
+static struct
+{
+	TaskHandle_t task;
+	struct udp_pcb* pcb;
+
+	//tcpip thread, or the task under the core lock
+	uint8_t forwarding;
+	ip_addr_t destination;
+	u16_t port;
+	TickType_t flush;
+	TickType_t config_tick;
+	uint16_t tx_sequence;
+	uint8_t hardware_filters;
+
+	//read by the interrupt, changed with it masked
+	can_bus_filter_t filters[CAN_GATEWAY_MAX_FILTERS];
+	uint8_t filter_count;
+
+	//written by the interrupt, read by the task
+	can_gateway_frame_t ring[CAN_GATEWAY_RING_SIZE];
+	uint32_t head;
+	uint32_t tail;
+	volatile uint32_t forwarded;
+	volatile uint32_t lost;
+
+	//written by the tcpip thread, sent by the task
+	can_gateway_tx_t tx_ring[CAN_GATEWAY_TX_RING_SIZE];
+	uint32_t tx_head;
+	uint32_t tx_tail;
+	volatile uint32_t tx_sent;
+	volatile uint32_t tx_dropped;
+} can_gateway;
+
+static void WriteHeader(uint8_t* datagram, uint8_t type)
+{
+	memcpy(datagram, "DBWG", 4);
+	datagram[4] = CAN_GATEWAY_VERSION;
+	datagram[5] = type;
+	PutLE16(&datagram[6], can_gateway.tx_sequence++);
+}
+
+static uint8_t Passes(const struct can_message* msg)
+{
+	for(uint8_t i = 0; i < can_gateway.filter_count; ++i)
+	{
+		const can_bus_filter_t* filter = &can_gateway.filters[i];
+		if( filter->fmt == msg->fmt && (msg->id & filter->mask) == (filter->id & filter->mask) )
+			return 1;
+	}
+	return 0;
+}
+
+//CAN interrupt, every data frame received while forwarding
+static uint8_t GatewayTap(const struct can_message* msg, uint32_t time, uint8_t ptp)
+{
+	if( !Passes(msg) )
+		return 0;
+
+	uint32_t head = can_gateway.head;
+	uint32_t waiting = head - __atomic_load_n(&can_gateway.tail, __ATOMIC_ACQUIRE);
+	if( waiting >= CAN_GATEWAY_RING_SIZE )
+	{
+		can_gateway.lost++;
+		return 1;
+	}
+
+	can_gateway_frame_t* frame = &can_gateway.ring[head & (CAN_GATEWAY_RING_SIZE - 1)];
+	frame->time = time;
+	frame->id = msg->id | (msg->fmt == CAN_FMT_EXTID ? CAN_GATEWAY_ID_EXTENDED : 0) | (ptp ? 0 : CAN_GATEWAY_ID_TIME_BASE);
+	frame->len = msg->len < CAN_BUS_MAX_DATA ? msg->len : CAN_BUS_MAX_DATA;
+	memcpy(frame->data, msg->data, frame->len);
+	__atomic_store_n(&can_gateway.head, head + 1, __ATOMIC_RELEASE);
+	can_gateway.forwarded++;
+
+	//only the frame that fills a batch wakes the task, the flush time the rest
+	if( waiting + 1 == CAN_GATEWAY_WAKE_FRAMES )
+	{
+		BaseType_t woken = pdFALSE;
+		vTaskNotifyGiveFromISR(can_gateway.task, &woken);
+		portYIELD_FROM_ISR(woken);
+	}
+	return 1;
+}
+
+//CAN interrupt, the TX FIFO has room again
+static void GatewayTxDone()
+{
+	if( can_gateway.tx_head == can_gateway.tx_tail )
+		return;
+
+	BaseType_t woken = pdFALSE;
+	vTaskNotifyGiveFromISR(can_gateway.task, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+//Feeds the TX FIFO from the TX ring while it has room
+static void SendTx()
+{
+	uint32_t head = __atomic_load_n(&can_gateway.tx_head, __ATOMIC_ACQUIRE);
+	while( can_gateway.tx_tail != head && CanBusTxFree() > 0 )
+	{
+		const can_gateway_tx_t* tx = &can_gateway.tx_ring[can_gateway.tx_tail & (CAN_GATEWAY_TX_RING_SIZE - 1)];
+		int32_t result = CanBusSend(tx->id, tx->fmt, tx->data, tx->len);
+		if( result == ERR_NO_RESOURCE )
+			break;
+		if( result == ERR_NONE )
+			can_gateway.tx_sent++;
+		else
+			can_gateway.tx_dropped++;
+		__atomic_store_n(&can_gateway.tx_tail, can_gateway.tx_tail + 1, __ATOMIC_RELEASE);
+	}
+}
+
+//Sends the frames waiting, a datagram at a time. The task, with the core
+//lock for the sends only.
+static void SendRx()
+{
+	uint32_t head = __atomic_load_n(&can_gateway.head, __ATOMIC_ACQUIRE);
+	while( can_gateway.tail != head )
+	{
+		struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CAN_GATEWAY_DATAGRAM_SIZE, PBUF_RAM);
+		if( p == NULL )
+			return;
+
+		uint8_t* datagram = (uint8_t*)p->payload;
+		uint16_t length = CAN_GATEWAY_RX_BATCH_SIZE;
+		uint8_t count = 0;
+		while( can_gateway.tail != head && count < 255 )
+		{
+			const can_gateway_frame_t* frame = &can_gateway.ring[can_gateway.tail & (CAN_GATEWAY_RING_SIZE - 1)];
+			if( length + CAN_GATEWAY_RX_FRAME_SIZE + frame->len > CAN_GATEWAY_DATAGRAM_SIZE )
+				break;
+			PutLE32(&datagram[length], frame->time);
+			PutLE32(&datagram[length + 4], frame->id);
+			datagram[length + 8] = frame->len;
+			memcpy(&datagram[length + 9], frame->data, frame->len);
+			length += CAN_GATEWAY_RX_FRAME_SIZE + frame->len;
+			++count;
+			__atomic_store_n(&can_gateway.tail, can_gateway.tail + 1, __ATOMIC_RELEASE);
+		}
+		datagram[8] = count;
+		PutLE32(&datagram[9], can_gateway.lost);
+		pbuf_realloc(p, length);
+
+		LOCK_TCPIP_CORE();
+		if( can_gateway.forwarding )
+		{
+			WriteHeader(datagram, CAN_GATEWAY_RX_BATCH);
+			udp_sendto(can_gateway.pcb, p, &can_gateway.destination, can_gateway.port);
+		}
+		UNLOCK_TCPIP_CORE();
+		pbuf_free(p);
+	}
+}
+
+//Stops the tap and takes the filters out. tcpip thread or the core lock.
+static void StopForwarding()
+{
+	CanBusSetTap(NULL);
+	CanBusSetFilters(NULL, 0);
+	can_gateway.forwarding = 0;
+	can_gateway.hardware_filters = 0;
+}
+
+static void GatewayTask(void* p)
+{
+	while( 1 )
+	{
+		//idle, the config or a TX batch wakes it
+		ulTaskNotifyTake(pdTRUE, can_gateway.forwarding ? can_gateway.flush : portMAX_DELAY);
+		SendTx();
+
+		LOCK_TCPIP_CORE();
+		if( can_gateway.forwarding && xTaskGetTickCount() - can_gateway.config_tick >= pdMS_TO_TICKS(CAN_GATEWAY_LEASE) )
+			StopForwarding();
+		UNLOCK_TCPIP_CORE();
+
+		//a full batch or the flush time woke it, or a TX wake up takes
+		//along what waits so far
+		SendRx();
+	}
+}
+
+static void SendStatus(struct udp_pcb* pcb, ip_addr_t* addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CAN_GATEWAY_STATUS_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	uint8_t* datagram = (uint8_t*)p->payload;
+	WriteHeader(datagram, CAN_GATEWAY_STATUS);
+	datagram[8] = can_gateway.forwarding;
+	datagram[9] = can_gateway.hardware_filters;
+	PutLE32(&datagram[10], can_gateway.forwarded);
+	PutLE32(&datagram[14], can_gateway.lost);
+	PutLE32(&datagram[18], can_gateway.tx_sent);
+	PutLE32(&datagram[22], can_gateway.tx_dropped);
+	udp_sendto(pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void ApplyConfig(const uint8_t* datagram, uint16_t length, ip_addr_t* addr, u16_t port)
+{
+	uint8_t count = datagram[17];
+	if( count > CAN_GATEWAY_MAX_FILTERS || length < CAN_GATEWAY_CONFIG_SIZE + count * CAN_GATEWAY_FILTER_SIZE )
+		return;
+
+	if( !datagram[8] )
+	{
+		StopForwarding();
+		return;
+	}
+
+	can_bus_filter_t filters[CAN_GATEWAY_MAX_FILTERS];
+	const uint8_t* entry = &datagram[CAN_GATEWAY_CONFIG_SIZE];
+	for(uint8_t i = 0; i < count; ++i, entry += CAN_GATEWAY_FILTER_SIZE)
+	{
+		uint32_t id = GetLE32(&entry[0]);
+		filters[i].fmt = (id & CAN_GATEWAY_ID_EXTENDED) ? CAN_FMT_EXTID : CAN_FMT_STDID;
+		filters[i].id = id & 0x1FFFFFFF;
+		filters[i].mask = GetLE32(&entry[4]) & 0x1FFFFFFF;
+	}
+
+	//the interrupt reads them, and never sees half a table
+	CRITICAL_SECTION_ENTER();
+	memcpy(can_gateway.filters, filters, count * sizeof(filters[0]));
+	can_gateway.filter_count = count;
+	CRITICAL_SECTION_LEAVE();
+	can_gateway.hardware_filters = CanBusSetFilters(filters, count);
+
+	uint32_t destination;
+	//already in network order, first octet first
+	memcpy(&destination, &datagram[9], sizeof(destination));
+	if( destination != 0 )
+		ip4_addr_set_u32(&can_gateway.destination, destination);
+	else
+		ip_addr_copy(can_gateway.destination, *addr);
+	can_gateway.port = GetLE16(&datagram[13]) ? GetLE16(&datagram[13]) : port;
+	uint16_t flush = GetLE16(&datagram[15]);
+	can_gateway.flush = pdMS_TO_TICKS(flush ? flush : CAN_GATEWAY_DEFAULT_FLUSH);
+	can_gateway.config_tick = xTaskGetTickCount();
+	if( !can_gateway.forwarding )
+	{
+		can_gateway.forwarding = 1;
+		CanBusSetTap(GatewayTap);
+		xTaskNotifyGive(can_gateway.task);
+	}
+}
+
+static void QueueTx(const uint8_t* datagram, uint16_t length)
+{
+	uint8_t count = datagram[8];
+	uint16_t offset = CAN_GATEWAY_TX_BATCH_SIZE;
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		if( offset + CAN_GATEWAY_TX_FRAME_SIZE > length
+			|| datagram[offset + 4] > CAN_BUS_MAX_DATA
+			|| offset + CAN_GATEWAY_TX_FRAME_SIZE + datagram[offset + 4] > length )
+		{
+			can_gateway.tx_dropped += count - i;
+			break;
+		}
+
+		uint32_t tail = __atomic_load_n(&can_gateway.tx_tail, __ATOMIC_ACQUIRE);
+		uint8_t len = datagram[offset + 4];
+		if( can_gateway.tx_head - tail >= CAN_GATEWAY_TX_RING_SIZE )
+			can_gateway.tx_dropped++;
+		else
+		{
+			can_gateway_tx_t* tx = &can_gateway.tx_ring[can_gateway.tx_head & (CAN_GATEWAY_TX_RING_SIZE - 1)];
+			uint32_t id = GetLE32(&datagram[offset]);
+			tx->fmt = (id & CAN_GATEWAY_ID_EXTENDED) ? CAN_FMT_EXTID : CAN_FMT_STDID;
+			tx->id = id & 0x1FFFFFFF;
+			tx->len = len;
+			memcpy(tx->data, &datagram[offset + CAN_GATEWAY_TX_FRAME_SIZE], len);
+			__atomic_store_n(&can_gateway.tx_head, can_gateway.tx_head + 1, __ATOMIC_RELEASE);
+		}
+		offset += CAN_GATEWAY_TX_FRAME_SIZE + len;
+	}
+	xTaskNotifyGive(can_gateway.task);
+}
+
+//Runs for every datagram on CAN_GATEWAY_PORT, in the tcpip thread
+static void GatewayReceive(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	static uint8_t datagram[CAN_GATEWAY_DATAGRAM_SIZE];
+	uint16_t length = pbuf_copy_partial(p, datagram, sizeof(datagram), 0);
+	pbuf_free(p);
+
+	if( length < CAN_GATEWAY_HEADER_SIZE + 1 || memcmp(datagram, "DBWG", 4) != 0 || datagram[4] != CAN_GATEWAY_VERSION )
+		return;
+
+	if( datagram[5] == CAN_GATEWAY_CONFIG && length >= CAN_GATEWAY_CONFIG_SIZE )
+	{
+		ApplyConfig(datagram, length, addr, port);
+		SendStatus(pcb, addr, port);
+	}
+	else if( datagram[5] == CAN_GATEWAY_TX_BATCH )
+		QueueTx(datagram, length);
+}
+
+void CanGatewayInit()
+{
+	can_gateway.flush = pdMS_TO_TICKS(CAN_GATEWAY_DEFAULT_FLUSH);
+	xTaskCreate(GatewayTask, "CanGateway", TASK_STACK_CAN_GATEWAY, NULL, TASK_PRIORITY_CAN_GATEWAY, &can_gateway.task);
+}
+
+void CanGatewayStart(void* ctx)
+{
+	if( can_gateway.task == NULL )
+	{
+		LOG("CAN gateway: no task");
+		return;
+	}
+
+	can_gateway.pcb = udp_new();
+	if( can_gateway.pcb == NULL || udp_bind(can_gateway.pcb, IP_ADDR_ANY, CAN_GATEWAY_PORT) != ERR_OK )
+	{
+		LOG("CAN gateway bind error");
+		if( can_gateway.pcb != NULL )
+			udp_remove(can_gateway.pcb);
+		can_gateway.pcb = NULL;
+		return;
+	}
+	udp_recv(can_gateway.pcb, GatewayReceive, NULL);
+	CanBusSetTxDone(GatewayTxDone);
+}
+
+#else
+
+void CanGatewayInit()
+{
+}
+
+void CanGatewayStart(void* ctx)
+{
+}
+
+#endif
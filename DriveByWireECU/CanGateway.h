@@ -0,0 +1,145 @@
+/*
+ * CanGateway.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CANGATEWAY_H_
+#define CANGATEWAY_H_
+
+#include <stdint.h>
+
+//CAN to Ethernet gateway, to log the vehicle's own bus on CAN_0 through the
+//ECU and to put frames on it from the PC, on a UDP port of its own.
+//
+//The PC sends a config: where the frames go, the filters of the ones it
+//wants and how long a frame may wait for its batch. The filters go into
+//the controller's acceptance lists behind the mailboxes' (CanBusSetFilters)
+//and are checked again in software, for the mailbox frames the hardware
+//lets in anyway. The CAN interrupt dates every frame that passes from the
+//controller's timestamp counter and copies it into a ring, that is all it
+//does for the gateway. The gateway task sends the ring on, as many frames
+//per datagram as fit CAN_GATEWAY_DATAGRAM_SIZE, once CAN_GATEWAY_WAKE_FRAMES
+//are waiting or the oldest has waited the flush time. TX batches from the
+//PC are queued and fed to the TX FIFO in order as it frees up.
+//
+//A loaded bus stays off the control timing: the interrupt costs a copy per
+//frame, the gateway task runs below the control, GMAC and tcpip tasks, and
+//the frames go to RX FIFO 1 with the sensor traffic so no burst pushes out
+//an actuator's reply. 1 Mbit/s of classic frames is about 8 per ms, the
+//ring holds CAN_GATEWAY_RING_SIZE of them while the task waits its turn.
+//
+//Forwarding stops CAN_GATEWAY_LEASE ms after the last config, so the PC
+//repeats it like a subscribe (ControlProtocol.h).
+//
+//Every datagram is little-endian with no padding and starts with
+//
+//	0		4		"DBWG"
+//	4		1		CAN_GATEWAY_VERSION
+//	5		1		type, CAN_GATEWAY_*
+//	6		2		sequence, incremented by the sender for every datagram
+//
+//Config payload, PC -> ECU, answered with a status datagram:
+//
+//	8		1		1 to forward, 0 to stop
+//	9		4		destination address, first octet first, 0 for the sender
+//	13		2		destination port, 0 for the sender's
+//	15		2		ms a frame waits at most for its batch, 0 for
+//					CAN_GATEWAY_DEFAULT_FLUSH
+//	17		1		filters that follow, up to CAN_GATEWAY_MAX_FILTERS
+//	18		...		per filter: id then mask, 4 bytes each. A frame passes
+//					when (id & mask) == (filter id & mask), and bit 31 of
+//					the filter id picks extended ids.
+//
+//Status payload, ECU -> PC:
+//
+//	8		1		1 while forwarding
+//	9		1		filters installed in hardware. Those past the room in
+//					the lists only see the frames a mailbox lets in.
+//	10		4		frames forwarded since boot
+//	14		4		frames lost since boot, the ring was full
+//	18		4		frames sent on the bus since boot
+//	22		4		frames from the PC dropped since boot, TX ring full,
+//					bad length or refused by the bus
+//
+//RX batch payload, ECU -> PC:
+//
+//	8		1		frames that follow
+//	9		4		frames lost since boot, as the status'
+//	13		...		per frame:
+//					0	4	us the frame started on the bus, low 32 bits
+//					4	4	id, bit 31 set for an extended id, bit 30 set
+//							when the time is TimeBaseUs because the PTP
+//							clock (Ptp.h) has not synced
+//					8	1	data bytes n, up to 64
+//					9	n	data
+//
+//TX batch payload, PC -> ECU:
+//
+//	8		1		frames that follow
+//	9		...		per frame: id as the RX batch's, bit 30 ignored, then
+//					the data bytes n and the data. Over 8 bytes goes as
+//					CAN FD.
+
+#ifndef CAN_GATEWAY_ENABLE
+#define CAN_GATEWAY_ENABLE 1
+#endif
+
+#ifndef CAN_GATEWAY_PORT
+#define CAN_GATEWAY_PORT 12096
+#endif
+
+#define CAN_GATEWAY_VERSION 1
+
+#define CAN_GATEWAY_CONFIG 1
+#define CAN_GATEWAY_STATUS 2
+#define CAN_GATEWAY_RX_BATCH 3
+#define CAN_GATEWAY_TX_BATCH 4
+
+#define CAN_GATEWAY_HEADER_SIZE 8
+#define CAN_GATEWAY_CONFIG_SIZE (CAN_GATEWAY_HEADER_SIZE + 10)
+#define CAN_GATEWAY_FILTER_SIZE 8
+#define CAN_GATEWAY_STATUS_SIZE (CAN_GATEWAY_HEADER_SIZE + 18)
+#define CAN_GATEWAY_RX_BATCH_SIZE (CAN_GATEWAY_HEADER_SIZE + 5)
+#define CAN_GATEWAY_RX_FRAME_SIZE 9
+#define CAN_GATEWAY_TX_BATCH_SIZE (CAN_GATEWAY_HEADER_SIZE + 1)
+#define CAN_GATEWAY_TX_FRAME_SIZE 5
+
+#define CAN_GATEWAY_ID_EXTENDED 0x80000000
+#define CAN_GATEWAY_ID_TIME_BASE 0x40000000
+
+//Largest RX batch datagram, one Ethernet frame
+#define CAN_GATEWAY_DATAGRAM_SIZE 1400
+
+#define CAN_GATEWAY_MAX_FILTERS 16
+
+//Frames the interrupt holds for the task, a power of 2
+#ifndef CAN_GATEWAY_RING_SIZE
+#define CAN_GATEWAY_RING_SIZE 128
+#endif
+
+//Frames from the PC waiting for the TX FIFO, a power of 2
+#ifndef CAN_GATEWAY_TX_RING_SIZE
+#define CAN_GATEWAY_TX_RING_SIZE 32
+#endif
+
+//Frames waiting that wake the task before the flush time, about a datagram
+//of classic frames
+#define CAN_GATEWAY_WAKE_FRAMES 64
+
+//ms
+#ifndef CAN_GATEWAY_DEFAULT_FLUSH
+#define CAN_GATEWAY_DEFAULT_FLUSH 5
+#endif
+#define CAN_GATEWAY_LEASE 3000
+
+//Creates the gateway task. Once at boot, before the scheduler starts.
+void CanGatewayInit();
+
+//Binds CAN_GATEWAY_PORT for configs and TX batches from the PC and takes
+//over the CAN TX done callback. ctx is unused, it has the tcpip_callback
+//signature so it can be queued to the tcpip thread. Needs the task from
+//CanGatewayInit.
+void CanGatewayStart(void* ctx);
+
+#endif /* CANGATEWAY_H_ */
@@ -0,0 +1,59 @@
+/*
+ * CanHealth.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "lwip/sys.h"
+#include "lwip/timers.h"
+#include "CanHealth.h"
+#include "CanBus.h"
+#include "SignalBus.h"
+
+//tcpip thread only
+static struct
+{
+	//sys_now of the last sample
+	uint32_t sampled_at;
+	can_bus_stats_t stats;
+} can_health;
+
+static void CanHealthSample(void* arg)
+{
+	can_bus_stats_t stats;
+	uint32_t now = sys_now();
+	uint32_t elapsed = now - can_health.sampled_at;
+	CanBusGetStats(&stats);
+	uint32_t wait_max = CanBusTakeTxWaitMax();
+
+	//a late timeout stretches the period, not the rates
+	float per_second = elapsed ? 1000.0f / (float)elapsed : 0.0f;
+	uint32_t sent = stats.tx_frames - can_health.stats.tx_frames;
+	uint32_t busy = stats.busy_ns - can_health.stats.busy_ns;
+	//busy ns over elapsed ms, in %
+	SignalPublishFloat(SIGNAL_CAN_BUS_LOAD, elapsed ? (float)busy / (float)elapsed * 0.0001f : 0.0f);
+	SignalPublishFloat(SIGNAL_CAN_RX_FRAMES, (float)(stats.rx_frames - can_health.stats.rx_frames) * per_second);
+	SignalPublishFloat(SIGNAL_CAN_TX_FRAMES, (float)sent * per_second);
+	SignalPublishFloat(SIGNAL_CAN_ERRORS, (float)(stats.errors - can_health.stats.errors) * per_second);
+	SignalPublishFloat(SIGNAL_CAN_RX_OVERRUNS, (float)(stats.rx_overrun - can_health.stats.rx_overrun) * per_second);
+	SignalPublishFloat(SIGNAL_CAN_TX_DROPPED, (float)(stats.tx_dropped - can_health.stats.tx_dropped) * per_second);
+	SignalPublishFloat(SIGNAL_CAN_TX_WAIT_MEAN,
+		sent ? (float)(stats.tx_wait_total - can_health.stats.tx_wait_total) / (float)sent : 0.0f);
+	SignalPublishFloat(SIGNAL_CAN_TX_WAIT_MAX, (float)wait_max);
+	SignalPublishUint(SIGNAL_CAN_TX_ERROR_COUNTER, stats.tx_error_counter);
+	SignalPublishUint(SIGNAL_CAN_RX_ERROR_COUNTER, stats.rx_error_counter);
+	SignalPublishUint(SIGNAL_CAN_BUS_OFF, stats.bus_off);
+	can_health.stats = stats;
+	can_health.sampled_at = now;
+
+	sys_timeout(CAN_HEALTH_PERIOD, CanHealthSample, arg);
+}
+
+void CanHealthStart()
+{
+	//what counted up during boot is not a rate, the first one starts here
+	CanBusGetStats(&can_health.stats);
+	CanBusTakeTxWaitMax();
+	can_health.sampled_at = sys_now();
+	sys_timeout(CAN_HEALTH_PERIOD, CanHealthSample, NULL);
+}
@@ -0,0 +1,49 @@
+/*
+ * CanHealth.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CANHEALTH_H_
+#define CANHEALTH_H_
+
+#include <stdint.h>
+
+//How loaded and how healthy CAN_0 is, as signals on the signal bus
+//(SignalBus.h), what NetHealth.h is for Ethernet.
+//
+//Every CAN_HEALTH_PERIOD a timeout in the tcpip thread reads the CAN
+//stats (CanBus.h) and publishes SIGNAL_CAN_*:
+//
+//	bus load			% of the period the frames received and sent kept
+//						the bus busy, from their lengths and the nominal and
+//						data bit rates. Stuff bits are not counted, so it
+//						reads up to about a fifth low, and the frames the
+//						acceptance filters reject are not seen at all: it is
+//						the load of the traffic the ECU takes part in, the
+//						whole bus once CanGateway.h forwards every id.
+//	rx, tx frames		per second
+//	errors				error counter increments per second, error frames
+//						the ECU saw or sent. The controller counts at most
+//						255 between two reads.
+//	rx overruns			frames a full RX FIFO lost, per second
+//	tx dropped			sends refused by a full TX FIFO, per second
+//	tx wait mean, max	us from CanBusSend to the frame starting on the
+//						bus, from the TX event FIFO's timestamps: the time
+//						behind other frames of the ECU and lost
+//						arbitrations. Over 65535 bit times reads short.
+//	error counters		transmit and receive, as read. 96 is the warning
+//						level, 128 error passive, the transmit one past 255
+//						bus off.
+//	bus off				since boot
+
+//ms between samples
+#ifndef CAN_HEALTH_PERIOD
+#define CAN_HEALTH_PERIOD 1000
+#endif
+
+//Takes the first sample and from then on. In the tcpip thread, after
+//CanBusInit.
+void CanHealthStart();
+
+#endif /* CANHEALTH_H_ */
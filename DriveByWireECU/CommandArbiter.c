@@ -0,0 +1,51 @@
+/*
+ * CommandArbiter.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "CommandArbiter.h"
+#include "TimeBase.h"
+
+void CommandArbiterInit(command_arbiter_t* arbiter)
+{
+	memset(arbiter, 0, sizeof(command_arbiter_t));
+}
+
+uint8_t CommandArbiterAccept(command_arbiter_t* arbiter, uint32_t address, uint16_t port,
+	const control_command_info_t* info, uint32_t now)
+{
+	command_commander_t* commander = &arbiter->commanders[info->priority];
+
+	if( commander->address != address || commander->port != port )
+	{
+		if( commander->synchronized && !TIME_REACHED(now, commander->lease_end) )
+		{
+			arbiter->rejected++;
+			return 0;
+		}
+
+		//the level is free, the new holder's count starts over
+		commander->address = address;
+		commander->port = port;
+		commander->synchronized = 0;
+	}
+
+	if( commander->synchronized )
+	{
+		int32_t ahead = (int32_t)(info->sequence - commander->sequence);
+		if( ahead <= 0 && ahead > -CONTROL_REORDER_WINDOW )
+		{
+			arbiter->reordered++;
+			return 0;
+		}
+		if( ahead > 1 )
+			arbiter->lost += ahead - 1;
+	}
+	commander->synchronized = 1;
+	commander->sequence = info->sequence;
+	commander->lease_end = now + info->lease;
+	arbiter->accepted++;
+	return 1;
+}
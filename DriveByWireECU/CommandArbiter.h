@@ -0,0 +1,51 @@
+/*
+ * CommandArbiter.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef COMMANDARBITER_H_
+#define COMMANDARBITER_H_
+
+#include <stdint.h>
+#include "ControlProtocol.h"
+
+//Decides which received commands get published, for the task running the
+//control channel. Every priority level is held by one commander, the address
+//and port it sends from. A level changes hands only once the lease of the
+//last command its holder sent has run out, so two commanders at the same
+//priority cannot fight over it, and a dead commander's level frees itself.
+//Sequence numbers are tracked per level, each commander counts on its own.
+//Which of the published levels the ECU obeys is up to SelectCommand.
+
+typedef struct command_commander_t
+{
+	//network order, like ip_addr_t
+	uint32_t address;
+	uint16_t port;
+	uint8_t synchronized;
+	uint32_t sequence;
+	uint32_t lease_end;
+} command_commander_t;
+
+typedef struct command_arbiter_t
+{
+	command_commander_t commanders[CONTROL_COMMAND_PRIORITY_COUNT];
+
+	uint32_t accepted;
+	//sequence numbers skipped between accepted commands of a commander
+	uint32_t lost;
+	//valid commands older than the newest one of their commander
+	uint32_t reordered;
+	//sent at a level somebody else holds
+	uint32_t rejected;
+} command_arbiter_t;
+
+void CommandArbiterInit(command_arbiter_t* arbiter);
+
+//Returns 1 if the command described by info, from address:port and received
+//at now, is to be published, after which its sender holds the level.
+uint8_t CommandArbiterAccept(command_arbiter_t* arbiter, uint32_t address, uint16_t port,
+	const control_command_info_t* info, uint32_t now);
+
+#endif /* COMMANDARBITER_H_ */
@@ -0,0 +1,147 @@
+/*
+ * CommandAuth.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "CommandAuth.h"
+
+#if COMMAND_AUTH_ENABLE
+
+#include <compiler.h>
+#include <hri_aes_e54.h>
+#include <hri_mclk_e54.h>
+#include "ControlProtocol.h"
+#include "EventLog.h"
+#include "Profiler.h"
+
+#define AES_BLOCK 16
+//boot count and the longest frame, whole blocks
+#define COMMAND_AUTH_MESSAGE_SIZE ((4 + CONTROL_TRAJECTORY_MAX_FRAME_SIZE + AES_BLOCK - 1) / AES_BLOCK * AES_BLOCK)
+
+static const uint8_t command_auth_key[AES_BLOCK] = { COMMAND_AUTH_KEY };
+
+static struct
+{
+	//RFC 4493 subkeys, K1 for a whole last block, K2 for a padded one
+	uint8_t k1[AES_BLOCK];
+	uint8_t k2[AES_BLOCK];
+	uint32_t boot_count;
+	uint8_t synchronized[CONTROL_COMMAND_PRIORITY_COUNT];
+	uint32_t sequence[CONTROL_COMMAND_PRIORITY_COUNT];
+} command_auth;
+
+//Encrypts block in place on the AES peripheral
+static void EncryptBlock(uint8_t* block)
+{
+	uint32_t words[AES_BLOCK / 4];
+
+	memcpy(words, block, AES_BLOCK);
+	hri_aes_write_DATABUFPTR_reg(AES, 0);
+	for(int i = 0; i < AES_BLOCK / 4; ++i)
+		hri_aes_write_INDATA_reg(AES, words[i]);
+	hri_aes_set_CTRLB_START_bit(AES);
+	while( !hri_aes_get_INTFLAG_ENCCMP_bit(AES) )
+		;
+	//reading the result back clears ENCCMP
+	hri_aes_write_DATABUFPTR_reg(AES, 0);
+	for(int i = 0; i < AES_BLOCK / 4; ++i)
+		words[i] = hri_aes_read_INDATA_reg(AES);
+	memcpy(block, words, AES_BLOCK);
+}
+
+//Doubling in GF(2^128), RFC 4493 2.3
+static void Double(uint8_t* out, const uint8_t* in)
+{
+	uint8_t carry = in[0] & 0x80;
+	for(int i = 0; i < AES_BLOCK - 1; ++i)
+		out[i] = (uint8_t)((in[i] << 1) | (in[i + 1] >> 7));
+	out[AES_BLOCK - 1] = (uint8_t)(in[AES_BLOCK - 1] << 1);
+	if( carry )
+		out[AES_BLOCK - 1] ^= 0x87;
+}
+
+void CommandAuthInit()
+{
+	hri_mclk_set_APBCMASK_AES_bit(MCLK);
+	hri_aes_set_CTRLA_SWRST_bit(AES);
+	//ECB encryption, each block started by software
+	hri_aes_write_CTRLA_reg(AES, AES_CTRLA_AESMODE_ECB | AES_CTRLA_KEYSIZE_128BIT | AES_CTRLA_CIPHER_ENC |
+		AES_CTRLA_STARTMODE_MANUAL);
+	hri_aes_set_CTRLA_ENABLE_bit(AES);
+	for(int i = 0; i < AES_BLOCK / 4; ++i)
+	{
+		uint32_t word;
+		memcpy(&word, &command_auth_key[i * 4], sizeof(word));
+		hri_aes_write_KEYWORD_reg(AES, i, word);
+	}
+
+	uint8_t l[AES_BLOCK] = { 0 };
+	EncryptBlock(l);
+	Double(command_auth.k1, l);
+	Double(command_auth.k2, command_auth.k1);
+	//a tag of this run never verifies in the next
+	command_auth.boot_count = EventLogBootCount();
+}
+
+uint8_t CommandAuthVerify(const uint8_t* frame, uint16_t payload_length)
+{
+	uint32_t profile_start = ProfilerStart();
+	uint8_t message[COMMAND_AUTH_MESSAGE_SIZE];
+	uint8_t x[AES_BLOCK] = { 0 };
+
+	if( payload_length < COMMAND_AUTH_TAG_SIZE )
+		return 0;
+	uint32_t length = CONTROL_HEADER_SIZE + payload_length - COMMAND_AUTH_TAG_SIZE;
+	if( 4 + length > sizeof(message) )
+		return 0;
+	message[0] = (uint8_t)command_auth.boot_count;
+	message[1] = (uint8_t)(command_auth.boot_count >> 8);
+	message[2] = (uint8_t)(command_auth.boot_count >> 16);
+	message[3] = (uint8_t)(command_auth.boot_count >> 24);
+	memcpy(&message[4], frame, length);
+	length += 4;
+
+	//every block but the last is chained as it is
+	uint32_t last = (length - 1) / AES_BLOCK * AES_BLOCK;
+	for(uint32_t offset = 0; offset < last; offset += AES_BLOCK)
+	{
+		for(int i = 0; i < AES_BLOCK; ++i)
+			x[i] ^= message[offset + i];
+		EncryptBlock(x);
+	}
+	uint32_t tail = length - last;
+	const uint8_t* subkey = tail == AES_BLOCK ? command_auth.k1 : command_auth.k2;
+	for(uint32_t i = 0; i < AES_BLOCK; ++i)
+	{
+		uint8_t byte = i < tail ? message[last + i] : (i == tail ? 0x80 : 0);
+		x[i] ^= byte ^ subkey[i];
+	}
+	EncryptBlock(x);
+
+	//every byte compared, the time gives away nothing about a near miss
+	const uint8_t* tag = &frame[CONTROL_HEADER_SIZE + payload_length - COMMAND_AUTH_TAG_SIZE];
+	uint8_t difference = 0;
+	for(int i = 0; i < COMMAND_AUTH_TAG_SIZE; ++i)
+		difference |= x[i] ^ tag[i];
+	ProfilerEnd(PROFILER_STAGE_COMMAND_AUTH, profile_start);
+	return difference == 0;
+}
+
+uint8_t CommandAuthFresh(uint8_t priority, uint32_t sequence)
+{
+	if( command_auth.synchronized[priority] && (int32_t)(sequence - command_auth.sequence[priority]) <= 0 )
+		return 0;
+	command_auth.synchronized[priority] = 1;
+	command_auth.sequence[priority] = sequence;
+	return 1;
+}
+
+#else
+
+void CommandAuthInit()
+{
+}
+
+#endif
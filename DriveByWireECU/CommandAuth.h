@@ -0,0 +1,64 @@
+/*
+ * CommandAuth.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef COMMANDAUTH_H_
+#define COMMANDAUTH_H_
+
+#include <stdint.h>
+
+//Authenticated command and trajectory frames, so only a PC holding the key
+//can steer the cart, whoever else is on the vehicle network.
+//
+//Every command and trajectory frame then ends its payload with a tag of
+//COMMAND_AUTH_TAG_SIZE bytes, counted in the payload length, ahead of the
+//CRC. The tag is the AES-128-CMAC (RFC 4493) under COMMAND_AUTH_KEY of
+//
+//	0		4		boot count of the ECU, as in its announce frame
+//	4		n		the frame from its version byte up to the tag
+//
+//truncated to its first COMMAND_AUTH_TAG_SIZE bytes. The boot count ties a
+//frame to one run of the ECU, a frame recorded before a reset never
+//verifies after it. Within a run a priority level only takes sequence
+//numbers past the last one it authenticated, whoever holds the level, so a
+//recorded frame never verifies twice either. A commander that starts over
+//picks its first sequence number above its last, from its clock for one.
+//
+//The AES peripheral does the cipher, a block in about 60 core cycles. A
+//command is two blocks plus the key's subkey derived once at boot, and a
+//full trajectory a few more, the whole check is a few hundred cycles at
+//most. PROFILER_STAGE_COMMAND_AUTH measures every one.
+//
+//Frames without a tag, or with a wrong one, count in rx_unauthenticated of
+//the control channel and are dropped like a bad CRC. Requests and
+//subscriptions stay unauthenticated, none of them moves the cart.
+
+#ifndef COMMAND_AUTH_ENABLE
+#define COMMAND_AUTH_ENABLE 0
+#endif
+
+//The 16 byte key, as comma separated bytes. Builds with COMMAND_AUTH_ENABLE
+//have to give it, there is no default.
+//#define COMMAND_AUTH_KEY 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+#define COMMAND_AUTH_TAG_SIZE 8
+
+#if COMMAND_AUTH_ENABLE && !defined(COMMAND_AUTH_KEY)
+#error COMMAND_AUTH_ENABLE needs COMMAND_AUTH_KEY
+#endif
+
+//Keys the AES peripheral and derives the subkeys. Once at boot, after
+//EventLogInit.
+void CommandAuthInit();
+
+//Returns 1 if the tag at the end of the payload_length bytes of payload of
+//frame is right. From the control channel only, with the core lock held.
+uint8_t CommandAuthVerify(const uint8_t* frame, uint16_t payload_length);
+
+//Returns 1 and takes sequence as the newest of priority if it is past the
+//last one taken for it, 0 for a replay. After CommandAuthVerify passed.
+uint8_t CommandAuthFresh(uint8_t priority, uint32_t sequence);
+
+#endif /* COMMANDAUTH_H_ */
@@ -0,0 +1,77 @@
+/*
+ * CommandHold.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "CommandHold.h"
+#include "FastCode.h"
+
+void CommandHoldInit(command_hold_t* hold, command_hold_mode_t mode, float min, float max, float safe_value,
+	float ramp_rate, uint32_t horizon, uint32_t late_after)
+{
+	hold->mode = mode;
+	hold->min = min;
+	hold->max = max;
+	hold->safe_value = safe_value;
+	hold->ramp_step = ramp_rate / 1000.0f;
+	hold->horizon = horizon;
+	hold->late_after = late_after;
+	hold->last_step = 0;
+	CommandHoldReset(hold, safe_value);
+}
+
+void CommandHoldReset(command_hold_t* hold, float value)
+{
+	hold->value = value;
+	hold->sent = 0;
+	hold->received = 0;
+	hold->slope = 0.0f;
+	hold->have_command = 0;
+	hold->output = value;
+}
+
+FAST_CODE void CommandHoldUpdate(command_hold_t* hold, float value, uint32_t sent, uint32_t now, uint8_t continuous)
+{
+	//a trend needs two commands in order and close enough to belong together
+	int32_t interval = (int32_t)(sent - hold->sent);
+	if( continuous && hold->have_command && interval > 0 && (uint32_t)interval <= hold->horizon )
+		hold->slope = (value - hold->value) / (float)interval;
+	else
+		hold->slope = 0.0f;
+
+	hold->value = value;
+	hold->sent = sent;
+	hold->received = now;
+	hold->have_command = 1;
+}
+
+FAST_CODE float CommandHoldStep(command_hold_t* hold, uint32_t now)
+{
+	uint32_t age = now - hold->received;
+	float output = hold->value;
+	if( !hold->have_command )
+		output = hold->output;
+	else if( hold->mode == COMMAND_HOLD_EXTRAPOLATE )
+		output = hold->value + hold->slope * (float)(age < hold->horizon ? age : hold->horizon);
+	else if( hold->mode == COMMAND_HOLD_RAMP && age >= hold->late_after )
+	{
+		//from wherever the setpoint was when the command went late
+		float step = hold->ramp_step * (float)(now - hold->last_step);
+		float error = hold->safe_value - hold->output;
+		if( error > step )
+			output = hold->output + step;
+		else if( error < -step )
+			output = hold->output - step;
+		else
+			output = hold->safe_value;
+	}
+
+	if( output < hold->min )
+		output = hold->min;
+	else if( output > hold->max )
+		output = hold->max;
+	hold->output = output;
+	hold->last_step = now;
+	return output;
+}
@@ -0,0 +1,74 @@
+/*
+ * CommandHold.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef COMMANDHOLD_H_
+#define COMMANDHOLD_H_
+
+#include <stdint.h>
+
+//What a setpoint does between the commands that set it, and once they
+//are late.
+//
+//	COMMAND_HOLD_LAST			keeps the last commanded value
+//	COMMAND_HOLD_EXTRAPOLATE	carries on along the line through the last
+//								two commands, by their sender timestamps,
+//								for at most horizon ms and holds from there
+//	COMMAND_HOLD_RAMP			keeps the last value until the command is
+//								late, then moves to safe_value at ramp_rate
+//
+//A command is late after late_after ms without a new one. The comm
+//timeouts still end autonomous mode and tele operation as before, the hold
+//only decides what the setpoint does until they do. Extrapolating lets
+//the driving agent command at a lower rate without the setpoint stepping
+//at every command. A step is O(1), a few compares and one multiply.
+
+typedef enum command_hold_mode_t
+{
+	COMMAND_HOLD_LAST = 0,
+	COMMAND_HOLD_EXTRAPOLATE,
+	COMMAND_HOLD_RAMP,
+} command_hold_mode_t;
+
+typedef struct command_hold_t
+{
+	command_hold_mode_t mode;
+	float min;
+	float max;
+	float safe_value;
+	//units per ms
+	float ramp_step;
+	uint32_t horizon;
+	uint32_t late_after;
+
+	//the last command, its sender timestamp and the local ms it came in at
+	float value;
+	uint32_t sent;
+	uint32_t received;
+	//units per sender ms from the command before, 0 without one
+	float slope;
+	uint8_t have_command;
+	//what the last step gave, where a ramp starts from
+	float output;
+	uint32_t last_step;
+} command_hold_t;
+
+//Values are kept to min .. max. ramp_rate in units/s, horizon and
+//late_after in ms. Starts at safe_value with no command.
+void CommandHoldInit(command_hold_t* hold, command_hold_mode_t mode, float min, float max, float safe_value,
+	float ramp_rate, uint32_t horizon, uint32_t late_after);
+
+//A new command, sent at the sender's timestamp and received at now. The
+//slope is only taken between two commands of the same sender, continuous
+//is 0 when the command came from another one.
+void CommandHoldUpdate(command_hold_t* hold, float value, uint32_t sent, uint32_t now, uint8_t continuous);
+
+//Forgets the commands and goes to value, nothing to extrapolate from
+void CommandHoldReset(command_hold_t* hold, float value);
+
+//The setpoint at now, ms
+float CommandHoldStep(command_hold_t* hold, uint32_t now);
+
+#endif /* COMMANDHOLD_H_ */
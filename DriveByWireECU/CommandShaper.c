@@ -0,0 +1,79 @@
+/*
+ * CommandShaper.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <float.h>
+#include <math.h>
+#include "CommandShaper.h"
+#include "FastCode.h"
+
+void CommandShaperInit(command_shaper_t* shaper, float max_rate, float max_accel, float dt)
+{
+	shaper->dt = dt;
+	CommandShaperSetLimits(shaper, max_rate, max_accel);
+	CommandShaperReset(shaper, 0.0f);
+}
+
+void CommandShaperSetLimits(command_shaper_t* shaper, float max_rate, float max_accel)
+{
+	shaper->max_rate = max_rate > 0.0f ? max_rate : FLT_MAX;
+	shaper->rate_step = max_accel > 0.0f ? max_accel * shaper->dt : 0.0f;
+	shaper->stop_scale = max_accel > 0.0f ? 2.0f / (max_accel * shaper->dt * shaper->dt) : 0.0f;
+}
+
+FAST_CODE void CommandShaperSetRate(command_shaper_t* shaper, float max_rate)
+{
+	shaper->max_rate = max_rate > 0.0f ? max_rate : FLT_MAX;
+}
+
+void CommandShaperReset(command_shaper_t* shaper, float value)
+{
+	shaper->value = value;
+	shaper->rate = 0.0f;
+}
+
+FAST_CODE float CommandShaperStep(command_shaper_t* shaper, float target)
+{
+	float error = target - shaper->value;
+	float distance = fabsf(error);
+
+	float speed = shaper->max_rate;
+	float rate = shaper->rate;
+	if( shaper->rate_step > 0.0f )
+	{
+		//Fastest rate toward the target that can still stop on it. Slowing
+		//down from n rate steps covers n(n + 1) / 2 times rate_step * dt.
+		float stopping = shaper->rate_step * (sqrtf(0.25f + distance * shaper->stop_scale) - 0.5f);
+		if( stopping < speed )
+			speed = stopping;
+		float desired = error < 0.0f ? -speed : speed;
+
+		if( desired > rate + shaper->rate_step )
+			rate += shaper->rate_step;
+		else if( desired < rate - shaper->rate_step )
+			rate -= shaper->rate_step;
+		else
+			rate = desired;
+	}
+	else
+	{
+		rate = error < 0.0f ? -speed : speed;
+	}
+
+	//Lands on the target once the step reaches it and the rate is low enough
+	//to stop in one step, otherwise overshoots and comes back.
+	float move = rate * shaper->dt;
+	if( fabsf(move) >= distance && (shaper->rate_step <= 0.0f || fabsf(rate) <= shaper->rate_step) )
+	{
+		shaper->value = target;
+		shaper->rate = 0.0f;
+	}
+	else
+	{
+		shaper->value += move;
+		shaper->rate = rate;
+	}
+	return shaper->value;
+}
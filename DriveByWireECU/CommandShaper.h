@@ -0,0 +1,51 @@
+/*
+ * CommandShaper.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef COMMANDSHAPER_H_
+#define COMMANDSHAPER_H_
+
+#include <stdint.h>
+
+//Shapes a stepped command into a smooth one for the control loops.
+//The shaped value moves toward the target no faster than max_rate (the slew
+//limit) and its rate changes by no more than max_accel per second (the jerk
+//limit, for a speed command the rate is the acceleration). It slows down
+//ahead of the target so as to arrive without overshooting.
+//
+//Everything that depends on the limits and the cycle time is worked out at
+//init, a step is a few multiplies and one FPU square root, no division.
+
+typedef struct command_shaper_t
+{
+	float value;
+	//units/s the value moved by in the last step
+	float rate;
+
+	float dt;
+	float max_rate;
+	//max_accel * dt, 0 without a jerk limit
+	float rate_step;
+	//2 / (max_accel * dt^2), for the rate that can still stop at the target
+	float stop_scale;
+} command_shaper_t;
+
+//dt in s. A max_rate or max_accel of 0 leaves that limit off. Starts at 0.
+void CommandShaperInit(command_shaper_t* shaper, float max_rate, float max_accel, float dt);
+
+//Changes the limits and keeps value and rate
+void CommandShaperSetLimits(command_shaper_t* shaper, float max_rate, float max_accel);
+
+//Changes only the slew limit, no division, cheap enough for every cycle. A
+//rate above the new limit comes down at the jerk limit.
+void CommandShaperSetRate(command_shaper_t* shaper, float max_rate);
+
+//Jumps to value at rest
+void CommandShaperReset(command_shaper_t* shaper, float value);
+
+//One cycle toward target, returns the shaped value
+float CommandShaperStep(command_shaper_t* shaper, float target);
+
+#endif /* COMMANDSHAPER_H_ */
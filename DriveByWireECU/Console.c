@@ -0,0 +1,263 @@
+/*
+ * Console.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <hri_sercom_e54.h>
+#include "Console.h"
+#include "driver_init.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Service.h"
+#include "Log.h"
+#include "SignalBus.h"
+#include "ParamStore.h"
+#include "EthernetIO.h"
+#include "CanBus.h"
+#include "PhyMonitor.h"
+#include "HeapMonitor.h"
+#include "LockProfiler.h"
+#include "TaskMonitor.h"
+
+#if CONSOLE_ENABLE
+
+#define CONSOLE_RX_MASK (CONSOLE_RX_RING - 1)
+//Most words of a command
+#define CONSOLE_MAX_WORDS 3
+
+#if (CONSOLE_RX_RING & CONSOLE_RX_MASK) != 0
+#error CONSOLE_RX_RING must be a power of two
+#endif
+
+static struct
+{
+	uint8_t ring[CONSOLE_RX_RING];
+	//advanced by the interrupt only
+	uint32_t head;
+	//advanced by the service only
+	uint32_t tail;
+	//bytes lost to a full ring, and framing errors and hardware overruns
+	uint32_t dropped;
+	uint32_t errors;
+	char line[CONSOLE_LINE_SIZE + 1];
+	uint8_t length;
+	//the line grew too long, dropped up to its end
+	uint8_t overlong;
+	service_t service;
+} console;
+
+//Static, the task names are logged with %s and have to outlive the command
+static task_monitor_snapshot_t console_tasks;
+
+//RX complete
+void SERCOM2_2_Handler()
+{
+	void* hw = TARGET_IO.device.hw;
+	uint8_t status = hri_sercomusart_read_STATUS_reg(hw);
+	//the data read clears the interrupt
+	uint8_t byte = hri_sercomusart_read_DATA_reg(hw);
+
+	if( status & (SERCOM_USART_STATUS_FERR | SERCOM_USART_STATUS_BUFOVF) )
+	{
+		hri_sercomusart_clear_STATUS_reg(hw, SERCOM_USART_STATUS_FERR | SERCOM_USART_STATUS_BUFOVF);
+		++console.errors;
+	}
+	uint32_t head = console.head;
+	if( head - __atomic_load_n(&console.tail, __ATOMIC_ACQUIRE) >= CONSOLE_RX_RING )
+	{
+		++console.dropped;
+		return;
+	}
+	console.ring[head & CONSOLE_RX_MASK] = byte;
+	__atomic_store_n(&console.head, head + 1, __ATOMIC_RELEASE);
+	if( byte == '\r' || byte == '\n' )
+		ServiceSignalFromIsr(&console.service);
+}
+
+//Floats do not survive LOG, so the value goes as its integer part and
+//thousandths
+static void LogSignal(const signal_info_t* info, signal_value_t value)
+{
+	if( info->type == SIGNAL_TYPE_UINT )
+	{
+		LOG("%s = %lu", info->name, value.u);
+		return;
+	}
+	float magnitude = value.f < 0.0f ? -value.f : value.f;
+	uint32_t milli = (uint32_t)(magnitude * 1000.0f + 0.5f);
+	LOG("%s = %s%lu.%03lu %s", info->name, value.f < 0.0f ? "-" : "", milli / 1000, milli % 1000, info->unit);
+}
+
+static void Help()
+{
+	LOG("commands: help, stats, tasks, get <signal>, set <param id> <value>, trace");
+}
+
+static void Stats()
+{
+	can_bus_stats_t can;
+	phy_monitor_stats_t phy;
+
+	CanBusGetStats(&can);
+	LOG("can: %lu unmatched, %lu overruns, %lu tx dropped, %lu error passive, %lu bus off", can.rx_unmatched,
+		can.rx_overrun, can.tx_dropped, can.error_passive, can.bus_off);
+	LOG("can: %lu received, %lu sent, tx wait max %lu us, %lu errors, tec %u rec %u", can.rx_frames, can.tx_frames,
+		can.tx_wait_max, can.errors, can.tx_error_counter, can.rx_error_counter);
+	PhyMonitorRead(&phy);
+	LOG("phy: %s %lu Mbit/s, %lu drops, last outage %lu ms", phy.up ? "up" : "down", phy.speed, phy.drops,
+		phy.last_outage);
+	LOG("log: %lu dropped, console: %lu dropped, %lu errors", LogDropped(), console.dropped, console.errors);
+	HeapMonitorReport();
+	LockProfilerReport();
+}
+
+static void Tasks()
+{
+	TaskMonitorRead(&console_tasks);
+	LOG("tasks over %lu ms, interrupt stack %lu words free", console_tasks.period, console_tasks.interrupt_stack_free);
+	for(uint8_t i = 0; i < console_tasks.count; ++i)
+	{
+		const task_monitor_entry_t* task = &console_tasks.tasks[i];
+		LOG("  %s priority %lu, load %lu/1000, %lu words free", task->name, task->priority, task->load, task->stack_free);
+	}
+}
+
+static void Get(const char* name)
+{
+	for(uint8_t id = 0; id < SIGNAL_COUNT; ++id)
+	{
+		const signal_info_t* info = SignalInfo(id);
+		if( strcmp(info->name, name) == 0 )
+		{
+			signal_value_t value;
+			SignalRead(id, &value);
+			LogSignal(info, value);
+			return;
+		}
+	}
+	LOG("no signal %s", name);
+}
+
+static void Set(const char* id_text, const char* value_text)
+{
+	char* end;
+	uint32_t id = strtoul(id_text, &end, 0);
+	const param_info_t* info = *end == '\0' && id < PARAM_COUNT ? ParamInfo(id) : NULL;
+	param_value_t value;
+
+	if( info == NULL )
+	{
+		LOG("no param %lu", id);
+		return;
+	}
+	if( info->type == PARAM_TYPE_FLOAT )
+		value.f = strtof(value_text, &end);
+	else
+		value.u = strtoul(value_text, &end, 0);
+	if( end == value_text || *end != '\0' || EthernetSetParam(id, value) != 0 )
+	{
+		LOG("param %lu rejected", id);
+		return;
+	}
+	LOG("param %lu set", id);
+}
+
+static void Execute(char* line)
+{
+	char* words[CONSOLE_MAX_WORDS];
+	uint8_t count = 0;
+
+	for(char* word = strtok(line, " \t"); word != NULL; word = strtok(NULL, " \t"))
+	{
+		if( count == CONSOLE_MAX_WORDS )
+		{
+			Help();
+			return;
+		}
+		words[count++] = word;
+	}
+	if( count == 0 )
+		return;
+
+	if( strcmp(words[0], "stats") == 0 && count == 1 )
+		Stats();
+	else if( strcmp(words[0], "tasks") == 0 && count == 1 )
+		Tasks();
+	else if( strcmp(words[0], "get") == 0 && count == 2 )
+		Get(words[1]);
+	else if( strcmp(words[0], "set") == 0 && count == 3 )
+		Set(words[1], words[2]);
+	else if( strcmp(words[0], "trace") == 0 && count == 1 )
+	{
+		if( EthernetTriggerTrace() )
+			LOG("trace triggered");
+		else
+			LOG("trace unavailable");
+	}
+	else
+		Help();
+}
+
+//Takes what the interrupt received and runs every line completed
+static void Drain()
+{
+	uint32_t head = __atomic_load_n(&console.head, __ATOMIC_ACQUIRE);
+	uint32_t tail = console.tail;
+
+	while( tail != head )
+	{
+		char byte = console.ring[tail++ & CONSOLE_RX_MASK];
+		if( byte == '\r' || byte == '\n' )
+		{
+			if( !console.overlong )
+			{
+				console.line[console.length] = '\0';
+				Execute(console.line);
+			}
+			console.length = 0;
+			console.overlong = 0;
+		}
+		else if( byte == '\b' || byte == 0x7F )
+		{
+			if( console.length > 0 )
+				--console.length;
+		}
+		else if( console.length < CONSOLE_LINE_SIZE )
+			console.line[console.length++] = byte;
+		else
+			console.overlong = 1;
+	}
+	//hands the bytes back to the interrupt
+	__atomic_store_n(&console.tail, tail, __ATOMIC_RELEASE);
+}
+
+static service_result_t ConsoleService(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	while(1)
+	{
+		SERVICE_WAIT_SIGNAL(service, CONSOLE_POLL_PERIOD);
+		Drain();
+	}
+	SERVICE_END(service);
+}
+
+void ConsoleStart()
+{
+	ServiceAdd(&console.service, "Console", ConsoleService);
+	hri_sercomusart_set_INTEN_RXC_bit(TARGET_IO.device.hw);
+	NVIC_SetPriority(SERCOM2_2_IRQn, IRQ_PRIORITY_CONSOLE);
+	NVIC_ClearPendingIRQ(SERCOM2_2_IRQn);
+	NVIC_EnableIRQ(SERCOM2_2_IRQn);
+}
+
+#else
+
+void ConsoleStart()
+{
+}
+
+#endif
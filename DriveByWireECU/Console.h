@@ -0,0 +1,63 @@
+/*
+ * Console.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdint.h>
+
+//Command shell on TARGET_IO (SERCOM2, the EDBG virtual COM port), for the
+//bench. Lines typed at a terminal are answered through the log (Log.h),
+//so nothing on either side of the UART waits on it:
+//
+//	receive		the RX complete interrupt moves every byte into a ring of
+//				CONSOLE_RX_RING bytes and signals the console service at
+//				the end of a line
+//	transmit	answers are LOG lines, the log service sends them with DMA
+//				between the other records
+//
+//The usart_sync driver of Atmel START only sets the SERCOM up, after boot
+//no task reads or writes it. printf stays synchronous and is only for
+//boot, as before.
+//
+//The console is a service (Service.h) at the service task's low priority,
+//a command costs no real-time task anything but the core lock a set or
+//trace command takes for a moment. Commands, one per line, words separated
+//by spaces:
+//
+//	help				the commands
+//	stats				CAN, PHY and log counters, the heap
+//	tasks				load and free stack of every task (TaskMonitor.h)
+//	get <signal>		a signal by its name (SignalBus.h)
+//	set <id> <value>	a parameter by its id (ParamStore.h), as a param
+//						set request of one entry would (EthernetIO.h), a
+//						float parameter takes a float
+//	trace				triggers the PID trace (PIDTrace.h)
+//
+//Nothing is echoed, set the terminal to local echo. Backspace works on the
+//line in the ring. Lines longer than CONSOLE_LINE_SIZE are dropped.
+
+#ifndef CONSOLE_ENABLE
+#define CONSOLE_ENABLE 1
+#endif
+
+//Bytes received and not yet taken by the service, a power of two. At
+//460800 baud it fills in 2.8 ms, far longer than a line takes to type.
+#ifndef CONSOLE_RX_RING
+#define CONSOLE_RX_RING 128
+#endif
+
+//Longest line, the line ending aside
+#define CONSOLE_LINE_SIZE 64
+
+//ms between looks at the ring when no line end signalled the service
+#define CONSOLE_POLL_PERIOD 100
+
+//Enables the RX interrupt and adds the console service. Before the
+//scheduler starts, after atmel_start_init.
+void ConsoleStart();
+
+#endif /* CONSOLE_H_ */
@@ -0,0 +1,896 @@
+/*
+ * ControlCore.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "ControlCore.h"
+#include "DriveByWireIO.h"
+#include "PID.h"
+#include "Profiler.h"
+#include "FastCode.h"
+#include "EventLog.h"
+#include "SteeringRateLoop.h"
+#include "RamEcc.h"
+#include "VehicleMode.h"
+#include "NetLatency.h"
+#include "LatencyProbe.h"
+#include "CommandHold.h"
+#include "TrajectoryBuffer.h"
+#include "Odometry.h"
+#include "SignalBus.h"
+#include "ControlRecord.h"
+#include "SteeringSweep.h"
+#include "Excitation.h"
+#include "PIDAutotune.h"
+#include "ShadowController.h"
+#include "ActuatorFault.h"
+#include "SteeringLimits.h"
+#include "TractionControl.h"
+#include "SteeringCompensation.h"
+
+//Front brake commands, shares of the full brake pressure (BRAKE_PRESSURE_LOOP)
+#define PARKING_BRAKE_PRESSURE 0.25f
+//m/s^2 a stop brakes at once the speed loop asks to slow down
+#define COME_TO_STOP_DECELERATION 2.0f
+//share of the full pressure per m/s^2, the host plant brakes 4 m/s^2 at full
+#define BRAKE_PRESSURE_PER_DECELERATION 0.25f
+
+#define MAX_STEERING_ANGLE 50.0f
+#define MIN_STEERING_ANGLE -50.0f
+
+#define MAX_VEHICLE_SPEED 12.0f
+#define MIN_VEHICLE_SPEED -1.0f
+
+//m, front to rear axle, for the odometry
+#ifndef ODOMETRY_WHEELBASE
+#define ODOMETRY_WHEELBASE 1.65f
+#endif
+
+#define MAX_STEERING_DUTY_CYCLE 1.0f
+#define MAX_ACCEL_DUTY_CYCLE 1.0f
+#define MIN_ACCEL_DUTY_CYCLE -0.25f
+
+//duty cycle (0.0 - 1.0) / degrees
+#define STEERING_P_GAIN (1.0f / 30.0f) //100% duty cycle at angles greater than 60 deg
+//duty cycle / degrees
+#define STEERING_I_GAIN (0.05f / (1 * 1000)) //5% duty cycle for every second we are 1 deg off.
+#define STEERING_D_GAIN 0.0f
+
+//With STEERING_RATE_LOOP the position loop commands a rate instead.
+//deg/s / degrees, the rate loop follows within a few ms so the gain can be
+//several times what the torque loop above gets from the motor. The host
+//plant settles a 1 deg step in 125 ms with this, 305 ms at best without the
+//rate loop.
+#define STEERING_POSITION_P_GAIN 20.0f
+#define STEERING_POSITION_I_GAIN 0.0f
+#define STEERING_POSITION_D_GAIN 0.0f
+//deg/s, about what the motor manages at full torque
+#define MAX_STEERING_RATE 60.0f
+
+//duty cycle (0.0 - 1.0) / m/s
+#define SPEED_P_GAIN (1.0f / 1.0f) //100% duty cycle at speed errors > 2.2 MPH
+#define SPEED_I_GAIN (0.05f / (0.1f * 1000)) //5% duty cycle for every second we are .2 MPH off of our target.
+#define SPEED_D_GAIN 0.0f
+
+//Speed loop gains by measured speed, every SPEED_SCHEDULE_SPACING m/s from
+//0, and the throttle that holds each speed as the feedforward by commanded
+//speed. More P at low speed to get going, less at speed where the same
+//throttle change accelerates harder. The feedforward follows the host plant
+//model (6 m/s at full throttle) until it is fitted to recorded telemetry.
+#define SPEED_SCHEDULE_SPACING 2.0f
+static const gain_schedule_point_t speed_schedule_points[] =
+{
+	//p	i	d	feedforward
+	{ 1.0f,	SPEED_I_GAIN,	0.0f,	0.0f },
+	{ 0.9f,	SPEED_I_GAIN,	0.0f,	0.33f },
+	{ 0.8f,	SPEED_I_GAIN,	0.0f,	0.67f },
+	{ 0.7f,	SPEED_I_GAIN * 0.8f,	0.0f,	1.0f },
+	{ 0.6f,	SPEED_I_GAIN * 0.8f,	0.0f,	1.0f },
+	{ 0.55f,	SPEED_I_GAIN * 0.6f,	0.0f,	1.0f },
+	{ 0.5f,	SPEED_I_GAIN * 0.6f,	0.0f,	1.0f },
+};
+
+//Autonomous steering limits by measured speed, every STEERING_LIMIT_SPACING
+//m/s from 0 (SteeringLimits.h). The angle keeps the lateral acceleration
+//of a steady turn under 3 m/s^2 and the rate its change under 10 m/s^3,
+//over the wheelbase, interpolated they stay within about a degree of that. Both
+//end at the fixed limits at walking pace.
+#define STEERING_LIMIT_SPACING 1.0f
+static const steering_limit_point_t steering_limit_points[] =
+{
+	//deg	deg/s
+	{ 50.0f,	60.0f },
+	{ 50.0f,	60.0f },
+	{ 50.0f,	60.0f },
+	{ 28.8f,	60.0f },
+	{ 17.2f,	59.1f },
+	{ 11.2f,	37.8f },
+	{ 7.8f,	26.3f },
+	{ 5.8f,	19.3f },
+	{ 4.4f,	14.8f },
+	{ 3.5f,	11.7f },
+	{ 2.8f,	9.5f },
+	{ 2.3f,	7.8f },
+	{ 2.0f,	6.6f },
+};
+
+//duty cycle (0.0 - 1.0) / share of the full brake pressure. The feedforward
+//is the duty cycle the open loop brake used for the same share, the loop
+//only makes up the difference.
+#define BRAKE_FEEDFORWARD_GAIN 1.0f
+#define BRAKE_P_GAIN 1.0f
+#define BRAKE_I_GAIN (1.0f / (0.1f * 1000)) //the whole error in 100 ms
+#define BRAKE_D_GAIN 0.0f
+#define MAX_BRAKE_DUTY_CYCLE 1.0f
+
+//share of the output beyond its bounds wound back out of the integral every cycle
+#define PID_ANTI_WINDUP_GAIN 1.0f
+//weight of the last derivative in the derivative filter, about a 10 ms time constant
+#define PID_DERIVATIVE_FILTER 0.9f
+
+//Command shaping, slew limit per s and jerk limit per s^2 of each command.
+//Autonomous commands are degrees and m/s, the speed limits are the cart's
+//acceleration and jerk.
+#define STEERING_SLEW_LIMIT 60.0f
+#define STEERING_JERK_LIMIT 600.0f
+#define SPEED_SLEW_LIMIT 2.0f
+#define SPEED_JERK_LIMIT 4.0f
+//Tele operation commands are torque and throttle duty cycles (0.0 - 1.0)
+#define TELEOP_STEERING_SLEW_LIMIT 5.0f
+#define TELEOP_STEERING_JERK_LIMIT 50.0f
+#define TELEOP_SPEED_SLEW_LIMIT 1.0f
+#define TELEOP_SPEED_JERK_LIMIT 5.0f
+
+//What each setpoint does between commands and once they are late
+//(CommandHold.h). Extrapolation runs at most COMMAND_HOLD_HORIZON ms past
+//the last command, a ramp starts COMMAND_HOLD_LATE ms after it and goes
+//at the rate per s toward a stop and straight ahead.
+#ifndef SPEED_HOLD_MODE
+#define SPEED_HOLD_MODE COMMAND_HOLD_LAST
+#endif
+#ifndef STEERING_HOLD_MODE
+#define STEERING_HOLD_MODE COMMAND_HOLD_LAST
+#endif
+#define COMMAND_HOLD_HORIZON 100
+#define COMMAND_HOLD_LATE 50
+#define SPEED_HOLD_RAMP_RATE 1.0f
+#define STEERING_HOLD_RAMP_RATE 0.5f
+
+//ms without an event before each deadline expires
+#define COMM_TIMEOUT 250
+#define TELEOP_TIMEOUT 100
+#define WHEEL_SPEED_TIMEOUT 50
+#define EPS_FEEDBACK_TIMEOUT 50
+
+FAST_CODE int ConvertAngleToPIDInt(float angle)
+{
+	return (int)(angle * 1000.0f);
+}
+FAST_CODE int ConvertSpeedToPIDInt(float speed)
+{
+	return (int)(speed * 1000.0f);
+}
+FAST_CODE float ConvertPIDIntToDutyCycle(int PID_int)
+{
+	return ((float)PID_int) / 1000.0f;
+}
+FAST_CODE int ConvertDutyCycleToPIDInt(float duty_cycle)
+{
+	return (int)(duty_cycle * 1000.0f);
+}
+FAST_CODE float ConvertPIDIntToRate(int PID_int)
+{
+	return ((float)PID_int) / 1000.0f;
+}
+int ConvertRateToPIDInt(float rate)
+{
+	return (int)(rate * 1000.0f);
+}
+
+//The speed gains come from the schedule every cycle, the steering gains
+//only change with the override
+static void SetDefaultSteeringGains(main_context_t* ctx)
+{
+#if STEERING_RATE_LOOP
+	ctx->steering_controller.p = PID_GAIN(STEERING_POSITION_P_GAIN);
+	ctx->steering_controller.i = PID_GAIN(STEERING_POSITION_I_GAIN);
+	ctx->steering_controller.d = PID_GAIN(STEERING_POSITION_D_GAIN);
+#else
+	ctx->steering_controller.p = PID_GAIN(STEERING_P_GAIN);
+	ctx->steering_controller.i = PID_GAIN(STEERING_I_GAIN);
+	ctx->steering_controller.d = PID_GAIN(STEERING_D_GAIN);
+#endif
+}
+
+FAST_CODE static void OverridePID(main_context_t* ctx)
+{
+	if( !ctx->override_pid )
+		return;
+
+	ctx->speed_controller.p = PID_GAIN(ctx->speed_p_gain_override);
+	ctx->speed_controller.i = PID_GAIN(ctx->speed_i_gain_override);
+	ctx->speed_controller.d = PID_GAIN(ctx->speed_d_gain_override);
+
+	ctx->steering_controller.p = PID_GAIN(ctx->steer_p_gain_override);
+	ctx->steering_controller.i = PID_GAIN(ctx->steer_i_gain_override);
+	ctx->steering_controller.d = PID_GAIN(ctx->steer_d_gain_override);
+}
+
+//Gains for the measured speed, unless the PC overrides them, and the
+//feedforward for the commanded speed. Two table lookups, the same cost at
+//any speed.
+FAST_CODE static void ScheduleSpeedController(main_context_t* ctx)
+{
+	if( !ctx->override_pid )
+	{
+		gain_schedule_point_t point;
+		GainScheduleLookup(&ctx->speed_schedule, ctx->vehicle_speed, &point);
+		ctx->speed_controller.p = PID_GAIN(point.p);
+		ctx->speed_controller.i = PID_GAIN(point.i);
+		ctx->speed_controller.d = PID_GAIN(point.d);
+	}
+	ctx->speed_controller.feedforward = ConvertDutyCycleToPIDInt(GainScheduleFeedforward(&ctx->speed_schedule, ctx->vehicle_speed_commanded));
+}
+
+//One update of a loop over the cycle's sample interval
+FAST_CODE static inline int StepLoop(main_context_t* ctx, PIDController* c, int setpoint, int feedback)
+{
+#if CONTROL_TIMED_PID
+	return pid_step_timed(c, setpoint, feedback, &ctx->pid_timing);
+#else
+	(void)ctx;
+	return pid_step(c, setpoint, feedback, PID_DT_UNTIMED);
+#endif
+}
+
+//What the actuators of a loop hold from the last cycle, in its units, for
+//a bumpless enable: the signed torque or rate and the signed acceleration
+FAST_CODE static int SteeringOutputNow(const actuator_command_t* out)
+{
+#if STEERING_RATE_LOOP
+	return ConvertRateToPIDInt(out->steering_rate_control ? out->steering_rate : 0.0f);
+#else
+	return ConvertDutyCycleToPIDInt(out->steer_right ? -out->steering_torque : out->steering_torque);
+#endif
+}
+
+FAST_CODE static int SpeedOutputNow(const actuator_command_t* out)
+{
+	return ConvertDutyCycleToPIDInt(out->reverse ? -out->acceleration : out->acceleration);
+}
+
+//Steps both loops, the commanded value is the setpoint and the measured
+//value the feedback. A loop that was off takes over from the actuators.
+FAST_CODE static void StepControllers(main_context_t* ctx)
+{
+	OverridePID(ctx);
+	ScheduleSpeedController(ctx);
+
+	//inlined updates
+	uint32_t pid_start = ProfilerStart();
+	int setpoint = ConvertAngleToPIDInt(ctx->steering_angle_commanded);
+	int feedback = ConvertAngleToPIDInt(ctx->steering_angle);
+	setEnabledBumpless(&ctx->steering_controller, setpoint, feedback, SteeringOutputNow(&ctx->actuators));
+	int steering_pid_out = StepLoop(ctx, &ctx->steering_controller, setpoint, feedback);
+#if PID_AUTOTUNE_ENABLE
+	PIDAutotuneRelay(ctx, PID_AUTOTUNE_STEERING, &ctx->steering_controller, setpoint, feedback, &steering_pid_out);
+#endif
+#if SHADOW_CONTROLLER_ENABLE
+	ShadowControllerStep(ctx, SHADOW_CONTROLLER_STEERING, &ctx->steering_controller, setpoint, feedback, steering_pid_out);
+#endif
+#if STEERING_RATE_LOOP
+	ctx->steering_rate_pid_out = ConvertPIDIntToRate(steering_pid_out);
+#else
+	ctx->steering_torque_pid_out = ConvertPIDIntToDutyCycle(steering_pid_out);
+#endif
+	ProfilerEnd(PROFILER_STAGE_STEERING_PID, pid_start);
+	pid_start = ProfilerStart();
+	setpoint = ConvertSpeedToPIDInt(ctx->vehicle_speed_commanded);
+	feedback = ConvertSpeedToPIDInt(ctx->vehicle_speed);
+	setEnabledBumpless(&ctx->speed_controller, setpoint, feedback, SpeedOutputNow(&ctx->actuators));
+	int speed_pid_out = StepLoop(ctx, &ctx->speed_controller, setpoint, feedback);
+#if PID_AUTOTUNE_ENABLE
+	PIDAutotuneRelay(ctx, PID_AUTOTUNE_SPEED, &ctx->speed_controller, setpoint, feedback, &speed_pid_out);
+#endif
+#if SHADOW_CONTROLLER_ENABLE
+	ShadowControllerStep(ctx, SHADOW_CONTROLLER_SPEED, &ctx->speed_controller, setpoint, feedback, speed_pid_out);
+	ShadowControllerRun(ctx);
+#endif
+	ctx->acceleration_pid_out = ConvertPIDIntToDutyCycle(speed_pid_out);
+	ProfilerEnd(PROFILER_STAGE_SPEED_PID, pid_start);
+}
+
+//Front brake duty cycle that holds the share of the full brake pressure
+FAST_CODE static float BrakeDuty(main_context_t* ctx, float pressure)
+{
+#if BRAKE_PRESSURE_LOOP
+	//released, the next brake takes over from the duty left then
+	if( pressure <= 0.0f )
+	{
+		setEnabled(&ctx->brake_controller, 0);
+		return 0.0f;
+	}
+	//shares convert like duty cycles
+	ctx->brake_controller.feedforward = ConvertDutyCycleToPIDInt(pressure * BRAKE_FEEDFORWARD_GAIN);
+	int setpoint = ConvertDutyCycleToPIDInt(pressure);
+	int feedback = ConvertDutyCycleToPIDInt(ctx->brake_pressure);
+	setEnabledBumpless(&ctx->brake_controller, setpoint, feedback, ConvertDutyCycleToPIDInt(ctx->actuators.front_brake));
+	return ConvertPIDIntToDutyCycle(StepLoop(ctx, &ctx->brake_controller, setpoint, feedback));
+#else
+	(void)ctx;
+	return pressure;
+#endif
+}
+
+//Mode output handlers (VehicleMode.h), only the current mode's runs.
+//Each decides the actuators of ctx->actuators it owns, the actuator stage
+//commits them.
+
+//The brake stays where the last mode left it, a parked cart stays braked
+FAST_CODE static void DisabledOutputs(main_context_t* ctx)
+{
+	actuator_command_t* out = &ctx->actuators;
+	out->safety_light_1 = 0;
+	out->steering_rate_control = 0;
+	out->steering_torque = 0.0f;
+	out->acceleration = 0.0f;
+	out->reverse = 0;
+}
+
+FAST_CODE static void TeleopOutputs(main_context_t* ctx)
+{
+	actuator_command_t* out = &ctx->actuators;
+	out->safety_light_1 = 1;
+	out->steering_rate_control = 0;
+	out->acceleration = ctx->vehicle_speed_commanded;
+	if(ctx->steering_angle_commanded > 0)
+	{
+		out->steering_torque = ctx->steering_angle_commanded;
+		out->steer_right = 0;
+	}
+	else
+	{
+		out->steering_torque = ctx->steering_angle_commanded * -1;
+		out->steer_right = 1;
+	}
+}
+
+FAST_CODE static void AutonomousOutputs(main_context_t* ctx)
+{
+	StepControllers(ctx);
+
+	actuator_command_t* out = &ctx->actuators;
+	out->safety_light_1 = 1;
+	float accel = ctx->acceleration_pid_out;
+	//released again as soon as the PID stops asking to slow down
+	float brake = 0.0f;
+
+	//if reverse commanded
+	if( accel < 0.0f )
+	{
+		//if we are moving forward
+		if(ctx->vehicle_speed > 0)
+		{
+			//Don't engage reverse while we are moving forward.
+			accel = 0.0f;
+			brake = COME_TO_STOP_DECELERATION * BRAKE_PRESSURE_PER_DECELERATION;
+		}
+		else //not moving forward and reverse commanded
+		{
+			out->reverse = 1;
+			accel = -accel;
+		}
+	}
+	else //reverse not commanded
+	{
+		out->reverse = 0;
+	}
+	if( accel > 1.0f)
+		accel = 1.0f;
+	out->acceleration = accel;
+	out->front_brake = BrakeDuty(ctx, brake);
+
+#if STEERING_RATE_LOOP
+	//the rate loop drives the motor from its interrupt, it stops
+	//when the loop lets go
+	out->steering_rate = ctx->steering_rate_pid_out;
+	out->steering_rate_control = 1;
+	out->steering_torque = 0.0f;
+#else
+	float SteeringTorqueFromPID = ctx->steering_torque_pid_out;
+#if STEERING_COMPENSATION_ENABLE
+	SteeringTorqueFromPID = SteeringCompensationStep(&ctx->steering_compensation, SteeringTorqueFromPID, ctx->steering_angle);
+#endif
+	out->steer_right = SteeringTorqueFromPID < 0.0f;
+
+	//limit the torque 0 to 1
+	if( SteeringTorqueFromPID < 0.0f )
+		SteeringTorqueFromPID = -SteeringTorqueFromPID;
+	if( SteeringTorqueFromPID > 1.0f )
+		SteeringTorqueFromPID = 1.0f;
+
+	out->steering_torque = SteeringTorqueFromPID;
+#endif
+}
+
+FAST_CODE static void ParkOutputs(main_context_t* ctx)
+{
+	actuator_command_t* out = &ctx->actuators;
+	out->safety_light_1 = 1;
+	out->steering_rate_control = 0;
+	out->steering_torque = 0.0f;
+	out->front_brake = BrakeDuty(ctx, PARKING_BRAKE_PRESSURE);
+	out->acceleration = 0.0f;
+}
+
+//What the estop interrupt forced already, held for as long as the press
+FAST_CODE static void EStopOutputs(main_context_t* ctx)
+{
+	actuator_command_t* out = &ctx->actuators;
+	out->safety_light_1 = 1;
+	out->steering_rate_control = 0;
+	out->steering_torque = 0.0f;
+	out->front_brake = EMERGENCY_STOP_BRAKE_DUTY_CYCLE;
+	out->acceleration = 0.0f;
+}
+
+//At rest while an excitation run computes its sequence, then its DMA
+//plays the output (Excitation.h). The parking brake holds the cart for a
+//steering run, a throttle run has to roll.
+FAST_CODE static void TestOutputs(main_context_t* ctx)
+{
+	actuator_command_t* out = &ctx->actuators;
+	out->safety_light_1 = 1;
+	out->steering_rate_control = 0;
+	out->steering_torque = 0.0f;
+	out->acceleration = 0.0f;
+	out->reverse = 0;
+#if EXCITATION_ENABLE
+	ExcitationOutputs(ctx);
+#endif
+	out->front_brake = out->acceleration_by_dma ? 0.0f : BrakeDuty(ctx, PARKING_BRAKE_PRESSURE);
+}
+
+//The cart held as parked while the sweep steers
+FAST_CODE static void CalibrateOutputs(main_context_t* ctx)
+{
+	actuator_command_t* out = &ctx->actuators;
+	out->safety_light_1 = 1;
+	out->steering_rate_control = 0;
+	out->front_brake = BrakeDuty(ctx, PARKING_BRAKE_PRESSURE);
+	out->acceleration = 0.0f;
+	out->reverse = 0;
+#if STEERING_SWEEP_ENABLE
+	SteeringSweepSteer(ctx);
+#else
+	out->steering_torque = 0.0f;
+#endif
+}
+
+static void (* const mode_outputs[VEHICLE_MODE_COUNT])(main_context_t* ctx) =
+{
+	[VEHICLE_MODE_DISABLED] = DisabledOutputs,
+	[VEHICLE_MODE_TELEOP] = TeleopOutputs,
+	[VEHICLE_MODE_AUTONOMOUS] = AutonomousOutputs,
+	[VEHICLE_MODE_PARK] = ParkOutputs,
+	[VEHICLE_MODE_ESTOP] = EStopOutputs,
+	[VEHICLE_MODE_TEST] = TestOutputs,
+	[VEHICLE_MODE_CALIBRATE] = CalibrateOutputs,
+};
+
+//The mode for this cycle from the flags the command and the inputs left,
+//then that mode's outputs
+FAST_CODE void ProcessAlgorithms(main_context_t* ctx)
+{
+	uint32_t profile_start = ProfilerStart();
+#if CONTROL_TIMED_PID
+	//every cycle, whichever loops the mode steps. The first has no last sample.
+	uint32_t elapsed = ctx->last_sample_time ? ctx->sample_time - ctx->last_sample_time : 0;
+	ctx->last_sample_time = ctx->sample_time;
+	ctx->pid_timing = getPIDTiming(elapsed, CONTROL_GAIN_PERIOD_US);
+#endif
+	uint8_t conditions = (ctx->estop_in ? VEHICLE_CONDITION_ESTOP : 0)
+		| (ctx->autonomous_mode ? VEHICLE_CONDITION_AUTONOMOUS : 0)
+		| (ctx->park_brake_commanded ? VEHICLE_CONDITION_PARK : 0)
+		| (ctx->tele_operation_enabled && DeadlineMet(&ctx->deadlines, DEADLINE_TELEOP) ? VEHICLE_CONDITION_TELEOP : 0);
+#if STEERING_SWEEP_ENABLE
+	conditions |= SteeringSweepCondition(ctx) ? VEHICLE_CONDITION_CALIBRATE : 0;
+#endif
+#if EXCITATION_ENABLE
+	conditions |= ExcitationCondition(ctx) ? VEHICLE_CONDITION_TEST : 0;
+#endif
+	conditions |= ctx->actuator_fault.faults ? VEHICLE_CONDITION_FAULT : 0;
+	//the loops take over from the actuators the next time autonomous mode
+	//is entered, the brake loop with every mode
+	if( VehicleModeUpdate(&ctx->mode, conditions, ctx->current_time) )
+	{
+		if( ctx->mode.mode != VEHICLE_MODE_AUTONOMOUS )
+		{
+			setEnabled(&ctx->steering_controller, 0);
+			setEnabled(&ctx->speed_controller, 0);
+			SteeringCompensationReset(&ctx->steering_compensation);
+		}
+		setEnabled(&ctx->brake_controller, 0);
+	}
+#if PID_AUTOTUNE_ENABLE
+	PIDAutotuneUpdate(ctx);
+#endif
+	ctx->estop_indicator = ctx->mode.mode == VEHICLE_MODE_ESTOP;
+	mode_outputs[ctx->mode.mode](ctx);
+	ProfilerEnd(PROFILER_STAGE_ALGORITHMS, profile_start);
+}
+
+//Copies a newly received command set, or the one of a commander that just
+//took over, into the control context.
+//Runs at the top of the cycle so the whole cycle works from one consistent command.
+//Once every lease has run out nothing is copied and the command timeout applies.
+FAST_CODE void ApplyLatestCommand(main_context_t* ctx)
+{
+	const control_command_t* command;
+	if( !SelectCommand(&ctx->exchange, ctx->current_time, &command) )
+		return;
+
+	NetLatencyApplied(&command->latency);
+	LatencyProbeApplied(&command->probe);
+#if CONTROL_RECORD_ENABLE
+	ControlRecordCommand(ctx, command);
+#endif
+	ctx->last_eth_input_rx_time = command->rx_time;
+	DeadlineKick(&ctx->deadlines, DEADLINE_COMM, command->rx_time);
+	DeadlineKick(&ctx->deadlines, DEADLINE_TELEOP, command->rx_time);
+	ctx->pc_comm_active = 1;
+	//a trend only holds between commands of one sender, in one set of units
+	uint8_t continuous = command->priority == ctx->applied_priority
+		&& (command->tele_operation_enabled != 0) == ctx->tele_operation_enabled;
+	ctx->applied_priority = command->priority;
+	CommandHoldUpdate(&ctx->speed_hold, command->vehicle_speed_commanded, command->sent_time, ctx->current_time,
+		continuous);
+	CommandHoldUpdate(&ctx->steering_hold, command->steering_angle_commanded, command->sent_time, ctx->current_time,
+		continuous);
+	//a plan from another sender starts over, a plain command ends it
+	if( command->trajectory_points )
+	{
+		if( !continuous || !ctx->following_trajectory )
+			TrajectoryBufferReset(&ctx->trajectory);
+		TrajectoryBufferMerge(&ctx->trajectory, command->trajectory, command->trajectory_points);
+	}
+	ctx->following_trajectory = command->trajectory_points != 0;
+	ctx->park_brake_commanded = command->park_brake_commanded;
+	ctx->reverse_commanded = command->reverse_commanded;
+	//a new command can not take back control while a sensor or the EPS is silent
+	ctx->autonomous_mode = command->autonomous_mode && !DeadlineMissed(&ctx->deadlines, DEADLINE_WHEEL_SPEED)
+		&& !DeadlineMissed(&ctx->deadlines, DEADLINE_EPS_FEEDBACK);
+	ctx->tele_operation_enabled = command->tele_operation_enabled;
+}
+
+//Takes a parameter set the control channel published, from NVM at boot or
+//as the PC changes it
+FAST_CODE void ApplyNewParams(main_context_t* ctx)
+{
+	const param_set_t* params;
+	if( !ReadNewParams(&ctx->exchange, &params) )
+		return;
+#if CONTROL_RECORD_ENABLE
+	ControlRecordParams(ctx, params);
+#endif
+
+	uint8_t was_overridden = ctx->override_pid;
+	ctx->override_pid = params->values[PARAM_OVERRIDE_PID].u != 0;
+	if( was_overridden && !ctx->override_pid )
+		SetDefaultSteeringGains(ctx);
+	ctx->speed_p_gain_override = params->values[PARAM_SPEED_P_GAIN].f;
+	ctx->speed_i_gain_override = params->values[PARAM_SPEED_I_GAIN].f;
+	ctx->speed_d_gain_override = params->values[PARAM_SPEED_D_GAIN].f;
+	ctx->steer_p_gain_override = params->values[PARAM_STEER_P_GAIN].f;
+	ctx->steer_i_gain_override = params->values[PARAM_STEER_I_GAIN].f;
+	ctx->steer_d_gain_override = params->values[PARAM_STEER_D_GAIN].f;
+#if SHADOW_CONTROLLER_ENABLE
+	ShadowControllerApplyParams(params);
+#endif
+}
+
+//Deadline actions, run from DeadlineMonitorCheck in main_task.
+//A stale sensor or an actuator that stopped reporting leaves the PID loops
+//working from old data, autonomous mode stays off until it is heard again.
+static void DropAutonomousMode(void* arg, deadline_id_t id, uint32_t overdue)
+{
+	main_context_t* ctx = (main_context_t*)arg;
+	ctx->autonomous_mode = 0;
+}
+
+static void CommLost(void* arg, deadline_id_t id, uint32_t overdue)
+{
+	main_context_t* ctx = (main_context_t*)arg;
+	ctx->pc_comm_active = 0;
+	ctx->autonomous_mode = 0;
+}
+
+//Records estop transitions in the event log, VehicleModeUpdate records
+//the mode's
+FAST_CODE void LogStateChanges(main_context_t* ctx)
+{
+	if( ctx->estop_in != ctx->logged_estop )
+	{
+		EventLogWrite(EVENT_LOG_ESTOP, ctx->estop_in, ctx->estop_time);
+		ctx->logged_estop = ctx->estop_in;
+	}
+}
+
+//Hands the end of cycle state to ethernet_thread without blocking.
+FAST_CODE void PublishTelemetrySnapshot(main_context_t* ctx)
+{
+	control_telemetry_t* telemetry = BeginTelemetryWrite(&ctx->exchange);
+	telemetry->vehicle_speed = ctx->vehicle_speed;
+	telemetry->steering_angle = ctx->steering_angle;
+	telemetry->estop_in = ctx->estop_in;
+	telemetry->sample_time = ctx->input_time;
+	telemetry->odometry_x = ctx->odometry.x;
+	telemetry->odometry_y = ctx->odometry.y;
+	telemetry->odometry_heading = ctx->odometry.heading;
+	telemetry->ram_corrected = RamEccCorrected();
+	telemetry->ram_uncorrectable = RamEccUncorrectable();
+	telemetry->speed_p_term = ctx->speed_controller.lastPTerm;
+	telemetry->speed_i_term = ctx->speed_controller.lastITerm;
+	telemetry->speed_d_term = ctx->speed_controller.lastDTerm;
+	telemetry->steering_p_term = ctx->steering_controller.lastPTerm;
+	telemetry->steering_i_term = ctx->steering_controller.lastITerm;
+	telemetry->steering_d_term = ctx->steering_controller.lastDTerm;
+	PublishTelemetry(&ctx->exchange);
+}
+
+//Moves the commands toward the latest requests within the slew and jerk
+//limits, for tele operation and autonomous mode alike. Switching between
+//the two changes the units, so the shapers restart from where the
+//actuators are: the measured values, or idle for tele operation.
+FAST_CODE void ShapeCommands(main_context_t* ctx)
+{
+	uint8_t tele_operation = ctx->tele_operation_enabled != 0;
+	if( tele_operation != ctx->shaping_tele_operation )
+	{
+		ctx->shaping_tele_operation = tele_operation;
+		if( tele_operation )
+		{
+			CommandShaperSetLimits(&ctx->steering_shaper, TELEOP_STEERING_SLEW_LIMIT, TELEOP_STEERING_JERK_LIMIT);
+			CommandShaperSetLimits(&ctx->speed_shaper, TELEOP_SPEED_SLEW_LIMIT, TELEOP_SPEED_JERK_LIMIT);
+			CommandShaperReset(&ctx->steering_shaper, 0.0f);
+			CommandShaperReset(&ctx->speed_shaper, 0.0f);
+		}
+		else
+		{
+			CommandShaperSetLimits(&ctx->steering_shaper, STEERING_SLEW_LIMIT, STEERING_JERK_LIMIT);
+			CommandShaperSetLimits(&ctx->speed_shaper, SPEED_SLEW_LIMIT, SPEED_JERK_LIMIT);
+			CommandShaperReset(&ctx->steering_shaper, ctx->steering_angle);
+			CommandShaperReset(&ctx->speed_shaper, ctx->vehicle_speed);
+		}
+	}
+
+	//tele operation commands a torque, not an angle
+	float steering = ctx->steering_angle_requested;
+	if( !tele_operation )
+	{
+		SteeringLimitsLookup(&ctx->steering_limits, ctx->vehicle_speed, &ctx->steering_limit);
+		CommandShaperSetRate(&ctx->steering_shaper, ctx->steering_limit.rate);
+		if( steering > ctx->steering_limit.angle )
+			steering = ctx->steering_limit.angle;
+		else if( steering < -ctx->steering_limit.angle )
+			steering = -ctx->steering_limit.angle;
+	}
+	ctx->steering_angle_commanded = CommandShaperStep(&ctx->steering_shaper, steering);
+	ctx->vehicle_speed_commanded = CommandShaperStep(&ctx->speed_shaper, ctx->vehicle_speed_requested);
+}
+
+//The requests for this cycle from the last commands, per the hold policy,
+//or from the trajectory at the time the inputs were sampled. Without a
+//synced clock a trajectory's first point is held like a plain command.
+FAST_CODE static void HoldCommands(main_context_t* ctx)
+{
+	float speed = CommandHoldStep(&ctx->speed_hold, ctx->current_time);
+	float steering = CommandHoldStep(&ctx->steering_hold, ctx->current_time);
+	if( ctx->following_trajectory && ctx->input_time != 0 )
+		TrajectoryBufferSample(&ctx->trajectory, ctx->input_time, &speed, &steering);
+	ctx->vehicle_speed_requested = speed;
+	ctx->steering_angle_requested = steering;
+}
+
+#if ACTUATOR_FAULT_ENABLE
+//The outputs committed last cycle against the inputs they brought, before
+//the control stage decides this cycle's
+FAST_CODE static void DetectActuatorFaults(main_context_t* ctx)
+{
+	ActuatorFaultStep(&ctx->actuator_fault, &ctx->actuators, ctx->steering_angle, ctx->vehicle_speed, ctx->estop_in);
+}
+#endif
+
+#if TRACTION_CONTROL_ENABLE
+//The mode's throttle and brake held back while the wheels slip. Tele
+//operation leaves the brake where the last mode did, only its throttle is
+//commanded.
+FAST_CODE static void LimitSlip(main_context_t* ctx)
+{
+	uint8_t channels = 0;
+	if( ctx->mode.mode == VEHICLE_MODE_AUTONOMOUS )
+		channels = TRACTION_CONTROL_THROTTLE | TRACTION_CONTROL_BRAKE;
+	else if( ctx->mode.mode == VEHICLE_MODE_TELEOP )
+		channels = TRACTION_CONTROL_THROTTLE;
+	TractionControlStep(&ctx->traction, ctx->wheel_speeds, ctx->front_wheels_valid, &ctx->actuators, channels);
+}
+#endif
+
+FAST_CODE static void UpdateOdometry(main_context_t* ctx)
+{
+	OdometryStep(&ctx->odometry, ctx->vehicle_speed, ctx->steering_angle);
+}
+
+//The cycle's end state for the other tasks, one signal at a time
+FAST_CODE static void PublishSignals(main_context_t* ctx)
+{
+	SignalPublishFloat(SIGNAL_VEHICLE_SPEED, ctx->vehicle_speed);
+	SignalPublishFloat(SIGNAL_STEERING_ANGLE, ctx->steering_angle);
+	SignalPublishFloat(SIGNAL_VEHICLE_SPEED_REQUESTED, ctx->vehicle_speed_requested);
+	SignalPublishFloat(SIGNAL_STEERING_ANGLE_REQUESTED, ctx->steering_angle_requested);
+	SignalPublishFloat(SIGNAL_VEHICLE_SPEED_COMMANDED, ctx->vehicle_speed_commanded);
+	SignalPublishFloat(SIGNAL_STEERING_ANGLE_COMMANDED, ctx->steering_angle_commanded);
+	SignalPublishFloat(SIGNAL_STEERING_TORQUE_PID_OUT, ctx->steering_torque_pid_out);
+	SignalPublishFloat(SIGNAL_ACCELERATION_PID_OUT, ctx->acceleration_pid_out);
+	if( ctx->imu_valid )
+	{
+		SignalPublishFloat(SIGNAL_YAW_RATE, ctx->yaw_rate);
+		SignalPublishFloat(SIGNAL_LONGITUDINAL_ACCEL, ctx->longitudinal_accel);
+		SignalPublishFloat(SIGNAL_LATERAL_ACCEL, ctx->lateral_accel);
+	}
+	SignalPublishFloat(SIGNAL_ODOMETRY_X, ctx->odometry.x);
+	SignalPublishFloat(SIGNAL_ODOMETRY_Y, ctx->odometry.y);
+	SignalPublishFloat(SIGNAL_ODOMETRY_HEADING, ctx->odometry.heading);
+	SignalPublishUint(SIGNAL_ESTOP, ctx->estop_in);
+	SignalPublishUint(SIGNAL_REVERSE, ctx->reverse);
+	SignalPublishUint(SIGNAL_VEHICLE_MODE, ctx->mode.mode);
+	SignalPublishUint(SIGNAL_AUTONOMOUS_MODE, ctx->autonomous_mode);
+	SignalPublishUint(SIGNAL_TELE_OPERATION, ctx->tele_operation_enabled);
+	SignalPublishUint(SIGNAL_PARK_BRAKE_COMMANDED, ctx->park_brake_commanded);
+	SignalPublishUint(SIGNAL_PC_COMM_ACTIVE, ctx->pc_comm_active);
+	SignalPublishFloat(SIGNAL_BRAKE_PRESSURE, ctx->brake_pressure);
+	SignalPublishFloat(SIGNAL_SUPPLY_VOLTAGE, ctx->supply_voltage);
+	SignalPublishFloat(SIGNAL_SUPPLY_GAIN, ctx->supply_gain);
+	SignalPublishUint(SIGNAL_ACTUATOR_FAULTS, ctx->actuator_fault.faults);
+	SignalPublishFloat(SIGNAL_STEERING_RESIDUAL, ctx->actuator_fault.steering.residual);
+	SignalPublishFloat(SIGNAL_THROTTLE_RESIDUAL, ctx->actuator_fault.throttle.residual);
+	SignalPublishFloat(SIGNAL_STEERING_ANGLE_LIMIT, ctx->steering_limit.angle);
+	SignalPublishFloat(SIGNAL_STEERING_RATE_LIMIT, ctx->steering_limit.rate);
+#if TRACTION_CONTROL_ENABLE
+	SignalPublishFloat(SIGNAL_DRIVE_SLIP, ctx->traction.drive_slip);
+	SignalPublishFloat(SIGNAL_BRAKE_SLIP, ctx->traction.brake_slip);
+	SignalPublishUint(SIGNAL_TRACTION_CONTROL, ctx->traction.active);
+#endif
+#if SHADOW_CONTROLLER_ENABLE
+	ShadowControllerPublish();
+#endif
+}
+
+FAST_CODE static void CheckDeadlines(main_context_t* ctx)
+{
+	DeadlineMonitorCheck(&ctx->deadlines, ctx->current_time);
+}
+
+FAST_CODE static void RecordTrace(main_context_t* ctx)
+{
+	PIDTraceRecord(&ctx->trace, ctx->scheduler.cycle_count, &ctx->steering_controller,
+		&ctx->speed_controller, ctx->estop_in);
+}
+
+FAST_CODE static void CommitOutputs(main_context_t* ctx)
+{
+	CommitActuators(&ctx->actuators);
+	LatencyProbeCommitted();
+}
+
+//The control cycle, in the order the data flows. Parameters come in at
+//100 Hz and the status lights go out at 10 Hz, on cycles of their own
+//whatever CONTROL_RATE_HZ: neither has anything to do every cycle. The estop light lags the press by
+//up to 100 ms, the brake is forced from the estop interrupt itself.
+static const control_stage_t control_stages[] =
+{
+	CONTROL_STAGE("params", ApplyNewParams, 10 * CONTROL_CYCLES_PER_MS, 5 * CONTROL_CYCLES_PER_MS, PROFILER_STAGE_COUNT),
+	CONTROL_STAGE("command", ApplyLatestCommand, 1, 0, PROFILER_STAGE_COUNT),
+	CONTROL_STAGE("inputs", ProcessCurrentInputs, 1, 0, PROFILER_STAGE_INPUTS),
+	//after the inputs kicked theirs, before anything acts on stale data
+	CONTROL_STAGE("deadlines", CheckDeadlines, 1, 0, PROFILER_STAGE_COUNT),
+	//at the time the inputs were sampled
+	CONTROL_STAGE("hold", HoldCommands, 1, 0, PROFILER_STAGE_COUNT),
+	//after the inputs, a change of mode restarts from the measured values
+	CONTROL_STAGE("shaping", ShapeCommands, 1, 0, PROFILER_STAGE_COUNT),
+	CONTROL_STAGE("trace", RecordTrace, 1, 0, PROFILER_STAGE_COUNT),
+	//as late as it can be, the IMU burst started at the wake is long done
+	CONTROL_STAGE("imu", ProcessImuInputs, 1, 0, PROFILER_STAGE_COUNT),
+#if ACTUATOR_FAULT_ENABLE
+	//ahead of the control stage, whose mode a fault decides
+	CONTROL_STAGE("faults", DetectActuatorFaults, 1, 0, PROFILER_STAGE_COUNT),
+#endif
+	CONTROL_STAGE("control", ProcessAlgorithms, 1, 0, PROFILER_STAGE_COUNT),
+#if TRACTION_CONTROL_ENABLE
+	CONTROL_STAGE("traction", LimitSlip, 1, 0, PROFILER_STAGE_TRACTION),
+#endif
+	CONTROL_STAGE("actuators", CommitOutputs, 1, 0, PROFILER_STAGE_COUNT),
+	CONTROL_STAGE("events", LogStateChanges, 1, 0, PROFILER_STAGE_COUNT),
+	//this cycle's inputs into the pose it publishes
+	CONTROL_STAGE("odometry", UpdateOdometry, 1, 0, PROFILER_STAGE_COUNT),
+	CONTROL_STAGE("telemetry", PublishTelemetrySnapshot, 1, 0, PROFILER_STAGE_COUNT),
+	CONTROL_STAGE("signals", PublishSignals, 1, 0, PROFILER_STAGE_COUNT),
+	CONTROL_STAGE("status", ProcessCurrentOutputs, 100 * CONTROL_CYCLES_PER_MS, 50 * CONTROL_CYCLES_PER_MS, PROFILER_STAGE_OUTPUTS),
+#if CONTROL_RECORD_ENABLE
+	//last, everything the cycle took and decided is in by now
+	CONTROL_STAGE("record", ControlRecordCycle, 1, 0, PROFILER_STAGE_COUNT),
+#endif
+};
+
+void ControlCoreInit(main_context_t* ctx)
+{
+	memset(ctx, 0, sizeof(main_context_t));
+	ControlPipelineInit(&ctx->pipeline, control_stages, sizeof(control_stages) / sizeof(control_stages[0]));
+	VehicleModeInit(&ctx->mode, 0);
+	ControlExchangeInit(&ctx->exchange);
+	PIDTraceInit(&ctx->trace);
+
+	//Initialize PID controllers.
+	SetDefaultSteeringGains(ctx);
+#if STEERING_RATE_LOOP
+	setInputBounds(&(ctx->steering_controller), ConvertAngleToPIDInt(MIN_STEERING_ANGLE), ConvertAngleToPIDInt(MAX_STEERING_ANGLE));
+	setOutputBounds(&(ctx->steering_controller), ConvertRateToPIDInt(MAX_STEERING_RATE)*-1, ConvertRateToPIDInt(MAX_STEERING_RATE));
+#else
+	setInputBounds(&(ctx->steering_controller), ConvertAngleToPIDInt(MIN_STEERING_ANGLE), ConvertAngleToPIDInt(MAX_STEERING_ANGLE));
+	setOutputBounds(&(ctx->steering_controller), ConvertDutyCycleToPIDInt(MAX_STEERING_DUTY_CYCLE)*-1, ConvertDutyCycleToPIDInt(MAX_STEERING_DUTY_CYCLE));
+#endif
+	setAntiWindup(&(ctx->steering_controller), PID_ANTI_WINDUP_BACK_CALCULATION, PID_ANTI_WINDUP_GAIN);
+	setDerivativeOnMeasurement(&(ctx->steering_controller), 1);
+	setDerivativeFilter(&(ctx->steering_controller), PID_DERIVATIVE_FILTER);
+
+	ctx->speed_controller.p = PID_GAIN(SPEED_P_GAIN);
+	ctx->speed_controller.i = PID_GAIN(SPEED_I_GAIN);
+	ctx->speed_controller.d = PID_GAIN(SPEED_D_GAIN);
+	setInputBounds(&(ctx->speed_controller), ConvertSpeedToPIDInt(MIN_VEHICLE_SPEED), ConvertSpeedToPIDInt(MAX_VEHICLE_SPEED));
+	setOutputBounds(&(ctx->speed_controller), ConvertDutyCycleToPIDInt(MIN_ACCEL_DUTY_CYCLE), ConvertDutyCycleToPIDInt(MAX_ACCEL_DUTY_CYCLE));
+	setAntiWindup(&(ctx->speed_controller), PID_ANTI_WINDUP_BACK_CALCULATION, PID_ANTI_WINDUP_GAIN);
+	setDerivativeOnMeasurement(&(ctx->speed_controller), 1);
+	setDerivativeFilter(&(ctx->speed_controller), PID_DERIVATIVE_FILTER);
+	ctx->brake_controller.p = PID_GAIN(BRAKE_P_GAIN);
+	ctx->brake_controller.i = PID_GAIN(BRAKE_I_GAIN);
+	ctx->brake_controller.d = PID_GAIN(BRAKE_D_GAIN);
+	setInputBounds(&(ctx->brake_controller), 0, ConvertDutyCycleToPIDInt(1.0f));
+	setOutputBounds(&(ctx->brake_controller), 0, ConvertDutyCycleToPIDInt(MAX_BRAKE_DUTY_CYCLE));
+	setAntiWindup(&(ctx->brake_controller), PID_ANTI_WINDUP_BACK_CALCULATION, PID_ANTI_WINDUP_GAIN);
+	setDerivativeOnMeasurement(&(ctx->brake_controller), 1);
+	setDerivativeFilter(&(ctx->brake_controller), PID_DERIVATIVE_FILTER);
+	GainScheduleInit(&ctx->speed_schedule, speed_schedule_points,
+		sizeof(speed_schedule_points) / sizeof(speed_schedule_points[0]), 0.0f, SPEED_SCHEDULE_SPACING);
+	SteeringLimitsInit(&ctx->steering_limits, steering_limit_points,
+		sizeof(steering_limit_points) / sizeof(steering_limit_points[0]), STEERING_LIMIT_SPACING);
+
+	CommandShaperInit(&ctx->steering_shaper, STEERING_SLEW_LIMIT, STEERING_JERK_LIMIT, CONTROL_CORE_CYCLE_US / 1000000.0f);
+	CommandShaperInit(&ctx->speed_shaper, SPEED_SLEW_LIMIT, SPEED_JERK_LIMIT, CONTROL_CORE_CYCLE_US / 1000000.0f);
+
+	CommandHoldInit(&ctx->speed_hold, SPEED_HOLD_MODE, 0.0f, 1.0f, 0.0f, SPEED_HOLD_RAMP_RATE, COMMAND_HOLD_HORIZON,
+		COMMAND_HOLD_LATE);
+	CommandHoldInit(&ctx->steering_hold, STEERING_HOLD_MODE, -1.0f, 1.0f, 0.0f, STEERING_HOLD_RAMP_RATE,
+		COMMAND_HOLD_HORIZON, COMMAND_HOLD_LATE);
+
+	OdometryInit(&ctx->odometry, ODOMETRY_WHEELBASE, CONTROL_CORE_CYCLE_US / 1000000.0f);
+	ActuatorFaultInit(&ctx->actuator_fault, CONTROL_CORE_CYCLE_US / 1000000.0f);
+	TractionControlInit(&ctx->traction, CONTROL_CORE_CYCLE_US / 1000000.0f);
+	SteeringCompensationInit(&ctx->steering_compensation, CONTROL_CORE_CYCLE_US / 1000000.0f);
+
+	DeadlineMonitorInit(&ctx->deadlines);
+	DeadlineRegister(&ctx->deadlines, DEADLINE_COMM, COMM_TIMEOUT, CommLost, ctx);
+	DeadlineRegister(&ctx->deadlines, DEADLINE_TELEOP, TELEOP_TIMEOUT, NULL, NULL);
+	DeadlineRegister(&ctx->deadlines, DEADLINE_WHEEL_SPEED, WHEEL_SPEED_TIMEOUT, DropAutonomousMode, ctx);
+	DeadlineRegister(&ctx->deadlines, DEADLINE_EPS_FEEDBACK, EPS_FEEDBACK_TIMEOUT, DropAutonomousMode, ctx);
+}
+
+FAST_CODE void ControlCoreStep(main_context_t* ctx, uint32_t now)
+{
+	ctx->current_time = now;
+#if CONTROL_RECORD_ENABLE
+	ControlRecordBegin(ctx);
+#endif
+	ControlPipelineRun(&ctx->pipeline, ctx, ctx->scheduler.cycle_count);
+}
@@ -0,0 +1,78 @@
+/*
+ * ControlCore.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CONTROLCORE_H_
+#define CONTROLCORE_H_
+
+#include <stdint.h>
+#include "main_context.h"
+#include "AdcSampler.h"
+
+//The control algorithms main_task runs every cycle, free of FreeRTOS and
+//HAL calls so the same code also builds for the host (host/Makefile).
+//Sensors and actuators are only reached through DriveByWireIO.h:
+//DriveByWireIO.c drives the hardware, host/HostIO.c stands in for it on
+//the host. Time only comes in as the now of each step.
+
+//ControlCoreStep runs every CONTROL_CORE_CYCLE_US, CONTROL_RATE_HZ times a
+//second (ControlScheduler.h).
+
+//us the PID gains are per, the 1 kHz cycle they were tuned at
+#define CONTROL_GAIN_PERIOD_US 1000
+
+//The loops integrate and differentiate over the measured interval between
+//the cycles' input samples (ctx->sample_time) rather than once per cycle.
+//The gains stay per CONTROL_GAIN_PERIOD_US, a cycle sampled on time steps
+//exactly as untimed, one sampled late by a stall or early after one
+//(ControlScheduler.h) integrates and differentiates what actually passed,
+//and so does every cycle at a faster CONTROL_RATE_HZ.
+#ifndef CONTROL_TIMED_PID
+#define CONTROL_TIMED_PID 1
+#endif
+
+#if !CONTROL_TIMED_PID && CONTROL_RATE_HZ != 1000
+#error Untimed loops take the gains per cycle, a CONTROL_RATE_HZ other than 1000 needs CONTROL_TIMED_PID
+#endif
+
+//Front brake duty while the estop is pressed, also what the estop interrupt
+//applies before the control loop gets to it
+#define EMERGENCY_STOP_BRAKE_DUTY_CYCLE 1.0f
+
+//The front brake is commanded as a share of its full pressure. 1 holds the
+//pressure with brake_controller on the brake pressure sensor, so a stop
+//brakes the same whatever the battery voltage and the wear of the
+//actuator. 0 takes the share as the duty cycle, as it used to be. The estop
+//brakes at EMERGENCY_STOP_BRAKE_DUTY_CYCLE either way.
+#ifndef BRAKE_PRESSURE_LOOP
+#define BRAKE_PRESSURE_LOOP ADC_SAMPLER_BRAKE_FEEDBACK
+#endif
+
+//Zeroes ctx and sets up the exchange, trace, controllers and deadlines.
+void ControlCoreInit(main_context_t* ctx);
+
+//One control cycle at now, in ms: the stages of the control pipeline due
+//on ctx->scheduler.cycle_count (ControlPipeline.h), new parameters, the
+//newest command, inputs, timeouts, command shaping, algorithms, actuators,
+//events, the telemetry snapshot and the status lights.
+void ControlCoreStep(main_context_t* ctx, uint32_t now);
+
+int ConvertAngleToPIDInt(float angle);
+int ConvertSpeedToPIDInt(float speed);
+float ConvertPIDIntToDutyCycle(int PID_int);
+int ConvertDutyCycleToPIDInt(float duty_cycle);
+float ConvertPIDIntToRate(int PID_int);
+int ConvertRateToPIDInt(float rate);
+
+void ApplyNewParams(main_context_t* ctx);
+void ApplyLatestCommand(main_context_t* ctx);
+void ShapeCommands(main_context_t* ctx);
+//The vehicle mode for the cycle (VehicleMode.h) and its outputs in
+//ctx->actuators, the pipeline's actuator stage commits them
+void ProcessAlgorithms(main_context_t* ctx);
+void LogStateChanges(main_context_t* ctx);
+void PublishTelemetrySnapshot(main_context_t* ctx);
+
+#endif /* CONTROLCORE_H_ */
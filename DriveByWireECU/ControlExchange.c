@@ -0,0 +1,129 @@
+/*
+ * ControlExchange.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "ControlExchange.h"
+#include "FastCode.h"
+#include "TimeBase.h"
+
+//Times are free running ms counters, compared through the signed difference
+void ControlExchangeInit(control_exchange_t* exchange)
+{
+	memset(exchange, 0, sizeof(*exchange));
+	for(int i = 0; i < CONTROL_COMMAND_PRIORITY_COUNT; ++i)
+		TripleBufferInit(&exchange->command_state[i]);
+	exchange->command_selected = -1;
+	TripleBufferInit(&exchange->telemetry_state);
+	TripleBufferInit(&exchange->params_state);
+}
+
+control_command_t* BeginCommandWrite(control_exchange_t* exchange, uint8_t priority)
+{
+	return &exchange->commands[priority][TripleBufferWriteIndex(&exchange->command_state[priority])];
+}
+
+void PublishCommand(control_exchange_t* exchange, uint8_t priority)
+{
+	TripleBufferPublish(&exchange->command_state[priority]);
+	__atomic_fetch_or(&exchange->command_pending, 1UL << priority, __ATOMIC_RELEASE);
+}
+
+static inline const control_command_t* HeldCommand(const control_exchange_t* exchange, int level)
+{
+	return &exchange->commands[level][TripleBufferReadIndex(&exchange->command_state[level])];
+}
+
+FAST_CODE uint8_t SelectCommand(control_exchange_t* exchange, uint32_t now, const control_command_t** command)
+{
+	//only the levels that were published to since the last call
+	uint32_t pending = __atomic_exchange_n(&exchange->command_pending, 0, __ATOMIC_ACQUIRE);
+	uint32_t updated = 0;
+	while( pending )
+	{
+		int level = __builtin_ctz(pending);
+		pending &= pending - 1;
+		if( TripleBufferUpdate(&exchange->command_state[level]) )
+			updated |= 1UL << level;
+	}
+	exchange->command_valid |= updated;
+
+	//every level dropped here stays dropped until its commander sends again
+	int top = -1;
+	while( exchange->command_valid )
+	{
+		top = 31 - __builtin_clz(exchange->command_valid);
+		if( !TIME_REACHED(now, HeldCommand(exchange, top)->lease_end) )
+			break;
+		exchange->command_valid &= ~(1UL << top);
+		top = -1;
+	}
+
+	uint8_t changed = top != exchange->command_selected || (top >= 0 && (updated & (1UL << top)));
+	exchange->command_selected = top;
+	if( top < 0 || !changed )
+		return 0;
+
+	*command = HeldCommand(exchange, top);
+	return 1;
+}
+
+FAST_CODE control_telemetry_t* BeginTelemetryWrite(control_exchange_t* exchange)
+{
+	return &exchange->telemetry[TripleBufferWriteIndex(&exchange->telemetry_state)];
+}
+
+FAST_CODE void PublishTelemetry(control_exchange_t* exchange)
+{
+	uint32_t published = exchange->telemetry_published;
+	exchange->telemetry_history[published % CONTROL_TELEMETRY_HISTORY] =
+		exchange->telemetry[TripleBufferWriteIndex(&exchange->telemetry_state)];
+	__atomic_store_n(&exchange->telemetry_published, published + 1, __ATOMIC_RELEASE);
+	TripleBufferPublish(&exchange->telemetry_state);
+}
+
+const control_telemetry_t* ReadLatestTelemetry(control_exchange_t* exchange)
+{
+	TripleBufferUpdate(&exchange->telemetry_state);
+	return &exchange->telemetry[TripleBufferReadIndex(&exchange->telemetry_state)];
+}
+
+uint32_t TelemetryHistoryCount(const control_exchange_t* exchange)
+{
+	return __atomic_load_n(&exchange->telemetry_published, __ATOMIC_ACQUIRE);
+}
+
+uint8_t ReadTelemetryHistory(const control_exchange_t* exchange, uint32_t n, control_telemetry_t* telemetry)
+{
+	uint32_t published = __atomic_load_n(&exchange->telemetry_published, __ATOMIC_ACQUIRE);
+	if( published - n - 1 >= CONTROL_TELEMETRY_HISTORY - 1 )
+		return 0;
+
+	*telemetry = exchange->telemetry_history[n % CONTROL_TELEMETRY_HISTORY];
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	//main_task writes the slot of n again for snapshot
+	//n + CONTROL_TELEMETRY_HISTORY, while the count is that
+	published = __atomic_load_n(&exchange->telemetry_published, __ATOMIC_RELAXED);
+	return published - n < CONTROL_TELEMETRY_HISTORY;
+}
+
+param_set_t* BeginParamsWrite(control_exchange_t* exchange)
+{
+	return &exchange->params[TripleBufferWriteIndex(&exchange->params_state)];
+}
+
+void PublishParams(control_exchange_t* exchange)
+{
+	TripleBufferPublish(&exchange->params_state);
+}
+
+FAST_CODE uint8_t ReadNewParams(control_exchange_t* exchange, const param_set_t** params)
+{
+	if( !TripleBufferUpdate(&exchange->params_state) )
+		return 0;
+
+	*params = &exchange->params[TripleBufferReadIndex(&exchange->params_state)];
+	return 1;
+}
@@ -0,0 +1,146 @@
+/*
+ * ControlExchange.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CONTROLEXCHANGE_H_
+#define CONTROLEXCHANGE_H_
+
+#include <stdint.h>
+#include "TripleBuffer.h"
+#include "PID.h"
+#include "ParamStore.h"
+#include "NetLatency.h"
+#include "LatencyProbe.h"
+#include "TrajectoryBuffer.h"
+
+//Commanders are ranked by priority, 0 to CONTROL_COMMAND_PRIORITY_COUNT - 1,
+//and the highest one whose lease has not run out is in control. Each level
+//has its own hand-off so a lower priority commander's newest command is
+//ready the moment the one above it goes quiet.
+#define CONTROL_COMMAND_PRIORITY_COUNT 4
+
+//Snapshots of the last cycles kept for the batched telemetry, a power of
+//two. Covers the largest batch and the time the network can take to get
+//to it, 128 ms at 1 kHz and 25 ms at 5 kHz (CONTROL_RATE_HZ).
+#define CONTROL_TELEMETRY_HISTORY 128
+
+//Decoded command set, written by ethernet_thread and consumed by main_task.
+typedef struct control_command_t
+{
+	//ms, tick the command was received at and tick it stops being in force
+	uint32_t rx_time;
+	uint32_t lease_end;
+	//sender ms from the frame header
+	uint32_t sent_time;
+	uint8_t priority;
+
+	float vehicle_speed_commanded;
+	float steering_angle_commanded;
+	uint8_t park_brake_commanded;
+	uint8_t reverse_commanded;
+	uint8_t autonomous_mode;
+	uint8_t tele_operation_enabled;
+
+	//future setpoints of a trajectory command, 0 for a plain command
+	uint8_t trajectory_points;
+	trajectory_point_t trajectory[TRAJECTORY_BATCH_MAX];
+
+	//when the frame it came in took each hop to here (NetLatency.h)
+	net_latency_stamps_t latency;
+	//the frame's sequence and its stages with the probe bit (LatencyProbe.h)
+	latency_probe_stamps_t probe;
+} control_command_t;
+
+//Telemetry snapshot, written by main_task at the end of a cycle and sent by ethernet_thread.
+typedef struct control_telemetry_t
+{
+	float vehicle_speed;
+	float steering_angle;
+	uint8_t estop_in;
+	//PTP us the inputs were sampled at, 0 while not synced
+	uint32_t sample_time;
+	//RAM ECC errors since boot (RamEcc.h)
+	uint32_t ram_corrected;
+	uint32_t ram_uncorrectable;
+	//dead reckoned pose, m and rad (Odometry.h)
+	float odometry_x;
+	float odometry_y;
+	float odometry_heading;
+
+	pid_term_t speed_p_term;
+	pid_term_t speed_i_term;
+	pid_term_t speed_d_term;
+	pid_term_t steering_p_term;
+	pid_term_t steering_i_term;
+	pid_term_t steering_d_term;
+} control_telemetry_t;
+
+//Both directions are triple buffered so neither task ever blocks the other
+//and the reader always sees one complete, consistent set.
+typedef struct control_exchange_t
+{
+	triple_buffer_t command_state[CONTROL_COMMAND_PRIORITY_COUNT];
+	control_command_t commands[CONTROL_COMMAND_PRIORITY_COUNT][3];
+	//bit n set by the writer when level n has a new command, taken by the reader
+	uint32_t command_pending;
+	//reader only: levels whose read slot holds a command that was in force at
+	//the last check, and the level that was selected
+	uint32_t command_valid;
+	int8_t command_selected;
+
+	triple_buffer_t telemetry_state;
+	control_telemetry_t telemetry[3];
+	//every published snapshot, the one published as number n in
+	//telemetry_history[n % CONTROL_TELEMETRY_HISTORY]. Written by main_task
+	//only, telemetry_published is stored after the slot.
+	control_telemetry_t telemetry_history[CONTROL_TELEMETRY_HISTORY];
+	uint32_t telemetry_published;
+
+	//tuning parameters (ParamStore.h), written at boot and then by ethernet_thread
+	triple_buffer_t params_state;
+	param_set_t params[3];
+} control_exchange_t;
+
+void ControlExchangeInit(control_exchange_t* exchange);
+
+//Writer side (ethernet_thread). Fill every field of the returned command then
+//publish it, at the priority the commander was accepted at.
+control_command_t* BeginCommandWrite(control_exchange_t* exchange, uint8_t priority);
+void PublishCommand(control_exchange_t* exchange, uint8_t priority);
+
+//Reader side (main_task). Picks the newest command of the highest priority
+//commander whose lease has not run out at now, in constant time apart from
+//dropping levels that expired since the last call. Returns non-zero and sets
+//*command if that is a new command or another commander took over, the
+//command stays valid until the next call. Returns 0 when nothing changed or
+//no commander is in control.
+uint8_t SelectCommand(control_exchange_t* exchange, uint32_t now, const control_command_t** command);
+
+//Writer side (main_task). Fill every field of the returned snapshot then
+//publish it, which also adds it to the history.
+control_telemetry_t* BeginTelemetryWrite(control_exchange_t* exchange);
+void PublishTelemetry(control_exchange_t* exchange);
+
+//Reader side (ethernet_thread). Always returns the newest published snapshot.
+const control_telemetry_t* ReadLatestTelemetry(control_exchange_t* exchange);
+
+//Reader side, any number of readers. Snapshots published so far, the
+//number the next one gets.
+uint32_t TelemetryHistoryCount(const control_exchange_t* exchange);
+
+//Copies snapshot number n of the history to telemetry. Returns 0 if it was
+//not published yet or was, or may have been, overwritten during the copy.
+uint8_t ReadTelemetryHistory(const control_exchange_t* exchange, uint32_t n, control_telemetry_t* telemetry);
+
+//Writer side (boot, then ethernet_thread). Fill every parameter of the
+//returned set then publish it.
+param_set_t* BeginParamsWrite(control_exchange_t* exchange);
+void PublishParams(control_exchange_t* exchange);
+
+//Reader side (main_task). Returns non-zero and sets *params if a set was
+//published since the last call, the set stays valid until the next call.
+uint8_t ReadNewParams(control_exchange_t* exchange, const param_set_t** params);
+
+#endif /* CONTROLEXCHANGE_H_ */
@@ -0,0 +1,62 @@
+/*
+ * ControlPipeline.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "ControlPipeline.h"
+#include "FastCode.h"
+#include "Seqlock.h"
+
+void ControlPipelineInit(control_pipeline_t* pipeline, const control_stage_t* stages, uint8_t count)
+{
+	memset(pipeline, 0, sizeof(*pipeline));
+	pipeline->stages = stages;
+	pipeline->count = count < CONTROL_PIPELINE_MAX_STAGES ? count : CONTROL_PIPELINE_MAX_STAGES;
+}
+
+void ControlPipelineReset(control_pipeline_t* pipeline)
+{
+	SeqlockWriteBegin(&pipeline->sequence);
+	memset(pipeline->stats, 0, sizeof(pipeline->stats));
+	SeqlockWriteEnd(&pipeline->sequence);
+}
+
+FAST_CODE void ControlPipelineRun(control_pipeline_t* pipeline, struct main_context_t* ctx, uint32_t cycle)
+{
+	for(uint8_t i = 0; i < pipeline->count; ++i)
+	{
+		const control_stage_t* stage = &pipeline->stages[i];
+		if( stage->divisor > 1 && cycle % stage->divisor != stage->phase )
+			continue;
+
+		uint32_t start = ProfilerStart();
+		stage->run(ctx);
+		uint32_t cycles = ProfilerStart() - start;
+		if( stage->profile != PROFILER_STAGE_COUNT )
+			ProfilerAdd(stage->profile, cycles);
+
+		control_stage_stats_t* stats = &pipeline->stats[i];
+		SeqlockWriteBegin(&pipeline->sequence);
+		stats->runs++;
+		stats->total += cycles;
+		if( cycles > stats->max )
+			stats->max = cycles;
+		SeqlockWriteEnd(&pipeline->sequence);
+	}
+}
+
+uint8_t ControlPipelineRead(const control_pipeline_t* pipeline, uint8_t stage, control_stage_stats_t* stats)
+{
+	if( stage >= pipeline->count )
+		return 0;
+
+	uint32_t sequence;
+	do
+	{
+		sequence = SeqlockReadBegin(&pipeline->sequence);
+		*stats = pipeline->stats[stage];
+	} while( SeqlockReadRetry(&pipeline->sequence, sequence) );
+	return 1;
+}
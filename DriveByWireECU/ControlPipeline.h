@@ -0,0 +1,77 @@
+/*
+ * ControlPipeline.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CONTROLPIPELINE_H_
+#define CONTROLPIPELINE_H_
+
+#include <stdint.h>
+#include "Profiler.h"
+
+//Static rate monotonic schedule of the stages of the control cycle.
+//
+//The stages are a const table, run in table order back to back in
+//main_task, which is the order the data flows through the cycle. A stage
+//runs on the cycles where cycle % divisor == phase: divisor 1 every cycle,
+//10 at 100 Hz and 100 at 10 Hz of the 1 kHz cycle. Give the slow stages
+//different phases, so they land on different cycles rather than all on
+//the same one, the worst cycle is then the fast stages plus one slow one.
+//Nothing preempts anything, a slow stage only ever runs after every fast
+//stage before it in the table.
+//
+//Every stage's runs, mean and max core cycles are kept and served on
+//DiagServer's /pipeline page. A stage with a Profiler stage also adds its
+//time there. Without PROFILER_ENABLE only the runs are counted.
+
+#define CONTROL_PIPELINE_MAX_STAGES 20
+
+struct main_context_t;
+
+typedef struct control_stage_t
+{
+	const char* name;
+	void (*run)(struct main_context_t* ctx);
+	uint16_t divisor;
+	uint16_t phase;
+	//also timed as this Profiler stage, PROFILER_STAGE_COUNT for none
+	profiler_stage_t profile;
+} control_stage_t;
+
+//A table entry. A divisor of 0 or a phase at or above the divisor does not
+//compile.
+#define CONTROL_STAGE(name, run, divisor, phase, profile) \
+	{ name, run, divisor, (phase) + 0 * sizeof(char[(divisor) > 0 && (phase) < (divisor) ? 1 : -1]), profile }
+
+typedef struct control_stage_stats_t
+{
+	uint32_t runs;
+	uint32_t max;
+	uint64_t total;
+} control_stage_stats_t;
+
+typedef struct control_pipeline_t
+{
+	const control_stage_t* stages;
+	uint8_t count;
+	//stats are written by main_task and read under it (Seqlock.h)
+	uint32_t sequence;
+	control_stage_stats_t stats[CONTROL_PIPELINE_MAX_STAGES];
+} control_pipeline_t;
+
+//stages must stay valid for as long as the pipeline runs, count is cut to
+//CONTROL_PIPELINE_MAX_STAGES.
+void ControlPipelineInit(control_pipeline_t* pipeline, const control_stage_t* stages, uint8_t count);
+
+//Zeroes every stage's stats, from the task that runs the pipeline
+void ControlPipelineReset(control_pipeline_t* pipeline);
+
+//Runs the stages due on cycle
+void ControlPipelineRun(control_pipeline_t* pipeline, struct main_context_t* ctx, uint32_t cycle);
+
+//Consistent copy of stage's stats, safe from any task. Returns 0 past the
+//last stage.
+uint8_t ControlPipelineRead(const control_pipeline_t* pipeline, uint8_t stage, control_stage_stats_t* stats);
+
+#endif /* CONTROLPIPELINE_H_ */
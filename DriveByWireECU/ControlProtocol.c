@@ -0,0 +1,960 @@
+/*
+ * ControlProtocol.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "ControlProtocol.h"
+#include "MemoryWindow.h"
+#include "Crc32.h"
+#include "CommandAuth.h"
+#include "ByteOrder.h"
+
+uint32_t ControlProtocolCRC(const uint8_t* data, uint32_t length)
+{
+	return Crc32(data, length);
+}
+
+static void WriteHeader(uint8_t* frame, uint8_t type, uint16_t payload_length, uint32_t sequence, uint32_t timestamp)
+{
+	frame[0] = CONTROL_PROTOCOL_VERSION;
+	frame[1] = type;
+	PutLE16(&frame[2], payload_length);
+	PutLE32(&frame[4], sequence);
+	PutLE32(&frame[8], timestamp);
+}
+
+//Size of each telemetry field on the wire, in field order
+static const uint8_t telemetry_field_size[CONTROL_TELEMETRY_FIELD_COUNT] =
+{
+	4, 4, 2, 2, 1,
+	4, 4, 4, 4, 4, 4,
+	4, 4,
+	4, 2,
+};
+
+//Field mask of each group
+static const uint16_t telemetry_group_fields[CONTROL_TELEMETRY_GROUP_COUNT] =
+{
+	0x781F,	//status, fields 0-4, 11-14
+	0x07E0,	//PID, fields 5-10
+};
+
+//Returns 1 if frame is a complete, intact frame of the given type with at
+//least min_payload bytes of payload.
+static uint8_t ValidateFrame(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t type, uint16_t min_payload)
+{
+	if( ControlProtocolFrameType(frame, length) != type )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+
+	uint16_t payload_length = GetLE16(&frame[2]);
+	if( payload_length < min_payload
+		|| length != (uint32_t)CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE
+		|| GetLE32(&frame[CONTROL_HEADER_SIZE + payload_length]) != ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length) )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+	return 1;
+}
+
+void ControlProtocolInit(control_protocol_t* protocol)
+{
+	memset(protocol, 0, sizeof(*protocol));
+}
+
+uint8_t ControlProtocolFrameType(const uint8_t* frame, uint32_t length)
+{
+	if( length < CONTROL_HEADER_SIZE + CONTROL_CRC_SIZE || frame[0] != CONTROL_PROTOCOL_VERSION )
+		return 0;
+
+	return frame[1];
+}
+
+//Points in range and in increasing time order
+static uint8_t CheckTrajectory(const uint8_t* payload, uint16_t payload_length)
+{
+	uint8_t count = payload[5];
+	if( count == 0 || count > CONTROL_TRAJECTORY_MAX_POINTS
+		|| payload_length < CONTROL_TRAJECTORY_PAYLOAD_SIZE + count * CONTROL_TRAJECTORY_POINT_SIZE )
+		return 0;
+
+	const uint8_t* point = &payload[CONTROL_TRAJECTORY_PAYLOAD_SIZE];
+	for(uint8_t i = 1; i < count; ++i, point += CONTROL_TRAJECTORY_POINT_SIZE)
+	{
+		if( (int32_t)(GetLE32(&point[CONTROL_TRAJECTORY_POINT_SIZE]) - GetLE32(point)) <= 0 )
+			return 0;
+	}
+	return 1;
+}
+
+uint8_t ControlProtocolCheckCommand(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_command_info_t* info)
+{
+	uint8_t trajectory = ControlProtocolFrameType(frame, length) == CONTROL_FRAME_TRAJECTORY;
+	if( !ValidateFrame(protocol, frame, length, trajectory ? CONTROL_FRAME_TRAJECTORY : CONTROL_FRAME_COMMAND,
+		trajectory ? CONTROL_TRAJECTORY_PAYLOAD_SIZE : CONTROL_COMMAND_PAYLOAD_SIZE) )
+		return 0;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = GetLE16(&frame[2]);
+#if COMMAND_AUTH_ENABLE
+	if( !CommandAuthVerify(frame, payload_length) )
+	{
+		protocol->rx_unauthenticated++;
+		return 0;
+	}
+	//the fields end where the tag starts
+	payload_length -= COMMAND_AUTH_TAG_SIZE;
+	if( payload_length < (trajectory ? CONTROL_TRAJECTORY_PAYLOAD_SIZE : CONTROL_COMMAND_PAYLOAD_SIZE) )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+#endif
+	if( trajectory && !CheckTrajectory(payload, payload_length) )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+
+	info->sequence = GetLE32(&frame[4]);
+	info->timestamp = GetLE32(&frame[8]);
+	if( trajectory )
+	{
+		info->priority = payload[2];
+		info->lease = GetLE16(&payload[3]);
+	}
+	else
+	{
+		info->priority = payload_length > 6 ? payload[6] : CONTROL_COMMAND_DEFAULT_PRIORITY;
+		info->lease = payload_length > 8 ? GetLE16(&payload[7]) : 0;
+	}
+	if( info->lease == 0 )
+		info->lease = CONTROL_COMMAND_DEFAULT_LEASE;
+
+	if( info->priority >= CONTROL_COMMAND_PRIORITY_COUNT )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+#if COMMAND_AUTH_ENABLE
+	if( !CommandAuthFresh(info->priority, info->sequence) )
+	{
+		protocol->rx_unauthenticated++;
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+void ControlProtocolDecodeCommand(control_protocol_t* protocol, const uint8_t* frame, const control_command_info_t* info,
+	uint32_t now, control_command_t* command)
+{
+	protocol->rx_sequence = info->sequence;
+	protocol->rx_timestamp = info->timestamp;
+
+	command->rx_time = now;
+	command->lease_end = now + info->lease;
+	command->sent_time = info->timestamp;
+	command->priority = info->priority;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t boolean_commands = GetLE16(&payload[0]);
+	command->trajectory_points = 0;
+	if( frame[1] == CONTROL_FRAME_TRAJECTORY )
+	{
+		command->trajectory_points = payload[5];
+		const uint8_t* point = &payload[CONTROL_TRAJECTORY_PAYLOAD_SIZE];
+		for(uint8_t i = 0; i < command->trajectory_points; ++i, point += CONTROL_TRAJECTORY_POINT_SIZE)
+		{
+			command->trajectory[i].time = GetLE32(&point[0]);
+			command->trajectory[i].speed = (float)GetLE16(&point[4]) / (float)0xFFFF;
+			command->trajectory[i].steering = (((float)GetLE16(&point[6]) - (float)0x7FFF) / (float)0x7FFF);
+		}
+		//what is followed until the clock is synced
+		command->vehicle_speed_commanded = command->trajectory[0].speed;
+		command->steering_angle_commanded = command->trajectory[0].steering;
+	}
+	else
+	{
+		command->vehicle_speed_commanded = (float)GetLE16(&payload[2]) / (float)0xFFFF;
+		command->steering_angle_commanded = (((float)GetLE16(&payload[4]) - (float)0x7FFF) / (float)0x7FFF);
+	}
+	command->park_brake_commanded = (boolean_commands & 0x1) != 0;
+	command->reverse_commanded = (boolean_commands & 0x2) != 0;
+	command->autonomous_mode = (boolean_commands & 0x4) != 0;
+	command->tele_operation_enabled = (boolean_commands & 0x10) != 0;
+	command->probe.marked = (boolean_commands & 0x20) != 0;
+	command->probe.sequence = info->sequence;
+	command->probe.interrupt = 0;
+	command->probe.received = 0;
+}
+
+uint8_t ControlProtocolDecodeSubscribe(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_subscription_t* subscription)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_SUBSCRIBE, CONTROL_SUBSCRIBE_PAYLOAD_SIZE) )
+		return 0;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	//already in network order, first octet first
+	memcpy(&subscription->address, &payload[0], sizeof(subscription->address));
+	subscription->port = GetLE16(&payload[4]);
+	subscription->period[CONTROL_TELEMETRY_GROUP_STATUS] = GetLE16(&payload[6]);
+	subscription->period[CONTROL_TELEMETRY_GROUP_PID] = GetLE16(&payload[8]);
+	subscription->batch = GetLE16(&frame[2]) > 10 ? payload[10] : 0;
+	if( subscription->batch > CONTROL_TELEMETRY_BATCH_MAX_SAMPLES )
+		subscription->batch = CONTROL_TELEMETRY_BATCH_MAX_SAMPLES;
+	return 1;
+}
+
+uint8_t ControlProtocolDecodeBootRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length)
+{
+	return ValidateFrame(protocol, frame, length, CONTROL_FRAME_BOOT_REQUEST, 0);
+}
+
+uint16_t ControlProtocolEncodeBootData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 2;
+	boot_profile_t profile;
+
+	BootProfileRead(&profile);
+	payload[0] = profile.reset_cause;
+	payload[1] = BOOT_STAGE_COUNT;
+	for(int i = 0; i < BOOT_STAGE_COUNT; ++i)
+	{
+		PutLE32(&payload[payload_length], profile.stage_us[i]);
+		payload_length += 4;
+	}
+
+	WriteHeader(frame, CONTROL_FRAME_BOOT_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeMemoryRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	control_memory_request_t* request)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_MEMORY_REQUEST, 1) )
+		return 0;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = GetLE16(&frame[2]);
+	request->count = payload[0];
+	if( request->count == 0 || request->count > CONTROL_MEMORY_MAX_RANGES
+		|| payload_length < 1 + request->count * CONTROL_MEMORY_RANGE_SIZE )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+
+	const uint8_t* range = &payload[1];
+	for(uint8_t i = 0; i < request->count; ++i, range += CONTROL_MEMORY_RANGE_SIZE)
+	{
+		request->addresses[i] = GetLE32(&range[0]);
+		request->lengths[i] = GetLE16(&range[4]);
+	}
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeMemoryData(control_protocol_t* protocol, uint8_t* frame, const control_memory_request_t* request,
+	uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 1;
+	uint16_t room = CONTROL_MEMORY_MAX_DATA;
+	payload[0] = request->count;
+
+	for(uint8_t i = 0; i < request->count; ++i)
+	{
+		uint8_t* range = &payload[payload_length];
+		uint16_t bytes = request->lengths[i];
+		uint8_t status = CONTROL_MEMORY_OK;
+		if( !MemoryWindowAllowed(request->addresses[i], bytes) )
+			status = CONTROL_MEMORY_DENIED;
+		else if( bytes > room )
+			status = CONTROL_MEMORY_NO_ROOM;
+		if( status != CONTROL_MEMORY_OK )
+			bytes = 0;
+
+		PutLE32(&range[0], request->addresses[i]);
+		PutLE16(&range[4], bytes);
+		range[6] = status;
+		MemoryWindowRead(&range[7], request->addresses[i], bytes);
+		payload_length += 7 + bytes;
+		room -= bytes;
+	}
+
+	WriteHeader(frame, CONTROL_FRAME_MEMORY_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeDiscover(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* node_id)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_DISCOVER, CONTROL_DISCOVER_PAYLOAD_SIZE) )
+		return 0;
+
+	*node_id = frame[CONTROL_HEADER_SIZE];
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeAnnounce(control_protocol_t* protocol, uint8_t* frame, const node_identity_t* node,
+	uint16_t command_port, uint16_t param_port, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+
+	payload[0] = node->id;
+	memcpy(&payload[1], node->mac, sizeof(node->mac));
+	memcpy(&payload[7], node->ip, sizeof(node->ip));
+	PutLE16(&payload[11], command_port);
+	PutLE16(&payload[13], param_port);
+	PutLE32(&payload[15], EventLogBootCount());
+
+	WriteHeader(frame, CONTROL_FRAME_ANNOUNCE, CONTROL_ANNOUNCE_PAYLOAD_SIZE, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[CONTROL_ANNOUNCE_PAYLOAD_SIZE], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + CONTROL_ANNOUNCE_PAYLOAD_SIZE));
+	return CONTROL_ANNOUNCE_FRAME_SIZE;
+}
+
+uint8_t ControlProtocolDecodeParamRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_param_request_t* request)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_PARAM_REQUEST, CONTROL_PARAM_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = GetLE16(&frame[2]);
+	request->action = payload[0];
+	request->count = payload[1];
+	if( request->count > CONTROL_PARAM_BATCH_MAX )
+	{
+		request->count = CONTROL_PARAM_BATCH_MAX + 1;
+		return 1;
+	}
+
+	uint8_t entry_size = request->action == CONTROL_PARAM_SET ? CONTROL_PARAM_SET_ENTRY_SIZE : 1;
+	if( request->action != CONTROL_PARAM_SET && request->action != CONTROL_PARAM_READ )
+		request->count = 0;
+	if( payload_length < CONTROL_PARAM_REQUEST_PAYLOAD_SIZE + request->count * entry_size )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+
+	const uint8_t* entry = &payload[CONTROL_PARAM_REQUEST_PAYLOAD_SIZE];
+	for(uint8_t i = 0; i < request->count; ++i, entry += entry_size)
+	{
+		request->ids[i] = entry[0];
+		//the union takes float bits as they are
+		if( request->action == CONTROL_PARAM_SET )
+			request->values[i].u = GetLE32(&entry[1]);
+	}
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeParamData(control_protocol_t* protocol, uint8_t* frame, const param_set_t* params,
+	uint8_t result, uint8_t rejected, const uint8_t* ids, uint8_t count, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 8;
+
+	if( ids == NULL )
+		count = PARAM_COUNT;
+	else if( count > CONTROL_PARAM_DATA_MAX_ENTRIES )
+		count = CONTROL_PARAM_DATA_MAX_ENTRIES;
+
+	uint8_t entries = 0;
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		uint8_t id = ids == NULL ? i : ids[i];
+		const param_info_t* info = ParamInfo(id);
+		//unknown ids are left out, the PC sees which by their absence
+		if( info == NULL )
+			continue;
+
+		payload[payload_length + 0] = id;
+		payload[payload_length + 1] = (uint8_t)info->type;
+		PutLE32(&payload[payload_length + 2], params->values[id].u);
+		payload_length += CONTROL_PARAM_DATA_ENTRY_SIZE;
+		entries++;
+	}
+
+	payload[0] = result;
+	payload[1] = rejected;
+	payload[2] = (uint8_t)ParamStoreState();
+	PutLE32(&payload[3], ParamStoreSequence());
+	payload[7] = entries;
+
+	WriteHeader(frame, CONTROL_FRAME_PARAM_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+//Writes the schema entry of signal id and returns its length, at most
+//CONTROL_SCHEMA_ENTRY_MAX_SIZE
+static uint16_t EncodeSchemaEntry(uint8_t* entry, uint8_t id)
+{
+	const signal_info_t* info = SignalInfo(id);
+	uint32_t scale;
+	memcpy(&scale, &info->scale, sizeof(scale));
+	size_t name = strlen(info->name);
+	size_t unit = strlen(info->unit);
+	if( name > CONTROL_SCHEMA_NAME_MAX )
+		name = CONTROL_SCHEMA_NAME_MAX;
+	if( unit > CONTROL_SCHEMA_UNIT_MAX )
+		unit = CONTROL_SCHEMA_UNIT_MAX;
+
+	entry[0] = (uint8_t)info->type;
+	entry[1] = info->size;
+	PutLE32(&entry[2], scale);
+	entry[6] = (uint8_t)name;
+	memcpy(&entry[7], info->name, name);
+	entry[7 + name] = (uint8_t)unit;
+	memcpy(&entry[8 + name], info->unit, unit);
+	return (uint16_t)(8 + name + unit);
+}
+
+uint32_t ControlProtocolSchemaId()
+{
+	//the table is const, so is its id once known
+	static uint32_t schema_id;
+	if( schema_id == 0 )
+	{
+		uint32_t crc = CRC32_INITIAL;
+		uint8_t entry[CONTROL_SCHEMA_ENTRY_MAX_SIZE];
+		for(uint8_t id = 0; id < SIGNAL_COUNT; ++id)
+			crc = Crc32Update(crc, entry, EncodeSchemaEntry(entry, id));
+		schema_id = ~crc;
+	}
+	return schema_id;
+}
+
+uint8_t ControlProtocolDecodeSchemaRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* first)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_SCHEMA_REQUEST, CONTROL_SCHEMA_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	*first = frame[CONTROL_HEADER_SIZE];
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeSchema(control_protocol_t* protocol, uint8_t* frame, uint8_t first, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 7;
+	uint8_t entries = 0;
+
+	PutLE32(&payload[0], ControlProtocolSchemaId());
+	payload[4] = SIGNAL_COUNT;
+	payload[5] = first;
+	for(uint16_t id = first; id < SIGNAL_COUNT && entries < CONTROL_SCHEMA_ENTRIES_PER_FRAME; ++id, ++entries)
+		payload_length += EncodeSchemaEntry(&payload[payload_length], (uint8_t)id);
+	payload[6] = entries;
+
+	WriteHeader(frame, CONTROL_FRAME_SCHEMA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeSignalSubscribe(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	control_signal_subscription_t* subscription)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_SIGNAL_SUBSCRIBE, CONTROL_SIGNAL_SUBSCRIBE_PAYLOAD_SIZE) )
+		return 0;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = GetLE16(&frame[2]);
+	//already in network order, first octet first
+	memcpy(&subscription->address, &payload[0], sizeof(subscription->address));
+	subscription->port = GetLE16(&payload[4]);
+	subscription->tag = payload[6];
+	subscription->period = GetLE16(&payload[7]);
+	subscription->count = payload[9];
+	if( subscription->count > CONTROL_SIGNAL_SET_MAX || (subscription->count == 0 && subscription->period != 0)
+		|| payload_length < CONTROL_SIGNAL_SUBSCRIBE_PAYLOAD_SIZE + subscription->count )
+	{
+		protocol->rx_invalid++;
+		return 0;
+	}
+
+	for(uint8_t i = 0; i < subscription->count; ++i)
+	{
+		subscription->ids[i] = payload[CONTROL_SIGNAL_SUBSCRIBE_PAYLOAD_SIZE + i];
+		if( subscription->ids[i] >= SIGNAL_COUNT )
+		{
+			protocol->rx_invalid++;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeSignalData(control_protocol_t* protocol, uint8_t* frame, uint8_t tag, const uint8_t* ids,
+	uint8_t count, uint32_t timestamp)
+{
+	if( count > CONTROL_SIGNAL_SET_MAX )
+		count = CONTROL_SIGNAL_SET_MAX;
+
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 6;
+	payload[0] = tag;
+	PutLE32(&payload[1], ControlProtocolSchemaId());
+	payload[5] = count;
+
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		const signal_info_t* info = SignalInfo(ids[i]);
+		signal_value_t value;
+		SignalRead((signal_id_t)ids[i], &value);
+		uint32_t wire = value.u;
+		//through int32_t, the FPU saturates a negative float converted straight to unsigned at 0
+		if( info->type == SIGNAL_TYPE_FLOAT && info->scale != 0 )
+			wire = (uint32_t)(int32_t)(value.f / info->scale);
+
+		if( info->size == 4 )
+			PutLE32(&payload[payload_length], wire);
+		else if( info->size == 2 )
+			PutLE16(&payload[payload_length], (uint16_t)wire);
+		else
+			payload[payload_length] = (uint8_t)wire;
+		payload_length += info->size;
+	}
+
+	WriteHeader(frame, CONTROL_FRAME_SIGNAL_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeCalibrationRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	uint8_t* action)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_CALIBRATION_REQUEST, CONTROL_CALIBRATION_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	*action = frame[CONTROL_HEADER_SIZE];
+	return 1;
+}
+
+static inline void PutFloat(uint8_t* p, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	PutLE32(p, bits);
+}
+
+static inline float GetFloat(const uint8_t* p)
+{
+	uint32_t bits = GetLE32(p);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+uint16_t ControlProtocolEncodeCalibrationData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 16;
+	steering_sweep_status_t status;
+	SteeringSweepStatus(&status);
+	const steering_calibration_t* table = SteeringCalibrationCurrent();
+	uint32_t count = table->count;
+	if( count > STEERING_CALIBRATION_MAX_POINTS )
+		count = STEERING_CALIBRATION_MAX_POINTS;
+
+	payload[0] = status.state;
+	payload[1] = status.result;
+	PutLE32(&payload[2], status.elapsed);
+	PutLE16(&payload[6], status.left_code);
+	PutLE16(&payload[8], status.right_code);
+	PutFloat(&payload[10], status.span);
+	payload[14] = table->magic == STEERING_CALIBRATION_MAGIC;
+	payload[15] = (uint8_t)count;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		PutFloat(&payload[payload_length], table->voltages[i]);
+		PutFloat(&payload[payload_length + 4], table->positions[i]);
+		payload_length += 8;
+	}
+
+	WriteHeader(frame, CONTROL_FRAME_CALIBRATION_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeAutotuneRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	uint8_t* action, uint8_t* loop)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_AUTOTUNE_REQUEST, CONTROL_AUTOTUNE_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	*action = frame[CONTROL_HEADER_SIZE];
+	*loop = frame[CONTROL_HEADER_SIZE + 1];
+	return 1;
+}
+
+static void PutGains(uint8_t* p, const pid_autotune_gains_t* gains)
+{
+	PutFloat(&p[0], gains->p);
+	PutFloat(&p[4], gains->i);
+	PutFloat(&p[8], gains->d);
+}
+
+uint16_t ControlProtocolEncodeAutotuneData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	pid_autotune_status_t status;
+	PIDAutotuneStatus(&status);
+
+	payload[0] = status.state;
+	payload[1] = status.loop;
+	payload[2] = status.result;
+	payload[3] = status.periods;
+	PutLE32(&payload[4], status.elapsed);
+	PutFloat(&payload[8], status.bias);
+	PutFloat(&payload[12], status.oscillation);
+	PutFloat(&payload[16], status.ultimate_gain);
+	PutFloat(&payload[20], status.ultimate_period);
+	PutGains(&payload[24], &status.ziegler_nichols);
+	PutGains(&payload[36], &status.tyreus_luyben);
+
+	WriteHeader(frame, CONTROL_FRAME_AUTOTUNE_DATA, CONTROL_AUTOTUNE_DATA_PAYLOAD_SIZE, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[CONTROL_AUTOTUNE_DATA_PAYLOAD_SIZE],
+		ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + CONTROL_AUTOTUNE_DATA_PAYLOAD_SIZE));
+	return CONTROL_AUTOTUNE_FRAME_SIZE;
+}
+
+uint8_t ControlProtocolDecodeExcitationRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	uint8_t* action, excitation_config_t* config)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_EXCITATION_REQUEST, CONTROL_EXCITATION_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	*action = payload[0];
+	config->output = (excitation_output_t)payload[1];
+	config->waveform = (excitation_waveform_t)payload[2];
+	config->steer_right = payload[3] != 0;
+	config->hold = GetLE16(&payload[4]);
+	config->samples = GetLE16(&payload[6]);
+	config->offset = GetFloat(&payload[8]);
+	config->amplitude = GetFloat(&payload[12]);
+	config->start_hz = GetFloat(&payload[16]);
+	config->end_hz = GetFloat(&payload[20]);
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeExcitationData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	excitation_status_t status;
+	ExcitationStatus(&status);
+
+	payload[0] = status.state;
+	payload[1] = status.result;
+	payload[2] = status.output;
+	payload[3] = status.waveform;
+	PutLE32(&payload[4], status.elapsed);
+	PutLE16(&payload[8], status.samples);
+	PutLE16(&payload[10], status.hold);
+	PutLE16(&payload[12], status.captured);
+	PutFloat(&payload[14], status.sample_rate);
+
+	WriteHeader(frame, CONTROL_FRAME_EXCITATION_DATA, CONTROL_EXCITATION_DATA_PAYLOAD_SIZE, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[CONTROL_EXCITATION_DATA_PAYLOAD_SIZE],
+		ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + CONTROL_EXCITATION_DATA_PAYLOAD_SIZE));
+	return CONTROL_EXCITATION_FRAME_SIZE;
+}
+
+void ControlProtocolQuantizeTelemetry(const control_protocol_t* protocol, const control_telemetry_t* telemetry, uint32_t values[CONTROL_TELEMETRY_FIELD_COUNT])
+{
+	values[0] = protocol->rx_sequence;
+	values[1] = protocol->rx_timestamp;
+	//through int16_t, the FPU saturates a negative float converted straight to unsigned at 0
+	values[2] = (uint16_t)(int16_t)(telemetry->vehicle_speed * 100);
+	values[3] = (uint16_t)(int16_t)(telemetry->steering_angle * 10);
+	values[4] = telemetry->estop_in > 0;
+	values[5] = (uint32_t)PID_TERM_TO_INT(telemetry->speed_p_term);
+	values[6] = (uint32_t)PID_TERM_TO_INT(telemetry->speed_i_term);
+	values[7] = (uint32_t)PID_TERM_TO_INT(telemetry->speed_d_term);
+	values[8] = (uint32_t)PID_TERM_TO_INT(telemetry->steering_p_term);
+	values[9] = (uint32_t)PID_TERM_TO_INT(telemetry->steering_i_term);
+	values[10] = (uint32_t)PID_TERM_TO_INT(telemetry->steering_d_term);
+	values[11] = protocol->rx_ptp_time;
+	values[12] = telemetry->sample_time;
+	values[13] = telemetry->ram_corrected;
+	//saturates rather than wraps, any is too many
+	values[14] = telemetry->ram_uncorrectable < 0xFFFF ? telemetry->ram_uncorrectable : 0xFFFF;
+}
+
+uint16_t ControlProtocolGroupFields(control_telemetry_group_t group)
+{
+	return telemetry_group_fields[group];
+}
+
+uint16_t ControlProtocolEncodeTelemetry(control_protocol_t* protocol, uint8_t* frame, control_telemetry_group_t group,
+	uint16_t mask, const uint32_t values[CONTROL_TELEMETRY_FIELD_COUNT], uint32_t timestamp)
+{
+	mask &= telemetry_group_fields[group];
+
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 3;
+	payload[0] = (uint8_t)group;
+	PutLE16(&payload[1], mask);
+
+	for(int i = 0; i < CONTROL_TELEMETRY_FIELD_COUNT; ++i)
+	{
+		if( !(mask & (1 << i)) )
+			continue;
+
+		if( telemetry_field_size[i] == 4 )
+			PutLE32(&payload[payload_length], values[i]);
+		else if( telemetry_field_size[i] == 2 )
+			PutLE16(&payload[payload_length], (uint16_t)values[i]);
+		else
+			payload[payload_length] = (uint8_t)values[i];
+		payload_length += telemetry_field_size[i];
+	}
+
+	WriteHeader(frame, CONTROL_FRAME_TELEMETRY, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint16_t ControlProtocolEncodeTelemetryBatch(control_protocol_t* protocol, uint8_t* frame, const control_telemetry_t* samples,
+	uint8_t count, uint32_t first, uint32_t lost, uint32_t timestamp)
+{
+	if( count > CONTROL_TELEMETRY_BATCH_MAX_SAMPLES )
+		count = CONTROL_TELEMETRY_BATCH_MAX_SAMPLES;
+
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 9;
+	payload[0] = count;
+	PutLE32(&payload[1], first);
+	PutLE32(&payload[5], lost);
+
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		//the same quantization the telemetry frames use
+		uint32_t values[CONTROL_TELEMETRY_FIELD_COUNT];
+		ControlProtocolQuantizeTelemetry(protocol, &samples[i], values);
+
+		uint8_t* sample = &payload[payload_length];
+		PutLE32(&sample[0], values[12]);
+		PutLE16(&sample[4], (uint16_t)values[2]);
+		PutLE16(&sample[6], (uint16_t)values[3]);
+		sample[8] = (uint8_t)values[4];
+		for(int f = 0; f < 6; ++f)
+			PutLE32(&sample[9 + f * 4], values[5 + f]);
+		PutLE32(&sample[33], (uint32_t)(int32_t)(samples[i].odometry_x * 1000));
+		PutLE32(&sample[37], (uint32_t)(int32_t)(samples[i].odometry_y * 1000));
+		PutLE16(&sample[41], (uint16_t)(int16_t)(samples[i].odometry_heading * 10000));
+		payload_length += CONTROL_TELEMETRY_BATCH_SAMPLE_SIZE;
+	}
+
+	WriteHeader(frame, CONTROL_FRAME_TELEMETRY_BATCH, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeTraceRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_trace_request_t* request)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_TRACE_REQUEST, CONTROL_TRACE_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	request->action = payload[0];
+	request->triggers = payload[1];
+	request->first = GetLE16(&payload[2]);
+	request->step_threshold = (int32_t)GetLE32(&payload[4]);
+	request->error_threshold = (int32_t)GetLE32(&payload[8]);
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeTraceData(control_protocol_t* protocol, uint8_t* frame, const pid_trace_t* trace,
+	uint16_t first, uint16_t* samples, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 11;
+	uint16_t count = 0;
+
+	const pid_trace_sample_t* sample;
+	while( count < CONTROL_TRACE_SAMPLES_PER_FRAME && (sample = PIDTraceSample(trace, first + count)) != NULL )
+	{
+		PutLE32(&payload[payload_length], sample->tick);
+		payload_length += 4;
+		for(int c = 0; c < PID_TRACE_CONTROLLER_COUNT; ++c)
+		{
+			const pid_trace_term_t* term = &sample->controller[c];
+			PutLE32(&payload[payload_length + 0], (uint32_t)term->setpoint);
+			PutLE32(&payload[payload_length + 4], (uint32_t)term->feedback);
+			PutLE32(&payload[payload_length + 8], (uint32_t)term->error);
+			PutLE32(&payload[payload_length + 12], (uint32_t)term->integral);
+			PutLE32(&payload[payload_length + 16], (uint32_t)term->p_term);
+			PutLE32(&payload[payload_length + 20], (uint32_t)term->i_term);
+			PutLE32(&payload[payload_length + 24], (uint32_t)term->d_term);
+			PutLE32(&payload[payload_length + 28], (uint32_t)term->output);
+			payload_length += 32;
+		}
+		count++;
+	}
+
+	pid_trace_state_t state = PIDTraceState(trace);
+	payload[0] = (uint8_t)state;
+	payload[1] = state == PID_TRACE_ARMED ? 0 : trace->trigger_reason;
+	PutLE16(&payload[2], state == PID_TRACE_FROZEN ? trace->count : 0);
+	PutLE16(&payload[4], first);
+	payload[6] = (uint8_t)count;
+	PutLE32(&payload[7], state == PID_TRACE_ARMED ? 0 : trace->trigger_tick);
+
+	WriteHeader(frame, CONTROL_FRAME_TRACE_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	*samples = count;
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeProfileRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* action)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_PROFILE_REQUEST, CONTROL_PROFILE_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	*action = frame[CONTROL_HEADER_SIZE];
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeProfileData(control_protocol_t* protocol, uint8_t* frame, uint32_t core_clock,
+	const control_load_stats_t* load, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 6;
+
+	PutLE32(&payload[0], core_clock);
+	payload[4] = PROFILER_STAGE_COUNT;
+	payload[5] = PROFILER_HISTOGRAM_BINS;
+
+	for(int i = 0; i < PROFILER_STAGE_COUNT; ++i)
+	{
+		profiler_stats_t stats;
+		ProfilerRead((profiler_stage_t)i, &stats);
+
+		uint8_t empty = stats.count == 0;
+		PutLE32(&payload[payload_length + 0], stats.count);
+		PutLE32(&payload[payload_length + 4], empty ? 0 : stats.min);
+		PutLE32(&payload[payload_length + 8], empty ? 0 : stats.max);
+		PutLE32(&payload[payload_length + 12], empty ? 0 : (uint32_t)(stats.total / stats.count));
+		payload_length += 16;
+		for(int b = 0; b < PROFILER_HISTOGRAM_BINS; ++b)
+		{
+			PutLE32(&payload[payload_length], stats.histogram[b]);
+			payload_length += 4;
+		}
+	}
+
+	payload[payload_length++] = CACHE_MONITOR_ENABLE ? CACHE_MONITOR_SECTION_COUNT : 0;
+	for(int i = 0; CACHE_MONITOR_ENABLE && i < CACHE_MONITOR_SECTION_COUNT; ++i)
+	{
+		cache_monitor_stats_t stats;
+		CacheMonitorRead((cache_monitor_section_t)i, &stats);
+
+		for(int e = 0; e < CACHE_MONITOR_EVENT_COUNT; ++e)
+		{
+			uint32_t samples = stats.samples[e];
+			PutLE32(&payload[payload_length + 0], samples);
+			PutLE32(&payload[payload_length + 4], samples ? (uint32_t)(stats.hits[e] / samples) : 0);
+			PutLE32(&payload[payload_length + 8], samples ? (uint32_t)(stats.cycles[e] / samples) : 0);
+			payload_length += 12;
+		}
+		PutLE32(&payload[payload_length], stats.skipped);
+		payload_length += 4;
+	}
+
+	PutLE32(&payload[payload_length + 0], load->cycles);
+	PutLE32(&payload[payload_length + 4], load->overruns);
+	PutLE32(&payload[payload_length + 8], load->rx_frames);
+	PutLE32(&payload[payload_length + 12], load->rx_dropped);
+	PutLE32(&payload[payload_length + 16], load->link_dropped);
+	payload_length += CONTROL_PROFILE_LOAD_SIZE;
+
+	WriteHeader(frame, CONTROL_FRAME_PROFILE_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeTaskRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length)
+{
+	return ValidateFrame(protocol, frame, length, CONTROL_FRAME_TASK_REQUEST, 0);
+}
+
+uint16_t ControlProtocolEncodeTaskData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 5;
+	task_monitor_snapshot_t snapshot;
+
+	TaskMonitorRead(&snapshot);
+	PutLE32(&payload[0], snapshot.period);
+	payload[4] = snapshot.count;
+
+	for(int i = 0; i < snapshot.count; ++i)
+	{
+		const task_monitor_entry_t* task = &snapshot.tasks[i];
+		payload[payload_length + 0] = task->number;
+		payload[payload_length + 1] = task->priority;
+		PutLE16(&payload[payload_length + 2], task->load);
+		PutLE16(&payload[payload_length + 4], task->stack_free);
+		memset(&payload[payload_length + 6], 0, CONTROL_TASK_NAME_SIZE);
+		memcpy(&payload[payload_length + 6], task->name, configMAX_TASK_NAME_LEN < CONTROL_TASK_NAME_SIZE ? configMAX_TASK_NAME_LEN : CONTROL_TASK_NAME_SIZE);
+		payload_length += CONTROL_TASK_ENTRY_SIZE;
+	}
+
+	WriteHeader(frame, CONTROL_FRAME_TASK_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+uint8_t ControlProtocolDecodeEventRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint32_t* first)
+{
+	if( !ValidateFrame(protocol, frame, length, CONTROL_FRAME_EVENT_REQUEST, CONTROL_EVENT_REQUEST_PAYLOAD_SIZE) )
+		return 0;
+
+	*first = GetLE32(&frame[CONTROL_HEADER_SIZE]);
+	return 1;
+}
+
+uint16_t ControlProtocolEncodeEventData(control_protocol_t* protocol, uint8_t* frame, uint32_t first, uint32_t timestamp)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t payload_length = 9;
+	uint32_t next = EventLogNext();
+	uint8_t count = 0;
+
+	//nothing older than the ring is left
+	uint32_t oldest = next > EVENT_LOG_DEPTH ? next - EVENT_LOG_DEPTH : 1;
+	if( first < oldest )
+		first = oldest;
+
+	for(uint32_t sequence = first; sequence < next && count < CONTROL_EVENTS_PER_FRAME; ++sequence)
+	{
+		event_log_entry_t entry;
+		if( !EventLogRead(sequence, &entry) )
+			continue;
+
+		PutLE32(&payload[payload_length + 0], entry.sequence);
+		PutLE32(&payload[payload_length + 4], entry.tick);
+		PutLE16(&payload[payload_length + 8], entry.id);
+		PutLE16(&payload[payload_length + 10], entry.arg);
+		PutLE32(&payload[payload_length + 12], entry.value);
+		payload_length += CONTROL_EVENT_ENTRY_SIZE;
+		count++;
+	}
+
+	PutLE32(&payload[0], EventLogBootCount());
+	PutLE32(&payload[4], next);
+	payload[8] = count;
+
+	WriteHeader(frame, CONTROL_FRAME_EVENT_DATA, payload_length, protocol->tx_sequence++, timestamp);
+	PutLE32(&payload[payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
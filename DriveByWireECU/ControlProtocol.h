@@ -0,0 +1,883 @@
+/*
+ * ControlProtocol.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CONTROLPROTOCOL_H_
+#define CONTROLPROTOCOL_H_
+
+#include <stdint.h>
+#include "ControlExchange.h"
+#include "PIDTrace.h"
+#include "Profiler.h"
+#include "CacheMonitor.h"
+#include "TaskMonitor.h"
+#include "EventLog.h"
+#include "ParamStore.h"
+#include "BootProfile.h"
+#include "NodeIdentity.h"
+#include "SignalBus.h"
+#include "SteeringSweep.h"
+#include "PIDAutotune.h"
+#include "Excitation.h"
+
+//UDP protocol between the ECU and the driving PC.
+//
+//!!!WARNING!!!
+//If you change a frame layout you MUST bump CONTROL_PROTOCOL_VERSION and
+//update the PC side software with the new layout.
+//
+//Every field is little-endian and there is no padding. A frame is:
+//
+//	offset	size	field
+//	0		1		version, CONTROL_PROTOCOL_VERSION
+//	1		1		type, CONTROL_FRAME_*
+//	2		2		payload length in bytes
+//	4		4		sequence, incremented by the sender for every frame
+//	8		4		timestamp, sender time in milliseconds
+//	12		n		payload
+//	12+n	4		CRC-32 (IEEE 802.3) of everything before it
+//
+//Command payload, PC -> ECU:
+//
+//	0		2		boolean commands
+//					0x1: parking_brake_commanded
+//					0x2: reverse_commanded
+//					0x4: autonomous mode
+//					0x8: unused, was override_pid. The gains are
+//					parameters now, see the param request.
+//					0x10: tele_operation_mode
+//					0x20: latency probe marker, the command's
+//					stages are timed (LatencyProbe.h)
+//	2		2		vehicle speed commanded, RAW / 0xFFFF
+//	4		2		steering angle commanded, (RAW - 0x7FFF) / 0x7FFF
+//	6		1		commander priority, higher wins, below
+//					CONTROL_COMMAND_PRIORITY_COUNT. Left out:
+//					CONTROL_COMMAND_DEFAULT_PRIORITY
+//	7		2		lease in ms, how long the command stays in force
+//					without a newer one. Left out or 0:
+//					CONTROL_COMMAND_DEFAULT_LEASE
+//
+//Trajectory payload, PC -> ECU. A command whose speed and steering are
+//future setpoints the ECU follows on its own clock (TrajectoryBuffer.h),
+//so the PC can send at 10 - 20 Hz while the loops track at 1 kHz. It is
+//arbitrated like a command and its points replace what the ECU held from
+//the first point on. Until the ECU has synced its PTP clock the first point
+//is taken as a plain command.
+//
+//	0		2		boolean commands, as the command's
+//	2		1		commander priority, as the command's
+//	3		2		lease in ms, as the command's. 0:
+//					CONTROL_COMMAND_DEFAULT_LEASE
+//	5		1		points that follow, 1 to CONTROL_TRAJECTORY_MAX_POINTS
+//	6		...		points in increasing time order,
+//					CONTROL_TRAJECTORY_POINT_SIZE bytes each:
+//					0	4	PTP time in us the setpoint is for, low 32 bits
+//					4	2	vehicle speed, as the command's
+//					6	2	steering angle, as the command's
+//
+//With COMMAND_AUTH_ENABLE both payloads end with a tag, counted in the
+//payload length, after the last field (CommandAuth.h).
+//
+//Several commanders can send at once, e.g. the planner, a teleop station
+//and a safety monitor (CommandArbiter.h). Each priority level is held by one
+//sender, address and port, until its lease runs out, and the highest level
+//in force is what the ECU obeys.
+//
+//Subscribe payload, PC -> ECU. Asks for telemetry for the next
+//CONTROL_SUBSCRIPTION_LEASE ms, so it has to be repeated to keep the stream.
+//Until somebody subscribes, the status group is broadcast at its default rate.
+//
+//	0		4		destination address, first octet first. 0 sends to the
+//					address the subscribe came from, a multicast group
+//					address sends to that group.
+//	4		2		destination port, 0 for the port the subscribe came from
+//	6		2		status group period in ms, 0 to stop
+//	8		2		PID group period in ms, 0 to stop
+//	10		1		samples per batched telemetry frame, up to
+//					CONTROL_TELEMETRY_BATCH_MAX_SAMPLES. Left out or 0: no
+//					batched telemetry
+//
+//Telemetry payload, ECU -> PC. Fields are split into groups that are sent
+//at their own rate, and a frame only carries the fields of its group that
+//changed since the last frame sent to that subscriber. Every group is sent
+//in full at least every CONTROL_TELEMETRY_REFRESH ms, which also bounds how
+//long a lost frame leaves a value stale.
+//
+//	0		1		group, CONTROL_TELEMETRY_GROUP_*
+//	1		2		field mask, bit n set if field n follows
+//	3		...		the fields present, in field order
+//
+//	field	size	group	value
+//	0		4		status	sequence of the last accepted command
+//	1		4		status	timestamp of the last accepted command, echoed
+//							unchanged so the PC can measure the round trip
+//	2		2		status	vehicle speed, signed, value / 0.01 (m/s)
+//	3		2		status	steering angle, signed, value / 0.1 (degrees)
+//	4		1		status	boolean states
+//							0x1: estop_state
+//	5		4		PID		speed p term, signed
+//	6		4		PID		speed i term
+//	7		4		PID		speed d term
+//	8		4		PID		steering p term
+//	9		4		PID		steering i term
+//	10		4		PID		steering d term
+//	11		4		status	PTP time in us, low 32 bits, the last accepted
+//							command was received at (Ptp.h). 0 while the ECU
+//							has not synced.
+//	12		4		status	PTP time in us the inputs of the values sent
+//							were sampled at, 0 while not synced
+//	13		4		status	RAM errors corrected since boot (RamEcc.h)
+//	14		2		status	uncorrectable RAM errors since boot
+//
+//Batched telemetry payload, ECU -> PC, to subscribers that asked for a
+//batch. Carries the snapshot of every control cycle, batch consecutive ones
+//per frame, so the PC gets the whole 1 kHz stream for one datagram every
+//batch cycles. Every sample is sent in full, there is no field mask.
+//
+//	0		1		samples in this frame
+//	1		4		number of the first sample, counted from boot, the
+//					others follow a control cycle apart each
+//	5		4		samples this subscriber lost since it subscribed,
+//					overwritten before the network got to them
+//	9		...		samples, CONTROL_TELEMETRY_BATCH_SAMPLE_SIZE bytes each:
+//					0	4	telemetry field 12, sample PTP time
+//					4	2	field 2, vehicle speed
+//					6	2	field 3, steering angle
+//					8	1	field 4, boolean states
+//					9	24	fields 5-10, the PID terms
+//					33	4	odometry x, signed, value / 1000 (m)
+//					37	4	odometry y, signed, value / 1000 (m)
+//					41	2	odometry heading, signed, value / 10000 (rad)
+//
+//The odometry (Odometry.h) is only in the batches, every cycle of it: a pose
+//sampled at the telemetry rates would leave the PC to interpolate what the
+//ECU already integrated.
+//
+//Trace request payload, PC -> ECU. Controls the on-board PID trace (PIDTrace.h).
+//
+//	0		1		action, CONTROL_TRACE_*
+//	1		1		rearm only, PID_TRACE_TRIGGER_* sources to enable
+//	2		2		read only, index of the first sample wanted, oldest is 0
+//	4		4		rearm only, setpoint step that triggers, signed
+//	8		4		rearm only, |error| that triggers, signed
+//
+//Every trace request is answered with trace data frames. A read gets up to
+//CONTROL_TRACE_FRAMES_PER_REQUEST frames of consecutive samples, the other
+//actions and a read of a trace that is not frozen get one frame with no
+//samples that only reports the state.
+//
+//Trace data payload, ECU -> PC:
+//
+//	0		1		state, pid_trace_state_t
+//	1		1		PID_TRACE_TRIGGER_* sources that fired
+//	2		2		samples in the trace
+//	4		2		index of the first sample in this frame
+//	6		1		samples in this frame
+//	7		4		control tick of the trigger
+//	11		...		samples, each a 4 byte tick followed by the steering
+//					then the speed controller as 8 signed 4 byte values:
+//					setpoint, feedback, error, integral, p term, i term,
+//					d term, output
+//
+//Profile request payload, PC -> ECU. Answered with one profile data frame.
+//
+//	0		1		action, CONTROL_PROFILE_*. A reset is answered with the
+//					stats from before the reset.
+//
+//Profile data payload, ECU -> PC. Control loop stage timings (Profiler.h),
+//all times in core cycles.
+//
+//	0		4		core clock in Hz
+//	4		1		stages that follow, in profiler_stage_t order
+//	5		1		histogram bins per stage
+//	6		...		for every stage: samples, min, max, mean, then the
+//					histogram bins, each 4 bytes unsigned. min, max and
+//					mean are 0 for a stage with no samples.
+//	...		1		cache sections that follow, in cache_monitor_section_t
+//					order, 0 when CACHE_MONITOR_ENABLE is off
+//	...		...		for every cache section, each 4 bytes unsigned:
+//					instruction hit samples, mean hits, mean core cycles,
+//					data hit samples, mean hits, mean core cycles, and
+//					samples skipped because the counter was in use.
+//					Means are 0 with no samples. The CMCC counts no misses,
+//					compare hits per core cycle instead (CacheMonitor.h).
+//	...		20		load counters since boot, each 4 bytes unsigned:
+//					control cycles run, control cycles overrun
+//					(ControlScheduler.h), frames the GMAC received, frames
+//					the GMAC dropped for a full ring or no buffer, frames
+//					lwIP dropped (0 without LINK_STATS). A reset leaves
+//					them running, take the difference of two reads.
+//
+//Task request payload, PC -> ECU. Empty, answered with one task data frame.
+//
+//Task data payload, ECU -> PC. Load and stack use of every RTOS task over
+//the last TaskMonitor period (TaskMonitor.h).
+//
+//	0		4		ms the loads cover, 0 before the first period ended
+//	4		1		tasks that follow
+//	5		...		for every task:
+//					0	1	task number
+//					1	1	base priority
+//					2	2	CPU load, value / 10 (%)
+//					4	2	least stack ever free, in words
+//					6	8	name, zero padded
+//
+//Event request payload, PC -> ECU. Answered with one event data frame.
+//
+//	0		4		sequence number of the first event wanted, 0 for the
+//					oldest one kept
+//
+//Event data payload, ECU -> PC. Entries of the event log (EventLog.h),
+//oldest first. Events that were overwritten or are being written are left
+//out, ask again from the last sequence number sent + 1 for the next ones.
+//
+//	0		4		boots recorded in the log
+//	4		4		sequence number the next event gets
+//	8		1		events in this frame
+//	9		...		for every event:
+//					0	4	sequence number
+//					4	4	RTOS tick, restarts with every boot
+//					8	2	event_log_id_t
+//					10	2	arg
+//					12	4	value
+//
+//Param request payload, PC -> ECU, on its own port (EthernetIO.c), so
+//tuning traffic never queues with the commands. Reads or changes the tuning
+//parameters (ParamStore.h), answered with one param data frame.
+//
+//	0		1		action, CONTROL_PARAM_*
+//	1		1		entries that follow, up to CONTROL_PARAM_BATCH_MAX
+//	2		...		read: a param_id_t per entry, none reads them all
+//					set: per entry the param_id_t (1 byte) then the value
+//					(4 bytes), an IEEE 754 float for float parameters
+//					save, defaults: none
+//
+//A set is all or nothing: if any entry has an unknown id or an out of range
+//value none of them are applied. Otherwise they all take effect together at
+//the start of the next control cycle. Only a save keeps the parameters in
+//force over a power cycle.
+//
+//Param data payload, ECU -> PC, the parameters as they are in force.
+//
+//	0		1		result, CONTROL_PARAM_RESULT_*
+//	1		1		rejected only, index of the first entry that was not
+//					accepted
+//	2		1		param_store_state_t
+//	3		4		sequence number of the last save in NVM, 0 for none
+//	7		1		entries that follow. Those read, or all of them after
+//					any other action.
+//	8		...		per entry: param_id_t (1 byte), param_type_t (1 byte)
+//					then the value (4 bytes)
+//
+//Boot request payload, PC -> ECU. Empty, answered with one boot data frame.
+//
+//Boot data payload, ECU -> PC. How long this boot took to get to each stage
+//(BootProfile.h).
+//
+//	0		1		RSTC RCAUSE of this boot
+//	1		1		stages that follow, in boot_stage_t order
+//	2		...		for every stage: us from main to the end of the stage,
+//					4 bytes unsigned, 0xFFFFFFFF if it was not reached yet
+//
+//Memory request payload, PC -> ECU. Reads RAM the ECU leaves open
+//(MemoryWindow.h), answered with one memory data frame. The PC resolves
+//symbol + offset to an address from the ELF file of the running build.
+//
+//	0		1		ranges that follow, 1 to CONTROL_MEMORY_MAX_RANGES
+//	1		...		per range, CONTROL_MEMORY_RANGE_SIZE bytes:
+//					0	4	address
+//					4	2	bytes wanted
+//
+//Memory data payload, ECU -> PC, the ranges in request order.
+//
+//	0		1		ranges that follow
+//	1		...		per range:
+//					0	4	address
+//					4	2	bytes that follow, 0 unless status is 0
+//					6	1	status, CONTROL_MEMORY_*
+//					7	...	the bytes, as they were in RAM
+//
+//All ranges together return at most CONTROL_MEMORY_MAX_DATA bytes, the
+//ones past that are answered with CONTROL_MEMORY_NO_ROOM. Each range is
+//copied as MemoryWindowRead does, the ranges one after the other: values
+//main_task changes every cycle may be from different cycles.
+//
+//Discover request payload, PC -> ECU, on the discovery port, usually as a
+//broadcast. Every node it names answers with an announce frame.
+//
+//	0		1		node id, NODE_ANY for every node (NodeIdentity.h)
+//
+//Announce payload, ECU -> PC. Sent to the requester of a discovery, and
+//unasked to the telemetry group on the discovery port at boot and every
+//few seconds after.
+//
+//	0		1		node id
+//	1		6		MAC
+//	7		4		IP, first octet first
+//	11		2		command port
+//	13		2		param port
+//	15		4		boot count, as in the event data
+//
+//Schema request payload, PC -> ECU. Asks which signals the ECU has
+//(SignalBus.h), answered with one schema frame.
+//
+//	0		1		id of the first signal wanted, 0 for all of them
+//
+//Schema payload, ECU -> PC. Up to CONTROL_SCHEMA_ENTRIES_PER_FRAME signals
+//from the first one asked for on, ask again from first + entries for the
+//rest.
+//
+//	0		4		schema id, a CRC-32 of every entry of every signal.
+//					Changes with any signal added or changed, the signal
+//					data frames carry it.
+//	4		1		signals the ECU has, ids 0 to this - 1
+//	5		1		id of the first entry
+//	6		1		entries that follow, for consecutive ids
+//	7		...		per entry:
+//					0	1	signal_type_t
+//					1	1	size on the wire
+//					2	4	scale, an IEEE 754 float. A float signal is sent
+//							as the signed integer value / scale, with a
+//							scale of 0 as the float itself. A uint is its
+//							low bytes.
+//					6	1	length of the name
+//					7	n	name, not terminated
+//					7+n	1	length of the unit, 0 for none
+//					8+n	m	unit, not terminated
+//
+//Signal subscribe payload, PC -> ECU. Asks for a set of signals, picked by
+//id from the schema, for the next CONTROL_SUBSCRIPTION_LEASE ms, so it has
+//to be repeated to keep the stream. Each sender can hold several sets at
+//their own periods, told apart by the tag, next to any subscribe.
+//
+//	0		4		destination address, as the subscribe's
+//	4		2		destination port, as the subscribe's
+//	6		1		tag, picked by the PC, echoed in the signal data
+//	7		2		period in ms, 0 to stop the set
+//	9		1		signals that follow, 1 to CONTROL_SIGNAL_SET_MAX, or 0
+//					with a period of 0
+//	10		...		signal ids, in the order they are to be sent
+//
+//A set with an unknown id is refused as a whole.
+//
+//Signal data payload, ECU -> PC. The newest value of every signal of a
+//set, sent every period. The header timestamp is when they were read.
+//
+//	0		1		tag of the set
+//	1		4		schema id the values are coded by
+//	5		1		signals that follow
+//	6		...		the values, in the order of the subscribe, each at its
+//					size on the wire
+//
+//Calibration request payload, PC -> ECU. Starts or ends a steering sweep
+//(SteeringSweep.h), or only asks how it goes. Answered with one calibration
+//data frame, of before main_task took the action up.
+//
+//	0		1		action, CONTROL_CALIBRATION_*
+//
+//Calibration data payload, ECU -> PC.
+//
+//	0		1		steering_sweep_state_t
+//	1		1		steering_sweep_result_t of the last sweep to end
+//	2		4		ms since the sweep started, of the last one once ended
+//	6		2		potentiometer code at the left stop, at 16 bits
+//	8		2		at the right stop
+//	10		4		deg from stop to stop by the encoder, 0 without, an
+//					IEEE 754 float
+//	14		1		1 if the table in use is a record from NVM, 0 for
+//					the default points
+//	15		1		points of the table in use that follow
+//	16		...		per point: voltage then position in deg, each an
+//					IEEE 754 float, by increasing voltage
+//
+//Autotune request payload, PC -> ECU. Starts a relay tune of a loop
+//(PIDAutotune.h), ends the one running or only asks how it goes. Answered
+//with one autotune data frame, of before main_task took the action up.
+//
+//	0		1		action, CONTROL_AUTOTUNE_*
+//	1		1		pid_autotune_loop_t to start, ignored otherwise
+//
+//Autotune data payload, ECU -> PC. The floats are IEEE 754, the results
+//from oscillation on are of the last tune that ended done.
+//
+//	0		1		pid_autotune_state_t
+//	1		1		pid_autotune_loop_t, of the last tune once it ended
+//	2		1		pid_autotune_result_t of the last tune to end
+//	3		1		periods measured
+//	4		4		ms since the tune started, of the last one once ended
+//	8		4		relay bias, in the loop's output
+//	12		4		half peak to peak of the feedback, deg or m/s
+//	16		4		ultimate gain, in the units of the P gain
+//	20		4		ultimate period, ms
+//	24		12		Ziegler-Nichols P, I and D gains, per ms
+//	36		12		Tyreus-Luyben P, I and D gains, per ms
+//
+//Excitation request payload, PC -> ECU. Starts a system identification run
+//(Excitation.h), ends the one running or only asks how it goes. Answered
+//with one excitation data frame, of before main_task took the action up.
+//The config is ignored but for a start, the floats are IEEE 754.
+//
+//	0		1		action, CONTROL_EXCITATION_*
+//	1		1		excitation_output_t
+//	2		1		excitation_waveform_t
+//	3		1		1 steers right
+//	4		2		PWM periods a sample is held for
+//	6		2		samples
+//	8		4		offset, duty cycle
+//	12		4		amplitude, duty cycle
+//	16		4		start Hz, the bit rate for PRBS
+//	20		4		end Hz
+//
+//Excitation data payload, ECU -> PC. The samples of the last run that was
+//done come over the bulk channel (BulkChannel.h).
+//
+//	0		1		excitation_state_t
+//	1		1		excitation_result_t of the last run to end
+//	2		1		excitation_output_t, of the last run once it ended
+//	3		1		excitation_waveform_t
+//	4		4		ms since the run started, of the last one once ended
+//	8		2		samples
+//	10		2		PWM periods a sample is held for
+//	12		2		samples captured
+//	14		4		samples per s, an IEEE 754 float
+//
+//A longer command, trajectory, subscribe, trace, profile, task, event, param, boot, memory, discover, schema request, signal
+//subscribe, calibration, autotune or excitation request payload than listed is accepted
+//and the extra bytes ignored, so fields can be appended without breaking older readers.
+
+#define CONTROL_PROTOCOL_VERSION 16
+
+#define CONTROL_FRAME_COMMAND 1
+#define CONTROL_FRAME_TELEMETRY 2
+#define CONTROL_FRAME_SUBSCRIBE 3
+#define CONTROL_FRAME_TRACE_REQUEST 4
+#define CONTROL_FRAME_TRACE_DATA 5
+#define CONTROL_FRAME_PROFILE_REQUEST 6
+#define CONTROL_FRAME_PROFILE_DATA 7
+#define CONTROL_FRAME_TASK_REQUEST 8
+#define CONTROL_FRAME_TASK_DATA 9
+#define CONTROL_FRAME_EVENT_REQUEST 10
+#define CONTROL_FRAME_EVENT_DATA 11
+#define CONTROL_FRAME_PARAM_REQUEST 12
+#define CONTROL_FRAME_PARAM_DATA 13
+#define CONTROL_FRAME_BOOT_REQUEST 14
+#define CONTROL_FRAME_BOOT_DATA 15
+#define CONTROL_FRAME_TELEMETRY_BATCH 16
+#define CONTROL_FRAME_TRAJECTORY 17
+#define CONTROL_FRAME_MEMORY_REQUEST 18
+#define CONTROL_FRAME_MEMORY_DATA 19
+#define CONTROL_FRAME_DISCOVER 20
+#define CONTROL_FRAME_ANNOUNCE 21
+#define CONTROL_FRAME_SCHEMA_REQUEST 22
+#define CONTROL_FRAME_SCHEMA 23
+#define CONTROL_FRAME_SIGNAL_SUBSCRIBE 24
+#define CONTROL_FRAME_SIGNAL_DATA 25
+#define CONTROL_FRAME_CALIBRATION_REQUEST 26
+#define CONTROL_FRAME_CALIBRATION_DATA 27
+#define CONTROL_FRAME_AUTOTUNE_REQUEST 28
+#define CONTROL_FRAME_AUTOTUNE_DATA 29
+#define CONTROL_FRAME_EXCITATION_REQUEST 30
+#define CONTROL_FRAME_EXCITATION_DATA 31
+
+#define CONTROL_HEADER_SIZE 12
+#define CONTROL_CRC_SIZE 4
+#define CONTROL_COMMAND_PAYLOAD_SIZE 6
+#define CONTROL_SUBSCRIBE_PAYLOAD_SIZE 10
+#define CONTROL_TRACE_REQUEST_PAYLOAD_SIZE 12
+#define CONTROL_PROFILE_REQUEST_PAYLOAD_SIZE 1
+#define CONTROL_EVENT_REQUEST_PAYLOAD_SIZE 4
+#define CONTROL_PARAM_REQUEST_PAYLOAD_SIZE 2
+#define CONTROL_DISCOVER_PAYLOAD_SIZE 1
+#define CONTROL_ANNOUNCE_PAYLOAD_SIZE 19
+#define CONTROL_SCHEMA_REQUEST_PAYLOAD_SIZE 1
+#define CONTROL_SIGNAL_SUBSCRIBE_PAYLOAD_SIZE 10
+#define CONTROL_CALIBRATION_REQUEST_PAYLOAD_SIZE 1
+#define CONTROL_AUTOTUNE_REQUEST_PAYLOAD_SIZE 2
+#define CONTROL_AUTOTUNE_DATA_PAYLOAD_SIZE 48
+#define CONTROL_EXCITATION_REQUEST_PAYLOAD_SIZE 24
+#define CONTROL_EXCITATION_DATA_PAYLOAD_SIZE 18
+
+#define CONTROL_COMMAND_FRAME_SIZE (CONTROL_HEADER_SIZE + CONTROL_COMMAND_PAYLOAD_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_TRAJECTORY_PAYLOAD_SIZE 6
+#define CONTROL_TRAJECTORY_POINT_SIZE 8
+#define CONTROL_TRAJECTORY_MAX_POINTS TRAJECTORY_BATCH_MAX
+#define CONTROL_TRAJECTORY_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + CONTROL_TRAJECTORY_PAYLOAD_SIZE + \
+	CONTROL_TRAJECTORY_MAX_POINTS * CONTROL_TRAJECTORY_POINT_SIZE + CONTROL_CRC_SIZE)
+
+typedef enum control_telemetry_group_t
+{
+	CONTROL_TELEMETRY_GROUP_STATUS = 0,
+	CONTROL_TELEMETRY_GROUP_PID,
+	CONTROL_TELEMETRY_GROUP_COUNT
+} control_telemetry_group_t;
+
+#define CONTROL_TELEMETRY_FIELD_COUNT 15
+
+//Largest telemetry frame, the status group sent in full
+#define CONTROL_TELEMETRY_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 3 + 27 + CONTROL_CRC_SIZE)
+
+//Largest batch, chosen so a full one still fits one Ethernet frame
+#define CONTROL_TELEMETRY_BATCH_MAX_SAMPLES 32
+#define CONTROL_TELEMETRY_BATCH_SAMPLE_SIZE 43
+#define CONTROL_TELEMETRY_BATCH_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 9 + \
+	CONTROL_TELEMETRY_BATCH_MAX_SAMPLES * CONTROL_TELEMETRY_BATCH_SAMPLE_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_TRACE_READ 0
+#define CONTROL_TRACE_REARM 1
+#define CONTROL_TRACE_TRIGGER 2
+
+//Samples per trace data frame, chosen so a frame fits one Ethernet frame
+#define CONTROL_TRACE_SAMPLES_PER_FRAME 16
+#define CONTROL_TRACE_FRAMES_PER_REQUEST 4
+#define CONTROL_TRACE_SAMPLE_SIZE (4 + PID_TRACE_CONTROLLER_COUNT * 8 * 4)
+#define CONTROL_TRACE_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 11 + CONTROL_TRACE_SAMPLES_PER_FRAME * CONTROL_TRACE_SAMPLE_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_PROFILE_READ 0
+#define CONTROL_PROFILE_RESET 1
+
+#define CONTROL_PROFILE_STAGE_SIZE (16 + PROFILER_HISTOGRAM_BINS * 4)
+#define CONTROL_PROFILE_CACHE_SIZE (4 + CACHE_MONITOR_EVENT_COUNT * 12)
+#define CONTROL_PROFILE_LOAD_SIZE 20
+#define CONTROL_PROFILE_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 6 + PROFILER_STAGE_COUNT * CONTROL_PROFILE_STAGE_SIZE + \
+	1 + CACHE_MONITOR_SECTION_COUNT * CONTROL_PROFILE_CACHE_SIZE + CONTROL_PROFILE_LOAD_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_TASK_NAME_SIZE 8
+#define CONTROL_TASK_ENTRY_SIZE (6 + CONTROL_TASK_NAME_SIZE)
+#define CONTROL_TASK_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 5 + TASK_MONITOR_MAX_TASKS * CONTROL_TASK_ENTRY_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_EVENTS_PER_FRAME 32
+#define CONTROL_EVENT_ENTRY_SIZE 16
+#define CONTROL_EVENT_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 9 + CONTROL_EVENTS_PER_FRAME * CONTROL_EVENT_ENTRY_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_PARAM_READ 0
+#define CONTROL_PARAM_SET 1
+#define CONTROL_PARAM_SAVE 2
+//back to the defaults, not saved until a save
+#define CONTROL_PARAM_DEFAULTS 3
+
+#define CONTROL_PARAM_RESULT_DONE 0
+//unknown id, value out of range or too many entries, nothing was changed
+#define CONTROL_PARAM_RESULT_REJECTED 1
+//a save with no NVM to save to
+#define CONTROL_PARAM_RESULT_UNAVAILABLE 2
+#define CONTROL_PARAM_RESULT_BAD_ACTION 3
+
+#define CONTROL_PARAM_BATCH_MAX 16
+#define CONTROL_PARAM_SET_ENTRY_SIZE 5
+#define CONTROL_PARAM_REQUEST_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + CONTROL_PARAM_REQUEST_PAYLOAD_SIZE + \
+	CONTROL_PARAM_BATCH_MAX * CONTROL_PARAM_SET_ENTRY_SIZE + CONTROL_CRC_SIZE)
+#define CONTROL_PARAM_DATA_ENTRY_SIZE 6
+#define CONTROL_PARAM_DATA_MAX_ENTRIES (PARAM_COUNT > CONTROL_PARAM_BATCH_MAX ? PARAM_COUNT : CONTROL_PARAM_BATCH_MAX)
+#define CONTROL_PARAM_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 8 + CONTROL_PARAM_DATA_MAX_ENTRIES * CONTROL_PARAM_DATA_ENTRY_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_BOOT_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 2 + BOOT_STAGE_COUNT * 4 + CONTROL_CRC_SIZE)
+
+#define CONTROL_MEMORY_OK 0
+//not all of the range is in one open region
+#define CONTROL_MEMORY_DENIED 1
+//past CONTROL_MEMORY_MAX_DATA with the ranges before it
+#define CONTROL_MEMORY_NO_ROOM 2
+
+#define CONTROL_MEMORY_MAX_RANGES 16
+#define CONTROL_MEMORY_MAX_DATA 1024
+#define CONTROL_MEMORY_RANGE_SIZE 6
+#define CONTROL_MEMORY_REQUEST_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 1 + \
+	CONTROL_MEMORY_MAX_RANGES * CONTROL_MEMORY_RANGE_SIZE + CONTROL_CRC_SIZE)
+#define CONTROL_MEMORY_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 1 + CONTROL_MEMORY_MAX_RANGES * 7 + \
+	CONTROL_MEMORY_MAX_DATA + CONTROL_CRC_SIZE)
+#define CONTROL_ANNOUNCE_FRAME_SIZE (CONTROL_HEADER_SIZE + CONTROL_ANNOUNCE_PAYLOAD_SIZE + CONTROL_CRC_SIZE)
+
+//Longer names and units are cut, chosen so a full schema frame still fits
+//one Ethernet frame
+#define CONTROL_SCHEMA_ENTRIES_PER_FRAME 24
+#define CONTROL_SCHEMA_NAME_MAX 32
+#define CONTROL_SCHEMA_UNIT_MAX 8
+#define CONTROL_SCHEMA_ENTRY_MAX_SIZE (9 + CONTROL_SCHEMA_NAME_MAX + CONTROL_SCHEMA_UNIT_MAX)
+#define CONTROL_SCHEMA_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 7 + \
+	CONTROL_SCHEMA_ENTRIES_PER_FRAME * CONTROL_SCHEMA_ENTRY_MAX_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_SIGNAL_SET_MAX 32
+#define CONTROL_SIGNAL_SUBSCRIBE_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + CONTROL_SIGNAL_SUBSCRIBE_PAYLOAD_SIZE + \
+	CONTROL_SIGNAL_SET_MAX + CONTROL_CRC_SIZE)
+#define CONTROL_SIGNAL_DATA_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 6 + CONTROL_SIGNAL_SET_MAX * 4 + CONTROL_CRC_SIZE)
+
+#define CONTROL_CALIBRATION_READ 0
+#define CONTROL_CALIBRATION_START 1
+#define CONTROL_CALIBRATION_ABORT 2
+
+#define CONTROL_CALIBRATION_MAX_FRAME_SIZE (CONTROL_HEADER_SIZE + 16 + STEERING_CALIBRATION_MAX_POINTS * 8 + CONTROL_CRC_SIZE)
+
+#define CONTROL_AUTOTUNE_READ 0
+#define CONTROL_AUTOTUNE_START 1
+#define CONTROL_AUTOTUNE_ABORT 2
+
+#define CONTROL_AUTOTUNE_FRAME_SIZE (CONTROL_HEADER_SIZE + CONTROL_AUTOTUNE_DATA_PAYLOAD_SIZE + CONTROL_CRC_SIZE)
+
+#define CONTROL_EXCITATION_READ 0
+#define CONTROL_EXCITATION_START 1
+#define CONTROL_EXCITATION_ABORT 2
+
+#define CONTROL_EXCITATION_FRAME_SIZE (CONTROL_HEADER_SIZE + CONTROL_EXCITATION_DATA_PAYLOAD_SIZE + CONTROL_CRC_SIZE)
+
+//ms
+#define CONTROL_SUBSCRIPTION_LEASE 3000
+#define CONTROL_TELEMETRY_REFRESH 1000
+
+//A command up to this many sequence numbers behind the newest one from the
+//same commander is a reordered duplicate and dropped. Anything further behind
+//is taken as the commander's software restarting its count.
+#define CONTROL_REORDER_WINDOW 64
+
+#define CONTROL_COMMAND_DEFAULT_PRIORITY 1
+//ms
+#define CONTROL_COMMAND_DEFAULT_LEASE 250
+
+//Per link state, owned by whichever task runs the control channel.
+typedef struct control_protocol_t
+{
+	uint32_t tx_sequence;
+
+	//last accepted command, from whichever commander
+	uint32_t rx_sequence;
+	uint32_t rx_timestamp;
+	//PTP us it was received at, set by whoever receives it
+	uint32_t rx_ptp_time;
+
+	//bad length, version, type, CRC or priority
+	uint32_t rx_invalid;
+	//commands with a wrong tag or a replayed sequence (CommandAuth.h)
+	uint32_t rx_unauthenticated;
+} control_protocol_t;
+
+//What arbitration needs from a command frame, read before the rest of it
+typedef struct control_command_info_t
+{
+	uint32_t sequence;
+	uint32_t timestamp;
+	uint8_t priority;
+	//ms
+	uint16_t lease;
+} control_command_info_t;
+
+typedef struct control_subscription_t
+{
+	//network byte order, as lwIP keeps addresses. 0 for the sender.
+	uint32_t address;
+	//0 for the sender
+	uint16_t port;
+	//ms, 0 for groups that are not wanted
+	uint16_t period[CONTROL_TELEMETRY_GROUP_COUNT];
+	//samples per batched telemetry frame, 0 for none
+	uint8_t batch;
+} control_subscription_t;
+
+typedef struct control_signal_subscription_t
+{
+	//as control_subscription_t's
+	uint32_t address;
+	uint16_t port;
+	uint8_t tag;
+	//ms, 0 to stop
+	uint16_t period;
+	uint8_t count;
+	uint8_t ids[CONTROL_SIGNAL_SET_MAX];
+} control_signal_subscription_t;
+
+typedef struct control_param_request_t
+{
+	uint8_t action;
+	uint8_t count;
+	uint8_t ids[CONTROL_PARAM_BATCH_MAX];
+	//set only
+	param_value_t values[CONTROL_PARAM_BATCH_MAX];
+} control_param_request_t;
+
+typedef struct control_memory_request_t
+{
+	uint8_t count;
+	uint32_t addresses[CONTROL_MEMORY_MAX_RANGES];
+	uint16_t lengths[CONTROL_MEMORY_MAX_RANGES];
+} control_memory_request_t;
+
+typedef struct control_trace_request_t
+{
+	uint8_t action;
+	uint8_t triggers;
+	uint16_t first;
+	int32_t step_threshold;
+	int32_t error_threshold;
+} control_trace_request_t;
+
+void ControlProtocolInit(control_protocol_t* protocol);
+
+//Type of a received frame, 0 if it is too short or of another version.
+//Only a first look, the decoders below still validate the whole frame.
+uint8_t ControlProtocolFrameType(const uint8_t* frame, uint32_t length);
+
+//CRC-32 every frame ends with, of the length bytes before it. Only for
+//frames built outside the encoders below, such as the benchmark's.
+uint32_t ControlProtocolCRC(const uint8_t* data, uint32_t length);
+
+//Returns 1 and fills info if frame is a valid command or trajectory.
+uint8_t ControlProtocolCheckCommand(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_command_info_t* info);
+
+//Decodes a frame that passed ControlProtocolCheckCommand, and that the
+//arbiter took, into command and makes it the last accepted command. now is
+//the receive time in ms.
+void ControlProtocolDecodeCommand(control_protocol_t* protocol, const uint8_t* frame, const control_command_info_t* info,
+	uint32_t now, control_command_t* command);
+
+//Returns 1 and fills subscription if frame is a valid subscribe.
+uint8_t ControlProtocolDecodeSubscribe(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_subscription_t* subscription);
+
+//Returns 1 and fills request if frame is a valid trace request.
+uint8_t ControlProtocolDecodeTraceRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_trace_request_t* request);
+
+//Writes a trace data frame with the samples from first on, at most
+//CONTROL_TRACE_SAMPLES_PER_FRAME of them and none unless the trace is frozen,
+//and returns its length. frame must hold CONTROL_TRACE_MAX_FRAME_SIZE bytes.
+//*samples is set to the number of samples written.
+uint16_t ControlProtocolEncodeTraceData(control_protocol_t* protocol, uint8_t* frame, const pid_trace_t* trace,
+	uint16_t first, uint16_t* samples, uint32_t timestamp);
+
+//Returns 1 and sets action if frame is a valid profile request.
+uint8_t ControlProtocolDecodeProfileRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* action);
+
+//Control loop and network counters the profile data frame ends with, so a
+//network stress run shows whether the flood cost the control loop anything
+typedef struct control_load_stats_t
+{
+	uint32_t cycles;
+	uint32_t overruns;
+	uint32_t rx_frames;
+	uint32_t rx_dropped;
+	uint32_t link_dropped;
+} control_load_stats_t;
+
+//Writes a profile data frame with the current stats of every stage and
+//returns its length. frame must hold CONTROL_PROFILE_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeProfileData(control_protocol_t* protocol, uint8_t* frame, uint32_t core_clock,
+	const control_load_stats_t* load, uint32_t timestamp);
+
+//Returns 1 if frame is a valid task request.
+uint8_t ControlProtocolDecodeTaskRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length);
+
+//Writes a task data frame with the newest TaskMonitor snapshot and returns
+//its length. frame must hold CONTROL_TASK_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeTaskData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp);
+
+//Returns 1 and sets first if frame is a valid event request.
+uint8_t ControlProtocolDecodeEventRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint32_t* first);
+
+//Writes an event data frame with up to CONTROL_EVENTS_PER_FRAME events from
+//sequence number first on and returns its length. frame must hold
+//CONTROL_EVENT_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeEventData(control_protocol_t* protocol, uint8_t* frame, uint32_t first, uint32_t timestamp);
+
+//Returns 1 and fills request if frame is a valid param request. Too many
+//entries for CONTROL_PARAM_BATCH_MAX are left to the caller to reject, count
+//is then CONTROL_PARAM_BATCH_MAX + 1 and the entries are not read.
+uint8_t ControlProtocolDecodeParamRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, control_param_request_t* request);
+
+//Writes a param data frame with the parameters of params in ids, all of
+//them if ids is NULL, and the state of the store and returns its length.
+//frame must hold CONTROL_PARAM_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeParamData(control_protocol_t* protocol, uint8_t* frame, const param_set_t* params,
+	uint8_t result, uint8_t rejected, const uint8_t* ids, uint8_t count, uint32_t timestamp);
+
+//Returns 1 if frame is a valid boot request.
+uint8_t ControlProtocolDecodeBootRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length);
+
+//Writes a boot data frame with the stages reached so far and returns its
+//length. frame must hold CONTROL_BOOT_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeBootData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp);
+
+//Returns 1 and fills request if frame is a valid memory request of 1 to
+//CONTROL_MEMORY_MAX_RANGES ranges.
+uint8_t ControlProtocolDecodeMemoryRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	control_memory_request_t* request);
+
+//Writes a memory data frame with the ranges of request and returns its
+//length. frame must hold CONTROL_MEMORY_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeMemoryData(control_protocol_t* protocol, uint8_t* frame, const control_memory_request_t* request,
+	uint32_t timestamp);
+
+//Returns 1 and the node id asked for if frame is a valid discover request.
+uint8_t ControlProtocolDecodeDiscover(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* node_id);
+
+//Writes an announce frame for node and returns its length. frame must hold
+//CONTROL_ANNOUNCE_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeAnnounce(control_protocol_t* protocol, uint8_t* frame, const node_identity_t* node,
+	uint16_t command_port, uint16_t param_port, uint32_t timestamp);
+
+//Returns 1 and sets first if frame is a valid schema request.
+uint8_t ControlProtocolDecodeSchemaRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* first);
+
+//Writes a schema frame with the signals from first on and returns its
+//length. frame must hold CONTROL_SCHEMA_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeSchema(control_protocol_t* protocol, uint8_t* frame, uint8_t first, uint32_t timestamp);
+
+//The schema id, computed on the first call
+uint32_t ControlProtocolSchemaId();
+
+//Returns 1 and fills subscription if frame is a valid signal subscribe
+//whose ids are all known.
+uint8_t ControlProtocolDecodeSignalSubscribe(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	control_signal_subscription_t* subscription);
+
+//Writes a signal data frame with the newest value of the count signals in
+//ids and returns its length. frame must hold
+//CONTROL_SIGNAL_DATA_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeSignalData(control_protocol_t* protocol, uint8_t* frame, uint8_t tag, const uint8_t* ids,
+	uint8_t count, uint32_t timestamp);
+
+//Returns 1 and sets action if frame is a valid calibration request.
+uint8_t ControlProtocolDecodeCalibrationRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	uint8_t* action);
+
+//Writes a calibration data frame with the state of the sweep and the table
+//in use and returns its length. frame must hold
+//CONTROL_CALIBRATION_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeCalibrationData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp);
+
+//Returns 1 and sets action and loop if frame is a valid autotune request.
+uint8_t ControlProtocolDecodeAutotuneRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	uint8_t* action, uint8_t* loop);
+
+//Writes an autotune data frame with the state and the results of the tune
+//and returns its length. frame must hold CONTROL_AUTOTUNE_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeAutotuneData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp);
+
+//Returns 1 and sets action and config if frame is a valid excitation
+//request.
+uint8_t ControlProtocolDecodeExcitationRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length,
+	uint8_t* action, excitation_config_t* config);
+
+//Writes an excitation data frame with the state of the run and returns its
+//length. frame must hold CONTROL_EXCITATION_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeExcitationData(control_protocol_t* protocol, uint8_t* frame, uint32_t timestamp);
+
+//Converts a snapshot to the wire value of every telemetry field, so changes
+//are detected at the resolution that is actually sent.
+void ControlProtocolQuantizeTelemetry(const control_protocol_t* protocol, const control_telemetry_t* telemetry, uint32_t values[CONTROL_TELEMETRY_FIELD_COUNT]);
+
+//Fields belonging to group, as a field mask.
+uint16_t ControlProtocolGroupFields(control_telemetry_group_t group);
+
+//Writes a telemetry frame carrying the fields in mask, which must all belong
+//to group, and returns its length. frame must hold
+//CONTROL_TELEMETRY_MAX_FRAME_SIZE bytes. timestamp is the ECU time in ms.
+uint16_t ControlProtocolEncodeTelemetry(control_protocol_t* protocol, uint8_t* frame, control_telemetry_group_t group,
+	uint16_t mask, const uint32_t values[CONTROL_TELEMETRY_FIELD_COUNT], uint32_t timestamp);
+
+//Writes a batched telemetry frame of count consecutive snapshots, the first
+//being number first, and returns its length. count is cut to
+//CONTROL_TELEMETRY_BATCH_MAX_SAMPLES, frame must hold
+//CONTROL_TELEMETRY_BATCH_MAX_FRAME_SIZE bytes.
+uint16_t ControlProtocolEncodeTelemetryBatch(control_protocol_t* protocol, uint8_t* frame, const control_telemetry_t* samples,
+	uint8_t count, uint32_t first, uint32_t lost, uint32_t timestamp);
+
+#endif /* CONTROLPROTOCOL_H_ */
@@ -0,0 +1,83 @@
+/*
+ * ControlRecord.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "ControlRecord.h"
+#include "main_context.h"
+#include "FastCode.h"
+
+//newest event of a deadline's source, 0 while it was never heard
+static inline uint32_t LastEvent(const deadline_monitor_t* monitor, deadline_id_t id)
+{
+	const deadline_t* deadline = &monitor->deadlines[id];
+	return deadline->armed ? deadline->last_event : 0;
+}
+
+FAST_CODE void ControlRecordBegin(main_context_t* ctx)
+{
+	control_record_t* record = &ctx->record;
+	record->cycle = ctx->scheduler.cycle_count;
+	record->now = ctx->current_time;
+	//the parameters stay applied, their flag with them
+	record->flags &= CONTROL_RECORD_OVERRIDE_PID;
+}
+
+FAST_CODE void ControlRecordCommand(main_context_t* ctx, const control_command_t* command)
+{
+	control_record_t* record = &ctx->record;
+	record->flags |= CONTROL_RECORD_COMMAND | (command->trajectory_points ? CONTROL_RECORD_TRAJECTORY : 0);
+	record->command_rx_time = command->rx_time;
+	record->command_lease_end = command->lease_end;
+	record->command_sent_time = command->sent_time;
+	record->command_vehicle_speed = command->vehicle_speed_commanded;
+	record->command_steering_angle = command->steering_angle_commanded;
+	record->command_flags = command->priority
+		| (command->park_brake_commanded ? CONTROL_RECORD_COMMAND_PARK_BRAKE : 0)
+		| (command->reverse_commanded ? CONTROL_RECORD_COMMAND_REVERSE : 0)
+		| (command->autonomous_mode ? CONTROL_RECORD_COMMAND_AUTONOMOUS : 0)
+		| (command->tele_operation_enabled ? CONTROL_RECORD_COMMAND_TELE_OPERATION : 0);
+}
+
+FAST_CODE void ControlRecordParams(main_context_t* ctx, const param_set_t* params)
+{
+	control_record_t* record = &ctx->record;
+	record->flags = (record->flags & ~CONTROL_RECORD_OVERRIDE_PID) | CONTROL_RECORD_PARAMS
+		| (params->values[PARAM_OVERRIDE_PID].u ? CONTROL_RECORD_OVERRIDE_PID : 0);
+	record->speed_p_gain = params->values[PARAM_SPEED_P_GAIN].f;
+	record->speed_i_gain = params->values[PARAM_SPEED_I_GAIN].f;
+	record->speed_d_gain = params->values[PARAM_SPEED_D_GAIN].f;
+	record->steer_p_gain = params->values[PARAM_STEER_P_GAIN].f;
+	record->steer_i_gain = params->values[PARAM_STEER_I_GAIN].f;
+	record->steer_d_gain = params->values[PARAM_STEER_D_GAIN].f;
+}
+
+FAST_CODE void ControlRecordCycle(main_context_t* ctx)
+{
+	control_record_t* record = &ctx->record;
+	record->flags |= (ctx->estop_in ? CONTROL_RECORD_ESTOP : 0) | (ctx->reverse ? CONTROL_RECORD_REVERSE : 0)
+		| (ctx->imu_valid ? CONTROL_RECORD_IMU_VALID : 0);
+	record->input_time = ctx->input_time;
+	record->sample_time = ctx->sample_time;
+	record->estop_time = ctx->estop_time;
+	record->steering_angle = ctx->steering_angle;
+	record->vehicle_speed = ctx->vehicle_speed;
+	record->brake_pressure = ctx->brake_pressure;
+	record->yaw_rate = ctx->yaw_rate;
+	record->longitudinal_accel = ctx->longitudinal_accel;
+	record->lateral_accel = ctx->lateral_accel;
+	record->wheel_speed_rx_tick = LastEvent(&ctx->deadlines, DEADLINE_WHEEL_SPEED);
+	record->eps_rx_tick = LastEvent(&ctx->deadlines, DEADLINE_EPS_FEEDBACK);
+
+	const actuator_command_t* actuators = &ctx->actuators;
+	record->acceleration = actuators->acceleration;
+	record->front_brake = actuators->front_brake;
+	record->steering_torque = actuators->steering_torque;
+	record->steering_rate = actuators->steering_rate;
+	record->output_flags = ctx->mode.mode
+		| (actuators->reverse ? CONTROL_RECORD_OUTPUT_REVERSE : 0)
+		| (actuators->steer_right ? CONTROL_RECORD_OUTPUT_STEER_RIGHT : 0)
+		| (actuators->steering_rate_control ? CONTROL_RECORD_OUTPUT_STEERING_RATE_CONTROL : 0)
+		| (actuators->safety_light_1 ? CONTROL_RECORD_OUTPUT_SAFETY_LIGHT_1 : 0);
+}
@@ -0,0 +1,128 @@
+/*
+ * ControlRecord.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CONTROLRECORD_H_
+#define CONTROLRECORD_H_
+
+#include <stdint.h>
+#include "ControlExchange.h"
+
+//Everything the control core took in one cycle, and what it put out, so a
+//field run can be fed through the core again off target and give the same
+//outputs bit for bit.
+//
+//The core's inputs are few: the sensor values ProcessCurrentInputs and
+//ProcessImuInputs leave in the context, the ticks the CAN nodes were last
+//heard at, the commands and parameters that reach it through the control
+//exchange, and the time. Everything else is state it builds from those
+//itself. With CONTROL_RECORD_ENABLE the cycle fills ctx->record with them:
+//ControlRecordBegin from ControlCoreStep, ControlRecordCommand and
+//ControlRecordParams as a command or a parameter set is applied, and the
+//"record" stage last in the cycle for the sensor values and the outputs.
+//The SD log (SdLogger.h) then stores the records in place of its own,
+//from the first cycle on.
+//
+//host/ControlReplay reads the card, runs each session through the host
+//build of the core from ControlCoreInit on and diffs every cycle's
+//outputs with the recorded ones. It has to be built with the defines the
+//firmware was, the core's configuration is not in the log. The points of
+//a trajectory command are not recorded, a cycle that applied one is
+//flagged and the replay of a run with them diverges from there.
+
+#ifndef CONTROL_RECORD_ENABLE
+#define CONTROL_RECORD_ENABLE 0
+#endif
+
+//Little endian as in RAM, 32-bit words only for DeltaCodec
+typedef struct control_record_t
+{
+	uint32_t cycle;
+	//ms, the now ControlCoreStep ran with
+	uint32_t now;
+	//CONTROL_RECORD_*
+	uint32_t flags;
+
+	//as the input stages left them
+	uint32_t input_time;
+	uint32_t sample_time;
+	uint32_t estop_time;
+	float steering_angle;
+	float vehicle_speed;
+	float brake_pressure;
+	float yaw_rate;
+	float longitudinal_accel;
+	float lateral_accel;
+	//ticks of the newest wheel speed and EPS frames, 0 while never heard
+	uint32_t wheel_speed_rx_tick;
+	uint32_t eps_rx_tick;
+
+	//the command applied last, new this cycle with CONTROL_RECORD_COMMAND
+	uint32_t command_rx_time;
+	uint32_t command_lease_end;
+	uint32_t command_sent_time;
+	float command_vehicle_speed;
+	float command_steering_angle;
+	//the priority in the low byte, then CONTROL_RECORD_COMMAND_*
+	uint32_t command_flags;
+
+	//the gains of the parameters applied last, new this cycle with
+	//CONTROL_RECORD_PARAMS
+	float speed_p_gain;
+	float speed_i_gain;
+	float speed_d_gain;
+	float steer_p_gain;
+	float steer_i_gain;
+	float steer_d_gain;
+
+	//what the cycle committed
+	float acceleration;
+	float front_brake;
+	float steering_torque;
+	float steering_rate;
+	//the vehicle_mode_t in the low byte, then CONTROL_RECORD_OUTPUT_*
+	uint32_t output_flags;
+} control_record_t;
+
+#define CONTROL_RECORD_WORDS (sizeof(control_record_t) / 4)
+
+//flags
+#define CONTROL_RECORD_COMMAND 0x01
+#define CONTROL_RECORD_PARAMS 0x02
+#define CONTROL_RECORD_ESTOP 0x04
+#define CONTROL_RECORD_REVERSE 0x08
+#define CONTROL_RECORD_IMU_VALID 0x10
+//of the parameters applied last
+#define CONTROL_RECORD_OVERRIDE_PID 0x20
+//the command had trajectory points, which are not recorded
+#define CONTROL_RECORD_TRAJECTORY 0x40
+
+//command_flags
+#define CONTROL_RECORD_COMMAND_PARK_BRAKE 0x100
+#define CONTROL_RECORD_COMMAND_REVERSE 0x200
+#define CONTROL_RECORD_COMMAND_AUTONOMOUS 0x400
+#define CONTROL_RECORD_COMMAND_TELE_OPERATION 0x800
+
+//output_flags
+#define CONTROL_RECORD_OUTPUT_REVERSE 0x100
+#define CONTROL_RECORD_OUTPUT_STEER_RIGHT 0x200
+#define CONTROL_RECORD_OUTPUT_STEERING_RATE_CONTROL 0x400
+#define CONTROL_RECORD_OUTPUT_SAFETY_LIGHT_1 0x800
+
+struct main_context_t;
+
+//Starts the cycle's record, from ControlCoreStep
+void ControlRecordBegin(struct main_context_t* ctx);
+
+//A command ApplyLatestCommand applies
+void ControlRecordCommand(struct main_context_t* ctx, const control_command_t* command);
+
+//A parameter set ApplyNewParams applies
+void ControlRecordParams(struct main_context_t* ctx, const param_set_t* params);
+
+//The inputs and outputs of the cycle, the pipeline's last stage
+void ControlRecordCycle(struct main_context_t* ctx);
+
+#endif /* CONTROLRECORD_H_ */
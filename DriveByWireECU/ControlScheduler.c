@@ -0,0 +1,151 @@
+/*
+ * ControlScheduler.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "ControlScheduler.h"
+#include "FastCode.h"
+#include "EventLog.h"
+#include "TimeBase.h"
+
+#if CONTROL_SCHEDULER_TIMER
+
+#include <compiler.h>
+#include <hri_tcc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include <irq_config.h>
+
+#define CONTROL_TIMER TCC3
+//TCC3 counts 16 bits at the PWM timers' 12 MHz, a cycle at 1 kHz is 12000
+#define CONTROL_TIMER_PERIOD (CONF_GCLK_TC0_FREQUENCY / CONTROL_RATE_HZ)
+#define CONTROL_TIMER_TICKS_PER_US (CONF_GCLK_TC0_FREQUENCY / 1000000)
+
+#if CONF_GCLK_TC0_FREQUENCY % CONTROL_RATE_HZ != 0 || CONTROL_TIMER_PERIOD > 0xFFFF
+#error CONTROL_RATE_HZ gives a period TCC3 cannot count
+#endif
+
+//notified by the timer interrupt
+static TaskHandle_t control_task;
+
+void ControlSchedulerInit(control_scheduler_t* sched)
+{
+	memset(sched, 0, sizeof(control_scheduler_t));
+	control_task = xTaskGetCurrentTaskHandle();
+
+	hri_mclk_set_APBCMASK_TCC3_bit(MCLK);
+	//TCC2 and TCC3 share a peripheral channel, clocked like the PWM timers
+	hri_gclk_write_PCHCTRL_reg(GCLK, TCC3_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+	hri_tcc_write_CTRLA_reg(CONTROL_TIMER, TCC_CTRLA_SWRST);
+	hri_tcc_wait_for_sync(CONTROL_TIMER, TCC_SYNCBUSY_SWRST);
+	hri_tcc_write_CTRLA_reg(CONTROL_TIMER, TCC_CTRLA_PRESCALER_DIV1);
+	hri_tcc_write_WAVE_reg(CONTROL_TIMER, TCC_WAVE_WAVEGEN_NFRQ);
+	hri_tcc_write_PER_reg(CONTROL_TIMER, CONTROL_TIMER_PERIOD - 1);
+	hri_tcc_set_INTEN_OVF_bit(CONTROL_TIMER);
+
+	NVIC_SetPriority(TCC3_0_IRQn, IRQ_PRIORITY_CONTROL_TIMER);
+	NVIC_ClearPendingIRQ(TCC3_0_IRQn);
+	NVIC_EnableIRQ(TCC3_0_IRQn);
+	hri_tcc_set_CTRLA_ENABLE_bit(CONTROL_TIMER);
+}
+
+//Releases a cycle
+FAST_CODE void TCC3_0_Handler()
+{
+	hri_tcc_clear_INTFLAG_OVF_bit(CONTROL_TIMER);
+	BaseType_t woken = pdFALSE;
+	vTaskNotifyGiveFromISR(control_task, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+//Timer counts since the last release
+FAST_CODE static uint32_t ReadTimer()
+{
+	//COUNT is only readable after a read synchronization
+	hri_tcc_set_CTRLB_CMD_bf(CONTROL_TIMER, TCC_CTRLBSET_CMD_READSYNC_Val);
+	hri_tcc_wait_for_sync(CONTROL_TIMER, TCC_SYNCBUSY_CTRLB | TCC_SYNCBUSY_COUNT);
+	return hri_tcc_read_COUNT_reg(CONTROL_TIMER);
+}
+
+FAST_CODE void ControlSchedulerWaitForNextCycle(control_scheduler_t* sched)
+{
+	//A release is already waiting, the previous cycle's work ran into the
+	//next deadline. Every missed one is dropped in the same take and the
+	//cycle runs at once, rather than a burst of back to back cycles.
+	uint32_t releases = ulTaskNotifyTake(pdTRUE, 0);
+	uint32_t lateness = ReadTimer() / CONTROL_TIMER_TICKS_PER_US;
+	if( releases != 0 && sched->cycle_count != 0 )
+	{
+		sched->overrun_count++;
+		EventLogWrite(EVENT_LOG_OVERRUN, lateness + (releases - 1) * CONTROL_CORE_CYCLE_US, sched->overrun_count);
+	}
+	if( releases == 0 )
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		lateness = ReadTimer() / CONTROL_TIMER_TICKS_PER_US;
+	}
+
+	sched->last_lateness = lateness;
+	if( lateness > sched->max_lateness )
+		sched->max_lateness = lateness;
+
+	sched->cycle_count++;
+}
+
+FAST_CODE uint32_t ControlSchedulerSinceRelease()
+{
+	return ReadTimer() * (CONF_CPU_FREQUENCY / 1000000) / CONTROL_TIMER_TICKS_PER_US;
+}
+
+#else
+
+//us from the start of tick to now. The time base counts the same ticks as
+//the kernel from the scheduler start (TimeBase.h), so a tick count times
+//the us of a tick is when that tick began, both wrapping in 32 bits alike.
+//Tick counts alone would round every lateness under a tick down to 0.
+FAST_CODE static uint32_t UsSinceTick(TickType_t tick)
+{
+	return (uint32_t)TimeBaseUs() - (uint32_t)tick * TIME_BASE_US_PER_TICK;
+}
+
+void ControlSchedulerInit(control_scheduler_t* sched)
+{
+	memset(sched, 0, sizeof(control_scheduler_t));
+	sched->period = configTICK_RATE_HZ / CONTROL_RATE_HZ;
+	if( sched->period == 0 )
+		sched->period = 1;
+	sched->last_wake = xTaskGetTickCount();
+}
+
+FAST_CODE void ControlSchedulerWaitForNextCycle(control_scheduler_t* sched)
+{
+	TickType_t elapsed = xTaskGetTickCount() - sched->last_wake;
+
+	//The previous cycle's work ran into the next deadline.
+	if( sched->cycle_count != 0 && elapsed >= sched->period )
+	{
+		sched->overrun_count++;
+		EventLogWrite(EVENT_LOG_OVERRUN, UsSinceTick(sched->last_wake + sched->period), sched->overrun_count);
+
+		//A whole cycle was missed. Drop it and re-phase from now, otherwise
+		//vTaskDelayUntil would return immediately and run a burst of back to back cycles.
+		if( elapsed > sched->period )
+			sched->last_wake += elapsed - sched->period;
+	}
+
+	vTaskDelayUntil(&sched->last_wake, sched->period);
+
+	//last_wake now holds the deadline we were released for
+	uint32_t lateness = UsSinceTick(sched->last_wake);
+	sched->last_lateness = lateness;
+	if( lateness > sched->max_lateness )
+		sched->max_lateness = lateness;
+
+	sched->cycle_count++;
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * ControlScheduler.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CONTROLSCHEDULER_H_
+#define CONTROLSCHEDULER_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+//Hard periodic pacing of the control loop.
+//Wake times are derived from the previous deadline rather than from when the
+//work finished, so the cycle phase does not drift with the loop execution time.
+
+//Control cycles per second: 1000, 2000, 4000 or 5000. Only the rate
+//changes with it. The gains stay tuned per ms and the loops integrate over
+//the measured interval (CONTROL_TIMED_PID, ControlCore.h), the filters,
+//shapers and models step by CONTROL_CORE_CYCLE_US, and the stages and
+//timeouts kept in ms stay in ms. build_compare.py profile --rate tells
+//whether the cycle fits the shorter budget.
+#ifndef CONTROL_RATE_HZ
+#define CONTROL_RATE_HZ 1000
+#endif
+
+#if CONTROL_RATE_HZ % 1000 != 0 || 1000000 % CONTROL_RATE_HZ != 0 || CONTROL_RATE_HZ > 5000
+#error CONTROL_RATE_HZ must be 1000, 2000, 4000 or 5000
+#endif
+
+//us between two cycles
+#define CONTROL_CORE_CYCLE_US (1000000 / CONTROL_RATE_HZ)
+#define CONTROL_CYCLES_PER_MS (CONTROL_RATE_HZ / 1000)
+
+//1 releases the cycles from TCC3 rather than from the RTOS tick, which
+//stays at 1 kHz. The faster rates need it. 1 kHz can have it too, but only
+//the tick can be steered onto the PTP schedule (TimeTrigger.h).
+#ifndef CONTROL_SCHEDULER_TIMER
+#define CONTROL_SCHEDULER_TIMER (CONTROL_RATE_HZ > 1000)
+#endif
+
+#if !CONTROL_SCHEDULER_TIMER && CONTROL_RATE_HZ > 1000
+#error The 1 kHz RTOS tick cannot release faster cycles, they need CONTROL_SCHEDULER_TIMER
+#endif
+
+typedef struct control_scheduler_t
+{
+#if !CONTROL_SCHEDULER_TIMER
+	TickType_t period;
+	TickType_t last_wake;
+#endif
+
+	uint32_t cycle_count;
+	//number of cycles whose work ran past the next deadline
+	uint32_t overrun_count;
+	//us between the deadline and the task actually running, from the
+	//release timer or the time base (TimeBase.h), not rounded to ticks
+	uint32_t last_lateness;
+	uint32_t max_lateness;
+} control_scheduler_t;
+
+//From the task that runs the cycles, before the first wait
+void ControlSchedulerInit(control_scheduler_t* sched);
+
+//Blocks until the start of the next control cycle.
+//Call once at the top of every loop iteration.
+void ControlSchedulerWaitForNextCycle(control_scheduler_t* sched);
+
+#if CONTROL_SCHEDULER_TIMER
+//Core cycles since the timer released the cycle running, for
+//PROFILER_STAGE_WAKE. The tick's release is ProfilerEndSinceTick's.
+uint32_t ControlSchedulerSinceRelease();
+#endif
+
+#endif /* CONTROLSCHEDULER_H_ */
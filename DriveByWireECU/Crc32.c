@@ -0,0 +1,238 @@
+/*
+ * Crc32.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "Crc32.h"
+#include "FastCode.h"
+
+#if CRC32_HARDWARE
+#include <compiler.h>
+#include <hri_dsu_e54.h>
+#include <hri_dmac_e54.h>
+#include <hri_pac_e54.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "DmaService.h"
+#include "NetMem.h"
+#include "Log.h"
+#endif
+
+static const uint32_t crc32_table[256] =
+{
+	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+	0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+	0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+	0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+	0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+	0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+	0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+	0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+	0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+	0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+	0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+	0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
+};
+
+FAST_CODE uint32_t Crc32Update(uint32_t crc, const void* data, uint32_t length)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	for(uint32_t i = 0; i < length; ++i)
+		crc = (crc >> 8) ^ crc32_table[(crc ^ bytes[i]) & 0xFF];
+	return crc;
+}
+
+uint32_t Crc32Table(const void* data, uint32_t length)
+{
+	return ~Crc32Update(CRC32_INITIAL, data, length);
+}
+
+#if CRC32_HARDWARE
+
+//Bytes Crc32Init checks the engines with
+#define CRC32_CHECK_LENGTH 256
+
+//set once the DSU matched the table
+static uint8_t dsu_ready;
+//taken by the call using the DSU
+static uint8_t dsu_busy;
+
+static struct
+{
+	int8_t channel;
+	//0 until the first copy matched the table, then 1, -1 if it did not
+	int8_t checked;
+	SemaphoreHandle_t lock;
+	SemaphoreHandle_t done;
+	volatile uint8_t error;
+} crc32_dma = { -1 };
+
+//Software triggered, a whole block per trigger, both sides moving a word
+//per beat
+static const dma_channel_config_t crc32_dma_config =
+{
+	0, DMAC_CHCTRLA_TRIGACT_TRANSACTION_Val, DMAC_BTCTRL_BEATSIZE_WORD_Val, 1, 1, 0, 0
+};
+
+//Runs the DSU over words words from data, both word aligned, carrying on
+//from crc. Returns 0 on a bus error, the DSU only reads what the core may.
+FAST_CODE static uint8_t UpdateDsu(uint32_t* crc, const uint32_t* data, uint32_t words)
+{
+	hri_dsu_clear_STATUSA_reg(DSU, DSU_STATUSA_DONE | DSU_STATUSA_BERR);
+	hri_dsu_write_DATA_reg(DSU, *crc);
+	hri_dsu_write_ADDR_reg(DSU, (uint32_t)data);
+	hri_dsu_write_LENGTH_reg(DSU, words * 4);
+	hri_dsu_write_CTRL_reg(DSU, DSU_CTRL_CRC);
+	while( !hri_dsu_get_STATUSA_DONE_bit(DSU) )
+		;
+	if( hri_dsu_get_STATUSA_BERR_bit(DSU) )
+		return 0;
+	*crc = hri_dsu_read_DATA_reg(DSU);
+	return 1;
+}
+
+FAST_CODE uint32_t Crc32(const void* data, uint32_t length)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint32_t crc = CRC32_INITIAL;
+
+	if( length < CRC32_DSU_MIN_LENGTH || !dsu_ready || __atomic_exchange_n(&dsu_busy, 1, __ATOMIC_ACQUIRE) )
+		return ~Crc32Update(crc, bytes, length);
+
+	uint32_t head = (4 - ((uint32_t)bytes & 3)) & 3;
+	crc = Crc32Update(crc, bytes, head);
+	uint32_t words = (length - head) / 4;
+	uint32_t dsu_crc = crc;
+	if( UpdateDsu(&dsu_crc, (const uint32_t*)(bytes + head), words) )
+		crc = dsu_crc;
+	else
+		crc = Crc32Update(crc, bytes + head, words * 4);
+	__atomic_store_n(&dsu_busy, 0, __ATOMIC_RELEASE);
+
+	return ~Crc32Update(crc, bytes + head + words * 4, length - head - words * 4);
+}
+
+static void Crc32DmaDone(void* arg, uint8_t error)
+{
+	BaseType_t woken = pdFALSE;
+
+	crc32_dma.error = error;
+	xSemaphoreGiveFromISR(crc32_dma.done, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+void Crc32Init()
+{
+	static uint32_t check[CRC32_CHECK_LENGTH / 4];
+
+	for(uint32_t i = 0; i < CRC32_CHECK_LENGTH / 4; ++i)
+		check[i] = i * 0x9E3779B9;
+
+	//the DSU is write protected out of reset
+	hri_pac_write_WRCTRL_reg(PAC, PAC_WRCTRL_PERID(ID_DSU) | PAC_WRCTRL_KEY_CLR);
+	uint32_t crc = CRC32_INITIAL;
+	uint32_t expected = Crc32Table(check, CRC32_CHECK_LENGTH);
+	if( UpdateDsu(&crc, check, CRC32_CHECK_LENGTH / 4) && ~crc == expected )
+		dsu_ready = 1;
+	else
+		LOG("crc32: DSU gave %08lx for %08lx, left off", (unsigned long)~crc, (unsigned long)expected);
+
+	crc32_dma.lock = xSemaphoreCreateMutex();
+	crc32_dma.done = xSemaphoreCreateBinary();
+	if( crc32_dma.lock != NULL && crc32_dma.done != NULL )
+		crc32_dma.channel = DmaAllocate(&crc32_dma_config, Crc32DmaDone, NULL);
+}
+
+//Copies and sums on the channel, returns 0 if the DMAC did not finish
+static uint8_t CopyDma(void* dst, const void* src, uint32_t length, uint32_t* crc)
+{
+	hri_dmac_write_CRCCHKSUM_reg(DMAC, 0xFFFFFFFF);
+	hri_dmac_write_CRCCTRL_reg(DMAC, DMAC_CRCCTRL_CRCBEATSIZE_WORD | DMAC_CRCCTRL_CRCPOLY_CRC32 |
+		DMAC_CRCCTRL_CRCSRC(DMAC_CRCCTRL_CRCSRC_CHN0_Val + crc32_dma.channel));
+	DmaSetBlock(crc32_dma.channel, NULL, src, dst, length / 4, NULL);
+	DmaStart(crc32_dma.channel);
+
+	uint8_t done = xSemaphoreTake(crc32_dma.done, pdMS_TO_TICKS(CRC32_COPY_TIMEOUT)) == pdTRUE && !crc32_dma.error;
+	if( !done )
+		DmaStop(crc32_dma.channel);
+	//read bit reversed and complemented, the final value
+	*crc = hri_dmac_read_CRCCHKSUM_reg(DMAC);
+	hri_dmac_write_CRCCTRL_reg(DMAC, 0);
+	hri_dmac_clear_CRCSTATUS_CRCBUSY_bit(DMAC);
+	return done;
+}
+
+uint32_t Crc32Copy(void* dst, const void* src, uint32_t length)
+{
+	uint32_t crc;
+
+	if( crc32_dma.channel < 0 || crc32_dma.checked < 0 || length == 0 ||
+		(((uint32_t)dst | (uint32_t)src | length) & 3) != 0 )
+	{
+		NetMemcpy(dst, src, length);
+		return Crc32(dst, length);
+	}
+
+	xSemaphoreTake(crc32_dma.lock, portMAX_DELAY);
+	uint8_t copied = CopyDma(dst, src, length, &crc);
+	xSemaphoreGive(crc32_dma.lock);
+
+	if( !copied )
+	{
+		NetMemcpy(dst, src, length);
+		return Crc32(dst, length);
+	}
+	if( crc32_dma.checked == 0 )
+	{
+		uint32_t expected = Crc32Table(dst, length);
+		crc32_dma.checked = crc == expected ? 1 : -1;
+		if( crc != expected )
+		{
+			LOG("crc32: DMAC gave %08lx for %08lx, left off", (unsigned long)crc, (unsigned long)expected);
+			crc = expected;
+		}
+	}
+	return crc;
+}
+
+#else
+
+void Crc32Init()
+{
+}
+
+uint32_t Crc32(const void* data, uint32_t length)
+{
+	return Crc32Table(data, length);
+}
+
+uint32_t Crc32Copy(void* dst, const void* src, uint32_t length)
+{
+	memcpy(dst, src, length);
+	return Crc32Table(dst, length);
+}
+
+#endif
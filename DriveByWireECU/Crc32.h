@@ -0,0 +1,70 @@
+/*
+ * Crc32.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include <stdint.h>
+
+//CRC-32 of zlib, the control protocol frames and the firmware image:
+//reflected, polynomial 0xEDB88320, initial value and final xor 0xFFFFFFFF.
+//
+//Three engines compute it:
+//
+//	table	a byte at a time from a 1 KB table, any length and alignment,
+//			from any context. What every call falls back to.
+//	DSU		the Device Service Unit sums a word aligned run of words in
+//			memory while the core polls. It wins from about
+//			CRC32_DSU_MIN_LENGTH bytes on, below that setting it up costs
+//			more than the table. The unaligned head and the tail go through
+//			the table, the DSU carries on from and hands back the running
+//			value. One user at a time, a call that finds it taken, from
+//			another task or an interrupt, uses the table instead.
+//	DMAC	the DMAC's CRC unit sums what one of its channels moves, so a
+//			buffer is copied and summed in one pass (Crc32Copy).
+//
+//Crc32Init checks the DSU against the table once at boot and the first
+//Crc32Copy checks the DMAC against the table of what it copied. An engine
+//that disagrees is logged and left off. BenchImage.c times the three
+//against each other.
+
+//Set to 0 to compute everything with the table
+#ifndef CRC32_HARDWARE
+#define CRC32_HARDWARE 1
+#endif
+
+//Bytes from which Crc32 hands a buffer to the DSU
+#ifndef CRC32_DSU_MIN_LENGTH
+#define CRC32_DSU_MIN_LENGTH 64
+#endif
+
+//ms a Crc32Copy may take before it counts as lost, far more than 64 KB
+//take on the bus
+#define CRC32_COPY_TIMEOUT 10
+
+//Unlocks the DSU, checks it and takes the DMA channel for Crc32Copy.
+//Once at boot after atmel_start_init, the table works before it.
+void Crc32Init();
+
+//CRC-32 of length bytes at data, on the DSU when it is free and the buffer
+//long enough. From any context.
+uint32_t Crc32(const void* data, uint32_t length);
+
+//Running value of a CRC-32 summed in pieces, with the table: starts at
+//CRC32_INITIAL, the CRC-32 is its complement once every piece is in
+#define CRC32_INITIAL 0xFFFFFFFF
+uint32_t Crc32Update(uint32_t crc, const void* data, uint32_t length);
+
+//Crc32 with the table only, for the benchmark
+uint32_t Crc32Table(const void* data, uint32_t length);
+
+//Copies length bytes from src to dst, which may not overlap, and returns
+//their CRC-32. Word aligned buffers of whole words go through the DMAC
+//with its CRC unit summing on the way, anything else is copied and then
+//summed with Crc32. From a task, blocks while the DMAC runs.
+uint32_t Crc32Copy(void* dst, const void* src, uint32_t length);
+
+#endif /* CRC32_H_ */
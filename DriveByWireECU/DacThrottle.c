@@ -0,0 +1,183 @@
+/*
+ * DacThrottle.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hal_gpio.h>
+#include <hri_dac_e54.h>
+#include <hri_tc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include "DacThrottle.h"
+#include "DmaService.h"
+#include "ControlCore.h"
+#include "FastCode.h"
+#include "Peripherals.h"
+
+#if DAC_THROTTLE_ENABLE
+
+#define DAC_THROTTLE_CHANNEL 1
+#define DAC_THROTTLE_FULL_SCALE 0xFFF
+
+#if DAC_THROTTLE_RAMP
+//PWM_3's timer, nothing else uses it, brought up by InitRamp
+#define DAC_THROTTLE_RAMP_TC TC6
+
+//12MHz ticks between two codes of a ramp over a control cycle
+#define DAC_THROTTLE_STEP_TICKS (CONF_GCLK_TC6_FREQUENCY / CONTROL_RATE_HZ / DAC_THROTTLE_RAMP_STEPS)
+
+#if DAC_THROTTLE_STEP_TICKS > 0xFFFF || DAC_THROTTLE_STEP_TICKS < 24
+#error DAC_THROTTLE_RAMP_STEPS does not fit the control cycle, a step has to be 2us to 5ms
+#endif
+
+//TC6 overflow -> DAC1 DATA, one code each
+static const dma_channel_config_t dac_throttle_ramp_config =
+{
+	TC6_DMAC_ID_OVF, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_HWORD_Val, 1, 0, 1, 0
+};
+#endif
+
+typedef struct dac_throttle_t
+{
+	//code of a throttle of 0, and codes per throttle of 1
+	float zero_code;
+	float span_code;
+	//last written, or where the running ramp ends
+	volatile uint16_t code;
+#if DAC_THROTTLE_RAMP
+	int8_t ramp_dma;
+	uint16_t ramp[DAC_THROTTLE_RAMP_STEPS];
+#endif
+} dac_throttle_t;
+
+static dac_throttle_t dac_throttle;
+
+static void SetCalibration(float zero_volts, float full_volts)
+{
+	dac_throttle.zero_code = zero_volts * (DAC_THROTTLE_FULL_SCALE / DAC_THROTTLE_VREF);
+	dac_throttle.span_code = (full_volts - zero_volts) * (DAC_THROTTLE_FULL_SCALE / DAC_THROTTLE_VREF);
+}
+
+FAST_CODE static uint16_t ThrottleCode(float throttle)
+{
+	if( throttle < 0.0f )
+		throttle = 0.0f;
+	else if( throttle > 1.0f )
+		throttle = 1.0f;
+
+	float code = dac_throttle.zero_code + throttle * dac_throttle.span_code;
+	if( code < 0.0f )
+		return 0;
+	if( code > DAC_THROTTLE_FULL_SCALE )
+		return DAC_THROTTLE_FULL_SCALE;
+	return (uint16_t)code;
+}
+
+#if DAC_THROTTLE_RAMP
+//Takes TC6 over from the PWM driver as the ramp's step clock, with ramps
+//only there is no need to stop it in between
+static void InitRamp()
+{
+	dac_throttle.ramp_dma = DmaAllocate(&dac_throttle_ramp_config, NULL, NULL);
+	PeripheralRequire(PERIPHERAL_PWM_3);
+
+	hri_tc_write_CTRLA_reg(DAC_THROTTLE_RAMP_TC, TC_CTRLA_SWRST);
+	hri_tc_wait_for_sync(DAC_THROTTLE_RAMP_TC, TC_SYNCBUSY_SWRST);
+	hri_tc_write_WAVE_reg(DAC_THROTTLE_RAMP_TC, TC_WAVE_WAVEGEN_MFRQ);
+	hri_tccount16_write_CC_reg(DAC_THROTTLE_RAMP_TC, 0, DAC_THROTTLE_STEP_TICKS - 1);
+	hri_tc_write_CTRLA_reg(DAC_THROTTLE_RAMP_TC, TC_CTRLA_MODE_COUNT16 | TC_CTRLA_ENABLE);
+}
+#endif
+
+void DacThrottleInit()
+{
+	SetCalibration(DAC_THROTTLE_ZERO_VOLTS, DAC_THROTTLE_FULL_VOLTS);
+
+	hri_mclk_set_APBDMASK_DAC_bit(MCLK);
+	//the 12MHz of the PWM timers, the most the DAC takes
+	hri_gclk_write_PCHCTRL_reg(GCLK, DAC_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+	hri_dac_write_CTRLA_reg(DAC, DAC_CTRLA_SWRST);
+	hri_dac_wait_for_sync(DAC, DAC_SYNCBUSY_SWRST);
+	hri_dac_write_CTRLB_reg(DAC, DAC_CTRLB_REFSEL_VDDANA);
+	//refreshed every 30us, the output holds on a sampled capacitor
+	hri_dac_write_DACCTRL_reg(DAC, DAC_THROTTLE_CHANNEL, DAC_DACCTRL_ENABLE | DAC_DACCTRL_CCTRL_CC12M | DAC_DACCTRL_REFRESH(1));
+	dac_throttle.code = ThrottleCode(0.0f);
+	hri_dac_write_CTRLA_reg(DAC, DAC_CTRLA_ENABLE);
+	hri_dac_wait_for_sync(DAC, DAC_SYNCBUSY_ENABLE);
+	while( !hri_dac_get_STATUS_READY1_bit(DAC) )
+		;
+	hri_dac_write_DATA_reg(DAC, DAC_THROTTLE_CHANNEL, dac_throttle.code);
+
+	//the pin leaves PWM_0, which is never started
+	gpio_set_pin_direction(DAC_THROTTLE_PIN, GPIO_DIRECTION_OFF);
+	gpio_set_pin_function(DAC_THROTTLE_PIN, DAC_THROTTLE_PINMUX);
+
+#if DAC_THROTTLE_RAMP
+	InitRamp();
+#endif
+}
+
+void DacThrottleCalibrate(const param_set_t* params)
+{
+	SetCalibration(params->values[PARAM_THROTTLE_ZERO].f, params->values[PARAM_THROTTLE_FULL].f);
+}
+
+FAST_CODE void DacThrottleSet(float throttle)
+{
+	uint16_t code = ThrottleCode(throttle);
+	if( code == dac_throttle.code )
+		return;
+
+#if DAC_THROTTLE_RAMP
+	//without a channel the throttle steps like it would without ramps
+	if( dac_throttle.ramp_dma >= 0 )
+	{
+		//the last ramp ended a cycle ago, unless this is early
+		DmaStop(dac_throttle.ramp_dma);
+		int32_t from = dac_throttle.code;
+		int32_t step = (int32_t)code - from;
+		for(int i = 0; i < DAC_THROTTLE_RAMP_STEPS; ++i)
+			dac_throttle.ramp[i] = (uint16_t)(from + step * (i + 1) / DAC_THROTTLE_RAMP_STEPS);
+		DmaSetBlock(dac_throttle.ramp_dma, NULL, dac_throttle.ramp, &DAC->DATA[DAC_THROTTLE_CHANNEL].reg,
+			DAC_THROTTLE_RAMP_STEPS, NULL);
+		dac_throttle.code = code;
+		DmaStart(dac_throttle.ramp_dma);
+		return;
+	}
+#endif
+	dac_throttle.code = code;
+	hri_dac_write_DATA_reg(DAC, DAC_THROTTLE_CHANNEL, code);
+}
+
+FAST_CODE void DacThrottleForce(float throttle)
+{
+#if DAC_THROTTLE_RAMP
+	if( dac_throttle.ramp_dma >= 0 )
+		DmaStop(dac_throttle.ramp_dma);
+#endif
+	dac_throttle.code = ThrottleCode(throttle);
+	hri_dac_write_DATA_reg(DAC, DAC_THROTTLE_CHANNEL, dac_throttle.code);
+}
+
+#else
+
+void DacThrottleInit()
+{
+}
+
+void DacThrottleCalibrate(const param_set_t* params)
+{
+}
+
+void DacThrottleSet(float throttle)
+{
+}
+
+void DacThrottleForce(float throttle)
+{
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * DacThrottle.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef DACTHROTTLE_H_
+#define DACTHROTTLE_H_
+
+#include <stdint.h>
+#include "ParamStore.h"
+
+//The throttle as a voltage from DAC1 instead of the 1kHz acceleration PWM
+//(DriveByWireIO.c).
+//
+//The throttle input of the motor controller is analog. Fed from the PWM it
+//needs an RC filter to smooth the 1kHz pulses, and a filter that takes the
+//ripple down far enough lags the duty by tens of ms. DAC1 drives the
+//voltage on the same pin instead, PA05, and settles within a few us of a
+//write, the RC filter comes off the board.
+//
+//The throttle range is calibrated in volts: a throttle of 0 is
+//PARAM_THROTTLE_ZERO, 1 is PARAM_THROTTLE_FULL, both read at boot. The DAC
+//refers to VDDANA, so neither can be above DAC_THROTTLE_VREF.
+//
+//With DAC_THROTTLE_RAMP a new throttle is not written in one step but
+//ramped to over one control cycle, so the output a cycle holds follows the
+//commands as a line instead of a staircase. TC6, a PWM_3 that drives
+//nothing since the rear brake went, paces a DmaService channel that copies
+//DAC_THROTTLE_RAMP_STEPS codes to the DAC, without CPU involvement. A ramp
+//starts from where the previous one was going to end.
+//
+//The estop and every other forced stop go to DacThrottleForce, which stops
+//a ramp and writes the DAC there and then. The DAC has no fault input like
+//the TCCs, the estop interrupt is what cuts it, about a us after the press.
+
+#ifndef DAC_THROTTLE_ENABLE
+#define DAC_THROTTLE_ENABLE 0
+#endif
+
+//1 ramps every new throttle in over a control cycle, as above
+#ifndef DAC_THROTTLE_RAMP
+#define DAC_THROTTLE_RAMP 0
+#endif
+
+//Codes per ramp
+#ifndef DAC_THROTTLE_RAMP_STEPS
+#define DAC_THROTTLE_RAMP_STEPS 32
+#endif
+
+//DAC1 VOUT, where PWM_0 was
+#define DAC_THROTTLE_PIN GPIO(GPIO_PORTA, 5)
+#define DAC_THROTTLE_PINMUX PINMUX_PA05B_DAC_VOUT1
+
+//VDDANA, the DAC reference, in volts
+#define DAC_THROTTLE_VREF 3.3f
+
+//Defaults of PARAM_THROTTLE_ZERO and PARAM_THROTTLE_FULL, volts
+#ifndef DAC_THROTTLE_ZERO_VOLTS
+#define DAC_THROTTLE_ZERO_VOLTS 0.5f
+#endif
+#ifndef DAC_THROTTLE_FULL_VOLTS
+#define DAC_THROTTLE_FULL_VOLTS 3.0f
+#endif
+
+//Starts DAC1 at a throttle of 0 on the default calibration. Call before
+//anything sets the throttle.
+void DacThrottleInit();
+
+//Takes the calibration from the parameters, once they are loaded at boot
+void DacThrottleCalibrate(const param_set_t* params);
+
+//Throttle in [0, 1], clamped, written or with DAC_THROTTLE_RAMP ramped to
+//over the control cycle. From main_task.
+void DacThrottleSet(float throttle);
+
+//Throttle in [0, 1] now, whatever ramp was running. Safe from the estop
+//interrupt.
+void DacThrottleForce(float throttle);
+
+#endif /* DACTHROTTLE_H_ */
@@ -0,0 +1,74 @@
+/*
+ * DeadlineMonitor.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "DeadlineMonitor.h"
+#include "FastCode.h"
+#include "EventLog.h"
+#include "TimeBase.h"
+
+void DeadlineMonitorInit(deadline_monitor_t* monitor)
+{
+	memset(monitor, 0, sizeof(deadline_monitor_t));
+}
+
+void DeadlineRegister(deadline_monitor_t* monitor, deadline_id_t id, uint32_t timeout, deadline_action_t action, void* arg)
+{
+	deadline_t* deadline = &monitor->deadlines[id];
+
+	deadline->timeout = timeout;
+	deadline->action = action;
+	deadline->arg = arg;
+	deadline->armed = 0;
+	deadline->expired = 0;
+}
+
+FAST_CODE void DeadlineKick(deadline_monitor_t* monitor, deadline_id_t id, uint32_t event_time)
+{
+	deadline_t* deadline = &monitor->deadlines[id];
+
+	if( deadline->armed && TIME_REACHED(deadline->last_event, event_time) )
+		return;
+
+	deadline->armed = 1;
+	deadline->expired = 0;
+	deadline->last_event = event_time;
+	deadline->expires = event_time + deadline->timeout;
+
+	//a later expiry leaves next_check early, the check then just finds
+	//nothing due and moves it on
+	if( !monitor->pending || TIME_REACHED(monitor->next_check, deadline->expires) )
+		monitor->next_check = deadline->expires;
+	monitor->pending = 1;
+}
+
+FAST_CODE void DeadlineMonitorCheck(deadline_monitor_t* monitor, uint32_t now)
+{
+	if( !monitor->pending || !TIME_REACHED(now, monitor->next_check) )
+		return;
+
+	monitor->pending = 0;
+	for(int i = 0; i < DEADLINE_COUNT; ++i)
+	{
+		deadline_t* deadline = &monitor->deadlines[i];
+		if( !deadline->armed || deadline->expired )
+			continue;
+
+		if( TIME_REACHED(now, deadline->expires) )
+		{
+			deadline->expired = 1;
+			monitor->expired_count++;
+			EventLogWrite(EVENT_LOG_DEADLINE, i, now - deadline->last_event);
+			if( deadline->action )
+				deadline->action(deadline->arg, (deadline_id_t)i, now - deadline->last_event);
+			continue;
+		}
+
+		if( !monitor->pending || TIME_REACHED(monitor->next_check, deadline->expires) )
+			monitor->next_check = deadline->expires;
+		monitor->pending = 1;
+	}
+}
@@ -0,0 +1,91 @@
+/*
+ * DeadlineMonitor.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef DEADLINEMONITOR_H_
+#define DEADLINEMONITOR_H_
+
+#include <stdint.h>
+
+//Timeouts of everything the control loop depends on arriving in time.
+//A deadline is kicked with the time of each new event from its source and
+//expires timeout ms after the newest one. On expiry it is logged
+//(EVENT_LOG_DEADLINE) and its action runs once, from DeadlineMonitorCheck,
+//and it stays expired until the next event.
+//A deadline only starts counting with its first event, a source that was
+//never seen does not time out.
+//
+//Times are RTOS ticks (ms) compared by their difference, so they are safe
+//across the tick counter wrapping. Everything runs in main_task.
+//
+//To add a deadline, add its id here and register it at startup.
+typedef enum deadline_id_t
+{
+	//commands from the PC. 0, the arg the comm timeout was always logged with
+	DEADLINE_COMM = 0,
+	//commands recent enough to drive by tele operation
+	DEADLINE_TELEOP,
+	//CAN wheel speed sensor frames
+	DEADLINE_WHEEL_SPEED,
+	//EPS status frames, the steering actuator reporting what it applied
+	DEADLINE_EPS_FEEDBACK,
+	DEADLINE_COUNT
+} deadline_id_t;
+
+//overdue: ms from the last event to the check that found it expired
+typedef void (*deadline_action_t)(void* arg, deadline_id_t id, uint32_t overdue);
+
+typedef struct deadline_t
+{
+	uint32_t timeout;
+	uint32_t last_event;
+	uint32_t expires;
+	//may be NULL for deadlines that are only polled
+	deadline_action_t action;
+	void* arg;
+	uint8_t armed;
+	uint8_t expired;
+} deadline_t;
+
+typedef struct deadline_monitor_t
+{
+	deadline_t deadlines[DEADLINE_COUNT];
+	//no armed deadline expires before this, only valid while pending
+	uint32_t next_check;
+	uint8_t pending;
+	uint32_t expired_count;
+} deadline_monitor_t;
+
+void DeadlineMonitorInit(deadline_monitor_t* monitor);
+
+//Sets the timeout in ms and what to do on expiry. The deadline is disarmed
+//until its next event.
+void DeadlineRegister(deadline_monitor_t* monitor, deadline_id_t id, uint32_t timeout, deadline_action_t action, void* arg);
+
+//An event from the deadline's source at event_time. Events no newer than the
+//last one are ignored, so a source can be kicked every cycle with the time
+//of its newest sample.
+void DeadlineKick(deadline_monitor_t* monitor, deadline_id_t id, uint32_t event_time);
+
+//Runs the actions of deadlines that expired by now. Call once per control
+//cycle after the kicks. A single compare while nothing is due, the
+//deadlines are only walked when the earliest expiry is reached.
+void DeadlineMonitorCheck(deadline_monitor_t* monitor, uint32_t now);
+
+//Non-zero if the deadline has seen an event and had not expired at the last
+//check
+static inline uint8_t DeadlineMet(const deadline_monitor_t* monitor, deadline_id_t id)
+{
+	const deadline_t* deadline = &monitor->deadlines[id];
+	return deadline->armed && !deadline->expired;
+}
+
+//Non-zero if the deadline expired and no event came since
+static inline uint8_t DeadlineMissed(const deadline_monitor_t* monitor, deadline_id_t id)
+{
+	return monitor->deadlines[id].expired;
+}
+
+#endif /* DEADLINEMONITOR_H_ */
@@ -0,0 +1,57 @@
+/*
+ * DeltaCodec.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "DeltaCodec.h"
+#include "FastCode.h"
+
+void DeltaCodecReset(delta_codec_t* codec, uint8_t fields)
+{
+	memset(codec, 0, sizeof(*codec));
+	codec->fields = fields < DELTA_CODEC_MAX_FIELDS ? fields : DELTA_CODEC_MAX_FIELDS;
+}
+
+FAST_CODE uint16_t DeltaCodecEncode(delta_codec_t* codec, const uint32_t* record, uint8_t* out)
+{
+	uint8_t* p = out;
+	for(uint8_t i = 0; i < codec->fields; ++i)
+	{
+		int32_t delta = (int32_t)(record[i] - codec->last[i]);
+		codec->last[i] = record[i];
+		uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+		while( zigzag >= 0x80 )
+		{
+			*p++ = (uint8_t)(zigzag | 0x80);
+			zigzag >>= 7;
+		}
+		*p++ = (uint8_t)zigzag;
+	}
+	return (uint16_t)(p - out);
+}
+
+FAST_CODE uint16_t DeltaCodecDecode(delta_codec_t* codec, const uint8_t* in, uint16_t len, uint32_t* record)
+{
+	const uint8_t* p = in;
+	const uint8_t* end = in + len;
+	for(uint8_t i = 0; i < codec->fields; ++i)
+	{
+		uint32_t zigzag = 0;
+		uint8_t shift = 0;
+		uint8_t byte;
+		do
+		{
+			if( p == end || shift > 28 )
+				return 0;
+			byte = *p++;
+			zigzag |= (uint32_t)(byte & 0x7F) << shift;
+			shift += 7;
+		} while( byte & 0x80 );
+		int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+		codec->last[i] += (uint32_t)delta;
+		record[i] = codec->last[i];
+	}
+	return (uint16_t)(p - in);
+}
@@ -0,0 +1,51 @@
+/*
+ * DeltaCodec.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef DELTACODEC_H_
+#define DELTACODEC_H_
+
+#include <stdint.h>
+
+//Streaming compression of fixed records of 32-bit words, for the SD log
+//(SdLogger.h), the packed trace dump (BulkChannel.h) and the state the
+//active ECU replicates to its standby (Redundancy.h).
+//
+//Each word is coded as its difference to the same word of the record
+//before, zigzag folded so a small negative difference is a small number,
+//then as a varint: 7 bits a byte, low bits first, the top bit set on every
+//byte but the last. A word that did not change is one byte, one that moves
+//by less than 64 either way too, and any word at most 5. The work per
+//record is the same loop over its words whatever the values, so the worst
+//case is fixed. Floats are coded by their bits, a slowly changing one
+//still only differs in the low bits of the mantissa.
+//
+//The first record after a reset is coded against all zero words, readers
+//start decoding there. PythonTestScripts/delta_codec.py is the decoder
+//for the logs, DeltaCodecDecode the one on the ECU.
+
+#define DELTA_CODEC_MAX_FIELDS 32
+//Most bytes a record of fields words can take
+#define DELTA_CODEC_MAX_BYTES(fields) ((fields) * 5)
+
+typedef struct delta_codec_t
+{
+	uint8_t fields;
+	uint32_t last[DELTA_CODEC_MAX_FIELDS];
+} delta_codec_t;
+
+//Starts over with records of fields words, at most DELTA_CODEC_MAX_FIELDS
+void DeltaCodecReset(delta_codec_t* codec, uint8_t fields);
+
+//Writes record, codec->fields words, to out and returns the bytes written.
+//out must hold DELTA_CODEC_MAX_BYTES(codec->fields).
+uint16_t DeltaCodecEncode(delta_codec_t* codec, const uint32_t* record, uint8_t* out);
+
+//Reads one record of codec->fields words from the len bytes at in into
+//record and returns the bytes read. 0 if in ends inside the record, codec
+//is then out of step with the encoder until both are reset.
+uint16_t DeltaCodecDecode(delta_codec_t* codec, const uint8_t* in, uint16_t len, uint32_t* record);
+
+#endif /* DELTACODEC_H_ */
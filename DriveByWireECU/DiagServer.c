@@ -0,0 +1,777 @@
+/*
+ * DiagServer.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "lwip/tcp.h"
+#include "DiagServer.h"
+#include "main_context.h"
+#include "TaskMonitor.h"
+#include "PoolMonitor.h"
+#include "PhyMonitor.h"
+#include "PcSampler.h"
+#include "NetLatency.h"
+#include "SignalBus.h"
+#include "NodeIdentity.h"
+#include "AdcSampler.h"
+#include "Ptp.h"
+#include "TimeTrigger.h"
+#include "Log.h"
+
+#if DIAG_SERVER_ENABLE && LWIP_TCP
+
+//tcp_poll interval, in units of the 500 ms TCP coarse timer
+#define DIAG_POLL_INTERVAL 2
+
+//PC sampler bins per item of the samples page
+#define DIAG_SAMPLE_GROUP 16
+
+//What the status page shows, copied out of main_context_t and the signal
+//bus in one go
+typedef struct diag_status_t
+{
+	uint32_t tick;
+	uint32_t cycles;
+	uint32_t overruns;
+	uint32_t max_lateness;
+	float vehicle_speed;
+	float steering_angle;
+	float vehicle_speed_requested;
+	float steering_angle_requested;
+	float vehicle_speed_commanded;
+	float steering_angle_commanded;
+	float steering_torque_pid_out;
+	float acceleration_pid_out;
+	uint8_t estop_in;
+	uint8_t reverse;
+	vehicle_mode_t mode;
+	uint8_t autonomous_mode;
+	uint8_t tele_operation_enabled;
+	uint8_t park_brake_commanded;
+	uint8_t pc_comm_active;
+	phy_monitor_stats_t link;
+	ptp_stats_t ptp;
+	time_trigger_stats_t schedule;
+} diag_status_t;
+
+typedef struct diag_writer_t
+{
+	char* data;
+	uint16_t length;
+	uint16_t size;
+	//an append did not fit, the item is rolled back and goes in the next chunk
+	uint8_t full;
+} diag_writer_t;
+
+struct diag_connection_t;
+
+typedef struct diag_page_t
+{
+	const char* path;
+	//copies what the page shows, NULL for pages that read as they go
+	void (*snapshot)(struct diag_connection_t* connection);
+	//Appends item index. Returns 0 past the last item.
+	uint8_t (*item)(struct diag_connection_t* connection, diag_writer_t* writer, uint16_t index);
+} diag_page_t;
+
+typedef struct diag_connection_t
+{
+	struct tcp_pcb* pcb;
+	char request[DIAG_REQUEST_SIZE];
+	uint8_t request_length;
+	//NULL until the request line is complete
+	const diag_page_t* page;
+	//next item of the page
+	uint16_t item;
+	uint8_t page_done;
+	//rendered, chunk_sent of it handed to tcp so far
+	char chunk[DIAG_CHUNK_SIZE];
+	uint16_t chunk_length;
+	uint16_t chunk_sent;
+	uint8_t idle_polls;
+	union
+	{
+		diag_status_t status;
+		task_monitor_snapshot_t tasks;
+		//samples in the trace page
+		uint16_t trace_count;
+		struct
+		{
+			pc_sampler_stats_t stats;
+			//first bin counted in each region, as the request came in
+			uint16_t first[PC_SAMPLER_REGION_COUNT];
+		} samples;
+	} snapshot;
+} diag_connection_t;
+
+typedef struct diag_server_t
+{
+	main_context_t* ctx;
+	struct tcp_pcb* listen_pcb;
+	diag_connection_t connections[DIAG_MAX_CONNECTIONS];
+} diag_server_t;
+
+static diag_server_t diag_server;
+
+static void Append(diag_writer_t* writer, const char* format, ...)
+{
+	if( writer->full )
+		return;
+
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(writer->data + writer->length, writer->size - writer->length, format, args);
+	va_end(args);
+	if( length < 0 || length >= writer->size - writer->length )
+		writer->full = 1;
+	else
+		writer->length += length;
+}
+
+//printf has no float support here, three decimals are plenty
+static void AppendFloat(diag_writer_t* writer, const char* name, float value, const char* separator)
+{
+	int32_t milli = (int32_t)(value * (value < 0 ? -1000.0f : 1000.0f) + 0.5f);
+	Append(writer, "\"%s\":%s%ld.%03ld%s", name, value < 0 ? "-" : "", milli / 1000, milli % 1000, separator);
+}
+
+static uint8_t HeaderItem(diag_writer_t* writer)
+{
+	Append(writer, "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n");
+	return 1;
+}
+
+static void StatusSnapshot(diag_connection_t* connection)
+{
+	const main_context_t* ctx = diag_server.ctx;
+	diag_status_t* status = &connection->snapshot.status;
+	//main_task keeps writing, every field is a single aligned load, the
+	//cycle's values come off the signal bus
+	status->tick = ctx->current_time;
+	status->cycles = ctx->scheduler.cycle_count;
+	status->overruns = ctx->scheduler.overrun_count;
+	status->max_lateness = ctx->scheduler.max_lateness;
+	status->vehicle_speed = SignalReadFloat(SIGNAL_VEHICLE_SPEED);
+	status->steering_angle = SignalReadFloat(SIGNAL_STEERING_ANGLE);
+	status->vehicle_speed_requested = SignalReadFloat(SIGNAL_VEHICLE_SPEED_REQUESTED);
+	status->steering_angle_requested = SignalReadFloat(SIGNAL_STEERING_ANGLE_REQUESTED);
+	status->vehicle_speed_commanded = SignalReadFloat(SIGNAL_VEHICLE_SPEED_COMMANDED);
+	status->steering_angle_commanded = SignalReadFloat(SIGNAL_STEERING_ANGLE_COMMANDED);
+	status->steering_torque_pid_out = SignalReadFloat(SIGNAL_STEERING_TORQUE_PID_OUT);
+	status->acceleration_pid_out = SignalReadFloat(SIGNAL_ACCELERATION_PID_OUT);
+	status->estop_in = SignalReadUint(SIGNAL_ESTOP);
+	status->reverse = SignalReadUint(SIGNAL_REVERSE);
+	status->mode = (vehicle_mode_t)SignalReadUint(SIGNAL_VEHICLE_MODE);
+	status->autonomous_mode = SignalReadUint(SIGNAL_AUTONOMOUS_MODE);
+	status->tele_operation_enabled = SignalReadUint(SIGNAL_TELE_OPERATION);
+	status->park_brake_commanded = SignalReadUint(SIGNAL_PARK_BRAKE_COMMANDED);
+	status->pc_comm_active = SignalReadUint(SIGNAL_PC_COMM_ACTIVE);
+	PhyMonitorRead(&status->link);
+	PtpRead(&status->ptp);
+	TimeTriggerRead(&status->schedule);
+}
+
+static uint8_t StatusItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	const diag_status_t* status = &connection->snapshot.status;
+	switch( index )
+	{
+	case 0:
+		return HeaderItem(writer);
+	case 1:
+		Append(writer, "{\"node\":%u,\"tick\":%lu,\"cycles\":%lu,\"overruns\":%lu,\"max_lateness\":%lu,\n",
+			NodeIdentity()->id, status->tick, status->cycles, status->overruns, status->max_lateness);
+		break;
+	case 2:
+		Append(writer, "\"measured\":{");
+		AppendFloat(writer, "vehicle_speed", status->vehicle_speed, ",");
+		AppendFloat(writer, "steering_angle", status->steering_angle, ",");
+		Append(writer, "\"estop\":%u,\"reverse\":%u,\"window_trips\":%lu},\n", status->estop_in, status->reverse,
+			AdcSamplerTrips());
+		break;
+	case 3:
+		Append(writer, "\"requested\":{");
+		AppendFloat(writer, "vehicle_speed", status->vehicle_speed_requested, ",");
+		AppendFloat(writer, "steering_angle", status->steering_angle_requested, "},\n");
+		Append(writer, "\"commanded\":{");
+		AppendFloat(writer, "vehicle_speed", status->vehicle_speed_commanded, ",");
+		AppendFloat(writer, "steering_angle", status->steering_angle_commanded, "},\n");
+		break;
+	case 4:
+		Append(writer, "\"outputs\":{");
+		AppendFloat(writer, "steering_torque", status->steering_torque_pid_out, ",");
+		AppendFloat(writer, "acceleration", status->acceleration_pid_out, "},\n");
+		break;
+	case 5:
+		Append(writer, "\"mode\":\"%s\",\"modes\":{\"autonomous\":%u,\"tele_operation\":%u,\"park_brake\":%u,\"pc_comm\":%u},\n",
+			VehicleModeName(status->mode), status->autonomous_mode, status->tele_operation_enabled, status->park_brake_commanded, status->pc_comm_active);
+		break;
+	case 6:
+		Append(writer, "\"link\":{\"up\":%u,\"speed\":%u,\"full_duplex\":%u,\"drops\":%lu,\"last_outage\":%lu},\n",
+			status->link.up, status->link.speed, status->link.full_duplex, status->link.drops, status->link.last_outage);
+		break;
+	case 7:
+		Append(writer, "\"ptp\":{\"synced\":%u,\"offset\":%ld,\"path_delay\":%ld,\"adjustment\":%ld,\"syncs\":%lu,\"steps\":%lu},\n",
+			status->ptp.synced, status->ptp.offset, status->ptp.path_delay, status->ptp.adjustment, status->ptp.syncs,
+			status->ptp.steps);
+		break;
+	case 8:
+		Append(writer, "\"schedule\":{\"locked\":%u,\"slot\":%u,\"phase_error\":%ld,\"trim\":%ld,\"held\":%lu,\"locks\":%lu}}\n",
+			status->schedule.locked, status->schedule.slot, status->schedule.phase_error, status->schedule.trim,
+			status->schedule.held, status->schedule.locks);
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static void TasksSnapshot(diag_connection_t* connection)
+{
+	TaskMonitorRead(&connection->snapshot.tasks);
+}
+
+static uint8_t TasksItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	const task_monitor_snapshot_t* tasks = &connection->snapshot.tasks;
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index == 1 )
+	{
+		Append(writer, "{\"period\":%lu,\"interrupt_stack_free\":%u,\"tasks\":[\n", tasks->period,
+			tasks->interrupt_stack_free);
+		return 1;
+	}
+
+	index -= 2;
+	if( index > tasks->count )
+		return 0;
+	if( index == tasks->count )
+	{
+		Append(writer, "]}\n");
+		return 1;
+	}
+
+	const task_monitor_entry_t* task = &tasks->tasks[index];
+	//load in 1/1000
+	Append(writer, "{\"name\":\"%.*s\",\"number\":%u,\"priority\":%u,\"load\":%u,\"stack_free\":%u}%s\n",
+		configMAX_TASK_NAME_LEN, task->name, task->number, task->priority, task->load, task->stack_free,
+		index + 1 < tasks->count ? "," : "");
+	return 1;
+}
+
+static const char* const trace_state_names[] = { "armed", "triggered", "frozen" };
+
+static void AppendTerm(diag_writer_t* writer, const char* name, const pid_trace_term_t* term, const char* separator)
+{
+	Append(writer, "\"%s\":[%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld]%s", name, term->setpoint, term->feedback, term->error,
+		term->integral, term->p_term, term->i_term, term->d_term, term->output, separator);
+}
+
+static uint8_t TraceItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	const pid_trace_t* trace = &diag_server.ctx->trace;
+	uint16_t* count = &connection->snapshot.trace_count;
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index == 1 )
+	{
+		//count and trigger are only settled once frozen
+		pid_trace_state_t state = PIDTraceState(trace);
+		uint8_t frozen = state == PID_TRACE_FROZEN;
+		*count = frozen ? trace->count : 0;
+		Append(writer, "{\"state\":\"%s\",\"trigger_reason\":%u,\"trigger_tick\":%lu,\"count\":%u,\n"
+			"\"columns\":[\"setpoint\",\"feedback\",\"error\",\"integral\",\"p\",\"i\",\"d\",\"output\"],\"samples\":[\n",
+			trace_state_names[state], frozen ? trace->trigger_reason : 0, frozen ? trace->trigger_tick : 0, *count);
+		return 1;
+	}
+
+	//samples from index 2, then the closing item
+	if( index > *count + 2 )
+		return 0;
+	const pid_trace_sample_t* sample = index < *count + 2 ? PIDTraceSample(trace, index - 2) : NULL;
+	if( sample == NULL )
+	{
+		//rearmed meanwhile, the samples end here
+		*count = index - 2;
+		Append(writer, "]}\n");
+		return 1;
+	}
+
+	Append(writer, "%s{\"tick\":%lu,", index > 2 ? "," : "", sample->tick);
+	AppendTerm(writer, "steering", &sample->controller[PID_TRACE_STEERING], ",");
+	AppendTerm(writer, "speed", &sample->controller[PID_TRACE_SPEED], "}\n");
+	return 1;
+}
+
+static uint8_t PoolsItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	uint16_t count = PoolMonitorCount();
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index == 1 )
+	{
+		//measured as the request arrives, under the tcpip thread's own load
+		PoolMonitorMeasure();
+		Append(writer, "{\"samples\":%u,\"pools\":[\n", POOL_MONITOR_SAMPLES);
+		return 1;
+	}
+
+	index -= 2;
+	if( index > count )
+		return 0;
+	if( index == count )
+	{
+		Append(writer, "]}\n");
+		return 1;
+	}
+
+	pool_monitor_stats_t pool;
+	PoolMonitorRead(index, &pool);
+	Append(writer, "{\"name\":\"%s\",\"size\":%u,\"count\":%u,\"used\":%u,\"max\":%u,\"failed\":%lu,"
+		"\"cycles_mean\":%lu,\"cycles_max\":%lu}%s\n", pool.name, pool.size, pool.count, pool.used, pool.max,
+		pool.failed, pool.cycles_mean, pool.cycles_max, index + 1 < count ? "," : "");
+	return 1;
+}
+
+static uint8_t PipelineItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	const control_pipeline_t* pipeline = &diag_server.ctx->pipeline;
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index == 1 )
+	{
+		Append(writer, "{\"core_clock\":%lu,\"stages\":[\n", (uint32_t)configCPU_CLOCK_HZ);
+		return 1;
+	}
+
+	index -= 2;
+	if( index > pipeline->count )
+		return 0;
+	if( index == pipeline->count )
+	{
+		Append(writer, "]}\n");
+		return 1;
+	}
+
+	const control_stage_t* stage = &pipeline->stages[index];
+	control_stage_stats_t stats;
+	ControlPipelineRead(pipeline, index, &stats);
+	Append(writer, "{\"name\":\"%s\",\"divisor\":%u,\"phase\":%u,\"runs\":%lu,\"cycles_mean\":%lu,\"cycles_max\":%lu}%s\n",
+		stage->name, stage->divisor, stage->phase, stats.runs, stats.runs ? (uint32_t)(stats.total / stats.runs) : 0,
+		stats.max, index + 1 < pipeline->count ? "," : "");
+	return 1;
+}
+
+//Every signal on the bus, whatever SignalInfo lists
+static uint8_t SignalsItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index == 1 )
+	{
+		Append(writer, "{\"signals\":[\n");
+		return 1;
+	}
+
+	index -= 2;
+	if( index > SIGNAL_COUNT )
+		return 0;
+	if( index == SIGNAL_COUNT )
+	{
+		Append(writer, "]}\n");
+		return 1;
+	}
+
+	const signal_info_t* info = SignalInfo(index);
+	signal_value_t value;
+	uint32_t sequence = SignalRead(index, &value);
+	Append(writer, "{\"name\":\"%s\",\"sequence\":%lu,", info->name, sequence);
+	if( info->type == SIGNAL_TYPE_FLOAT )
+		AppendFloat(writer, "value", value.f, "");
+	else
+		Append(writer, "\"value\":%lu", value.u);
+	Append(writer, "}%s\n", index + 1 < SIGNAL_COUNT ? "," : "");
+	return 1;
+}
+
+//Every hop of the command receive chain, in core cycles
+static uint8_t LatencyItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index == 1 )
+	{
+		Append(writer, "{\"built\":%u,\"core_clock\":%lu,\"hops\":[\n", NET_LATENCY_ENABLE, (uint32_t)configCPU_CLOCK_HZ);
+		return 1;
+	}
+
+	index -= 2;
+	if( index > NET_LATENCY_HOP_COUNT )
+		return 0;
+	if( index == NET_LATENCY_HOP_COUNT )
+	{
+		Append(writer, "]}\n");
+		return 1;
+	}
+
+	profiler_stats_t stats;
+	NetLatencyRead(index, &stats);
+	Append(writer, "{\"name\":\"%s\",\"count\":%lu,\"min\":%lu,\"mean\":%lu,\"max\":%lu,\"histogram\":[",
+		NetLatencyHopName(index), stats.count, stats.count ? stats.min : 0,
+		stats.count ? (uint32_t)(stats.total / stats.count) : 0, stats.max);
+	for(int bin = 0; bin < PROFILER_HISTOGRAM_BINS; ++bin)
+		Append(writer, "%s%lu", bin ? "," : "", stats.histogram[bin]);
+	Append(writer, "]}%s\n", index + 1 < NET_LATENCY_HOP_COUNT ? "," : "");
+	return 1;
+}
+
+static void SamplesSnapshot(diag_connection_t* connection)
+{
+	PcSamplerRead(&connection->snapshot.samples.stats);
+	for(uint8_t region = 0; region < PC_SAMPLER_REGION_COUNT; ++region)
+	{
+		uint16_t bins = PcSamplerRegionBins(region);
+		uint16_t first = 0;
+		while( first < bins && PcSamplerBin(region, first) == 0 )
+			first++;
+		connection->snapshot.samples.first[region] = first;
+	}
+}
+
+static void SamplesStartSnapshot(diag_connection_t* connection)
+{
+	PcSamplerStart();
+	SamplesSnapshot(connection);
+}
+
+static void SamplesStopSnapshot(diag_connection_t* connection)
+{
+	PcSamplerStop();
+	SamplesSnapshot(connection);
+}
+
+static const char* const sample_region_names[PC_SAMPLER_REGION_COUNT] = { "flash", "ram" };
+
+//Bins the sampler counted in as [bin,count] pairs, one item per
+//DIAG_SAMPLE_GROUP bins. Bins that were empty before the first counted one
+//when the request came in are left out, they would need a comma before
+//the first pair.
+static uint8_t SamplesItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	const pc_sampler_stats_t* stats = &connection->snapshot.samples.stats;
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index == 1 )
+	{
+		Append(writer, "{\"built\":%u,\"running\":%u,\"saturated\":%u,\"samples\":%lu,\"other\":%lu,\"rate\":%u,\"bin_size\":%u,"
+			"\"regions\":[\n", PC_SAMPLER_ENABLE, stats->running, stats->saturated, stats->samples, stats->other,
+			PC_SAMPLER_RATE, PC_SAMPLER_BIN_SIZE);
+		return 1;
+	}
+
+	index -= 2;
+	for(uint8_t region = 0; region < PC_SAMPLER_REGION_COUNT; ++region)
+	{
+		uint16_t bins = PcSamplerRegionBins(region);
+		uint16_t groups = (bins + DIAG_SAMPLE_GROUP - 1) / DIAG_SAMPLE_GROUP;
+		if( index == 0 )
+		{
+			Append(writer, "{\"name\":\"%s\",\"base\":%lu,\"bins\":[", sample_region_names[region],
+				PcSamplerRegionBase(region));
+			return 1;
+		}
+		if( index <= groups )
+		{
+			uint16_t first = connection->snapshot.samples.first[region];
+			uint16_t bin = (index - 1) * DIAG_SAMPLE_GROUP;
+			uint16_t end = bin + DIAG_SAMPLE_GROUP < bins ? bin + DIAG_SAMPLE_GROUP : bins;
+			for(bin = bin > first ? bin : first; bin < end; ++bin)
+			{
+				uint16_t count = PcSamplerBin(region, bin);
+				if( count != 0 || bin == first )
+					Append(writer, "%s[%u,%u]", bin == first ? "" : ",", bin, count);
+			}
+			return 1;
+		}
+		if( index == groups + 1 )
+		{
+			Append(writer, "]}%s\n", region + 1 < PC_SAMPLER_REGION_COUNT ? "," : "]}");
+			return 1;
+		}
+		index -= groups + 2;
+	}
+	return 0;
+}
+
+static uint8_t IndexItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	if( index == 0 )
+		return HeaderItem(writer);
+	if( index > 1 )
+		return 0;
+	Append(writer, "{\"pages\":[\"/status\",\"/tasks\",\"/trace\",\"/pools\",\"/pipeline\",\"/signals\",\"/latency\",\"/samples\"]}\n");
+	return 1;
+}
+
+static uint8_t NotFoundItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	if( index > 0 )
+		return 0;
+	Append(writer, "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\nnot found\n");
+	return 1;
+}
+
+static uint8_t BadRequestItem(diag_connection_t* connection, diag_writer_t* writer, uint16_t index)
+{
+	if( index > 0 )
+		return 0;
+	Append(writer, "HTTP/1.0 400 Bad Request\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\nbad request\n");
+	return 1;
+}
+
+static const diag_page_t pages[] =
+{
+	{ "/", NULL, IndexItem },
+	{ "/status", StatusSnapshot, StatusItem },
+	{ "/tasks", TasksSnapshot, TasksItem },
+	{ "/trace", NULL, TraceItem },
+	{ "/pools", NULL, PoolsItem },
+	{ "/pipeline", NULL, PipelineItem },
+	{ "/signals", NULL, SignalsItem },
+	{ "/latency", NULL, LatencyItem },
+	{ "/samples", SamplesSnapshot, SamplesItem },
+	{ "/samples/start", SamplesStartSnapshot, SamplesItem },
+	{ "/samples/stop", SamplesStopSnapshot, SamplesItem },
+};
+
+static const diag_page_t not_found_page = { NULL, NULL, NotFoundItem };
+static const diag_page_t bad_request_page = { NULL, NULL, BadRequestItem };
+
+//Renders the items that fit the next chunk
+static void RenderChunk(diag_connection_t* connection)
+{
+	diag_writer_t writer = { connection->chunk, 0, sizeof(connection->chunk), 0 };
+	while( !connection->page_done )
+	{
+		uint16_t mark = writer.length;
+		if( !connection->page->item(connection, &writer, connection->item) )
+		{
+			connection->page_done = 1;
+			break;
+		}
+		if( writer.full )
+		{
+			writer.length = mark;
+			//an item that does not fit an empty chunk never will
+			if( mark == 0 )
+				connection->page_done = 1;
+			break;
+		}
+		connection->item++;
+	}
+	connection->chunk_length = writer.length;
+	connection->chunk_sent = 0;
+}
+
+static void CloseConnection(diag_connection_t* connection)
+{
+	struct tcp_pcb* pcb = connection->pcb;
+	connection->pcb = NULL;
+	tcp_arg(pcb, NULL);
+	tcp_recv(pcb, NULL);
+	tcp_sent(pcb, NULL);
+	tcp_err(pcb, NULL);
+	tcp_poll(pcb, NULL, 0);
+	//queued data still goes out before the FIN
+	if( tcp_close(pcb) != ERR_OK )
+		tcp_abort(pcb);
+}
+
+//Hands tcp as much of the page as its send buffer takes. Returns ERR_ABRT if
+//the connection had to be aborted.
+static err_t Pump(diag_connection_t* connection)
+{
+	while( 1 )
+	{
+		if( connection->chunk_sent == connection->chunk_length )
+		{
+			if( connection->page_done )
+			{
+				CloseConnection(connection);
+				return ERR_OK;
+			}
+			RenderChunk(connection);
+			continue;
+		}
+
+		uint16_t room = tcp_sndbuf(connection->pcb);
+		uint16_t length = connection->chunk_length - connection->chunk_sent;
+		if( length > room )
+			length = room;
+		if( length == 0 )
+			break;
+		//copied, the chunk is rendered over right after
+		if( tcp_write(connection->pcb, &connection->chunk[connection->chunk_sent], length,
+			TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK )
+			//out of segments, tcp_sent comes back for the rest
+			break;
+		connection->chunk_sent += length;
+	}
+	tcp_output(connection->pcb);
+	return ERR_OK;
+}
+
+static const diag_page_t* FindPage(const char* request)
+{
+	if( strncmp(request, "GET ", 4) != 0 )
+		return &bad_request_page;
+
+	const char* path = &request[4];
+	uint8_t length = 0;
+	while( path[length] != ' ' && path[length] != '\r' && path[length] != '\n' && path[length] != '?' && path[length] != 0 )
+		length++;
+	for(uint8_t i = 0; i < sizeof(pages) / sizeof(pages[0]); ++i)
+	{
+		if( strlen(pages[i].path) == length && strncmp(pages[i].path, path, length) == 0 )
+			return &pages[i];
+	}
+	return &not_found_page;
+}
+
+static err_t DiagReceive(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err)
+{
+	diag_connection_t* connection = (diag_connection_t*)arg;
+	if( p == NULL )
+	{
+		//the client closed, whatever it asked for is moot
+		CloseConnection(connection);
+		return ERR_OK;
+	}
+
+	tcp_recved(pcb, p->tot_len);
+	connection->idle_polls = 0;
+	//the headers after the request line are read and dropped
+	if( connection->page == NULL )
+	{
+		uint16_t room = sizeof(connection->request) - 1 - connection->request_length;
+		uint16_t length = pbuf_copy_partial(p, &connection->request[connection->request_length], room, 0);
+		connection->request_length += length;
+		connection->request[connection->request_length] = 0;
+
+		if( strchr(connection->request, '\n') != NULL )
+			connection->page = FindPage(connection->request);
+		else if( connection->request_length == sizeof(connection->request) - 1 )
+			connection->page = &bad_request_page;
+
+		if( connection->page != NULL )
+		{
+			if( connection->page->snapshot != NULL )
+				connection->page->snapshot(connection);
+			pbuf_free(p);
+			return Pump(connection);
+		}
+	}
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+static err_t DiagSent(void* arg, struct tcp_pcb* pcb, u16_t length)
+{
+	diag_connection_t* connection = (diag_connection_t*)arg;
+	connection->idle_polls = 0;
+	return Pump(connection);
+}
+
+static err_t DiagPoll(void* arg, struct tcp_pcb* pcb)
+{
+	diag_connection_t* connection = (diag_connection_t*)arg;
+	if( ++connection->idle_polls * DIAG_POLL_INTERVAL / 2 >= DIAG_IDLE_TIMEOUT )
+	{
+		connection->pcb = NULL;
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+	if( connection->page != NULL )
+		return Pump(connection);
+	return ERR_OK;
+}
+
+//lwIP has freed the pcb already
+static void DiagError(void* arg, err_t err)
+{
+	diag_connection_t* connection = (diag_connection_t*)arg;
+	if( connection != NULL )
+		connection->pcb = NULL;
+}
+
+static err_t DiagAccept(void* arg, struct tcp_pcb* pcb, err_t err)
+{
+	tcp_accepted(diag_server.listen_pcb);
+
+	diag_connection_t* connection = NULL;
+	for(int i = 0; i < DIAG_MAX_CONNECTIONS; ++i)
+	{
+		if( diag_server.connections[i].pcb == NULL )
+		{
+			connection = &diag_server.connections[i];
+			break;
+		}
+	}
+	if( err != ERR_OK || connection == NULL )
+	{
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	connection->pcb = pcb;
+	connection->request_length = 0;
+	connection->page = NULL;
+	connection->item = 0;
+	connection->page_done = 0;
+	connection->chunk_length = 0;
+	connection->chunk_sent = 0;
+	connection->idle_polls = 0;
+	//diagnostics never get ahead of the control channel
+	tcp_setprio(pcb, TCP_PRIO_MIN);
+	tcp_arg(pcb, connection);
+	tcp_recv(pcb, DiagReceive);
+	tcp_sent(pcb, DiagSent);
+	tcp_err(pcb, DiagError);
+	tcp_poll(pcb, DiagPoll, DIAG_POLL_INTERVAL);
+	return ERR_OK;
+}
+
+void DiagServerStart(void* ctx)
+{
+	diag_server.ctx = (main_context_t*)ctx;
+
+	struct tcp_pcb* pcb = tcp_new();
+	if( pcb == NULL || tcp_bind(pcb, IP_ADDR_ANY, DIAG_PORT) != ERR_OK )
+	{
+		LOG("Diagnostics server bind error");
+		if( pcb != NULL )
+			tcp_close(pcb);
+		return;
+	}
+	diag_server.listen_pcb = tcp_listen(pcb);
+	if( diag_server.listen_pcb == NULL )
+	{
+		LOG("Diagnostics server listen error");
+		tcp_close(pcb);
+		return;
+	}
+	tcp_accept(diag_server.listen_pcb, DiagAccept);
+}
+
+#else
+
+void DiagServerStart(void* ctx)
+{
+}
+
+#endif
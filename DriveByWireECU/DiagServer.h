@@ -0,0 +1,70 @@
+/*
+ * DiagServer.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef DIAGSERVER_H_
+#define DIAGSERVER_H_
+
+#include <stdint.h>
+
+//Live diagnostics over HTTP, for a browser or curl on the PC.
+//
+//Runs on the raw TCP API in the tcpip thread: every connection is a small
+//state machine driven by lwIP's callbacks, there is no task per connection
+//and nothing ever blocks. Connections above DIAG_MAX_CONNECTIONS are
+//refused and RAM is fixed at DIAG_MAX_CONNECTIONS times one chunk plus one
+//snapshot, whatever is asked for. Pages are rendered a chunk at a time as
+//the send buffer drains, so a long page costs no more RAM than a short one.
+//
+//	GET /			the pages below
+//	GET /status		node id, main_context_t: cycle, measured, commanded, modes, link
+//	GET /tasks		the newest TaskMonitor snapshot
+//	GET /trace		PID trace state, and every sample once it is frozen
+//	GET /pools		lwIP pool use, failures and alloc cost (PoolMonitor.h)
+//	GET /pipeline	control cycle stages, their rates and timings
+//					(ControlPipeline.h)
+//	GET /signals	every signal on the bus, its value and sequence
+//					(SignalBus.h)
+//	GET /latency	command receive chain, every hop's histogram in the
+//					profiler's bins (NetLatency.h)
+//	GET /samples	PC sampler state and histogram (PcSampler.h)
+//	GET /samples/start	clears the histogram and starts the sampler
+//	GET /samples/stop	stops it, both answer like /samples
+//
+//All pages are JSON. Values are snapshotted when the request arrives. The
+//trace is read from the frozen ring as it is sent, and ends early if the
+//ring is rearmed meanwhile.
+//
+//Needs LWIP_TCP, the production profile leaves it out (feature_config.h).
+
+#ifndef DIAG_SERVER_ENABLE
+#define DIAG_SERVER_ENABLE 1
+#endif
+
+#ifndef DIAG_PORT
+#define DIAG_PORT 80
+#endif
+
+#ifndef DIAG_MAX_CONNECTIONS
+#define DIAG_MAX_CONNECTIONS 2
+#endif
+
+//Rendered at a time, must hold the longest item of any page
+#define DIAG_CHUNK_SIZE 512
+
+//Longest request line kept, the path has to be in it
+#define DIAG_REQUEST_SIZE 64
+
+//s without progress after which a connection is dropped
+#ifndef DIAG_IDLE_TIMEOUT
+#define DIAG_IDLE_TIMEOUT 5
+#endif
+
+//Accepts HTTP connections on DIAG_PORT, up to DIAG_MAX_CONNECTIONS. ctx is
+//the main_context_t that /status, /trace and /pipeline are read from. Runs
+//in the tcpip thread, queued with tcpip_callback.
+void DiagServerStart(void* ctx);
+
+#endif /* DIAGSERVER_H_ */
@@ -0,0 +1,165 @@
+/*
+ * DmaService.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hpl_dma.h>
+#include <hal_atomic.h>
+#include <hri_dmac_e54.h>
+#include "DmaService.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if DMA_SERVICE_CHANNELS > DMAC_CH_NUM
+#error DMA_SERVICE_CHANNELS is more than the DMAC has
+#endif
+
+//hpl_dmac.c's, the DMAC reads each channel's first block from here
+extern DmacDescriptor _descriptor_section[DMAC_CH_NUM];
+
+typedef struct dma_slot_t
+{
+	dma_done_t done;
+	void* arg;
+	//BTCTRL of every block, from the channel config
+	uint16_t btctrl;
+} dma_slot_t;
+
+typedef struct dma_service_t
+{
+	uint32_t allocated;
+	dma_slot_t slots[DMA_SERVICE_CHANNELS];
+} dma_service_t;
+
+static dma_service_t dma_service = { DMA_SERVICE_STATIC_CHANNELS };
+
+static void TransferDone(struct _dma_resource* resource)
+{
+	dma_slot_t* slot = (dma_slot_t*)resource->back;
+	if( slot->done )
+		slot->done(slot->arg, 0);
+}
+
+static void TransferError(struct _dma_resource* resource)
+{
+	dma_slot_t* slot = (dma_slot_t*)resource->back;
+	if( slot->done )
+		slot->done(slot->arg, 1);
+}
+
+//Channels 0 to 3 have an interrupt each, the rest share the last one
+static IRQn_Type ChannelIrq(int8_t channel)
+{
+	return (IRQn_Type)(DMAC_0_IRQn + (channel < 4 ? channel : 4));
+}
+
+int8_t DmaAllocate(const dma_channel_config_t* config, dma_done_t done, void* arg)
+{
+	int8_t channel = -1;
+	CRITICAL_SECTION_ENTER();
+	for(int8_t i = 0; i < DMA_SERVICE_CHANNELS; ++i)
+	{
+		if( !(dma_service.allocated & (1UL << i)) )
+		{
+			dma_service.allocated |= 1UL << i;
+			channel = i;
+			break;
+		}
+	}
+	CRITICAL_SECTION_LEAVE();
+	if( channel < 0 )
+		return -1;
+
+	dma_slot_t* slot = &dma_service.slots[channel];
+	slot->done = done;
+	slot->arg = arg;
+	slot->btctrl = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE(config->beat_size)
+		| (config->source_increment ? DMAC_BTCTRL_SRCINC : 0)
+		| (config->destination_increment ? DMAC_BTCTRL_DSTINC : 0)
+		| DMAC_BTCTRL_BLOCKACT(config->block_done ? DMAC_BTCTRL_BLOCKACT_INT_Val : DMAC_BTCTRL_BLOCKACT_NOACT_Val);
+
+	//whatever the generated configuration had for it is replaced
+	hri_dmac_write_CHCTRLA_reg(DMAC, channel, DMAC_CHCTRLA_TRIGSRC(config->trigger) | DMAC_CHCTRLA_TRIGACT(config->trigger_action));
+	hri_dmac_write_CHPRILVL_reg(DMAC, channel, DMAC_CHPRILVL_PRILVL(config->priority));
+	hri_dmac_write_CHEVCTRL_reg(DMAC, channel, 0);
+	hri_dmacdescriptor_write_BTCTRL_reg(&_descriptor_section[channel], slot->btctrl & ~DMAC_BTCTRL_VALID);
+	hri_dmacdescriptor_write_DESCADDR_reg(&_descriptor_section[channel], 0);
+
+	struct _dma_resource* resource;
+	_dma_get_channel_resource(&resource, channel);
+	resource->back = slot;
+	resource->dma_cb.transfer_done = TransferDone;
+	resource->dma_cb.error = TransferError;
+	hri_dmac_clear_CHINTFLAG_reg(DMAC, channel, DMAC_CHINTFLAG_TCMPL | DMAC_CHINTFLAG_TERR | DMAC_CHINTFLAG_SUSP);
+	_dma_set_irq_state(channel, DMA_TRANSFER_COMPLETE_CB, done != NULL);
+	_dma_set_irq_state(channel, DMA_TRANSFER_ERROR_CB, done != NULL);
+	NVIC_SetPriority(ChannelIrq(channel), IRQ_PRIORITY_DMA);
+	return channel;
+}
+
+void DmaFree(int8_t channel)
+{
+	DmaStop(channel);
+	_dma_set_irq_state(channel, DMA_TRANSFER_COMPLETE_CB, false);
+	_dma_set_irq_state(channel, DMA_TRANSFER_ERROR_CB, false);
+	dma_service.slots[channel].done = NULL;
+	CRITICAL_SECTION_ENTER();
+	dma_service.allocated &= ~(1UL << channel);
+	CRITICAL_SECTION_LEAVE();
+}
+
+DmacDescriptor* DmaFirstBlock(int8_t channel)
+{
+	return &_descriptor_section[channel];
+}
+
+void DmaSetBlock(int8_t channel, DmacDescriptor* block, const volatile void* source,
+	volatile void* destination, uint32_t beats, DmacDescriptor* next)
+{
+	uint16_t btctrl = dma_service.slots[channel].btctrl;
+	uint32_t span = beats << ((btctrl & DMAC_BTCTRL_BEATSIZE_Msk) >> DMAC_BTCTRL_BEATSIZE_Pos);
+	uint32_t source_address = (uint32_t)source;
+	uint32_t destination_address = (uint32_t)destination;
+
+	if( btctrl & DMAC_BTCTRL_SRCINC )
+		source_address += span;
+	if( btctrl & DMAC_BTCTRL_DSTINC )
+		destination_address += span;
+
+	if( block == NULL )
+		block = &_descriptor_section[channel];
+	//the first block is made valid by DmaStart
+	if( block == &_descriptor_section[channel] )
+		btctrl &= ~DMAC_BTCTRL_VALID;
+	hri_dmacdescriptor_write_BTCTRL_reg(block, btctrl);
+	hri_dmacdescriptor_write_BTCNT_reg(block, beats);
+	hri_dmacdescriptor_write_SRCADDR_reg(block, source_address);
+	hri_dmacdescriptor_write_DSTADDR_reg(block, destination_address);
+	hri_dmacdescriptor_write_DESCADDR_reg(block, (uint32_t)next);
+}
+
+void DmaStart(int8_t channel)
+{
+	hri_dmacdescriptor_set_BTCTRL_VALID_bit(&_descriptor_section[channel]);
+	hri_dmac_set_CHCTRLA_ENABLE_bit(DMAC, channel);
+	if( hri_dmac_read_CHCTRLA_TRIGSRC_bf(DMAC, channel) == 0 )
+		hri_dmac_set_SWTRIGCTRL_reg(DMAC, 1UL << channel);
+}
+
+void DmaStop(int8_t channel)
+{
+	hri_dmac_clear_CHCTRLA_ENABLE_bit(DMAC, channel);
+	//the beat in flight finishes first
+	while( hri_dmac_get_CHCTRLA_ENABLE_bit(DMAC, channel) )
+		;
+	hri_dmac_clear_CHINTFLAG_reg(DMAC, channel, DMAC_CHINTFLAG_TCMPL | DMAC_CHINTFLAG_TERR | DMAC_CHINTFLAG_SUSP);
+}
+
+void DmaNotifyTask(void* arg, uint8_t error)
+{
+	BaseType_t woken = pdFALSE;
+
+	vTaskNotifyGiveFromISR((TaskHandle_t)arg, &woken);
+	portYIELD_FROM_ISR(woken);
+}
@@ -0,0 +1,86 @@
+/*
+ * DmaService.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef DMASERVICE_H_
+#define DMASERVICE_H_
+
+#include <stdint.h>
+#include <compiler.h>
+
+//DMAC channels handed out at run time, on top of hpl_dmac.c. A module
+//asks for a channel with the trigger and beat layout it needs and gets
+//whichever one is free, config/hpl_dmac_config.h only has to know the
+//channels in DMA_SERVICE_STATIC_CHANNELS.
+//
+//A transfer is one block or a chain of blocks: the channel's first block
+//lives in the DMAC's descriptor section, every further block is a
+//DmacDescriptor of the caller's that has to stay put while the channel
+//runs. Linking the last block back to DmaFirstBlock makes the transfer
+//circular, it then runs until DmaStop.
+//
+//The done callback runs in the DMAC interrupt, at
+//configLIBRARY_LOWEST_INTERRUPT_PRIORITY so it may use the FromISR calls.
+//DmaNotifyTask is one that hands completion to a task.
+
+//Set up by the generated configuration and never handed out: 0 and 1 are
+//AdcSampler's linked pair
+#ifndef DMA_SERVICE_STATIC_CHANNELS
+#define DMA_SERVICE_STATIC_CHANNELS 0x3UL
+#endif
+
+//Channels the service hands out, from 0 up. Each one has its slot here.
+#ifndef DMA_SERVICE_CHANNELS
+#define DMA_SERVICE_CHANNELS 8
+#endif
+
+//error is non-zero for a bus error, the channel is disabled then
+typedef void (*dma_done_t)(void* arg, uint8_t error);
+
+typedef struct dma_channel_config_t
+{
+	//DMAC_CHCTRLA_TRIGSRC, 0 for software triggered transfers
+	uint8_t trigger;
+	//DMAC_CHCTRLA_TRIGACT_*_Val, what one trigger moves
+	uint8_t trigger_action;
+	//DMAC_BTCTRL_BEATSIZE_*_Val
+	uint8_t beat_size;
+	uint8_t source_increment;
+	uint8_t destination_increment;
+	//0 to 3, DMAC_CHPRILVL
+	uint8_t priority;
+	//done after every block instead of only after the last, for circular
+	//transfers
+	uint8_t block_done;
+} dma_channel_config_t;
+
+//A free channel set up to config, or -1 if there is none. done may be
+//NULL. From any task, before the channel is used.
+int8_t DmaAllocate(const dma_channel_config_t* config, dma_done_t done, void* arg);
+
+//Stops the channel and hands it back
+void DmaFree(int8_t channel);
+
+//The channel's first block, as the target of a circular link
+DmacDescriptor* DmaFirstBlock(int8_t channel);
+
+//Sets block, DmaFirstBlock or NULL for it, to move beats from source to
+//destination and go on with next, NULL to end there. Addresses are the
+//start of the data, an incrementing side is moved to its end as the DMAC
+//takes it. Only while the channel is stopped.
+void DmaSetBlock(int8_t channel, DmacDescriptor* block, const volatile void* source,
+	volatile void* destination, uint32_t beats, DmacDescriptor* next);
+
+//Starts the transfer from the first block. A software triggered channel
+//is triggered once, a peripheral one waits for its trigger.
+void DmaStart(int8_t channel);
+
+//Aborts a running transfer, the channel is idle on return
+void DmaStop(int8_t channel);
+
+//A dma_done_t that gives the notification of the TaskHandle_t in arg
+void DmaNotifyTask(void* arg, uint8_t error);
+
+#endif /* DMASERVICE_H_ */
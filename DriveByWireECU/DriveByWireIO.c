@@ -5,92 +5,680 @@
  *  Author: John Brooks
  */ 
 #include "DriveByWireIO.h"
+#include <irq_config.h>
 #include "hal_gpio.h"
 #include "hal_delay.h"
 #include "hal_usart_sync.h"
 #include "hal_pwm.h"
 #include "driver_init.h"
+#include <peripheral_clk_config.h>
 #include "main_context.h"
+#include "AdcSampler.h"
+#include "CanBus.h"
+#include "WheelSpeed.h"
+#include "SteeringEncoder.h"
+#include "SteeringCalibration.h"
+#include "SteeringRateLoop.h"
+#include "SensorFilter.h"
+#include "ControlCore.h"
+#include "Profiler.h"
+#include "FastCode.h"
+#include "Ptp.h"
+#include "TimeBase.h"
+#include "TccPwm.h"
+#include "DacThrottle.h"
+#include "GpioBatch.h"
+#include "EStopInput.h"
+#include "Imu.h"
+#include "Redundancy.h"
+#include "Excitation.h"
+#include "Peripherals.h"
+#include "MotorThermal.h"
+#include "LatencyProbe.h"
+#include "SignalBus.h"
+#include <hal_atomic.h>
 
-//PWM clock is 12Mhz
+//PWM clock is 12Mhz in both clock profiles (see config/clock_profile_config.h)
 #define PWM_TICKS_PER_SECOND 0xB71B00
 
-//PWM Frequency in Hz
-#define VEHICLE_SPEED_FREQ 1000
-#define STEERING_TORQUE_FREQ 30000
-#define FRONT_BRAKE_FREQ 1000
-#define REAR_BRAKE_FREQ 1000
-#define ACCELERATION_FREQ 1000
+#if CONF_GCLK_TC0_FREQUENCY != PWM_TICKS_PER_SECOND || CONF_GCLK_TC4_FREQUENCY != PWM_TICKS_PER_SECOND || CONF_GCLK_TC5_FREQUENCY != PWM_TICKS_PER_SECOND
+#error PWM_TICKS_PER_SECOND does not match the PWM timer clocks
+#endif
 
 //Duty Cycle of Rear Brake
 #define REAR_BRAKE_ENGAGED_DUTY_CYCLE 0.50f
 #define REAR_BRAKE_DISENGAGED_DUTY_CYCLE 0.0f
 
-//Mapping of PWM to Outputs
-#define PWM_Acceleration PWM_0		//PA05
-#define PWM_SteeringTorque PWM_4	//PB09
-#define PWM_FrontBrake PWM_2		//PB15
-//#define PWM_RearBrake PWM_3			//PB03
+//Steering torque and acceleration can move to TCC0 and TCC1 instead, for
+//the estop fault input (TccPwm.h). The front brake stays on its TC.
+#if TCC_PWM_ENABLE
+#define STEERING_TORQUE_TCC TCC_PWM_STEERING_TORQUE
+#define ACCELERATION_TCC TCC_PWM_ACCELERATION
+#else
+#define STEERING_TORQUE_TCC TCC_PWM_NONE
+#define ACCELERATION_TCC TCC_PWM_NONE
+#endif
 
-//rename this if used for something. For now PWM_4 is just an available pin.
-#define PWM_ExtraPWM PWM_4
+//no enable pin
+#define PWM_NO_ENABLE 0xFFFFFFFFUL
 
-typedef union adc_val_t {
-	uint8_t ADC_Read_8[2];
-	uint16_t ADC_Read;
-} adc_val_t;
+//The PWM outputs, one row each:
+//	  id, atmel_start PWM, frequency (Hz), share of the period a duty of 1
+//	  gives, 1 if the driver's input is inverted, the TCC it moves to,
+//	  the pin that is on at any duty but the one that stops the output.
+//Acceleration is PWM_0 on PA05, steering torque PWM_4 on PB09 and the
+//front brake PWM_2 on PB15. The rear brake was PWM_3 on PB03 at 1000Hz.
+//The steering driver's PWM input is inverted and limited to 60%.
+#define PWM_ACTUATORS(X) \
+	X(ACCELERATION, PWM_0, 1000, 1.0f, 0, ACCELERATION_TCC, AccelerationEnable) \
+	X(STEERING_TORQUE, PWM_4, 30000, 0.6f, 1, STEERING_TORQUE_TCC, SteeringEnable) \
+	X(FRONT_BRAKE, PWM_2, 1000, 1.0f, 0, TCC_PWM_NONE, PWM_NO_ENABLE)
 
-//interpolation table of steering positions[]
-const float steering_positions[] = {0, 1, 2};
-const float steering_voltages[] = {0, 1.65, 3.3};
-int steering_table_size = sizeof(steering_positions) / sizeof(float);
- 
+typedef enum pwm_actuator_t
+{
+#define PWM_ACTUATOR_ID(id, pwm, freq, scale, inverted, tcc, enable) PWM_##id,
+	PWM_ACTUATORS(PWM_ACTUATOR_ID)
+#undef PWM_ACTUATOR_ID
+	PWM_ACTUATOR_COUNT
+} pwm_actuator_t;
+
+//All PWM timers are 16 bit counters (CONF_TCn_MODE in hpl_tc_config.h)
+#define PWM_PERIOD_TICKS(freq) (PWM_TICKS_PER_SECOND / (freq))
+#define PWM_PERIOD_FITS(id, pwm, freq, scale, inverted, tcc, enable) \
+	typedef char pwm_period_fits_##id[PWM_PERIOD_TICKS(freq) <= 0xFFFF ? 1 : -1];
+PWM_ACTUATORS(PWM_PERIOD_FITS)
+#undef PWM_PERIOD_FITS
+
+//Everything a duty cycle is turned into ticks with, worked out by the
+//compiler. The compare value of duty d in [0, 1] is zero_ticks +
+//d * slope_ticks, one multiply-add. Indexed by a constant id the whole row
+//folds into the code that uses it.
+typedef struct pwm_actuator_config_t
+{
+	struct pwm_descriptor* pwm;
+	//the one pwm is, brought up by the first write
+	peripheral_t peripheral;
+	//compare value at a duty of 0
+	float zero_ticks;
+	//compare value change from a duty of 0 to 1
+	float slope_ticks;
+	uint16_t period_ticks;
+	uint8_t inverted;
+	//tcc_pwm_output_t, TCC_PWM_NONE for the TC behind pwm
+	uint8_t tcc;
+	uint32_t enable;
+} pwm_actuator_config_t;
+
+static const pwm_actuator_config_t pwm_actuator[PWM_ACTUATOR_COUNT] =
+{
+#define PWM_ACTUATOR_CONFIG(id, pwm, freq, scale, inverted, tcc, enable) \
+	{ \
+		&pwm, \
+		PERIPHERAL_##pwm, \
+		(inverted) ? PWM_PERIOD_TICKS(freq) * (scale) : 0.0f, \
+		(inverted) ? -(PWM_PERIOD_TICKS(freq) * (scale)) : PWM_PERIOD_TICKS(freq) * (scale), \
+		PWM_PERIOD_TICKS(freq), \
+		inverted, \
+		tcc, \
+		enable, \
+	},
+	PWM_ACTUATORS(PWM_ACTUATOR_CONFIG)
+#undef PWM_ACTUATOR_CONFIG
+};
+
+//Last written compare value of every PWM output
+typedef struct pwm_output_t
+{
+	uint16_t duty_ticks;
+	uint8_t configured;
+} pwm_output_t;
+
+static pwm_output_t pwm_output[PWM_ACTUATOR_COUNT];
+
+//last SetReverseDrive, the wheel speed sensors can not tell direction
+static uint8_t reverse_engaged = 0;
+
+#if SUPPLY_COMPENSATION && !ADC_SAMPLER_SUPPLY_VOLTAGE
+#error SUPPLY_COMPENSATION needs the supply channel, set ADC_SAMPLER_SUPPLY_VOLTAGE
+#endif
+
+//Nominal over measured supply voltage, what the PWM duties are scaled by.
+//Written by the control task once a cycle, a single float store the rate
+//loop interrupt reads whole.
+static volatile float supply_gain = 1.0f;
+
+static const motor_thermal_config_t steering_thermal_config =
+{
+	STEERING_MOTOR_THERMAL_TAU, STEERING_MOTOR_THERMAL_RISE,
+	STEERING_MOTOR_DERATE_START, STEERING_MOTOR_DERATE_END, STEERING_MOTOR_MIN_LIMIT
+};
+static const motor_thermal_config_t brake_thermal_config =
+{
+	BRAKE_MOTOR_THERMAL_TAU, BRAKE_MOTOR_THERMAL_RISE, 0.0f, 0.0f, 1.0f
+};
+static motor_thermal_t steering_thermal;
+static motor_thermal_t brake_thermal;
+//SIGNAL_MOTOR_TEMPERATURE_TIME of the last reading the model took
+static uint32_t motor_temperature_time;
+
+//Share of full duty the steering motor's temperature allows, what the
+//motor duty is held to after the supply gain. Written by the control task
+//once a cycle as supply_gain.
+static volatile float steering_duty_limit = 1.0f;
+
+#if SENSOR_FILTER_INPUTS
+//Hz, well above what the steering column can do
+#define STEERING_FILTER_CUTOFF 200.0f
+#define STEERING_FILTER_MEDIAN 5
+//ADC codes have 12 bits, shifted up to use the Q15 range. The bits below
+//come from the ADC's oversampling and the history, where there are any.
+#define STEERING_FILTER_SHIFT 3
+
+//m/s^2, m/s^3 and m/s. The speed is 1 edge in WHEEL_SPEED_WINDOW coarse,
+//about 1.5 m/s at the defaults, and the acceleration can swing fast.
+#define SPEED_FILTER_ACCEL_NOISE 0.5f
+#define SPEED_FILTER_ACCEL_DRIFT 20.0f
+#define SPEED_FILTER_MEASUREMENT_NOISE 0.3f
+
+static median_filter_t steering_median;
+static biquad_q15_t steering_lowpass;
+static kalman2_t speed_kalman;
+#endif
+
+#if STEERING_ENCODER_ENABLE
+//degrees, what one encoder increment is off by beyond its count, and the
+//noise of the potentiometer. Puts the crossover near 3 Hz: above it the
+//angle is the encoder's, below it the potentiometer's.
+#define STEERING_FUSION_ENCODER_NOISE 0.005f
+#define STEERING_FUSION_POT_NOISE 0.3f
+//Q16 degrees per encoder count
+#define STEERING_FUSION_Q16_PER_COUNT (65536.0f / STEERING_ENCODER_COUNTS_PER_DEGREE)
+
+static fusion_t steering_fusion;
+#endif
+
+#if STEERING_RATE_LOOP
+#if PID_ARITHMETIC == PID_ARITHMETIC_DOUBLE
+#error The steering rate loop runs in an interrupt, build it with PID_ARITHMETIC_FLOAT or PID_ARITHMETIC_Q16
+#endif
+#if CONF_GCLK_TC1_FREQUENCY != PWM_TICKS_PER_SECOND
+#error PWM_TICKS_PER_SECOND does not match the steering rate loop timer clock
+#endif
+
+//PWM_1 drives nothing, its TC paces the rate loop
+#define STEERING_RATE_TC TC1
+
+static steering_rate_loop_t steering_rate_loop;
+#endif
+
+//Compare value of a duty cycle, clamped to [0, 1], with the fraction of a
+//tick a dithered TCC output keeps
+FAST_CODE static float DutyTicksFine(pwm_actuator_t id, float duty_cycle)
+{
+	if( duty_cycle < 0 )
+		duty_cycle = 0;
+	else if( duty_cycle > 1.0f )
+		duty_cycle = 1;
+
+	return pwm_actuator[id].zero_ticks + duty_cycle * pwm_actuator[id].slope_ticks;
+}
+
+//Compare value of a duty cycle in whole ticks
+FAST_CODE static uint16_t DutyTicks(pwm_actuator_t id, float duty_cycle)
+{
+	return (uint16_t)DutyTicksFine(id, duty_cycle);
+}
+
+FAST_CODE float SteeringTorqueDutyTicks(float duty_cycle)
+{
+	return DutyTicksFine(PWM_STEERING_TORQUE, duty_cycle);
+}
+
+FAST_CODE float AccelerationDutyTicks(float duty_cycle)
+{
+	return DutyTicksFine(PWM_ACCELERATION, duty_cycle);
+}
+
+//Level of the enable pin at a duty cycle, on at any duty but the one that
+//stops the output: 0, or 1 for an inverted input
+FAST_CODE static int DutyEnable(pwm_actuator_t id, float duty_cycle)
+{
+	return pwm_actuator[id].inverted ? duty_cycle < 1.0f : duty_cycle > 0;
+}
+
+//Only the first write goes through the HAL. After that only a changed compare
+//value is written, and it goes to CCBUF which the timer copies into CC on the
+//next overflow, so the duty never changes in the middle of a pulse. A TCC
+//takes the fraction of a tick as well and every write, TCC writes do not
+//wait on a synchronization.
+FAST_CODE static void WritePWMDuty(pwm_actuator_t id, float duty_ticks_fine)
+{
+	const pwm_actuator_config_t* config = &pwm_actuator[id];
+	pwm_output_t* output = &pwm_output[id];
+	uint16_t duty_ticks = (uint16_t)duty_ticks_fine;
+
+	//TccPwmInit has the TCC running already
+	if( config->tcc != TCC_PWM_NONE )
+	{
+		TccPwmSetDuty((tcc_pwm_output_t)config->tcc, duty_ticks_fine);
+		output->configured = 1;
+	}
+	else if( !output->configured )
+	{
+		PeripheralRequire(config->peripheral);
+		pwm_set_parameters(config->pwm, config->period_ticks, duty_ticks);
+		pwm_enable(config->pwm);
+		output->configured = 1;
+	}
+	else if( duty_ticks != output->duty_ticks )
+	{
+		hri_tccount16_write_CCBUF_reg(config->pwm->device.hw, 1, duty_ticks);
+	}
+
+	output->duty_ticks = duty_ticks;
+}
+
+//Sets the duty cycle of a PWM output, clamped to [0, 1], and its enable pin
+FAST_CODE static void SetPWMDuty(pwm_actuator_t id, float duty_cycle)
+{
+	WritePWMDuty(id, DutyTicksFine(id, duty_cycle));
+
+	if( pwm_actuator[id].enable != PWM_NO_ENABLE )
+		GpioFastLevel(pwm_actuator[id].enable, DutyEnable(id, duty_cycle));
+}
 
-float LinearlyInterpolate(float val_x, float left_x, float right_x, float left_y, float right_y)
+//Duty from the estop interrupt, now rather than at the end of the period.
+//CC takes it at once and CCBUF keeps a buffered value from replacing it.
+//The TCC outputs are held low by their fault already.
+FAST_CODE static void ForcePWMDuty(pwm_actuator_t id, uint16_t duty_ticks)
 {
-	float delta_x = right_x - left_x;
-	float percent_x = (val_x - left_x) / delta_x;
-	return left_y + (percent_x * (right_y - left_y));
+	const pwm_actuator_config_t* config = &pwm_actuator[id];
+
+	if( config->tcc != TCC_PWM_NONE )
+		TccPwmSetDuty((tcc_pwm_output_t)config->tcc, duty_ticks);
+	else
+	{
+		hri_tccount16_write_CC_reg(config->pwm->device.hw, 1, duty_ticks);
+		hri_tccount16_write_CCBUF_reg(config->pwm->device.hw, 1, duty_ticks);
+	}
+	pwm_output[id].duty_ticks = duty_ticks;
 }
 
-float ReadSteeringPosition()
+FAST_CODE void ForceBrakeOutputs()
 {
-	//TODO: determine voltage mapping between linear potentiometer and steering angle.
-	//fill out linear interpolation table above
-	if( steering_table_size < 2 )
+	//the duties below would be overwritten with the next period
+	ExcitationHalt();
+	GpioFastLevel(pwm_actuator[PWM_ACCELERATION].enable, 0);
+#if DAC_THROTTLE_ENABLE
+	DacThrottleForce(0.0f);
+#else
+	ForcePWMDuty(PWM_ACCELERATION, 0);
+#endif
+	ForcePWMDuty(PWM_FRONT_BRAKE, DutyTicks(PWM_FRONT_BRAKE, EMERGENCY_STOP_BRAKE_DUTY_CYCLE));
+}
+
+//Steering motor power without the rate loop check, from the task or the loop.
+//Held at 0 while an ADC window trip is latched, and to the duty the motor's
+//temperature allows (MotorThermal.h).
+FAST_CODE static void ApplySteeringTorque(float duty_cycle)
+{
+	if( AdcSamplerTripped() )
+		duty_cycle = 0.0f;
+	else if( duty_cycle > steering_duty_limit )
+		duty_cycle = steering_duty_limit;
+	SetPWMDuty(PWM_STEERING_TORQUE, duty_cycle);
+}
+
+//From the ADC window interrupt, as ForceBrakeOutputs from the estop one.
+//With TCC_PWM_ENABLE the TCC fault has the output low already.
+FAST_CODE static void ForceSteeringOff()
+{
+	ExcitationHalt();
+	if( pwm_actuator[PWM_STEERING_TORQUE].enable != PWM_NO_ENABLE )
+		GpioFastLevel(pwm_actuator[PWM_STEERING_TORQUE].enable, DutyEnable(PWM_STEERING_TORQUE, 0.0f));
+	ForcePWMDuty(PWM_STEERING_TORQUE, DutyTicks(PWM_STEERING_TORQUE, 0.0f));
+}
+
+FAST_CODE float ReadSteeringPosition()
+{
+	return SteeringCalibrationLookup(AdcSamplerRead(ADC_SAMPLER_STEERING_POSITION));
+}
+
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+//Share of the full front brake pressure, 0 to 1
+FAST_CODE static float ReadBrakePressure()
+{
+	float pressure = (float)((int)AdcSamplerRead(ADC_SAMPLER_BRAKE_PRESSURE) - ADC_SAMPLER_BRAKE_ZERO)
+		/ (ADC_SAMPLER_BRAKE_FULL - ADC_SAMPLER_BRAKE_ZERO);
+	if( pressure < 0.0f )
 		return 0.0f;
+	if( pressure > 1.0f )
+		return 1.0f;
+	return pressure;
+}
+#endif
 
-	//Read the steering position
-	adc_val_t adc_val;
-	adc_sync_read_channel(&ADC_0, 0, adc_val.ADC_Read_8, 2);
-	float steering_voltage = ((float)adc_val.ADC_Read / (float)0xFFF) * 3.3f;
-	for(int i = 0; i < steering_table_size; ++i)
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+//Volts at the divider's input
+FAST_CODE static float ReadSupplyVoltage()
+{
+	return AdcSamplerReadFine(ADC_SAMPLER_SUPPLY) * (ADC_SAMPLER_SUPPLY_FULL_SCALE_VOLTS / ADC_SAMPLER_FINE_FULL_SCALE);
+}
+#endif
+
+//Duty cycle, 0 to 1, of the compare value last written to a PWM output.
+//The reciprocal of the constant slope folds, there is no divide.
+FAST_CODE static float AppliedDuty(pwm_actuator_t id)
+{
+	float duty = ((float)pwm_output[id].duty_ticks - pwm_actuator[id].zero_ticks) * (1.0f / pwm_actuator[id].slope_ticks);
+	if( duty < 0.0f )
+		return 0.0f;
+	return duty > 1.0f ? 1.0f : duty;
+}
+
+//Steps the motor models on the duties the outputs hold now, whether the
+//task, the rate loop or the estop wrote them, against the board's
+//temperature once the sensor hub has read it. A new motor temperature
+//reading corrects the steering model, SensorHub publishes its time after
+//the value.
+FAST_CODE static void UpdateMotorThermal()
+{
+	float ambient = MOTOR_THERMAL_AMBIENT;
+	if( SignalReadUint(SIGNAL_BOARD_TEMPERATURE_TIME) != 0 )
+		ambient = SignalReadFloat(SIGNAL_BOARD_TEMPERATURE);
+	uint32_t measured = SignalReadUint(SIGNAL_MOTOR_TEMPERATURE_TIME);
+	if( measured != motor_temperature_time )
 	{
-		//maximum value
-		if( i == steering_table_size - 1 )
-			return steering_positions[i];
-
-		if( steering_voltage <= steering_voltages[i+1] )
-		{
-			//minimum value
-			if( i == 0 )
-				return steering_positions[0];
-
-			//some intermediate value
-			return LinearlyInterpolate(steering_voltage, steering_voltages[i], steering_voltages[i+1], steering_positions[i], steering_positions[i+1]);
-		}
+		motor_temperature_time = measured;
+		MotorThermalMeasured(&steering_thermal, SignalReadFloat(SIGNAL_MOTOR_TEMPERATURE));
 	}
-	//if execution reaches here, then the above code is broken
-	return 0.0f;
+
+	float limit = MotorThermalStep(&steering_thermal, AppliedDuty(PWM_STEERING_TORQUE), ambient);
+	MotorThermalStep(&brake_thermal, AppliedDuty(PWM_FRONT_BRAKE), ambient);
+#if MOTOR_THERMAL_ENABLE
+	steering_duty_limit = limit;
+#endif
+	SignalPublishFloat(SIGNAL_STEERING_MOTOR_ESTIMATE, steering_thermal.temperature);
+	SignalPublishFloat(SIGNAL_BRAKE_MOTOR_ESTIMATE, brake_thermal.temperature);
+	SignalPublishFloat(SIGNAL_STEERING_DUTY_LIMIT, limit);
 }
 
-void ProcessCurrentInputs(main_context_t* context)
+#if SUPPLY_COMPENSATION
+//One Newton step of the reciprocal of volts / SUPPLY_NOMINAL_VOLTS from
+//the last gain, as in DriveByWireIO.h. Every constant folds, there is no
+//divide at run time. The gain range bounds the ratio, and from anywhere
+//in it |1 - ratio * gain| < 1, so the step always converges.
+FAST_CODE static void UpdateSupplyGain(float volts)
 {
-	context->estop_in = !gpio_get_pin_level(EStop_In);
+	float ratio = volts * (1.0f / SUPPLY_NOMINAL_VOLTS);
+	if( ratio < 1.0f / SUPPLY_GAIN_MAX )
+		ratio = 1.0f / SUPPLY_GAIN_MAX;
+	else if( ratio > 1.0f / SUPPLY_GAIN_MIN )
+		ratio = 1.0f / SUPPLY_GAIN_MIN;
+
+	float gain = supply_gain;
+	gain = gain * (2.0f - ratio * gain);
+	if( gain < SUPPLY_GAIN_MIN )
+		gain = SUPPLY_GAIN_MIN;
+	else if( gain > SUPPLY_GAIN_MAX )
+		gain = SUPPLY_GAIN_MAX;
+	supply_gain = gain;
+}
+#endif
+
+#if STEERING_RATE_LOOP
+//Takes TC1 over from the PWM driver as a STEERING_RATE_LOOP_FREQ interrupt
+static void InitSteeringRateLoop()
+{
+	SteeringRateLoopInit(&steering_rate_loop);
+
+	PeripheralRequire(PERIPHERAL_PWM_1);
+	hri_tc_write_CTRLA_reg(STEERING_RATE_TC, TC_CTRLA_SWRST);
+	hri_tc_wait_for_sync(STEERING_RATE_TC, TC_SYNCBUSY_SWRST);
+	hri_tc_write_WAVE_reg(STEERING_RATE_TC, TC_WAVE_WAVEGEN_MFRQ);
+	hri_tccount16_write_CC_reg(STEERING_RATE_TC, 0, PWM_TICKS_PER_SECOND / STEERING_RATE_LOOP_FREQ - 1);
+	hri_tc_set_INTEN_OVF_bit(STEERING_RATE_TC);
+
+	//IRQ_PRIORITY_STEERING_RATE is above configMAX_SYSCALL_INTERRUPT_PRIORITY,
+	//the loop makes no RTOS calls and is never held off by a kernel critical
+	//section
+	NVIC_SetPriority(TC1_IRQn, IRQ_PRIORITY_STEERING_RATE);
+	NVIC_ClearPendingIRQ(TC1_IRQn);
+	NVIC_EnableIRQ(TC1_IRQn);
+	hri_tc_write_CTRLA_reg(STEERING_RATE_TC, TC_CTRLA_MODE_COUNT16 | TC_CTRLA_ENABLE);
+}
+
+//Steps the rate loop on the position the ADC DMA last filled in. The loop
+//runs all the time, so its measured rate is current when it is enabled.
+FAST_CODE void TC1_Handler()
+{
+	//core cycles between two steps on time
+	static const uint32_t period = CONF_CPU_FREQUENCY / STEERING_RATE_LOOP_FREQ;
+	static uint32_t last_start;
+
+	uint32_t start = ProfilerStart();
+	hri_tc_clear_INTFLAG_OVF_bit(STEERING_RATE_TC);
+	//the first step has nothing to be late against
+	if( last_start )
+	{
+		uint32_t interval = start - last_start;
+		ProfilerAdd(PROFILER_STAGE_STEERING_RATE_JITTER, interval > period ? interval - period : period - interval);
+	}
+	last_start = start;
+
+	float torque = SteeringRateLoopStep(&steering_rate_loop, ReadSteeringPosition());
+	if( steering_rate_loop.enabled )
+	{
+		GpioFastLevel(SteeringDirection, torque < 0.0f);
+		ApplySteeringTorque((torque < 0.0f ? -torque : torque) * supply_gain);
+	}
+	ProfilerEnd(PROFILER_STAGE_STEERING_RATE, start);
+}
+#endif
+
+//Puts every actuator in the state ProcessAlgorithms keeps it in outside of
+//autonomous mode. The PWM timers are not running until their first duty is
+//set, this starts them at a known duty.
+static void SetOutputsSafe()
+{
+	SetAcceleration(0.0f);
+	SetSteeringTorque(0.0f);
+	SetFrontBrake(0.0f);
+	SetReverseDrive(0);
+	SetSafetyLight1On(0);
+	SetEStopState(0);
+}
+
+uint32_t CheckPWMOutputs()
+{
+	uint32_t failed = 0;
+	for(int id = 0; id < PWM_ACTUATOR_COUNT; ++id)
+	{
+		const pwm_actuator_config_t* config = &pwm_actuator[id];
+#if DAC_THROTTLE_ENABLE
+		if( id == PWM_ACCELERATION )
+			continue;
+#endif
+		if( config->tcc != TCC_PWM_NONE )
+			continue;
+
+		void* hw = config->pwm->device.hw;
+		//the control task writes CCBUF, which CC takes at the overflow
+		CRITICAL_SECTION_ENTER();
+		uint16_t duty_ticks = pwm_output[id].duty_ticks;
+		uint8_t ok = pwm_output[id].configured && hri_tc_get_CTRLA_ENABLE_bit(hw)
+			&& hri_tccount16_read_CC_reg(hw, 0) == config->period_ticks
+			&& (hri_tccount16_read_CC_reg(hw, 1) == duty_ticks || hri_tccount16_read_CCBUF_reg(hw, 1) == duty_ticks);
+		CRITICAL_SECTION_LEAVE();
+		if( !ok )
+			failed |= 1UL << id;
+	}
+	return failed;
+}
+
+void InitializeDriveByWireIO()
+{
+	//first, before anything that takes time
+#if TCC_PWM_ENABLE
+	TccPwmInit(pwm_actuator[PWM_STEERING_TORQUE].period_ticks, pwm_actuator[PWM_ACCELERATION].period_ticks);
+#endif
+#if DAC_THROTTLE_ENABLE
+	//the throttle is a voltage, PWM_0 is never started
+	DacThrottleInit();
+#endif
+	SetOutputsSafe();
+
+	//once the PWMs it forces are running, a press interrupts from here on
+	EStopInputInit(ForceBrakeOutputs);
+
+	SteeringCalibrationInit();
+
+	//analog inputs are scanned in the background from here on, a steering
+	//input out of its window cuts the steering motor
+	AdcSamplerInit(ForceSteeringOff);
+
+	//CAN mailboxes fill in the background from here on
+	CanBusInit();
+
+	//wheel sensor edges are counted in hardware from here on
+	WheelSpeedInit();
+
+	//last to change the EIC, the steering PWM's edges are captured from here on
+	LatencyProbeInit();
+
+#if STEERING_ENCODER_ENABLE
+	//steering motor edges as well. The fusion starts where the potentiometer
+	//is, a history not yet full reads low and is pulled in within the
+	//fusion's time constant.
+	SteeringEncoderInit();
+	FusionInit(&steering_fusion, STEERING_FUSION_ENCODER_NOISE, STEERING_FUSION_POT_NOISE);
+	FusionReset(&steering_fusion, FILTER_Q16(ReadSteeringPosition()));
+#endif
+
+	//read by main_task every cycle from here on, a missing IMU leaves it off
+	ImuInit();
+
+	MotorThermalInit(&steering_thermal, &steering_thermal_config, CONTROL_CORE_CYCLE_US / 1000000.0f, MOTOR_THERMAL_AMBIENT);
+	MotorThermalInit(&brake_thermal, &brake_thermal_config, CONTROL_CORE_CYCLE_US / 1000000.0f, MOTOR_THERMAL_AMBIENT);
+
+#if STEERING_RATE_LOOP
+	//after the ADC, the loop reads the steering position from the first step
+	InitSteeringRateLoop();
+#endif
+
+#if SENSOR_FILTER_INPUTS
+	MedianFilterInit(&steering_median, STEERING_FILTER_MEDIAN, (ADC_SAMPLER_FULL_SCALE / 2) << STEERING_FILTER_SHIFT);
+	BiquadInitLowpass(&steering_lowpass, STEERING_FILTER_CUTOFF, (float)CONTROL_RATE_HZ);
+	BiquadReset(&steering_lowpass, (ADC_SAMPLER_FULL_SCALE / 2) << STEERING_FILTER_SHIFT);
+	Kalman2Init(&speed_kalman, SPEED_FILTER_ACCEL_NOISE, SPEED_FILTER_ACCEL_DRIFT, SPEED_FILTER_MEASUREMENT_NOISE, CONTROL_CORE_CYCLE_US / 1000000.0f);
+#endif
+}
+
+#if SENSOR_FILTER_INPUTS
+//The median drops single sample spikes, the low pass the noise that is left.
+//The rate loop keeps reading the position unfiltered, it needs every bit of
+//phase it can get and does its own filtering of the rate.
+FAST_CODE static float ReadFilteredSteeringPosition()
+{
+	int16_t code = (int16_t)(AdcSamplerReadFine(ADC_SAMPLER_STEERING_POSITION) >> (16 - 12 - STEERING_FILTER_SHIFT));
+	code = MedianFilterStep(&steering_median, code);
+	int32_t filtered = BiquadStep(&steering_lowpass, code) >> STEERING_FILTER_SHIFT;
+	if( filtered < 0 )
+		filtered = 0;
+	else if( filtered > ADC_SAMPLER_FULL_SCALE )
+		filtered = ADC_SAMPLER_FULL_SCALE;
+	return SteeringCalibrationLookup((uint16_t)filtered);
+}
+
+//The acceleration is left to the filter's bias to estimate. The command is
+//no use as the control input, the throttle response lags it by seconds.
+FAST_CODE static float FilterVehicleSpeed(float measured)
+{
+	return FILTER_Q16_TO_FLOAT(Kalman2Step(&speed_kalman, FILTER_Q16(measured), 0));
+}
+#endif
+
+#if STEERING_ENCODER_ENABLE
+//The encoder counts since the last cycle carry the angle, the potentiometer
+//keeps it absolute. The potentiometer goes in unfiltered, the fusion is its
+//filter, and the low pass would only lag it behind the encoder.
+FAST_CODE static float ReadFusedSteeringPosition(int32_t counts)
+{
+	int32_t increment = (int32_t)((float)counts * STEERING_FUSION_Q16_PER_COUNT);
+	return FILTER_Q16_TO_FLOAT(FusionStep(&steering_fusion, FILTER_Q16(ReadSteeringPosition()), increment));
+}
+#endif
+
+FAST_CODE void ProcessCurrentInputs(main_context_t* context)
+{
+	context->input_time = PtpTimeUs();
+	context->sample_time = (uint32_t)TimeBaseUs();
+	//a press released again since the last cycle still counts once
+	uint8_t pressed = !gpio_get_pin_level(EStop_In);
+	context->estop_in = pressed || EStopInputLatched();
+	context->estop_time = context->estop_in ? EStopInputPressTime() : 0;
+	if( !pressed )
+		EStopInputRelease();
+	//the steering stays cut until its inputs are back in their windows
+	AdcSamplerTripRelease();
+#if TCC_PWM_ENABLE
+	//the TCC outputs stay forced low after an estop or a window trip until this
+	if( !context->estop_in && !AdcSamplerTripped() )
+		TccPwmRecover();
+#endif
+	context->steering_code = AdcSamplerReadFine(ADC_SAMPLER_STEERING_POSITION);
+#if STEERING_ENCODER_ENABLE
+	int32_t counts = SteeringEncoderRead();
+	context->steering_encoder_count += counts;
+	context->steering_angle = ReadFusedSteeringPosition(counts);
+#elif SENSOR_FILTER_INPUTS
+	context->steering_angle = ReadFilteredSteeringPosition();
+#else
 	context->steering_angle = ReadSteeringPosition();
+#endif
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+	context->brake_pressure = ReadBrakePressure();
+#endif
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+	context->supply_voltage = ReadSupplyVoltage();
+#endif
+#if SUPPLY_COMPENSATION
+	UpdateSupplyGain(context->supply_voltage);
+#endif
+	context->supply_gain = supply_gain;
+	UpdateMotorThermal();
+
+	//the wheel sensors have no direction, the gear says which way we roll
+	WheelSpeedUpdate(context->current_time);
+	context->reverse = reverse_engaged;
+	context->vehicle_speed = reverse_engaged ? -WheelSpeedVehicle() : WheelSpeedVehicle();
+	for(int i = 0; i < WHEEL_SPEED_SENSOR_COUNT; ++i)
+		context->wheel_speeds[i] = WheelSpeedRead(i);
+	context->front_wheels_valid = WheelSpeedFrontValid();
+#if SENSOR_FILTER_INPUTS
+	context->vehicle_speed = FilterVehicleSpeed(context->vehicle_speed);
+#endif
+
+	//CAN nodes only start being watched once they have sent something
+	uint32_t rx_tick;
+	if( CanBusLastReceived(CAN_BUS_WHEEL_SPEED, &rx_tick) )
+		DeadlineKick(&context->deadlines, DEADLINE_WHEEL_SPEED, rx_tick);
+	if( CanBusLastReceived(CAN_BUS_EPS_STATUS, &rx_tick) )
+		DeadlineKick(&context->deadlines, DEADLINE_EPS_FEEDBACK, rx_tick);
 }
 
-void ProcessCurrentOutputs(main_context_t* context)
+FAST_CODE void ProcessImuInputs(main_context_t* context)
+{
+	imu_sample_t sample;
+	context->imu_valid = ImuRead(&sample);
+	if( !context->imu_valid )
+		return;
+	context->yaw_rate = sample.gyro[2];
+	context->longitudinal_accel = sample.accel[0];
+	context->lateral_accel = sample.accel[1];
+}
+
+FAST_CODE void ProcessCurrentOutputs(main_context_t* context)
 {	
 	SetPCComm(context->pc_comm_active);
 	SetDebugLED1(context->debug_led_1);
@@ -98,91 +686,188 @@ void ProcessCurrentOutputs(main_context_t* context)
 	SetEStopState(context->estop_indicator);
 }
 
+//Every pin in the batch is the task's while the command is applied, the
+//pins the rate loop interrupt owns are left out of it. A standby ECU
+//leaves the outputs as they are (Redundancy.h). The PWM duties are scaled
+//by the supply gain, the enable pins follow the command as it came.
+FAST_CODE void CommitActuators(const actuator_command_t* command)
+{
+	if( !RedundancyActive() )
+		return;
+
+	float gain = supply_gain;
+	gpio_batch_t levels;
+	GpioBatchInit(&levels);
+	uint16_t acceleration_ticks = DutyTicks(PWM_ACCELERATION, command->acceleration * gain);
+	uint16_t front_brake_ticks = DutyTicks(PWM_FRONT_BRAKE, command->front_brake * gain);
+	uint8_t acceleration_by_dma = command->acceleration_by_dma;
+	GpioBatchLevel(&levels, pwm_actuator[PWM_ACCELERATION].enable,
+		acceleration_by_dma || DutyEnable(PWM_ACCELERATION, command->acceleration));
+	GpioBatchLevel(&levels, Reverse, command->reverse);
+	GpioBatchLevel(&levels, NotReverse, !command->reverse);
+	GpioBatchLevel(&levels, SafetyLights2Enable, command->reverse);
+	GpioBatchLevel(&levels, SafetyLights1Enable, command->safety_light_1);
+
+	uint8_t drive_motor = 1;
+#if STEERING_RATE_LOOP
+	steering_rate_loop.setpoint = command->steering_rate;
+	if( command->steering_rate_control )
+	{
+		steering_rate_loop.enabled = 1;
+		drive_motor = 0;
+	}
+	else
+	{
+		//before the motor is written, the interrupt has made its last write then
+		steering_rate_loop.enabled = 0;
+	}
+#endif
+	float steering_ticks = 0.0f;
+	uint8_t steering_by_dma = 0;
+	if( drive_motor )
+	{
+		//an ADC window trip holds the motor off as in ApplySteeringTorque,
+		//its interrupt stopped the DMA already
+		uint8_t tripped = AdcSamplerTripped() != 0;
+		float steering_torque = tripped ? 0.0f : command->steering_torque;
+		steering_by_dma = command->steering_torque_by_dma && !tripped;
+		float steering_duty = steering_torque * gain;
+		if( steering_duty > steering_duty_limit )
+			steering_duty = steering_duty_limit;
+		steering_ticks = DutyTicksFine(PWM_STEERING_TORQUE, steering_duty);
+		GpioBatchLevel(&levels, pwm_actuator[PWM_STEERING_TORQUE].enable,
+			steering_by_dma || DutyEnable(PWM_STEERING_TORQUE, steering_torque));
+		GpioBatchLevel(&levels, SteeringDirection, command->steer_right);
+	}
+
+	//the estop interrupt either ran before and its latch holds the throttle
+	//and brake here, or runs after and overrides these writes
+	CRITICAL_SECTION_ENTER();
+	if( EStopInputLatched() )
+	{
+		uint16_t estop_brake_ticks = DutyTicks(PWM_FRONT_BRAKE, EMERGENCY_STOP_BRAKE_DUTY_CYCLE);
+		acceleration_ticks = 0;
+		acceleration_by_dma = 0;
+		GpioBatchLevel(&levels, pwm_actuator[PWM_ACCELERATION].enable, 0);
+		if( front_brake_ticks < estop_brake_ticks )
+			front_brake_ticks = estop_brake_ticks;
+	}
+#if DAC_THROTTLE_ENABLE
+	DacThrottleSet(acceleration_ticks ? command->acceleration : 0.0f);
+#else
+	if( !acceleration_by_dma )
+		WritePWMDuty(PWM_ACCELERATION, acceleration_ticks);
+#endif
+	WritePWMDuty(PWM_FRONT_BRAKE, front_brake_ticks);
+	if( drive_motor && !steering_by_dma )
+		WritePWMDuty(PWM_STEERING_TORQUE, steering_ticks);
+	GpioBatchApply(&levels);
+	CRITICAL_SECTION_LEAVE();
+	reverse_engaged = command->reverse != 0;
+}
+
 //non-zero values turn lights on
-void SetSafetyLight1On(int on)
+FAST_CODE void SetSafetyLight1On(int on)
 {
-	gpio_set_pin_level(SafetyLights1Enable, on);
+	GpioFastLevel(SafetyLights1Enable, on);
 }
-void SetSafetyLight2On(int on)
+FAST_CODE void SetSafetyLight2On(int on)
 {
-	gpio_set_pin_level(SafetyLights2Enable, on);
+	GpioFastLevel(SafetyLights2Enable, on);
 }
 
 //non zero values steer right, zero steers left.
-void SetSteerDirection(int right)
+FAST_CODE void SetSteerDirection(int right)
 {
-	gpio_set_pin_level(SteeringDirection, right);
+#if STEERING_RATE_LOOP
+	if( steering_rate_loop.enabled )
+		return;
+#endif
+	GpioFastLevel(SteeringDirection, right);
 }
 
 //Puts the vehicle in reverse if value is non-zero.
-void SetReverseDrive(int reverse)
+FAST_CODE void SetReverseDrive(int reverse)
 {
-	gpio_set_pin_level(Reverse, reverse);
-	gpio_set_pin_level(NotReverse, !reverse);
-	SetSafetyLight2On(reverse);
+	//both gear pins flip on the same clock, never both on or both off
+	gpio_batch_t levels;
+	GpioBatchInit(&levels);
+	GpioBatchLevel(&levels, Reverse, reverse);
+	GpioBatchLevel(&levels, NotReverse, !reverse);
+	GpioBatchLevel(&levels, SafetyLights2Enable, reverse);
+	GpioBatchApply(&levels);
+	reverse_engaged = reverse != 0;
 }
 
 //Applies power to the steering motor as duty cycle percentage
-void SetSteeringTorque(float duty_cycle)
+FAST_CODE void SetSteeringTorque(float duty_cycle)
 {
-	if(duty_cycle < 0)
-		duty_cycle = 0;
-	else if (duty_cycle > 1.0)
-		duty_cycle = 1;
-	
-	duty_cycle = 1 - duty_cycle;
-	
-	duty_cycle = duty_cycle * 0.6;
-		
-	const static int STEERING_TORQUE_FREQ_TICKS = PWM_TICKS_PER_SECOND / STEERING_TORQUE_FREQ;
-	pwm_set_parameters(&PWM_SteeringTorque, STEERING_TORQUE_FREQ_TICKS, duty_cycle * STEERING_TORQUE_FREQ_TICKS);
-	pwm_enable(&PWM_SteeringTorque);
+#if STEERING_RATE_LOOP
+	if( steering_rate_loop.enabled )
+		return;
+#endif
+	ApplySteeringTorque(duty_cycle);
+}
 
-	gpio_set_pin_level(SteeringEnable, duty_cycle > 0.0);
+//Hands the motor over by the enabled flag alone. The interrupt only preempts
+//this task, so once the flag is clear it has made its last write.
+FAST_CODE void SetSteeringRateControl(int enabled)
+{
+#if STEERING_RATE_LOOP
+	if( !enabled && steering_rate_loop.enabled )
+	{
+		steering_rate_loop.enabled = 0;
+		ApplySteeringTorque(0.0f);
+	}
+	else if( enabled )
+	{
+		steering_rate_loop.enabled = 1;
+	}
+#endif
+}
+
+FAST_CODE void SetSteeringRate(float rate)
+{
+#if STEERING_RATE_LOOP
+	steering_rate_loop.setpoint = rate;
+#endif
 }
 
  //Sets the front brake PWM as duty cycle percentage.
- void SetFrontBrake(float duty_cycle)
+ FAST_CODE void SetFrontBrake(float duty_cycle)
  {
-	const static int FRONT_BRAKE_FREQ_TICKS = PWM_TICKS_PER_SECOND / FRONT_BRAKE_FREQ;
-	pwm_set_parameters(&PWM_FrontBrake, FRONT_BRAKE_FREQ_TICKS, duty_cycle * FRONT_BRAKE_FREQ_TICKS);
-	pwm_enable(&PWM_FrontBrake);
+	SetPWMDuty(PWM_FRONT_BRAKE, duty_cycle);
  }
 
-//Sets the acceleration value to the specified duty cycle
-void SetAcceleration(float duty_cycle)
+//Sets the acceleration value to the specified duty cycle, a voltage with
+//DAC_THROTTLE_ENABLE
+FAST_CODE void SetAcceleration(float duty_cycle)
 {	
-	const static int ACCELERATION_FREQ_TICKS = PWM_TICKS_PER_SECOND / ACCELERATION_FREQ;
-	pwm_set_parameters(&PWM_Acceleration, ACCELERATION_FREQ_TICKS, duty_cycle * ACCELERATION_FREQ_TICKS);
-	pwm_enable(&PWM_Acceleration);
-
-	if(duty_cycle > 0)
-	{
-		gpio_set_pin_level(AccelerationEnable, 1);
-	}
-	else
-	{
-		gpio_set_pin_level(AccelerationEnable, 0);
-	}
+#if DAC_THROTTLE_ENABLE
+	DacThrottleSet(duty_cycle);
+	GpioFastLevel(pwm_actuator[PWM_ACCELERATION].enable, DutyEnable(PWM_ACCELERATION, duty_cycle));
+#else
+	SetPWMDuty(PWM_ACCELERATION, duty_cycle);
+#endif
 }
 
 //Non-zero values turns the PC Comm LED ON.
-void SetPCComm(int active)
+FAST_CODE void SetPCComm(int active)
 {
-	gpio_set_pin_level(PCComm, active);
+	GpioFastLevel(PCComm, active);
 }
 
 //non-zero values turns the EStop LED ON.
-void SetEStopState(int active)
+FAST_CODE void SetEStopState(int active)
 {
-	gpio_set_pin_level(EStopState, active);
+	GpioFastLevel(EStopState, active);
 }
 //non-zero values turns on the debug LEDs.
-void SetDebugLED1(int active)
+FAST_CODE void SetDebugLED1(int active)
 {
-	gpio_set_pin_level(LED1, active);
+	GpioFastLevel(LED1, active);
 }
-void SetDebugLED2(int active)
+FAST_CODE void SetDebugLED2(int active)
 {
-	gpio_set_pin_level(LED2, active);
-}
\ No newline at end of file
+	GpioFastLevel(LED2, active);
+}
@@ -8,10 +8,92 @@
  #define DRIVEBYWIREIO_H_
 
  #include "main_context.h"
+ #include "AdcSampler.h"
+
+//Set to 0 to feed the control loop the raw sensor values.
+//Otherwise the steering position goes through a median and a low pass and
+//the vehicle speed through a Kalman filter, see ProcessCurrentInputs.
+//With STEERING_ENCODER_ENABLE (SteeringEncoder.h) the steering angle is the
+//potentiometer fused with the motor encoder instead.
+#ifndef SENSOR_FILTER_INPUTS
+#define SENSOR_FILTER_INPUTS 1
+#endif
+
+//1 scales the throttle, front brake and steering torque duty cycles by the
+//nominal over the measured supply voltage, so that the force a duty gives,
+//and with it the gain of the plant the PID loops were tuned on, stays the
+//same as the battery drains. Needs the supply channel of
+//ADC_SAMPLER_SUPPLY_VOLTAGE (AdcSampler.h).
+//
+//The gain is not divided out every cycle. ProcessCurrentInputs takes one
+//Newton step of the reciprocal, g = g * (2 - v * g) for v the measured over
+//the nominal voltage, two multiplies and a subtract, from the last cycle's
+//g. The supply moves far slower than the step converges, which doubles the
+//correct bits each cycle. v is held to where the gain stays within
+//[SUPPLY_GAIN_MIN, SUPPLY_GAIN_MAX], a broken divider reading 0 leaves the
+//outputs at most that much stronger. CommitActuators and the steering rate
+//loop apply it, the DAC throttle, a voltage reference the motor controller
+//reads, the estop duties and an excitation played by DMA are left as they
+//are.
+#ifndef SUPPLY_COMPENSATION
+#define SUPPLY_COMPENSATION ADC_SAMPLER_SUPPLY_VOLTAGE
+#endif
+
+//Volts the actuators were tuned at, the pack's nominal voltage
+#ifndef SUPPLY_NOMINAL_VOLTS
+#define SUPPLY_NOMINAL_VOLTS 48.0f
+#endif
+
+//Range of the compensation gain, nominal over measured
+#ifndef SUPPLY_GAIN_MIN
+#define SUPPLY_GAIN_MIN 0.8f
+#endif
+#ifndef SUPPLY_GAIN_MAX
+#define SUPPLY_GAIN_MAX 1.5f
+#endif
+
+//Must be called once after atmel_start_init and before the control loop starts.
+//Puts the actuators in a safe state before anything else, the network comes
+//up later and independently of it.
+void InitializeDriveByWireIO();
 
 void ProcessCurrentInputs(main_context_t* context);
+//The IMU sample main_task started reading at the start of the cycle
+//(Imu.h). Keeps the last one and clears imu_valid if it is not in.
+void ProcessImuInputs(main_context_t* context);
 void ProcessCurrentOutputs(main_context_t* context);
 
+//Applies a whole cycle's worth of actuator outputs in one go. All values
+//are worked out before the first write, then the PWM compare buffers are
+//written back to back and each port's pins change with one write
+//(GpioBatch.h). The pins change within a few cycles of each other and each
+//PWM at the end of its current period, instead of one Set* call apart.
+//The rate loop hand off is as SetSteeringRateControl's. An output played
+//by DMA only gets its enable pin, the estop latch and an ADC window trip
+//take it back.
+void CommitActuators(const actuator_command_t* command);
+
+//Compare value of a steering torque and an acceleration duty cycle as
+//CommitActuators writes it, with the fraction of a tick a dithered TCC
+//output keeps, for an output played by DMA (Excitation.h)
+float SteeringTorqueDutyTicks(float duty_cycle);
+float AccelerationDutyTicks(float duty_cycle);
+
+//Throttle off and the brake on at the emergency stop duty, what the control
+//loop's estop branch commands. From the estop and watchdog interrupts,
+//without waiting for the control loop.
+void ForceBrakeOutputs();
+
+//Bit n set for PWM output n, acceleration, steering torque and front brake
+//in that order, whose timer is not running or whose period or compare
+//value does not read back as last written. A TCC output (TccPwm.h) and a
+//DAC throttle are not checked. For the self test (SelfTest.h), from a task.
+uint32_t CheckPWMOutputs();
+
+//Steering angle from the latest ADC sample through the steering
+//calibration, what ProcessCurrentInputs reads every cycle.
+float ReadSteeringPosition();
+
 //non-zero values turn lights on
 void SetSafetyLight1On(int on);
 void SetSafetyLight2On(int on);
@@ -22,9 +104,19 @@ void SetAcceleration(float duty_cycle);
 //non zero values steer right, zero steers left.
 void SetSteerDirection(int right);
 
-//Applies power to the steering motor as duty cycle percentage
+//Applies power to the steering motor as duty cycle percentage.
+//Ignored, like SetSteerDirection, while the steering rate loop drives the motor.
 void SetSteeringTorque(float duty_cycle);
 
+//Hands the steering motor to the rate loop (SteeringRateLoop.h) when
+//non-zero, which then drives it toward the SetSteeringRate rate from its
+//own interrupt. Zero stops the loop and the motor.
+//Without STEERING_RATE_LOOP both do nothing.
+void SetSteeringRateControl(int enabled);
+
+//deg/s, positive toward higher steering angles
+void SetSteeringRate(float rate);
+
 //Puts the vehicle in reverse if value is non-zero.
 void SetReverseDrive(int reverse);
 
@@ -0,0 +1,101 @@
+/*
+ * EStopInput.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hal_gpio.h>
+#include <hri_eic_e54.h>
+#include <hri_mclk_e54.h>
+#include <irq_config.h>
+#include "EStopInput.h"
+#include "FastCode.h"
+#include "Profiler.h"
+#include "RtosTrace.h"
+#include "Ptp.h"
+#include "atmel_start_pins.h"
+
+#define ESTOP_INPUT_PINMUX PINMUX_PC03A_EIC_EXTINT3
+#define ESTOP_INPUT_IRQ EIC_3_IRQn
+
+typedef struct estop_input_t
+{
+	void (*on_press)();
+	volatile uint8_t latched;
+	volatile uint32_t press_time;
+	volatile uint32_t presses;
+} estop_input_t;
+
+static estop_input_t estop_input;
+
+FAST_CODE void EIC_3_Handler()
+{
+	uint32_t start = ProfilerStart();
+	RTOS_TRACE_ISR_ENTER();
+	//level sensitive, off until the control loop rearms it
+	hri_eic_clear_INTEN_reg(EIC, 1UL << ESTOP_INPUT_EXTINT);
+	hri_eic_clear_INTFLAG_reg(EIC, 1UL << ESTOP_INPUT_EXTINT);
+
+	estop_input.on_press();
+	estop_input.press_time = PtpTimeUs();
+	estop_input.presses++;
+	estop_input.latched = 1;
+	ProfilerEnd(PROFILER_STAGE_ESTOP, start);
+	RTOS_TRACE_ISR_EXIT();
+}
+
+void EStopInputInit(void (*on_press)())
+{
+	estop_input.on_press = on_press;
+	estop_input.latched = 0;
+	estop_input.press_time = 0;
+	estop_input.presses = 0;
+
+	hri_mclk_set_APBAMASK_EIC_bit(MCLK);
+
+	//the pin stays readable through PORT IN for ProcessCurrentInputs
+	gpio_set_pin_function(EStop_In, ESTOP_INPUT_PINMUX);
+
+	//other EXTINTs keep their configuration
+	hri_eic_clear_CTRLA_ENABLE_bit(EIC);
+	hri_eic_wait_for_sync(EIC, EIC_SYNCBUSY_ENABLE);
+	uint8_t shift = (ESTOP_INPUT_EXTINT & 7) * 4;
+	uint32_t config = hri_eic_read_CONFIG_reg(EIC, ESTOP_INPUT_EXTINT / 8) & ~(0xFUL << shift);
+	hri_eic_write_CONFIG_reg(EIC, ESTOP_INPUT_EXTINT / 8, config | ((uint32_t)EIC_CONFIG_SENSE0_LOW_Val << shift));
+	hri_eic_set_ASYNCH_ASYNCH_bf(EIC, 1UL << ESTOP_INPUT_EXTINT);
+	hri_eic_set_EVCTRL_EXTINTEO_bf(EIC, 1UL << ESTOP_INPUT_EXTINT);
+	hri_eic_clear_INTFLAG_reg(EIC, 1UL << ESTOP_INPUT_EXTINT);
+	hri_eic_set_INTEN_reg(EIC, 1UL << ESTOP_INPUT_EXTINT);
+	hri_eic_set_CTRLA_ENABLE_bit(EIC);
+	hri_eic_wait_for_sync(EIC, EIC_SYNCBUSY_ENABLE);
+
+	NVIC_SetPriority(ESTOP_INPUT_IRQ, IRQ_PRIORITY_ESTOP);
+	NVIC_ClearPendingIRQ(ESTOP_INPUT_IRQ);
+	NVIC_EnableIRQ(ESTOP_INPUT_IRQ);
+}
+
+FAST_CODE uint8_t EStopInputLatched()
+{
+	return estop_input.latched;
+}
+
+FAST_CODE uint32_t EStopInputPressTime()
+{
+	return estop_input.press_time;
+}
+
+FAST_CODE uint32_t EStopInputPresses()
+{
+	return estop_input.presses;
+}
+
+//The interrupt is off while latched, nothing else writes the latch
+FAST_CODE void EStopInputRelease()
+{
+	if( !estop_input.latched || !gpio_get_pin_level(EStop_In) )
+		return;
+
+	estop_input.latched = 0;
+	hri_eic_clear_INTFLAG_reg(EIC, 1UL << ESTOP_INPUT_EXTINT);
+	hri_eic_set_INTEN_reg(EIC, 1UL << ESTOP_INPUT_EXTINT);
+}
@@ -0,0 +1,53 @@
+/*
+ * EStopInput.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef ESTOPINPUT_H_
+#define ESTOPINPUT_H_
+
+#include <stdint.h>
+
+//The estop input, EStop_In (PC03, active low), as an interrupt instead of
+//a pin the control loop polls once a cycle.
+//
+//EIC EXTINT3 senses the input low without filter and asynchronously, so
+//nothing waits on the 32kHz EIC clock. The press interrupts at
+//IRQ_PRIORITY_ESTOP (irq_config.h), above everything else, the rate loop
+//and every kernel critical section included. The handler calls the function given
+//to EStopInputInit, which forces the outputs off there and then, stamps
+//the PTP time and latches the press for the control loop. Its duration is
+//the PROFILER_STAGE_ESTOP stage. The pin to handler entry time comes on top,
+//the core's 12 cycle interrupt latency and the EIC's asynchronous path,
+//and is for a scope on EStop_In and AccelerationEnable to measure.
+//
+//A press that is released before the control loop looks is still seen by
+//it: the latch holds until EStopInputRelease finds the input released. The
+//interrupt is level sensitive, so it is off while the latch is set and
+//fires again as soon as it is rearmed if the input is still low.
+//
+//The EIC also sends the input out as an event, TccPwm.c takes it from
+//there as the TCC fault.
+
+//EStop_In, PC03
+#define ESTOP_INPUT_EXTINT 3
+
+//Sets the input up and enables its interrupt, on_press runs from it. Call
+//once the outputs on_press writes are running.
+void EStopInputInit(void (*on_press)());
+
+//Non-zero from a press until EStopInputRelease clears it. Any context.
+uint8_t EStopInputLatched();
+
+//PTP us of the press that set the latch, 0 if the clock was not synced
+uint32_t EStopInputPressTime();
+
+//Presses since boot
+uint32_t EStopInputPresses();
+
+//Clears the latch and rearms the interrupt once the input reads released.
+//From the control loop, after it has acted on the press.
+void EStopInputRelease();
+
+#endif /* ESTOPINPUT_H_ */
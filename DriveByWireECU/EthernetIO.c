@@ -4,26 +4,170 @@
  * Created: 10/2/2019 8:02:24 AM
  *  Author: John Brooks
  */ 
+#include <string.h>
 #include "EthernetIO.h"
 #include "sockets.h"
+#include "semphr.h"
 #include "lwip/sys.h"
 #include "lwip/api.h"
 #include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/ip.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/netif.h"
+#include "netif/etharp.h"
+#include "ethif_mac.h"
+#include "lwip/timers.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
 #include "webserver_tasks.h"
 #include "main_context.h"
+#include "ControlProtocol.h"
+#include "TelemetryStream.h"
+#include "HeapMonitor.h"
+#include "PoolMonitor.h"
+#include "Profiler.h"
+#include "CacheMonitor.h"
+#include "Log.h"
+#include "SysArchBenchmark.h"
+#include "UdpFlow.h"
+#include "CommandArbiter.h"
+#include "ParamStore.h"
+#include "PhyMonitor.h"
+#include "Ptp.h"
+#include "DiagServer.h"
+#include "BulkChannel.h"
+#include "FirmwareUpdate.h"
+#include "CanGateway.h"
+#include "Watchdog.h"
+#include "NetLatency.h"
+#include "LatencyProbe.h"
+#include "NodeIdentity.h"
+#include "BootProfile.h"
+#include "TimeTrigger.h"
 
-#define ECU_IP "192.168.2.100"
 #define ECU_PORT "1234"
 #define BROADCAST_PORT "1235"
-#define PC_IP "255.255.255.255"
+#define PC_IP ETHERNET_PC_IP
 #define PC_PORT "1236"
 #define SUBNET_MASK "255.255.255.0"
 
-#define TRANSMIT_INTERVAL 10 //milliseconds
+#define TELEMETRY_PORT 12089 //PC listens for telemetry on the group here until it subscribes
+//Administratively scoped group the unsubscribed status frames go to. Only
+//hosts that joined it get them, where a broadcast hit every host on the
+//segment.
+#define TELEMETRY_GROUP "239.192.2.100"
+#define COMMAND_PORT 12090 //ECU listens for commands here
+#define PARAM_PORT 12091 //ECU listens for param requests here
+#define DISCOVERY_PORT 12092 //ECU listens for discover requests and announces itself here
+
+#if TIME_TRIGGER_ENABLE && !(ETHERNET_RAW_UDP && ETHERNET_CYCLE_ALIGNED_TX)
+#error TIME_TRIGGER_ENABLE gates the cycle aligned telemetry of ETHERNET_RAW_UDP
+#endif
+
+#if ETHERNET_LINK_COMMANDS && !(ETHERNET_RAW_UDP && LWIP_TCPIP_CORE_LOCKING)
+#error ETHERNET_LINK_COMMANDS needs ETHERNET_RAW_UDP and LWIP_TCPIP_CORE_LOCKING
+#endif
 
 struct sockaddr_in ecu_addr, pc_addr;
 static int lwip_initialized = 0;
 
+#if ETHERNET_CONTROL_PRIORITY || (ETHERNET_RAW_UDP && ETHERNET_FAST_INPUT && LWIP_TCPIP_CORE_LOCKING_INPUT)
+//UDP header of frame p if it is an unfragmented IPv4 datagram without IP
+//options with all headers in the first pbuf, NULL for anything else.
+//p->payload points at the Ethernet header.
+static struct udp_hdr* FindUdpHeader(struct pbuf *p)
+{
+	if( p->len < SIZEOF_ETH_HDR + IP_HLEN + UDP_HLEN )
+		return NULL;
+
+	const struct eth_hdr* ethhdr = (const struct eth_hdr*)p->payload;
+	const struct ip_hdr* iphdr = (const struct ip_hdr*)((uint8_t*)p->payload + SIZEOF_ETH_HDR);
+	if( ethhdr->type != PP_HTONS(ETHTYPE_IP) || IPH_V(iphdr) != 4 || IPH_HL(iphdr) != IP_HLEN / 4 ||
+		IPH_PROTO(iphdr) != IP_PROTO_UDP || (IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) != 0 )
+		return NULL;
+
+	return (struct udp_hdr*)((uint8_t*)iphdr + IP_HLEN);
+}
+#endif
+
+#if ETHERNET_CONTROL_PRIORITY
+//Receive classifier (ethif_mac.h), runs in gmac_task for every IP and ARP
+//frame. Control datagrams overtake whatever else is waiting in the ring.
+//Of the broadcasts only ARP requests for our address and discover requests
+//are let through, nothing else on the ECU listens for them.
+static enum ethernetif_rx_class ClassifyFrame(struct pbuf *p, struct netif *netif)
+{
+	const struct eth_hdr* ethhdr = (const struct eth_hdr*)p->payload;
+	const struct udp_hdr* udphdr = FindUdpHeader(p);
+
+	if( udphdr != NULL && udphdr->dest == PP_HTONS(COMMAND_PORT) )
+		return ETHERNETIF_RX_PRIORITY;
+	if( !eth_addr_cmp(&ethhdr->dest, &ethbroadcast) || (udphdr != NULL && udphdr->dest == PP_HTONS(DISCOVERY_PORT)) )
+		return ETHERNETIF_RX_NORMAL;
+
+	if( ethhdr->type == PP_HTONS(ETHTYPE_ARP) && p->len >= SIZEOF_ETHARP_PACKET )
+	{
+		const struct etharp_hdr* arphdr = (const struct etharp_hdr*)((uint8_t*)p->payload + SIZEOF_ETH_HDR);
+		ip_addr_t target;
+		IPADDR2_COPY(&target, &arphdr->dipaddr);
+		if( ip_addr_cmp(&target, &netif->ip_addr) )
+			return ETHERNETIF_RX_NORMAL;
+	}
+	return ETHERNETIF_RX_DROP;
+}
+#endif
+
+//The PC's IP, from the node parameters or else ETHERNET_PC_IP
+static void PeerAddress(ip_addr_t* ip)
+{
+	const node_identity_t* node = NodeIdentity();
+	if( node->peer_ip[0] | node->peer_ip[1] | node->peer_ip[2] | node->peer_ip[3] )
+		IP4_ADDR(ip, node->peer_ip[0], node->peer_ip[1], node->peer_ip[2], node->peer_ip[3]);
+	else
+		ip->addr = ipaddr_addr(PC_IP);
+}
+
+//Pins the PC's MAC, from the node parameters or else ETHERNET_PC_MAC, so
+//the first packet after an ARP timeout does not sit in the ARP queue
+//waiting for a reply
+void EthernetAddStaticPeers()
+{
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+	const node_identity_t* node = NodeIdentity();
+	struct eth_addr pc_mac;
+	if( node->peer_mac_set )
+		memcpy(pc_mac.addr, node->peer_mac, sizeof(pc_mac.addr));
+	else
+	{
+#if defined(ETHERNET_PC_MAC)
+		static const struct eth_addr default_mac = { { ETHERNET_PC_MAC } };
+		pc_mac = default_mac;
+#else
+		return;
+#endif
+	}
+
+	ip_addr_t pc_ip;
+	PeerAddress(&pc_ip);
+	err_t err = etharp_add_static_entry(&pc_ip, &pc_mac);
+	if( err != ERR_OK )
+		LOG("static ARP entry for %s failed: %d", ipaddr_ntoa(&pc_ip), err);
+#endif
+}
+
+//lwIP broadcast its gratuitous ARP already, which a PC only takes to update
+//an entry it has. A request addressed to the PC makes it enter ours right
+//away, and its reply fills in the PC's entry if it is not pinned.
+void EthernetLinkUp(struct netif* netif)
+{
+	if( ip_addr_isany(&netif->ip_addr) )
+		return;
+	ip_addr_t pc_ip;
+	PeerAddress(&pc_ip);
+	etharp_request(netif, &pc_ip);
+}
+
 int InitializeLWIP()
 {
 	if(lwip_initialized)
@@ -34,108 +178,1457 @@ int InitializeLWIP()
 	tcpip_init(tcpip_init_done, &sem);
 	sys_sem_wait(&sem); /* Block until the lwIP stack is initialized. */
 	sys_sem_free(&sem); /* Free the semaphore. */
-	print_ipaddress();
+	LOCK_TCPIP_CORE();
+	EthernetAddStaticPeers();
+	UNLOCK_TCPIP_CORE();
+#if ETHERNET_CONTROL_PRIORITY
+	ethernetif_mac_set_classifier(ClassifyFrame);
+#endif
+#if SYS_ARCH_BENCHMARK
+	ReportSysArchBenchmark();
+#endif
 	lwip_initialized = 1;
 	return 0; 
 }
 
-void decode_ethernet_inputs(EthernetInputs* inputs, main_context_t* ctx)
+//Sender time stamped into every frame
+static uint32_t GetProtocolTime()
+{
+	return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+//Received frames longer than this are dropped whole and counted in
+//rx_invalid, never cut short. The largest the PC sends on the command port
+//are trajectories and memory requests.
+#define RX_FRAME_BUFFER_SIZE (CONTROL_TRAJECTORY_MAX_FRAME_SIZE > CONTROL_MEMORY_REQUEST_MAX_FRAME_SIZE ? \
+	CONTROL_TRAJECTORY_MAX_FRAME_SIZE : CONTROL_MEMORY_REQUEST_MAX_FRAME_SIZE)
+
+//Carries out the rearm and trigger actions. Returns how many trace data
+//frames should be sent back.
+static uint8_t ApplyTraceRequest(pid_trace_t* trace, const control_trace_request_t* request)
+{
+	switch( request->action )
+	{
+	case CONTROL_TRACE_REARM:
+		PIDTraceConfigure(trace, request->triggers, request->step_threshold, request->error_threshold);
+		PIDTraceRequestRearm(trace);
+		return 1;
+	case CONTROL_TRACE_TRIGGER:
+		PIDTraceRequestTrigger(trace);
+		return 1;
+	default:
+		return PIDTraceState(trace) == PID_TRACE_FROZEN ? CONTROL_TRACE_FRAMES_PER_REQUEST : 1;
+	}
+}
+
+//The control channel's set becomes changed, and goes to main_task whole
+static void ApplyParamSet(main_context_t* ctx, const param_set_t* changed)
+{
+	ctx->params = *changed;
+	*BeginParamsWrite(&ctx->exchange) = *changed;
+	PublishParams(&ctx->exchange);
+}
+
+//Carries out a param request and writes the param data frame answering it,
+//returns its length. The set the control channel owns is only changed, and
+//goes to main_task whole, once every entry of a set was accepted, so
+//main_task switches to all of them in the same cycle.
+static uint16_t ApplyParamRequest(main_context_t* ctx, control_protocol_t* protocol, const control_param_request_t* request,
+	uint8_t* frame)
+{
+	uint8_t result = CONTROL_PARAM_RESULT_DONE;
+	uint8_t rejected = 0;
+	param_set_t changed = ctx->params;
+
+	switch( request->action )
+	{
+	case CONTROL_PARAM_READ:
+		if( request->count > CONTROL_PARAM_BATCH_MAX )
+			result = CONTROL_PARAM_RESULT_REJECTED;
+		else if( request->count > 0 )
+			return ControlProtocolEncodeParamData(protocol, frame, &ctx->params, result, 0, request->ids, request->count, GetProtocolTime());
+		break;
+	case CONTROL_PARAM_SET:
+		if( request->count > CONTROL_PARAM_BATCH_MAX )
+		{
+			result = CONTROL_PARAM_RESULT_REJECTED;
+			rejected = CONTROL_PARAM_BATCH_MAX;
+			break;
+		}
+		for(uint8_t i = 0; i < request->count; ++i)
+		{
+			if( ParamSetValue(&changed, request->ids[i], request->values[i]) != 0 )
+			{
+				result = CONTROL_PARAM_RESULT_REJECTED;
+				rejected = i;
+				break;
+			}
+		}
+		break;
+	case CONTROL_PARAM_DEFAULTS:
+		ParamSetDefaults(&changed);
+		break;
+	case CONTROL_PARAM_SAVE:
+		if( ParamStoreState() == PARAM_STORE_UNAVAILABLE )
+			result = CONTROL_PARAM_RESULT_UNAVAILABLE;
+		else
+			ParamStoreRequestSave(&ctx->params);
+		break;
+	default:
+		result = CONTROL_PARAM_RESULT_BAD_ACTION;
+		break;
+	}
+
+	if( result == CONTROL_PARAM_RESULT_DONE && (request->action == CONTROL_PARAM_SET || request->action == CONTROL_PARAM_DEFAULTS) )
+		ApplyParamSet(ctx, &changed);
+	return ControlProtocolEncodeParamData(protocol, frame, &ctx->params, result, rejected, NULL, 0, GetProtocolTime());
+}
+
+//For the profile data frame, from the thread that answers the request
+static void ReadLoadStats(main_context_t* ctx, control_load_stats_t* load)
+{
+	memset(load, 0, sizeof(*load));
+	load->cycles = ctx->scheduler.cycle_count;
+	load->overruns = ctx->scheduler.overrun_count;
+	if( netif_default != NULL )
+	{
+		struct mac_async_ring_stats ring;
+		mac_async_get_ring_stats((struct mac_async_descriptor*)netif_default->state, &ring);
+		load->rx_frames = ring.rx_frames;
+		load->rx_dropped = ring.rx_overruns + ring.rx_no_buffer;
+	}
+#if LWIP_STATS && LINK_STATS
+	load->link_dropped = lwip_stats.link.drop;
+#endif
+}
+
+#if LWIP_STATS
+#ifndef LWIP_STATS_REPORT_PERIOD
+#define LWIP_STATS_REPORT_PERIOD 10000
+#endif
+
+//Runs in the tcpip thread every LWIP_STATS_REPORT_PERIOD ms. The lwIP
+//sizes in lwipopts.h and lwip_profile_config.h come from these high-water
+//marks.
+static void LogNetworkStats(void* arg)
+{
+	PoolMonitorReport();
+#if LINK_STATS
+	LOG("lwip link: %lu received, %lu sent, %lu dropped, %lu out of memory",
+		lwip_stats.link.recv, lwip_stats.link.xmit, lwip_stats.link.drop, lwip_stats.link.memerr);
+#endif
+#if UDP_STATS
+	LOG("lwip udp: %lu received, %lu sent, %lu dropped",
+		lwip_stats.udp.recv, lwip_stats.udp.xmit, lwip_stats.udp.drop);
+#endif
+	struct mac_async_ring_stats ring;
+	mac_async_get_ring_stats((struct mac_async_descriptor*)netif_default->state, &ring);
+	LOG("gmac rx: %lu frames, %lu chained, %lu broken, %lu overruns, %lu without a buffer",
+		ring.rx_frames, ring.rx_chained, ring.rx_broken, ring.rx_overruns, ring.rx_no_buffer);
+	LOG("gmac rx pressure: %lu stalls, %lu resyncs, %lu frames shed",
+		ring.rx_stalls, ring.rx_resyncs, ethernetif_mac_rx_shed());
+	LOG("gmac rings: rx at least %lu of %lu filled, tx at most %lu of %lu queued, %lu frames refused",
+		ring.rx_filled_min, ring.rx_descriptors, ring.tx_queued_max, ring.tx_descriptors, ring.tx_full);
+	phy_monitor_stats_t phy;
+	PhyMonitorRead(&phy);
+	LOG("ethernet link: %s, %lu Mbit/s %s duplex, %lu drops, last outage %lu ms, %lu mode corrections", phy.up ? "up" : "down",
+		phy.speed, phy.full_duplex ? "full" : "half", phy.drops, phy.last_outage, phy.mode_corrections);
+	ptp_stats_t ptp;
+	PtpRead(&ptp);
+	LOG("ptp: %s, offset %ld ns, path delay %ld ns, rate %ld ppb, %lu syncs, %lu steps",
+		ptp.synced ? "synced" : "not synced", ptp.offset, ptp.path_delay, ptp.adjustment, ptp.syncs, ptp.steps);
+
+	sys_timeout(LWIP_STATS_REPORT_PERIOD, LogNetworkStats, arg);
+}
+#endif
+
+//The action of a calibration request, after its answer
+static void ApplyCalibrationAction(uint8_t action)
+{
+	if( action == CONTROL_CALIBRATION_START )
+		SteeringSweepRequestStart();
+	else if( action == CONTROL_CALIBRATION_ABORT )
+		SteeringSweepRequestAbort();
+}
+
+//The action of an autotune request, after its answer
+static void ApplyAutotuneAction(uint8_t action, uint8_t loop)
+{
+	if( action == CONTROL_AUTOTUNE_START )
+		PIDAutotuneRequestStart((pid_autotune_loop_t)loop);
+	else if( action == CONTROL_AUTOTUNE_ABORT )
+		PIDAutotuneRequestAbort();
+}
+
+//The action of an excitation request, after its answer
+static void ApplyExcitationAction(uint8_t action, const excitation_config_t* config)
+{
+	if( action == CONTROL_EXCITATION_START )
+		ExcitationRequestStart(config);
+	else if( action == CONTROL_EXCITATION_ABORT )
+		ExcitationRequestAbort();
+}
+
+#if ETHERNET_RAW_UDP
+//The GMAC sends PBUF_RAM pbufs in place and only drops its reference when the
+//next frame goes out, so every frame sent in one pass needs its own pbuf and
+//the last one sent may still be held at the start of the next pass.
+#define TELEMETRY_PBUF_COUNT (TELEMETRY_MAX_FRAMES_PER_PASS + 1)
+//Batched telemetry frames are close to a full Ethernet frame, they get
+//pbufs of their own rather than every telemetry pbuf being that large. A
+//pass sends at least one, batches that are still due go on the next.
+#ifndef TELEMETRY_BATCH_PBUF_COUNT
+#define TELEMETRY_BATCH_PBUF_COUNT 2
+#endif
+//Signal data frames are as large as their sets, they get their own too
+#define TELEMETRY_SIGNAL_PBUF_COUNT (TELEMETRY_MAX_SIGNAL_FRAMES_PER_PASS + 1)
+
+typedef struct raw_udp_channel_t
+{
+	main_context_t* ctx;
+	struct udp_pcb* pcb;
+	struct udp_pcb* param_pcb;
+	struct udp_pcb* discovery_pcb;
+	struct pbuf* telemetry[TELEMETRY_PBUF_COUNT];
+	//where each telemetry pbuf's frame starts, ahead of any headers
+	uint8_t* telemetry_frame[TELEMETRY_PBUF_COUNT];
+	struct pbuf* telemetry_batch[TELEMETRY_BATCH_PBUF_COUNT];
+	uint8_t* telemetry_batch_frame[TELEMETRY_BATCH_PBUF_COUNT];
+	struct pbuf* telemetry_signal[TELEMETRY_SIGNAL_PBUF_COUNT];
+	uint8_t* telemetry_signal_frame[TELEMETRY_SIGNAL_PBUF_COUNT];
+	control_protocol_t protocol;
+	command_arbiter_t arbiter;
+	telemetry_stream_t stream;
+	//set by raw_udp_start once lwIP and the channel are up
+	volatile uint8_t started;
+#if ETHERNET_PINNED_FLOW && CONF_GMAC_TX_SCATTER_GATHER
+	//one per subscriber plus the telemetry group
+	udp_flow_t flows[TELEMETRY_MAX_SUBSCRIBERS + 1];
+	uint32_t flow_opened[TELEMETRY_MAX_SUBSCRIBERS + 1];
+#endif
+#if ETHERNET_CYCLE_ALIGNED_TX
+	//posted by EthernetCycleEnd, allocated once so main_task never allocates.
+	//NULL until the channel is up.
+	struct tcpip_callback_msg* cycle_end;
+	//set by main_task when it posts, cleared by the tcpip thread before it
+	//reads the snapshot, so a cycle that ends after that posts again
+	volatile uint8_t cycle_end_pending;
+	//GetProtocolTime the next frame is due at, written by the tcpip thread
+	volatile uint32_t next_due;
+#endif
+} raw_udp_channel_t;
+
+static raw_udp_channel_t raw_channel;
+
+//Answers a trace request straight from the frozen trace. The frames are only
+//allocated for the dump, the trace is read rarely.
+static void raw_udp_trace_reply(raw_udp_channel_t* channel, const control_trace_request_t* request, ip_addr_t *addr, u16_t port)
+{
+	uint8_t frames = ApplyTraceRequest(&channel->ctx->trace, request);
+	uint16_t first = request->first;
+
+	for(uint8_t f = 0; f < frames; ++f)
+	{
+		struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_TRACE_MAX_FRAME_SIZE, PBUF_RAM);
+		if( p == NULL )
+			return;
+
+		uint16_t samples;
+		uint16_t length = ControlProtocolEncodeTraceData(&channel->protocol, (uint8_t*)p->payload, &channel->ctx->trace,
+			first, &samples, GetProtocolTime());
+		pbuf_realloc(p, length);
+		udp_sendto(channel->pcb, p, addr, port);
+		pbuf_free(p);
+
+		first += samples;
+		//past the end of the trace
+		if( samples < CONTROL_TRACE_SAMPLES_PER_FRAME )
+			return;
+	}
+}
+
+static void raw_udp_profile_reply(raw_udp_channel_t* channel, uint8_t action, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_PROFILE_MAX_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	control_load_stats_t load;
+	ReadLoadStats(channel->ctx, &load);
+	uint16_t length = ControlProtocolEncodeProfileData(&channel->protocol, (uint8_t*)p->payload, configCPU_CLOCK_HZ, &load,
+		GetProtocolTime());
+	pbuf_realloc(p, length);
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+
+	if( action == CONTROL_PROFILE_RESET )
+	{
+		ProfilerRequestReset();
+		CacheMonitorRequestReset();
+		NetLatencyRequestReset();
+	}
+}
+
+static void raw_udp_task_reply(raw_udp_channel_t* channel, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_TASK_MAX_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	uint16_t length = ControlProtocolEncodeTaskData(&channel->protocol, (uint8_t*)p->payload, GetProtocolTime());
+	pbuf_realloc(p, length);
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void raw_udp_boot_reply(raw_udp_channel_t* channel, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_BOOT_MAX_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	uint16_t length = ControlProtocolEncodeBootData(&channel->protocol, (uint8_t*)p->payload, GetProtocolTime());
+	pbuf_realloc(p, length);
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void raw_udp_calibration_reply(raw_udp_channel_t* channel, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_CALIBRATION_MAX_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	uint16_t length = ControlProtocolEncodeCalibrationData(&channel->protocol, (uint8_t*)p->payload, GetProtocolTime());
+	pbuf_realloc(p, length);
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void raw_udp_autotune_reply(raw_udp_channel_t* channel, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_AUTOTUNE_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	ControlProtocolEncodeAutotuneData(&channel->protocol, (uint8_t*)p->payload, GetProtocolTime());
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void raw_udp_excitation_reply(raw_udp_channel_t* channel, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_EXCITATION_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	ControlProtocolEncodeExcitationData(&channel->protocol, (uint8_t*)p->payload, GetProtocolTime());
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void raw_udp_schema_reply(raw_udp_channel_t* channel, uint8_t first, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_SCHEMA_MAX_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	uint16_t length = ControlProtocolEncodeSchema(&channel->protocol, (uint8_t*)p->payload, first, GetProtocolTime());
+	pbuf_realloc(p, length);
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void raw_udp_memory_reply(raw_udp_channel_t* channel, const control_memory_request_t* request, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_MEMORY_MAX_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	uint16_t length = ControlProtocolEncodeMemoryData(&channel->protocol, (uint8_t*)p->payload, request, GetProtocolTime());
+	pbuf_realloc(p, length);
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+static void raw_udp_event_reply(raw_udp_channel_t* channel, uint32_t first, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_EVENT_MAX_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	uint16_t length = ControlProtocolEncodeEventData(&channel->protocol, (uint8_t*)p->payload, first, GetProtocolTime());
+	pbuf_realloc(p, length);
+	udp_sendto(channel->pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+//Runs for every datagram on PARAM_PORT, in the tcpip thread. The control
+//channel's set is only ever touched here once the channel is up.
+static void raw_udp_param_receive(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	raw_udp_channel_t* channel = (raw_udp_channel_t*)arg;
+	uint8_t buffer[CONTROL_PARAM_REQUEST_MAX_FRAME_SIZE];
+	uint32_t length = pbuf_copy_partial(p, buffer, sizeof(buffer), 0);
+	//longer than any request can be, a plain copy would cut it short
+	uint8_t too_long = p->tot_len > sizeof(buffer);
+	pbuf_free(p);
+
+	control_param_request_t request;
+	if( too_long || !ControlProtocolDecodeParamRequest(&channel->protocol, buffer, length, &request) )
+		return;
+
+	struct pbuf* reply = pbuf_alloc(PBUF_TRANSPORT, CONTROL_PARAM_MAX_FRAME_SIZE, PBUF_RAM);
+	if( reply == NULL )
+		return;
+
+	uint16_t reply_length = ApplyParamRequest(channel->ctx, &channel->protocol, &request, (uint8_t*)reply->payload);
+	pbuf_realloc(reply, reply_length);
+	udp_sendto(pcb, reply, addr, port);
+	pbuf_free(reply);
+}
+
+static void raw_udp_announce_to(raw_udp_channel_t* channel, ip_addr_t *addr, u16_t port)
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, CONTROL_ANNOUNCE_FRAME_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	ControlProtocolEncodeAnnounce(&channel->protocol, (uint8_t*)p->payload, NodeIdentity(), COMMAND_PORT, PARAM_PORT,
+		GetProtocolTime());
+	udp_sendto(channel->discovery_pcb, p, addr, port);
+	pbuf_free(p);
+}
+
+//Runs for every datagram on DISCOVERY_PORT, in the tcpip thread
+static void raw_udp_discovery_receive(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	raw_udp_channel_t* channel = (raw_udp_channel_t*)arg;
+	uint8_t buffer[CONTROL_HEADER_SIZE + CONTROL_DISCOVER_PAYLOAD_SIZE + CONTROL_CRC_SIZE];
+	uint32_t length = pbuf_copy_partial(p, buffer, sizeof(buffer), 0);
+	uint8_t too_long = p->tot_len > sizeof(buffer);
+	pbuf_free(p);
+
+	uint8_t node_id;
+	if( too_long || !ControlProtocolDecodeDiscover(&channel->protocol, buffer, length, &node_id) )
+		return;
+	if( node_id == NODE_ANY || node_id == NodeIdentity()->id )
+		raw_udp_announce_to(channel, addr, port);
+}
+
+//lwIP timer, lets PCs listening on the group see the node come and go
+static void raw_udp_announce(void *arg)
+{
+	raw_udp_channel_t* channel = (raw_udp_channel_t*)arg;
+	ip_addr_t group;
+
+	group.addr = ipaddr_addr(TELEMETRY_GROUP);
+	raw_udp_announce_to(channel, &group, DISCOVERY_PORT);
+	sys_timeout(ETHERNET_ANNOUNCE_PERIOD, raw_udp_announce, arg);
+}
+
+//Runs for every datagram on COMMAND_PORT, in gmac_task with the core locked
+//when LWIP_TCPIP_CORE_LOCKING_INPUT is set, otherwise in the tcpip thread.
+//With ETHERNET_FAST_INPUT most of them come straight from raw_udp_input.
+//Publishes a command or trajectory frame from the commander address:port,
+//received at rx_ptp_time. In the tcpip thread or with the core locked.
+static void raw_udp_command(raw_udp_channel_t* channel, const uint8_t* frame, uint32_t length, uint32_t address,
+	uint16_t port, uint32_t rx_ptp_time)
+{
+	control_command_info_t info;
+	uint32_t now = xTaskGetTickCount();
+	if( ControlProtocolCheckCommand(&channel->protocol, frame, length, &info)
+		&& CommandArbiterAccept(&channel->arbiter, address, port, &info, now) )
+	{
+		control_command_t* command = BeginCommandWrite(&channel->ctx->exchange, info.priority);
+		ControlProtocolDecodeCommand(&channel->protocol, frame, &info, now, command);
+		NetLatencyReceived(&command->latency);
+		LatencyProbeReceived(&command->probe);
+		channel->protocol.rx_ptp_time = rx_ptp_time;
+		PublishCommand(&channel->ctx->exchange, info.priority);
+		BootProfileMark(BOOT_STAGE_FIRST_COMMAND);
+	}
+}
+
+static void raw_udp_receive(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	uint32_t rx_ptp_time = PtpTimeUs();
+	uint32_t profile_start = ProfilerStart();
+	raw_udp_channel_t* channel = (raw_udp_channel_t*)arg;
+	if( p->tot_len > RX_FRAME_BUFFER_SIZE )
+	{
+		channel->protocol.rx_invalid++;
+		pbuf_free(p);
+		return;
+	}
+
+	CacheMonitorBegin(CACHE_MONITOR_NETWORK);
+	uint8_t buffer[RX_FRAME_BUFFER_SIZE];
+	const uint8_t* frame = (const uint8_t*)p->payload;
+	uint32_t length = p->tot_len;
+
+	//Most frames fit in one pool pbuf, only a chained one needs gathering.
+	if( p->len != p->tot_len )
+	{
+		frame = buffer;
+		length = pbuf_copy_partial(p, buffer, sizeof(buffer), 0);
+	}
+
+	switch( ControlProtocolFrameType(frame, length) )
+	{
+	case CONTROL_FRAME_SUBSCRIBE:
+	{
+		control_subscription_t subscription;
+		if( ControlProtocolDecodeSubscribe(&channel->protocol, frame, length, &subscription) )
+			TelemetryStreamSubscribe(&channel->stream, &subscription, addr->addr, port, GetProtocolTime());
+		break;
+	}
+	case CONTROL_FRAME_SIGNAL_SUBSCRIBE:
+	{
+		control_signal_subscription_t subscription;
+		if( ControlProtocolDecodeSignalSubscribe(&channel->protocol, frame, length, &subscription) )
+			TelemetryStreamSubscribeSignals(&channel->stream, &subscription, addr->addr, port, GetProtocolTime());
+		break;
+	}
+	case CONTROL_FRAME_SCHEMA_REQUEST:
+	{
+		uint8_t first;
+		if( ControlProtocolDecodeSchemaRequest(&channel->protocol, frame, length, &first) )
+			raw_udp_schema_reply(channel, first, addr, port);
+		break;
+	}
+	case CONTROL_FRAME_TRACE_REQUEST:
+	{
+		control_trace_request_t request;
+		if( ControlProtocolDecodeTraceRequest(&channel->protocol, frame, length, &request) )
+			raw_udp_trace_reply(channel, &request, addr, port);
+		break;
+	}
+	case CONTROL_FRAME_PROFILE_REQUEST:
+	{
+		uint8_t action;
+		if( ControlProtocolDecodeProfileRequest(&channel->protocol, frame, length, &action) )
+			raw_udp_profile_reply(channel, action, addr, port);
+		break;
+	}
+	case CONTROL_FRAME_TASK_REQUEST:
+		if( ControlProtocolDecodeTaskRequest(&channel->protocol, frame, length) )
+			raw_udp_task_reply(channel, addr, port);
+		break;
+	case CONTROL_FRAME_EVENT_REQUEST:
+	{
+		uint32_t first;
+		if( ControlProtocolDecodeEventRequest(&channel->protocol, frame, length, &first) )
+			raw_udp_event_reply(channel, first, addr, port);
+		break;
+	}
+	case CONTROL_FRAME_BOOT_REQUEST:
+		if( ControlProtocolDecodeBootRequest(&channel->protocol, frame, length) )
+			raw_udp_boot_reply(channel, addr, port);
+		break;
+	case CONTROL_FRAME_MEMORY_REQUEST:
+	{
+		control_memory_request_t request;
+		if( ControlProtocolDecodeMemoryRequest(&channel->protocol, frame, length, &request) )
+			raw_udp_memory_reply(channel, &request, addr, port);
+		break;
+	}
+	case CONTROL_FRAME_CALIBRATION_REQUEST:
+	{
+		uint8_t action;
+		if( ControlProtocolDecodeCalibrationRequest(&channel->protocol, frame, length, &action) )
+		{
+			raw_udp_calibration_reply(channel, addr, port);
+			ApplyCalibrationAction(action);
+		}
+		break;
+	}
+	case CONTROL_FRAME_AUTOTUNE_REQUEST:
+	{
+		uint8_t action, loop;
+		if( ControlProtocolDecodeAutotuneRequest(&channel->protocol, frame, length, &action, &loop) )
+		{
+			raw_udp_autotune_reply(channel, addr, port);
+			ApplyAutotuneAction(action, loop);
+		}
+		break;
+	}
+	case CONTROL_FRAME_EXCITATION_REQUEST:
+	{
+		uint8_t action;
+		excitation_config_t config;
+		if( ControlProtocolDecodeExcitationRequest(&channel->protocol, frame, length, &action, &config) )
+		{
+			raw_udp_excitation_reply(channel, addr, port);
+			ApplyExcitationAction(action, &config);
+		}
+		break;
+	}
+	default:
+		raw_udp_command(channel, frame, length, addr->addr, port, rx_ptp_time);
+		break;
+	}
+	pbuf_free(p);
+	CacheMonitorEnd(CACHE_MONITOR_NETWORK);
+	ProfilerEnd(PROFILER_STAGE_ETH_RECEIVE, profile_start);
+}
+
+uint8_t EthernetAnswerRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* buffer,
+	ethernet_reply_t reply, void* arg)
+{
+	raw_udp_channel_t* channel = &raw_channel;
+	uint8_t answered = 1;
+
+	//the core lock only exists once lwIP is up
+	if( !__atomic_load_n(&channel->started, __ATOMIC_ACQUIRE) )
+		return 0;
+	LOCK_TCPIP_CORE();
+	switch( ControlProtocolFrameType(frame, length) )
+	{
+	case CONTROL_FRAME_TRACE_REQUEST:
+	{
+		control_trace_request_t request;
+		if( !ControlProtocolDecodeTraceRequest(protocol, frame, length, &request) )
+		{
+			answered = 0;
+			break;
+		}
+		uint8_t frames = ApplyTraceRequest(&channel->ctx->trace, &request);
+		uint16_t first = request.first;
+		for(uint8_t f = 0; f < frames; ++f)
+		{
+			uint16_t samples;
+			reply(arg, buffer, ControlProtocolEncodeTraceData(protocol, buffer, &channel->ctx->trace, first, &samples,
+				GetProtocolTime()));
+			first += samples;
+			if( samples < CONTROL_TRACE_SAMPLES_PER_FRAME )
+				break;
+		}
+		break;
+	}
+	case CONTROL_FRAME_PROFILE_REQUEST:
+	{
+		uint8_t action;
+		answered = ControlProtocolDecodeProfileRequest(protocol, frame, length, &action);
+		if( !answered )
+			break;
+		control_load_stats_t load;
+		ReadLoadStats(channel->ctx, &load);
+		reply(arg, buffer, ControlProtocolEncodeProfileData(protocol, buffer, configCPU_CLOCK_HZ, &load, GetProtocolTime()));
+		if( action == CONTROL_PROFILE_RESET )
+		{
+			ProfilerRequestReset();
+			CacheMonitorRequestReset();
+			NetLatencyRequestReset();
+		}
+		break;
+	}
+	case CONTROL_FRAME_TASK_REQUEST:
+		answered = ControlProtocolDecodeTaskRequest(protocol, frame, length);
+		if( answered )
+			reply(arg, buffer, ControlProtocolEncodeTaskData(protocol, buffer, GetProtocolTime()));
+		break;
+	case CONTROL_FRAME_EVENT_REQUEST:
+	{
+		uint32_t first;
+		answered = ControlProtocolDecodeEventRequest(protocol, frame, length, &first);
+		if( answered )
+			reply(arg, buffer, ControlProtocolEncodeEventData(protocol, buffer, first, GetProtocolTime()));
+		break;
+	}
+	case CONTROL_FRAME_BOOT_REQUEST:
+		answered = ControlProtocolDecodeBootRequest(protocol, frame, length);
+		if( answered )
+			reply(arg, buffer, ControlProtocolEncodeBootData(protocol, buffer, GetProtocolTime()));
+		break;
+	case CONTROL_FRAME_MEMORY_REQUEST:
+	{
+		control_memory_request_t request;
+		answered = ControlProtocolDecodeMemoryRequest(protocol, frame, length, &request);
+		if( answered )
+			reply(arg, buffer, ControlProtocolEncodeMemoryData(protocol, buffer, &request, GetProtocolTime()));
+		break;
+	}
+	case CONTROL_FRAME_SCHEMA_REQUEST:
+	{
+		uint8_t first;
+		answered = ControlProtocolDecodeSchemaRequest(protocol, frame, length, &first);
+		if( answered )
+			reply(arg, buffer, ControlProtocolEncodeSchema(protocol, buffer, first, GetProtocolTime()));
+		break;
+	}
+	case CONTROL_FRAME_CALIBRATION_REQUEST:
+	{
+		uint8_t action;
+		answered = ControlProtocolDecodeCalibrationRequest(protocol, frame, length, &action);
+		if( !answered )
+			break;
+		reply(arg, buffer, ControlProtocolEncodeCalibrationData(protocol, buffer, GetProtocolTime()));
+		ApplyCalibrationAction(action);
+		break;
+	}
+	case CONTROL_FRAME_AUTOTUNE_REQUEST:
+	{
+		uint8_t action, loop;
+		answered = ControlProtocolDecodeAutotuneRequest(protocol, frame, length, &action, &loop);
+		if( !answered )
+			break;
+		reply(arg, buffer, ControlProtocolEncodeAutotuneData(protocol, buffer, GetProtocolTime()));
+		ApplyAutotuneAction(action, loop);
+		break;
+	}
+	case CONTROL_FRAME_EXCITATION_REQUEST:
+	{
+		uint8_t action;
+		excitation_config_t config;
+		answered = ControlProtocolDecodeExcitationRequest(protocol, frame, length, &action, &config);
+		if( !answered )
+			break;
+		reply(arg, buffer, ControlProtocolEncodeExcitationData(protocol, buffer, GetProtocolTime()));
+		ApplyExcitationAction(action, &config);
+		break;
+	}
+	case CONTROL_FRAME_PARAM_REQUEST:
+	{
+		control_param_request_t request;
+		answered = ControlProtocolDecodeParamRequest(protocol, frame, length, &request);
+		if( answered )
+			reply(arg, buffer, ApplyParamRequest(channel->ctx, protocol, &request, buffer));
+		break;
+	}
+	default:
+		//commands and subscriptions only come over Ethernet
+		answered = 0;
+		break;
+	}
+	UNLOCK_TCPIP_CORE();
+	return answered;
+}
+
+int EthernetSetParam(uint8_t id, param_value_t value)
+{
+	raw_udp_channel_t* channel = &raw_channel;
+	int result;
+
+	if( !__atomic_load_n(&channel->started, __ATOMIC_ACQUIRE) )
+		return -1;
+	LOCK_TCPIP_CORE();
+	param_set_t changed = channel->ctx->params;
+	result = ParamSetValue(&changed, id, value);
+	if( result == 0 )
+		ApplyParamSet(channel->ctx, &changed);
+	UNLOCK_TCPIP_CORE();
+	return result;
+}
+
+uint8_t EthernetTriggerTrace()
+{
+	raw_udp_channel_t* channel = &raw_channel;
+
+	if( !__atomic_load_n(&channel->started, __ATOMIC_ACQUIRE) )
+		return 0;
+	LOCK_TCPIP_CORE();
+	PIDTraceRequestTrigger(&channel->ctx->trace);
+	UNLOCK_TCPIP_CORE();
+	return 1;
+}
+
+#if ETHERNET_FAST_INPUT && LWIP_TCPIP_CORE_LOCKING_INPUT
+//netif input, runs in gmac_task for every received frame before lwIP sees it.
+//An unfragmented datagram without IP options to COMMAND_PORT on this
+//interface goes straight to raw_udp_receive under the core lock, after the
+//checks ip_input and udp_input would make. Everything else, and anything
+//unusual about a control datagram, takes the normal path through
+//tcpip_input.
+static err_t raw_udp_input(struct pbuf *p, struct netif *netif)
+{
+	//a pool pbuf always holds all three headers
+	const struct udp_hdr* udphdr = FindUdpHeader(p);
+	if( udphdr == NULL || udphdr->dest != PP_HTONS(COMMAND_PORT) )
+		return tcpip_input(p, netif);
+
+	struct ip_hdr* iphdr = (struct ip_hdr*)((uint8_t*)p->payload + SIZEOF_ETH_HDR);
+
+	ip_addr_t src, dest;
+	ip_addr_copy(src, iphdr->src);
+	ip_addr_copy(dest, iphdr->dest);
+	uint16_t ip_length = ntohs(IPH_LEN(iphdr));
+	uint16_t src_port = ntohs(udphdr->src);
+	if( !netif_is_up(netif) || !(ip_addr_cmp(&dest, &netif->ip_addr) || ip_addr_isbroadcast(&dest, netif)) ||
+		ip_length > p->tot_len - SIZEOF_ETH_HDR || ip_length < IP_HLEN + UDP_HLEN ||
+		ntohs(udphdr->len) != ip_length - IP_HLEN )
+		return tcpip_input(p, netif);
+#if CHECKSUM_CHECK_IP
+	//ip_input drops and counts it
+	if( inet_chksum(iphdr, IP_HLEN) != 0 )
+		return tcpip_input(p, netif);
+#endif
+
+	//short frames carry Ethernet padding past the datagram
+	pbuf_header(p, -(s16_t)SIZEOF_ETH_HDR);
+	pbuf_realloc(p, ip_length);
+	pbuf_header(p, -(s16_t)IP_HLEN);
+	IP_STATS_INC(ip.recv);
+#if CHECKSUM_CHECK_UDP
+	if( udphdr->chksum != 0 && inet_chksum_pseudo(p, &src, &dest, IP_PROTO_UDP, p->tot_len) != 0 )
+	{
+		UDP_STATS_INC(udp.chkerr);
+		UDP_STATS_INC(udp.drop);
+		pbuf_free(p);
+		return ERR_OK;
+	}
+#endif
+	pbuf_header(p, -(s16_t)UDP_HLEN);
+	UDP_STATS_INC(udp.recv);
+
+	LOCK_TCPIP_CORE();
+	raw_udp_receive(&raw_channel, raw_channel.pcb, p, &src, src_port);
+	UNLOCK_TCPIP_CORE();
+	return ERR_OK;
+}
+#endif
+
+#if ETHERNET_LINK_COMMANDS
+//Link handler (ethif_mac.h), runs in gmac_task for every frame of
+//ETHERNET_LINK_ETHERTYPE. Short frames carry Ethernet padding, the control
+//header's payload length gives where the frame ends. The arbiter gets the
+//sender's MAC as an address of its last four bytes and a port of its first
+//two.
+static void raw_link_input(struct pbuf *p, struct netif *netif)
+{
+	uint32_t rx_ptp_time = PtpTimeUs();
+	uint32_t profile_start = ProfilerStart();
+	const struct eth_hdr* ethhdr = (const struct eth_hdr*)p->payload;
+	uint8_t buffer[RX_FRAME_BUFFER_SIZE];
+	const uint8_t* frame = (const uint8_t*)p->payload + SIZEOF_ETH_HDR;
+	uint32_t length = p->tot_len - SIZEOF_ETH_HDR;
+
+	//a frame too long to gather is dropped and counted with the link's drops,
+	//the channel's counters are only touched under the core lock
+	if( p->len != p->tot_len && length <= sizeof(buffer) )
+	{
+		frame = buffer;
+		length = pbuf_copy_partial(p, buffer, sizeof(buffer), SIZEOF_ETH_HDR);
+	}
+
+	if( netif_is_up(netif) && length >= CONTROL_HEADER_SIZE && length <= sizeof(buffer) &&
+		memcmp(ethhdr->dest.addr, netif->hwaddr, ETHARP_HWADDR_LEN) == 0 )
+	{
+		uint32_t frame_length = CONTROL_HEADER_SIZE + (frame[2] | (frame[3] << 8)) + CONTROL_CRC_SIZE;
+		if( frame_length < length )
+			length = frame_length;
+		const uint8_t* src = ethhdr->src.addr;
+		uint32_t address = src[2] | (src[3] << 8) | (src[4] << 16) | ((uint32_t)src[5] << 24);
+
+		LOCK_TCPIP_CORE();
+		CacheMonitorBegin(CACHE_MONITOR_NETWORK);
+		raw_udp_command(&raw_channel, frame, length, address, src[0] | (src[1] << 8), rx_ptp_time);
+		CacheMonitorEnd(CACHE_MONITOR_NETWORK);
+		UNLOCK_TCPIP_CORE();
+	}
+	else
+		LINK_STATS_INC(link.drop);
+	pbuf_free(p);
+	ProfilerEnd(PROFILER_STAGE_ETH_RECEIVE, profile_start);
+}
+#endif
+
+static int8_t FindFreeTelemetryPbuf(struct pbuf* const* pbufs, int count)
+{
+	for(int i = 0; i < count; ++i)
+	{
+		if(pbufs[i] != NULL && pbufs[i]->ref == 1)
+			return i;
+	}
+	return -1;
+}
+
+#if ETHERNET_PINNED_FLOW && CONF_GMAC_TX_SCATTER_GATHER
+//Sends p on the flow to address:port, opening one in place of the flow used
+//least recently when there is none. Anything but ERR_OK leaves p to udp_sendto.
+static err_t SendOnFlow(raw_udp_channel_t* channel, struct pbuf* p, uint32_t address, uint16_t port, uint32_t now)
+{
+	int slot = 0;
+	for(int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS + 1; ++i)
+	{
+		if( UdpFlowMatches(&channel->flows[i], address, port) )
+		{
+			slot = i;
+			break;
+		}
+		if( now - channel->flow_opened[i] > now - channel->flow_opened[slot] || !channel->flows[i].open )
+			slot = i;
+	}
+
+	udp_flow_t* flow = &channel->flows[slot];
+	if( !UdpFlowMatches(flow, address, port) || now - channel->flow_opened[slot] >= ETHERNET_FLOW_REFRESH )
+	{
+		channel->flow_opened[slot] = now;
+		err_t err = UdpFlowOpen(flow, address, port, COMMAND_PORT);
+		if( err != ERR_OK )
+			return err;
+	}
+	return UdpFlowSend(flow, p);
+}
+#endif
+
+//Sends length bytes of frame, which starts in p where it was allocated
+static void SendTelemetry(raw_udp_channel_t* channel, struct pbuf* p, uint8_t* frame, uint16_t length,
+	ip_addr_t* address, uint16_t port, uint32_t now)
 {
-	ctx->steering_angle_commanded = (((float)inputs->steering_angle_commanded - (float)0x7FFF) /  (float)0x7FFF);
-	ctx->vehicle_speed_commanded = (float)inputs->vehicle_speed_commanded / (float)0xFFFF;
-	ctx->park_brake_commanded = (inputs->boolean_commands & 0x1) != 0;
-	ctx->reverse_commanded = (inputs->boolean_commands & 0x2) != 0;
-	ctx->autonomous_mode = (inputs->boolean_commands & 0x4) != 0;
-	ctx->override_pid = (inputs->boolean_commands & 0x8) != 0;
-	ctx->tele_operation_enabled = (inputs->boolean_commands & 0x10) != 0;
-	ctx->speed_p_gain_override = (float)inputs->speed_p_gain * 0.000001;
-	ctx->speed_i_gain_override = (float)inputs->speed_i_gain * 0.000001;
-	ctx->speed_d_gain_override = (float)inputs->speed_d_gain * 0.000001;
-	ctx->steer_p_gain_override = (float)inputs->steering_p_gain * 0.000001;
-	ctx->steer_i_gain_override = (float)inputs->steering_i_gain * 0.000001;
-	ctx->steer_d_gain_override = (float)inputs->steering_d_gain * 0.000001;
+	//udp_sendto leaves the headers it added in front of the frame
+	p->payload = frame;
+	p->len = p->tot_len = length;
+#if ETHERNET_PINNED_FLOW && CONF_GMAC_TX_SCATTER_GATHER
+	if( SendOnFlow(channel, p, address->addr, port, now) == ERR_OK )
+		return;
+#endif
+	udp_sendto(channel->pcb, p, address, port);
+}
+
+//Runs in the tcpip thread whenever the next telemetry frame is due.
+static void raw_udp_transmit(void *arg)
+{
+	raw_udp_channel_t* channel = (raw_udp_channel_t*)arg;
+	uint32_t profile_start = ProfilerStart();
+	CacheMonitorBegin(CACHE_MONITOR_NETWORK);
+	uint32_t now = GetProtocolTime();
+	int8_t i;
+
+	//never blocks on main_task, we always get the newest complete snapshot
+	TelemetryStreamBegin(&channel->stream, &channel->protocol, &channel->ctx->exchange, now);
+
+	//Whatever is still due when the pbufs run out goes out on the next pass.
+	ip_addr_t address;
+	uint16_t port;
+	while( (i = FindFreeTelemetryPbuf(channel->telemetry, TELEMETRY_PBUF_COUNT)) >= 0 )
+	{
+		uint16_t length = TelemetryStreamNext(&channel->stream, &channel->protocol, channel->telemetry_frame[i], &address.addr, &port);
+		if( length == 0 )
+			break;
+		SendTelemetry(channel, channel->telemetry[i], channel->telemetry_frame[i], length, &address, port, now);
+	}
+	while( (i = FindFreeTelemetryPbuf(channel->telemetry_batch, TELEMETRY_BATCH_PBUF_COUNT)) >= 0 )
+	{
+		uint16_t length = TelemetryStreamNextBatch(&channel->stream, &channel->protocol, channel->telemetry_batch_frame[i],
+			&address.addr, &port);
+		if( length == 0 )
+			break;
+		SendTelemetry(channel, channel->telemetry_batch[i], channel->telemetry_batch_frame[i], length, &address, port, now);
+	}
+	while( (i = FindFreeTelemetryPbuf(channel->telemetry_signal, TELEMETRY_SIGNAL_PBUF_COUNT)) >= 0 )
+	{
+		uint16_t length = TelemetryStreamNextSignals(&channel->stream, &channel->protocol, channel->telemetry_signal_frame[i],
+			&address.addr, &port);
+		if( length == 0 )
+			break;
+		SendTelemetry(channel, channel->telemetry_signal[i], channel->telemetry_signal_frame[i], length, &address, port, now);
+	}
+	CacheMonitorEnd(CACHE_MONITOR_NETWORK);
+	ProfilerEnd(PROFILER_STAGE_ETH_SEND, profile_start);
 
+	uint32_t wait = TelemetryStreamWaitTime(&channel->stream, GetProtocolTime());
+#if ETHERNET_CYCLE_ALIGNED_TX
+	channel->next_due = GetProtocolTime() + wait;
+	//due frames wait for the end of the next cycle
+	if( channel->cycle_end != NULL && wait < ETHERNET_CYCLE_TX_FALLBACK )
+		wait = ETHERNET_CYCLE_TX_FALLBACK;
+#endif
+	sys_timeout(wait, raw_udp_transmit, channel);
 }
-void encode_ethernet_outputs(EthernetOutputs* outputs, main_context_t* ctx)
+
+#if ETHERNET_CYCLE_ALIGNED_TX
+//Runs in the tcpip thread, posted by EthernetCycleEnd
+static void raw_udp_cycle_end(void *arg)
 {
-	outputs->steering_angle = ctx->steering_angle * 10;
-	outputs->vehicle_speed = ctx->vehicle_speed * 100;
-	outputs->boolean_states = 0;
-	outputs->boolean_states |= ctx->estop_in > 0;
-	outputs->speed_p_term = ctx->speed_controller.lastPTerm;
-	outputs->speed_i_term = ctx->speed_controller.lastITerm;
-	outputs->speed_d_term = ctx->speed_controller.lastDTerm;
-	outputs->steering_p_term = ctx->steering_controller.lastPTerm;
-	outputs->steering_i_term = ctx->steering_controller.lastITerm;
-	outputs->steering_d_term = ctx->steering_controller.lastDTerm;
+	raw_udp_channel_t* channel = (raw_udp_channel_t*)arg;
+	channel->cycle_end_pending = 0;
+	//still due, the next cycle end posts again
+	if( !TimeTriggerSlotOpen() )
+		return;
+	//raw_udp_transmit schedules the timer again itself
+	sys_untimeout(raw_udp_transmit, channel);
+	raw_udp_transmit(channel);
+}
+#endif
+
+void EthernetCycleEnd()
+{
+#if ETHERNET_CYCLE_ALIGNED_TX
+	raw_udp_channel_t* channel = &raw_channel;
+	if( channel->cycle_end == NULL || channel->cycle_end_pending ||
+		(int32_t)(GetProtocolTime() - channel->next_due) < 0 )
+		return;
+
+	channel->cycle_end_pending = 1;
+	//a full mbox only delays the frame to the next cycle end
+	if( tcpip_trycallback(channel->cycle_end) != ERR_OK )
+		channel->cycle_end_pending = 0;
+#endif
+}
+
+//lwIP timer, the tcpip thread's heartbeat. Under the core lock gmac_task
+//holding it too long stops it as well.
+static void raw_udp_heartbeat(void *arg)
+{
+	WatchdogHeartbeat(WATCHDOG_NETWORK);
+	sys_timeout(WATCHDOG_NETWORK_PERIOD, raw_udp_heartbeat, arg);
+}
+
+//Runs in the tcpip thread once, queued by ethernet_thread.
+static void raw_udp_start(void *arg)
+{
+	raw_udp_channel_t* channel = (raw_udp_channel_t*)arg;
+
+	channel->pcb = udp_new();
+	if(channel->pcb == NULL || udp_bind(channel->pcb, IP_ADDR_ANY, COMMAND_PORT) != ERR_OK)
+	{
+		LWIP_DEBUGF(LWIP_DBG_ON, ("Control channel bind error\n"));
+		return;
+	}
+	udp_recv(channel->pcb, raw_udp_receive, channel);
+
+	channel->param_pcb = udp_new();
+	if(channel->param_pcb == NULL || udp_bind(channel->param_pcb, IP_ADDR_ANY, PARAM_PORT) != ERR_OK)
+		LWIP_DEBUGF(LWIP_DBG_ON, ("Param channel bind error\n"));
+	else
+		udp_recv(channel->param_pcb, raw_udp_param_receive, channel);
+
+	channel->discovery_pcb = udp_new();
+	if(channel->discovery_pcb == NULL || udp_bind(channel->discovery_pcb, IP_ADDR_ANY, DISCOVERY_PORT) != ERR_OK)
+		LWIP_DEBUGF(LWIP_DBG_ON, ("Discovery channel bind error\n"));
+	else
+	{
+		udp_recv(channel->discovery_pcb, raw_udp_discovery_receive, channel);
+		raw_udp_announce(channel);
+	}
+
+	//allocated once with room for every header, then reused for every send
+	for(int i = 0; i < TELEMETRY_PBUF_COUNT; ++i)
+	{
+		channel->telemetry[i] = pbuf_alloc(PBUF_TRANSPORT, CONTROL_TELEMETRY_MAX_FRAME_SIZE, PBUF_RAM);
+		if(channel->telemetry[i] != NULL)
+			channel->telemetry_frame[i] = (uint8_t*)channel->telemetry[i]->payload;
+	}
+	for(int i = 0; i < TELEMETRY_BATCH_PBUF_COUNT; ++i)
+	{
+		channel->telemetry_batch[i] = pbuf_alloc(PBUF_TRANSPORT, CONTROL_TELEMETRY_BATCH_MAX_FRAME_SIZE, PBUF_RAM);
+		if(channel->telemetry_batch[i] != NULL)
+			channel->telemetry_batch_frame[i] = (uint8_t*)channel->telemetry_batch[i]->payload;
+	}
+	for(int i = 0; i < TELEMETRY_SIGNAL_PBUF_COUNT; ++i)
+	{
+		channel->telemetry_signal[i] = pbuf_alloc(PBUF_TRANSPORT, CONTROL_SIGNAL_DATA_MAX_FRAME_SIZE, PBUF_RAM);
+		if(channel->telemetry_signal[i] != NULL)
+			channel->telemetry_signal_frame[i] = (uint8_t*)channel->telemetry_signal[i]->payload;
+	}
+
+	TelemetryStreamInit(&channel->stream, ipaddr_addr(TELEMETRY_GROUP), TELEMETRY_PORT, GetProtocolTime());
+	raw_udp_transmit(channel);
+#if ETHERNET_CYCLE_ALIGNED_TX
+	//from here on the cycle ends drive telemetry
+	channel->cycle_end = tcpip_callbackmsg_new(raw_udp_cycle_end, channel);
+#endif
+
+#if ETHERNET_FAST_INPUT && LWIP_TCPIP_CORE_LOCKING_INPUT
+	//from here on gmac_task picks the control datagrams out itself
+	netif_default->input = raw_udp_input;
+#endif
+#if ETHERNET_LINK_COMMANDS
+	//and the command frames that come without IP
+	ethernetif_mac_set_link_handler(ETHERNET_LINK_ETHERTYPE, raw_link_input);
+#endif
+
+	DiagServerStart(channel->ctx);
+	BulkChannelStart(channel->ctx);
+	FirmwareUpdateStart(channel->ctx);
+	CanGatewayStart(channel->ctx);
+
+	__atomic_store_n(&channel->started, 1, __ATOMIC_RELEASE);
+	raw_udp_heartbeat(NULL);
+	//the control channel was the last thing to be set up
+	HeapMonitorEndBoot();
+#if LWIP_STATS
+	sys_timeout(LWIP_STATS_REPORT_PERIOD, LogNetworkStats, NULL);
+#endif
 }
 
 void ethernet_thread(void *p)
 {
 	main_context_t* ctx = (main_context_t*)p;
-	EthernetInputs eth_inputs;
-	EthernetOutputs eth_outputs;
-
-	memset(&eth_inputs, 0, sizeof(eth_inputs));
-	memset(&eth_outputs, 0, sizeof(eth_outputs));
 
 	InitializeLWIP();
 
-	struct sockaddr_in sa, ra;
-	int s_create, new_socket;
-	int socket_check;
-	int opt = 1;
-	int num_bytes_received = 0;
+	raw_channel.ctx = ctx;
+	ControlProtocolInit(&raw_channel.protocol);
+	CommandArbiterInit(&raw_channel.arbiter);
+	tcpip_callback(raw_udp_start, &raw_channel);
+
+	//everything from here on happens in the tcpip thread, or under its core
+	//lock in gmac_task for received frames
+	vTaskDelete(NULL);
+}
+#else
+//The service loop waits on one queue set for everything it does: the
+//receive mboxes of the control and the param netconn, and the send request
+//a cycle end gives when a telemetry frame is due. It wakes only when one
+//of them has something, nothing polls.
+#define ETHERNET_SERVICE_SET_LENGTH (2 * DEFAULT_UDP_RECVMBOX_SIZE + 1)
 
-	/*Create a socket*/
-	s_create = socket(AF_INET, SOCK_DGRAM, 0);
+static SemaphoreHandle_t ethernet_send_request;
+//protocol ms the next telemetry frame is due at
+static uint32_t ethernet_send_due;
 
-	setsockopt(s_create, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt));
+void EthernetCycleEnd()
+{
+#if ETHERNET_CYCLE_ALIGNED_TX
+	if( ethernet_send_request == NULL ||
+		(int32_t)(GetProtocolTime() - __atomic_load_n(&ethernet_send_due, __ATOMIC_RELAXED)) < 0 )
+		return;
+	//a request still pending stays the one
+	xSemaphoreGive(ethernet_send_request);
+#endif
+}
 
-	//Destination
-	memset(&ra, 0, sizeof(ra));
-	ra.sin_family 		= AF_INET;
-	ra.sin_addr.s_addr	= htonl(INADDR_BROADCAST);
-	ra.sin_port        	= htons(12089);
-	ra.sin_len			= sizeof(ra);
+//the service loop owns the control channel's set without the core lock
+uint8_t EthernetAnswerRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* buffer,
+	ethernet_reply_t reply, void* arg)
+{
+	return 0;
+}
 
-	//Source
-	memset(&sa, 0, sizeof(sa));
-	sa.sin_family		= AF_INET;
-	sa.sin_addr.s_addr	= htonl(INADDR_ANY);
-	sa.sin_port			= htons(12090);
-	sa.sin_len			= sizeof(sa);
+int EthernetSetParam(uint8_t id, param_value_t value)
+{
+	return -1;
+}
 
-	/* bind the connection to port */
-	socket_check = bind(s_create, (struct sockaddr *)&sa, sizeof(sa));
-	if (socket_check < 0) {
-		LWIP_DEBUGF(LWIP_DBG_ON, ("Bind error=%d\n", socket_check));
+uint8_t EthernetTriggerTrace()
+{
+	return 0;
+}
+
+//Takes the one datagram the set selected conn for and copies up to size
+//bytes of it into buffer. Bytes copied, 0 if there was none.
+static uint16_t ReceiveDatagram(control_protocol_t* protocol, struct netconn* conn, uint8_t* buffer, uint16_t size,
+	ip_addr_t* from, u16_t* port)
+{
+	struct netbuf* datagram;
+	if( netconn_recv(conn, &datagram) != ERR_OK )
+		return 0;
+	uint16_t length = 0;
+	//one longer than buffer is dropped whole, not cut short
+	if( netbuf_len(datagram) <= size )
+	{
+		*from = *netbuf_fromaddr(datagram);
+		*port = netbuf_fromport(datagram);
+		length = netbuf_copy(datagram, buffer, size);
+	}
+	else
+		protocol->rx_invalid++;
+	netbuf_delete(datagram);
+	return length;
+}
+
+//Sends length bytes of frame by reference, as lwip_sendto does. With
+//LWIP_TCPIP_CORE_LOCKING the stack runs right here.
+static void SendDatagram(struct netconn* conn, const uint8_t* frame, uint16_t length, ip_addr_t* to, u16_t port)
+{
+	struct netbuf datagram;
+	memset(&datagram, 0, sizeof(datagram));
+	if( netbuf_ref(&datagram, frame, length) == ERR_OK )
+		netconn_sendto(conn, &datagram, to, port);
+	netbuf_free(&datagram);
+}
+
+void ethernet_thread(void *p)
+{
+	main_context_t* ctx = (main_context_t*)p;
+	control_protocol_t protocol;
+	command_arbiter_t arbiter;
+	//static, the batch samples make it too big for the stack
+	static telemetry_stream_t stream;
+	uint8_t telemetry_frame[CONTROL_TELEMETRY_MAX_FRAME_SIZE];
+	static uint8_t telemetry_batch_frame[CONTROL_TELEMETRY_BATCH_MAX_FRAME_SIZE];
+	static uint8_t signal_frame[CONTROL_SIGNAL_DATA_MAX_FRAME_SIZE];
+
+	ControlProtocolInit(&protocol);
+	CommandArbiterInit(&arbiter);
+	TelemetryStreamInit(&stream, inet_addr(TELEMETRY_GROUP), TELEMETRY_PORT, GetProtocolTime());
+
+	InitializeLWIP();
+
+	int num_bytes_received = 0;
+	QueueSetHandle_t set = xQueueCreateSet(ETHERNET_SERVICE_SET_LENGTH);
+	ethernet_send_request = xSemaphoreCreateBinary();
+	struct netconn* control = netconn_new(NETCONN_UDP);
+	struct netconn* param = netconn_new(NETCONN_UDP);
+	//members join while they are empty, before the ports are bound
+	if( set == NULL || ethernet_send_request == NULL || control == NULL || param == NULL ||
+		xQueueAddToSet(control->recvmbox, set) != pdPASS || xQueueAddToSet(param->recvmbox, set) != pdPASS ||
+		xQueueAddToSet(ethernet_send_request, set) != pdPASS )
+	{
+		LWIP_DEBUGF(LWIP_DBG_ON, ("Service set error\n"));
+		return;
+	}
+
+	if( netconn_bind(control, IP_ADDR_ANY, COMMAND_PORT) != ERR_OK )
+	{
+		LWIP_DEBUGF(LWIP_DBG_ON, ("Bind error\n"));
+		return;
+	}
+	if( netconn_bind(param, IP_ADDR_ANY, PARAM_PORT) != ERR_OK )
+	{
+		LWIP_DEBUGF(LWIP_DBG_ON, ("Param bind error\n"));
 		return;
 	}
+	tcpip_callback(DiagServerStart, ctx);
+	tcpip_callback(BulkChannelStart, ctx);
+	tcpip_callback(FirmwareUpdateStart, ctx);
+	tcpip_callback(CanGatewayStart, ctx);
+	HeapMonitorEndBoot();
+#if LWIP_STATS
+	tcpip_timeout(LWIP_STATS_REPORT_PERIOD, LogNetworkStats, NULL);
+#endif
 
-    uint8_t buffer[64];
+	uint8_t buffer[RX_FRAME_BUFFER_SIZE];
+	static uint8_t param_buffer[CONTROL_PARAM_REQUEST_MAX_FRAME_SIZE];
+	ip_addr_t to;
+	ip_addr_t from;
+	u16_t from_port;
+	static uint8_t trace_frame[CONTROL_TRACE_MAX_FRAME_SIZE];
+	static uint8_t profile_frame[CONTROL_PROFILE_MAX_FRAME_SIZE];
+	static uint8_t task_frame[CONTROL_TASK_MAX_FRAME_SIZE];
+	static uint8_t event_frame[CONTROL_EVENT_MAX_FRAME_SIZE];
+	static uint8_t param_frame[CONTROL_PARAM_MAX_FRAME_SIZE];
+	static uint8_t boot_frame[CONTROL_BOOT_MAX_FRAME_SIZE];
+	static uint8_t memory_frame[CONTROL_MEMORY_MAX_FRAME_SIZE];
+	static uint8_t schema_frame[CONTROL_SCHEMA_MAX_FRAME_SIZE];
+	static uint8_t calibration_frame[CONTROL_CALIBRATION_MAX_FRAME_SIZE];
+	static uint8_t autotune_frame[CONTROL_AUTOTUNE_FRAME_SIZE];
+	static uint8_t excitation_frame[CONTROL_EXCITATION_FRAME_SIZE];
 	while(1)
 	{
-		if( xSemaphoreTake(ctx->sem, 100) != pdTRUE)
+		WatchdogHeartbeat(WATCHDOG_NETWORK);
+		//never blocks on main_task, we always get the newest complete snapshot
+		uint32_t profile_start = ProfilerStart();
+		CacheMonitorBegin(CACHE_MONITOR_NETWORK);
+		TelemetryStreamBegin(&stream, &protocol, &ctx->exchange, GetProtocolTime());
+		uint16_t length;
+		uint32_t address;
+		uint16_t port;
+		while( (length = TelemetryStreamNext(&stream, &protocol, telemetry_frame, &address, &port)) != 0 )
+		{
+			to.addr = address;
+			SendDatagram(control, telemetry_frame, length, &to, port);
+		}
+		while( (length = TelemetryStreamNextBatch(&stream, &protocol, telemetry_batch_frame, &address, &port)) != 0 )
 		{
-			vTaskDelay(1);
-			continue;
+			to.addr = address;
+			SendDatagram(control, telemetry_batch_frame, length, &to, port);
 		}
+		while( (length = TelemetryStreamNextSignals(&stream, &protocol, signal_frame, &address, &port)) != 0 )
+		{
+			to.addr = address;
+			SendDatagram(control, signal_frame, length, &to, port);
+		}
+		CacheMonitorEnd(CACHE_MONITOR_NETWORK);
+		ProfilerEnd(PROFILER_STAGE_ETH_SEND, profile_start);
 
-		encode_ethernet_outputs(&eth_outputs, ctx);
+		//Sleep until a datagram arrives, a cycle end asks for the due frames
+		//or the next one is due, so a command is published as soon as it is
+		//received.
+		uint32_t wait_ms = TelemetryStreamWaitTime(&stream, GetProtocolTime());
+#if ETHERNET_CYCLE_ALIGNED_TX
+		__atomic_store_n(&ethernet_send_due, GetProtocolTime() + wait_ms, __ATOMIC_RELAXED);
+		//due frames wait for the end of the next cycle
+		if( wait_ms < ETHERNET_CYCLE_TX_FALLBACK )
+			wait_ms = ETHERNET_CYCLE_TX_FALLBACK;
+#endif
+		QueueSetMemberHandle_t member = xQueueSelectFromSet(set, pdMS_TO_TICKS(wait_ms));
 
-		num_bytes_received = sendto(s_create, &eth_outputs, sizeof(eth_outputs), 0, &ra, sizeof(ra));
-	
-		num_bytes_received = recv(s_create, &buffer, sizeof(buffer), MSG_DONTWAIT);
-		
-		if(num_bytes_received > 0)
+		//Take everything that queued up before the next send, one datagram
+		//or request per selection as the set hands them out, in the order
+		//they came. Every accepted command is published at its level, the
+		//newest one at each level wins.
+		for( ; member != NULL; member = xQueueSelectFromSet(set, 0) )
 		{
-			memcpy(&eth_inputs.boolean_commands, buffer, num_bytes_received);
-			ctx->last_eth_input_rx_time = xTaskGetTickCount();
-			decode_ethernet_inputs(&eth_inputs, ctx);
-		}
+			if( member == ethernet_send_request )
+			{
+				xSemaphoreTake(ethernet_send_request, 0);
+				continue;
+			}
+			if( member == param->recvmbox )
+			{
+				control_param_request_t param_request;
+				num_bytes_received = ReceiveDatagram(&protocol, param, param_buffer, sizeof(param_buffer), &from, &from_port);
+				if( num_bytes_received > 0 &&
+					ControlProtocolDecodeParamRequest(&protocol, param_buffer, num_bytes_received, &param_request) )
+				{
+					uint16_t param_length = ApplyParamRequest(ctx, &protocol, &param_request, param_frame);
+					SendDatagram(param, param_frame, param_length, &from, from_port);
+				}
+				continue;
+			}
+			num_bytes_received = ReceiveDatagram(&protocol, control, buffer, sizeof(buffer), &from, &from_port);
+			if( num_bytes_received == 0 )
+				continue;
 
-		xSemaphoreGive(ctx->sem);
-		vTaskDelay(TRANSMIT_INTERVAL);
+			//when the loop got to it, the time in the mailbox included
+			uint32_t rx_ptp_time = PtpTimeUs();
+			profile_start = ProfilerStart();
+			CacheMonitorBegin(CACHE_MONITOR_NETWORK);
+			control_subscription_t subscription;
+			control_trace_request_t request;
+			uint8_t action;
+			uint32_t first_event;
+			switch( ControlProtocolFrameType(buffer, num_bytes_received) )
+			{
+			case CONTROL_FRAME_SUBSCRIBE:
+				if( ControlProtocolDecodeSubscribe(&protocol, buffer, num_bytes_received, &subscription) )
+					TelemetryStreamSubscribe(&stream, &subscription, from.addr, from_port, GetProtocolTime());
+				break;
+			case CONTROL_FRAME_SIGNAL_SUBSCRIBE:
+			{
+				control_signal_subscription_t signal_subscription;
+				if( ControlProtocolDecodeSignalSubscribe(&protocol, buffer, num_bytes_received, &signal_subscription) )
+					TelemetryStreamSubscribeSignals(&stream, &signal_subscription, from.addr, from_port,
+						GetProtocolTime());
+				break;
+			}
+			case CONTROL_FRAME_SCHEMA_REQUEST:
+			{
+				uint8_t first_signal;
+				if( ControlProtocolDecodeSchemaRequest(&protocol, buffer, num_bytes_received, &first_signal) )
+				{
+					uint16_t schema_length = ControlProtocolEncodeSchema(&protocol, schema_frame, first_signal, GetProtocolTime());
+					SendDatagram(control, schema_frame, schema_length, &from, from_port);
+				}
+				break;
+			}
+			case CONTROL_FRAME_TRACE_REQUEST:
+				if( ControlProtocolDecodeTraceRequest(&protocol, buffer, num_bytes_received, &request) )
+				{
+					uint8_t frames = ApplyTraceRequest(&ctx->trace, &request);
+					uint16_t first = request.first;
+					for(uint8_t f = 0; f < frames; ++f)
+					{
+						uint16_t samples;
+						uint16_t trace_length = ControlProtocolEncodeTraceData(&protocol, trace_frame, &ctx->trace, first, &samples, GetProtocolTime());
+						SendDatagram(control, trace_frame, trace_length, &from, from_port);
+						first += samples;
+						if( samples < CONTROL_TRACE_SAMPLES_PER_FRAME )
+							break;
+					}
+				}
+				break;
+			case CONTROL_FRAME_PROFILE_REQUEST:
+				if( ControlProtocolDecodeProfileRequest(&protocol, buffer, num_bytes_received, &action) )
+				{
+					control_load_stats_t load;
+					ReadLoadStats(ctx, &load);
+					uint16_t profile_length = ControlProtocolEncodeProfileData(&protocol, profile_frame, configCPU_CLOCK_HZ, &load,
+						GetProtocolTime());
+					SendDatagram(control, profile_frame, profile_length, &from, from_port);
+					if( action == CONTROL_PROFILE_RESET )
+					{
+						ProfilerRequestReset();
+						CacheMonitorRequestReset();
+						NetLatencyRequestReset();
+					}
+				}
+				break;
+			case CONTROL_FRAME_TASK_REQUEST:
+				if( ControlProtocolDecodeTaskRequest(&protocol, buffer, num_bytes_received) )
+				{
+					uint16_t task_length = ControlProtocolEncodeTaskData(&protocol, task_frame, GetProtocolTime());
+					SendDatagram(control, task_frame, task_length, &from, from_port);
+				}
+				break;
+			case CONTROL_FRAME_EVENT_REQUEST:
+				if( ControlProtocolDecodeEventRequest(&protocol, buffer, num_bytes_received, &first_event) )
+				{
+					uint16_t event_length = ControlProtocolEncodeEventData(&protocol, event_frame, first_event, GetProtocolTime());
+					SendDatagram(control, event_frame, event_length, &from, from_port);
+				}
+				break;
+			case CONTROL_FRAME_BOOT_REQUEST:
+				if( ControlProtocolDecodeBootRequest(&protocol, buffer, num_bytes_received) )
+				{
+					uint16_t boot_length = ControlProtocolEncodeBootData(&protocol, boot_frame, GetProtocolTime());
+					SendDatagram(control, boot_frame, boot_length, &from, from_port);
+				}
+				break;
+			case CONTROL_FRAME_MEMORY_REQUEST:
+			{
+				control_memory_request_t memory_request;
+				if( ControlProtocolDecodeMemoryRequest(&protocol, buffer, num_bytes_received, &memory_request) )
+				{
+					uint16_t memory_length = ControlProtocolEncodeMemoryData(&protocol, memory_frame, &memory_request,
+						GetProtocolTime());
+					SendDatagram(control, memory_frame, memory_length, &from, from_port);
+				}
+				break;
+			}
+			case CONTROL_FRAME_CALIBRATION_REQUEST:
+			{
+				uint8_t calibration_action;
+				if( ControlProtocolDecodeCalibrationRequest(&protocol, buffer, num_bytes_received, &calibration_action) )
+				{
+					uint16_t calibration_length = ControlProtocolEncodeCalibrationData(&protocol, calibration_frame,
+						GetProtocolTime());
+					SendDatagram(control, calibration_frame, calibration_length, &from, from_port);
+					ApplyCalibrationAction(calibration_action);
+				}
+				break;
+			}
+			case CONTROL_FRAME_AUTOTUNE_REQUEST:
+			{
+				uint8_t autotune_action, autotune_loop;
+				if( ControlProtocolDecodeAutotuneRequest(&protocol, buffer, num_bytes_received, &autotune_action,
+					&autotune_loop) )
+				{
+					uint16_t autotune_length = ControlProtocolEncodeAutotuneData(&protocol, autotune_frame,
+						GetProtocolTime());
+					SendDatagram(control, autotune_frame, autotune_length, &from, from_port);
+					ApplyAutotuneAction(autotune_action, autotune_loop);
+				}
+				break;
+			}
+			case CONTROL_FRAME_EXCITATION_REQUEST:
+			{
+				uint8_t excitation_action;
+				excitation_config_t excitation_config;
+				if( ControlProtocolDecodeExcitationRequest(&protocol, buffer, num_bytes_received, &excitation_action,
+					&excitation_config) )
+				{
+					uint16_t excitation_length = ControlProtocolEncodeExcitationData(&protocol, excitation_frame,
+						GetProtocolTime());
+					SendDatagram(control, excitation_frame, excitation_length, &from, from_port);
+					ApplyExcitationAction(excitation_action, &excitation_config);
+				}
+				break;
+			}
+			default:
+			{
+				control_command_info_t info;
+				uint32_t now = xTaskGetTickCount();
+				if( ControlProtocolCheckCommand(&protocol, buffer, num_bytes_received, &info)
+					&& CommandArbiterAccept(&arbiter, from.addr, from_port, &info, now) )
+				{
+					control_command_t* command = BeginCommandWrite(&ctx->exchange, info.priority);
+					ControlProtocolDecodeCommand(&protocol, buffer, &info, now, command);
+					NetLatencyReceived(&command->latency);
+					LatencyProbeReceived(&command->probe);
+					protocol.rx_ptp_time = rx_ptp_time;
+					PublishCommand(&ctx->exchange, info.priority);
+					BootProfileMark(BOOT_STAGE_FIRST_COMMAND);
+				}
+				break;
+			}
+			}
+			CacheMonitorEnd(CACHE_MONITOR_NETWORK);
+			ProfilerEnd(PROFILER_STAGE_ETH_RECEIVE, profile_start);
+		}
 	}
-}
\ No newline at end of file
+}
+#endif
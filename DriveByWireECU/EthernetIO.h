@@ -7,65 +7,150 @@
  #ifndef ETHERNETIO_H_
  #define ETHERNETIO_H_
 
- #include "stdint.h"
-
- //!!!WARNING!!! 
-//If you add members to this struct you MUST update the transmitting 
-//software with the new structure definition. 
-// DONT USE ANYTHING SMALLER THAN uint16_t
-typedef struct EthernetInputs_t
-{
-	//Decoding:
-	//	0x1:	parking_brake_commanded
-	//	0x2:	reverse_commanded
-	//	0x4:	autonomous mode
-	//	0x8:	override_pid
-	//  0x10:	tele_operation_mode
-	uint16_t boolean_commands;
-	
-	//Decoding: RAW * 0.01 (m/s)
-	uint16_t vehicle_speed_commanded;
-	
-	//Decoding: RAW * 0.1 (degrees)
-	uint16_t steering_angle_commanded;
-
-	//Decoding: RAW * 0.000001
-	//Range: ~ 0.000001 - 1000
-	uint32_t speed_p_gain;
-	uint32_t speed_i_gain;
-	uint32_t speed_d_gain;
-	uint32_t steering_p_gain;
-	uint32_t steering_i_gain;
-	uint32_t steering_d_gain;
-	
-	//total size should be 
-} EthernetInputs;
-
-//!!!WARNING!!! 
-//If you add members to this struct you MUST update the receiving 
-//software with the new structure definition. 
-typedef struct EthernetOutputs_t
-{
-	//Encoding: value / 0.01 (m/s)
-	uint16_t vehicle_speed;
-	
-	//Encoding: value / 0.1 (degrees)
-	uint16_t steering_angle;	
-
-	//Decoding:
-	//	0x1:	estop_state
-	uint8_t boolean_states;
-
-	//Decoding: value / 0.00001 (percent)
-	uint32_t speed_p_term;
-	uint32_t speed_i_term;
-	uint32_t speed_d_term;
-	uint32_t steering_p_term;
-	uint32_t steering_i_term;
-	uint32_t steering_d_term;
-
-} EthernetOutputs;
+#include <stdint.h>
+#include "ControlProtocol.h"
 
+//The frames exchanged with the driving PC are defined in ControlProtocol.h
+
+//Non zero runs the control protocol on a raw udp_pcb inside the tcpip thread:
+//commands are decoded straight from the receive callback and telemetry is
+//sent from a tcpip timer, with no socket, netconn or mbox round trip.
+//0 falls back to a service loop in ethernet_thread on netconns, where
+//LWIP_TCPIP_CORE_LOCKING lets a send run the stack directly. It blocks on
+//one FreeRTOS queue set holding the receive mboxes of the command and the
+//param port and the send request of a cycle end, and wakes only when one of
+//them has work.
+#ifndef ETHERNET_RAW_UDP
+#define ETHERNET_RAW_UDP 1
+#endif
+
+//Non zero lets gmac_task hand datagrams for the control channel straight to
+//it, skipping ethernet_input, ip_input and udp_input. Needs ETHERNET_RAW_UDP
+//and LWIP_TCPIP_CORE_LOCKING_INPUT, without them every frame goes through
+//tcpip_input.
+#ifndef ETHERNET_FAST_INPUT
+#define ETHERNET_FAST_INPUT 1
+#endif
+
+//Non zero has gmac_task hand control datagrams to lwIP ahead of the other
+//frames waiting in the receive ring (CONF_GMAC_RX_PRIORITY) and drop the
+//broadcasts the ECU does not use before they reach lwIP.
+#ifndef ETHERNET_CONTROL_PRIORITY
+#define ETHERNET_CONTROL_PRIORITY 1
+#endif
+
+//Non zero sends telemetry on pinned flows (UdpFlow.h) with prebuilt headers
+//instead of through udp_sendto. A destination whose MAC is not known yet
+//goes through udp_sendto until it is. Needs ETHERNET_RAW_UDP and
+//CONF_GMAC_TX_SCATTER_GATHER.
+#ifndef ETHERNET_PINNED_FLOW
+#define ETHERNET_PINNED_FLOW 1
+#endif
+//ms after which a flow is opened again, so a peer's changed ARP entry is
+//picked up
+#ifndef ETHERNET_FLOW_REFRESH
+#define ETHERNET_FLOW_REFRESH 1000
+#endif
+
+//Non zero sends telemetry right behind the control cycle that produced it.
+//main_task hands the tcpip thread a pass at the end of a cycle, when a frame
+//is due, and it goes out with that cycle's snapshot while main_task waits
+//for the next release. The values sent are then at most one cycle old, and
+//a due frame waits at most one cycle for them. Without ETHERNET_RAW_UDP the
+//cycle end gives the service loop's send request instead.
+#ifndef ETHERNET_CYCLE_ALIGNED_TX
+#define ETHERNET_CYCLE_ALIGNED_TX 1
+#endif
+//ms between passes that come from the timer instead, while main_task does
+//not end cycles
+#ifndef ETHERNET_CYCLE_TX_FALLBACK
+#define ETHERNET_CYCLE_TX_FALLBACK 50
+#endif
+
+//Non zero also takes commands in raw Ethernet frames of
+//ETHERNET_LINK_ETHERTYPE, for a PC cabled straight to the ECU. The frame
+//carries the command or trajectory frame the control channel takes on
+//COMMAND_PORT right behind the Ethernet header. gmac_task hands it to the
+//command set under the core lock as soon as it comes off the ring, without
+//ARP, IP, UDP or their checksums. Only frames to the ECU's own MAC count,
+//and the arbiter knows the sender by its MAC. Subscriptions, requests and
+//telemetry stay on IP. Needs ETHERNET_RAW_UDP and LWIP_TCPIP_CORE_LOCKING.
+#ifndef ETHERNET_LINK_COMMANDS
+#define ETHERNET_LINK_COMMANDS 0
+#endif
+//IEEE 802 local experimental EtherType 1
+#ifndef ETHERNET_LINK_ETHERTYPE
+#define ETHERNET_LINK_ETHERTYPE 0x88B5
+#endif
+
+//Address of the autonomy PC, where the node parameters do not store one
+//(NodeIdentity.h). With its MAC stored or ETHERNET_PC_MAC defined, as six
+//comma separated bytes, the PC gets a static ARP entry at boot: replies and
+//telemetry to it never wait on address resolution and the entry never ages
+//out. Without it the PC is resolved through ARP like any other host.
+#ifndef ETHERNET_PC_IP
+#define ETHERNET_PC_IP "192.168.2.1"
+#endif
+//#define ETHERNET_PC_MAC 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+//ms between the announce frames each node sends to the telemetry group on
+//the discovery port (ControlProtocol.h). Only with ETHERNET_RAW_UDP.
+#ifndef ETHERNET_ANNOUNCE_PERIOD
+#define ETHERNET_ANNOUNCE_PERIOD 5000
+#endif
+
+//Adds the static ARP entries, if any. In the tcpip thread or with the core
+//locked.
+void EthernetAddStaticPeers();
+
+//Asks the PC for its address on a link that just came up, after lwIP was
+//told. The PC learns ours from it before it sends its first command. In
+//the tcpip thread.
+void EthernetLinkUp(struct netif* netif);
+
+//End of a control cycle, from main_task once its telemetry snapshot is
+//published. Never blocks.
+void EthernetCycleEnd();
+
+#define ETHERNET_MAX(a, b) ((a) > (b) ? (a) : (b))
+//Largest frame EthernetAnswerRequest writes
+#define ETHERNET_ANSWER_MAX_FRAME_SIZE ETHERNET_MAX(ETHERNET_MAX(ETHERNET_MAX(CONTROL_TRACE_MAX_FRAME_SIZE, \
+	CONTROL_PROFILE_MAX_FRAME_SIZE), ETHERNET_MAX(CONTROL_TASK_MAX_FRAME_SIZE, CONTROL_EVENT_MAX_FRAME_SIZE)), \
+	ETHERNET_MAX(ETHERNET_MAX(CONTROL_PARAM_MAX_FRAME_SIZE, CONTROL_BOOT_MAX_FRAME_SIZE), \
+	ETHERNET_MAX(ETHERNET_MAX(CONTROL_MEMORY_MAX_FRAME_SIZE, CONTROL_SCHEMA_MAX_FRAME_SIZE), \
+	ETHERNET_MAX(CONTROL_CALIBRATION_MAX_FRAME_SIZE, ETHERNET_MAX(CONTROL_AUTOTUNE_FRAME_SIZE, \
+	CONTROL_EXCITATION_FRAME_SIZE)))))
+
+//Gets every frame of an answer in turn, length bytes of it in frame
+typedef void (*ethernet_reply_t)(void* arg, const uint8_t* frame, uint16_t length);
+
+//Answers a trace, profile, task, event, boot, param, memory, schema,
+//calibration, autotune or excitation request that came over another link
+//than Ethernet, as the control channel would, with protocol the other
+//link's state. The answer is written a frame at a time into buffer, which
+//holds ETHERNET_ANSWER_MAX_FRAME_SIZE bytes, and handed to reply. Commands
+//and subscriptions are left to the control channel.
+//
+//Takes the core lock, the control channel's set and the trace stay with
+//the tcpip thread. reply runs under it and must not block. Non-zero if
+//frame was a request and got its answer, 0 for anything else and until
+//the control channel is up. Only with ETHERNET_RAW_UDP.
+uint8_t EthernetAnswerRequest(control_protocol_t* protocol, const uint8_t* frame, uint32_t length, uint8_t* buffer,
+	ethernet_reply_t reply, void* arg);
+
+//Sets one parameter of the control channel's set and hands the set to
+//main_task, as a param set request of one entry would. Returns 0, or -1 if
+//ParamSetValue rejected it or the control channel is not up. Takes the core
+//lock, from a task. Only with ETHERNET_RAW_UDP.
+int EthernetSetParam(uint8_t id, param_value_t value);
+
+//Triggers the PID trace as a trace trigger request would. 0 until the
+//control channel is up. Takes the core lock, from a task. Only with
+//ETHERNET_RAW_UDP.
+uint8_t EthernetTriggerTrace();
+
+//Starts the control channel. With ETHERNET_RAW_UDP the task only brings up
+//lwIP and hands the channel to the tcpip thread, then deletes itself.
 void ethernet_thread(void *p);
 
 #endif /* ETHERNETIO_H_ */
\ No newline at end of file
@@ -0,0 +1,98 @@
+/*
+ * EventLog.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hri_rstc_e54.h>
+#include "EventLog.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define EVENT_LOG_MASK (EVENT_LOG_DEPTH - 1)
+//changes with the layout, a log of another layout is started over
+#define EVENT_LOG_MAGIC ((uint32_t)(0x45564C00UL | sizeof(event_log_entry_t)))
+
+#if (EVENT_LOG_DEPTH & EVENT_LOG_MASK) != 0
+#error EVENT_LOG_DEPTH must be a power of two
+#endif
+
+typedef struct event_log_t
+{
+	uint32_t magic;
+	//complements magic, so a cleared or random RAM is not taken for a log
+	uint32_t check;
+	uint32_t boot_count;
+	//sequence number the next entry gets, numbering starts at 1
+	uint32_t next;
+	event_log_entry_t entries[EVENT_LOG_DEPTH];
+} event_log_t;
+
+static event_log_t event_log __attribute__((section(".noinit")));
+
+void EventLogInit()
+{
+	uint16_t lost = 0;
+
+	if( event_log.magic != EVENT_LOG_MAGIC || event_log.check != (uint32_t)~EVENT_LOG_MAGIC )
+	{
+		memset(&event_log, 0, sizeof(event_log));
+		event_log.next = 1;
+		event_log.magic = EVENT_LOG_MAGIC;
+		event_log.check = (uint32_t)~EVENT_LOG_MAGIC;
+	}
+	else
+	{
+		//entries the reset caught half written can not be trusted
+		for(int i = 0; i < EVENT_LOG_DEPTH; ++i)
+		{
+			event_log_entry_t* entry = &event_log.entries[i];
+			if( entry->sequence != 0 && ((entry->sequence - 1) & EVENT_LOG_MASK) != (uint32_t)i )
+			{
+				entry->sequence = 0;
+				lost++;
+			}
+		}
+	}
+
+	event_log.boot_count++;
+	EventLogWrite(EVENT_LOG_BOOT, lost, hri_rstc_read_RCAUSE_reg(RSTC));
+}
+
+void EventLogWrite(event_log_id_t id, uint16_t arg, uint32_t value)
+{
+	uint32_t sequence = __atomic_fetch_add(&event_log.next, 1, __ATOMIC_RELAXED);
+	event_log_entry_t* entry = &event_log.entries[(sequence - 1) & EVENT_LOG_MASK];
+
+	__atomic_store_n(&entry->sequence, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	//only reads the tick count, fine from tasks too
+	entry->tick = xTaskGetTickCountFromISR();
+	entry->id = id;
+	entry->arg = arg;
+	entry->value = value;
+	__atomic_store_n(&entry->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+uint32_t EventLogNext()
+{
+	return __atomic_load_n(&event_log.next, __ATOMIC_RELAXED);
+}
+
+uint8_t EventLogRead(uint32_t sequence, event_log_entry_t* entry)
+{
+	const event_log_entry_t* slot = &event_log.entries[(sequence - 1) & EVENT_LOG_MASK];
+
+	if( sequence == 0 || __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != sequence )
+		return 0;
+
+	*entry = *slot;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+uint32_t EventLogBootCount()
+{
+	return event_log.boot_count;
+}
@@ -0,0 +1,125 @@
+/*
+ * EventLog.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+#include <stdint.h>
+
+//Flight recorder of what the ECU did, kept in RAM across warm resets.
+//Every event is a fixed size binary entry in a ring in the .noinit
+//section, which the startup code leaves alone, so after a watchdog, a
+//software or an external reset the events leading up to it are still
+//there. Only a power cycle or brown-out clears the log.
+//
+//Writing an entry is a handful of stores and never blocks, from any task
+//or interrupt. Every entry has a sequence number that keeps counting
+//across resets, the newest EVENT_LOG_DEPTH are kept. The control channel
+//reads them out with the event request (ControlProtocol.h).
+//
+//To add an event, add its id here with what arg and value hold.
+typedef enum event_log_id_t
+{
+	//arg: events lost with the previous log, value: RSTC RCAUSE
+	EVENT_LOG_BOOT = 1,
+	//arg: new estop input state. value: PTP us the estop interrupt saw the
+	//press at, 0 if the clock was not synced or on a release
+	EVENT_LOG_ESTOP,
+	//arg: vehicle_mode_t entered, the one left in the high byte. value: ms
+	//spent in the one left
+	EVENT_LOG_MODE,
+	//arg: deadline_id_t that expired, value: ms since its last event
+	EVENT_LOG_DEADLINE,
+	//arg: us the cycle ran late, value: overruns so far
+	EVENT_LOG_OVERRUN,
+	//arg: EVENT_LOG_PARAMS_*, value: sequence number of the save
+	EVENT_LOG_PARAMS,
+	//arg: EVENT_LOG_LINK_* of the Ethernet link, 0 down. value: drops since
+	//boot (PhyMonitor.h)
+	EVENT_LOG_LINK,
+	//arg: RamEcc.h region of an uncorrectable RAM error, value: address
+	//of the 64-bit word
+	EVENT_LOG_RAM_ECC,
+	//arg: bit n set for every watchdog_task_t found dead, 0 if the tick
+	//stopped instead. value: ms since the oldest of their heartbeats
+	//(Watchdog.h)
+	EVENT_LOG_WATCHDOG,
+	//arg: number of the task that overflowed its stack, value: the first 4
+	//characters of its name, the first in the low byte (TaskMonitor.h)
+	EVENT_LOG_STACK_OVERFLOW,
+	//arg: EVENT_LOG_FIRMWARE_*, value: CRC of the image, or what failed
+	//(FirmwareUpdate.h)
+	EVENT_LOG_FIRMWARE,
+	//arg: the redundancy_role_t taken, value: node id of the peer
+	//(Redundancy.h)
+	EVENT_LOG_REDUNDANCY,
+	//arg: steering_sweep_result_t, value: ms the sweep ran
+	//(SteeringSweep.h)
+	EVENT_LOG_CALIBRATION,
+	//arg: pid_autotune_result_t, the pid_autotune_loop_t in the high byte.
+	//value: ms the tune ran (PIDAutotune.h)
+	EVENT_LOG_AUTOTUNE,
+	//arg: excitation_result_t, the excitation_output_t in the high byte.
+	//value: ms the run took (Excitation.h)
+	EVENT_LOG_EXCITATION,
+	//arg: the ACTUATOR_FAULT_* raised, value: the residual of the window
+	//that raised it, thousandths (ActuatorFault.h)
+	EVENT_LOG_ACTUATOR_FAULT,
+	//arg: the SELF_TEST_* that failed, value: ms after the scheduler started
+	//that the last test finished (SelfTest.h)
+	EVENT_LOG_SELF_TEST,
+	//arg: integrity_region_t found changed, or EVENT_LOG_INTEGRITY_PASS_FAILED.
+	//value: first word of its new SHA-256, or the ICM status
+	//(IntegrityMonitor.h)
+	EVENT_LOG_INTEGRITY,
+} event_log_id_t;
+
+//arg of EVENT_LOG_PARAMS (ParamStore.h)
+#define EVENT_LOG_PARAMS_LOADED 0
+#define EVENT_LOG_PARAMS_DEFAULTS 1
+#define EVENT_LOG_PARAMS_UNAVAILABLE 2
+#define EVENT_LOG_PARAMS_SAVED 3
+
+//arg bits of EVENT_LOG_LINK
+#define EVENT_LOG_LINK_UP 0x1
+#define EVENT_LOG_LINK_100M 0x2
+#define EVENT_LOG_LINK_FULL_DUPLEX 0x4
+
+//Entries kept, a power of two
+#ifndef EVENT_LOG_DEPTH
+#define EVENT_LOG_DEPTH 128
+#endif
+
+typedef struct event_log_entry_t
+{
+	//0 while being written
+	uint32_t sequence;
+	//RTOS tick, restarts at 0 with every boot
+	uint32_t tick;
+	uint16_t id;
+	uint16_t arg;
+	uint32_t value;
+} event_log_entry_t;
+
+//Takes over the log from before the reset, or starts a new one when it
+//does not hold a valid log, and records EVENT_LOG_BOOT. Call first
+//thing in main.
+void EventLogInit();
+
+void EventLogWrite(event_log_id_t id, uint16_t arg, uint32_t value);
+
+//Sequence number the next event gets. The log holds the events from
+//EventLogNext() - EVENT_LOG_DEPTH on, those that were written.
+uint32_t EventLogNext();
+
+//Copies the event with sequence number sequence. Returns 0 if it was
+//overwritten already, is not written yet or is being written.
+uint8_t EventLogRead(uint32_t sequence, event_log_entry_t* entry);
+
+//Times the ECU booted with this log
+uint32_t EventLogBootCount();
+
+#endif /* EVENTLOG_H_ */
@@ -0,0 +1,527 @@
+/*
+ * Excitation.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <math.h>
+#include "Excitation.h"
+#include "main_context.h"
+#include "DriveByWireIO.h"
+#include "TccPwm.h"
+#include "AdcSampler.h"
+#include "DacThrottle.h"
+#include "DmaService.h"
+#include "FirmwareUpdate.h"
+#include "Redundancy.h"
+#include "EventLog.h"
+#include "FastCode.h"
+
+#if EXCITATION_ENABLE
+
+#if !TCC_PWM_ENABLE || !ADC_SAMPLER_PWM_TRIGGER
+#error EXCITATION_ENABLE needs TCC_PWM_ENABLE and ADC_SAMPLER_PWM_TRIGGER
+#endif
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+#error EXCITATION_ENABLE reads the steering position from RESULT, with ADC_SAMPLER_BRAKE_FEEDBACK it holds the brake pressure
+#endif
+
+#define EXCITATION_REQUEST_NONE 0
+#define EXCITATION_REQUEST_START 1
+#define EXCITATION_REQUEST_ABORT 2
+
+//PWM periods in each half of the buffers, the DMAC interrupt of one half
+//has the other's to refill it: 2.1 ms at 30kHz
+#define EXCITATION_HALF 64
+
+//x^15 + x^14 + 1
+#define EXCITATION_PRBS_SEED 0x7FFF
+#define EXCITATION_PRBS_MASK 0x7FFF
+
+//compare values -> CCBUF, a word per overflow
+static dma_channel_config_t excitation_output_config =
+{
+	0, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_WORD_Val, 1, 0, 2, 0
+};
+//ADC RESULT -> capture, a halfword per overflow. The position's channel
+//has the interrupt and the lowest priority, the others' beats of a trigger
+//are in by the time it runs.
+static dma_channel_config_t excitation_position_config =
+{
+	0, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_HWORD_Val, 0, 1, 0, 1
+};
+#if ADC_SAMPLER_DUAL
+static dma_channel_config_t excitation_current_config =
+{
+	0, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_HWORD_Val, 0, 1, 1, 0
+};
+#endif
+
+//the second block of each circular transfer, the first is the DMAC's
+static DmacDescriptor excitation_output_block COMPILER_ALIGNED(16);
+static DmacDescriptor excitation_position_block COMPILER_ALIGNED(16);
+#if ADC_SAMPLER_DUAL
+static DmacDescriptor excitation_current_block COMPILER_ALIGNED(16);
+#endif
+
+static struct
+{
+	//EXCITATION_REQUEST_*, from any task, with the config of a start
+	uint8_t request;
+	excitation_config_t requested;
+	//a dump holds the samples, set by the tcpip thread
+	uint8_t held;
+	//set by the DMAC interrupt
+	volatile uint8_t dma_error;
+	volatile uint8_t complete;
+
+	//state written by main_task and the DMAC interrupt, read by the network
+	excitation_status_t status;
+	//the last run that was done, what a dump sends
+	excitation_status_t done;
+	excitation_config_t config;
+	uint32_t started;
+	//ms from the start the capture has to be complete by
+	uint32_t deadline;
+	tcc_pwm_output_t tcc;
+	float (*duty_ticks)(float duty_cycle);
+	float max_duty;
+
+	//PREPARE: the next sample, the PRBS shift register and samples a bit lasts
+	uint16_t prepared;
+	uint16_t lfsr;
+	uint16_t bit_samples;
+
+	//DMAC interrupt side. Beats are counted from the first trigger, the
+	//same for every channel.
+	uint8_t half;
+	//the next sample whose compare value goes into the output, the value
+	//being written and periods of it left
+	uint16_t fill_next;
+	uint32_t fill_compare;
+	uint16_t fill_left;
+	//the compare value after the last sample, a duty of 0
+	uint32_t rest;
+	//beat of the first capture of the half that ends next, and the beat the
+	//next sample is taken at
+	uint32_t capture_beat;
+	uint32_t next_capture;
+
+	uint32_t compare_words[2][EXCITATION_HALF];
+	uint16_t positions[2][EXCITATION_HALF];
+#if ADC_SAMPLER_DUAL
+	uint16_t currents[2][EXCITATION_HALF];
+#endif
+	excitation_sample_t samples[EXCITATION_MAX_SAMPLES];
+} excitation;
+
+//channels, -1 while not allocated. The output's is read by ExcitationHalt.
+static volatile int8_t excitation_output_dma = -1;
+static int8_t excitation_position_dma = -1;
+static int8_t excitation_current_dma = -1;
+
+static void StopDma()
+{
+	int8_t output = excitation_output_dma;
+	__atomic_store_n(&excitation_output_dma, -1, __ATOMIC_RELEASE);
+	if( output >= 0 )
+		DmaFree(output);
+	if( excitation_position_dma >= 0 )
+		DmaFree(excitation_position_dma);
+	if( excitation_current_dma >= 0 )
+		DmaFree(excitation_current_dma);
+	excitation_position_dma = -1;
+	excitation_current_dma = -1;
+}
+
+static void Finish(main_context_t* ctx, excitation_result_t result)
+{
+	excitation_status_t* status = &excitation.status;
+	StopDma();
+	status->elapsed = ctx->current_time - excitation.started;
+	status->result = result;
+	__atomic_store_n(&status->state, EXCITATION_IDLE, __ATOMIC_SEQ_CST);
+	if( result == EXCITATION_DONE )
+		excitation.done = *status;
+	EventLogWrite(EVENT_LOG_EXCITATION, (uint16_t)(result | (status->output << 8)), status->elapsed);
+}
+
+static uint8_t ConfigValid(const excitation_config_t* config, float sample_rate)
+{
+	if( config->output >= EXCITATION_OUTPUT_COUNT || config->waveform >= EXCITATION_WAVEFORM_COUNT
+		|| config->hold == 0 || config->samples == 0 || config->samples > EXCITATION_MAX_SAMPLES
+		|| !(config->amplitude >= 0.0f) || !(config->offset >= 0.0f) )
+		return 0;
+	if( !(config->start_hz > 0.0f) || config->start_hz > sample_rate * 0.5f )
+		return 0;
+	if( config->waveform == EXCITATION_CHIRP && (!(config->end_hz > 0.0f) || config->end_hz > sample_rate * 0.5f) )
+		return 0;
+	//the DAC has no TCC to be played into
+	if( config->output == EXCITATION_THROTTLE && DAC_THROTTLE_ENABLE )
+		return 0;
+	return 1;
+}
+
+static void Start(main_context_t* ctx)
+{
+	excitation_status_t* status = &excitation.status;
+	excitation_config_t* config = &excitation.config;
+	*config = excitation.requested;
+	excitation.started = ctx->current_time;
+	status->output = config->output;
+	status->waveform = config->waveform;
+	status->samples = config->samples;
+	status->hold = config->hold;
+	status->captured = 0;
+	status->elapsed = 0;
+
+	excitation.tcc = config->output == EXCITATION_THROTTLE ? TCC_PWM_ACCELERATION : TCC_PWM_STEERING_TORQUE;
+	float sample_rate = config->hold ? TccPwmFrequency(excitation.tcc) / config->hold : 0.0f;
+	status->sample_rate = sample_rate;
+
+	//on before the hold is checked, a dump either sees the run or is seen
+	__atomic_store_n(&status->state, EXCITATION_PREPARE, __ATOMIC_SEQ_CST);
+	if( __atomic_load_n(&excitation.held, __ATOMIC_SEQ_CST) || !ConfigValid(config, sample_rate)
+		|| ctx->mode.mode != VEHICLE_MODE_DISABLED || ctx->autonomous_mode || ctx->tele_operation_enabled
+		|| ctx->vehicle_speed > EXCITATION_START_MAX_SPEED || ctx->vehicle_speed < -EXCITATION_START_MAX_SPEED
+		|| FirmwareUpdateBusy() || !RedundancyActive() )
+	{
+		Finish(ctx, EXCITATION_REJECTED);
+		return;
+	}
+
+	//the samples are overwritten from here on
+	excitation.done.samples = 0;
+	if( config->output == EXCITATION_THROTTLE )
+	{
+		excitation.duty_ticks = AccelerationDutyTicks;
+		excitation.max_duty = EXCITATION_MAX_THROTTLE_DUTY;
+	}
+	else
+	{
+		excitation.duty_ticks = SteeringTorqueDutyTicks;
+		excitation.max_duty = EXCITATION_MAX_STEERING_DUTY;
+	}
+	excitation.deadline = (uint32_t)((float)config->samples * 1000.0f / sample_rate) + EXCITATION_TIMEOUT_MARGIN;
+	excitation.prepared = 0;
+	excitation.lfsr = EXCITATION_PRBS_SEED;
+	uint32_t bit_samples = (uint32_t)(sample_rate / config->start_hz + 0.5f);
+	excitation.bit_samples = bit_samples ? bit_samples : 1;
+}
+
+//The next EXCITATION_PREPARE_SAMPLES duties. Returns 1 once all are in.
+static uint8_t Prepare()
+{
+	const excitation_config_t* config = &excitation.config;
+	float rate = excitation.status.sample_rate;
+	float duration = (float)config->samples / rate;
+	//the chirp's phase in cycles is f0 t + (f1 - f0) t^2 / 2T
+	float sweep = (config->end_hz - config->start_hz) / (2.0f * duration);
+	uint32_t end = excitation.prepared + EXCITATION_PREPARE_SAMPLES;
+	if( end > config->samples )
+		end = config->samples;
+
+	for(uint32_t i = excitation.prepared; i < end; ++i)
+	{
+		float duty;
+		if( config->waveform == EXCITATION_CHIRP )
+		{
+			float t = (float)i / rate;
+			float cycles = config->start_hz * t + sweep * t * t;
+			duty = config->offset + config->amplitude * sinf(2.0f * (float)M_PI * (cycles - floorf(cycles)));
+		}
+		else
+		{
+			if( i && i % excitation.bit_samples == 0 )
+			{
+				uint16_t lfsr = excitation.lfsr;
+				uint16_t bit = ((lfsr >> 14) ^ (lfsr >> 13)) & 1;
+				excitation.lfsr = ((lfsr << 1) | bit) & EXCITATION_PRBS_MASK;
+			}
+			duty = excitation.lfsr & 1 ? config->offset + config->amplitude : config->offset - config->amplitude;
+		}
+
+		if( duty < 0.0f )
+			duty = 0.0f;
+		else if( duty > excitation.max_duty )
+			duty = excitation.max_duty;
+		excitation.samples[i].duty = duty;
+		excitation.samples[i].position = 0;
+		excitation.samples[i].current = 0;
+	}
+	excitation.prepared = end;
+	return end == config->samples;
+}
+
+//The output half's next EXCITATION_HALF compare values, a sample's for hold
+//periods, the rest once the samples are out
+FAST_CODE static void Refill(uint8_t half)
+{
+	uint32_t* words = excitation.compare_words[half];
+	for(uint32_t j = 0; j < EXCITATION_HALF; ++j)
+	{
+		if( excitation.fill_left == 0 )
+		{
+			uint16_t next = excitation.fill_next;
+			if( next < excitation.config.samples )
+			{
+				excitation.fill_compare = TccPwmCompare(excitation.tcc, excitation.duty_ticks(excitation.samples[next].duty));
+				excitation.fill_next = next + 1;
+			}
+			else
+				excitation.fill_compare = excitation.rest;
+			excitation.fill_left = excitation.config.hold;
+		}
+		words[j] = excitation.fill_compare;
+		excitation.fill_left--;
+	}
+}
+
+//Takes the samples out of the capture half that just ended. Sample i is
+//taken at beat (i + 1) hold + 1, the last period of its hold two periods on.
+FAST_CODE static void Capture(uint8_t half)
+{
+	excitation_status_t* status = &excitation.status;
+	uint32_t base = excitation.capture_beat;
+	uint32_t end = base + EXCITATION_HALF;
+	uint16_t captured = status->captured;
+	while( excitation.next_capture < end && captured < excitation.config.samples )
+	{
+		uint32_t j = excitation.next_capture - base;
+		excitation_sample_t* sample = &excitation.samples[captured++];
+		sample->position = excitation.positions[half][j];
+#if ADC_SAMPLER_DUAL
+		sample->current = excitation.currents[half][j];
+#endif
+		excitation.next_capture += excitation.config.hold;
+	}
+	excitation.capture_beat = end;
+	__atomic_store_n(&status->captured, captured, __ATOMIC_RELEASE);
+	if( captured == excitation.config.samples )
+		excitation.complete = 1;
+}
+
+//DMAC interrupt, once per half of the position capture. The output ended
+//the same half at the same trigger and plays the other one.
+FAST_CODE static void HalfDone(void* arg, uint8_t error)
+{
+	if( error )
+	{
+		excitation.dma_error = 1;
+		return;
+	}
+	uint8_t half = excitation.half;
+	excitation.half = half ^ 1;
+	Capture(half);
+	Refill(half);
+}
+
+//Both halves filled, then every channel enabled while the timer stands, so
+//they all start from the same trigger. Returns 0 without the channels.
+static uint8_t StartDma()
+{
+	uint8_t trigger = TccPwmOverflowTrigger(excitation.tcc);
+	excitation_output_config.trigger = trigger;
+	excitation_position_config.trigger = trigger;
+	int8_t output = DmaAllocate(&excitation_output_config, NULL, NULL);
+	excitation_position_dma = DmaAllocate(&excitation_position_config, HalfDone, NULL);
+#if ADC_SAMPLER_DUAL
+	excitation_current_config.trigger = trigger;
+	excitation_current_dma = DmaAllocate(&excitation_current_config, NULL, NULL);
+#endif
+	excitation_output_dma = output;
+	if( output < 0 || excitation_position_dma < 0 || (ADC_SAMPLER_DUAL && excitation_current_dma < 0) )
+	{
+		StopDma();
+		return 0;
+	}
+
+	excitation.dma_error = 0;
+	excitation.complete = 0;
+	excitation.half = 0;
+	excitation.fill_next = 0;
+	excitation.fill_left = 0;
+	excitation.rest = TccPwmCompare(excitation.tcc, excitation.duty_ticks(0.0f));
+	excitation.capture_beat = 0;
+	excitation.next_capture = (uint32_t)excitation.config.hold + 1;
+	Refill(0);
+	Refill(1);
+
+	volatile uint32_t* compare = TccPwmCompareBuffer(excitation.tcc);
+	DmaSetBlock(output, NULL, excitation.compare_words[0], compare, EXCITATION_HALF, &excitation_output_block);
+	DmaSetBlock(output, &excitation_output_block, excitation.compare_words[1], compare, EXCITATION_HALF,
+		DmaFirstBlock(output));
+	int8_t position = excitation_position_dma;
+	DmaSetBlock(position, NULL, &ADC1->RESULT.reg, excitation.positions[0], EXCITATION_HALF, &excitation_position_block);
+	DmaSetBlock(position, &excitation_position_block, &ADC1->RESULT.reg, excitation.positions[1], EXCITATION_HALF,
+		DmaFirstBlock(position));
+#if ADC_SAMPLER_DUAL
+	int8_t current = excitation_current_dma;
+	DmaSetBlock(current, NULL, &ADC0->RESULT.reg, excitation.currents[0], EXCITATION_HALF, &excitation_current_block);
+	DmaSetBlock(current, &excitation_current_block, &ADC0->RESULT.reg, excitation.currents[1], EXCITATION_HALF,
+		DmaFirstBlock(current));
+#endif
+
+	TccPwmPause(excitation.tcc, 1);
+	DmaStart(output);
+	DmaStart(position);
+#if ADC_SAMPLER_DUAL
+	DmaStart(current);
+#endif
+	TccPwmPause(excitation.tcc, 0);
+	return 1;
+}
+
+void ExcitationRequestStart(const excitation_config_t* config)
+{
+	//a start taken up in between gets the config of the one before
+	excitation.requested = *config;
+	__atomic_store_n(&excitation.request, EXCITATION_REQUEST_START, __ATOMIC_RELEASE);
+}
+
+void ExcitationRequestAbort()
+{
+	__atomic_store_n(&excitation.request, EXCITATION_REQUEST_ABORT, __ATOMIC_RELEASE);
+}
+
+uint8_t ExcitationCondition(main_context_t* ctx)
+{
+	uint8_t request = __atomic_exchange_n(&excitation.request, EXCITATION_REQUEST_NONE, __ATOMIC_ACQUIRE);
+	excitation_status_t* status = &excitation.status;
+	//the Test mode's handler sets them again while the DMA plays
+	ctx->actuators.steering_torque_by_dma = 0;
+	ctx->actuators.acceleration_by_dma = 0;
+	if( status->state != EXCITATION_IDLE )
+	{
+		//the mode was taken a cycle after the start, anything else took over
+		//since
+		if( request == EXCITATION_REQUEST_ABORT || ctx->mode.mode != VEHICLE_MODE_TEST )
+			Finish(ctx, EXCITATION_ABORTED);
+	}
+	else if( request == EXCITATION_REQUEST_START )
+		Start(ctx);
+	return status->state != EXCITATION_IDLE;
+}
+
+void ExcitationOutputs(main_context_t* ctx)
+{
+	excitation_status_t* status = &excitation.status;
+	status->elapsed = ctx->current_time - excitation.started;
+
+	if( status->state == EXCITATION_PREPARE )
+	{
+		if( !Prepare() )
+			return;
+		if( !StartDma() )
+		{
+			Finish(ctx, EXCITATION_NO_DMA);
+			return;
+		}
+		excitation.deadline += status->elapsed;
+		__atomic_store_n(&status->state, EXCITATION_RUN, __ATOMIC_RELEASE);
+	}
+	else if( status->state != EXCITATION_RUN )
+		return;
+
+	float speed = ctx->vehicle_speed;
+	if( excitation.complete )
+		Finish(ctx, EXCITATION_DONE);
+	else if( excitation.dma_error )
+		Finish(ctx, EXCITATION_NO_DMA);
+	else if( ctx->steering_angle > EXCITATION_MAX_ANGLE || ctx->steering_angle < -EXCITATION_MAX_ANGLE
+		|| speed > EXCITATION_MAX_SPEED || speed < -EXCITATION_MAX_SPEED || AdcSamplerTripped() )
+		Finish(ctx, EXCITATION_LIMIT);
+	else if( status->elapsed > excitation.deadline )
+		Finish(ctx, EXCITATION_TIMED_OUT);
+	if( status->state != EXCITATION_RUN )
+		return;
+
+	actuator_command_t* out = &ctx->actuators;
+	if( excitation.config.output == EXCITATION_THROTTLE )
+		out->acceleration_by_dma = 1;
+	else
+	{
+		out->steering_torque_by_dma = 1;
+		out->steer_right = excitation.config.steer_right;
+	}
+}
+
+FAST_CODE void ExcitationHalt()
+{
+	int8_t output = __atomic_load_n(&excitation_output_dma, __ATOMIC_ACQUIRE);
+	if( output >= 0 )
+		DmaStop(output);
+}
+
+void ExcitationStatus(excitation_status_t* status)
+{
+	*status = excitation.status;
+}
+
+uint8_t ExcitationHold(excitation_status_t* run)
+{
+	//on before the state is checked, a start either sees the hold or is seen
+	__atomic_store_n(&excitation.held, 1, __ATOMIC_SEQ_CST);
+	if( __atomic_load_n(&excitation.status.state, __ATOMIC_SEQ_CST) != EXCITATION_IDLE || excitation.done.samples == 0 )
+	{
+		__atomic_store_n(&excitation.held, 0, __ATOMIC_RELEASE);
+		return 0;
+	}
+	*run = excitation.done;
+	return 1;
+}
+
+void ExcitationRelease()
+{
+	__atomic_store_n(&excitation.held, 0, __ATOMIC_RELEASE);
+}
+
+const excitation_sample_t* ExcitationSamples()
+{
+	return excitation.samples;
+}
+
+#else
+
+void ExcitationRequestStart(const excitation_config_t* config)
+{
+}
+
+void ExcitationRequestAbort()
+{
+}
+
+uint8_t ExcitationCondition(struct main_context_t* ctx)
+{
+	return 0;
+}
+
+void ExcitationOutputs(struct main_context_t* ctx)
+{
+}
+
+void ExcitationHalt()
+{
+}
+
+void ExcitationStatus(excitation_status_t* status)
+{
+	memset(status, 0, sizeof(*status));
+}
+
+uint8_t ExcitationHold(excitation_status_t* run)
+{
+	return 0;
+}
+
+void ExcitationRelease()
+{
+}
+
+const excitation_sample_t* ExcitationSamples()
+{
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ * Excitation.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef EXCITATION_H_
+#define EXCITATION_H_
+
+#include <stdint.h>
+
+//System identification runs: a precomputed chirp or PRBS duty sequence
+//played into the steering torque or the throttle PWM by DMA, with the ADC
+//captured in step with it, for input/output data sets of the actuators at
+//kHz rates with no software timing in them.
+//
+//A start comes over the control channel (the excitation request,
+//ControlProtocol.h) and is only taken up while the cart is Disabled and
+//standing, with no command in force and no firmware update running. The
+//run then holds the cart in the Test mode (VehicleMode.h): the sequence is
+//computed over the first few cycles, then a DMA channel triggered by the
+//output's TCC overflow writes the next compare value to CCBUF every PWM
+//period, each sample's value for hold periods in a row. Channels on the
+//same trigger copy the ADC RESULT of the steering position, and with
+//ADC_SAMPLER_DUAL of the steering current, every period. The buffers are
+//two halves of 64 periods each: the DMAC interrupt of a finished half
+//picks the samples out of its capture and refills its output while the
+//DMA runs on in the other one. The control loop only watches.
+//
+//With ADC_SAMPLER_PWM_TRIGGER the ADC converts in the middle of every
+//steering period and RESULT holds that conversion at the next overflow. A
+//compare value written at overflow k is in effect from overflow k+1 and the
+//conversion of that period is read at overflow k+2: a sample's position is
+//the one converted in the last period of its hold, two periods after the
+//sample's first compare value was written. Every sample of a run is paired
+//that way, there is no jitter between them.
+//
+//A steering run turns the motor one way, the direction pin stays where
+//steer_right puts it for the whole run, and holds the parking brake. A
+//throttle run plays the acceleration PWM in forward gear with the brake
+//off, so the cart has to be on stands or have room. The ADC sees nothing of
+//the throttle, its samples hold the steering channels and the speed comes
+//from telemetry at the control rate.
+//
+//Duties are clamped to EXCITATION_MAX_STEERING_DUTY or
+//EXCITATION_MAX_THROTTLE_DUTY. The estop and an ADC window trip stop the
+//DMA from their interrupts; tele operation, a steering angle past
+//EXCITATION_MAX_ANGLE, a speed past EXCITATION_MAX_SPEED and an abort
+//request end the run from main_task. The end of every run is an
+//EVENT_LOG_EXCITATION entry, and the samples of the last one that was done
+//are dumped over the bulk channel (BulkChannel.h).
+
+#ifndef EXCITATION_ENABLE
+#define EXCITATION_ENABLE 0
+#endif
+
+//Samples of a run, 8 bytes each
+#ifndef EXCITATION_MAX_SAMPLES
+#define EXCITATION_MAX_SAMPLES 4096
+#endif
+
+//Duty cycles a run is clamped to
+#ifndef EXCITATION_MAX_STEERING_DUTY
+#define EXCITATION_MAX_STEERING_DUTY 0.3f
+#endif
+#ifndef EXCITATION_MAX_THROTTLE_DUTY
+#define EXCITATION_MAX_THROTTLE_DUTY 0.2f
+#endif
+
+//deg either side of center that end a run
+#ifndef EXCITATION_MAX_ANGLE
+#define EXCITATION_MAX_ANGLE 30.0f
+#endif
+
+//m/s that end a run, and that the cart may be moving at when asked to start
+#ifndef EXCITATION_MAX_SPEED
+#define EXCITATION_MAX_SPEED 2.0f
+#endif
+#ifndef EXCITATION_START_MAX_SPEED
+#define EXCITATION_START_MAX_SPEED 0.05f
+#endif
+
+//Samples computed per cycle before the run starts
+#ifndef EXCITATION_PREPARE_SAMPLES
+#define EXCITATION_PREPARE_SAMPLES 128
+#endif
+
+//ms past the length of the sequence the capture has to be complete in
+#ifndef EXCITATION_TIMEOUT_MARGIN
+#define EXCITATION_TIMEOUT_MARGIN 100
+#endif
+
+typedef enum excitation_output_t
+{
+	EXCITATION_STEERING = 0,
+	EXCITATION_THROTTLE,
+	EXCITATION_OUTPUT_COUNT
+} excitation_output_t;
+
+typedef enum excitation_waveform_t
+{
+	//a sine of start_hz to end_hz, its frequency rising linearly
+	EXCITATION_CHIRP = 0,
+	//offset plus or minus amplitude from a 15 bit maximum length sequence,
+	//a bit every 1 / start_hz s rounded to whole samples
+	EXCITATION_PRBS,
+	EXCITATION_WAVEFORM_COUNT
+} excitation_waveform_t;
+
+typedef enum excitation_state_t
+{
+	EXCITATION_IDLE = 0,
+	//the sequence is computed
+	EXCITATION_PREPARE,
+	//the DMA plays it
+	EXCITATION_RUN,
+} excitation_state_t;
+
+//Also the arg of EVENT_LOG_EXCITATION, with the excitation_output_t in the
+//high byte. value: ms the run took.
+typedef enum excitation_result_t
+{
+	//no run since boot
+	EXCITATION_NONE = 0,
+	//every sample is captured
+	EXCITATION_DONE,
+	//not Disabled, moving, commanded, a firmware update running, a bulk
+	//dump holding the samples or a config out of range
+	EXCITATION_REJECTED,
+	//the estop, tele operation or an abort request
+	EXCITATION_ABORTED,
+	//the steering angle or the speed went past their limits, or an ADC
+	//window trip
+	EXCITATION_LIMIT,
+	//the capture was not complete in time
+	EXCITATION_TIMED_OUT,
+	//no DMA channels free, or a bus error
+	EXCITATION_NO_DMA,
+} excitation_result_t;
+
+typedef struct excitation_config_t
+{
+	excitation_output_t output;
+	excitation_waveform_t waveform;
+	//steering runs only
+	uint8_t steer_right;
+	//PWM periods a sample is held for, 1 or more. The sample rate is the
+	//output's PWM frequency, 30kHz or 1kHz, over hold.
+	uint16_t hold;
+	//1 to EXCITATION_MAX_SAMPLES
+	uint16_t samples;
+	//duty cycles around which and by how much the waveform swings
+	float offset;
+	float amplitude;
+	//Hz, up to half the sample rate. PRBS: the bit rate, end_hz unused.
+	float start_hz;
+	float end_hz;
+} excitation_config_t;
+
+typedef struct excitation_sample_t
+{
+	//applied, clamped
+	float duty;
+	//ADC results, 12 bits in the averaging modes. The current is 0 without
+	//ADC_SAMPLER_DUAL.
+	uint16_t position;
+	uint16_t current;
+} excitation_sample_t;
+
+typedef struct excitation_status_t
+{
+	excitation_state_t state;
+	//of the last run to end
+	excitation_result_t result;
+	//of the run, of the last one once it ended
+	excitation_output_t output;
+	excitation_waveform_t waveform;
+	//ms since the start, of the last run once it ended
+	uint32_t elapsed;
+	uint16_t samples;
+	uint16_t hold;
+	//samples captured so far
+	uint16_t captured;
+	//Hz
+	float sample_rate;
+} excitation_status_t;
+
+struct main_context_t;
+
+//Asks for a run of config, copied, or to end the one running. Any task,
+//main_task takes them up in its next cycle.
+void ExcitationRequestStart(const excitation_config_t* config);
+void ExcitationRequestAbort();
+
+//Takes up a request and ends the run if the mode was left. Returns 1 while
+//a run is on, for VEHICLE_CONDITION_TEST. From the control stage, before
+//the mode update.
+uint8_t ExcitationCondition(struct main_context_t* ctx);
+
+//Computes the sequence, starts the DMA once it is done and watches the run.
+//The Test mode's output handler, the actuators are at rest otherwise.
+void ExcitationOutputs(struct main_context_t* ctx);
+
+//Stops the output DMA, from the estop and the ADC window trip interrupts
+//before they force the outputs. main_task ends the run on its next cycle.
+void ExcitationHalt();
+
+//Any task, the fields are copied one at a time
+void ExcitationStatus(excitation_status_t* status);
+
+//Holds the samples of the last run that was done for a dump, no run starts
+//until the release, and sets run to its status as it ended. Returns 0 and
+//holds nothing if there is no such run or one is on. From the tcpip
+//thread.
+uint8_t ExcitationHold(excitation_status_t* run);
+void ExcitationRelease();
+
+//The samples, while held
+const excitation_sample_t* ExcitationSamples();
+
+#endif /* EXCITATION_H_ */
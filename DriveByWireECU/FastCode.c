@@ -0,0 +1,24 @@
+/*
+ * FastCode.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hpl_cmcc.h>
+#include "FastCode.h"
+
+#define CACHE_OTHER_WAYS ((enum way_num_index)(WAY1 | WAY2 | WAY3))
+
+void FastCodeCacheCaptureBegin()
+{
+	//start empty and only let way 0 allocate
+	_cmcc_invalidate_all(CMCC);
+	_cmcc_enable(CMCC);
+	_cmcc_lock_way(CMCC, CACHE_OTHER_WAYS);
+}
+
+void FastCodeCacheCaptureEnd()
+{
+	_cmcc_unlock_way(CMCC, CACHE_OTHER_WAYS);
+	_cmcc_lock_way(CMCC, WAY0);
+}
@@ -0,0 +1,66 @@
+/*
+ * FastCode.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef FASTCODE_H_
+#define FASTCODE_H_
+
+#include <utils.h>
+
+//Keeps the control path's execution time independent of flash.
+//Functions marked FAST_CODE are copied to SRAM at startup (the .ramfunc
+//input section of .relocate in the linker script) and run from there with
+//no flash wait states and no cache misses, whatever lwIP did in between.
+//Calls from there into flash still work, the linker adds long branch veneers.
+//
+//The CMCC cache is on for everything else. It only caches the code bus,
+//so data in SRAM never goes through it and DMA buffers need no maintenance.
+//
+//With the control path left in flash instead, FAST_CODE_CACHE_LOCK locks
+//one cache way around it. Only way 0 may fill during one control cycle,
+//then way 0 is locked and the others are released. The control path then
+//hits in the cache for up to a way's worth of code (1KB of the 4KB), and
+//ISRs that ran during that cycle share the way.
+
+//Set to 0 to leave the control path in flash
+#ifndef FAST_CODE_IN_RAM
+#define FAST_CODE_IN_RAM 1
+#endif
+
+//Set to 1 to lock a cache way around the control path
+#ifndef FAST_CODE_CACHE_LOCK
+#define FAST_CODE_CACHE_LOCK 0
+#endif
+
+//Control cycle captured into the locked way. Not the first one, which takes
+//the one off setup paths.
+#define FAST_CODE_CAPTURE_CYCLE 2
+
+#if FAST_CODE_IN_RAM
+#define FAST_CODE RAMFUNC
+#else
+#define FAST_CODE
+#endif
+
+//Files whose speed matters more than their size put FAST_CODE_FILE after
+//their includes: PID.c, and on the network path ethif_mac.c, hpl_gmac.c,
+//inet_chksum.c and NetMem.c. In a size optimised build (Release, -Os) their
+//functions are still built at -O2. Debug builds are left unoptimised and
+//the Performance configuration builds everything at -O2 already.
+#ifndef FAST_CODE_OPTIMIZE
+#define FAST_CODE_OPTIMIZE 1
+#endif
+
+#if FAST_CODE_OPTIMIZE && defined(__OPTIMIZE_SIZE__)
+#define FAST_CODE_FILE _Pragma("GCC optimize(\"O2\")")
+#else
+#define FAST_CODE_FILE
+#endif
+
+//Call right before and after the control cycle to be captured
+void FastCodeCacheCaptureBegin();
+void FastCodeCacheCaptureEnd();
+
+#endif /* FASTCODE_H_ */
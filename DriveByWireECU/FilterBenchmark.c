@@ -0,0 +1,123 @@
+/*
+ * FilterBenchmark.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include <compiler.h>
+#include "FilterBenchmark.h"
+#include "SensorFilter.h"
+
+#define FILTER_BENCHMARK_ITERATIONS 1000
+
+static int16_t bench_sample = 0;
+static volatile int32_t bench_output = 0;
+
+static int16_t BenchSample()
+{
+	//a sawtooth, so the median insert moves by varying amounts
+	bench_sample = (int16_t)((bench_sample + 1237) % 8000 - 4000);
+	return bench_sample;
+}
+
+static void BenchStartCounter()
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t BenchmarkBiquad(uint32_t iterations)
+{
+	biquad_q15_t biquad;
+	BiquadInitLowpass(&biquad, 200.0f, 1000.0f);
+	BenchStartCounter();
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		bench_output = BiquadStep(&biquad, BenchSample());
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkMedian(uint32_t iterations)
+{
+	median_filter_t median;
+	MedianFilterInit(&median, 5, 0);
+	BenchStartCounter();
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		bench_output = MedianFilterStep(&median, BenchSample());
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkKalman1(uint32_t iterations)
+{
+	kalman1_t kalman;
+	Kalman1Init(&kalman, 0.5f, 0.05f, 0.001f);
+	BenchStartCounter();
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		bench_output = Kalman1Step(&kalman, (int32_t)BenchSample() << 4, FILTER_Q16(1.0f));
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkKalman2(uint32_t iterations)
+{
+	kalman2_t kalman;
+	Kalman2Init(&kalman, 0.5f, 0.2f, 0.05f, 0.001f);
+	BenchStartCounter();
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		bench_output = Kalman2Step(&kalman, (int32_t)BenchSample() << 4, FILTER_Q16(1.0f));
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkFusion(uint32_t iterations)
+{
+	fusion_t fusion;
+	FusionInit(&fusion, 0.01f, 0.5f);
+	BenchStartCounter();
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		bench_output = FusionStep(&fusion, (int32_t)BenchSample() << 4, FILTER_Q16(0.01f));
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+void ReportFilterBenchmark(void)
+{
+	//the loop and the sample source are in every figure
+	printf("Biquad: %lu cycles\r\n", (unsigned long)BenchmarkBiquad(FILTER_BENCHMARK_ITERATIONS));
+	printf("Median 5: %lu cycles\r\n", (unsigned long)BenchmarkMedian(FILTER_BENCHMARK_ITERATIONS));
+	printf("Kalman1: %lu cycles\r\n", (unsigned long)BenchmarkKalman1(FILTER_BENCHMARK_ITERATIONS));
+	printf("Kalman2: %lu cycles\r\n", (unsigned long)BenchmarkKalman2(FILTER_BENCHMARK_ITERATIONS));
+	printf("Fusion: %lu cycles\r\n", (unsigned long)BenchmarkFusion(FILTER_BENCHMARK_ITERATIONS));
+}
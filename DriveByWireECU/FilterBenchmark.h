@@ -0,0 +1,28 @@
+/*
+ * FilterBenchmark.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef FILTERBENCHMARK_H_
+#define FILTERBENCHMARK_H_
+
+#include <stdint.h>
+
+//Set to 1 to print the per sample cost of each SensorFilter.h filter at boot
+#ifndef FILTER_BENCHMARK
+#define FILTER_BENCHMARK 0
+#endif
+
+//Each runs iterations samples through a scratch filter and returns the
+//average number of core cycles per sample, measured with the DWT cycle counter.
+uint32_t BenchmarkBiquad(uint32_t iterations);
+uint32_t BenchmarkMedian(uint32_t iterations);
+uint32_t BenchmarkKalman1(uint32_t iterations);
+uint32_t BenchmarkKalman2(uint32_t iterations);
+uint32_t BenchmarkFusion(uint32_t iterations);
+
+//Prints the benchmark results
+void ReportFilterBenchmark(void);
+
+#endif /* FILTERBENCHMARK_H_ */
@@ -0,0 +1,522 @@
+/*
+ * FirmwareUpdate.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hri_nvmctrl_e54.h>
+#include <hpl_cmcc.h>
+#include "FirmwareUpdate.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "task_config.h"
+#include "main_context.h"
+#include "ControlProtocol.h"
+#include "Crc32.h"
+#include "DriveByWireIO.h"
+#include "SteeringCalibration.h"
+#include "ParamStore.h"
+#include "EventLog.h"
+#include "Log.h"
+#include "ByteOrder.h"
+#include "Nvm.h"
+
+#if FIRMWARE_UPDATE_ENABLE && LWIP_TCP
+
+#if FIRMWARE_UPDATE_BUFFER < TCP_WND || FIRMWARE_UPDATE_BUFFER % FIRMWARE_UPDATE_PAGE_SIZE
+#error FIRMWARE_UPDATE_BUFFER must be whole pages and hold the TCP window
+#endif
+
+#if FIRMWARE_UPDATE_BLOCK_SIZE != NVM_BLOCK_SIZE || FIRMWARE_UPDATE_PAGE_SIZE != NVM_PAGE_SIZE
+#error The update erases and programs the flash in its blocks and pages
+#endif
+#if STEERING_CALIBRATION_NVM_ADDRESS % FIRMWARE_UPDATE_BANK_SIZE < FIRMWARE_UPDATE_MAX_IMAGE
+#error The steering calibration has to be in FIRMWARE_UPDATE_RESERVED, an update would erase it
+#endif
+#if FIRMWARE_UPDATE_RESERVED % FIRMWARE_UPDATE_BLOCK_SIZE || FIRMWARE_UPDATE_RESERVED < PARAM_STORE_SMART_EEPROM_SIZE
+#error FIRMWARE_UPDATE_RESERVED has to be whole blocks and hold the SmartEEPROM
+#endif
+
+//tcp_poll interval, in units of the 500 ms TCP coarse timer
+#define FIRMWARE_UPDATE_POLL_INTERVAL 2
+
+#define FIRMWARE_UPDATE_TRIAL_MAGIC 0x4C525446	//"FTRL"
+#define FIRMWARE_UPDATE_ROLLBACK_MAGIC 0x4B424C52	//"RLBK"
+
+typedef enum firmware_update_state_t
+{
+	FIRMWARE_UPDATE_IDLE = 0,
+	//header in, the task programs what arrives
+	FIRMWARE_UPDATE_RECEIVING,
+	//the connection went before the image was in, the task drops it
+	FIRMWARE_UPDATE_ABORTED,
+} firmware_update_state_t;
+
+//In the backup RAM, kept through the swap's reset. The only user of it.
+typedef struct firmware_trial_t
+{
+	uint32_t magic;
+	uint32_t boots;
+	uint32_t crc;
+} firmware_trial_t;
+
+typedef struct firmware_update_t
+{
+	main_context_t* ctx;
+	TaskHandle_t task;
+	struct tcp_pcb* listen_pcb;
+	//the update's connection, NULL once it is closed. The task only
+	//touches it with the core locked.
+	struct tcp_pcb* pcb;
+	uint8_t idle_polls;
+	uint8_t header_length;
+	uint8_t header[FIRMWARE_UPDATE_HEADER_SIZE];
+	uint32_t length;
+	uint32_t crc;
+	//firmware_update_state_t, set by the tcpip thread, back to idle by the task
+	uint8_t state;
+	//image bytes in the ring so far, and programmed out of it
+	uint32_t received;
+	uint32_t programmed;
+	uint8_t ring[FIRMWARE_UPDATE_BUFFER] __attribute__((aligned(4)));
+} firmware_update_t;
+
+static firmware_update_t firmware_update;
+static firmware_trial_t firmware_trial __attribute__((section(".bkupram")));
+
+//the running image, .text and the copy of .data after it
+extern uint32_t _etext;
+extern uint32_t _srelocate;
+extern uint32_t _erelocate;
+
+//Disabled or Estop, nothing is driving
+static uint8_t VehicleStopped()
+{
+	vehicle_mode_t mode = __atomic_load_n(&firmware_update.ctx->mode.mode, __ATOMIC_RELAXED);
+	return mode == VEHICLE_MODE_DISABLED || mode == VEHICLE_MODE_ESTOP;
+}
+
+//Answers and closes the connection. In the tcpip thread, or with the core
+//locked.
+static void Reply(firmware_update_status_t status, uint32_t value)
+{
+	struct tcp_pcb* pcb = firmware_update.pcb;
+	if( status != FIRMWARE_UPDATE_OK )
+		EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_FAILED | status, value);
+	if( pcb == NULL )
+		return;
+
+	uint8_t reply[FIRMWARE_UPDATE_REPLY_SIZE] = { status };
+	PutLE32(&reply[4], value);
+	firmware_update.pcb = NULL;
+	tcp_arg(pcb, NULL);
+	tcp_recv(pcb, NULL);
+	tcp_err(pcb, NULL);
+	tcp_poll(pcb, NULL, 0);
+	tcp_write(pcb, reply, sizeof(reply), TCP_WRITE_FLAG_COPY);
+	tcp_output(pcb);
+	//the reply still goes out after a close
+	if( tcp_close(pcb) != ERR_OK )
+		tcp_abort(pcb);
+}
+
+static void ReplyLocked(firmware_update_status_t status, uint32_t value)
+{
+	LOCK_TCPIP_CORE();
+	Reply(status, value);
+	UNLOCK_TCPIP_CORE();
+}
+
+//What is at calibration now is at calibration ^ bank size after a swap,
+//so it goes there first. Only if it differs, that bank is the one running
+//and the core stalls while it is written.
+static uint8_t CarryCalibration()
+{
+	uint32_t from = STEERING_CALIBRATION_NVM_ADDRESS & ~(FIRMWARE_UPDATE_BLOCK_SIZE - 1);
+	uint32_t to = from ^ FIRMWARE_UPDATE_BANK_SIZE;
+	if( memcmp((const void*)from, (const void*)to, FIRMWARE_UPDATE_BLOCK_SIZE) == 0 )
+		return 1;
+
+	static uint8_t block[FIRMWARE_UPDATE_BLOCK_SIZE];
+	memcpy(block, (const void*)from, sizeof(block));
+	if( !NvmCommand(to, NVMCTRL_CTRLB_CMD_EB, 0) )
+		return 0;
+	for(uint32_t offset = 0; offset < FIRMWARE_UPDATE_BLOCK_SIZE; offset += FIRMWARE_UPDATE_PAGE_SIZE)
+	{
+		if( !NvmProgramPage(to + offset, &block[offset], FIRMWARE_UPDATE_PAGE_SIZE, 0) )
+			return 0;
+	}
+	return 1;
+}
+
+//Swaps the banks, the NVMCTRL resets the core into the other one
+static void SwapBanks()
+{
+	__disable_irq();
+	NvmWaitReady(0);
+	hri_nvmctrl_write_CTRLB_reg(NVMCTRL, NVMCTRL_CTRLB_CMDEX_KEY | NVMCTRL_CTRLB_CMD_BKSWRST);
+	while( 1 )
+		;
+}
+
+//The image is in the other bank and its CRC matches
+static void Install()
+{
+	if( !VehicleStopped() )
+	{
+		ReplyLocked(FIRMWARE_UPDATE_NOT_STOPPED, firmware_update.programmed);
+		return;
+	}
+	ReplyLocked(FIRMWARE_UPDATE_OK, firmware_update.programmed);
+	EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_SWAP, firmware_update.crc);
+	LOG("firmware: %lu bytes verified, swapping banks", firmware_update.length);
+	vTaskDelay(pdMS_TO_TICKS(FIRMWARE_UPDATE_SWAP_DELAY));
+
+	//the cart may have been put in gear meanwhile, the reply is a promise
+	//to try, not to swap
+	if( !VehicleStopped() )
+	{
+		EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_FAILED | FIRMWARE_UPDATE_NOT_STOPPED, 0);
+		return;
+	}
+	ForceBrakeOutputs();
+	if( !CarryCalibration() )
+	{
+		EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_FAILED | FIRMWARE_UPDATE_FLASH_ERROR,
+			STEERING_CALIBRATION_NVM_ADDRESS ^ FIRMWARE_UPDATE_BANK_SIZE);
+		return;
+	}
+
+	firmware_trial.magic = FIRMWARE_UPDATE_TRIAL_MAGIC;
+	firmware_trial.boots = 0;
+	firmware_trial.crc = firmware_update.crc;
+	SwapBanks();
+}
+
+//Programs what the tcpip thread received, a page at a time, erasing every
+//block as the first page of it comes up. Returns 0 once the update is over.
+static uint8_t ProgramReceived()
+{
+	uint32_t received = __atomic_load_n(&firmware_update.received, __ATOMIC_ACQUIRE);
+	while( firmware_update.programmed < firmware_update.length )
+	{
+		uint32_t length = firmware_update.length - firmware_update.programmed;
+		if( length > FIRMWARE_UPDATE_PAGE_SIZE )
+			length = FIRMWARE_UPDATE_PAGE_SIZE;
+		if( received - firmware_update.programmed < length )
+			return 1;
+
+		uint32_t address = FIRMWARE_UPDATE_BANK_SIZE + firmware_update.programmed;
+		if( (address % FIRMWARE_UPDATE_BLOCK_SIZE) == 0 && !NvmCommand(address, NVMCTRL_CTRLB_CMD_EB, 1) )
+		{
+			ReplyLocked(FIRMWARE_UPDATE_FLASH_ERROR, address);
+			return 0;
+		}
+		const uint8_t* data = &firmware_update.ring[firmware_update.programmed % FIRMWARE_UPDATE_BUFFER];
+		if( !NvmProgramPage(address, data, length, 1) )
+		{
+			ReplyLocked(FIRMWARE_UPDATE_FLASH_ERROR, address);
+			return 0;
+		}
+		firmware_update.programmed += length;
+
+		//the page is free for the PC to fill again
+		LOCK_TCPIP_CORE();
+		if( firmware_update.pcb != NULL )
+			tcp_recved(firmware_update.pcb, length);
+		UNLOCK_TCPIP_CORE();
+	}
+
+	//what the PC sent against what is in the flash now, not what arrived
+	_cmcc_invalidate_all(CMCC);
+	//on the DSU, the table would take the core for tens of ms
+	uint32_t crc = Crc32((const uint8_t*)FIRMWARE_UPDATE_BANK_SIZE, firmware_update.length);
+	if( crc != firmware_update.crc )
+		ReplyLocked(FIRMWARE_UPDATE_CRC_MISMATCH, crc);
+	else
+		Install();
+	return 0;
+}
+
+static void FirmwareUpdateTask(void* p)
+{
+	while( 1 )
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		uint8_t state = __atomic_load_n(&firmware_update.state, __ATOMIC_ACQUIRE);
+		if( state == FIRMWARE_UPDATE_RECEIVING && ProgramReceived() )
+			continue;
+		//over, an aborted one leaves the other bank half written, nothing
+		//boots it
+		if( state != FIRMWARE_UPDATE_IDLE )
+			__atomic_store_n(&firmware_update.state, FIRMWARE_UPDATE_IDLE, __ATOMIC_RELEASE);
+	}
+}
+
+//The connection is gone, an update in progress goes with it
+static void Abandon()
+{
+	firmware_update.pcb = NULL;
+	if( __atomic_load_n(&firmware_update.state, __ATOMIC_ACQUIRE) == FIRMWARE_UPDATE_RECEIVING )
+	{
+		__atomic_store_n(&firmware_update.state, FIRMWARE_UPDATE_ABORTED, __ATOMIC_RELEASE);
+		xTaskNotifyGive(firmware_update.task);
+	}
+}
+
+static void Drop(struct tcp_pcb* pcb)
+{
+	tcp_arg(pcb, NULL);
+	tcp_recv(pcb, NULL);
+	tcp_err(pcb, NULL);
+	tcp_poll(pcb, NULL, 0);
+	Abandon();
+}
+
+static uint8_t TakeHeader(struct tcp_pcb* pcb)
+{
+	const uint8_t* header = firmware_update.header;
+	if( memcmp(header, "DBWF", 4) != 0 || header[4] != FIRMWARE_UPDATE_VERSION )
+	{
+		Reply(FIRMWARE_UPDATE_BAD_HEADER, 0);
+		return 0;
+	}
+	firmware_update.length = GetLE32(&header[8]);
+	firmware_update.crc = GetLE32(&header[12]);
+	if( firmware_update.length == 0 || firmware_update.length > FIRMWARE_UPDATE_MAX_IMAGE )
+	{
+		Reply(FIRMWARE_UPDATE_TOO_LARGE, firmware_update.length);
+		return 0;
+	}
+	if( !VehicleStopped() )
+	{
+		Reply(FIRMWARE_UPDATE_NOT_STOPPED, 0);
+		return 0;
+	}
+
+	LOG("firmware: receiving %lu bytes", firmware_update.length);
+	firmware_update.received = 0;
+	firmware_update.programmed = 0;
+	__atomic_store_n(&firmware_update.state, FIRMWARE_UPDATE_RECEIVING, __ATOMIC_RELEASE);
+	return 1;
+}
+
+static err_t UpdateReceive(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err)
+{
+	if( p == NULL )
+	{
+		//a PC that shuts its side down after the image still gets the reply
+		if( __atomic_load_n(&firmware_update.state, __ATOMIC_ACQUIRE) == FIRMWARE_UPDATE_RECEIVING
+			&& firmware_update.received == firmware_update.length )
+			return ERR_OK;
+		Drop(pcb);
+		if( tcp_close(pcb) == ERR_OK )
+			return ERR_OK;
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	firmware_update.idle_polls = 0;
+	uint16_t offset = 0;
+	//the header and anything past the image are taken in right away, the
+	//image as it is programmed
+	uint16_t consumed = 0;
+	if( firmware_update.header_length < FIRMWARE_UPDATE_HEADER_SIZE )
+	{
+		uint16_t length = FIRMWARE_UPDATE_HEADER_SIZE - firmware_update.header_length;
+		if( length > p->tot_len )
+			length = p->tot_len;
+		pbuf_copy_partial(p, &firmware_update.header[firmware_update.header_length], length, 0);
+		firmware_update.header_length += length;
+		offset = length;
+		consumed = length;
+		if( firmware_update.header_length == FIRMWARE_UPDATE_HEADER_SIZE && !TakeHeader(pcb) )
+		{
+			pbuf_free(p);
+			//Reply closed it
+			return ERR_OK;
+		}
+	}
+
+	if( __atomic_load_n(&firmware_update.state, __ATOMIC_ACQUIRE) == FIRMWARE_UPDATE_RECEIVING )
+	{
+		uint32_t received = firmware_update.received;
+		uint32_t length = p->tot_len - offset;
+		if( length > firmware_update.length - received )
+			length = firmware_update.length - received;
+		//at most the window is outstanding, and the ring holds that much
+		while( length )
+		{
+			uint32_t at = received % FIRMWARE_UPDATE_BUFFER;
+			uint32_t span = FIRMWARE_UPDATE_BUFFER - at;
+			if( span > length )
+				span = length;
+			pbuf_copy_partial(p, &firmware_update.ring[at], span, offset);
+			offset += span;
+			received += span;
+			length -= span;
+		}
+		__atomic_store_n(&firmware_update.received, received, __ATOMIC_RELEASE);
+		xTaskNotifyGive(firmware_update.task);
+	}
+	consumed += p->tot_len - offset;
+	if( consumed )
+		tcp_recved(pcb, consumed);
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+static err_t UpdatePoll(void* arg, struct tcp_pcb* pcb)
+{
+	if( ++firmware_update.idle_polls * FIRMWARE_UPDATE_POLL_INTERVAL / 2 >= FIRMWARE_UPDATE_IDLE_TIMEOUT )
+	{
+		Drop(pcb);
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+	return ERR_OK;
+}
+
+//lwIP has freed the pcb already
+static void UpdateError(void* arg, err_t err)
+{
+	if( arg != NULL )
+		Abandon();
+}
+
+static err_t UpdateAccept(void* arg, struct tcp_pcb* pcb, err_t err)
+{
+	tcp_accepted(firmware_update.listen_pcb);
+	if( err != ERR_OK )
+	{
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+	//one at a time, the second is told so
+	if( firmware_update.pcb != NULL || __atomic_load_n(&firmware_update.state, __ATOMIC_ACQUIRE) != FIRMWARE_UPDATE_IDLE )
+	{
+		uint8_t reply[FIRMWARE_UPDATE_REPLY_SIZE] = { FIRMWARE_UPDATE_BUSY };
+		tcp_write(pcb, reply, sizeof(reply), TCP_WRITE_FLAG_COPY);
+		if( tcp_close(pcb) == ERR_OK )
+			return ERR_OK;
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	firmware_update.pcb = pcb;
+	firmware_update.header_length = 0;
+	firmware_update.idle_polls = 0;
+	//the control channel goes first
+	tcp_setprio(pcb, TCP_PRIO_MIN);
+	tcp_arg(pcb, &firmware_update);
+	tcp_recv(pcb, UpdateReceive);
+	tcp_err(pcb, UpdateError);
+	tcp_poll(pcb, UpdatePoll, FIRMWARE_UPDATE_POLL_INTERVAL);
+	return ERR_OK;
+}
+
+void FirmwareUpdateBoot()
+{
+	if( firmware_trial.magic == FIRMWARE_UPDATE_ROLLBACK_MAGIC )
+	{
+		//back in the previous image
+		firmware_trial.magic = 0;
+		EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_ROLLED_BACK, firmware_trial.crc);
+		return;
+	}
+	if( firmware_trial.magic != FIRMWARE_UPDATE_TRIAL_MAGIC )
+		return;
+
+	if( ++firmware_trial.boots > FIRMWARE_UPDATE_BOOT_TRIES )
+	{
+		firmware_trial.magic = FIRMWARE_UPDATE_ROLLBACK_MAGIC;
+		EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_ROLLBACK, firmware_trial.crc);
+		SwapBanks();
+	}
+	EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_TRIAL, firmware_trial.boots);
+}
+
+void FirmwareUpdateConfirm()
+{
+	if( firmware_trial.magic != FIRMWARE_UPDATE_TRIAL_MAGIC )
+		return;
+	firmware_trial.magic = 0;
+	EventLogWrite(EVENT_LOG_FIRMWARE, EVENT_LOG_FIRMWARE_CONFIRMED, firmware_trial.crc);
+}
+
+void FirmwareUpdateInit()
+{
+	xTaskCreate(FirmwareUpdateTask, "Firmware", TASK_STACK_FIRMWARE_UPDATE, NULL, TASK_PRIORITY_FIRMWARE_UPDATE,
+		&firmware_update.task);
+}
+
+uint8_t FirmwareUpdateBusy()
+{
+	return __atomic_load_n(&firmware_update.state, __ATOMIC_ACQUIRE) != FIRMWARE_UPDATE_IDLE;
+}
+
+void FirmwareUpdateStart(void* ctx)
+{
+	firmware_update.ctx = (main_context_t*)ctx;
+
+	//the half of this image in the other bank would be erased by the first update
+	uint32_t image_end = (uint32_t)&_etext + ((uint32_t)&_erelocate - (uint32_t)&_srelocate);
+	if( image_end > FIRMWARE_UPDATE_MAX_IMAGE )
+	{
+		LOG("firmware: this image is %lu bytes, over a bank, no updates", image_end);
+		return;
+	}
+	//carrying the calibration over would erase part of a larger SmartEEPROM
+	if( !ParamStoreFitsLayout() )
+	{
+		LOG("firmware: SmartEEPROM over %u blocks, no updates", PARAM_STORE_SMART_EEPROM_BLOCKS);
+		return;
+	}
+
+	struct tcp_pcb* pcb = tcp_new();
+	if( pcb == NULL || tcp_bind(pcb, IP_ADDR_ANY, FIRMWARE_UPDATE_PORT) != ERR_OK )
+	{
+		LOG("Firmware update bind error");
+		if( pcb != NULL )
+			tcp_close(pcb);
+		return;
+	}
+	firmware_update.listen_pcb = tcp_listen(pcb);
+	if( firmware_update.listen_pcb == NULL )
+	{
+		LOG("Firmware update listen error");
+		tcp_close(pcb);
+		return;
+	}
+	tcp_accept(firmware_update.listen_pcb, UpdateAccept);
+	LOG("firmware: bank %s running, updates on port %u", hri_nvmctrl_get_STATUS_AFIRST_bit(NVMCTRL) ? "A" : "B",
+		FIRMWARE_UPDATE_PORT);
+}
+
+#else
+
+void FirmwareUpdateBoot()
+{
+}
+
+void FirmwareUpdateConfirm()
+{
+}
+
+void FirmwareUpdateInit()
+{
+}
+
+uint8_t FirmwareUpdateBusy()
+{
+	return 0;
+}
+
+void FirmwareUpdateStart(void* ctx)
+{
+}
+
+#endif
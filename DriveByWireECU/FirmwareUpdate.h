@@ -0,0 +1,161 @@
+/*
+ * FirmwareUpdate.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef FIRMWAREUPDATE_H_
+#define FIRMWAREUPDATE_H_
+
+#include <stdint.h>
+#include "lwip/opt.h"
+#include "ControlCore.h"
+#include "SteeringCalibration.h"
+
+//Firmware updates over Ethernet into the second flash bank, without JTAG.
+//
+//The SAME54's 1MB flash is two banks of 512KB. The one running is always
+//mapped at 0, the other at FIRMWARE_UPDATE_BANK_SIZE, and the NVMCTRL can
+//write one while the core runs from the other. The PC connects to
+//FIRMWARE_UPDATE_PORT and sends a FIRMWARE_UPDATE_HEADER_SIZE header, then
+//the image, the .bin of any build, linked for 0 like every build is:
+//
+//	0	"DBWF"
+//	4	FIRMWARE_UPDATE_VERSION
+//	5	0, 0, 0
+//	8	image length, LE32
+//	12	CRC-32 of the image (zlib's), LE32
+//
+//The image goes into a FIRMWARE_UPDATE_BUFFER byte ring in the tcpip
+//thread and the update task programs it out of there a page at a time,
+//erasing each block as the writes reach it, and reads every page back.
+//The TCP window only reopens for bytes that are programmed, so the ring
+//never overflows and the PC sends as fast as the flash takes it, while a
+//page is programmed the next ones arrive. Once the last is in, the CRC of
+//the whole image is taken out of the flash. A match is answered, and after
+//FIRMWARE_UPDATE_SWAP_DELAY ms for the answer to get out NVMCTRL BKSWRST
+//swaps the banks and resets into the new image. Anything else is answered
+//with what failed and leaves the running image alone.
+//
+//The answer is FIRMWARE_UPDATE_REPLY_SIZE bytes before the ECU closes: a
+//firmware_update_status_t, 0, 0, 0, and a value, LE32, for a flash error
+//its address, otherwise the bytes programmed.
+//
+//Updates are only taken while the cart is Disabled or in Estop, and that
+//is checked again before the swap: the swap resets the ECU, which cuts
+//the outputs like any reset. The top FIRMWARE_UPDATE_RESERVED bytes of
+//each bank are never written, they hold the SmartEEPROM and the steering
+//calibration, which is copied to the other bank before the swap so it is
+//where it was after it. An image, and the running one, has to fit a bank
+//less those.
+//
+//A swap starts a trial. The trial record in the backup RAM counts the
+//boots of the new image, and a boot that is not confirmed within
+//FIRMWARE_UPDATE_CONFIRM_TIME ms of control cycles, a watchdog reset or a
+//fault, counts against it. After FIRMWARE_UPDATE_BOOT_TRIES of those the
+//banks are swapped back to the previous image, which logs the rollback.
+//A power cycle loses the record along with the backup RAM, the image
+//running then stays. Every step is an EVENT_LOG_FIRMWARE entry.
+//
+//Runs on the raw TCP API in the tcpip thread, one update at a time, the
+//flash writes in their own task at the lowest priority.
+
+#ifndef FIRMWARE_UPDATE_ENABLE
+#define FIRMWARE_UPDATE_ENABLE 0
+#endif
+
+#ifndef FIRMWARE_UPDATE_PORT
+#define FIRMWARE_UPDATE_PORT 12094
+#endif
+
+#define FIRMWARE_UPDATE_VERSION 1
+#define FIRMWARE_UPDATE_HEADER_SIZE 16
+#define FIRMWARE_UPDATE_REPLY_SIZE 8
+
+#define FIRMWARE_UPDATE_BANK_SIZE 0x80000
+#define FIRMWARE_UPDATE_BLOCK_SIZE 8192
+#define FIRMWARE_UPDATE_PAGE_SIZE 512
+
+//Top of each bank the update leaves alone, whole blocks: the SmartEEPROM
+//(ParamStore.h) and the steering calibration block below it
+#ifndef FIRMWARE_UPDATE_RESERVED
+#define FIRMWARE_UPDATE_RESERVED (PARAM_STORE_SMART_EEPROM_SIZE + STEERING_CALIBRATION_BLOCK_SIZE)
+#endif
+
+#define FIRMWARE_UPDATE_MAX_IMAGE (FIRMWARE_UPDATE_BANK_SIZE - FIRMWARE_UPDATE_RESERVED)
+
+//Bytes received ahead of the flash, at least the TCP window
+#ifndef FIRMWARE_UPDATE_BUFFER
+#define FIRMWARE_UPDATE_BUFFER 8192
+#endif
+
+//ms between the answer and the swap
+#ifndef FIRMWARE_UPDATE_SWAP_DELAY
+#define FIRMWARE_UPDATE_SWAP_DELAY 200
+#endif
+
+//ms of control cycles that confirm a new image
+#ifndef FIRMWARE_UPDATE_CONFIRM_TIME
+#define FIRMWARE_UPDATE_CONFIRM_TIME 10000
+#endif
+#define FIRMWARE_UPDATE_CONFIRM_CYCLES (FIRMWARE_UPDATE_CONFIRM_TIME * CONTROL_CYCLES_PER_MS)
+
+//Unconfirmed boots of a new image before it is rolled back
+#ifndef FIRMWARE_UPDATE_BOOT_TRIES
+#define FIRMWARE_UPDATE_BOOT_TRIES 3
+#endif
+
+//s without data after which an update is dropped
+#ifndef FIRMWARE_UPDATE_IDLE_TIMEOUT
+#define FIRMWARE_UPDATE_IDLE_TIMEOUT 5
+#endif
+
+typedef enum firmware_update_status_t
+{
+	//verified, the banks are swapped next
+	FIRMWARE_UPDATE_OK = 0,
+	//not "DBWF" or of another version
+	FIRMWARE_UPDATE_BAD_HEADER,
+	//empty or over FIRMWARE_UPDATE_MAX_IMAGE
+	FIRMWARE_UPDATE_TOO_LARGE,
+	//the cart is not Disabled or in Estop
+	FIRMWARE_UPDATE_NOT_STOPPED,
+	//an erase or write failed or did not read back
+	FIRMWARE_UPDATE_FLASH_ERROR,
+	FIRMWARE_UPDATE_CRC_MISMATCH,
+	//another update is running
+	FIRMWARE_UPDATE_BUSY,
+} firmware_update_status_t;
+
+//arg of EVENT_LOG_FIRMWARE, value: the image CRC, for a failure the
+//reply's value
+#define EVENT_LOG_FIRMWARE_SWAP 0
+#define EVENT_LOG_FIRMWARE_TRIAL 1
+#define EVENT_LOG_FIRMWARE_CONFIRMED 2
+#define EVENT_LOG_FIRMWARE_ROLLBACK 3
+#define EVENT_LOG_FIRMWARE_ROLLED_BACK 4
+//plus the firmware_update_status_t
+#define EVENT_LOG_FIRMWARE_FAILED 0x10
+
+//Counts a boot of an image on trial and swaps back after too many. Call
+//early at boot, after EventLogInit.
+void FirmwareUpdateBoot();
+
+//Ends the trial of a new image. main_task calls it after
+//FIRMWARE_UPDATE_CONFIRM_CYCLES cycles.
+void FirmwareUpdateConfirm();
+
+//Creates the update task. Call once before the scheduler starts.
+void FirmwareUpdateInit();
+
+//1 while an update is being received or installed, 0 without
+//FIRMWARE_UPDATE_ENABLE. Any task.
+uint8_t FirmwareUpdateBusy();
+
+//Accepts update connections on FIRMWARE_UPDATE_PORT, one image at a time.
+//Does nothing if this image is too large for the other bank to hold a copy.
+//ctx is the main_context_t whose vehicle mode gates an update. Runs in the
+//tcpip thread, queued with tcpip_callback.
+void FirmwareUpdateStart(void* ctx);
+
+#endif /* FIRMWAREUPDATE_H_ */
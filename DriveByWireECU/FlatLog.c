@@ -0,0 +1,59 @@
+/*
+ * FlatLog.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stddef.h>
+#include <string.h>
+#include "FlatLog.h"
+#include "Crc32.h"
+#include "FastCode.h"
+
+void FlatLogBegin(flat_log_block_t* block, uint32_t block_size, uint32_t schema, uint16_t record_size,
+	uint32_t dropped)
+{
+	memset(block, 0, sizeof(*block));
+	block->magic = FLAT_LOG_MAGIC;
+	block->version = FLAT_LOG_VERSION;
+	block->header_size = sizeof(flat_log_block_t);
+	block->record_size = record_size;
+	block->block_size = block_size;
+	block->schema = schema;
+	block->dropped = dropped;
+}
+
+FAST_CODE void FlatLogAppend(flat_log_block_t* block, uint64_t time, uint32_t bytes)
+{
+	if( block->count == 0 )
+		block->first_time = time;
+	block->last_time = time;
+	block->count++;
+	block->bytes += bytes;
+}
+
+static uint32_t BlockCrc(const flat_log_block_t* block)
+{
+	uint32_t crc = Crc32Update(CRC32_INITIAL, block, offsetof(flat_log_block_t, crc));
+	return ~Crc32Update(crc, (const uint8_t*)block + sizeof(flat_log_block_t), block->bytes);
+}
+
+void FlatLogSeal(flat_log_block_t* block, uint32_t session, uint32_t sequence)
+{
+	memset(FlatLogEnd(block), 0, FlatLogRoom(block));
+	block->session = session;
+	block->sequence = sequence;
+	block->crc = BlockCrc(block);
+}
+
+uint8_t FlatLogHeaderValid(const flat_log_block_t* block, uint32_t block_size, uint32_t sequence)
+{
+	return block->magic == FLAT_LOG_MAGIC && block->version == FLAT_LOG_VERSION
+		&& block->header_size == sizeof(flat_log_block_t) && block->block_size == block_size
+		&& block->sequence == sequence && block->bytes <= FLAT_LOG_DATA_SIZE(block_size);
+}
+
+uint8_t FlatLogBlockValid(const flat_log_block_t* block, uint32_t block_size, uint32_t sequence)
+{
+	return FlatLogHeaderValid(block, block_size, sequence) && block->crc == BlockCrc(block);
+}
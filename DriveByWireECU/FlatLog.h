@@ -0,0 +1,116 @@
+/*
+ * FlatLog.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef FLATLOG_H_
+#define FLATLOG_H_
+
+#include <stdint.h>
+
+//Append-only log of fixed size records in fixed size blocks, one format for
+//everything the ECU records to a medium or dumps in bulk, read on the PC by
+//PythonTestScripts/flat_log.py.
+//
+//A log is a run of blocks of one size, a power of two from
+//FLAT_LOG_MIN_BLOCK, block n at n block sizes from where the log starts.
+//Each block is a flat_log_block_t and then count records of record_size
+//bytes, all of one schema, and zeroes to its end. A block only counts at
+//its own index, so the blocks of a log are a prefix of the medium: a writer
+//finds the end in log2(blocks) header reads and appends from there,
+//nothing written before is ever touched again, and a reader stops at the
+//first block that is not one. A block cut short by a reset fails its CRC.
+//
+//Every block says what its records are, the time range they cover and the
+//session, the boot, that wrote them. Sessions only grow along the log and
+//times only grow within a session, so a reader that maps a log of any size
+//seeks to a time by bisecting the block headers, and to record i of a
+//block at header_size + i * record_size.
+//
+//A block with record_size 0 holds records packed by DeltaCodec.h instead,
+//bytes of them. Those unpack from the start of their block, the time range
+//still seeks to the block.
+//
+//The writer fills a block in RAM and writes it out whole: FlatLogBegin,
+//FlatLogAppend per record, FlatLogSeal once it is full, at the index it
+//goes to. Begin and Append are a few stores, Seal zeroes the rest of the
+//block and sums it, for the task that writes it out.
+
+#define FLAT_LOG_MAGIC 0x46574244	//"DBWF"
+#define FLAT_LOG_VERSION 1
+#define FLAT_LOG_MIN_BLOCK 512
+
+//What the records of a block are. A record that changes layout gets a new
+//id, readers keep the old ones.
+typedef enum flat_log_schema_t
+{
+	//sd_log_record_t (SdLogger.h)
+	FLAT_LOG_SCHEMA_SD_RECORD = 1,
+	//control_record_t (ControlRecord.h), for host/ControlReplay
+	FLAT_LOG_SCHEMA_CONTROL_RECORD,
+} flat_log_schema_t;
+
+//Little endian as in RAM, 64 bytes
+typedef struct flat_log_block_t
+{
+	uint32_t magic;
+	uint8_t version;
+	//bytes of this header, the records start there
+	uint8_t header_size;
+	//0 when the records are packed
+	uint16_t record_size;
+	//us of the first and the last record on the writer's clock, which
+	//starts over with the session
+	uint64_t first_time;
+	uint64_t last_time;
+	//bytes, header included
+	uint32_t block_size;
+	uint32_t schema;
+	uint32_t session;
+	//index in the log, a block is only valid at its own
+	uint32_t sequence;
+	uint32_t count;
+	//record bytes after the header
+	uint32_t bytes;
+	//records the writer lost in the session before this block
+	uint32_t dropped;
+	uint32_t reserved[2];
+	//CRC-32 (Crc32.h) of the header up to here and the record bytes
+	uint32_t crc;
+} flat_log_block_t;
+
+//Record bytes a block has room for
+#define FLAT_LOG_DATA_SIZE(block_size) ((block_size) - sizeof(flat_log_block_t))
+
+//Starts an empty block in a buffer of block_size bytes. dropped is what
+//the writer lost so far.
+void FlatLogBegin(flat_log_block_t* block, uint32_t block_size, uint32_t schema, uint16_t record_size,
+	uint32_t dropped);
+
+//Where the next record goes, and the room there is for it
+static inline uint8_t* FlatLogEnd(flat_log_block_t* block)
+{
+	return (uint8_t*)block + sizeof(flat_log_block_t) + block->bytes;
+}
+
+static inline uint32_t FlatLogRoom(const flat_log_block_t* block)
+{
+	return FLAT_LOG_DATA_SIZE(block->block_size) - block->bytes;
+}
+
+//Counts a record of bytes written at FlatLogEnd, at time us
+void FlatLogAppend(flat_log_block_t* block, uint64_t time, uint32_t bytes);
+
+//Zeroes the block past its records and sums it, to be written at index
+//sequence of the log
+void FlatLogSeal(flat_log_block_t* block, uint32_t session, uint32_t sequence);
+
+//Whether a header is one of the log's at index sequence, for finding the
+//end of the log from the headers alone
+uint8_t FlatLogHeaderValid(const flat_log_block_t* block, uint32_t block_size, uint32_t sequence);
+
+//FlatLogHeaderValid and the CRC of the whole block right
+uint8_t FlatLogBlockValid(const flat_log_block_t* block, uint32_t block_size, uint32_t sequence);
+
+#endif /* FLATLOG_H_ */
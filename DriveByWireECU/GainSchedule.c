@@ -0,0 +1,68 @@
+/*
+ * GainSchedule.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "GainSchedule.h"
+#include "FastCode.h"
+
+void GainScheduleInit(gain_schedule_t* schedule, const gain_schedule_point_t* points, uint8_t count, float start, float spacing)
+{
+	schedule->points = points;
+	schedule->count = count;
+	schedule->start = start;
+	schedule->inverse_spacing = 1.0f / spacing;
+}
+
+//Index of the point below x and how far x is toward the next one (0 - 1).
+//The last interval ends on the last point so the next one always exists.
+FAST_CODE static uint8_t FindInterval(const gain_schedule_t* schedule, float x, float* fraction)
+{
+	float position = (x - schedule->start) * schedule->inverse_spacing;
+	uint8_t last = schedule->count - 1;
+
+	//NaN lands on the first point too
+	if( last == 0 || !(position > 0.0f) )
+	{
+		*fraction = 0.0f;
+		return 0;
+	}
+	if( position >= last )
+	{
+		*fraction = 1.0f;
+		return last - 1;
+	}
+	uint8_t index = (uint8_t)position;
+	*fraction = position - index;
+	return index;
+}
+
+static inline float Interpolate(float low, float high, float fraction)
+{
+	return low + (high - low) * fraction;
+}
+
+FAST_CODE void GainScheduleLookup(const gain_schedule_t* schedule, float x, gain_schedule_point_t* point)
+{
+	float fraction;
+	uint8_t index = FindInterval(schedule, x, &fraction);
+	const gain_schedule_point_t* low = &schedule->points[index];
+	//a one point table has no interval, fraction is 0 and only low counts
+	const gain_schedule_point_t* high = schedule->count > 1 ? low + 1 : low;
+
+	point->p = Interpolate(low->p, high->p, fraction);
+	point->i = Interpolate(low->i, high->i, fraction);
+	point->d = Interpolate(low->d, high->d, fraction);
+	point->feedforward = Interpolate(low->feedforward, high->feedforward, fraction);
+}
+
+FAST_CODE float GainScheduleFeedforward(const gain_schedule_t* schedule, float x)
+{
+	float fraction;
+	uint8_t index = FindInterval(schedule, x, &fraction);
+	const gain_schedule_point_t* low = &schedule->points[index];
+	const gain_schedule_point_t* high = schedule->count > 1 ? low + 1 : low;
+
+	return Interpolate(low->feedforward, high->feedforward, fraction);
+}
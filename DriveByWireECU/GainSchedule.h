@@ -0,0 +1,48 @@
+/*
+ * GainSchedule.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef GAINSCHEDULE_H_
+#define GAINSCHEDULE_H_
+
+#include <stdint.h>
+
+//PID gains and a feedforward that change with an operating point, for
+//example the vehicle speed.
+//The table holds one point at each of count evenly spaced values of the
+//operating point, from start in steps of spacing. A lookup finds its
+//interval with one multiply and interpolates linearly between the two
+//points around it, so it costs the same wherever it lands. Values outside
+//the table use its first or last point.
+//
+//feedforward is the output that holds the process at that operating point
+//on its own, looked up by the setpoint, the PID only corrects what it misses.
+
+typedef struct gain_schedule_point_t
+{
+	float p;
+	float i;
+	float d;
+	float feedforward;
+} gain_schedule_point_t;
+
+typedef struct gain_schedule_t
+{
+	const gain_schedule_point_t* points;
+	uint8_t count;
+	float start;
+	float inverse_spacing;
+} gain_schedule_t;
+
+//points is referenced, not copied. count has to be at least 1, spacing above 0.
+void GainScheduleInit(gain_schedule_t* schedule, const gain_schedule_point_t* points, uint8_t count, float start, float spacing);
+
+//Gains and feedforward interpolated at x
+void GainScheduleLookup(const gain_schedule_t* schedule, float x, gain_schedule_point_t* point);
+
+//Only the feedforward interpolated at x
+float GainScheduleFeedforward(const gain_schedule_t* schedule, float x);
+
+#endif /* GAINSCHEDULE_H_ */
@@ -0,0 +1,78 @@
+/*
+ * GpioBatch.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef GPIOBATCH_H_
+#define GPIOBATCH_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <hal_gpio.h>
+
+//Output pins changed together, and single pins changed fast, through the
+//PORT's IOBUS alias. The CPU reaches it in a single cycle, where the APB
+//PORT hal_gpio goes through costs a bridge access per write.
+//
+//A batch collects pin levels and applies each port with one OUTTGL write
+//of the pins whose level differs, so every pin of a port changes on the
+//same clock. Complementary pins never pass through a state with both on
+//or both off. Pins outside the batch are not touched, whatever else
+//drives them, but a pin in the batch must not be written by an interrupt
+//between GpioBatchApply's read of OUT and its write.
+
+//PORT registers on the IOBUS, the same as PORT on the APB
+#ifndef GPIO_BATCH_IOBUS
+#define GPIO_BATCH_IOBUS ((Port*)0x60000000UL)
+#endif
+
+//ports A to D
+#define GPIO_BATCH_PORTS (GPIO_PORTD + 1)
+
+typedef struct gpio_batch_t
+{
+	//pins in the batch, and their levels, by port
+	uint32_t mask[GPIO_BATCH_PORTS];
+	uint32_t level[GPIO_BATCH_PORTS];
+} gpio_batch_t;
+
+static inline void GpioBatchInit(gpio_batch_t* batch)
+{
+	memset(batch, 0, sizeof(*batch));
+}
+
+//pin as in atmel_start_pins.h, non-zero level for high
+static inline void GpioBatchLevel(gpio_batch_t* batch, uint32_t pin, int level)
+{
+	uint32_t bit = 1UL << GPIO_PIN(pin);
+	batch->mask[GPIO_PORT(pin)] |= bit;
+	if( level )
+		batch->level[GPIO_PORT(pin)] |= bit;
+	else
+		batch->level[GPIO_PORT(pin)] &= ~bit;
+}
+
+static inline void GpioBatchApply(const gpio_batch_t* batch)
+{
+	for(int port = 0; port < GPIO_BATCH_PORTS; ++port)
+	{
+		if( batch->mask[port] == 0 )
+			continue;
+		uint32_t toggle = (GPIO_BATCH_IOBUS->Group[port].OUT.reg ^ batch->level[port]) & batch->mask[port];
+		if( toggle )
+			GPIO_BATCH_IOBUS->Group[port].OUTTGL.reg = toggle;
+	}
+}
+
+//gpio_set_pin_level on the IOBUS, safe against writes to the port's other
+//pins from anywhere
+static inline void GpioFastLevel(uint32_t pin, int level)
+{
+	if( level )
+		GPIO_BATCH_IOBUS->Group[GPIO_PORT(pin)].OUTSET.reg = 1UL << GPIO_PIN(pin);
+	else
+		GPIO_BATCH_IOBUS->Group[GPIO_PORT(pin)].OUTCLR.reg = 1UL << GPIO_PIN(pin);
+}
+
+#endif /* GPIOBATCH_H_ */
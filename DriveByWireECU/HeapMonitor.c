@@ -0,0 +1,95 @@
+/*
+ * HeapMonitor.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include "HeapMonitor.h"
+#include "Log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+static heap_monitor_stats_t heap_stats =
+{
+	.total = configTOTAL_HEAP_SIZE,
+	.free = configTOTAL_HEAP_SIZE,
+	.min_free = configTOTAL_HEAP_SIZE,
+};
+static size_t last_failed_size;
+static uint8_t boot_done;
+
+void HeapMonitorAllocated(void* block, size_t size)
+{
+	if( block == NULL )
+	{
+		//vApplicationMallocFailedHook follows and does the counting
+		last_failed_size = size;
+		return;
+	}
+
+	heap_stats.allocations++;
+	if( boot_done )
+		heap_stats.runtime_allocations++;
+
+	heap_stats.free = xPortGetFreeHeapSize();
+	if( heap_stats.free < heap_stats.min_free )
+		heap_stats.min_free = heap_stats.free;
+}
+
+void HeapMonitorFreed(void* block, size_t size)
+{
+	heap_stats.frees++;
+	heap_stats.free = xPortGetFreeHeapSize();
+}
+
+void vApplicationMallocFailedHook(void)
+{
+	heap_stats.failed++;
+	if( last_failed_size > heap_stats.largest_failed )
+		heap_stats.largest_failed = last_failed_size;
+
+	if( boot_done )
+		return;
+
+	//The log service may never run again, this one goes out synchronously.
+	//printf may allocate itself, only ever report the first failure
+	static uint8_t reported;
+	if( !reported )
+	{
+		reported = 1;
+		printf("RTOS heap exhausted during boot, %u bytes requested, %u free\r\n",
+			(unsigned)last_failed_size, (unsigned)xPortGetFreeHeapSize());
+	}
+	taskDISABLE_INTERRUPTS();
+	for(;;)
+		;
+}
+
+void HeapMonitorEndBoot()
+{
+	vTaskSuspendAll();
+	heap_stats.boot_used = heap_stats.total - xPortGetFreeHeapSize();
+	boot_done = 1;
+	xTaskResumeAll();
+
+	HeapMonitorReport();
+}
+
+void HeapMonitorGetStats(heap_monitor_stats_t* stats)
+{
+	vTaskSuspendAll();
+	*stats = heap_stats;
+	xTaskResumeAll();
+}
+
+void HeapMonitorReport()
+{
+	heap_monitor_stats_t stats;
+	HeapMonitorGetStats(&stats);
+
+	LOG("RTOS heap: %lu of %lu bytes used at boot, %lu free, %lu lowest",
+		stats.boot_used, stats.total, stats.free, stats.min_free);
+	LOG("RTOS heap: %lu allocations (%lu after boot), %lu frees, %lu failed, largest failed %lu",
+		stats.allocations, stats.runtime_allocations, stats.frees, stats.failed, stats.largest_failed);
+}
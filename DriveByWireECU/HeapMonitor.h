@@ -0,0 +1,55 @@
+/*
+ * HeapMonitor.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef HEAPMONITOR_H_
+#define HEAPMONITOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Bookkeeping for the RTOS heap (heap_2, configTOTAL_HEAP_SIZE).
+//heap_2 never merges free blocks, so the heap only stays healthy if
+//everything is allocated once while booting and blocks that are freed at
+//run time come back at the same size. The monitor records both phases so
+//the heap can be sized from a real boot and run time allocations can be
+//spotted.
+//
+//An allocation that fails while booting halts the ECU right there, before
+//any actuator is driven, instead of leaving it to run without a task or a
+//queue. After HeapMonitorEndBoot a failure is only counted, the caller
+//handles it.
+typedef struct heap_monitor_stats_t
+{
+	size_t total;
+	size_t free;
+	//lowest free ever seen, the heap's high water mark
+	size_t min_free;
+	//in use when boot ended, 0 while still booting
+	size_t boot_used;
+	uint32_t allocations;
+	uint32_t frees;
+	//allocations made after the end of boot
+	uint32_t runtime_allocations;
+	uint32_t failed;
+	//bytes the largest failed request asked for, block header included
+	size_t largest_failed;
+} heap_monitor_stats_t;
+
+//Call once when every task, queue and network buffer the ECU needs has
+//been created. Logs the boot report (Log.h).
+void HeapMonitorEndBoot();
+
+void HeapMonitorGetStats(heap_monitor_stats_t* stats);
+
+//Logs the current stats (Log.h)
+void HeapMonitorReport();
+
+//traceMALLOC and traceFREE hooks (FreeRTOSConfig.h), called by the heap
+//with the scheduler suspended. Not for direct use.
+void HeapMonitorAllocated(void* block, size_t size);
+void HeapMonitorFreed(void* block, size_t size);
+
+#endif /* HEAPMONITOR_H_ */
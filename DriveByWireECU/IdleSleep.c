@@ -0,0 +1,37 @@
+/*
+ * IdleSleep.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hpl_sleep.h>
+#include <hri_pm_e54.h>
+#include "IdleSleep.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "ParamStore.h"
+#include "RamEcc.h"
+#include "SteeringSweep.h"
+
+void IdleSleepInit()
+{
+	//set once, so the hook does not wait on the register bridge every time
+	_set_sleep_mode(PM_SLEEPCFG_SLEEPMODE_IDLE_Val);
+}
+
+//configUSE_IDLE_HOOK, called over and over from the idle task
+void vApplicationIdleHook(void)
+{
+	//saves go out in whatever time nothing else wants, the calibration's
+	//before the parameters', which hold back while the NVMCTRL is busy
+	SteeringSweepService();
+	ParamStoreService();
+	//then one slice of the RAM scrub per tick
+	RamEccScrub();
+
+#if IDLE_SLEEP_ENABLE
+	//An interrupt that readies a task pends a context switch, which runs
+	//as soon as it returns, so there is no window to sleep through.
+	_go_to_sleep();
+#endif
+}
@@ -0,0 +1,31 @@
+/*
+ * IdleSleep.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef IDLESLEEP_H_
+#define IDLESLEEP_H_
+
+//Sleeps the core whenever no task is ready to run.
+//The idle hook puts the core in the IDLE sleep mode with WFI. The bus and
+//peripheral clocks keep running, so SysTick, GMAC, DMAC, CAN and the ADC
+//scans carry on and any of their interrupts wakes the core within a few
+//cycles. Nothing has to be restored on wakeup, the interrupt just runs.
+//
+//Tick suppression (configUSE_TICKLESS_IDLE) is left off. main_task runs
+//every tick, so the kernel never idles long enough to skip one.
+//
+//The time from the tick interrupt to main_task running, wakeup included,
+//is kept as PROFILER_STAGE_WAKE (Profiler.h).
+
+//Set to 0 to keep the core spinning in the idle task
+#ifndef IDLE_SLEEP_ENABLE
+#define IDLE_SLEEP_ENABLE 1
+#endif
+
+//Selects the sleep mode used by the idle hook. Call once before the
+//scheduler starts.
+void IdleSleepInit();
+
+#endif /* IDLESLEEP_H_ */
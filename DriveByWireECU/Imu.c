@@ -0,0 +1,197 @@
+/*
+ * Imu.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hal_gpio.h>
+#include <hri_sercom_e54.h>
+#include <hri_gclk_e54.h>
+#include <hri_mclk_e54.h>
+#include "Imu.h"
+#include "DmaService.h"
+#include "FastCode.h"
+
+#define IMU_SERCOM SERCOM4
+//12MHz, like the other SERCOMs. SCK is GCLK2 / (2 * (BAUD + 1)), 6MHz,
+//the IMU takes up to 10MHz.
+#define IMU_GCLK_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define IMU_BAUD 0
+
+#define IMU_READ 0x80
+#define IMU_WHO_AM_I 0x0F
+#define IMU_WHO_AM_I_VALUE 0x6B
+#define IMU_CTRL1_XL 0x10
+#define IMU_CTRL2_G 0x11
+#define IMU_CTRL3_C 0x12
+//gyro x, y, z then accel x, y, z, low byte first
+#define IMU_OUTX_L_G 0x22
+
+//1.66kHz and +/-4g
+#define IMU_CTRL1_XL_VALUE 0x88
+//1.66kHz and +/-250 deg/s
+#define IMU_CTRL2_G_VALUE 0x80
+//block data update, so a burst never mixes two outputs, and address
+//increment
+#define IMU_CTRL3_C_VALUE 0x44
+
+//deg/s and m/s^2 per LSB at those full scales
+#define IMU_GYRO_SCALE 0.00875f
+#define IMU_ACCEL_SCALE (0.000122f * 9.80665f)
+
+//the address byte, then the 12 output bytes
+#define IMU_BURST_SIZE 13
+
+//dummy bytes -> DATA on data register empty, DATA -> rx on receive complete
+static const dma_channel_config_t imu_tx_config =
+{
+	SERCOM4_DMAC_ID_TX, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_BYTE_Val, 1, 0, 0, 0
+};
+//ahead of TX, a received byte is always taken before the next one is in
+static const dma_channel_config_t imu_rx_config =
+{
+	SERCOM4_DMAC_ID_RX, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_BYTE_Val, 0, 1, 1, 0
+};
+
+typedef struct imu_t
+{
+	int8_t tx_dma;
+	int8_t rx_dma;
+	uint8_t enabled;
+	//bursts started by main_task and ended by the RX interrupt, failed on a
+	//bus error
+	uint32_t started;
+	volatile uint32_t completed;
+	volatile uint8_t failed;
+	uint32_t missed;
+	uint8_t tx[IMU_BURST_SIZE];
+	uint8_t rx[IMU_BURST_SIZE];
+} imu_t;
+
+static imu_t imu = { -1, -1, 0, 0, 0, 0, 0, { IMU_READ | IMU_OUTX_L_G } };
+
+static void BurstDone(void* arg, uint8_t error)
+{
+	gpio_set_pin_level(IMU_CS_PIN, true);
+	imu.failed = error;
+	__atomic_store_n(&imu.completed, imu.started, __ATOMIC_RELEASE);
+}
+
+//One byte each way, only at init before the DMAC takes over
+static uint8_t Transfer(uint8_t value)
+{
+	hri_sercomspi_write_DATA_reg(IMU_SERCOM, value);
+	while( !hri_sercomspi_get_INTFLAG_RXC_bit(IMU_SERCOM) )
+		;
+	return (uint8_t)hri_sercomspi_read_DATA_reg(IMU_SERCOM);
+}
+
+static uint8_t ReadRegister(uint8_t address)
+{
+	gpio_set_pin_level(IMU_CS_PIN, false);
+	Transfer(IMU_READ | address);
+	uint8_t value = Transfer(0);
+	gpio_set_pin_level(IMU_CS_PIN, true);
+	return value;
+}
+
+static void WriteRegister(uint8_t address, uint8_t value)
+{
+	gpio_set_pin_level(IMU_CS_PIN, false);
+	Transfer(address);
+	Transfer(value);
+	gpio_set_pin_level(IMU_CS_PIN, true);
+}
+
+static void InitSpi()
+{
+	gpio_set_pin_function(GPIO(GPIO_PORTB, 26), PINMUX_PB26D_SERCOM4_PAD1);
+	gpio_set_pin_function(GPIO(GPIO_PORTB, 27), PINMUX_PB27D_SERCOM4_PAD0);
+	gpio_set_pin_function(GPIO(GPIO_PORTB, 29), PINMUX_PB29D_SERCOM4_PAD3);
+	gpio_set_pin_level(IMU_CS_PIN, true);
+	gpio_set_pin_direction(IMU_CS_PIN, GPIO_DIRECTION_OUT);
+	gpio_set_pin_function(IMU_CS_PIN, GPIO_PIN_FUNCTION_OFF);
+
+	hri_gclk_write_PCHCTRL_reg(GCLK, SERCOM4_GCLK_ID_CORE, IMU_GCLK_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	hri_mclk_set_APBDMASK_SERCOM4_bit(MCLK);
+
+	hri_sercomspi_write_CTRLA_reg(IMU_SERCOM, SERCOM_SPI_CTRLA_SWRST);
+	//mode 3, MSB first, MOSI on PAD0 with SCK on PAD1, MISO on PAD3
+	hri_sercomspi_write_CTRLA_reg(IMU_SERCOM, SERCOM_SPI_CTRLA_MODE(3) | SERCOM_SPI_CTRLA_DOPO(0)
+		| SERCOM_SPI_CTRLA_DIPO(3) | SERCOM_SPI_CTRLA_CPOL | SERCOM_SPI_CTRLA_CPHA);
+	hri_sercomspi_write_CTRLB_reg(IMU_SERCOM, SERCOM_SPI_CTRLB_RXEN);
+	hri_sercomspi_write_BAUD_reg(IMU_SERCOM, IMU_BAUD);
+	hri_sercomspi_set_CTRLA_ENABLE_bit(IMU_SERCOM);
+}
+
+uint8_t ImuInit()
+{
+	InitSpi();
+
+	if( ReadRegister(IMU_WHO_AM_I) != IMU_WHO_AM_I_VALUE )
+		return 0;
+	WriteRegister(IMU_CTRL3_C, IMU_CTRL3_C_VALUE);
+	WriteRegister(IMU_CTRL1_XL, IMU_CTRL1_XL_VALUE);
+	WriteRegister(IMU_CTRL2_G, IMU_CTRL2_G_VALUE);
+
+	imu.rx_dma = DmaAllocate(&imu_rx_config, BurstDone, NULL);
+	imu.tx_dma = DmaAllocate(&imu_tx_config, NULL, NULL);
+	if( imu.rx_dma < 0 || imu.tx_dma < 0 )
+	{
+		if( imu.rx_dma >= 0 )
+			DmaFree(imu.rx_dma);
+		if( imu.tx_dma >= 0 )
+			DmaFree(imu.tx_dma);
+		return 0;
+	}
+	volatile void* data = &((Sercom*)IMU_SERCOM)->SPI.DATA.reg;
+	DmaSetBlock(imu.rx_dma, NULL, data, imu.rx, IMU_BURST_SIZE, NULL);
+	DmaSetBlock(imu.tx_dma, NULL, imu.tx, data, IMU_BURST_SIZE, NULL);
+	imu.enabled = 1;
+	return 1;
+}
+
+FAST_CODE void ImuStartRead()
+{
+	if( !imu.enabled )
+		return;
+	//a burst still running a cycle on is stuck, it restarts clean
+	if( __atomic_load_n(&imu.completed, __ATOMIC_ACQUIRE) != imu.started )
+	{
+		DmaStop(imu.tx_dma);
+		DmaStop(imu.rx_dma);
+		gpio_set_pin_level(IMU_CS_PIN, true);
+		while( hri_sercomspi_get_INTFLAG_RXC_bit(IMU_SERCOM) )
+			hri_sercomspi_read_DATA_reg(IMU_SERCOM);
+	}
+
+	//the blocks are as ImuInit set them, the channels only run them again
+	imu.started++;
+	gpio_set_pin_level(IMU_CS_PIN, false);
+	DmaStart(imu.rx_dma);
+	DmaStart(imu.tx_dma);
+}
+
+FAST_CODE uint8_t ImuRead(imu_sample_t* sample)
+{
+	if( !imu.enabled )
+		return 0;
+	if( __atomic_load_n(&imu.completed, __ATOMIC_ACQUIRE) != imu.started || imu.failed )
+	{
+		imu.missed++;
+		return 0;
+	}
+
+	const uint8_t* out = &imu.rx[1];
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		sample->gyro[axis] = (float)(int16_t)(out[axis * 2] | (out[axis * 2 + 1] << 8)) * IMU_GYRO_SCALE;
+		sample->accel[axis] = (float)(int16_t)(out[6 + axis * 2] | (out[6 + axis * 2 + 1] << 8)) * IMU_ACCEL_SCALE;
+	}
+	return 1;
+}
+
+uint32_t ImuMissed()
+{
+	return imu.missed;
+}
@@ -0,0 +1,57 @@
+/*
+ * Imu.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef IMU_H_
+#define IMU_H_
+
+#include <stdint.h>
+
+//A 6 axis IMU (ST ASM330LHH, the LSM6 register map) on SERCOM4 as SPI
+//master, read in one DMA burst per control cycle.
+//
+//main_task starts the burst as soon as it wakes for a cycle: chip select
+//goes low and two DMAC channels run the SPI, one feeding the command and
+//dummy bytes to DATA on every data register empty, the other taking every
+//received byte out of DATA. The CPU is not involved until the burst is
+//done and the RX channel's single interrupt raises chip select again. The
+//burst takes about 30 us at 6 MHz, the cycle reads the result well after
+//that, before the control stage. A burst that is not done by then is
+//counted as missed and the previous sample is kept, nothing waits on it.
+//
+//Pins of the SAM E54 Xplained Pro EXT1 header: SCK PB26, MOSI PB27,
+//MISO PB29, chip select on IMU_CS_PIN. The IMU's x axis points forward,
+//y to the left and z up.
+
+#ifndef IMU_CS_PIN
+#define IMU_CS_PIN GPIO(GPIO_PORTB, 14)
+#endif
+
+typedef struct imu_sample_t
+{
+	//deg/s about x, y and z, counter clockwise positive
+	float gyro[3];
+	//m/s^2 along x, y and z, gravity included
+	float accel[3];
+} imu_sample_t;
+
+//Sets up the SPI and the DMAC channels and configures the IMU for 1.66 kHz
+//output at +/-250 deg/s and +/-4 g. Once from InitializeDriveByWireIO.
+//Returns 0, and the reads stay off, if the IMU does not answer or no DMAC
+//channels are free.
+uint8_t ImuInit();
+
+//Starts a burst read of the output registers. From main_task at the start
+//of a cycle, does nothing before ImuInit. One still running is aborted.
+void ImuStartRead();
+
+//The sample of the last burst started, 1 if it is done and sample was
+//written, 0 if it is not in yet or the IMU is off
+uint8_t ImuRead(imu_sample_t* sample);
+
+//Bursts that were still running when read, or failed, since boot
+uint32_t ImuMissed();
+
+#endif /* IMU_H_ */
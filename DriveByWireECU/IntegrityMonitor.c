@@ -0,0 +1,269 @@
+/*
+ * IntegrityMonitor.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "IntegrityMonitor.h"
+
+#if INTEGRITY_MONITOR_ENABLE
+
+#include <hri_icm_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_nvmctrl_e54.h>
+#include <irq_config.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Service.h"
+#include "EventLog.h"
+#include "Log.h"
+#include "ParamStore.h"
+#include "SteeringCalibration.h"
+
+#if INTEGRITY_MONITOR_BUS_BURDEN > 15
+#error INTEGRITY_MONITOR_BUS_BURDEN is 0 to 15
+#endif
+
+//the ICM hashes 512-bit blocks
+#define ICM_BLOCK_SIZE 64
+#define ICM_DIGEST_WORDS 8
+//RCFG ALGO of SHA-256, as CFG UALGO
+#define ICM_ALGO_SHA256 1
+
+extern uint32_t _etext;
+extern uint32_t _srelocate;
+extern uint32_t _erelocate;
+
+typedef struct integrity_digest_t
+{
+	uint32_t words[ICM_DIGEST_WORDS];
+} integrity_digest_t;
+
+typedef struct integrity_monitor_t
+{
+	//bumped by IntegrityMonitorRebase
+	volatile uint32_t rebase[INTEGRITY_REGION_COUNT];
+	//rebase count the reference was taken at, and at the start of the pass
+	uint32_t reference_rebase[INTEGRITY_REGION_COUNT];
+	uint32_t pass_rebase[INTEGRITY_REGION_COUNT];
+	uint8_t has_reference[INTEGRITY_REGION_COUNT];
+	integrity_digest_t reference[INTEGRITY_REGION_COUNT];
+	//differed in the last pass, and was reported since it last matched
+	uint8_t suspect[INTEGRITY_REGION_COUNT];
+	uint8_t reported[INTEGRITY_REGION_COUNT];
+
+	//regions in the pass running, in list order
+	uint8_t regions[INTEGRITY_REGION_COUNT];
+	uint8_t region_count;
+	//ISR of the pass, from the interrupt
+	volatile uint32_t status;
+
+	uint32_t passes;
+	uint32_t mismatches;
+} integrity_monitor_t;
+
+static integrity_monitor_t integrity;
+
+//The ICM reads its list at a 64 byte boundary and writes the digests at a
+//128 byte one, a digest slot per region in list order
+static IcmDescriptor descriptors[INTEGRITY_REGION_COUNT] __attribute__((aligned(64)));
+static integrity_digest_t digests[INTEGRITY_REGION_COUNT] __attribute__((aligned(128)));
+
+static service_t integrity_service;
+
+static const char* const region_names[INTEGRITY_REGION_COUNT] = { "image", "calibration", "params" };
+
+void ICM_Handler()
+{
+	uint32_t status = hri_icm_read_ISR_reg(ICM);
+	hri_icm_clear_IMR_reg(ICM, 0xFFFFFFFF);
+	integrity.status = status;
+	ServiceSignalFromIsr(&integrity_service);
+}
+
+static uint8_t RegionBounds(uint8_t region, uint32_t* address, uint32_t* length)
+{
+	switch( region )
+	{
+	case INTEGRITY_REGION_IMAGE:
+		*address = 0;
+		*length = (uint32_t)&_etext + ((uint32_t)&_erelocate - (uint32_t)&_srelocate);
+		return 1;
+	case INTEGRITY_REGION_CALIBRATION:
+		*address = STEERING_CALIBRATION_NVM_ADDRESS;
+		*length = sizeof(steering_calibration_t);
+		return 1;
+	case INTEGRITY_REGION_PARAMS:
+		//a SmartEEPROM being written stalls whoever reads it, the ICM too
+		if( ParamStoreState() != PARAM_STORE_IDLE || hri_nvmctrl_get_SEESTAT_BUSY_bit(NVMCTRL) )
+			return 0;
+		*address = SEEPROM_ADDR;
+		*length = PARAM_STORE_SLOTS * PARAM_STORE_SLOT_SIZE;
+		return 1;
+	}
+	return 0;
+}
+
+//Lists the regions and enables the ICM, which interrupts once the last
+//one is hashed or a read fails
+static void StartPass()
+{
+	integrity.region_count = 0;
+	for(uint8_t region = 0; region < INTEGRITY_REGION_COUNT; ++region)
+	{
+		uint32_t address, length;
+		if( !RegionBounds(region, &address, &length) )
+			continue;
+
+		IcmDescriptor* descriptor = &descriptors[integrity.region_count];
+		uint32_t blocks = (length + ICM_BLOCK_SIZE - 1) / ICM_BLOCK_SIZE;
+		hri_icmdescriptor_write_RADDR_reg(descriptor, address);
+		//compute mode, the digest is written to its slot
+		hri_icmdescriptor_write_RCFG_reg(descriptor, ICM_RCFG_ALGO(ICM_ALGO_SHA256));
+		hri_icmdescriptor_write_RCTRL_reg(descriptor, ICM_RCTRL_TRSIZE(blocks - 1));
+		hri_icmdescriptor_write_RNEXT_reg(descriptor, 0);
+
+		integrity.pass_rebase[region] = integrity.rebase[region];
+		integrity.regions[integrity.region_count++] = region;
+	}
+	IcmDescriptor* last = &descriptors[integrity.region_count - 1];
+	hri_icmdescriptor_set_RCFG_reg(last, ICM_RCFG_EOM);
+
+	integrity.status = 0;
+	__DSB();
+	hri_icm_write_DSCR_reg(ICM, (uint32_t)descriptors);
+	hri_icm_write_HASH_reg(ICM, (uint32_t)digests);
+	hri_icm_read_ISR_reg(ICM);
+	hri_icm_set_IMR_reg(ICM, ICM_IMR_RHC(1 << (integrity.region_count - 1)) | ICM_IMR_RBE(0xF));
+	hri_icm_write_CTRL_reg(ICM, ICM_CTRL_ENABLE);
+}
+
+static void Mismatch(uint8_t region, const integrity_digest_t* digest)
+{
+	if( integrity.reported[region] )
+		return;
+	integrity.reported[region] = 1;
+	integrity.mismatches++;
+	EventLogWrite(EVENT_LOG_INTEGRITY, region, digest->words[0]);
+	LOG("integrity: %s differs from its reference", region_names[region]);
+}
+
+//Compares the digests of a finished pass with the references
+static void EndPass()
+{
+	integrity.passes++;
+	for(uint8_t slot = 0; slot < integrity.region_count; ++slot)
+	{
+		uint8_t region = integrity.regions[slot];
+		const integrity_digest_t* digest = &digests[slot];
+
+		if( !integrity.has_reference[region] || integrity.reference_rebase[region] != integrity.rebase[region] )
+		{
+			//only a pass that started after the rebase saw the new contents
+			if( integrity.pass_rebase[region] == integrity.rebase[region] )
+			{
+				integrity.reference[region] = *digest;
+				integrity.reference_rebase[region] = integrity.pass_rebase[region];
+				integrity.has_reference[region] = 1;
+				integrity.suspect[region] = 0;
+				integrity.reported[region] = 0;
+			}
+			continue;
+		}
+
+		if( memcmp(digest, &integrity.reference[region], sizeof(integrity_digest_t)) == 0 )
+		{
+			integrity.suspect[region] = 0;
+			integrity.reported[region] = 0;
+		}
+		else if( integrity.suspect[region] )
+		{
+			Mismatch(region, digest);
+		}
+		else
+		{
+			integrity.suspect[region] = 1;
+		}
+	}
+}
+
+static service_result_t IntegrityService(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	while(1)
+	{
+		StartPass();
+		SERVICE_WAIT_SIGNAL(service, INTEGRITY_MONITOR_TIMEOUT);
+		hri_icm_write_CTRL_reg(ICM, ICM_CTRL_DISABLE);
+		hri_icm_clear_IMR_reg(ICM, 0xFFFFFFFF);
+
+		uint32_t status = integrity.status;
+		if( (status & ICM_ISR_RBE(0xF)) != 0 || (status & ICM_ISR_RHC(1 << (integrity.region_count - 1))) == 0 )
+		{
+			EventLogWrite(EVENT_LOG_INTEGRITY, EVENT_LOG_INTEGRITY_PASS_FAILED, status);
+			LOG("integrity: pass failed, ICM status 0x%08lx", status);
+			hri_icm_write_CTRL_reg(ICM, ICM_CTRL_SWRST);
+			hri_icm_write_CFG_reg(ICM, ICM_CFG_BBC(INTEGRITY_MONITOR_BUS_BURDEN));
+		}
+		else
+		{
+			__DSB();
+			EndPass();
+		}
+		SERVICE_DELAY(service, INTEGRITY_MONITOR_PERIOD);
+	}
+	SERVICE_END(service);
+}
+
+void IntegrityMonitorStart()
+{
+	memset(&integrity, 0, sizeof(integrity));
+
+	hri_mclk_set_AHBMASK_ICM_bit(MCLK);
+	hri_mclk_set_APBCMASK_ICM_bit(MCLK);
+	hri_icm_write_CTRL_reg(ICM, ICM_CTRL_SWRST);
+	hri_icm_write_CFG_reg(ICM, ICM_CFG_BBC(INTEGRITY_MONITOR_BUS_BURDEN));
+
+	NVIC_SetPriority(ICM_IRQn, IRQ_PRIORITY_ICM);
+	NVIC_ClearPendingIRQ(ICM_IRQn);
+	NVIC_EnableIRQ(ICM_IRQn);
+	ServiceAdd(&integrity_service, "Integrity", IntegrityService);
+}
+
+void IntegrityMonitorRebase(integrity_region_t region)
+{
+	__atomic_add_fetch(&integrity.rebase[region], 1, __ATOMIC_RELEASE);
+}
+
+uint32_t IntegrityMonitorPasses()
+{
+	return integrity.passes;
+}
+
+uint32_t IntegrityMonitorMismatches()
+{
+	return integrity.mismatches;
+}
+
+#else
+
+void IntegrityMonitorStart()
+{
+}
+
+void IntegrityMonitorRebase(integrity_region_t region)
+{
+}
+
+uint32_t IntegrityMonitorPasses()
+{
+	return 0;
+}
+
+uint32_t IntegrityMonitorMismatches()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * IntegrityMonitor.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef INTEGRITYMONITOR_H_
+#define INTEGRITYMONITOR_H_
+
+#include <stdint.h>
+
+//Background check that the code and the persisted calibration are still
+//what they were at boot, on the ICM (Integrity Check Monitor).
+//
+//The ICM is a bus master with its own SHA engine. Given a list of regions
+//it reads and hashes them without the core, then raises its interrupt. A
+//service (Service.h) starts a pass over the regions below every
+//INTEGRITY_MONITOR_PERIOD ms and compares the SHA-256 of each with the one
+//taken when it started:
+//
+//	image		the running image in the bank mapped at 0, code and the
+//				initial values of the data
+//	calibration	the steering calibration record (SteeringCalibration.h)
+//	params		both slots of the parameter record in the SmartEEPROM
+//				(ParamStore.h), when the fuses give it one
+//
+//The ICM waits 2^INTEGRITY_MONITOR_BUS_BURDEN cycles between the 64 byte
+//blocks it reads, so it never holds the flash long enough for the control
+//loop's fetches to notice. A pass over a 300 KB image takes about 50 ms
+//at the default. The core only runs the interrupt and the compare at the
+//end of the pass.
+//
+//A region has to differ in two passes in a row before it is reported, a
+//save that raced a pass does not count. The calibration and the params
+//are rewritten on purpose, their writers call IntegrityMonitorRebase once
+//a save is done and the next whole pass becomes the region's reference.
+//A corrupt region is recorded as EVENT_LOG_INTEGRITY and logged, once
+//until it matches again. Boot time corruption is the firmware update's
+//CRC's job, the reference is what booted.
+
+//Set to 0 to leave the ICM off
+#ifndef INTEGRITY_MONITOR_ENABLE
+#define INTEGRITY_MONITOR_ENABLE 1
+#endif
+
+//ms from the end of one pass to the start of the next
+#ifndef INTEGRITY_MONITOR_PERIOD
+#define INTEGRITY_MONITOR_PERIOD 10000
+#endif
+
+//log2 of the cycles the ICM leaves the bus between blocks, 0 to 15
+#ifndef INTEGRITY_MONITOR_BUS_BURDEN
+#define INTEGRITY_MONITOR_BUS_BURDEN 8
+#endif
+
+//ms a pass may take before the ICM counts as stuck
+#define INTEGRITY_MONITOR_TIMEOUT 2000
+
+typedef enum integrity_region_t
+{
+	INTEGRITY_REGION_IMAGE = 0,
+	INTEGRITY_REGION_CALIBRATION,
+	INTEGRITY_REGION_PARAMS,
+	INTEGRITY_REGION_COUNT
+} integrity_region_t;
+
+//arg of EVENT_LOG_INTEGRITY: the integrity_region_t, or this for a pass
+//the ICM did not finish
+#define EVENT_LOG_INTEGRITY_PASS_FAILED 0xFF
+
+//Adds the service. Before the scheduler starts, after ParamStoreInit.
+void IntegrityMonitorStart();
+
+//The region was rewritten on purpose, its next whole pass is the new
+//reference. From any task, once the write is done.
+void IntegrityMonitorRebase(integrity_region_t region);
+
+//Passes finished and regions found corrupt since boot
+uint32_t IntegrityMonitorPasses();
+uint32_t IntegrityMonitorMismatches();
+
+#endif /* INTEGRITYMONITOR_H_ */
@@ -0,0 +1,197 @@
+/*
+ * LatencyProbe.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hal_gpio.h>
+#include <hri_eic_e54.h>
+#include <hri_evsys_e54.h>
+#include <hri_tcc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include "LatencyProbe.h"
+#include "FastCode.h"
+#include "GpioBatch.h"
+#include "SignalBus.h"
+#include "TimeBase.h"
+
+#if LATENCY_PROBE_ENABLE
+
+//EVSYS channels, 0 to 5 belong to WheelSpeed, AdcSampler and TccPwm
+#define LATENCY_PROBE_EVSYS 6
+
+//A marked command from main_task taking it in on
+typedef struct latency_probe_command_t
+{
+	latency_probe_stamps_t stamps;
+	uint32_t applied;
+	uint32_t committed;
+	//TCC4 at the compare write, PWM ticks to the period that has the new duty
+	uint16_t write_count;
+	uint32_t update_ticks;
+} latency_probe_command_t;
+
+typedef struct latency_probe_t
+{
+	//the last receive interrupt
+	volatile uint32_t interrupt;
+	//main_task only. Applied and not committed yet, then committed and
+	//waiting for its edge.
+	uint8_t applied_pending;
+	latency_probe_command_t applied;
+	uint8_t edge_pending;
+	latency_probe_command_t edge;
+	//the last command counted, a command selected again is not
+	uint32_t applied_received;
+} latency_probe_t;
+
+static latency_probe_t latency_probe;
+
+//Wraps after 35 s at 120MHz, the stages are a few ms at most
+FAST_CODE static uint32_t Stamp()
+{
+	return (uint32_t)TimeBaseCycles();
+}
+
+static float CyclesUs(uint32_t cycles)
+{
+	return (float)cycles / TIME_BASE_CYCLES_PER_US;
+}
+
+//TCC4 runs free over 16 bits at the PWM clock and captures its count into
+//CC0 on each falling edge of the wired back output. A second edge before
+//CC0 is read waits in CCBUF.
+static void InitCapture()
+{
+	gpio_set_pin_direction(LATENCY_PROBE_CAPTURE_PIN, GPIO_DIRECTION_IN);
+	gpio_set_pin_function(LATENCY_PROBE_CAPTURE_PIN, LATENCY_PROBE_CAPTURE_PINMUX);
+
+	hri_mclk_set_APBDMASK_TCC4_bit(MCLK);
+	hri_gclk_write_PCHCTRL_reg(GCLK, TCC4_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	hri_tcc_write_CTRLA_reg(TCC4, TCC_CTRLA_SWRST);
+	hri_tcc_wait_for_sync(TCC4, TCC_SYNCBUSY_SWRST);
+	hri_tcc_write_EVCTRL_reg(TCC4, TCC_EVCTRL_MCEI0);
+	hri_tcc_write_CTRLA_reg(TCC4, TCC_CTRLA_CPTEN0 | TCC_CTRLA_PRESCALER_DIV1 | TCC_CTRLA_ENABLE);
+	hri_tcc_wait_for_sync(TCC4, TCC_SYNCBUSY_ENABLE);
+
+	//EIC event -> TCC4 capture, asynchronous path, TCC4 takes it on its clock
+	hri_mclk_set_APBBMASK_EVSYS_bit(MCLK);
+	hri_evsys_write_CHANNEL_reg(EVSYS, LATENCY_PROBE_EVSYS,
+		EVSYS_CHANNEL_EVGEN(EVSYS_ID_GEN_EIC_EXTINT_0 + LATENCY_PROBE_CAPTURE_EXTINT) | EVSYS_CHANNEL_PATH_ASYNCHRONOUS);
+	hri_evsys_write_USER_reg(EVSYS, EVSYS_ID_USER_TCC4_MC_0, LATENCY_PROBE_EVSYS + 1);
+
+	//asynchronous edge detection, the EIC's 32kHz clock would take up to
+	//30us. Other EXTINTs keep their configuration.
+	hri_mclk_set_APBAMASK_EIC_bit(MCLK);
+	hri_eic_clear_CTRLA_ENABLE_bit(EIC);
+	hri_eic_wait_for_sync(EIC, EIC_SYNCBUSY_ENABLE);
+	uint8_t shift = (LATENCY_PROBE_CAPTURE_EXTINT & 7) * 4;
+	uint32_t config = hri_eic_read_CONFIG_reg(EIC, LATENCY_PROBE_CAPTURE_EXTINT / 8) & ~(0xFUL << shift);
+	hri_eic_write_CONFIG_reg(EIC, LATENCY_PROBE_CAPTURE_EXTINT / 8, config | ((uint32_t)EIC_CONFIG_SENSE0_FALL_Val << shift));
+	hri_eic_set_ASYNCH_ASYNCH_bf(EIC, 1UL << LATENCY_PROBE_CAPTURE_EXTINT);
+	hri_eic_set_EVCTRL_EXTINTEO_bf(EIC, 1UL << LATENCY_PROBE_CAPTURE_EXTINT);
+	hri_eic_set_CTRLA_ENABLE_bit(EIC);
+	hri_eic_wait_for_sync(EIC, EIC_SYNCBUSY_ENABLE);
+}
+
+static uint16_t ReadCaptureCount()
+{
+	hri_tcc_set_CTRLB_CMD_bf(TCC4, TCC_CTRLBSET_CMD_READSYNC_Val);
+	hri_tcc_wait_for_sync(TCC4, TCC_SYNCBUSY_CTRLB);
+	return (uint16_t)hri_tcc_read_COUNT_reg(TCC4);
+}
+
+void LatencyProbeInit()
+{
+	gpio_set_pin_level(LATENCY_PROBE_PIN, 0);
+	gpio_set_pin_direction(LATENCY_PROBE_PIN, GPIO_DIRECTION_OUT);
+	gpio_set_pin_function(LATENCY_PROBE_PIN, GPIO_PIN_FUNCTION_OFF);
+	InitCapture();
+}
+
+FAST_CODE void LatencyProbeInterrupt()
+{
+	GpioFastLevel(LATENCY_PROBE_PIN, 1);
+	latency_probe.interrupt = Stamp();
+}
+
+FAST_CODE void LatencyProbeReceived(latency_probe_stamps_t* stamps)
+{
+	GpioFastLevel(LATENCY_PROBE_PIN, 0);
+	if( !stamps->marked )
+		return;
+	stamps->interrupt = latency_probe.interrupt;
+	stamps->received = Stamp();
+	//0 means not stamped to LatencyProbeApplied
+	if( stamps->received == 0 )
+		stamps->received = 1;
+}
+
+FAST_CODE void LatencyProbeApplied(const latency_probe_stamps_t* stamps)
+{
+	if( !stamps->marked || stamps->received == latency_probe.applied_received )
+		return;
+	GpioFastLevel(LATENCY_PROBE_PIN, 1);
+	latency_probe.applied_received = stamps->received;
+	latency_probe.applied.stamps = *stamps;
+	latency_probe.applied.applied = Stamp();
+	latency_probe.applied_pending = 1;
+}
+
+//us of each stage, 0 for an edge that did not come
+static void Publish(const latency_probe_command_t* command, uint32_t edge_ticks)
+{
+	SignalPublishFloat(SIGNAL_LATENCY_PROBE_RECEIVED, CyclesUs(command->stamps.received - command->stamps.interrupt));
+	SignalPublishFloat(SIGNAL_LATENCY_PROBE_APPLIED, CyclesUs(command->applied - command->stamps.received));
+	SignalPublishFloat(SIGNAL_LATENCY_PROBE_COMMITTED, CyclesUs(command->committed - command->applied));
+	SignalPublishFloat(SIGNAL_LATENCY_PROBE_EDGE, edge_ticks * (1000000.0f / CONF_GCLK_TC0_FREQUENCY));
+	//last, a new sequence says the rest is in
+	SignalPublishUint(SIGNAL_LATENCY_PROBE_SEQUENCE, command->stamps.sequence);
+}
+
+//Captures of the edges before the new duty's are passed over, reading CC0
+//clears its flag and brings in CCBUF's. An edge between draining CC0 and
+//reading the count is half the counter's range behind it.
+FAST_CODE static void FindEdge()
+{
+	latency_probe_command_t* command = &latency_probe.edge;
+	while( hri_tcc_get_INTFLAG_MC0_bit(TCC4) )
+	{
+		uint16_t ticks = (uint16_t)(hri_tcc_read_CC_reg(TCC4, 0) - command->write_count);
+		if( ticks >= command->update_ticks && ticks < 0x8000 )
+		{
+			Publish(command, ticks);
+			latency_probe.edge_pending = 0;
+			return;
+		}
+	}
+	if( Stamp() - command->committed > LATENCY_PROBE_EDGE_TIMEOUT * TIME_BASE_CYCLES_PER_US )
+	{
+		Publish(command, 0);
+		latency_probe.edge_pending = 0;
+	}
+}
+
+FAST_CODE void LatencyProbeCommitted()
+{
+	if( latency_probe.edge_pending )
+		FindEdge();
+	if( !latency_probe.applied_pending )
+		return;
+
+	GpioFastLevel(LATENCY_PROBE_PIN, 0);
+	latency_probe_command_t* command = &latency_probe.edge;
+	//an edge still missing is given up on for the newer command
+	*command = latency_probe.applied;
+	command->committed = Stamp();
+	while( hri_tcc_get_INTFLAG_MC0_bit(TCC4) )
+		hri_tcc_read_CC_reg(TCC4, 0);
+	command->write_count = ReadCaptureCount();
+	command->update_ticks = TccPwmTicksToUpdate(LATENCY_PROBE_OUTPUT);
+	latency_probe.applied_pending = 0;
+	latency_probe.edge_pending = 1;
+}
+
+#endif
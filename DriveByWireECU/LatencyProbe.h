@@ -0,0 +1,118 @@
+/*
+ * LatencyProbe.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef LATENCYPROBE_H_
+#define LATENCYPROBE_H_
+
+#include <stdint.h>
+#include "TccPwm.h"
+
+//Command to actuation latency of single commands, on the pins and on the
+//ECU's own timers, for the HIL bench (PythonTestScripts/latency_bench.py
+//--probe).
+//
+//A command frame with the probe bit (0x20 of the boolean commands,
+//ControlProtocol.h) is followed through the ECU on LATENCY_PROBE_PIN:
+//	rises		gmac_handler_cb, receive complete
+//	falls		the command decoded, in raw_udp_command or ethernet_thread
+//	rises		main_task taking it in ApplyLatestCommand
+//	falls		CommitActuators done, the new compare values in CCBUF
+//A logic analyzer on the pin and on the PWM output sees every stage and
+//where the PWM follows. The receive interrupt raises the pin for any
+//frame and the next decoded command drops it, marked or not: a frame that
+//is no command leaves it high until then, keep the link quiet besides the
+//bench.
+//
+//The PWM output of LATENCY_PROBE_OUTPUT is wired back to
+//LATENCY_PROBE_CAPTURE_PIN as well. Its falling edges are EIC events that
+//EVSYS routes to TCC4, which runs free at the PWM clock and captures its
+//count on each, so the edge is timed by the hardware to a tick of the PWM
+//clock, 83ns. The compare write of a marked command reads TCC4's count and
+//how long TCC_PWM's current period still runs, and the first falling edge
+//after that period ends is the first one at the new duty. A duty of 0 or
+//1 has no falling edge, the probe gives up on it after
+//LATENCY_PROBE_EDGE_TIMEOUT.
+//
+//Under load, while gmac_task polls the ring (GMAC_RX_ADAPTIVE), a frame has
+//no receive interrupt of its own and the first stage counts from the last
+//one there was.
+//
+//Each stage is stamped in core cycles of the time base (TimeBase.h) and the
+//result of every marked command is published on the signal bus with its
+//frame sequence, once its edge is in (SignalBus.h, latency_probe_*).
+//
+//Needs TCC_PWM_ENABLE. TCC4 and EVSYS channel 6 are the probe's, nothing
+//else uses them.
+
+//Set to 1 to build the probe in
+#ifndef LATENCY_PROBE_ENABLE
+#define LATENCY_PROBE_ENABLE 0
+#endif
+
+//Marker output, and the input the PWM output is wired back to. PD11 is
+//EXTINT6.
+#define LATENCY_PROBE_PIN GPIO(GPIO_PORTD, 10)
+#define LATENCY_PROBE_CAPTURE_PIN GPIO(GPIO_PORTD, 11)
+#define LATENCY_PROBE_CAPTURE_PINMUX PINMUX_PD11A_EIC_EXTINT6
+#define LATENCY_PROBE_CAPTURE_EXTINT 6
+
+//The PWM output wired back
+#ifndef LATENCY_PROBE_OUTPUT
+#define LATENCY_PROBE_OUTPUT TCC_PWM_STEERING_TORQUE
+#endif
+
+//us after the compare write to give up on the edge. TCC4 wraps after 5.4ms.
+#ifndef LATENCY_PROBE_EDGE_TIMEOUT
+#define LATENCY_PROBE_EDGE_TIMEOUT 2000
+#endif
+
+#if LATENCY_PROBE_ENABLE && !TCC_PWM_ENABLE
+#error LATENCY_PROBE_ENABLE needs TCC_PWM_ENABLE
+#endif
+
+//Stamps of one command, travel with it in control_command_t. The decode
+//sets marked and sequence (ControlProtocol.h), the stamps are 0 for an
+//unmarked command.
+typedef struct latency_probe_stamps_t
+{
+	uint32_t sequence;
+	uint32_t interrupt;
+	uint32_t received;
+	uint8_t marked;
+} latency_probe_stamps_t;
+
+#if LATENCY_PROBE_ENABLE
+//Sets up the pins, TCC4 and its capture. After TccPwmInit, EStopInputInit
+//and WheelSpeedInit, which reconfigure the EIC.
+void LatencyProbeInit();
+//GMAC interrupt, receive complete
+void LatencyProbeInterrupt();
+//Every command just decoded, stamps a marked one
+void LatencyProbeReceived(latency_probe_stamps_t* stamps);
+//main_task, stamps of the command it just took in
+void LatencyProbeApplied(const latency_probe_stamps_t* stamps);
+//main_task, once CommitActuators has written the compare values. Also
+//looks for the edge of the last marked command and publishes its result.
+void LatencyProbeCommitted();
+#else
+static inline void LatencyProbeInit()
+{
+}
+static inline void LatencyProbeInterrupt()
+{
+}
+static inline void LatencyProbeReceived(latency_probe_stamps_t* stamps)
+{
+}
+static inline void LatencyProbeApplied(const latency_probe_stamps_t* stamps)
+{
+}
+static inline void LatencyProbeCommitted()
+{
+}
+#endif
+
+#endif /* LATENCYPROBE_H_ */
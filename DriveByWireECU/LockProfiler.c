@@ -0,0 +1,167 @@
+/*
+ * LockProfiler.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "LockProfiler.h"
+#include "task.h"
+#include "lwip/sys.h"
+#include "lwip/timers.h"
+#include "Log.h"
+#include "SignalBus.h"
+#include "TimeBase.h"
+
+static const char* const lock_profiler_names[LOCK_PROFILE_COUNT] =
+{
+	[LOCK_PROFILE_TCPIP_CORE] = "tcpip core",
+	[LOCK_PROFILE_LWIP_MUTEX] = "lwip mutex",
+	[LOCK_PROFILE_LWIP_SEM] = "lwip sem",
+	[LOCK_PROFILE_USB_DEBUG] = "usb debug",
+};
+
+//contended per second, longest wait, longest hold. SIGNAL_COUNT for none.
+static const signal_id_t lock_profiler_signals[LOCK_PROFILE_COUNT][3] =
+{
+	[LOCK_PROFILE_TCPIP_CORE] = { SIGNAL_LOCK_TCPIP_CORE_CONTENDED, SIGNAL_LOCK_TCPIP_CORE_WAIT_MAX, SIGNAL_LOCK_TCPIP_CORE_HOLD_MAX },
+	[LOCK_PROFILE_LWIP_MUTEX] = { SIGNAL_LOCK_LWIP_MUTEX_CONTENDED, SIGNAL_LOCK_LWIP_MUTEX_WAIT_MAX, SIGNAL_LOCK_LWIP_MUTEX_HOLD_MAX },
+	[LOCK_PROFILE_LWIP_SEM] = { SIGNAL_LOCK_LWIP_SEM_CONTENDED, SIGNAL_LOCK_LWIP_SEM_WAIT_MAX, SIGNAL_COUNT },
+	[LOCK_PROFILE_USB_DEBUG] = { SIGNAL_LOCK_USB_DEBUG_CONTENDED, SIGNAL_LOCK_USB_DEBUG_WAIT_MAX, SIGNAL_LOCK_USB_DEBUG_HOLD_MAX },
+};
+
+typedef struct lock_profiler_slot_t
+{
+	lock_profile_stats_t stats;
+	//TimeBaseUs of the last take, for the hold time
+	uint32_t taken_at;
+	//over the current period, taken by the sampler
+	uint32_t period_wait_max;
+	uint32_t period_hold_max;
+} lock_profiler_slot_t;
+
+//changed in critical sections, takes come from any task
+static lock_profiler_slot_t lock_profiler_slots[LOCK_PROFILE_COUNT];
+
+//tcpip thread only
+static struct
+{
+	uint32_t sampled_at;
+	uint32_t contended[LOCK_PROFILE_COUNT];
+} lock_profiler;
+
+#if LOCK_PROFILER_ENABLE
+BaseType_t LockProfileTake(lock_profile_id_t id, SemaphoreHandle_t lock, TickType_t timeout)
+{
+	lock_profiler_slot_t* slot = &lock_profiler_slots[id];
+	uint32_t start = (uint32_t)TimeBaseUs();
+	uint8_t contended = 0;
+	BaseType_t taken = xSemaphoreTake(lock, 0);
+	if( taken != pdTRUE )
+	{
+		contended = 1;
+		if( timeout != 0 )
+			taken = xSemaphoreTake(lock, timeout);
+	}
+	uint32_t now = (uint32_t)TimeBaseUs();
+	uint32_t wait = now - start;
+
+	taskENTER_CRITICAL();
+	slot->stats.contended += contended;
+	if( taken == pdTRUE )
+	{
+		slot->stats.acquires++;
+		slot->stats.wait_total += wait;
+		if( wait > slot->stats.wait_max )
+			slot->stats.wait_max = wait;
+		if( wait > slot->period_wait_max )
+			slot->period_wait_max = wait;
+		slot->taken_at = now;
+	}
+	else
+		slot->stats.timeouts++;
+	taskEXIT_CRITICAL();
+	return taken;
+}
+
+void LockProfileGive(lock_profile_id_t id, SemaphoreHandle_t lock)
+{
+	lock_profiler_slot_t* slot = &lock_profiler_slots[id];
+	//read before the give, a waiter takes it right away
+	uint32_t hold = (uint32_t)TimeBaseUs() - slot->taken_at;
+	xSemaphoreGive(lock);
+
+	taskENTER_CRITICAL();
+	slot->stats.hold_total += hold;
+	if( hold > slot->stats.hold_max )
+		slot->stats.hold_max = hold;
+	if( hold > slot->period_hold_max )
+		slot->period_hold_max = hold;
+	taskEXIT_CRITICAL();
+}
+#endif
+
+void LockProfilerRead(lock_profile_id_t id, lock_profile_stats_t* stats)
+{
+	taskENTER_CRITICAL();
+	*stats = lock_profiler_slots[id].stats;
+	taskEXIT_CRITICAL();
+}
+
+void LockProfilerReport()
+{
+	for(uint32_t i = 0; i < LOCK_PROFILE_COUNT; ++i)
+	{
+		lock_profile_stats_t stats;
+		LockProfilerRead((lock_profile_id_t)i, &stats);
+		LOG("lock %s: %lu taken, %lu contended, %lu timeouts, wait mean %lu max %lu us, hold mean %lu max %lu us",
+			lock_profiler_names[i], stats.acquires, stats.contended, stats.timeouts,
+			stats.acquires ? (uint32_t)(stats.wait_total / stats.acquires) : 0, stats.wait_max,
+			stats.acquires ? (uint32_t)(stats.hold_total / stats.acquires) : 0, stats.hold_max);
+	}
+}
+
+static void LockProfilerSample(void* arg)
+{
+	uint32_t now = sys_now();
+	uint32_t elapsed = now - lock_profiler.sampled_at;
+	lock_profiler.sampled_at = now;
+	//a late timeout stretches the period, not the rates
+	float per_second = elapsed ? 1000.0f / (float)elapsed : 0.0f;
+
+	for(uint32_t i = 0; i < LOCK_PROFILE_COUNT; ++i)
+	{
+		lock_profiler_slot_t* slot = &lock_profiler_slots[i];
+		taskENTER_CRITICAL();
+		uint32_t contended = slot->stats.contended;
+		uint32_t wait_max = slot->period_wait_max;
+		uint32_t hold_max = slot->period_hold_max;
+		slot->period_wait_max = 0;
+		slot->period_hold_max = 0;
+		taskEXIT_CRITICAL();
+
+		const signal_id_t* signals = lock_profiler_signals[i];
+		SignalPublishFloat(signals[0], (float)(contended - lock_profiler.contended[i]) * per_second);
+		SignalPublishFloat(signals[1], (float)wait_max);
+		if( signals[2] != SIGNAL_COUNT )
+			SignalPublishFloat(signals[2], (float)hold_max);
+		lock_profiler.contended[i] = contended;
+	}
+
+	sys_timeout(LOCK_PROFILER_PERIOD, LockProfilerSample, arg);
+}
+
+void LockProfilerStart()
+{
+	//the boot's locking is not a rate, the first period starts here
+	taskENTER_CRITICAL();
+	for(uint32_t i = 0; i < LOCK_PROFILE_COUNT; ++i)
+	{
+		lock_profiler.contended[i] = lock_profiler_slots[i].stats.contended;
+		lock_profiler_slots[i].period_wait_max = 0;
+		lock_profiler_slots[i].period_hold_max = 0;
+	}
+	taskEXIT_CRITICAL();
+	lock_profiler.sampled_at = sys_now();
+	sys_timeout(LOCK_PROFILER_PERIOD, LockProfilerSample, NULL);
+}
@@ -0,0 +1,105 @@
+/*
+ * LockProfiler.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef LOCKPROFILER_H_
+#define LOCKPROFILER_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+//Contention of the locks tasks share: how often a take found the lock
+//held, how long it waited and how long the holder kept it.
+//
+//LockProfileTake and LockProfileGive stand in for xSemaphoreTake and
+//xSemaphoreGive on a lock named here. A take first tries without
+//blocking, so an uncontended one costs two time base reads (TimeBase.h)
+//and a short critical section more than the plain call, and only a take
+//that found the lock held counts as contended. Hold times run from a take
+//to the give of the same lock, so they only mean anything for a lock one
+//task holds at a time, a mutex. sys_arch.c takes lwIP's mutexes and
+//semaphores through them, so the core lock every LOCK_TCPIP_CORE caller
+//shares is measured without touching lwIP.
+//
+//The control path takes no lock at all, main_task and the network tasks
+//exchange through ControlExchange.h and the signal bus. What is left is
+//the network side, and this tells whether a lock is worth the same
+//rework before anyone does it.
+//
+//Every LOCK_PROFILER_PERIOD a timeout in the tcpip thread publishes, per
+//lock, the contended takes per second and the longest wait and hold in
+//us over the period as SIGNAL_LOCK_* signals. The totals since boot are
+//in LockProfilerRead and on the console's stats command.
+
+//Set to 0 to take the locks directly
+#ifndef LOCK_PROFILER_ENABLE
+#define LOCK_PROFILER_ENABLE 1
+#endif
+
+//ms between samples
+#ifndef LOCK_PROFILER_PERIOD
+#define LOCK_PROFILER_PERIOD 1000
+#endif
+
+//To add a lock, add it here, its signals to SignalBus.h and to
+//lock_profiler_signals in LockProfiler.c, and take it through the
+//wrappers.
+typedef enum lock_profile_id_t
+{
+	//lwIP's core lock, LOCK_TCPIP_CORE, held by the tcpip thread for every
+	//packet and timeout and by the tasks that send on raw pcbs
+	LOCK_PROFILE_TCPIP_CORE = 0,
+	//lwIP's other sys_mutex, the heap's
+	LOCK_PROFILE_LWIP_MUTEX,
+	//every sys_sem wait: netconn and tcpip_callback_wait callers waiting
+	//for the tcpip thread to do their job. A wait only, nothing holds it.
+	LOCK_PROFILE_LWIP_SEM,
+	//the USB debug channel's ring (UsbDebug.h)
+	LOCK_PROFILE_USB_DEBUG,
+	LOCK_PROFILE_COUNT
+} lock_profile_id_t;
+
+typedef struct lock_profile_stats_t
+{
+	uint32_t acquires;
+	//takes that found the lock held, the ones that gave up included
+	uint32_t contended;
+	uint32_t timeouts;
+	//us
+	uint64_t wait_total;
+	uint32_t wait_max;
+	uint64_t hold_total;
+	uint32_t hold_max;
+} lock_profile_stats_t;
+
+#if LOCK_PROFILER_ENABLE
+//xSemaphoreTake of lock, from a task
+BaseType_t LockProfileTake(lock_profile_id_t id, SemaphoreHandle_t lock, TickType_t timeout);
+//xSemaphoreGive of a lock taken with LockProfileTake, from the task that
+//took it
+void LockProfileGive(lock_profile_id_t id, SemaphoreHandle_t lock);
+#else
+static inline BaseType_t LockProfileTake(lock_profile_id_t id, SemaphoreHandle_t lock, TickType_t timeout)
+{
+	return xSemaphoreTake(lock, timeout);
+}
+
+static inline void LockProfileGive(lock_profile_id_t id, SemaphoreHandle_t lock)
+{
+	xSemaphoreGive(lock);
+}
+#endif
+
+//Totals since boot, zeroes without LOCK_PROFILER_ENABLE. Any task.
+void LockProfilerRead(lock_profile_id_t id, lock_profile_stats_t* stats);
+
+//LOGs the totals, a line per lock
+void LockProfilerReport();
+
+//Starts publishing the signals. In the tcpip thread.
+void LockProfilerStart();
+
+#endif /* LOCKPROFILER_H_ */
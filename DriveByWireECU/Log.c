@@ -0,0 +1,182 @@
+/*
+ * Log.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include "Log.h"
+#include "driver_init.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "DmaService.h"
+#include "Service.h"
+#include "UsbDebug.h"
+#include "ByteOrder.h"
+
+//TX buffer -> SERCOM2 DATA, a byte per DATA register empty
+static const dma_channel_config_t log_dma_config =
+{
+	SERCOM2_DMAC_ID_TX, DMAC_CHCTRLA_TRIGACT_BURST_Val, DMAC_BTCTRL_BEATSIZE_BYTE_Val, 1, 0, 0, 0
+};
+
+#define LOG_MASK (LOG_DEPTH - 1)
+//Longest rendered line, longer ones are cut
+#define LOG_LINE_SIZE 128
+#define LOG_TX_BUFFER_SIZE 512
+//ms, a full buffer takes about 11 ms at 460800 baud. Only guards against
+//a lost DMA interrupt.
+#define LOG_TX_TIMEOUT 100
+
+#if (LOG_DEPTH & LOG_MASK) != 0
+#error LOG_DEPTH must be a power of two
+#endif
+
+//sequence is the claim index + 1 once the record is complete, the log
+//service only reads a record after seeing that
+typedef struct log_record_t
+{
+	uint32_t sequence;
+	const char* format;
+	uint32_t tick;
+	uint32_t count;
+	uint32_t args[LOG_MAX_ARGS];
+} log_record_t;
+
+static log_record_t log_ring[LOG_DEPTH];
+//next record to claim, advanced by every writer
+static uint32_t log_head;
+//next record to render, advanced only by the log service
+static uint32_t log_tail;
+static uint32_t log_dropped;
+
+static uint8_t log_tx[LOG_TX_BUFFER_SIZE];
+static uint32_t reported_drops;
+static service_t log_service;
+//DmaService channel, -1 until LogStart and if none was free
+static int8_t log_dma = -1;
+
+void LogWrite(const char* format, uint32_t count, ...)
+{
+	uint32_t head = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+
+	//claim a record, the compare exchange loses only to another writer
+	do
+	{
+		if( head - __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE) >= LOG_DEPTH )
+		{
+			__atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while( !__atomic_compare_exchange_n(&log_head, &head, head + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+
+	log_record_t* record = &log_ring[head & LOG_MASK];
+	va_list args;
+
+	record->format = format;
+	//only reads the tick count, fine from tasks too
+	record->tick = xTaskGetTickCountFromISR();
+	record->count = count < LOG_MAX_ARGS ? count : LOG_MAX_ARGS;
+	va_start(args, count);
+	for(uint32_t i = 0; i < record->count; ++i)
+		record->args[i] = va_arg(args, uint32_t);
+	va_end(args);
+	__atomic_store_n(&record->sequence, head + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t LogDropped()
+{
+	return __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+}
+
+//Renders record into out, which has room for LOG_LINE_SIZE bytes, and
+//returns the bytes written
+static uint16_t Render(const log_record_t* record, uint8_t* out)
+{
+#if LOG_BINARY
+	out[0] = LOG_BINARY_SYNC;
+	out[1] = record->count;
+	PutLE32(&out[2], (uint32_t)record->format);
+	PutLE32(&out[6], record->tick);
+	for(uint32_t i = 0; i < record->count; ++i)
+		PutLE32(&out[10 + i * 4], record->args[i]);
+	return 10 + record->count * 4;
+#else
+	//unused arguments are ignored by snprintf
+	const uint32_t* a = record->args;
+	char* line = (char*)out;
+	int room = LOG_LINE_SIZE - 2;
+	int length = snprintf(line, room, "%8lu ", (unsigned long)record->tick);
+	length += snprintf(line + length, room - length, record->format, a[0], a[1], a[2], a[3], a[4], a[5]);
+	if( length > room - 1 )
+		length = room - 1;
+	line[length++] = '\r';
+	line[length++] = '\n';
+	return length;
+#endif
+}
+
+//Renders the drops notice and as many records as fit into the TX buffer,
+//returns the bytes used
+static uint16_t Fill()
+{
+	uint16_t used = 0;
+
+	uint32_t drops = LogDropped();
+	if( drops != reported_drops )
+	{
+		log_record_t notice = { 0, "log: %lu records dropped", xTaskGetTickCount(), 1, { drops - reported_drops } };
+		used += Render(&notice, log_tx);
+		reported_drops = drops;
+	}
+
+	uint32_t tail = log_tail;
+	log_record_t* record = &log_ring[tail & LOG_MASK];
+	while( LOG_TX_BUFFER_SIZE - used >= LOG_LINE_SIZE && __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) == tail + 1 )
+	{
+		used += Render(record, &log_tx[used]);
+		//hands the record back to the writers
+		__atomic_store_n(&log_tail, ++tail, __ATOMIC_RELEASE);
+		record = &log_ring[tail & LOG_MASK];
+	}
+	return used;
+}
+
+//Returns whether the DMA is sending, its done callback signals the service
+static uint8_t Send(uint16_t length)
+{
+	//a copy, the USB takes it at its own pace
+	UsbDebugWrite(USB_DEBUG_LOG, log_tx, length);
+	if( log_dma < 0 )
+		return 0;
+	//stops a transfer whose interrupt got lost
+	DmaStop(log_dma);
+	DmaSetBlock(log_dma, NULL, log_tx, &((Sercom*)TARGET_IO.device.hw)->USART.DATA.reg, length, NULL);
+	DmaStart(log_dma);
+	return 1;
+}
+
+static service_result_t LogService(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	while(1)
+	{
+		uint16_t used = Fill();
+		if( !used )
+		{
+			SERVICE_DELAY(service, LOG_DRAIN_PERIOD);
+			continue;
+		}
+		if( Send(used) )
+			SERVICE_WAIT_SIGNAL(service, LOG_TX_TIMEOUT);
+	}
+	SERVICE_END(service);
+}
+
+void LogStart()
+{
+	ServiceAdd(&log_service, "Log", LogService);
+	//the service is signalled when a line is out, or on a bus error
+	log_dma = DmaAllocate(&log_dma_config, ServiceDmaDone, &log_service);
+}
@@ -0,0 +1,86 @@
+/*
+ * Log.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdint.h>
+
+//Deferred logging to TARGET_IO (SERCOM2, the EDBG virtual COM port).
+//LOG only stores the format string pointer, the tick and up to
+//LOG_MAX_ARGS arguments in a lock-free ring. It never blocks and is safe
+//from any task or interrupt, a full ring drops the record and counts it.
+//The log service (Service.h) renders the records at a low priority and
+//sends them out with DMAC, so a log line costs the caller a few dozen cycles instead of
+//the whole time the line takes on the wire. With USB_DEBUG_ENABLE the
+//same lines also go to the USB debug port (UsbDebug.h).
+//
+//Arguments are converted to 32 bit values when logged: integers, pointers
+//and %s of strings that stay valid until the line is rendered, such as
+//literals. Floats do not survive the conversion, log them scaled to an
+//integer. printf stays synchronous and is only for boot, before LogStart.
+//
+//With LOG_BINARY the records go out unrendered and the PC side renders
+//them, looking the format string up by its address in the ELF file.
+//Each record is:
+//
+//	0		1		0xA5
+//	1		1		arguments that follow
+//	2		4		format string address
+//	6		4		RTOS tick
+//	10		...		arguments, 4 bytes each
+//
+//Multi-byte fields are little-endian. A %s argument is an address as well,
+//only strings in flash can be rendered from the ELF.
+
+//Records the ring holds, a power of two
+#ifndef LOG_DEPTH
+#define LOG_DEPTH 64
+#endif
+
+//ms between checks for new records when the ring is empty
+#ifndef LOG_DRAIN_PERIOD
+#define LOG_DRAIN_PERIOD 10
+#endif
+
+//Set to 1 to send records unrendered, see above
+#ifndef LOG_BINARY
+#define LOG_BINARY 0
+#endif
+
+//Most arguments a LOG call can take
+#define LOG_MAX_ARGS 6
+
+#define LOG_BINARY_SYNC 0xA5
+
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define LOG_NARGS(...) LOG_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_CAT_(a, b) a##b
+#define LOG_CAT(a, b) LOG_CAT_(a, b)
+#define LOG_ARGS_0()
+#define LOG_ARGS_1(a) , (uint32_t)(a)
+#define LOG_ARGS_2(a, b) , (uint32_t)(a), (uint32_t)(b)
+#define LOG_ARGS_3(a, b, c) , (uint32_t)(a), (uint32_t)(b), (uint32_t)(c)
+#define LOG_ARGS_4(a, b, c, d) , (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d)
+#define LOG_ARGS_5(a, b, c, d, e) , (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d), (uint32_t)(e)
+#define LOG_ARGS_6(a, b, c, d, e, f) , (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d), (uint32_t)(e), (uint32_t)(f)
+
+//Logs one line, printf style, the line ending is added when rendering.
+//format must be a string literal.
+#define LOG(format, ...) LogWrite(format, LOG_NARGS(__VA_ARGS__) LOG_CAT(LOG_ARGS_, LOG_NARGS(__VA_ARGS__))(__VA_ARGS__))
+
+//Sets up the TX DMA channel and adds the log service. Call once after
+//atmel_start_init, before the scheduler starts. Records logged before
+//this go out once it runs.
+void LogStart();
+
+//Use LOG instead, count uint32_t arguments follow format
+void LogWrite(const char* format, uint32_t count, ...);
+
+//Records dropped because the ring was full
+uint32_t LogDropped();
+
+#endif /* LOG_H_ */
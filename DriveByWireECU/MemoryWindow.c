@@ -0,0 +1,61 @@
+/*
+ * MemoryWindow.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "MemoryWindow.h"
+
+//The linker script's
+extern uint32_t _srelocate, _erelocate;
+extern uint32_t _szero, _ezero;
+extern uint32_t _snoinit, _enoinit;
+extern uint32_t _sbkupram, _ebkupram;
+
+typedef struct memory_region_t
+{
+	const uint32_t* start;
+	const uint32_t* end;
+} memory_region_t;
+
+static const memory_region_t memory_regions[] =
+{
+	{ &_srelocate, &_erelocate },
+	{ &_szero, &_ezero },
+	{ &_snoinit, &_enoinit },
+	{ &_sbkupram, &_ebkupram },
+};
+
+uint8_t MemoryWindowAllowed(uint32_t address, uint32_t length)
+{
+	for(uint32_t i = 0; i < sizeof(memory_regions) / sizeof(memory_regions[0]); ++i)
+	{
+		uint32_t start = (uint32_t)memory_regions[i].start;
+		uint32_t end = (uint32_t)memory_regions[i].end;
+		//no wrap past the end of the address space either
+		if( address >= start && address < end && length <= end - address )
+			return 1;
+	}
+	return 0;
+}
+
+void MemoryWindowRead(uint8_t* destination, uint32_t address, uint32_t length)
+{
+	if( ((address | length) & 3) == 0 )
+	{
+		const volatile uint32_t* source = (const volatile uint32_t*)address;
+		for(uint32_t i = 0; i < length / 4; ++i)
+		{
+			uint32_t word = source[i];
+			destination[i * 4 + 0] = (uint8_t)word;
+			destination[i * 4 + 1] = (uint8_t)(word >> 8);
+			destination[i * 4 + 2] = (uint8_t)(word >> 16);
+			destination[i * 4 + 3] = (uint8_t)(word >> 24);
+		}
+		return;
+	}
+
+	const volatile uint8_t* source = (const volatile uint8_t*)address;
+	for(uint32_t i = 0; i < length; ++i)
+		destination[i] = source[i];
+}
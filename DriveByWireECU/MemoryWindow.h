@@ -0,0 +1,30 @@
+/*
+ * MemoryWindow.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef MEMORYWINDOW_H_
+#define MEMORYWINDOW_H_
+
+#include <stdint.h>
+
+//The RAM the PC may read over the memory request (ControlProtocol.h) to
+//look at live state by symbol, without a telemetry field for it.
+//
+//Only the statically allocated RAM is open: .relocate (initialised data,
+//and the RAM functions ahead of it), .bss, which holds the RTOS heap with
+//the task stacks, .noinit and the backup RAM. The main stack, the GMAC's
+//DMA memory, flash and the peripherals are not, so a read has no side
+//effects. Reads race the tasks that write: a range that is word aligned
+//and a whole number of words long is copied a word at a time, so no
+//aligned 32 bit variable is ever torn, anything longer may mix two
+//updates.
+
+//1 if all of address .. address + length - 1 is in one open region
+uint8_t MemoryWindowAllowed(uint32_t address, uint32_t length);
+
+//Copies a range MemoryWindowAllowed accepted
+void MemoryWindowRead(uint8_t* destination, uint32_t address, uint32_t length);
+
+#endif /* MEMORYWINDOW_H_ */
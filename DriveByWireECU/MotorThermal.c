@@ -0,0 +1,52 @@
+/*
+ * MotorThermal.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "MotorThermal.h"
+#include "FastCode.h"
+
+void MotorThermalInit(motor_thermal_t* thermal, const motor_thermal_config_t* config, float dt, float ambient)
+{
+	memset(thermal, 0, sizeof(*thermal));
+	thermal->config = config;
+	thermal->cycles_per_update = (uint16_t)(MOTOR_THERMAL_UPDATE / dt + 0.5f);
+	if( thermal->cycles_per_update == 0 )
+		thermal->cycles_per_update = 1;
+	thermal->mean_scale = 1.0f / thermal->cycles_per_update;
+	thermal->weight = thermal->cycles_per_update * dt / config->tau;
+	if( config->derate_end > config->derate_start )
+		thermal->derate_slope = (1.0f - config->min_limit) / (config->derate_end - config->derate_start);
+	thermal->temperature = ambient;
+	thermal->limit = 1.0f;
+}
+
+FAST_CODE float MotorThermalStep(motor_thermal_t* thermal, float duty, float ambient)
+{
+	thermal->duty_squared += duty * duty;
+	if( ++thermal->cycles < thermal->cycles_per_update )
+		return thermal->limit;
+
+	const motor_thermal_config_t* config = thermal->config;
+	float settled = ambient + config->rise * thermal->duty_squared * thermal->mean_scale;
+	thermal->temperature += (settled - thermal->temperature) * thermal->weight;
+	thermal->duty_squared = 0.0f;
+	thermal->cycles = 0;
+
+	float limit = 1.0f;
+	if( thermal->temperature > config->derate_start )
+	{
+		limit -= (thermal->temperature - config->derate_start) * thermal->derate_slope;
+		if( limit < config->min_limit )
+			limit = config->min_limit;
+	}
+	thermal->limit = limit;
+	return limit;
+}
+
+void MotorThermalMeasured(motor_thermal_t* thermal, float temperature)
+{
+	thermal->temperature += (temperature - thermal->temperature) * MOTOR_THERMAL_CORRECTION;
+}
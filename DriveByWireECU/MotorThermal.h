@@ -0,0 +1,126 @@
+/*
+ * MotorThermal.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef MOTORTHERMAL_H_
+#define MOTORTHERMAL_H_
+
+#include <stdint.h>
+
+//Estimated temperature of an actuator motor, and the duty it is derated to
+//as it heats up.
+//
+//The copper losses go with the square of the current, and at a given
+//supply with the square of the duty. The motor is taken as one thermal
+//mass with a resistance to the air around it:
+//
+//	T += (ambient + rise * mean duty^2 - T) * MOTOR_THERMAL_UPDATE / tau
+//
+//rise is how far over ambient the motor settles at full duty, tau how fast,
+//both read off a run at a fixed duty from cold. Every control cycle adds
+//its duty^2 to a sum, and every MOTOR_THERMAL_UPDATE s the mean of it moves
+//the temperature, a multiply-add a cycle and a few more per update,
+//whatever the duty did. Stepped every ms instead, a change in T of dt / tau
+//of the distance left would fall under a float's resolution degrees short
+//of where the motor settles.
+//
+//Where a sensor sits on the motor, every new reading pulls the estimate
+//toward it by MOTOR_THERMAL_CORRECTION. The model carries the estimate
+//between readings, a few hundred ms apart (SensorHub.h), and through a
+//sensor that stopped answering, the readings keep a rise or tau that is
+//off from drifting away.
+//
+//Below derate_start the whole duty is allowed. From there the share
+//allowed falls in a straight line to min_limit at derate_end and stays
+//there, so a motor held near its limit is eased back rather than cut off.
+//Set the thresholds below the winding's rating by what the winding runs
+//over the case, which is what the sensor and with it the model follow.
+
+//Set to 1 to derate the steering motor, the estimates are published either way
+#ifndef MOTOR_THERMAL_ENABLE
+#define MOTOR_THERMAL_ENABLE 0
+#endif
+
+//degC, the ambient without a board temperature sensor
+#ifndef MOTOR_THERMAL_AMBIENT
+#define MOTOR_THERMAL_AMBIENT 25.0f
+#endif
+
+//s between two updates of the temperature
+#define MOTOR_THERMAL_UPDATE 0.1f
+
+//weight of a new sensor reading in the estimate
+#ifndef MOTOR_THERMAL_CORRECTION
+#define MOTOR_THERMAL_CORRECTION 0.2f
+#endif
+
+//Steering motor: s, degC over ambient at full duty, degC the derating
+//starts and ends at, and the share of full duty left at the end
+#ifndef STEERING_MOTOR_THERMAL_TAU
+#define STEERING_MOTOR_THERMAL_TAU 600.0f
+#endif
+#ifndef STEERING_MOTOR_THERMAL_RISE
+#define STEERING_MOTOR_THERMAL_RISE 90.0f
+#endif
+#ifndef STEERING_MOTOR_DERATE_START
+#define STEERING_MOTOR_DERATE_START 80.0f
+#endif
+#ifndef STEERING_MOTOR_DERATE_END
+#define STEERING_MOTOR_DERATE_END 110.0f
+#endif
+#ifndef STEERING_MOTOR_MIN_LIMIT
+#define STEERING_MOTOR_MIN_LIMIT 0.3f
+#endif
+
+//Front brake motor, as the steering's. It is never derated, a brake held
+//back to save its motor is worse than the motor.
+#ifndef BRAKE_MOTOR_THERMAL_TAU
+#define BRAKE_MOTOR_THERMAL_TAU 300.0f
+#endif
+#ifndef BRAKE_MOTOR_THERMAL_RISE
+#define BRAKE_MOTOR_THERMAL_RISE 70.0f
+#endif
+
+typedef struct motor_thermal_config_t
+{
+	//s and degC
+	float tau;
+	float rise;
+	float derate_start;
+	float derate_end;
+	//share of full duty at derate_end and above
+	float min_limit;
+} motor_thermal_config_t;
+
+typedef struct motor_thermal_t
+{
+	const motor_thermal_config_t* config;
+	//MOTOR_THERMAL_UPDATE / tau, and the limit lost per degC over
+	//derate_start
+	float weight;
+	float derate_slope;
+	//duty^2 summed over the cycles since the last update
+	float duty_squared;
+	uint16_t cycles;
+	uint16_t cycles_per_update;
+	float mean_scale;
+	//degC
+	float temperature;
+	//share of full duty allowed
+	float limit;
+} motor_thermal_t;
+
+//dt in s of a cycle, starts at ambient, which a motor that was off long
+//enough is
+void MotorThermalInit(motor_thermal_t* thermal, const motor_thermal_config_t* config, float dt, float ambient);
+
+//One cycle at duty, 0 to 1 of full, with the air at ambient. Returns the
+//share of full duty allowed, as of the last update.
+float MotorThermalStep(motor_thermal_t* thermal, float duty, float ambient);
+
+//A new reading of the motor's sensor, degC
+void MotorThermalMeasured(motor_thermal_t* thermal, float temperature);
+
+#endif /* MOTORTHERMAL_H_ */
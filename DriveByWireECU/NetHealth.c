@@ -0,0 +1,145 @@
+/*
+ * NetHealth.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hri_gmac_e54.h>
+#include <hal_mac_async.h>
+#include "lwip/sys.h"
+#include "lwip/timers.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+#include "ethif_mac.h"
+#include "NetHealth.h"
+#include "SignalBus.h"
+
+typedef enum net_health_counter_t
+{
+	NET_HEALTH_RX_FRAMES = 0,
+	NET_HEALTH_TX_FRAMES,
+	NET_HEALTH_CRC_ERRORS,
+	NET_HEALTH_FRAME_ERRORS,
+	NET_HEALTH_COLLISIONS,
+	NET_HEALTH_OVERRUNS,
+	NET_HEALTH_RESOURCE_ERRORS,
+	NET_HEALTH_TX_REFUSED,
+	NET_HEALTH_LINK_DROPS,
+	NET_HEALTH_PBUF_FAILURES,
+	NET_HEALTH_MBOX_OVERFLOWS,
+	NET_HEALTH_UDP_DROPS,
+	NET_HEALTH_RX_RESYNCS,
+	NET_HEALTH_RX_SHED,
+	NET_HEALTH_COUNTER_COUNT
+} net_health_counter_t;
+
+static const signal_id_t net_health_signals[NET_HEALTH_COUNTER_COUNT] =
+{
+	[NET_HEALTH_RX_FRAMES] = SIGNAL_NET_RX_FRAMES,
+	[NET_HEALTH_TX_FRAMES] = SIGNAL_NET_TX_FRAMES,
+	[NET_HEALTH_CRC_ERRORS] = SIGNAL_NET_CRC_ERRORS,
+	[NET_HEALTH_FRAME_ERRORS] = SIGNAL_NET_FRAME_ERRORS,
+	[NET_HEALTH_COLLISIONS] = SIGNAL_NET_COLLISIONS,
+	[NET_HEALTH_OVERRUNS] = SIGNAL_NET_OVERRUNS,
+	[NET_HEALTH_RESOURCE_ERRORS] = SIGNAL_NET_RESOURCE_ERRORS,
+	[NET_HEALTH_TX_REFUSED] = SIGNAL_NET_TX_REFUSED,
+	[NET_HEALTH_LINK_DROPS] = SIGNAL_NET_LINK_DROPS,
+	[NET_HEALTH_PBUF_FAILURES] = SIGNAL_NET_PBUF_FAILURES,
+	[NET_HEALTH_MBOX_OVERFLOWS] = SIGNAL_NET_MBOX_OVERFLOWS,
+	[NET_HEALTH_UDP_DROPS] = SIGNAL_NET_UDP_DROPS,
+	[NET_HEALTH_RX_RESYNCS] = SIGNAL_NET_RX_RESYNCS,
+	[NET_HEALTH_RX_SHED] = SIGNAL_NET_RX_SHED,
+};
+
+//tcpip thread only
+static struct
+{
+	struct netif* netif;
+	//sys_now of the last sample
+	uint32_t sampled_at;
+	//the counters that do not clear on read, as of the last sample
+	struct mac_async_ring_stats ring;
+	uint32_t rx_shed;
+	STAT_COUNTER last_link_drops;
+	STAT_COUNTER last_pbuf_failures;
+	STAT_COUNTER last_mbox_overflows;
+	STAT_COUNTER last_udp_drops;
+} net_health;
+
+//What each counter moved by since the last sample. The lwIP ones are 16
+//bits and wrap, a difference of them is right while they moved by less.
+static void ReadCounters(uint32_t* moved)
+{
+	moved[NET_HEALTH_RX_FRAMES] = hri_gmac_read_FR_reg(GMAC);
+	moved[NET_HEALTH_TX_FRAMES] = hri_gmac_read_FT_reg(GMAC);
+	moved[NET_HEALTH_CRC_ERRORS] = hri_gmac_read_FCSE_reg(GMAC);
+	moved[NET_HEALTH_FRAME_ERRORS] = hri_gmac_read_AE_reg(GMAC) + hri_gmac_read_RSE_reg(GMAC)
+		+ hri_gmac_read_LFFE_reg(GMAC) + hri_gmac_read_UFR_reg(GMAC) + hri_gmac_read_OFR_reg(GMAC)
+		+ hri_gmac_read_JR_reg(GMAC) + hri_gmac_read_IHCE_reg(GMAC) + hri_gmac_read_TCE_reg(GMAC)
+		+ hri_gmac_read_UCE_reg(GMAC);
+	moved[NET_HEALTH_COLLISIONS] = hri_gmac_read_SCF_reg(GMAC) + hri_gmac_read_MCF_reg(GMAC)
+		+ hri_gmac_read_LC_reg(GMAC) + hri_gmac_read_EC_reg(GMAC);
+
+	//ROE and RRE are summed up by hpl_gmac.c, they clear on its read
+	struct mac_async_ring_stats ring;
+	mac_async_get_ring_stats((struct mac_async_descriptor*)net_health.netif->state, &ring);
+	moved[NET_HEALTH_OVERRUNS] = ring.rx_overruns - net_health.ring.rx_overruns + hri_gmac_read_TUR_reg(GMAC);
+	moved[NET_HEALTH_RESOURCE_ERRORS] = ring.rx_no_buffer - net_health.ring.rx_no_buffer;
+	moved[NET_HEALTH_TX_REFUSED] = ring.tx_full - net_health.ring.tx_full;
+	moved[NET_HEALTH_RX_RESYNCS] = ring.rx_resyncs - net_health.ring.rx_resyncs;
+	net_health.ring = ring;
+	uint32_t shed = ethernetif_mac_rx_shed();
+	moved[NET_HEALTH_RX_SHED] = shed - net_health.rx_shed;
+	net_health.rx_shed = shed;
+
+#if LINK_STATS
+	moved[NET_HEALTH_LINK_DROPS] = (STAT_COUNTER)(lwip_stats.link.drop - net_health.last_link_drops);
+	net_health.last_link_drops = lwip_stats.link.drop;
+#else
+	moved[NET_HEALTH_LINK_DROPS] = 0;
+#endif
+#if MEMP_STATS
+	moved[NET_HEALTH_PBUF_FAILURES] = (STAT_COUNTER)(lwip_stats.memp[MEMP_PBUF_POOL].err - net_health.last_pbuf_failures);
+	net_health.last_pbuf_failures = lwip_stats.memp[MEMP_PBUF_POOL].err;
+#else
+	moved[NET_HEALTH_PBUF_FAILURES] = 0;
+#endif
+#if SYS_STATS
+	moved[NET_HEALTH_MBOX_OVERFLOWS] = (STAT_COUNTER)(lwip_stats.sys.mbox.err - net_health.last_mbox_overflows);
+	net_health.last_mbox_overflows = lwip_stats.sys.mbox.err;
+#else
+	moved[NET_HEALTH_MBOX_OVERFLOWS] = 0;
+#endif
+#if UDP_STATS
+	moved[NET_HEALTH_UDP_DROPS] = (STAT_COUNTER)(lwip_stats.udp.drop - net_health.last_udp_drops);
+	net_health.last_udp_drops = lwip_stats.udp.drop;
+#else
+	moved[NET_HEALTH_UDP_DROPS] = 0;
+#endif
+}
+
+static void NetHealthSample(void* arg)
+{
+	uint32_t moved[NET_HEALTH_COUNTER_COUNT];
+	uint32_t now = sys_now();
+	uint32_t elapsed = now - net_health.sampled_at;
+	ReadCounters(moved);
+	net_health.sampled_at = now;
+
+	//a late timeout stretches the period, not the rates
+	float per_second = elapsed ? 1000.0f / (float)elapsed : 0.0f;
+	for(uint32_t i = 0; i < NET_HEALTH_COUNTER_COUNT; ++i)
+		SignalPublishFloat(net_health_signals[i], (float)moved[i] * per_second);
+
+	sys_timeout(NET_HEALTH_PERIOD, NetHealthSample, arg);
+}
+
+void NetHealthStart(struct netif* netif)
+{
+	uint32_t moved[NET_HEALTH_COUNTER_COUNT];
+	net_health.netif = netif;
+	//what counted up during boot is not a rate, the first one starts here
+	ReadCounters(moved);
+	net_health.sampled_at = sys_now();
+	sys_timeout(NET_HEALTH_PERIOD, NetHealthSample, NULL);
+}
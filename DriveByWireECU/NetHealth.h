@@ -0,0 +1,51 @@
+/*
+ * NetHealth.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef NETHEALTH_H_
+#define NETHEALTH_H_
+
+#include <stdint.h>
+#include "lwip/netif.h"
+
+//Where frames get lost, as rates on the signal bus (SignalBus.h).
+//
+//Every NET_HEALTH_PERIOD a timeout in the tcpip thread reads the GMAC's
+//statistics registers, which clear on read, the receive ring's counters of
+//hpl_gmac.c and lwIP's LWIP_STATS, and publishes what each moved by per
+//second as a SIGNAL_NET_* signal. Telemetry signal sets, the diag server's
+//signals page and signal_watch.py pick them up from there, next to the
+//command latency when it spikes. Apart, the counters tell the causes:
+//
+//	crc, frame errors	the cable, the connector or the PHY
+//	collisions			a half duplex link (PhyMonitor.h)
+//	overruns			the receive FIFO filled or the transmit one ran dry,
+//						the GMAC did not get the bus
+//	resource errors		the ring had no buffer, gmac_task fell behind
+//	tx refused			the transmit ring was full
+//	link drops			frames lwIP's port let go: no pbuf for a received
+//						one, an unused broadcast, a transmit that did not fit
+//	pbuf failures		the PBUF_POOL was empty (PoolMonitor.h)
+//	mbox overflows		a full tcpip or netconn receive mbox, a queue the
+//						reader did not drain in time
+//	udp drops			datagrams for no pcb, or that failed their checksum
+//	rx resyncs			the receive ring had fallen behind the DMA after it
+//						stalled, and was skipped ahead (hpl_gmac.c)
+//	rx shed				normal frames freed short of receive buffers, so
+//						the control ones get them (ethif_mac.h)
+//
+//The GMAC counters saturate rather than wrap, far above anything a second
+//at 100 Mbit/s can reach.
+
+//ms between samples
+#ifndef NET_HEALTH_PERIOD
+#define NET_HEALTH_PERIOD 1000
+#endif
+
+//Takes the first sample of netif's GMAC and from then on. In the tcpip
+//thread, after netif is added.
+void NetHealthStart(struct netif* netif);
+
+#endif /* NETHEALTH_H_ */
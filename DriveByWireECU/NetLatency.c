@@ -0,0 +1,155 @@
+/*
+ * NetLatency.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <compiler.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "NetLatency.h"
+#include "FastCode.h"
+#include "TimeBase.h"
+#include "Seqlock.h"
+
+static const char* const hop_names[NET_LATENCY_HOP_COUNT] =
+{
+	"interrupt_to_wake", "wake_to_input", "input_to_received", "received_to_applied", "total"
+};
+
+//Written only by main_task, hops are read under sequence (Seqlock.h)
+typedef struct net_latency_stats_t
+{
+	uint32_t sequence;
+	uint8_t reset_request;
+	profiler_stats_t hops[NET_LATENCY_HOP_COUNT];
+} net_latency_stats_t;
+
+//the first command clears the stats
+static net_latency_stats_t net_latency_stats = { .reset_request = 1 };
+
+#if NET_LATENCY_ENABLE
+
+typedef struct net_latency_t
+{
+	//set by the interrupt, taken by the next wake. Receive complete is
+	//masked until gmac_task has drained the ring, there is one at a time.
+	volatile uint8_t interrupt_pending;
+	uint32_t interrupt;
+	//gmac_task only, the wake's interrupt until the pass's first frame
+	uint8_t woken;
+	uint32_t woken_interrupt;
+	uint32_t wake;
+	//the newest frame handed to lwIP, read under sequence
+	uint32_t sequence;
+	net_latency_stamps_t frame;
+	//main_task only, the last command counted
+	uint32_t applied_received;
+} net_latency_t;
+
+static net_latency_t net_latency;
+
+//Wraps after 35 s at 120MHz, the hops are differences of a few ms at most
+FAST_CODE static uint32_t Stamp()
+{
+	return (uint32_t)TimeBaseCycles();
+}
+
+FAST_CODE void NetLatencyInterrupt()
+{
+	if( net_latency.interrupt_pending )
+		return;
+	net_latency.interrupt = Stamp();
+	__atomic_store_n(&net_latency.interrupt_pending, 1, __ATOMIC_RELEASE);
+}
+
+FAST_CODE void NetLatencyWake()
+{
+	uint32_t now = Stamp();
+	//a refill timeout has no interrupt to pair with
+	net_latency.woken = __atomic_load_n(&net_latency.interrupt_pending, __ATOMIC_ACQUIRE);
+	if( !net_latency.woken )
+		return;
+	net_latency.woken_interrupt = net_latency.interrupt;
+	net_latency.wake = now;
+	__atomic_store_n(&net_latency.interrupt_pending, 0, __ATOMIC_RELEASE);
+}
+
+FAST_CODE void NetLatencyInput()
+{
+	uint32_t now = Stamp();
+	SeqlockWriteBegin(&net_latency.sequence);
+	net_latency.frame.woken = net_latency.woken;
+	net_latency.frame.interrupt = net_latency.woken ? net_latency.woken_interrupt : 0;
+	net_latency.frame.wake = net_latency.woken ? net_latency.wake : 0;
+	net_latency.frame.input = now;
+	SeqlockWriteEnd(&net_latency.sequence);
+	net_latency.woken = 0;
+}
+
+FAST_CODE void NetLatencyReceived(net_latency_stamps_t* stamps)
+{
+	uint32_t sequence;
+	do
+	{
+		sequence = SeqlockReadBegin(&net_latency.sequence);
+		*stamps = net_latency.frame;
+	} while( SeqlockReadRetry(&net_latency.sequence, sequence) );
+	stamps->received = Stamp();
+	//0 means not stamped to NetLatencyApplied
+	if( stamps->received == 0 )
+		stamps->received = 1;
+}
+
+FAST_CODE void NetLatencyApplied(const net_latency_stamps_t* stamps)
+{
+	uint32_t now = Stamp();
+	if( stamps->received == 0 || stamps->received == net_latency.applied_received )
+		return;
+	net_latency.applied_received = stamps->received;
+
+	net_latency_stats_t* stats = &net_latency_stats;
+	SeqlockWriteBegin(&stats->sequence);
+	if( __atomic_exchange_n(&stats->reset_request, 0, __ATOMIC_ACQUIRE) )
+	{
+		for(int i = 0; i < NET_LATENCY_HOP_COUNT; ++i)
+			ProfilerStatsClear(&stats->hops[i]);
+	}
+	if( stamps->woken )
+	{
+		ProfilerStatsAdd(&stats->hops[NET_LATENCY_HOP_WAKE], stamps->wake - stamps->interrupt);
+		ProfilerStatsAdd(&stats->hops[NET_LATENCY_HOP_INPUT], stamps->input - stamps->wake);
+		ProfilerStatsAdd(&stats->hops[NET_LATENCY_HOP_TOTAL], now - stamps->interrupt);
+	}
+	ProfilerStatsAdd(&stats->hops[NET_LATENCY_HOP_RECEIVE], stamps->received - stamps->input);
+	ProfilerStatsAdd(&stats->hops[NET_LATENCY_HOP_APPLY], now - stamps->received);
+	SeqlockWriteEnd(&stats->sequence);
+}
+
+#endif
+
+const char* NetLatencyHopName(net_latency_hop_t hop)
+{
+	return hop < NET_LATENCY_HOP_COUNT ? hop_names[hop] : "";
+}
+
+void NetLatencyRead(net_latency_hop_t hop, profiler_stats_t* stats)
+{
+	if( hop >= NET_LATENCY_HOP_COUNT || __atomic_load_n(&net_latency_stats.reset_request, __ATOMIC_ACQUIRE) )
+	{
+		ProfilerStatsClear(stats);
+		return;
+	}
+
+	uint32_t sequence;
+	do
+	{
+		sequence = SeqlockReadBegin(&net_latency_stats.sequence);
+		*stats = net_latency_stats.hops[hop];
+	} while( SeqlockReadRetry(&net_latency_stats.sequence, sequence) );
+}
+
+void NetLatencyRequestReset()
+{
+	__atomic_store_n(&net_latency_stats.reset_request, 1, __ATOMIC_RELEASE);
+}
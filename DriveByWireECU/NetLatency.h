@@ -0,0 +1,102 @@
+/*
+ * NetLatency.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef NETLATENCY_H_
+#define NETLATENCY_H_
+
+#include <stdint.h>
+#include "Profiler.h"
+
+//Where a command's latency goes between the wire and the control loop.
+//
+//A command frame is stamped at each hop it takes:
+//	interrupt	gmac_handler_cb, receive complete
+//	wake		gmac_task back from its notification
+//	input		the frame handed to lwIP by ethif_mac.c
+//	received	the command decoded, in raw_udp_receive or past recvfrom in
+//				ethernet_thread
+//	applied		main_task taking it in ApplyLatestCommand
+//and main_task adds the time of every hop, and from the interrupt to
+//applied, to a histogram in the profiler's bins (Profiler.h). The stamps
+//travel with the command in control_command_t. The diagnostics server
+//(DiagServer.h) serves the histograms, a profile reset request clears them.
+//
+//The stamps are core cycles of the time base (TimeBase.h), the DWT cycle
+//counter would stop while main_task waits in idle sleep.
+//
+//Receive complete stays masked while gmac_task drains the ring, so only
+//the first frame of a pass has an interrupt and a wake of its own, the
+//frames after it count from input on. While gmac_task polls the ring under
+//load (GMAC_RX_ADAPTIVE) no frame has them. Frames queued to the tcpip thread
+//rather than processed in gmac_task (ETHERNET_FAST_INPUT) are stamped
+//received with the newest frame handed to lwIP rather than their own.
+
+//Set to 0 to compile every stamp out
+#ifndef NET_LATENCY_ENABLE
+#define NET_LATENCY_ENABLE PROFILER_ENABLE
+#endif
+
+typedef enum net_latency_hop_t
+{
+	NET_LATENCY_HOP_WAKE = 0,
+	NET_LATENCY_HOP_INPUT,
+	NET_LATENCY_HOP_RECEIVE,
+	NET_LATENCY_HOP_APPLY,
+	//interrupt to applied
+	NET_LATENCY_HOP_TOTAL,
+	NET_LATENCY_HOP_COUNT
+} net_latency_hop_t;
+
+//Stamps of one command, 0 until NetLatencyReceived
+typedef struct net_latency_stamps_t
+{
+	uint32_t interrupt;
+	uint32_t wake;
+	uint32_t input;
+	uint32_t received;
+	//interrupt and wake are this frame's
+	uint8_t woken;
+} net_latency_stamps_t;
+
+#if NET_LATENCY_ENABLE
+//GMAC interrupt, receive complete
+void NetLatencyInterrupt();
+//gmac_task, every return from its wait
+void NetLatencyWake();
+//Every frame handed to lwIP, from gmac_task
+void NetLatencyInput();
+//Fills stamps for the command just decoded from the newest frame
+void NetLatencyReceived(net_latency_stamps_t* stamps);
+//main_task, stamps of the command it just took in. A command selected
+//again, when its commander takes back over, is not counted twice.
+void NetLatencyApplied(const net_latency_stamps_t* stamps);
+#else
+static inline void NetLatencyInterrupt()
+{
+}
+static inline void NetLatencyWake()
+{
+}
+static inline void NetLatencyInput()
+{
+}
+static inline void NetLatencyReceived(net_latency_stamps_t* stamps)
+{
+}
+static inline void NetLatencyApplied(const net_latency_stamps_t* stamps)
+{
+}
+#endif
+
+const char* NetLatencyHopName(net_latency_hop_t hop);
+
+//Consistent copy of a hop's stats in core cycles, safe from any task
+void NetLatencyRead(net_latency_hop_t hop, profiler_stats_t* stats);
+
+//Clears every hop, with the next command
+void NetLatencyRequestReset();
+
+#endif /* NETLATENCY_H_ */
@@ -0,0 +1,148 @@
+/*
+ * NetMem.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "NetMem.h"
+#include "FastCode.h"
+
+FAST_CODE_FILE
+
+//Bytes per LDM/STM pair, eight registers
+#define NET_MEM_BURST 32
+
+//One burst from s to d, both word aligned, both moved past it
+#if defined(__thumb2__)
+#define NET_MEM_COPY_BURST(d, s) \
+	__asm volatile( \
+		"ldmia %[src]!, {r3, r4, r5, r6, r8, r9, r10, r12}\n" \
+		"stmia %[dst]!, {r3, r4, r5, r6, r8, r9, r10, r12}\n" \
+		: [dst] "+r" (d), [src] "+r" (s) \
+		: \
+		: "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12", "memory")
+#else
+#define NET_MEM_COPY_BURST(d, s) \
+	do \
+	{ \
+		for(int word = 0; word < NET_MEM_BURST / 4; ++word) \
+			*d++ = *s++; \
+	} while( 0 )
+#endif
+
+//Word at any address, the M4 splits an unaligned LDR in hardware
+static inline uint32_t LoadUnaligned(const uint8_t* p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+void NetMemcpy(void* dst, const void* src, uint32_t len)
+{
+	uint8_t* d = (uint8_t*)dst;
+	const uint8_t* s = (const uint8_t*)src;
+
+	//too short for the setup to pay off
+	if( len < 16 )
+	{
+		while( len-- )
+			*d++ = *s++;
+		return;
+	}
+
+	//dst aligned first, it is the side that cannot go unaligned in bursts
+	while( (uintptr_t)d & 3 )
+	{
+		*d++ = *s++;
+		len--;
+	}
+
+	if( ((uintptr_t)s & 3) == 0 )
+	{
+		uint32_t* dw = (uint32_t*)d;
+		const uint32_t* sw = (const uint32_t*)s;
+		for(; len >= NET_MEM_BURST; len -= NET_MEM_BURST)
+			NET_MEM_COPY_BURST(dw, sw);
+		for(; len >= 4; len -= 4)
+			*dw++ = *sw++;
+		d = (uint8_t*)dw;
+		s = (const uint8_t*)sw;
+	}
+	else
+	{
+		uint32_t* dw = (uint32_t*)d;
+		for(; len >= 16; len -= 16, s += 16)
+		{
+			dw[0] = LoadUnaligned(s);
+			dw[1] = LoadUnaligned(s + 4);
+			dw[2] = LoadUnaligned(s + 8);
+			dw[3] = LoadUnaligned(s + 12);
+			dw += 4;
+		}
+		for(; len >= 4; len -= 4, s += 4)
+			*dw++ = LoadUnaligned(s);
+		d = (uint8_t*)dw;
+	}
+
+	while( len-- )
+		*d++ = *s++;
+}
+
+uint16_t NetChecksum(const void* data, int len)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	uint64_t sum = 0;
+	uint32_t odd = (uintptr_t)p & 1;
+
+	//an odd start sums the bytes shifted by one, swapped back at the end
+	if( odd && len > 0 )
+	{
+		sum = (uint32_t)*p++ << 8;
+		len--;
+	}
+	//from here on p is even, make it a word
+	if( ((uintptr_t)p & 2) && len > 1 )
+	{
+		sum += *(const uint16_t*)p;
+		p += 2;
+		len -= 2;
+	}
+
+	const uint32_t* w = (const uint32_t*)p;
+	for(; len >= NET_MEM_BURST; len -= NET_MEM_BURST, w += NET_MEM_BURST / 4)
+	{
+		sum += w[0];
+		sum += w[1];
+		sum += w[2];
+		sum += w[3];
+		sum += w[4];
+		sum += w[5];
+		sum += w[6];
+		sum += w[7];
+	}
+	for(; len >= 4; len -= 4)
+		sum += *w++;
+
+	p = (const uint8_t*)w;
+	if( len >= 2 )
+	{
+		sum += *(const uint16_t*)p;
+		p += 2;
+		len -= 2;
+	}
+	//the last byte is the low half of a little endian halfword
+	if( len > 0 )
+		sum += *p;
+
+	//64 to 32 to 16 bits, the carries folded back in each time
+	sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+	sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+	uint32_t folded = (uint32_t)sum;
+	folded = (folded & 0xFFFF) + (folded >> 16);
+	folded = (folded & 0xFFFF) + (folded >> 16);
+
+	if( odd )
+		folded = ((folded & 0xFF) << 8) | (folded >> 8);
+	return (uint16_t)folded;
+}
@@ -0,0 +1,52 @@
+/*
+ * NetMem.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef NETMEM_H_
+#define NETMEM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+//Copy and Internet checksum kernels for the network path, in place of
+//newlib's memcpy and lwIP's generic lwip_standard_chksum.
+//
+//newlib nano's memcpy is built for size and copies a word at a time at
+//best, and the frames hpl_gmac.c copies between its ring buffers and the
+//pbufs are up to 1.5KB. NetMemcpy moves 32 bytes per LDM/STM pair once both
+//ends are word aligned. When they cannot both be, which is every frame with
+//ETH_PAD_SIZE in front of it, src is read with unaligned word loads, which
+//the M4 takes in its stride, and dst is written a word at a time.
+//
+//NetChecksum sums 32 bytes per iteration into a 64-bit accumulator, one
+//add with carry per word, and folds to 16 bits once at the end. lwIP's
+//version 2 adds 16 bits at a time. It is what LWIP_CHKSUM is with
+//NET_MEM_FAST, and returns the same host order, non-inverted sum as
+//lwip_standard_chksum, from any alignment.
+//
+//With GMAC checksum offload (lwipopts.h) the checksum only runs for ICMP
+//and for the Bench image. BenchImage.c times both kernels next to the
+//paths they replace: memcpy_* against net_memcpy_*, and inet_chksum_*
+//against net_chksum_* in a Bench build with NET_MEM_FAST at 0.
+
+//Set to 0 to leave lwIP and hpl_gmac.c on memcpy and lwip_standard_chksum
+#ifndef NET_MEM_FAST
+#define NET_MEM_FAST 1
+#endif
+
+//Copy of len bytes, any alignment, the areas may not overlap
+void NetMemcpy(void* dst, const void* src, uint32_t len);
+
+//Non-inverted Internet sum of len bytes at data, in host order
+uint16_t NetChecksum(const void* data, int len);
+
+//What the network path copies frames with
+#if NET_MEM_FAST
+#define NET_MEMCPY(dst, src, len) NetMemcpy(dst, src, len)
+#else
+#define NET_MEMCPY(dst, src, len) memcpy(dst, src, len)
+#endif
+
+#endif /* NETMEM_H_ */
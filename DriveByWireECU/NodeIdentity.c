@@ -0,0 +1,75 @@
+/*
+ * NodeIdentity.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "NodeIdentity.h"
+
+#if NODE_MAX_ID >= NODE_ANY
+#error NODE_MAX_ID must stay below NODE_ANY
+#endif
+
+static const uint8_t base_ip[4] = { NODE_BASE_IP };
+static const uint8_t base_mac[6] = { NODE_BASE_MAC };
+
+static node_identity_t node_identity;
+
+void NodeIdentityInit(const param_set_t* params)
+{
+	node_identity_t* node = &node_identity;
+	node->id = (uint8_t)params->values[PARAM_NODE_ID].u;
+
+	uint32_t ip = params->values[PARAM_NODE_IP].u;
+	if( ip == 0 )
+	{
+		memcpy(node->ip, base_ip, sizeof(node->ip));
+		node->ip[3] += node->id;
+	}
+	else
+	{
+		node->ip[0] = (uint8_t)(ip >> 24);
+		node->ip[1] = (uint8_t)(ip >> 16);
+		node->ip[2] = (uint8_t)(ip >> 8);
+		node->ip[3] = (uint8_t)ip;
+	}
+
+	uint32_t mac = params->values[PARAM_NODE_MAC].u;
+	if( mac == 0 )
+	{
+		memcpy(node->mac, base_mac, sizeof(node->mac));
+		node->mac[5] += node->id;
+	}
+	else
+	{
+		//locally administered, unicast
+		node->mac[0] = 0x02;
+		node->mac[1] = 0x00;
+		node->mac[2] = 0x00;
+		node->mac[3] = (uint8_t)(mac >> 16);
+		node->mac[4] = (uint8_t)(mac >> 8);
+		node->mac[5] = (uint8_t)mac;
+	}
+
+	uint32_t peer_ip = params->values[PARAM_PEER_IP].u;
+	node->peer_ip[0] = (uint8_t)(peer_ip >> 24);
+	node->peer_ip[1] = (uint8_t)(peer_ip >> 16);
+	node->peer_ip[2] = (uint8_t)(peer_ip >> 8);
+	node->peer_ip[3] = (uint8_t)peer_ip;
+
+	uint32_t peer_mac_high = params->values[PARAM_PEER_MAC_HIGH].u;
+	uint32_t peer_mac_low = params->values[PARAM_PEER_MAC_LOW].u;
+	node->peer_mac_set = peer_mac_high != 0 || peer_mac_low != 0;
+	node->peer_mac[0] = (uint8_t)(peer_mac_high >> 16);
+	node->peer_mac[1] = (uint8_t)(peer_mac_high >> 8);
+	node->peer_mac[2] = (uint8_t)peer_mac_high;
+	node->peer_mac[3] = (uint8_t)(peer_mac_low >> 16);
+	node->peer_mac[4] = (uint8_t)(peer_mac_low >> 8);
+	node->peer_mac[5] = (uint8_t)peer_mac_low;
+}
+
+const node_identity_t* NodeIdentity()
+{
+	return &node_identity;
+}
@@ -0,0 +1,64 @@
+/*
+ * NodeIdentity.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef NODEIDENTITY_H_
+#define NODEIDENTITY_H_
+
+#include <stdint.h>
+#include "ParamStore.h"
+
+//Which ECU of a vehicle this one is, and the addresses it answers on.
+//
+//A vehicle can carry several ECUs on one network, a steering and a drive
+//ECU for instance, all running the same firmware. Each gets its node id,
+//IP and MAC from the node parameters in NVM (ParamStore.h), set over the
+//param port and saved like any tuning parameter. They are read once at
+//boot, a change takes effect at the next one.
+//
+//Left at 0, node_ip and node_mac follow from node_id: NODE_BASE_IP and
+//NODE_BASE_MAC with node_id added to their last byte. A board that never
+//had its node set boots as node 0 on the addresses the ECU always had.
+//The PC finds the nodes on the network with the discovery request and the
+//announce frames (ControlProtocol.h) and addresses each by its IP.
+//
+//The autonomy PC's IP and MAC can be stored the same way, for a vehicle
+//whose PC is known: EthernetIO.c then gives it a static ARP entry and asks
+//it for its address the moment the link comes up, so the first command
+//and its reply wait on no address resolution either way.
+
+//Address of node 0, as four comma separated bytes
+#ifndef NODE_BASE_IP
+#define NODE_BASE_IP 192, 168, 2, 100
+#endif
+//MAC of node 0, as six comma separated bytes
+#ifndef NODE_BASE_MAC
+#define NODE_BASE_MAC 0x00, 0x00, 0x00, 0x00, 0x20, 0x76
+#endif
+
+//Highest node id, the base addresses leave room for this many more
+#define NODE_MAX_ID 63
+//Node id of a discovery request every node answers
+#define NODE_ANY 0xFF
+
+typedef struct node_identity_t
+{
+	uint8_t id;
+	//first octet first
+	uint8_t ip[4];
+	uint8_t mac[6];
+	//the PC's, all 0 where not stored
+	uint8_t peer_ip[4];
+	uint8_t peer_mac[6];
+	uint8_t peer_mac_set;
+} node_identity_t;
+
+//Takes the node parameters of params. Call once at boot, after
+//ParamStoreInit and before the network starts.
+void NodeIdentityInit(const param_set_t* params);
+
+const node_identity_t* NodeIdentity();
+
+#endif /* NODEIDENTITY_H_ */
@@ -0,0 +1,69 @@
+/*
+ * Nvm.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hri_nvmctrl_e54.h>
+#include <hpl_cmcc.h>
+#include "Nvm.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define NVM_ERRORS (NVMCTRL_INTFLAG_ADDRE | NVMCTRL_INTFLAG_PROGE | NVMCTRL_INTFLAG_LOCKE | NVMCTRL_INTFLAG_NVME)
+
+void NvmWaitReady(uint8_t may_block)
+{
+	while( !hri_nvmctrl_get_STATUS_READY_bit(NVMCTRL) )
+	{
+		if( may_block )
+			vTaskDelay(1);
+	}
+}
+
+uint8_t NvmCommand(uint32_t address, uint32_t command, uint8_t may_block)
+{
+	NvmWaitReady(may_block);
+	hri_nvmctrl_clear_INTFLAG_reg(NVMCTRL, NVM_ERRORS);
+	hri_nvmctrl_write_ADDR_reg(NVMCTRL, address);
+	hri_nvmctrl_write_CTRLB_reg(NVMCTRL, NVMCTRL_CTRLB_CMDEX_KEY | command);
+	NvmWaitReady(may_block);
+	return (hri_nvmctrl_read_INTFLAG_reg(NVMCTRL) & NVM_ERRORS) == 0;
+}
+
+uint8_t NvmProgramPage(uint32_t address, const void* data, uint32_t length, uint8_t may_block)
+{
+	if( length > NVM_PAGE_SIZE )
+		return 0;
+
+	//the page buffer is only written when told to
+	hri_nvmctrl_write_CTRLA_WMODE_bf(NVMCTRL, NVMCTRL_CTRLA_WMODE_MAN_Val);
+	if( !NvmCommand(address, NVMCTRL_CTRLB_CMD_PBC, may_block) )
+		return 0;
+
+	//a word at a time, data need not be aligned
+	const uint8_t* source = data;
+	volatile uint32_t* page = (volatile uint32_t*)address;
+	for(uint32_t offset = 0; offset < NVM_PAGE_SIZE; offset += 4)
+	{
+		uint32_t word = 0xFFFFFFFF;
+		if( offset < length )
+			memcpy(&word, &source[offset], length - offset < 4 ? length - offset : 4);
+		page[offset / 4] = word;
+	}
+	if( !NvmCommand(address, NVMCTRL_CTRLB_CMD_WP, may_block) )
+		return 0;
+
+	//what is in the flash now, not what the cache kept of the page before
+	_cmcc_invalidate_all(CMCC);
+	if( memcmp((const void*)address, data, length) != 0 )
+		return 0;
+	const uint8_t* padding = (const uint8_t*)address;
+	for(uint32_t offset = length; offset < NVM_PAGE_SIZE; ++offset)
+	{
+		if( padding[offset] != 0xFF )
+			return 0;
+	}
+	return 1;
+}
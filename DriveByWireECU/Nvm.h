@@ -0,0 +1,38 @@
+/*
+ * Nvm.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef NVM_H_
+#define NVM_H_
+
+#include <stdint.h>
+
+//Erasing and programming the main flash array through the NVMCTRL, for the
+//steering calibration (SteeringCalibration.h) and firmware updates
+//(FirmwareUpdate.h). The SmartEEPROM has its own interface (ParamStore.h).
+//
+//may_block: non-zero from a task that may sleep while the NVMCTRL is busy,
+//0 spins, for callers that must not give up the core or have interrupts
+//off. An erase takes a few ms and a page write about one. The ParamStore
+//idle hook holds back its SmartEEPROM writes while the NVMCTRL is busy.
+//
+//One writer at a time, the NVMCTRL takes one command at a time.
+
+#define NVM_PAGE_SIZE 512
+#define NVM_BLOCK_SIZE 8192
+
+//Returns once the NVMCTRL is ready for a command
+void NvmWaitReady(uint8_t may_block);
+
+//Runs a NVMCTRL_CTRLB_CMD_* command on address and waits for it. Returns 1
+//if it went through.
+uint8_t NvmCommand(uint32_t address, uint32_t command, uint8_t may_block);
+
+//Programs the page at address, erased beforehand, with length bytes of data
+//padded with erased bytes, and reads it back. Returns 1 if the page reads
+//back as written.
+uint8_t NvmProgramPage(uint32_t address, const void* data, uint32_t length, uint8_t may_block);
+
+#endif /* NVM_H_ */
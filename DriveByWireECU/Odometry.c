@@ -0,0 +1,45 @@
+/*
+ * Odometry.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <math.h>
+#include "Odometry.h"
+#include "FastCode.h"
+
+#define ODOMETRY_PI 3.14159265f
+
+void OdometryInit(odometry_t* odometry, float wheelbase, float dt)
+{
+	odometry->dt = dt;
+	odometry->inverse_wheelbase = 1.0f / wheelbase;
+	OdometryReset(odometry);
+}
+
+void OdometryReset(odometry_t* odometry)
+{
+	odometry->x = 0.0f;
+	odometry->y = 0.0f;
+	odometry->heading = 0.0f;
+	odometry->yaw_rate = 0.0f;
+}
+
+FAST_CODE void OdometryStep(odometry_t* odometry, float speed, float steering_angle)
+{
+	odometry->yaw_rate = speed * tanf(steering_angle * (ODOMETRY_PI / 180.0f)) * odometry->inverse_wheelbase;
+	float turn = odometry->yaw_rate * odometry->dt;
+	float distance = speed * odometry->dt;
+
+	float midway = odometry->heading + 0.5f * turn;
+	odometry->x += distance * cosf(midway);
+	odometry->y += distance * sinf(midway);
+
+	//a step turns far less than a turn, one wrap is enough
+	float heading = odometry->heading + turn;
+	if( heading > ODOMETRY_PI )
+		heading -= 2.0f * ODOMETRY_PI;
+	else if( heading < -ODOMETRY_PI )
+		heading += 2.0f * ODOMETRY_PI;
+	odometry->heading = heading;
+}
@@ -0,0 +1,47 @@
+/*
+ * Odometry.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef ODOMETRY_H_
+#define ODOMETRY_H_
+
+#include <stdint.h>
+
+//Dead reckoning of the cart's pose from the measured speed and steering
+//angle, every control cycle.
+//
+//A kinematic bicycle model: the rear axle moves along the heading at the
+//measured speed and the heading turns at speed * tan(steering) / wheelbase.
+//Each step advances along the heading halfway through the step, which
+//keeps a steady turn on its circle rather than spiralling out of it. The
+//pose starts at 0, 0 facing along x at boot, the PC places it on its map.
+//Everything is single precision for the FPU, a step is one tanf, one sinf
+//and one cosf. Wheel slip and the steering's lag are not modelled, the
+//error grows with distance like any odometry.
+
+typedef struct odometry_t
+{
+	//m and rad, heading in -pi .. pi, counter clockwise from x
+	float x;
+	float y;
+	float heading;
+	//rad/s in the last step
+	float yaw_rate;
+
+	//s per step and 1 / wheelbase in m
+	float dt;
+	float inverse_wheelbase;
+} odometry_t;
+
+//wheelbase in m, dt in s. Starts at the origin.
+void OdometryInit(odometry_t* odometry, float wheelbase, float dt);
+
+void OdometryReset(odometry_t* odometry);
+
+//One step at speed in m/s, negative in reverse, and the steering angle in
+//degrees, positive to the left
+void OdometryStep(odometry_t* odometry, float speed, float steering_angle);
+
+#endif /* ODOMETRY_H_ */
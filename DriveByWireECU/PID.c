@@ -48,15 +48,23 @@
  *
  *				Derivative component = (D Gain) * ((error - lastError) / time - lastTime)
  *
+ *					*Optionally the derivative of the negated feedback is used instead,
+ *					which is the same while the target holds still but does not kick
+ *					when it steps, and smoothed by a first order filter.
+ *
  * The output generated by the PID Controller is the sum of the three
- * components.
+ * components, plus a feedforward the caller may give for the target.
  *
- *		PID output = Proportional component + Integral component + Derivative component
+ *		PID output = Proportional component + Integral component + Derivative component + Feedforward
  */
 
 #include <stdlib.h>
 #include <stdint.h>
 #include "PID.h"
+#include "FastCode.h"
+
+//the float math of every control cycle
+FAST_CODE_FILE
 
 /**
  * Constructs the PIDController object with PID Gains and function pointers
@@ -69,14 +77,15 @@
  * @param (*pidSource) The function pointer for retrieving system feedback.
  * @param (*pidOutput) The function pointer for delivering system output.
  */
-PIDController *createPIDController(double p, double i, double d, int (*pidSource)(void), void (*pidOutput)(int output)) {
+PIDController *createPIDController(float p, float i, float d, int (*pidSource)(void), void (*pidOutput)(int output)) {
 
 	PIDController *controller = malloc(sizeof(PIDController));
-	controller->p = p;
-	controller->i = i;
-	controller->d = d;
+	controller->p = PID_GAIN(p);
+	controller->i = PID_GAIN(i);
+	controller->d = PID_GAIN(d);
 	controller->target = 0;
 	controller->output = 0;
+	controller->feedforward = 0;
 	controller->enabled = 1;
 	controller->currentFeedback = 0;
 	controller->lastFeedback = 0;
@@ -85,6 +94,12 @@ PIDController *createPIDController(double p, double i, double d, int (*pidSource
 	controller->lastTime = 0L;
 	controller->integralCumulation = 0;
 	controller->maxCumulation = 30000;
+	controller->cycleDerivative = 0;
+	controller->antiWindup = PID_ANTI_WINDUP_NONE;
+	controller->antiWindupGain = PID_GAIN(0.0f);
+	controller->derivativeOnMeasurement = 0;
+	controller->derivativeFilter = PID_GAIN(0.0f);
+	controller->derivativePrimed = 0;
 	controller->inputBounded = 0;
 	controller->outputBounded = 0;
 	controller->inputLowerBound = 0;
@@ -92,6 +107,9 @@ PIDController *createPIDController(double p, double i, double d, int (*pidSource
 	controller->outputBounded = 0;
 	controller->outputLowerBound = 0;
 	controller->outputUpperBound = 0;
+	controller->feedbackWrapped = 0;
+	controller->feedbackWrapLowerBound = 0;
+	controller->feedbackWrapUpperBound = 0;
 	controller->timeFunctionRegistered = 0;
 	controller->pidSource = pidSource;
 	controller->pidOutput = pidOutput;
@@ -99,121 +117,145 @@ PIDController *createPIDController(double p, double i, double d, int (*pidSource
 	return controller;
 }
 
+/**
+ * Calculates the error for a controller whose feedback wraps around, for
+ * example an angle. Feedback wrapping causes two distant numbers to appear
+ * adjacent to one another for the purpose of calculating the system's error.
+ * Used by pid_step() and pid_step_timed() when feedback wrapping is enabled.
+ */
+int getWrappedError(PIDController *c) {
+
+	/*
+	 * There are three ways to traverse from one point to another in this setup.
+	 *
+	 *		1)	Target --> Feedback
+	 *
+	 * The other two ways involve bridging a gap connected by the upper and
+	 * lower bounds of the feedback wrap.
+	 *
+	 *		2)	Target --> Upper Bound == Lower Bound --> Feedback
+	 *
+	 *		3)	Target --> Lower Bound == Upper Bound --> Feedback
+	 *
+	 * Of these three paths, one should always be shorter than the other two,
+	 * unless all three are equal, in which case it does not matter which path
+	 * is taken.
+	 */
+	int regErr = c->target - c->currentFeedback;
+	int altErr1 = (c->target - c->feedbackWrapLowerBound) + (c->feedbackWrapUpperBound - c->currentFeedback);
+	int altErr2 = (c->feedbackWrapUpperBound - c->target) + (c->currentFeedback - c->feedbackWrapLowerBound);
+
+	// Calculate the absolute values of each error.
+	int regErrAbs = (regErr >= 0) ? regErr : -regErr;
+	int altErr1Abs = (altErr1 >= 0) ? altErr1 : -altErr1;
+	int altErr2Abs = (altErr2 >= 0) ? altErr2 : -altErr2;
+
+	// Use the error with the smallest absolute value. Path 2 raises the
+	// feedback to reach the target and path 3 lowers it, so path 3's error
+	// is negative.
+	if(regErrAbs <= altErr1Abs && regErrAbs <= altErr2Abs) {
+		return regErr;
+	}
+	else if(altErr1Abs < regErrAbs && altErr1Abs < altErr2Abs) {
+		return altErr1;
+	}
+	else if(altErr2Abs < regErrAbs && altErr2Abs < altErr1Abs) {
+		return -altErr2;
+	}
+	return c->error;
+}
+
+/**
+ * Calculates the negated change of the feedback since the last update for a
+ * controller whose feedback wraps around, taking the shorter way around as
+ * the one the feedback moved. Used by pid_step() for the derivative on
+ * measurement when feedback wrapping is enabled.
+ */
+int getWrappedFeedbackChange(PIDController *c) {
+
+	int range = c->feedbackWrapUpperBound - c->feedbackWrapLowerBound;
+	int change = c->lastFeedback - c->currentFeedback;
+
+	if(change > range / 2) {
+		change -= range;
+	}
+	else if(change < -range / 2) {
+		change += range;
+	}
+	return change;
+}
+
+/**
+ * Keeps the integral from winding up while the output is trimmed to one of
+ * its bounds, according to the controller's anti-windup mode. Used by
+ * pid_step() whenever it trims the output.
+ * @param lastCumulation The integral cumulation before this update.
+ * @param excess The untrimmed output minus the bound it was trimmed to,
+ *				 positive above the upper bound.
+ */
+void antiWindup(PIDController *c, int lastCumulation, int excess) {
+
+	if(c->antiWindup == PID_ANTI_WINDUP_CONDITIONAL) {
+		// Drop this update's share of the integral if it moved the output further past the bound.
+		pid_term_t lastITerm = PID_SCALE(lastCumulation, c->i);
+		if(c->lastITerm != lastITerm && (c->lastITerm > lastITerm) == (excess > 0)) {
+			c->integralCumulation = lastCumulation;
+			c->lastITerm = lastITerm;
+		}
+	}
+	else if(c->antiWindup == PID_ANTI_WINDUP_BACK_CALCULATION && c->i != 0) {
+		// Wind the integral back by a share of the excess, converted back into cumulation.
+		c->integralCumulation -= PID_UNSCALE(PID_SCALE(excess, c->antiWindupGain), c->i);
+		c->lastITerm = PID_SCALE(c->integralCumulation, c->i);
+	}
+}
+
 /**
  * This method uses the established function pointers to retrieve system
  * feedback, calculate the PID output, and deliver the correction value
  * to the parent of this PIDController.	This method should be run as
  * fast as the source of the feedback in order to provide the highest
  * resolution of control (for example, to be placed in the loop() method).
+ * It is a thin wrapper over pid_step(), which hot paths should call directly.
  */
 void tick(PIDController *c) {
 
 	if(c->enabled) {
 		//Retrieve system feedback from user callback.
-		c->currentFeedback = c->pidSource();
-
-		//Apply input bounds if necessary.
-		if(c->inputBounded) {
-			if(c->currentFeedback > c->inputUpperBound) c->currentFeedback = c->inputUpperBound;
-			if(c->currentFeedback < c->inputLowerBound) c->currentFeedback = c->inputLowerBound;
-		}
-
-		/*
-		 * Feedback wrapping causes two distant numbers to appear adjacent to one
-		 * another for the purpose of calculating the system's error.
-		 */
-		if(c->feedbackWrapped) {
-
-			/*
-			 * There are three ways to traverse from one point to another in this setup.
-			 *
-			 *		1)	Target --> Feedback
-			 *
-			 * The other two ways involve bridging a gap connected by the upper and
-			 * lower bounds of the feedback wrap.
-			 *
-			 *		2)	Target --> Upper Bound == Lower Bound --> Feedback
-			 *
-			 *		3)	Target --> Lower Bound == Upper Bound --> Feedback
-			 *
-			 * Of these three paths, one should always be shorter than the other two,
-			 * unless all three are equal, in which case it does not matter which path
-			 * is taken.
-			 */
-			int regErr = c->target - c->currentFeedback;
-			int altErr1 = (c->target - c->feedbackWrapLowerBound) + (c->feedbackWrapUpperBound - c->currentFeedback);
-			int altErr2 = (c->feedbackWrapUpperBound - c->target) + (c->currentFeedback - c->feedbackWrapLowerBound);
-
-			// Calculate the absolute values of each error.
-			int regErrAbs = (regErr >= 0) ? regErr : -regErr;
-			int altErr1Abs = (altErr1 >= 0) ? altErr1 : -altErr1;
-			int altErr2Abs = (altErr2 >= 0) ? altErr2 : -altErr2;
-
-			// Use the error with the smallest absolute value
-			if(regErrAbs <= altErr1Abs && regErr <= altErr2Abs) {
-				c->error = regErr;
-			}
-			else if(altErr1Abs < regErrAbs && altErr1Abs < altErr2Abs) {
-				c->error = altErr1Abs;
-			}
-			else if(altErr2Abs < regErrAbs && altErr2Abs < altErr1Abs) {
-				c->error = altErr2Abs;
-			}
-		}
-		else {
-			// Calculate the error between the feedback and the target.
-			c->error = c->target - c->currentFeedback;
-		}
+		int feedback = c->pidSource();
 
 		// If we have a registered way to retrieve the system time, use time in PID calculations.
+		long deltaTime = PID_DT_UNTIMED;
 		if(c->timeFunctionRegistered) {
-			// Retrieve system time
 			c->currentTime = c->getSystemTime();
-
-			// Calculate time since last tick() cycle.
-			long deltaTime = c->currentTime - c->lastTime;
-
-			// Calculate the integral of the feedback data since last cycle.
-			int cycleIntegral = (c->lastError + c->error / 2) * deltaTime;
-
-			// Add this cycle's integral to the integral cumulation.
-			c->integralCumulation += cycleIntegral;
-
-			// Calculate the slope of the line with data from the current and last cycles.
-			c->cycleDerivative = (c->error - c->lastError) / deltaTime;
-
-			// Save time data for next iteration.
+			deltaTime = c->currentTime - c->lastTime;
 			c->lastTime = c->currentTime;
 		}
-		// If we have no way to retrieve system time, estimate calculations.
-		else {
-			c->integralCumulation += c->error;
-			c->cycleDerivative = (c->error - c->lastError);
-		}
 
-		// Prevent the integral cumulation from becoming overwhelmingly huge.
-		if(c->integralCumulation > c->maxCumulation) c->integralCumulation = c->maxCumulation;
-		if(c->integralCumulation < -c->maxCumulation) c->integralCumulation = -c->maxCumulation;
-
-		// Calculate the system output based on data and PID gains.
-		c->lastPTerm = (double)c->error * c->p;
-		c->lastITerm = (double)c->integralCumulation * c->i;
-		c->lastDTerm = (double)c->cycleDerivative * c->d;
-
-		c->output = (int) (c->lastPTerm + c->lastITerm + c->lastDTerm);
-
-		// Save a record of this iteration's data.
-		c->lastFeedback = c->currentFeedback;
-		c->lastError = c->error;
+		c->pidOutput(pid_step(c, c->target, feedback, deltaTime));
+	}
+}
 
-		// Trim the output to the bounds if needed.
-		if(c->outputBounded) {
-			if(c->output > c->outputUpperBound) c->output = c->outputUpperBound;
-			if(c->output < c->outputLowerBound) c->output = c->outputLowerBound;
-		}
+/**
+ * The timing of an update for pid_step_timed, in Q16 periods clamped to
+ * PID_TIMING_MIN_PERIODS and PID_TIMING_MAX_PERIODS. The divisions are here so
+ * a cycle that steps several controllers only does them once.
+ * @param elapsed Time since the last update, 0 for one period.
+ * @param period Time of one update at the rate the gains were tuned at.
+ */
+pid_timing_t getPIDTiming(uint32_t elapsed, uint32_t period) {
 
-		c->pidOutput(c->output);
+	pid_timing_t timing = { PID_TIMING_ONE, PID_TIMING_ONE };
+	if(elapsed == 0 || period == 0) {
+		return timing;
 	}
+
+	float periods = (float)elapsed / (float)period;
+	if(periods < (float)PID_TIMING_MIN_PERIODS / PID_TIMING_ONE) periods = (float)PID_TIMING_MIN_PERIODS / PID_TIMING_ONE;
+	if(periods > (float)PID_TIMING_MAX_PERIODS / PID_TIMING_ONE) periods = (float)PID_TIMING_MAX_PERIODS / PID_TIMING_ONE;
+	timing.periods = (int32_t)(periods * PID_TIMING_ONE + 0.5f);
+	timing.inverse = (int32_t)(PID_TIMING_ONE / periods + 0.5f);
+	return timing;
 }
 
 /**
@@ -226,16 +268,57 @@ void setEnabled(PIDController *controller, uint8_t enabled) {
 	if(!enabled && controller->enabled) {
 		controller->output = 0;
 		controller->integralCumulation = 0;
+		controller->cycleDerivative = 0;
+		controller->derivativePrimed = 0;
 	}
 	controller->enabled = enabled;
 }
 
+/**
+ * Enables this PIDController for a bumpless transfer: its next update goes on
+ * from output, what the actuator gets now, instead of from an empty integral
+ * and a stale last error. The error of setpoint and feedback becomes the last
+ * error, so the derivative starts at 0, and the integral takes what the
+ * proportional term and the feedforward leave of output. Constant time.
+ * An enabled controller is left alone.
+ * @param setpoint The target of the next update.
+ * @param feedback The measured system feedback now.
+ * @param output The output the actuator holds now, in the controller's units.
+ */
+void setEnabledBumpless(PIDController *controller, int setpoint, int feedback, int output) {
+
+	if(controller->enabled) {
+		return;
+	}
+
+	if(controller->outputBounded) {
+		if(output > controller->outputUpperBound) output = controller->outputUpperBound;
+		if(output < controller->outputLowerBound) output = controller->outputLowerBound;
+	}
+
+	controller->derivativePrimed = 0;
+	pid_begin(controller, setpoint, feedback);
+	controller->lastError = controller->error;
+	controller->lastFeedback = controller->currentFeedback;
+	controller->cycleDerivative = 0;
+
+	int remainder = output - controller->feedforward - PID_TERM_TO_INT(PID_SCALE(controller->error, controller->p));
+	controller->integralCumulation = controller->i != 0 ? PID_UNSCALE(remainder, controller->i) : 0;
+	if(controller->maxCumulation > 0) {
+		if(controller->integralCumulation > controller->maxCumulation) controller->integralCumulation = controller->maxCumulation;
+		if(controller->integralCumulation < -controller->maxCumulation) controller->integralCumulation = -controller->maxCumulation;
+	}
+
+	controller->output = output;
+	controller->enabled = 1;
+}
+
 /**
  * Returns the value that the Proportional component is contributing to the output.
  * @return The value that the Proportional component is contributing to the output.
  */
 int getProportionalComponent(PIDController *controller) {
-	return (controller->error * controller->p);
+	return PID_TERM_TO_INT(PID_SCALE(controller->error, controller->p));
 }
 
 /**
@@ -243,7 +326,7 @@ int getProportionalComponent(PIDController *controller) {
  * @return The value that the Integral component is contributing to the output.
  */
 int getIntegralComponent(PIDController *controller) {
-	return (controller->integralCumulation * controller->i);
+	return PID_TERM_TO_INT(PID_SCALE(controller->integralCumulation, controller->i));
 }
 
 /**
@@ -251,7 +334,7 @@ int getIntegralComponent(PIDController *controller) {
  * @return The value that the Derivative component is contributing to the output.
  */
 int getDerivativeComponent(PIDController *controller) {
-	return (controller->cycleDerivative * controller->d);
+	return PID_TERM_TO_INT(PID_SCALE(controller->cycleDerivative, controller->d));
 }
 
 /**
@@ -271,6 +354,45 @@ void setMaxIntegralCumulation(PIDController *controller, int max) {
 	}
 }
 
+/**
+ * Selects how the integral is kept from winding up while the output is
+ * trimmed to its bounds, see PID_ANTI_WINDUP_NONE and the others.
+ * Only takes effect with output bounds.
+ * @param mode One of the PID_ANTI_WINDUP_ modes.
+ * @param gain The share of the excess output wound back per update with
+ *			   PID_ANTI_WINDUP_BACK_CALCULATION, ignored otherwise.
+ */
+void setAntiWindup(PIDController *controller, uint8_t mode, float gain) {
+
+	controller->antiWindup = mode;
+	controller->antiWindupGain = PID_GAIN(gain);
+}
+
+/**
+ * Takes the derivative from the negated feedback instead of from the error,
+ * so steps of the target do not kick the output.
+ * @param enabled True for the feedback, False for the error.
+ */
+void setDerivativeOnMeasurement(PIDController *controller, uint8_t enabled) {
+
+	controller->derivativeOnMeasurement = enabled;
+	// The last error and feedback are not interchangeable, start over.
+	controller->derivativePrimed = 0;
+}
+
+/**
+ * Smooths the derivative with a first order filter, each update the filtered
+ * derivative moves toward the new one by (1 - weight) of the difference.
+ * @param weight The weight of the filtered derivative, from 0 (unfiltered)
+ *				 up to but not including 1.
+ */
+void setDerivativeFilter(PIDController *controller, float weight) {
+
+	if(weight >= 0.0f && weight < 1.0f) {
+		controller->derivativeFilter = PID_GAIN(weight);
+	}
+}
+
 /**
  * Sets bounds which limit the lower and upper extremes that this PIDController
  * accepts as inputs.	Outliers are trimmed to the lower and upper bounds.
@@ -319,3 +441,34 @@ void setFeedbackWrapBounds(PIDController *controller, int lower, int upper) {
 	controller->feedbackWrapLowerBound = lower;
 	controller->feedbackWrapUpperBound = upper;
 }
+
+/**
+ * Sets the function this PIDController retrieves system feedback from
+ * in tick().
+ * @param (*pidSource) The function pointer for retrieving system feedback.
+ */
+void setPIDSource(PIDController *controller, int (*pidSource)()) {
+
+	controller->pidSource = pidSource;
+}
+
+/**
+ * Sets the function this PIDController delivers its output to in tick().
+ * @param (*pidOutput) The function pointer for delivering system output.
+ */
+void setPIDOutput(PIDController *controller, void (*pidOutput)(int output)) {
+
+	controller->pidOutput = pidOutput;
+}
+
+/**
+ * Registers a function that returns the system time, after which tick()
+ * integrates and differentiates over the time between calls instead of
+ * estimating per call. The first tick() after this measures from time 0.
+ * @param (*getSystemTime) The function pointer for retrieving the time.
+ */
+void registerTimeFunction(PIDController *controller, unsigned long (*getSystemTime)(void)) {
+
+	controller->getSystemTime = getSystemTime;
+	controller->timeFunctionRegistered = 1;
+}
@@ -3,13 +3,91 @@
 
 #include <stdint.h>
 
+/*
+ * Arithmetic used for the gains and the P/I/D terms. Feedback, target and
+ * output are always integers.
+ *
+ *		PID_ARITHMETIC_DOUBLE	The original implementation. The Cortex-M4F FPU is
+ *								single precision only so every term is software emulated.
+ *		PID_ARITHMETIC_FLOAT	Single precision, runs on the FPU.
+ *		PID_ARITHMETIC_Q16		Q16.16 fixed point gains, integer only. The terms are
+ *								kept in output units. Gains below about 0.001 lose
+ *								resolution, prefer float for very small I gains.
+ *
+ * Select one by defining PID_ARITHMETIC in the build, the default is double,
+ * float with SINGLE_PRECISION_ONLY (feature_config.h).
+ */
+#define PID_ARITHMETIC_DOUBLE 0
+#define PID_ARITHMETIC_FLOAT 1
+#define PID_ARITHMETIC_Q16 2
+
+#ifndef PID_ARITHMETIC
+#if SINGLE_PRECISION_ONLY
+#define PID_ARITHMETIC PID_ARITHMETIC_FLOAT
+#else
+#define PID_ARITHMETIC PID_ARITHMETIC_DOUBLE
+#endif
+#endif
+
+#if SINGLE_PRECISION_ONLY && PID_ARITHMETIC == PID_ARITHMETIC_DOUBLE
+#error SINGLE_PRECISION_ONLY builds take PID_ARITHMETIC_FLOAT or PID_ARITHMETIC_Q16
+#endif
+
+#if PID_ARITHMETIC == PID_ARITHMETIC_Q16
+typedef int32_t pid_gain_t;
+typedef int32_t pid_term_t;
+#define PID_Q16_ONE 65536
+//Converts a gain given as a real number into the controller's representation.
+#define PID_GAIN(x) ((pid_gain_t)((x) * PID_Q16_ONE))
+#define PID_GAIN_TO_FLOAT(g) ((float)(g) * (1.0f / PID_Q16_ONE))
+//Multiplies an integer by a gain giving a term.
+#define PID_SCALE(value, gain) ((pid_term_t)(((int64_t)(value) * (gain)) >> 16))
+//Divides a term by a non zero gain giving an integer, the inverse of PID_SCALE.
+#define PID_UNSCALE(term, gain) ((int)(((int64_t)(term) << 16) / (gain)))
+#define PID_TERM_TO_INT(t) ((int)(t))
+#elif PID_ARITHMETIC == PID_ARITHMETIC_FLOAT
+typedef float pid_gain_t;
+typedef float pid_term_t;
+#define PID_GAIN(x) ((pid_gain_t)(x))
+#define PID_GAIN_TO_FLOAT(g) (g)
+#define PID_SCALE(value, gain) ((float)(value) * (gain))
+#define PID_UNSCALE(term, gain) ((int)((term) / (gain)))
+#define PID_TERM_TO_INT(t) ((int)(t))
+#else
+typedef double pid_gain_t;
+typedef double pid_term_t;
+#define PID_GAIN(x) ((pid_gain_t)(x))
+#define PID_GAIN_TO_FLOAT(g) ((float)(g))
+#define PID_SCALE(value, gain) ((double)(value) * (gain))
+#define PID_UNSCALE(term, gain) ((int)((term) / (gain)))
+#define PID_TERM_TO_INT(t) ((int)(t))
+#endif
+
+/*
+ * What keeps the integral from winding up while the output is held at one of
+ * its bounds. Both modes only act on a controller with output bounds.
+ *
+ *		PID_ANTI_WINDUP_NONE			Only the maxCumulation clamp, the original behavior.
+ *		PID_ANTI_WINDUP_CONDITIONAL		The update's share of the integral is dropped
+ *										when the output is saturated and the share would
+ *										drive it further past the bound.
+ *		PID_ANTI_WINDUP_BACK_CALCULATION	While saturated the integral is wound back by
+ *										antiWindupGain times the output beyond the bound
+ *										every update, 1 winds it back in one update.
+ */
+#define PID_ANTI_WINDUP_NONE 0
+#define PID_ANTI_WINDUP_CONDITIONAL 1
+#define PID_ANTI_WINDUP_BACK_CALCULATION 2
+
 typedef struct pid_controller {
 
-	double p;
-	double i;
-	double d;
+	pid_gain_t p;
+	pid_gain_t i;
+	pid_gain_t d;
 	int target;
 	int output;
+	//added to the output of every update before the bounds, set before the update
+	int feedforward;
 	uint8_t enabled;
 	int currentFeedback;
 	int lastFeedback;
@@ -18,12 +96,22 @@ typedef struct pid_controller {
 	long currentTime;
 	long lastTime;
 	int integralCumulation;
+	//0 leaves the integral cumulation unlimited
 	int maxCumulation;
 	int cycleDerivative;
 
-	double lastPTerm;
-	double lastITerm;
-	double lastDTerm;
+	uint8_t antiWindup;
+	pid_gain_t antiWindupGain;
+	//derivative of the negated feedback instead of the error, no kick on setpoint steps
+	uint8_t derivativeOnMeasurement;
+	//weight of the last derivative in the first order filter, 0 is unfiltered
+	pid_gain_t derivativeFilter;
+	//the derivative is 0 until there is a last feedback to take it from
+	uint8_t derivativePrimed;
+
+	pid_term_t lastPTerm;
+	pid_term_t lastITerm;
+	pid_term_t lastDTerm;
 
 	uint8_t inputBounded;
 	int inputLowerBound;
@@ -42,14 +130,199 @@ typedef struct pid_controller {
 
 } PIDController;
 
-PIDController *createPIDController(double p, double i, double d, int (*pidSource)(void), void (*pidOutput)(int output));
+//Pass as dt to pid_step when there is no time base, the integral and
+//derivative are then estimated per call.
+#define PID_DT_UNTIMED (-1L)
+
+int getWrappedError(PIDController *c);
+int getWrappedFeedbackChange(PIDController *c);
+void antiWindup(PIDController *c, int lastCumulation, int excess);
+
+//Time of an update in periods of the rate the gains were tuned at, Q16,
+//for pid_step_timed. From getPIDTiming, once per cycle for every controller
+//stepped in it.
+#define PID_TIMING_ONE 65536
+
+typedef struct pid_timing_t {
+	int32_t periods;
+	//PID_TIMING_ONE / periods, Q16
+	int32_t inverse;
+} pid_timing_t;
+
+//What getPIDTiming clamps an interval to, Q16 periods. A cycle run late by a
+//stall keeps the integral from taking all of it at once, and one run right
+//after it the derivative from dividing by next to nothing.
+#ifndef PID_TIMING_MIN_PERIODS
+#define PID_TIMING_MIN_PERIODS (PID_TIMING_ONE / 4)
+#endif
+#ifndef PID_TIMING_MAX_PERIODS
+#define PID_TIMING_MAX_PERIODS (PID_TIMING_ONE * 4)
+#endif
+
+/**
+ * The error and its change of an update, the part pid_step and
+ * pid_step_timed share ahead of the integral and the derivative.
+ * @return The change of the error, or of the negated feedback, since the last
+ *		   update. 0 for the first.
+ */
+static inline int pid_begin(PIDController *c, int setpoint, int feedback) {
+
+	c->target = setpoint;
+	c->currentFeedback = feedback;
+
+	//Apply input bounds if necessary.
+	if(c->inputBounded) {
+		if(c->currentFeedback > c->inputUpperBound) c->currentFeedback = c->inputUpperBound;
+		if(c->currentFeedback < c->inputLowerBound) c->currentFeedback = c->inputLowerBound;
+	}
+
+	if(c->feedbackWrapped) {
+		c->error = getWrappedError(c);
+	}
+	else {
+		// Calculate the error between the feedback and the target.
+		c->error = c->target - c->currentFeedback;
+	}
+
+	// Calculate the change of the error, or of the negated feedback, since last cycle.
+	int change = 0;
+	if(c->derivativePrimed) {
+		if(!c->derivativeOnMeasurement) {
+			change = c->error - c->lastError;
+		}
+		else if(c->feedbackWrapped) {
+			change = getWrappedFeedbackChange(c);
+		}
+		else {
+			change = c->lastFeedback - c->currentFeedback;
+		}
+	}
+	c->derivativePrimed = 1;
+	return change;
+}
+
+/**
+ * The output of an update from its integral cumulation and derivative, the
+ * part pid_step and pid_step_timed share behind them.
+ * @param lastCumulation The integral cumulation before this update.
+ */
+static inline int pid_finish(PIDController *c, int lastCumulation, int derivative) {
+
+	// Prevent the integral cumulation from becoming overwhelmingly huge, 0 leaves it unlimited.
+	if(c->maxCumulation > 0) {
+		if(c->integralCumulation > c->maxCumulation) c->integralCumulation = c->maxCumulation;
+		if(c->integralCumulation < -c->maxCumulation) c->integralCumulation = -c->maxCumulation;
+	}
+
+	// Smooth the derivative, the filter keeps its output in cycleDerivative.
+	c->cycleDerivative = derivative + PID_TERM_TO_INT(PID_SCALE(c->cycleDerivative - derivative, c->derivativeFilter));
+
+	// Calculate the system output based on data and PID gains.
+	c->lastPTerm = PID_SCALE(c->error, c->p);
+	c->lastITerm = PID_SCALE(c->integralCumulation, c->i);
+	c->lastDTerm = PID_SCALE(c->cycleDerivative, c->d);
+
+	c->output = PID_TERM_TO_INT(c->lastPTerm + c->lastITerm + c->lastDTerm) + c->feedforward;
+
+	// Trim the output to the bounds if needed, and keep the integral from winding up meanwhile.
+	if(c->outputBounded) {
+		int bounded = c->output;
+		if(bounded > c->outputUpperBound) bounded = c->outputUpperBound;
+		if(bounded < c->outputLowerBound) bounded = c->outputLowerBound;
+
+		if(bounded != c->output && c->antiWindup != PID_ANTI_WINDUP_NONE) {
+			antiWindup(c, lastCumulation, c->output - bounded);
+		}
+		c->output = bounded;
+	}
+
+	// Save a record of this iteration's data.
+	c->lastFeedback = c->currentFeedback;
+	c->lastError = c->error;
+
+	return c->output;
+}
+
+/**
+ * Calculates one PID update from the given setpoint and feedback and returns
+ * the bounded output. No callbacks are made so the whole update can be
+ * inlined into the control loop.
+ * @param setpoint The target for this update.
+ * @param feedback The measured system feedback.
+ * @param dt Time since the last update in the controller's time units,
+ *			 or PID_DT_UNTIMED. A dt of 0 adds no integral and no derivative.
+ * @return The controller output. A disabled controller returns its last output.
+ */
+static inline int pid_step(PIDController *c, int setpoint, int feedback, long dt) {
+
+	if(!c->enabled) {
+		return c->output;
+	}
+
+	int change = pid_begin(c, setpoint, feedback);
+
+	int lastCumulation = c->integralCumulation;
+	int derivative;
+	if(dt > 0) {
+		// Calculate the integral of the feedback data since last cycle.
+		c->integralCumulation += (c->lastError + c->error) / 2 * dt;
+
+		// Calculate the slope of the line with data from the current and last cycles.
+		derivative = change / dt;
+	}
+	else if(dt == 0) {
+		derivative = 0;
+	}
+	// If we have no time base, estimate calculations.
+	else {
+		c->integralCumulation += c->error;
+		derivative = change;
+	}
+
+	return pid_finish(c, lastCumulation, derivative);
+}
+
+/**
+ * pid_step for gains tuned per period of a nominal rate, with the integral
+ * and the derivative taken over the measured time of the update. At exactly
+ * one period it gives what pid_step with PID_DT_UNTIMED does, bit for bit.
+ * @param timing The time since the last update, from getPIDTiming.
+ * @return The controller output. A disabled controller returns its last output.
+ */
+static inline int pid_step_timed(PIDController *c, int setpoint, int feedback, const pid_timing_t *timing) {
+
+	if(!c->enabled) {
+		return c->output;
+	}
+
+	int change = pid_begin(c, setpoint, feedback);
+
+	int lastCumulation = c->integralCumulation;
+	c->integralCumulation += (int)(((int64_t)c->error * timing->periods) >> 16);
+	int derivative = (int)(((int64_t)change * timing->inverse) >> 16);
+
+	return pid_finish(c, lastCumulation, derivative);
+}
+
+/**
+ * The timing of an update elapsed time units after the last, for gains tuned
+ * at one update per period time units. An elapsed of 0, no last update,
+ * counts as one period.
+ */
+pid_timing_t getPIDTiming(uint32_t elapsed, uint32_t period);
+
+PIDController *createPIDController(float p, float i, float d, int (*pidSource)(void), void (*pidOutput)(int output));
 
 void tick(PIDController *controller);
 void setEnabled(PIDController *controller, uint8_t e);
+void setEnabledBumpless(PIDController *controller, int setpoint, int feedback, int output);
 int getProportionalComponent(PIDController *controller);
 int getIntegralComponent(PIDController *controller);
 int getDerivativeComponent(PIDController *controller);
 void setMaxIntegralCumulation(PIDController *controller, int max);
+void setAntiWindup(PIDController *controller, uint8_t mode, float gain);
+void setDerivativeOnMeasurement(PIDController *controller, uint8_t enabled);
+void setDerivativeFilter(PIDController *controller, float weight);
 
 void setInputBounds(PIDController *controller, int lower, int upper);
 void setOutputBounds(PIDController *controller, int lower, int upper);
@@ -0,0 +1,310 @@
+/*
+ * PIDAutotune.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <math.h>
+#include <string.h>
+#include "PIDAutotune.h"
+#include "main_context.h"
+#include "ControlCore.h"
+#include "EventLog.h"
+
+#if PID_AUTOTUNE_ENABLE
+
+#define PID_AUTOTUNE_REQUEST_NONE 0
+#define PID_AUTOTUNE_REQUEST_START 1
+#define PID_AUTOTUNE_REQUEST_ABORT 2
+
+typedef struct pid_autotune_period_t
+{
+	//ms
+	uint32_t length;
+	//half peak to peak of the feedback, in the loop's ints
+	float oscillation;
+} pid_autotune_period_t;
+
+static struct
+{
+	//PID_AUTOTUNE_REQUEST_* and the loop to start in the high byte, from any task
+	uint16_t request;
+	//written by main_task, read by the network
+	pid_autotune_status_t status;
+	uint32_t started;
+
+	//in the loop's ints
+	int bias;
+	int amplitude;
+	int hysteresis;
+	int max_error;
+	//the bias is taken, with the first relay output
+	uint8_t biased;
+	//the relay is on the high side
+	uint8_t high;
+	//ms of the last upward switch, 0 before the first
+	uint32_t switched;
+	//the feedback's extremes since it
+	int feedback_max;
+	int feedback_min;
+	uint8_t settled;
+	//ring of the periods measured
+	pid_autotune_period_t measured[PID_AUTOTUNE_PERIODS];
+	uint8_t next;
+} pid_autotune;
+
+//PID ints of the loop's feedback per deg or m/s
+static float FeedbackScale(pid_autotune_loop_t loop)
+{
+	return loop == PID_AUTOTUNE_STEERING ? (float)ConvertAngleToPIDInt(1.0f) : (float)ConvertSpeedToPIDInt(1.0f);
+}
+
+//The loop's output in its units
+static float OutputUnits(pid_autotune_loop_t loop, int value)
+{
+#if STEERING_RATE_LOOP
+	if( loop == PID_AUTOTUNE_STEERING )
+		return ConvertPIDIntToRate(value);
+#endif
+	return ConvertPIDIntToDutyCycle(value);
+}
+
+static void Finish(main_context_t* ctx, pid_autotune_result_t result)
+{
+	pid_autotune_status_t* status = &pid_autotune.status;
+	status->elapsed = ctx->current_time - pid_autotune.started;
+	status->result = result;
+	__atomic_store_n(&status->state, PID_AUTOTUNE_IDLE, __ATOMIC_RELEASE);
+	//the tuned loop starts over from its gains
+	setEnabled(status->loop == PID_AUTOTUNE_STEERING ? &ctx->steering_controller : &ctx->speed_controller, 0);
+	EventLogWrite(EVENT_LOG_AUTOTUNE, (uint16_t)(result | (status->loop << 8)), status->elapsed);
+}
+
+static void Start(main_context_t* ctx, pid_autotune_loop_t loop)
+{
+	pid_autotune_status_t* status = &pid_autotune.status;
+	pid_autotune.started = ctx->current_time;
+	//the loop that runs is left alone
+	if( loop >= PID_AUTOTUNE_LOOP_COUNT || ctx->mode.mode != VEHICLE_MODE_AUTONOMOUS
+		|| (loop == PID_AUTOTUNE_SPEED && ctx->vehicle_speed < PID_AUTOTUNE_MIN_SPEED) )
+	{
+		status->result = PID_AUTOTUNE_REJECTED;
+		status->elapsed = 0;
+		EventLogWrite(EVENT_LOG_AUTOTUNE, (uint16_t)(PID_AUTOTUNE_REJECTED | (loop << 8)), 0);
+		return;
+	}
+	status->loop = loop;
+
+	if( loop == PID_AUTOTUNE_STEERING )
+	{
+#if STEERING_RATE_LOOP
+		pid_autotune.amplitude = ConvertRateToPIDInt(PID_AUTOTUNE_STEERING_AMPLITUDE);
+#else
+		pid_autotune.amplitude = ConvertDutyCycleToPIDInt(PID_AUTOTUNE_STEERING_AMPLITUDE);
+#endif
+		pid_autotune.hysteresis = ConvertAngleToPIDInt(PID_AUTOTUNE_STEERING_HYSTERESIS);
+		pid_autotune.max_error = ConvertAngleToPIDInt(PID_AUTOTUNE_STEERING_MAX_ERROR);
+	}
+	else
+	{
+		pid_autotune.amplitude = ConvertDutyCycleToPIDInt(PID_AUTOTUNE_SPEED_AMPLITUDE);
+		pid_autotune.hysteresis = ConvertSpeedToPIDInt(PID_AUTOTUNE_SPEED_HYSTERESIS);
+		pid_autotune.max_error = ConvertSpeedToPIDInt(PID_AUTOTUNE_SPEED_MAX_ERROR);
+	}
+	pid_autotune.biased = 0;
+	pid_autotune.switched = 0;
+	pid_autotune.settled = 0;
+	pid_autotune.next = 0;
+	status->periods = 0;
+	status->elapsed = 0;
+	__atomic_store_n(&status->state, PID_AUTOTUNE_SETTLE, __ATOMIC_RELEASE);
+}
+
+//Ku, Tu and the gains from the mean of the measured periods. 0 while they
+//do not agree yet.
+static uint8_t Identify(pid_autotune_loop_t loop)
+{
+	float length = 0.0f;
+	float oscillation = 0.0f;
+	for(uint32_t i = 0; i < PID_AUTOTUNE_PERIODS; ++i)
+	{
+		length += pid_autotune.measured[i].length;
+		oscillation += pid_autotune.measured[i].oscillation;
+	}
+	length /= PID_AUTOTUNE_PERIODS;
+	oscillation /= PID_AUTOTUNE_PERIODS;
+	for(uint32_t i = 0; i < PID_AUTOTUNE_PERIODS; ++i)
+	{
+		if( fabsf(pid_autotune.measured[i].length - length) > PID_AUTOTUNE_TOLERANCE * length
+			|| fabsf(pid_autotune.measured[i].oscillation - oscillation) > PID_AUTOTUNE_TOLERANCE * oscillation )
+			return 0;
+	}
+	float hysteresis = (float)pid_autotune.hysteresis;
+	//the noise switched the relay rather than the loop
+	if( oscillation <= hysteresis )
+		return 0;
+
+	pid_autotune_status_t* status = &pid_autotune.status;
+	float ku = 4.0f * pid_autotune.amplitude / ((float)M_PI * sqrtf(oscillation * oscillation - hysteresis * hysteresis));
+	//in the periods the gains are per
+	float tu = length * (1000.0f / CONTROL_GAIN_PERIOD_US);
+	status->oscillation = oscillation / FeedbackScale(loop);
+	status->ultimate_gain = ku;
+	status->ultimate_period = length;
+
+	float kp = 0.6f * ku;
+	status->ziegler_nichols.p = kp;
+	status->ziegler_nichols.i = kp / (tu / 2.0f);
+	status->ziegler_nichols.d = kp * (tu / 8.0f);
+	kp = ku / 2.2f;
+	status->tyreus_luyben.p = kp;
+	status->tyreus_luyben.i = kp / (2.2f * tu);
+	status->tyreus_luyben.d = kp * (tu / 6.3f);
+	return 1;
+}
+
+//An upward switch ends the period that started with the last one
+static void EndPeriod(main_context_t* ctx)
+{
+	pid_autotune_status_t* status = &pid_autotune.status;
+	uint32_t now = ctx->current_time;
+	uint32_t last = pid_autotune.switched;
+	pid_autotune.switched = now;
+	int peak_to_peak = pid_autotune.feedback_max - pid_autotune.feedback_min;
+	if( last == 0 )
+		return;
+
+	if( status->state == PID_AUTOTUNE_SETTLE )
+	{
+		if( ++pid_autotune.settled >= PID_AUTOTUNE_SETTLE_PERIODS )
+			status->state = PID_AUTOTUNE_MEASURE;
+		return;
+	}
+
+	pid_autotune_period_t* period = &pid_autotune.measured[pid_autotune.next];
+	period->length = now - last;
+	period->oscillation = peak_to_peak * 0.5f;
+	pid_autotune.next = (pid_autotune.next + 1) % PID_AUTOTUNE_PERIODS;
+	if( status->periods < PID_AUTOTUNE_PERIODS )
+		status->periods++;
+	if( status->periods == PID_AUTOTUNE_PERIODS && Identify(status->loop) )
+		Finish(ctx, PID_AUTOTUNE_DONE);
+}
+
+void PIDAutotuneRequestStart(pid_autotune_loop_t loop)
+{
+	__atomic_store_n(&pid_autotune.request, (uint16_t)(PID_AUTOTUNE_REQUEST_START | (loop << 8)), __ATOMIC_RELEASE);
+}
+
+void PIDAutotuneRequestAbort()
+{
+	__atomic_store_n(&pid_autotune.request, PID_AUTOTUNE_REQUEST_ABORT, __ATOMIC_RELEASE);
+}
+
+void PIDAutotuneUpdate(main_context_t* ctx)
+{
+	uint16_t request = __atomic_exchange_n(&pid_autotune.request, PID_AUTOTUNE_REQUEST_NONE, __ATOMIC_ACQUIRE);
+	pid_autotune_status_t* status = &pid_autotune.status;
+	if( status->state != PID_AUTOTUNE_IDLE )
+	{
+		if( (request & 0xFF) == PID_AUTOTUNE_REQUEST_ABORT || ctx->mode.mode != VEHICLE_MODE_AUTONOMOUS )
+			Finish(ctx, PID_AUTOTUNE_ABORTED);
+		else if( ctx->current_time - pid_autotune.started > PID_AUTOTUNE_TIMEOUT )
+			Finish(ctx, PID_AUTOTUNE_TIMED_OUT);
+	}
+	else if( (request & 0xFF) == PID_AUTOTUNE_REQUEST_START )
+		Start(ctx, (pid_autotune_loop_t)(request >> 8));
+}
+
+uint8_t PIDAutotuneRelay(main_context_t* ctx, pid_autotune_loop_t loop, PIDController* controller,
+	int setpoint, int feedback, int* output)
+{
+	pid_autotune_status_t* status = &pid_autotune.status;
+	if( status->state == PID_AUTOTUNE_IDLE || status->loop != loop )
+		return 0;
+
+	status->elapsed = ctx->current_time - pid_autotune.started;
+	int error = setpoint - feedback;
+	//the first cycle, the PID just stepped from where it held the loop
+	if( !pid_autotune.biased )
+	{
+		pid_autotune.biased = 1;
+		pid_autotune.bias = controller->output;
+		status->bias = OutputUnits(loop, controller->output);
+		pid_autotune.high = error > 0;
+		pid_autotune.feedback_max = feedback;
+		pid_autotune.feedback_min = feedback;
+	}
+
+	//the cycle that ends the tune holds the bias, the PID starts over in the next
+	if( error > pid_autotune.max_error || error < -pid_autotune.max_error )
+		Finish(ctx, PID_AUTOTUNE_RUNAWAY);
+	if( status->state == PID_AUTOTUNE_IDLE )
+	{
+		*output = pid_autotune.bias;
+		return 1;
+	}
+
+	if( feedback > pid_autotune.feedback_max )
+		pid_autotune.feedback_max = feedback;
+	if( feedback < pid_autotune.feedback_min )
+		pid_autotune.feedback_min = feedback;
+
+	if( !pid_autotune.high && error > pid_autotune.hysteresis )
+	{
+		pid_autotune.high = 1;
+		EndPeriod(ctx);
+		pid_autotune.feedback_max = feedback;
+		pid_autotune.feedback_min = feedback;
+		if( status->state == PID_AUTOTUNE_IDLE )
+		{
+			*output = pid_autotune.bias;
+			return 1;
+		}
+	}
+	else if( pid_autotune.high && error < -pid_autotune.hysteresis )
+		pid_autotune.high = 0;
+
+	int relay = pid_autotune.bias + (pid_autotune.high ? pid_autotune.amplitude : -pid_autotune.amplitude);
+	if( controller->outputBounded )
+	{
+		if( relay > controller->outputUpperBound )
+			relay = controller->outputUpperBound;
+		if( relay < controller->outputLowerBound )
+			relay = controller->outputLowerBound;
+	}
+	*output = relay;
+	return 1;
+}
+
+void PIDAutotuneStatus(pid_autotune_status_t* status)
+{
+	*status = pid_autotune.status;
+}
+
+#else
+
+void PIDAutotuneRequestStart(pid_autotune_loop_t loop)
+{
+}
+
+void PIDAutotuneRequestAbort()
+{
+}
+
+void PIDAutotuneUpdate(struct main_context_t* ctx)
+{
+}
+
+uint8_t PIDAutotuneRelay(struct main_context_t* ctx, pid_autotune_loop_t loop, PIDController* controller,
+	int setpoint, int feedback, int* output)
+{
+	return 0;
+}
+
+void PIDAutotuneStatus(pid_autotune_status_t* status)
+{
+	memset(status, 0, sizeof(*status));
+}
+
+#endif
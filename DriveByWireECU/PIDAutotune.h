@@ -0,0 +1,195 @@
+/*
+ * PIDAutotune.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PIDAUTOTUNE_H_
+#define PIDAUTOTUNE_H_
+
+#include <stdint.h>
+#include "PID.h"
+#include "SteeringRateLoop.h"
+
+//Measures the steering or the speed loop on the cart by relay feedback
+//(Astrom and Hagglund) and suggests gains for it, in a minute rather than
+//an afternoon of override_pid packets.
+//
+//A start comes over the control channel (the autotune request,
+//ControlProtocol.h) and is only taken up in Autonomous mode, the speed
+//loop's only at PID_AUTOTUNE_MIN_SPEED or more. The driving agent keeps
+//commanding the setpoint to tune around and its leases, the estop and the
+//deadlines stay in force. From then on the loop's output is the relay's:
+//the output it had at the start, the bias, plus the amplitude while the
+//error is above the hysteresis and minus it while below, until the error
+//crosses the hysteresis the other way. The other loop runs on as before.
+//
+//The loop then oscillates at its ultimate period Tu. Every period, from
+//one upward switch to the next, gives Tu and the half peak to peak a of
+//the feedback, and from those the ultimate gain
+//
+//	Ku = 4 d / (pi sqrt(a^2 - h^2))
+//
+//with d the amplitude and h the hysteresis. The first
+//PID_AUTOTUNE_SETTLE_PERIODS are skipped, the tune ends once the last
+//PID_AUTOTUNE_PERIODS agree to within PID_AUTOTUNE_TOLERANCE and reports
+//their means, and the gains of two rules in the units of the loop's
+//parameters (ParamStore.h), per ms like the firmware's gains:
+//
+//	Ziegler-Nichols	Kp = 0.6 Ku		Ti = Tu / 2		Td = Tu / 8
+//	Tyreus-Luyben	Kp = Ku / 2.2	Ti = 2.2 Tu		Td = Tu / 6.3
+//
+//Ziegler-Nichols is the quick one and overshoots, Tyreus-Luyben the
+//damped one. Nothing is applied, the PC sets what it picks with a
+//parameter set.
+//
+//Leaving Autonomous mode, an error beyond PID_AUTOTUNE_MAX_ERROR, no
+//agreement within PID_AUTOTUNE_TIMEOUT and an abort request end the tune.
+//However it ends the loop starts over from its gains the next cycle, and
+//it is an EVENT_LOG_AUTOTUNE entry.
+
+#ifndef PID_AUTOTUNE_ENABLE
+#define PID_AUTOTUNE_ENABLE 0
+#endif
+
+//Relay amplitudes in the loops' outputs: duty cycle of the steering motor,
+//or deg/s with STEERING_RATE_LOOP, and throttle duty cycle
+#ifndef PID_AUTOTUNE_STEERING_AMPLITUDE
+#if STEERING_RATE_LOOP
+#define PID_AUTOTUNE_STEERING_AMPLITUDE 10.0f
+#else
+#define PID_AUTOTUNE_STEERING_AMPLITUDE 0.15f
+#endif
+#endif
+#ifndef PID_AUTOTUNE_SPEED_AMPLITUDE
+#define PID_AUTOTUNE_SPEED_AMPLITUDE 0.1f
+#endif
+
+//Hysteresis in the loops' feedback, deg and m/s. Above the sensor noise,
+//or the noise switches the relay.
+#ifndef PID_AUTOTUNE_STEERING_HYSTERESIS
+#define PID_AUTOTUNE_STEERING_HYSTERESIS 0.2f
+#endif
+#ifndef PID_AUTOTUNE_SPEED_HYSTERESIS
+#define PID_AUTOTUNE_SPEED_HYSTERESIS 0.05f
+#endif
+
+//Error that ends the tune, deg and m/s
+#ifndef PID_AUTOTUNE_STEERING_MAX_ERROR
+#define PID_AUTOTUNE_STEERING_MAX_ERROR 5.0f
+#endif
+#ifndef PID_AUTOTUNE_SPEED_MAX_ERROR
+#define PID_AUTOTUNE_SPEED_MAX_ERROR 1.0f
+#endif
+
+//m/s the cart has to be moving at for the speed loop, so the relay stays on
+//the throttle and off the brake
+#ifndef PID_AUTOTUNE_MIN_SPEED
+#define PID_AUTOTUNE_MIN_SPEED 1.0f
+#endif
+
+//Periods skipped while the oscillation builds up, and measured
+#ifndef PID_AUTOTUNE_SETTLE_PERIODS
+#define PID_AUTOTUNE_SETTLE_PERIODS 2
+#endif
+#ifndef PID_AUTOTUNE_PERIODS
+#define PID_AUTOTUNE_PERIODS 4
+#endif
+
+//Share of their mean within which the measured periods and amplitudes
+//have to lie
+#ifndef PID_AUTOTUNE_TOLERANCE
+#define PID_AUTOTUNE_TOLERANCE 0.2f
+#endif
+
+//ms from the start
+#ifndef PID_AUTOTUNE_TIMEOUT
+#define PID_AUTOTUNE_TIMEOUT 30000
+#endif
+
+typedef enum pid_autotune_loop_t
+{
+	PID_AUTOTUNE_STEERING = 0,
+	PID_AUTOTUNE_SPEED,
+	PID_AUTOTUNE_LOOP_COUNT
+} pid_autotune_loop_t;
+
+typedef enum pid_autotune_state_t
+{
+	PID_AUTOTUNE_IDLE = 0,
+	//the first PID_AUTOTUNE_SETTLE_PERIODS
+	PID_AUTOTUNE_SETTLE,
+	PID_AUTOTUNE_MEASURE,
+} pid_autotune_state_t;
+
+//Also the arg of EVENT_LOG_AUTOTUNE, with the loop in the high byte.
+//value: ms the tune ran.
+typedef enum pid_autotune_result_t
+{
+	//no tune since boot
+	PID_AUTOTUNE_NONE = 0,
+	//the gains are in the status
+	PID_AUTOTUNE_DONE,
+	//not Autonomous, too slow for the speed loop or no such loop
+	PID_AUTOTUNE_REJECTED,
+	//left Autonomous or an abort request
+	PID_AUTOTUNE_ABORTED,
+	//the periods did not agree within PID_AUTOTUNE_TIMEOUT
+	PID_AUTOTUNE_TIMED_OUT,
+	//the error went past PID_AUTOTUNE_MAX_ERROR
+	PID_AUTOTUNE_RUNAWAY,
+} pid_autotune_result_t;
+
+//per ms, in the units of the loop's parameters
+typedef struct pid_autotune_gains_t
+{
+	float p;
+	float i;
+	float d;
+} pid_autotune_gains_t;
+
+typedef struct pid_autotune_status_t
+{
+	pid_autotune_state_t state;
+	//the loop tuned, of the last tune once it ended
+	pid_autotune_loop_t loop;
+	//of the last tune to end
+	pid_autotune_result_t result;
+	//periods measured of the tune running, PID_AUTOTUNE_PERIODS once done
+	uint8_t periods;
+	//ms since the start, of the last tune once it ended
+	uint32_t elapsed;
+	//the relay's center in the loop's output, as the PID gave it at the start
+	float bias;
+	//the rest is of the last tune that ended PID_AUTOTUNE_DONE.
+	//half peak to peak of the feedback, deg or m/s
+	float oscillation;
+	//in the units of the P gain
+	float ultimate_gain;
+	//ms
+	float ultimate_period;
+	pid_autotune_gains_t ziegler_nichols;
+	pid_autotune_gains_t tyreus_luyben;
+} pid_autotune_status_t;
+
+struct main_context_t;
+
+//Asks for a tune of loop, or to end the one running. Any task, main_task
+//takes them up in its next cycle.
+void PIDAutotuneRequestStart(pid_autotune_loop_t loop);
+void PIDAutotuneRequestAbort();
+
+//Takes up a request and ends the tune if the mode is not Autonomous. From
+//the algorithm stage, after the mode update.
+void PIDAutotuneUpdate(struct main_context_t* ctx);
+
+//1 while loop is tuned, with the relay's output in *output in place of
+//what controller gave for setpoint and feedback, in its units. After the
+//loop's PID update.
+uint8_t PIDAutotuneRelay(struct main_context_t* ctx, pid_autotune_loop_t loop, PIDController* controller,
+	int setpoint, int feedback, int* output);
+
+//Any task, the fields are copied one at a time
+void PIDAutotuneStatus(pid_autotune_status_t* status);
+
+#endif /* PIDAUTOTUNE_H_ */
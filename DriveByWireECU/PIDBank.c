@@ -0,0 +1,141 @@
+/*
+ * PIDBank.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <limits.h>
+#include <string.h>
+#include "PIDBank.h"
+#include "FastCode.h"
+
+void PIDBankInit(pid_bank_t* bank, uint32_t count)
+{
+	memset(bank, 0, sizeof(*bank));
+	bank->count = count > PID_BANK_MAX_LOOPS ? PID_BANK_MAX_LOOPS : count;
+	for(uint32_t n = 0; n < PID_BANK_MAX_LOOPS; ++n)
+	{
+		bank->input_lower[n] = INT_MIN;
+		bank->input_upper[n] = INT_MAX;
+		bank->output_lower[n] = INT_MIN;
+		bank->output_upper[n] = INT_MAX;
+		bank->max_cumulation[n] = INT_MAX;
+	}
+}
+
+uint8_t PIDBankLoad(pid_bank_t* bank, uint32_t loop, const PIDController* c)
+{
+	if( loop >= bank->count || c->feedbackWrapped || c->antiWindup == PID_ANTI_WINDUP_CONDITIONAL )
+		return 0;
+
+	bank->p[loop] = c->p;
+	bank->i[loop] = c->i;
+	bank->d[loop] = c->d;
+	bank->derivative_filter[loop] = c->derivativeFilter;
+	bank->anti_windup_gain[loop] = c->antiWindupGain;
+	bank->input_lower[loop] = c->inputBounded ? c->inputLowerBound : INT_MIN;
+	bank->input_upper[loop] = c->inputBounded ? c->inputUpperBound : INT_MAX;
+	bank->output_lower[loop] = c->outputBounded ? c->outputLowerBound : INT_MIN;
+	bank->output_upper[loop] = c->outputBounded ? c->outputUpperBound : INT_MAX;
+	bank->max_cumulation[loop] = c->maxCumulation > 0 ? c->maxCumulation : INT_MAX;
+	bank->derivative_on_measurement[loop] = c->derivativeOnMeasurement;
+	bank->back_calculation[loop] = c->antiWindup == PID_ANTI_WINDUP_BACK_CALCULATION && c->i != 0;
+
+	bank->setpoint[loop] = c->target;
+	bank->feedback[loop] = c->currentFeedback;
+	bank->feedforward[loop] = c->feedforward;
+	bank->enabled[loop] = c->enabled;
+	bank->primed[loop] = c->derivativePrimed;
+	bank->error[loop] = c->lastError;
+	bank->last_feedback[loop] = c->lastFeedback;
+	bank->integral[loop] = c->integralCumulation;
+	bank->cycle_derivative[loop] = c->cycleDerivative;
+	bank->output[loop] = c->output;
+	bank->p_term[loop] = c->lastPTerm;
+	bank->i_term[loop] = c->lastITerm;
+	bank->d_term[loop] = c->lastDTerm;
+	return 1;
+}
+
+void PIDBankStore(const pid_bank_t* bank, uint32_t loop, PIDController* c)
+{
+	if( loop >= bank->count )
+		return;
+	c->target = bank->setpoint[loop];
+	c->currentFeedback = bank->last_feedback[loop];
+	c->lastFeedback = bank->last_feedback[loop];
+	c->feedforward = bank->feedforward[loop];
+	c->enabled = bank->enabled[loop];
+	c->derivativePrimed = bank->primed[loop];
+	c->error = bank->error[loop];
+	c->lastError = bank->error[loop];
+	c->integralCumulation = bank->integral[loop];
+	c->cycleDerivative = bank->cycle_derivative[loop];
+	c->output = bank->output[loop];
+	c->lastPTerm = bank->p_term[loop];
+	c->lastITerm = bank->i_term[loop];
+	c->lastDTerm = bank->d_term[loop];
+}
+
+void PIDBankSetEnabled(pid_bank_t* bank, uint32_t loop, uint8_t enabled)
+{
+	if( !enabled && bank->enabled[loop] )
+	{
+		bank->output[loop] = 0;
+		bank->integral[loop] = 0;
+		bank->cycle_derivative[loop] = 0;
+		bank->primed[loop] = 0;
+	}
+	bank->enabled[loop] = enabled;
+}
+
+FAST_CODE static inline int Clamp(int value, int lower, int upper)
+{
+	value = value > upper ? upper : value;
+	return value < lower ? lower : value;
+}
+
+FAST_CODE void PIDBankStep(pid_bank_t* bank, const pid_timing_t* timing)
+{
+	int32_t periods = timing->periods;
+	int32_t inverse = timing->inverse;
+	for(uint32_t n = 0; n < bank->count; ++n)
+	{
+		//pid_begin, the error's change taken both ways and picked
+		int feedback = Clamp(bank->feedback[n], bank->input_lower[n], bank->input_upper[n]);
+		int error = bank->setpoint[n] - feedback;
+		int change = bank->derivative_on_measurement[n] ? bank->last_feedback[n] - feedback : error - bank->error[n];
+		change = bank->primed[n] ? change : 0;
+
+		int integral = bank->integral[n] + (int)(((int64_t)error * periods) >> 16);
+		int derivative = (int)(((int64_t)change * inverse) >> 16);
+
+		//pid_finish
+		int max = bank->max_cumulation[n];
+		integral = Clamp(integral, -max, max);
+		int cycle_derivative = derivative + PID_TERM_TO_INT(PID_SCALE(bank->cycle_derivative[n] - derivative, bank->derivative_filter[n]));
+		pid_term_t p_term = PID_SCALE(error, bank->p[n]);
+		pid_term_t i_term = PID_SCALE(integral, bank->i[n]);
+		pid_term_t d_term = PID_SCALE(cycle_derivative, bank->d[n]);
+		int output = PID_TERM_TO_INT(p_term + i_term + d_term) + bank->feedforward[n];
+		int bounded = Clamp(output, bank->output_lower[n], bank->output_upper[n]);
+		int excess = output - bounded;
+		if( excess != 0 && bank->back_calculation[n] )
+		{
+			integral -= PID_UNSCALE(PID_SCALE(excess, bank->anti_windup_gain[n]), bank->i[n]);
+			i_term = PID_SCALE(integral, bank->i[n]);
+		}
+
+		//a disabled loop keeps everything
+		uint8_t enabled = bank->enabled[n];
+		bank->primed[n] = enabled ? 1 : bank->primed[n];
+		bank->error[n] = enabled ? error : bank->error[n];
+		bank->last_feedback[n] = enabled ? feedback : bank->last_feedback[n];
+		bank->integral[n] = enabled ? integral : bank->integral[n];
+		bank->cycle_derivative[n] = enabled ? cycle_derivative : bank->cycle_derivative[n];
+		bank->output[n] = enabled ? bounded : bank->output[n];
+		bank->p_term[n] = enabled ? p_term : bank->p_term[n];
+		bank->i_term[n] = enabled ? i_term : bank->i_term[n];
+		bank->d_term[n] = enabled ? d_term : bank->d_term[n];
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * PIDBank.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PIDBANK_H_
+#define PIDBANK_H_
+
+#include <stdint.h>
+#include "PID.h"
+
+//A set of PID loops stepped together, stored as one array per field
+//instead of one PIDController per loop.
+//
+//A step of a PIDController goes through its flags one branch at a time,
+//input bounds, wrapping, derivative on measurement, output bounds, each
+//taken or not by the loop at hand. The bank does every loop the same way:
+//an unbounded input or output is a bound at INT_MIN and INT_MAX, an
+//unlimited cumulation one at INT_MAX, the flags pick between two values
+//already computed, and a disabled loop computes its update and keeps what
+//it had. The clamps and picks are compares and conditional moves, the
+//loop over the bank has no branch in it but the back calculation, which
+//divides and only runs on the update a loop is past its output bound. The
+//same fields of consecutive loops sit side by side, so a step walks every
+//array front to back.
+//
+//A step gives what pid_step_timed gives every loop, bit for bit. Taken in
+//are loops with no anti-windup or a back calculation and no feedback
+//wrapping, the others stay PIDControllers.
+
+#ifndef PID_BANK_MAX_LOOPS
+#define PID_BANK_MAX_LOOPS 8
+#endif
+
+typedef struct pid_bank_t
+{
+	uint32_t count;
+
+	//set before every step
+	int setpoint[PID_BANK_MAX_LOOPS];
+	int feedback[PID_BANK_MAX_LOOPS];
+	int feedforward[PID_BANK_MAX_LOOPS];
+
+	pid_gain_t p[PID_BANK_MAX_LOOPS];
+	pid_gain_t i[PID_BANK_MAX_LOOPS];
+	pid_gain_t d[PID_BANK_MAX_LOOPS];
+	pid_gain_t derivative_filter[PID_BANK_MAX_LOOPS];
+	pid_gain_t anti_windup_gain[PID_BANK_MAX_LOOPS];
+	int input_lower[PID_BANK_MAX_LOOPS];
+	int input_upper[PID_BANK_MAX_LOOPS];
+	int output_lower[PID_BANK_MAX_LOOPS];
+	int output_upper[PID_BANK_MAX_LOOPS];
+	int max_cumulation[PID_BANK_MAX_LOOPS];
+	uint8_t derivative_on_measurement[PID_BANK_MAX_LOOPS];
+	//back calculation with an I gain to wind back through
+	uint8_t back_calculation[PID_BANK_MAX_LOOPS];
+
+	uint8_t enabled[PID_BANK_MAX_LOOPS];
+	uint8_t primed[PID_BANK_MAX_LOOPS];
+	int error[PID_BANK_MAX_LOOPS];
+	int last_feedback[PID_BANK_MAX_LOOPS];
+	int integral[PID_BANK_MAX_LOOPS];
+	int cycle_derivative[PID_BANK_MAX_LOOPS];
+	int output[PID_BANK_MAX_LOOPS];
+	pid_term_t p_term[PID_BANK_MAX_LOOPS];
+	pid_term_t i_term[PID_BANK_MAX_LOOPS];
+	pid_term_t d_term[PID_BANK_MAX_LOOPS];
+} pid_bank_t;
+
+//count loops, all disabled and without gains until loaded
+void PIDBankInit(pid_bank_t* bank, uint32_t count);
+
+//Takes a controller's gains, settings and state over into a loop of the
+//bank. Returns 0 and leaves the loop as it was for one the bank can not
+//step.
+uint8_t PIDBankLoad(pid_bank_t* bank, uint32_t loop, const PIDController* c);
+
+//Hands a loop's state back to a controller loaded from it earlier
+void PIDBankStore(const pid_bank_t* bank, uint32_t loop, PIDController* c);
+
+//setEnabled for a loop, one that is switched off starts over
+void PIDBankSetEnabled(pid_bank_t* bank, uint32_t loop, uint8_t enabled);
+
+//Steps every loop of the bank on its setpoint, feedback and feedforward,
+//pid_step_timed on each with the same timing. PID_DT_UNTIMED callers pass
+//{ PID_TIMING_ONE, PID_TIMING_ONE }. The outputs are left in bank->output.
+void PIDBankStep(pid_bank_t* bank, const pid_timing_t* timing);
+
+#endif /* PIDBANK_H_ */
@@ -0,0 +1,149 @@
+/*
+ * PIDBenchmark.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include <compiler.h>
+#include "PIDBenchmark.h"
+#include "PID.h"
+#include "PIDBank.h"
+
+#define PID_BENCHMARK_ITERATIONS 1000
+
+static int bench_feedback = 0;
+static int bench_output = 0;
+static unsigned long bench_time = 0;
+
+static int BenchPIDSource()
+{
+	//sweep the feedback so every branch sees changing data
+	bench_feedback = (bench_feedback + 37) % 4000 - 2000;
+	return bench_feedback;
+}
+static void BenchPIDOutput(int output)
+{
+	bench_output = output;
+}
+static unsigned long BenchPIDTime()
+{
+	return ++bench_time;
+}
+
+void BenchmarkPIDInit(PIDController* c)
+{
+	PIDController blank = {0};
+	*c = blank;
+	c->p = PID_GAIN(1.0 / 30.0);
+	c->i = PID_GAIN(0.05 / 1000.0);
+	c->d = PID_GAIN(0.01);
+	c->enabled = 1;
+	c->maxCumulation = 30000;
+	c->target = 500;
+	setPIDSource(c, BenchPIDSource);
+	setPIDOutput(c, BenchPIDOutput);
+	registerTimeFunction(c, BenchPIDTime);
+	setInputBounds(c, -50000, 50000);
+	setOutputBounds(c, -1000, 1000);
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t BenchmarkPIDTick(uint32_t iterations)
+{
+	PIDController c;
+	BenchmarkPIDInit(&c);
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		tick(&c);
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkPIDWrappedTick(uint32_t iterations)
+{
+	PIDController c;
+	BenchmarkPIDInit(&c);
+	//the sweep crosses the bounds, so all three paths get taken
+	setFeedbackWrapBounds(&c, -1800, 1800);
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		tick(&c);
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkPIDStep(uint32_t iterations)
+{
+	PIDController c;
+	BenchmarkPIDInit(&c);
+
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+		bench_output = pid_step(&c, 500, BenchPIDSource(), 1);
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkPIDBank(uint32_t iterations)
+{
+	static pid_bank_t bank;
+	PIDController c;
+	BenchmarkPIDInit(&c);
+	PIDBankInit(&bank, PID_BANK_MAX_LOOPS);
+	for(uint32_t loop = 0; loop < PID_BANK_MAX_LOOPS; ++loop)
+	{
+		PIDBankLoad(&bank, loop, &c);
+		bank.setpoint[loop] = 500;
+	}
+
+	if( iterations == 0 )
+		return 0;
+
+	static const pid_timing_t timing = { PID_TIMING_ONE, PID_TIMING_ONE };
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		int feedback = BenchPIDSource();
+		for(uint32_t loop = 0; loop < PID_BANK_MAX_LOOPS; ++loop)
+			bank.feedback[loop] = feedback + (int)loop;
+		PIDBankStep(&bank, &timing);
+	}
+	uint32_t cycles = DWT->CYCCNT - start;
+	bench_output = bank.output[0];
+
+	return cycles / (iterations * PID_BANK_MAX_LOOPS);
+}
+
+void ReportPIDBenchmark(void)
+{
+#if PID_ARITHMETIC == PID_ARITHMETIC_Q16
+	const char* arithmetic = "q16";
+#elif PID_ARITHMETIC == PID_ARITHMETIC_FLOAT
+	const char* arithmetic = "float";
+#else
+	const char* arithmetic = "double";
+#endif
+	printf("PID tick (%s): %lu cycles\r\n", arithmetic, (unsigned long)BenchmarkPIDTick(PID_BENCHMARK_ITERATIONS));
+	printf("PID wrapped tick (%s): %lu cycles\r\n", arithmetic,
+		(unsigned long)BenchmarkPIDWrappedTick(PID_BENCHMARK_ITERATIONS));
+	printf("PID step (%s): %lu cycles\r\n", arithmetic, (unsigned long)BenchmarkPIDStep(PID_BENCHMARK_ITERATIONS));
+	printf("PID bank of %u (%s): %lu cycles per loop\r\n", PID_BANK_MAX_LOOPS, arithmetic,
+		(unsigned long)BenchmarkPIDBank(PID_BENCHMARK_ITERATIONS));
+}
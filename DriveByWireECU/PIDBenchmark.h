@@ -0,0 +1,40 @@
+/*
+ * PIDBenchmark.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PIDBENCHMARK_H_
+#define PIDBENCHMARK_H_
+
+#include <stdint.h>
+#include "PID.h"
+
+//Set to 1 to print the PID tick cost at boot.
+//Build once per PID_ARITHMETIC setting to compare the implementations.
+#ifndef PID_BENCHMARK
+#define PID_BENCHMARK 0
+#endif
+
+//Sets c up as the scratch controller below, on a sweeping feedback, and
+//turns on the DWT cycle counter. For BenchImage.c as well.
+void BenchmarkPIDInit(PIDController* c);
+
+//Runs iterations ticks of a scratch controller and returns the average
+//number of core cycles per tick, measured with the DWT cycle counter.
+uint32_t BenchmarkPIDTick(uint32_t iterations);
+
+//Same as BenchmarkPIDTick with the feedback wrapping around its bounds.
+uint32_t BenchmarkPIDWrappedTick(uint32_t iterations);
+
+//Same as BenchmarkPIDTick but through the inlined pid_step, no callbacks.
+uint32_t BenchmarkPIDStep(uint32_t iterations);
+
+//Steps a PIDBank of PID_BANK_MAX_LOOPS copies of the scratch controller
+//and returns the average number of core cycles per loop and step.
+uint32_t BenchmarkPIDBank(uint32_t iterations);
+
+//Prints the benchmark results together with the selected arithmetic.
+void ReportPIDBenchmark(void);
+
+#endif /* PIDBENCHMARK_H_ */
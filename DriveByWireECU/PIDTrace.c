@@ -0,0 +1,182 @@
+/*
+ * PIDTrace.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stddef.h>
+#include "PIDTrace.h"
+#include "FastCode.h"
+
+#define PID_TRACE_MASK (PID_TRACE_DEPTH - 1)
+
+static inline void CaptureTerm(pid_trace_term_t* term, const PIDController* c)
+{
+	term->setpoint = c->target;
+	term->feedback = c->currentFeedback;
+	term->error = c->error;
+	term->integral = c->integralCumulation;
+	term->p_term = PID_TERM_TO_INT(c->lastPTerm);
+	term->i_term = PID_TERM_TO_INT(c->lastITerm);
+	term->d_term = PID_TERM_TO_INT(c->lastDTerm);
+	term->output = c->output;
+}
+
+static inline int32_t Magnitude(int32_t value)
+{
+	return value >= 0 ? value : -value;
+}
+
+//Which enabled trigger, if any, the newest sample fires.
+FAST_CODE static uint8_t CheckTriggers(pid_trace_t* trace, const pid_trace_sample_t* sample, uint8_t estop)
+{
+	uint8_t fired = 0;
+
+	if( estop && !trace->last_estop )
+		fired |= PID_TRACE_TRIGGER_ESTOP;
+
+	for(int i = 0; i < PID_TRACE_CONTROLLER_COUNT; ++i)
+	{
+		const pid_trace_term_t* term = &sample->controller[i];
+		if( Magnitude(term->setpoint - trace->last_setpoint[i]) > trace->step_threshold )
+			fired |= PID_TRACE_TRIGGER_STEP;
+		if( Magnitude(term->error) > trace->error_threshold )
+			fired |= PID_TRACE_TRIGGER_ERROR;
+		trace->last_setpoint[i] = term->setpoint;
+	}
+	trace->last_estop = estop;
+
+	return fired & trace->triggers;
+}
+
+FAST_CODE static void Rearm(pid_trace_t* trace)
+{
+	trace->head = 0;
+	trace->count = 0;
+	trace->trigger_reason = 0;
+	trace->trigger_tick = 0;
+	__atomic_store_n(&trace->state, PID_TRACE_ARMED, __ATOMIC_RELEASE);
+}
+
+void PIDTraceInit(pid_trace_t* trace)
+{
+	trace->triggers = PID_TRACE_TRIGGER_MANUAL | PID_TRACE_TRIGGER_ESTOP;
+	trace->step_threshold = INT32_MAX;
+	trace->error_threshold = INT32_MAX;
+	trace->last_estop = 0;
+	for(int i = 0; i < PID_TRACE_CONTROLLER_COUNT; ++i)
+		trace->last_setpoint[i] = 0;
+	trace->rearm_request = 0;
+	trace->trigger_request = 0;
+	trace->holds = 0;
+	Rearm(trace);
+}
+
+FAST_CODE void PIDTraceRecord(pid_trace_t* trace, uint32_t tick, const PIDController* steering, const PIDController* speed, uint8_t estop)
+{
+	//a held ring stays frozen, the request waits for the last release
+	uint8_t free_holds = 0;
+	if( __atomic_load_n(&trace->rearm_request, __ATOMIC_ACQUIRE) &&
+		__atomic_compare_exchange_n(&trace->holds, &free_holds, PID_TRACE_HOLD_REARMING, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) )
+	{
+		__atomic_store_n(&trace->rearm_request, 0, __ATOMIC_RELAXED);
+		Rearm(trace);
+		__atomic_store_n(&trace->holds, 0, __ATOMIC_RELEASE);
+	}
+
+	if( trace->state == PID_TRACE_FROZEN )
+		return;
+
+	pid_trace_sample_t* sample = &trace->samples[trace->head];
+	sample->tick = tick;
+	CaptureTerm(&sample->controller[PID_TRACE_STEERING], steering);
+	CaptureTerm(&sample->controller[PID_TRACE_SPEED], speed);
+	trace->head = (trace->head + 1) & PID_TRACE_MASK;
+	if( trace->count < PID_TRACE_DEPTH )
+		trace->count++;
+
+	uint8_t fired = CheckTriggers(trace, sample, estop);
+	if( __atomic_exchange_n(&trace->trigger_request, 0, __ATOMIC_ACQUIRE) )
+		fired |= PID_TRACE_TRIGGER_MANUAL & trace->triggers;
+
+	if( trace->state == PID_TRACE_ARMED )
+	{
+		if( !fired )
+			return;
+
+		trace->trigger_reason = fired;
+		trace->trigger_tick = tick;
+		trace->post_remaining = PID_TRACE_POST_TRIGGER;
+		trace->state = PID_TRACE_TRIGGERED;
+	}
+
+	if( trace->post_remaining == 0 || --trace->post_remaining == 0 )
+		__atomic_store_n(&trace->state, PID_TRACE_FROZEN, __ATOMIC_RELEASE);
+}
+
+pid_trace_state_t PIDTraceState(const pid_trace_t* trace)
+{
+	return (pid_trace_state_t)__atomic_load_n(&trace->state, __ATOMIC_ACQUIRE);
+}
+
+void PIDTraceConfigure(pid_trace_t* trace, uint8_t triggers, int32_t step_threshold, int32_t error_threshold)
+{
+	//each field is a single aligned store, the writer never sees a torn value
+	__atomic_store_n(&trace->step_threshold, step_threshold, __ATOMIC_RELAXED);
+	__atomic_store_n(&trace->error_threshold, error_threshold, __ATOMIC_RELAXED);
+	__atomic_store_n(&trace->triggers, triggers | PID_TRACE_TRIGGER_MANUAL, __ATOMIC_RELAXED);
+}
+
+void PIDTraceRequestRearm(pid_trace_t* trace)
+{
+	__atomic_store_n(&trace->rearm_request, 1, __ATOMIC_RELEASE);
+}
+
+void PIDTraceRequestTrigger(pid_trace_t* trace)
+{
+	__atomic_store_n(&trace->trigger_request, 1, __ATOMIC_RELEASE);
+}
+
+const pid_trace_sample_t* PIDTraceSample(const pid_trace_t* trace, uint16_t index)
+{
+	if( PIDTraceState(trace) != PID_TRACE_FROZEN || index >= trace->count )
+		return NULL;
+
+	return &trace->samples[(trace->head - trace->count + index) & PID_TRACE_MASK];
+}
+
+uint8_t PIDTraceHold(pid_trace_t* trace)
+{
+	uint8_t holds = __atomic_load_n(&trace->holds, __ATOMIC_RELAXED);
+	do
+	{
+		if( holds >= PID_TRACE_HOLD_REARMING - 1 )
+			return 0;
+	} while( !__atomic_compare_exchange_n(&trace->holds, &holds, holds + 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) );
+
+	//the writer can not rearm from here on, but it may not have frozen yet
+	if( PIDTraceState(trace) != PID_TRACE_FROZEN )
+	{
+		PIDTraceRelease(trace);
+		return 0;
+	}
+	return 1;
+}
+
+void PIDTraceRelease(pid_trace_t* trace)
+{
+	__atomic_fetch_sub(&trace->holds, 1, __ATOMIC_RELEASE);
+}
+
+uint16_t PIDTraceSpan(const pid_trace_t* trace, uint16_t index, const pid_trace_sample_t** first)
+{
+	*first = PIDTraceSample(trace, index);
+	if( *first == NULL )
+		return 0;
+
+	uint16_t position = *first - trace->samples;
+	uint16_t span = trace->count - index;
+	if( span > PID_TRACE_DEPTH - position )
+		span = PID_TRACE_DEPTH - position;
+	return span;
+}
@@ -0,0 +1,135 @@
+/*
+ * PIDTrace.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PIDTRACE_H_
+#define PIDTRACE_H_
+
+#include <stdint.h>
+#include <lwip_profile_config.h>
+#include "PID.h"
+
+//Every control cycle's PID state for gain tuning.
+//main_task records one sample per cycle into a RAM ring at a fixed cost. A
+//trigger lets PID_TRACE_POST_TRIGGER more samples in and then freezes the
+//ring, so it holds the lead up to the event and its aftermath. The frozen
+//ring is read out over Ethernet, and re-arming starts a new capture.
+//
+//main_task is the only writer. Other tasks only read a frozen ring and
+//post requests, which main_task picks up on its next sample. A reader that
+//needs the samples to stay put for longer, such as lwIP sending straight
+//out of the ring, holds the trace: a rearm request then waits until the
+//last hold is released.
+
+//Samples kept, must be a power of two. 512 is half a second at 1 kHz.
+#ifndef PID_TRACE_DEPTH
+#define PID_TRACE_DEPTH 512
+#endif
+
+//Samples recorded after the trigger, the rest of the ring is lead up
+#ifndef PID_TRACE_POST_TRIGGER
+#define PID_TRACE_POST_TRIGGER (PID_TRACE_DEPTH / 2)
+#endif
+
+#if (PID_TRACE_DEPTH & (PID_TRACE_DEPTH - 1)) != 0
+#error PID_TRACE_DEPTH must be a power of two
+#endif
+
+#define PID_TRACE_CONTROLLER_COUNT 2
+#define PID_TRACE_STEERING 0
+#define PID_TRACE_SPEED 1
+
+//Trigger sources, as a mask in pid_trace_t.triggers
+#define PID_TRACE_TRIGGER_MANUAL 0x01
+#define PID_TRACE_TRIGGER_ESTOP 0x02
+#define PID_TRACE_TRIGGER_STEP 0x04
+#define PID_TRACE_TRIGGER_ERROR 0x08
+
+typedef struct pid_trace_term_t
+{
+	int32_t setpoint;
+	int32_t feedback;
+	int32_t error;
+	int32_t integral;
+	int32_t p_term;
+	int32_t i_term;
+	int32_t d_term;
+	int32_t output;
+} pid_trace_term_t;
+
+typedef struct pid_trace_sample_t
+{
+	uint32_t tick;
+	pid_trace_term_t controller[PID_TRACE_CONTROLLER_COUNT];
+} pid_trace_sample_t;
+
+typedef enum pid_trace_state_t
+{
+	PID_TRACE_ARMED = 0,	//recording, waiting for a trigger
+	PID_TRACE_TRIGGERED,	//recording the samples after the trigger
+	PID_TRACE_FROZEN		//complete, safe to read
+} pid_trace_state_t;
+
+typedef struct pid_trace_t
+{
+	pid_trace_sample_t samples[PID_TRACE_DEPTH];
+	uint16_t head;		//next sample written
+	uint16_t count;		//valid samples, up to PID_TRACE_DEPTH
+	uint16_t post_remaining;
+
+	//pid_trace_state_t, published with release ordering once frozen
+	uint8_t state;
+	uint8_t trigger_reason;
+	uint32_t trigger_tick;
+
+	//enabled PID_TRACE_TRIGGER_* sources
+	uint8_t triggers;
+	//setpoint change between two samples that counts as a step
+	int32_t step_threshold;
+	//|error| that triggers
+	int32_t error_threshold;
+
+	uint8_t last_estop;
+	int32_t last_setpoint[PID_TRACE_CONTROLLER_COUNT];
+
+	//posted by readers, taken by the writer
+	uint8_t rearm_request;
+	uint8_t trigger_request;
+	//readers holding the frozen ring, PID_TRACE_HOLD_REARMING while the
+	//writer rearms
+	uint8_t holds;
+} pid_trace_t;
+
+#define PID_TRACE_HOLD_REARMING 0xFF
+
+//Arms the trace with only the manual and estop triggers enabled.
+void PIDTraceInit(pid_trace_t* trace);
+
+//Writer side (main_task), once per control cycle after the PID updates.
+void PIDTraceRecord(pid_trace_t* trace, uint32_t tick, const PIDController* steering, const PIDController* speed, uint8_t estop);
+
+//Reader side, any task.
+pid_trace_state_t PIDTraceState(const pid_trace_t* trace);
+//Sets the trigger sources and thresholds, used from the next sample on.
+//The manual trigger is always kept enabled.
+void PIDTraceConfigure(pid_trace_t* trace, uint8_t triggers, int32_t step_threshold, int32_t error_threshold);
+//Asks the writer to start a new capture, discarding the current one.
+//Samples read after this may already be overwritten.
+void PIDTraceRequestRearm(pid_trace_t* trace);
+//Asks the writer to trigger now, if it is armed.
+void PIDTraceRequestTrigger(pid_trace_t* trace);
+//Sample index counted from the oldest, or NULL if the ring is not frozen
+//or index is past the end.
+const pid_trace_sample_t* PIDTraceSample(const pid_trace_t* trace, uint16_t index);
+//Keeps a frozen ring frozen, rearm requests are deferred until every hold
+//is released. Returns 0, holding nothing, if the ring is not frozen.
+uint8_t PIDTraceHold(pid_trace_t* trace);
+void PIDTraceRelease(pid_trace_t* trace);
+//The samples from index on that lie one after another in memory, up to the
+//wrap of the ring or the last sample, with *first set to index. 0 if the
+//ring is not frozen or index is past the end.
+uint16_t PIDTraceSpan(const pid_trace_t* trace, uint16_t index, const pid_trace_sample_t** first);
+
+#endif /* PIDTRACE_H_ */
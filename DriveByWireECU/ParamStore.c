@@ -0,0 +1,261 @@
+/*
+ * ParamStore.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <hri_nvmctrl_e54.h>
+#include "ParamStore.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "EventLog.h"
+#include "NodeIdentity.h"
+#include "DacThrottle.h"
+#include "IntegrityMonitor.h"
+
+#if PARAM_COUNT > PARAM_STORE_MAX_VALUES
+#error The parameters no longer fit a PARAM_STORE_SLOT_SIZE record
+#endif
+
+//Slot n of the record is at SEEPROM_ADDR + n * PARAM_STORE_SLOT_SIZE. The
+//SmartEEPROM is mapped there, reads are plain loads and the NVM controller
+//turns writes into page updates of its own.
+#define PARAM_STORE_WORDS ((offsetof(param_record_t, values) / 4) + PARAM_COUNT)
+
+#define PARAM_FLOAT(min, max, value) { PARAM_TYPE_FLOAT, { .f = (min) }, { .f = (max) }, { .f = (value) } }
+#define PARAM_UINT(min, max, value) { PARAM_TYPE_UINT, { .u = (min) }, { .u = (max) }, { .u = (value) } }
+
+//In param_id_t order. The gains default to 0, what the command frames used
+//to carry when nothing was overridden.
+static const param_info_t param_info[PARAM_COUNT] =
+{
+	PARAM_UINT(0, 1, 0),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_UINT(0, NODE_MAX_ID, 0),
+	PARAM_UINT(0, 0xFFFFFFFF, 0),
+	PARAM_UINT(0, 0xFFFFFF, 0),
+	PARAM_FLOAT(0.0f, DAC_THROTTLE_VREF, DAC_THROTTLE_ZERO_VOLTS),
+	PARAM_FLOAT(0.0f, DAC_THROTTLE_VREF, DAC_THROTTLE_FULL_VOLTS),
+	PARAM_UINT(0, 1, 0),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_FLOAT(0.0f, 100.0f, 0.0f),
+	PARAM_UINT(0, 0xFFFFFFFF, 0),
+	PARAM_UINT(0, 0xFFFFFF, 0),
+	PARAM_UINT(0, 0xFFFFFF, 0),
+};
+
+typedef struct param_store_t
+{
+	param_store_state_t state;
+	uint32_t sequence;
+
+	//from ParamStoreRequestSave, taken by the idle hook
+	param_set_t requested;
+	volatile uint8_t save_requested;
+
+	//the save being written and how far it got
+	param_record_t record;
+	uint8_t slot;
+	uint16_t next_word;
+} param_store_t;
+
+static param_store_t param_store;
+
+static volatile uint32_t* SlotAddress(uint8_t slot)
+{
+	return (volatile uint32_t*)(SEEPROM_ADDR + slot * PARAM_STORE_SLOT_SIZE);
+}
+
+static uint32_t RecordChecksum(const param_record_t* record, uint16_t count)
+{
+	const uint32_t* words = (const uint32_t*)record;
+	uint32_t sum = 0;
+	for(size_t i = 0; i < offsetof(param_record_t, checksum) / sizeof(uint32_t); ++i)
+		sum += words[i];
+	for(uint16_t i = 0; i < count; ++i)
+		sum += record->values[i].u;
+
+	return ~sum;
+}
+
+static int RecordValid(const param_record_t* record)
+{
+	return record->magic == PARAM_STORE_MAGIC && record->version == PARAM_STORE_VERSION &&
+		record->count <= PARAM_STORE_MAX_VALUES && record->checksum == RecordChecksum(record, record->count);
+}
+
+const param_info_t* ParamInfo(uint8_t id)
+{
+	if( id >= PARAM_COUNT )
+		return NULL;
+
+	return &param_info[id];
+}
+
+void ParamSetDefaults(param_set_t* set)
+{
+	for(int i = 0; i < PARAM_COUNT; ++i)
+		set->values[i] = param_info[i].value;
+}
+
+int ParamSetValue(param_set_t* set, uint8_t id, param_value_t value)
+{
+	const param_info_t* info = ParamInfo(id);
+	if( info == NULL )
+		return -1;
+
+	if( info->type == PARAM_TYPE_FLOAT )
+	{
+		//NaN fails both
+		if( !(value.f >= info->min.f && value.f <= info->max.f) )
+			return -1;
+	}
+	else if( value.u < info->min.u || value.u > info->max.u )
+	{
+		return -1;
+	}
+
+	set->values[id] = value;
+	return 0;
+}
+
+int ParamStoreInit(param_set_t* set)
+{
+	memset(&param_store, 0, sizeof(param_store));
+	ParamSetDefaults(set);
+
+	if( hri_nvmctrl_read_SEESTAT_SBLK_bf(NVMCTRL) == 0 )
+	{
+		param_store.state = PARAM_STORE_UNAVAILABLE;
+		EventLogWrite(EVENT_LOG_PARAMS, EVENT_LOG_PARAMS_UNAVAILABLE, 0);
+		return 0;
+	}
+
+	//the SmartEEPROM is reloaded from flash after reset before it can be read
+	while( hri_nvmctrl_get_SEESTAT_BUSY_bit(NVMCTRL) )
+		;
+
+	param_record_t slots[PARAM_STORE_SLOTS];
+	memcpy(slots, (const void*)SEEPROM_ADDR, sizeof(slots));
+
+	const param_record_t* newest = NULL;
+	for(uint8_t slot = 0; slot < PARAM_STORE_SLOTS; ++slot)
+	{
+		if( RecordValid(&slots[slot]) && (newest == NULL || (int32_t)(slots[slot].sequence - newest->sequence) > 0) )
+		{
+			newest = &slots[slot];
+			param_store.slot = slot;
+		}
+	}
+
+	//writes stay in the page buffer until the save is flushed as a whole
+	hri_nvmctrl_set_SEECFG_WMODE_bit(NVMCTRL);
+
+	if( newest == NULL )
+	{
+		EventLogWrite(EVENT_LOG_PARAMS, EVENT_LOG_PARAMS_DEFAULTS, 0);
+		return 0;
+	}
+
+	//a parameter that is out of range for this firmware keeps its default
+	uint16_t count = newest->count < PARAM_COUNT ? newest->count : PARAM_COUNT;
+	for(uint16_t i = 0; i < count; ++i)
+		ParamSetValue(set, i, newest->values[i]);
+
+	param_store.sequence = newest->sequence;
+	EventLogWrite(EVENT_LOG_PARAMS, EVENT_LOG_PARAMS_LOADED, newest->sequence);
+	return 1;
+}
+
+void ParamStoreRequestSave(const param_set_t* set)
+{
+	taskENTER_CRITICAL();
+	param_store.requested = *set;
+	param_store.save_requested = 1;
+	taskEXIT_CRITICAL();
+}
+
+//Starts writing the requested set over the older slot
+static void BeginSave()
+{
+	param_record_t* record = &param_store.record;
+
+	taskENTER_CRITICAL();
+	memcpy(record->values, param_store.requested.values, sizeof(param_store.requested.values));
+	param_store.save_requested = 0;
+	taskEXIT_CRITICAL();
+
+	record->magic = PARAM_STORE_MAGIC;
+	record->version = PARAM_STORE_VERSION;
+	record->count = PARAM_COUNT;
+	record->sequence = param_store.sequence + 1;
+	record->checksum = RecordChecksum(record, PARAM_COUNT);
+
+	param_store.slot = (param_store.slot + 1) % PARAM_STORE_SLOTS;
+	param_store.next_word = 0;
+	param_store.state = PARAM_STORE_SAVING;
+}
+
+void ParamStoreService()
+{
+	if( param_store.state == PARAM_STORE_UNAVAILABLE )
+		return;
+
+	if( param_store.state == PARAM_STORE_IDLE )
+	{
+		if( !param_store.save_requested )
+			return;
+		BeginSave();
+	}
+
+	//An access while the SmartEEPROM is busy would stall the bus until it is
+	//done, so this backs off to the next idle pass instead.
+	//Words that already hold the value are skipped, they cost no wear.
+	const uint32_t* words = (const uint32_t*)&param_store.record;
+	volatile uint32_t* slot = SlotAddress(param_store.slot);
+	while( param_store.next_word < PARAM_STORE_WORDS )
+	{
+		if( hri_nvmctrl_get_SEESTAT_BUSY_bit(NVMCTRL) )
+			return;
+
+		uint16_t word = param_store.next_word++;
+		if( slot[word] != words[word] )
+			slot[word] = words[word];
+	}
+
+	if( hri_nvmctrl_get_SEESTAT_BUSY_bit(NVMCTRL) || !hri_nvmctrl_get_STATUS_READY_bit(NVMCTRL) )
+		return;
+	hri_nvmctrl_write_CTRLB_reg(NVMCTRL, NVMCTRL_CTRLB_CMDEX_KEY | NVMCTRL_CTRLB_CMD_SEEFLUSH);
+
+	param_store.sequence = param_store.record.sequence;
+	param_store.state = PARAM_STORE_IDLE;
+	IntegrityMonitorRebase(INTEGRITY_REGION_PARAMS);
+	EventLogWrite(EVENT_LOG_PARAMS, EVENT_LOG_PARAMS_SAVED, param_store.sequence);
+}
+
+param_store_state_t ParamStoreState()
+{
+	return param_store.state;
+}
+
+uint8_t ParamStoreFitsLayout()
+{
+	return hri_nvmctrl_read_SEESTAT_SBLK_bf(NVMCTRL) <= PARAM_STORE_SMART_EEPROM_BLOCKS;
+}
+
+uint32_t ParamStoreSequence()
+{
+	return param_store.sequence;
+}
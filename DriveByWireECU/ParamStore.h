@@ -0,0 +1,169 @@
+/*
+ * ParamStore.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PARAMSTORE_H_
+#define PARAMSTORE_H_
+
+#include <stdint.h>
+
+//Tuning parameters that survive a power cycle, kept in the SmartEEPROM.
+//
+//The PC sets them one at a time with the param request (ControlProtocol.h)
+//and asks for a save once it is happy with them. At boot the whole set is
+//read back in one block and main_task starts on it, so the command frames
+//only carry setpoints.
+//
+//The SmartEEPROM has to be enabled in the user page fuses (SBLK and PSZ,
+//512 bytes is plenty). It levels the wear over its flash blocks in
+//hardware. Without it the defaults are used and saves are dropped.
+//
+//The SmartEEPROM takes the top SBLK 8K blocks of each flash bank. The
+//steering calibration (SteeringCalibration.h) and firmware updates
+//(FirmwareUpdate.h) stay below PARAM_STORE_SMART_EEPROM_BLOCKS of them, so
+//the fuses must not set SBLK higher than that.
+//
+//The record is kept twice and a save overwrites the older copy, so power
+//lost during a save still leaves the previous save to boot from. A save
+//is written a few words at a time from the idle hook and never holds up a
+//task.
+//
+//To add a parameter, append its id here and its entry to param_info in
+//ParamStore.c. Ids are never reused or reordered, so a record saved by
+//older firmware still loads, the parameters it lacks take their defaults.
+typedef enum param_id_t
+{
+	//non-zero: the gains below replace the built in gains and speed schedule
+	PARAM_OVERRIDE_PID = 0,
+	PARAM_SPEED_P_GAIN,
+	PARAM_SPEED_I_GAIN,
+	PARAM_SPEED_D_GAIN,
+	PARAM_STEER_P_GAIN,
+	PARAM_STEER_I_GAIN,
+	PARAM_STEER_D_GAIN,
+	//which ECU of the vehicle, 0 to NODE_MAX_ID, read at boot (NodeIdentity.h)
+	PARAM_NODE_ID,
+	//first octet in the top byte, 0 for the one node_id gives, read at boot
+	PARAM_NODE_IP,
+	//low 3 bytes of a locally administered MAC, 0 for the one node_id gives,
+	//read at boot
+	PARAM_NODE_MAC,
+	//volts of the DAC throttle at a throttle of 0 and 1, read at boot
+	//(DacThrottle.h)
+	PARAM_THROTTLE_ZERO,
+	PARAM_THROTTLE_FULL,
+	//non-zero: the gains below run beside the live ones without being
+	//applied (ShadowController.h)
+	PARAM_SHADOW_PID,
+	PARAM_SHADOW_SPEED_P_GAIN,
+	PARAM_SHADOW_SPEED_I_GAIN,
+	PARAM_SHADOW_SPEED_D_GAIN,
+	PARAM_SHADOW_STEER_P_GAIN,
+	PARAM_SHADOW_STEER_I_GAIN,
+	PARAM_SHADOW_STEER_D_GAIN,
+	//the autonomy PC, first octet in the top byte, 0 for ETHERNET_PC_IP,
+	//read at boot (NodeIdentity.h)
+	PARAM_PEER_IP,
+	//top and low 3 bytes of the PC's MAC, both 0 for ETHERNET_PC_MAC or
+	//none, read at boot
+	PARAM_PEER_MAC_HIGH,
+	PARAM_PEER_MAC_LOW,
+	PARAM_COUNT
+} param_id_t;
+
+typedef enum param_type_t
+{
+	PARAM_TYPE_UINT = 0,
+	PARAM_TYPE_FLOAT
+} param_type_t;
+
+typedef union param_value_t
+{
+	uint32_t u;
+	float f;
+} param_value_t;
+
+typedef struct param_set_t
+{
+	param_value_t values[PARAM_COUNT];
+} param_set_t;
+
+typedef struct param_info_t
+{
+	param_type_t type;
+	param_value_t min;
+	param_value_t max;
+	param_value_t value;
+} param_info_t;
+
+//SBLK of the fuses the flash layout is built for, 1 holds up to 4K
+#ifndef PARAM_STORE_SMART_EEPROM_BLOCKS
+#define PARAM_STORE_SMART_EEPROM_BLOCKS 1
+#endif
+
+//Bytes at the top of each bank the SmartEEPROM may take
+#define PARAM_STORE_SMART_EEPROM_SIZE (PARAM_STORE_SMART_EEPROM_BLOCKS * 8192)
+
+typedef enum param_store_state_t
+{
+	//the last save, if any, is in NVM
+	PARAM_STORE_IDLE = 0,
+	PARAM_STORE_SAVING,
+	//the SmartEEPROM is not enabled in the fuses
+	PARAM_STORE_UNAVAILABLE
+} param_store_state_t;
+
+//Record layout in the SmartEEPROM, one per slot
+#define PARAM_STORE_MAGIC 0x50524D53
+#define PARAM_STORE_VERSION 1
+#define PARAM_STORE_SLOT_SIZE 128
+//slots at SEEPROM_ADDR, a save overwrites the older
+#define PARAM_STORE_SLOTS 2
+#define PARAM_STORE_MAX_VALUES ((PARAM_STORE_SLOT_SIZE - 16) / 4)
+
+typedef struct param_record_t
+{
+	uint32_t magic;
+	uint16_t version;
+	//values stored, PARAM_COUNT of the firmware that saved it
+	uint16_t count;
+	//of the save, the higher valid one of the two slots is loaded
+	uint32_t sequence;
+	//of everything else in the record, up to values[count]
+	uint32_t checksum;
+	param_value_t values[PARAM_STORE_MAX_VALUES];
+} param_record_t;
+
+//Type, range and default of a parameter, NULL for an unknown id
+const param_info_t* ParamInfo(uint8_t id);
+
+void ParamSetDefaults(param_set_t* set);
+
+//Returns 0 and sets the parameter, or -1 if id is unknown or value is out
+//of range, when the set is left unchanged.
+int ParamSetValue(param_set_t* set, uint8_t id, param_value_t value);
+
+//Reads both slots in one block and fills set from the newest valid one, or
+//with the defaults. Returns 1 if it came from NVM. Call once at boot.
+int ParamStoreInit(param_set_t* set);
+
+//Copies set to be saved by the idle hook. A newer request before the save
+//started replaces it. Any task.
+void ParamStoreRequestSave(const param_set_t* set);
+
+//Writes what it can of a requested save without waiting on the NVM.
+//Called from the idle hook.
+void ParamStoreService();
+
+param_store_state_t ParamStoreState();
+
+//Non-zero if the SmartEEPROM the fuses set up fits in
+//PARAM_STORE_SMART_EEPROM_SIZE, so the flash below it is free to erase
+uint8_t ParamStoreFitsLayout();
+
+//Sequence number of the last save that completed or was loaded, 0 for none
+uint32_t ParamStoreSequence();
+
+#endif /* PARAMSTORE_H_ */
@@ -0,0 +1,190 @@
+/*
+ * PcSampler.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hri_tcc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include <irq_config.h>
+#include "PcSampler.h"
+#include "FastCode.h"
+
+#if PC_SAMPLER_ENABLE
+
+#if PC_SAMPLER_BIN_SIZE & (PC_SAMPLER_BIN_SIZE - 1)
+#error PC_SAMPLER_BIN_SIZE must be a power of 2
+#endif
+
+#define PC_SAMPLER_TCC TCC2
+//TCC2 counts 16 bits, undivided that is 5.5 ms at 12 MHz
+#define PC_SAMPLER_PERIOD (CONF_GCLK_TC0_FREQUENCY / PC_SAMPLER_RATE)
+
+#if PC_SAMPLER_PERIOD + PC_SAMPLER_PERIOD / 8 > 0xFFFF || PC_SAMPLER_PERIOD < 512
+#error PC_SAMPLER_RATE gives a period TCC2 cannot count
+#endif
+
+//The linker script's .relocate, .ramfunc comes first in it
+extern uint32_t _srelocate;
+
+typedef struct pc_sampler_t
+{
+	volatile uint8_t running;
+	volatile uint8_t saturated;
+	volatile uint32_t samples;
+	volatile uint32_t other;
+	uint32_t dither;
+	uint16_t flash_bins[PC_SAMPLER_FLASH_BINS];
+	uint16_t ram_bins[PC_SAMPLER_RAM_BINS];
+} pc_sampler_t;
+
+static pc_sampler_t pc_sampler;
+
+void PcSamplerInit()
+{
+	hri_mclk_set_APBCMASK_TCC2_bit(MCLK);
+	hri_gclk_write_PCHCTRL_reg(GCLK, TCC2_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+	hri_tcc_write_CTRLA_reg(PC_SAMPLER_TCC, TCC_CTRLA_SWRST);
+	hri_tcc_wait_for_sync(PC_SAMPLER_TCC, TCC_SYNCBUSY_SWRST);
+	hri_tcc_write_CTRLA_reg(PC_SAMPLER_TCC, TCC_CTRLA_PRESCALER_DIV1);
+	hri_tcc_write_WAVE_reg(PC_SAMPLER_TCC, TCC_WAVE_WAVEGEN_NFRQ);
+	hri_tcc_write_PER_reg(PC_SAMPLER_TCC, PC_SAMPLER_PERIOD - 1);
+	hri_tcc_set_INTEN_OVF_bit(PC_SAMPLER_TCC);
+
+	NVIC_SetPriority(TCC2_0_IRQn, IRQ_PRIORITY_PC_SAMPLER);
+	NVIC_ClearPendingIRQ(TCC2_0_IRQn);
+	NVIC_EnableIRQ(TCC2_0_IRQn);
+}
+
+void PcSamplerStart()
+{
+	PcSamplerStop();
+	memset(pc_sampler.flash_bins, 0, sizeof(pc_sampler.flash_bins));
+	memset(pc_sampler.ram_bins, 0, sizeof(pc_sampler.ram_bins));
+	pc_sampler.samples = 0;
+	pc_sampler.other = 0;
+	pc_sampler.saturated = 0;
+	pc_sampler.running = 1;
+	hri_tcc_set_CTRLA_ENABLE_bit(PC_SAMPLER_TCC);
+}
+
+void PcSamplerStop()
+{
+	hri_tcc_clear_CTRLA_ENABLE_bit(PC_SAMPLER_TCC);
+	hri_tcc_wait_for_sync(PC_SAMPLER_TCC, TCC_SYNCBUSY_ENABLE);
+	pc_sampler.running = 0;
+}
+
+//Tail called by the handler with the interrupted PC, returns from the
+//interrupt
+FAST_CODE void PcSamplerSample(uint32_t pc)
+{
+	hri_tcc_clear_INTFLAG_OVF_bit(PC_SAMPLER_TCC);
+
+	//next period from a linear congruential step, spread over
+	//PC_SAMPLER_PERIOD -1/8 .. +1/8
+	pc_sampler.dither = pc_sampler.dither * 1664525UL + 1013904223UL;
+	uint32_t spread = ((pc_sampler.dither >> 16) * (PC_SAMPLER_PERIOD / 4)) >> 16;
+	hri_tcc_write_PERBUF_reg(PC_SAMPLER_TCC, PC_SAMPLER_PERIOD - PC_SAMPLER_PERIOD / 8 + spread - 1);
+
+	uint16_t* bin = NULL;
+	uint32_t ram = pc - (uint32_t)&_srelocate;
+	if( pc < PC_SAMPLER_FLASH_SIZE )
+		bin = &pc_sampler.flash_bins[pc / PC_SAMPLER_BIN_SIZE];
+	else if( ram < PC_SAMPLER_RAM_SIZE )
+		bin = &pc_sampler.ram_bins[ram / PC_SAMPLER_BIN_SIZE];
+
+	pc_sampler.samples++;
+	if( bin == NULL )
+		pc_sampler.other++;
+	else if( *bin < UINT16_MAX )
+		++*bin;
+	else
+	{
+		//the counts stay in proportion, the window ends here
+		hri_tcc_clear_CTRLA_ENABLE_bit(PC_SAMPLER_TCC);
+		pc_sampler.saturated = 1;
+		pc_sampler.running = 0;
+	}
+}
+
+//The exception frame is on the process stack if a task was interrupted
+//and on the main stack if another handler was. Naked so nothing is pushed
+//before the frame is found, the stacked PC is its seventh word.
+__attribute__((naked)) void TCC2_0_Handler(void)
+{
+	__asm volatile(
+		"tst lr, #4\n"
+		"ite eq\n"
+		"mrseq r0, msp\n"
+		"mrsne r0, psp\n"
+		"ldr r0, [r0, #24]\n"
+		"b PcSamplerSample\n");
+}
+
+void PcSamplerRead(pc_sampler_stats_t* stats)
+{
+	stats->running = pc_sampler.running;
+	stats->saturated = pc_sampler.saturated;
+	stats->samples = pc_sampler.samples;
+	stats->other = pc_sampler.other;
+}
+
+uint32_t PcSamplerRegionBase(pc_sampler_region_t region)
+{
+	return region == PC_SAMPLER_RAM ? (uint32_t)&_srelocate : 0;
+}
+
+uint16_t PcSamplerRegionBins(pc_sampler_region_t region)
+{
+	if( region == PC_SAMPLER_FLASH )
+		return PC_SAMPLER_FLASH_BINS;
+	return region == PC_SAMPLER_RAM ? PC_SAMPLER_RAM_BINS : 0;
+}
+
+uint16_t PcSamplerBin(pc_sampler_region_t region, uint16_t bin)
+{
+	if( bin >= PcSamplerRegionBins(region) )
+		return 0;
+	return region == PC_SAMPLER_FLASH ? pc_sampler.flash_bins[bin] : pc_sampler.ram_bins[bin];
+}
+
+#else
+
+void PcSamplerInit()
+{
+}
+
+void PcSamplerStart()
+{
+}
+
+void PcSamplerStop()
+{
+}
+
+void PcSamplerRead(pc_sampler_stats_t* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+uint32_t PcSamplerRegionBase(pc_sampler_region_t region)
+{
+	return 0;
+}
+
+uint16_t PcSamplerRegionBins(pc_sampler_region_t region)
+{
+	return 0;
+}
+
+uint16_t PcSamplerBin(pc_sampler_region_t region, uint16_t bin)
+{
+	return 0;
+}
+
+#endif
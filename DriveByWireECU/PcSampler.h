@@ -0,0 +1,94 @@
+/*
+ * PcSampler.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PCSAMPLER_H_
+#define PCSAMPLER_H_
+
+#include <stdint.h>
+
+//Statistical profiler: where the core spends its time, lwIP and the HAL
+//included, without a probe in any of them.
+//
+//Every TC is taken, so TCC2 interrupts PC_SAMPLER_RATE times a second at
+//priority IRQ_PRIORITY_PC_SAMPLER, above the kernel's mask so critical
+//sections are sampled too. The handler takes the PC the interrupted code
+//was at from its exception frame and counts it in a histogram of
+//PC_SAMPLER_BIN_SIZE byte bins over the flash and over the code
+//FAST_CODE copies to SRAM. Each period is dithered by up to an eighth
+//either way, so the samples never lock to the 1 kHz control cycle and
+//always land on the same part of it. The idle task's sleep shows up as
+//the instruction after its WFI.
+//
+//Sampling is started and stopped at run time over the diagnostics server
+//(DiagServer.h), which also serves the histogram. Start clears it. A bin
+//that reaches UINT16_MAX stops the sampler, the histogram is then a
+//consistent window, about half a minute at the default rate if the ECU
+//does nothing but idle. PythonTestScripts/pc_profile.py resolves the
+//bins against the ELF file's symbols.
+
+//Set to 1 to build the sampler in, its bins take 2 bytes per
+//PC_SAMPLER_BIN_SIZE of PC_SAMPLER_FLASH_SIZE and PC_SAMPLER_RAM_SIZE
+#ifndef PC_SAMPLER_ENABLE
+#define PC_SAMPLER_ENABLE 0
+#endif
+
+//Samples a second
+#ifndef PC_SAMPLER_RATE
+#define PC_SAMPLER_RATE 2000
+#endif
+
+//Bytes of code per bin, a power of 2
+#ifndef PC_SAMPLER_BIN_SIZE
+#define PC_SAMPLER_BIN_SIZE 32
+#endif
+
+//Flash histogrammed from address 0, the rest counts as other
+#ifndef PC_SAMPLER_FLASH_SIZE
+#define PC_SAMPLER_FLASH_SIZE 0x40000
+#endif
+
+//SRAM code histogrammed from the start of .relocate, where .ramfunc is
+#ifndef PC_SAMPLER_RAM_SIZE
+#define PC_SAMPLER_RAM_SIZE 0x4000
+#endif
+
+#define PC_SAMPLER_FLASH_BINS (PC_SAMPLER_FLASH_SIZE / PC_SAMPLER_BIN_SIZE)
+#define PC_SAMPLER_RAM_BINS (PC_SAMPLER_RAM_SIZE / PC_SAMPLER_BIN_SIZE)
+
+typedef enum pc_sampler_region_t
+{
+	PC_SAMPLER_FLASH = 0,
+	PC_SAMPLER_RAM,
+	PC_SAMPLER_REGION_COUNT
+} pc_sampler_region_t;
+
+typedef struct pc_sampler_stats_t
+{
+	uint8_t running;
+	//a bin filled up and stopped the sampler
+	uint8_t saturated;
+	uint32_t samples;
+	//samples outside both regions
+	uint32_t other;
+} pc_sampler_stats_t;
+
+//Sets up TCC2, stopped. Before the scheduler starts.
+void PcSamplerInit();
+
+//Clears the histogram and starts sampling. Both from one task at a time,
+//the diagnostics server's in the tcpip thread.
+void PcSamplerStart();
+void PcSamplerStop();
+
+void PcSamplerRead(pc_sampler_stats_t* stats);
+
+//Address of the first byte of region's bin 0, the bins it has and their
+//counts. Counts go on changing while the sampler runs.
+uint32_t PcSamplerRegionBase(pc_sampler_region_t region);
+uint16_t PcSamplerRegionBins(pc_sampler_region_t region);
+uint16_t PcSamplerBin(pc_sampler_region_t region, uint16_t bin);
+
+#endif /* PCSAMPLER_H_ */
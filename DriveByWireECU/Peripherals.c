@@ -0,0 +1,66 @@
+/*
+ * Peripherals.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "Peripherals.h"
+#include "driver_init.h"
+#include "ethernet_phy_main.h"
+#include "BootProfile.h"
+
+#define PERIPHERAL_BIT(peripheral) (1UL << (peripheral))
+
+typedef struct peripheral_entry_t
+{
+	void (*init)(void);
+	//PERIPHERAL_BITs that have to be up first
+	uint32_t depends;
+	boot_stage_t stage;
+} peripheral_entry_t;
+
+//In the order system_init brought them up
+static const peripheral_entry_t peripherals[PERIPHERAL_COUNT] =
+{
+	[PERIPHERAL_ADC_0] = { ADC_0_init, 0, BOOT_STAGE_ADC },
+	[PERIPHERAL_TARGET_IO] = { TARGET_IO_init, 0, BOOT_STAGE_TARGET_IO },
+	[PERIPHERAL_PWM_0] = { PWM_0_init, 0, BOOT_STAGE_PWM },
+	[PERIPHERAL_PWM_1] = { PWM_1_init, 0, BOOT_STAGE_PWM },
+	[PERIPHERAL_PWM_4] = { PWM_4_init, 0, BOOT_STAGE_PWM },
+	[PERIPHERAL_PWM_2] = { PWM_2_init, 0, BOOT_STAGE_PWM },
+	[PERIPHERAL_PWM_3] = { PWM_3_init, 0, BOOT_STAGE_PWM },
+	[PERIPHERAL_CAN_0] = { CAN_0_init, 0, BOOT_STAGE_CAN },
+	[PERIPHERAL_COMMUNICATION_IO] = { COMMUNICATION_IO_init, 0, BOOT_STAGE_MAC },
+	[PERIPHERAL_ETHERNET_PHY] = { ethernet_phys_init, PERIPHERAL_BIT(PERIPHERAL_COMMUNICATION_IO), BOOT_STAGE_PHY },
+};
+
+static uint32_t peripherals_up;
+
+void PeripheralsInit()
+{
+#if !PERIPHERALS_LAZY
+	for(int i = 0; i < PERIPHERAL_COUNT; ++i)
+		PeripheralRequire((peripheral_t)i);
+#endif
+}
+
+void PeripheralRequire(peripheral_t peripheral)
+{
+	if( peripheral >= PERIPHERAL_COUNT || (peripherals_up & PERIPHERAL_BIT(peripheral)) )
+		return;
+
+	const peripheral_entry_t* entry = &peripherals[peripheral];
+	for(int i = 0; i < PERIPHERAL_COUNT; ++i)
+	{
+		if( entry->depends & PERIPHERAL_BIT(i) )
+			PeripheralRequire((peripheral_t)i);
+	}
+	entry->init();
+	peripherals_up |= PERIPHERAL_BIT(peripheral);
+	BootProfileMark(entry->stage);
+}
+
+uint32_t PeripheralsUp()
+{
+	return peripherals_up;
+}
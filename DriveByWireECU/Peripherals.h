@@ -0,0 +1,59 @@
+/*
+ * Peripherals.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PERIPHERALS_H_
+#define PERIPHERALS_H_
+
+#include <stdint.h>
+
+//The peripherals Atmel START generated in driver_init.c, brought up on
+//first use instead of all of them in system_init.
+//
+//system_init only sets up the pins. Each peripheral's owner calls
+//PeripheralRequire before touching it, which runs its generated init,
+//clocks first, once, after whatever it depends on. One that nothing in a
+//build uses never gets a clock: PWM_1 without STEERING_RATE_LOOP, PWM_3
+//without DAC_THROTTLE_RAMP, the TCs of the outputs on a TCC with
+//TCC_PWM_ENABLE. The actuator PWMs come up first, from
+//InitializeDriveByWireIO, the MAC and its PHY only once the outputs are
+//safe, so the time to a safe state no longer includes the PHY's reset.
+//
+//Each one's boot stage (BootProfile.h) is marked as it comes up, a stage
+//shared by several is the first of them.
+
+//Set to 0 to bring every peripheral up in system_init as generated, to
+//compare boot profiles
+#ifndef PERIPHERALS_LAZY
+#define PERIPHERALS_LAZY 1
+#endif
+
+typedef enum peripheral_t
+{
+	PERIPHERAL_ADC_0 = 0,
+	PERIPHERAL_TARGET_IO,
+	PERIPHERAL_PWM_0,
+	PERIPHERAL_PWM_1,
+	PERIPHERAL_PWM_4,
+	PERIPHERAL_PWM_2,
+	PERIPHERAL_PWM_3,
+	PERIPHERAL_CAN_0,
+	PERIPHERAL_COMMUNICATION_IO,
+	//ethernet_phys_init, over the MAC's MDIO
+	PERIPHERAL_ETHERNET_PHY,
+	PERIPHERAL_COUNT
+} peripheral_t;
+
+//From the end of system_init, everything without PERIPHERALS_LAZY
+void PeripheralsInit();
+
+//Brings peripheral up if it is not yet, its dependencies first. Before the
+//scheduler starts.
+void PeripheralRequire(peripheral_t peripheral);
+
+//Bit per peripheral_t that is up
+uint32_t PeripheralsUp();
+
+#endif /* PERIPHERALS_H_ */
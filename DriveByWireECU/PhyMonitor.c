@@ -0,0 +1,203 @@
+/*
+ * PhyMonitor.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hri_gmac_e54.h>
+#include <ethernet_phy_main.h>
+#include <ieee8023_mii_standard_register.h>
+#include "lwip/sys.h"
+#include "lwip/timers.h"
+#include "netif/etharp.h"
+#include "PhyMonitor.h"
+#include "EthernetIO.h"
+#include "EventLog.h"
+#include "BootProfile.h"
+#include "SelfTest.h"
+#include "Log.h"
+
+typedef struct phy_monitor_t
+{
+	struct netif* netif;
+	phy_monitor_stats_t stats;
+	//sys_now of the last drop
+	uint32_t down_since;
+	//sys_now of the next VerifyLinkMode
+	uint32_t next_verify;
+	//the link has been up at least once
+	uint8_t was_up;
+} phy_monitor_t;
+
+static phy_monitor_t phy_monitor;
+
+//Reads the mode the PHY is running the link in. With autonegotiation that
+//is the best mode both ends advertised, as the PHY itself resolves it,
+//otherwise what BMCR forces. Returns 0 while it can not be known yet.
+static int ReadLinkMode(uint16_t status, uint8_t* speed, uint8_t* full_duplex)
+{
+	uint16_t control;
+	if( ethernet_phy_read_reg(&ETHERNET_PHY_0_desc, MDIO_REG0_BMCR, &control) != ERR_NONE )
+		return 0;
+
+	if( !(control & MDIO_REG0_BIT_AUTONEG) )
+	{
+		*speed = (control & MDIO_REG0_BIT_SPEED_SELECT_LSB) ? 100 : 10;
+		*full_duplex = (control & MDIO_REG0_BIT_DUPLEX_MODE) != 0;
+		return 1;
+	}
+
+	uint16_t advertised, partner;
+	if( !(status & MDIO_REG1_BIT_AUTONEG_COMP) ||
+		ethernet_phy_read_reg(&ETHERNET_PHY_0_desc, MDIO_REG4_ANA, &advertised) != ERR_NONE ||
+		ethernet_phy_read_reg(&ETHERNET_PHY_0_desc, MDIO_REG5_ANLPA, &partner) != ERR_NONE )
+		return 0;
+
+	//a partner that does not negotiate is parallel detected, the PHY then
+	//sets its one half duplex ability here
+	uint16_t common = advertised & partner;
+	if( (common & (MDIO_100TX_FDX | MDIO_100TX_HDX | MDIO_10_FDX | MDIO_10_HDX)) == 0 )
+		return 0;
+
+	*speed = (common & (MDIO_100TX_FDX | MDIO_100TX_HDX)) ? 100 : 10;
+	*full_duplex = *speed == 100 ? (common & MDIO_100TX_FDX) != 0 : (common & MDIO_10_FDX) != 0;
+	return 1;
+}
+
+static hri_gmac_ncfgr_reg_t ModeBits(uint8_t speed, uint8_t full_duplex)
+{
+	return (speed == 100 ? GMAC_NCFGR_SPD : 0) | (full_duplex ? GMAC_NCFGR_FD : 0);
+}
+
+//Reads the link mode and sets the GMAC to match. Returns 1 if the GMAC had
+//to be changed. A mode that can not be read leaves everything as it was.
+static int ApplyLinkMode(uint16_t status)
+{
+	uint8_t speed, full_duplex;
+	if( !ReadLinkMode(status, &speed, &full_duplex) )
+		return 0;
+
+	phy_monitor.stats.speed = speed;
+	phy_monitor.stats.full_duplex = full_duplex;
+
+	hri_gmac_ncfgr_reg_t ncfgr = hri_gmac_read_NCFGR_reg(GMAC);
+	hri_gmac_ncfgr_reg_t mode = ModeBits(speed, full_duplex);
+	if( (ncfgr & (GMAC_NCFGR_SPD | GMAC_NCFGR_FD)) == mode )
+		return 0;
+
+	hri_gmac_write_NCFGR_reg(GMAC, (ncfgr & ~(GMAC_NCFGR_SPD | GMAC_NCFGR_FD)) | mode);
+	return 1;
+}
+
+//EVENT_LOG_LINK arg of the current link
+static uint16_t LinkEventArg()
+{
+	if( !phy_monitor.stats.up )
+		return 0;
+	return EVENT_LOG_LINK_UP | (phy_monitor.stats.speed == 100 ? EVENT_LOG_LINK_100M : 0) |
+		(phy_monitor.stats.full_duplex ? EVENT_LOG_LINK_FULL_DUPLEX : 0);
+}
+
+static void LinkUp(uint16_t status)
+{
+	phy_monitor.stats.speed = 0;
+	phy_monitor.stats.full_duplex = 0;
+	ApplyLinkMode(status);
+	phy_monitor.stats.up = 1;
+	phy_monitor.next_verify = sys_now() + PHY_MONITOR_VERIFY_PERIOD;
+	//also restarts DHCP and sends a gratuitous ARP
+	netif_set_link_up(phy_monitor.netif);
+	EthernetLinkUp(phy_monitor.netif);
+
+	if( phy_monitor.was_up )
+	{
+		phy_monitor.stats.last_outage = sys_now() - phy_monitor.down_since;
+		LOG("Ethernet link back after %lu ms, %lu Mbit/s %s duplex, %lu drops", phy_monitor.stats.last_outage,
+			phy_monitor.stats.speed, phy_monitor.stats.full_duplex ? "full" : "half", phy_monitor.stats.drops);
+	}
+	else
+	{
+		BootProfileMark(BOOT_STAGE_LINK_UP);
+		SelfTestLinkUp();
+		LOG("Ethernet link up, %lu Mbit/s %s duplex", phy_monitor.stats.speed, phy_monitor.stats.full_duplex ? "full" : "half");
+	}
+	//every frame of a half duplex link can wait on collisions
+	if( phy_monitor.stats.speed != 0 && (phy_monitor.stats.speed != 100 || !phy_monitor.stats.full_duplex) )
+		LOG("Ethernet link is not 100 Mbit/s full duplex, check the PC's port settings");
+	phy_monitor.was_up = 1;
+	EventLogWrite(EVENT_LOG_LINK, LinkEventArg(), phy_monitor.stats.drops);
+}
+
+//The mode only changes with a renegotiation, which takes the link down.
+//This catches the GMAC and PHY disagreeing anyway, and a mode that could
+//not be read when the link came up.
+static void VerifyLinkMode(uint16_t status)
+{
+	uint8_t speed = phy_monitor.stats.speed;
+	uint8_t full_duplex = phy_monitor.stats.full_duplex;
+	if( !ApplyLinkMode(status) && speed == phy_monitor.stats.speed && full_duplex == phy_monitor.stats.full_duplex )
+		return;
+
+	phy_monitor.stats.mode_corrections++;
+	LOG("Ethernet GMAC set to %lu Mbit/s %s duplex to match the PHY", phy_monitor.stats.speed,
+		phy_monitor.stats.full_duplex ? "full" : "half");
+	EventLogWrite(EVENT_LOG_LINK, LinkEventArg(), phy_monitor.stats.drops);
+}
+
+static void LinkDown()
+{
+	phy_monitor.stats.up = 0;
+	phy_monitor.stats.drops++;
+	phy_monitor.down_since = sys_now();
+	netif_set_link_down(phy_monitor.netif);
+
+	//whatever answers after the link is back gets asked again, only the
+	//configured peers stay pinned
+	etharp_cleanup_netif(phy_monitor.netif);
+	EthernetAddStaticPeers();
+
+	LOG("Ethernet link down, %lu drops", phy_monitor.stats.drops);
+	EventLogWrite(EVENT_LOG_LINK, LinkEventArg(), phy_monitor.stats.drops);
+}
+
+static void PhyMonitorPoll(void* arg)
+{
+	uint16_t status;
+	if( ethernet_phy_read_reg(&ETHERNET_PHY_0_desc, MDIO_REG1_BMSR, &status) == ERR_NONE )
+	{
+		uint8_t up = (status & MDIO_REG1_BIT_LINK_STATUS) != 0;
+		//A drop and recovery between two polls reads as down once. That is
+		//passed on too, the peer may have changed meanwhile.
+		if( !up && phy_monitor.stats.up )
+			LinkDown();
+		else if( up && !phy_monitor.stats.up )
+			LinkUp(status);
+		else if( up && (int32_t)(sys_now() - phy_monitor.next_verify) >= 0 )
+		{
+			VerifyLinkMode(status);
+			phy_monitor.next_verify = sys_now() + PHY_MONITOR_VERIFY_PERIOD;
+		}
+	}
+
+	sys_timeout(phy_monitor.stats.up ? PHY_MONITOR_UP_PERIOD : PHY_MONITOR_DOWN_PERIOD, PhyMonitorPoll, arg);
+}
+
+void PhyMonitorStart(struct netif* netif)
+{
+	phy_monitor.netif = netif;
+#if PHY_MONITOR_FORCE_100FD
+	//autonegotiation off, the link comes up as soon as the partner's
+	//signal does
+	ethernet_phy_write_reg(&ETHERNET_PHY_0_desc, MDIO_REG0_BMCR, MDIO_REG0_BIT_SPEED_SELECT_LSB | MDIO_REG0_BIT_DUPLEX_MODE);
+	hri_gmac_write_NCFGR_reg(GMAC, (hri_gmac_read_NCFGR_reg(GMAC) & ~(GMAC_NCFGR_SPD | GMAC_NCFGR_FD)) | ModeBits(100, 1));
+#endif
+	PhyMonitorPoll(NULL);
+}
+
+void PhyMonitorRead(phy_monitor_stats_t* stats)
+{
+	SYS_ARCH_DECL_PROTECT(level);
+	SYS_ARCH_PROTECT(level);
+	*stats = phy_monitor.stats;
+	SYS_ARCH_UNPROTECT(level);
+}
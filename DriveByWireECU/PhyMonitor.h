@@ -0,0 +1,75 @@
+/*
+ * PhyMonitor.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PHYMONITOR_H_
+#define PHYMONITOR_H_
+
+#include <stdint.h>
+#include "lwip/netif.h"
+
+//Follows the Ethernet link for the life of the ECU.
+//
+//The PHY's link status is polled over MDIO from a timeout in the tcpip
+//thread, one register read of a few tens of us, no task ever waits on it.
+//The status bit latches low, so a cable bump shorter than the poll period
+//is still seen as a drop.
+//
+//On a drop lwIP is told right away and the ARP table is cleared, the next
+//peer may well be another machine. The PHY renegotiates on its own and the
+//poll runs at PHY_MONITOR_DOWN_PERIOD while the link is down, so the link
+//is back within one autonegotiation. The GMAC is then set to the speed and
+//duplex that were negotiated before lwIP is told the link is up, which
+//announces the ECU, and the PC is asked for its address
+//(EthernetLinkUp), all in the same poll. The mode is checked against the
+//PHY every PHY_MONITOR_VERIFY_PERIOD after that.
+//Anything but 100 Mbit/s full duplex is logged, a half duplex link adds
+//collision latency to every frame.
+
+//ms between polls while the link is up
+#ifndef PHY_MONITOR_UP_PERIOD
+#define PHY_MONITOR_UP_PERIOD 100
+#endif
+
+//ms between polls while the link is down
+#ifndef PHY_MONITOR_DOWN_PERIOD
+#define PHY_MONITOR_DOWN_PERIOD 10
+#endif
+
+//ms between checks that the GMAC runs the mode the PHY does
+#ifndef PHY_MONITOR_VERIFY_PERIOD
+#define PHY_MONITOR_VERIFY_PERIOD 1000
+#endif
+
+//Set to 1 for a fixed point to point link: autonegotiation is turned off
+//and PHY and GMAC run 100 Mbit/s full duplex. The PC's port must be forced
+//to the same, a negotiating partner would detect half duplex.
+#ifndef PHY_MONITOR_FORCE_100FD
+#define PHY_MONITOR_FORCE_100FD 0
+#endif
+
+typedef struct phy_monitor_stats_t
+{
+	//times the link went down after it had been up, cable bumps included
+	uint32_t drops;
+	//ms the last drop lasted, 0 before the first one came back
+	uint32_t last_outage;
+	//the current link, 0 while down
+	uint8_t up;
+	//of the current link, 10 or 100, 0 if it could not be read
+	uint8_t speed;
+	uint8_t full_duplex;
+	//times the GMAC was found in another mode than the PHY and corrected
+	uint32_t mode_corrections;
+} phy_monitor_stats_t;
+
+//Polls the PHY once and from then on. In the tcpip thread, after netif is
+//added.
+void PhyMonitorStart(struct netif* netif);
+
+//Safe from any task
+void PhyMonitorRead(phy_monitor_stats_t* stats);
+
+#endif /* PHYMONITOR_H_ */
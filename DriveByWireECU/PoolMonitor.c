@@ -0,0 +1,133 @@
+/*
+ * PoolMonitor.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <compiler.h>
+#include "PoolMonitor.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
+#include "Log.h"
+
+//in memp_t order
+static const char* const pool_names[MEMP_MAX] =
+{
+#define LWIP_MEMPOOL(name, num, size, desc) desc,
+#include "lwip/memp_std.h"
+};
+
+static const uint16_t pool_counts[MEMP_MAX] =
+{
+#define LWIP_MEMPOOL(name, num, size, desc) (num),
+#include "lwip/memp_std.h"
+};
+
+typedef struct pool_cycles_t
+{
+	uint32_t mean;
+	uint32_t max;
+} pool_cycles_t;
+
+//written by PoolMonitorMeasure only
+static pool_cycles_t pool_cycles[MEMP_MAX];
+
+uint16_t PoolMonitorCount()
+{
+	return MEMP_MAX;
+}
+
+void PoolMonitorRead(uint16_t pool, pool_monitor_stats_t* stats)
+{
+	stats->name = pool_names[pool];
+	//memp.c only shares its sizes with mem_malloc's pools
+#if MEM_USE_POOLS
+	stats->size = memp_sizes[pool];
+#else
+	stats->size = 0;
+#endif
+	stats->count = pool_counts[pool];
+#if MEMP_STATS
+	SYS_ARCH_DECL_PROTECT(level);
+	SYS_ARCH_PROTECT(level);
+	stats->used = lwip_stats.memp[pool].used;
+	stats->max = lwip_stats.memp[pool].max;
+	stats->failed = lwip_stats.memp[pool].err;
+	SYS_ARCH_UNPROTECT(level);
+#else
+	stats->used = 0;
+	stats->max = 0;
+	stats->failed = 0;
+#endif
+	stats->cycles_mean = pool_cycles[pool].mean;
+	stats->cycles_max = pool_cycles[pool].max;
+}
+
+//Cycles of one alloc and free pair, 0 if the pool has no free element
+static uint32_t MeasurePair(memp_t pool)
+{
+	SYS_ARCH_DECL_PROTECT(level);
+	SYS_ARCH_PROTECT(level);
+#if MEMP_STATS
+	mem_size_t max = lwip_stats.memp[pool].max;
+	if( lwip_stats.memp[pool].used >= lwip_stats.memp[pool].avail )
+	{
+		SYS_ARCH_UNPROTECT(level);
+		return 0;
+	}
+#endif
+
+	uint32_t start = DWT->CYCCNT;
+	void* element = memp_malloc(pool);
+	if( element != NULL )
+		memp_free(pool, element);
+	uint32_t cycles = DWT->CYCCNT - start;
+
+#if MEMP_STATS
+	lwip_stats.memp[pool].max = max;
+#endif
+	SYS_ARCH_UNPROTECT(level);
+	return element != NULL ? cycles : 0;
+}
+
+void PoolMonitorMeasure()
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for(int pool = 0; pool < MEMP_MAX; ++pool)
+	{
+		uint32_t total = 0;
+		uint32_t worst = 0;
+		uint32_t samples = 0;
+		for(int n = 0; n < POOL_MONITOR_SAMPLES; ++n)
+		{
+			uint32_t cycles = MeasurePair((memp_t)pool);
+			if( cycles == 0 )
+				continue;
+			total += cycles;
+			samples++;
+			if( cycles > worst )
+				worst = cycles;
+		}
+		//a pool that was full keeps its last measurement
+		if( samples )
+		{
+			pool_cycles[pool].mean = total / samples;
+			pool_cycles[pool].max = worst;
+		}
+	}
+}
+
+void PoolMonitorReport()
+{
+	PoolMonitorMeasure();
+	for(uint16_t pool = 0; pool < MEMP_MAX; ++pool)
+	{
+		pool_monitor_stats_t stats;
+		PoolMonitorRead(pool, &stats);
+		LOG("lwip %s: %lu of %lu used, %lu most, %lu failed, %lu cycles worst", stats.name, (uint32_t)stats.used,
+			(uint32_t)stats.count, (uint32_t)stats.max, stats.failed, stats.cycles_max);
+	}
+}
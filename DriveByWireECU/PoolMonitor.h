@@ -0,0 +1,58 @@
+/*
+ * PoolMonitor.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef POOLMONITOR_H_
+#define POOLMONITOR_H_
+
+#include <stdint.h>
+
+//Use and cost of the lwIP memory pools (lwip/memp_std.h), the mem_malloc
+//size classes of lwippools.h among them. Everything lwIP allocates at run
+//time comes out of one of these, so their high-water marks are what the
+//counts in lwipopts.h and lwip_profile_config.h are sized from, and a
+//failure count above zero is a frame that was dropped or never sent.
+//
+//The counts are lwIP's MEMP_STATS. The cost is measured: PoolMonitorMeasure
+//times POOL_MONITOR_SAMPLES alloc and free pairs of every pool that has a
+//free element, with the DWT cycle counter. A pool is a free list, so the
+//pairs should cost the same whatever the pool and however full it is.
+
+//alloc and free pairs per pool and measurement
+#define POOL_MONITOR_SAMPLES 16
+
+typedef struct pool_monitor_stats_t
+{
+	//lwIP's description, "MALLOC_128" for a mem_malloc class
+	const char* name;
+	//bytes per element, 0 without MEM_USE_POOLS, and elements
+	uint16_t size;
+	uint16_t count;
+	uint16_t used;
+	//most ever in use, the pool's high water mark
+	uint16_t max;
+	//allocations that found the pool empty
+	uint32_t failed;
+	//core cycles of an alloc and free pair at the last PoolMonitorMeasure,
+	//0 while not measured
+	uint32_t cycles_mean;
+	uint32_t cycles_max;
+} pool_monitor_stats_t;
+
+//Number of pools, MEMP_MAX
+uint16_t PoolMonitorCount();
+
+//From any task, pool is below PoolMonitorCount
+void PoolMonitorRead(uint16_t pool, pool_monitor_stats_t* stats);
+
+//Measures every pool's alloc and free. Each pair runs with the lwIP
+//protection held, so it takes no element anybody else is waiting for and
+//leaves the high-water mark as it was.
+void PoolMonitorMeasure();
+
+//Measures and logs every pool (Log.h)
+void PoolMonitorReport();
+
+#endif /* POOLMONITOR_H_ */
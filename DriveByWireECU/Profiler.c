@@ -0,0 +1,123 @@
+/*
+ * Profiler.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <compiler.h>
+#include "Profiler.h"
+#include "FastCode.h"
+#include "Seqlock.h"
+
+//Written only by the task that measures the stage, stats are read under
+//sequence (Seqlock.h).
+typedef struct profiler_slot_t
+{
+	uint32_t sequence;
+	uint8_t reset_request;
+	profiler_stats_t stats;
+} profiler_slot_t;
+
+static profiler_slot_t profiler_slots[PROFILER_STAGE_COUNT];
+
+void ProfilerStatsClear(profiler_stats_t* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->min = UINT32_MAX;
+}
+
+static inline uint8_t HistogramBin(uint32_t cycles)
+{
+	//bits needed for cycles, 8 or fewer land in bin 0
+	int bits = 32 - __builtin_clz(cycles | 1);
+	if( bits <= 8 )
+		return 0;
+	if( bits - 8 >= PROFILER_HISTOGRAM_BINS )
+		return PROFILER_HISTOGRAM_BINS - 1;
+	return bits - 8;
+}
+
+FAST_CODE void ProfilerStatsAdd(profiler_stats_t* stats, uint32_t cycles)
+{
+	stats->count++;
+	stats->total += cycles;
+	if( cycles < stats->min )
+		stats->min = cycles;
+	if( cycles > stats->max )
+		stats->max = cycles;
+	stats->histogram[HistogramBin(cycles)]++;
+}
+
+void ProfilerInit()
+{
+	for(int i = 0; i < PROFILER_STAGE_COUNT; ++i)
+	{
+		profiler_slots[i].sequence = 0;
+		profiler_slots[i].reset_request = 0;
+		ProfilerStatsClear(&profiler_slots[i].stats);
+	}
+
+	//the count is left running, BootProfile times the boot with it
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#if PROFILER_ENABLE
+FAST_CODE uint32_t ProfilerStart()
+{
+	return DWT->CYCCNT;
+}
+
+FAST_CODE static void AddSample(profiler_stage_t stage, uint32_t cycles)
+{
+	profiler_slot_t* slot = &profiler_slots[stage];
+	profiler_stats_t* stats = &slot->stats;
+
+	SeqlockWriteBegin(&slot->sequence);
+	if( __atomic_exchange_n(&slot->reset_request, 0, __ATOMIC_ACQUIRE) )
+		ProfilerStatsClear(stats);
+	ProfilerStatsAdd(stats, cycles);
+	SeqlockWriteEnd(&slot->sequence);
+}
+
+FAST_CODE void ProfilerEnd(profiler_stage_t stage, uint32_t start)
+{
+	AddSample(stage, DWT->CYCCNT - start);
+}
+
+FAST_CODE void ProfilerEndSinceTick(profiler_stage_t stage)
+{
+	//SysTick counts core cycles down from LOAD and reloads on every tick
+	AddSample(stage, SysTick->LOAD - SysTick->VAL);
+}
+
+FAST_CODE void ProfilerAdd(profiler_stage_t stage, uint32_t cycles)
+{
+	AddSample(stage, cycles);
+}
+#endif
+
+void ProfilerRead(profiler_stage_t stage, profiler_stats_t* stats)
+{
+	if( stage >= PROFILER_STAGE_COUNT )
+	{
+		ProfilerStatsClear(stats);
+		return;
+	}
+
+	profiler_slot_t* slot = &profiler_slots[stage];
+	uint32_t sequence;
+
+	do
+	{
+		sequence = SeqlockReadBegin(&slot->sequence);
+		*stats = slot->stats;
+	} while( SeqlockReadRetry(&slot->sequence, sequence) );
+}
+
+void ProfilerRequestReset()
+{
+	for(int i = 0; i < PROFILER_STAGE_COUNT; ++i)
+		__atomic_store_n(&profiler_slots[i].reset_request, 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,121 @@
+/*
+ * Profiler.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdint.h>
+
+//Execution time of the control loop stages, in core cycles from the DWT
+//cycle counter. A probe is a ProfilerStart/ProfilerEnd pair around a
+//stage and costs a few dozen cycles. Each stage keeps its count, min, max,
+//total and a histogram in RAM, and the PC reads them with a profile
+//request (ControlProtocol.h).
+//
+//The cycle counter stops while the core sleeps (IdleSleep.h), so a stage
+//that blocks part way through reads short.
+//
+//Every stage must only ever be measured from one task or interrupt. Readers
+//and resets can come from any task, a reset is picked up by the stage's next
+//sample.
+
+//Set to 0 to compile every probe out
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE 1
+#endif
+
+//To add a stage, add it here and put a probe around it.
+typedef enum profiler_stage_t
+{
+	//main_task, from the cycle release to the telemetry snapshot
+	PROFILER_STAGE_CYCLE = 0,
+	PROFILER_STAGE_INPUTS,
+	PROFILER_STAGE_ALGORITHMS,
+	PROFILER_STAGE_STEERING_PID,
+	PROFILER_STAGE_SPEED_PID,
+	PROFILER_STAGE_OUTPUTS,
+	//control channel, one received frame or one telemetry send pass
+	PROFILER_STAGE_ETH_RECEIVE,
+	PROFILER_STAGE_ETH_SEND,
+	//main_task, from the tick interrupt that releases a cycle to the cycle
+	//running, waking the core from idle sleep included
+	PROFILER_STAGE_WAKE,
+	//TC1 interrupt, one step of the steering rate loop (STEERING_RATE_LOOP)
+	PROFILER_STAGE_STEERING_RATE,
+	//EIC interrupt, from entry to the outputs forced off and the press latched
+	PROFILER_STAGE_ESTOP,
+	//GMAC interrupt, the whole handler
+	PROFILER_STAGE_GMAC_ISR,
+	//CAN interrupt, draining the RX FIFOs into the mailboxes
+	PROFILER_STAGE_CAN_RECEIVE,
+	//TC1 interrupt, how far the time between two rate loop steps was off
+	//the loop's period, what the interrupts above it cost it
+	PROFILER_STAGE_STEERING_RATE_JITTER,
+	//control channel, checking the tag of an authenticated command
+	//(CommandAuth.h)
+	PROFILER_STAGE_COMMAND_AUTH,
+	//main_task, holding the throttle and brake back from the wheel slip
+	//(TractionControl.h)
+	PROFILER_STAGE_TRACTION,
+	PROFILER_STAGE_COUNT
+} profiler_stage_t;
+
+//Histogram bin 0 counts samples below 256 cycles, bin n above that
+//[2^(n+7), 2^(n+8)) and the last bin everything longer.
+#define PROFILER_HISTOGRAM_BINS 16
+
+typedef struct profiler_stats_t
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t histogram[PROFILER_HISTOGRAM_BINS];
+} profiler_stats_t;
+
+//Starts the cycle counter and clears every stage.
+//Must be called once before the scheduler starts.
+void ProfilerInit();
+
+#if PROFILER_ENABLE
+//Cycle count to hand to ProfilerEnd. Not inline so this header stays free
+//of the device headers, it is included next to lwIP.
+uint32_t ProfilerStart();
+//Adds the cycles since start to stage
+void ProfilerEnd(profiler_stage_t stage, uint32_t start);
+//Adds the cycles since the last RTOS tick interrupt to stage, from the
+//SysTick count. Only meaningful within one tick of the interrupt.
+void ProfilerEndSinceTick(profiler_stage_t stage);
+//Adds a sample measured some other way to stage
+void ProfilerAdd(profiler_stage_t stage, uint32_t cycles);
+#else
+static inline uint32_t ProfilerStart()
+{
+	return 0;
+}
+static inline void ProfilerEnd(profiler_stage_t stage, uint32_t start)
+{
+}
+static inline void ProfilerEndSinceTick(profiler_stage_t stage)
+{
+}
+static inline void ProfilerAdd(profiler_stage_t stage, uint32_t cycles)
+{
+}
+#endif
+
+//Consistent copy of a stage's stats, safe from any task
+void ProfilerRead(profiler_stage_t stage, profiler_stats_t* stats);
+
+//Clears every stage
+void ProfilerRequestReset();
+
+//Clears stats and adds one sample to them, for the modules that keep
+//stats of their own in the same form. Locking is up to the caller.
+void ProfilerStatsClear(profiler_stats_t* stats);
+void ProfilerStatsAdd(profiler_stats_t* stats, uint32_t cycles);
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,470 @@
+/*
+ * Ptp.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hri_gmac_e54.h>
+#include "lwip/udp.h"
+#include "lwip/igmp.h"
+#include "lwip/sys.h"
+#include "lwip/timers.h"
+#include "FreeRTOS.h"
+#include "Ptp.h"
+#include "Log.h"
+
+#if PTP_ENABLE
+
+//The TSU counts CLK_GMAC_AHB, the CPU clock
+#ifndef PTP_TSU_CLOCK_HZ
+#define PTP_TSU_CLOCK_HZ configCPU_CLOCK_HZ
+#endif
+
+//Servo gains per Sync, tuned for the 1 s Sync interval of a default master.
+//ppb of rate correction per ns of offset.
+#ifndef PTP_KP
+#define PTP_KP 0.7f
+#endif
+#ifndef PTP_KI
+#define PTP_KI 0.3f
+#endif
+
+#define PTP_EVENT_PORT 319
+#define PTP_GENERAL_PORT 320
+#define PTP_GROUP "224.0.1.129"
+
+#define PTP_MESSAGE_SYNC 0x0
+#define PTP_MESSAGE_DELAY_REQ 0x1
+#define PTP_MESSAGE_FOLLOW_UP 0x8
+#define PTP_MESSAGE_DELAY_RESP 0x9
+
+#define PTP_VERSION 2
+#define PTP_HEADER_SIZE 34
+//header and one timestamp, Sync, Follow_Up and Delay_Req alike
+#define PTP_TIMESTAMP_MESSAGE_SIZE 44
+#define PTP_DELAY_RESP_SIZE 54
+#define PTP_PORT_IDENTITY_SIZE 10
+//flagField, first octet
+#define PTP_FLAG_TWO_STEP 0x02
+
+#define NS_PER_SECOND 1000000000LL
+
+typedef struct ptp_t
+{
+	struct udp_pcb* event_pcb;
+	struct udp_pcb* general_pcb;
+	ip_addr_t group;
+
+	//clock identity from the MAC address, port 1
+	uint8_t identity[PTP_PORT_IDENTITY_SIZE];
+	//the master followed, valid with have_master
+	uint8_t master[PTP_PORT_IDENTITY_SIZE];
+	uint8_t have_master;
+	//sys_now of the last Sync from master
+	uint32_t last_sync;
+	uint32_t next_delay_request;
+
+	//The event frame registers keep their last stamp, one that did not move
+	//since the last frame means the GMAC did not stamp this one.
+	int64_t last_rx_stamp;
+	int64_t last_tx_stamp;
+
+	//t2 and correction of a two step Sync waiting for its Follow_Up
+	int64_t sync_rx;
+	int64_t sync_correction;
+	uint16_t sync_sequence;
+	uint8_t follow_up_pending;
+
+	//t2 - t1 of the last Sync, valid with have_sync. A step invalidates it,
+	//the t2 is from before.
+	int64_t master_to_slave;
+	uint8_t have_sync;
+
+	uint16_t delay_sequence;
+	uint8_t delay_pending;
+	int64_t path_delay;
+	uint8_t have_delay;
+
+	//TSU increment per clock at zero correction, 2^-16 ns
+	uint32_t nominal_increment;
+	//servo integral, ppb
+	float drift;
+
+	//set once the timer holds the master's time, read from any task
+	volatile uint8_t stepped;
+	ptp_stats_t stats;
+} ptp_t;
+
+static ptp_t ptp;
+
+static uint16_t GetBE16(const uint8_t* data)
+{
+	return ((uint16_t)data[0] << 8) | data[1];
+}
+
+static uint32_t GetBE32(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+static void PutBE16(uint8_t* data, uint16_t value)
+{
+	data[0] = value >> 8;
+	data[1] = value;
+}
+
+//48 bit seconds and 32 bit ns, as in every PTP timestamp
+static int64_t GetTimestamp(const uint8_t* data)
+{
+	int64_t seconds = ((int64_t)GetBE16(data) << 32) | GetBE32(&data[2]);
+	return seconds * NS_PER_SECOND + GetBE32(&data[6]);
+}
+
+//correctionField, ns scaled by 2^16
+static int64_t GetCorrection(const uint8_t* data)
+{
+	int64_t correction = ((int64_t)GetBE32(data) << 32) | GetBE32(&data[4]);
+	return correction >> 16;
+}
+
+//TSH only counts from 2106 on, the seconds fit TSL
+static int64_t ReadTimer()
+{
+	uint32_t seconds = hri_gmac_read_TSL_reg(GMAC);
+	uint32_t ns = hri_gmac_read_TN_reg(GMAC);
+	//the second rolled over between the two reads
+	uint32_t again = hri_gmac_read_TSL_reg(GMAC);
+	if( again != seconds )
+	{
+		seconds = again;
+		ns = hri_gmac_read_TN_reg(GMAC);
+	}
+	return (int64_t)seconds * NS_PER_SECOND + ns;
+}
+
+static int64_t ReadRxStamp()
+{
+	return (int64_t)hri_gmac_read_EFRSL_reg(GMAC) * NS_PER_SECOND + hri_gmac_read_EFRN_reg(GMAC);
+}
+
+static int64_t ReadTxStamp()
+{
+	return (int64_t)hri_gmac_read_EFTSL_reg(GMAC) * NS_PER_SECOND + hri_gmac_read_EFTN_reg(GMAC);
+}
+
+//Runs the timer fast by ppb, slow for negative. One step of the increment is
+//about 1.8 ppm at 120 MHz, the offset servo dithers between two of them.
+static void SetRate(int32_t ppb)
+{
+	uint32_t increment = ptp.nominal_increment + (int32_t)((int64_t)ptp.nominal_increment * ppb / NS_PER_SECOND);
+	hri_gmac_write_TISUBN_reg(GMAC, GMAC_TISUBN_LSBTIR(increment & 0xFFFF));
+	hri_gmac_write_TI_reg(GMAC, GMAC_TI_CNS(increment >> 16));
+	ptp.stats.adjustment = ppb;
+}
+
+//Takes offset off the timer at once
+static void StepTimer(int64_t offset)
+{
+	int64_t magnitude = offset < 0 ? -offset : offset;
+	if( magnitude < NS_PER_SECOND )
+		//ADJ subtracts
+		hri_gmac_write_TA_reg(GMAC, GMAC_TA_ITDT((uint32_t)magnitude) | (offset > 0 ? GMAC_TA_ADJ : 0));
+	else
+	{
+		int64_t now = ReadTimer() - offset;
+		hri_gmac_write_TSH_reg(GMAC, 0);
+		hri_gmac_write_TSL_reg(GMAC, (uint32_t)(now / NS_PER_SECOND));
+		hri_gmac_write_TN_reg(GMAC, (uint32_t)(now % NS_PER_SECOND));
+	}
+
+	//both were measured on the old time
+	ptp.have_sync = 0;
+	ptp.delay_pending = 0;
+	ptp.stats.steps++;
+	ptp.stepped = 1;
+}
+
+static void Servo(int64_t offset)
+{
+	ptp.stats.offset = offset > INT32_MAX ? INT32_MAX : offset < INT32_MIN ? INT32_MIN : (int32_t)offset;
+	if( !ptp.stepped || offset > PTP_STEP_THRESHOLD || offset < -PTP_STEP_THRESHOLD )
+	{
+		StepTimer(offset);
+		ptp.stats.synced = 0;
+		LOG("PTP stepped by %ld ns", ptp.stats.offset);
+		return;
+	}
+
+	//a positive offset is an ECU ahead of the master, it has to slow down
+	ptp.drift -= PTP_KI * (float)offset;
+	if( ptp.drift > PTP_MAX_ADJUSTMENT )
+		ptp.drift = PTP_MAX_ADJUSTMENT;
+	else if( ptp.drift < -PTP_MAX_ADJUSTMENT )
+		ptp.drift = -PTP_MAX_ADJUSTMENT;
+
+	float adjustment = ptp.drift - PTP_KP * (float)offset;
+	if( adjustment > PTP_MAX_ADJUSTMENT )
+		adjustment = PTP_MAX_ADJUSTMENT;
+	else if( adjustment < -PTP_MAX_ADJUSTMENT )
+		adjustment = -PTP_MAX_ADJUSTMENT;
+	SetRate((int32_t)adjustment);
+
+	uint8_t synced = offset < PTP_SYNCED_THRESHOLD && offset > -PTP_SYNCED_THRESHOLD;
+	if( synced && !ptp.stats.synced )
+		LOG("PTP synced, offset %ld ns, path delay %ld ns", ptp.stats.offset, ptp.stats.path_delay);
+	ptp.stats.synced = synced;
+}
+
+static void SendDelayRequest()
+{
+	struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, PTP_TIMESTAMP_MESSAGE_SIZE, PBUF_RAM);
+	if( p == NULL )
+		return;
+
+	//the origin timestamp may be left 0, t3 is the GMAC's stamp
+	uint8_t* message = (uint8_t*)p->payload;
+	memset(message, 0, PTP_TIMESTAMP_MESSAGE_SIZE);
+	message[0] = PTP_MESSAGE_DELAY_REQ;
+	message[1] = PTP_VERSION;
+	PutBE16(&message[2], PTP_TIMESTAMP_MESSAGE_SIZE);
+	message[4] = PTP_DOMAIN;
+	memcpy(&message[20], ptp.identity, PTP_PORT_IDENTITY_SIZE);
+	PutBE16(&message[30], ++ptp.delay_sequence);
+	//controlField and logMessageInterval of a Delay_Req
+	message[32] = 1;
+	message[33] = 0x7F;
+
+	ptp.last_tx_stamp = ReadTxStamp();
+	ptp.delay_pending = udp_sendto(ptp.event_pcb, p, &ptp.group, PTP_EVENT_PORT) == ERR_OK;
+	pbuf_free(p);
+}
+
+//t1 of the Sync whose t2 is in sync_rx
+static void SyncComplete(int64_t origin)
+{
+	ptp.master_to_slave = ptp.sync_rx - origin;
+	ptp.have_sync = 1;
+	ptp.stats.syncs++;
+
+	//until there is a path delay the offset is off by it, close enough to
+	//step the first time
+	Servo(ptp.master_to_slave - (ptp.have_delay ? ptp.path_delay : 0));
+
+	if( ptp.have_sync && (int32_t)(sys_now() - ptp.next_delay_request) >= 0 )
+	{
+		SendDelayRequest();
+		ptp.next_delay_request = sys_now() + PTP_DELAY_REQ_PERIOD;
+	}
+}
+
+//Checks version, domain and length. Returns the message type, or -1.
+static int CheckMessage(const uint8_t* message, uint16_t length)
+{
+	if( length < PTP_HEADER_SIZE || (message[1] & 0x0F) != PTP_VERSION || message[4] != PTP_DOMAIN ||
+		GetBE16(&message[2]) > length )
+		return -1;
+	return message[0] & 0x0F;
+}
+
+static uint8_t FromMaster(const uint8_t* message)
+{
+	return ptp.have_master && memcmp(&message[20], ptp.master, PTP_PORT_IDENTITY_SIZE) == 0;
+}
+
+static void PtpEventReceive(void* arg, struct udp_pcb* pcb, struct pbuf* p, ip_addr_t* addr, u16_t port)
+{
+	//before anything else can be received
+	int64_t stamp = ReadRxStamp();
+	uint8_t message[PTP_TIMESTAMP_MESSAGE_SIZE];
+	uint16_t length = pbuf_copy_partial(p, message, sizeof(message), 0);
+	pbuf_free(p);
+
+	if( CheckMessage(message, length) != PTP_MESSAGE_SYNC || length < PTP_TIMESTAMP_MESSAGE_SIZE )
+		return;
+
+	//the first master to send a Sync is followed until it goes quiet
+	if( !ptp.have_master || (int32_t)(sys_now() - ptp.last_sync) >= PTP_MASTER_TIMEOUT )
+	{
+		if( !FromMaster(message) )
+			ptp.have_delay = 0;
+		memcpy(ptp.master, &message[20], PTP_PORT_IDENTITY_SIZE);
+		ptp.have_master = 1;
+	}
+	if( !FromMaster(message) )
+		return;
+	ptp.last_sync = sys_now();
+
+	if( stamp == ptp.last_rx_stamp )
+	{
+		ptp.stats.missed_stamps++;
+		ptp.follow_up_pending = 0;
+		return;
+	}
+	ptp.last_rx_stamp = stamp;
+
+	ptp.sync_rx = stamp;
+	ptp.sync_correction = GetCorrection(&message[8]);
+	ptp.sync_sequence = GetBE16(&message[30]);
+	ptp.follow_up_pending = (message[6] & PTP_FLAG_TWO_STEP) != 0;
+	if( !ptp.follow_up_pending )
+		SyncComplete(GetTimestamp(&message[PTP_HEADER_SIZE]) + ptp.sync_correction);
+}
+
+static void PtpGeneralReceive(void* arg, struct udp_pcb* pcb, struct pbuf* p, ip_addr_t* addr, u16_t port)
+{
+	uint8_t message[PTP_DELAY_RESP_SIZE];
+	uint16_t length = pbuf_copy_partial(p, message, sizeof(message), 0);
+	pbuf_free(p);
+
+	int type = CheckMessage(message, length);
+	if( !FromMaster(message) )
+		return;
+
+	if( type == PTP_MESSAGE_FOLLOW_UP && length >= PTP_TIMESTAMP_MESSAGE_SIZE )
+	{
+		if( !ptp.follow_up_pending || GetBE16(&message[30]) != ptp.sync_sequence )
+			return;
+		ptp.follow_up_pending = 0;
+		SyncComplete(GetTimestamp(&message[PTP_HEADER_SIZE]) + ptp.sync_correction + GetCorrection(&message[8]));
+	}
+	else if( type == PTP_MESSAGE_DELAY_RESP && length >= PTP_DELAY_RESP_SIZE )
+	{
+		if( !ptp.delay_pending || GetBE16(&message[30]) != ptp.delay_sequence ||
+			memcmp(&message[44], ptp.identity, PTP_PORT_IDENTITY_SIZE) != 0 )
+			return;
+		ptp.delay_pending = 0;
+
+		//long sent by now, the master has answered it
+		int64_t tx_stamp = ReadTxStamp();
+		if( tx_stamp == ptp.last_tx_stamp )
+		{
+			ptp.stats.missed_stamps++;
+			return;
+		}
+		ptp.last_tx_stamp = tx_stamp;
+		if( !ptp.have_sync )
+			return;
+
+		int64_t slave_to_master = GetTimestamp(&message[PTP_HEADER_SIZE]) - GetCorrection(&message[8]) - tx_stamp;
+		int64_t delay = (ptp.master_to_slave + slave_to_master) / 2;
+		if( delay < 0 )
+			delay = 0;
+		//the delay is steady, an average keeps the queueing jitter of the
+		//PC's stack out of the offset
+		ptp.path_delay = ptp.have_delay ? ptp.path_delay + (delay - ptp.path_delay) / 8 : delay;
+		ptp.have_delay = 1;
+		ptp.stats.path_delay = (int32_t)ptp.path_delay;
+		ptp.stats.delay_responses++;
+	}
+}
+
+//Once a second, notices a master that went away
+static void PtpCheckMaster(void* arg)
+{
+	if( ptp.have_master && (int32_t)(sys_now() - ptp.last_sync) >= PTP_MASTER_TIMEOUT )
+	{
+		if( ptp.stats.synced )
+			LOG("PTP master lost, the clock runs free");
+		ptp.stats.synced = 0;
+		ptp.have_master = 0;
+		ptp.have_sync = 0;
+	}
+	sys_timeout(1000, PtpCheckMaster, NULL);
+}
+
+void PtpStart(struct netif* netif)
+{
+	memset(&ptp, 0, sizeof(ptp));
+
+	//EUI-64 of the MAC address
+	memcpy(ptp.identity, netif->hwaddr, 3);
+	ptp.identity[3] = 0xFF;
+	ptp.identity[4] = 0xFE;
+	memcpy(&ptp.identity[5], &netif->hwaddr[3], 3);
+	ptp.identity[9] = 1;
+
+	//ns per TSU clock, the fraction in 2^-16 ns
+	ptp.nominal_increment = (uint32_t)((NS_PER_SECOND << 16) / PTP_TSU_CLOCK_HZ);
+	SetRate(0);
+
+	ptp.group.addr = ipaddr_addr(PTP_GROUP);
+	ptp.event_pcb = udp_new();
+	ptp.general_pcb = udp_new();
+	if( ptp.event_pcb == NULL || ptp.general_pcb == NULL ||
+		udp_bind(ptp.event_pcb, IP_ADDR_ANY, PTP_EVENT_PORT) != ERR_OK ||
+		udp_bind(ptp.general_pcb, IP_ADDR_ANY, PTP_GENERAL_PORT) != ERR_OK ||
+		igmp_joingroup(IP_ADDR_ANY, &ptp.group) != ERR_OK )
+	{
+		LOG("PTP could not be started");
+		return;
+	}
+	udp_recv(ptp.event_pcb, PtpEventReceive, NULL);
+	udp_recv(ptp.general_pcb, PtpGeneralReceive, NULL);
+	sys_timeout(1000, PtpCheckMaster, NULL);
+}
+
+uint32_t PtpTimeUs()
+{
+	if( !ptp.stepped )
+		return 0;
+
+	uint32_t seconds = hri_gmac_read_TSL_reg(GMAC);
+	uint32_t ns = hri_gmac_read_TN_reg(GMAC);
+	uint32_t again = hri_gmac_read_TSL_reg(GMAC);
+	if( again != seconds )
+	{
+		seconds = again;
+		ns = hri_gmac_read_TN_reg(GMAC);
+	}
+	//wraps like the ms timestamps do
+	return seconds * 1000000u + ns / 1000;
+}
+
+uint32_t PtpPhaseNs(uint32_t period_ns)
+{
+	if( !ptp.stepped )
+		return 0;
+	return hri_gmac_read_TN_reg(GMAC) % period_ns;
+}
+
+uint8_t PtpSynced()
+{
+	return __atomic_load_n(&ptp.stats.synced, __ATOMIC_RELAXED);
+}
+
+void PtpRead(ptp_stats_t* stats)
+{
+	SYS_ARCH_DECL_PROTECT(level);
+	SYS_ARCH_PROTECT(level);
+	*stats = ptp.stats;
+	SYS_ARCH_UNPROTECT(level);
+}
+
+#else
+
+void PtpStart(struct netif* netif)
+{
+}
+
+uint32_t PtpTimeUs()
+{
+	return 0;
+}
+
+uint32_t PtpPhaseNs(uint32_t period_ns)
+{
+	return 0;
+}
+
+uint8_t PtpSynced()
+{
+	return 0;
+}
+
+void PtpRead(ptp_stats_t* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Ptp.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PTP_H_
+#define PTP_H_
+
+#include <stdint.h>
+#include "lwip/netif.h"
+
+//Keeps the GMAC's IEEE 1588 timer on the autonomy PC's PTP clock.
+//
+//The ECU is a PTPv2 slave, end to end delay mechanism over UDP/IPv4
+//multicast, in the tcpip thread. Sync and Delay_Req are stamped by the GMAC
+//itself as they cross the MII, the PTP event frame registers, so neither
+//lwIP nor the tasks add to the measured offset. One and two step masters
+//both work. Offsets beyond PTP_STEP_THRESHOLD are stepped, the rest is
+//steered out through the timer's increment by a PI servo.
+//
+//The GMAC only stamps PTP event frames, not the control channel's. Command
+//and telemetry times (ControlProtocol.h) are read from the disciplined timer
+//in software as they are handled, a few us after the wire.
+//
+//The event frame registers hold the last frame of each direction, so the
+//link carries one master and this ECU: another slave's Delay_Req would
+//overwrite the receive stamp of the next Sync.
+
+#ifndef PTP_ENABLE
+#define PTP_ENABLE 1
+#endif
+
+#ifndef PTP_DOMAIN
+#define PTP_DOMAIN 0
+#endif
+
+//ns of offset that are stepped instead of steered
+#ifndef PTP_STEP_THRESHOLD
+#define PTP_STEP_THRESHOLD 100000
+#endif
+
+//ns of offset under which the clock counts as synced
+#ifndef PTP_SYNCED_THRESHOLD
+#define PTP_SYNCED_THRESHOLD 1000
+#endif
+
+//ms between Delay_Req, the path delay only changes with the cabling
+#ifndef PTP_DELAY_REQ_PERIOD
+#define PTP_DELAY_REQ_PERIOD 1000
+#endif
+
+//ms without a Sync after which the master is taken as gone and the next one
+//that syncs is followed
+#ifndef PTP_MASTER_TIMEOUT
+#define PTP_MASTER_TIMEOUT 5000
+#endif
+
+//largest rate correction, ppb
+#ifndef PTP_MAX_ADJUSTMENT
+#define PTP_MAX_ADJUSTMENT 500000
+#endif
+
+typedef struct ptp_stats_t
+{
+	//the last offset was under PTP_SYNCED_THRESHOLD and the master is alive
+	uint8_t synced;
+	//from the master, ns, positive when the ECU is ahead
+	int32_t offset;
+	//one way, ns
+	int32_t path_delay;
+	//rate correction in force, ppb
+	int32_t adjustment;
+	uint32_t syncs;
+	uint32_t delay_responses;
+	uint32_t steps;
+	//event frames the GMAC did not stamp, they are skipped
+	uint32_t missed_stamps;
+} ptp_stats_t;
+
+//Starts the timer and joins the PTP group. In the tcpip thread, after netif
+//is added.
+void PtpStart(struct netif* netif);
+
+//The PTP time in us, low 32 bits, 0 until the clock has synced once. Safe
+//from any task and from interrupts, a few register reads.
+uint32_t PtpTimeUs();
+
+//ns into the current period of the PTP time, for a period that divides a
+//second. Only the ns register is read, safe from interrupts. 0 until the
+//clock has synced once.
+uint32_t PtpPhaseNs(uint32_t period_ns);
+
+//The last offset was under PTP_SYNCED_THRESHOLD and the master is alive.
+//Safe from interrupts.
+uint8_t PtpSynced();
+
+//Safe from any task
+void PtpRead(ptp_stats_t* stats);
+
+#endif /* PTP_H_ */
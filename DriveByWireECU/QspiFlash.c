@@ -0,0 +1,197 @@
+/*
+ * QspiFlash.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hal_gpio.h>
+#include <hal_delay.h>
+#include <hpl_cmcc.h>
+#include <hri_qspi_e54.h>
+#include <hri_mclk_e54.h>
+#include "QspiFlash.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+//SCK is the CPU clock over BAUD + 1, at most 30MHz: 30MHz with the 120MHz
+//clock profile, 12MHz without
+#define QSPI_FLASH_BAUD ((configCPU_CLOCK_HZ + 30000000UL - 1) / 30000000UL - 1)
+
+#define QSPI_FLASH_RESET_ENABLE 0x66
+#define QSPI_FLASH_RESET 0x99
+#define QSPI_FLASH_JEDEC_ID 0x9F
+#define QSPI_FLASH_READ_STATUS 0x05
+#define QSPI_FLASH_READ_CONFIG 0x35
+#define QSPI_FLASH_WRITE_STATUS 0x01
+#define QSPI_FLASH_WRITE_ENABLE 0x06
+#define QSPI_FLASH_GLOBAL_UNLOCK 0x98
+#define QSPI_FLASH_SECTOR_ERASE 0x20
+#define QSPI_FLASH_PAGE_PROGRAM 0x02
+#define QSPI_FLASH_QUAD_OUTPUT_READ 0x6B
+
+#define QSPI_FLASH_STATUS_BUSY 0x01
+//IOC on the SST26, QE on most others: WP and HOLD become DATA2 and DATA3
+#define QSPI_FLASH_CONFIG_QUAD 0x02
+
+//Frames of the commands without an address, and of those with one
+#define QSPI_FLASH_FRAME (QSPI_INSTRFRAME_WIDTH_SINGLE_BIT_SPI | QSPI_INSTRFRAME_INSTREN)
+#define QSPI_FLASH_ADDRESS_FRAME (QSPI_FLASH_FRAME | QSPI_INSTRFRAME_ADDRLEN_24BITS | QSPI_INSTRFRAME_ADDREN)
+
+static void InitPins()
+{
+	static const uint32_t pins[][2] =
+	{
+		{ GPIO(GPIO_PORTA, 8), PINMUX_PA08H_QSPI_DATA0 },
+		{ GPIO(GPIO_PORTA, 9), PINMUX_PA09H_QSPI_DATA1 },
+		{ GPIO(GPIO_PORTA, 10), PINMUX_PA10H_QSPI_DATA2 },
+		{ GPIO(GPIO_PORTA, 11), PINMUX_PA11H_QSPI_DATA3 },
+		{ GPIO(GPIO_PORTB, 10), PINMUX_PB10H_QSPI_SCK },
+		{ GPIO(GPIO_PORTB, 11), PINMUX_PB11H_QSPI_CS },
+	};
+	for(uint32_t i = 0; i < sizeof(pins) / sizeof(pins[0]); ++i)
+		gpio_set_pin_function(pins[i][0], pins[i][1]);
+}
+
+//Back to memory mapped reads
+static void MapReads()
+{
+	hri_qspi_write_INSTRCTRL_reg(QSPI, QSPI_INSTRCTRL_INSTR(QSPI_FLASH_QUAD_OUTPUT_READ));
+	hri_qspi_write_INSTRFRAME_reg(QSPI, QSPI_INSTRFRAME_WIDTH_QUAD_OUTPUT | QSPI_INSTRFRAME_INSTREN
+		| QSPI_INSTRFRAME_ADDRLEN_24BITS | QSPI_INSTRFRAME_ADDREN | QSPI_INSTRFRAME_DATAEN
+		| QSPI_INSTRFRAME_TFRTYPE_READMEMORY | QSPI_INSTRFRAME_DUMMYLEN(8));
+	hri_qspi_read_INSTRFRAME_reg(QSPI);
+}
+
+//One instruction, with its data read from or written to the window. The
+//frame of a mapped read ends first, the QSPI only starts a new
+//instruction once chip select went up.
+static void Command(uint8_t instruction, uint32_t frame, uint32_t address, uint8_t* data, uint16_t length)
+{
+	hri_qspi_write_CTRLA_reg(QSPI, QSPI_CTRLA_ENABLE | QSPI_CTRLA_LASTXFER);
+	while( !hri_qspi_get_STATUS_CSSTATUS_bit(QSPI) )
+		;
+	hri_qspi_clear_INTFLAG_INSTREND_bit(QSPI);
+
+	hri_qspi_write_INSTRADDR_reg(QSPI, address);
+	hri_qspi_write_INSTRCTRL_reg(QSPI, QSPI_INSTRCTRL_INSTR(instruction));
+	hri_qspi_write_INSTRFRAME_reg(QSPI, frame | (length ? QSPI_INSTRFRAME_DATAEN : 0));
+	//the frame has to be in before the window is touched
+	hri_qspi_read_INSTRFRAME_reg(QSPI);
+
+	volatile uint8_t* window = (volatile uint8_t*)QSPI_AHB + ((frame & QSPI_INSTRFRAME_ADDREN) ? address : 0);
+	uint32_t type = frame & QSPI_INSTRFRAME_TFRTYPE_Msk;
+	for(uint16_t i = 0; i < length; ++i)
+	{
+		if( type == QSPI_INSTRFRAME_TFRTYPE_READ || type == QSPI_INSTRFRAME_TFRTYPE_READMEMORY )
+			data[i] = window[i];
+		else
+			window[i] = data[i];
+	}
+	__DSB();
+	__ISB();
+
+	hri_qspi_write_CTRLA_reg(QSPI, QSPI_CTRLA_ENABLE | QSPI_CTRLA_LASTXFER);
+	while( !hri_qspi_get_INTFLAG_INSTREND_bit(QSPI) )
+		;
+	hri_qspi_clear_INTFLAG_INSTREND_bit(QSPI);
+}
+
+static uint8_t ReadRegister(uint8_t instruction)
+{
+	uint8_t value;
+	Command(instruction, QSPI_FLASH_FRAME | QSPI_INSTRFRAME_TFRTYPE_READ, 0, &value, 1);
+	return value;
+}
+
+//Polls the busy bit, in 1 ms task sleeps once the scheduler runs and in
+//100 us spins before
+static uint8_t WaitReady(uint32_t timeout_ms, uint8_t sleep)
+{
+	for(uint32_t waited = 0; waited <= timeout_ms * (sleep ? 1 : 10); ++waited)
+	{
+		if( !(ReadRegister(QSPI_FLASH_READ_STATUS) & QSPI_FLASH_STATUS_BUSY) )
+			return 1;
+		if( sleep )
+			vTaskDelay(pdMS_TO_TICKS(1) > 0 ? pdMS_TO_TICKS(1) : 1);
+		else
+			delay_us(100);
+	}
+	return 0;
+}
+
+static void WriteEnable()
+{
+	Command(QSPI_FLASH_WRITE_ENABLE, QSPI_FLASH_FRAME | QSPI_INSTRFRAME_TFRTYPE_READ, 0, NULL, 0);
+}
+
+uint8_t QspiFlashInit()
+{
+	hri_mclk_set_AHBMASK_QSPI_bit(MCLK);
+	hri_mclk_set_AHBMASK_QSPI_2X_bit(MCLK);
+	hri_mclk_set_APBCMASK_QSPI_bit(MCLK);
+	InitPins();
+
+	hri_qspi_write_CTRLA_reg(QSPI, QSPI_CTRLA_SWRST);
+	hri_qspi_write_CTRLB_reg(QSPI, QSPI_CTRLB_MODE_MEMORY | QSPI_CTRLB_CSMODE_LASTXFER | QSPI_CTRLB_DATALEN_8BITS);
+	hri_qspi_write_BAUD_reg(QSPI, QSPI_BAUD_BAUD(QSPI_FLASH_BAUD));
+	hri_qspi_write_CTRLA_reg(QSPI, QSPI_CTRLA_ENABLE);
+
+	//out of whatever a debugger or the last run left it in
+	Command(QSPI_FLASH_RESET_ENABLE, QSPI_FLASH_FRAME | QSPI_INSTRFRAME_TFRTYPE_READ, 0, NULL, 0);
+	Command(QSPI_FLASH_RESET, QSPI_FLASH_FRAME | QSPI_INSTRFRAME_TFRTYPE_READ, 0, NULL, 0);
+	delay_us(100);
+
+	//nothing on the bus reads all ones or all zeroes
+	uint8_t id[3];
+	Command(QSPI_FLASH_JEDEC_ID, QSPI_FLASH_FRAME | QSPI_INSTRFRAME_TFRTYPE_READ, 0, id, sizeof(id));
+	if( id[0] == 0x00 || id[0] == 0xFF )
+		return 0;
+
+	uint8_t config = ReadRegister(QSPI_FLASH_READ_CONFIG);
+	if( !(config & QSPI_FLASH_CONFIG_QUAD) )
+	{
+		uint8_t registers[2] = { ReadRegister(QSPI_FLASH_READ_STATUS), config | QSPI_FLASH_CONFIG_QUAD };
+		WriteEnable();
+		Command(QSPI_FLASH_WRITE_STATUS, QSPI_FLASH_FRAME | QSPI_INSTRFRAME_TFRTYPE_WRITE, 0, registers, sizeof(registers));
+		if( !WaitReady(QSPI_FLASH_PROGRAM_TIMEOUT, 0) )
+			return 0;
+	}
+
+	WriteEnable();
+	Command(QSPI_FLASH_GLOBAL_UNLOCK, QSPI_FLASH_FRAME | QSPI_INSTRFRAME_TFRTYPE_READ, 0, NULL, 0);
+	MapReads();
+	return 1;
+}
+
+const volatile uint8_t* QspiFlashMapped(uint32_t address)
+{
+	return (const volatile uint8_t*)QSPI_AHB + address;
+}
+
+void QspiFlashInvalidate()
+{
+	_cmcc_invalidate_all(CMCC);
+	_cmcc_enable(CMCC);
+}
+
+uint8_t QspiFlashErase(uint32_t address)
+{
+	WriteEnable();
+	Command(QSPI_FLASH_SECTOR_ERASE, QSPI_FLASH_ADDRESS_FRAME | QSPI_INSTRFRAME_TFRTYPE_READ,
+		address & ~(QSPI_FLASH_SECTOR_SIZE - 1UL), NULL, 0);
+	uint8_t done = WaitReady(QSPI_FLASH_ERASE_TIMEOUT, 1);
+	MapReads();
+	return done;
+}
+
+uint8_t QspiFlashProgram(uint32_t address, const void* data, uint16_t length)
+{
+	if( length == 0 || (address % QSPI_FLASH_PAGE_SIZE) + length > QSPI_FLASH_PAGE_SIZE )
+		return 0;
+	WriteEnable();
+	Command(QSPI_FLASH_PAGE_PROGRAM, QSPI_FLASH_ADDRESS_FRAME | QSPI_INSTRFRAME_TFRTYPE_WRITEMEMORY,
+		address, (uint8_t*)data, length);
+	uint8_t done = WaitReady(QSPI_FLASH_PROGRAM_TIMEOUT, 1);
+	MapReads();
+	return done;
+}
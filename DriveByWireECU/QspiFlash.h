@@ -0,0 +1,60 @@
+/*
+ * QspiFlash.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef QSPIFLASH_H_
+#define QSPIFLASH_H_
+
+#include <stdint.h>
+
+//Serial NOR flash on the QSPI, for BlackBox.h. Written for the SST26VF064B
+//of the SAME54 Xplained Pro, other parts with 4KB sectors, 256 byte pages
+//and the usual JEDEC commands work with QSPI_FLASH_SIZE changed.
+//
+//	PA08 to PA11 DATA0 to DATA3, PB10 SCK, PB11 CS
+//
+//Reads are memory mapped: between erases and programs the whole flash is
+//readable at QspiFlashMapped, in quad output reads at up to 30MHz, by the CPU
+//and by anything that copies out of it. Erases and programs are commands
+//that wait for the flash in vTaskDelay steps, from one task only, and
+//nothing may read the window while one runs.
+//
+//The window is on the code bus and goes through the CMCC, which does not
+//see the flash change. QspiFlashInvalidate drops whatever it cached.
+
+//Bytes, 64Mbit
+#ifndef QSPI_FLASH_SIZE
+#define QSPI_FLASH_SIZE 0x800000UL
+#endif
+
+#define QSPI_FLASH_SECTOR_SIZE 4096
+#define QSPI_FLASH_PAGE_SIZE 256
+
+//ms an erase may take, 25 on the SST26
+#define QSPI_FLASH_ERASE_TIMEOUT 100
+//ms a page program may take, 1.5 on the SST26
+#define QSPI_FLASH_PROGRAM_TIMEOUT 10
+
+//Clocks, pins and the QSPI, then checks that a flash answers, enables its
+//quad data lines and lifts the write protection it powers up with.
+//Non-zero once it can be read and written. Before the scheduler starts.
+uint8_t QspiFlashInit();
+
+//address in the memory mapped window
+const volatile uint8_t* QspiFlashMapped(uint32_t address);
+
+//Drops the CMCC's copy of the window, after the flash changed under what
+//was read from it. Clears the whole cache and leaves it enabled.
+void QspiFlashInvalidate();
+
+//Erases the sector address is in. Non-zero once the flash is done.
+uint8_t QspiFlashErase(uint32_t address);
+
+//Programs length bytes at address, all within one page. Bits only go from
+//1 to 0, bytes already programmed but 0xFF in data stay as they are.
+//Non-zero once the flash is done.
+uint8_t QspiFlashProgram(uint32_t address, const void* data, uint16_t length);
+
+#endif /* QSPIFLASH_H_ */
@@ -0,0 +1,192 @@
+/*
+ * RamEcc.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hpl_ramecc.h>
+#include "RamEcc.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "EventLog.h"
+#include "Log.h"
+
+#if RAM_ECC_ENABLE
+
+#if RAM_ECC_SCRUB_BYTES % RAM_ECC_WORD_SIZE != 0
+#error RAM_ECC_SCRUB_BYTES must be a multiple of RAM_ECC_WORD_SIZE
+#endif
+
+#define RAM_ECC_REGION_SIZE (HSRAM_SIZE / RAM_ECC_REGIONS)
+
+typedef struct ram_ecc_t
+{
+	uint8_t enabled;
+
+	//written by the interrupt only
+	volatile uint32_t corrected[RAM_ECC_REGIONS];
+	volatile uint32_t uncorrectable[RAM_ECC_REGIONS];
+	volatile uint32_t corrected_total;
+	volatile uint32_t uncorrectable_total;
+	//corrected word for the scrub to write back, 0 for none
+	volatile uint32_t repair;
+	//word being written back, its own read of the bad bit is not counted
+	volatile uint32_t repairing;
+
+	//scrub state, idle task only
+	uint32_t offset;
+	TickType_t tick;
+	uint32_t passes;
+	//counts at the end of the last pass, to log what changed
+	uint32_t reported_corrected[RAM_ECC_REGIONS];
+	uint32_t reported_uncorrectable[RAM_ECC_REGIONS];
+} ram_ecc_t;
+
+static ram_ecc_t ram_ecc;
+
+static uint32_t ErrorRegion(uint32_t erraddr, uint32_t* address)
+{
+	uint32_t offset = erraddr * RAM_ECC_WORD_SIZE;
+	*address = HSRAM_ADDR + offset;
+	uint32_t region = offset / RAM_ECC_REGION_SIZE;
+	return region < RAM_ECC_REGIONS ? region : RAM_ECC_REGIONS - 1;
+}
+
+static void SingleError(const uint32_t erraddr)
+{
+	uint32_t address;
+	uint32_t region = ErrorRegion(erraddr, &address);
+	if( address == ram_ecc.repairing )
+		return;
+
+	ram_ecc.corrected[region]++;
+	ram_ecc.corrected_total++;
+	ram_ecc.repair = address;
+}
+
+static void DualError(const uint32_t erraddr)
+{
+	uint32_t address;
+	uint32_t region = ErrorRegion(erraddr, &address);
+
+	ram_ecc.uncorrectable[region]++;
+	ram_ecc.uncorrectable_total++;
+	//the data is gone, writing it back would only hide that
+	EventLogWrite(EVENT_LOG_RAM_ECC, (uint16_t)region, address);
+	LOG("ram ecc: uncorrectable error at 0x%08lx", address);
+}
+
+void RamEccInit()
+{
+	if( _ramecc_init() != ERR_NONE )
+	{
+		LOG("ram ecc: disabled in the user row");
+		return;
+	}
+	//below everything that has a deadline
+	NVIC_SetPriority(RAMECC_IRQn, IRQ_PRIORITY_RAM_ECC);
+	_ramecc_register_callback(RAMECC_SINGLE_ERROR_CB, SingleError);
+	_ramecc_register_callback(RAMECC_DUAL_ERROR_CB, DualError);
+	ram_ecc.enabled = 1;
+}
+
+#if RAM_ECC_REPAIR
+//Rewrites the corrected 64-bit word, which stores it with new check bits.
+//Nothing else may write the word between the loads and the stores, so the
+//interrupts are masked around them. A DMA write that lands in those few
+//cycles would still be lost.
+static void Repair(uint32_t address)
+{
+	volatile uint32_t* word = (volatile uint32_t*)address;
+
+	ram_ecc.repairing = address;
+	__disable_irq();
+	uint32_t low = word[0];
+	uint32_t high = word[1];
+	word[0] = low;
+	word[1] = high;
+	__DSB();
+	__enable_irq();
+	__ISB();
+	//the interrupt of the load above has run by now
+	ram_ecc.repairing = 0;
+}
+#endif
+
+static void LogPass()
+{
+	for(uint32_t r = 0; r < RAM_ECC_REGIONS; ++r)
+	{
+		uint32_t corrected = ram_ecc.corrected[r];
+		uint32_t uncorrectable = ram_ecc.uncorrectable[r];
+		if( corrected == ram_ecc.reported_corrected[r] && uncorrectable == ram_ecc.reported_uncorrectable[r] )
+			continue;
+
+		LOG("ram ecc: pass %lu region 0x%08lx corrected %lu uncorrectable %lu", ram_ecc.passes,
+			HSRAM_ADDR + r * RAM_ECC_REGION_SIZE, corrected, uncorrectable);
+		ram_ecc.reported_corrected[r] = corrected;
+		ram_ecc.reported_uncorrectable[r] = uncorrectable;
+	}
+}
+
+void RamEccScrub()
+{
+	TickType_t tick = xTaskGetTickCount();
+	if( !ram_ecc.enabled || tick == ram_ecc.tick )
+		return;
+	ram_ecc.tick = tick;
+
+#if RAM_ECC_REPAIR
+	uint32_t repair = ram_ecc.repair;
+	if( repair )
+	{
+		ram_ecc.repair = 0;
+		Repair(repair);
+	}
+#endif
+
+	//only the loads matter, a bad bit raises the interrupt
+	const volatile uint32_t* word = (const volatile uint32_t*)(HSRAM_ADDR + ram_ecc.offset);
+	for(uint32_t i = 0; i < RAM_ECC_SCRUB_BYTES / 4; ++i)
+		(void)word[i];
+
+	ram_ecc.offset += RAM_ECC_SCRUB_BYTES;
+	if( ram_ecc.offset >= HSRAM_SIZE )
+	{
+		ram_ecc.offset = 0;
+		ram_ecc.passes++;
+		LogPass();
+	}
+}
+
+uint32_t RamEccCorrected()
+{
+	return ram_ecc.corrected_total;
+}
+
+uint32_t RamEccUncorrectable()
+{
+	return ram_ecc.uncorrectable_total;
+}
+
+#else
+
+void RamEccInit()
+{
+}
+
+void RamEccScrub()
+{
+}
+
+uint32_t RamEccCorrected()
+{
+	return 0;
+}
+
+uint32_t RamEccUncorrectable()
+{
+	return 0;
+}
+
+#endif
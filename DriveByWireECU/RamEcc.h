@@ -0,0 +1,68 @@
+/*
+ * RamEcc.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef RAMECC_H_
+#define RAMECC_H_
+
+#include <stdint.h>
+
+//RAM ECC error counting and scrubbing.
+//The RAMECC corrects a single bit error in a 64-bit RAM word on every read
+//and detects a double bit error, but it only tells anybody with its
+//interrupt. Its interrupt counts both kinds per region of RAM, so a cell
+//going bad shows up as one region's count climbing long before two bits
+//of the same word flip.
+//
+//An error is only seen when the word is read. The idle hook walks all of
+//RAM, RAM_ECC_SCRUB_BYTES per tick, so words nobody reads are checked
+//too and a bit that flipped is found before a second one in the same
+//word makes it uncorrectable. A corrected word is written back, which
+//stores it with fresh check bits. The slice runs in idle time after
+//everything else and is a few microseconds of loads, the control loop
+//only ever sees it as the idle task it preempts.
+//
+//An uncorrectable error is also recorded as EVENT_LOG_RAM_ECC. The totals
+//go out with the status telemetry (ControlProtocol.h) and the per region
+//counts are logged at the end of every pass that found new errors.
+//
+//Nothing is counted when the ECC is off in the NVM user row (ECCDIS).
+
+//Set to 0 to leave the RAMECC alone
+#ifndef RAM_ECC_ENABLE
+#define RAM_ECC_ENABLE 1
+#endif
+
+//Regions RAM is counted in, equal slices of HSRAM
+#ifndef RAM_ECC_REGIONS
+#define RAM_ECC_REGIONS 8
+#endif
+
+//Bytes the idle hook reads per tick, a multiple of 8. At 512 a pass over
+//the 256KB takes 512 ticks.
+#ifndef RAM_ECC_SCRUB_BYTES
+#define RAM_ECC_SCRUB_BYTES 512
+#endif
+
+//Set to 0 to count corrected errors without writing the word back
+#ifndef RAM_ECC_REPAIR
+#define RAM_ECC_REPAIR 1
+#endif
+
+//Bytes per unit of ERRADDR, the RAMECC reports the 64-bit word
+#define RAM_ECC_WORD_SIZE 8
+
+//Enables the error interrupts. Once, before the scheduler starts.
+void RamEccInit();
+
+//Writes back the last corrected word and reads the next slice of RAM.
+//From the idle hook, later calls in the same tick return at once.
+void RamEccScrub();
+
+//Totals over all regions since boot
+uint32_t RamEccCorrected();
+uint32_t RamEccUncorrectable();
+
+#endif /* RAMECC_H_ */
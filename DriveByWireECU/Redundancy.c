@@ -0,0 +1,259 @@
+/*
+ * Redundancy.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "Redundancy.h"
+#include "FastCode.h"
+
+#if REDUNDANCY_ENABLE
+
+#include "CanBus.h"
+#include "DeltaCodec.h"
+#include "EventLog.h"
+#include "NodeIdentity.h"
+
+//flags, node id, LE16 sequence
+#define REDUNDANCY_HEADER_SIZE 4
+#define REDUNDANCY_FLAG_ACTIVE 0x01
+//the state is coded from zero
+#define REDUNDANCY_FLAG_KEY 0x02
+
+#define REDUNDANCY_NO_PEER 0xFF
+
+#if REDUNDANCY_HEADER_SIZE + DELTA_CODEC_MAX_BYTES(REDUNDANCY_STATE_WORDS) > CAN_BUS_MAX_DATA
+#error redundancy_state_t does not fit a CAN FD frame
+#endif
+
+typedef struct redundancy_t
+{
+	redundancy_role_t role;
+	uint8_t node;
+	can_bus_mailbox_t peer_mailbox;
+	uint32_t cycles;
+
+	//sending
+	uint16_t sequence;
+	uint8_t since_key;
+	delta_codec_t encoder;
+
+	//receiving, the peer as of its newest frame
+	uint8_t peer_node;
+	uint8_t peer_active;
+	uint32_t peer_count;
+	uint16_t peer_sequence;
+	//cycles since the last frame from an active peer
+	uint32_t active_silence;
+	//the decoder follows the active's frames since a key frame
+	uint8_t in_step;
+	uint8_t state_fresh;
+	delta_codec_t decoder;
+	redundancy_state_t state;
+} redundancy_t;
+
+static redundancy_t redundancy;
+
+static void SetRole(redundancy_role_t role)
+{
+	redundancy.role = role;
+	redundancy.since_key = 0;
+	redundancy.in_step = 0;
+	EventLogWrite(EVENT_LOG_REDUNDANCY, role, redundancy.peer_node);
+}
+
+FAST_CODE static void Receive()
+{
+	can_bus_message_t message;
+	redundancy.active_silence++;
+	if( !CanBusRead(redundancy.peer_mailbox, &message) || message.count == redundancy.peer_count )
+		return;
+	redundancy.peer_count = message.count;
+	if( message.len < REDUNDANCY_HEADER_SIZE )
+		return;
+
+	uint8_t flags = message.data[0];
+	uint16_t sequence = message.data[2] | (message.data[3] << 8);
+	//a gap is a frame the mailbox or the bus lost, the deltas after it are
+	//against a state this node never had
+	uint8_t gap = sequence != (uint16_t)(redundancy.peer_sequence + 1);
+	redundancy.peer_node = message.data[1];
+	redundancy.peer_sequence = sequence;
+	redundancy.peer_active = flags & REDUNDANCY_FLAG_ACTIVE;
+	if( !redundancy.peer_active )
+	{
+		redundancy.in_step = 0;
+		return;
+	}
+	redundancy.active_silence = 0;
+
+	if( flags & REDUNDANCY_FLAG_KEY )
+	{
+		DeltaCodecReset(&redundancy.decoder, REDUNDANCY_STATE_WORDS);
+		redundancy.in_step = 1;
+	}
+	else if( gap )
+		redundancy.in_step = 0;
+	if( !redundancy.in_step )
+		return;
+
+	if( DeltaCodecDecode(&redundancy.decoder, &message.data[REDUNDANCY_HEADER_SIZE],
+		message.len - REDUNDANCY_HEADER_SIZE, (uint32_t*)&redundancy.state) == 0 )
+	{
+		redundancy.in_step = 0;
+		return;
+	}
+	redundancy.state_fresh = 1;
+}
+
+FAST_CODE static void PackState(const main_context_t* ctx, redundancy_state_t* state)
+{
+	state->flags = (ctx->autonomous_mode ? REDUNDANCY_STATE_AUTONOMOUS : 0)
+		| (ctx->tele_operation_enabled ? REDUNDANCY_STATE_TELE_OPERATION : 0)
+		| (ctx->park_brake_commanded ? REDUNDANCY_STATE_PARK_BRAKE : 0)
+		| (ctx->reverse_commanded ? REDUNDANCY_STATE_REVERSE_COMMANDED : 0)
+		| (ctx->actuators.reverse ? REDUNDANCY_STATE_REVERSE : 0)
+		| (ctx->actuators.steer_right ? REDUNDANCY_STATE_STEER_RIGHT : 0)
+		| (ctx->actuators.steering_rate_control ? REDUNDANCY_STATE_STEERING_RATE_CONTROL : 0)
+		| (ctx->actuators.safety_light_1 ? REDUNDANCY_STATE_SAFETY_LIGHT_1 : 0);
+	state->speed_integral = ctx->speed_controller.integralCumulation;
+	state->steering_integral = ctx->steering_controller.integralCumulation;
+	state->brake_integral = ctx->brake_controller.integralCumulation;
+	state->vehicle_speed_commanded = ctx->vehicle_speed_commanded;
+	state->steering_angle_commanded = ctx->steering_angle_commanded;
+	state->speed_shaper_rate = ctx->speed_shaper.rate;
+	state->steering_shaper_rate = ctx->steering_shaper.rate;
+	state->acceleration = ctx->actuators.acceleration;
+	state->front_brake = ctx->actuators.front_brake;
+	state->steering_torque = ctx->actuators.steering_torque;
+	state->steering_rate = ctx->actuators.steering_rate;
+}
+
+//The standby's own cycle ran on the same inputs, what it can not have is
+//the history the active's controllers and shapers integrated
+FAST_CODE static void ApplyState(main_context_t* ctx, const redundancy_state_t* state)
+{
+	ctx->autonomous_mode = (state->flags & REDUNDANCY_STATE_AUTONOMOUS) != 0;
+	ctx->tele_operation_enabled = (state->flags & REDUNDANCY_STATE_TELE_OPERATION) != 0;
+	ctx->park_brake_commanded = (state->flags & REDUNDANCY_STATE_PARK_BRAKE) != 0;
+	ctx->reverse_commanded = (state->flags & REDUNDANCY_STATE_REVERSE_COMMANDED) != 0;
+	ctx->speed_controller.integralCumulation = state->speed_integral;
+	ctx->steering_controller.integralCumulation = state->steering_integral;
+	ctx->brake_controller.integralCumulation = state->brake_integral;
+	ctx->vehicle_speed_commanded = state->vehicle_speed_commanded;
+	ctx->steering_angle_commanded = state->steering_angle_commanded;
+	ctx->speed_shaper.value = state->vehicle_speed_commanded;
+	ctx->steering_shaper.value = state->steering_angle_commanded;
+	ctx->speed_shaper.rate = state->speed_shaper_rate;
+	ctx->steering_shaper.rate = state->steering_shaper_rate;
+	ctx->actuators.acceleration = state->acceleration;
+	ctx->actuators.front_brake = state->front_brake;
+	ctx->actuators.steering_torque = state->steering_torque;
+	ctx->actuators.steering_rate = state->steering_rate;
+	ctx->actuators.reverse = (state->flags & REDUNDANCY_STATE_REVERSE) != 0;
+	ctx->actuators.steer_right = (state->flags & REDUNDANCY_STATE_STEER_RIGHT) != 0;
+	ctx->actuators.steering_rate_control = (state->flags & REDUNDANCY_STATE_STEERING_RATE_CONTROL) != 0;
+	ctx->actuators.safety_light_1 = (state->flags & REDUNDANCY_STATE_SAFETY_LIGHT_1) != 0;
+}
+
+FAST_CODE static void Send(const main_context_t* ctx)
+{
+	uint8_t data[CAN_BUS_MAX_DATA];
+	uint8_t len = REDUNDANCY_HEADER_SIZE;
+	uint8_t flags = 0;
+
+	if( redundancy.role == REDUNDANCY_ACTIVE )
+	{
+		flags = REDUNDANCY_FLAG_ACTIVE;
+		if( redundancy.since_key == 0 )
+		{
+			flags |= REDUNDANCY_FLAG_KEY;
+			DeltaCodecReset(&redundancy.encoder, REDUNDANCY_STATE_WORDS);
+		}
+		if( ++redundancy.since_key >= REDUNDANCY_KEY_INTERVAL )
+			redundancy.since_key = 0;
+
+		redundancy_state_t state;
+		PackState(ctx, &state);
+		len += DeltaCodecEncode(&redundancy.encoder, (const uint32_t*)&state, &data[REDUNDANCY_HEADER_SIZE]);
+	}
+
+	redundancy.sequence++;
+	data[0] = flags;
+	data[1] = redundancy.node;
+	data[2] = (uint8_t)redundancy.sequence;
+	data[3] = (uint8_t)(redundancy.sequence >> 8);
+	//a full TX FIFO drops it, to the standby that is a gap
+	CanBusSend(CAN_BUS_REDUNDANCY_ID + (redundancy.node & 1), CAN_FMT_STDID, data, len);
+}
+
+void RedundancyInit()
+{
+	memset(&redundancy, 0, sizeof(redundancy));
+	redundancy.role = REDUNDANCY_LISTENING;
+	redundancy.node = NodeIdentity()->id;
+	redundancy.peer_mailbox = (redundancy.node & 1) ? CAN_BUS_REDUNDANCY_0 : CAN_BUS_REDUNDANCY_1;
+	redundancy.peer_node = REDUNDANCY_NO_PEER;
+}
+
+FAST_CODE void RedundancyCycleEnd(main_context_t* ctx)
+{
+	Receive();
+	uint8_t active_heard = redundancy.peer_active && redundancy.active_silence == 0;
+
+	switch( redundancy.role )
+	{
+	case REDUNDANCY_LISTENING:
+		if( active_heard )
+			SetRole(REDUNDANCY_STANDBY);
+		else if( ++redundancy.cycles >= REDUNDANCY_LISTEN_CYCLES )
+			SetRole(REDUNDANCY_ACTIVE);
+		break;
+	case REDUNDANCY_STANDBY:
+		if( redundancy.active_silence >= REDUNDANCY_TAKEOVER_CYCLES )
+			SetRole(REDUNDANCY_ACTIVE);
+		else if( redundancy.state_fresh )
+			ApplyState(ctx, &redundancy.state);
+		break;
+	case REDUNDANCY_ACTIVE:
+		if( active_heard && redundancy.peer_node < redundancy.node )
+			SetRole(REDUNDANCY_STANDBY);
+		break;
+	}
+	redundancy.state_fresh = 0;
+
+	Send(ctx);
+}
+
+FAST_CODE uint8_t RedundancyActive()
+{
+	return redundancy.role == REDUNDANCY_ACTIVE;
+}
+
+redundancy_role_t RedundancyRole()
+{
+	return redundancy.role;
+}
+
+#else
+
+void RedundancyInit()
+{
+}
+
+void RedundancyCycleEnd(main_context_t* ctx)
+{
+}
+
+uint8_t RedundancyActive()
+{
+	return 1;
+}
+
+redundancy_role_t RedundancyRole()
+{
+	return REDUNDANCY_ACTIVE;
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Redundancy.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef REDUNDANCY_H_
+#define REDUNDANCY_H_
+
+#include <stdint.h>
+#include "main_context.h"
+
+//Hot standby: two ECUs on the same sensors, commands and CAN bus, one
+//driving the actuators and the other ready to take over from where it is.
+//
+//Every control cycle each of the two sends one frame on CAN_0, on
+//CAN_BUS_REDUNDANCY_ID plus the low bit of its node id, so the node ids of
+//a pair have to differ there. The active node's frame carries its control
+//state, redundancy_state_t: the command flags, the integrals of the three
+//controllers, the shaped setpoints and their rates and the actuator
+//outputs, delta coded against the frame before (DeltaCodec.h), with a key
+//frame coded from zero every REDUNDANCY_KEY_INTERVAL. The standby's frame
+//is the header alone, a heartbeat.
+//
+//The standby runs the whole control cycle on its own inputs and commands
+//but commits no actuators, they stay where InitializeDriveByWireIO left
+//them, and the vehicle wiring selects the outputs of the active node.
+//After each cycle it takes over the active's newest state, so it never
+//runs more than a cycle apart. When REDUNDANCY_TAKEOVER_CYCLES go by
+//without a frame from the active it becomes active and commits from the
+//next cycle on, from integrals and outputs that were the active's, so the
+//outputs do not step. A frame lost on the bus puts the standby out of step
+//with the delta coding, it waits for the next key frame.
+//
+//At boot a node listens for REDUNDANCY_LISTEN_CYCLES, goes standby if it
+//hears an active one and active otherwise. Of two actives, two that booted
+//together, the lower node id stays active.
+//
+//The mode is not replicated, each node's follows from the command flags
+//it has from the active and from its own estop input and deadlines. The
+//driving agent has to send its commands to both (NodeIdentity.h), a
+//standby that gets none is in comm timeout when it takes over.
+
+#ifndef REDUNDANCY_ENABLE
+#define REDUNDANCY_ENABLE 0
+#endif
+
+//Cycles without a frame from the active before the standby takes over
+#ifndef REDUNDANCY_TAKEOVER_CYCLES
+#define REDUNDANCY_TAKEOVER_CYCLES 3
+#endif
+
+//Cycles a booting node listens for an active one
+#ifndef REDUNDANCY_LISTEN_CYCLES
+#define REDUNDANCY_LISTEN_CYCLES 20
+#endif
+
+//Frames from one key frame to the next
+#ifndef REDUNDANCY_KEY_INTERVAL
+#define REDUNDANCY_KEY_INTERVAL 10
+#endif
+
+//Also the arg of EVENT_LOG_REDUNDANCY, value: the peer's node id, 0xFF if
+//none was heard
+typedef enum redundancy_role_t
+{
+	REDUNDANCY_LISTENING = 0,
+	REDUNDANCY_STANDBY,
+	REDUNDANCY_ACTIVE,
+} redundancy_role_t;
+
+//What the active replicates, 32-bit words only for DeltaCodec
+typedef struct redundancy_state_t
+{
+	//REDUNDANCY_STATE_*
+	uint32_t flags;
+	int32_t speed_integral;
+	int32_t steering_integral;
+	int32_t brake_integral;
+	float vehicle_speed_commanded;
+	float steering_angle_commanded;
+	float speed_shaper_rate;
+	float steering_shaper_rate;
+	float acceleration;
+	float front_brake;
+	float steering_torque;
+	float steering_rate;
+} redundancy_state_t;
+
+//Words of redundancy_state_t, a number for the frame size check
+#define REDUNDANCY_STATE_WORDS 12
+
+#define REDUNDANCY_STATE_AUTONOMOUS 0x01
+#define REDUNDANCY_STATE_TELE_OPERATION 0x02
+#define REDUNDANCY_STATE_PARK_BRAKE 0x04
+#define REDUNDANCY_STATE_REVERSE_COMMANDED 0x08
+#define REDUNDANCY_STATE_REVERSE 0x10
+#define REDUNDANCY_STATE_STEER_RIGHT 0x20
+#define REDUNDANCY_STATE_STEERING_RATE_CONTROL 0x40
+#define REDUNDANCY_STATE_SAFETY_LIGHT_1 0x80
+
+//Starts listening. Call once at boot, after CanBusInit and NodeIdentityInit.
+void RedundancyInit();
+
+//Receives the peer's frame, settles the role, on the standby takes over
+//the active's state and sends this node's frame. From main_task right
+//after ControlCoreStep.
+void RedundancyCycleEnd(main_context_t* ctx);
+
+//1 while this node drives the actuators, always without REDUNDANCY_ENABLE
+uint8_t RedundancyActive();
+
+redundancy_role_t RedundancyRole();
+
+#endif /* REDUNDANCY_H_ */
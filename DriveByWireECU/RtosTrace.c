@@ -0,0 +1,154 @@
+/*
+ * RtosTrace.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <compiler.h>
+#include "RtosTrace.h"
+#include "FastCode.h"
+#include "Log.h"
+
+#if RTOS_TRACE_ENABLE
+
+#if RTOS_TRACE_DEPTH & (RTOS_TRACE_DEPTH - 1)
+#error RTOS_TRACE_DEPTH must be a power of 2
+#endif
+
+//events written back to back by RtosTraceInit to time one
+#define RTOS_TRACE_CALIBRATION_EVENTS 32
+
+typedef struct rtos_trace_t
+{
+	//events written since recording started, the next goes to
+	//next % RTOS_TRACE_DEPTH. Only changed with the interrupts masked.
+	uint32_t next;
+	uint8_t recording;
+	//dumps holding the ring, recording is off while there are any
+	uint8_t holds;
+	//the oldest event held and how many
+	uint32_t first;
+	uint32_t count;
+	uint32_t event_cycles;
+	rtos_trace_event_t events[RTOS_TRACE_DEPTH];
+} rtos_trace_t;
+
+//events the kernel writes before RtosTraceInit, creating queues, are
+//kept until it starts the ring over
+static rtos_trace_t rtos_trace = { .recording = 1 };
+
+//Called from the kernel's context switch and from interrupts at any
+//priority, the estop's included, so the slot is claimed and filled with
+//every interrupt masked rather than just the kernel's.
+FAST_CODE void RtosTraceWrite(uint8_t type, uint8_t id, uint16_t arg)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if( rtos_trace.recording )
+	{
+		rtos_trace_event_t* event = &rtos_trace.events[rtos_trace.next++ & (RTOS_TRACE_DEPTH - 1)];
+		event->cycles = DWT->CYCCNT;
+		event->type = type;
+		event->id = id;
+		event->arg = arg;
+	}
+	__set_PRIMASK(primask);
+}
+
+FAST_CODE void RtosTraceIsrEnter()
+{
+	RtosTraceWrite(RTOS_TRACE_ISR_ENTER, (uint8_t)(__get_IPSR() - 16), 0);
+}
+
+FAST_CODE void RtosTraceIsrExit()
+{
+	RtosTraceWrite(RTOS_TRACE_ISR_EXIT, (uint8_t)(__get_IPSR() - 16), 0);
+}
+
+void RtosTraceInit()
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t start = DWT->CYCCNT;
+	for(int i = 0; i < RTOS_TRACE_CALIBRATION_EVENTS; ++i)
+		RtosTraceWrite(RTOS_TRACE_TICK, 0, 0);
+	uint32_t cycles = DWT->CYCCNT - start;
+	rtos_trace.event_cycles = (cycles + RTOS_TRACE_CALIBRATION_EVENTS / 2) / RTOS_TRACE_CALIBRATION_EVENTS;
+	rtos_trace.next = 0;
+	__set_PRIMASK(primask);
+
+	LOG("RTOS trace: %lu events, %lu cycles an event", (uint32_t)RTOS_TRACE_DEPTH, rtos_trace.event_cycles);
+}
+
+//Dumps only come from the tcpip thread, holds need no lock against each
+//other, only the writers have to see recording cleared before the ring is
+//read.
+uint32_t RtosTraceHold()
+{
+	if( rtos_trace.holds++ == 0 )
+	{
+		__atomic_store_n(&rtos_trace.recording, 0, __ATOMIC_SEQ_CST);
+		uint32_t next = rtos_trace.next;
+		rtos_trace.count = next < RTOS_TRACE_DEPTH ? next : RTOS_TRACE_DEPTH;
+		rtos_trace.first = next - rtos_trace.count;
+	}
+	return rtos_trace.count;
+}
+
+void RtosTraceRelease()
+{
+	if( rtos_trace.holds == 0 || --rtos_trace.holds != 0 )
+		return;
+	rtos_trace.next = 0;
+	__atomic_store_n(&rtos_trace.recording, 1, __ATOMIC_SEQ_CST);
+}
+
+uint32_t RtosTraceSpan(uint32_t index, const rtos_trace_event_t** first)
+{
+	if( rtos_trace.holds == 0 || index >= rtos_trace.count )
+		return 0;
+	uint32_t slot = (rtos_trace.first + index) & (RTOS_TRACE_DEPTH - 1);
+	uint32_t span = RTOS_TRACE_DEPTH - slot;
+	if( span > rtos_trace.count - index )
+		span = rtos_trace.count - index;
+	*first = &rtos_trace.events[slot];
+	return span;
+}
+
+uint32_t RtosTraceWritten()
+{
+	return __atomic_load_n(&rtos_trace.next, __ATOMIC_RELAXED);
+}
+
+uint32_t RtosTraceEventCycles()
+{
+	return rtos_trace.event_cycles;
+}
+
+#else
+
+uint32_t RtosTraceHold()
+{
+	return 0;
+}
+
+void RtosTraceRelease()
+{
+}
+
+uint32_t RtosTraceSpan(uint32_t index, const rtos_trace_event_t** first)
+{
+	return 0;
+}
+
+uint32_t RtosTraceWritten()
+{
+	return 0;
+}
+
+uint32_t RtosTraceEventCycles()
+{
+	return 0;
+}
+
+#endif
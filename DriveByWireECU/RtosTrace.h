@@ -0,0 +1,111 @@
+/*
+ * RtosTrace.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef RTOSTRACE_H_
+#define RTOSTRACE_H_
+
+#include <stdint.h>
+
+//Timeline of the kernel: context switches, ticks, the interrupts that
+//matter to the control loop and queue traffic, as 8 byte events stamped
+//with the DWT cycle counter in a RAM ring. The kernel's trace macros
+//(FreeRTOSConfig.h) and RTOS_TRACE_ISR_ENTER/EXIT in the GMAC, CAN and
+//estop handlers write them. The steering rate loop's 8 kHz interrupt is
+//left out, it alone would fill the ring in a quarter of a second.
+//
+//The PC pulls the ring over the bulk channel (BulkChannel.h) and
+//PythonTestScripts/rtos_trace.py turns it into a timeline a trace viewer
+//opens. The ring records until a dump holds it, the dump sends the events
+//oldest first straight out of the ring, and recording starts over on an
+//empty ring when the last hold is released.
+//
+//The cycle counter stops while the core sleeps (IdleSleep.h), so cycles
+//alone run slow across idle time. Every tick is an event with the tick
+//count, and the viewer puts each event at its tick plus the cycles since
+//that tick's event.
+//
+//An event costs a call and a few stores with the interrupts masked.
+//RtosTraceInit measures it, it is logged and sent in every dump header.
+
+//Set to 1 to build the trace in. Off, the macros compile to nothing and
+//the ring takes no RAM.
+#ifndef RTOS_TRACE_ENABLE
+#define RTOS_TRACE_ENABLE 0
+#endif
+
+//Events in the ring, a power of 2. At 1 kHz main_task alone is 3 events
+//a tick, the default holds about a second of a quiet ECU.
+#ifndef RTOS_TRACE_DEPTH
+#define RTOS_TRACE_DEPTH 4096
+#endif
+
+typedef enum rtos_trace_type_t
+{
+	//id the task's number (TaskMonitor.h), arg its priority
+	RTOS_TRACE_TASK_IN = 1,
+	//arg 1 if the task is still ready, it was preempted or yielded
+	RTOS_TRACE_TASK_OUT,
+	//arg the low 16 bits of the tick count before the increment
+	RTOS_TRACE_TICK,
+	//id the interrupt number
+	RTOS_TRACE_ISR_ENTER,
+	RTOS_TRACE_ISR_EXIT,
+	//queues, semaphores and mutexes: id the messages waiting before the
+	//call, capped at 255, arg the low 16 bits of the queue's address
+	RTOS_TRACE_QUEUE_SEND,
+	RTOS_TRACE_QUEUE_SEND_FROM_ISR,
+	RTOS_TRACE_QUEUE_RECEIVE,
+	RTOS_TRACE_QUEUE_BLOCK_SEND,
+	RTOS_TRACE_QUEUE_BLOCK_RECEIVE,
+} rtos_trace_type_t;
+
+typedef struct rtos_trace_event_t
+{
+	//DWT cycle count
+	uint32_t cycles;
+	uint8_t type;
+	uint8_t id;
+	uint16_t arg;
+} rtos_trace_event_t;
+
+#if RTOS_TRACE_ENABLE
+//Measures the cost of an event and starts recording on an empty ring.
+//After ProfilerInit, which starts the cycle counter, and before the
+//scheduler starts.
+void RtosTraceInit();
+
+//Adds an event, from any task or interrupt
+void RtosTraceWrite(uint8_t type, uint8_t id, uint16_t arg);
+
+//Called first and last in a traced interrupt handler
+void RtosTraceIsrEnter();
+void RtosTraceIsrExit();
+#define RTOS_TRACE_ISR_ENTER() RtosTraceIsrEnter()
+#define RTOS_TRACE_ISR_EXIT() RtosTraceIsrExit()
+#else
+static inline void RtosTraceInit()
+{
+}
+#define RTOS_TRACE_ISR_ENTER()
+#define RTOS_TRACE_ISR_EXIT()
+#endif
+
+//Stops recording, for a dump. Returns the events held, oldest first, 0
+//without RTOS_TRACE_ENABLE.
+uint32_t RtosTraceHold();
+//Recording starts over once every hold is released
+void RtosTraceRelease();
+//The held events from index on that lie one after another in the ring,
+//up to its wrap or the last event, with *first set to index. 0 past the
+//end.
+uint32_t RtosTraceSpan(uint32_t index, const rtos_trace_event_t** first);
+
+//Events written since recording started, those overwritten included, and
+//the cycles RtosTraceInit measured for one event
+uint32_t RtosTraceWritten();
+uint32_t RtosTraceEventCycles();
+
+#endif /* RTOSTRACE_H_ */
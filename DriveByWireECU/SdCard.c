@@ -0,0 +1,318 @@
+/*
+ * SdCard.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hal_gpio.h>
+#include <hri_sdhc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include "SdCard.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define SD_CARD_SDHC SDHC1
+
+//the core clock is GCLK0, 12 or 120MHz with the clock profile. The card is
+//identified at 400kHz or less and runs at 20MHz or less after that.
+#define SD_CARD_CORE_HZ ((uint32_t)configCPU_CLOCK_HZ)
+#define SD_CARD_IDENTIFY_DIVIDER (SD_CARD_CORE_HZ / (2 * 400000UL) + 1)
+#define SD_CARD_TRANSFER_DIVIDER ((SD_CARD_CORE_HZ + 2 * 20000000UL - 1) / (2 * 20000000UL))
+
+//us a command response may take, far more than any card needs
+#define SD_CARD_COMMAND_TIMEOUT 100000
+//ACMD41 rounds of 1 ms before a card that stays busy is given up on
+#define SD_CARD_POWER_UP_TRIES 1000
+
+//Bytes per ADMA2 descriptor, a multiple of the block size under 64k
+#define SD_CARD_ADMA_SPAN 32768
+#define SD_CARD_ADMA_LINES ((SD_CARD_MAX_WRITE_BLOCKS * SD_CARD_BLOCK_SIZE + SD_CARD_ADMA_SPAN - 1) / SD_CARD_ADMA_SPAN)
+
+//ADMA2 attribute bits: valid, end of table, transfer data
+#define SD_CARD_ADMA_VALID 0x01
+#define SD_CARD_ADMA_END 0x02
+#define SD_CARD_ADMA_TRAN 0x20
+
+typedef struct sd_card_adma_t
+{
+	uint16_t attributes;
+	uint16_t length;
+	uint32_t address;
+} sd_card_adma_t;
+
+//response layouts, the bits the controller gets to check
+typedef enum sd_card_response_t
+{
+	SD_CARD_RESPONSE_NONE = 0,
+	SD_CARD_RESPONSE_R1,
+	SD_CARD_RESPONSE_R1B,
+	SD_CARD_RESPONSE_R2,
+	SD_CARD_RESPONSE_R3,
+} sd_card_response_t;
+
+typedef struct sd_card_t
+{
+	uint32_t blocks;
+	uint16_t rca;
+	//SDHC and SDXC address blocks, standard capacity cards bytes
+	uint8_t block_addressing;
+	sd_card_adma_t adma[SD_CARD_ADMA_LINES];
+} sd_card_t;
+
+COMPILER_ALIGNED(4)
+static sd_card_t sd_card;
+
+static void Delay(uint32_t ms)
+{
+	vTaskDelay(pdMS_TO_TICKS(ms) > 0 ? pdMS_TO_TICKS(ms) : 1);
+}
+
+static void InitPins()
+{
+	static const uint32_t pins[][2] =
+	{
+		{ GPIO(GPIO_PORTA, 20), PINMUX_PA20I_SDHC1_SDCMD },
+		{ GPIO(GPIO_PORTA, 21), PINMUX_PA21I_SDHC1_SDCK },
+		{ GPIO(GPIO_PORTB, 18), PINMUX_PB18I_SDHC1_SDDAT0 },
+		{ GPIO(GPIO_PORTB, 19), PINMUX_PB19I_SDHC1_SDDAT1 },
+		{ GPIO(GPIO_PORTB, 20), PINMUX_PB20I_SDHC1_SDDAT2 },
+		{ GPIO(GPIO_PORTB, 21), PINMUX_PB21I_SDHC1_SDDAT3 },
+	};
+	for(uint32_t i = 0; i < sizeof(pins) / sizeof(pins[0]); ++i)
+	{
+		//the card drives CMD and DAT open drain while it is identified
+		if( i != 1 )
+			gpio_set_pin_pull_mode(pins[i][0], GPIO_PULL_UP);
+		gpio_set_pin_function(pins[i][0], pins[i][1]);
+	}
+}
+
+static void SetClock(uint16_t divider)
+{
+	hri_sdhc_clear_CCR_reg(SD_CARD_SDHC, SDHC_CCR_SDCLKEN);
+	hri_sdhc_write_CCR_reg(SD_CARD_SDHC, SDHC_CCR_INTCLKEN | SDHC_CCR_SDCLKFSEL(divider & 0xFF) | SDHC_CCR_USDCLKFSEL(divider >> 8));
+	while( !(hri_sdhc_read_CCR_reg(SD_CARD_SDHC) & SDHC_CCR_INTCLKS) )
+		;
+	hri_sdhc_set_CCR_reg(SD_CARD_SDHC, SDHC_CCR_SDCLKEN);
+}
+
+//Waits for the command to complete, or for a transfer when SDHC_NISTR_TRFC
+//is in done. Clears what it waited for either way.
+static uint8_t WaitFor(uint16_t done, uint32_t timeout_us, uint8_t sleep)
+{
+	TickType_t start = xTaskGetTickCount();
+	uint32_t spins = 0;
+	while(1)
+	{
+		uint16_t status = hri_sdhc_read_NISTR_reg(SD_CARD_SDHC);
+		if( status & SDHC_NISTR_ERRINT )
+		{
+			hri_sdhc_write_EISTR_reg(SD_CARD_SDHC, hri_sdhc_read_EISTR_reg(SD_CARD_SDHC));
+			hri_sdhc_write_NISTR_reg(SD_CARD_SDHC, status);
+			//the command and data lines start over for the next command
+			hri_sdhc_write_SRR_reg(SD_CARD_SDHC, SDHC_SRR_SWRSTCMD | SDHC_SRR_SWRSTDAT);
+			while( hri_sdhc_read_SRR_reg(SD_CARD_SDHC) )
+				;
+			return 0;
+		}
+		if( (status & done) == done )
+		{
+			hri_sdhc_write_NISTR_reg(SD_CARD_SDHC, done);
+			return 1;
+		}
+		if( sleep )
+		{
+			if( xTaskGetTickCount() - start > pdMS_TO_TICKS(timeout_us / 1000) )
+				return 0;
+			Delay(1);
+		}
+		else if( ++spins > timeout_us * (SD_CARD_CORE_HZ / 1000000) / 16 )
+			return 0;
+	}
+}
+
+static uint8_t Command(uint8_t index, uint32_t argument, sd_card_response_t response, uint16_t data)
+{
+	uint32_t inhibit = SDHC_PSR_CMDINHC;
+	if( data || response == SD_CARD_RESPONSE_R1B )
+		inhibit |= SDHC_PSR_CMDINHD;
+	while( hri_sdhc_read_PSR_reg(SD_CARD_SDHC) & inhibit )
+		;
+
+	uint16_t command = SDHC_CR_CMDIDX(index);
+	switch(response)
+	{
+	case SD_CARD_RESPONSE_NONE:
+		command |= SDHC_CR_RESPTYP_NONE;
+		break;
+	case SD_CARD_RESPONSE_R1:
+		command |= SDHC_CR_RESPTYP_48_BIT | SDHC_CR_CMDCCEN | SDHC_CR_CMDICEN;
+		break;
+	case SD_CARD_RESPONSE_R1B:
+		command |= SDHC_CR_RESPTYP_48_BIT_BUSY | SDHC_CR_CMDCCEN | SDHC_CR_CMDICEN;
+		break;
+	case SD_CARD_RESPONSE_R2:
+		command |= SDHC_CR_RESPTYP_136_BIT | SDHC_CR_CMDCCEN;
+		break;
+	case SD_CARD_RESPONSE_R3:
+		command |= SDHC_CR_RESPTYP_48_BIT;
+		break;
+	}
+	if( data )
+		command |= SDHC_CR_DPSEL;
+
+	hri_sdhc_write_ARG1R_reg(SD_CARD_SDHC, argument);
+	hri_sdhc_write_CR_reg(SD_CARD_SDHC, command);
+	if( !WaitFor(SDHC_NISTR_CMDC, SD_CARD_COMMAND_TIMEOUT, 0) )
+		return 0;
+	//the card signals busy on DAT0 until it is done
+	if( response == SD_CARD_RESPONSE_R1B )
+		return WaitFor(SDHC_NISTR_TRFC, SD_CARD_TIMEOUT * 1000, 1);
+	return 1;
+}
+
+static uint8_t AppCommand(uint8_t index, uint32_t argument, sd_card_response_t response)
+{
+	return Command(55, (uint32_t)sd_card.rca << 16, SD_CARD_RESPONSE_R1, 0) && Command(index, argument, response, 0);
+}
+
+//CSD version 1 or 2, as the controller has it without the CRC byte
+static uint32_t CapacityBlocks()
+{
+	uint32_t csd[4];
+	for(int i = 0; i < 4; ++i)
+		csd[i] = hri_sdhc_read_RR_reg(SD_CARD_SDHC, i);
+
+	if( (csd[3] >> 22) & 0x3 )
+	{
+		//version 2: C_SIZE in CSD bits 69:48, units of 512k
+		uint32_t c_size = (csd[1] >> 8) & 0x3FFFFF;
+		return (c_size + 1) * 1024;
+	}
+	//version 1: C_SIZE 73:62, C_SIZE_MULT 49:47, READ_BL_LEN 83:80
+	uint32_t c_size = ((csd[2] & 0x3) << 10) | (csd[1] >> 22);
+	uint32_t mult = (csd[1] >> 7) & 0x7;
+	uint32_t read_bl_len = (csd[2] >> 8) & 0xF;
+	return (c_size + 1) << (mult + 2 + read_bl_len - 9);
+}
+
+uint8_t SdCardInit()
+{
+	sd_card.blocks = 0;
+	sd_card.rca = 0;
+
+	hri_mclk_set_AHBMASK_SDHC1_bit(MCLK);
+	hri_gclk_write_PCHCTRL_reg(GCLK, SDHC1_GCLK_ID, GCLK_PCHCTRL_GEN_GCLK0 | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	//only times out the card, the PWM clock will do
+	hri_gclk_write_PCHCTRL_reg(GCLK, SDHC1_GCLK_ID_SLOW, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	InitPins();
+
+	hri_sdhc_write_SRR_reg(SD_CARD_SDHC, SDHC_SRR_SWRSTALL);
+	while( hri_sdhc_read_SRR_reg(SD_CARD_SDHC) & SDHC_SRR_SWRSTALL )
+		;
+	hri_sdhc_write_PCR_reg(SD_CARD_SDHC, SDHC_PCR_SDBVSEL_3V3 | SDHC_PCR_SDBPWR);
+	hri_sdhc_write_TCR_reg(SD_CARD_SDHC, SDHC_TCR_DTCVAL(0xE));
+	//status bits only, nothing interrupts
+	hri_sdhc_write_NISTER_reg(SD_CARD_SDHC, 0xFFFF);
+	hri_sdhc_write_EISTER_reg(SD_CARD_SDHC, 0xFFFF);
+	SetClock(SD_CARD_IDENTIFY_DIVIDER);
+	//74 clocks before the first command
+	Delay(1);
+
+	if( !Command(0, 0, SD_CARD_RESPONSE_NONE, 0) )
+		return 0;
+	//a version 1 card does not answer CMD8, and only has byte addresses
+	uint8_t version_2 = Command(8, 0x1AA, SD_CARD_RESPONSE_R1, 0) && (hri_sdhc_read_RR_reg(SD_CARD_SDHC, 0) & 0xFFF) == 0x1AA;
+
+	uint32_t ocr = 0;
+	for(int tries = 0; !(ocr & (1UL << 31)); ++tries)
+	{
+		if( tries == SD_CARD_POWER_UP_TRIES )
+			return 0;
+		//3.2 to 3.4V, and high capacity if the card has it
+		if( !AppCommand(41, (version_2 ? (1UL << 30) : 0) | 0x00300000, SD_CARD_RESPONSE_R3) )
+			return 0;
+		ocr = hri_sdhc_read_RR_reg(SD_CARD_SDHC, 0);
+		if( !(ocr & (1UL << 31)) )
+			Delay(1);
+	}
+	sd_card.block_addressing = (ocr >> 30) & 1;
+
+	if( !Command(2, 0, SD_CARD_RESPONSE_R2, 0) || !Command(3, 0, SD_CARD_RESPONSE_R1, 0) )
+		return 0;
+	sd_card.rca = hri_sdhc_read_RR_reg(SD_CARD_SDHC, 0) >> 16;
+	if( !Command(9, (uint32_t)sd_card.rca << 16, SD_CARD_RESPONSE_R2, 0) )
+		return 0;
+	uint32_t blocks = CapacityBlocks();
+
+	if( !Command(7, (uint32_t)sd_card.rca << 16, SD_CARD_RESPONSE_R1B, 0)
+		|| !AppCommand(6, 2, SD_CARD_RESPONSE_R1)
+		|| !Command(16, SD_CARD_BLOCK_SIZE, SD_CARD_RESPONSE_R1, 0) )
+		return 0;
+	hri_sdhc_write_HC1R_reg(SD_CARD_SDHC, SDHC_HC1R_DW_4BIT | SDHC_HC1R_DMASEL_32BIT);
+	SetClock(SD_CARD_TRANSFER_DIVIDER);
+
+	sd_card.blocks = blocks;
+	return 1;
+}
+
+uint32_t SdCardBlocks()
+{
+	return sd_card.blocks;
+}
+
+static uint32_t Address(uint32_t block)
+{
+	return sd_card.block_addressing ? block : block * SD_CARD_BLOCK_SIZE;
+}
+
+uint8_t SdCardRead(uint32_t block, uint8_t* data)
+{
+	if( sd_card.blocks == 0 || block >= sd_card.blocks )
+		return 0;
+
+	hri_sdhc_write_BSR_reg(SD_CARD_SDHC, SDHC_BSR_BLKSIZE(SD_CARD_BLOCK_SIZE));
+	hri_sdhc_write_BCR_reg(SD_CARD_SDHC, 1);
+	hri_sdhc_write_TMR_reg(SD_CARD_SDHC, SDHC_TMR_DTDSEL_READ);
+	if( !Command(17, Address(block), SD_CARD_RESPONSE_R1, 1)
+		|| !WaitFor(SDHC_NISTR_BRDRDY, SD_CARD_TIMEOUT * 1000, 1) )
+		return 0;
+
+	uint32_t* words = (uint32_t*)data;
+	for(int i = 0; i < SD_CARD_BLOCK_SIZE / 4; ++i)
+		words[i] = hri_sdhc_read_BDPR_reg(SD_CARD_SDHC);
+	return WaitFor(SDHC_NISTR_TRFC, SD_CARD_TIMEOUT * 1000, 1);
+}
+
+uint8_t SdCardWrite(uint32_t block, const uint8_t* data, uint16_t count)
+{
+	if( sd_card.blocks == 0 || count == 0 || count > SD_CARD_MAX_WRITE_BLOCKS || block + count > sd_card.blocks )
+		return 0;
+
+	uint32_t remaining = (uint32_t)count * SD_CARD_BLOCK_SIZE;
+	uint32_t address = (uint32_t)data;
+	int line = 0;
+	while( remaining )
+	{
+		uint32_t length = remaining > SD_CARD_ADMA_SPAN ? SD_CARD_ADMA_SPAN : remaining;
+		remaining -= length;
+		sd_card.adma[line].attributes = SD_CARD_ADMA_VALID | SD_CARD_ADMA_TRAN | (remaining ? 0 : SD_CARD_ADMA_END);
+		sd_card.adma[line].length = (uint16_t)length;
+		sd_card.adma[line].address = address;
+		address += length;
+		++line;
+	}
+
+	hri_sdhc_write_ASAR_reg(SD_CARD_SDHC, 0, (uint32_t)sd_card.adma);
+	hri_sdhc_write_BSR_reg(SD_CARD_SDHC, SDHC_BSR_BLKSIZE(SD_CARD_BLOCK_SIZE));
+	hri_sdhc_write_BCR_reg(SD_CARD_SDHC, count);
+	hri_sdhc_write_TMR_reg(SD_CARD_SDHC, SDHC_TMR_DMAEN | SDHC_TMR_BCEN | SDHC_TMR_ACMDEN_CMD12
+		| SDHC_TMR_DTDSEL_WRITE | (count > 1 ? SDHC_TMR_MSBSEL : 0));
+	if( !Command(count > 1 ? 25 : 24, Address(block), SD_CARD_RESPONSE_R1, 1) )
+		return 0;
+	//the card programming the data shows as busy, done is after that
+	return WaitFor(SDHC_NISTR_TRFC, SD_CARD_TIMEOUT * 1000, 1);
+}
@@ -0,0 +1,46 @@
+/*
+ * SdCard.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SDCARD_H_
+#define SDCARD_H_
+
+#include <stdint.h>
+
+//Raw block access to an SD card on SDHC1, 4 bit bus at up to 20MHz, for
+//SdLogger.h. SDHC, SDXC and standard capacity cards, 512 byte blocks.
+//
+//	PA20 SDCMD, PA21 SDCK, PB18 to PB21 SDDAT0 to SDDAT3
+//
+//Writes go through the SDHC's own ADMA2 engine as one multi-block write
+//with automatic CMD12, the DMAC is not involved. Everything blocks the
+//calling task: commands are polled, most take a few us, and a transfer
+//waits in vTaskDelay steps. Only ever call from one task.
+
+#define SD_CARD_BLOCK_SIZE 512
+
+//Blocks in one SdCardWrite, bounded by the ADMA2 descriptor table
+#define SD_CARD_MAX_WRITE_BLOCKS 128
+
+//ms a transfer may take, cards stall writes for 250 ms at worst
+#ifndef SD_CARD_TIMEOUT
+#define SD_CARD_TIMEOUT 500
+#endif
+
+//Powers the card up and identifies it, non-zero once it can be read and
+//written. Can be called again after a failure or a card change.
+uint8_t SdCardInit();
+
+//Card size in blocks, 0 before SdCardInit succeeded
+uint32_t SdCardBlocks();
+
+//One block into data, 4 byte aligned. Non-zero on success.
+uint8_t SdCardRead(uint32_t block, uint8_t* data);
+
+//count blocks from data, 4 byte aligned and left alone until the call
+//returns, starting at block. Non-zero once the card has taken them all.
+uint8_t SdCardWrite(uint32_t block, const uint8_t* data, uint16_t count);
+
+#endif /* SDCARD_H_ */
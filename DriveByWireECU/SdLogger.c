@@ -0,0 +1,250 @@
+/*
+ * SdLogger.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "SdLogger.h"
+#include "SdCard.h"
+#include "DeltaCodec.h"
+#include "FastCode.h"
+#include "Log.h"
+#include "TimeBase.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "task_config.h"
+
+#if SD_LOGGER_ENABLE
+
+#if SD_LOGGER_CHUNK_SIZE % SD_CARD_BLOCK_SIZE != 0 || SD_LOGGER_CHUNK_BLOCKS > SD_CARD_MAX_WRITE_BLOCKS
+#error SD_LOGGER_CHUNK_SIZE must be whole blocks, at most SD_CARD_MAX_WRITE_BLOCKS of them
+#endif
+#if SD_LOGGER_CHUNK_SIZE & (SD_LOGGER_CHUNK_SIZE - 1)
+#error SD_LOGGER_CHUNK_SIZE must be a power of two, a flat log block
+#endif
+
+#if CONTROL_RECORD_ENABLE
+#define SD_LOGGER_RECORD_TYPE control_record_t
+#define SD_LOGGER_RECORD_WORDS CONTROL_RECORD_WORDS
+#define SD_LOGGER_SCHEMA FLAT_LOG_SCHEMA_CONTROL_RECORD
+#else
+#define SD_LOGGER_RECORD_TYPE sd_log_record_t
+#define SD_LOGGER_RECORD_WORDS SD_LOG_RECORD_WORDS
+#define SD_LOGGER_SCHEMA FLAT_LOG_SCHEMA_SD_RECORD
+#endif
+
+#if SD_LOGGER_PACK
+//room a record may need
+#define SD_LOGGER_RECORD_ROOM DELTA_CODEC_MAX_BYTES(SD_LOGGER_RECORD_WORDS)
+#else
+#define SD_LOGGER_RECORD_ROOM sizeof(SD_LOGGER_RECORD_TYPE)
+#endif
+
+//s between tries to bring up a card that is missing or failed
+#define SD_LOGGER_RETRY_PERIOD 5
+
+typedef enum sd_logger_buffer_state_t
+{
+	//main_task's, being filled or waiting to be
+	SD_LOGGER_FILLING = 0,
+	//the log task's until it is written
+	SD_LOGGER_FULL,
+} sd_logger_buffer_state_t;
+
+typedef struct sd_logger_buffer_t
+{
+	flat_log_block_t header;
+	//the records, then zeroes to the end of the chunk
+	uint8_t data[SD_LOGGER_CHUNK_DATA];
+} sd_logger_buffer_t;
+
+typedef struct sd_logger_t
+{
+	sd_logger_buffer_t buffers[2];
+	uint8_t state[2];
+	//main_task's: the buffer it fills, and records it could not keep
+	uint8_t filling;
+	uint32_t dropped;
+#if SD_LOGGER_PACK
+	delta_codec_t codec;
+#endif
+	//the log task's
+	uint8_t ready;
+	uint32_t session;
+	uint32_t next_chunk;
+	uint32_t chunks;
+	uint32_t written;
+	uint32_t failures;
+	uint8_t scratch[SD_CARD_BLOCK_SIZE];
+} sd_logger_t;
+
+COMPILER_ALIGNED(4)
+static sd_logger_t sd_logger;
+
+static uint32_t ChunkBlock(uint32_t chunk)
+{
+	return SD_LOGGER_FIRST_BLOCK + chunk * SD_LOGGER_CHUNK_BLOCKS;
+}
+
+//The header of chunk if it is one of ours, in scratch
+static const flat_log_block_t* ReadChunk(uint32_t chunk)
+{
+	if( !SdCardRead(ChunkBlock(chunk), sd_logger.scratch) )
+		return NULL;
+	const flat_log_block_t* header = (const flat_log_block_t*)sd_logger.scratch;
+	return FlatLogHeaderValid(header, SD_LOGGER_CHUNK_SIZE, chunk) ? header : NULL;
+}
+
+//Chunks are appended in order, so the valid ones are a prefix of the log
+//and the end is found in log2(chunks) reads
+static uint8_t FindEnd()
+{
+	uint32_t blocks = SdCardBlocks();
+	if( blocks <= SD_LOGGER_FIRST_BLOCK + SD_LOGGER_CHUNK_BLOCKS )
+		return 0;
+	sd_logger.chunks = (blocks - SD_LOGGER_FIRST_BLOCK) / SD_LOGGER_CHUNK_BLOCKS;
+
+	uint32_t low = 0;
+	uint32_t high = sd_logger.chunks;
+	while( low < high )
+	{
+		uint32_t middle = low + (high - low) / 2;
+		if( ReadChunk(middle) != NULL )
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	sd_logger.next_chunk = low;
+
+	sd_logger.session = 1;
+	if( low > 0 )
+	{
+		const flat_log_block_t* last = ReadChunk(low - 1);
+		if( last != NULL )
+			sd_logger.session = last->session + 1;
+	}
+	return 1;
+}
+
+static uint8_t BringUp()
+{
+	if( !SdCardInit() || !FindEnd() )
+		return 0;
+	LOG("SD log: session %lu from chunk %lu of %lu", sd_logger.session, sd_logger.next_chunk, sd_logger.chunks);
+	return 1;
+}
+
+static void SdLoggerTask(void* p)
+{
+	while( !BringUp() )
+		vTaskDelay(pdMS_TO_TICKS(SD_LOGGER_RETRY_PERIOD * 1000));
+	//main_task starts filling from here on
+	__atomic_store_n(&sd_logger.ready, 1, __ATOMIC_RELEASE);
+
+	uint8_t next = 0;
+	while(1)
+	{
+		if( __atomic_load_n(&sd_logger.state[next], __ATOMIC_ACQUIRE) != SD_LOGGER_FULL )
+		{
+			vTaskDelay(pdMS_TO_TICKS(SD_LOGGER_POLL_PERIOD));
+			continue;
+		}
+
+		sd_logger_buffer_t* buffer = &sd_logger.buffers[next];
+		if( sd_logger.next_chunk < sd_logger.chunks )
+		{
+			FlatLogSeal(&buffer->header, sd_logger.session, sd_logger.next_chunk);
+			if( SdCardWrite(ChunkBlock(sd_logger.next_chunk), (const uint8_t*)buffer, SD_LOGGER_CHUNK_BLOCKS) )
+			{
+				sd_logger.next_chunk++;
+				sd_logger.written++;
+			}
+			else if( sd_logger.failures++ == 0 )
+				LOG("SD log: write of chunk %lu failed", sd_logger.next_chunk);
+			if( sd_logger.next_chunk == sd_logger.chunks )
+				LOG("SD log: card full after %lu chunks", sd_logger.written);
+		}
+
+		//back to main_task empty, written or not. Sealing zeroed the rest.
+		buffer->header.count = 0;
+		__atomic_store_n(&sd_logger.state[next], SD_LOGGER_FILLING, __ATOMIC_RELEASE);
+		next ^= 1;
+	}
+}
+
+void SdLoggerStart()
+{
+	memset(&sd_logger, 0, sizeof(sd_logger));
+	xTaskCreate(SdLoggerTask, "SdLog", TASK_STACK_SD_LOGGER, NULL, TASK_PRIORITY_SD_LOGGER, NULL);
+}
+
+FAST_CODE void SdLoggerRecord(const main_context_t* ctx)
+{
+#if !CONTROL_RECORD_ENABLE
+	if( !__atomic_load_n(&sd_logger.ready, __ATOMIC_ACQUIRE) )
+		return;
+#endif
+
+	uint8_t filling = sd_logger.filling;
+	if( __atomic_load_n(&sd_logger.state[filling], __ATOMIC_ACQUIRE) != SD_LOGGER_FILLING )
+	{
+		sd_logger.dropped++;
+		return;
+	}
+
+	sd_logger_buffer_t* buffer = &sd_logger.buffers[filling];
+	if( buffer->header.count == 0 )
+	{
+		FlatLogBegin(&buffer->header, SD_LOGGER_CHUNK_SIZE, SD_LOGGER_SCHEMA,
+			SD_LOGGER_PACK ? 0 : sizeof(SD_LOGGER_RECORD_TYPE), sd_logger.dropped);
+#if SD_LOGGER_PACK
+		DeltaCodecReset(&sd_logger.codec, SD_LOGGER_RECORD_WORDS);
+#endif
+	}
+
+#if CONTROL_RECORD_ENABLE
+	//filled by the cycle itself
+	const void* data = &ctx->record;
+#else
+	sd_log_record_t record = { 0 };
+	record.cycle = ctx->scheduler.cycle_count;
+	record.input_time = ctx->input_time;
+	record.vehicle_speed = ctx->vehicle_speed;
+	record.steering_angle = ctx->steering_angle;
+	record.vehicle_speed_commanded = ctx->vehicle_speed_commanded;
+	record.steering_angle_commanded = ctx->steering_angle_commanded;
+	record.acceleration = ctx->actuators.acceleration;
+	record.front_brake = ctx->actuators.front_brake;
+	record.steering_torque = ctx->actuators.steering_torque;
+	record.flags = (ctx->estop_in ? 0x01 : 0) | (ctx->autonomous_mode ? 0x02 : 0) | (ctx->tele_operation_enabled ? 0x04 : 0)
+		| (ctx->actuators.reverse ? 0x08 : 0) | (ctx->actuators.steer_right ? 0x10 : 0);
+	const void* data = &record;
+#endif
+
+	uint8_t* end = FlatLogEnd(&buffer->header);
+#if SD_LOGGER_PACK
+	FlatLogAppend(&buffer->header, TimeBaseUs(), DeltaCodecEncode(&sd_logger.codec, (const uint32_t*)data, end));
+#else
+	memcpy(end, data, sizeof(SD_LOGGER_RECORD_TYPE));
+	FlatLogAppend(&buffer->header, TimeBaseUs(), sizeof(SD_LOGGER_RECORD_TYPE));
+#endif
+
+	if( FlatLogRoom(&buffer->header) < SD_LOGGER_RECORD_ROOM )
+	{
+		__atomic_store_n(&sd_logger.state[filling], SD_LOGGER_FULL, __ATOMIC_RELEASE);
+		sd_logger.filling = filling ^ 1;
+	}
+}
+
+#else
+
+void SdLoggerStart()
+{
+}
+
+void SdLoggerRecord(const main_context_t* ctx)
+{
+}
+
+#endif
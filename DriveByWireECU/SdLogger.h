@@ -0,0 +1,97 @@
+/*
+ * SdLogger.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SDLOGGER_H_
+#define SDLOGGER_H_
+
+#include <stdint.h>
+#include "main_context.h"
+#include "FlatLog.h"
+
+//Every control cycle, on an SD card (SdCard.h), for runs the network does
+//not see all of or drops out of.
+//
+//main_task adds one sd_log_record_t per cycle to one of two
+//SD_LOGGER_CHUNK_SIZE buffers, a copy of a few dozen bytes, or with
+//SD_LOGGER_PACK the record packed by DeltaCodec.h, and nothing else. When a buffer is full the log task writes it out as one multi-block
+//write while main_task fills the other one. If the card is still busy
+//with the first when the second is full, records are dropped and counted
+//until a buffer is free again, main_task never waits on the card.
+//
+//The card is a raw flat log (FlatLog.h), no file system: chunk n is block
+//n of the log, SD_LOGGER_CHUNK_SIZE bytes at card block
+//SD_LOGGER_FIRST_BLOCK + n * SD_LOGGER_CHUNK_BLOCKS. Chunks are only ever
+//appended: at boot the log task finds the first chunk without a valid
+//header and goes on from there in a new session, so a card holds every
+//run since it was erased until it is full. Records are stamped with the
+//time base's us (TimeBase.h). At 1 kHz that is about
+//150MB an hour unpacked, packed a quarter of that or less while the cart
+//holds still. A reset loses the buffer being filled, at most one chunk.
+//PythonTestScripts/sd_log_dump.py reads a card image.
+//
+//With CONTROL_RECORD_ENABLE the records are the control core's
+//control_record_t instead (ControlRecord.h), in chunks of
+//FLAT_LOG_SCHEMA_CONTROL_RECORD for host/ControlReplay, and main_task fills the
+//buffers from the first cycle on, before the card is up: a replay starts
+//from ControlCoreInit, the two buffers hold the cycles a card takes.
+//
+//Needs SD_LOGGER_ENABLE and a card wired to SDHC1. The card must be blank
+//or erased from SD_LOGGER_FIRST_BLOCK on before its first run.
+
+#ifndef SD_LOGGER_ENABLE
+#define SD_LOGGER_ENABLE 0
+#endif
+
+//4MB in, past a partition table and whatever a PC puts at the start
+#ifndef SD_LOGGER_FIRST_BLOCK
+#define SD_LOGGER_FIRST_BLOCK 8192
+#endif
+
+//A multiple of the block size, and at most SD_CARD_MAX_WRITE_BLOCKS. Half a
+//second of records at the default. Two of these live in RAM.
+#ifndef SD_LOGGER_CHUNK_SIZE
+#define SD_LOGGER_CHUNK_SIZE 16384
+#endif
+#define SD_LOGGER_CHUNK_BLOCKS (SD_LOGGER_CHUNK_SIZE / 512)
+
+//Packs every record against the one before. The codec starts over with
+//every chunk, so each chunk still reads on its own.
+#ifndef SD_LOGGER_PACK
+#define SD_LOGGER_PACK 1
+#endif
+
+//ms between the log task's looks at the buffers, a chunk takes 400 at 1 kHz
+#define SD_LOGGER_POLL_PERIOD 20
+
+//One control cycle, little endian as in RAM
+typedef struct sd_log_record_t
+{
+	uint32_t cycle;
+	//PTP us of the inputs, 0 while not synced
+	uint32_t input_time;
+	float vehicle_speed;
+	float steering_angle;
+	float vehicle_speed_commanded;
+	float steering_angle_commanded;
+	float acceleration;
+	float front_brake;
+	float steering_torque;
+	//bit 0 estop, 1 autonomous, 2 tele operation, 3 reverse, 4 steer right
+	uint8_t flags;
+	uint8_t reserved[3];
+} sd_log_record_t;
+
+#define SD_LOG_RECORD_WORDS (sizeof(sd_log_record_t) / 4)
+
+#define SD_LOGGER_CHUNK_DATA FLAT_LOG_DATA_SIZE(SD_LOGGER_CHUNK_SIZE)
+
+//Creates the log task, which brings the card up. Before the scheduler starts.
+void SdLoggerStart();
+
+//From main_task, once per cycle after ControlCoreStep
+void SdLoggerRecord(const main_context_t* ctx);
+
+#endif /* SDLOGGER_H_ */
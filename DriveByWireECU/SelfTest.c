@@ -0,0 +1,168 @@
+/*
+ * SelfTest.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "SelfTest.h"
+#include "Service.h"
+#include "DriveByWireIO.h"
+#include "AdcSampler.h"
+#include "CanBus.h"
+#include "EStopInput.h"
+#include "EventLog.h"
+#include "SignalBus.h"
+#include "Log.h"
+
+#if SELF_TEST_ENABLE
+
+static const char* const self_test_names[] = { "estop", "pwm", "adc", "link", "can" };
+
+static struct
+{
+	service_t estop;
+	service_t pwm;
+	service_t adc;
+	service_t link;
+	service_t can;
+	//SELF_TEST_* finished, and those of them that failed
+	uint8_t done;
+	uint8_t failed;
+	//set by their events
+	volatile uint8_t link_up;
+	volatile uint8_t can_echo;
+} self_test;
+
+//ms to the end of the budget, 0 once it is over
+static uint32_t Remaining()
+{
+	TickType_t budget = pdMS_TO_TICKS(SELF_TEST_BUDGET);
+	TickType_t now = xTaskGetTickCount();
+	return now < budget ? (budget - now) * portTICK_PERIOD_MS : 0;
+}
+
+static uint32_t AtMost(uint32_t ms)
+{
+	uint32_t remaining = Remaining();
+	return ms < remaining ? ms : remaining;
+}
+
+static void Finish(uint8_t test, uint8_t passed)
+{
+	//the services share one task, nothing else writes these
+	self_test.done |= test;
+	if( !passed )
+		self_test.failed |= test;
+	if( self_test.done != SELF_TEST_ALL )
+		return;
+
+	uint32_t ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+	for(uint32_t i = 0; i < sizeof(self_test_names) / sizeof(self_test_names[0]); ++i)
+	{
+		if( self_test.failed & (1 << i) )
+			LOG("Self test: %s failed", self_test_names[i]);
+	}
+	LOG("Self test %s in %lu ms", self_test.failed ? "failed" : "passed", ms);
+	EventLogWrite(EVENT_LOG_SELF_TEST, self_test.failed, ms);
+	SignalPublishUint(SIGNAL_SELF_TEST_PASSED, SELF_TEST_ALL & ~self_test.failed);
+	SignalPublishUint(SIGNAL_SELF_TEST_FAILED, self_test.failed);
+}
+
+//A press at power up stays latched until the control loop sees the loop
+//closed again
+static service_result_t EStopTest(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	while( EStopInputLatched() && Remaining() > 0 )
+		SERVICE_DELAY(service, AtMost(SELF_TEST_ESTOP_POLL));
+	Finish(SELF_TEST_ESTOP, !EStopInputLatched());
+	SERVICE_END(service);
+}
+
+static service_result_t PwmTest(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	uint32_t failed = CheckPWMOutputs();
+	if( failed )
+		LOG("Self test: PWM outputs 0x%lx do not read back", failed);
+	Finish(SELF_TEST_PWM, failed == 0);
+	SERVICE_END(service);
+}
+
+static uint8_t Inside(uint32_t value, uint32_t low, uint32_t high)
+{
+	return value >= low && value <= high;
+}
+
+//The scan fills its history within microseconds of AdcSamplerInit, long
+//before the scheduler starts
+static service_result_t AdcTest(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	uint8_t passed = Inside(AdcSamplerRead(ADC_SAMPLER_STEERING_POSITION), ADC_SAMPLER_STEERING_WINDOW_LOW,
+		ADC_SAMPLER_STEERING_WINDOW_HIGH);
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+	passed &= Inside(AdcSamplerRead(ADC_SAMPLER_BRAKE_PRESSURE) + SELF_TEST_BRAKE_MARGIN, ADC_SAMPLER_BRAKE_ZERO,
+		ADC_SAMPLER_BRAKE_FULL + 2 * SELF_TEST_BRAKE_MARGIN);
+#endif
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+	float volts = AdcSamplerReadFine(ADC_SAMPLER_SUPPLY) * (ADC_SAMPLER_SUPPLY_FULL_SCALE_VOLTS / ADC_SAMPLER_FINE_FULL_SCALE);
+	passed &= volts >= SELF_TEST_SUPPLY_LOW && volts <= SELF_TEST_SUPPLY_HIGH;
+#endif
+	Finish(SELF_TEST_ADC, passed);
+	SERVICE_END(service);
+}
+
+static service_result_t LinkTest(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	//a link from before the wait ends it at once
+	if( Remaining() > 0 )
+		SERVICE_WAIT_SIGNAL(service, Remaining());
+	Finish(SELF_TEST_LINK, self_test.link_up);
+	SERVICE_END(service);
+}
+
+//CAN interrupt
+static void OnEcho(uint8_t intact)
+{
+	self_test.can_echo = intact;
+	ServiceSignalFromIsr(&self_test.can);
+}
+
+static service_result_t CanTest(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	if( CanBusLoopbackBegin(OnEcho) )
+		SERVICE_WAIT_SIGNAL(service, AtMost(SELF_TEST_CAN_TIMEOUT));
+	CanBusLoopbackEnd();
+	Finish(SELF_TEST_CAN, self_test.can_echo);
+	SERVICE_END(service);
+}
+
+void SelfTestStart()
+{
+	ServiceAdd(&self_test.estop, "SelfTestEStop", EStopTest);
+	ServiceAdd(&self_test.pwm, "SelfTestPwm", PwmTest);
+	ServiceAdd(&self_test.adc, "SelfTestAdc", AdcTest);
+	ServiceAdd(&self_test.link, "SelfTestLink", LinkTest);
+	ServiceAdd(&self_test.can, "SelfTestCan", CanTest);
+}
+
+void SelfTestLinkUp()
+{
+	self_test.link_up = 1;
+	ServiceSignal(&self_test.link);
+}
+
+#else
+
+void SelfTestStart()
+{
+}
+
+void SelfTestLinkUp()
+{
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * SelfTest.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SELFTEST_H_
+#define SELFTEST_H_
+
+#include <stdint.h>
+
+//Power-on self test of the hardware the control loop depends on:
+//
+//	estop	the estop loop reads closed, a press at power up has to be let
+//			go within the budget
+//	pwm		every PWM timer runs and reads back the period and duty last
+//			written (CheckPWMOutputs, DriveByWireIO.h)
+//	adc		the steering potentiometer reads inside its safe window, the
+//			brake pressure and the supply voltage inside their ranges where
+//			they are scanned
+//	link	the PHY reports the Ethernet link (PhyMonitor.h)
+//	can		the CAN controller receives back a frame it sends in internal
+//			loopback (CanBusLoopbackBegin, CanBus.h)
+//
+//Every test is a service (Service.h), they run side by side on the
+//service task while the control loop and the network come up, nothing in
+//the boot waits on them. A test that waits on hardware waits on its event,
+//the link up or the loopback frame's interrupt, and every wait ends at
+//SELF_TEST_BUDGET ms after the scheduler started at the latest, a test its
+//event has not come for by then fails. The last test to finish writes the
+//report: an EVENT_LOG_SELF_TEST entry, a LOG line per test that failed and
+//the SIGNAL_SELF_TEST_* signals, which telemetry subscribes to.
+//
+//The tests only look, none drives an actuator. The CAN test takes the
+//controller off the bus for a frame time or two.
+
+#ifndef SELF_TEST_ENABLE
+#define SELF_TEST_ENABLE 1
+#endif
+
+//ms after the scheduler starts by which every test has ended. The link
+//takes the longest, autonegotiation alone is a second or two.
+#ifndef SELF_TEST_BUDGET
+#define SELF_TEST_BUDGET 5000
+#endif
+
+//ms between looks at the estop loop while it reads open
+#define SELF_TEST_ESTOP_POLL 10
+//ms the loopback frame takes at most, a frame time is well below 1 ms
+#define SELF_TEST_CAN_TIMEOUT 5
+//V either side the supply may read, as far as the compensation reaches
+//(DriveByWireIO.h)
+#define SELF_TEST_SUPPLY_LOW (SUPPLY_NOMINAL_VOLTS / SUPPLY_GAIN_MAX)
+#define SELF_TEST_SUPPLY_HIGH (SUPPLY_NOMINAL_VOLTS / SUPPLY_GAIN_MIN)
+//12 bit codes the brake pressure may read beyond its zero and full pressure
+#define SELF_TEST_BRAKE_MARGIN 200
+
+//Bits of the tests, the arg of EVENT_LOG_SELF_TEST
+#define SELF_TEST_ESTOP 0x01
+#define SELF_TEST_PWM 0x02
+#define SELF_TEST_ADC 0x04
+#define SELF_TEST_LINK 0x08
+#define SELF_TEST_CAN 0x10
+#define SELF_TEST_ALL 0x1F
+
+//Adds the tests' services. Before ServiceStart, after InitializeDriveByWireIO.
+void SelfTestStart();
+
+//The PHY reported the first link, from the tcpip thread
+void SelfTestLinkUp();
+
+#endif /* SELFTEST_H_ */
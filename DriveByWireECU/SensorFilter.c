@@ -0,0 +1,275 @@
+/*
+ * SensorFilter.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <math.h>
+#include <string.h>
+#include "SensorFilter.h"
+#include "FastCode.h"
+
+#if defined(__ARM_FEATURE_SAT) || defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+#if SENSOR_FILTER_SIMD && defined(__ARM_FEATURE_DSP)
+#define SENSOR_FILTER_USE_SIMD 1
+#else
+#define SENSOR_FILTER_USE_SIMD 0
+#endif
+
+//iterations of the covariance recursion at init, far more than it takes to converge
+#define KALMAN_GAIN_ITERATIONS 20000
+
+//one SSAT on the M4
+static inline int16_t SaturateQ15(int32_t value)
+{
+#if defined(__ARM_FEATURE_SAT)
+	return (int16_t)__ssat(value, 16);
+#else
+	if( value > INT16_MAX )
+		return INT16_MAX;
+	if( value < INT16_MIN )
+		return INT16_MIN;
+	return (int16_t)value;
+#endif
+}
+
+//one SMULL and a shift
+static inline int32_t MulQ31(int32_t a, int32_t b)
+{
+	return (int32_t)(((int64_t)a * b) >> 31);
+}
+
+#if SENSOR_FILTER_USE_SIMD
+//two adjacent halfwords as one word, low half first. An unaligned LDR on the M4.
+static inline int16x2_t LoadPair(const int16_t* pair)
+{
+	int16x2_t packed;
+	memcpy(&packed, pair, sizeof(packed));
+	return packed;
+}
+#endif
+
+static int16_t ToQ14(float value)
+{
+	float scaled = roundf(value * 16384.0f);
+	if( scaled > INT16_MAX )
+		return INT16_MAX;
+	if( scaled < INT16_MIN )
+		return INT16_MIN;
+	return (int16_t)scaled;
+}
+
+static int32_t ToQ31(float value)
+{
+	if( value >= 1.0f )
+		return INT32_MAX;
+	if( value <= 0.0f )
+		return 0;
+	return (int32_t)(value * 2147483648.0f);
+}
+
+void BiquadInitLowpass(biquad_q15_t* biquad, float cutoff, float sample_rate)
+{
+	//RBJ cookbook low pass, Q of 1/sqrt(2)
+	float w0 = 2.0f * (float)M_PI * cutoff / sample_rate;
+	float cosw0 = cosf(w0);
+	float alpha = sinf(w0) / (2.0f * 0.70710678f);
+	float a0 = 1.0f + alpha;
+
+	biquad->coefficients[0] = ToQ14((1.0f - cosw0) / 2.0f / a0);
+	biquad->coefficients[1] = ToQ14((1.0f - cosw0) / a0);
+	biquad->coefficients[2] = biquad->coefficients[0];
+	biquad->coefficients[3] = ToQ14(2.0f * cosw0 / a0);
+	biquad->coefficients[4] = ToQ14(-(1.0f - alpha) / a0);
+	BiquadReset(biquad, 0);
+}
+
+void BiquadReset(biquad_q15_t* biquad, int16_t value)
+{
+	biquad->x1 = value;
+	biquad->x2 = value;
+	biquad->y1 = value;
+	biquad->y2 = value;
+}
+
+FAST_CODE int16_t BiquadStep(biquad_q15_t* biquad, int16_t x)
+{
+	const int16_t* c = biquad->coefficients;
+
+	//Q15 * Q14 products summed in 64 bits, so no intermediate sum can
+	//overflow whatever the coefficients
+#if SENSOR_FILTER_USE_SIMD
+	int64_t acc = (int64_t)c[0] * x;
+	acc = __smlald(LoadPair(&c[1]), LoadPair(&biquad->x1), acc);
+	acc = __smlald(LoadPair(&c[3]), LoadPair(&biquad->y1), acc);
+#else
+	int64_t acc = (int64_t)c[0] * x;
+	acc += (int64_t)c[1] * biquad->x1;
+	acc += (int64_t)c[2] * biquad->x2;
+	acc += (int64_t)c[3] * biquad->y1;
+	acc += (int64_t)c[4] * biquad->y2;
+#endif
+
+	int16_t y = SaturateQ15((int32_t)(acc >> 14));
+	biquad->x2 = biquad->x1;
+	biquad->x1 = x;
+	biquad->y2 = biquad->y1;
+	biquad->y1 = y;
+	return y;
+}
+
+void MedianFilterInit(median_filter_t* median, uint8_t window, int16_t value)
+{
+	if( window > MEDIAN_FILTER_MAX_WINDOW )
+		window = MEDIAN_FILTER_MAX_WINDOW;
+	if( window < 1 )
+		window = 1;
+	window |= 1;
+
+	median->window = window;
+	median->next = 0;
+	for(int i = 0; i < MEDIAN_FILTER_MAX_WINDOW; ++i)
+	{
+		median->history[i] = value;
+		median->sorted[i] = value;
+	}
+}
+
+FAST_CODE int16_t MedianFilterStep(median_filter_t* median, int16_t x)
+{
+	int16_t oldest = median->history[median->next];
+	median->history[median->next] = x;
+	if( ++median->next == median->window )
+		median->next = 0;
+
+	//The oldest sample's slot takes x, moved along until the order holds again
+	int i = 0;
+	while( median->sorted[i] != oldest )
+		++i;
+	while( i > 0 && median->sorted[i - 1] > x )
+	{
+		median->sorted[i] = median->sorted[i - 1];
+		--i;
+	}
+	while( i < median->window - 1 && median->sorted[i + 1] < x )
+	{
+		median->sorted[i] = median->sorted[i + 1];
+		++i;
+	}
+	median->sorted[i] = x;
+
+	return median->sorted[median->window / 2];
+}
+
+void Kalman1Init(kalman1_t* kalman, float accel_noise, float measurement_noise, float dt)
+{
+	float q = accel_noise * dt * accel_noise * dt;
+	float r = measurement_noise * measurement_noise;
+	float p = r;
+	float k = 0.0f;
+
+	for(int n = 0; n < KALMAN_GAIN_ITERATIONS; ++n)
+	{
+		p += q;
+		k = p / (p + r);
+		p *= 1.0f - k;
+	}
+
+	kalman->gain = ToQ31(k);
+	kalman->dt = ToQ31(dt);
+	Kalman1Reset(kalman, 0);
+}
+
+void Kalman1Reset(kalman1_t* kalman, int32_t speed)
+{
+	kalman->speed = speed;
+}
+
+FAST_CODE int32_t Kalman1Step(kalman1_t* kalman, int32_t measured, int32_t accel)
+{
+	int32_t predicted = kalman->speed + MulQ31(accel, kalman->dt);
+	kalman->speed = predicted + MulQ31(measured - predicted, kalman->gain);
+	return kalman->speed;
+}
+
+void Kalman2Init(kalman2_t* kalman, float accel_noise, float bias_drift, float measurement_noise, float dt)
+{
+	float qv = accel_noise * dt * accel_noise * dt;
+	float qb = bias_drift * dt * bias_drift * dt;
+	float r = measurement_noise * measurement_noise;
+	//covariance of speed and bias, p01 == p10
+	float p00 = r;
+	float p01 = 0.0f;
+	float p11 = r;
+	float k0 = 0.0f;
+	float k1 = 0.0f;
+
+	for(int n = 0; n < KALMAN_GAIN_ITERATIONS; ++n)
+	{
+		//predict, F = [1 dt; 0 1]
+		p00 += dt * (2.0f * p01 + dt * p11) + qv;
+		p01 += dt * p11;
+		p11 += qb;
+
+		//correct with the speed, H = [1 0]
+		float s = p00 + r;
+		k0 = p00 / s;
+		k1 = p01 / s;
+		p11 -= k1 * p01;
+		p01 -= k0 * p01;
+		p00 -= k0 * p00;
+	}
+
+	kalman->speed_gain = ToQ31(k0);
+	kalman->bias_gain = ToQ31(k1);
+	kalman->dt = ToQ31(dt);
+	Kalman2Reset(kalman, 0);
+}
+
+void Kalman2Reset(kalman2_t* kalman, int32_t speed)
+{
+	kalman->speed = speed;
+	kalman->bias = 0;
+}
+
+FAST_CODE int32_t Kalman2Step(kalman2_t* kalman, int32_t measured, int32_t accel)
+{
+	int32_t predicted = kalman->speed + MulQ31(accel + kalman->bias, kalman->dt);
+	int32_t innovation = measured - predicted;
+	kalman->speed = predicted + MulQ31(innovation, kalman->speed_gain);
+	kalman->bias += MulQ31(innovation, kalman->bias_gain);
+	return kalman->speed;
+}
+
+void FusionInit(fusion_t* fusion, float increment_noise, float measurement_noise)
+{
+	float q = increment_noise * increment_noise;
+	float r = measurement_noise * measurement_noise;
+	float p = r;
+	float k = 0.0f;
+
+	for(int n = 0; n < KALMAN_GAIN_ITERATIONS; ++n)
+	{
+		p += q;
+		k = p / (p + r);
+		p *= 1.0f - k;
+	}
+
+	fusion->gain = ToQ31(k);
+	FusionReset(fusion, 0);
+}
+
+void FusionReset(fusion_t* fusion, int32_t position)
+{
+	fusion->position = position;
+}
+
+FAST_CODE int32_t FusionStep(fusion_t* fusion, int32_t measured, int32_t increment)
+{
+	int32_t predicted = fusion->position + increment;
+	fusion->position = predicted + MulQ31(measured - predicted, fusion->gain);
+	return fusion->position;
+}
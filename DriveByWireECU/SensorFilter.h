@@ -0,0 +1,137 @@
+/*
+ * SensorFilter.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SENSORFILTER_H_
+#define SENSORFILTER_H_
+
+#include <stdint.h>
+
+//Fixed cost filters for the sensor inputs, integer only per sample.
+//Whatever needs floating point (coefficient design, Kalman gains) is done
+//once at init. FilterBenchmark.h measures what each costs per sample.
+//
+//Q15 is a fraction in int16_t (1.0 is 32768), Q31 in int32_t, and Q16 a
+//value with 16 fraction bits in int32_t, +-32767.
+
+//Set to 0 to build the kernels as plain C on a core with the DSP extension.
+//Otherwise the biquad takes its products two at a time with SMLALD.
+#ifndef SENSOR_FILTER_SIMD
+#define SENSOR_FILTER_SIMD 1
+#endif
+
+#define FILTER_Q15(x) ((int16_t)((x) * 32768.0f))
+#define FILTER_Q16(x) ((int32_t)((x) * 65536.0f))
+#define FILTER_Q16_TO_FLOAT(q) ((float)(q) * (1.0f / 65536.0f))
+
+//Direct form I biquad on Q15 samples.
+//The coefficients are Q14 so they reach +-2, a low pass needs that for a1.
+//Below about fs / 200 the Q14 coefficients get too coarse for the response
+//to hold, cascade a decimator first for anything that slow.
+//The layout is what the dual MAC wants: b1, b2 pair with x1, x2 and -a1, -a2
+//with y1, y2, each pair one word load.
+typedef struct biquad_q15_t
+{
+	//b0, b1, b2, -a1, -a2
+	int16_t coefficients[5];
+	int16_t x1;
+	int16_t x2;
+	int16_t y1;
+	int16_t y2;
+} biquad_q15_t;
+
+//Second order Butterworth low pass, cutoff and sample_rate in Hz. Starts at 0.
+void BiquadInitLowpass(biquad_q15_t* biquad, float cutoff, float sample_rate);
+
+//Settles the filter on value, as if it had been in forever
+void BiquadReset(biquad_q15_t* biquad, int16_t value);
+
+int16_t BiquadStep(biquad_q15_t* biquad, int16_t x);
+
+//Median of the last window samples, which rejects single spikes without the
+//lag a low pass would need to. The window is kept sorted, a sample costs
+//two passes over it.
+#define MEDIAN_FILTER_MAX_WINDOW 9
+
+typedef struct median_filter_t
+{
+	int16_t history[MEDIAN_FILTER_MAX_WINDOW];
+	int16_t sorted[MEDIAN_FILTER_MAX_WINDOW];
+	uint8_t window;
+	uint8_t next;
+} median_filter_t;
+
+//window is odd and from 1 to MEDIAN_FILTER_MAX_WINDOW, it is forced to be.
+//Starts full of value.
+void MedianFilterInit(median_filter_t* median, uint8_t window, int16_t value);
+
+int16_t MedianFilterStep(median_filter_t* median, int16_t x);
+
+//Steady state Kalman filters for a speed measured once per step, with the
+//commanded acceleration as the control input.
+//The model is time invariant, so the gains converge to constants. They are
+//found at init by running the covariance recursion to its fixed point,
+//and a step is only the prediction and the fixed gain correction in fixed
+//point, no division and no covariance to carry.
+//Speeds are Q16 m/s, accelerations Q16 m/s^2, the gains Q31.
+//
+//Kalman1: the speed integrates the commanded acceleration, anything else
+//the speed does is process noise.
+//Kalman2: adds an acceleration bias, what the cart does beyond the command
+//(grade, drag, a slow throttle), which is estimated rather than treated as
+//noise. The speed it gives then does not lag a ramp.
+typedef struct kalman1_t
+{
+	int32_t speed;
+	int32_t gain;
+	int32_t dt;
+} kalman1_t;
+
+typedef struct kalman2_t
+{
+	int32_t speed;
+	int32_t bias;
+	int32_t speed_gain;
+	int32_t bias_gain;
+	int32_t dt;
+} kalman2_t;
+
+//accel_noise: m/s^2 std of what the acceleration does beyond the command.
+//measurement_noise: m/s std of the measured speed. dt in s.
+void Kalman1Init(kalman1_t* kalman, float accel_noise, float measurement_noise, float dt);
+//measured and accel as above, returns the estimated speed
+int32_t Kalman1Step(kalman1_t* kalman, int32_t measured, int32_t accel);
+
+//bias_drift: m/s^3 std of how fast the acceleration bias changes
+void Kalman2Init(kalman2_t* kalman, float accel_noise, float bias_drift, float measurement_noise, float dt);
+int32_t Kalman2Step(kalman2_t* kalman, int32_t measured, int32_t accel);
+
+//Restart from speed with no bias, before the estimate is trusted again
+void Kalman1Reset(kalman1_t* kalman, int32_t speed);
+void Kalman2Reset(kalman2_t* kalman, int32_t speed);
+
+//Steady state Kalman filter of a position measured two ways, absolute but
+//noisy, and as an increment per step that is precise but only relative,
+//like a potentiometer and an encoder on the same shaft. The increments
+//carry the position from step to step, the absolute measurement pulls it
+//back with the fixed gain: a complementary filter, with the crossover the
+//Kalman gain puts where the two noises meet. What the increments get wrong
+//(a missed count, a scale that is a little off) decays by the gain every
+//step instead of adding up. Positions and increments are Q16, the gain Q31.
+typedef struct fusion_t
+{
+	int32_t position;
+	int32_t gain;
+} fusion_t;
+
+//increment_noise: std of the error of one increment, measurement_noise:
+//std of the absolute measurement, both in the units of the position
+void FusionInit(fusion_t* fusion, float increment_noise, float measurement_noise);
+//measured and increment as above, returns the estimated position
+int32_t FusionStep(fusion_t* fusion, int32_t measured, int32_t increment);
+//Restart at position, the first absolute measurement for one
+void FusionReset(fusion_t* fusion, int32_t position);
+
+#endif /* SENSORFILTER_H_ */
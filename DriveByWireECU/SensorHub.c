@@ -0,0 +1,277 @@
+/*
+ * SensorHub.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "SensorHub.h"
+
+#if SENSOR_HUB_ENABLE
+
+#include <hal_gpio.h>
+#include <hri_sercom_e54.h>
+#include <hri_gclk_e54.h>
+#include <hri_mclk_e54.h>
+#include <irq_config.h>
+#include <peripheral_clk_config.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Service.h"
+#include "SignalBus.h"
+#include "TimeBase.h"
+#include "Log.h"
+
+#define SENSOR_HUB_SERCOM SERCOM7
+//12MHz, like the other SERCOMs
+#define SENSOR_HUB_GCLK_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define SENSOR_HUB_GCLK_HZ 12000000
+//SCL is GCLK / (10 + 2 * BAUD) with the rise time left out
+#define SENSOR_HUB_BAUD (SENSOR_HUB_GCLK_HZ / (2 * SENSOR_HUB_I2C_HZ) - 5)
+
+#if SENSOR_HUB_BAUD < 1 || SENSOR_HUB_BAUD > 255
+#error SENSOR_HUB_I2C_HZ is out of the SERCOM's range
+#endif
+
+//CTRLB CMD
+#define I2C_CMD_READ 2
+#define I2C_CMD_STOP 3
+//STATUS BUSSTATE
+#define I2C_BUS_IDLE 1
+
+//TMP102 temperature, 12 bits left aligned, 1/16 degC
+#define TMP102_TEMPERATURE 0x00
+#define TMP102_DEGC_PER_LSB 0.0625f
+//INA226 shunt voltage, signed, 2.5 uV, and bus voltage, 1.25 mV. It
+//powers up converting both continuously.
+#define INA226_SHUNT_VOLTAGE 0x01
+#define INA226_BUS_VOLTAGE 0x02
+#define INA226_SHUNT_V_PER_LSB 2.5e-6f
+#define INA226_BUS_V_PER_LSB 1.25e-3f
+
+typedef struct sensor_hub_read_t
+{
+	uint8_t address;
+	uint8_t reg;
+	//from the big endian register
+	float scale;
+	uint8_t is_signed;
+	//the 12 bit temperature sits in the top of the register
+	uint8_t shift;
+	signal_id_t value;
+	signal_id_t time;
+} sensor_hub_read_t;
+
+//The round robin, a read per slot
+static const sensor_hub_read_t sensor_hub_reads[] =
+{
+	{ SENSOR_HUB_CURRENT_ADDRESS, INA226_SHUNT_VOLTAGE, INA226_SHUNT_V_PER_LSB / SENSOR_HUB_SHUNT_OHMS, 1, 0,
+		SIGNAL_MOTOR_CURRENT, SIGNAL_MOTOR_CURRENT_TIME },
+	{ SENSOR_HUB_MOTOR_TEMP_ADDRESS, TMP102_TEMPERATURE, TMP102_DEGC_PER_LSB, 1, 4,
+		SIGNAL_MOTOR_TEMPERATURE, SIGNAL_MOTOR_TEMPERATURE_TIME },
+	{ SENSOR_HUB_CURRENT_ADDRESS, INA226_BUS_VOLTAGE, INA226_BUS_V_PER_LSB, 0, 0,
+		SIGNAL_MOTOR_VOLTAGE, SIGNAL_MOTOR_VOLTAGE_TIME },
+	{ SENSOR_HUB_BOARD_TEMP_ADDRESS, TMP102_TEMPERATURE, TMP102_DEGC_PER_LSB, 1, 4,
+		SIGNAL_BOARD_TEMPERATURE, SIGNAL_BOARD_TEMPERATURE_TIME },
+};
+
+#define SENSOR_HUB_READS (sizeof(sensor_hub_reads) / sizeof(sensor_hub_reads[0]))
+
+typedef enum sensor_hub_state_t
+{
+	SENSOR_HUB_IDLE = 0,
+	//the address and the register pointer going out
+	SENSOR_HUB_WRITING,
+	SENSOR_HUB_POINTER,
+	//the two bytes coming in
+	SENSOR_HUB_READING,
+	SENSOR_HUB_DONE,
+	SENSOR_HUB_FAILED
+} sensor_hub_state_t;
+
+typedef struct sensor_hub_t
+{
+	service_t service;
+	uint8_t next;
+	uint32_t errors;
+
+	//the read running, interrupt side
+	const sensor_hub_read_t* read;
+	volatile uint8_t state;
+	uint8_t received;
+	uint8_t data[2];
+	uint32_t time;
+} sensor_hub_t;
+
+static sensor_hub_t hub;
+
+static void Finish(uint8_t state)
+{
+	hri_sercomi2cm_clear_INTEN_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_INTENSET_MASK);
+	hub.state = state;
+	ServiceSignalFromIsr(&hub.service);
+}
+
+static void Stop(uint8_t state)
+{
+	hri_sercomi2cm_write_CTRLB_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_CTRLB_CMD(I2C_CMD_STOP));
+	Finish(state);
+}
+
+//Every interrupt of the SERCOM: master on bus after a byte went out,
+//slave on bus after one came in, or an error
+static void SensorHubInterrupt()
+{
+	uint8_t flags = hri_sercomi2cm_read_INTFLAG_reg(SENSOR_HUB_SERCOM);
+	uint16_t status = hri_sercomi2cm_read_STATUS_reg(SENSOR_HUB_SERCOM);
+
+	if( (flags & SERCOM_I2CM_INTFLAG_ERROR) || (status & (SERCOM_I2CM_STATUS_BUSERR | SERCOM_I2CM_STATUS_ARBLOST)) )
+	{
+		hri_sercomi2cm_clear_INTFLAG_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_INTFLAG_MASK);
+		Finish(SENSOR_HUB_FAILED);
+		return;
+	}
+
+	if( flags & SERCOM_I2CM_INTFLAG_MB )
+	{
+		if( status & SERCOM_I2CM_STATUS_RXNACK )
+		{
+			Stop(SENSOR_HUB_FAILED);
+		}
+		else if( hub.state == SENSOR_HUB_WRITING )
+		{
+			hub.state = SENSOR_HUB_POINTER;
+			hri_sercomi2cm_write_DATA_reg(SENSOR_HUB_SERCOM, hub.read->reg);
+		}
+		else
+		{
+			//repeated start for the read, a slave on bus comes next
+			hub.state = SENSOR_HUB_READING;
+			hri_sercomi2cm_write_ADDR_reg(SENSOR_HUB_SERCOM, (hub.read->address << 1) | 1);
+		}
+		return;
+	}
+
+	if( flags & SERCOM_I2CM_INTFLAG_SB )
+	{
+		if( hub.received + 1 < sizeof(hub.data) )
+		{
+			//ack and read on
+			hub.data[hub.received++] = hri_sercomi2cm_read_DATA_reg(SENSOR_HUB_SERCOM);
+			hri_sercomi2cm_write_CTRLB_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_CTRLB_CMD(I2C_CMD_READ));
+		}
+		else
+		{
+			//nack the last byte and stop before DATA is read, which would
+			//clock in another
+			hri_sercomi2cm_write_CTRLB_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_CTRLB_ACKACT | SERCOM_I2CM_CTRLB_CMD(I2C_CMD_STOP));
+			hub.data[hub.received++] = hri_sercomi2cm_read_DATA_reg(SENSOR_HUB_SERCOM);
+			hub.time = (uint32_t)TimeBaseUs();
+			Finish(SENSOR_HUB_DONE);
+		}
+	}
+}
+
+void SERCOM7_0_Handler()
+{
+	SensorHubInterrupt();
+}
+
+void SERCOM7_1_Handler()
+{
+	SensorHubInterrupt();
+}
+
+void SERCOM7_3_Handler()
+{
+	SensorHubInterrupt();
+}
+
+static void InitI2c()
+{
+	hri_sercomi2cm_write_CTRLA_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_CTRLA_SWRST);
+	//master, SDA held 300-600 ns after SCL falls, a slave holding SCL low
+	//over 25 ms ends the transfer with an error
+	hri_sercomi2cm_write_CTRLA_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_CTRLA_MODE(5) | SERCOM_I2CM_CTRLA_SDAHOLD(2)
+		| SERCOM_I2CM_CTRLA_LOWTOUTEN);
+	hri_sercomi2cm_write_CTRLB_reg(SENSOR_HUB_SERCOM, 0);
+	hri_sercomi2cm_write_BAUD_reg(SENSOR_HUB_SERCOM, SENSOR_HUB_BAUD);
+	hri_sercomi2cm_set_CTRLA_ENABLE_bit(SENSOR_HUB_SERCOM);
+	//the bus state is unknown after enabling, nobody else is on it
+	hri_sercomi2cm_write_STATUS_BUSSTATE_bf(SENSOR_HUB_SERCOM, I2C_BUS_IDLE);
+}
+
+static void StartRead(const sensor_hub_read_t* read)
+{
+	hub.read = read;
+	hub.received = 0;
+	hub.state = SENSOR_HUB_WRITING;
+	hri_sercomi2cm_clear_INTFLAG_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_INTFLAG_MASK);
+	hri_sercomi2cm_set_INTEN_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_INTENSET_MB | SERCOM_I2CM_INTENSET_SB
+		| SERCOM_I2CM_INTENSET_ERROR);
+	hri_sercomi2cm_write_ADDR_reg(SENSOR_HUB_SERCOM, read->address << 1);
+}
+
+static void Publish(const sensor_hub_read_t* read)
+{
+	uint16_t raw = ((uint16_t)hub.data[0] << 8) | hub.data[1];
+	float value = read->is_signed ? (float)((int16_t)raw >> read->shift) : (float)(raw >> read->shift);
+	SignalPublishFloat(read->value, value * read->scale);
+	SignalPublishUint(read->time, hub.time);
+}
+
+static service_result_t SensorHubService(service_t* service)
+{
+	SERVICE_BEGIN(service);
+	while(1)
+	{
+		StartRead(&sensor_hub_reads[hub.next]);
+		SERVICE_WAIT_SIGNAL(service, SENSOR_HUB_TIMEOUT);
+
+		if( hub.state == SENSOR_HUB_DONE )
+		{
+			Publish(hub.read);
+		}
+		else
+		{
+			//a read that failed or never finished can leave the SERCOM mid
+			//transfer
+			hri_sercomi2cm_clear_INTEN_reg(SENSOR_HUB_SERCOM, SERCOM_I2CM_INTENSET_MASK);
+			InitI2c();
+			hub.errors++;
+			SignalPublishUint(SIGNAL_SENSOR_HUB_ERRORS, hub.errors);
+		}
+
+		hub.next = (hub.next + 1) % SENSOR_HUB_READS;
+		SERVICE_DELAY(service, SENSOR_HUB_SLOT);
+	}
+	SERVICE_END(service);
+}
+
+void SensorHubStart()
+{
+	gpio_set_pin_function(GPIO(GPIO_PORTD, 8), PINMUX_PD08C_SERCOM7_PAD0);
+	gpio_set_pin_function(GPIO(GPIO_PORTD, 9), PINMUX_PD09C_SERCOM7_PAD1);
+
+	hri_gclk_write_PCHCTRL_reg(GCLK, SERCOM7_GCLK_ID_CORE, SENSOR_HUB_GCLK_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	//the slow clock times SCL held low, the console's 32 kHz
+	hri_gclk_write_PCHCTRL_reg(GCLK, SERCOM7_GCLK_ID_SLOW, CONF_GCLK_SERCOM2_SLOW_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	hri_mclk_set_APBDMASK_SERCOM7_bit(MCLK);
+	InitI2c();
+
+	NVIC_SetPriority(SERCOM7_0_IRQn, IRQ_PRIORITY_SENSOR_HUB);
+	NVIC_SetPriority(SERCOM7_1_IRQn, IRQ_PRIORITY_SENSOR_HUB);
+	NVIC_SetPriority(SERCOM7_3_IRQn, IRQ_PRIORITY_SENSOR_HUB);
+	NVIC_EnableIRQ(SERCOM7_0_IRQn);
+	NVIC_EnableIRQ(SERCOM7_1_IRQn);
+	NVIC_EnableIRQ(SERCOM7_3_IRQn);
+	ServiceAdd(&hub.service, "SensorHub", SensorHubService);
+	LOG("sensor hub: %u reads every %u ms", (unsigned)SENSOR_HUB_READS, (unsigned)(SENSOR_HUB_READS * SENSOR_HUB_SLOT));
+}
+
+#else
+
+void SensorHubStart()
+{
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * SensorHub.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SENSORHUB_H_
+#define SENSORHUB_H_
+
+#include <stdint.h>
+
+//Slow auxiliary sensors on I2C, read in the background into the signal
+//bus (SignalBus.h):
+//
+//	board temperature	TMP102 at SENSOR_HUB_BOARD_TEMP_ADDRESS
+//	motor temperature	TMP102 at SENSOR_HUB_MOTOR_TEMP_ADDRESS, on the
+//						motor's case
+//	motor current		INA226 at SENSOR_HUB_CURRENT_ADDRESS across
+//						SENSOR_HUB_SHUNT_OHMS in the motor supply, its
+//						current and bus voltage
+//
+//A service (Service.h) walks a round robin of register reads, one every
+//SENSOR_HUB_SLOT ms. A read is a pointer write and a repeated start read
+//of two bytes, run by the SERCOM's interrupts at the lowest priority, a
+//few us of handler per byte. The service starts it and waits on its
+//signal, so no task ever waits for the bus, and a device that holds SCL
+//low only times out the service. The values are published with the time
+//base us (TimeBase.h) the last byte came in at, as a *_TIME signal after
+//its value: a reader that sees a new time sees at least that value. A
+//device that does not answer counts in SIGNAL_SENSOR_HUB_ERRORS and its
+//signals keep their last values and times.
+//
+//SERCOM7 as I2C master on the EXT1 header of the SAM E54 Xplained Pro:
+//SDA PD08, SCL PD09, with pull-ups on the sensor board.
+
+//Set to 1 with the sensors fitted
+#ifndef SENSOR_HUB_ENABLE
+#define SENSOR_HUB_ENABLE 0
+#endif
+
+//SCL in Hz, the long leads to the motor keep it at standard mode
+#ifndef SENSOR_HUB_I2C_HZ
+#define SENSOR_HUB_I2C_HZ 100000
+#endif
+
+//ms between two reads of the round robin
+#ifndef SENSOR_HUB_SLOT
+#define SENSOR_HUB_SLOT 25
+#endif
+
+//ms a read may take before the bus is reset, a two byte read takes 0.5
+#define SENSOR_HUB_TIMEOUT 5
+
+//7 bit addresses
+#ifndef SENSOR_HUB_BOARD_TEMP_ADDRESS
+#define SENSOR_HUB_BOARD_TEMP_ADDRESS 0x48
+#endif
+#ifndef SENSOR_HUB_MOTOR_TEMP_ADDRESS
+#define SENSOR_HUB_MOTOR_TEMP_ADDRESS 0x49
+#endif
+#ifndef SENSOR_HUB_CURRENT_ADDRESS
+#define SENSOR_HUB_CURRENT_ADDRESS 0x40
+#endif
+
+//Ohms of the current shunt
+#ifndef SENSOR_HUB_SHUNT_OHMS
+#define SENSOR_HUB_SHUNT_OHMS 0.001f
+#endif
+
+//Sets up SERCOM7 and adds the service. Before the scheduler starts.
+void SensorHubStart();
+
+#endif /* SENSORHUB_H_ */
@@ -0,0 +1,51 @@
+/*
+ * Seqlock.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <stdint.h>
+
+//Stats and snapshots with one writer and readers in other tasks, copied
+//without a lock. The writer brackets every update with SeqlockWriteBegin
+//and SeqlockWriteEnd, which leave the sequence odd in between. A reader
+//copies the data between SeqlockReadBegin and SeqlockReadRetry and copies
+//it again while the update overlapped the copy:
+//
+//	do
+//	{
+//		sequence = SeqlockReadBegin(&slot->sequence);
+//		*copy = slot->data;
+//	} while( SeqlockReadRetry(&slot->sequence, sequence) );
+//
+//The writer never waits, so it can be an interrupt or the control loop. A
+//reader that preempted the writer mid update retries until the writer has
+//run again.
+
+static inline void SeqlockWriteBegin(uint32_t* sequence)
+{
+	__atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void SeqlockWriteEnd(uint32_t* sequence)
+{
+	__atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t SeqlockReadBegin(const uint32_t* sequence)
+{
+	return __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+}
+
+//Non-zero if the copy taken since SeqlockReadBegin returned start may be torn
+static inline uint8_t SeqlockReadRetry(const uint32_t* sequence, uint32_t start)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (start & 1) || start != __atomic_load_n(sequence, __ATOMIC_RELAXED);
+}
+
+#endif /* SEQLOCK_H_ */
@@ -0,0 +1,119 @@
+/*
+ * Service.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "Service.h"
+#include "task_config.h"
+
+static struct
+{
+	service_t* first;
+	service_t* last;
+	TaskHandle_t task;
+} services;
+
+//a wake time counts as passed for half the tick range after it
+static uint8_t Passed(TickType_t wake, TickType_t now)
+{
+	return (TickType_t)(now - wake) < (portMAX_DELAY >> 1);
+}
+
+void ServiceSleep(service_t* service, TickType_t ticks)
+{
+	service->wake = xTaskGetTickCount() + ticks;
+}
+
+uint8_t ServiceTakeSignal(service_t* service)
+{
+	return __atomic_exchange_n(&service->signalled, 0, __ATOMIC_ACQUIRE) != 0;
+}
+
+uint8_t ServiceExpired(const service_t* service)
+{
+	return Passed(service->wake, xTaskGetTickCount());
+}
+
+//A signalled service is due whatever it waits on, SERVICE_DELAY goes back
+//to sleep on its wake time
+static uint8_t Due(const service_t* service, TickType_t now)
+{
+	if( service->result == SERVICE_YIELDED || __atomic_load_n(&service->signalled, __ATOMIC_ACQUIRE) )
+		return 1;
+	return service->result == SERVICE_WAITING && Passed(service->wake, now);
+}
+
+static void ServiceTask(void* p)
+{
+	while( 1 )
+	{
+		TickType_t sleep = portMAX_DELAY;
+		for(service_t* service = services.first; service != NULL; service = service->next)
+		{
+			if( service->result == SERVICE_ENDED )
+				continue;
+			if( Due(service, xTaskGetTickCount()) )
+				service->result = service->run(service);
+
+			if( service->result == SERVICE_YIELDED )
+				sleep = 0;
+			else if( service->result == SERVICE_WAITING )
+			{
+				TickType_t now = xTaskGetTickCount();
+				TickType_t left = Passed(service->wake, now) ? 0 : service->wake - now;
+				if( left < sleep )
+					sleep = left;
+			}
+		}
+		//signals notify the task as well, one during the pass ends this at once
+		ulTaskNotifyTake(pdTRUE, sleep);
+	}
+}
+
+void ServiceAdd(service_t* service, const char* name, service_run_t run)
+{
+	memset(service, 0, sizeof(*service));
+	service->name = name;
+	service->run = run;
+	service->result = SERVICE_YIELDED;
+
+	taskENTER_CRITICAL();
+	if( services.last != NULL )
+		services.last->next = service;
+	else
+		services.first = service;
+	services.last = service;
+	taskEXIT_CRITICAL();
+
+	if( services.task != NULL )
+		xTaskNotifyGive(services.task);
+}
+
+void ServiceStart()
+{
+	xTaskCreate(ServiceTask, "Service", TASK_STACK_SERVICE, NULL, TASK_PRIORITY_SERVICE, &services.task);
+}
+
+void ServiceSignal(service_t* service)
+{
+	__atomic_store_n(&service->signalled, 1, __ATOMIC_RELEASE);
+	if( services.task != NULL )
+		xTaskNotifyGive(services.task);
+}
+
+void ServiceSignalFromIsr(service_t* service)
+{
+	BaseType_t woken = pdFALSE;
+
+	__atomic_store_n(&service->signalled, 1, __ATOMIC_RELEASE);
+	if( services.task != NULL )
+		vTaskNotifyGiveFromISR(services.task, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+void ServiceDmaDone(void* arg, uint8_t error)
+{
+	ServiceSignalFromIsr((service_t*)arg);
+}
@@ -0,0 +1,106 @@
+/*
+ * Service.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SERVICE_H_
+#define SERVICE_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+//Cooperative services that share one task and its stack, for the jobs
+//that are neither real time nor worth a stack of their own: the log's
+//rendering and UART DMA (Log.h) and the black box's flash writes
+//(BlackBox.h) so far. Every task costs its stack from the heap, the
+//lwIP pools share the same RAM. A service costs a service_t.
+//
+//A service is a protothread. Its function runs between SERVICE_BEGIN and
+//SERVICE_END as a task's body would, but every SERVICE_DELAY,
+//SERVICE_WAIT_SIGNAL and SERVICE_YIELD returns to the service task, which
+//calls the function again once the service is due and the switch the
+//macros build jumps back to where it waited. Nothing on the stack
+//survives a wait, what has to lives in the module's statics. A wait can
+//not be in a function the service calls, or in a switch of its own.
+//
+//The service task runs each service that is due in the order they were
+//added, then sleeps until the earliest wake time or a signal. A service
+//that takes long holds up all the others: a service waits only through
+//the macros, short waits for hardware aside, the black box's sector
+//erase is the longest at 25 ms. Jobs that block on hardware for longer,
+//the SD card's, or have a deadline keep their own task, and control stays
+//on its own preemptive tasks.
+
+typedef enum service_result_t
+{
+	//again at the wake time, or on a signal
+	SERVICE_WAITING = 0,
+	//again on the service task's next pass
+	SERVICE_YIELDED,
+	//never again
+	SERVICE_ENDED,
+} service_result_t;
+
+typedef struct service_t service_t;
+
+typedef service_result_t (*service_run_t)(service_t* service);
+
+struct service_t
+{
+	const char* name;
+	service_run_t run;
+	//__LINE__ of the wait to resume at, 0 at the start
+	uint16_t resume;
+	uint8_t result;
+	//tick it is due at while result is SERVICE_WAITING
+	TickType_t wake;
+	//set by ServiceSignal, cleared by the wait that takes it
+	volatile uint32_t signalled;
+	service_t* next;
+};
+
+#define SERVICE_BEGIN(service) switch( (service)->resume ) { case 0:
+
+#define SERVICE_END(service) } (service)->resume = 0; return SERVICE_ENDED
+
+//Lets the other services run, then carries on
+#define SERVICE_YIELD(service) \
+	do { (service)->resume = __LINE__; return SERVICE_YIELDED; case __LINE__:; } while( 0 )
+
+//Sleeps ms
+#define SERVICE_DELAY(service, ms) \
+	do { ServiceSleep((service), pdMS_TO_TICKS(ms)); (service)->resume = __LINE__; case __LINE__: \
+		if( !ServiceExpired(service) ) return SERVICE_WAITING; } while( 0 )
+
+//Sleeps until the service is signalled or ms have passed, whichever is
+//first. A signal from before the wait ends it at once, as a task
+//notification would.
+#define SERVICE_WAIT_SIGNAL(service, ms) \
+	do { ServiceSleep((service), pdMS_TO_TICKS(ms)); (service)->resume = __LINE__; case __LINE__: \
+		if( !ServiceTakeSignal(service) && !ServiceExpired(service) ) return SERVICE_WAITING; } while( 0 )
+
+//Adds a service, due at once. Before the scheduler starts or from a task.
+void ServiceAdd(service_t* service, const char* name, service_run_t run);
+
+//Creates the service task. Before the scheduler starts, once the services
+//of the boot are added.
+void ServiceStart();
+
+//Wakes a service's SERVICE_WAIT_SIGNAL, from a task
+void ServiceSignal(service_t* service);
+
+//From an interrupt below configMAX_SYSCALL_INTERRUPT_PRIORITY
+void ServiceSignalFromIsr(service_t* service);
+
+//DmaService.h done callback that signals the service in arg, as
+//DmaNotifyTask notifies a task
+void ServiceDmaDone(void* arg, uint8_t error);
+
+//For the macros
+void ServiceSleep(service_t* service, TickType_t ticks);
+uint8_t ServiceTakeSignal(service_t* service);
+uint8_t ServiceExpired(const service_t* service);
+
+#endif /* SERVICE_H_ */
@@ -0,0 +1,201 @@
+/*
+ * ShadowController.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <math.h>
+#include "ShadowController.h"
+#include "PIDBank.h"
+#include "main_context.h"
+#include "ControlCore.h"
+#include "SignalBus.h"
+#include "SteeringRateLoop.h"
+#include "FastCode.h"
+
+#if SHADOW_CONTROLLER_ENABLE
+
+typedef struct shadow_loop_t
+{
+	pid_gain_t p;
+	pid_gain_t i;
+	pid_gain_t d;
+	//copy the live controller on the next step
+	uint8_t restart;
+	//stepped since the restart, there is something to publish
+	uint8_t running;
+	//what ShadowControllerStep left for ShadowControllerRun
+	const PIDController* live;
+	float applied;
+	//in the loop's output units
+	float output;
+	float mean;
+	float mean_square;
+	float max;
+} shadow_loop_t;
+
+//main_task only
+static struct
+{
+	uint8_t enabled;
+	shadow_loop_t loops[SHADOW_CONTROLLER_LOOP_COUNT];
+	//the shadows' controllers, a loop each
+	pid_bank_t bank;
+} shadow;
+
+static const struct
+{
+	signal_id_t output;
+	signal_id_t mean;
+	signal_id_t rms;
+	signal_id_t max;
+} shadow_signals[SHADOW_CONTROLLER_LOOP_COUNT] =
+{
+	[SHADOW_CONTROLLER_STEERING] = { SIGNAL_SHADOW_STEERING_PID_OUT, SIGNAL_SHADOW_STEERING_MEAN_DIFFERENCE,
+		SIGNAL_SHADOW_STEERING_RMS_DIFFERENCE, SIGNAL_SHADOW_STEERING_MAX_DIFFERENCE },
+	[SHADOW_CONTROLLER_SPEED] = { SIGNAL_SHADOW_ACCELERATION_PID_OUT, SIGNAL_SHADOW_ACCELERATION_MEAN_DIFFERENCE,
+		SIGNAL_SHADOW_ACCELERATION_RMS_DIFFERENCE, SIGNAL_SHADOW_ACCELERATION_MAX_DIFFERENCE },
+};
+
+//A loop restarts when its gains change or the shadows are switched on
+static void SetGains(shadow_loop_t* s, float p, float i, float d, uint8_t switched_on)
+{
+	pid_gain_t gp = PID_GAIN(p);
+	pid_gain_t gi = PID_GAIN(i);
+	pid_gain_t gd = PID_GAIN(d);
+	if( switched_on || gp != s->p || gi != s->i || gd != s->d )
+		s->restart = 1;
+	s->p = gp;
+	s->i = gi;
+	s->d = gd;
+}
+
+void ShadowControllerApplyParams(const param_set_t* params)
+{
+	uint8_t enabled = params->values[PARAM_SHADOW_PID].u != 0;
+	uint8_t switched_on = enabled && !shadow.enabled;
+	shadow.enabled = enabled;
+	SetGains(&shadow.loops[SHADOW_CONTROLLER_STEERING], params->values[PARAM_SHADOW_STEER_P_GAIN].f,
+		params->values[PARAM_SHADOW_STEER_I_GAIN].f, params->values[PARAM_SHADOW_STEER_D_GAIN].f, switched_on);
+	SetGains(&shadow.loops[SHADOW_CONTROLLER_SPEED], params->values[PARAM_SHADOW_SPEED_P_GAIN].f,
+		params->values[PARAM_SHADOW_SPEED_I_GAIN].f, params->values[PARAM_SHADOW_SPEED_D_GAIN].f, switched_on);
+	if( !enabled )
+	{
+		shadow.loops[SHADOW_CONTROLLER_STEERING].running = 0;
+		shadow.loops[SHADOW_CONTROLLER_SPEED].running = 0;
+	}
+}
+
+//A PID int of the loop's output in its units
+FAST_CODE static float OutputUnits(shadow_controller_loop_t loop, int output)
+{
+#if STEERING_RATE_LOOP
+	if( loop == SHADOW_CONTROLLER_STEERING )
+		return ConvertPIDIntToRate(output);
+#endif
+	return ConvertPIDIntToDutyCycle(output);
+}
+
+FAST_CODE void ShadowControllerStep(main_context_t* ctx, shadow_controller_loop_t loop, const PIDController* live,
+	int setpoint, int feedback, int output)
+{
+	(void)ctx;
+	if( !shadow.enabled )
+		return;
+	shadow_loop_t* s = &shadow.loops[loop];
+	s->live = live;
+	s->applied = OutputUnits(loop, output);
+	shadow.bank.setpoint[loop] = setpoint;
+	shadow.bank.feedback[loop] = feedback;
+}
+
+FAST_CODE void ShadowControllerRun(main_context_t* ctx)
+{
+	if( !shadow.enabled )
+		return;
+	if( shadow.bank.count == 0 )
+		PIDBankInit(&shadow.bank, SHADOW_CONTROLLER_LOOP_COUNT);
+
+	//the speed loop's is scheduled, and the end of an autotune restarts live
+	for(uint32_t loop = 0; loop < SHADOW_CONTROLLER_LOOP_COUNT; ++loop)
+	{
+		const PIDController* live = shadow.loops[loop].live;
+		if( !live )
+			return;
+		shadow.bank.feedforward[loop] = live->feedforward;
+		PIDBankSetEnabled(&shadow.bank, loop, live->enabled);
+	}
+#if CONTROL_TIMED_PID
+	PIDBankStep(&shadow.bank, &ctx->pid_timing);
+#else
+	(void)ctx;
+	static const pid_timing_t untimed = { PID_TIMING_ONE, PID_TIMING_ONE };
+	PIDBankStep(&shadow.bank, &untimed);
+#endif
+
+	for(uint32_t loop = 0; loop < SHADOW_CONTROLLER_LOOP_COUNT; ++loop)
+	{
+		shadow_loop_t* s = &shadow.loops[loop];
+
+		//live was stepped this cycle already, the copy is where it is now
+		//and diverges from the next cycle on. What the bank just stepped
+		//in the loop is overwritten.
+		if( s->restart )
+		{
+			PIDController copy = *s->live;
+			copy.p = s->p;
+			copy.i = s->i;
+			copy.d = s->d;
+			s->restart = 0;
+			s->running = PIDBankLoad(&shadow.bank, loop, &copy);
+			s->output = s->applied;
+			s->mean = 0.0f;
+			s->mean_square = 0.0f;
+			s->max = 0.0f;
+			continue;
+		}
+
+		s->output = OutputUnits(loop, shadow.bank.output[loop]);
+		float difference = s->output - s->applied;
+		s->mean += (difference - s->mean) * SHADOW_CONTROLLER_AVERAGE_WEIGHT;
+		s->mean_square += (difference * difference - s->mean_square) * SHADOW_CONTROLLER_AVERAGE_WEIGHT;
+		float magnitude = fabsf(difference);
+		if( magnitude > s->max )
+			s->max = magnitude;
+	}
+}
+
+FAST_CODE void ShadowControllerPublish()
+{
+	for(uint32_t loop = 0; loop < SHADOW_CONTROLLER_LOOP_COUNT; ++loop)
+	{
+		const shadow_loop_t* s = &shadow.loops[loop];
+		if( !s->running )
+			continue;
+		SignalPublishFloat(shadow_signals[loop].output, s->output);
+		SignalPublishFloat(shadow_signals[loop].mean, s->mean);
+		SignalPublishFloat(shadow_signals[loop].rms, sqrtf(s->mean_square));
+		SignalPublishFloat(shadow_signals[loop].max, s->max);
+	}
+}
+
+#else
+
+void ShadowControllerApplyParams(const param_set_t* params)
+{
+}
+
+void ShadowControllerStep(struct main_context_t* ctx, shadow_controller_loop_t loop, const PIDController* live,
+	int setpoint, int feedback, int output)
+{
+}
+
+void ShadowControllerRun(struct main_context_t* ctx)
+{
+}
+
+void ShadowControllerPublish()
+{
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * ShadowController.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SHADOWCONTROLLER_H_
+#define SHADOWCONTROLLER_H_
+
+#include <stdint.h>
+#include "PID.h"
+#include "ParamStore.h"
+
+//Candidate gains tried out while driving, without them ever reaching the
+//actuators.
+//
+//With PARAM_SHADOW_PID set the steering and the speed loop each get a
+//second controller with the PARAM_SHADOW_* gains. It is stepped every
+//cycle after the live one, on the same setpoint, feedback, timing and
+//feedforward, and its output goes nowhere but into the divergence from the
+//output applied and onto the signal bus. Telemetry signal sets, the diag
+//server and the PC tools pick the SIGNAL_SHADOW_* signals up from there.
+//
+//A shadow starts as a copy of its live controller, integral, bounds and
+//all, as of the cycle it is switched on or its gains change, and from then
+//on only its gains set the two apart. Both are only stepped in Autonomous
+//mode, the shadow then keeps its state while the mode is left like the
+//live one.
+//
+//The divergence is the shadow's output less the one applied, in the loop's
+//output units: its mean and RMS over about the last
+//1 / SHADOW_CONTROLLER_AVERAGE_WEIGHT cycles and its largest magnitude
+//since the start. The shadows are the loops of a PIDBank, both stepped in
+//one pass once the speed loop is, at its profiler stage. Take
+//PID_ARITHMETIC_FLOAT or PID_ARITHMETIC_Q16 over the software emulated
+//double for it.
+
+#ifndef SHADOW_CONTROLLER_ENABLE
+#define SHADOW_CONTROLLER_ENABLE 0
+#endif
+
+//Weight of a cycle's divergence in the averages, 0.01 is about 100 ms at 1 kHz
+#ifndef SHADOW_CONTROLLER_AVERAGE_WEIGHT
+#define SHADOW_CONTROLLER_AVERAGE_WEIGHT 0.01f
+#endif
+
+typedef enum shadow_controller_loop_t
+{
+	SHADOW_CONTROLLER_STEERING = 0,
+	SHADOW_CONTROLLER_SPEED,
+	SHADOW_CONTROLLER_LOOP_COUNT
+} shadow_controller_loop_t;
+
+struct main_context_t;
+
+//Takes the shadow switch and gains of a parameter set up, from
+//ApplyNewParams
+void ShadowControllerApplyParams(const param_set_t* params);
+
+//Hands the loop's shadow what live was just stepped on. output is what the
+//loop applies, after an autotune relay.
+void ShadowControllerStep(struct main_context_t* ctx, shadow_controller_loop_t loop, const PIDController* live,
+	int setpoint, int feedback, int output);
+
+//Steps the shadows of all loops on what ShadowControllerStep handed them
+//this cycle, after the last loop's
+void ShadowControllerRun(struct main_context_t* ctx);
+
+//Publishes the outputs and divergences of the shadows that ran, from
+//main_task's signal stage
+void ShadowControllerPublish();
+
+#endif /* SHADOWCONTROLLER_H_ */
@@ -0,0 +1,143 @@
+/*
+ * SignalBus.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stddef.h>
+#include "SignalBus.h"
+#include "FastCode.h"
+
+//name, unit, then scale and size on the wire (signal_info_t)
+#define SIGNAL_FLOAT(name, unit, scale, size) { name, SIGNAL_TYPE_FLOAT, unit, scale, size }
+#define SIGNAL_UINT(name, size) { name, SIGNAL_TYPE_UINT, "", 0, size }
+
+static const signal_info_t signal_info[SIGNAL_COUNT] =
+{
+	SIGNAL_FLOAT("vehicle_speed", "m/s", 0.01f, 2),
+	SIGNAL_FLOAT("steering_angle", "deg", 0.1f, 2),
+	SIGNAL_FLOAT("vehicle_speed_requested", "", 0, 4),
+	SIGNAL_FLOAT("steering_angle_requested", "", 0, 4),
+	SIGNAL_FLOAT("vehicle_speed_commanded", "", 0, 4),
+	SIGNAL_FLOAT("steering_angle_commanded", "", 0, 4),
+	SIGNAL_FLOAT("steering_torque_pid_out", "", 0, 4),
+	SIGNAL_FLOAT("acceleration_pid_out", "", 0, 4),
+	SIGNAL_FLOAT("yaw_rate", "deg/s", 0.01f, 2),
+	SIGNAL_FLOAT("longitudinal_accel", "m/s^2", 0.001f, 2),
+	SIGNAL_FLOAT("lateral_accel", "m/s^2", 0.001f, 2),
+	SIGNAL_FLOAT("odometry_x", "m", 0.001f, 4),
+	SIGNAL_FLOAT("odometry_y", "m", 0.001f, 4),
+	SIGNAL_FLOAT("odometry_heading", "rad", 0.0001f, 2),
+	SIGNAL_UINT("estop", 1),
+	SIGNAL_UINT("reverse", 1),
+	SIGNAL_UINT("vehicle_mode", 1),
+	SIGNAL_UINT("autonomous_mode", 1),
+	SIGNAL_UINT("tele_operation", 1),
+	SIGNAL_UINT("park_brake_commanded", 1),
+	SIGNAL_UINT("pc_comm_active", 1),
+	SIGNAL_FLOAT("brake_pressure", "", 0.001f, 2),
+	SIGNAL_FLOAT("shadow_steering_pid_out", "", 0, 4),
+	SIGNAL_FLOAT("shadow_steering_mean_difference", "", 0, 4),
+	SIGNAL_FLOAT("shadow_steering_rms_difference", "", 0, 4),
+	SIGNAL_FLOAT("shadow_steering_max_difference", "", 0, 4),
+	SIGNAL_FLOAT("shadow_acceleration_pid_out", "", 0, 4),
+	SIGNAL_FLOAT("shadow_acceleration_mean_difference", "", 0, 4),
+	SIGNAL_FLOAT("shadow_acceleration_rms_difference", "", 0, 4),
+	SIGNAL_FLOAT("shadow_acceleration_max_difference", "", 0, 4),
+	SIGNAL_FLOAT("net_rx_frames", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_tx_frames", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_crc_errors", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_frame_errors", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_collisions", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_overruns", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_resource_errors", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_tx_refused", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_link_drops", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_pbuf_failures", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_mbox_overflows", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_udp_drops", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("supply_voltage", "V", 0.01f, 2),
+	SIGNAL_FLOAT("supply_gain", "", 0.001f, 2),
+	SIGNAL_UINT("actuator_faults", 1),
+	SIGNAL_FLOAT("steering_residual", "", 0.001f, 2),
+	SIGNAL_FLOAT("throttle_residual", "", 0.001f, 2),
+	SIGNAL_FLOAT("steering_angle_limit", "deg", 0.1f, 2),
+	SIGNAL_FLOAT("steering_rate_limit", "deg/s", 0.1f, 2),
+	SIGNAL_UINT("self_test_passed", 1),
+	SIGNAL_UINT("self_test_failed", 1),
+	SIGNAL_FLOAT("can_bus_load", "%", 0.1f, 2),
+	SIGNAL_FLOAT("can_rx_frames", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("can_tx_frames", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("can_errors", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("can_rx_overruns", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("can_tx_dropped", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("can_tx_wait_mean", "us", 0.1f, 4),
+	SIGNAL_FLOAT("can_tx_wait_max", "us", 0.1f, 4),
+	SIGNAL_UINT("can_tx_error_counter", 1),
+	SIGNAL_UINT("can_rx_error_counter", 1),
+	SIGNAL_UINT("can_bus_off", 4),
+	SIGNAL_FLOAT("lock_tcpip_core_contended", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("lock_tcpip_core_wait_max", "us", 0, 4),
+	SIGNAL_FLOAT("lock_tcpip_core_hold_max", "us", 0, 4),
+	SIGNAL_FLOAT("lock_lwip_mutex_contended", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("lock_lwip_mutex_wait_max", "us", 0, 4),
+	SIGNAL_FLOAT("lock_lwip_mutex_hold_max", "us", 0, 4),
+	SIGNAL_FLOAT("lock_lwip_sem_contended", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("lock_lwip_sem_wait_max", "us", 0, 4),
+	SIGNAL_FLOAT("lock_usb_debug_contended", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("lock_usb_debug_wait_max", "us", 0, 4),
+	SIGNAL_FLOAT("lock_usb_debug_hold_max", "us", 0, 4),
+	SIGNAL_FLOAT("motor_temperature", "degC", 0.1f, 2),
+	SIGNAL_UINT("motor_temperature_time", 4),
+	SIGNAL_FLOAT("board_temperature", "degC", 0.1f, 2),
+	SIGNAL_UINT("board_temperature_time", 4),
+	SIGNAL_FLOAT("motor_current", "A", 0.01f, 2),
+	SIGNAL_UINT("motor_current_time", 4),
+	SIGNAL_FLOAT("motor_voltage", "V", 0.01f, 2),
+	SIGNAL_UINT("motor_voltage_time", 4),
+	SIGNAL_UINT("sensor_hub_errors", 4),
+	SIGNAL_FLOAT("drive_slip", "", 0.001f, 2),
+	SIGNAL_FLOAT("brake_slip", "", 0.001f, 2),
+	SIGNAL_UINT("traction_control", 1),
+	SIGNAL_UINT("net_rx_polling", 1),
+	SIGNAL_FLOAT("steering_motor_estimate", "degC", 0.1f, 2),
+	SIGNAL_FLOAT("brake_motor_estimate", "degC", 0.1f, 2),
+	SIGNAL_FLOAT("steering_duty_limit", "", 0.001f, 2),
+	SIGNAL_FLOAT("net_rx_resyncs", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("net_rx_shed", "1/s", 0.1f, 4),
+	SIGNAL_FLOAT("latency_probe_received", "us", 0, 4),
+	SIGNAL_FLOAT("latency_probe_applied", "us", 0, 4),
+	SIGNAL_FLOAT("latency_probe_committed", "us", 0, 4),
+	SIGNAL_FLOAT("latency_probe_edge", "us", 0, 4),
+	SIGNAL_UINT("latency_probe_sequence", 4),
+};
+
+typedef struct signal_slot_t
+{
+	uint32_t sequence;
+	signal_value_t value;
+} signal_slot_t;
+
+static signal_slot_t signal_slots[SIGNAL_COUNT];
+
+const signal_info_t* SignalInfo(uint8_t id)
+{
+	if( id >= SIGNAL_COUNT )
+		return NULL;
+	return &signal_info[id];
+}
+
+FAST_CODE void SignalPublish(signal_id_t id, signal_value_t value)
+{
+	signal_slot_t* slot = &signal_slots[id];
+	__atomic_store_n(&slot->value.u, value.u, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->sequence, slot->sequence + 1, __ATOMIC_RELEASE);
+}
+
+FAST_CODE uint32_t SignalRead(signal_id_t id, signal_value_t* value)
+{
+	const signal_slot_t* slot = &signal_slots[id];
+	uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+	value->u = __atomic_load_n(&slot->value.u, __ATOMIC_RELAXED);
+	return sequence;
+}
@@ -0,0 +1,234 @@
+/*
+ * SignalBus.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SIGNALBUS_H_
+#define SIGNALBUS_H_
+
+#include <stdint.h>
+
+//Named scalar signals any task can read without reaching into
+//main_context_t.
+//
+//Every signal is one 32 bit slot with a sequence counter and exactly one
+//writer, main_task for all of these but the tcpip thread's SIGNAL_NET_*
+//SIGNAL_CAN_* and SIGNAL_LOCK_* and the service task's
+//SIGNAL_SELF_TEST_* and sensor hub signals. A publish stores the value and then
+//bumps the sequence, a read is one aligned load of each and never blocks
+//or retries: the value is at least as new as the sequence read. Signals
+//are independent of each other, values that must be seen together from
+//one cycle go through ControlExchange.h instead. The sequence tells a
+//reader whether a signal moved since it last looked, 0 is never published.
+//
+//Diagnostics and logs walk the signals by id through SignalInfo, so a new
+//signal shows up on the diag server's signals page without touching it.
+//The same table is the telemetry schema the control channel hands out
+//(ControlProtocol.h), and PC tools subscribe to signals by id from it.
+//
+//To add a signal, append its id here, its entry to signal_info in
+//SignalBus.c and its publish to the writer. Ids are never reused or
+//reordered, the tools that subscribed by id keep getting what they asked
+//for.
+typedef enum signal_id_t
+{
+	//measured, m/s and degrees
+	SIGNAL_VEHICLE_SPEED = 0,
+	SIGNAL_STEERING_ANGLE,
+	//as the driving agent last asked for them, held between commands
+	SIGNAL_VEHICLE_SPEED_REQUESTED,
+	SIGNAL_STEERING_ANGLE_REQUESTED,
+	//shaped, what the controls follow
+	SIGNAL_VEHICLE_SPEED_COMMANDED,
+	SIGNAL_STEERING_ANGLE_COMMANDED,
+	SIGNAL_STEERING_TORQUE_PID_OUT,
+	SIGNAL_ACCELERATION_PID_OUT,
+	//only published with a new IMU sample
+	SIGNAL_YAW_RATE,
+	SIGNAL_LONGITUDINAL_ACCEL,
+	SIGNAL_LATERAL_ACCEL,
+	//dead reckoned pose, m and rad
+	SIGNAL_ODOMETRY_X,
+	SIGNAL_ODOMETRY_Y,
+	SIGNAL_ODOMETRY_HEADING,
+	SIGNAL_ESTOP,
+	SIGNAL_REVERSE,
+	//vehicle_mode_t
+	SIGNAL_VEHICLE_MODE,
+	SIGNAL_AUTONOMOUS_MODE,
+	SIGNAL_TELE_OPERATION,
+	SIGNAL_PARK_BRAKE_COMMANDED,
+	SIGNAL_PC_COMM_ACTIVE,
+	//measured, share of the full front brake pressure
+	SIGNAL_BRAKE_PRESSURE,
+	//only published while the shadow controllers run (ShadowController.h),
+	//the shadow's output and its divergence from the one applied
+	SIGNAL_SHADOW_STEERING_PID_OUT,
+	SIGNAL_SHADOW_STEERING_MEAN_DIFFERENCE,
+	SIGNAL_SHADOW_STEERING_RMS_DIFFERENCE,
+	SIGNAL_SHADOW_STEERING_MAX_DIFFERENCE,
+	SIGNAL_SHADOW_ACCELERATION_PID_OUT,
+	SIGNAL_SHADOW_ACCELERATION_MEAN_DIFFERENCE,
+	SIGNAL_SHADOW_ACCELERATION_RMS_DIFFERENCE,
+	SIGNAL_SHADOW_ACCELERATION_MAX_DIFFERENCE,
+	//per second over the last NET_HEALTH_PERIOD, published by the tcpip
+	//thread (NetHealth.h)
+	SIGNAL_NET_RX_FRAMES,
+	SIGNAL_NET_TX_FRAMES,
+	SIGNAL_NET_CRC_ERRORS,
+	SIGNAL_NET_FRAME_ERRORS,
+	SIGNAL_NET_COLLISIONS,
+	SIGNAL_NET_OVERRUNS,
+	SIGNAL_NET_RESOURCE_ERRORS,
+	SIGNAL_NET_TX_REFUSED,
+	SIGNAL_NET_LINK_DROPS,
+	SIGNAL_NET_PBUF_FAILURES,
+	SIGNAL_NET_MBOX_OVERFLOWS,
+	SIGNAL_NET_UDP_DROPS,
+	//V, 0 without ADC_SAMPLER_SUPPLY_VOLTAGE, and the gain the actuator
+	//duties are scaled by (DriveByWireIO.h)
+	SIGNAL_SUPPLY_VOLTAGE,
+	SIGNAL_SUPPLY_GAIN,
+	//ACTUATOR_FAULT_* latched, and the share of each actuator's predicted
+	//motion its last judged window missed (ActuatorFault.h)
+	SIGNAL_ACTUATOR_FAULTS,
+	SIGNAL_STEERING_RESIDUAL,
+	SIGNAL_THROTTLE_RESIDUAL,
+	//deg and deg/s the autonomous steering is limited to at the measured
+	//speed (SteeringLimits.h)
+	SIGNAL_STEERING_ANGLE_LIMIT,
+	SIGNAL_STEERING_RATE_LIMIT,
+	//SELF_TEST_* that passed and failed the power-on self test, both 0 until
+	//it has finished (SelfTest.h)
+	SIGNAL_SELF_TEST_PASSED,
+	SIGNAL_SELF_TEST_FAILED,
+	//CAN_0 over the last CAN_HEALTH_PERIOD, published by the tcpip thread
+	//(CanHealth.h): % of the time the bus was busy, per second rates, us
+	//frames waited to be sent, the error counters as read and bus offs
+	//since boot
+	SIGNAL_CAN_BUS_LOAD,
+	SIGNAL_CAN_RX_FRAMES,
+	SIGNAL_CAN_TX_FRAMES,
+	SIGNAL_CAN_ERRORS,
+	SIGNAL_CAN_RX_OVERRUNS,
+	SIGNAL_CAN_TX_DROPPED,
+	SIGNAL_CAN_TX_WAIT_MEAN,
+	SIGNAL_CAN_TX_WAIT_MAX,
+	SIGNAL_CAN_TX_ERROR_COUNTER,
+	SIGNAL_CAN_RX_ERROR_COUNTER,
+	SIGNAL_CAN_BUS_OFF,
+	//per lock over the last LOCK_PROFILER_PERIOD, published by the tcpip
+	//thread (LockProfiler.h): takes that found it held per second, and the
+	//longest wait and hold in us
+	SIGNAL_LOCK_TCPIP_CORE_CONTENDED,
+	SIGNAL_LOCK_TCPIP_CORE_WAIT_MAX,
+	SIGNAL_LOCK_TCPIP_CORE_HOLD_MAX,
+	SIGNAL_LOCK_LWIP_MUTEX_CONTENDED,
+	SIGNAL_LOCK_LWIP_MUTEX_WAIT_MAX,
+	SIGNAL_LOCK_LWIP_MUTEX_HOLD_MAX,
+	SIGNAL_LOCK_LWIP_SEM_CONTENDED,
+	SIGNAL_LOCK_LWIP_SEM_WAIT_MAX,
+	SIGNAL_LOCK_USB_DEBUG_CONTENDED,
+	SIGNAL_LOCK_USB_DEBUG_WAIT_MAX,
+	SIGNAL_LOCK_USB_DEBUG_HOLD_MAX,
+	//read off I2C by the service task (SensorHub.h), degC, A and V, each
+	//followed by the time base us it was read at
+	SIGNAL_MOTOR_TEMPERATURE,
+	SIGNAL_MOTOR_TEMPERATURE_TIME,
+	SIGNAL_BOARD_TEMPERATURE,
+	SIGNAL_BOARD_TEMPERATURE_TIME,
+	SIGNAL_MOTOR_CURRENT,
+	SIGNAL_MOTOR_CURRENT_TIME,
+	SIGNAL_MOTOR_VOLTAGE,
+	SIGNAL_MOTOR_VOLTAGE_TIME,
+	//reads that failed since boot
+	SIGNAL_SENSOR_HUB_ERRORS,
+	//slip ratios of the axles and the TRACTION_CONTROL_* bits held back,
+	//with TRACTION_CONTROL_ENABLE (TractionControl.h)
+	SIGNAL_DRIVE_SLIP,
+	SIGNAL_BRAKE_SLIP,
+	SIGNAL_TRACTION_CONTROL,
+	//1 while gmac_task polls the receive ring rather than taking its
+	//interrupt, with GMAC_RX_ADAPTIVE (webserver_tasks.h)
+	SIGNAL_NET_RX_POLLING,
+	//degC of the steering and front brake motor models, and the share of
+	//full duty the steering motor is allowed (MotorThermal.h)
+	SIGNAL_STEERING_MOTOR_ESTIMATE,
+	SIGNAL_BRAKE_MOTOR_ESTIMATE,
+	SIGNAL_STEERING_DUTY_LIMIT,
+	//per second, times the receive ring was skipped ahead to the DMA and
+	//normal frames shed short of buffers (NetHealth.h)
+	SIGNAL_NET_RX_RESYNCS,
+	SIGNAL_NET_RX_SHED,
+	//us of each stage of the last marked command and its frame sequence,
+	//with LATENCY_PROBE_ENABLE (LatencyProbe.h). The sequence changes last.
+	SIGNAL_LATENCY_PROBE_RECEIVED,
+	SIGNAL_LATENCY_PROBE_APPLIED,
+	SIGNAL_LATENCY_PROBE_COMMITTED,
+	SIGNAL_LATENCY_PROBE_EDGE,
+	SIGNAL_LATENCY_PROBE_SEQUENCE,
+	SIGNAL_COUNT
+} signal_id_t;
+
+typedef enum signal_type_t
+{
+	SIGNAL_TYPE_UINT = 0,
+	SIGNAL_TYPE_FLOAT
+} signal_type_t;
+
+typedef union signal_value_t
+{
+	uint32_t u;
+	float f;
+} signal_value_t;
+
+typedef struct signal_info_t
+{
+	const char* name;
+	signal_type_t type;
+	//"" for none
+	const char* unit;
+	//How the value is sent in signal data frames: a float as the signed
+	//integer value / scale in size bytes, or with a scale of 0 as the IEEE
+	//754 float itself in 4, a uint as its low size bytes
+	float scale;
+	uint8_t size;
+} signal_info_t;
+
+//Name, type, unit and wire format, NULL for an unknown id
+const signal_info_t* SignalInfo(uint8_t id);
+
+//From the signal's writer only
+void SignalPublish(signal_id_t id, signal_value_t value);
+
+static inline void SignalPublishFloat(signal_id_t id, float value)
+{
+	signal_value_t v = { .f = value };
+	SignalPublish(id, v);
+}
+
+static inline void SignalPublishUint(signal_id_t id, uint32_t value)
+{
+	signal_value_t v = { .u = value };
+	SignalPublish(id, v);
+}
+
+//The latest value, returns the signal's sequence. Any task.
+uint32_t SignalRead(signal_id_t id, signal_value_t* value);
+
+static inline float SignalReadFloat(signal_id_t id)
+{
+	signal_value_t value;
+	SignalRead(id, &value);
+	return value.f;
+}
+
+static inline uint32_t SignalReadUint(signal_id_t id)
+{
+	signal_value_t value;
+	SignalRead(id, &value);
+	return value.u;
+}
+
+#endif /* SIGNALBUS_H_ */
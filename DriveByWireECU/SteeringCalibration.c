@@ -0,0 +1,157 @@
+/*
+ * SteeringCalibration.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stddef.h>
+#include <string.h>
+#include <hri_nvmctrl_e54.h>
+#include "SteeringCalibration.h"
+#include "FastCode.h"
+#include "AdcSampler.h"
+#include "IntegrityMonitor.h"
+#include "Nvm.h"
+
+#if STEERING_CALIBRATION_NVM_ADDRESS % STEERING_CALIBRATION_BLOCK_SIZE \
+	|| STEERING_CALIBRATION_NVM_ADDRESS + STEERING_CALIBRATION_BLOCK_SIZE > 0x00100000 - PARAM_STORE_SMART_EEPROM_SIZE
+#error The steering calibration has to be a whole block below the SmartEEPROM, a save would erase it
+#endif
+
+#define STEERING_LUT_STEP (1 << STEERING_LUT_SHIFT)
+#define STEERING_LUT_MASK (STEERING_LUT_STEP - 1)
+//one extra entry so the last code still has a right hand neighbour
+#define STEERING_LUT_SIZE ((ADC_SAMPLER_FULL_SCALE >> STEERING_LUT_SHIFT) + 2)
+
+//Placeholder mapping, used until a steering sweep (SteeringSweep.h) has
+//written a calibration to NVM.
+static const float default_steering_voltages[] = {0, 1.65f, 3.3f};
+static const float default_steering_positions[] = {0, 1, 2};
+
+static float steering_lut[STEERING_LUT_SIZE];
+static steering_calibration_t steering_current;
+
+static uint32_t SteeringCalibrationChecksum(const steering_calibration_t* record)
+{
+	const uint32_t* words = (const uint32_t*)record;
+	uint32_t sum = 0;
+	for(size_t i = 0; i < offsetof(steering_calibration_t, checksum) / sizeof(uint32_t); ++i)
+		sum += words[i];
+
+	return ~sum;
+}
+
+int SteeringCalibrationLoad(const float* voltages, const float* positions, uint32_t count)
+{
+	if( count < 2 || count > STEERING_CALIBRATION_MAX_POINTS )
+		return -1;
+
+	for(uint32_t i = 1; i < count; ++i)
+	{
+		if( !(voltages[i] > voltages[i-1]) )
+			return -1;
+	}
+
+	//Table entries are walked in increasing voltage, so the segment only ever moves forward.
+	uint32_t segment = 0;
+	for(int i = 0; i < STEERING_LUT_SIZE; ++i)
+	{
+		float voltage = ((float)(i << STEERING_LUT_SHIFT) / (float)ADC_SAMPLER_FULL_SCALE) * STEERING_ADC_VREF;
+
+		if( voltage <= voltages[0] )
+		{
+			steering_lut[i] = positions[0];
+			continue;
+		}
+		if( voltage >= voltages[count-1] )
+		{
+			steering_lut[i] = positions[count-1];
+			continue;
+		}
+
+		while( voltage > voltages[segment+1] )
+			++segment;
+
+		steering_lut[i] = LinearlyInterpolate(voltage, voltages[segment], voltages[segment+1], positions[segment], positions[segment+1]);
+	}
+
+	steering_current.magic = 0;
+	steering_current.count = count;
+	memcpy(steering_current.voltages, voltages, count * sizeof(float));
+	memcpy(steering_current.positions, positions, count * sizeof(float));
+	return 0;
+}
+
+int SteeringCalibrationLoadRecord(const steering_calibration_t* record)
+{
+	if( record->magic != STEERING_CALIBRATION_MAGIC || record->checksum != SteeringCalibrationChecksum(record) )
+		return -1;
+
+	if( SteeringCalibrationLoad(record->voltages, record->positions, record->count) != 0 )
+		return -1;
+	steering_current.magic = record->magic;
+	return 0;
+}
+
+void SteeringCalibrationSeal(steering_calibration_t* record)
+{
+	record->magic = STEERING_CALIBRATION_MAGIC;
+	record->checksum = SteeringCalibrationChecksum(record);
+}
+
+//Spins on the NVMCTRL, the idle hook must not sleep
+static int WriteRecord(const steering_calibration_t* record)
+{
+	if( !NvmCommand(STEERING_CALIBRATION_NVM_ADDRESS, NVMCTRL_CTRLB_CMD_EB, 0) )
+		return -1;
+	const uint8_t* source = (const uint8_t*)record;
+	for(uint32_t offset = 0; offset < sizeof(*record); offset += NVM_PAGE_SIZE)
+	{
+		uint32_t length = sizeof(*record) - offset < NVM_PAGE_SIZE ? sizeof(*record) - offset : NVM_PAGE_SIZE;
+		if( !NvmProgramPage(STEERING_CALIBRATION_NVM_ADDRESS + offset, &source[offset], length, 0) )
+			return -1;
+	}
+	return 0;
+}
+
+int SteeringCalibrationSave(const steering_calibration_t* record)
+{
+	//fuses with a larger SmartEEPROM than the layout has room for put it
+	//in the calibration's block
+	if( !ParamStoreFitsLayout() )
+		return -1;
+
+	int result = WriteRecord(record);
+	//failed or not, the block holds something new
+	IntegrityMonitorRebase(INTEGRITY_REGION_CALIBRATION);
+	return result;
+}
+
+const steering_calibration_t* SteeringCalibrationCurrent()
+{
+	return &steering_current;
+}
+
+void SteeringCalibrationInit()
+{
+	if( SteeringCalibrationLoadRecord((const steering_calibration_t*)STEERING_CALIBRATION_NVM_ADDRESS) == 0 )
+		return;
+
+	SteeringCalibrationLoad(default_steering_voltages, default_steering_positions,
+		sizeof(default_steering_positions) / sizeof(float));
+}
+
+FAST_CODE float SteeringCalibrationLookup(uint16_t adc_code)
+{
+	if( adc_code > ADC_SAMPLER_FULL_SCALE )
+		adc_code = ADC_SAMPLER_FULL_SCALE;
+
+	uint16_t index = adc_code >> STEERING_LUT_SHIFT;
+	float left = steering_lut[index];
+#if STEERING_LUT_SHIFT == 0
+	return left;
+#else
+	float fraction = (float)(adc_code & STEERING_LUT_MASK) * (1.0f / STEERING_LUT_STEP);
+	return left + (steering_lut[index+1] - left) * fraction;
+#endif
+}
@@ -0,0 +1,91 @@
+/*
+ * SteeringCalibration.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef STEERINGCALIBRATION_H_
+#define STEERINGCALIBRATION_H_
+
+#include <stdint.h>
+#include "ParamStore.h"
+
+//Mapping from the steering potentiometer ADC code to steering position.
+//The calibration points are only used to build a lookup table indexed by
+//ADC code, so a position read costs the same no matter how many points the
+//calibration has. The sweep (SteeringSweep.h) measures one and writes the
+//record.
+
+//as many as the sweep fits, the record has to fit in one NVM block
+#define STEERING_CALIBRATION_MAX_POINTS 64
+
+//ADC reference voltage, the voltage of ADC_SAMPLER_FULL_SCALE
+#define STEERING_ADC_VREF 3.3f
+
+//Each table entry covers 1 << STEERING_LUT_SHIFT ADC codes and positions in
+//between are interpolated. 0 gives one entry per code (16K of RAM), 4 gives 257.
+#ifndef STEERING_LUT_SHIFT
+#define STEERING_LUT_SHIFT 4
+#endif
+
+//Calibration record as it is stored in NVM.
+//voltages must be strictly increasing.
+typedef struct steering_calibration_t
+{
+	uint32_t magic;
+	uint32_t count;
+	float voltages[STEERING_CALIBRATION_MAX_POINTS];
+	float positions[STEERING_CALIBRATION_MAX_POINTS];
+	uint32_t checksum;
+} steering_calibration_t;
+
+//"BCTS", a record of the 16 point layout before fails it
+#define STEERING_CALIBRATION_MAGIC 0x53544342
+
+//Flash is memory mapped, so the record is read in place. It has the 8K
+//block of bank B right below the SmartEEPROM (ParamStore.h), the rom region
+//of the linker script ends there. Erased flash fails the magic check.
+#define STEERING_CALIBRATION_BLOCK_SIZE 8192
+#ifndef STEERING_CALIBRATION_NVM_ADDRESS
+#define STEERING_CALIBRATION_NVM_ADDRESS (0x00100000 - PARAM_STORE_SMART_EEPROM_SIZE - STEERING_CALIBRATION_BLOCK_SIZE)
+#endif
+
+//y at val_x on the line through (left_x, left_y) and (right_x, right_y),
+//extrapolated outside them. left_x and right_x must differ.
+static inline float LinearlyInterpolate(float val_x, float left_x, float right_x, float left_y, float right_y)
+{
+	float delta_x = right_x - left_x;
+	float percent_x = (val_x - left_x) / delta_x;
+	return left_y + (percent_x * (right_y - left_y));
+}
+
+//Builds the table from the record in NVM, or from the default points if
+//there is no valid record. Must be called before the first lookup.
+void SteeringCalibrationInit();
+
+//Rebuilds the table from the given points.
+//Returns 0 on success, or -1 if the points are not usable and the table was left unchanged.
+int SteeringCalibrationLoad(const float* voltages, const float* positions, uint32_t count);
+
+//Returns 0 and rebuilds the table if record holds a valid calibration, -1 otherwise.
+int SteeringCalibrationLoadRecord(const steering_calibration_t* record);
+
+//Fills in magic and checksum so the record can be written to NVM.
+void SteeringCalibrationSeal(steering_calibration_t* record);
+
+//Erases the NVM block of the record and writes record, which has to be
+//sealed, then reads it back. Returns 0 if it matches, -1 otherwise. The
+//NVMCTRL is busy for tens of ms and the caller spins meanwhile: from the
+//idle hook only, and never while a firmware update programs. The table is
+//left as it was, load the record to use it.
+int SteeringCalibrationSave(const steering_calibration_t* record);
+
+//The points the table was last built from, with the magic of a record it
+//came from and 0 for points given to SteeringCalibrationLoad or the
+//defaults. Read by other tasks as it is being rebuilt, a read can be torn.
+const steering_calibration_t* SteeringCalibrationCurrent();
+
+//Steering position for a raw 12 bit ADC code, constant time.
+float SteeringCalibrationLookup(uint16_t adc_code);
+
+#endif /* STEERINGCALIBRATION_H_ */
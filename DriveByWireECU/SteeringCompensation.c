@@ -0,0 +1,102 @@
+/*
+ * SteeringCompensation.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "SteeringCompensation.h"
+#include "FastCode.h"
+
+void SteeringCompensationInit(steering_compensation_t* compensation, float dt)
+{
+	memset(compensation, 0, sizeof(*compensation));
+	compensation->dt = dt;
+	compensation->rate_weight = dt / (STEERING_COMPENSATION_RATE_TAU + dt);
+}
+
+void SteeringCompensationReset(steering_compensation_t* compensation)
+{
+	compensation->primed = 0;
+	compensation->rate = 0.0f;
+	compensation->direction = 0;
+	compensation->taking_up = 0;
+	compensation->kick_left = 0.0f;
+	compensation->offset = 0.0f;
+}
+
+FAST_CODE static float Clamp(float value, float limit)
+{
+	if( value > limit )
+		return limit;
+	if( value < -limit )
+		return -limit;
+	return value;
+}
+
+//Starts taking up the play at a reversal of u, and ends it once the
+//column turns the new way or the reversal ran out of time. Returns the
+//kick for this step.
+FAST_CODE static float Backlash(steering_compensation_t* compensation, float torque)
+{
+	int8_t push = torque > STEERING_COMPENSATION_BLEND ? 1 : torque < -STEERING_COMPENSATION_BLEND ? -1 : 0;
+	if( push != 0 && push != compensation->direction )
+	{
+		//the first push after a start has no play behind it to know of
+		if( compensation->direction != 0 )
+		{
+			compensation->taking_up = 1;
+			compensation->take_up_time = 0.0f;
+			compensation->take_up_work = 0.0f;
+			compensation->kick_left = compensation->backlash;
+		}
+		compensation->direction = push;
+	}
+	if( !compensation->taking_up )
+		return 0.0f;
+
+	if( compensation->rate * compensation->direction > STEERING_FRICTION_RATE )
+	{
+		compensation->backlash += (compensation->take_up_work - compensation->backlash) * STEERING_BACKLASH_ADAPT;
+		compensation->taking_up = 0;
+		return 0.0f;
+	}
+	if( compensation->take_up_time >= STEERING_BACKLASH_MAX_TIME )
+	{
+		compensation->taking_up = 0;
+		return 0.0f;
+	}
+	compensation->take_up_time += compensation->dt;
+	if( compensation->kick_left <= 0.0f )
+		return 0.0f;
+	compensation->kick_left -= STEERING_BACKLASH_KICK * compensation->dt;
+	return STEERING_BACKLASH_KICK * compensation->direction;
+}
+
+FAST_CODE float SteeringCompensationStep(steering_compensation_t* compensation, float torque, float angle)
+{
+	if( compensation->primed )
+	{
+		float rate = (angle - compensation->last_angle) / compensation->dt;
+		compensation->rate += (rate - compensation->rate) * compensation->rate_weight;
+	}
+	compensation->last_angle = angle;
+	compensation->primed = 1;
+
+	//the direction u pushes, ramped in around 0
+	float push = Clamp(torque * (1.0f / STEERING_COMPENSATION_BLEND), 1.0f);
+	float offset = STEERING_DEADBAND * push;
+	if( compensation->rate > STEERING_FRICTION_RATE )
+		offset += STEERING_COULOMB_FRICTION;
+	else if( compensation->rate < -STEERING_FRICTION_RATE )
+		offset -= STEERING_COULOMB_FRICTION;
+	else
+		offset += STEERING_STATIC_FRICTION * push;
+	offset += Backlash(compensation, torque);
+
+	float out = Clamp(torque + offset, 1.0f);
+	if( compensation->taking_up )
+		compensation->take_up_work += (out < 0.0f ? -out : out) * compensation->dt;
+	compensation->offset = out - torque;
+	return out;
+}
@@ -0,0 +1,121 @@
+/*
+ * SteeringCompensation.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef STEERINGCOMPENSATION_H_
+#define STEERINGCOMPENSATION_H_
+
+#include <stdint.h>
+
+//The nonlinear part of the steering actuator, taken out between the
+//position PID's torque and the motor, so that the PID sees something
+//closer to the linear plant it was tuned on. Without it the I term has to
+//wind up through the motor driver's deadband and the column's friction
+//before anything moves, small corrections stall and then jump, and every
+//reversal first has to take up the play in the gears.
+//
+//Three terms are added to the PID's signed torque u, each 0 by default
+//until measured on the vehicle:
+//
+//	deadband	STEERING_DEADBAND, the duty below which the motor does not
+//				turn at all, in the direction of u
+//	friction	STEERING_COULOMB_FRICTION against the direction the column
+//				turns while it turns faster than
+//				STEERING_FRICTION_RATE, STEERING_STATIC_FRICTION in the
+//				direction of u while it stands
+//	backlash	STEERING_BACKLASH_KICK in the new direction after u
+//				reverses, until the play is estimated to be taken up or
+//				the column moves
+//
+//The terms that go by the direction of u ramp in over
+//|u| < STEERING_COMPENSATION_BLEND, so a u dithering around 0 at the
+//setpoint does not toggle the full deadband and friction back and forth.
+//
+//The play is not measured directly, the encoder is fused into the angle.
+//It is estimated as the duty seconds it took from a reversal of u to the
+//column turning the new way, a running average over reversals with
+//STEERING_BACKLASH_ADAPT. A reversal that has not moved the column within
+//STEERING_BACKLASH_MAX_TIME, against a stop or a stuck column, teaches
+//nothing. The kick then puts that much duty in at once.
+//
+//A step is the same couple of dozen float operations every cycle. With the
+//compensation fitted the steering I gain can come down to what the slow
+//disturbances need.
+
+#ifndef STEERING_COMPENSATION_ENABLE
+#define STEERING_COMPENSATION_ENABLE 0
+#endif
+
+//shares of full duty
+#ifndef STEERING_DEADBAND
+#define STEERING_DEADBAND 0.0f
+#endif
+#ifndef STEERING_COULOMB_FRICTION
+#define STEERING_COULOMB_FRICTION 0.0f
+#endif
+#ifndef STEERING_STATIC_FRICTION
+#define STEERING_STATIC_FRICTION 0.0f
+#endif
+#ifndef STEERING_BACKLASH_KICK
+#define STEERING_BACKLASH_KICK 0.0f
+#endif
+
+//|u| the direction terms are full at
+#ifndef STEERING_COMPENSATION_BLEND
+#define STEERING_COMPENSATION_BLEND 0.02f
+#endif
+
+//deg/s the column counts as turning above, and s of the rate filter
+#ifndef STEERING_FRICTION_RATE
+#define STEERING_FRICTION_RATE 2.0f
+#endif
+#define STEERING_COMPENSATION_RATE_TAU 0.01f
+
+//weight of a new measurement of the play, and s a reversal is given to
+//move the column
+#ifndef STEERING_BACKLASH_ADAPT
+#define STEERING_BACKLASH_ADAPT 0.25f
+#endif
+#ifndef STEERING_BACKLASH_MAX_TIME
+#define STEERING_BACKLASH_MAX_TIME 0.3f
+#endif
+
+typedef struct steering_compensation_t
+{
+	float dt;
+	//weight of a new rate in the filter
+	float rate_weight;
+	float last_angle;
+	//deg/s, filtered
+	float rate;
+	uint8_t primed;
+
+	//-1, 0 or 1, the side u was last pushed to beyond the blend
+	int8_t direction;
+	//s and duty seconds since that reversal, while the column has not
+	//moved the new way yet
+	uint8_t taking_up;
+	float take_up_time;
+	float take_up_work;
+	//duty seconds the play takes, and what the kick still has to put in
+	float backlash;
+	float kick_left;
+
+	//what the last step added to u
+	float offset;
+} steering_compensation_t;
+
+//dt in s, no play known
+void SteeringCompensationInit(steering_compensation_t* compensation, float dt);
+
+//For a loop that stops driving the motor, the next step starts over from
+//the angle it is given. The play learned is kept.
+void SteeringCompensationReset(steering_compensation_t* compensation);
+
+//One cycle: the PID's signed torque, positive toward higher angles, and
+//the measured angle in deg. Returns the torque to apply, clamped to -1 to 1.
+float SteeringCompensationStep(steering_compensation_t* compensation, float torque, float angle);
+
+#endif /* STEERINGCOMPENSATION_H_ */
@@ -0,0 +1,73 @@
+/*
+ * SteeringEncoder.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hal_gpio.h>
+#include <hri_pdec_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include "SteeringEncoder.h"
+#include "FastCode.h"
+
+#if STEERING_ENCODER_ENABLE
+
+#define STEERING_ENCODER_PIN_A GPIO(GPIO_PORTB, 18)
+#define STEERING_ENCODER_PIN_B GPIO(GPIO_PORTB, 19)
+
+//the count as of the last read
+static uint16_t steering_encoder_count;
+
+FAST_CODE static uint16_t ReadCount()
+{
+	//COUNT is only readable after a read synchronization, a few PDEC clocks
+	hri_pdec_set_CTRLB_CMD_bf(PDEC, PDEC_CTRLBSET_CMD_READSYNC_Val);
+	hri_pdec_wait_for_sync(PDEC, PDEC_SYNCBUSY_CTRLB);
+	return hri_pdec_read_COUNT_reg(PDEC);
+}
+
+void SteeringEncoderInit()
+{
+	hri_mclk_set_APBCMASK_PDEC_bit(MCLK);
+	//clocked like the PWM timers, far above any edge rate of the motor
+	hri_gclk_write_PCHCTRL_reg(GCLK, PDEC_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+	gpio_set_pin_function(STEERING_ENCODER_PIN_A, PINMUX_PB18G_PDEC_QDI0);
+	gpio_set_pin_function(STEERING_ENCODER_PIN_B, PINMUX_PB19G_PDEC_QDI1);
+
+	hri_pdec_write_CTRLA_reg(PDEC, PDEC_CTRLA_SWRST);
+	hri_pdec_wait_for_sync(PDEC, PDEC_SYNCBUSY_SWRST);
+	//The filter passes an edge after 8 stable clocks, under 1us at 12MHz.
+	//16 angular bits and no revolution counter make COUNT one free running
+	//16 bit position.
+	hri_pdec_write_FILTER_reg(PDEC, 8);
+	hri_pdec_write_CTRLA_reg(PDEC, PDEC_CTRLA_MODE_QDEC | PDEC_CTRLA_CONF_X4 | PDEC_CTRLA_ANGULAR(7)
+		| PDEC_CTRLA_PINEN0 | PDEC_CTRLA_PINEN1 | (STEERING_ENCODER_REVERSED ? PDEC_CTRLA_SWAP : 0));
+	hri_pdec_set_CTRLA_ENABLE_bit(PDEC);
+	hri_pdec_set_CTRLB_CMD_bf(PDEC, PDEC_CTRLBSET_CMD_START_Val);
+
+	steering_encoder_count = ReadCount();
+}
+
+FAST_CODE int32_t SteeringEncoderRead()
+{
+	uint16_t count = ReadCount();
+	int16_t counts = (int16_t)(count - steering_encoder_count);
+	steering_encoder_count = count;
+	return counts;
+}
+
+#else
+
+void SteeringEncoderInit()
+{
+}
+
+int32_t SteeringEncoderRead()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * SteeringEncoder.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef STEERINGENCODER_H_
+#define STEERINGENCODER_H_
+
+#include <stdint.h>
+
+//Quadrature encoder on the steering motor, counted by the PDEC.
+//
+//The PDEC decodes the A and B channels on PB18 and PB19 in hardware, all
+//four edges of a cycle, and keeps a 16 bit position count without any
+//interrupts. Each read takes the count since the last one, which the
+//steering fusion (DriveByWireIO.c) adds to the angle it keeps from the
+//potentiometer. The encoder alone has no zero, before the first read the
+//motor could be anywhere.
+//
+//The count wraps at 16 bits. Reads must come often enough that the motor
+//never turns half of that between two, at the control cycle that is over
+//30 million counts per second.
+
+#ifndef STEERING_ENCODER_ENABLE
+#define STEERING_ENCODER_ENABLE 0
+#endif
+
+//Counts per degree at the steering column, all four edges of every encoder
+//cycle through the motor gearbox. A placeholder until it is measured on
+//the vehicle.
+#ifndef STEERING_ENCODER_COUNTS_PER_DEGREE
+#define STEERING_ENCODER_COUNTS_PER_DEGREE 100.0f
+#endif
+
+//1 if the count goes down while the potentiometer angle goes up
+#ifndef STEERING_ENCODER_REVERSED
+#define STEERING_ENCODER_REVERSED 0
+#endif
+
+//Sets up the PDEC in quadrature mode and starts counting.
+//Must be called once after atmel_start_init.
+void SteeringEncoderInit();
+
+//Counts since the last call, signed like the potentiometer angle. From
+//main_task only.
+int32_t SteeringEncoderRead();
+
+#endif /* STEERINGENCODER_H_ */
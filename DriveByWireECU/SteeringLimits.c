@@ -0,0 +1,35 @@
+/*
+ * SteeringLimits.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "SteeringLimits.h"
+#include "FastCode.h"
+
+void SteeringLimitsInit(steering_limits_t* limits, const steering_limit_point_t* points, uint8_t count, float spacing)
+{
+	limits->points = points;
+	limits->count = count;
+	limits->inverse_spacing = 1.0f / spacing;
+}
+
+FAST_CODE void SteeringLimitsLookup(const steering_limits_t* limits, float speed, steering_limit_point_t* point)
+{
+	float position = (speed < 0.0f ? -speed : speed) * limits->inverse_spacing;
+	uint8_t last = limits->count - 1;
+	const steering_limit_point_t* low;
+	float fraction;
+
+	//NaN lands on the last point, the tightest
+	if( last == 0 || !(position < last) )
+	{
+		*point = limits->points[last];
+		return;
+	}
+	uint8_t index = (uint8_t)position;
+	fraction = position - index;
+	low = &limits->points[index];
+	point->angle = low->angle + (low[1].angle - low->angle) * fraction;
+	point->rate = low->rate + (low[1].rate - low->rate) * fraction;
+}
@@ -0,0 +1,49 @@
+/*
+ * SteeringLimits.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef STEERINGLIMITS_H_
+#define STEERINGLIMITS_H_
+
+#include <stdint.h>
+
+//The steering angle and rate the cart may be steered at, by its speed.
+//What is harmless at walking pace rolls the cart over at 12 m/s, a fixed
+//limit is either useless at speed or cripples the cart in a parking lot.
+//
+//The table holds one point at each of count evenly spaced speeds from 0 in
+//steps of spacing, like a gain schedule (GainSchedule.h): a lookup finds
+//its interval with one multiply and interpolates linearly between the two
+//points around it, the same cost wherever it lands. Speeds beyond the
+//table use its last point, reverse looks up the speed forward.
+//
+//The shaping stage (ControlCore.c) clamps the autonomous steering request
+//to the angle and slews it at no more than the rate, every cycle from the
+//measured speed. The planner no longer has to know the limits to stay
+//inside them. A commanded angle that was inside the limit when the speed
+//was lower is slewed back in at the rate limit rather than cut off.
+
+typedef struct steering_limit_point_t
+{
+	//deg either side, and deg/s
+	float angle;
+	float rate;
+} steering_limit_point_t;
+
+typedef struct steering_limits_t
+{
+	const steering_limit_point_t* points;
+	uint8_t count;
+	float inverse_spacing;
+} steering_limits_t;
+
+//points is referenced, not copied. count has to be at least 1, spacing in
+//m/s above 0.
+void SteeringLimitsInit(steering_limits_t* limits, const steering_limit_point_t* points, uint8_t count, float spacing);
+
+//Limits interpolated at speed, m/s
+void SteeringLimitsLookup(const steering_limits_t* limits, float speed, steering_limit_point_t* point);
+
+#endif /* STEERINGLIMITS_H_ */
@@ -0,0 +1,61 @@
+/*
+ * SteeringRateLoop.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "SteeringRateLoop.h"
+#include "FastCode.h"
+
+//duty cycle / deg/s, 100% at 20 deg/s off the commanded rate
+#define STEERING_RATE_P_GAIN (1.0f / 20.0f)
+//integrates away friction within about 50 ms, per step
+#define STEERING_RATE_I_GAIN (STEERING_RATE_P_GAIN / (0.05f * STEERING_RATE_LOOP_FREQ))
+#define STEERING_RATE_D_GAIN 0.0f
+
+//weight of the last rate in the rate filter, about a 0.6 ms time constant.
+//One ADC code of position is about 200 deg/s of rate at 8 kHz.
+#define STEERING_RATE_FILTER 0.8f
+
+#define MAX_STEERING_RATE_DUTY_CYCLE 1.0f
+
+//milli deg/s and thousandths of duty cycle, the resolution of the outer loop
+#define RATE_TO_PID_INT(rate) ((int)((rate) * 1000.0f))
+#define PID_INT_TO_DUTY_CYCLE(value) ((float)(value) * (1.0f / 1000.0f))
+
+void SteeringRateLoopInit(steering_rate_loop_t* loop)
+{
+	memset(loop, 0, sizeof(steering_rate_loop_t));
+
+	loop->controller.p = PID_GAIN(STEERING_RATE_P_GAIN);
+	loop->controller.i = PID_GAIN(STEERING_RATE_I_GAIN);
+	loop->controller.d = PID_GAIN(STEERING_RATE_D_GAIN);
+	setOutputBounds(&loop->controller, -MAX_STEERING_RATE_DUTY_CYCLE * 1000, MAX_STEERING_RATE_DUTY_CYCLE * 1000);
+	setAntiWindup(&loop->controller, PID_ANTI_WINDUP_BACK_CALCULATION, 1.0f);
+	setEnabled(&loop->controller, 0);
+}
+
+FAST_CODE float SteeringRateLoopStep(steering_rate_loop_t* loop, float position)
+{
+	if( loop->primed )
+	{
+		float rate = (position - loop->last_position) * STEERING_RATE_LOOP_FREQ;
+		loop->rate = rate + (loop->rate - rate) * STEERING_RATE_FILTER;
+	}
+	loop->last_position = position;
+	loop->primed = 1;
+
+	//disabling here, not from the outer loop, keeps the controller to this context
+	uint8_t enabled = loop->enabled;
+	setEnabled(&loop->controller, enabled);
+	if( !enabled )
+	{
+		loop->torque = 0.0f;
+		return 0.0f;
+	}
+
+	int output = pid_step(&loop->controller, RATE_TO_PID_INT(loop->setpoint), RATE_TO_PID_INT(loop->rate), PID_DT_UNTIMED);
+	loop->torque = PID_INT_TO_DUTY_CYCLE(output);
+	return loop->torque;
+}
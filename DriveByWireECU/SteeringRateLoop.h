@@ -0,0 +1,61 @@
+/*
+ * SteeringRateLoop.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef STEERINGRATELOOP_H_
+#define STEERINGRATELOOP_H_
+
+#include <stdint.h>
+#include "PID.h"
+
+//Inner loop of the cascaded steering control.
+//The position PID in main_task commands a steering rate at 1 kHz, and this
+//loop turns it into motor torque at STEERING_RATE_LOOP_FREQ, fast enough to
+//keep up with the motor so the position loop sees an almost ideal rate
+//actuator and can run a much higher gain.
+//The rate is the difference of successive steering positions from the DMA
+//sampled ADC, smoothed by a first order filter, the only sensor there is.
+//
+//Steps run in an interrupt (DriveByWireIO.c) and own the controller, the
+//outer loop only writes setpoint and enabled. The controller is stepped
+//inline with pid_step, no callbacks, and the firmware refuses to build the
+//loop with PID_ARITHMETIC_DOUBLE, which the FPU does not do.
+
+//1 runs steering as position loop and rate loop, 0 as the single position
+//PID driving torque directly
+#ifndef STEERING_RATE_LOOP
+#define STEERING_RATE_LOOP 0
+#endif
+
+//Steps per second
+#ifndef STEERING_RATE_LOOP_FREQ
+#define STEERING_RATE_LOOP_FREQ 8000
+#endif
+
+typedef struct steering_rate_loop_t
+{
+	PIDController controller;
+	//deg/s, positive toward higher steering angles, from the outer loop
+	volatile float setpoint;
+	//non zero while the loop drives the motor, from the outer loop
+	volatile uint8_t enabled;
+
+	float last_position;
+	uint8_t primed;
+	//measured and filtered, deg/s
+	float rate;
+	//signed duty cycle of the last step
+	float torque;
+} steering_rate_loop_t;
+
+void SteeringRateLoopInit(steering_rate_loop_t* loop);
+
+//One step from the steering position in degrees. Returns the signed torque
+//duty cycle (-1 to 1) to apply, positive toward higher angles, or 0 while
+//disabled. The rate is measured even while disabled so the loop starts
+//from the actual one.
+float SteeringRateLoopStep(steering_rate_loop_t* loop, float position);
+
+#endif /* STEERINGRATELOOP_H_ */
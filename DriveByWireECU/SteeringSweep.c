@@ -0,0 +1,399 @@
+/*
+ * SteeringSweep.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "SteeringSweep.h"
+#include "main_context.h"
+#include "AdcSampler.h"
+#include "SteeringEncoder.h"
+#include "FirmwareUpdate.h"
+#include "EventLog.h"
+
+#if STEERING_SWEEP_ENABLE
+
+#define STEERING_SWEEP_REQUEST_NONE 0
+#define STEERING_SWEEP_REQUEST_START 1
+#define STEERING_SWEEP_REQUEST_ABORT 2
+
+#define STEERING_SWEEP_SAVE_PENDING 0
+#define STEERING_SWEEP_SAVE_OK 1
+#define STEERING_SWEEP_SAVE_FAILED 2
+
+typedef struct steering_sweep_bin_t
+{
+	uint32_t samples;
+	uint32_t code_sum;
+	//encoder counts from the start of the sweep stage
+	float count_sum;
+} steering_sweep_bin_t;
+
+static struct
+{
+	//STEERING_SWEEP_REQUEST_*, from any task
+	uint8_t request;
+	//STEERING_SWEEP_SAVE_*, set by the idle hook
+	uint8_t saved;
+	//state written by main_task, read by the idle hook and the network
+	steering_sweep_status_t status;
+	uint32_t started;
+	uint32_t last_time;
+
+	//the rate measured over the last window
+	uint32_t window_time;
+	uint16_t window_code;
+	float rate;
+	float torque;
+	//ms at the torque limit without moving
+	uint32_t stalled;
+
+	//range the bins cover
+	uint16_t low_code;
+	uint16_t high_code;
+	int32_t sweep_count;
+	steering_sweep_bin_t bins[STEERING_SWEEP_BINS];
+	steering_calibration_t record;
+} steering_sweep;
+
+static inline float Volts(uint32_t fine_code)
+{
+	return (float)fine_code * (STEERING_ADC_VREF / ADC_SAMPLER_FINE_FULL_SCALE);
+}
+
+static void Finish(main_context_t* ctx, steering_sweep_result_t result)
+{
+	steering_sweep_status_t* status = &steering_sweep.status;
+	status->elapsed = ctx->current_time - steering_sweep.started;
+	status->result = result;
+	__atomic_store_n(&status->state, STEERING_SWEEP_IDLE, __ATOMIC_RELEASE);
+	EventLogWrite(EVENT_LOG_CALIBRATION, result, status->elapsed);
+}
+
+//Starts the torque from 0 for a new direction
+static void ResetDrive(main_context_t* ctx)
+{
+	steering_sweep.window_time = ctx->current_time;
+	steering_sweep.window_code = ctx->steering_code;
+	steering_sweep.rate = 0.0f;
+	steering_sweep.torque = 0.0f;
+	steering_sweep.stalled = 0;
+}
+
+static void Start(main_context_t* ctx)
+{
+	steering_sweep_status_t* status = &steering_sweep.status;
+	steering_sweep.started = ctx->current_time;
+	if( ctx->mode.mode != VEHICLE_MODE_DISABLED || ctx->autonomous_mode || ctx->tele_operation_enabled
+		|| ctx->vehicle_speed > STEERING_SWEEP_MAX_SPEED || ctx->vehicle_speed < -STEERING_SWEEP_MAX_SPEED
+		|| FirmwareUpdateBusy() )
+	{
+		Finish(ctx, STEERING_SWEEP_REJECTED);
+		return;
+	}
+
+	status->elapsed = 0;
+	status->left_code = 0;
+	status->right_code = 0;
+	status->span = 0.0f;
+	steering_sweep.last_time = ctx->current_time;
+	ResetDrive(ctx);
+	__atomic_store_n(&status->state, STEERING_SWEEP_SEEK, __ATOMIC_RELEASE);
+}
+
+//Steers at the sweep rate, up to the torque limit. Returns 1 once stalled
+//at a stop.
+static uint8_t Drive(main_context_t* ctx, uint8_t right, uint32_t dt)
+{
+	uint32_t window = ctx->current_time - steering_sweep.window_time;
+	if( window >= STEERING_SWEEP_RATE_WINDOW )
+	{
+		int32_t moved = (int32_t)ctx->steering_code - steering_sweep.window_code;
+		if( moved < 0 )
+			moved = -moved;
+		steering_sweep.rate = (float)moved * 1000.0f / window;
+		steering_sweep.window_time = ctx->current_time;
+		steering_sweep.window_code = ctx->steering_code;
+	}
+
+	//integral only, the motor needs its breakaway torque before anything moves
+	float torque = steering_sweep.torque + STEERING_SWEEP_TORQUE_GAIN * (STEERING_SWEEP_RATE - steering_sweep.rate) * dt;
+	if( torque < 0.0f )
+		torque = 0.0f;
+	if( torque >= STEERING_SWEEP_MAX_TORQUE )
+	{
+		torque = STEERING_SWEEP_MAX_TORQUE;
+		steering_sweep.stalled = steering_sweep.rate < STEERING_SWEEP_STALL_RATE ? steering_sweep.stalled + dt : 0;
+	}
+	else
+		steering_sweep.stalled = 0;
+	steering_sweep.torque = torque;
+
+	actuator_command_t* out = &ctx->actuators;
+	out->steer_right = right;
+	out->steering_torque = torque;
+	return steering_sweep.stalled >= STEERING_SWEEP_STALL_TIME;
+}
+
+static void BeginSweep(main_context_t* ctx)
+{
+	steering_sweep_status_t* status = &steering_sweep.status;
+	status->right_code = ctx->steering_code;
+	uint16_t left = status->left_code;
+	uint16_t right = status->right_code;
+	steering_sweep.low_code = left < right ? left : right;
+	steering_sweep.high_code = left < right ? right : left;
+	steering_sweep.sweep_count = ctx->steering_encoder_count;
+	memset(steering_sweep.bins, 0, sizeof(steering_sweep.bins));
+	ResetDrive(ctx);
+}
+
+static void Bin(const main_context_t* ctx)
+{
+	uint16_t code = ctx->steering_code;
+	if( code < steering_sweep.low_code || code > steering_sweep.high_code )
+		return;
+
+	uint32_t index = (uint32_t)(code - steering_sweep.low_code) * STEERING_SWEEP_BINS
+		/ ((uint32_t)(steering_sweep.high_code - steering_sweep.low_code) + 1);
+	steering_sweep_bin_t* bin = &steering_sweep.bins[index];
+	bin->samples++;
+	bin->code_sum += code;
+	bin->count_sum += (float)(ctx->steering_encoder_count - steering_sweep.sweep_count);
+}
+
+//Pool adjacent violators: the nearest non-decreasing values in the least
+//squares sense, each run that decreases replaced by its mean
+static void MakeIncreasing(float* values, uint32_t count)
+{
+	static float means[STEERING_CALIBRATION_MAX_POINTS];
+	static uint8_t sizes[STEERING_CALIBRATION_MAX_POINTS];
+	uint32_t blocks = 0;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		means[blocks] = values[i];
+		sizes[blocks] = 1;
+		blocks++;
+		while( blocks > 1 && means[blocks-2] > means[blocks-1] )
+		{
+			uint8_t size = sizes[blocks-2] + sizes[blocks-1];
+			means[blocks-2] = (means[blocks-2] * sizes[blocks-2] + means[blocks-1] * sizes[blocks-1]) / size;
+			sizes[blocks-2] = size;
+			blocks--;
+		}
+	}
+
+	uint32_t i = 0;
+	for(uint32_t b = 0; b < blocks; ++b)
+	{
+		for(uint8_t k = 0; k < sizes[b]; ++k)
+			values[i++] = means[b];
+	}
+}
+
+//The record from the bins, once the sweep is at the left stop again.
+//Returns 0 if the travel does not make a table.
+static uint8_t Fit(main_context_t* ctx)
+{
+	steering_sweep_status_t* status = &steering_sweep.status;
+	steering_calibration_t* record = &steering_sweep.record;
+	//this pass's left stop
+	status->left_code = ctx->steering_code;
+	uint16_t low = status->left_code < status->right_code ? status->left_code : status->right_code;
+	uint16_t high = status->left_code < status->right_code ? status->right_code : status->left_code;
+	if( high - low < STEERING_SWEEP_MIN_SPAN )
+		return 0;
+
+	//right stop to left, in encoder counts
+	int32_t travel = ctx->steering_encoder_count - steering_sweep.sweep_count;
+#if STEERING_ENCODER_ENABLE
+	if( travel == 0 )
+		return 0;
+	float span = (float)(travel < 0 ? -travel : travel) / STEERING_ENCODER_COUNTS_PER_DEGREE;
+	status->span = span;
+#else
+	float span = 2.0f * STEERING_SWEEP_LOCK_ANGLE;
+#endif
+	float half = span * 0.5f;
+	//the left stop is positive
+	float low_position = low == status->left_code ? half : -half;
+
+	uint32_t count = 0;
+	record->voltages[count] = Volts(low);
+	record->positions[count++] = low_position;
+#if STEERING_ENCODER_ENABLE
+	for(uint32_t i = 0; i < STEERING_SWEEP_BINS; ++i)
+	{
+		const steering_sweep_bin_t* bin = &steering_sweep.bins[i];
+		if( bin->samples < STEERING_SWEEP_MIN_BIN_SAMPLES )
+			continue;
+		float voltage = Volts(bin->code_sum / bin->samples);
+		if( !(voltage > record->voltages[count-1]) || !(voltage < Volts(high)) )
+			continue;
+		record->voltages[count] = voltage;
+		record->positions[count++] = -half + span * (bin->count_sum / bin->samples) / (float)travel;
+	}
+#else
+	(void)travel;
+#endif
+	record->voltages[count] = Volts(high);
+	record->positions[count++] = -low_position;
+
+	//the encoder and the potentiometer disagree a little from bin to bin
+	if( low_position > 0.0f )
+	{
+		for(uint32_t i = 0; i < count; ++i)
+			record->positions[i] = -record->positions[i];
+		MakeIncreasing(record->positions, count);
+		for(uint32_t i = 0; i < count; ++i)
+			record->positions[i] = -record->positions[i];
+	}
+	else
+		MakeIncreasing(record->positions, count);
+
+	record->count = count;
+	SteeringCalibrationSeal(record);
+	return 1;
+}
+
+void SteeringSweepRequestStart()
+{
+	__atomic_store_n(&steering_sweep.request, STEERING_SWEEP_REQUEST_START, __ATOMIC_RELEASE);
+}
+
+void SteeringSweepRequestAbort()
+{
+	__atomic_store_n(&steering_sweep.request, STEERING_SWEEP_REQUEST_ABORT, __ATOMIC_RELEASE);
+}
+
+uint8_t SteeringSweepCondition(main_context_t* ctx)
+{
+	uint8_t request = __atomic_exchange_n(&steering_sweep.request, STEERING_SWEEP_REQUEST_NONE, __ATOMIC_ACQUIRE);
+	steering_sweep_status_t* status = &steering_sweep.status;
+	if( status->state != STEERING_SWEEP_IDLE )
+	{
+		//the mode was taken a cycle after the start, anything else took over
+		//since. A save that started runs to its end.
+		if( status->state != STEERING_SWEEP_SAVING
+			&& (request == STEERING_SWEEP_REQUEST_ABORT || ctx->mode.mode != VEHICLE_MODE_CALIBRATE) )
+			Finish(ctx, STEERING_SWEEP_ABORTED);
+	}
+	else if( request == STEERING_SWEEP_REQUEST_START )
+		Start(ctx);
+	return status->state != STEERING_SWEEP_IDLE;
+}
+
+void SteeringSweepSteer(main_context_t* ctx)
+{
+	steering_sweep_status_t* status = &steering_sweep.status;
+	uint32_t dt = ctx->current_time - steering_sweep.last_time;
+	steering_sweep.last_time = ctx->current_time;
+	status->elapsed = ctx->current_time - steering_sweep.started;
+
+	if( status->state != STEERING_SWEEP_SAVING && status->elapsed > STEERING_SWEEP_TIMEOUT )
+		Finish(ctx, STEERING_SWEEP_TIMED_OUT);
+
+	//each stage returns while it steers, the steering is off for a cycle
+	//between two of them and once the sweep stops
+	switch( status->state )
+	{
+	case STEERING_SWEEP_SEEK:
+		if( !Drive(ctx, 0, dt) )
+			return;
+		status->left_code = ctx->steering_code;
+		ResetDrive(ctx);
+		status->state = STEERING_SWEEP_FIND;
+		break;
+	case STEERING_SWEEP_FIND:
+		if( !Drive(ctx, 1, dt) )
+			return;
+		BeginSweep(ctx);
+		status->state = STEERING_SWEEP_SWEEP;
+		break;
+	case STEERING_SWEEP_SWEEP:
+		Bin(ctx);
+		if( !Drive(ctx, 0, dt) )
+			return;
+		if( !Fit(ctx) )
+		{
+			Finish(ctx, STEERING_SWEEP_NO_TRAVEL);
+			break;
+		}
+		ResetDrive(ctx);
+		status->state = STEERING_SWEEP_CENTER;
+		break;
+	case STEERING_SWEEP_CENTER:
+	{
+		uint16_t center = (uint16_t)(((uint32_t)status->left_code + status->right_code) / 2);
+		//from the left stop toward the right one until past the middle
+		uint8_t past = status->left_code < status->right_code ? ctx->steering_code >= center : ctx->steering_code <= center;
+		if( !past && !Drive(ctx, 1, dt) )
+			return;
+		steering_sweep.saved = STEERING_SWEEP_SAVE_PENDING;
+		__atomic_store_n(&status->state, STEERING_SWEEP_SAVING, __ATOMIC_RELEASE);
+		break;
+	}
+	case STEERING_SWEEP_SAVING:
+	{
+		uint8_t saved = __atomic_load_n(&steering_sweep.saved, __ATOMIC_ACQUIRE);
+		if( saved == STEERING_SWEEP_SAVE_PENDING )
+			break;
+		//the table is rebuilt from what is in the flash now
+		if( saved == STEERING_SWEEP_SAVE_OK
+			&& SteeringCalibrationLoadRecord((const steering_calibration_t*)STEERING_CALIBRATION_NVM_ADDRESS) == 0 )
+			Finish(ctx, STEERING_SWEEP_DONE);
+		else
+			Finish(ctx, STEERING_SWEEP_FLASH_ERROR);
+		break;
+	}
+	default:
+		break;
+	}
+	ctx->actuators.steering_torque = 0.0f;
+}
+
+void SteeringSweepService()
+{
+	if( __atomic_load_n(&steering_sweep.status.state, __ATOMIC_ACQUIRE) != STEERING_SWEEP_SAVING
+		|| __atomic_load_n(&steering_sweep.saved, __ATOMIC_ACQUIRE) != STEERING_SWEEP_SAVE_PENDING )
+		return;
+
+	uint8_t saved = SteeringCalibrationSave(&steering_sweep.record) == 0 ? STEERING_SWEEP_SAVE_OK : STEERING_SWEEP_SAVE_FAILED;
+	__atomic_store_n(&steering_sweep.saved, saved, __ATOMIC_RELEASE);
+}
+
+void SteeringSweepStatus(steering_sweep_status_t* status)
+{
+	*status = steering_sweep.status;
+}
+
+#else
+
+void SteeringSweepRequestStart()
+{
+}
+
+void SteeringSweepRequestAbort()
+{
+}
+
+uint8_t SteeringSweepCondition(struct main_context_t* ctx)
+{
+	return 0;
+}
+
+void SteeringSweepSteer(struct main_context_t* ctx)
+{
+}
+
+void SteeringSweepService()
+{
+}
+
+void SteeringSweepStatus(steering_sweep_status_t* status)
+{
+	memset(status, 0, sizeof(*status));
+}
+
+#endif
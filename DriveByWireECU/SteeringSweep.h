@@ -0,0 +1,178 @@
+/*
+ * SteeringSweep.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef STEERINGSWEEP_H_
+#define STEERINGSWEEP_H_
+
+#include <stdint.h>
+#include "SteeringCalibration.h"
+
+//Measures the steering calibration (SteeringCalibration.h) on the cart in
+//about a minute: drives the steering from stop to stop under a torque
+//limit, bins the potentiometer on the way and writes the table it fits to
+//NVM.
+//
+//A start comes over the control channel (the calibration request,
+//ControlProtocol.h) and is only taken up while the cart is Disabled and
+//standing, with no command in force and no firmware update running. The
+//sweep then holds the cart in the Calibrate mode (VehicleMode.h), the front
+//brake at the parking pressure, and in it
+//
+//	seek	steers left until the steering stalls at the stop
+//	find	steers right to the other stop, which gives the range
+//	sweep	steers back left, binning every cycle's sample
+//	center	steers right again until the potentiometer is midway
+//
+//The torque rises from 0 until the potentiometer moves at
+//STEERING_SWEEP_RATE and never goes past STEERING_SWEEP_MAX_TORQUE, which
+//is all a stop ever gets. A stop is where the torque sits at the limit and
+//the potentiometer moves less than STEERING_SWEEP_STALL_RATE for
+//STEERING_SWEEP_STALL_TIME.
+//
+//With STEERING_ENCODER_ENABLE the encoder (SteeringEncoder.h) places the
+//samples: each of the STEERING_SWEEP_BINS bins of the range gets the mean
+//code and encoder count of the sweep's samples in it, in degrees from the
+//center midway between the stops. The table is the two stops and every bin
+//with samples, made monotonic. Without the encoder nothing places the codes
+//in between and the table is the two stops at +-STEERING_SWEEP_LOCK_ANGLE.
+//Left is positive, as in the steering commands.
+//
+//The idle hook writes the record (SteeringCalibrationSave) and main_task
+//loads it from NVM once it reads back. A stop not met within
+//STEERING_SWEEP_TIMEOUT, the estop, tele operation or an abort request end
+//the sweep with the steering off and the table as it was. The end of every
+//sweep is an EVENT_LOG_CALIBRATION entry.
+
+#ifndef STEERING_SWEEP_ENABLE
+#define STEERING_SWEEP_ENABLE 0
+#endif
+
+//Share of full steering torque the sweep never goes past
+#ifndef STEERING_SWEEP_MAX_TORQUE
+#define STEERING_SWEEP_MAX_TORQUE 0.25f
+#endif
+
+//Potentiometer rate the sweep steers at, fine codes (AdcSamplerReadFine)
+//per s, about 10 deg/s with the potentiometer over half its range
+#ifndef STEERING_SWEEP_RATE
+#define STEERING_SWEEP_RATE 3000.0f
+#endif
+
+//Torque per fine code/s short of the rate, per ms. Reaches the limit from
+//standing in about 300 ms.
+#ifndef STEERING_SWEEP_TORQUE_GAIN
+#define STEERING_SWEEP_TORQUE_GAIN (1.0f / 3600000.0f)
+#endif
+
+//ms the rate is measured over, so the noise of a sample is spread over many
+#ifndef STEERING_SWEEP_RATE_WINDOW
+#define STEERING_SWEEP_RATE_WINDOW 50
+#endif
+
+//fine codes/s below which the steering counts as stalled
+#ifndef STEERING_SWEEP_STALL_RATE
+#define STEERING_SWEEP_STALL_RATE 200.0f
+#endif
+
+//ms stalled at the torque limit that make a stop
+#ifndef STEERING_SWEEP_STALL_TIME
+#define STEERING_SWEEP_STALL_TIME 300
+#endif
+
+//ms from the start until the steering is centered again
+#ifndef STEERING_SWEEP_TIMEOUT
+#define STEERING_SWEEP_TIMEOUT 60000
+#endif
+
+//fine codes the stops have to be apart at least
+#ifndef STEERING_SWEEP_MIN_SPAN
+#define STEERING_SWEEP_MIN_SPAN 4096
+#endif
+
+//m/s the cart may be moving at when asked to start
+#ifndef STEERING_SWEEP_MAX_SPEED
+#define STEERING_SWEEP_MAX_SPEED 0.05f
+#endif
+
+//deg of either stop from the center, without STEERING_ENCODER_ENABLE
+#ifndef STEERING_SWEEP_LOCK_ANGLE
+#define STEERING_SWEEP_LOCK_ANGLE 50.0f
+#endif
+
+//Bins of the range, the table has the two stops besides
+#define STEERING_SWEEP_BINS (STEERING_CALIBRATION_MAX_POINTS - 2)
+
+//samples a bin needs to become a point
+#ifndef STEERING_SWEEP_MIN_BIN_SAMPLES
+#define STEERING_SWEEP_MIN_BIN_SAMPLES 8
+#endif
+
+typedef enum steering_sweep_state_t
+{
+	STEERING_SWEEP_IDLE = 0,
+	STEERING_SWEEP_SEEK,
+	STEERING_SWEEP_FIND,
+	STEERING_SWEEP_SWEEP,
+	STEERING_SWEEP_CENTER,
+	//stopped, the idle hook writes the record
+	STEERING_SWEEP_SAVING,
+} steering_sweep_state_t;
+
+//Also the arg of EVENT_LOG_CALIBRATION, value: ms the sweep ran
+typedef enum steering_sweep_result_t
+{
+	//no sweep since boot
+	STEERING_SWEEP_NONE = 0,
+	//the new table is in NVM and in use
+	STEERING_SWEEP_DONE,
+	//not Disabled, moving, commanded or a firmware update running
+	STEERING_SWEEP_REJECTED,
+	//the estop, tele operation or an abort request
+	STEERING_SWEEP_ABORTED,
+	STEERING_SWEEP_TIMED_OUT,
+	//the stops are less than STEERING_SWEEP_MIN_SPAN apart, or the encoder
+	//did not count
+	STEERING_SWEEP_NO_TRAVEL,
+	//the record did not read back, the table is as it was
+	STEERING_SWEEP_FLASH_ERROR,
+} steering_sweep_result_t;
+
+typedef struct steering_sweep_status_t
+{
+	steering_sweep_state_t state;
+	//of the last sweep to end
+	steering_sweep_result_t result;
+	//ms since the start, of the last sweep once it ended
+	uint32_t elapsed;
+	//fine codes at the stops, 0 until found
+	uint16_t left_code;
+	uint16_t right_code;
+	//deg from stop to stop, measured with STEERING_ENCODER_ENABLE
+	float span;
+} steering_sweep_status_t;
+
+struct main_context_t;
+
+//Asks for a sweep, or to end the one running. Any task, main_task takes
+//them up in its next cycle.
+void SteeringSweepRequestStart();
+void SteeringSweepRequestAbort();
+
+//Takes up a request and ends the sweep if the mode is not Calibrate. 1
+//while the sweep wants the mode, VEHICLE_CONDITION_CALIBRATE. From the
+//control stage, before the mode update.
+uint8_t SteeringSweepCondition(struct main_context_t* ctx);
+
+//The steering outputs of the Calibrate mode, from its handler
+void SteeringSweepSteer(struct main_context_t* ctx);
+
+//Writes the record once the sweep is saving. From the idle hook.
+void SteeringSweepService();
+
+//Any task, the fields are copied one at a time
+void SteeringSweepStatus(steering_sweep_status_t* status);
+
+#endif /* STEERINGSWEEP_H_ */
@@ -0,0 +1,123 @@
+/*
+ * SysArchBenchmark.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <compiler.h>
+#include "SysArchBenchmark.h"
+#include "lwip/sys.h"
+#include "lwip/pbuf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Log.h"
+
+#define SYS_ARCH_BENCHMARK_ITERATIONS 1000
+
+static void BenchEnableCycleCounter()
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t BenchmarkSysArchProtect(uint32_t iterations)
+{
+	BenchEnableCycleCounter();
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		SYS_ARCH_DECL_PROTECT(level);
+		SYS_ARCH_PROTECT(level);
+		SYS_ARCH_UNPROTECT(level);
+	}
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkKernelCritical(uint32_t iterations)
+{
+	BenchEnableCycleCounter();
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		vPortEnterCritical();
+		vPortExitCritical();
+	}
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkPoolPbuf(uint32_t iterations)
+{
+	BenchEnableCycleCounter();
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		struct pbuf* p = pbuf_alloc(PBUF_RAW, 64, PBUF_POOL);
+		if( p == NULL )
+			return 0;
+		pbuf_free(p);
+	}
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkSysSem(uint32_t iterations)
+{
+	sys_sem_t sem;
+
+	BenchEnableCycleCounter();
+	if( iterations == 0 || sys_sem_new(&sem, 0) != ERR_OK )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		sys_sem_signal(&sem);
+		sys_arch_sem_wait(&sem, 1);
+	}
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	sys_sem_free(&sem);
+	return cycles / iterations;
+}
+
+uint32_t BenchmarkTaskNotify(uint32_t iterations)
+{
+	TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+	BenchEnableCycleCounter();
+	if( iterations == 0 )
+		return 0;
+
+	uint32_t start = DWT->CYCCNT;
+	for(uint32_t n = 0; n < iterations; ++n)
+	{
+		xTaskNotifyGive(self);
+		ulTaskNotifyTake(pdTRUE, 0);
+	}
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	return cycles / iterations;
+}
+
+void ReportSysArchBenchmark(void)
+{
+	LOG("sys_arch protect: %lu cycles, kernel critical: %lu cycles",
+		BenchmarkSysArchProtect(SYS_ARCH_BENCHMARK_ITERATIONS), BenchmarkKernelCritical(SYS_ARCH_BENCHMARK_ITERATIONS));
+	LOG("pool pbuf alloc/free: %lu cycles", BenchmarkPoolPbuf(SYS_ARCH_BENCHMARK_ITERATIONS));
+	LOG("sys_sem signal/wait: %lu cycles, task notify give/take: %lu cycles",
+		BenchmarkSysSem(SYS_ARCH_BENCHMARK_ITERATIONS), BenchmarkTaskNotify(SYS_ARCH_BENCHMARK_ITERATIONS));
+}
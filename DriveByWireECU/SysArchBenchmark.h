@@ -0,0 +1,40 @@
+/*
+ * SysArchBenchmark.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef SYSARCHBENCHMARK_H_
+#define SYSARCHBENCHMARK_H_
+
+#include <stdint.h>
+
+//Set to 1 to log the cost of the lwIP port primitives once lwIP is up.
+//Each result is the average number of core cycles per pair, measured with
+//the DWT cycle counter from the calling task.
+#ifndef SYS_ARCH_BENCHMARK
+#define SYS_ARCH_BENCHMARK 0
+#endif
+
+//sys_arch_protect/sys_arch_unprotect, the BASEPRI region behind
+//SYS_LIGHTWEIGHT_PROT
+uint32_t BenchmarkSysArchProtect(uint32_t iterations);
+
+//vPortEnterCritical/vPortExitCritical, what sys_arch_protect used to be
+uint32_t BenchmarkKernelCritical(uint32_t iterations);
+
+//pbuf_alloc/pbuf_free of a pool pbuf, the allocation every received frame
+//makes
+uint32_t BenchmarkPoolPbuf(uint32_t iterations);
+
+//sys_sem_signal/sys_arch_sem_wait on a semaphore that is never contended
+uint32_t BenchmarkSysSem(uint32_t iterations);
+
+//xTaskNotifyGive/ulTaskNotifyTake on the calling task, the same handoff as
+//BenchmarkSysSem without a queue behind it
+uint32_t BenchmarkTaskNotify(uint32_t iterations);
+
+//Logs every result. Must be called from a task after lwIP is initialized.
+void ReportSysArchBenchmark(void);
+
+#endif /* SYSARCHBENCHMARK_H_ */
@@ -0,0 +1,276 @@
+/*
+ * TaskMonitor.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hri_tc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include "TaskMonitor.h"
+#include "task.h"
+#include "timers.h"
+#include "task_config.h"
+#include "EventLog.h"
+#include "DriveByWireIO.h"
+#include "Log.h"
+#include "TimerClaims.h"
+#include "Seqlock.h"
+
+#if configGENERATE_RUN_TIME_STATS
+
+//The run time counter's TC, the one TimerClaims.h leaves free
+#define TASK_MONITOR_PASTE_(a, b, c) a##b##c
+#define TASK_MONITOR_PASTE(a, b, c) TASK_MONITOR_PASTE_(a, b, c)
+#define TASK_MONITOR_TC TASK_MONITOR_PASTE(TC, TIMER_RUN_TIME_TC, )
+#define TASK_MONITOR_TC_GCLK_ID TASK_MONITOR_PASTE(TC, TIMER_RUN_TIME_TC, _GCLK_ID)
+#define TASK_MONITOR_TC_IRQn TASK_MONITOR_PASTE(TC, TIMER_RUN_TIME_TC, _IRQn)
+#define TASK_MONITOR_TC_Handler TASK_MONITOR_PASTE(TC, TIMER_RUN_TIME_TC, _Handler)
+#endif
+
+//The TC is clocked like the PWM timers. A prescaler of 256 puts 12MHz at
+//about 47 times the tick rate.
+#define TASK_MONITOR_PRESCALER TC_CTRLA_PRESCALER_DIV256
+#define TASK_MONITOR_COUNTER_HZ (CONF_GCLK_TC0_FREQUENCY / 256)
+
+#if TASK_MONITOR_COUNTER_HZ < 10 * configTICK_RATE_HZ || TASK_MONITOR_COUNTER_HZ > 100 * configTICK_RATE_HZ
+#error TASK_MONITOR_PRESCALER does not give 10 to 100 run time counts per tick
+#endif
+
+//The TC counts 16 bits, the overflow interrupt supplies the rest
+#define TASK_MONITOR_COUNTER_BITS 16
+
+//tskSTACK_FILL_BYTE of the kernel's stack painting, in every byte
+#define TASK_MONITOR_STACK_FILL 0xA5A5A5A5UL
+
+//Bytes below the stack pointer left alone when painting, for the frame
+//of the painting itself
+#define TASK_MONITOR_PAINT_MARGIN 256
+
+//The linker script's main stack
+extern uint32_t _sstack;
+extern uint32_t _estack;
+
+static volatile uint32_t counter_overflows;
+
+//Written by the monitor task only, read under snapshot_sequence (Seqlock.h)
+static uint32_t snapshot_sequence;
+static task_monitor_snapshot_t snapshot;
+
+#if configGENERATE_RUN_TIME_STATS
+void vConfigureTimerForRunTimeStats(void)
+{
+#if TIMER_RUN_TIME_TC < 2
+	hri_mclk_set_APBAMASK_reg(MCLK, TIMER_RUN_TIME_TC ? MCLK_APBAMASK_TC1 : MCLK_APBAMASK_TC0);
+#elif TIMER_RUN_TIME_TC < 4
+	hri_mclk_set_APBBMASK_reg(MCLK, TIMER_RUN_TIME_TC == 3 ? MCLK_APBBMASK_TC3 : MCLK_APBBMASK_TC2);
+#elif TIMER_RUN_TIME_TC < 6
+	hri_mclk_set_APBCMASK_reg(MCLK, TIMER_RUN_TIME_TC == 5 ? MCLK_APBCMASK_TC5 : MCLK_APBCMASK_TC4);
+#else
+	hri_mclk_set_APBDMASK_reg(MCLK, TIMER_RUN_TIME_TC == 7 ? MCLK_APBDMASK_TC7 : MCLK_APBDMASK_TC6);
+#endif
+	//TCs share their peripheral channel in pairs, all clocked like the PWM
+	//timers
+	hri_gclk_write_PCHCTRL_reg(GCLK, TASK_MONITOR_TC_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+	hri_tc_write_CTRLA_reg(TASK_MONITOR_TC, TC_CTRLA_SWRST);
+	hri_tc_wait_for_sync(TASK_MONITOR_TC, TC_SYNCBUSY_SWRST);
+	//NFRQ toggles WO0 only, a WO1 the TC was a PWM on is not driven
+	hri_tc_write_WAVE_reg(TASK_MONITOR_TC, TC_WAVE_WAVEGEN_NFRQ);
+	hri_tc_set_INTEN_OVF_bit(TASK_MONITOR_TC);
+
+	//no kernel calls in the handler, any priority will do
+	NVIC_SetPriority(TASK_MONITOR_TC_IRQn, IRQ_PRIORITY_RUN_TIME_COUNTER);
+	NVIC_ClearPendingIRQ(TASK_MONITOR_TC_IRQn);
+	NVIC_EnableIRQ(TASK_MONITOR_TC_IRQn);
+	hri_tc_write_CTRLA_reg(TASK_MONITOR_TC, TC_CTRLA_MODE_COUNT16 | TASK_MONITOR_PRESCALER | TC_CTRLA_ENABLE);
+	hri_tc_wait_for_sync(TASK_MONITOR_TC, TC_SYNCBUSY_ENABLE);
+}
+
+//Once every 2^16 counts, about 1.4 s
+void TASK_MONITOR_TC_Handler(void)
+{
+	hri_tc_clear_INTFLAG_OVF_bit(TASK_MONITOR_TC);
+	counter_overflows++;
+}
+
+//Called by the kernel on every context switch
+uint32_t vGetRunTimeCounterValue(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	//COUNT is only readable after a read synchronization
+	hri_tc_set_CTRLB_CMD_bf(TASK_MONITOR_TC, TC_CTRLBSET_CMD_READSYNC_Val);
+	hri_tc_wait_for_sync(TASK_MONITOR_TC, TC_SYNCBUSY_CTRLB | TC_SYNCBUSY_COUNT);
+	uint32_t count = hri_tccount16_read_COUNT_reg(TASK_MONITOR_TC);
+	uint32_t overflows = counter_overflows;
+
+	//an overflow the handler has not seen yet, if count already wrapped
+	if( hri_tc_get_INTFLAG_OVF_bit(TASK_MONITOR_TC) && count < (1UL << (TASK_MONITOR_COUNTER_BITS - 1)) )
+		overflows++;
+
+	__set_PRIMASK(primask);
+	return (overflows << TASK_MONITOR_COUNTER_BITS) | count;
+}
+#endif
+
+//configCHECK_FOR_STACK_OVERFLOW, a task ran past its stack. Called on the
+//main stack from the context switch. Nothing can be trusted any more, stop
+//before the outputs are driven from corrupted state. The interrupts stay
+//masked with the watchdog's early warning, the WDT resets the ECU.
+void vApplicationStackOverflowHook(TaskHandle_t task, signed char* name)
+{
+	taskDISABLE_INTERRUPTS();
+	ForceBrakeOutputs();
+
+	//the event log holds no strings, the first 4 characters of the name
+	uint32_t prefix = 0;
+	for(int i = 0; i < 4 && name[i]; ++i)
+		prefix |= (uint32_t)(uint8_t)name[i] << (8 * i);
+	EventLogWrite(EVENT_LOG_STACK_OVERFLOW, (uint16_t)uxTaskGetTaskNumber(task), prefix);
+	for(;;)
+		;
+}
+
+void TaskMonitorPaintInterruptStack()
+{
+	uint32_t* end = (uint32_t*)(__get_MSP() - TASK_MONITOR_PAINT_MARGIN);
+	for(uint32_t* word = &_sstack; word < end; ++word)
+		*word = TASK_MONITOR_STACK_FILL;
+}
+
+//Words of the main stack that never were written, from its bottom
+static uint16_t InterruptStackFree()
+{
+	const volatile uint32_t* word = &_sstack;
+	while( word < &_estack && *word == TASK_MONITOR_STACK_FILL )
+		++word;
+	return (uint16_t)(word - &_sstack);
+}
+
+//Logs the least free stack of every task, on every report and for a task
+//that falls below TASK_MONITOR_STACK_WARN the first time it is seen there
+static void ReportStacks(const TaskStatus_t* status, UBaseType_t count, uint16_t interrupt_free, uint8_t report)
+{
+	//bit n set for task number n once it was warned about
+	static uint32_t warned;
+
+	if( report )
+		LOG("task monitor: interrupt stack %lu words free", (uint32_t)interrupt_free);
+	for(UBaseType_t i = 0; i < count; ++i)
+	{
+		const TaskStatus_t* task = &status[i];
+		uint32_t bit = task->xTaskNumber < 32 ? 1UL << task->xTaskNumber : 0;
+		if( task->usStackHighWaterMark < TASK_MONITOR_STACK_WARN && !(warned & bit) )
+		{
+			warned |= bit;
+			LOG("task monitor: %s down to %lu words of stack", task->pcTaskName, (uint32_t)task->usStackHighWaterMark);
+		}
+		else if( report )
+			LOG("task monitor: %s %lu words of stack free", task->pcTaskName, (uint32_t)task->usStackHighWaterMark);
+	}
+}
+
+static void PublishSnapshot(const task_monitor_snapshot_t* next)
+{
+	SeqlockWriteBegin(&snapshot_sequence);
+	snapshot = *next;
+	SeqlockWriteEnd(&snapshot_sequence);
+}
+
+//Counters at the last sample, by task number. Only the timer service
+//touches them.
+typedef struct task_monitor_sampler_t
+{
+	TaskStatus_t status[TASK_MONITOR_MAX_TASKS];
+	task_monitor_snapshot_t next;
+	uint32_t last_run_time[TASK_MONITOR_MAX_TASKS];
+	uint8_t last_number[TASK_MONITOR_MAX_TASKS];
+	uint8_t last_count;
+	uint32_t last_total;
+	uint32_t periods;
+} task_monitor_sampler_t;
+
+static task_monitor_sampler_t sampler;
+
+//Runs in the timer service every TASK_MONITOR_PERIOD
+static void TaskMonitorSample(TimerHandle_t timer)
+{
+	TaskStatus_t* status = sampler.status;
+	task_monitor_snapshot_t* next = &sampler.next;
+
+	uint32_t total;
+	UBaseType_t count = uxTaskGetSystemState(status, TASK_MONITOR_MAX_TASKS, &total);
+	//0 when there are more tasks than slots, the snapshot would be partial
+	if( count == 0 )
+		return;
+
+	uint32_t elapsed = total - sampler.last_total;
+	next->period = (uint32_t)((uint64_t)elapsed * 1000 / TASK_MONITOR_COUNTER_HZ);
+	next->interrupt_stack_free = InterruptStackFree();
+	next->count = (uint8_t)count;
+	for(UBaseType_t i = 0; i < count; ++i)
+	{
+		const TaskStatus_t* task = &status[i];
+		task_monitor_entry_t* entry = &next->tasks[i];
+
+		//a task created since the last sample has run from 0
+		uint32_t previous = 0;
+		for(uint8_t j = 0; j < sampler.last_count; ++j)
+		{
+			if( sampler.last_number[j] == (uint8_t)task->xTaskNumber )
+			{
+				previous = sampler.last_run_time[j];
+				break;
+			}
+		}
+
+		strncpy(entry->name, task->pcTaskName, configMAX_TASK_NAME_LEN);
+		entry->number = (uint8_t)task->xTaskNumber;
+		entry->priority = (uint8_t)task->uxBasePriority;
+		entry->load = elapsed == 0 ? 0 : (uint16_t)((uint64_t)(task->ulRunTimeCounter - previous) * 1000 / elapsed);
+		entry->stack_free = task->usStackHighWaterMark;
+	}
+
+	for(UBaseType_t i = 0; i < count; ++i)
+	{
+		sampler.last_number[i] = (uint8_t)status[i].xTaskNumber;
+		sampler.last_run_time[i] = status[i].ulRunTimeCounter;
+	}
+	sampler.last_count = (uint8_t)count;
+
+	++sampler.periods;
+#if TASK_MONITOR_STACK_REPORT
+	ReportStacks(status, count, next->interrupt_stack_free, sampler.periods % TASK_MONITOR_STACK_REPORT == 0);
+#else
+	ReportStacks(status, count, next->interrupt_stack_free, 0);
+#endif
+
+	//the first pass only has a baseline
+	if( sampler.last_total != 0 )
+		PublishSnapshot(next);
+	sampler.last_total = total;
+}
+
+void TaskMonitorStart()
+{
+	memset(&snapshot, 0, sizeof(snapshot));
+	TimerHandle_t timer = xTimerCreate("TaskMon", pdMS_TO_TICKS(TASK_MONITOR_PERIOD), pdTRUE, NULL, TaskMonitorSample);
+	configASSERT(timer != NULL);
+	//queued for the timer service, which starts with the scheduler
+	xTimerStart(timer, 0);
+}
+
+void TaskMonitorRead(task_monitor_snapshot_t* copy)
+{
+	uint32_t sequence;
+
+	do
+	{
+		sequence = SeqlockReadBegin(&snapshot_sequence);
+		*copy = snapshot;
+	} while( SeqlockReadRetry(&snapshot_sequence, sequence) );
+}
@@ -0,0 +1,84 @@
+/*
+ * TaskMonitor.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TASKMONITOR_H_
+#define TASKMONITOR_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+
+//CPU load and stack use of every RTOS task.
+//The kernel charges run time to tasks from a counter on a TC no other
+//module takes (TimerClaims.h) running at TASK_MONITOR_COUNTER_HZ, far
+//finer than the 1 ms tick so short tasks are not rounded away. A timer in the low priority timer service (task_config.h)
+//turns the counters into a load per TASK_MONITOR_PERIOD and publishes a snapshot that the control channel
+//sends to the PC on request (ControlProtocol.h).
+//
+//configCHECK_FOR_STACK_OVERFLOW 2 has the kernel fill every task stack
+//with a known pattern, the least stack left free is how much of it is
+//still there. TaskMonitorPaintInterruptStack does the same to the main
+//stack, which the interrupts run on once the scheduler started. Every
+//TASK_MONITOR_STACK_REPORT periods the monitor logs the least free stack of
+//every task, and a task that falls below TASK_MONITOR_STACK_WARN is logged
+//at once. A task that overflows forces the brake on and the throttle off,
+//records EVENT_LOG_STACK_OVERFLOW and halts, the watchdog resets the ECU.
+
+//ms each snapshot covers
+#ifndef TASK_MONITOR_PERIOD
+#define TASK_MONITOR_PERIOD 1000
+#endif
+
+//Tasks beyond this are left out of the snapshot
+#ifndef TASK_MONITOR_MAX_TASKS
+#define TASK_MONITOR_MAX_TASKS 12
+#endif
+
+//Periods between stack reports, 0 for none
+#ifndef TASK_MONITOR_STACK_REPORT
+#define TASK_MONITOR_STACK_REPORT 60
+#endif
+
+//Words of free stack below which a task is logged as soon as it is seen
+#ifndef TASK_MONITOR_STACK_WARN
+#define TASK_MONITOR_STACK_WARN 32
+#endif
+
+typedef struct task_monitor_entry_t
+{
+	char name[configMAX_TASK_NAME_LEN];
+	uint8_t number;
+	uint8_t priority;
+	//share of the period spent in the task, 1/1000
+	uint16_t load;
+	//least stack ever left free, in words
+	uint16_t stack_free;
+} task_monitor_entry_t;
+
+typedef struct task_monitor_snapshot_t
+{
+	//ms actually covered, 0 until the first period has passed
+	uint32_t period;
+	//least main stack ever left free, in words
+	uint16_t interrupt_stack_free;
+	uint8_t count;
+	task_monitor_entry_t tasks[TASK_MONITOR_MAX_TASKS];
+} task_monitor_snapshot_t;
+
+//Fills the unused part of the main stack with the pattern the kernel uses
+//for task stacks. Call first thing in main.
+void TaskMonitorPaintInterruptStack();
+
+//Creates and starts the monitor timer. Call before vTaskStartScheduler.
+void TaskMonitorStart();
+
+//Copies the newest snapshot, safe from any task
+void TaskMonitorRead(task_monitor_snapshot_t* snapshot);
+
+//Run time stats clock for the kernel, see configGENERATE_RUN_TIME_STATS
+void vConfigureTimerForRunTimeStats(void);
+uint32_t vGetRunTimeCounterValue(void);
+
+#endif /* TASKMONITOR_H_ */
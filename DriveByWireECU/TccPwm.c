@@ -0,0 +1,242 @@
+/*
+ * TccPwm.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hal_gpio.h>
+#include <hri_evsys_e54.h>
+#include <hri_tcc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include "TccPwm.h"
+#include "EStopInput.h"
+#include "AdcSampler.h"
+#include "FastCode.h"
+#include "atmel_start_pins.h"
+
+#if TCC_PWM_ENABLE
+
+//EVSYS channels, 0 and 1 belong to WheelSpeed, 2 and 3 to AdcSampler
+#define TCC_PWM_FAULT_EVSYS 4
+
+//CTRLA RESOLUTION of the steering dither
+#if TCC_PWM_STEERING_DITHER == 0
+#define TCC_PWM_STEERING_RESOLUTION TCC_CTRLA_RESOLUTION_NONE
+#elif TCC_PWM_STEERING_DITHER == 4
+#define TCC_PWM_STEERING_RESOLUTION TCC_CTRLA_RESOLUTION_DITH4
+#elif TCC_PWM_STEERING_DITHER == 5
+#define TCC_PWM_STEERING_RESOLUTION TCC_CTRLA_RESOLUTION_DITH5
+#elif TCC_PWM_STEERING_DITHER == 6
+#define TCC_PWM_STEERING_RESOLUTION TCC_CTRLA_RESOLUTION_DITH6
+#else
+#error TCC_PWM_STEERING_DITHER must be 0, 4, 5 or 6
+#endif
+
+typedef struct tcc_pwm_channel_t
+{
+	Tcc* tcc;
+	uint8_t cc;
+	//the low bits of PER and CC that count dithered periods
+	uint8_t dither;
+	uint8_t overflow_trigger;
+} tcc_pwm_channel_t;
+
+//In tcc_pwm_output_t order
+static const tcc_pwm_channel_t tcc_pwm_channels[TCC_PWM_OUTPUT_COUNT] =
+{
+	{ TCC0, 0, TCC_PWM_STEERING_DITHER, TCC0_DMAC_ID_OVF },
+	{ TCC1, 0, 0, TCC1_DMAC_ID_OVF },
+};
+
+//what TccPwmRecover checks before letting go of a fault, CC as written
+static volatile uint32_t tcc_pwm_duty[TCC_PWM_OUTPUT_COUNT];
+//ticks per period, as TccPwmInit got them
+static uint16_t tcc_pwm_periods[TCC_PWM_OUTPUT_COUNT];
+
+//Estop pressed, the input low, is an event for as long as it lasts. The
+//EIC side is EStopInputInit's.
+static void InitFaultInput()
+{
+	hri_mclk_set_APBBMASK_EVSYS_bit(MCLK);
+	hri_evsys_write_CHANNEL_reg(EVSYS, TCC_PWM_FAULT_EVSYS,
+		EVSYS_CHANNEL_EVGEN(EVSYS_ID_GEN_EIC_EXTINT_0 + ESTOP_INPUT_EXTINT) | EVSYS_CHANNEL_PATH_ASYNCHRONOUS);
+	hri_evsys_write_USER_reg(EVSYS, EVSYS_ID_USER_TCC0_EV_1, TCC_PWM_FAULT_EVSYS + 1);
+	hri_evsys_write_USER_reg(EVSYS, EVSYS_ID_USER_TCC1_EV_1, TCC_PWM_FAULT_EVSYS + 1);
+}
+
+static void InitPin(uint32_t pin, uint32_t pinmux)
+{
+	//low until the TCC drives it
+	gpio_set_pin_level(pin, 0);
+	gpio_set_pin_direction(pin, GPIO_DIRECTION_OUT);
+	gpio_set_pin_function(pin, pinmux);
+}
+
+//Single slope PWM, high from the start of the period to the compare match.
+//drvctrl holds the non-recoverable fault enables of the outputs in use, the
+//fault value they are forced to is 0. evctrl adds to the estop fault on
+//event input 1. With dither bits the period is above them, and their
+//count of dithered periods in PER is 0.
+static void InitTcc(Tcc* tcc, uint16_t period, uint32_t drvctrl, uint32_t wexctrl, uint32_t evctrl,
+	uint8_t dither, uint32_t resolution)
+{
+	hri_tcc_write_CTRLA_reg(tcc, TCC_CTRLA_SWRST);
+	hri_tcc_wait_for_sync(tcc, TCC_SYNCBUSY_SWRST);
+	hri_tcc_write_WAVE_reg(tcc, TCC_WAVE_WAVEGEN_NPWM);
+	hri_tcc_write_PER_reg(tcc, (uint32_t)(period - 1) << dither);
+	hri_tcc_write_CC_reg(tcc, 0, 0);
+	hri_tcc_write_DRVCTRL_reg(tcc, drvctrl);
+	hri_tcc_write_WEXCTRL_reg(tcc, wexctrl);
+	//overflow events always, AdcSampler may start its scans on TCC0's
+	hri_tcc_write_EVCTRL_reg(tcc, TCC_EVCTRL_TCEI1 | TCC_EVCTRL_EVACT1_FAULT | TCC_EVCTRL_OVFEO | evctrl);
+	hri_tcc_write_CTRLA_reg(tcc, resolution | TCC_CTRLA_PRESCALER_DIV1 | TCC_CTRLA_ENABLE);
+	hri_tcc_wait_for_sync(tcc, TCC_SYNCBUSY_ENABLE);
+}
+
+void TccPwmInit(uint16_t steering_period, uint16_t acceleration_period)
+{
+	for(int i = 0; i < TCC_PWM_OUTPUT_COUNT; ++i)
+		tcc_pwm_duty[i] = 0;
+	tcc_pwm_periods[TCC_PWM_STEERING_TORQUE] = steering_period;
+	tcc_pwm_periods[TCC_PWM_ACCELERATION] = acceleration_period;
+
+	hri_mclk_set_APBBMASK_TCC0_bit(MCLK);
+	hri_mclk_set_APBBMASK_TCC1_bit(MCLK);
+	//TCC0 and TCC1 share a peripheral channel, clocked like the PWM timers
+	hri_gclk_write_PCHCTRL_reg(GCLK, TCC0_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+	//the fault is routed before an output can go high, the EIC sends it
+	//from EStopInputInit on
+	InitFaultInput();
+
+#if ADC_SAMPLER_WINDOW_TRIP
+	//the ADC window monitor trips the steering on event input 0, AdcSampler
+	//routes it
+	uint32_t steering_evctrl = TCC_EVCTRL_TCEI0 | TCC_EVCTRL_EVACT0_FAULT;
+#else
+	uint32_t steering_evctrl = 0;
+#endif
+
+#if TCC_PWM_STEERING_DEAD_TIME
+	//WO4 is the complement of WO0, each side waits the dead time after the
+	//other turned off
+	InitTcc(TCC0, steering_period, TCC_DRVCTRL_NRE0 | TCC_DRVCTRL_NRE4,
+		TCC_WEXCTRL_DTIEN0 | TCC_WEXCTRL_DTLS(TCC_PWM_STEERING_DEAD_TIME) | TCC_WEXCTRL_DTHS(TCC_PWM_STEERING_DEAD_TIME), steering_evctrl,
+		TCC_PWM_STEERING_DITHER, TCC_PWM_STEERING_RESOLUTION);
+	InitPin(TCC_PWM_STEERING_LOW_PIN, TCC_PWM_STEERING_LOW_PINMUX);
+#else
+	InitTcc(TCC0, steering_period, TCC_DRVCTRL_NRE0, 0, steering_evctrl,
+		TCC_PWM_STEERING_DITHER, TCC_PWM_STEERING_RESOLUTION);
+#endif
+	InitPin(TCC_PWM_STEERING_PIN, TCC_PWM_STEERING_PINMUX);
+
+	InitTcc(TCC1, acceleration_period, TCC_DRVCTRL_NRE0, 0, 0, 0, TCC_CTRLA_RESOLUTION_NONE);
+	InitPin(TCC_PWM_ACCELERATION_PIN, TCC_PWM_ACCELERATION_PINMUX);
+}
+
+FAST_CODE uint32_t TccPwmCompare(tcc_pwm_output_t output, float duty_ticks)
+{
+	//ticks above the dither bits, the fraction in them
+	return duty_ticks > 0.0f ? (uint32_t)(duty_ticks * (float)(1UL << tcc_pwm_channels[output].dither)) : 0;
+}
+
+FAST_CODE void TccPwmSetDuty(tcc_pwm_output_t output, float duty_ticks)
+{
+	const tcc_pwm_channel_t* channel = &tcc_pwm_channels[output];
+	uint32_t cc = TccPwmCompare(output, duty_ticks);
+	tcc_pwm_duty[output] = cc;
+	hri_tcc_write_CCBUF_reg(channel->tcc, channel->cc, cc);
+}
+
+volatile uint32_t* TccPwmCompareBuffer(tcc_pwm_output_t output)
+{
+	const tcc_pwm_channel_t* channel = &tcc_pwm_channels[output];
+	return &channel->tcc->CCBUF[channel->cc].reg;
+}
+
+uint8_t TccPwmOverflowTrigger(tcc_pwm_output_t output)
+{
+	return tcc_pwm_channels[output].overflow_trigger;
+}
+
+float TccPwmFrequency(tcc_pwm_output_t output)
+{
+	return (float)CONF_GCLK_TC0_FREQUENCY / tcc_pwm_periods[output];
+}
+
+uint32_t TccPwmTicksToUpdate(tcc_pwm_output_t output)
+{
+	const tcc_pwm_channel_t* channel = &tcc_pwm_channels[output];
+	hri_tcc_set_CTRLB_CMD_bf(channel->tcc, TCC_CTRLBSET_CMD_READSYNC_Val);
+	hri_tcc_wait_for_sync(channel->tcc, TCC_SYNCBUSY_CTRLB);
+	//counts up to period - 1, above the dither bits like PER
+	return tcc_pwm_periods[output] - (hri_tcc_read_COUNT_reg(channel->tcc) >> channel->dither);
+}
+
+void TccPwmPause(tcc_pwm_output_t output, uint8_t paused)
+{
+	Tcc* tcc = tcc_pwm_channels[output].tcc;
+	hri_tcc_set_CTRLB_CMD_bf(tcc, paused ? TCC_CTRLBSET_CMD_STOP_Val : TCC_CTRLBSET_CMD_RETRIGGER_Val);
+	hri_tcc_wait_for_sync(tcc, TCC_SYNCBUSY_CTRLB);
+}
+
+FAST_CODE void TccPwmRecover()
+{
+	for(int i = 0; i < TCC_PWM_OUTPUT_COUNT; ++i)
+	{
+		Tcc* tcc = tcc_pwm_channels[i].tcc;
+		if( tcc_pwm_duty[i] != 0 )
+			continue;
+		if( hri_tcc_get_STATUS_FAULT1_bit(tcc) )
+			hri_tcc_clear_STATUS_FAULT1_bit(tcc);
+		if( hri_tcc_get_STATUS_FAULT0_bit(tcc) )
+			hri_tcc_clear_STATUS_FAULT0_bit(tcc);
+	}
+}
+
+#else
+
+void TccPwmInit(uint16_t steering_period, uint16_t acceleration_period)
+{
+}
+
+void TccPwmSetDuty(tcc_pwm_output_t output, float duty_ticks)
+{
+}
+
+uint32_t TccPwmCompare(tcc_pwm_output_t output, float duty_ticks)
+{
+	return 0;
+}
+
+volatile uint32_t* TccPwmCompareBuffer(tcc_pwm_output_t output)
+{
+	return NULL;
+}
+
+uint8_t TccPwmOverflowTrigger(tcc_pwm_output_t output)
+{
+	return 0;
+}
+
+float TccPwmFrequency(tcc_pwm_output_t output)
+{
+	return 0.0f;
+}
+
+uint32_t TccPwmTicksToUpdate(tcc_pwm_output_t output)
+{
+	return 0;
+}
+
+void TccPwmPause(tcc_pwm_output_t output, uint8_t paused)
+{
+}
+
+void TccPwmRecover()
+{
+}
+
+#endif
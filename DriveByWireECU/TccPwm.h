@@ -0,0 +1,116 @@
+/*
+ * TccPwm.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TCCPWM_H_
+#define TCCPWM_H_
+
+#include <stdint.h>
+
+//Steering torque and acceleration PWM on TCC0 and TCC1 instead of TC4 and
+//TC0 (DriveByWireIO.c), with the estop wired into the timers themselves.
+//
+//The estop input is a hardware fault of both TCCs: EVSYS routes the EIC
+//event of EStopInput.h to event input 1 of each TCC as a non-recoverable
+//fault. The TCC forces its outputs low as soon as the event arrives, a few
+//tens of ns after the pin and ahead of the estop interrupt, whatever the
+//software is doing. They stay low until TccPwmRecover, which only lets go
+//once the estop is released again and every duty is back at 0, so the
+//outputs never come back at what was commanded when the estop was hit.
+//
+//With ADC_SAMPLER_WINDOW_TRIP (AdcSampler.h) the ADC window monitor is a
+//second non-recoverable fault of TCC0, on event input 0, and forces the
+//steering output low the same way when a steering input leaves its window.
+//
+//Compare values are double buffered in hardware as with the TC: writes go
+//to CCBUF and are applied at the end of the period. The TCC writes also do
+//not wait on a register synchronization, the TC ones do.
+//
+//The steering PWM has 400 ticks of the 12MHz clock per 30kHz period, 240
+//of them in the 60% its driver takes, too coarse a duty for the position
+//loop to settle on. With TCC_PWM_STEERING_DITHER the TCC dithers its
+//compare: of every 2^n periods, as many as the duty's fraction of a tick
+//asks for are one tick longer, so the mean duty has n more bits. At 6
+//bits that is 25600 steps per period, 15360 in the driver's range, close
+//to 14 bits. The dither pattern repeats at 30kHz / 2^n, 470Hz at 6 bits,
+//far above what the motor and the steering column pass.
+//
+//The TC outputs, PA05 and PB09, have no TCC. The outputs below have to be
+//wired to the drivers instead.
+
+#ifndef TCC_PWM_ENABLE
+#define TCC_PWM_ENABLE 0
+#endif
+
+//TCC0 WO0, and WO4 as the low side with dead time
+#define TCC_PWM_STEERING_PIN GPIO(GPIO_PORTA, 8)
+#define TCC_PWM_STEERING_PINMUX PINMUX_PA08F_TCC0_WO0
+#define TCC_PWM_STEERING_LOW_PIN GPIO(GPIO_PORTB, 10)
+#define TCC_PWM_STEERING_LOW_PINMUX PINMUX_PB10F_TCC0_WO4
+//TCC1 WO0
+#define TCC_PWM_ACCELERATION_PIN GPIO(GPIO_PORTA, 16)
+#define TCC_PWM_ACCELERATION_PINMUX PINMUX_PA16F_TCC1_WO0
+
+//PWM clock ticks, 83ns each, between one side of the steering output
+//turning off and the other turning on, for an H-bridge. 0 leaves the low
+//side output off and the steering output single ended, as with the TC.
+#ifndef TCC_PWM_STEERING_DEAD_TIME
+#define TCC_PWM_STEERING_DEAD_TIME 0
+#endif
+
+//Dither bits of the steering output, 0, 4, 5 or 6. The acceleration
+//output has none.
+#ifndef TCC_PWM_STEERING_DITHER
+#define TCC_PWM_STEERING_DITHER 0
+#endif
+
+typedef enum tcc_pwm_output_t
+{
+	TCC_PWM_STEERING_TORQUE = 0,
+	TCC_PWM_ACCELERATION,
+	TCC_PWM_OUTPUT_COUNT,
+	//the output is on its TC
+	TCC_PWM_NONE = TCC_PWM_OUTPUT_COUNT
+} tcc_pwm_output_t;
+
+//Sets up the fault input and starts both TCCs at 0 duty. Periods are in
+//ticks of the 12MHz PWM clock. Call before anything sets a duty.
+void TccPwmInit(uint16_t steering_period, uint16_t acceleration_period);
+
+//Duty in ticks of the period, from the next period on. The fraction of a
+//tick is kept to the output's dither bits and dropped without. Safe from
+//the steering rate loop interrupt.
+void TccPwmSetDuty(tcc_pwm_output_t output, float duty_ticks);
+
+//CC value of a duty in ticks as TccPwmSetDuty writes it, for compare
+//values written by DMA (Excitation.h)
+uint32_t TccPwmCompare(tcc_pwm_output_t output, float duty_ticks);
+
+//The output's CCBUF and the DMAC trigger of its timer's overflow, for a
+//DMA channel that writes a compare value every period. CCBUF is applied at
+//the end of the period it is written in. TccPwmRecover does not see duties
+//written that way, the writer sets the duty with TccPwmSetDuty once done.
+volatile uint32_t* TccPwmCompareBuffer(tcc_pwm_output_t output);
+uint8_t TccPwmOverflowTrigger(tcc_pwm_output_t output);
+
+//Hz of the output's PWM
+float TccPwmFrequency(tcc_pwm_output_t output);
+
+//Ticks of the PWM clock until the output's current period ends and its
+//CCBUF is applied. Waits on a count read synchronization, a few us.
+uint32_t TccPwmTicksToUpdate(tcc_pwm_output_t output);
+
+//Stops the output's timer, or starts it again from the start of a period.
+//The output holds its level while stopped. DMA channels enabled while it
+//is stopped all get their first overflow trigger from the same period.
+void TccPwmPause(tcc_pwm_output_t output, uint8_t paused);
+
+//Releases a fault once every duty is 0. Call while the software sees the
+//estop released and no window trip latched, the hardware keeps the fault
+//while the input is active or sets it again with the next conversion
+//outside the window.
+void TccPwmRecover();
+
+#endif /* TCCPWM_H_ */
@@ -0,0 +1,359 @@
+/*
+ * TelemetryStream.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "TelemetryStream.h"
+#include "ControlScheduler.h"
+#include "TimeBase.h"
+
+//Times are free running ms counters, compared through the signed difference
+static uint8_t IsMulticast(uint32_t address)
+{
+	//first octet is the first byte in memory
+	return (((const uint8_t*)&address)[0] & 0xF0) == 0xE0;
+}
+
+static void StartSubscriber(telemetry_subscriber_t* subscriber, const uint16_t* period, uint8_t batch, uint32_t published,
+	uint32_t now)
+{
+	subscriber->batch = batch;
+	subscriber->batch_next = published;
+	subscriber->batch_lost = 0;
+
+	for(int g = 0; g < CONTROL_TELEMETRY_GROUP_COUNT; ++g)
+	{
+		subscriber->period[g] = period[g];
+		if( subscriber->period[g] != 0 && subscriber->period[g] < TELEMETRY_MIN_PERIOD )
+			subscriber->period[g] = TELEMETRY_MIN_PERIOD;
+
+		//first frame of every group goes out right away and in full
+		subscriber->next_due[g] = now;
+		subscriber->next_refresh[g] = now;
+	}
+}
+
+static uint8_t HasSubscribers(const telemetry_stream_t* stream)
+{
+	for(int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; ++i)
+	{
+		if( stream->subscribers[i].active )
+			return 1;
+	}
+	return 0;
+}
+
+void TelemetryStreamInit(telemetry_stream_t* stream, uint32_t broadcast_address, uint16_t broadcast_port, uint32_t now)
+{
+	static const uint16_t broadcast_period[CONTROL_TELEMETRY_GROUP_COUNT] = { TELEMETRY_BROADCAST_PERIOD, 0 };
+
+	memset(stream, 0, sizeof(*stream));
+	stream->broadcast.active = 1;
+	stream->broadcast.address = broadcast_address;
+	stream->broadcast.port = broadcast_port;
+	StartSubscriber(&stream->broadcast, broadcast_period, 0, 0, now);
+}
+
+//Only the sender itself or a multicast group can be named, the ECU never
+//streams to some other host on request.
+static void ResolveDestination(uint32_t address, uint16_t port, uint32_t source_address, uint16_t source_port,
+	uint32_t* resolved_address, uint16_t* resolved_port)
+{
+	*resolved_address = IsMulticast(address) ? address : source_address;
+	*resolved_port = port != 0 ? port : source_port;
+}
+
+void TelemetryStreamSubscribe(telemetry_stream_t* stream, const control_subscription_t* subscription,
+	uint32_t source_address, uint16_t source_port, uint32_t now)
+{
+	uint32_t address;
+	uint16_t port;
+	ResolveDestination(subscription->address, subscription->port, source_address, source_port, &address, &port);
+
+	uint8_t wanted = subscription->batch != 0;
+	for(int g = 0; g < CONTROL_TELEMETRY_GROUP_COUNT; ++g)
+		wanted |= subscription->period[g] != 0;
+
+	telemetry_subscriber_t* slot = NULL;
+	for(int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; ++i)
+	{
+		telemetry_subscriber_t* subscriber = &stream->subscribers[i];
+		if( subscriber->active && subscriber->address == address && subscriber->port == port )
+		{
+			slot = subscriber;
+			break;
+		}
+		if( !subscriber->active && slot == NULL )
+			slot = subscriber;
+	}
+
+	if( !wanted )
+	{
+		if( slot != NULL && slot->active )
+			slot->active = 0;
+		return;
+	}
+	if( slot == NULL )
+	{
+		stream->rejected++;
+		return;
+	}
+
+	//A renewal keeps the schedule so the stream does not restart every lease.
+	uint8_t renewal = slot->active && memcmp(slot->period, subscription->period, sizeof(slot->period)) == 0 &&
+		slot->batch == subscription->batch;
+	if( !renewal )
+	{
+		slot->active = 1;
+		slot->address = address;
+		slot->port = port;
+		//the batches start with the newest snapshot of the last pass
+		StartSubscriber(slot, subscription->period, subscription->batch, stream->published, now);
+	}
+	slot->expires = now + CONTROL_SUBSCRIPTION_LEASE;
+}
+
+void TelemetryStreamSubscribeSignals(telemetry_stream_t* stream, const control_signal_subscription_t* subscription,
+	uint32_t source_address, uint16_t source_port, uint32_t now)
+{
+	uint32_t address;
+	uint16_t port;
+	ResolveDestination(subscription->address, subscription->port, source_address, source_port, &address, &port);
+
+	telemetry_signal_set_t* slot = NULL;
+	for(int i = 0; i < TELEMETRY_MAX_SIGNAL_SETS; ++i)
+	{
+		telemetry_signal_set_t* set = &stream->signal_sets[i];
+		if( set->active && set->address == address && set->port == port && set->tag == subscription->tag )
+		{
+			slot = set;
+			break;
+		}
+		if( !set->active && slot == NULL )
+			slot = set;
+	}
+
+	if( subscription->period == 0 )
+	{
+		if( slot != NULL && slot->active )
+			slot->active = 0;
+		return;
+	}
+	if( slot == NULL )
+	{
+		stream->rejected++;
+		return;
+	}
+
+	//A renewal keeps the schedule so the stream does not restart every lease.
+	uint8_t renewal = slot->active && slot->period == subscription->period && slot->count == subscription->count
+		&& memcmp(slot->ids, subscription->ids, subscription->count) == 0;
+	if( !renewal )
+	{
+		slot->active = 1;
+		slot->address = address;
+		slot->port = port;
+		slot->tag = subscription->tag;
+		slot->period = subscription->period < TELEMETRY_MIN_PERIOD ? TELEMETRY_MIN_PERIOD : subscription->period;
+		slot->count = subscription->count;
+		memcpy(slot->ids, subscription->ids, subscription->count);
+		slot->next_due = now;
+	}
+	slot->expires = now + CONTROL_SUBSCRIPTION_LEASE;
+}
+
+void TelemetryStreamBegin(telemetry_stream_t* stream, const control_protocol_t* protocol, control_exchange_t* exchange, uint32_t now)
+{
+	stream->now = now;
+	ControlProtocolQuantizeTelemetry(protocol, ReadLatestTelemetry(exchange), stream->values);
+	stream->exchange = exchange;
+	stream->published = TelemetryHistoryCount(exchange);
+
+	for(int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; ++i)
+	{
+		telemetry_subscriber_t* subscriber = &stream->subscribers[i];
+		if( subscriber->active && TIME_REACHED(now, subscriber->expires) )
+			subscriber->active = 0;
+	}
+	for(int i = 0; i < TELEMETRY_MAX_SIGNAL_SETS; ++i)
+	{
+		telemetry_signal_set_t* set = &stream->signal_sets[i];
+		if( set->active && TIME_REACHED(now, set->expires) )
+			set->active = 0;
+	}
+}
+
+uint16_t TelemetryStreamNext(telemetry_stream_t* stream, control_protocol_t* protocol, uint8_t* frame,
+	uint32_t* address, uint16_t* port)
+{
+	uint8_t subscribed = HasSubscribers(stream);
+	int count = subscribed ? TELEMETRY_MAX_SUBSCRIBERS : 1;
+	uint32_t now = stream->now;
+
+	for(int i = 0; i < count; ++i)
+	{
+		telemetry_subscriber_t* subscriber = subscribed ? &stream->subscribers[i] : &stream->broadcast;
+		if( !subscriber->active )
+			continue;
+
+		for(int g = 0; g < CONTROL_TELEMETRY_GROUP_COUNT; ++g)
+		{
+			if( subscriber->period[g] == 0 || !TIME_REACHED(now, subscriber->next_due[g]) )
+				continue;
+
+			//Stay on the period grid, but skip slots that were missed rather
+			//than catching up with a burst.
+			subscriber->next_due[g] += subscriber->period[g];
+			if( TIME_REACHED(now, subscriber->next_due[g]) )
+				subscriber->next_due[g] = now + subscriber->period[g];
+
+			uint16_t fields = ControlProtocolGroupFields((control_telemetry_group_t)g);
+			uint16_t mask = 0;
+			if( TIME_REACHED(now, subscriber->next_refresh[g]) )
+			{
+				mask = fields;
+				subscriber->next_refresh[g] = now + CONTROL_TELEMETRY_REFRESH;
+			}
+			else
+			{
+				for(int f = 0; f < CONTROL_TELEMETRY_FIELD_COUNT; ++f)
+				{
+					if( (fields & (1 << f)) && subscriber->sent[f] != stream->values[f] )
+						mask |= 1 << f;
+				}
+			}
+
+			//nothing changed, nothing to send until the next period
+			if( mask == 0 )
+				continue;
+
+			for(int f = 0; f < CONTROL_TELEMETRY_FIELD_COUNT; ++f)
+			{
+				if( mask & (1 << f) )
+					subscriber->sent[f] = stream->values[f];
+			}
+
+			*address = subscriber->address;
+			*port = subscriber->port;
+			return ControlProtocolEncodeTelemetry(protocol, frame, (control_telemetry_group_t)g, mask, stream->values, now);
+		}
+	}
+	return 0;
+}
+
+uint16_t TelemetryStreamNextBatch(telemetry_stream_t* stream, control_protocol_t* protocol, uint8_t* frame,
+	uint32_t* address, uint16_t* port)
+{
+	for(int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; ++i)
+	{
+		telemetry_subscriber_t* subscriber = &stream->subscribers[i];
+		if( !subscriber->active || subscriber->batch == 0 )
+			continue;
+
+		uint32_t available = stream->published - subscriber->batch_next;
+		//Fell behind the history, the newest batch is worth more than the
+		//oldest still held
+		if( available >= CONTROL_TELEMETRY_HISTORY - subscriber->batch )
+		{
+			subscriber->batch_lost += available - subscriber->batch;
+			subscriber->batch_next = stream->published - subscriber->batch;
+			available = subscriber->batch;
+		}
+		if( available < subscriber->batch )
+			continue;
+
+		uint32_t first = subscriber->batch_next;
+		subscriber->batch_next += subscriber->batch;
+		uint8_t read = 0;
+		while( read < subscriber->batch && ReadTelemetryHistory(stream->exchange, first + read, &stream->batch_samples[read]) )
+			read++;
+		//overwritten while it was read, skipped
+		if( read < subscriber->batch )
+		{
+			subscriber->batch_lost += subscriber->batch;
+			continue;
+		}
+
+		*address = subscriber->address;
+		*port = subscriber->port;
+		return ControlProtocolEncodeTelemetryBatch(protocol, frame, stream->batch_samples, subscriber->batch, first,
+			subscriber->batch_lost, stream->now);
+	}
+	return 0;
+}
+
+uint16_t TelemetryStreamNextSignals(telemetry_stream_t* stream, control_protocol_t* protocol, uint8_t* frame,
+	uint32_t* address, uint16_t* port)
+{
+	uint32_t now = stream->now;
+
+	for(int i = 0; i < TELEMETRY_MAX_SIGNAL_SETS; ++i)
+	{
+		telemetry_signal_set_t* set = &stream->signal_sets[i];
+		if( !set->active || !TIME_REACHED(now, set->next_due) )
+			continue;
+
+		//on the period grid, as the groups are
+		set->next_due += set->period;
+		if( TIME_REACHED(now, set->next_due) )
+			set->next_due = now + set->period;
+
+		*address = set->address;
+		*port = set->port;
+		return ControlProtocolEncodeSignalData(protocol, frame, set->tag, set->ids, set->count, now);
+	}
+	return 0;
+}
+
+uint32_t TelemetryStreamWaitTime(const telemetry_stream_t* stream, uint32_t now)
+{
+	uint8_t subscribed = HasSubscribers(stream);
+	int count = subscribed ? TELEMETRY_MAX_SUBSCRIBERS : 1;
+	uint32_t wait = TELEMETRY_BROADCAST_PERIOD;
+
+	for(int i = 0; i < TELEMETRY_MAX_SIGNAL_SETS; ++i)
+	{
+		const telemetry_signal_set_t* set = &stream->signal_sets[i];
+		if( !set->active )
+			continue;
+		if( TIME_REACHED(now, set->next_due) )
+			return 1;
+		if( set->next_due - now < wait )
+			wait = set->next_due - now;
+	}
+
+	for(int i = 0; i < count; ++i)
+	{
+		const telemetry_subscriber_t* subscriber = subscribed ? &stream->subscribers[i] : &stream->broadcast;
+		if( !subscriber->active )
+			continue;
+
+		if( subscriber->batch != 0 )
+		{
+			//a snapshot per control cycle since the pass began,
+			//CONTROL_CYCLES_PER_MS of them a ms
+			uint32_t published = stream->published + (now - stream->now) * CONTROL_CYCLES_PER_MS;
+			uint32_t available = published - subscriber->batch_next;
+			if( available >= subscriber->batch )
+				return 1;
+			uint32_t remaining = (subscriber->batch - available + CONTROL_CYCLES_PER_MS - 1) / CONTROL_CYCLES_PER_MS;
+			if( remaining < wait )
+				wait = remaining;
+		}
+
+		for(int g = 0; g < CONTROL_TELEMETRY_GROUP_COUNT; ++g)
+		{
+			if( subscriber->period[g] == 0 )
+				continue;
+			if( TIME_REACHED(now, subscriber->next_due[g]) )
+				return 1;
+
+			uint32_t remaining = subscriber->next_due[g] - now;
+			if( remaining < wait )
+				wait = remaining;
+		}
+	}
+	return wait;
+}
@@ -0,0 +1,136 @@
+/*
+ * TelemetryStream.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TELEMETRYSTREAM_H_
+#define TELEMETRYSTREAM_H_
+
+#include <stdint.h>
+#include "ControlProtocol.h"
+
+//Decides which telemetry frame goes to which host and when.
+//Each subscriber gets every group at the period it asked for, and only the
+//fields that changed since the last frame it was sent. While nobody is
+//subscribed the status group goes to the default destination, the telemetry
+//multicast group, so the PC can find the ECU.
+//A subscriber that asks for a batch also gets every control cycle's
+//snapshot from the history (ControlExchange.h), batch of them per frame,
+//one frame each time batch new ones were published. One that falls behind
+//the history skips to the newest batch and counts the samples it lost.
+//A subscriber can also ask for sets of signals by id (SignalBus.h), each at
+//its own period. A set is every one of its signals as of the pass, read off
+//the signal bus, so only what some tool asked for is ever encoded.
+//Transport independent, the caller does the sending.
+
+#ifndef TELEMETRY_MAX_SUBSCRIBERS
+#define TELEMETRY_MAX_SUBSCRIBERS 4
+#endif
+
+//Signal sets held at once, over all subscribers
+#ifndef TELEMETRY_MAX_SIGNAL_SETS
+#define TELEMETRY_MAX_SIGNAL_SETS 8
+#endif
+
+//ms. A subscriber can not ask for more than one frame per group per control cycle.
+#define TELEMETRY_MIN_PERIOD 1
+#define TELEMETRY_BROADCAST_PERIOD 100
+
+//Most frames a single pass can produce
+#define TELEMETRY_MAX_FRAMES_PER_PASS (TELEMETRY_MAX_SUBSCRIBERS * CONTROL_TELEMETRY_GROUP_COUNT)
+#define TELEMETRY_MAX_SIGNAL_FRAMES_PER_PASS TELEMETRY_MAX_SIGNAL_SETS
+
+typedef struct telemetry_subscriber_t
+{
+	uint8_t active;
+	//network byte order
+	uint32_t address;
+	uint16_t port;
+	uint32_t expires;
+
+	uint16_t period[CONTROL_TELEMETRY_GROUP_COUNT];
+	uint32_t next_due[CONTROL_TELEMETRY_GROUP_COUNT];
+	uint32_t next_refresh[CONTROL_TELEMETRY_GROUP_COUNT];
+	//field values as last sent to this subscriber
+	uint32_t sent[CONTROL_TELEMETRY_FIELD_COUNT];
+
+	//samples per batched frame, 0 for none, number of the next sample to
+	//send and samples lost
+	uint8_t batch;
+	uint32_t batch_next;
+	uint32_t batch_lost;
+} telemetry_subscriber_t;
+
+typedef struct telemetry_signal_set_t
+{
+	uint8_t active;
+	//network byte order
+	uint32_t address;
+	uint16_t port;
+	uint8_t tag;
+	uint32_t expires;
+
+	uint16_t period;
+	uint32_t next_due;
+	uint8_t count;
+	uint8_t ids[CONTROL_SIGNAL_SET_MAX];
+} telemetry_signal_set_t;
+
+typedef struct telemetry_stream_t
+{
+	telemetry_subscriber_t subscribers[TELEMETRY_MAX_SUBSCRIBERS];
+	telemetry_signal_set_t signal_sets[TELEMETRY_MAX_SIGNAL_SETS];
+	//used instead of the subscribers while there are none
+	telemetry_subscriber_t broadcast;
+
+	//snapshot, time and history count latched by TelemetryStreamBegin
+	uint32_t values[CONTROL_TELEMETRY_FIELD_COUNT];
+	uint32_t now;
+	const control_exchange_t* exchange;
+	uint32_t published;
+	//the samples of the batch being written
+	control_telemetry_t batch_samples[CONTROL_TELEMETRY_BATCH_MAX_SAMPLES];
+
+	//subscribe and signal subscribe requests turned away because every slot
+	//was taken
+	uint32_t rejected;
+} telemetry_stream_t;
+
+//address is in network byte order
+void TelemetryStreamInit(telemetry_stream_t* stream, uint32_t broadcast_address, uint16_t broadcast_port, uint32_t now);
+
+//Adds, renews or, when every period is 0, removes a subscription.
+//source_address and source_port are where the subscribe came from.
+void TelemetryStreamSubscribe(telemetry_stream_t* stream, const control_subscription_t* subscription,
+	uint32_t source_address, uint16_t source_port, uint32_t now);
+
+//Adds, renews or, with a period of 0, removes the signal set of the
+//subscription's tag, the same way
+void TelemetryStreamSubscribeSignals(telemetry_stream_t* stream, const control_signal_subscription_t* subscription,
+	uint32_t source_address, uint16_t source_port, uint32_t now);
+
+//Starts a send pass with the newest snapshot and history of exchange,
+//which must stay valid until the pass ends. now is in ms.
+void TelemetryStreamBegin(telemetry_stream_t* stream, const control_protocol_t* protocol, control_exchange_t* exchange, uint32_t now);
+
+//Writes the next frame that is due in this pass and returns its length and
+//destination, or returns 0 once nothing else is due. frame must hold
+//CONTROL_TELEMETRY_MAX_FRAME_SIZE bytes.
+uint16_t TelemetryStreamNext(telemetry_stream_t* stream, control_protocol_t* protocol, uint8_t* frame,
+	uint32_t* address, uint16_t* port);
+
+//The same for the batched telemetry frames that are due, frame must hold
+//CONTROL_TELEMETRY_BATCH_MAX_FRAME_SIZE bytes.
+uint16_t TelemetryStreamNextBatch(telemetry_stream_t* stream, control_protocol_t* protocol, uint8_t* frame,
+	uint32_t* address, uint16_t* port);
+
+//The same for the signal data frames that are due, frame must hold
+//CONTROL_SIGNAL_DATA_MAX_FRAME_SIZE bytes.
+uint16_t TelemetryStreamNextSignals(telemetry_stream_t* stream, control_protocol_t* protocol, uint8_t* frame,
+	uint32_t* address, uint16_t* port);
+
+//ms until the next frame is due, at least 1
+uint32_t TelemetryStreamWaitTime(const telemetry_stream_t* stream, uint32_t now);
+
+#endif /* TELEMETRYSTREAM_H_ */
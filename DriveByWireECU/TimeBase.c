@@ -0,0 +1,50 @@
+/*
+ * TimeBase.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <compiler.h>
+#include "TimeBase.h"
+#include "FastCode.h"
+
+//tick hook only, read with interrupts off
+static volatile uint64_t time_base_ticks;
+
+FAST_CODE void TimeBaseTick()
+{
+	time_base_ticks++;
+}
+
+//The tick count and the cycles into the tick. A SysTick that reloaded
+//ahead of its interrupt still being pending counts as the tick after.
+FAST_CODE static uint64_t ReadTicks(uint32_t* cycles)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint64_t ticks = time_base_ticks;
+	uint32_t value = SysTick->VAL;
+	if( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk )
+	{
+		value = SysTick->VAL;
+		ticks++;
+	}
+	uint32_t load = SysTick->LOAD;
+	__set_PRIMASK(primask);
+	*cycles = load - value;
+	return ticks;
+}
+
+FAST_CODE uint64_t TimeBaseCycles()
+{
+	uint32_t cycles;
+	uint64_t ticks = ReadTicks(&cycles);
+	return ticks * (configCPU_CLOCK_HZ / configTICK_RATE_HZ) + cycles;
+}
+
+FAST_CODE uint64_t TimeBaseUs()
+{
+	uint32_t cycles;
+	uint64_t ticks = ReadTicks(&cycles);
+	return ticks * TIME_BASE_US_PER_TICK + cycles / TIME_BASE_CYCLES_PER_US;
+}
@@ -0,0 +1,52 @@
+/*
+ * TimeBase.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+
+//Monotonic 64-bit time since the scheduler started, to the core cycle.
+//
+//The tick hook counts RTOS ticks into 64 bits, which unlike the kernel's
+//tick count keeps counting while the scheduler is suspended, and SysTick
+//counts the core cycles within the tick down from LOAD. A reading is the
+//two taken with interrupts off, a few loads and a multiply, no
+//peripheral synchronisation. SysTick keeps running in idle sleep, which
+//stops the DWT cycle counter, and is never stepped like the PTP time
+//(Ptp.h): the time base is for intervals, the PTP time for when. With
+//TIME_TRIGGER_ENABLE a tick is trimmed by a few us at most to keep it on
+//the schedule (TimeTrigger.h), the time base then runs at the PTP clock's
+//rate rather than the crystal's.
+//
+//Every TC already has a job, the PWM, the rate loop, the wheel speed
+//capture, the DAC ramp and the ADC trigger, so there is none left to
+//chain into a counter of its own.
+//
+//Safe from any task and from interrupts up to the kernel's priority. An
+//interrupt above it that preempts the tick interrupt before the hook
+//reads a tick behind.
+
+//Non-zero once the 32-bit timestamp now is at or past time, in ticks, ms or
+//us alike. Compared by their difference, so safe across the counter
+//wrapping as long as the two are less than half its range apart.
+#define TIME_REACHED(now, time) ((int32_t)((now) - (time)) >= 0)
+
+#define TIME_BASE_CYCLES_PER_US (configCPU_CLOCK_HZ / 1000000)
+#define TIME_BASE_US_PER_TICK (1000000 / configTICK_RATE_HZ)
+
+//Core cycles since the scheduler started
+uint64_t TimeBaseCycles();
+
+//us since the scheduler started. The low 32 bits wrap after 71 minutes,
+//their differences are safe across that like the ms timestamps.
+uint64_t TimeBaseUs();
+
+//From the tick hook, once per tick
+void TimeBaseTick();
+
+#endif /* TIMEBASE_H_ */
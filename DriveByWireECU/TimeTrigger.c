@@ -0,0 +1,154 @@
+/*
+ * TimeTrigger.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <compiler.h>
+#include "TimeTrigger.h"
+#include "Ptp.h"
+#include "NodeIdentity.h"
+#include "TimeBase.h"
+#include "FastCode.h"
+#include "Log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if TIME_TRIGGER_ENABLE
+
+//configTICK_RATE_HZ is a cast, the preprocessor can not check it is 1000
+#if CONTROL_RATE_HZ != 1000 || CONTROL_SCHEDULER_TIMER
+#error TIME_TRIGGER_ENABLE locks the tick to the cycle, the cycle must be one tick
+#endif
+
+#if TIME_TRIGGER_CYCLE_US % TIME_TRIGGER_SLOT_US != 0 || TIME_TRIGGER_SLOTS < 2
+#error TIME_TRIGGER_SLOT_US must cut the cycle into two or more slots
+#endif
+
+#define CYCLE_NS ((int32_t)TIME_TRIGGER_CYCLE_US * 1000)
+//what the port loads, a tick on the crystal
+#define NOMINAL_LOAD (configCPU_CLOCK_HZ / configTICK_RATE_HZ - 1)
+//the servo takes a quarter of the error each tick, the integral the drift
+//between the crystal and the PTP clock
+#define PROPORTIONAL_DIVIDER 4
+#define INTEGRAL_DIVIDER 64
+
+static struct
+{
+	//ns into the cycle the tick is steered to, and the node's slot
+	int32_t target;
+	uint32_t slot_start;
+	uint32_t slot_end;
+	//ns of error summed, the tick interrupt's
+	int32_t integral;
+	time_trigger_stats_t stats;
+} time_trigger;
+
+void TimeTriggerInit()
+{
+	uint32_t slot = 1 + NodeIdentity()->id % (TIME_TRIGGER_SLOTS - 1);
+	int32_t target = (int32_t)(slot * TIME_TRIGGER_SLOT_US - TIME_TRIGGER_LEAD_US) * 1000;
+
+	time_trigger.stats.slot = slot;
+	time_trigger.slot_start = slot * TIME_TRIGGER_SLOT_US * 1000;
+	time_trigger.slot_end = (slot + 1) * TIME_TRIGGER_SLOT_US * 1000 - TIME_TRIGGER_GUARD_US * 1000;
+	time_trigger.target = (target % CYCLE_NS + CYCLE_NS) % CYCLE_NS;
+	LOG("Time trigger slot %lu of %lu, %lu us", slot, TIME_TRIGGER_SLOTS, TIME_TRIGGER_SLOT_US);
+}
+
+static void Free()
+{
+	SysTick->LOAD = NOMINAL_LOAD;
+	time_trigger.integral = 0;
+	time_trigger.stats.trim = 0;
+	if( time_trigger.stats.locked )
+	{
+		time_trigger.stats.locked = 0;
+		LOG("Time trigger unlocked, the tick runs free");
+	}
+}
+
+FAST_CODE void TimeTriggerTick()
+{
+	if( !PtpSynced() )
+	{
+		if( time_trigger.stats.trim != 0 || time_trigger.stats.locked )
+			Free();
+		return;
+	}
+
+	//the reload only applies from the next tick on, the servo sees its
+	//trim a tick late
+	int32_t error = (int32_t)PtpPhaseNs(CYCLE_NS) - time_trigger.target;
+	if( error >= CYCLE_NS / 2 )
+		error -= CYCLE_NS;
+	else if( error < -CYCLE_NS / 2 )
+		error += CYCLE_NS;
+
+	int32_t trim = error / PROPORTIONAL_DIVIDER + time_trigger.integral / INTEGRAL_DIVIDER;
+	if( trim > TIME_TRIGGER_MAX_TRIM_NS )
+		trim = TIME_TRIGGER_MAX_TRIM_NS;
+	else if( trim < -TIME_TRIGGER_MAX_TRIM_NS )
+		trim = -TIME_TRIGGER_MAX_TRIM_NS;
+	else
+		//only while not slewing, the integral is for the drift
+		time_trigger.integral += error;
+	//late shortens the next tick
+	SysTick->LOAD = NOMINAL_LOAD - trim * (int32_t)TIME_BASE_CYCLES_PER_US / 1000;
+
+	time_trigger.stats.phase_error = error;
+	time_trigger.stats.trim = trim;
+	uint32_t magnitude = error < 0 ? -error : error;
+	if( !time_trigger.stats.locked && magnitude < TIME_TRIGGER_LOCKED_NS )
+	{
+		time_trigger.stats.locked = 1;
+		time_trigger.stats.locks++;
+		LOG("Time trigger locked, slot %u", time_trigger.stats.slot);
+	}
+	else if( time_trigger.stats.locked && magnitude > 2 * TIME_TRIGGER_LOCKED_NS )
+	{
+		time_trigger.stats.locked = 0;
+		LOG("Time trigger unlocked, phase error %ld ns", error);
+	}
+}
+
+uint8_t TimeTriggerSlotOpen()
+{
+	if( !__atomic_load_n(&time_trigger.stats.locked, __ATOMIC_RELAXED) )
+		return 1;
+	uint32_t phase = PtpPhaseNs(CYCLE_NS);
+	if( phase >= time_trigger.slot_start && phase < time_trigger.slot_end )
+		return 1;
+	time_trigger.stats.held++;
+	return 0;
+}
+
+void TimeTriggerRead(time_trigger_stats_t* stats)
+{
+	taskENTER_CRITICAL();
+	*stats = time_trigger.stats;
+	taskEXIT_CRITICAL();
+}
+
+#else
+
+void TimeTriggerInit()
+{
+}
+
+void TimeTriggerTick()
+{
+}
+
+uint8_t TimeTriggerSlotOpen()
+{
+	return 1;
+}
+
+void TimeTriggerRead(time_trigger_stats_t* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+#endif
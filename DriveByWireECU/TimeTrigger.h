@@ -0,0 +1,98 @@
+/*
+ * TimeTrigger.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TIMETRIGGER_H_
+#define TIMETRIGGER_H_
+
+#include <stdint.h>
+#include "ControlCore.h"
+
+//Time-triggered transmission: the PC and every ECU send in a slot of their
+//own in a cycle of the control period, on the PTP time (Ptp.h), so frames
+//of different nodes never queue behind each other in the switch or the
+//GMAC rings and the worst case latency follows from the schedule.
+//
+//The cycle is CONTROL_CORE_CYCLE_US, cut into TIME_TRIGGER_SLOT_US
+//slots. Slot 0 is the PC's commands (latency_bench.py --slot-us), node n
+//of NodeIdentity.h has slot 1 + n, modulo the slots there are.
+//
+//An ECU's telemetry goes out right behind the control cycle that produced
+//it (ETHERNET_CYCLE_ALIGNED_TX), so the schedule moves the control cycle:
+//once PTP is synced the tick hook trims SysTick's reload, at most
+//TIME_TRIGGER_MAX_TRIM_NS a tick, until the RTOS tick, and with it every
+//release of main_task, falls TIME_TRIGGER_LEAD_US ahead of the node's
+//slot. The lead is from release to the telemetry pass, take it from the
+//cycle time the profiler reports on the vehicle. A pass that still comes
+//outside the slot, or closer than TIME_TRIGGER_GUARD_US to its end, is held
+//for the next cycle's.
+//
+//Without a synced PTP clock the tick runs free on the crystal and
+//telemetry goes out as without the schedule. Replies to requests, the
+//announce frames and the other ports are not scheduled, they are rare next
+//to the cycle's traffic. A slot has to hold a pass's frames on the wire,
+//about 0.08 us a byte at 100 Mbit/s.
+
+#ifndef TIME_TRIGGER_ENABLE
+#define TIME_TRIGGER_ENABLE 0
+#endif
+
+//us, the cycle must be a whole number of them
+#ifndef TIME_TRIGGER_SLOT_US
+#define TIME_TRIGGER_SLOT_US 200
+#endif
+
+//us from a release of main_task until its telemetry pass
+#ifndef TIME_TRIGGER_LEAD_US
+#define TIME_TRIGGER_LEAD_US 150
+#endif
+
+//us at the end of a slot where no pass starts
+#ifndef TIME_TRIGGER_GUARD_US
+#define TIME_TRIGGER_GUARD_US 20
+#endif
+
+//Largest change of one tick's length, ns. 5 us pulls a tick that is half a
+//cycle off into place in 100 ms.
+#ifndef TIME_TRIGGER_MAX_TRIM_NS
+#define TIME_TRIGGER_MAX_TRIM_NS 5000
+#endif
+
+//ns of phase error under which the tick counts as locked
+#ifndef TIME_TRIGGER_LOCKED_NS
+#define TIME_TRIGGER_LOCKED_NS 2000
+#endif
+
+#define TIME_TRIGGER_CYCLE_US CONTROL_CORE_CYCLE_US
+#define TIME_TRIGGER_SLOTS (TIME_TRIGGER_CYCLE_US / TIME_TRIGGER_SLOT_US)
+
+typedef struct time_trigger_stats_t
+{
+	//the tick is on the schedule and passes are gated
+	uint8_t locked;
+	uint8_t slot;
+	//of the last tick, ns, positive when it came late
+	int32_t phase_error;
+	//change of the tick's length in force, ns
+	int32_t trim;
+	//passes held for a later cycle
+	uint32_t held;
+	uint32_t locks;
+} time_trigger_stats_t;
+
+//Takes the slot of the node. Once at boot, after NodeIdentityInit.
+void TimeTriggerInit();
+
+//From the tick hook, once per tick
+void TimeTriggerTick();
+
+//Whether a telemetry pass may go out now, always while not locked. Counts
+//the passes it holds. From the tcpip thread.
+uint8_t TimeTriggerSlotOpen();
+
+//Safe from any task
+void TimeTriggerRead(time_trigger_stats_t* stats);
+
+#endif /* TIMETRIGGER_H_ */
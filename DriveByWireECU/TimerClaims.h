@@ -0,0 +1,83 @@
+/*
+ * TimerClaims.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TIMERCLAIMS_H_
+#define TIMERCLAIMS_H_
+
+#include "FreeRTOS.h"
+#include "AdcSampler.h"
+#include "ControlScheduler.h"
+#include "DacThrottle.h"
+#include "LatencyProbe.h"
+#include "PcSampler.h"
+#include "SteeringRateLoop.h"
+#include "TccPwm.h"
+
+//Which module takes each TC and TCC in a build. Every owner resets its
+//timer and sets it up its own way, a second one would take it from under
+//the first without either noticing, so a build in which two modules take
+//one instance does not compile.
+//
+//	TC0		acceleration PWM_0, free with TCC_PWM_ENABLE or DAC_THROTTLE_ENABLE
+//	TC1		steering rate loop (STEERING_RATE_LOOP), PWM_1 drives no pin
+//	TC2, TC3	wheel speed edge counters (WheelSpeed.h)
+//	TC4		steering PWM_4, free with TCC_PWM_ENABLE
+//	TC5		front brake PWM_2
+//	TC6		DAC throttle ramp (DAC_THROTTLE_RAMP), PWM_3 drives no pin
+//	TC7		ADC scan delay (ADC_SAMPLER_PWM_TRIGGER)
+//	TCC0, TCC1	steering and acceleration PWM (TCC_PWM_ENABLE)
+//	TCC2	PC sampler (PC_SAMPLER_ENABLE)
+//	TCC3	control cycle release (CONTROL_SCHEDULER_TIMER)
+//	TCC4	latency probe capture (LATENCY_PROBE_ENABLE)
+//
+//The kernel's run time counter (TaskMonitor.h) takes whichever of TC6, TC1
+//and TC0 is free, in that order, or TIMER_RUN_TIME_TC.
+
+#ifndef TIMER_RUN_TIME_TC
+#if !configGENERATE_RUN_TIME_STATS
+#define TIMER_RUN_TIME_TC -1
+#elif !(DAC_THROTTLE_ENABLE && DAC_THROTTLE_RAMP)
+#define TIMER_RUN_TIME_TC 6
+#elif !STEERING_RATE_LOOP
+#define TIMER_RUN_TIME_TC 1
+#elif TCC_PWM_ENABLE || DAC_THROTTLE_ENABLE
+#define TIMER_RUN_TIME_TC 0
+#else
+#error No TC is free for the run time counter, set TIMER_RUN_TIME_TC or turn configGENERATE_RUN_TIME_STATS off
+#endif
+#endif
+
+#define TIMER_CLAIMS_TC0 ((!TCC_PWM_ENABLE && !DAC_THROTTLE_ENABLE) + (TIMER_RUN_TIME_TC == 0))
+#define TIMER_CLAIMS_TC1 (!!STEERING_RATE_LOOP + (TIMER_RUN_TIME_TC == 1))
+#define TIMER_CLAIMS_TC2 (1 + (TIMER_RUN_TIME_TC == 2))
+#define TIMER_CLAIMS_TC3 (1 + (TIMER_RUN_TIME_TC == 3))
+#define TIMER_CLAIMS_TC4 (!TCC_PWM_ENABLE + (TIMER_RUN_TIME_TC == 4))
+#define TIMER_CLAIMS_TC5 (1 + (TIMER_RUN_TIME_TC == 5))
+#define TIMER_CLAIMS_TC6 (!!(DAC_THROTTLE_ENABLE && DAC_THROTTLE_RAMP) + (TIMER_RUN_TIME_TC == 6))
+#define TIMER_CLAIMS_TC7 (!!ADC_SAMPLER_PWM_TRIGGER + (TIMER_RUN_TIME_TC == 7))
+
+#if TIMER_CLAIMS_TC0 > 1 || TIMER_CLAIMS_TC1 > 1 || TIMER_CLAIMS_TC2 > 1 || TIMER_CLAIMS_TC3 > 1
+#error Two modules take one of TC0 to TC3, see TimerClaims.h
+#endif
+#if TIMER_CLAIMS_TC4 > 1 || TIMER_CLAIMS_TC5 > 1 || TIMER_CLAIMS_TC6 > 1 || TIMER_CLAIMS_TC7 > 1
+#error Two modules take one of TC4 to TC7, see TimerClaims.h
+#endif
+
+#define TIMER_CLAIMS_TCC0 (!!TCC_PWM_ENABLE)
+#define TIMER_CLAIMS_TCC1 (!!TCC_PWM_ENABLE)
+#define TIMER_CLAIMS_TCC2 (!!PC_SAMPLER_ENABLE)
+#define TIMER_CLAIMS_TCC3 (!!CONTROL_SCHEDULER_TIMER)
+#define TIMER_CLAIMS_TCC4 (!!LATENCY_PROBE_ENABLE)
+
+#if TIMER_CLAIMS_TCC0 > 1 || TIMER_CLAIMS_TCC1 > 1 || TIMER_CLAIMS_TCC2 > 1 || TIMER_CLAIMS_TCC3 > 1 \
+	|| TIMER_CLAIMS_TCC4 > 1
+#error Two modules take one of TCC0 to TCC4, see TimerClaims.h
+#endif
+#if TIMER_RUN_TIME_TC > 7
+#error TIMER_RUN_TIME_TC is not a TC
+#endif
+
+#endif /* TIMERCLAIMS_H_ */
@@ -0,0 +1,93 @@
+/*
+ * TractionControl.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "TractionControl.h"
+#include "FastCode.h"
+
+void TractionControlInit(traction_control_t* traction, float dt)
+{
+	memset(traction, 0, sizeof(*traction));
+	traction->throttle_limit = 1.0f;
+	traction->brake_limit = 1.0f;
+	traction->dt = dt;
+}
+
+//(faster - slower) over the reference speed, 0 when slower is the faster
+FAST_CODE static float SlipRatio(float faster, float slower, float reference)
+{
+	if( faster <= slower )
+		return 0.0f;
+	if( reference < TRACTION_CONTROL_MIN_SPEED )
+		reference = TRACTION_CONTROL_MIN_SPEED;
+	return (faster - slower) / reference;
+}
+
+//Moves limit for this slip and returns command held to it. A channel let
+//go of starts free the next time.
+FAST_CODE static float Limit(float* limit, float slip, float command, float dt)
+{
+	if( command <= 0.0f )
+	{
+		*limit = 1.0f;
+		return command;
+	}
+	if( slip > TRACTION_CONTROL_SLIP )
+	{
+		//from what was commanded when it started to slip
+		if( *limit > command )
+			*limit = command;
+		*limit -= TRACTION_CONTROL_CUT * (slip - TRACTION_CONTROL_SLIP) * dt;
+		if( *limit < 0.0f )
+			*limit = 0.0f;
+	}
+	else
+	{
+		*limit += TRACTION_CONTROL_RECOVER * dt;
+		if( *limit > 1.0f )
+			*limit = 1.0f;
+	}
+	return command > *limit ? *limit : command;
+}
+
+FAST_CODE uint8_t TractionControlStep(traction_control_t* traction, const float speeds[WHEEL_SPEED_SENSOR_COUNT],
+	uint8_t front_valid, actuator_command_t* out, uint8_t channels)
+{
+	traction->drive_slip = 0.0f;
+	traction->brake_slip = 0.0f;
+	if( front_valid )
+	{
+		float rear_fast = speeds[WHEEL_SPEED_LEFT] > speeds[WHEEL_SPEED_RIGHT] ? speeds[WHEEL_SPEED_LEFT] : speeds[WHEEL_SPEED_RIGHT];
+		float front_left = speeds[WHEEL_SPEED_FRONT_LEFT];
+		float front_right = speeds[WHEEL_SPEED_FRONT_RIGHT];
+		float front_mean = (front_left + front_right) * 0.5f;
+		float front_slow = front_left < front_right ? front_left : front_right;
+
+		//a wheel spun up by the throttle is no reference for the brake
+		traction->drive_slip = SlipRatio(rear_fast, front_mean, front_mean);
+		if( out->acceleration <= 0.0f )
+			traction->brake_slip = SlipRatio(rear_fast, front_slow, rear_fast);
+	}
+
+	uint8_t active = 0;
+	//a channel left out is let go of like one commanded off
+	float acceleration = (channels & TRACTION_CONTROL_THROTTLE) ? out->acceleration : 0.0f;
+	float limited = Limit(&traction->throttle_limit, traction->drive_slip, acceleration, traction->dt);
+	if( limited < acceleration )
+	{
+		out->acceleration = limited;
+		active |= TRACTION_CONTROL_THROTTLE;
+	}
+	float brake = (channels & TRACTION_CONTROL_BRAKE) ? out->front_brake : 0.0f;
+	limited = Limit(&traction->brake_limit, traction->brake_slip, brake, traction->dt);
+	if( limited < brake )
+	{
+		out->front_brake = limited;
+		active |= TRACTION_CONTROL_BRAKE;
+	}
+	traction->active = active;
+	return active;
+}
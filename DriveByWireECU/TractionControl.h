@@ -0,0 +1,97 @@
+/*
+ * TractionControl.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TRACTIONCONTROL_H_
+#define TRACTIONCONTROL_H_
+
+#include <stdint.h>
+#include "ActuatorCommand.h"
+#include "WheelSpeed.h"
+
+//Holds the throttle and the front brake back while the wheels slip, on wet
+//grass or gravel, from the four wheel speeds (WheelSpeed.h).
+//
+//Every cycle, between the mode's outputs and their commit, the slip ratio
+//of each axle is taken against the other one:
+//
+//	drive slip	how much faster the faster rear wheel turns than the front
+//				ones, the rear wheels are the driven ones
+//	brake slip	how much slower the slower front wheel turns than the
+//				faster rear one, only the front wheels are braked. Not
+//				while the throttle is on, the rear wheels are no
+//				reference then.
+//
+//over the reference's speed, TRACTION_CONTROL_MIN_SPEED at the least so a
+//standing start does not divide by nothing. Without a valid front wheel
+//frame neither can be told and both count as 0.
+//
+//Each of the throttle and the brake has a limit, the share of full duty it
+//is held to. A slip over TRACTION_CONTROL_SLIP takes the limit down to the
+//duty commanded and then cuts it by TRACTION_CONTROL_CUT per second and
+//unit of slip over, once it is back under the limit climbs back at
+//TRACTION_CONTROL_RECOVER per second, until it no longer holds anything
+//back. A throttle or brake let go of starts free the next time. The loops
+//behind the command never see the limit, what they wind up in the
+//meantime is their integral's bound.
+//
+//A step is a handful of compares and multiplies on four floats, no loops,
+//the same every cycle. PROFILER_STAGE_TRACTION and the pipeline's
+//"traction" stage measure it. The wheel speeds are not in the control
+//record (ControlRecord.h), a replay of a run with traction control
+//diverges from the first cycle it held anything back.
+
+//Set to 1 once the CAN wheel speed node is fitted
+#ifndef TRACTION_CONTROL_ENABLE
+#define TRACTION_CONTROL_ENABLE 0
+#endif
+
+//Slip ratio allowed, a tyre pulls best at 0.1 - 0.2
+#ifndef TRACTION_CONTROL_SLIP
+#define TRACTION_CONTROL_SLIP 0.15f
+#endif
+
+//m/s, the least reference speed a slip is taken against
+#ifndef TRACTION_CONTROL_MIN_SPEED
+#define TRACTION_CONTROL_MIN_SPEED 1.0f
+#endif
+
+//share of full duty per s and unit of slip over, and per s back
+#ifndef TRACTION_CONTROL_CUT
+#define TRACTION_CONTROL_CUT 20.0f
+#endif
+#ifndef TRACTION_CONTROL_RECOVER
+#define TRACTION_CONTROL_RECOVER 0.5f
+#endif
+
+//Bits of what a step held back
+#define TRACTION_CONTROL_THROTTLE 0x01
+#define TRACTION_CONTROL_BRAKE 0x02
+
+typedef struct traction_control_t
+{
+	//shares of full duty the throttle and the brake are held to, 1 free
+	float throttle_limit;
+	float brake_limit;
+	//slip ratios of the last step
+	float drive_slip;
+	float brake_slip;
+	float dt;
+	//TRACTION_CONTROL_* of the last step
+	uint8_t active;
+} traction_control_t;
+
+//dt in s, nothing held back
+void TractionControlInit(traction_control_t* traction, float dt);
+
+//One cycle: speeds in m/s by wheel_speed_sensor_t, front_valid as
+//WheelSpeedFrontValid. Holds out's acceleration and front_brake to the
+//limits, those of the TRACTION_CONTROL_* bits of channels, which the mode
+//decides anew every cycle. A channel left out is let go of. Returns the
+//bits it held back.
+uint8_t TractionControlStep(traction_control_t* traction, const float speeds[WHEEL_SPEED_SENSOR_COUNT],
+	uint8_t front_valid, actuator_command_t* out, uint8_t channels);
+
+#endif /* TRACTIONCONTROL_H_ */
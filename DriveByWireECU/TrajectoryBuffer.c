@@ -0,0 +1,70 @@
+/*
+ * TrajectoryBuffer.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "TrajectoryBuffer.h"
+#include "FastCode.h"
+
+#if TRAJECTORY_DEPTH & (TRAJECTORY_DEPTH - 1) || TRAJECTORY_DEPTH > 128
+#error TRAJECTORY_DEPTH must be a power of 2 up to 128
+#endif
+
+#define POINT(trajectory, n) (&(trajectory)->points[((trajectory)->head + (n)) & (TRAJECTORY_DEPTH - 1)])
+
+//PTP time wraps, a is at or after b within half the range
+#define AT_OR_AFTER(a, b) ((int32_t)((a) - (b)) >= 0)
+
+void TrajectoryBufferReset(trajectory_buffer_t* trajectory)
+{
+	trajectory->head = 0;
+	trajectory->count = 0;
+}
+
+FAST_CODE void TrajectoryBufferMerge(trajectory_buffer_t* trajectory, const trajectory_point_t* points, uint8_t count)
+{
+	if( count == 0 )
+		return;
+
+	//the new batch is the newer plan from its first point on
+	while( trajectory->count && AT_OR_AFTER(POINT(trajectory, trajectory->count - 1)->time, points[0].time) )
+		trajectory->count--;
+
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		if( trajectory->count == TRAJECTORY_DEPTH )
+		{
+			trajectory->head = (trajectory->head + 1) & (TRAJECTORY_DEPTH - 1);
+			trajectory->count--;
+		}
+		*POINT(trajectory, trajectory->count) = points[i];
+		trajectory->count++;
+	}
+}
+
+FAST_CODE uint8_t TrajectoryBufferSample(trajectory_buffer_t* trajectory, uint32_t now, float* speed, float* steering)
+{
+	//past ones go, the last point stays to be held
+	while( trajectory->count >= 2 && AT_OR_AFTER(now, POINT(trajectory, 1)->time) )
+	{
+		trajectory->head = (trajectory->head + 1) & (TRAJECTORY_DEPTH - 1);
+		trajectory->count--;
+	}
+	if( trajectory->count == 0 )
+		return 0;
+
+	const trajectory_point_t* from = POINT(trajectory, 0);
+	if( trajectory->count == 1 || AT_OR_AFTER(from->time, now) )
+	{
+		*speed = from->speed;
+		*steering = from->steering;
+		return 1;
+	}
+
+	const trajectory_point_t* to = POINT(trajectory, 1);
+	float share = (float)(now - from->time) / (float)(to->time - from->time);
+	*speed = from->speed + (to->speed - from->speed) * share;
+	*steering = from->steering + (to->steering - from->steering) * share;
+	return 1;
+}
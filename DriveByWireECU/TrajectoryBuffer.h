@@ -0,0 +1,58 @@
+/*
+ * TrajectoryBuffer.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TRAJECTORYBUFFER_H_
+#define TRAJECTORYBUFFER_H_
+
+#include <stdint.h>
+
+//Setpoints the driving agent sends ahead of time, followed by the ECU on
+//its own clock.
+//
+//A trajectory command (ControlProtocol.h) carries up to
+//TRAJECTORY_BATCH_MAX future (time, speed, steering) points. main_task
+//merges every batch into a ring of TRAJECTORY_DEPTH points, replacing
+//whatever the ring held from the batch's first point on, and every control
+//cycle interpolates the speed and steering requests between the two points
+//around the cycle's PTP time (Ptp.h). Before the first point the first
+//point's values apply, past the last one its values are held until a new
+//batch or the comm timeout. Points behind the cycle's time are dropped as
+//it passes them, a sample is O(1) over time.
+
+//Points per trajectory command
+#define TRAJECTORY_BATCH_MAX 16
+
+//Points kept, a power of 2
+#ifndef TRAJECTORY_DEPTH
+#define TRAJECTORY_DEPTH 32
+#endif
+
+typedef struct trajectory_point_t
+{
+	//PTP us, low 32 bits
+	uint32_t time;
+	float speed;
+	float steering;
+} trajectory_point_t;
+
+typedef struct trajectory_buffer_t
+{
+	uint8_t head;
+	uint8_t count;
+	trajectory_point_t points[TRAJECTORY_DEPTH];
+} trajectory_buffer_t;
+
+void TrajectoryBufferReset(trajectory_buffer_t* trajectory);
+
+//Adds count points in increasing time order, dropping every point held
+//from points[0].time on, and the oldest ones if the ring is full.
+void TrajectoryBufferMerge(trajectory_buffer_t* trajectory, const trajectory_point_t* points, uint8_t count);
+
+//Setpoints at now in PTP us. Returns 0 and leaves them if there are no
+//points.
+uint8_t TrajectoryBufferSample(trajectory_buffer_t* trajectory, uint32_t now, float* speed, float* steering);
+
+#endif /* TRAJECTORYBUFFER_H_ */
@@ -0,0 +1,69 @@
+/*
+ * TripleBuffer.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef TRIPLEBUFFER_H_
+#define TRIPLEBUFFER_H_
+
+#include <stdint.h>
+
+//Lock-free single writer / single reader hand-off of the latest value.
+//The caller owns three slots of whatever type it is exchanging; this only
+//tracks which slot belongs to the writer, which to the reader and which one
+//is in the middle waiting to be picked up. Neither side ever waits on the
+//other, so it is safe between tasks of any priority and from ISRs.
+//
+//Every publish must fill the whole write slot, the slot handed back to the
+//writer holds stale data from an earlier cycle.
+
+#define TRIPLE_BUFFER_INDEX_MASK 0x03
+#define TRIPLE_BUFFER_FRESH 0x04
+
+typedef struct triple_buffer_t
+{
+	uint8_t write_index;	//only touched by the writer
+	uint8_t read_index;		//only touched by the reader
+	uint8_t middle;			//slot index | TRIPLE_BUFFER_FRESH, swapped atomically
+} triple_buffer_t;
+
+static inline void TripleBufferInit(triple_buffer_t* tb)
+{
+	tb->write_index = 0;
+	tb->middle = 1;
+	tb->read_index = 2;
+}
+
+//Index of the slot the writer should fill next.
+static inline uint8_t TripleBufferWriteIndex(const triple_buffer_t* tb)
+{
+	return tb->write_index;
+}
+
+//Makes the write slot the newest value and takes back the middle slot.
+static inline void TripleBufferPublish(triple_buffer_t* tb)
+{
+	uint8_t previous = __atomic_exchange_n(&tb->middle, (uint8_t)(tb->write_index | TRIPLE_BUFFER_FRESH), __ATOMIC_ACQ_REL);
+	tb->write_index = previous & TRIPLE_BUFFER_INDEX_MASK;
+}
+
+//Moves the newest published value into the read slot.
+//Returns non-zero if there was something new since the last call.
+static inline uint8_t TripleBufferUpdate(triple_buffer_t* tb)
+{
+	if( !(__atomic_load_n(&tb->middle, __ATOMIC_ACQUIRE) & TRIPLE_BUFFER_FRESH) )
+		return 0;
+
+	uint8_t previous = __atomic_exchange_n(&tb->middle, tb->read_index, __ATOMIC_ACQ_REL);
+	tb->read_index = previous & TRIPLE_BUFFER_INDEX_MASK;
+	return 1;
+}
+
+//Index of the slot the reader may use until its next TripleBufferUpdate.
+static inline uint8_t TripleBufferReadIndex(const triple_buffer_t* tb)
+{
+	return tb->read_index;
+}
+
+#endif /* TRIPLEBUFFER_H_ */
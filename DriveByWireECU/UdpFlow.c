@@ -0,0 +1,175 @@
+/*
+ * UdpFlow.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "UdpFlow.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/stats.h"
+#include "ethif_mac.h"
+
+//sending needs ethernetif_mac_output_prefixed
+#if CONF_GMAC_TX_SCATTER_GATHER
+
+static inline struct eth_hdr* EthHeader(udp_flow_t* flow)
+{
+	return (struct eth_hdr*)flow->header;
+}
+
+static inline struct ip_hdr* IpHeader(udp_flow_t* flow)
+{
+	return (struct ip_hdr*)((uint8_t*)flow->header + SIZEOF_ETH_HDR);
+}
+
+static inline struct udp_hdr* UdpHeader(udp_flow_t* flow)
+{
+	return (struct udp_hdr*)((uint8_t*)flow->header + SIZEOF_ETH_HDR + IP_HLEN);
+}
+
+//Words are summed as they sit in memory, the folded sum can be stored as is
+static uint32_t SumWords(const void* data, uint16_t length)
+{
+	const uint16_t* word = (const uint16_t*)data;
+	uint32_t sum = 0;
+
+	for(uint16_t i = 0; i < length / 2; ++i)
+		sum += word[i];
+	return sum;
+}
+
+static inline uint16_t FoldSum(uint32_t sum)
+{
+	while( sum >> 16 )
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	return (uint16_t)sum;
+}
+
+//MAC the datagrams have to be sent to, the peer's own or the gateway's
+static err_t ResolvePeer(struct netif* netif, ip_addr_t* dest, struct eth_addr* mac)
+{
+	if( ip_addr_isbroadcast(dest, netif) )
+	{
+		*mac = ethbroadcast;
+		return ERR_OK;
+	}
+	if( ip_addr_ismulticast(dest) )
+	{
+		mac->addr[0] = 0x01;
+		mac->addr[1] = 0x00;
+		mac->addr[2] = 0x5e;
+		mac->addr[3] = ip4_addr2(dest) & 0x7f;
+		mac->addr[4] = ip4_addr3(dest);
+		mac->addr[5] = ip4_addr4(dest);
+		return ERR_OK;
+	}
+
+	ip_addr_t* hop = dest;
+	if( !ip_addr_netcmp(dest, &netif->ip_addr, &netif->netmask) )
+	{
+		if( ip_addr_isany(&netif->gw) )
+			return ERR_RTE;
+		hop = &netif->gw;
+	}
+
+	struct eth_addr* found;
+	ip_addr_t* found_ip;
+	if( etharp_find_addr(netif, hop, &found, &found_ip) < 0 )
+		return ERR_INPROGRESS;
+	*mac = *found;
+	return ERR_OK;
+}
+
+err_t UdpFlowOpen(udp_flow_t* flow, uint32_t address, uint16_t port, uint16_t src_port)
+{
+	ip_addr_t dest;
+	struct eth_addr mac;
+
+	flow->open = 0;
+	dest.addr = address;
+	flow->netif = ip_route(&dest);
+	if( flow->netif == NULL )
+		return ERR_RTE;
+
+	err_t err = ResolvePeer(flow->netif, &dest, &mac);
+	if( err != ERR_OK )
+		return err;
+
+	memset(flow->header, 0, sizeof(flow->header));
+
+	struct eth_hdr* ethhdr = EthHeader(flow);
+	ethhdr->dest = mac;
+	memcpy(ethhdr->src.addr, flow->netif->hwaddr, ETHARP_HWADDR_LEN);
+	ethhdr->type = PP_HTONS(ETHTYPE_IP);
+
+	//never fragmented, so the ID does not have to be unique
+	struct ip_hdr* iphdr = IpHeader(flow);
+	IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+	IPH_OFFSET_SET(iphdr, PP_HTONS(IP_DF));
+	IPH_TTL_SET(iphdr, UDP_TTL);
+	IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+	ip_addr_copy(iphdr->src, flow->netif->ip_addr);
+	ip_addr_copy(iphdr->dest, dest);
+
+	struct udp_hdr* udphdr = UdpHeader(flow);
+	udphdr->src = htons(src_port);
+	udphdr->dest = htons(port);
+
+	//length, ID and checksums are still 0 and add nothing
+	flow->ip_sum = SumWords(iphdr, IP_HLEN);
+	flow->udp_sum = SumWords(&iphdr->src, 2 * sizeof(ip_addr_p_t)) + PP_HTONS(IP_PROTO_UDP) + SumWords(udphdr, UDP_HLEN);
+
+	flow->address = address;
+	flow->port = port;
+	flow->open = 1;
+	return ERR_OK;
+}
+
+void UdpFlowClose(udp_flow_t* flow)
+{
+	flow->open = 0;
+}
+
+uint8_t UdpFlowMatches(const udp_flow_t* flow, uint32_t address, uint16_t port)
+{
+	return flow->open && flow->address == address && flow->port == port;
+}
+
+err_t UdpFlowSend(udp_flow_t* flow, struct pbuf* p)
+{
+	if( !flow->open )
+		return ERR_CONN;
+	if( p->tot_len > flow->netif->mtu - IP_HLEN - UDP_HLEN )
+		return ERR_VAL;
+
+	struct ip_hdr* iphdr = IpHeader(flow);
+	struct udp_hdr* udphdr = UdpHeader(flow);
+	uint16_t udp_length = htons(UDP_HLEN + p->tot_len);
+
+	IPH_LEN_SET(iphdr, htons(IP_HLEN + UDP_HLEN + p->tot_len));
+	IPH_ID_SET(iphdr, htons(flow->id));
+	flow->id++;
+	udphdr->len = udp_length;
+
+	//without checksum offload the fields are filled in here, otherwise the
+	//GMAC fills in the zeroes left in them
+#if CHECKSUM_GEN_IP
+	IPH_CHKSUM_SET(iphdr, ~FoldSum(flow->ip_sum + IPH_LEN(iphdr) + IPH_ID(iphdr)));
+#endif
+#if CHECKSUM_GEN_UDP
+	//the pseudo header carries the length as well as the UDP header
+	uint16_t chksum = ~FoldSum(flow->udp_sum + 2 * (uint32_t)udp_length + (uint16_t)~inet_chksum_pbuf(p));
+	udphdr->chksum = chksum == 0 ? 0xFFFF : chksum;
+#endif
+
+	err_t err = ethernetif_mac_output_prefixed(flow->netif, (uint8_t*)flow->header + ETH_PAD_SIZE, UDP_FLOW_HEADER_SIZE - ETH_PAD_SIZE, p);
+	if( err != ERR_OK )
+		return err;
+
+	IP_STATS_INC(ip.xmit);
+	UDP_STATS_INC(udp.xmit);
+	return ERR_OK;
+}
+
+#endif
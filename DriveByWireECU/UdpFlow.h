@@ -0,0 +1,62 @@
+/*
+ * UdpFlow.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef UDPFLOW_H_
+#define UDPFLOW_H_
+
+#include <stdint.h>
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip.h"
+#include "lwip/udp.h"
+#include "netif/etharp.h"
+
+//Pinned UDP flow: datagrams to one fixed peer that skip udp_sendto,
+//ip_output and etharp_output.
+//The Ethernet, IP and UDP headers are built once when the flow is opened,
+//with the peer's MAC looked up then. Each send only patches the lengths and
+//the IP ID into them, adds the payload to the checksums that were summed at
+//open time when the GMAC does not insert them, and queues the header and
+//the payload pbuf on the GMAC.
+//The peer's MAC is not followed after opening, reopen the flow now and then
+//to pick up a changed ARP entry.
+//Everything here has to run in the tcpip thread or under the core lock.
+//Only built with CONF_GMAC_TX_SCATTER_GATHER.
+
+//SIZEOF_ETH_HDR counts the ETH_PAD_SIZE padding in front of the Ethernet header
+#define UDP_FLOW_HEADER_SIZE (SIZEOF_ETH_HDR + IP_HLEN + UDP_HLEN)
+
+typedef struct udp_flow_t
+{
+	struct netif* netif;
+	//padding and headers, word aligned so the IP header is too
+	uint32_t header[(UDP_FLOW_HEADER_SIZE + 3) / 4];
+	//one's complement sums of the header words that never change
+	uint32_t ip_sum;
+	uint32_t udp_sum;
+	uint32_t address;
+	uint16_t port;
+	uint16_t id;
+	uint8_t open;
+} udp_flow_t;
+
+//Builds the headers for datagrams from src_port to address:port, address in
+//network order like ip_addr_t. ERR_RTE when no interface reaches the peer,
+//ERR_INPROGRESS when its MAC is not known yet. Nothing is resolved here,
+//sending through udp_sendto meanwhile gets the MAC into the ARP table.
+err_t UdpFlowOpen(udp_flow_t* flow, uint32_t address, uint16_t port, uint16_t src_port);
+
+//Closed flows never match
+void UdpFlowClose(udp_flow_t* flow);
+
+//Non zero if flow is open and goes to address:port
+uint8_t UdpFlowMatches(const udp_flow_t* flow, uint32_t address, uint16_t port);
+
+//Sends p as the payload of one datagram. p is sent in place and referenced
+//until the GMAC is done with it, like with udp_sendto.
+err_t UdpFlowSend(udp_flow_t* flow, struct pbuf* p);
+
+#endif /* UDPFLOW_H_ */
@@ -0,0 +1,555 @@
+/*
+ * UsbCdc.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hal_gpio.h>
+#include <hri_usb_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <hri_oscctrl_e54.h>
+#include "UsbCdc.h"
+
+#define USB_CDC_GCLK 3
+#define USB_CDC_DPLL 1
+//XOSC1 in DPLLCTRLB.REFCLK
+#define USB_CDC_DPLL_XOSC1 3
+
+#define USB_CDC_EP0_SIZE 64
+#define USB_CDC_DATA_SIZE 64
+#define USB_CDC_NOTIFY_SIZE 8
+//PCKSIZE.SIZE of 64 byte packets
+#define USB_CDC_PCKSIZE_64 3
+
+#define USB_CDC_NOTIFY_EP 1
+#define USB_CDC_DATA_EP 2
+#define USB_CDC_ENDPOINTS 3
+
+//EPCFG.EPTYPE
+#define USB_CDC_EPTYPE_CONTROL 1
+#define USB_CDC_EPTYPE_BULK 3
+#define USB_CDC_EPTYPE_INTERRUPT 4
+
+//Pad calibration in the software calibration row, and what to use when
+//the row was erased
+#define USB_CDC_PAD_TRANSN_POS 32
+#define USB_CDC_PAD_TRANSP_POS 37
+#define USB_CDC_PAD_TRIM_POS 42
+#define USB_CDC_PAD_TRANSN_DEFAULT 5
+#define USB_CDC_PAD_TRANSP_DEFAULT 29
+#define USB_CDC_PAD_TRIM_DEFAULT 3
+
+#define USB_REQUEST_GET_STATUS 0
+#define USB_REQUEST_CLEAR_FEATURE 1
+#define USB_REQUEST_SET_FEATURE 3
+#define USB_REQUEST_SET_ADDRESS 5
+#define USB_REQUEST_GET_DESCRIPTOR 6
+#define USB_REQUEST_GET_CONFIGURATION 8
+#define USB_REQUEST_SET_CONFIGURATION 9
+#define USB_REQUEST_GET_INTERFACE 10
+#define USB_REQUEST_SET_INTERFACE 11
+#define CDC_REQUEST_SET_LINE_CODING 0x20
+#define CDC_REQUEST_GET_LINE_CODING 0x21
+#define CDC_REQUEST_SET_CONTROL_LINE_STATE 0x22
+#define CDC_REQUEST_SEND_BREAK 0x23
+
+//bmRequestType type bits
+#define USB_REQUEST_TYPE_MASK 0x60
+#define USB_REQUEST_STANDARD 0x00
+#define USB_REQUEST_CLASS 0x20
+
+#define USB_DESCRIPTOR_DEVICE 1
+#define USB_DESCRIPTOR_CONFIGURATION 2
+#define USB_DESCRIPTOR_STRING 3
+
+typedef struct usb_setup_t
+{
+	uint8_t type;
+	uint8_t request;
+	uint16_t value;
+	uint16_t index;
+	uint16_t length;
+} usb_setup_t;
+
+static const uint8_t device_descriptor[] =
+{
+	18, USB_DESCRIPTOR_DEVICE, 0x00, 0x02,
+	//communications device, the interfaces say the rest
+	0x02, 0x00, 0x00, USB_CDC_EP0_SIZE,
+	USB_CDC_VENDOR_ID & 0xFF, USB_CDC_VENDOR_ID >> 8, USB_CDC_PRODUCT_ID & 0xFF, USB_CDC_PRODUCT_ID >> 8,
+	0x00, 0x01, 1, 2, 0, 1
+};
+
+static const uint8_t configuration_descriptor[] =
+{
+	//self powered, 100mA at most from the bus
+	9, USB_DESCRIPTOR_CONFIGURATION, 67, 0, 2, 1, 0, 0xC0, 50,
+
+	//communications interface, AT commands that are never sent
+	9, 4, 0, 0, 1, 0x02, 0x02, 0x01, 0,
+	//header, CDC 1.10
+	5, 0x24, 0x00, 0x10, 0x01,
+	//call management over the communications interface, data interface 1
+	5, 0x24, 0x01, 0x00, 1,
+	//abstract control management: line coding and control line state
+	4, 0x24, 0x02, 0x02,
+	//union of interfaces 0 and 1
+	5, 0x24, 0x06, 0, 1,
+	//notifications, interrupt IN
+	7, 5, 0x80 | USB_CDC_NOTIFY_EP, 0x03, USB_CDC_NOTIFY_SIZE, 0, 16,
+
+	//data interface
+	9, 4, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+	7, 5, USB_CDC_DATA_EP, 0x02, USB_CDC_DATA_SIZE, 0, 0,
+	7, 5, 0x80 | USB_CDC_DATA_EP, 0x02, USB_CDC_DATA_SIZE, 0, 0,
+};
+
+//Index 1 and 2, sent as UTF-16
+static const char* const strings[] = { "Drive By Wire", "Drive By Wire ECU debug" };
+
+typedef struct usb_cdc_t
+{
+	//the USB moves data in and out of these itself
+	UsbDeviceDescriptor descriptors[USB_CDC_ENDPOINTS];
+	uint8_t ep0_out[USB_CDC_EP0_SIZE];
+	uint8_t ep0_in[128];
+	uint8_t rx[USB_CDC_RX_SIZE];
+	uint8_t tx[USB_CDC_TX_SIZE];
+
+	TaskHandle_t notify;
+	//SET_ADDRESS, applied once its status stage went out
+	uint8_t address;
+	uint8_t configuration;
+	uint8_t dtr;
+	//SET_LINE_CODING data stage expected on endpoint 0
+	uint8_t line_coding_pending;
+	uint8_t line_coding[7];
+	volatile uint8_t tx_busy;
+	volatile uint8_t rx_ready;
+	uint16_t rx_length;
+} usb_cdc_t;
+
+static usb_cdc_t usb_cdc __attribute__((aligned(4))) =
+{
+	//115200 8N1 until the PC sets its own
+	.line_coding = { 0x00, 0xC2, 0x01, 0x00, 0, 0, 8 },
+};
+
+static void Notify(BaseType_t* woken)
+{
+	if( usb_cdc.notify != NULL )
+		vTaskNotifyGiveFromISR(usb_cdc.notify, woken);
+}
+
+static void InitClock()
+{
+	//XOSC1 / (2 * (2 + 1)) = 2MHz reference, * (23 + 1) = 48MHz
+	hri_oscctrl_write_DPLLRATIO_reg(OSCCTRL, USB_CDC_DPLL, OSCCTRL_DPLLRATIO_LDRFRAC(0) | OSCCTRL_DPLLRATIO_LDR(23));
+	hri_oscctrl_write_DPLLCTRLB_reg(OSCCTRL, USB_CDC_DPLL, OSCCTRL_DPLLCTRLB_DIV(2) | OSCCTRL_DPLLCTRLB_REFCLK(USB_CDC_DPLL_XOSC1));
+	hri_oscctrl_write_DPLLCTRLA_reg(OSCCTRL, USB_CDC_DPLL, OSCCTRL_DPLLCTRLA_ENABLE);
+	while( !(hri_oscctrl_get_DPLLSTATUS_LOCK_bit(OSCCTRL, USB_CDC_DPLL) || hri_oscctrl_get_DPLLSTATUS_CLKRDY_bit(OSCCTRL, USB_CDC_DPLL)) )
+		;
+
+	hri_gclk_write_GENCTRL_reg(GCLK, USB_CDC_GCLK, GCLK_GENCTRL_SRC_DPLL1 | GCLK_GENCTRL_GENEN | GCLK_GENCTRL_DIV(1));
+	hri_gclk_write_PCHCTRL_reg(GCLK, USB_GCLK_ID, GCLK_PCHCTRL_GEN(USB_CDC_GCLK) | (1 << GCLK_PCHCTRL_CHEN_Pos));
+	hri_mclk_set_AHBMASK_USB_bit(MCLK);
+	hri_mclk_set_APBBMASK_USB_bit(MCLK);
+}
+
+static uint32_t PadField(uint32_t position, uint32_t bits, uint32_t fallback)
+{
+	uint32_t value = (((const uint32_t*)NVMCTRL_SW0)[position / 32] >> (position % 32)) & ((1UL << bits) - 1);
+	return value == (1UL << bits) - 1 ? fallback : value;
+}
+
+//The USB splits length into packets itself. With zlp a transfer that is
+//a whole number of packets ends with a zero length one, so the PC knows
+//it is over.
+static void StartIn(uint8_t endpoint, uint8_t* data, uint16_t length, uint8_t zlp)
+{
+	UsbDeviceDescBank* bank = &usb_cdc.descriptors[endpoint].DeviceDescBank[1];
+	bank->ADDR.reg = (uint32_t)data;
+	bank->PCKSIZE.reg = USB_DEVICE_PCKSIZE_SIZE(USB_CDC_PCKSIZE_64) | USB_DEVICE_PCKSIZE_BYTE_COUNT(length)
+		| USB_DEVICE_PCKSIZE_MULTI_PACKET_SIZE(0) | (zlp ? USB_DEVICE_PCKSIZE_AUTO_ZLP : 0);
+	hri_usbendpoint_set_EPSTATUS_reg(USB, endpoint, USB_DEVICE_EPSTATUS_BK1RDY);
+}
+
+static void StartOut(uint8_t endpoint, uint8_t* data, uint16_t size)
+{
+	UsbDeviceDescBank* bank = &usb_cdc.descriptors[endpoint].DeviceDescBank[0];
+	bank->ADDR.reg = (uint32_t)data;
+	bank->PCKSIZE.reg = USB_DEVICE_PCKSIZE_SIZE(USB_CDC_PCKSIZE_64) | USB_DEVICE_PCKSIZE_BYTE_COUNT(0)
+		| USB_DEVICE_PCKSIZE_MULTI_PACKET_SIZE(size);
+	hri_usbendpoint_clear_EPSTATUS_reg(USB, endpoint, USB_DEVICE_EPSTATUS_BK0RDY);
+}
+
+static uint16_t OutLength(uint8_t endpoint)
+{
+	return (usb_cdc.descriptors[endpoint].DeviceDescBank[0].PCKSIZE.reg & USB_DEVICE_PCKSIZE_BYTE_COUNT_Msk)
+		>> USB_DEVICE_PCKSIZE_BYTE_COUNT_Pos;
+}
+
+//The data stage out of ep0_in, at most what the PC asked for. Only a
+//shorter one has to be ended.
+static void ControlSend(uint16_t length, uint16_t requested)
+{
+	if( length < requested )
+		StartIn(0, usb_cdc.ep0_in, length, 1);
+	else
+		StartIn(0, usb_cdc.ep0_in, requested, 0);
+}
+
+static void ControlStatus()
+{
+	StartIn(0, usb_cdc.ep0_in, 0, 0);
+}
+
+static void ControlStall()
+{
+	hri_usbendpoint_set_EPSTATUS_reg(USB, 0, USB_DEVICE_EPSTATUS_STALLRQ0 | USB_DEVICE_EPSTATUS_STALLRQ1);
+}
+
+static uint16_t StringDescriptor(uint8_t index)
+{
+	uint8_t* out = usb_cdc.ep0_in;
+	uint16_t length = 2;
+	if( index == 0 )
+	{
+		//US English only
+		out[2] = 0x09;
+		out[3] = 0x04;
+		length = 4;
+	}
+	else if( index <= sizeof(strings) / sizeof(strings[0]) )
+	{
+		for(const char* c = strings[index - 1]; *c != 0 && length + 2 <= sizeof(usb_cdc.ep0_in); ++c)
+		{
+			out[length++] = *c;
+			out[length++] = 0;
+		}
+	}
+	else
+		return 0;
+	out[0] = length;
+	out[1] = USB_DESCRIPTOR_STRING;
+	return length;
+}
+
+static void GetDescriptor(const usb_setup_t* setup)
+{
+	uint16_t length = 0;
+	switch( setup->value >> 8 )
+	{
+	case USB_DESCRIPTOR_DEVICE:
+		length = sizeof(device_descriptor);
+		memcpy(usb_cdc.ep0_in, device_descriptor, length);
+		break;
+	case USB_DESCRIPTOR_CONFIGURATION:
+		length = sizeof(configuration_descriptor);
+		memcpy(usb_cdc.ep0_in, configuration_descriptor, length);
+		break;
+	case USB_DESCRIPTOR_STRING:
+		length = StringDescriptor(setup->value & 0xFF);
+		break;
+	}
+	if( length )
+		ControlSend(length, setup->length);
+	else
+		ControlStall();
+}
+
+static void Configure(uint8_t configuration)
+{
+	usb_cdc.configuration = configuration;
+	usb_cdc.tx_busy = 0;
+	usb_cdc.rx_ready = 0;
+	if( !configuration )
+	{
+		hri_usbendpoint_write_EPCFG_reg(USB, USB_CDC_NOTIFY_EP, 0);
+		hri_usbendpoint_write_EPCFG_reg(USB, USB_CDC_DATA_EP, 0);
+		return;
+	}
+
+	//nothing is ever sent on the notification endpoint, the PC only polls it
+	hri_usbendpoint_write_EPCFG_reg(USB, USB_CDC_NOTIFY_EP, USB_DEVICE_EPCFG_EPTYPE1(USB_CDC_EPTYPE_INTERRUPT));
+	hri_usbendpoint_write_EPCFG_reg(USB, USB_CDC_DATA_EP,
+		USB_DEVICE_EPCFG_EPTYPE0(USB_CDC_EPTYPE_BULK) | USB_DEVICE_EPCFG_EPTYPE1(USB_CDC_EPTYPE_BULK));
+	hri_usbendpoint_clear_EPSTATUS_reg(USB, USB_CDC_NOTIFY_EP, USB_DEVICE_EPSTATUS_DTGLIN | USB_DEVICE_EPSTATUS_BK1RDY);
+	hri_usbendpoint_clear_EPSTATUS_reg(USB, USB_CDC_DATA_EP, USB_DEVICE_EPSTATUS_DTGLIN | USB_DEVICE_EPSTATUS_DTGLOUT
+		| USB_DEVICE_EPSTATUS_BK1RDY);
+	hri_usbendpoint_set_EPINTEN_reg(USB, USB_CDC_DATA_EP, USB_DEVICE_EPINTENSET_TRCPT0 | USB_DEVICE_EPINTENSET_TRCPT1);
+	StartOut(USB_CDC_DATA_EP, usb_cdc.rx, USB_CDC_RX_SIZE);
+}
+
+static void Setup(const usb_setup_t* setup, BaseType_t* woken)
+{
+	uint8_t* in = usb_cdc.ep0_in;
+
+	if( (setup->type & USB_REQUEST_TYPE_MASK) == USB_REQUEST_CLASS )
+	{
+		switch( setup->request )
+		{
+		case CDC_REQUEST_SET_LINE_CODING:
+			//the status goes once the data stage is in
+			usb_cdc.line_coding_pending = 1;
+			return;
+		case CDC_REQUEST_GET_LINE_CODING:
+			memcpy(in, usb_cdc.line_coding, sizeof(usb_cdc.line_coding));
+			ControlSend(sizeof(usb_cdc.line_coding), setup->length);
+			return;
+		case CDC_REQUEST_SET_CONTROL_LINE_STATE:
+			usb_cdc.dtr = setup->value & 1;
+			Notify(woken);
+			ControlStatus();
+			return;
+		case CDC_REQUEST_SEND_BREAK:
+			ControlStatus();
+			return;
+		}
+		ControlStall();
+		return;
+	}
+	if( (setup->type & USB_REQUEST_TYPE_MASK) != USB_REQUEST_STANDARD )
+	{
+		ControlStall();
+		return;
+	}
+
+	switch( setup->request )
+	{
+	case USB_REQUEST_GET_DESCRIPTOR:
+		GetDescriptor(setup);
+		break;
+	case USB_REQUEST_SET_ADDRESS:
+		usb_cdc.address = setup->value & 0x7F;
+		ControlStatus();
+		break;
+	case USB_REQUEST_GET_CONFIGURATION:
+		in[0] = usb_cdc.configuration;
+		ControlSend(1, setup->length);
+		break;
+	case USB_REQUEST_SET_CONFIGURATION:
+		if( setup->value > 1 )
+		{
+			ControlStall();
+			break;
+		}
+		Configure(setup->value);
+		Notify(woken);
+		ControlStatus();
+		break;
+	case USB_REQUEST_GET_STATUS:
+		//self powered device, endpoints never halted
+		in[0] = (setup->type & 0x1F) == 0 ? 1 : 0;
+		in[1] = 0;
+		ControlSend(2, setup->length);
+		break;
+	case USB_REQUEST_GET_INTERFACE:
+		in[0] = 0;
+		ControlSend(1, setup->length);
+		break;
+	case USB_REQUEST_CLEAR_FEATURE:
+		//a halt the PC clears starts the endpoint over at DATA0
+		if( (setup->type & 0x1F) == 2 && (setup->index & 0x0F) == USB_CDC_DATA_EP )
+			hri_usbendpoint_clear_EPSTATUS_reg(USB, USB_CDC_DATA_EP,
+				(setup->index & 0x80) ? USB_DEVICE_EPSTATUS_DTGLIN : USB_DEVICE_EPSTATUS_DTGLOUT);
+		ControlStatus();
+		break;
+	case USB_REQUEST_SET_FEATURE:
+	case USB_REQUEST_SET_INTERFACE:
+		ControlStatus();
+		break;
+	default:
+		ControlStall();
+		break;
+	}
+}
+
+static void Reset()
+{
+	usb_cdc.address = 0;
+	usb_cdc.dtr = 0;
+	usb_cdc.line_coding_pending = 0;
+	Configure(0);
+	hri_usbdevice_write_DADD_reg(USB, 0);
+
+	hri_usbendpoint_write_EPCFG_reg(USB, 0,
+		USB_DEVICE_EPCFG_EPTYPE0(USB_CDC_EPTYPE_CONTROL) | USB_DEVICE_EPCFG_EPTYPE1(USB_CDC_EPTYPE_CONTROL));
+	StartOut(0, usb_cdc.ep0_out, USB_CDC_EP0_SIZE);
+	hri_usbendpoint_set_EPINTEN_reg(USB, 0,
+		USB_DEVICE_EPINTENSET_RXSTP | USB_DEVICE_EPINTENSET_TRCPT0 | USB_DEVICE_EPINTENSET_TRCPT1);
+}
+
+static void ControlEndpoint(BaseType_t* woken)
+{
+	uint8_t flags = hri_usbendpoint_read_EPINTFLAG_reg(USB, 0);
+
+	if( flags & USB_DEVICE_EPINTFLAG_RXSTP )
+	{
+		hri_usbendpoint_clear_EPINTFLAG_reg(USB, 0,
+			USB_DEVICE_EPINTFLAG_RXSTP | USB_DEVICE_EPINTFLAG_TRCPT0 | USB_DEVICE_EPINTFLAG_TRCPT1);
+		hri_usbendpoint_clear_EPSTATUS_reg(USB, 0, USB_DEVICE_EPSTATUS_STALLRQ0 | USB_DEVICE_EPSTATUS_STALLRQ1);
+		usb_cdc.line_coding_pending = 0;
+		usb_setup_t setup;
+		memcpy(&setup, usb_cdc.ep0_out, sizeof(setup));
+		Setup(&setup, woken);
+		//bank 0 takes the data or status stage that follows
+		StartOut(0, usb_cdc.ep0_out, USB_CDC_EP0_SIZE);
+		return;
+	}
+
+	if( flags & USB_DEVICE_EPINTFLAG_TRCPT1 )
+	{
+		hri_usbendpoint_clear_EPINTFLAG_reg(USB, 0, USB_DEVICE_EPINTFLAG_TRCPT1);
+		if( usb_cdc.address )
+		{
+			hri_usbdevice_write_DADD_reg(USB, USB_DEVICE_DADD_ADDEN | USB_DEVICE_DADD_DADD(usb_cdc.address));
+			usb_cdc.address = 0;
+		}
+	}
+
+	if( flags & USB_DEVICE_EPINTFLAG_TRCPT0 )
+	{
+		hri_usbendpoint_clear_EPINTFLAG_reg(USB, 0, USB_DEVICE_EPINTFLAG_TRCPT0);
+		if( usb_cdc.line_coding_pending && OutLength(0) >= sizeof(usb_cdc.line_coding) )
+		{
+			usb_cdc.line_coding_pending = 0;
+			memcpy(usb_cdc.line_coding, usb_cdc.ep0_out, sizeof(usb_cdc.line_coding));
+			ControlStatus();
+		}
+		StartOut(0, usb_cdc.ep0_out, USB_CDC_EP0_SIZE);
+	}
+}
+
+static void DataEndpoint(BaseType_t* woken)
+{
+	uint8_t flags = hri_usbendpoint_read_EPINTFLAG_reg(USB, USB_CDC_DATA_EP);
+
+	//bank 0 stays full, and the PC's next transfer waits, until UsbCdcRead
+	if( flags & USB_DEVICE_EPINTFLAG_TRCPT0 )
+	{
+		hri_usbendpoint_clear_EPINTFLAG_reg(USB, USB_CDC_DATA_EP, USB_DEVICE_EPINTFLAG_TRCPT0);
+		usb_cdc.rx_length = OutLength(USB_CDC_DATA_EP);
+		usb_cdc.rx_ready = 1;
+		Notify(woken);
+	}
+	if( flags & USB_DEVICE_EPINTFLAG_TRCPT1 )
+	{
+		hri_usbendpoint_clear_EPINTFLAG_reg(USB, USB_CDC_DATA_EP, USB_DEVICE_EPINTFLAG_TRCPT1);
+		usb_cdc.tx_busy = 0;
+		Notify(woken);
+	}
+}
+
+//Every USB interrupt line lands here
+static void UsbInterrupt()
+{
+	BaseType_t woken = pdFALSE;
+
+	if( hri_usbdevice_read_INTFLAG_reg(USB) & USB_DEVICE_INTFLAG_EORST )
+	{
+		hri_usbdevice_clear_INTFLAG_reg(USB, USB_DEVICE_INTFLAG_EORST);
+		Reset();
+		Notify(&woken);
+	}
+
+	uint16_t endpoints = hri_usbdevice_read_EPINTSMRY_reg(USB);
+	if( endpoints & (1 << 0) )
+		ControlEndpoint(&woken);
+	if( endpoints & (1 << USB_CDC_DATA_EP) )
+		DataEndpoint(&woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+void USB_0_Handler()
+{
+	UsbInterrupt();
+}
+
+void USB_1_Handler()
+{
+	UsbInterrupt();
+}
+
+void USB_2_Handler()
+{
+	UsbInterrupt();
+}
+
+void USB_3_Handler()
+{
+	UsbInterrupt();
+}
+
+void UsbCdcInit(TaskHandle_t notify)
+{
+	usb_cdc.notify = notify;
+	InitClock();
+	gpio_set_pin_function(GPIO(GPIO_PORTA, 24), PINMUX_PA24H_USB_DM);
+	gpio_set_pin_function(GPIO(GPIO_PORTA, 25), PINMUX_PA25H_USB_DP);
+
+	hri_usb_write_CTRLA_reg(USB, USB_CTRLA_SWRST);
+	hri_usb_wait_for_sync(USB, USB_SYNCBUSY_SWRST);
+	hri_usb_write_PADCAL_reg(USB,
+		USB_PADCAL_TRANSN(PadField(USB_CDC_PAD_TRANSN_POS, 5, USB_CDC_PAD_TRANSN_DEFAULT))
+		| USB_PADCAL_TRANSP(PadField(USB_CDC_PAD_TRANSP_POS, 5, USB_CDC_PAD_TRANSP_DEFAULT))
+		| USB_PADCAL_TRIM(PadField(USB_CDC_PAD_TRIM_POS, 3, USB_CDC_PAD_TRIM_DEFAULT)));
+	hri_usb_write_DESCADD_reg(USB, (uint32_t)usb_cdc.descriptors);
+	//device mode, full speed
+	hri_usbdevice_write_CTRLB_reg(USB, USB_DEVICE_CTRLB_SPDCONF_FS | USB_DEVICE_CTRLB_DETACH);
+	hri_usb_write_CTRLA_reg(USB, USB_CTRLA_ENABLE);
+	hri_usb_wait_for_sync(USB, USB_SYNCBUSY_ENABLE);
+
+	hri_usbdevice_write_INTEN_reg(USB, USB_DEVICE_INTENSET_EORST);
+	for(uint8_t i = 0; i < 4; ++i)
+	{
+		NVIC_SetPriority((IRQn_Type)(USB_0_IRQn + i), IRQ_PRIORITY_USB);
+		NVIC_EnableIRQ((IRQn_Type)(USB_0_IRQn + i));
+	}
+	//the PC sees the pull-up and resets the bus, Reset configures endpoint 0
+	hri_usbdevice_clear_CTRLB_DETACH_bit(USB);
+}
+
+uint8_t UsbCdcConnected()
+{
+	return usb_cdc.configuration && usb_cdc.dtr;
+}
+
+uint16_t UsbCdcRead(uint8_t* data)
+{
+	uint16_t length = 0;
+	taskENTER_CRITICAL();
+	if( usb_cdc.rx_ready && usb_cdc.configuration )
+	{
+		length = usb_cdc.rx_length;
+		memcpy(data, usb_cdc.rx, length);
+		usb_cdc.rx_ready = 0;
+		StartOut(USB_CDC_DATA_EP, usb_cdc.rx, USB_CDC_RX_SIZE);
+	}
+	taskEXIT_CRITICAL();
+	return length;
+}
+
+uint8_t UsbCdcWriteReady()
+{
+	return UsbCdcConnected() && !usb_cdc.tx_busy;
+}
+
+uint8_t UsbCdcWrite(const uint8_t* data, uint16_t length)
+{
+	uint8_t started = 0;
+	if( length > USB_CDC_TX_SIZE )
+		return 0;
+	taskENTER_CRITICAL();
+	if( UsbCdcWriteReady() )
+	{
+		memcpy(usb_cdc.tx, data, length);
+		usb_cdc.tx_busy = 1;
+		StartIn(USB_CDC_DATA_EP, usb_cdc.tx, length, 1);
+		started = 1;
+	}
+	taskEXIT_CRITICAL();
+	return started;
+}
@@ -0,0 +1,56 @@
+/*
+ * UsbCdc.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef USBCDC_H_
+#define USBCDC_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+//Full speed USB device on the SAME54's USB, for UsbDebug.h. It enumerates
+//as a CDC ACM virtual COM port, which every PC has a driver for: a
+///dev/ttyACM on Linux, a COM port on Windows. The line coding the PC sets
+//is accepted and ignored, data moves at whatever rate the bus gives.
+//
+//	PA24 D-, PA25 D+
+//
+//The 48MHz the USB needs comes from DPLL1 on XOSC1 through GCLK3, both
+//unused by either clock profile. One task owns the data endpoints: it is
+//notified from the USB interrupt when data came in, when what it wrote
+//went out and when the PC opened or closed the port.
+
+#ifndef USB_CDC_VENDOR_ID
+#define USB_CDC_VENDOR_ID 0x03EB
+#endif
+#ifndef USB_CDC_PRODUCT_ID
+#define USB_CDC_PRODUCT_ID 0x2404
+#endif
+
+//Largest write, and the bulk OUT transfer that ends without a short packet
+#define USB_CDC_TX_SIZE 512
+#define USB_CDC_RX_SIZE 256
+
+//Brings the USB up and attaches to the bus, notify is the task that gets
+//the notifications. Before the scheduler starts.
+void UsbCdcInit(TaskHandle_t notify);
+
+//Non-zero while the PC has the port open, it raises DTR when it does
+uint8_t UsbCdcConnected();
+
+//Copies what the last bulk OUT transfer brought into data, which holds
+//USB_CDC_RX_SIZE bytes, and hands the endpoint back for the next one.
+//Bytes copied, 0 if nothing came in.
+uint16_t UsbCdcRead(uint8_t* data);
+
+//Non-zero when a write can start, the last one went out
+uint8_t UsbCdcWriteReady();
+
+//Copies length bytes, at most USB_CDC_TX_SIZE, and sends them. Non-zero if
+//the transfer started, which needs UsbCdcWriteReady and an open port.
+uint8_t UsbCdcWrite(const uint8_t* data, uint16_t length);
+
+#endif /* USBCDC_H_ */
@@ -0,0 +1,180 @@
+/*
+ * UsbDebug.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "UsbDebug.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "task_config.h"
+
+#if USB_DEBUG_ENABLE
+
+#include "UsbCdc.h"
+#include "EthernetIO.h"
+#include "Log.h"
+#include "LockProfiler.h"
+
+#if !ETHERNET_RAW_UDP
+#error USB_DEBUG_ENABLE needs ETHERNET_RAW_UDP
+#endif
+
+#define USB_DEBUG_MASK (USB_DEBUG_RING - 1)
+
+#if (USB_DEBUG_RING & USB_DEBUG_MASK) != 0
+#error USB_DEBUG_RING must be a power of two
+#endif
+
+//Largest record the PC sends, a param set or a memory request
+#define USB_DEBUG_RX_SIZE (USB_DEBUG_HEADER_SIZE + ETHERNET_MAX(CONTROL_PARAM_REQUEST_MAX_FRAME_SIZE, \
+	CONTROL_MEMORY_REQUEST_MAX_FRAME_SIZE))
+
+typedef struct usb_debug_t
+{
+	TaskHandle_t task;
+	//writers take it around the ring, the debug task around the reads
+	SemaphoreHandle_t lock;
+	uint8_t ring[USB_DEBUG_RING];
+	uint32_t head;
+	uint32_t tail;
+
+	//the record being received, and how much of it is in
+	uint8_t record[USB_DEBUG_RX_SIZE];
+	uint16_t received;
+	uint8_t rx[USB_CDC_RX_SIZE];
+	uint8_t reply[ETHERNET_ANSWER_MAX_FRAME_SIZE];
+	//of this link, apart from the control channel's
+	control_protocol_t protocol;
+} usb_debug_t;
+
+static usb_debug_t usb_debug;
+
+static void PutRing(const void* data, uint16_t length)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	for(uint16_t i = 0; i < length; ++i)
+		usb_debug.ring[(usb_debug.head + i) & USB_DEBUG_MASK] = bytes[i];
+	usb_debug.head += length;
+}
+
+uint8_t UsbDebugWrite(usb_debug_kind_t kind, const void* payload, uint16_t length)
+{
+	if( usb_debug.lock == NULL || !UsbCdcConnected() )
+		return 0;
+
+	uint8_t header[USB_DEBUG_HEADER_SIZE] = { USB_DEBUG_SYNC, kind, (uint8_t)length, (uint8_t)(length >> 8) };
+	uint8_t queued = 0;
+	LockProfileTake(LOCK_PROFILE_USB_DEBUG, usb_debug.lock, portMAX_DELAY);
+	if( USB_DEBUG_RING - (usb_debug.head - usb_debug.tail) >= USB_DEBUG_HEADER_SIZE + (uint32_t)length )
+	{
+		PutRing(header, sizeof(header));
+		PutRing(payload, length);
+		queued = 1;
+	}
+	LockProfileGive(LOCK_PROFILE_USB_DEBUG, usb_debug.lock);
+	if( queued )
+		xTaskNotifyGive(usb_debug.task);
+	return queued;
+}
+
+//Runs under the core lock, the ring has room for it or it is dropped
+static void Reply(void* arg, const uint8_t* frame, uint16_t length)
+{
+	UsbDebugWrite(USB_DEBUG_FRAME, frame, length);
+}
+
+//Hands the next piece of the ring to the USB, the longest that is
+//contiguous and fits one write
+static void Flush()
+{
+	LockProfileTake(LOCK_PROFILE_USB_DEBUG, usb_debug.lock, portMAX_DELAY);
+	if( !UsbCdcConnected() )
+		//the PC went away, what it did not read is stale
+		usb_debug.tail = usb_debug.head;
+	else if( usb_debug.head != usb_debug.tail && UsbCdcWriteReady() )
+	{
+		uint32_t offset = usb_debug.tail & USB_DEBUG_MASK;
+		uint32_t length = usb_debug.head - usb_debug.tail;
+		if( length > USB_DEBUG_RING - offset )
+			length = USB_DEBUG_RING - offset;
+		if( length > USB_CDC_TX_SIZE )
+			length = USB_CDC_TX_SIZE;
+		if( UsbCdcWrite(&usb_debug.ring[offset], length) )
+			usb_debug.tail += length;
+	}
+	LockProfileGive(LOCK_PROFILE_USB_DEBUG, usb_debug.lock);
+}
+
+//Gathers records out of what came in, resynchronising on the sync byte
+static void Receive(const uint8_t* data, uint16_t length)
+{
+	for(uint16_t i = 0; i < length; ++i)
+	{
+		if( usb_debug.received == 0 && data[i] != USB_DEBUG_SYNC )
+			continue;
+		usb_debug.record[usb_debug.received++] = data[i];
+		if( usb_debug.received < USB_DEBUG_HEADER_SIZE )
+			continue;
+
+		uint16_t payload = usb_debug.record[2] | (usb_debug.record[3] << 8);
+		if( USB_DEBUG_HEADER_SIZE + payload > USB_DEBUG_RX_SIZE )
+		{
+			usb_debug.received = 0;
+			continue;
+		}
+		if( usb_debug.received < USB_DEBUG_HEADER_SIZE + payload )
+			continue;
+
+		if( usb_debug.record[1] == USB_DEBUG_FRAME )
+			EthernetAnswerRequest(&usb_debug.protocol, &usb_debug.record[USB_DEBUG_HEADER_SIZE], payload,
+				usb_debug.reply, Reply, NULL);
+		usb_debug.received = 0;
+	}
+}
+
+static void UsbDebugTask(void* p)
+{
+	uint8_t connected = 0;
+
+	while(1)
+	{
+		//notified by the USB and by every writer
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(USB_DEBUG_POLL_PERIOD));
+
+		if( UsbCdcConnected() != connected )
+		{
+			connected = !connected;
+			usb_debug.received = 0;
+			LOG("usb: debug port %s", connected ? "open" : "closed");
+		}
+
+		uint16_t length = UsbCdcRead(usb_debug.rx);
+		if( length )
+			Receive(usb_debug.rx, length);
+		Flush();
+	}
+}
+
+void UsbDebugStart()
+{
+	ControlProtocolInit(&usb_debug.protocol);
+	usb_debug.lock = xSemaphoreCreateMutex();
+	xTaskCreate(UsbDebugTask, "UsbDbg", TASK_STACK_USB_DEBUG, NULL, TASK_PRIORITY_USB_DEBUG, &usb_debug.task);
+	UsbCdcInit(usb_debug.task);
+}
+
+#else
+
+void UsbDebugStart()
+{
+}
+
+uint8_t UsbDebugWrite(usb_debug_kind_t kind, const void* payload, uint16_t length)
+{
+	return 0;
+}
+
+#endif
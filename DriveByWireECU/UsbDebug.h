@@ -0,0 +1,69 @@
+/*
+ * UsbDebug.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef USBDEBUG_H_
+#define USBDEBUG_H_
+
+#include <stdint.h>
+
+//Diagnostics over the USB virtual COM port (UsbCdc.h), for the shop when
+//the vehicle network is not plugged in: the log, and the trace, profile,
+//task, event, boot and param requests of the control protocol, each
+//answered with the frames the control channel would send. Commands and
+//subscriptions stay Ethernet only, nothing on the bench drives the
+//vehicle through a USB cable.
+//
+//Both ways the port carries records:
+//
+//	0		1		USB_DEBUG_SYNC
+//	1		1		USB_DEBUG_LOG or USB_DEBUG_FRAME
+//	2		2		payload length, little-endian
+//	4		...		payload
+//
+//A log record is the rendered lines, or with LOG_BINARY the binary
+//records, of one of the log service's buffers. A frame record is one
+//ControlProtocol.h frame. The PC sends frame records with requests, a
+//record that is not one is skipped.
+//
+//What goes to the PC waits in a ring of USB_DEBUG_RING bytes. A record
+//that does not fit is dropped, an answer has to be asked for again and a
+//log line still goes to the UART. Nothing is kept while the port is
+//closed. PythonTestScripts/usb_debug.py
+//shows the log, param_tool.py --usb goes through the port.
+//
+//Needs USB_DEBUG_ENABLE and ETHERNET_RAW_UDP, the requests are answered in
+//the control channel's name.
+
+#ifndef USB_DEBUG_ENABLE
+#define USB_DEBUG_ENABLE 0
+#endif
+
+//Bytes waiting for the PC, a power of two. A trace request's answer is
+//about 4.5k.
+#ifndef USB_DEBUG_RING
+#define USB_DEBUG_RING 8192
+#endif
+
+//ms between the debug task's looks at the ring when nothing notified it
+#define USB_DEBUG_POLL_PERIOD 10
+
+#define USB_DEBUG_SYNC 0xA6
+#define USB_DEBUG_HEADER_SIZE 4
+
+typedef enum usb_debug_kind_t
+{
+	USB_DEBUG_LOG = 1,
+	USB_DEBUG_FRAME = 2,
+} usb_debug_kind_t;
+
+//Brings up the USB and creates the debug task. Before the scheduler starts.
+void UsbDebugStart();
+
+//Queues one record for the PC. 0 if it did not fit or the port is closed.
+//From tasks, not from interrupts.
+uint8_t UsbDebugWrite(usb_debug_kind_t kind, const void* payload, uint16_t length);
+
+#endif /* USBDEBUG_H_ */
@@ -0,0 +1,84 @@
+/*
+ * VehicleMode.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "VehicleMode.h"
+#include "EventLog.h"
+#include "FastCode.h"
+
+#define MODE_BIT(mode) (1U << (mode))
+#define ANY_MODE ((1U << VEHICLE_MODE_COUNT) - 1)
+
+typedef struct vehicle_transition_t
+{
+	//modes the row applies in, a MODE_BIT each
+	uint8_t from;
+	//conditions that must all be set, and those that must all be clear
+	uint8_t require;
+	uint8_t forbid;
+	vehicle_mode_t to;
+} vehicle_transition_t;
+
+//First match wins, no match stays in the mode
+static const vehicle_transition_t vehicle_transitions[] =
+{
+	{ ANY_MODE & ~MODE_BIT(VEHICLE_MODE_ESTOP), VEHICLE_CONDITION_ESTOP, 0, VEHICLE_MODE_ESTOP },
+	{ MODE_BIT(VEHICLE_MODE_ESTOP), 0, VEHICLE_CONDITION_ESTOP, VEHICLE_MODE_DISABLED },
+
+	{ MODE_BIT(VEHICLE_MODE_DISABLED) | MODE_BIT(VEHICLE_MODE_TEST) | MODE_BIT(VEHICLE_MODE_AUTONOMOUS) | MODE_BIT(VEHICLE_MODE_PARK)
+		| MODE_BIT(VEHICLE_MODE_CALIBRATE), VEHICLE_CONDITION_TELEOP, 0, VEHICLE_MODE_TELEOP },
+	{ MODE_BIT(VEHICLE_MODE_TELEOP), 0, VEHICLE_CONDITION_TELEOP, VEHICLE_MODE_DISABLED },
+
+	{ MODE_BIT(VEHICLE_MODE_AUTONOMOUS) | MODE_BIT(VEHICLE_MODE_PARK) | MODE_BIT(VEHICLE_MODE_TEST)
+		| MODE_BIT(VEHICLE_MODE_CALIBRATE), VEHICLE_CONDITION_FAULT, 0, VEHICLE_MODE_DISABLED },
+
+	{ MODE_BIT(VEHICLE_MODE_DISABLED), VEHICLE_CONDITION_CALIBRATE, VEHICLE_CONDITION_FAULT, VEHICLE_MODE_CALIBRATE },
+	{ MODE_BIT(VEHICLE_MODE_CALIBRATE), 0, VEHICLE_CONDITION_CALIBRATE, VEHICLE_MODE_DISABLED },
+
+	{ MODE_BIT(VEHICLE_MODE_DISABLED) | MODE_BIT(VEHICLE_MODE_AUTONOMOUS),
+		VEHICLE_CONDITION_AUTONOMOUS | VEHICLE_CONDITION_PARK, VEHICLE_CONDITION_FAULT, VEHICLE_MODE_PARK },
+	{ MODE_BIT(VEHICLE_MODE_DISABLED) | MODE_BIT(VEHICLE_MODE_PARK),
+		VEHICLE_CONDITION_AUTONOMOUS, VEHICLE_CONDITION_PARK | VEHICLE_CONDITION_FAULT, VEHICLE_MODE_AUTONOMOUS },
+	{ MODE_BIT(VEHICLE_MODE_AUTONOMOUS) | MODE_BIT(VEHICLE_MODE_PARK), 0, VEHICLE_CONDITION_AUTONOMOUS, VEHICLE_MODE_DISABLED },
+
+	{ MODE_BIT(VEHICLE_MODE_DISABLED), VEHICLE_CONDITION_TEST, VEHICLE_CONDITION_FAULT, VEHICLE_MODE_TEST },
+	{ MODE_BIT(VEHICLE_MODE_TEST), 0, VEHICLE_CONDITION_TEST, VEHICLE_MODE_DISABLED },
+};
+
+static const char* const vehicle_mode_names[VEHICLE_MODE_COUNT] =
+{
+	"disabled", "teleop", "autonomous", "park", "estop", "test", "calibrate"
+};
+
+void VehicleModeInit(vehicle_mode_state_t* state, uint32_t now)
+{
+	state->mode = VEHICLE_MODE_DISABLED;
+	state->entered = now;
+	state->transitions = 0;
+}
+
+FAST_CODE uint8_t VehicleModeUpdate(vehicle_mode_state_t* state, uint8_t conditions, uint32_t now)
+{
+	const vehicle_transition_t* row = vehicle_transitions;
+	const vehicle_transition_t* end = row + sizeof(vehicle_transitions) / sizeof(vehicle_transitions[0]);
+	for(; row < end; ++row)
+	{
+		if( (row->from & MODE_BIT(state->mode)) && (conditions & row->require) == row->require && !(conditions & row->forbid) )
+			break;
+	}
+	if( row == end )
+		return 0;
+
+	EventLogWrite(EVENT_LOG_MODE, row->to | (state->mode << 8), now - state->entered);
+	state->mode = row->to;
+	state->entered = now;
+	state->transitions++;
+	return 1;
+}
+
+const char* VehicleModeName(vehicle_mode_t mode)
+{
+	return mode < VEHICLE_MODE_COUNT ? vehicle_mode_names[mode] : "unknown";
+}
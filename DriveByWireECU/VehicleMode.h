@@ -0,0 +1,77 @@
+/*
+ * VehicleMode.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef VEHICLEMODE_H_
+#define VEHICLEMODE_H_
+
+#include <stdint.h>
+
+//The mode the cart is driven in, one state machine in place of flags that
+//every stage checked on its own.
+//
+//The control stage gathers the conditions once per cycle, the first row of
+//the transition table in VehicleMode.c that matches the mode and the
+//conditions picks the next mode, and only that mode's output handler runs
+//(ControlCore.c). The estop wins over everything, and tele operation over
+//autonomous mode, the operator on the sticks has the last word. When the
+//estop is released or the command behind a mode stops, the cart drops to
+//Disabled for at least a cycle, which resets the controllers before the
+//next mode starts. A steering calibration sweep and an excitation run
+//give way only to the estop and tele operation. An actuator fault
+//(ActuatorFault.h) drops every mode but tele operation and the estop to
+//Disabled and keeps them out until it is cleared.
+//
+//Every transition is an EVENT_LOG_MODE entry with the modes and the ms
+//spent in the one that was left.
+
+typedef enum vehicle_mode_t
+{
+	//no command in force, throttle and steering off
+	VEHICLE_MODE_DISABLED = 0,
+	VEHICLE_MODE_TELEOP,
+	VEHICLE_MODE_AUTONOMOUS,
+	//autonomous with the park brake commanded
+	VEHICLE_MODE_PARK,
+	VEHICLE_MODE_ESTOP,
+	//a system identification run (Excitation.h)
+	VEHICLE_MODE_TEST,
+	//the steering calibration sweep (SteeringSweep.h)
+	VEHICLE_MODE_CALIBRATE,
+	VEHICLE_MODE_COUNT
+} vehicle_mode_t;
+
+//Conditions, gathered once per cycle
+#define VEHICLE_CONDITION_ESTOP 0x01
+#define VEHICLE_CONDITION_AUTONOMOUS 0x02
+#define VEHICLE_CONDITION_PARK 0x04
+//tele operation commanded and its commands current
+#define VEHICLE_CONDITION_TELEOP 0x08
+//an excitation run was started and has not ended
+#define VEHICLE_CONDITION_TEST 0x10
+//a steering sweep was started and has not ended
+#define VEHICLE_CONDITION_CALIBRATE 0x20
+//an actuator fault is latched
+#define VEHICLE_CONDITION_FAULT 0x40
+
+typedef struct vehicle_mode_state_t
+{
+	vehicle_mode_t mode;
+	//ms the mode was entered at
+	uint32_t entered;
+	uint32_t transitions;
+} vehicle_mode_state_t;
+
+//Starts in Disabled at now
+void VehicleModeInit(vehicle_mode_state_t* state, uint32_t now);
+
+//Moves state to the mode the table gives for conditions at now, and logs
+//the transition. Returns 1 when the mode changed.
+uint8_t VehicleModeUpdate(vehicle_mode_state_t* state, uint8_t conditions, uint32_t now);
+
+//Short lower case name, for logs and pages
+const char* VehicleModeName(vehicle_mode_t mode);
+
+#endif /* VEHICLEMODE_H_ */
@@ -0,0 +1,138 @@
+/*
+ * Watchdog.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <hri_wdt_e54.h>
+#include "Watchdog.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "EventLog.h"
+#include "DriveByWireIO.h"
+#include "TimeBase.h"
+#include "TimeTrigger.h"
+
+#if WATCHDOG_ENABLE
+
+static const uint32_t watchdog_timeout[WATCHDOG_TASK_COUNT] =
+{
+	WATCHDOG_CONTROL_TIMEOUT,
+	WATCHDOG_NETWORK_TIMEOUT,
+};
+
+typedef struct watchdog_t
+{
+	//tick of every task's last heartbeat
+	volatile uint32_t beat[WATCHDOG_TASK_COUNT];
+	//bit n set once task n sent its first
+	volatile uint32_t started;
+	//tick hook only
+	uint32_t last_kick;
+	uint8_t running;
+	//set by the early warning, no kick may cancel the reset after it
+	volatile uint8_t tripped;
+} watchdog_t;
+
+static watchdog_t watchdog;
+
+void WatchdogHeartbeat(watchdog_task_t task)
+{
+	watchdog.beat[task] = xTaskGetTickCount();
+	if( !(watchdog.started & (1UL << task)) )
+		__atomic_fetch_or(&watchdog.started, 1UL << task, __ATOMIC_RELAXED);
+}
+
+//Bit n set for every task that is dead at now, and the ms since the
+//oldest of their heartbeats
+static uint16_t DeadTasks(uint32_t now, uint32_t* silence)
+{
+	uint16_t dead = 0;
+	*silence = 0;
+	for(int i = 0; i < WATCHDOG_TASK_COUNT; ++i)
+	{
+		//the scheduler started at tick 0
+		uint32_t since = (watchdog.started & (1UL << i)) ? now - watchdog.beat[i] : now;
+		uint32_t timeout = (watchdog.started & (1UL << i)) ? watchdog_timeout[i] : WATCHDOG_START_TIMEOUT;
+		if( since > timeout )
+		{
+			dead |= 1 << i;
+			if( since > *silence )
+				*silence = since;
+		}
+	}
+	return dead;
+}
+
+//configUSE_TICK_HOOK, from the tick interrupt
+void vApplicationTickHook(void)
+{
+	TimeBaseTick();
+	TimeTriggerTick();
+	uint32_t now = xTaskGetTickCountFromISR();
+	if( !watchdog.running || watchdog.tripped || now - watchdog.last_kick < WATCHDOG_KICK_PERIOD )
+		return;
+
+	uint32_t silence;
+	//a clear still synchronising to the slow clock has not landed yet,
+	//try again next tick rather than wait for it here
+	if( DeadTasks(now, &silence) || hri_wdt_get_SYNCBUSY_CLEAR_bit(WDT) )
+		return;
+
+	((Wdt*)WDT)->CLEAR.reg = WDT_CLEAR_CLEAR_KEY;
+	watchdog.last_kick = now;
+}
+
+//Early warning, the reset is WATCHDOG_PERIOD - WATCHDOG_EARLY_WARNING away
+void WDT_Handler()
+{
+	hri_wdt_clear_INTFLAG_EW_bit(WDT);
+	watchdog.tripped = 1;
+	//the outputs first, the log entry can wait
+	ForceBrakeOutputs();
+
+	uint32_t silence;
+	uint16_t dead = DeadTasks(xTaskGetTickCountFromISR(), &silence);
+	EventLogWrite(EVENT_LOG_WATCHDOG, dead, silence);
+}
+
+void WatchdogStart()
+{
+	//with the fuses' ALWAYSON the WDT already runs with their periods,
+	//which are locked
+	uint8_t always_on = hri_wdt_get_CTRLA_ALWAYSON_bit(WDT);
+	if( !always_on )
+	{
+		hri_wdt_clear_CTRLA_ENABLE_bit(WDT);
+		hri_wdt_write_CONFIG_reg(WDT, WDT_CONFIG_PER(WATCHDOG_PERIOD));
+		hri_wdt_write_EWCTRL_reg(WDT, WDT_EWCTRL_EWOFFSET(WATCHDOG_EARLY_WARNING));
+	}
+	hri_wdt_clear_INTFLAG_EW_bit(WDT);
+	hri_wdt_set_INTEN_EW_bit(WDT);
+	NVIC_SetPriority(WDT_IRQn, IRQ_PRIORITY_WATCHDOG);
+	NVIC_ClearPendingIRQ(WDT_IRQn);
+	NVIC_EnableIRQ(WDT_IRQn);
+
+	if( !always_on )
+		hri_wdt_set_CTRLA_ENABLE_bit(WDT);
+	hri_wdt_write_CLEAR_reg(WDT, WDT_CLEAR_CLEAR_KEY);
+	watchdog.running = 1;
+}
+
+#else
+
+void WatchdogStart()
+{
+}
+
+void WatchdogHeartbeat(watchdog_task_t task)
+{
+}
+
+void vApplicationTickHook(void)
+{
+	TimeBaseTick();
+	TimeTriggerTick();
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Watchdog.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <stdint.h>
+
+//Hardware watchdog fed only while every supervised task is alive.
+//Each supervised task sends a heartbeat from its loop: main_task every
+//control cycle, the network every WATCHDOG_NETWORK_PERIOD from a timer in
+//the tcpip thread, or from the service loop in that build. The RTOS tick
+//hook checks the heartbeats and clears the WDT every WATCHDOG_KICK_PERIOD
+//while none is older than its timeout. A task that stalls, on a semaphore,
+//a blocked send or a loop that never ends, stops the kicks, and so does a
+//tick that stopped.
+//
+//WATCHDOG_EARLY_WARNING after the last kick the early warning interrupt
+//forces the brake on and the throttle off, records EVENT_LOG_WATCHDOG,
+//which survives the reset, and stops the kicks for good. The WDT resets
+//the ECU at WATCHDOG_PERIOD, and the EVENT_LOG_BOOT that follows has the
+//WDT bit in its RCAUSE.
+//
+//A task that has not sent its first heartbeat yet counts as alive for
+//the first WATCHDOG_START_TIMEOUT ms after the scheduler starts.
+//
+//The early warning only forces outputs and writes the event log, which
+//reads the tick, so it runs at IRQ_PRIORITY_WATCHDOG (irq_config.h), the
+//highest priority the RTOS allows calls from.
+//
+//The WDT runs from the 1.024kHz OSCULP32K output. Its periods are the
+//CONFIG.PER and EWCTRL.EWOFFSET codes, 8 << code clock cycles.
+
+//Set to 0 to leave the WDT off
+#ifndef WATCHDOG_ENABLE
+#define WATCHDOG_ENABLE 1
+#endif
+
+//8 << 4 = 128 cycles, 125ms from the last kick to the reset
+#ifndef WATCHDOG_PERIOD
+#define WATCHDOG_PERIOD 4
+#endif
+
+//8 << 3 = 64 cycles, 62.5ms from the last kick to the early warning
+#ifndef WATCHDOG_EARLY_WARNING
+#define WATCHDOG_EARLY_WARNING 3
+#endif
+
+//ms between kicks while everything is alive
+#define WATCHDOG_KICK_PERIOD 8
+
+//ms of silence after which a task is dead
+#ifndef WATCHDOG_CONTROL_TIMEOUT
+#define WATCHDOG_CONTROL_TIMEOUT 20
+#endif
+#ifndef WATCHDOG_NETWORK_TIMEOUT
+#define WATCHDOG_NETWORK_TIMEOUT 500
+#endif
+
+//ms between the network's heartbeats
+#define WATCHDOG_NETWORK_PERIOD 100
+
+//ms every task gets for its first heartbeat, lwIP comes up in this time
+#ifndef WATCHDOG_START_TIMEOUT
+#define WATCHDOG_START_TIMEOUT 5000
+#endif
+
+//To supervise another task, add its id here with its timeout in
+//Watchdog.c and send heartbeats from its loop.
+typedef enum watchdog_task_t
+{
+	WATCHDOG_CONTROL = 0,
+	WATCHDOG_NETWORK,
+	WATCHDOG_TASK_COUNT
+} watchdog_task_t;
+
+//Configures and enables the WDT. Call last thing before
+//vTaskStartScheduler, the kicks come from the tick.
+void WatchdogStart();
+
+//The task is alive. From the task itself, never from an interrupt.
+void WatchdogHeartbeat(watchdog_task_t task);
+
+#endif /* WATCHDOG_H_ */
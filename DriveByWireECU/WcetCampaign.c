@@ -0,0 +1,270 @@
+/*
+ * WcetCampaign.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <compiler.h>
+#include <peripheral_clk_config.h>
+#include "WcetCampaign.h"
+
+#if WCET_CAMPAIGN
+
+#include <hpl_cmcc.h>
+#include <hal_mac_async.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/netif.h"
+#include "ControlCore.h"
+#include "ControlPipeline.h"
+#include "DmaService.h"
+#include "Log.h"
+
+typedef struct wcet_condition_t
+{
+	const char* name;
+	uint8_t interference;
+} wcet_condition_t;
+
+static const wcet_condition_t wcet_conditions[] =
+{
+	{ "quiet", 0 },
+	{ "cold_cache", WCET_COLD_CACHE },
+	{ "uncached", WCET_UNCACHED },
+	{ "network", WCET_NETWORK },
+	{ "isr_storm", WCET_ISR_STORM },
+	{ "all", WCET_COLD_CACHE | WCET_UNCACHED | WCET_NETWORK | WCET_ISR_STORM },
+};
+
+#define WCET_CONDITION_COUNT (sizeof(wcet_conditions) / sizeof(wcet_conditions[0]))
+
+//The worst of any condition and the condition it came from
+typedef struct wcet_worst_t
+{
+	uint32_t max;
+	uint8_t condition;
+} wcet_worst_t;
+
+static const dma_channel_config_t wcet_storm_config =
+{
+	0, DMAC_CHCTRLA_TRIGACT_TRANSACTION_Val, DMAC_BTCTRL_BEATSIZE_WORD_Val, 1, 1, 0, 1
+};
+
+static struct
+{
+	TaskHandle_t burst_task;
+	struct udp_pcb* pcb;
+	ip_addr_t loopback;
+	//the burst task sends while it is set
+	volatile uint8_t bursting;
+	volatile uint32_t bursts;
+	volatile uint32_t storm_interrupts;
+	int8_t storm_dma;
+	wcet_worst_t stages[CONTROL_PIPELINE_MAX_STAGES];
+	wcet_worst_t cycle;
+	uint32_t storm_source[WCET_CAMPAIGN_STORM_BEATS];
+	uint32_t storm_destination[WCET_CAMPAIGN_STORM_BEATS];
+} wcet;
+
+//DMAC interrupt, once per storm block
+static void StormBlockDone(void* arg, uint8_t error)
+{
+	++wcet.storm_interrupts;
+}
+
+//From the tcpip thread
+static void BurstReceive(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	pbuf_free(p);
+}
+
+//Below the control task, it only ever runs in the gaps between cycles. The
+//task stays blocked on its notification outside the network conditions.
+static void BurstTask(void* p)
+{
+	while( 1 )
+	{
+		if( !wcet.bursting )
+		{
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			continue;
+		}
+
+		struct pbuf* burst = pbuf_alloc(PBUF_TRANSPORT, WCET_CAMPAIGN_BURST_SIZE, PBUF_RAM);
+		err_t err = ERR_MEM;
+		if( burst != NULL )
+		{
+			memset(burst->payload, 0xA5, WCET_CAMPAIGN_BURST_SIZE);
+			LOCK_TCPIP_CORE();
+			err = udp_sendto(wcet.pcb, burst, &wcet.loopback, WCET_CAMPAIGN_PORT);
+			UNLOCK_TCPIP_CORE();
+			pbuf_free(burst);
+		}
+		//the loopback queue or the pools are full, the tcpip thread drains them
+		if( err != ERR_OK )
+			vTaskDelay(1);
+		else
+			++wcet.bursts;
+	}
+}
+
+static uint32_t GmacFramesReceived()
+{
+	struct mac_async_ring_stats ring;
+	mac_async_get_ring_stats((struct mac_async_descriptor*)netif_default->state, &ring);
+	return ring.rx_frames;
+}
+
+static void InterferenceBegin(uint8_t interference)
+{
+	if( (interference & WCET_NETWORK) && wcet.pcb != NULL )
+	{
+		wcet.bursting = 1;
+		xTaskNotifyGive(wcet.burst_task);
+	}
+	if( (interference & WCET_ISR_STORM) && wcet.storm_dma >= 0 )
+		DmaStart(wcet.storm_dma);
+}
+
+static void InterferenceEnd()
+{
+	wcet.bursting = 0;
+	if( wcet.storm_dma >= 0 )
+		DmaStop(wcet.storm_dma);
+}
+
+//One timed cycle, the cache set up as the condition wants it around the
+//step only
+static uint32_t TimedCycle(main_context_t* ctx, uint8_t interference)
+{
+	if( interference & WCET_COLD_CACHE )
+		_cmcc_invalidate_all(CMCC);
+	if( interference & WCET_UNCACHED )
+		_cmcc_disable(CMCC);
+
+	uint32_t start = DWT->CYCCNT;
+	ControlCoreStep(ctx, xTaskGetTickCount());
+	uint32_t cycles = DWT->CYCCNT - start;
+
+	if( interference & WCET_UNCACHED )
+		_cmcc_enable(CMCC);
+	ctx->scheduler.cycle_count++;
+	return cycles;
+}
+
+static void RunCondition(main_context_t* ctx, uint8_t condition)
+{
+	const wcet_condition_t* info = &wcet_conditions[condition];
+	uint64_t total = 0;
+	uint32_t max = 0;
+
+	ControlPipelineReset(&ctx->pipeline);
+	wcet.storm_interrupts = 0;
+	wcet.bursts = 0;
+	uint32_t frames = GmacFramesReceived();
+	InterferenceBegin(info->interference);
+	for(uint32_t i = 0; i < WCET_CAMPAIGN_CYCLES; ++i)
+	{
+		//the interference gets the tick in between, as it would the rest
+		//of a real cycle
+		vTaskDelay(1);
+		uint32_t cycles = TimedCycle(ctx, info->interference);
+		total += cycles;
+		if( cycles > max )
+			max = cycles;
+	}
+	InterferenceEnd();
+	frames = GmacFramesReceived() - frames;
+
+	control_stage_stats_t stats;
+	for(uint8_t i = 0; ControlPipelineRead(&ctx->pipeline, i, &stats); ++i)
+	{
+		if( stats.runs == 0 )
+			continue;
+		if( stats.max > wcet.stages[i].max )
+		{
+			wcet.stages[i].max = stats.max;
+			wcet.stages[i].condition = condition;
+		}
+		LOG("wcet %s %s %lu %lu %lu", info->name, ctx->pipeline.stages[i].name, stats.runs,
+			(uint32_t)(stats.total / stats.runs), stats.max);
+		vTaskDelay(pdMS_TO_TICKS(BENCH_IMAGE_LOG_PERIOD));
+	}
+	if( max > wcet.cycle.max )
+	{
+		wcet.cycle.max = max;
+		wcet.cycle.condition = condition;
+	}
+	LOG("wcet %s cycle %lu %lu", info->name, (uint32_t)(total / WCET_CAMPAIGN_CYCLES), max);
+	LOG("wcet %s interference %lu %lu %lu", info->name, wcet.storm_interrupts, wcet.bursts, frames);
+	vTaskDelay(pdMS_TO_TICKS(BENCH_IMAGE_LOG_PERIOD));
+}
+
+static void Setup()
+{
+	memset(wcet.stages, 0, sizeof(wcet.stages));
+	memset(&wcet.cycle, 0, sizeof(wcet.cycle));
+
+	IP4_ADDR(&wcet.loopback, 127, 0, 0, 1);
+	LOCK_TCPIP_CORE();
+	wcet.pcb = udp_new();
+	if( wcet.pcb != NULL )
+	{
+		udp_bind(wcet.pcb, IP_ADDR_ANY, WCET_CAMPAIGN_PORT);
+		udp_recv(wcet.pcb, BurstReceive, NULL);
+	}
+	UNLOCK_TCPIP_CORE();
+	if( xTaskCreate(BurstTask, "WcetBurst", TASK_STACK_WCET_BURST, NULL, TASK_PRIORITY_WCET_BURST,
+		&wcet.burst_task) != pdPASS )
+		wcet.burst_task = NULL;
+	if( wcet.burst_task == NULL && wcet.pcb != NULL )
+	{
+		LOCK_TCPIP_CORE();
+		udp_remove(wcet.pcb);
+		UNLOCK_TCPIP_CORE();
+		wcet.pcb = NULL;
+	}
+	if( wcet.pcb == NULL )
+		LOG("wcet: no loopback sender, network runs without bursts");
+
+	//one block linked to itself, an interrupt at the end of each pass
+	wcet.storm_dma = DmaAllocate(&wcet_storm_config, StormBlockDone, NULL);
+	if( wcet.storm_dma >= 0 )
+	{
+		DmacDescriptor* block = DmaFirstBlock(wcet.storm_dma);
+		DmaSetBlock(wcet.storm_dma, block, wcet.storm_source, wcet.storm_destination, WCET_CAMPAIGN_STORM_BEATS, block);
+	}
+	else
+		LOG("wcet: no DMA channel, isr_storm runs without a storm");
+}
+
+void WcetCampaignRun(main_context_t* ctx)
+{
+	Setup();
+	for(uint8_t i = 0; i < WCET_CONDITION_COUNT; ++i)
+		RunCondition(ctx, i);
+
+	for(uint8_t i = 0; i < ctx->pipeline.count; ++i)
+	{
+		LOG("wcet worst %s %lu %s", ctx->pipeline.stages[i].name, wcet.stages[i].max,
+			wcet_conditions[wcet.stages[i].condition].name);
+		vTaskDelay(pdMS_TO_TICKS(BENCH_IMAGE_LOG_PERIOD));
+	}
+	uint32_t budget = CONF_CPU_FREQUENCY / CONTROL_RATE_HZ;
+	LOG("wcet worst cycle %lu %s budget %lu margin %ld", wcet.cycle.max, wcet_conditions[wcet.cycle.condition].name,
+		budget, (int32_t)(budget - wcet.cycle.max));
+
+	if( wcet.storm_dma >= 0 )
+		DmaFree(wcet.storm_dma);
+}
+
+#else
+
+void WcetCampaignRun(struct main_context_t* ctx)
+{
+}
+
+#endif
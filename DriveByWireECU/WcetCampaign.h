@@ -0,0 +1,85 @@
+/*
+ * WcetCampaign.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef WCETCAMPAIGN_H_
+#define WCETCAMPAIGN_H_
+
+#include <stdint.h>
+#include "BenchImage.h"
+
+//Worst case execution time of the control cycle in the Bench image, after
+//the catalogue. The catalogue times each call warm and alone, the
+//campaign runs the whole control pipeline (ControlCoreStep,
+//ControlPipeline.h) WCET_CAMPAIGN_CYCLES times under each condition of
+//interference and keeps every stage's mean and max there:
+//
+//	quiet		nothing else runs, the reference
+//	cold_cache	the CMCC invalidated before every cycle, every fetch from
+//				flash misses once
+//	uncached	the CMCC off for the cycle, everything the cycle runs from
+//				flash runs at the flash wait states. FAST_CODE is in RAM
+//				and unaffected unless the image is built with
+//				FAST_CODE_IN_RAM=0 (FastCode.h), which puts the whole
+//				control path in flash.
+//	network		UDP bursts through the loopback interface, sent by a task
+//				below the control priority between the cycles, so the
+//				tcpip thread and the pbuf pools stay busy and the cache is
+//				someone else's when a cycle starts. GMAC frames received in
+//				the meantime are counted, python net_stress.py run from the
+//				PC against the bench adds real RX bursts.
+//	isr_storm	a circular memory to memory DMA with an interrupt every
+//				WCET_CAMPAIGN_STORM_BEATS words, interrupts through the
+//				cycle and the DMA contending for the bus matrix
+//	all			every one of them at once
+//
+//A line per condition and stage, in core cycles, then per condition the
+//whole cycle and the interference that ran:
+//
+//  wcet <condition> <stage> <runs> <mean> <max>
+//  wcet <condition> cycle <mean> <max>
+//  wcet <condition> interference <storm interrupts> <bursts> <gmac frames>
+//
+//and last, per stage and for the cycle, the worst max of any condition and
+//the condition it was seen under, against the budget of one cycle:
+//
+//  wcet worst <stage> <max> <condition>
+//  wcet worst cycle <max> <condition> budget <cycles> margin <cycles>
+//
+//The pipeline runs on main()'s context, with the actuators at their off
+//values as the catalogue's Set* cases leave them: no command ever arrives
+//that moves them.
+
+#ifndef WCET_CAMPAIGN
+#define WCET_CAMPAIGN BENCH_IMAGE
+#endif
+
+//Control cycles under each condition
+#ifndef WCET_CAMPAIGN_CYCLES
+#define WCET_CAMPAIGN_CYCLES 2000
+#endif
+
+//Words the storm DMA moves per interrupt, fewer is a harder storm
+#ifndef WCET_CAMPAIGN_STORM_BEATS
+#define WCET_CAMPAIGN_STORM_BEATS 64
+#endif
+
+//Bytes of one loopback burst datagram, and the port it goes to
+#define WCET_CAMPAIGN_BURST_SIZE 512
+#define WCET_CAMPAIGN_PORT 12098
+
+//Bits of the interference conditions
+#define WCET_COLD_CACHE 0x01
+#define WCET_UNCACHED 0x02
+#define WCET_NETWORK 0x04
+#define WCET_ISR_STORM 0x08
+
+struct main_context_t;
+
+//Runs every condition and logs the results. From the Bench task, ctx is
+//main()'s, set up and its parameters published.
+void WcetCampaignRun(struct main_context_t* ctx);
+
+#endif /* WCETCAMPAIGN_H_ */
@@ -0,0 +1,204 @@
+/*
+ * WheelSpeed.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include <hal_gpio.h>
+#include <hri_eic_e54.h>
+#include <hri_evsys_e54.h>
+#include <hri_tc_e54.h>
+#include <hri_mclk_e54.h>
+#include <hri_gclk_e54.h>
+#include <peripheral_clk_config.h>
+#include "WheelSpeed.h"
+#include "CanBus.h"
+#include "FastCode.h"
+#include "atmel_start_pins.h"
+
+#define WHEEL_SPEED_METERS_PER_EDGE (WHEEL_SPEED_CIRCUMFERENCE / WHEEL_SPEED_EDGES_PER_REV)
+
+typedef struct wheel_speed_input_t
+{
+	uint32_t pin;
+	uint32_t pinmux;
+	uint8_t extint;
+	uint8_t evsys_channel;
+	uint8_t evsys_user;
+	Tc* tc;
+} wheel_speed_input_t;
+
+//In wheel_speed_sensor_t order. The EVSYS channels are reserved for the
+//wheel sensors.
+static const wheel_speed_input_t wheel_speed_inputs[WHEEL_SPEED_COUNTED_SENSORS] =
+{
+	{ WheelSpeedLeft, PINMUX_PB07A_EIC_EXTINT7, 7, 0, EVSYS_ID_USER_TC2_EVU, TC2 },
+	{ WheelSpeedRight, PINMUX_PD00A_EIC_EXTINT0, 0, 1, EVSYS_ID_USER_TC3_EVU, TC3 },
+};
+
+typedef struct wheel_speed_state_t
+{
+	uint16_t last_count;
+	//an edge was seen within WHEEL_SPEED_STOP_TIME
+	uint8_t moving;
+	//tick of the edge that opened the window
+	uint32_t window_start;
+	uint32_t window_edges;
+	uint32_t last_edge;
+	float speed;
+} wheel_speed_state_t;
+
+static wheel_speed_state_t wheel_speed_states[WHEEL_SPEED_SENSOR_COUNT];
+static uint8_t wheel_speed_front_valid;
+
+static const can_bus_signal_t wheel_speed_front_signals[2] =
+{
+	{ 0, 16, 0 },
+	{ 16, 16, 0 },
+};
+
+FAST_CODE static uint16_t ReadCount(Tc* tc)
+{
+	//COUNT is only readable after a read synchronization, a few TC clocks
+	hri_tc_set_CTRLB_CMD_bf(tc, TC_CTRLBSET_CMD_READSYNC_Val);
+	hri_tc_wait_for_sync(tc, TC_SYNCBUSY_CTRLB);
+	return hri_tccount16_read_COUNT_reg(tc);
+}
+
+FAST_CODE static void UpdateSensor(wheel_speed_state_t* state, uint16_t count, uint32_t now)
+{
+	uint16_t edges = count - state->last_count;
+	state->last_count = count;
+
+	if( edges == 0 )
+	{
+		if( !state->moving )
+			return;
+
+		if( now - state->last_edge >= WHEEL_SPEED_STOP_TIME )
+		{
+			state->moving = 0;
+			state->speed = 0.0f;
+			return;
+		}
+		if( now == state->window_start )
+			return;
+
+		//With no new edge yet, the wheel can at most be doing one more edge
+		//than counted over the window so far. Holding the speed down to that
+		//lets it fall off while slowing instead of freezing until the next edge.
+		float bound = (state->window_edges + 1) * WHEEL_SPEED_METERS_PER_EDGE * 1000.0f / (now - state->window_start);
+		if( bound < state->speed )
+			state->speed = bound;
+		return;
+	}
+
+	state->last_edge = now;
+
+	//A single edge after standing still carries no rate, it only opens the window
+	if( !state->moving )
+	{
+		state->moving = 1;
+		state->window_start = now;
+		state->window_edges = 0;
+		return;
+	}
+
+	state->window_edges += edges;
+	uint32_t span = now - state->window_start;
+	if( span < WHEEL_SPEED_WINDOW )
+		return;
+
+	state->speed = state->window_edges * WHEEL_SPEED_METERS_PER_EDGE * 1000.0f / span;
+	state->window_start = now;
+	state->window_edges = 0;
+}
+
+void WheelSpeedInit()
+{
+	memset(wheel_speed_states, 0, sizeof(wheel_speed_states));
+
+	hri_mclk_set_APBAMASK_EIC_bit(MCLK);
+	hri_mclk_set_APBBMASK_EVSYS_bit(MCLK);
+	hri_mclk_set_APBBMASK_TC2_bit(MCLK);
+	hri_mclk_set_APBBMASK_TC3_bit(MCLK);
+	//TC2 and TC3 share a peripheral channel, clocked like the PWM timers
+	hri_gclk_write_PCHCTRL_reg(GCLK, TC2_GCLK_ID, CONF_GCLK_TC0_SRC | (1 << GCLK_PCHCTRL_CHEN_Pos));
+
+	//EIC runs from the always-on 32kHz oscillator. The filter rejects
+	//pulses shorter than a couple of its periods, far shorter than any
+	//real edge spacing.
+	hri_eic_clear_CTRLA_ENABLE_bit(EIC);
+	hri_eic_wait_for_sync(EIC, EIC_SYNCBUSY_ENABLE);
+	hri_eic_write_CTRLA_CKSEL_bit(EIC, 1);
+
+	//other EXTINTs keep their configuration (TccPwm.c)
+	uint32_t config[2] = { hri_eic_read_CONFIG_reg(EIC, 0), hri_eic_read_CONFIG_reg(EIC, 1) };
+	uint32_t event_outputs = 0;
+	for(int i = 0; i < WHEEL_SPEED_COUNTED_SENSORS; ++i)
+	{
+		const wheel_speed_input_t* input = &wheel_speed_inputs[i];
+		uint8_t shift = (input->extint & 7) * 4;
+
+		config[input->extint / 8] &= ~(0xFUL << shift);
+		config[input->extint / 8] |= (uint32_t)(EIC_CONFIG_SENSE0_RISE_Val | EIC_CONFIG_FILTEN0) << shift;
+		event_outputs |= 1UL << input->extint;
+		gpio_set_pin_function(input->pin, input->pinmux);
+
+		//EIC event -> TC count input, asynchronous path, no EVSYS clock needed
+		hri_evsys_write_CHANNEL_reg(EVSYS, input->evsys_channel,
+			EVSYS_CHANNEL_EVGEN(EVSYS_ID_GEN_EIC_EXTINT_0 + input->extint) | EVSYS_CHANNEL_PATH_ASYNCHRONOUS);
+		hri_evsys_write_USER_reg(EVSYS, input->evsys_user, input->evsys_channel + 1);
+
+		//16 bit counter that only ever advances on an event
+		hri_tc_write_CTRLA_reg(input->tc, TC_CTRLA_SWRST);
+		hri_tc_write_EVCTRL_reg(input->tc, TC_EVCTRL_TCEI | TC_EVCTRL_EVACT_COUNT);
+		hri_tc_write_CTRLA_reg(input->tc, TC_CTRLA_MODE_COUNT16 | TC_CTRLA_ENABLE);
+	}
+
+	hri_eic_write_CONFIG_reg(EIC, 0, config[0]);
+	hri_eic_write_CONFIG_reg(EIC, 1, config[1]);
+	hri_eic_set_EVCTRL_EXTINTEO_bf(EIC, event_outputs);
+	hri_eic_set_CTRLA_ENABLE_bit(EIC);
+	hri_eic_wait_for_sync(EIC, EIC_SYNCBUSY_ENABLE);
+}
+
+FAST_CODE static void UpdateFront(uint32_t now)
+{
+	can_bus_message_t message;
+	wheel_speed_front_valid = CanBusRead(CAN_BUS_WHEEL_SPEED, &message) && now - message.rx_tick < WHEEL_SPEED_CAN_TIMEOUT;
+	if( !wheel_speed_front_valid )
+		return;
+
+	for(int i = 0; i < 2; ++i)
+	{
+		uint32_t raw = CanBusUnpackSignal(message.data, message.len, &wheel_speed_front_signals[i]);
+		wheel_speed_states[WHEEL_SPEED_FRONT_LEFT + i].speed = raw * WHEEL_SPEED_CAN_SCALE;
+	}
+}
+
+FAST_CODE void WheelSpeedUpdate(uint32_t now)
+{
+	for(int i = 0; i < WHEEL_SPEED_COUNTED_SENSORS; ++i)
+		UpdateSensor(&wheel_speed_states[i], ReadCount(wheel_speed_inputs[i].tc), now);
+	UpdateFront(now);
+}
+
+float WheelSpeedRead(wheel_speed_sensor_t sensor)
+{
+	if( sensor >= WHEEL_SPEED_SENSOR_COUNT )
+		return 0.0f;
+
+	return wheel_speed_states[sensor].speed;
+}
+
+uint8_t WheelSpeedFrontValid()
+{
+	return wheel_speed_front_valid;
+}
+
+FAST_CODE float WheelSpeedVehicle()
+{
+	return (wheel_speed_states[WHEEL_SPEED_LEFT].speed + wheel_speed_states[WHEEL_SPEED_RIGHT].speed) * 0.5f;
+}
@@ -0,0 +1,87 @@
+/*
+ * WheelSpeed.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef WHEELSPEED_H_
+#define WHEELSPEED_H_
+
+#include <stdint.h>
+
+//Wheel speed from the pulse sensors on WheelSpeedLeft (PB07) and
+//WheelSpeedRight (PD00), on the rear wheels the motor drives, and from the
+//CAN wheel speed node on the front ones.
+//
+//Each rear sensor edge is an EIC event that EVSYS routes to the count input of a
+//TC, so edges are counted in hardware without any interrupts. The control
+//tick reads both counters at a fixed cost and turns them into speeds.
+//
+//At speed, the speed is the edge count over WHEEL_SPEED_WINDOW. When edges
+//are further apart than that the window stretches until the next edge
+//arrives, which turns into a measurement of the period between edges, so
+//slow crawling still gives a smooth value instead of 0 or 1 edge per window.
+//
+//Every TC already has a job, the front wheels come from the frame of
+//CAN_BUS_WHEEL_SPEED (CanBus.h) instead, one 16 bit speed per wheel of
+//WHEEL_SPEED_CAN_SCALE m/s per bit, front left in bits 0-15 and front
+//right in bits 16-31. A frame older than WHEEL_SPEED_CAN_TIMEOUT is not
+//valid any more, the speeds read then are the last ones it had.
+typedef enum wheel_speed_sensor_t
+{
+	//rear, counted
+	WHEEL_SPEED_LEFT = 0,
+	WHEEL_SPEED_RIGHT,
+	//front, from CAN
+	WHEEL_SPEED_FRONT_LEFT,
+	WHEEL_SPEED_FRONT_RIGHT,
+	WHEEL_SPEED_SENSOR_COUNT
+} wheel_speed_sensor_t;
+
+#define WHEEL_SPEED_COUNTED_SENSORS 2
+
+//Placeholders until the tone wheels are measured on the vehicle
+#ifndef WHEEL_SPEED_EDGES_PER_REV
+#define WHEEL_SPEED_EDGES_PER_REV 48
+#endif
+#ifndef WHEEL_SPEED_CIRCUMFERENCE
+#define WHEEL_SPEED_CIRCUMFERENCE 1.45f	//m
+#endif
+
+//ms, shortest time edges are counted over. A window closes at the first
+//edge after this, edge times are only known to the control tick.
+#ifndef WHEEL_SPEED_WINDOW
+#define WHEEL_SPEED_WINDOW 20
+#endif
+//ms without an edge after which the wheel counts as stopped
+#ifndef WHEEL_SPEED_STOP_TIME
+#define WHEEL_SPEED_STOP_TIME 500
+#endif
+
+//Placeholders until the CAN node is programmed, m/s per bit and ms
+#ifndef WHEEL_SPEED_CAN_SCALE
+#define WHEEL_SPEED_CAN_SCALE 0.01f
+#endif
+#ifndef WHEEL_SPEED_CAN_TIMEOUT
+#define WHEEL_SPEED_CAN_TIMEOUT 50
+#endif
+
+//Sets up EIC, EVSYS and the counters and starts counting.
+//Must be called once after atmel_start_init.
+void WheelSpeedInit();
+
+//Reads the counters and the newest CAN frame and updates the speeds.
+//Called once per control tick from main_task, now in ms.
+void WheelSpeedUpdate(uint32_t now);
+
+//m/s as of the last update, never negative, the sensors have no direction
+float WheelSpeedRead(wheel_speed_sensor_t sensor);
+
+//The front wheels' frame is within WHEEL_SPEED_CAN_TIMEOUT as of the last
+//update. The rear ones are always valid.
+uint8_t WheelSpeedFrontValid();
+
+//Mean of both rear wheels, m/s
+float WheelSpeedVehicle();
+
+#endif /* WHEELSPEED_H_ */
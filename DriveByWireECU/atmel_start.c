@@ -1,4 +1,6 @@
 #include <atmel_start.h>
+#include "BootProfile.h"
+#include "Peripherals.h"
 
 /**
  * Initializes MCU, drivers and middleware in the project
@@ -6,6 +8,8 @@
 void atmel_start_init(void)
 {
 	system_init();
-	ethernet_phys_init();
+	//the MAC and its PHY come up once the outputs are safe (main.c)
+	PeripheralRequire(PERIPHERAL_TARGET_IO);
 	stdio_redirect_init();
+	BootProfileMark(BOOT_STAGE_STDIO);
 }
@@ -39,6 +39,7 @@
 #define PA19 GPIO(GPIO_PORTA, 19)
 #define SafetyLights2Enable GPIO(GPIO_PORTB, 1)
 #define PB03 GPIO(GPIO_PORTB, 3)
+#define BrakePressure GPIO(GPIO_PORTB, 4)
 #define LED2 GPIO(GPIO_PORTB, 5)
 #define SafetyLights1Enable GPIO(GPIO_PORTB, 6)
 #define WheelSpeedLeft GPIO(GPIO_PORTB, 7)
@@ -51,6 +52,7 @@
 #define PB25 GPIO(GPIO_PORTB, 25)
 #define LED1 GPIO(GPIO_PORTB, 28)
 #define AccelerationEnable GPIO(GPIO_PORTC, 1)
+#define SupplyVoltage GPIO(GPIO_PORTC, 2)
 #define EStop_In GPIO(GPIO_PORTC, 3)
 #define EStopState GPIO(GPIO_PORTC, 6)
 #define NotReverse GPIO(GPIO_PORTC, 10)
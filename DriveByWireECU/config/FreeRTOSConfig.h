@@ -9,8 +9,12 @@
  */
 #include <stdint.h>
 void assert_triggered(const char *file, uint32_t line);
+#include "HeapMonitor.h"
+#include "RtosTrace.h"
 #endif
 
+#include <task_config.h>
+#include <irq_config.h>
 #include <peripheral_clk_config.h>
 
 // <h> Basic
@@ -79,7 +83,7 @@ void assert_triggered(const char *file, uint32_t line);
 // <q> Generate runtime stats
 // <id> freertos_generate_run_time_stats
 #ifndef configGENERATE_RUN_TIME_STATS
-#define configGENERATE_RUN_TIME_STATS 0
+#define configGENERATE_RUN_TIME_STATS 1
 #endif
 
 // <q> Use 16bit tick
@@ -91,26 +95,26 @@ void assert_triggered(const char *file, uint32_t line);
 // <q> Check stack overflow
 // <id> freertos_check_for_stack_overflow
 #ifndef configCHECK_FOR_STACK_OVERFLOW
-#define configCHECK_FOR_STACK_OVERFLOW 0
+#define configCHECK_FOR_STACK_OVERFLOW 2
 #endif
 
 // <q> Use maclloc failed hook
 // <id> freertos_use_malloc_failed_hook
 #ifndef configUSE_MALLOC_FAILED_HOOK
-#define configUSE_MALLOC_FAILED_HOOK 0
+#define configUSE_MALLOC_FAILED_HOOK 1
 #endif
 
 // <q> Use idle hook
 // <id> freertos_use_idle_hook
 #ifndef configUSE_IDLE_HOOK
-#define configUSE_IDLE_HOOK 0
+#define configUSE_IDLE_HOOK 1
 #endif
 
 // <q> Use tick hook
 // <i> if open, you must realize vApplicationTickHook function
 // <id> freertos_use_tick_hook
 #ifndef configUSE_TICK_HOOK
-#define configUSE_TICK_HOOK 0
+#define configUSE_TICK_HOOK 1
 #endif
 
 // <q> Use tickless idle
@@ -179,12 +183,14 @@ void assert_triggered(const char *file, uint32_t line);
 #define configTIMER_TASK_PRIORITY (2)
 #endif
 
+#ifndef configTIMER_QUEUE_LENGTH
 #define configTIMER_QUEUE_LENGTH 2
+#endif
 
 // <o> Timer task stack size <32-512:4>
 // <i> Default is 64
 // <id> freertos_timer_task_stack_depth
-#ifndef TIMER_TASK_STACK_DEPTH
+#ifndef configTIMER_TASK_STACK_DEPTH
 #define configTIMER_TASK_STACK_DEPTH (256)
 #endif
 
@@ -232,7 +238,7 @@ to exclude the API function. */
 // <q> Include task delay utilities
 // <id> freertos_vtaskdelayuntil
 #ifndef INCLUDE_vTaskDelayUntil
-#define INCLUDE_vTaskDelayUntil 0
+#define INCLUDE_vTaskDelayUntil 1
 #endif
 
 // <q> Include task delay function
@@ -246,7 +252,7 @@ to exclude the API function. */
 // <q> Include the function to get current task handler
 // <id> freertos_xtaskgetcurrenttaskhandle
 #ifndef INCLUDE_xTaskGetCurrentTaskHandle
-#define INCLUDE_xTaskGetCurrentTaskHandle 0
+#define INCLUDE_xTaskGetCurrentTaskHandle 1
 #endif
 
 #define INCLUDE_uxTaskGetStackHighWaterMark 0
@@ -294,6 +300,32 @@ header file. */
 			;                                                                                                          \
 	}
 
+/* Heap bookkeeping, see HeapMonitor.h */
+#define traceMALLOC(pvAddress, uiSize) HeapMonitorAllocated(pvAddress, uiSize)
+#define traceFREE(pvAddress, uiSize) HeapMonitorFreed(pvAddress, uiSize)
+
+/* Kernel timeline, see RtosTrace.h. The macros expand inside tasks.c and
+queue.c, against the kernel's own TCB and queue structures. */
+#if RTOS_TRACE_ENABLE
+#define traceTASK_SWITCHED_IN()                                                                                        \
+	RtosTraceWrite(RTOS_TRACE_TASK_IN, (uint8_t)pxCurrentTCB->uxTCBNumber, (uint16_t)pxCurrentTCB->uxPriority)
+#define traceTASK_SWITCHED_OUT()                                                                                       \
+	RtosTraceWrite(RTOS_TRACE_TASK_OUT,                                                                                \
+	               (uint8_t)pxCurrentTCB->uxTCBNumber,                                                                 \
+	               (uint16_t)listIS_CONTAINED_WITHIN(&pxReadyTasksLists[pxCurrentTCB->uxPriority],                     \
+	                                                 &pxCurrentTCB->xGenericListItem))
+#define traceTASK_INCREMENT_TICK(xTickCount) RtosTraceWrite(RTOS_TRACE_TICK, 0, (uint16_t)(xTickCount))
+#define RTOS_TRACE_QUEUE(type, pxQueue)                                                                                \
+	RtosTraceWrite((type),                                                                                             \
+	               (uint8_t)((pxQueue)->uxMessagesWaiting < 255 ? (pxQueue)->uxMessagesWaiting : 255),                 \
+	               (uint16_t)(uintptr_t)(pxQueue))
+#define traceQUEUE_SEND(pxQueue) RTOS_TRACE_QUEUE(RTOS_TRACE_QUEUE_SEND, pxQueue)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) RTOS_TRACE_QUEUE(RTOS_TRACE_QUEUE_SEND_FROM_ISR, pxQueue)
+#define traceQUEUE_RECEIVE(pxQueue) RTOS_TRACE_QUEUE(RTOS_TRACE_QUEUE_RECEIVE, pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) RTOS_TRACE_QUEUE(RTOS_TRACE_QUEUE_BLOCK_SEND, pxQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) RTOS_TRACE_QUEUE(RTOS_TRACE_QUEUE_BLOCK_RECEIVE, pxQueue)
+#endif
+
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
 standard names - or at least those used in the unmodified vector table. */
 
@@ -311,14 +343,18 @@ extern uint32_t vGetRunTimeCounterValue(void);
 #endif
 
 /* The lowest interrupt priority that can be used in a call to a "set priority"
-function. */
+function. irq_config.h sets it with the rest of the priority map. */
+#ifndef configLIBRARY_LOWEST_INTERRUPT_PRIORITY
 #define configLIBRARY_LOWEST_INTERRUPT_PRIORITY 0x07
+#endif
 
 /* The highest interrupt priority that can be used by any interrupt service
 routine that makes calls to interrupt safe FreeRTOS API functions.  DO NOT CALL
 INTERRUPT SAFE FREERTOS API FUNCTIONS FROM ANY INTERRUPT THAT HAS A HIGHER
 PRIORITY THAN THIS! (higher priorities are lower numeric values. */
+#ifndef configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
 #define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY 4
+#endif
 
 /* Interrupt priorities used by the kernel port layer itself.  These are generic
 to all Cortex-M ports, and do not rely on any particular library functions. */
@@ -0,0 +1,57 @@
+/* Clock profile selection, included ahead of the generated clock configs */
+#ifndef CLOCK_PROFILE_CONFIG_H
+#define CLOCK_PROFILE_CONFIG_H
+
+// Anything defined here takes precedence over the defaults in
+// hpl_oscctrl_config.h, hpl_gclk_config.h, hpl_mclk_config.h and
+// peripheral_clk_config.h.
+
+// <q> 120MHz core clock
+// <i> 0: CPU, buses and peripherals all run from XOSC1 at 12MHz.
+// <i> 1: CPU and buses run at 120MHz from DPLL0, referenced to XOSC1. The
+// <i> peripherals whose rates the application code assumes (TC/PWM,
+// <i> SERCOM, ADC, CAN) stay at 12MHz on GCLK2.
+// <id> clock_profile_120mhz
+#ifndef CONF_CLOCK_PROFILE_120MHZ
+#define CONF_CLOCK_PROFILE_120MHZ 0
+#endif
+
+#if CONF_CLOCK_PROFILE_120MHZ == 1
+
+// DPLL0: 12MHz XOSC1 / (2 * (DIV + 1)) = 2MHz reference, * (LDR + 1) = 120MHz
+#define CONF_FDPLL0_CONFIG 1
+#define CONF_FDPLL0_ENABLE 1
+#define CONF_FDPLL0_REFCLK 0x3
+#define CONF_FDPLL0_DIV 0x2
+#define CONF_FDPLL0_LDR 0x3b
+#define CONF_FDPLL0_LDRFRAC 0x0
+
+// GCLK0 drives the CPU and the AHB/APB buses
+#define CONF_GCLK_GEN_0_SOURCE GCLK_GENCTRL_SRC_DPLL0
+#define CONF_CPU_FREQUENCY 120000000
+
+// Flash needs 5 wait states above 119MHz
+#define CONF_NVM_WAIT_STATE 5
+
+// GCLK2: undivided XOSC1 for the peripherals
+#define CONF_GCLK_GENERATOR_2_CONFIG 1
+#define CONF_GCLK_GEN_2_SOURCE GCLK_GENCTRL_SRC_XOSC1
+#define CONF_GCLK_GEN_2_GENEN 1
+#define CONF_GCLK_GEN_2_DIVSEL 0
+#define CONF_GCLK_GEN_2_DIV 1
+
+// The CONF_GCLK_*_FREQUENCY values keep their 12MHz defaults
+#define CONF_GCLK_ADC1_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define CONF_GCLK_SERCOM2_CORE_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define CONF_GCLK_TC0_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define CONF_GCLK_TC1_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define CONF_GCLK_TC4_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define CONF_GCLK_TC5_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define CONF_GCLK_TC6_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+#define CONF_GCLK_CAN1_SRC GCLK_PCHCTRL_GEN_GCLK2_Val
+
+// GMAC MDC stays at MCK / 64 = 1.875MHz, inside the 2.5MHz limit
+
+#endif
+
+#endif // CLOCK_PROFILE_CONFIG_H
@@ -0,0 +1,88 @@
+/* Build profiles, force included ahead of every source file */
+#ifndef FEATURE_CONFIG_H
+#define FEATURE_CONFIG_H
+
+// Every configuration of DriveByWireECU.cproj compiles with
+// -include feature_config.h, so a profile sets its switches before any
+// module header or lwipopts.h sees them. Every module keeps its own
+// #ifndef default, and a profile only overrides the ones it changes. A
+// -D in a configuration's symbols still wins over both.
+//
+//	FEATURE_PROFILE_FULL		everything at the modules' defaults:
+//								Release, Performance, Bench and Debug
+//	FEATURE_PROFILE_PRODUCTION	the vehicle image, the Production
+//								configuration. No TCP: the diagnostics
+//								server, the bulk channel and with them
+//								lwIP's TCP code, timers and pools are
+//								left out. No serial console. The control
+//								channel, telemetry, the event log and
+//								the self test stay.
+//
+// A firmware update build (FIRMWARE_UPDATE_ENABLE=1) keeps TCP in any
+// profile.
+//
+// What a profile is not: the driver examples, rtos_start.c and the
+// Atmel START sockets code are never called, and the linker already drops
+// them with --gc-sections. PWM_1 and PWM_3 drive no pin, their timers
+// pace the rate loop (TC1) and the DAC throttle ramp (TC6) and only come
+// up in the builds that have those (Peripherals.h).
+//
+// The savings of a profile are measured, not listed here:
+//
+//	flash and RAM	memory_budget.py Production/DriveByWireECU.map
+//					--baseline Performance/DriveByWireECU.memory.json
+//	boot time		build_compare.py boot, once against each image
+//
+// Both scripts are in PythonTestScripts.
+
+#define FEATURE_PROFILE_FULL 0
+#define FEATURE_PROFILE_PRODUCTION 1
+
+#ifndef FEATURE_PROFILE
+#define FEATURE_PROFILE FEATURE_PROFILE_FULL
+#endif
+
+#if FEATURE_PROFILE == FEATURE_PROFILE_PRODUCTION
+
+#ifndef DIAG_SERVER_ENABLE
+#define DIAG_SERVER_ENABLE 0
+#endif
+#ifndef BULK_CHANNEL_ENABLE
+#define BULK_CHANNEL_ENABLE 0
+#endif
+#ifndef CONSOLE_ENABLE
+#define CONSOLE_ENABLE 0
+#endif
+
+// TCP only for what uses it. An undefined FIRMWARE_UPDATE_ENABLE is 0, as
+// its default.
+#if !defined(LWIP_TCP) && !DIAG_SERVER_ENABLE && !BULK_CHANNEL_ENABLE && !FIRMWARE_UPDATE_ENABLE
+#define LWIP_TCP 0
+#endif
+
+#elif FEATURE_PROFILE != FEATURE_PROFILE_FULL
+#error Unknown FEATURE_PROFILE
+#endif
+
+// SINGLE_PRECISION_ONLY=1 keeps the control and IO math on the FPU, which
+// is single precision only: the PID terms are float (PID_ARITHMETIC_FLOAT
+// unless another is given, PID_ARITHMETIC_DOUBLE is refused), and the hard
+// float configurations, Performance, Bench and Production, also compile
+// with -fsingle-precision-constant and -Wdouble-promotion so a double that
+// creeps back in is a warning. It is on with PERFORMANCE_BUILD. The
+// sources write float literals and call no double math either way, Release
+// and Debug only keep the double PID.
+//
+// The cycles it saves, on the bench with build_compare.py profile: --save
+// a build with SINGLE_PRECISION_ONLY=0 in its symbols, then --compare the
+// default one, the INPUTS, ALGORITHMS and OUTPUTS stages.
+
+#ifndef SINGLE_PRECISION_ONLY
+#ifdef PERFORMANCE_BUILD
+#define SINGLE_PRECISION_ONLY 1
+#else
+#define SINGLE_PRECISION_ONLY 0
+#endif
+#endif
+
+#endif // FEATURE_CONFIG_H
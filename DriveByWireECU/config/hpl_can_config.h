@@ -13,14 +13,14 @@
 // <i> Enable CAN FD operation
 // <id> can_cccr_fdoe
 #ifndef CONF_CAN1_CCCR_FDOE
-#define CONF_CAN1_CCCR_FDOE 0
+#define CONF_CAN1_CCCR_FDOE 1
 #endif
 
 // <q> Bit Rate Switch Enable
 // <i> Bit Rate Switch Enable
 // <id> can_cccr_brse
 #ifndef CONF_CAN1_CCCR_BRSE
-#define CONF_CAN1_CCCR_BRSE 0
+#define CONF_CAN1_CCCR_BRSE 1
 #endif
 
 // <hidden> Run In Standby is invalid for C21/E5x/D5x devices
@@ -138,7 +138,7 @@
 // <i> Number of Rx FIFO 0 element
 // <id> can_rxf0c_f0s
 #ifndef CONF_CAN1_RXF0C_F0S
-#define CONF_CAN1_RXF0C_F0S 2
+#define CONF_CAN1_RXF0C_F0S 8
 #endif
 
 // <o> Data Field Size
@@ -153,7 +153,7 @@
 // <7=> 64 byte data field.
 // <id> can_rxesc_f0ds
 #ifndef CONF_CAN1_RXESC_F0DS
-#define CONF_CAN1_RXESC_F0DS 0
+#define CONF_CAN1_RXESC_F0DS 7
 #endif
 
 /* Bytes size for CAN FIFO 0 element, plus 8 bytes for R0,R1 */
@@ -163,13 +163,60 @@
 
 // </h>
 
+// <h> RX FIFO 1 Configuration
+
+// <o> Operation Mode
+// <i> Select Operation Mode
+// <0=> blocking mode
+// <1=> overwrite mode
+// <id> can_rxf1c_f1om
+#ifndef CONF_CAN1_RXF1C_F1OM
+#define CONF_CAN1_RXF1C_F1OM 0
+#endif
+
+// <o> Watermark <0-64>
+// <i> Watermark, 0 for disable watermark interrupt
+// <id> can_rxf1c_f1wm
+#ifndef CONF_CAN1_RXF1C_F1WM
+#define CONF_CAN1_RXF1C_F1WM 0
+#endif
+
+// <o> Size <0-64>
+// <i> Number of Rx FIFO 1 element
+// <id> can_rxf1c_f1s
+#ifndef CONF_CAN1_RXF1C_F1S
+#define CONF_CAN1_RXF1C_F1S 8
+#endif
+
+// <o> Data Field Size
+// <i> Rx FIFO 1 Data Field Size
+// <0=> 8 byte data field.
+// <1=> 12 byte data field.
+// <2=> 16 byte data field.
+// <3=> 20 byte data field.
+// <4=> 24 byte data field.
+// <5=> 32 byte data field.
+// <6=> 48 byte data field.
+// <7=> 64 byte data field.
+// <id> can_rxesc_f1ds
+#ifndef CONF_CAN1_RXESC_F1DS
+#define CONF_CAN1_RXESC_F1DS 7
+#endif
+
+/* Bytes size for CAN FIFO 1 element, plus 8 bytes for R0,R1 */
+#undef CONF_CAN1_F1DS
+#define CONF_CAN1_F1DS                                                                                                 \
+	((CONF_CAN1_RXESC_F1DS < 5) ? ((CONF_CAN1_RXESC_F1DS << 2) + 16) : (40 + ((CONF_CAN1_RXESC_F1DS % 5) << 4)))
+
+// </h>
+
 // <h> TX FIFO Configuration
 
 // <o> Transmit FIFO Size <0-32>
 // <i> Number of Tx Buffers used for Tx FIFO
 // <id> can_txbc_tfqs
 #ifndef CONF_CAN1_TXBC_TFQS
-#define CONF_CAN1_TXBC_TFQS 2
+#define CONF_CAN1_TXBC_TFQS 4
 #endif
 
 // <o> Tx Buffer Data Field Size
@@ -184,7 +231,7 @@
 // <7=> 64 byte data field.
 // <id> can_txesc_tbds
 #ifndef CONF_CAN1_TXESC_TBDS
-#define CONF_CAN1_TXESC_TBDS 0
+#define CONF_CAN1_TXESC_TBDS 7
 #endif
 
 /* Bytes size for CAN Transmit Buffer element, plus 8 bytes for R0,R1 */
@@ -205,9 +252,11 @@
 
 // <o> Size <0-32>
 // <i> Number of Event FIFO element
+// <i> Every frame sent is logged, room for two Tx FIFOs in case the
+// <i> interrupt that drains it runs late
 // <id> can_txefc_efs
 #ifndef CONF_CAN1_TXEFC_EFS
-#define CONF_CAN1_TXEFC_EFS 2
+#define CONF_CAN1_TXEFC_EFS 8
 #endif
 
 // </h>
@@ -258,14 +307,14 @@
 // <i> Number of standard Message ID filter elements
 // <id> can_sidfc_lss
 #ifndef CONF_CAN1_SIDFC_LSS
-#define CONF_CAN1_SIDFC_LSS 2
+#define CONF_CAN1_SIDFC_LSS 16
 #endif
 
 // <o> Number of Extended Message ID filter elements <0-128>
 // <i> Number of Extended Message ID filter elements
 // <id> can_xidfc_lss
 #ifndef CONF_CAN1_XIDFC_LSS
-#define CONF_CAN1_XIDFC_LSS 2
+#define CONF_CAN1_XIDFC_LSS 16
 #endif
 
 // <o> Extended ID Mask <0x0000-0x1FFFFFFF>
@@ -280,6 +329,26 @@
 
 // </h>
 
+// <h> Timestamp Configuration
+
+// <o> Timestamp Select
+// <0=> Always 0
+// <1=> Incremented by TCP
+// <i> Source of the Rx timestamp stored with every received message
+// <id> can_tscc_tss
+#ifndef CONF_CAN1_TSCC_TSS
+#define CONF_CAN1_TSCC_TSS 1
+#endif
+
+// <o> Timestamp Counter Prescaler <1-16>
+// <i> Nominal bit times per timestamp counter increment
+// <id> can_tscc_tcp
+#ifndef CONF_CAN1_TSCC_TCP
+#define CONF_CAN1_TSCC_TCP 1
+#endif
+
+// </h>
+
 // <h> Interrupt Configuration
 
 // <q> Error Warning
@@ -300,21 +369,21 @@
 // <i> Indicates whether to not disable CAN error passive interrupt
 // <id> can_ie_ep
 #ifndef CONF_CAN1_IE_EP
-#define CONF_CAN1_IE_EP 0
+#define CONF_CAN1_IE_EP 1
 #endif
 
 // <q> Bus Off
 // <i> Indicates whether to not disable CAN bus off interrupt
 // <id> can_ie_bo
 #ifndef CONF_CAN1_IE_BO
-#define CONF_CAN1_IE_BO 0
+#define CONF_CAN1_IE_BO 1
 #endif
 
 // <q> Data Overrun
 // <i> Indicates whether to not disable CAN data overrun interrupt
 // <id> can_ie_do
 #ifndef CONF_CAN1_IE_DO
-#define CONF_CAN1_IE_DO 0
+#define CONF_CAN1_IE_DO 1
 #endif
 
 // </h>
@@ -346,8 +415,14 @@
 	    | CAN_RXF0C_F0S(CONF_CAN1_RXF0C_F0S)
 #endif
 
+#ifndef CONF_CAN1_RXF1C_REG
+#define CONF_CAN1_RXF1C_REG                                                                                            \
+	(CONF_CAN1_RXF1C_F1OM << CAN_RXF1C_F1OM_Pos) | CAN_RXF1C_F1WM(CONF_CAN1_RXF1C_F1WM)                                \
+	    | CAN_RXF1C_F1S(CONF_CAN1_RXF1C_F1S)
+#endif
+
 #ifndef CONF_CAN1_RXESC_REG
-#define CONF_CAN1_RXESC_REG CAN_RXESC_F0DS(CONF_CAN1_RXESC_F0DS)
+#define CONF_CAN1_RXESC_REG CAN_RXESC_F0DS(CONF_CAN1_RXESC_F0DS) | CAN_RXESC_F1DS(CONF_CAN1_RXESC_F1DS)
 #endif
 
 #ifndef CONF_CAN1_TXESC_REG
@@ -362,6 +437,10 @@
 #define CONF_CAN1_TXEFC_REG CAN_TXEFC_EFWM(CONF_CAN1_TXEFC_EFWM) | CAN_TXEFC_EFS(CONF_CAN1_TXEFC_EFS)
 #endif
 
+#ifndef CONF_CAN1_TSCC_REG
+#define CONF_CAN1_TSCC_REG CAN_TSCC_TSS(CONF_CAN1_TSCC_TSS) | CAN_TSCC_TCP(CONF_CAN1_TSCC_TCP - 1)
+#endif
+
 #ifndef CONF_CAN1_GFC_REG
 #define CONF_CAN1_GFC_REG                                                                                              \
 	CAN_GFC_ANFS(CONF_CAN1_GFC_ANFS) | CAN_GFC_ANFE(CONF_CAN1_GFC_ANFE) | (CONF_CAN1_GFC_RRFS << CAN_GFC_RRFS_Pos)     \
@@ -383,7 +462,8 @@
 #ifndef CONF_CAN0_IE_REG
 #define CONF_CAN0_IE_REG                                                                                               \
 	(CONF_CAN1_IE_EW << CAN_IR_EW_Pos) | (CONF_CAN1_IE_EA << CAN_IR_EP_Pos) | (CONF_CAN1_IE_EP << CAN_IR_EP_Pos)       \
-	    | (CONF_CAN1_IE_BO << CAN_IR_BO_Pos) | (CONF_CAN1_IE_DO << CAN_IR_RF0L_Pos)
+	    | (CONF_CAN1_IE_BO << CAN_IR_BO_Pos) | (CONF_CAN1_IE_DO << CAN_IR_RF0L_Pos)                                    \
+	    | (CONF_CAN1_IE_DO << CAN_IR_RF1L_Pos)
 #endif
 
 // <<< end of configuration section >>>
@@ -4,6 +4,8 @@
 
 // <<< Use Configuration Wizard in Context Menu >>>
 
+#include <clock_profile_config.h>
+
 // <e> Generic clock generator 0 configuration
 // <i> Indicates whether generic clock 0 configuration is enabled or not
 // <id> enable_gclk_gen_0
@@ -5,6 +5,48 @@
 // <<< Use Configuration Wizard in Context Menu >>>
 
 #include <peripheral_clk_config.h>
+#include <lwip_profile_config.h>
+
+// <q> Zero copy receive
+// <i> Receive descriptors point at buffers handed over by the network stack
+// <i> with _mac_async_rx_give and taken back with _mac_async_rx_take instead of
+// <i> the driver's own buffers, so frames are never copied. Each buffer holds a
+// <i> whole frame, which sets the DMA receive buffer size.
+// <id> gmac_arch_rx_zero_copy
+#ifndef CONF_GMAC_RX_ZERO_COPY
+#define CONF_GMAC_RX_ZERO_COPY 1
+#endif
+
+// <q> Scatter gather transmit
+// <i> Frames are queued with _mac_async_write_sg as a list of segments, each
+// <i> sent from where it already is through its own transmit descriptor.
+// <i> Segments marked for copying go through the driver's transmit buffers.
+// <i> _mac_async_write is not available in this mode.
+// <id> gmac_arch_tx_scatter_gather
+#ifndef CONF_GMAC_TX_SCATTER_GATHER
+#define CONF_GMAC_TX_SCATTER_GATHER 1
+#endif
+
+// <q> Priority receive
+// <i> ethernetif_mac_input takes up to half a ring of frames per pass and
+// <i> sorts them with the classifier from ethernetif_mac_set_classifier.
+// <i> Priority frames go to the stack right away, the others after the pass.
+// <i> This GMAC has a single receive queue and no screening registers, the
+// <i> deferral task does the sorting instead.
+// <id> gmac_arch_rx_priority
+#ifndef CONF_GMAC_RX_PRIORITY
+#define CONF_GMAC_RX_PRIORITY 1
+#endif
+
+// <o> Receive shed level <0-255>
+// <i> With zero copy receive and a classifier, while fewer receive descriptors
+// <i> than this have a buffer ethernetif_mac_input frees normal frames as
+// <i> they are taken off the ring, so the pool refills the ring for the
+// <i> priority ones. 0 never sheds.
+// <id> gmac_arch_rx_shed_level
+#ifndef CONF_GMAC_RX_SHED_LEVEL
+#define CONF_GMAC_RX_SHED_LEVEL (CONF_GMAC_RXDESCR_NUM / 4)
+#endif
 
 // <h> Network Control configuration
 
@@ -100,7 +142,7 @@
 // <i> Multicast frames will be accepted when the 6-bit hash function of the destination address points to a bit that is set in the Hash Register.
 // <id> gmac_arch_ncfgr_mtihen
 #ifndef CONF_GMAC_NCFGR_MTIHEN
-#define CONF_GMAC_NCFGR_MTIHEN 0
+#define CONF_GMAC_NCFGR_MTIHEN 1
 #endif
 
 // <q> Unicast Hash Enable
@@ -140,6 +182,10 @@
 // <i> Indicates the number of bytes by which the received data is offset from
 // <i> the start of the receive buffer.
 // <id> gmac_arch_ncfgr_rxbufo
+#if CONF_GMAC_RX_ZERO_COPY
+/* Frame is placed after the lwIP ETH_PAD_SIZE padding in the pbuf */
+#define CONF_GMAC_NCFGR_RXBUFO 2
+#endif
 #ifndef CONF_GMAC_NCFGR_RXBUFO
 #define CONF_GMAC_NCFGR_RXBUFO 0
 #endif
@@ -219,7 +265,7 @@
 // <i> TCP or UDP checksums are discarded.
 // <id> gmac_arch_ncfgr_rxcoen
 #ifndef CONF_GMAC_NCFGR_RXCOEN
-#define CONF_GMAC_NCFGR_RXCOEN 0
+#define CONF_GMAC_NCFGR_RXCOEN 1
 #endif
 
 // <q> Enable Frames Received in Half Duplex
@@ -371,7 +417,7 @@
 // <i> unaffected
 // <id> gmac_arch_dcfgr_txcoen
 #ifndef CONF_GMAC_DCFGR_TXCOEN
-#define CONF_GMAC_DCFGR_TXCOEN 0
+#define CONF_GMAC_DCFGR_TXCOEN 1
 #endif
 
 // <o> DMA Receive Buffer Size <1-255>
@@ -381,6 +427,10 @@
 // <i> thus a value of 0x01 corresponds to buffers of 64 bytes, 0x02
 // <i> corresponds to 128 bytes etc.
 // <id> gmac_arch_dcfgr_drbs
+#if CONF_GMAC_RX_ZERO_COPY && !defined(CONF_GMAC_DCFGR_DRBS)
+/* 1536 bytes, one buffer holds a 1518 byte frame plus the receive offset */
+#define CONF_GMAC_DCFGR_DRBS 24
+#endif
 #ifndef CONF_GMAC_DCFGR_DRBS
 #define CONF_GMAC_DCFGR_DRBS 2
 #endif
@@ -407,7 +457,7 @@
 // <i> Number of Transmit Buffer Descriptor
 // <id> gmac_arch_txdescr_num
 #ifndef CONF_GMAC_TXDESCR_NUM
-#define CONF_GMAC_TXDESCR_NUM 2
+#define CONF_GMAC_TXDESCR_NUM 16
 #endif
 
 // <o> Number of Receive Buffer Descriptor <1-255>
@@ -420,6 +470,10 @@
 // <o> Byte size of Transmit Buffer <64-10240>
 // <i> Byte size of buffer for each transmit buffer descriptor.
 // <id> gmac_arch_txbuf_size
+#if CONF_GMAC_TX_SCATTER_GATHER
+/* Only segments that have to be copied use these, longer ones span several */
+#define CONF_GMAC_TXBUF_SIZE 256
+#endif
 #ifndef CONF_GMAC_TXBUF_SIZE
 #define CONF_GMAC_TXBUF_SIZE 1500
 #endif
@@ -428,6 +482,31 @@
 #define CONF_GMAC_RXBUF_SIZE (CONF_GMAC_DCFGR_DRBS * 64)
 #endif
 
+// The ring and buffer sizes a profile picks (lwip_profile_config.h)
+#if CONF_GMAC_RXDESCR_NUM < 2 || CONF_GMAC_RXDESCR_NUM > 255 || CONF_GMAC_TXDESCR_NUM < 2 || CONF_GMAC_TXDESCR_NUM > 255
+#error "CONF_GMAC_RXDESCR_NUM and CONF_GMAC_TXDESCR_NUM must be 2 to 255"
+#endif
+#if CONF_GMAC_DCFGR_DRBS < 1 || CONF_GMAC_DCFGR_DRBS > 255
+#error "CONF_GMAC_DCFGR_DRBS must be 1 to 255"
+#endif
+#if CONF_GMAC_RXDESCR_NUM * CONF_GMAC_RXBUF_SIZE < CONF_GMAC_NCFGR_RXBUFO + (CONF_GMAC_NCFGR_MAXFS ? 1536 : 1518)
+#error "The receive ring must hold the longest frame the GMAC accepts"
+#endif
+
+// <s> DMA memory section
+// <i> Linker section of the descriptors and every buffer the GMAC reads or
+// <i> writes. The linker script keeps it in one block aligned to
+// <i> CONF_GMAC_DMA_ALIGN after the main stack, apart from the CPU's data.
+// <i> The CMCC only caches the code bus, SRAM is never cached.
+// <id> gmac_arch_dma_section
+#ifndef CONF_GMAC_DMA_SECTION
+#define CONF_GMAC_DMA_SECTION ".gmac"
+#endif
+
+// Alignment of the section and of its buffers. The descriptor lists need 8,
+// 32 keeps a buffer from sharing a burst with its neighbour's tail.
+#define CONF_GMAC_DMA_ALIGN 32
+
 // <e> Enable Transmit Partial Store and Forward
 // <i> This allows for a reduced latency but there are performance implications.
 // <id> gmac_arch_tpsf_en
@@ -4,6 +4,8 @@
 
 // <<< Use Configuration Wizard in Context Menu >>>
 
+#include <clock_profile_config.h>
+
 #include <peripheral_clk_config.h>
 
 // <e> System Configuration
@@ -4,6 +4,8 @@
 
 // <<< Use Configuration Wizard in Context Menu >>>
 
+#include <clock_profile_config.h>
+
 // <e> External Multipurpose Crystal Oscillator Configuration
 // <i> Indicates whether configuration for XOSC0 is enabled or not
 // <id> enable_xosc0
@@ -61,7 +61,7 @@
 // <i> USART baud rate setting
 // <id> usart_baud_rate
 #ifndef CONF_SERCOM_2_USART_BAUD
-#define CONF_SERCOM_2_USART_BAUD 9600
+#define CONF_SERCOM_2_USART_BAUD 460800
 #endif
 
 // </h>
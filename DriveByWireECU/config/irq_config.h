@@ -0,0 +1,82 @@
+/* Interrupt priorities, included ahead of FreeRTOSConfig.h */
+#ifndef IRQ_CONFIG_H
+#define IRQ_CONFIG_H
+
+// Every interrupt the ECU enables gets its NVIC priority here, the kernel's
+// split below takes precedence over the one in FreeRTOSConfig.h. 0 is the
+// highest of the 8 levels (configPRIO_BITS 3).
+//
+// Priority map, highest first:
+//
+//	0	EIC_3		estop input, forces the outputs off (EStopInput.h)
+//	1				TCC fault, reserved: the TCCs take the estop as a
+//					fault event without an interrupt (TccPwm.h)
+//	1	ADC1_0, ADC0_0	window monitor trip, cuts the steering actuator
+//					(AdcSampler.h)
+//	2	TC1			steering rate loop (SteeringRateLoop.h)
+//	3				ADC DMA, reserved: the ADC scan runs on DMAC channels
+//					without interrupts (AdcSampler.h)
+//	3	TCC2		PC sampler, samples everything it can preempt
+//					(PcSampler.h)
+//	--- configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, masked by the kernel
+//	4	WDT			watchdog early warning (Watchdog.h)
+//	4	TCC3		releases the control cycle above 1 kHz
+//					(ControlScheduler.h)
+//	5	CAN1		vehicle CAN receive, stamps frames with the tick
+//	7	GMAC		network, only notifies gmac_task
+//	7	DMAC		DmaService channels, the log UART
+//	7	SERCOM2_2	console receive (Console.h)
+//	7	USB			USB debug port
+//	7	TC6, RAMECC	run time counter on TC6, TC1 or TC0 (TimerClaims.h),
+//					RAM ECC errors
+//	7	SysTick, PendSV	kernel, releases the control cycle at 1 kHz
+//
+// Nothing above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY is ever held
+// off by a kernel critical section, so those handlers must make no RTOS
+// calls. The network and the debug interrupts share the kernel's level: they
+// can never preempt the tick that releases the control cycle, the most they
+// can do is delay it by one of their short handlers. The Profiler stages
+// PROFILER_STAGE_GMAC_ISR, PROFILER_STAGE_CAN_RECEIVE and
+// PROFILER_STAGE_STEERING_RATE_JITTER keep those handlers and the rate
+// loop's release honest, PROFILER_STAGE_WAKE the cycle's.
+//
+// Atmel START enables some interrupts at the NVIC's reset priority 0, above
+// the estop. main sets every interrupt to IRQ_PRIORITY_DEFAULT first, the
+// modules set their own from here when they start.
+
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY 0x07
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY 4
+
+#define IRQ_PRIORITY_ESTOP 0
+#define IRQ_PRIORITY_ADC_WINDOW 1
+#define IRQ_PRIORITY_STEERING_RATE 2
+#define IRQ_PRIORITY_PC_SAMPLER 3
+#define IRQ_PRIORITY_WATCHDOG 4
+#define IRQ_PRIORITY_CONTROL_TIMER 4
+#define IRQ_PRIORITY_CAN 5
+#define IRQ_PRIORITY_NETWORK configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_DMA configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_USB configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_CONSOLE configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_RUN_TIME_COUNTER configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_RAM_ECC configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_ICM configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_SENSOR_HUB configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_DEFAULT configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+
+// These handlers call the RTOS
+#if IRQ_PRIORITY_WATCHDOG < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY || IRQ_PRIORITY_CAN < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY \
+	|| IRQ_PRIORITY_NETWORK < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY || IRQ_PRIORITY_DMA < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY \
+	|| IRQ_PRIORITY_USB < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY || IRQ_PRIORITY_CONSOLE < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+#error An interrupt that calls the RTOS is above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+#endif
+
+// The estop must preempt the rate loop, and the rate loop must preempt
+// everything the kernel masks. The window trip sits between the estop and
+// the rate loop, the loop writes the torque it cuts.
+#if IRQ_PRIORITY_ESTOP >= IRQ_PRIORITY_STEERING_RATE || IRQ_PRIORITY_STEERING_RATE >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY \
+	|| IRQ_PRIORITY_ADC_WINDOW < IRQ_PRIORITY_ESTOP || IRQ_PRIORITY_ADC_WINDOW >= IRQ_PRIORITY_STEERING_RATE
+#error IRQ_PRIORITY_ESTOP, IRQ_PRIORITY_ADC_WINDOW and IRQ_PRIORITY_STEERING_RATE are out of order
+#endif
+
+#endif // IRQ_CONFIG_H
@@ -32,7 +32,7 @@
 // <i> If set, the netif has IGMP capability.
 // <id> macif_igmp
 #ifndef CONF_TCPIP_STACK_INTERFACE_0_IGMP
-#define CONF_TCPIP_STACK_INTERFACE_0_IGMP 0
+#define CONF_TCPIP_STACK_INTERFACE_0_IGMP 1
 #endif
 
 // <q> Enable Point to Point
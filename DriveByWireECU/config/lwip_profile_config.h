@@ -0,0 +1,64 @@
+/* lwIP memory profile selection, included ahead of lwipopts.h, hpl_gmac_config.h and PIDTrace.h */
+#ifndef LWIP_PROFILE_CONFIG_H
+#define LWIP_PROFILE_CONFIG_H
+
+// Anything defined here takes precedence over the defaults in lwipopts.h,
+// hpl_gmac_config.h and PIDTrace.h.
+
+// <q> Control profile
+// <i> 0: the generated lwIP sizing, TCP enabled and every pool pbuf holding
+// <i> a full size frame, as for a web server.
+// <i> 1: sized for the UDP control channel. TCP is compiled out, pool
+// <i> pbufs and GMAC receive buffers are 128 bytes, twice as many, and
+// <i> lwIP also keeps link and UDP statistics. The RAM freed doubles the
+// <i> PID trace.
+// <id> lwip_profile_control
+#ifndef CONF_LWIP_PROFILE_CONTROL
+#define CONF_LWIP_PROFILE_CONTROL 0
+#endif
+
+#if CONF_LWIP_PROFILE_CONTROL == 1
+
+// Nothing in the ECU talks TCP. That takes the TCP PCBs, segments and
+// windows with it.
+#define LWIP_TCP 0
+
+// Every frame the ECU receives is a command or a request of well under 100
+// bytes, ARP and ping are smaller still. A 128 byte buffer holds a 126 byte
+// frame after the receive offset, a longer one continues in the buffers
+// that follow and reaches lwIP as a pbuf chain. 32 descriptors hold a
+// 1536 byte frame with room for a burst of small ones behind it. One pool
+// pbuf per GMAC receive descriptor plus a few for frames the stack still
+// holds. The GMAC ring statistics are logged with the pools, size these
+// from the fewest descriptors ever filled and the frames lost.
+#define CONF_GMAC_DCFGR_DRBS 2
+#define CONF_GMAC_RXDESCR_NUM 32
+#define PBUF_POOL_BUFSIZE 128
+#define PBUF_POOL_SIZE 40
+
+// The mem_malloc pools only hold the transmit frames, the largest being a
+// trace data frame of about 1.1kB, briefly, plus the telemetry pbufs.
+// Nothing received is copied, only the two batched telemetry pbufs need
+// the 1600 byte class.
+#define MEM_POOL_128_NUM 12
+#define MEM_POOL_256_NUM 4
+#define MEM_POOL_640_NUM 2
+#define MEM_POOL_1200_NUM 2
+#define MEM_POOL_1600_NUM 2
+
+// Pool use is logged every LWIP_STATS_REPORT_PERIOD ms (EthernetIO.c),
+// with the link and UDP counters here. Size the pools above from their
+// high-water marks.
+#define LINK_STATS 1
+#define UDP_STATS 1
+#define LWIP_STATS_REPORT_PERIOD 10000
+// Without the TCP timer MEMP_NUM_SYS_TIMEOUT is one too many here
+
+// About 34kB less than the generated profile: 20 1.5kB pool pbufs become
+// 40 of 128 bytes, the mem_malloc pools shrink by 7.5kB and TCP state goes. The PID
+// trace takes about the same back, 512 more samples of 68 bytes.
+#define PID_TRACE_DEPTH 1024
+
+#endif
+
+#endif // LWIP_PROFILE_CONFIG_H
@@ -2,6 +2,10 @@
 #ifndef LWIPOPTS_H
 #define LWIPOPTS_H
 
+#include <task_config.h>
+#include <lwip_profile_config.h>
+#include <hpl_gmac_config.h>
+
 // <<< Use Configuration Wizard in Context Menu >>>
 
 // <h> Basic Configuration
@@ -24,12 +28,42 @@
 #define SYS_THREAD_MAX 8
 #endif
 
-// <o> The size of the heap memory <0-100000>
-// <i> Defines size of the heap memory
-// <i> Default: 4096
-// <id> lwip_mem_size
-#ifndef MEM_SIZE
-#define MEM_SIZE 14336
+// mem_malloc, and with it every PBUF_RAM pbuf, takes the smallest free
+// element of the size classes in lwippools.h instead of carving up a heap.
+// Allocation and free are O(1) and nothing fragments. A class that runs
+// out borrows from the next larger one.
+#ifndef MEM_USE_POOLS
+#define MEM_USE_POOLS 1
+#endif
+#define MEMP_USE_CUSTOM_POOLS MEM_USE_POOLS
+#ifndef MEM_USE_POOLS_TRY_BIGGER_POOL
+#define MEM_USE_POOLS_TRY_BIGGER_POOL 1
+#endif
+
+// With zero copy receive the GMAC writes frames straight into PBUF_POOL
+// pbufs, so the pools go in its DMA section with the descriptors
+#if CONF_GMAC_RX_ZERO_COPY
+#define MEMP_MEMORY_ATTRIBUTE __attribute__((__section__(CONF_GMAC_DMA_SECTION ".memp_memory"), __aligned__(CONF_GMAC_DMA_ALIGN)))
+#endif
+
+// Elements of each mem_malloc size class (lwippools.h). 1600 byte elements
+// hold a full size frame, received without zero copy, flattened for
+// transmit or a TCP segment, and the two batched telemetry pbufs
+// (EthernetIO.c) the control channel keeps for good.
+#ifndef MEM_POOL_128_NUM
+#define MEM_POOL_128_NUM 16
+#endif
+#ifndef MEM_POOL_256_NUM
+#define MEM_POOL_256_NUM 8
+#endif
+#ifndef MEM_POOL_640_NUM
+#define MEM_POOL_640_NUM 4
+#endif
+#ifndef MEM_POOL_1200_NUM
+#define MEM_POOL_1200_NUM 2
+#endif
+#ifndef MEM_POOL_1600_NUM
+#define MEM_POOL_1600_NUM 5
 #endif
 
 // <q> Enables TCP
@@ -65,7 +99,14 @@
 // <q> Enables IGMP
 // <id> lwip_igmp
 #ifndef LWIP_IGMP
-#define LWIP_IGMP 0
+#define LWIP_IGMP 1
+#endif
+
+// <q> Enables static ARP entries
+// <i> Entries added with etharp_add_static_entry never time out and are never replaced by ARP replies
+// <id> lwip_etharp_support_static_entries
+#ifndef ETHARP_SUPPORT_STATIC_ENTRIES
+#define ETHARP_SUPPORT_STATIC_ENTRIES 1
 #endif
 
 // <q> Enables SLIP interface
@@ -126,11 +167,11 @@
 #endif
 
 // <o> TCP sender buffer space (bytes)<0-100000>
-// <i> multiple of TCP_MSS
-// <i> Default: 2
+// <i> multiple of TCP_MSS, at least BULK_MAX_IN_FLIGHT (BulkChannel.h)
+// <i> Default: 4
 // <id> lwip_tcp_snd_buf_mul
 #ifndef TCP_SND_BUF_MUL
-#define TCP_SND_BUF_MUL 2
+#define TCP_SND_BUF_MUL 4
 #endif
 
 #ifndef TCP_SND_BUF
@@ -154,11 +195,12 @@
 #endif
 
 // <o> the number of simultaneously queued TCP segments<0-1000>
-// <i> the number of simultaneously queued TCP segments
-// <i> Default: 16
+// <i> the number of simultaneously queued TCP segments, a full send buffer
+// <i> of the bulk channel and of both diagnostics connections
+// <i> Default: 24
 // <id> lwip_memp_num_tcp_seg
 #ifndef MEMP_NUM_TCP_SEG
-#define MEMP_NUM_TCP_SEG 16
+#define MEMP_NUM_TCP_SEG 24
 #endif
 
 // <o> Number of bytes added before the ethernet header CPU<0-100000>
@@ -203,7 +245,7 @@
 // <q> Enable inter-task protection for certain critical regions during buffer/memory allocation etc.
 // <id> lwip_sys_lightweight_prot
 #ifndef SYS_LIGHTWEIGHT_PROT
-#define SYS_LIGHTWEIGHT_PROT 0
+#define SYS_LIGHTWEIGHT_PROT 1
 #endif
 
 // <q> Enables Netconn API(not available when using "NO_SYS")
@@ -218,6 +260,23 @@
 #define LWIP_TCPIP_TIMEOUT 1
 #endif
 
+// <q> Enables TCP/IP core locking
+// <i> Netconn and socket calls take the core mutex and run in the calling
+// <i> thread instead of posting to tcpip_thread and waiting for it
+// <id> lwip_tcpip_core_locking
+#ifndef LWIP_TCPIP_CORE_LOCKING
+#define LWIP_TCPIP_CORE_LOCKING 1
+#endif
+
+// <q> Enables TCP/IP core locking for input
+// <i> tcpip_input takes the core mutex and processes the frame in the
+// <i> calling thread (gmac_task) instead of queueing it to tcpip_thread.
+// <i> Needs core locking.
+// <id> lwip_tcpip_core_locking_input
+#ifndef LWIP_TCPIP_CORE_LOCKING_INPUT
+#define LWIP_TCPIP_CORE_LOCKING_INPUT 1
+#endif
+
 // <q> Enables Socket functions(not available when using "NO_SYS")
 // <id> lwip_socket
 #ifndef LWIP_SOCKET
@@ -268,6 +327,16 @@
 #define MEMP_NUM_ARP_QUEUE 30
 #endif
 
+// <o> the number of simultaneously active timeouts<0-1000>
+// <i> lwIP's ARP, reassembly, IGMP and TCP timers, the control channel
+// <i> transmit timer and watchdog heartbeat, the stats report, PhyMonitor
+// <i> and Ptp, one spare
+// <i> Default: 10
+// <id> lwip_memp_num_sys_timeout
+#ifndef MEMP_NUM_SYS_TIMEOUT
+#define MEMP_NUM_SYS_TIMEOUT 10
+#endif
+
 // <o> the number of struct netbufs<0-1000>
 // <i> the number of struct netbufs
 // <i> Default: 2
@@ -286,10 +355,12 @@
 
 // <o> the number of buffers in the pbuf pool<0-1000>
 // <i> the number of buffers in the pbuf pool
+// <i> Each GMAC receive descriptor holds one of these in zero copy receive
+// <i> mode, the rest cover frames still being processed by the stack.
 // <i> Default: 16
 // <id> lwip_pbuf_pool_size
 #ifndef PBUF_POOL_SIZE
-#define PBUF_POOL_SIZE 16
+#define PBUF_POOL_SIZE 20
 #endif
 
 // <o> the number of bytes that should be allocated for a link level header<0-1000>
@@ -305,12 +376,15 @@
 // <o> Extra size of each pbuf in the pbuf pool<0-1000>
 // <i> The default is designed to accomodate single full size TCP frame in one pbuf.
 // <i> It will include TCP_MSS, IP header, and link header, plus an extra word
+// <i> 20 makes a pool pbuf exactly one 1536 byte GMAC receive buffer
 // <id> lwip_pbuf_pool_bufsize_added
 #ifndef PBUF_POOL_BUFSIZE_ADDED
-#define PBUF_POOL_BUFSIZE_ADDED 0
+#define PBUF_POOL_BUFSIZE_ADDED 20
 #endif
 
+#ifndef PBUF_POOL_BUFSIZE
 #define PBUF_POOL_BUFSIZE LWIP_MEM_ALIGN_SIZE(TCP_MSS + 40 + PBUF_LINK_HLEN + PBUF_POOL_BUFSIZE_ADDED)
+#endif
 
 // <o> the number of multicast groups<0-1000>
 // <i> the number of multicast groups
@@ -396,7 +470,7 @@
 // <q> Enables statistics collection in lwip_stats
 // <id> lwip_stats
 #ifndef LWIP_STATS
-#define LWIP_STATS 0
+#define LWIP_STATS 1
 #endif
 
 // <q> Compile in the statistics output functions
@@ -408,7 +482,7 @@
 // <q> Compile in the statistics output functions
 // <id> lwip_link_stats
 #ifndef LINK_STATS
-#define LINK_STATS 0
+#define LINK_STATS 1
 #endif
 
 // <q> Enable etharp stats
@@ -444,7 +518,7 @@
 // <q> Enable UDP stats
 // <id> lwip_udp_stats
 #ifndef UDP_STATS
-#define UDP_STATS 0
+#define UDP_STATS 1
 #endif
 
 // <q> Enable TCP stats
@@ -456,13 +530,13 @@
 // <q> Enable memp.c stats
 // <id> lwip_memp_stats
 #ifndef MEMP_STATS
-#define MEMP_STATS 0
+#define MEMP_STATS 1
 #endif
 
 // <q> Enable system stats
 // <id> lwip_sys_stats
 #ifndef SYS_STATS
-#define SYS_STATS 0
+#define SYS_STATS 1
 #endif
 
 // <q> Disable LwIP Assert
@@ -792,4 +866,27 @@
 
 // <<< end of configuration section >>>
 
+// Checksums the GMAC takes care of (hpl_gmac_config.h) are not computed again
+// in software. With receive offload the GMAC drops frames with a bad IP, UDP
+// or TCP checksum before lwIP sees them, with transmit offload it fills in
+// the fields lwIP leaves zero. ICMP is not covered and stays in software.
+#if CONF_GMAC_DCFGR_TXCOEN
+#define CHECKSUM_GEN_IP 0
+#define CHECKSUM_GEN_UDP 0
+#define CHECKSUM_GEN_TCP 0
+#endif
+#if CONF_GMAC_NCFGR_RXCOEN
+#define CHECKSUM_CHECK_IP 0
+#define CHECKSUM_CHECK_UDP 0
+#define CHECKSUM_CHECK_TCP 0
+#endif
+
+// The M4 copy and checksum kernels (NetMem.h). SMEMCPY stays on memcpy, it
+// is only used with small constant lengths that gcc copies inline.
+#include "NetMem.h"
+#define MEMCPY(dst, src, len) NET_MEMCPY(dst, src, len)
+#if NET_MEM_FAST
+#define LWIP_CHKSUM NetChecksum
+#endif
+
 #endif // LWIPOPTS_H
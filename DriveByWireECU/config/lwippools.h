@@ -0,0 +1,29 @@
+/* mem_malloc size classes, included by lwip/memp_std.h for MEM_USE_POOLS */
+
+// No include guard, memp_std.h includes this once for every way it
+// expands the pool list.
+//
+// Each class is the bytes mem_malloc hands out, the pool adds its own
+// header. A PBUF_RAM pbuf takes 60 bytes of pbuf and headers ahead of its
+// payload: telemetry, PTP messages and small requests fit 128, parameter,
+// boot and task frames 256, event frames 640, profile and trace frames
+// 1200, batched telemetry 1600. The counts are in lwipopts.h and
+// lwip_profile_config.h, smallest class first as mem_malloc expects.
+
+#if MEM_USE_POOLS
+
+#if !CONF_GMAC_RX_ZERO_COPY && !MEM_POOL_1600_NUM
+#error Without CONF_GMAC_RX_ZERO_COPY every received frame is a PBUF_RAM, MEM_POOL_1600_NUM must hold them
+#endif
+
+LWIP_MALLOC_MEMPOOL_START
+LWIP_MALLOC_MEMPOOL(MEM_POOL_128_NUM, 128)
+LWIP_MALLOC_MEMPOOL(MEM_POOL_256_NUM, 256)
+LWIP_MALLOC_MEMPOOL(MEM_POOL_640_NUM, 640)
+LWIP_MALLOC_MEMPOOL(MEM_POOL_1200_NUM, 1200)
+#if MEM_POOL_1600_NUM
+LWIP_MALLOC_MEMPOOL(MEM_POOL_1600_NUM, 1600)
+#endif
+LWIP_MALLOC_MEMPOOL_END
+
+#endif
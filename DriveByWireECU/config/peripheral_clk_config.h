@@ -4,6 +4,8 @@
 
 // <<< Use Configuration Wizard in Context Menu >>>
 
+#include <clock_profile_config.h>
+
 // <y> ADC Clock Source
 // <id> adc_gclk_selection
 
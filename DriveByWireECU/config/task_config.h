@@ -0,0 +1,88 @@
+/* Task priorities and stacks, included ahead of FreeRTOSConfig.h and lwipopts.h */
+#ifndef TASK_CONFIG_H
+#define TASK_CONFIG_H
+
+// Every task in the system gets its priority and stack depth here, the
+// kernel and lwIP settings below take precedence over the defaults in
+// FreeRTOSConfig.h and lwipopts.h.
+//
+// Priority map, highest first:
+//
+//	5	Main_Task		control loop, preempts everything else
+//	3	GMAC			RX deferral, refills the RX descriptors and, with
+//						LWIP_TCPIP_CORE_LOCKING_INPUT, runs lwIP input and
+//						the raw UDP command callbacks under the core lock
+//	2	tcpip_thread	lwIP timers, raw UDP telemetry, and received frames
+//						when input does not lock the core
+//	1	Ethernet_Task	netconn control channel and telemetry on one queue
+//						set, unused in the raw UDP build after startup
+//	1	Tmr Svc			kernel timer daemon, the periodic housekeeping:
+//						CPU load and stack statistics (TaskMonitor.h) and
+//						the LED0 heartbeat
+//	1	Service			the cooperative services (Service.h): log records
+//						to the debug UART, the black box to the QSPI flash
+//	1	UsbDbg			USB debug port, answers requests under the core lock
+//	1	WcetBurst		Bench image only, the network load of the WCET
+//						campaign (WcetCampaign.h)
+//	0	IDLE
+//
+// Networking can never delay a control cycle, and a burst of received
+// frames is taken off the GMAC before telemetry competes for the CPU.
+// Periodic housekeeping is a software timer rather than a task of its own,
+// every job shares the timer daemon's stack. Its callbacks must never
+// block, jobs that wait on hardware keep their own task. Low priority jobs
+// that wait on their own terms, a period or a DMA, are services that share
+// the service task's stack the same way.
+//
+// Stack depths are in words, sized from the deepest call each task makes
+// with room to spare. The task data frame (ControlProtocol.h) reports the
+// least free stack of every task, trim or grow these from what it shows on
+// the vehicle, and the monitor logs it every TASK_MONITOR_STACK_REPORT
+// periods (TaskMonitor.h). An overflow forces the outputs safe and halts the
+// ECU until the watchdog resets it.
+
+#define configMAX_PRIORITIES ((uint32_t)6)
+
+#define TASK_PRIORITY_CONTROL 5
+#define TASK_PRIORITY_TIMER 1
+#define TASK_PRIORITY_GMAC 3
+#define TASK_PRIORITY_TCPIP 2
+#define TASK_PRIORITY_ETHERNET 1
+#define TASK_PRIORITY_SERVICE 1
+#define TASK_PRIORITY_SD_LOGGER 1
+#define TASK_PRIORITY_USB_DEBUG 1
+#define TASK_PRIORITY_FIRMWARE_UPDATE 1
+#define TASK_PRIORITY_WCET_BURST 1
+#define TASK_PRIORITY_CAN_GATEWAY 1
+
+#define TASK_STACK_CONTROL 512
+// the task monitor's stack report LOG calls, its buffers are static
+#define TASK_STACK_TIMER 320
+#define TASK_STACK_GMAC 384
+// gmac_task when it runs lwIP input itself, down to the control channel
+// replies, as deep as the tcpip thread
+#define TASK_STACK_GMAC_INPUT 1024
+#define TASK_STACK_TCPIP 1024
+#define TASK_STACK_ETHERNET 768
+// the deepest service, snprintf of one log line
+#define TASK_STACK_SERVICE 384
+// LOG calls and the card driver, the chunks are static
+#define TASK_STACK_SD_LOGGER 256
+// the param request path and LOG calls, the buffers are static
+#define TASK_STACK_USB_DEBUG 384
+// the flash commands and LOG calls, the page is static
+#define TASK_STACK_FIRMWARE_UPDATE 256
+// udp_sendto down the loopback interface, no LOG calls
+#define TASK_STACK_WCET_BURST 256
+// udp_sendto of a batch and CanBusSend, no LOG calls
+#define TASK_STACK_CAN_GATEWAY 256
+
+#define configTIMER_TASK_PRIORITY TASK_PRIORITY_TIMER
+#define configTIMER_TASK_STACK_DEPTH TASK_STACK_TIMER
+// commands from the housekeeping timers starting, and changing period, in
+// one burst at boot
+#define configTIMER_QUEUE_LENGTH 8
+#define TCPIP_THREAD_PRIO TASK_PRIORITY_TCPIP
+#define TCPIP_THREAD_STACKSIZE TASK_STACK_TCPIP
+
+#endif // TASK_CONFIG_H
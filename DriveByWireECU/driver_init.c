@@ -13,6 +13,10 @@
 
 #include <hpl_adc_base.h>
 
+#include "BootProfile.h"
+#include "Peripherals.h"
+#include "AdcSampler.h"
+
 struct can_async_descriptor CAN_0;
 
 struct adc_sync_descriptor ADC_0;
@@ -38,6 +42,18 @@ void ADC_0_PORT_init(void)
 	gpio_set_pin_direction(SteeringPosition, GPIO_DIRECTION_OFF);
 
 	gpio_set_pin_function(SteeringPosition, PINMUX_PB08B_ADC1_AIN0);
+
+#if ADC_SAMPLER_BRAKE_FEEDBACK
+	gpio_set_pin_direction(BrakePressure, GPIO_DIRECTION_OFF);
+
+	gpio_set_pin_function(BrakePressure, PINMUX_PB04B_ADC1_AIN6);
+#endif
+
+#if ADC_SAMPLER_SUPPLY_VOLTAGE
+	gpio_set_pin_direction(SupplyVoltage, GPIO_DIRECTION_OFF);
+
+	gpio_set_pin_function(SupplyVoltage, PINMUX_PC02B_ADC1_AIN4);
+#endif
 }
 
 void ADC_0_CLOCK_init(void)
@@ -240,6 +256,7 @@ void COMMUNICATION_IO_example(void)
 void system_init(void)
 {
 	init_mcu();
+	BootProfileMark(BOOT_STAGE_MCU);
 
 	// GPIO on PA06
 
@@ -453,21 +470,8 @@ void system_init(void)
 	                       GPIO_PULL_DOWN);
 
 	gpio_set_pin_function(WheelSpeedRight, GPIO_PIN_FUNCTION_OFF);
+	BootProfileMark(BOOT_STAGE_PINS);
 
-	ADC_0_init();
-
-	TARGET_IO_init();
-
-	PWM_0_init();
-
-	PWM_1_init();
-
-	PWM_4_init();
-
-	PWM_2_init();
-
-	PWM_3_init();
-	CAN_0_init();
-
-	COMMUNICATION_IO_init();
+	//the peripherals come up as their owners first use them
+	PeripheralsInit();
 }
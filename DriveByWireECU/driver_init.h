@@ -83,6 +83,9 @@ void PWM_3_PORT_init(void);
 void PWM_3_CLOCK_init(void);
 void PWM_3_init(void);
 
+void CAN_0_PORT_init(void);
+void CAN_0_init(void);
+
 void COMMUNICATION_IO_CLOCK_init(void);
 void COMMUNICATION_IO_init(void);
 void COMMUNICATION_IO_PORT_init(void);
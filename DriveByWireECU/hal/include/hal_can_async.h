@@ -131,6 +131,30 @@ int32_t can_async_disable(struct can_async_descriptor *const descr);
  */
 int32_t can_async_read(struct can_async_descriptor *const descr, struct can_message *msg);
 
+/**
+ * \brief Read a CAN message from one RX FIFO
+ *
+ * \param[in] descr The CAN descriptor to read message.
+ * \param[in] fifo  RX FIFO to read, 0 or 1
+ * \param[in] msg   The CAN message to read to.
+ *
+ * \return ERR_NOT_FOUND if the FIFO is empty, otherwise the status of read message.
+ */
+int32_t can_async_read_fifo(struct can_async_descriptor *const descr, uint8_t fifo, struct can_message *msg);
+
+/**
+ * \brief Read the oldest entry of the Tx event FIFO
+ *
+ * Every message written is logged there once it has been sent, with the
+ * Tx FIFO element it came from and its timestamp.
+ *
+ * \param[in] descr The CAN descriptor to read the event from.
+ * \param[in] event The Tx event to read to.
+ *
+ * \return ERR_NOT_FOUND if the FIFO is empty, otherwise the status of read event.
+ */
+int32_t can_async_read_tx_event(struct can_async_descriptor *const descr, struct can_tx_event *event);
+
 /**
  * \brief Write a CAN message
  *
@@ -203,6 +227,22 @@ int32_t can_async_set_mode(struct can_async_descriptor *const descr, enum can_mo
 int32_t can_async_set_filter(struct can_async_descriptor *const descr, uint8_t index, enum can_format fmt,
                              struct can_filter *filter);
 
+/**
+ * \brief Set CAN Filter storing matching messages in a given RX FIFO
+ *
+ * can_async_set_filter() always stores in RX FIFO 0.
+ *
+ * \param[in] descr The CAN descriptor pointer
+ * \param[in] index   Index of Filter list
+ * \param[in] fmt     CAN Indentify Type
+ * \param[in] filter  CAN Filter struct, NULL for clear filter
+ * \param[in] fifo    RX FIFO for matching messages, 0 or 1
+ *
+ * \return Status of the operation.
+ */
+int32_t can_async_set_filter_fifo(struct can_async_descriptor *const descr, uint8_t index, enum can_format fmt,
+                                  struct can_filter *filter, uint8_t fifo);
+
 /**
  * \brief Retrieve the current driver version
  *
@@ -136,6 +136,32 @@ int32_t mac_async_disable(struct mac_async_descriptor *const descr);
  */
 int32_t mac_async_write(struct mac_async_descriptor *const descr, uint8_t *buf, uint32_t len);
 
+/**
+ * \brief Queue a frame made of several segments for transmission
+ *
+ * Scatter gather transmit only. Segments that are not marked for copying are
+ * sent in place and must stay untouched until mac_async_tx_reclaim has
+ * reported the frame as sent.
+ *
+ * \param[in] descr Pointer to the HAL MAC descriptor.
+ * \param[in] segs  Segments of the frame, in order.
+ * \param[in] count Number of segments.
+ *
+ * \return ERR_NONE, or ERR_NO_RESOURCE if the frame does not fit in the free
+ *         transmit descriptors.
+ */
+int32_t mac_async_write_sg(struct mac_async_descriptor *const descr, const struct mac_async_tx_segment *segs,
+                           uint32_t count);
+
+/**
+ * \brief Release the descriptors of frames that have been sent
+ *
+ * \param[in] descr Pointer to the HAL MAC descriptor.
+ *
+ * \return Number of frames sent since the previous call, in queued order.
+ */
+uint32_t mac_async_tx_reclaim(struct mac_async_descriptor *const descr);
+
 /**
  * \brief Read raw data from MAC
  *
@@ -164,6 +190,46 @@ uint32_t mac_async_read(struct mac_async_descriptor *const descr, uint8_t *buf,
  */
 uint32_t mac_async_read_len(struct mac_async_descriptor *const descr);
 
+/**
+ * \brief Hand a receive buffer to the MAC
+ *
+ * Zero copy receive only. The buffer must be word aligned and hold
+ * CONF_GMAC_RXBUF_SIZE bytes, it belongs to the MAC until it comes back from
+ * mac_async_rx_take.
+ *
+ * \param[in] descr Pointer to the HAL MAC descriptor.
+ * \param[in] buf   Pointer to the receive buffer.
+ *
+ * \return Index of the descriptor the buffer was attached to, or -1 if every
+ *         descriptor already has a buffer.
+ */
+int32_t mac_async_rx_give(struct mac_async_descriptor *const descr, uint8_t *buf);
+
+/**
+ * \brief Take the next received frame from the MAC
+ *
+ * Zero copy receive only. Detaches the buffers holding the oldest received
+ * frame, the ones given to count descriptors from the returned index on in
+ * ring order. Only the first starts with the receive offset, all but the
+ * last are full.
+ *
+ * \param[in]  descr Pointer to the HAL MAC descriptor.
+ * \param[out] len   Length of the frame, 0 if the frame was bad and the
+ *                   buffers only have to be given back.
+ * \param[out] count Number of buffers the frame took.
+ *
+ * \return Index of the first descriptor, or -1 if no whole frame is waiting.
+ */
+int32_t mac_async_rx_take(struct mac_async_descriptor *const descr, uint32_t *len, uint32_t *count);
+
+/**
+ * \brief Read the occupancy and overrun counters of the descriptor rings
+ *
+ * \param[in]  descr Pointer to the HAL MAC descriptor.
+ * \param[out] stats The statistics.
+ */
+void mac_async_get_ring_stats(struct mac_async_descriptor *const descr, struct mac_async_ring_stats *stats);
+
 /**
  * \brief Enable the MAC IRQ
  *
@@ -220,6 +286,21 @@ int32_t mac_async_set_filter(struct mac_async_descriptor *const descr, uint8_t i
  */
 int32_t mac_async_set_filter_ex(struct mac_async_descriptor *const descr, uint8_t mac[6]);
 
+/**
+ * \brief Write the whole hash filter
+ *
+ * Replaces the 64 bit hash filter set up by mac_async_set_filter_ex, so
+ * addresses can be removed again. Bit n accepts the addresses whose 6 bit
+ * hash is n.
+ *
+ * \param[in] descr Pointer to the HAL MAC descriptor
+ * \param[in] hash  New value of the hash filter
+ *
+ * \return Operation status.
+ * \retval ERR_NONE Success.
+ */
+int32_t mac_async_write_hash(struct mac_async_descriptor *const descr, uint64_t hash);
+
 /**
  * \brief Write PHY register
  *
@@ -96,6 +96,18 @@ struct can_message {
 	uint8_t *       data; /* Pointer to Message Data */
 	uint8_t         len;  /* Message Length */
 	enum can_format fmt;  /* Identifier format, CAN_STD, CAN_EXT */
+	uint16_t        timestamp; /* Rx timestamp counter at the start of frame, received messages only */
+};
+
+/**
+ * \brief CAN Tx event, a message that has been sent
+ */
+struct can_tx_event {
+	uint32_t        id;        /* Message identifier */
+	enum can_format fmt;       /* Identifier format, CAN_STD, CAN_EXT */
+	uint8_t         len;       /* Length the DLC stands for */
+	uint8_t         marker;    /* Tx FIFO element the message was sent from */
+	uint16_t        timestamp; /* Tx timestamp counter at the start of frame */
 };
 
 /**
@@ -168,6 +168,27 @@ int32_t _can_async_disable(struct _can_async_device *const dev);
  */
 int32_t _can_async_read(struct _can_async_device *const dev, struct can_message *msg);
 
+/**
+ * \brief Read a CAN message from one RX FIFO
+ *
+ * \param[in] dev   The CAN device descriptor pointer
+ * \param[in] fifo  RX FIFO to read, 0 or 1
+ * \param[in] msg   The CAN message to read to.
+ *
+ * \return ERR_NOT_FOUND if the FIFO is empty, otherwise the status of the operation
+ */
+int32_t _can_async_read_fifo(struct _can_async_device *const dev, uint8_t fifo, struct can_message *msg);
+
+/**
+ * \brief Read the oldest entry of the Tx event FIFO
+ *
+ * \param[in] dev   The CAN device descriptor pointer
+ * \param[in] event The Tx event to read to.
+ *
+ * \return ERR_NOT_FOUND if the FIFO is empty, otherwise the status of the operation
+ */
+int32_t _can_async_read_tx_event(struct _can_async_device *const dev, struct can_tx_event *event);
+
 /**
  * \brief Write a CAN message
  *
@@ -236,6 +257,19 @@ int32_t _can_async_set_mode(struct _can_async_device *const dev, enum can_mode m
 int32_t _can_async_set_filter(struct _can_async_device *const dev, uint8_t index, enum can_format fmt,
                               struct can_filter *filter);
 
+/**
+ * \brief Set CAN filter storing matching messages in a given RX FIFO
+ *
+ * \param[in] dev The CAN device descriptor pointer
+ * \param[in] index   Index of Filter list
+ * \param[in] filter  CAN Filter struct, NULL for clear filter
+ * \param[in] fifo    RX FIFO for matching messages, 0 or 1
+ *
+ * \return Status of the operation
+ */
+int32_t _can_async_set_filter_fifo(struct _can_async_device *const dev, uint8_t index, enum can_format fmt,
+                                   struct can_filter *filter, uint8_t fifo);
+
 /**@}*/
 
 #ifdef __cplusplus
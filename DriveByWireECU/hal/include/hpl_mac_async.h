@@ -89,6 +89,42 @@ struct mac_async_filter {
 	uint8_t tid[2];     /*!< Type ID, 0x0600 IP package */
 	bool    tid_enable; /*!< Enable TID matching */
 };
+
+/**
+ * \brief One piece of a frame queued for scatter gather transmit
+ */
+struct mac_async_tx_segment {
+	uint8_t *buf;  /*!< Segment data */
+	uint32_t len;  /*!< Segment length in bytes */
+	bool     copy; /*!< Copy the data into the driver's buffers instead of
+	                    sending it in place, for data the caller may change
+	                    before the frame has gone out */
+};
+
+/**
+ * \brief Occupancy and overrun counters of the descriptor rings
+ *
+ * The counts run from initialization on, the minimum and maximum are the
+ * extremes seen so far.
+ */
+struct mac_async_ring_stats {
+	uint32_t rx_descriptors; /*!< Receive descriptors in the ring */
+	uint32_t rx_filled_min;  /*!< Fewest descriptors holding a buffer when a
+	                              frame was taken, zero copy receive only */
+	uint32_t rx_frames;      /*!< Frames taken off the ring, zero copy only */
+	uint32_t rx_chained;     /*!< Of those, frames that took several buffers */
+	uint32_t rx_broken;      /*!< Of those, frames that did not arrive whole */
+	uint32_t rx_overruns;    /*!< Frames lost to a full receive FIFO */
+	uint32_t rx_no_buffer;   /*!< Frames lost with no buffer to receive into */
+	uint32_t rx_stalls;      /*!< Times the receive DMA found no buffer or
+	                              overran its FIFO */
+	uint32_t rx_resyncs;     /*!< Times the ring was found behind the DMA and
+	                              skipped ahead to it */
+	uint32_t tx_descriptors; /*!< Transmit descriptors in the ring */
+	uint32_t tx_queued_max;  /*!< Most descriptors queued at once, scatter
+	                              gather transmit only */
+	uint32_t tx_full;        /*!< Frames refused because the ring was full */
+};
 /**
  * \brief Initialize the MAC driver
  *
@@ -152,6 +188,35 @@ int32_t _mac_async_disable(struct _mac_async_device *const dev);
  */
 int32_t _mac_async_write(struct _mac_async_device *const dev, uint8_t *buf, uint32_t len);
 
+/**
+ * \brief Queue a frame made of several segments for transmission
+ *
+ * Each segment is sent through its own transmit descriptor, directly from
+ * its buffer unless it is marked for copying. Segments that are not copied
+ * must stay untouched until _mac_async_tx_reclaim has reported the frame as
+ * sent. Only available in scatter gather transmit mode.
+ *
+ * \param[in] dev   Pointer to the HPL MAC device descriptor
+ * \param[in] segs  Segments of the frame, in order
+ * \param[in] count Number of segments
+ *
+ * \return ERR_NONE, or ERR_NO_RESOURCE if there are not enough free
+ *         transmit descriptors for the whole frame
+ */
+int32_t _mac_async_write_sg(struct _mac_async_device *const dev, const struct mac_async_tx_segment *segs,
+                            uint32_t count);
+
+/**
+ * \brief Release the descriptors of frames that have been sent
+ *
+ * Frames complete in the order they were queued.
+ *
+ * \param[in] dev Pointer to the HPL MAC device descriptor
+ *
+ * \return Number of frames sent since the previous call
+ */
+uint32_t _mac_async_tx_reclaim(struct _mac_async_device *const dev);
+
 /**
  * \brief Read received raw data from MAC
  *
@@ -180,6 +245,58 @@ uint32_t _mac_async_read(struct _mac_async_device *const dev, uint8_t *buf, uint
  */
 uint32_t _mac_async_read_len(struct _mac_async_device *const dev);
 
+/**
+ * \brief Hand a receive buffer to the MAC
+ *
+ * Attaches the buffer to the next receive descriptor that has none. Only
+ * available in zero copy receive mode. The buffer must be word aligned and
+ * hold CONF_GMAC_RXBUF_SIZE bytes, it belongs to the MAC until it comes back
+ * from _mac_async_rx_take.
+ *
+ * \param[in] dev Pointer to the HPL MAC device descriptor
+ * \param[in] buf Pointer to the receive buffer
+ *
+ * \return Index of the descriptor the buffer was attached to, or -1 if every
+ *         descriptor already has a buffer
+ */
+int32_t _mac_async_rx_give(struct _mac_async_device *const dev, uint8_t *buf);
+
+/**
+ * \brief Take the next received frame from the MAC
+ *
+ * Detaches the buffers holding the oldest received frame from their
+ * descriptors. Only available in zero copy receive mode. A frame longer than
+ * a buffer continues in the buffers of the descriptors that follow, all of
+ * them full but the last; the first starts with CONF_GMAC_NCFGR_RXBUFO bytes
+ * of padding.
+ *
+ * After the DMA stopped on a descriptor without a buffer or overran its FIFO,
+ * a ring whose oldest descriptor is still empty while a later one holds the
+ * start of a frame has fallen behind the DMA. The descriptors in between are
+ * then taken back from it and returned as a bad frame, and the ring goes on
+ * from that frame.
+ *
+ * \param[in]  dev   Pointer to the HPL MAC device descriptor
+ * \param[out] len   Length of the frame, 0 if the frame was bad and the
+ *                   buffers only have to be given back
+ * \param[out] count Number of buffers the frame took
+ *
+ * \return Index of the descriptor the first buffer was given to, the others
+ *         follow in ring order, or -1 if no whole frame is waiting
+ */
+int32_t _mac_async_rx_take(struct _mac_async_device *const dev, uint32_t *len, uint32_t *count);
+
+/**
+ * \brief Read the ring statistics
+ *
+ * Also collects the GMAC's overrun and resource error counters, which clear
+ * when read. Call from one task only.
+ *
+ * \param[in]  dev   Pointer to the HPL MAC device descriptor
+ * \param[out] stats The statistics
+ */
+void _mac_async_get_ring_stats(struct _mac_async_device *const dev, struct mac_async_ring_stats *stats);
+
 /**
  * \brief Enable the MAC IRQ
  *
@@ -241,6 +358,20 @@ int32_t _mac_async_set_filter(struct _mac_async_device *const dev, uint8_t index
  */
 int32_t _mac_async_set_filter_ex(struct _mac_async_device *const dev, uint8_t mac[6]);
 
+/**
+ * \brief Write the whole hash filter
+ *
+ * Replaces the 64 bit hash filter, bit n accepts the addresses whose 6 bit
+ * hash is n.
+ *
+ * \param[in] dev  Pointer to the HPL MAC device descriptor
+ * \param[in] hash New value of the hash filter
+ *
+ * \return Operation status.
+ * \retval ERR_NONE Success.
+ */
+int32_t _mac_async_write_hash(struct _mac_async_device *const dev, uint64_t hash);
+
 /**
  * \brief Write PHY register
  *
@@ -111,6 +111,24 @@ int32_t can_async_read(struct can_async_descriptor *const descr, struct can_mess
 	return _can_async_read(&descr->dev, msg);
 }
 
+/**
+ * \brief Read a CAN message from one RX FIFO
+ */
+int32_t can_async_read_fifo(struct can_async_descriptor *const descr, uint8_t fifo, struct can_message *msg)
+{
+	ASSERT(descr && msg && fifo <= 1);
+	return _can_async_read_fifo(&descr->dev, fifo, msg);
+}
+
+/**
+ * \brief Read the oldest entry of the Tx event FIFO
+ */
+int32_t can_async_read_tx_event(struct can_async_descriptor *const descr, struct can_tx_event *event)
+{
+	ASSERT(descr && event);
+	return _can_async_read_tx_event(&descr->dev, event);
+}
+
 /**
  * \brief Write a CAN message
  */
@@ -185,6 +203,16 @@ int32_t can_async_set_filter(struct can_async_descriptor *const descr, uint8_t i
 	return _can_async_set_filter(&descr->dev, index, fmt, filter);
 }
 
+/**
+ * \brief Set CAN Filter storing matching messages in a given RX FIFO
+ */
+int32_t can_async_set_filter_fifo(struct can_async_descriptor *const descr, uint8_t index, enum can_format fmt,
+                                  struct can_filter *filter, uint8_t fifo)
+{
+	ASSERT(descr && fifo <= 1);
+	return _can_async_set_filter_fifo(&descr->dev, index, fmt, filter, fifo);
+}
+
 /**
  * \brief Retrieve the current driver version
  */
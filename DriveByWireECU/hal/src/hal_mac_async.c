@@ -89,6 +89,27 @@ int32_t mac_async_write(struct mac_async_descriptor *const descr, uint8_t *buf,
 	return _mac_async_write(&descr->dev, buf, len);
 }
 
+/**
+ * \brief Queue a frame made of several segments for transmission
+ */
+int32_t mac_async_write_sg(struct mac_async_descriptor *const descr, const struct mac_async_tx_segment *segs,
+                           uint32_t count)
+{
+	ASSERT(descr && segs && count);
+
+	return _mac_async_write_sg(&descr->dev, segs, count);
+}
+
+/**
+ * \brief Release the descriptors of frames that have been sent
+ */
+uint32_t mac_async_tx_reclaim(struct mac_async_descriptor *const descr)
+{
+	ASSERT(descr);
+
+	return _mac_async_tx_reclaim(&descr->dev);
+}
+
 /**
  * \brief Read raw data from MAC
  */
@@ -108,6 +129,36 @@ uint32_t mac_async_read_len(struct mac_async_descriptor *const descr)
 
 	return _mac_async_read_len(&descr->dev);
 }
+
+/**
+ * \brief Hand a receive buffer to the MAC
+ */
+int32_t mac_async_rx_give(struct mac_async_descriptor *const descr, uint8_t *buf)
+{
+	ASSERT(descr && buf);
+
+	return _mac_async_rx_give(&descr->dev, buf);
+}
+
+/**
+ * \brief Take the next received frame from the MAC
+ */
+int32_t mac_async_rx_take(struct mac_async_descriptor *const descr, uint32_t *len, uint32_t *count)
+{
+	ASSERT(descr && len && count);
+
+	return _mac_async_rx_take(&descr->dev, len, count);
+}
+
+/**
+ * \brief Read the occupancy and overrun counters of the descriptor rings
+ */
+void mac_async_get_ring_stats(struct mac_async_descriptor *const descr, struct mac_async_ring_stats *stats)
+{
+	ASSERT(descr && stats);
+
+	_mac_async_get_ring_stats(&descr->dev, stats);
+}
 /**
  * \brief Enable the MAC IRQ
  */
@@ -167,6 +218,16 @@ int32_t mac_async_set_filter_ex(struct mac_async_descriptor *const descr, uint8_
 	return _mac_async_set_filter_ex(&descr->dev, mac);
 }
 
+/**
+ * \brief Write the whole hash filter
+ */
+int32_t mac_async_write_hash(struct mac_async_descriptor *const descr, uint64_t hash)
+{
+	ASSERT(descr);
+
+	return _mac_async_write_hash(&descr->dev, hash);
+}
+
 /**
  * \brief Write PHY register
  */
@@ -0,0 +1,312 @@
+/*
+ * ControlReplay.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ControlCore.h"
+#include "ControlRecord.h"
+#include "DeltaCodec.h"
+#include "DriveByWireIO.h"
+#include "FlatLog.h"
+#include "HostIO.h"
+#include "SdLogger.h"
+
+//Runs the SD log of a CONTROL_RECORD_ENABLE build (ControlRecord.h) through
+//the control core again and diffs every cycle's outputs with the recorded
+//ones, bit for bit. Each session on the card is replayed from
+//ControlCoreInit on, record by record: the recorded inputs go into
+//host_io, a recorded command or parameter set into the control exchange
+//the way ethernet_thread publishes them, then one ControlCoreStep at the
+//recorded cycle and time. A session whose log does not start at the first
+//cycle, or that dropped records, can only be replayed up to there. The
+//log ends at the first chunk that is not a valid flat log block
+//(FlatLog.h), a chunk cut short by a reset included.
+//
+//Build with the DEFINES the firmware was built with. One line per session
+//goes to stdout, the first -n mismatching cycles to stderr, and the exit
+//status is 1 if any cycle did not match.
+//
+//usage: ControlReplay image [-s session] [-n mismatches] [-b first block]
+
+#define REPLAY_BLOCK_SIZE 512
+#define REPLAY_DEFAULT_REPORTS 10
+
+//the words of control_record_t from acceleration on
+#define REPLAY_OUTPUT_FIRST (offsetof(control_record_t, acceleration) / 4)
+#define REPLAY_OUTPUT_WORDS (CONTROL_RECORD_WORDS - REPLAY_OUTPUT_FIRST)
+
+static const char* const replay_output_names[REPLAY_OUTPUT_WORDS] =
+{
+	"acceleration", "front_brake", "steering_torque", "steering_rate", "mode and flags"
+};
+
+typedef struct replay_config_t
+{
+	const char* image;
+	//0 for every session
+	uint32_t session;
+	uint32_t reports;
+	uint32_t first_block;
+} replay_config_t;
+
+typedef struct replay_session_t
+{
+	uint32_t session;
+	uint32_t cycles;
+	uint32_t mismatches;
+	uint32_t trajectories;
+	//the next record has to be this cycle, 0 once the replay stopped
+	uint32_t next_cycle;
+	uint32_t stopped_at;
+} replay_session_t;
+
+static main_context_t ctx;
+static uint32_t reported;
+
+static void Usage()
+{
+	fprintf(stderr, "usage: ControlReplay image [-s session] [-n mismatches] [-b first block]\n");
+	exit(2);
+}
+
+//What ethernet_thread would have published for the recorded command
+static void PublishRecordedCommand(const control_record_t* record)
+{
+	uint8_t priority = (uint8_t)record->command_flags;
+	control_command_t* command = BeginCommandWrite(&ctx.exchange, priority);
+	memset(command, 0, sizeof(*command));
+	command->rx_time = record->command_rx_time;
+	command->lease_end = record->command_lease_end;
+	command->sent_time = record->command_sent_time;
+	command->priority = priority;
+	command->vehicle_speed_commanded = record->command_vehicle_speed;
+	command->steering_angle_commanded = record->command_steering_angle;
+	command->park_brake_commanded = (record->command_flags & CONTROL_RECORD_COMMAND_PARK_BRAKE) != 0;
+	command->reverse_commanded = (record->command_flags & CONTROL_RECORD_COMMAND_REVERSE) != 0;
+	command->autonomous_mode = (record->command_flags & CONTROL_RECORD_COMMAND_AUTONOMOUS) != 0;
+	command->tele_operation_enabled = (record->command_flags & CONTROL_RECORD_COMMAND_TELE_OPERATION) != 0;
+	PublishCommand(&ctx.exchange, priority);
+}
+
+//Only the values ApplyNewParams reads are in the record
+static void PublishRecordedParams(const control_record_t* record)
+{
+	param_set_t* params = BeginParamsWrite(&ctx.exchange);
+	memset(params, 0, sizeof(*params));
+	params->values[PARAM_OVERRIDE_PID].u = (record->flags & CONTROL_RECORD_OVERRIDE_PID) != 0;
+	params->values[PARAM_SPEED_P_GAIN].f = record->speed_p_gain;
+	params->values[PARAM_SPEED_I_GAIN].f = record->speed_i_gain;
+	params->values[PARAM_SPEED_D_GAIN].f = record->speed_d_gain;
+	params->values[PARAM_STEER_P_GAIN].f = record->steer_p_gain;
+	params->values[PARAM_STEER_I_GAIN].f = record->steer_i_gain;
+	params->values[PARAM_STEER_D_GAIN].f = record->steer_d_gain;
+	PublishParams(&ctx.exchange);
+}
+
+static void Report(const replay_session_t* session, const uint32_t* replayed, const uint32_t* recorded)
+{
+	fprintf(stderr, "session %u cycle %u:", session->session, session->next_cycle);
+	for(uint32_t i = 0; i < REPLAY_OUTPUT_WORDS; ++i)
+	{
+		if( replayed[i] == recorded[i] )
+			continue;
+		if( i == REPLAY_OUTPUT_WORDS - 1 )
+			fprintf(stderr, " %s 0x%x recorded 0x%x", replay_output_names[i], replayed[i], recorded[i]);
+		else
+		{
+			float a, b;
+			memcpy(&a, &replayed[i], sizeof(a));
+			memcpy(&b, &recorded[i], sizeof(b));
+			fprintf(stderr, " %s %.9g recorded %.9g", replay_output_names[i], a, b);
+		}
+	}
+	fprintf(stderr, "\n");
+}
+
+static void ReplayRecord(const replay_config_t* config, replay_session_t* session, const control_record_t* record)
+{
+	if( session->next_cycle == 0 )
+		return;
+	if( record->cycle != session->next_cycle )
+	{
+		session->stopped_at = session->next_cycle;
+		session->next_cycle = 0;
+		return;
+	}
+
+	host_io.input_time = record->input_time;
+	host_io.sample_time = record->sample_time;
+	host_io.estop = (record->flags & CONTROL_RECORD_ESTOP) != 0;
+	host_io.estop_time = record->estop_time;
+	host_io.reverse = (record->flags & CONTROL_RECORD_REVERSE) != 0;
+	host_io.steering_angle = record->steering_angle;
+	host_io.vehicle_speed = record->vehicle_speed;
+	host_io.brake_pressure = record->brake_pressure;
+	host_io.imu_stale = !(record->flags & CONTROL_RECORD_IMU_VALID);
+	host_io.yaw_rate = record->yaw_rate;
+	host_io.longitudinal_accel = record->longitudinal_accel;
+	host_io.lateral_accel = record->lateral_accel;
+	host_io.wheel_speed_rx_tick = record->wheel_speed_rx_tick;
+	host_io.eps_rx_tick = record->eps_rx_tick;
+	if( record->flags & CONTROL_RECORD_PARAMS )
+		PublishRecordedParams(record);
+	if( record->flags & CONTROL_RECORD_COMMAND )
+		PublishRecordedCommand(record);
+	if( record->flags & CONTROL_RECORD_TRAJECTORY )
+		session->trajectories++;
+
+	ctx.scheduler.cycle_count = record->cycle;
+	ControlCoreStep(&ctx, record->now);
+	ControlRecordCycle(&ctx);
+
+	const uint32_t* replayed = (const uint32_t*)&ctx.record + REPLAY_OUTPUT_FIRST;
+	const uint32_t* recorded = (const uint32_t*)record + REPLAY_OUTPUT_FIRST;
+	if( memcmp(replayed, recorded, REPLAY_OUTPUT_WORDS * 4) != 0 )
+	{
+		if( reported++ < config->reports )
+			Report(session, replayed, recorded);
+		session->mismatches++;
+	}
+	session->cycles++;
+	session->next_cycle++;
+}
+
+static void StartSession(replay_session_t* session, uint32_t number)
+{
+	memset(session, 0, sizeof(*session));
+	session->session = number;
+	//main_task's first cycle
+	session->next_cycle = 1;
+	InitializeDriveByWireIO();
+	ControlCoreInit(&ctx);
+}
+
+//0 if the session was replayed to its end without a mismatch
+static int EndSession(const replay_session_t* session)
+{
+	printf("session %u: %u cycles replayed, %u mismatched", session->session, session->cycles, session->mismatches);
+	if( session->cycles == 0 )
+		printf(", does not start at the first cycle");
+	else if( session->stopped_at )
+		printf(", stopped at cycle %u where records were dropped", session->stopped_at);
+	if( session->trajectories )
+		printf(", %u trajectory commands not recorded", session->trajectories);
+	printf("\n");
+	return session->mismatches != 0;
+}
+
+int main(int argc, char** argv)
+{
+	replay_config_t config = { NULL, 0, REPLAY_DEFAULT_REPORTS, SD_LOGGER_FIRST_BLOCK };
+
+	int opt;
+	while( (opt = getopt(argc, argv, "s:n:b:")) != -1 )
+	{
+		switch( opt )
+		{
+		case 's':
+			config.session = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			config.reports = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			config.first_block = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			Usage();
+		}
+	}
+	if( optind != argc - 1 )
+		Usage();
+	config.image = argv[optind];
+
+	FILE* image = fopen(config.image, "rb");
+	if( image == NULL || fseeko(image, (off_t)config.first_block * REPLAY_BLOCK_SIZE, SEEK_SET) != 0 )
+	{
+		perror(config.image);
+		return 2;
+	}
+
+	//the first chunk says how long every chunk is
+	flat_log_block_t first;
+	uint32_t chunk_size = 0;
+	if( fread(&first, 1, sizeof(first), image) == sizeof(first) && first.block_size >= FLAT_LOG_MIN_BLOCK
+		&& (first.block_size & (first.block_size - 1)) == 0 && FlatLogHeaderValid(&first, first.block_size, 0) )
+		chunk_size = first.block_size;
+	if( chunk_size == 0 || fseeko(image, (off_t)config.first_block * REPLAY_BLOCK_SIZE, SEEK_SET) != 0 )
+	{
+		fprintf(stderr, "%s: no flat log at block %u\n", config.image, config.first_block);
+		fclose(image);
+		return 2;
+	}
+
+	flat_log_block_t* chunk = malloc(chunk_size);
+	replay_session_t session;
+	uint8_t in_session = 0;
+	int failed = 0;
+	uint32_t sessions = 0;
+	uint32_t skipped = 0;
+	for(uint32_t index = 0; fread(chunk, 1, chunk_size, image) == chunk_size; ++index)
+	{
+		if( !FlatLogBlockValid(chunk, chunk_size, index) )
+			break;
+		if( (config.session && chunk->session != config.session) || chunk->schema != FLAT_LOG_SCHEMA_CONTROL_RECORD
+			|| (chunk->record_size != 0 && chunk->record_size != sizeof(control_record_t)) )
+		{
+			skipped++;
+			continue;
+		}
+		if( !in_session || chunk->session != session.session )
+		{
+			if( in_session )
+				failed |= EndSession(&session);
+			StartSession(&session, chunk->session);
+			in_session = 1;
+			sessions++;
+		}
+
+		const uint8_t* data = (const uint8_t*)chunk + chunk->header_size;
+		uint32_t size = chunk->bytes;
+		delta_codec_t codec;
+		DeltaCodecReset(&codec, CONTROL_RECORD_WORDS);
+		control_record_t record;
+		for(uint32_t i = 0; i < chunk->count; ++i)
+		{
+			if( chunk->record_size == 0 )
+			{
+				uint16_t used = DeltaCodecDecode(&codec, data, (uint16_t)size, (uint32_t*)&record);
+				if( used == 0 )
+					break;
+				data += used;
+				size -= used;
+			}
+			else
+			{
+				if( size < sizeof(record) )
+					break;
+				memcpy(&record, data, sizeof(record));
+				data += sizeof(record);
+				size -= sizeof(record);
+			}
+			ReplayRecord(&config, &session, &record);
+		}
+	}
+	if( in_session )
+		failed |= EndSession(&session);
+	fclose(image);
+	free(chunk);
+
+	if( sessions == 0 )
+	{
+		fprintf(stderr, "%s: no replay chunks, %u other chunks\n", config.image, skipped);
+		return 2;
+	}
+	return failed;
+}
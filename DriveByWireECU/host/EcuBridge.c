@@ -0,0 +1,558 @@
+/*
+ * EcuBridge.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "EcuBridge.h"
+
+//Frame layout, as ControlProtocol.h's
+#define BRIDGE_HEADER_SIZE 12
+#define BRIDGE_CRC_SIZE 4
+#define BRIDGE_FRAME_COMMAND 1
+#define BRIDGE_FRAME_TELEMETRY 2
+#define BRIDGE_FRAME_SUBSCRIBE 3
+#define BRIDGE_FRAME_TELEMETRY_BATCH 16
+#define BRIDGE_COMMAND_PAYLOAD_SIZE 9
+#define BRIDGE_SUBSCRIBE_PAYLOAD_SIZE 11
+#define BRIDGE_TELEMETRY_FIELD_COUNT 15
+#define BRIDGE_BATCH_SAMPLE_SIZE 43
+//the largest frame the ECU sends on the command port, a full batch
+#define BRIDGE_MAX_FRAME_SIZE (BRIDGE_HEADER_SIZE + 9 + ECU_BRIDGE_BATCH_MAX_SAMPLES * BRIDGE_BATCH_SAMPLE_SIZE + BRIDGE_CRC_SIZE)
+
+//ms between subscribes, well inside CONTROL_SUBSCRIPTION_LEASE
+#define BRIDGE_SUBSCRIBE_PERIOD 1000
+
+//Send times of the last commands, by sequence, for the round trip. A
+//status echo comes back within a few status periods, far fewer commands.
+#define BRIDGE_SENT_HISTORY 256
+
+//SCHED_FIFO priorities, above the middleware's own threads
+#define BRIDGE_COMMAND_PRIORITY 80
+#define BRIDGE_TELEMETRY_PRIORITY 70
+
+//ms the telemetry thread waits in recvmsg before it looks at running again
+#define BRIDGE_RECEIVE_TIMEOUT 100
+
+static const uint8_t telemetry_field_size[BRIDGE_TELEMETRY_FIELD_COUNT] =
+{
+	4, 4, 2, 2, 1,
+	4, 4, 4, 4, 4, 4,
+	4, 4,
+	4, 2,
+};
+
+typedef struct bridge_sent_t
+{
+	uint32_t sequence;
+	uint64_t time;
+} bridge_sent_t;
+
+struct ecu_bridge_t
+{
+	ecu_bridge_config_t config;
+	ecu_bridge_callbacks_t callbacks;
+	int socket;
+	struct sockaddr_in ecu;
+	pthread_t command_thread;
+	pthread_t telemetry_thread;
+	volatile int running;
+
+	//guards everything below, held for copies only
+	pthread_mutex_t lock;
+	ecu_bridge_command_t command;
+	//CLOCK_MONOTONIC ns of EcuBridgeSetCommand, 0 before the first
+	uint64_t command_set;
+	//not sent yet since it was set
+	uint8_t command_fresh;
+	bridge_sent_t sent[BRIDGE_SENT_HISTORY];
+	ecu_bridge_stats_t stats;
+
+	//command thread only
+	uint32_t tx_sequence;
+
+	//telemetry thread only
+	ecu_bridge_status_t last;
+	uint32_t last_echo;
+};
+
+static inline uint16_t GetLE16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t GetLE32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void PutLE16(uint8_t* p, uint16_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+}
+
+static inline void PutLE32(uint8_t* p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+//Reflected CRC-32, polynomial 0xEDB88320, a byte at a time
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void BuildCRCTable()
+{
+	for(uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t crc = i;
+		for(int bit = 0; bit < 8; ++bit)
+			crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+		crc_table[i] = crc;
+	}
+}
+
+static uint32_t CRC32(const uint8_t* data, uint32_t length)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	for(uint32_t i = 0; i < length; ++i)
+		crc = (crc >> 8) ^ crc_table[(crc ^ data[i]) & 0xFF];
+	return ~crc;
+}
+
+static uint64_t Now(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void AddLatency(ecu_bridge_latency_t* latency, uint64_t ns)
+{
+	latency->count++;
+	latency->total += ns;
+	if( ns > latency->max )
+		latency->max = ns;
+}
+
+//Header and CRC around the payload already in place, returns the length
+static uint32_t FinishFrame(uint8_t* frame, uint8_t type, uint16_t payload_length, uint32_t sequence, uint32_t timestamp)
+{
+	frame[0] = ECU_BRIDGE_PROTOCOL_VERSION;
+	frame[1] = type;
+	PutLE16(&frame[2], payload_length);
+	PutLE32(&frame[4], sequence);
+	PutLE32(&frame[8], timestamp);
+	PutLE32(&frame[BRIDGE_HEADER_SIZE + payload_length], CRC32(frame, BRIDGE_HEADER_SIZE + payload_length));
+	return BRIDGE_HEADER_SIZE + payload_length + BRIDGE_CRC_SIZE;
+}
+
+//Payload length of a frame of the given type, -1 if it is not one
+static int CheckFrame(const uint8_t* frame, uint32_t length, uint8_t type)
+{
+	if( length < BRIDGE_HEADER_SIZE + BRIDGE_CRC_SIZE || frame[0] != ECU_BRIDGE_PROTOCOL_VERSION || frame[1] != type )
+		return -1;
+
+	uint16_t payload_length = GetLE16(&frame[2]);
+	if( length != (uint32_t)BRIDGE_HEADER_SIZE + payload_length + BRIDGE_CRC_SIZE
+		|| GetLE32(&frame[BRIDGE_HEADER_SIZE + payload_length]) != CRC32(frame, BRIDGE_HEADER_SIZE + payload_length) )
+		return -1;
+	return payload_length;
+}
+
+void EcuBridgeDefaultConfig(ecu_bridge_config_t* config)
+{
+	memset(config, 0, sizeof(*config));
+	config->address = "192.168.2.100";
+	config->port = ECU_BRIDGE_PORT;
+	config->rate = 100;
+	config->hold = 100;
+	//CONTROL_COMMAND_DEFAULT_PRIORITY and _LEASE
+	config->priority = 1;
+	config->lease = 250;
+	config->status_period = 10;
+	config->pid_period = 0;
+	config->batch_samples = 0;
+}
+
+static void SendSubscribe(ecu_bridge_t* bridge, uint32_t timestamp)
+{
+	uint8_t frame[BRIDGE_HEADER_SIZE + BRIDGE_SUBSCRIBE_PAYLOAD_SIZE + BRIDGE_CRC_SIZE];
+	uint8_t* payload = &frame[BRIDGE_HEADER_SIZE];
+	//to the address and port it came from
+	PutLE32(&payload[0], 0);
+	PutLE16(&payload[4], 0);
+	PutLE16(&payload[6], bridge->config.status_period);
+	PutLE16(&payload[8], bridge->config.pid_period);
+	payload[10] = bridge->config.batch_samples;
+
+	uint32_t length = FinishFrame(frame, BRIDGE_FRAME_SUBSCRIBE, BRIDGE_SUBSCRIBE_PAYLOAD_SIZE, bridge->tx_sequence++, timestamp);
+	sendto(bridge->socket, frame, length, 0, (const struct sockaddr*)&bridge->ecu, sizeof(bridge->ecu));
+}
+
+static void SendCommand(ecu_bridge_t* bridge, const ecu_bridge_command_t* command, uint32_t timestamp)
+{
+	uint8_t frame[BRIDGE_HEADER_SIZE + BRIDGE_COMMAND_PAYLOAD_SIZE + BRIDGE_CRC_SIZE];
+	uint8_t* payload = &frame[BRIDGE_HEADER_SIZE];
+	float speed = command->speed < 0 ? 0 : command->speed > 1 ? 1 : command->speed;
+	float steering = command->steering < -1 ? -1 : command->steering > 1 ? 1 : command->steering;
+	PutLE16(&payload[0], command->flags);
+	PutLE16(&payload[2], (uint16_t)(speed * 0xFFFF + 0.5f));
+	PutLE16(&payload[4], (uint16_t)(steering * 0x7FFF + 0x7FFF + 0.5f));
+	payload[6] = bridge->config.priority;
+	PutLE16(&payload[7], bridge->config.lease);
+
+	uint32_t sequence = bridge->tx_sequence++;
+	uint32_t length = FinishFrame(frame, BRIDGE_FRAME_COMMAND, BRIDGE_COMMAND_PAYLOAD_SIZE, sequence, timestamp);
+	uint64_t sent = Now(CLOCK_MONOTONIC);
+	if( sendto(bridge->socket, frame, length, 0, (const struct sockaddr*)&bridge->ecu, sizeof(bridge->ecu)) < 0 )
+		return;
+
+	pthread_mutex_lock(&bridge->lock);
+	bridge->sent[sequence % BRIDGE_SENT_HISTORY].sequence = sequence;
+	bridge->sent[sequence % BRIDGE_SENT_HISTORY].time = sent;
+	bridge->stats.commands_sent++;
+	pthread_mutex_unlock(&bridge->lock);
+}
+
+//Sends the newest command on a fixed grid of absolute times, and the
+//subscribe every BRIDGE_SUBSCRIBE_PERIOD ms
+static void* CommandThread(void* arg)
+{
+	ecu_bridge_t* bridge = arg;
+	uint64_t period = 1000000000ull / bridge->config.rate;
+	uint64_t hold = (uint64_t)bridge->config.hold * 1000000;
+	uint8_t subscribe = bridge->config.status_period || bridge->config.pid_period || bridge->config.batch_samples;
+
+	uint64_t next = Now(CLOCK_MONOTONIC);
+	uint64_t next_subscribe = next;
+	while( bridge->running )
+	{
+		struct timespec wake = { (time_t)(next / 1000000000ull), (long)(next % 1000000000ull) };
+		while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR )
+			;
+		uint64_t now = Now(CLOCK_MONOTONIC);
+		uint32_t timestamp = (uint32_t)(now / 1000000);
+
+		if( subscribe && now >= next_subscribe )
+		{
+			SendSubscribe(bridge, timestamp);
+			next_subscribe = now + BRIDGE_SUBSCRIBE_PERIOD * 1000000ull;
+		}
+
+		pthread_mutex_lock(&bridge->lock);
+		AddLatency(&bridge->stats.send_lateness, now - next);
+		ecu_bridge_command_t command = bridge->command;
+		uint8_t live = bridge->command_set && now - bridge->command_set <= hold;
+		if( live && bridge->command_fresh )
+		{
+			AddLatency(&bridge->stats.command_age, now - bridge->command_set);
+			bridge->command_fresh = 0;
+		}
+		pthread_mutex_unlock(&bridge->lock);
+
+		if( live )
+			SendCommand(bridge, &command, timestamp);
+
+		//on the grid, skipping the slots a long stall missed
+		next += period;
+		if( next <= now )
+			next += ((now - next) / period + 1) * period;
+	}
+	return NULL;
+}
+
+static int16_t ToInt16(const uint8_t* p)
+{
+	return (int16_t)GetLE16(p);
+}
+
+static void DecodeTelemetry(ecu_bridge_t* bridge, const uint8_t* payload, uint16_t payload_length, uint64_t received)
+{
+	if( payload_length < 3 || !bridge->callbacks.loan_status )
+		return;
+
+	uint16_t mask = GetLE16(&payload[1]);
+	uint16_t length = 3;
+	for(int i = 0; i < BRIDGE_TELEMETRY_FIELD_COUNT; ++i)
+		if( mask & (1 << i) )
+			length += telemetry_field_size[i];
+	if( length > payload_length )
+	{
+		pthread_mutex_lock(&bridge->lock);
+		bridge->stats.frames_rejected++;
+		pthread_mutex_unlock(&bridge->lock);
+		return;
+	}
+
+	ecu_bridge_status_t* status = bridge->callbacks.loan_status(bridge->callbacks.arg);
+	if( !status )
+		return;
+
+	ecu_bridge_status_t* last = &bridge->last;
+	const uint8_t* p = &payload[3];
+	for(int i = 0; i < BRIDGE_TELEMETRY_FIELD_COUNT; ++i)
+	{
+		if( !(mask & (1 << i)) )
+			continue;
+
+		switch(i)
+		{
+			case 0: last->command_sequence = GetLE32(p); break;
+			case 1: last->command_timestamp = GetLE32(p); break;
+			case 2: last->speed = ToInt16(p) * 0.01f; break;
+			case 3: last->steering = ToInt16(p) * 0.1f; break;
+			case 4: last->estop = p[0] & 0x1; break;
+			case 11: last->command_ptp = GetLE32(p); break;
+			case 12: last->sample_ptp = GetLE32(p); break;
+			case 13: last->ram_corrected = GetLE32(p); break;
+			case 14: last->ram_uncorrectable = GetLE16(p); break;
+			default: last->pid[i - 5] = (int32_t)GetLE32(p); break;
+		}
+		p += telemetry_field_size[i];
+	}
+	last->fields = mask;
+	last->received = received;
+	*status = *last;
+
+	if( (mask & ECU_BRIDGE_FIELD_SEQUENCE) && last->command_sequence != bridge->last_echo )
+	{
+		bridge->last_echo = last->command_sequence;
+		pthread_mutex_lock(&bridge->lock);
+		const bridge_sent_t* sent = &bridge->sent[last->command_sequence % BRIDGE_SENT_HISTORY];
+		if( sent->sequence == last->command_sequence && sent->time && sent->time <= received )
+			AddLatency(&bridge->stats.round_trip, received - sent->time);
+		pthread_mutex_unlock(&bridge->lock);
+	}
+
+	bridge->callbacks.publish_status(bridge->callbacks.arg, status);
+}
+
+static void DecodeBatch(ecu_bridge_t* bridge, const uint8_t* payload, uint16_t payload_length, uint64_t received)
+{
+	if( payload_length < 9 || !bridge->callbacks.loan_batch )
+		return;
+
+	uint8_t count = payload[0];
+	if( count > ECU_BRIDGE_BATCH_MAX_SAMPLES || payload_length < 9 + count * BRIDGE_BATCH_SAMPLE_SIZE )
+	{
+		pthread_mutex_lock(&bridge->lock);
+		bridge->stats.frames_rejected++;
+		pthread_mutex_unlock(&bridge->lock);
+		return;
+	}
+
+	ecu_bridge_batch_t* batch = bridge->callbacks.loan_batch(bridge->callbacks.arg);
+	if( !batch )
+		return;
+
+	batch->count = count;
+	batch->first = GetLE32(&payload[1]);
+	batch->lost = GetLE32(&payload[5]);
+	batch->received = received;
+	const uint8_t* p = &payload[9];
+	for(uint8_t i = 0; i < count; ++i, p += BRIDGE_BATCH_SAMPLE_SIZE)
+	{
+		ecu_bridge_sample_t* sample = &batch->samples[i];
+		sample->sample_ptp = GetLE32(&p[0]);
+		sample->speed = ToInt16(&p[4]) * 0.01f;
+		sample->steering = ToInt16(&p[6]) * 0.1f;
+		sample->estop = p[8] & 0x1;
+		for(int f = 0; f < 6; ++f)
+			sample->pid[f] = (int32_t)GetLE32(&p[9 + f * 4]);
+		sample->x = (int32_t)GetLE32(&p[33]) * 0.001f;
+		sample->y = (int32_t)GetLE32(&p[37]) * 0.001f;
+		sample->heading = ToInt16(&p[41]) * 0.0001f;
+	}
+
+	bridge->callbacks.publish_batch(bridge->callbacks.arg, batch);
+}
+
+//Takes frames off the socket with their kernel timestamp and decodes them
+//straight from the receive buffer into the loaned messages
+static void* TelemetryThread(void* arg)
+{
+	ecu_bridge_t* bridge = arg;
+	uint8_t frame[BRIDGE_MAX_FRAME_SIZE];
+	uint8_t control[CMSG_SPACE(sizeof(struct timespec))];
+
+	while( bridge->running )
+	{
+		struct iovec iov = { frame, sizeof(frame) };
+		struct msghdr message = { 0 };
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		ssize_t length = recvmsg(bridge->socket, &message, 0);
+		if( length < 0 )
+			continue;
+		uint64_t received = Now(CLOCK_MONOTONIC);
+		uint64_t taken = Now(CLOCK_REALTIME);
+
+		uint64_t kernel = 0;
+		for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+		{
+			if( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS )
+			{
+				struct timespec ts;
+				memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+				kernel = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+			}
+		}
+
+		int telemetry = CheckFrame(frame, (uint32_t)length, BRIDGE_FRAME_TELEMETRY);
+		int batch = telemetry < 0 ? CheckFrame(frame, (uint32_t)length, BRIDGE_FRAME_TELEMETRY_BATCH) : -1;
+
+		pthread_mutex_lock(&bridge->lock);
+		bridge->stats.frames_received++;
+		if( telemetry < 0 && batch < 0 )
+			bridge->stats.frames_rejected++;
+		if( kernel && kernel <= taken )
+			AddLatency(&bridge->stats.socket_queue, taken - kernel);
+		pthread_mutex_unlock(&bridge->lock);
+
+		if( telemetry >= 0 )
+			DecodeTelemetry(bridge, &frame[BRIDGE_HEADER_SIZE], (uint16_t)telemetry, received);
+		else if( batch >= 0 )
+			DecodeBatch(bridge, &frame[BRIDGE_HEADER_SIZE], (uint16_t)batch, received);
+		else
+			continue;
+
+		uint64_t published = Now(CLOCK_MONOTONIC);
+		pthread_mutex_lock(&bridge->lock);
+		AddLatency(&bridge->stats.publish, published - received);
+		pthread_mutex_unlock(&bridge->lock);
+	}
+	return NULL;
+}
+
+//SCHED_FIFO at priority where the process may, the default policy otherwise
+static int StartThread(pthread_t* thread, void* (*entry)(void*), void* arg, int priority)
+{
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	struct sched_param param = { .sched_priority = priority };
+	pthread_attr_setschedparam(&attr, &param);
+	int result = pthread_create(thread, &attr, entry, arg);
+	pthread_attr_destroy(&attr);
+	if( result == EPERM )
+	{
+		fprintf(stderr, "EcuBridge: no SCHED_FIFO, running at the default policy\n");
+		result = pthread_create(thread, NULL, entry, arg);
+	}
+	return result;
+}
+
+ecu_bridge_t* EcuBridgeStart(const ecu_bridge_config_t* config, const ecu_bridge_callbacks_t* callbacks)
+{
+	if( config->rate == 0 )
+	{
+		fprintf(stderr, "EcuBridge: rate must be above 0\n");
+		return NULL;
+	}
+
+	pthread_once(&crc_table_once, BuildCRCTable);
+
+	ecu_bridge_t* bridge = calloc(1, sizeof(*bridge));
+	if( !bridge )
+		return NULL;
+	bridge->config = *config;
+	bridge->callbacks = *callbacks;
+	bridge->ecu.sin_family = AF_INET;
+	bridge->ecu.sin_port = htons(config->port);
+	if( inet_pton(AF_INET, config->address, &bridge->ecu.sin_addr) != 1 )
+	{
+		fprintf(stderr, "EcuBridge: bad address %s\n", config->address);
+		free(bridge);
+		return NULL;
+	}
+
+	bridge->socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if( bridge->socket < 0 )
+	{
+		perror("EcuBridge: socket");
+		free(bridge);
+		return NULL;
+	}
+
+	int on = 1;
+	struct timeval timeout = { 0, BRIDGE_RECEIVE_TIMEOUT * 1000 };
+	setsockopt(bridge->socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+	setsockopt(bridge->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	struct sockaddr_in local = { 0 };
+	local.sin_family = AF_INET;
+	local.sin_port = htons(config->local_port);
+	if( bind(bridge->socket, (const struct sockaddr*)&local, sizeof(local)) < 0 )
+	{
+		perror("EcuBridge: bind");
+		close(bridge->socket);
+		free(bridge);
+		return NULL;
+	}
+
+	pthread_mutex_init(&bridge->lock, NULL);
+	bridge->running = 1;
+	if( StartThread(&bridge->telemetry_thread, TelemetryThread, bridge, BRIDGE_TELEMETRY_PRIORITY) != 0 )
+	{
+		fprintf(stderr, "EcuBridge: telemetry thread failed\n");
+		close(bridge->socket);
+		free(bridge);
+		return NULL;
+	}
+	if( StartThread(&bridge->command_thread, CommandThread, bridge, BRIDGE_COMMAND_PRIORITY) != 0 )
+	{
+		fprintf(stderr, "EcuBridge: command thread failed\n");
+		bridge->running = 0;
+		pthread_join(bridge->telemetry_thread, NULL);
+		close(bridge->socket);
+		free(bridge);
+		return NULL;
+	}
+	return bridge;
+}
+
+void EcuBridgeStop(ecu_bridge_t* bridge)
+{
+	bridge->running = 0;
+	pthread_join(bridge->command_thread, NULL);
+	pthread_join(bridge->telemetry_thread, NULL);
+	close(bridge->socket);
+	pthread_mutex_destroy(&bridge->lock);
+	free(bridge);
+}
+
+void EcuBridgeSetCommand(ecu_bridge_t* bridge, const ecu_bridge_command_t* command)
+{
+	uint64_t now = Now(CLOCK_MONOTONIC);
+	pthread_mutex_lock(&bridge->lock);
+	bridge->command = *command;
+	bridge->command_set = now;
+	bridge->command_fresh = 1;
+	pthread_mutex_unlock(&bridge->lock);
+}
+
+void EcuBridgeReadStats(ecu_bridge_t* bridge, ecu_bridge_stats_t* stats)
+{
+	pthread_mutex_lock(&bridge->lock);
+	*stats = bridge->stats;
+	pthread_mutex_unlock(&bridge->lock);
+}
@@ -0,0 +1,206 @@
+/*
+ * EcuBridge.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef ECUBRIDGE_H_
+#define ECUBRIDGE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//PC side of the UDP control protocol (ControlProtocol.h) for the driving
+//stack, a library its middleware node links against. EcuBridgeMain.c is a
+//standalone front end to it.
+//
+//	telemetry	one thread takes the status and PID groups and, when asked,
+//				batched telemetry, the command thread keeps the
+//				subscription alive. Every frame is checked and decoded
+//				straight out of the receive buffer into a message the
+//				caller lends for it, which goes back to the caller to
+//				publish. A ROS 2 node returns a loaned message from its
+//				loan callback and publishes that same message from the
+//				publish callback, nothing is copied in between. The status
+//				fields a frame leaves out, unchanged on the ECU, are filled
+//				from the last values.
+//	command		another thread sends the newest command at a fixed rate,
+//				woken at absolute times on CLOCK_MONOTONIC so a late wake
+//				does not push the later sends back. A command not renewed
+//				within hold ms is no longer sent, the ECU's lease then runs
+//				out and it stops the cart on its own.
+//
+//Both threads run SCHED_FIFO where the process may, the command thread
+//above the telemetry thread. The latency the PC side adds in either
+//direction is kept in ecu_bridge_stats_t.
+//
+//The frame layouts are copies of ControlProtocol.h's, the firmware headers
+//do not build for the PC. ECU_BRIDGE_PROTOCOL_VERSION has to follow
+//CONTROL_PROTOCOL_VERSION.
+
+#define ECU_BRIDGE_PROTOCOL_VERSION 16
+
+//The ECU's command port
+#define ECU_BRIDGE_PORT 12090
+
+//Samples a batched telemetry frame carries at most,
+//CONTROL_TELEMETRY_BATCH_MAX_SAMPLES
+#define ECU_BRIDGE_BATCH_MAX_SAMPLES 32
+
+//ECU_BRIDGE_FIELD_* bits of the status fields a frame carried. The fields
+//not carried did not change since the last frame and hold their last value.
+#define ECU_BRIDGE_FIELD_SEQUENCE 0x0001
+#define ECU_BRIDGE_FIELD_TIMESTAMP 0x0002
+#define ECU_BRIDGE_FIELD_SPEED 0x0004
+#define ECU_BRIDGE_FIELD_STEERING 0x0008
+#define ECU_BRIDGE_FIELD_STATES 0x0010
+#define ECU_BRIDGE_FIELD_PID 0x07E0
+#define ECU_BRIDGE_FIELD_COMMAND_PTP 0x0800
+#define ECU_BRIDGE_FIELD_SAMPLE_PTP 0x1000
+#define ECU_BRIDGE_FIELD_RAM 0x6000
+
+typedef struct ecu_bridge_status_t
+{
+	//ECU_BRIDGE_FIELD_* of the fields this frame carried
+	uint16_t fields;
+	//sequence and timestamp of the last command the ECU accepted
+	uint32_t command_sequence;
+	uint32_t command_timestamp;
+	//m/s and degrees
+	float speed;
+	float steering;
+	uint8_t estop;
+	//speed p, i, d and steering p, i, d
+	int32_t pid[6];
+	//PTP us the command was received and the values sampled at, 0 unsynced
+	uint32_t command_ptp;
+	uint32_t sample_ptp;
+	uint32_t ram_corrected;
+	uint16_t ram_uncorrectable;
+	//CLOCK_MONOTONIC ns the frame was taken off the socket at
+	uint64_t received;
+} ecu_bridge_status_t;
+
+typedef struct ecu_bridge_sample_t
+{
+	uint32_t sample_ptp;
+	float speed;
+	float steering;
+	uint8_t estop;
+	int32_t pid[6];
+	//odometry, m and rad
+	float x;
+	float y;
+	float heading;
+} ecu_bridge_sample_t;
+
+typedef struct ecu_bridge_batch_t
+{
+	//number of the first sample since boot, the others follow a control
+	//cycle apart
+	uint32_t first;
+	//samples the ECU overwrote before sending them, since the subscription
+	uint32_t lost;
+	uint8_t count;
+	ecu_bridge_sample_t samples[ECU_BRIDGE_BATCH_MAX_SAMPLES];
+	uint64_t received;
+} ecu_bridge_batch_t;
+
+//Command payload bits, as ControlProtocol.h's
+#define ECU_BRIDGE_PARKING_BRAKE 0x01
+#define ECU_BRIDGE_REVERSE 0x02
+#define ECU_BRIDGE_AUTONOMOUS 0x04
+#define ECU_BRIDGE_TELE_OPERATION 0x10
+
+typedef struct ecu_bridge_command_t
+{
+	uint16_t flags;
+	//0 to 1 of the top speed, -1 to 1 of full lock
+	float speed;
+	float steering;
+} ecu_bridge_command_t;
+
+//Where a message is decoded into and how it is published, from the
+//telemetry thread. A loan of NULL drops the frame. Either pair may be NULL
+//for telemetry the caller does not want.
+typedef struct ecu_bridge_callbacks_t
+{
+	void* arg;
+	ecu_bridge_status_t* (*loan_status)(void* arg);
+	void (*publish_status)(void* arg, ecu_bridge_status_t* status);
+	ecu_bridge_batch_t* (*loan_batch)(void* arg);
+	void (*publish_batch)(void* arg, ecu_bridge_batch_t* batch);
+} ecu_bridge_callbacks_t;
+
+typedef struct ecu_bridge_config_t
+{
+	//dotted quad of the ECU
+	const char* address;
+	uint16_t port;
+	//0 for any
+	uint16_t local_port;
+	//Hz the command is sent at
+	uint32_t rate;
+	//ms a command is sent for without a newer one
+	uint32_t hold;
+	//commander priority and lease ms the commands carry
+	uint8_t priority;
+	uint16_t lease;
+	//status and PID group periods ms, 0 for none
+	uint16_t status_period;
+	uint16_t pid_period;
+	//samples per batched telemetry frame, 0 for none
+	uint8_t batch_samples;
+} ecu_bridge_config_t;
+
+//One direction's delay, in ns
+typedef struct ecu_bridge_latency_t
+{
+	uint64_t count;
+	uint64_t total;
+	uint64_t max;
+} ecu_bridge_latency_t;
+
+typedef struct ecu_bridge_stats_t
+{
+	//command thread wake up after its absolute time
+	ecu_bridge_latency_t send_lateness;
+	//EcuBridgeSetCommand to the first send of it
+	ecu_bridge_latency_t command_age;
+	//send to the telemetry that echoes the sequence, the ECU included
+	ecu_bridge_latency_t round_trip;
+	//kernel receive timestamp to the frame taken off the socket
+	ecu_bridge_latency_t socket_queue;
+	//frame taken off the socket to publish returned
+	ecu_bridge_latency_t publish;
+	uint64_t commands_sent;
+	uint64_t frames_received;
+	//failed the length, version or CRC check
+	uint64_t frames_rejected;
+} ecu_bridge_stats_t;
+
+typedef struct ecu_bridge_t ecu_bridge_t;
+
+void EcuBridgeDefaultConfig(ecu_bridge_config_t* config);
+
+//Opens the socket and starts both threads, NULL on a failure, reported on
+//stderr. callbacks is copied.
+ecu_bridge_t* EcuBridgeStart(const ecu_bridge_config_t* config, const ecu_bridge_callbacks_t* callbacks);
+
+//Stops the threads and frees the bridge
+void EcuBridgeStop(ecu_bridge_t* bridge);
+
+//The command to send from now on, from any thread
+void EcuBridgeSetCommand(ecu_bridge_t* bridge, const ecu_bridge_command_t* command);
+
+//Consistent copy of the stats, from any thread
+void EcuBridgeReadStats(ecu_bridge_t* bridge, ecu_bridge_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ECUBRIDGE_H_ */
@@ -0,0 +1,143 @@
+/*
+ * EcuBridgeMain.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "EcuBridge.h"
+
+//Standalone front end to EcuBridge.h, what send.py was: sends one steady
+//command for the given seconds, renewed every BRIDGE_MAIN_RENEW ms as a
+//driving stack would, prints the newest status once a second and the
+//latency stats at the end. The loan and publish callbacks hand out
+//messages from a small pool the way a middleware's loaned messages are.
+//
+//The ECU drives the cart with the command given. Run with the drive
+//disconnected or the cart up on stands. Speed and steering default to 0.
+//
+//usage: EcuBridge [-a address] [-r Hz] [-d s] [-s speed] [-t steering]
+//                 [-f flags] [-p status ms] [-i pid ms] [-b samples]
+
+#define BRIDGE_MAIN_RENEW 20
+#define BRIDGE_MAIN_POOL 4
+
+typedef struct bridge_main_t
+{
+	ecu_bridge_status_t statuses[BRIDGE_MAIN_POOL];
+	ecu_bridge_batch_t batches[BRIDGE_MAIN_POOL];
+	uint32_t next_status;
+	uint32_t next_batch;
+	//newest published, read by main without a lock, for printing only
+	ecu_bridge_status_t* volatile status;
+	volatile uint64_t samples;
+	volatile uint64_t lost;
+} bridge_main_t;
+
+static ecu_bridge_status_t* LoanStatus(void* arg)
+{
+	bridge_main_t* state = arg;
+	return &state->statuses[state->next_status++ % BRIDGE_MAIN_POOL];
+}
+
+static void PublishStatus(void* arg, ecu_bridge_status_t* status)
+{
+	bridge_main_t* state = arg;
+	state->status = status;
+}
+
+static ecu_bridge_batch_t* LoanBatch(void* arg)
+{
+	bridge_main_t* state = arg;
+	return &state->batches[state->next_batch++ % BRIDGE_MAIN_POOL];
+}
+
+static void PublishBatch(void* arg, ecu_bridge_batch_t* batch)
+{
+	bridge_main_t* state = arg;
+	state->samples += batch->count;
+	state->lost = batch->lost;
+}
+
+static void PrintLatency(const char* name, const ecu_bridge_latency_t* latency)
+{
+	if( latency->count == 0 )
+	{
+		printf("%-16s none\n", name);
+		return;
+	}
+	printf("%-16s %10llu  mean %9.1f us  max %9.1f us\n", name, (unsigned long long)latency->count,
+		latency->total / (double)latency->count / 1000.0, latency->max / 1000.0);
+}
+
+static void Usage()
+{
+	fprintf(stderr, "usage: EcuBridge [-a address] [-r Hz] [-d s] [-s speed] [-t steering]\n"
+		"                 [-f flags] [-p status ms] [-i pid ms] [-b samples]\n");
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	ecu_bridge_config_t config;
+	EcuBridgeDefaultConfig(&config);
+	ecu_bridge_command_t command = { ECU_BRIDGE_TELE_OPERATION, 0, 0 };
+	uint32_t duration = 10;
+
+	int option;
+	while( (option = getopt(argc, argv, "a:r:d:s:t:f:p:i:b:")) != -1 )
+	{
+		switch(option)
+		{
+			case 'a': config.address = optarg; break;
+			case 'r': config.rate = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 'd': duration = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 's': command.speed = strtof(optarg, NULL); break;
+			case 't': command.steering = strtof(optarg, NULL); break;
+			case 'f': command.flags = (uint16_t)strtoul(optarg, NULL, 0); break;
+			case 'p': config.status_period = (uint16_t)strtoul(optarg, NULL, 0); break;
+			case 'i': config.pid_period = (uint16_t)strtoul(optarg, NULL, 0); break;
+			case 'b': config.batch_samples = (uint8_t)strtoul(optarg, NULL, 0); break;
+			default: Usage();
+		}
+	}
+	if( config.batch_samples > ECU_BRIDGE_BATCH_MAX_SAMPLES )
+		config.batch_samples = ECU_BRIDGE_BATCH_MAX_SAMPLES;
+
+	static bridge_main_t state;
+	ecu_bridge_callbacks_t callbacks = { &state, LoanStatus, PublishStatus, LoanBatch, PublishBatch };
+	ecu_bridge_t* bridge = EcuBridgeStart(&config, &callbacks);
+	if( !bridge )
+		return 1;
+
+	struct timespec renew = { 0, BRIDGE_MAIN_RENEW * 1000000L };
+	for(uint32_t ms = 0; ms < duration * 1000; ms += BRIDGE_MAIN_RENEW)
+	{
+		EcuBridgeSetCommand(bridge, &command);
+		if( ms % 1000 == 0 && state.status )
+		{
+			ecu_bridge_status_t status = *state.status;
+			printf("seq %u  speed %6.2f m/s  steering %6.1f deg  estop %u  samples %llu lost %llu\n",
+				status.command_sequence, status.speed, status.steering, status.estop,
+				(unsigned long long)state.samples, (unsigned long long)state.lost);
+		}
+		nanosleep(&renew, NULL);
+	}
+
+	ecu_bridge_stats_t stats;
+	EcuBridgeReadStats(bridge, &stats);
+	EcuBridgeStop(bridge);
+
+	printf("commands sent %llu  frames received %llu  rejected %llu\n", (unsigned long long)stats.commands_sent,
+		(unsigned long long)stats.frames_received, (unsigned long long)stats.frames_rejected);
+	PrintLatency("send lateness", &stats.send_lateness);
+	PrintLatency("command age", &stats.command_age);
+	PrintLatency("round trip", &stats.round_trip);
+	PrintLatency("socket queue", &stats.socket_queue);
+	PrintLatency("publish", &stats.publish);
+	return 0;
+}
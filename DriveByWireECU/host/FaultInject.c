@@ -0,0 +1,210 @@
+/*
+ * FaultInject.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ControlCore.h"
+#include "DriveByWireIO.h"
+#include "HostIO.h"
+#include "PlantModel.h"
+#include "ActuatorFault.h"
+
+//Detection of the actuator faults of ActuatorFault.h against the plant
+//models in PlantModel.c. Every run drives the cart in autonomous mode at
+//1 kHz, the steering following a triangle wave and the speed a constant, with the
+//default gains. ProcessAlgorithms and the detector run as the control
+//cycle runs them. The sensed angle and speed get noise of their own.
+//
+//	none		no fault, any fault raised is a false alarm
+//	steering	the steering motor stalls at the inject time
+//	throttle	the throttle is disconnected at the inject time
+//
+//One CSV row per run goes to stdout with the ms from the injection to the
+//fault, and to the mode leaving autonomous, against
+//ACTUATOR_FAULT_DETECTION_BOUND. The exit code is non-zero if a fault was
+//missed, raised late or raised falsely.
+//
+//usage: FaultInject [-t ms] [-f ms] [-a deg] [-s m/s] [-n deg]
+
+typedef enum inject_fault_t
+{
+	INJECT_NONE = 0,
+	INJECT_STEERING,
+	INJECT_THROTTLE
+} inject_fault_t;
+
+typedef struct inject_config_t
+{
+	//ms per run and of the injection
+	uint32_t duration;
+	uint32_t inject;
+	//deg of the steering wave, its period in ms, and m/s commanded
+	float amplitude;
+	uint32_t period;
+	float speed;
+	//deg either way on the sensed angle, a tenth of it in m/s on the speed
+	float noise;
+	plant_params_t plant;
+} inject_config_t;
+
+typedef struct inject_result_t
+{
+	uint8_t faults;
+	//ms after the injection, -1 for never
+	int32_t detected;
+	int32_t disabled;
+} inject_result_t;
+
+static const char* const fault_names[] = { "none", "steering", "throttle" };
+
+static main_context_t ctx;
+
+static float Noise(float amplitude)
+{
+	return amplitude * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+//The steering moves at one rate between the turns
+static float Steering(const inject_config_t* config, uint32_t t)
+{
+	uint32_t phase = t % config->period;
+	float share = 4.0f * phase / config->period;
+	if( share < 1.0f )
+		return config->amplitude * share;
+	if( share < 3.0f )
+		return config->amplitude * (2.0f - share);
+	return config->amplitude * (share - 4.0f);
+}
+
+static void Run(const inject_config_t* config, inject_fault_t fault, inject_result_t* result)
+{
+	plant_t plant;
+
+	srand(1);
+	InitializeDriveByWireIO();
+	ControlCoreInit(&ctx);
+	PlantInit(&plant, &config->plant);
+	ctx.autonomous_mode = 1;
+	ctx.vehicle_speed_commanded = config->speed;
+
+	result->faults = 0;
+	result->detected = -1;
+	result->disabled = -1;
+	for(uint32_t cycle = 0; cycle < config->duration * CONTROL_CYCLES_PER_MS; ++cycle)
+	{
+		uint32_t t = cycle / CONTROL_CYCLES_PER_MS;
+		if( t == config->inject )
+		{
+			if( fault == INJECT_STEERING )
+			{
+				plant.params.steer_rate = 0.0f;
+				plant.steer_rate = 0.0f;
+			}
+			else if( fault == INJECT_THROTTLE )
+				plant.params.speed_gain = 0.0f;
+		}
+
+		PlantSense(&plant, &host_io);
+		host_io.steering_angle += Noise(config->noise);
+		host_io.vehicle_speed += Noise(config->noise * 0.1f);
+		ctx.current_time = t;
+		host_io.sample_time = cycle * CONTROL_CORE_CYCLE_US;
+		ctx.steering_angle_commanded = Steering(config, t);
+		ProcessCurrentInputs(&ctx);
+		//the faults stage
+		ActuatorFaultStep(&ctx.actuator_fault, &ctx.actuators, ctx.steering_angle, ctx.vehicle_speed, ctx.estop_in);
+		ProcessAlgorithms(&ctx);
+		CommitActuators(&ctx.actuators);
+#if STEERING_RATE_LOOP
+		for(int step = 0; step < STEERING_RATE_LOOP_FREQ / CONTROL_RATE_HZ; ++step)
+		{
+			PlantSense(&plant, &host_io);
+			HostSteeringRateStep();
+			PlantStep(&plant, &host_io, 1.0f / STEERING_RATE_LOOP_FREQ);
+		}
+#else
+		PlantStep(&plant, &host_io, CONTROL_CORE_CYCLE_US / 1000000.0f);
+#endif
+
+		int32_t since = (int32_t)(t - config->inject);
+		if( ctx.actuator_fault.faults && !result->faults )
+		{
+			result->faults = ctx.actuator_fault.faults;
+			result->detected = since;
+		}
+		if( result->faults && result->disabled < 0 && ctx.mode.mode != VEHICLE_MODE_AUTONOMOUS )
+			result->disabled = since;
+	}
+}
+
+static void Usage()
+{
+	fprintf(stderr, "usage: FaultInject [-t ms] [-f ms] [-a deg] [-s m/s] [-n deg]\n");
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	inject_config_t config;
+
+	memset(&config, 0, sizeof(config));
+	PlantDefaultParams(&config.plant);
+	config.duration = 20000;
+	config.inject = 10000;
+	config.amplitude = 20.0f;
+	config.period = 4000;
+	config.speed = 3.0f;
+	config.noise = 0.2f;
+
+	int opt;
+	while( (opt = getopt(argc, argv, "t:f:a:s:n:")) != -1 )
+	{
+		switch( opt )
+		{
+		case 't':
+			config.duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			config.inject = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			config.amplitude = strtof(optarg, NULL);
+			break;
+		case 's':
+			config.speed = strtof(optarg, NULL);
+			break;
+		case 'n':
+			config.noise = strtof(optarg, NULL);
+			break;
+		default:
+			Usage();
+		}
+	}
+	if( config.inject >= config.duration )
+		Usage();
+
+	int failed = 0;
+	printf("fault,raised,detected_ms,disabled_ms,bound_ms\n");
+	for(inject_fault_t fault = INJECT_NONE; fault <= INJECT_THROTTLE; ++fault)
+	{
+		inject_result_t result;
+		uint8_t expected = fault == INJECT_STEERING ? ACTUATOR_FAULT_STEERING
+			: fault == INJECT_THROTTLE ? ACTUATOR_FAULT_THROTTLE : 0;
+
+		Run(&config, fault, &result);
+		printf("%s,%u,%ld,%ld,%d\n", fault_names[fault], result.faults, (long)result.detected,
+			(long)result.disabled, ACTUATOR_FAULT_DETECTION_BOUND / CONTROL_CYCLES_PER_MS);
+		if( result.faults != expected || (expected && (result.detected < 0
+			|| result.detected > ACTUATOR_FAULT_DETECTION_BOUND / CONTROL_CYCLES_PER_MS)) )
+		{
+			printf("# %s: expected %u\n", fault_names[fault], expected);
+			failed = 1;
+		}
+	}
+	return failed;
+}
@@ -0,0 +1,193 @@
+/*
+ * HostIO.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "HostIO.h"
+#include "DriveByWireIO.h"
+#include "EventLog.h"
+#include "RamEcc.h"
+
+host_io_t host_io;
+
+//the PWM outputs clamp to [0, 1] like SetPWMDuty does
+static float ClampDuty(float duty_cycle)
+{
+	if( duty_cycle < 0 )
+		return 0;
+	if( duty_cycle > 1.0f )
+		return 1;
+	return duty_cycle;
+}
+
+void InitializeDriveByWireIO()
+{
+	memset(&host_io, 0, sizeof(host_io));
+	SteeringRateLoopInit(&host_io.steering_rate_loop);
+}
+
+static void ApplySteeringTorque(float duty_cycle)
+{
+	host_io.steering_torque = ClampDuty(duty_cycle);
+}
+
+void HostSteeringRateStep()
+{
+	float torque = SteeringRateLoopStep(&host_io.steering_rate_loop, host_io.steering_angle);
+	if( host_io.steering_rate_loop.enabled )
+	{
+		host_io.steer_right = torque < 0.0f;
+		ApplySteeringTorque(torque < 0.0f ? -torque : torque);
+	}
+}
+
+void ProcessCurrentInputs(main_context_t* context)
+{
+	context->input_time = host_io.input_time;
+	context->sample_time = host_io.sample_time;
+	context->estop_in = host_io.estop != 0;
+	context->estop_time = host_io.estop_time;
+	context->steering_angle = host_io.steering_angle;
+	context->reverse = host_io.reverse;
+	context->vehicle_speed = host_io.vehicle_speed;
+	memcpy(context->wheel_speeds, host_io.wheel_speeds, sizeof(context->wheel_speeds));
+	context->front_wheels_valid = host_io.front_wheels_valid != 0;
+	context->brake_pressure = host_io.brake_pressure;
+	//the plant has no supply, its outputs are as commanded
+	context->supply_gain = 1.0f;
+	if( host_io.wheel_speed_rx_tick )
+		DeadlineKick(&context->deadlines, DEADLINE_WHEEL_SPEED, host_io.wheel_speed_rx_tick);
+	if( host_io.eps_rx_tick )
+		DeadlineKick(&context->deadlines, DEADLINE_EPS_FEEDBACK, host_io.eps_rx_tick);
+}
+
+void ProcessImuInputs(main_context_t* context)
+{
+	context->imu_valid = !host_io.imu_stale;
+	if( !context->imu_valid )
+		return;
+	context->yaw_rate = host_io.yaw_rate;
+	context->longitudinal_accel = host_io.longitudinal_accel;
+	context->lateral_accel = host_io.lateral_accel;
+}
+
+void ProcessCurrentOutputs(main_context_t* context)
+{
+	SetPCComm(context->pc_comm_active);
+	SetDebugLED1(context->debug_led_1);
+	SetDebugLED2(context->debug_led_1);
+	SetEStopState(context->estop_indicator);
+}
+
+//The target's writes are ordered for the pins, here only the values matter
+void CommitActuators(const actuator_command_t* command)
+{
+	host_io.acceleration = ClampDuty(command->acceleration);
+	host_io.front_brake = ClampDuty(command->front_brake);
+	host_io.reverse = command->reverse != 0;
+	host_io.safety_light_2 = command->reverse != 0;
+	host_io.safety_light_1 = command->safety_light_1 != 0;
+	host_io.steering_rate_loop.setpoint = command->steering_rate;
+#if STEERING_RATE_LOOP
+	host_io.steering_rate_loop.enabled = command->steering_rate_control != 0;
+#endif
+	if( !host_io.steering_rate_loop.enabled )
+	{
+		host_io.steer_right = command->steer_right != 0;
+		ApplySteeringTorque(command->steering_torque);
+	}
+}
+
+void SetSafetyLight1On(int on)
+{
+	host_io.safety_light_1 = on != 0;
+}
+
+void SetSafetyLight2On(int on)
+{
+	host_io.safety_light_2 = on != 0;
+}
+
+void SetSteerDirection(int right)
+{
+	if( host_io.steering_rate_loop.enabled )
+		return;
+	host_io.steer_right = right != 0;
+}
+
+void SetReverseDrive(int reverse)
+{
+	host_io.reverse = reverse != 0;
+	SetSafetyLight2On(reverse);
+}
+
+void SetSteeringTorque(float duty_cycle)
+{
+	if( host_io.steering_rate_loop.enabled )
+		return;
+	ApplySteeringTorque(duty_cycle);
+}
+
+void SetSteeringRateControl(int enabled)
+{
+#if STEERING_RATE_LOOP
+	if( !enabled && host_io.steering_rate_loop.enabled )
+		ApplySteeringTorque(0.0f);
+	host_io.steering_rate_loop.enabled = enabled != 0;
+#endif
+}
+
+void SetSteeringRate(float rate)
+{
+	host_io.steering_rate_loop.setpoint = rate;
+}
+
+void SetFrontBrake(float duty_cycle)
+{
+	host_io.front_brake = ClampDuty(duty_cycle);
+}
+
+void SetAcceleration(float duty_cycle)
+{
+	host_io.acceleration = ClampDuty(duty_cycle);
+}
+
+void SetPCComm(int active)
+{
+	host_io.pc_comm = active != 0;
+}
+
+void SetEStopState(int active)
+{
+	host_io.estop_indicator = active != 0;
+}
+
+void SetDebugLED1(int active)
+{
+	host_io.debug_led_1 = active != 0;
+}
+
+void SetDebugLED2(int active)
+{
+	host_io.debug_led_2 = active != 0;
+}
+
+//The event log lives in RAM kept across resets on the target, the host
+//only counts the writes
+void EventLogWrite(event_log_id_t id, uint16_t arg, uint32_t value)
+{
+	host_io.events++;
+}
+
+//No ECC RAM on the host
+uint32_t RamEccCorrected()
+{
+	return 0;
+}
+
+uint32_t RamEccUncorrectable()
+{
+	return 0;
+}
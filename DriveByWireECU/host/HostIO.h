@@ -0,0 +1,75 @@
+/*
+ * HostIO.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef HOSTIO_H_
+#define HOSTIO_H_
+
+#include <stdint.h>
+#include "SteeringRateLoop.h"
+#include "WheelSpeed.h"
+#include "ControlScheduler.h"
+
+//DriveByWireIO.h for the host build. The sensors read whatever the
+//simulation last wrote into host_io, and the actuators only record what
+//the control core set, in the units the setters take.
+typedef struct host_io_t
+{
+	//inputs, set before each ControlCoreStep
+	float steering_angle;
+	float vehicle_speed;
+	uint8_t estop;
+	//PTP us of the inputs and of the estop press, 0 while not synced
+	uint32_t input_time;
+	uint32_t estop_time;
+	//us of the time base the inputs were sampled at
+	uint32_t sample_time;
+	//share of the full front brake pressure
+	float brake_pressure;
+	//deg/s and m/s^2, the IMU's sample is in every cycle
+	float yaw_rate;
+	float longitudinal_accel;
+	float lateral_accel;
+	//the IMU's sample is not in this cycle, the last one stays
+	uint8_t imu_stale;
+	//m/s of each wheel, and the front ones' frame is in. The simulations
+	//leave them 0, traction control then holds nothing back.
+	float wheel_speeds[WHEEL_SPEED_SENSOR_COUNT];
+	uint8_t front_wheels_valid;
+	//ticks of the newest wheel speed and EPS frames, 0 while never heard
+	uint32_t wheel_speed_rx_tick;
+	uint32_t eps_rx_tick;
+
+	//outputs, as ControlCoreStep left them
+	float acceleration;
+	float steering_torque;
+	uint8_t steer_right;
+	float front_brake;
+	uint8_t reverse;
+	uint8_t safety_light_1;
+	uint8_t safety_light_2;
+	uint8_t pc_comm;
+	uint8_t estop_indicator;
+	uint8_t debug_led_1;
+	uint8_t debug_led_2;
+
+	//EventLogWrite calls
+	uint32_t events;
+
+	//stands in for the one in DriveByWireIO.c, stepped by HostSteeringRateStep
+	steering_rate_loop_t steering_rate_loop;
+} host_io_t;
+
+extern host_io_t host_io;
+
+//One step of the steering rate loop on the current steering_angle, what the
+//firmware's TC1 interrupt does, for simulations to call at STEERING_RATE_LOOP_FREQ
+void HostSteeringRateStep();
+
+#if STEERING_RATE_LOOP && STEERING_RATE_LOOP_FREQ % CONTROL_RATE_HZ != 0
+#error The simulations step the rate loop a whole number of times a control cycle
+#endif
+
+#endif /* HOSTIO_H_ */
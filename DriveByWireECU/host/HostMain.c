@@ -0,0 +1,70 @@
+/*
+ * HostMain.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ControlCore.h"
+#include "DriveByWireIO.h"
+#include "HostIO.h"
+
+//The stand-in PC sends a command every HOST_COMMAND_PERIOD ms, at one
+//commander level with a lease of HOST_COMMAND_LEASE ms
+#define HOST_COMMAND_PERIOD 10
+#define HOST_COMMAND_PRIORITY 1
+#define HOST_COMMAND_LEASE 250
+
+static main_context_t ctx;
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//What ethernet_thread would publish for a steady command
+static void SendCommand(uint32_t now)
+{
+	control_command_t* command = BeginCommandWrite(&ctx.exchange, HOST_COMMAND_PRIORITY);
+	command->rx_time = now;
+	command->lease_end = now + HOST_COMMAND_LEASE;
+	command->priority = HOST_COMMAND_PRIORITY;
+	command->vehicle_speed_commanded = 0.3f;
+	command->steering_angle_commanded = 0.2f;
+	command->autonomous_mode = 1;
+	command->tele_operation_enabled = 1;
+	PublishCommand(&ctx.exchange, HOST_COMMAND_PRIORITY);
+}
+
+//Runs the control core for the given number of simulated ms, as fast as it
+//goes, and reports how much faster than real time that was.
+//usage: DriveByWireHost [ms]
+int main(int argc, char** argv)
+{
+	uint32_t cycles = (argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000) * CONTROL_CYCLES_PER_MS;
+
+	InitializeDriveByWireIO();
+	ControlCoreInit(&ctx);
+
+	double start = Seconds();
+	for(uint32_t cycle = 0; cycle < cycles; ++cycle)
+	{
+		uint32_t now = cycle / CONTROL_CYCLES_PER_MS;
+		if( cycle % (HOST_COMMAND_PERIOD * CONTROL_CYCLES_PER_MS) == 0 )
+			SendCommand(now);
+		host_io.sample_time = cycle * CONTROL_CORE_CYCLE_US;
+		ctx.scheduler.cycle_count++;
+		ControlCoreStep(&ctx, now);
+	}
+	double elapsed = Seconds() - start;
+
+	printf("%lu cycles in %.3f s, %.1f ns per cycle, %.0fx real time\n", (unsigned long)cycles, elapsed,
+		elapsed * 1e9 / cycles, cycles / (double)CONTROL_RATE_HZ / elapsed);
+	printf("outputs: acceleration %.3f steering torque %.3f, %lu events logged\n", host_io.acceleration,
+		host_io.steering_torque, (unsigned long)host_io.events);
+	return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * HostStatus.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <string.h>
+#include "ControlProtocol.h"
+#include "MemoryWindow.h"
+#include "SteeringCalibration.h"
+
+//Stand-ins for the monitors and stores ControlProtocol.c answers requests
+//from, which have no host build. They report nothing: no events, no saves,
+//no parameters and no readable memory.
+
+void BootProfileRead(boot_profile_t* profile)
+{
+	memset(profile, 0, sizeof(*profile));
+}
+
+uint32_t EventLogNext()
+{
+	return 0;
+}
+
+uint8_t EventLogRead(uint32_t sequence, event_log_entry_t* entry)
+{
+	return 0;
+}
+
+uint32_t EventLogBootCount()
+{
+	return 0;
+}
+
+void ExcitationStatus(excitation_status_t* status)
+{
+	memset(status, 0, sizeof(*status));
+}
+
+uint8_t MemoryWindowAllowed(uint32_t address, uint32_t length)
+{
+	return 0;
+}
+
+void MemoryWindowRead(uint8_t* destination, uint32_t address, uint32_t length)
+{
+	memset(destination, 0, length);
+}
+
+const param_info_t* ParamInfo(uint8_t id)
+{
+	return NULL;
+}
+
+param_store_state_t ParamStoreState()
+{
+	return PARAM_STORE_UNAVAILABLE;
+}
+
+uint32_t ParamStoreSequence()
+{
+	return 0;
+}
+
+void ProfilerRead(profiler_stage_t stage, profiler_stats_t* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+const steering_calibration_t* SteeringCalibrationCurrent()
+{
+	static const steering_calibration_t none;
+	return &none;
+}
+
+void SteeringSweepStatus(steering_sweep_status_t* status)
+{
+	memset(status, 0, sizeof(*status));
+}
+
+void TaskMonitorRead(task_monitor_snapshot_t* snapshot)
+{
+	memset(snapshot, 0, sizeof(*snapshot));
+}
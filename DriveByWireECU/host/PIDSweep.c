@@ -0,0 +1,242 @@
+/*
+ * PIDSweep.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ControlCore.h"
+#include "DriveByWireIO.h"
+#include "HostIO.h"
+#include "PlantModel.h"
+#include "StepMetrics.h"
+
+//Closed-loop step responses of one control loop over a grid of gains.
+//Every run starts the control core and the plant from rest, commands a step
+//and runs ProcessAlgorithms against the plant at 1 kHz, the gains going in
+//through override_pid like the PC sets them live. The other loop's gains
+//are zero. One CSV row per gain set goes to stdout.
+//
+//Gains are in the firmware's units, see ControlCore.c: duty cycle per
+//degree or per m/s, I per ms. Built with STEERING_RATE_LOOP the steering
+//gains are the position loop's, deg/s per degree, and the rate loop and the
+//plant step at STEERING_RATE_LOOP_FREQ in between.
+//
+//usage: PIDSweep steering|speed [-p lo:hi:n] [-i lo:hi:n] [-d lo:hi:n]
+//	[-s step] [-t ms] [-b band]
+
+typedef enum sweep_loop_t
+{
+	SWEEP_STEERING = 0,
+	SWEEP_SPEED
+} sweep_loop_t;
+
+typedef struct sweep_range_t
+{
+	float lo;
+	float hi;
+	uint32_t count;
+} sweep_range_t;
+
+typedef struct sweep_config_t
+{
+	sweep_loop_t loop;
+	sweep_range_t p;
+	sweep_range_t i;
+	sweep_range_t d;
+	//deg or m/s from rest
+	float step;
+	//ms per run
+	uint32_t duration;
+	float settle_band;
+	plant_params_t plant;
+} sweep_config_t;
+
+static main_context_t ctx;
+
+static float RangeValue(const sweep_range_t* range, uint32_t k)
+{
+	if( range->count < 2 )
+		return range->lo;
+	return range->lo + (range->hi - range->lo) * k / (range->count - 1);
+}
+
+//lo:hi:n, or a single value
+static int ParseRange(const char* text, sweep_range_t* range)
+{
+	unsigned count;
+	int fields = sscanf(text, "%f:%f:%u", &range->lo, &range->hi, &count);
+
+	if( fields == 1 )
+	{
+		range->hi = range->lo;
+		range->count = 1;
+		return 1;
+	}
+	if( fields != 3 || count == 0 )
+		return 0;
+	range->count = count;
+	return 1;
+}
+
+static void RunStep(const sweep_config_t* config, float p, float i, float d, step_result_t* result)
+{
+	plant_t plant;
+	step_metrics_t metrics;
+
+	InitializeDriveByWireIO();
+	ControlCoreInit(&ctx);
+	PlantInit(&plant, &config->plant);
+
+	ctx.autonomous_mode = 1;
+	ctx.override_pid = 1;
+	if( config->loop == SWEEP_STEERING )
+	{
+		ctx.steer_p_gain_override = p;
+		ctx.steer_i_gain_override = i;
+		ctx.steer_d_gain_override = d;
+		ctx.steering_angle_commanded = config->step;
+	}
+	else
+	{
+		ctx.speed_p_gain_override = p;
+		ctx.speed_i_gain_override = i;
+		ctx.speed_d_gain_override = d;
+		ctx.vehicle_speed_commanded = config->step;
+	}
+
+	StepMetricsInit(&metrics, 0.0f, config->step, config->settle_band);
+	for(uint32_t cycle = 0; cycle < config->duration * CONTROL_CYCLES_PER_MS; ++cycle)
+	{
+		uint32_t t = cycle / CONTROL_CYCLES_PER_MS;
+		PlantSense(&plant, &host_io);
+		ctx.current_time = t;
+		host_io.sample_time = cycle * CONTROL_CORE_CYCLE_US;
+		ProcessCurrentInputs(&ctx);
+		ProcessAlgorithms(&ctx);
+		CommitActuators(&ctx.actuators);
+#if STEERING_RATE_LOOP
+		//the inner loop and the plant between two control cycles
+		for(int step = 0; step < STEERING_RATE_LOOP_FREQ / CONTROL_RATE_HZ; ++step)
+		{
+			PlantSense(&plant, &host_io);
+			HostSteeringRateStep();
+			PlantStep(&plant, &host_io, 1.0f / STEERING_RATE_LOOP_FREQ);
+		}
+#else
+		PlantStep(&plant, &host_io, CONTROL_CORE_CYCLE_US / 1000000.0f);
+#endif
+		StepMetricsAdd(&metrics, t, config->loop == SWEEP_STEERING ? plant.steering_angle : plant.vehicle_speed);
+	}
+	StepMetricsResult(&metrics, result);
+}
+
+static void Usage()
+{
+	fprintf(stderr, "usage: PIDSweep steering|speed [-p lo:hi:n] [-i lo:hi:n] [-d lo:hi:n] [-s step] [-t ms] [-b band]\n");
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	sweep_config_t config;
+
+	if( argc < 2 )
+		Usage();
+	memset(&config, 0, sizeof(config));
+	PlantDefaultParams(&config.plant);
+	config.settle_band = STEP_METRICS_DEFAULT_BAND;
+	config.d.count = 1;
+	if( strcmp(argv[1], "steering") == 0 )
+	{
+		config.loop = SWEEP_STEERING;
+		config.p = (sweep_range_t){ 0.01f, 0.1f, 10 };
+		config.i = (sweep_range_t){ 0.0f, 0.0001f, 5 };
+		config.step = 10.0f;
+		config.duration = 5000;
+	}
+	else if( strcmp(argv[1], "speed") == 0 )
+	{
+		config.loop = SWEEP_SPEED;
+		config.p = (sweep_range_t){ 0.1f, 2.0f, 10 };
+		config.i = (sweep_range_t){ 0.0f, 0.001f, 5 };
+		config.step = 2.0f;
+		config.duration = 20000;
+	}
+	else
+		Usage();
+
+	int opt;
+	optind = 2;
+	while( (opt = getopt(argc, argv, "p:i:d:s:t:b:")) != -1 )
+	{
+		switch( opt )
+		{
+		case 'p':
+			if( !ParseRange(optarg, &config.p) )
+				Usage();
+			break;
+		case 'i':
+			if( !ParseRange(optarg, &config.i) )
+				Usage();
+			break;
+		case 'd':
+			if( !ParseRange(optarg, &config.d) )
+				Usage();
+			break;
+		case 's':
+			config.step = strtof(optarg, NULL);
+			break;
+		case 't':
+			config.duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			config.settle_band = strtof(optarg, NULL);
+			break;
+		default:
+			Usage();
+		}
+	}
+	if( config.duration == 0 || config.step == 0.0f )
+		Usage();
+
+	//fastest to settle, then least overshoot
+	int32_t best_settling = -1;
+	float best_overshoot = 0.0f;
+	float best[3] = { 0.0f, 0.0f, 0.0f };
+
+	printf("p,i,d,rise_ms,overshoot_pct,settling_ms,final_error\n");
+	for(uint32_t pk = 0; pk < config.p.count; ++pk)
+	for(uint32_t ik = 0; ik < config.i.count; ++ik)
+	for(uint32_t dk = 0; dk < config.d.count; ++dk)
+	{
+		float p = RangeValue(&config.p, pk);
+		float i = RangeValue(&config.i, ik);
+		float d = RangeValue(&config.d, dk);
+		step_result_t result;
+
+		RunStep(&config, p, i, d, &result);
+		printf("%g,%g,%g,%ld,%.2f,%ld,%g\n", p, i, d, (long)result.rise_time, result.overshoot,
+			(long)result.settling_time, result.final_error);
+
+		if( result.settling_time >= 0 && (best_settling < 0 || result.settling_time < best_settling
+			|| (result.settling_time == best_settling && result.overshoot < best_overshoot)) )
+		{
+			best_settling = result.settling_time;
+			best_overshoot = result.overshoot;
+			best[0] = p;
+			best[1] = i;
+			best[2] = d;
+		}
+	}
+
+	if( best_settling >= 0 )
+		printf("# best: p %g i %g d %g, settles in %ld ms with %.2f%% overshoot\n", best[0], best[1], best[2],
+			(long)best_settling, best_overshoot);
+	else
+		printf("# no gain set settled within %lu ms\n", (unsigned long)config.duration);
+	return 0;
+}
@@ -0,0 +1,491 @@
+/*
+ * PIDTest.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "PID.h"
+#include "SteeringCalibration.h"
+#include "ControlCore.h"
+#include "ControlProtocol.h"
+#include "ByteOrder.h"
+
+//Checks of the PID controller, the steering interpolation, the control
+//protocol's command and telemetry frames and the PID unit conversions, then
+//the time one call of the PID takes on this machine. tick() through its
+//callbacks, the output bounds, the error across the seam of a wrapped
+//feedback in both directions, the integral clamp, LinearlyInterpolate, the
+//fields of a command frame and a telemetry frame after a round trip, the
+//frames a command is rejected for and the conversions at their endpoints
+//and midpoints are checked against values worked out by hand. Any failed
+//check is printed and makes the exit status 1, the timings are only
+//printed.
+//
+//usage: PIDTest [calls]
+
+#define PID_TEST_DEFAULT_CALLS 10000000
+
+static int failures;
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+static void Check(int passed, const char* condition, int line)
+{
+	if( !passed )
+	{
+		printf("FAIL line %d: %s\n", line, condition);
+		failures++;
+	}
+}
+
+static int CloseTo(float value, float expected)
+{
+	float difference = value - expected;
+	return difference < 1e-4f && difference > -1e-4f;
+}
+
+static int source_feedback;
+static int output_value;
+static int output_calls;
+static unsigned long system_time;
+
+static int TestSource()
+{
+	return source_feedback;
+}
+
+static void TestOutput(int output)
+{
+	output_value = output;
+	output_calls++;
+}
+
+static unsigned long TestTime()
+{
+	return system_time;
+}
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void TestTick()
+{
+	//callbacks set after creation
+	PIDController* c = createPIDController(2, 0, 0, NULL, NULL);
+	setPIDSource(c, TestSource);
+	setPIDOutput(c, TestOutput);
+	c->target = 100;
+	source_feedback = 40;
+	output_calls = 0;
+	tick(c);
+	CHECK(output_calls == 1);
+	CHECK(output_value == 120);
+
+	//disabled, no feedback read and no output
+	setEnabled(c, 0);
+	tick(c);
+	CHECK(output_calls == 1);
+	free(c);
+
+	//untimed, the integral grows by the error every tick
+	c = createPIDController(0, 1, 0, TestSource, TestOutput);
+	c->target = 10;
+	source_feedback = 0;
+	tick(c);
+	tick(c);
+	tick(c);
+	CHECK(output_value == 30);
+	free(c);
+
+	//timed, the integral of a constant error over 5 time units
+	c = createPIDController(0, 1, 0, TestSource, TestOutput);
+	registerTimeFunction(c, TestTime);
+	c->target = 10;
+	system_time = 0;
+	tick(c);
+	system_time = 5;
+	tick(c);
+	CHECK(output_value == 50);
+	free(c);
+}
+
+static void TestOutputBounds()
+{
+	PIDController* c = createPIDController(10, 0, 0, NULL, NULL);
+	setOutputBounds(c, -50, 50);
+	CHECK(pid_step(c, 100, 0, PID_DT_UNTIMED) == 50);
+	CHECK(pid_step(c, -100, 0, PID_DT_UNTIMED) == -50);
+	CHECK(pid_step(c, 3, 0, PID_DT_UNTIMED) == 30);
+	free(c);
+}
+
+static void TestWrap()
+{
+	PIDController* c = createPIDController(1, 0, 0, NULL, NULL);
+	setFeedbackWrapBounds(c, 0, 360);
+
+	//up across the seam, 350 to 10
+	CHECK(pid_step(c, 10, 350, PID_DT_UNTIMED) == 20);
+	CHECK(c->error == 20);
+
+	//down across the seam, 10 to 350
+	CHECK(pid_step(c, 350, 10, PID_DT_UNTIMED) == -20);
+	CHECK(c->error == -20);
+
+	//no shorter way across the seam
+	CHECK(pid_step(c, 200, 100, PID_DT_UNTIMED) == 100);
+	CHECK(pid_step(c, 100, 200, PID_DT_UNTIMED) == -100);
+
+	//feedback past the bounds is clamped to them first
+	CHECK(pid_step(c, 5, 400, PID_DT_UNTIMED) == 5);
+	free(c);
+}
+
+static void TestIntegralClamp()
+{
+	PIDController* c = createPIDController(0, 1, 0, NULL, NULL);
+	setMaxIntegralCumulation(c, 100);
+	for(int i = 0; i < 50; ++i)
+		pid_step(c, 10, 0, PID_DT_UNTIMED);
+	CHECK(c->integralCumulation == 100);
+	CHECK(c->output == 100);
+
+	for(int i = 0; i < 50; ++i)
+		pid_step(c, -10, 0, PID_DT_UNTIMED);
+	CHECK(c->integralCumulation == -100);
+	CHECK(c->output == -100);
+
+	//a max of 1 or less is ignored, a negative one taken as positive
+	setMaxIntegralCumulation(c, 1);
+	CHECK(c->maxCumulation == 100);
+	setMaxIntegralCumulation(c, -40);
+	CHECK(c->maxCumulation == 40);
+
+	//0 leaves it unlimited
+	c->maxCumulation = 0;
+	c->integralCumulation = 0;
+	for(int i = 0; i < 5000; ++i)
+		pid_step(c, 10, 0, PID_DT_UNTIMED);
+	CHECK(c->integralCumulation == 50000);
+	free(c);
+}
+
+static void TestLinearlyInterpolate()
+{
+	CHECK(CloseTo(LinearlyInterpolate(1.5f, 1, 2, 10, 20), 15));
+	CHECK(CloseTo(LinearlyInterpolate(1, 1, 2, 10, 20), 10));
+	CHECK(CloseTo(LinearlyInterpolate(2, 1, 2, 10, 20), 20));
+	//falling line and extrapolation on both sides
+	CHECK(CloseTo(LinearlyInterpolate(0.25f, 0, 1, 4, 0), 3));
+	CHECK(CloseTo(LinearlyInterpolate(3, 1, 2, 10, 20), 30));
+	CHECK(CloseTo(LinearlyInterpolate(0, 1, 2, 10, 20), 0));
+}
+
+//Header and CRC around the payload already in place, as the PC sends them.
+//Returns the length.
+static uint32_t FinishFrame(uint8_t* frame, uint8_t type, uint16_t payload_length, uint32_t sequence, uint32_t timestamp)
+{
+	frame[0] = CONTROL_PROTOCOL_VERSION;
+	frame[1] = type;
+	PutLE16(&frame[2], payload_length);
+	PutLE32(&frame[4], sequence);
+	PutLE32(&frame[8], timestamp);
+	PutLE32(&frame[CONTROL_HEADER_SIZE + payload_length], ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+	return CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE;
+}
+
+//Command with every field, priority and lease included
+static uint32_t BuildCommand(uint8_t* frame, uint16_t flags, uint16_t speed, uint16_t steering, uint8_t priority, uint16_t lease)
+{
+	uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	PutLE16(&payload[0], flags);
+	PutLE16(&payload[2], speed);
+	PutLE16(&payload[4], steering);
+	payload[6] = priority;
+	PutLE16(&payload[7], lease);
+	return FinishFrame(frame, CONTROL_FRAME_COMMAND, 9, 1234, 5678);
+}
+
+static void TestCommandRoundTrip()
+{
+	control_protocol_t protocol;
+	ControlProtocolInit(&protocol);
+	control_command_info_t info;
+	control_command_t command;
+	uint8_t frame[64];
+
+	uint32_t length = BuildCommand(frame, 0x1 | 0x4 | 0x20, 0xFFFF, 0x7FFF, 2, 100);
+	CHECK(ControlProtocolFrameType(frame, length) == CONTROL_FRAME_COMMAND);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 1);
+	CHECK(info.sequence == 1234);
+	CHECK(info.timestamp == 5678);
+	CHECK(info.priority == 2);
+	CHECK(info.lease == 100);
+
+	ControlProtocolDecodeCommand(&protocol, frame, &info, 1000, &command);
+	CHECK(protocol.rx_sequence == 1234);
+	CHECK(protocol.rx_timestamp == 5678);
+	CHECK(command.rx_time == 1000);
+	CHECK(command.lease_end == 1100);
+	CHECK(command.sent_time == 5678);
+	CHECK(command.priority == 2);
+	CHECK(command.vehicle_speed_commanded == 1.0f);
+	CHECK(command.steering_angle_commanded == 0.0f);
+	CHECK(command.park_brake_commanded);
+	CHECK(!command.reverse_commanded);
+	CHECK(command.autonomous_mode);
+	CHECK(!command.tele_operation_enabled);
+	CHECK(command.probe.marked);
+	CHECK(command.probe.sequence == 1234);
+	CHECK(command.trajectory_points == 0);
+
+	//the other flags, no speed and full steering to each side
+	length = BuildCommand(frame, 0x2 | 0x10, 0, 0, 0, 100);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 1);
+	ControlProtocolDecodeCommand(&protocol, frame, &info, 0, &command);
+	CHECK(command.vehicle_speed_commanded == 0.0f);
+	CHECK(command.steering_angle_commanded == -1.0f);
+	CHECK(!command.park_brake_commanded);
+	CHECK(command.reverse_commanded);
+	CHECK(!command.autonomous_mode);
+	CHECK(command.tele_operation_enabled);
+	CHECK(!command.probe.marked);
+
+	length = BuildCommand(frame, 0, 0x8000, 0xFFFE, 0, 100);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 1);
+	ControlProtocolDecodeCommand(&protocol, frame, &info, 0, &command);
+	CHECK(CloseTo(command.vehicle_speed_commanded, 0.5f));
+	CHECK(command.steering_angle_commanded == 1.0f);
+
+	//a lease of 0, and the short payload without priority and lease, take
+	//the defaults
+	length = BuildCommand(frame, 0, 0, 0x7FFF, 3, 0);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 1);
+	CHECK(info.priority == 3);
+	CHECK(info.lease == CONTROL_COMMAND_DEFAULT_LEASE);
+	length = FinishFrame(frame, CONTROL_FRAME_COMMAND, CONTROL_COMMAND_PAYLOAD_SIZE, 1, 2);
+	CHECK(length == CONTROL_COMMAND_FRAME_SIZE);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 1);
+	CHECK(info.priority == CONTROL_COMMAND_DEFAULT_PRIORITY);
+	CHECK(info.lease == CONTROL_COMMAND_DEFAULT_LEASE);
+	CHECK(protocol.rx_invalid == 0);
+}
+
+//Each frame is rejected and counted once
+static void TestCommandRejected()
+{
+	control_protocol_t protocol;
+	ControlProtocolInit(&protocol);
+	control_command_info_t info;
+	uint8_t frame[64];
+
+	//bad CRC
+	uint32_t length = BuildCommand(frame, 0, 0, 0x7FFF, 0, 100);
+	frame[CONTROL_HEADER_SIZE + 2] ^= 0x01;
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 0);
+	CHECK(protocol.rx_invalid == 1);
+
+	//payload length that does not match the frame's
+	length = BuildCommand(frame, 0, 0, 0x7FFF, 0, 100);
+	PutLE16(&frame[2], 8);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 0);
+	CHECK(protocol.rx_invalid == 2);
+
+	//frame cut short, by a byte and to less than a header and CRC
+	length = BuildCommand(frame, 0, 0, 0x7FFF, 0, 100);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length - 1, &info) == 0);
+	CHECK(protocol.rx_invalid == 3);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, CONTROL_HEADER_SIZE + CONTROL_CRC_SIZE - 1, &info) == 0);
+	CHECK(protocol.rx_invalid == 4);
+
+	//payload shorter than a command's, with a good CRC
+	length = FinishFrame(frame, CONTROL_FRAME_COMMAND, CONTROL_COMMAND_PAYLOAD_SIZE - 1, 1, 2);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 0);
+	CHECK(protocol.rx_invalid == 5);
+
+	//bytes past the CRC
+	length = BuildCommand(frame, 0, 0, 0x7FFF, 0, 100);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length + 1, &info) == 0);
+	CHECK(protocol.rx_invalid == 6);
+
+	//priority out of range, the highest one is accepted
+	length = BuildCommand(frame, 0, 0, 0x7FFF, CONTROL_COMMAND_PRIORITY_COUNT, 100);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 0);
+	CHECK(protocol.rx_invalid == 7);
+	length = BuildCommand(frame, 0, 0, 0x7FFF, CONTROL_COMMAND_PRIORITY_COUNT - 1, 100);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 1);
+
+	//another version or type
+	frame[0] = CONTROL_PROTOCOL_VERSION + 1;
+	CHECK(ControlProtocolFrameType(frame, length) == 0);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 0);
+	CHECK(protocol.rx_invalid == 8);
+	length = FinishFrame(frame, CONTROL_FRAME_SUBSCRIBE, 9, 1, 2);
+	CHECK(ControlProtocolCheckCommand(&protocol, frame, length, &info) == 0);
+	CHECK(protocol.rx_invalid == 9);
+}
+
+static void TestTelemetryRoundTrip()
+{
+	static const uint8_t field_size[CONTROL_TELEMETRY_FIELD_COUNT] = { 4, 4, 2, 2, 1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 2 };
+	control_protocol_t protocol;
+	ControlProtocolInit(&protocol);
+	protocol.tx_sequence = 77;
+	uint32_t values[CONTROL_TELEMETRY_FIELD_COUNT];
+	for(int i = 0; i < CONTROL_TELEMETRY_FIELD_COUNT; ++i)
+		values[i] = 0x01020304u * (i + 1);
+	uint8_t frame[CONTROL_TELEMETRY_MAX_FRAME_SIZE];
+
+	//every field asked for, only the status group's are sent
+	uint16_t length = ControlProtocolEncodeTelemetry(&protocol, frame, CONTROL_TELEMETRY_GROUP_STATUS, 0xFFFF, values, 4321);
+	CHECK(length == CONTROL_TELEMETRY_MAX_FRAME_SIZE);
+	CHECK(ControlProtocolFrameType(frame, length) == CONTROL_FRAME_TELEMETRY);
+	uint16_t payload_length = GetLE16(&frame[2]);
+	CHECK(length == CONTROL_HEADER_SIZE + payload_length + CONTROL_CRC_SIZE);
+	CHECK(GetLE32(&frame[4]) == 77);
+	CHECK(protocol.tx_sequence == 78);
+	CHECK(GetLE32(&frame[8]) == 4321);
+	CHECK(GetLE32(&frame[CONTROL_HEADER_SIZE + payload_length]) == ControlProtocolCRC(frame, CONTROL_HEADER_SIZE + payload_length));
+
+	const uint8_t* payload = &frame[CONTROL_HEADER_SIZE];
+	uint16_t mask = GetLE16(&payload[1]);
+	CHECK(payload[0] == CONTROL_TELEMETRY_GROUP_STATUS);
+	CHECK(mask == 0x781F);
+	uint16_t offset = 3;
+	for(int i = 0; i < CONTROL_TELEMETRY_FIELD_COUNT; ++i)
+	{
+		if( !(mask & (1 << i)) )
+			continue;
+
+		if( field_size[i] == 4 )
+			CHECK(GetLE32(&payload[offset]) == values[i]);
+		else if( field_size[i] == 2 )
+			CHECK(GetLE16(&payload[offset]) == (uint16_t)values[i]);
+		else
+			CHECK(payload[offset] == (uint8_t)values[i]);
+		offset += field_size[i];
+	}
+	CHECK(offset == payload_length);
+
+	//only the fields that changed
+	length = ControlProtocolEncodeTelemetry(&protocol, frame, CONTROL_TELEMETRY_GROUP_PID, 0x0060, values, 0);
+	CHECK(length == CONTROL_HEADER_SIZE + 3 + 8 + CONTROL_CRC_SIZE);
+	CHECK(payload[0] == CONTROL_TELEMETRY_GROUP_PID);
+	CHECK(GetLE16(&payload[1]) == 0x0060);
+	CHECK(GetLE32(&payload[3]) == values[5]);
+	CHECK(GetLE32(&payload[7]) == values[6]);
+}
+
+static void TestConversions()
+{
+	CHECK(ConvertAngleToPIDInt(-1.0f) == -1000);
+	CHECK(ConvertAngleToPIDInt(-0.5f) == -500);
+	CHECK(ConvertAngleToPIDInt(0.0f) == 0);
+	CHECK(ConvertAngleToPIDInt(0.5f) == 500);
+	CHECK(ConvertAngleToPIDInt(1.0f) == 1000);
+	//truncated toward 0
+	CHECK(ConvertAngleToPIDInt(0.0015f) == 1);
+	CHECK(ConvertAngleToPIDInt(-0.0015f) == -1);
+
+	CHECK(ConvertSpeedToPIDInt(0.0f) == 0);
+	CHECK(ConvertSpeedToPIDInt(0.5f) == 500);
+	CHECK(ConvertSpeedToPIDInt(1.0f) == 1000);
+
+	//the brake's pressure and output, and the throttle and steering outputs
+	CHECK(ConvertDutyCycleToPIDInt(0.0f) == 0);
+	CHECK(ConvertDutyCycleToPIDInt(0.5f) == 500);
+	CHECK(ConvertDutyCycleToPIDInt(1.0f) == 1000);
+	CHECK(ConvertDutyCycleToPIDInt(-1.0f) == -1000);
+	CHECK(ConvertPIDIntToDutyCycle(0) == 0.0f);
+	CHECK(ConvertPIDIntToDutyCycle(500) == 0.5f);
+	CHECK(ConvertPIDIntToDutyCycle(1000) == 1.0f);
+	CHECK(ConvertPIDIntToDutyCycle(-1000) == -1.0f);
+
+	CHECK(ConvertRateToPIDInt(-1.0f) == -1000);
+	CHECK(ConvertRateToPIDInt(0.5f) == 500);
+	CHECK(ConvertPIDIntToRate(-500) == -0.5f);
+	CHECK(ConvertPIDIntToRate(1000) == 1.0f);
+}
+
+//volatile so the timed loops are not optimized away
+static volatile int sink;
+static volatile float float_sink;
+
+static void Report(const char* name, double seconds, long calls)
+{
+	printf("%-24s %8.2f ns/call\n", name, seconds * 1e9 / calls);
+}
+
+static void Benchmark(long calls)
+{
+	PIDController* c = createPIDController(1.5f, 0.01f, 0.2f, TestSource, TestOutput);
+	setOutputBounds(c, -1000, 1000);
+	double start = Seconds();
+	for(long i = 0; i < calls; ++i)
+	{
+		source_feedback = (int)(i & 1023);
+		tick(c);
+	}
+	Report("tick", Seconds() - start, calls);
+	free(c);
+
+	c = createPIDController(1.5f, 0.01f, 0.2f, NULL, NULL);
+	setOutputBounds(c, -1000, 1000);
+	start = Seconds();
+	for(long i = 0; i < calls; ++i)
+		sink = pid_step(c, 512, (int)(i & 1023), PID_DT_UNTIMED);
+	Report("pid_step", Seconds() - start, calls);
+
+	setFeedbackWrapBounds(c, 0, 1024);
+	start = Seconds();
+	for(long i = 0; i < calls; ++i)
+		sink = pid_step(c, 1000, (int)(i & 1023), PID_DT_UNTIMED);
+	Report("pid_step wrapped", Seconds() - start, calls);
+
+	start = Seconds();
+	for(long i = 0; i < calls; ++i)
+	{
+		c->currentFeedback = (int)(i & 1023);
+		sink = getWrappedError(c);
+	}
+	Report("getWrappedError", Seconds() - start, calls);
+	free(c);
+
+	start = Seconds();
+	for(long i = 0; i < calls; ++i)
+		float_sink = LinearlyInterpolate((float)(i & 1023), 0, 1024, -1, 1);
+	Report("LinearlyInterpolate", Seconds() - start, calls);
+}
+
+int main(int argc, char** argv)
+{
+	long calls = PID_TEST_DEFAULT_CALLS;
+	if( argc > 1 )
+		calls = atol(argv[1]);
+	if( calls <= 0 )
+	{
+		fprintf(stderr, "usage: PIDTest [calls]\n");
+		return 2;
+	}
+
+	TestTick();
+	TestOutputBounds();
+	TestWrap();
+	TestIntegralClamp();
+	TestLinearlyInterpolate();
+	TestCommandRoundTrip();
+	TestCommandRejected();
+	TestTelemetryRoundTrip();
+	TestConversions();
+	printf("%d check%s failed\n", failures, failures == 1 ? "" : "s");
+
+	Benchmark(calls);
+	return failures ? 1 : 0;
+}
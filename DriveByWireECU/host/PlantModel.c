@@ -0,0 +1,61 @@
+/*
+ * PlantModel.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include "PlantModel.h"
+
+void PlantDefaultParams(plant_params_t* params)
+{
+	params->steer_rate = 60.0f;
+	params->steer_tau = 0.05f;
+	params->steer_limit = 50.0f;
+	params->speed_gain = 6.0f;
+	params->speed_tau = 1.5f;
+	params->brake_decel = 4.0f;
+	params->brake_gain = 1.0f;
+	params->brake_tau = 0.03f;
+}
+
+void PlantInit(plant_t* plant, const plant_params_t* params)
+{
+	plant->params = *params;
+	plant->steer_rate = 0.0f;
+	plant->steering_angle = 0.0f;
+	plant->vehicle_speed = 0.0f;
+	plant->brake_pressure = 0.0f;
+}
+
+void PlantStep(plant_t* plant, const host_io_t* io, float dt)
+{
+	const plant_params_t* params = &plant->params;
+
+	float torque = io->steer_right ? -io->steering_torque : io->steering_torque;
+	plant->steer_rate += (params->steer_rate * torque - plant->steer_rate) * dt / params->steer_tau;
+	plant->steering_angle += plant->steer_rate * dt;
+	if( plant->steering_angle > params->steer_limit || plant->steering_angle < -params->steer_limit )
+	{
+		plant->steering_angle = plant->steering_angle > 0 ? params->steer_limit : -params->steer_limit;
+		plant->steer_rate = 0.0f;
+	}
+
+	float drive = io->reverse ? -io->acceleration : io->acceleration;
+	plant->vehicle_speed += (params->speed_gain * drive - plant->vehicle_speed) * dt / params->speed_tau;
+
+	plant->brake_pressure += (params->brake_gain * io->front_brake - plant->brake_pressure) * dt / params->brake_tau;
+	float braking = params->brake_decel * plant->brake_pressure * dt;
+	if( plant->vehicle_speed > braking )
+		plant->vehicle_speed -= braking;
+	else if( plant->vehicle_speed < -braking )
+		plant->vehicle_speed += braking;
+	else
+		plant->vehicle_speed = 0.0f;
+}
+
+void PlantSense(const plant_t* plant, host_io_t* io)
+{
+	io->steering_angle = plant->steering_angle;
+	io->vehicle_speed = plant->vehicle_speed;
+	io->brake_pressure = plant->brake_pressure;
+}
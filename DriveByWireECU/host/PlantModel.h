@@ -0,0 +1,70 @@
+/*
+ * PlantModel.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef PLANTMODEL_H_
+#define PLANTMODEL_H_
+
+#include "HostIO.h"
+
+//First-order models of the cart for closed-loop runs of the control core.
+//
+//Steering: the motor's rate follows the torque command with time constant
+//steer_tau, and the angle integrates it up to the mechanical stops. Steering
+//left, SetSteerDirection(0), raises the angle like the position sensor reads.
+//
+//Speed: the speed follows the drive command with time constant speed_tau
+//towards speed_gain times the duty cycle, backwards with reverse engaged.
+//The brake pressure follows brake_gain times the front brake duty with time
+//constant brake_tau, a brake_gain below 1 is a low battery or a worn
+//actuator. The pressure takes off up to brake_decel at full pressure
+//without ever reversing the cart.
+typedef struct plant_params_t
+{
+	//deg/s at full steering torque
+	float steer_rate;
+	//s
+	float steer_tau;
+	//deg, either side
+	float steer_limit;
+
+	//m/s at full throttle
+	float speed_gain;
+	//s
+	float speed_tau;
+	//m/s^2 at full brake pressure
+	float brake_decel;
+	//share of the full pressure at full duty
+	float brake_gain;
+	//s
+	float brake_tau;
+} plant_params_t;
+
+typedef struct plant_t
+{
+	plant_params_t params;
+	//deg/s
+	float steer_rate;
+	//deg
+	float steering_angle;
+	//m/s
+	float vehicle_speed;
+	//share of the full brake pressure
+	float brake_pressure;
+} plant_t;
+
+//Rough golf cart figures, replace with measured ones
+void PlantDefaultParams(plant_params_t* params);
+
+//At rest, wheels straight
+void PlantInit(plant_t* plant, const plant_params_t* params);
+
+//Advances the plant dt seconds under the outputs in io
+void PlantStep(plant_t* plant, const host_io_t* io, float dt);
+
+//Writes the plant's state to the sensor inputs of io
+void PlantSense(const plant_t* plant, host_io_t* io);
+
+#endif /* PLANTMODEL_H_ */
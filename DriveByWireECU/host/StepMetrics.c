@@ -0,0 +1,55 @@
+/*
+ * StepMetrics.c
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#include <math.h>
+#include "StepMetrics.h"
+
+void StepMetricsInit(step_metrics_t* metrics, float initial, float target, float settle_band)
+{
+	metrics->initial = initial;
+	metrics->target = target;
+	metrics->settle_band = settle_band;
+	metrics->rise_start = -1;
+	metrics->rise_end = -1;
+	metrics->last_outside = -1;
+	metrics->peak = 0.0f;
+	metrics->last = initial;
+	metrics->samples = 0;
+}
+
+void StepMetricsAdd(step_metrics_t* metrics, uint32_t time, float value)
+{
+	float step = metrics->target - metrics->initial;
+	//progress along the step, 0 at the start and 1 on the target
+	float progress = step != 0.0f ? (value - metrics->initial) / step : 1.0f;
+
+	if( metrics->rise_start < 0 && progress >= 0.1f )
+		metrics->rise_start = time;
+	if( metrics->rise_end < 0 && progress >= 0.9f )
+		metrics->rise_end = time;
+	if( progress > metrics->peak )
+		metrics->peak = progress;
+	if( fabsf(progress - 1.0f) > metrics->settle_band )
+		metrics->last_outside = time;
+
+	metrics->last = value;
+	metrics->samples++;
+}
+
+void StepMetricsResult(const step_metrics_t* metrics, step_result_t* result)
+{
+	result->rise_time = metrics->rise_end >= 0 ? metrics->rise_end - metrics->rise_start : -1;
+	result->overshoot = metrics->peak > 1.0f ? (metrics->peak - 1.0f) * 100.0f : 0.0f;
+
+	if( metrics->last_outside < 0 )
+		result->settling_time = 0;
+	else if( (uint32_t)metrics->last_outside + 1 >= metrics->samples )
+		result->settling_time = -1;
+	else
+		result->settling_time = metrics->last_outside + 1;
+
+	result->final_error = metrics->target - metrics->last;
+}
@@ -0,0 +1,54 @@
+/*
+ * StepMetrics.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef STEPMETRICS_H_
+#define STEPMETRICS_H_
+
+#include <stdint.h>
+
+//Step response figures, accumulated one sample at a time so a run needs no
+//history. One sample per ms, the first at 0 ms after the step.
+typedef struct step_metrics_t
+{
+	float initial;
+	float target;
+	//fraction of the step, either side of the target
+	float settle_band;
+
+	//-1 until reached
+	int32_t rise_start;
+	int32_t rise_end;
+	//the last time the response left the settling band, -1 if it never did
+	int32_t last_outside;
+	//furthest along the step, 1 on the target
+	float peak;
+	float last;
+	uint32_t samples;
+} step_metrics_t;
+
+typedef struct step_result_t
+{
+	//10% to 90% of the step, -1 if it never got there
+	int32_t rise_time;
+	//% of the step
+	float overshoot;
+	//time after which the response stayed within the band, -1 if it left
+	//the band in the last sample
+	int32_t settling_time;
+	//target minus the last sample
+	float final_error;
+} step_result_t;
+
+#define STEP_METRICS_DEFAULT_BAND 0.02f
+
+void StepMetricsInit(step_metrics_t* metrics, float initial, float target, float settle_band);
+
+//value time ms after the step
+void StepMetricsAdd(step_metrics_t* metrics, uint32_t time, float value);
+
+void StepMetricsResult(const step_metrics_t* metrics, step_result_t* result);
+
+#endif /* STEPMETRICS_H_ */
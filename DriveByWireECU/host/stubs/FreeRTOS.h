@@ -0,0 +1,23 @@
+/*
+ * FreeRTOS.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+#include <stdint.h>
+
+//Host build: only the types the control core's headers use. Nothing here
+//runs a scheduler, the host advances time itself.
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+//as in config/FreeRTOSConfig.h, for the task monitor's snapshot layout
+#define configMAX_TASK_NAME_LEN (8)
+
+#endif /* HOST_FREERTOS_H_ */
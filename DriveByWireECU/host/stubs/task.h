@@ -0,0 +1,12 @@
+/*
+ * task.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef HOST_TASK_H_
+#define HOST_TASK_H_
+
+#include "FreeRTOS.h"
+
+#endif /* HOST_TASK_H_ */
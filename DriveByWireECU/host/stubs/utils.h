@@ -0,0 +1,13 @@
+/*
+ * utils.h
+ *
+ * Created: 10/14/2026
+ *  Author: John Brooks
+ */
+#ifndef HOST_UTILS_H_
+#define HOST_UTILS_H_
+
+//Host build: code placement attributes only mean something on the target
+#define RAMFUNC
+
+#endif /* HOST_UTILS_H_ */
@@ -34,6 +34,7 @@
 #include <hpl_can_base.h>
 #include <hpl_can_config.h>
 #include <string.h>
+#include "RtosTrace.h"
 
 #ifdef CONF_CAN0_ENABLED
 COMPILER_ALIGNED(4)
@@ -60,6 +61,8 @@ static struct _can_async_device *_can0_dev     = NULL; /*!< Pointer to hpl devic
 COMPILER_ALIGNED(4)
 uint8_t can1_rx_fifo[CONF_CAN1_F0DS * CONF_CAN1_RXF0C_F0S];
 COMPILER_ALIGNED(4)
+uint8_t can1_rx_fifo1[CONF_CAN1_F1DS * CONF_CAN1_RXF1C_F1S];
+COMPILER_ALIGNED(4)
 uint8_t can1_tx_fifo[CONF_CAN1_TBDS * CONF_CAN1_TXBC_TFQS];
 COMPILER_ALIGNED(4)
 static struct _can_tx_event_entry can1_tx_event_fifo[CONF_CAN1_TXEFC_EFS];
@@ -122,6 +125,7 @@ int32_t _can_async_init(struct _can_async_device *const dev, void *const hw)
 		hri_can_write_NBTP_reg(dev->hw, CONF_CAN1_BTP_REG);
 		hri_can_write_DBTP_reg(dev->hw, CONF_CAN1_DBTP_REG);
 		hri_can_write_RXF0C_reg(dev->hw, CONF_CAN1_RXF0C_REG | CAN_RXF0C_F0SA((uint32_t)can1_rx_fifo));
+		hri_can_write_RXF1C_reg(dev->hw, CONF_CAN1_RXF1C_REG | CAN_RXF1C_F1SA((uint32_t)can1_rx_fifo1));
 		hri_can_write_RXESC_reg(dev->hw, CONF_CAN1_RXESC_REG);
 		hri_can_write_TXESC_reg(dev->hw, CONF_CAN1_TXESC_REG);
 		hri_can_write_TXBC_reg(dev->hw, CONF_CAN1_TXBC_REG | CAN_TXBC_TBSA((uint32_t)can1_tx_fifo));
@@ -130,6 +134,7 @@ int32_t _can_async_init(struct _can_async_device *const dev, void *const hw)
 		hri_can_write_SIDFC_reg(dev->hw, CONF_CAN1_SIDFC_REG | CAN_SIDFC_FLSSA((uint32_t)can1_rx_std_filter));
 		hri_can_write_XIDFC_reg(dev->hw, CONF_CAN1_XIDFC_REG | CAN_XIDFC_FLESA((uint32_t)can1_rx_ext_filter));
 		hri_can_write_XIDAM_reg(dev->hw, CONF_CAN1_XIDAM_REG);
+		hri_can_write_TSCC_reg(dev->hw, CONF_CAN1_TSCC_REG);
 
 		NVIC_DisableIRQ(CAN1_IRQn);
 		NVIC_ClearPendingIRQ(CAN1_IRQn);
@@ -175,28 +180,77 @@ int32_t _can_async_disable(struct _can_async_device *const dev)
 	return ERR_NONE;
 }
 
+/**
+ * \brief Copy a received FIFO element into a message
+ */
+/* Data bytes each DLC stands for */
+static const uint8_t _can_dlc2len[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+static void _can_read_entry(struct _can_rx_fifo_entry *f, struct can_message *msg)
+{
+	if (f->R0.bit.XTD == 1) {
+		msg->fmt = CAN_FMT_EXTID;
+		msg->id  = f->R0.bit.ID;
+	} else {
+		msg->fmt = CAN_FMT_STDID;
+		/* A standard identifier is stored into ID[28:18] */
+		msg->id = f->R0.bit.ID >> 18;
+	}
+
+	msg->type      = (f->R0.bit.RTR == 1) ? CAN_TYPE_REMOTE : CAN_TYPE_DATA;
+	msg->timestamp = f->R1.bit.RXTS;
+
+	msg->len       = _can_dlc2len[f->R1.bit.DLC];
+
+	memcpy(msg->data, f->data, msg->len);
+}
+
 /**
  * \brief Read a CAN message
  */
 int32_t _can_async_read(struct _can_async_device *const dev, struct can_message *msg)
 {
-	struct _can_rx_fifo_entry *f = NULL;
-	hri_can_rxf0s_reg_t        get_index;
+	int32_t rc = _can_async_read_fifo(dev, 0, msg);
 
-	if (!hri_can_read_RXF0S_F0FL_bf(dev->hw)) {
-		return ERR_NOT_FOUND;
+	if (rc == ERR_NOT_FOUND) {
+		rc = _can_async_read_fifo(dev, 1, msg);
 	}
 
-	get_index = hri_can_read_RXF0S_F0GI_bf(dev->hw);
+	return rc;
+}
+
+/**
+ * \brief Read a CAN message from the given RX FIFO
+ */
+int32_t _can_async_read_fifo(struct _can_async_device *const dev, uint8_t fifo, struct can_message *msg)
+{
+	struct _can_rx_fifo_entry *f = NULL;
+	uint32_t                   get_index;
+
+	if (fifo == 0) {
+		if (!hri_can_read_RXF0S_F0FL_bf(dev->hw)) {
+			return ERR_NOT_FOUND;
+		}
+		get_index = hri_can_read_RXF0S_F0GI_bf(dev->hw);
+	} else {
+		if (!hri_can_read_RXF1S_F1FL_bf(dev->hw)) {
+			return ERR_NOT_FOUND;
+		}
+		get_index = hri_can_read_RXF1S_F1GI_bf(dev->hw);
+	}
 
 #ifdef CONF_CAN0_ENABLED
-	if (dev->hw == CAN0) {
+	if (dev->hw == CAN0 && fifo == 0) {
 		f = (struct _can_rx_fifo_entry *)(can0_rx_fifo + get_index * CONF_CAN0_F0DS);
 	}
 #endif
 #ifdef CONF_CAN1_ENABLED
 	if (dev->hw == CAN1) {
-		f = (struct _can_rx_fifo_entry *)(can1_rx_fifo + get_index * CONF_CAN1_F0DS);
+		if (fifo == 0) {
+			f = (struct _can_rx_fifo_entry *)(can1_rx_fifo + get_index * CONF_CAN1_F0DS);
+		} else {
+			f = (struct _can_rx_fifo_entry *)(can1_rx_fifo1 + get_index * CONF_CAN1_F1DS);
+		}
 	}
 #endif
 
@@ -204,26 +258,56 @@ int32_t _can_async_read(struct _can_async_device *const dev, struct can_message
 		return ERR_NO_RESOURCE;
 	}
 
-	if (f->R0.bit.XTD == 1) {
-		msg->fmt = CAN_FMT_EXTID;
-		msg->id  = f->R0.bit.ID;
+	_can_read_entry(f, msg);
+
+	if (fifo == 0) {
+		hri_can_write_RXF0A_F0AI_bf(dev->hw, get_index);
 	} else {
-		msg->fmt = CAN_FMT_STDID;
-		/* A standard identifier is stored into ID[28:18] */
-		msg->id = f->R0.bit.ID >> 18;
+		hri_can_write_RXF1A_F1AI_bf(dev->hw, get_index);
 	}
 
-	if (f->R0.bit.RTR == 1) {
-		msg->type = CAN_TYPE_REMOTE;
-	}
+	return ERR_NONE;
+}
 
-	const uint8_t dlc2len[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
-	msg->len                = dlc2len[f->R1.bit.DLC];
+/**
+ * \brief Read the oldest entry of the Tx event FIFO
+ */
+int32_t _can_async_read_tx_event(struct _can_async_device *const dev, struct can_tx_event *event)
+{
+	struct _can_tx_event_entry *e = NULL;
+	uint32_t                    get_index;
 
-	memcpy(msg->data, f->data, msg->len);
+	if (!hri_can_read_TXEFS_EFFL_bf(dev->hw)) {
+		return ERR_NOT_FOUND;
+	}
+	get_index = hri_can_read_TXEFS_EFGI_bf(dev->hw);
 
-	hri_can_write_RXF0A_F0AI_bf(dev->hw, get_index);
+#ifdef CONF_CAN0_ENABLED
+	if (dev->hw == CAN0) {
+		e = &can0_tx_event_fifo[get_index];
+	}
+#endif
+#ifdef CONF_CAN1_ENABLED
+	if (dev->hw == CAN1) {
+		e = &can1_tx_event_fifo[get_index];
+	}
+#endif
+	if (e == NULL) {
+		return ERR_NO_RESOURCE;
+	}
 
+	if (e->R0.bit.XTD == 1) {
+		event->fmt = CAN_FMT_EXTID;
+		event->id  = e->R0.bit.ID;
+	} else {
+		event->fmt = CAN_FMT_STDID;
+		event->id  = e->R0.bit.ID >> 18;
+	}
+	event->len       = _can_dlc2len[e->R1.bit.DLC];
+	event->marker    = e->R1.bit.MM;
+	event->timestamp = e->R1.bit.TXTS;
+
+	hri_can_write_TXEFA_EFAI_bf(dev->hw, get_index);
 	return ERR_NONE;
 }
 
@@ -281,11 +365,23 @@ int32_t _can_async_write(struct _can_async_device *const dev, struct can_message
 		f->T1.bit.DLC = 0xF;
 	}
 
-	f->T1.bit.FDF = hri_can_get_CCCR_FDOE_bit(dev->hw);
-	f->T1.bit.BRS = hri_can_get_CCCR_BRSE_bit(dev->hw);
+	/* Only payloads that do not fit a classic frame are sent as CAN FD, so
+	 * classic nodes on the same bus keep seeing frames they understand */
+	f->T1.bit.FDF = hri_can_get_CCCR_FDOE_bit(dev->hw) && msg->len > 8;
+	f->T1.bit.BRS = f->T1.bit.FDF && hri_can_get_CCCR_BRSE_bit(dev->hw);
+
+	/* Logged in the Tx event FIFO once sent, marked with its element */
+	f->T1.bit.EFC = 1;
+	f->T1.bit.MM  = put_index;
 
 	memcpy(f->data, msg->data, msg->len);
 
+	/* Pad up to the length the DLC stands for, rather than sending
+	 * whatever the buffer element held before */
+	if (f->T1.bit.DLC > 8) {
+		memset(f->data + msg->len, 0, _can_dlc2len[f->T1.bit.DLC] - msg->len);
+	}
+
 	hri_can_write_TXBAR_reg(dev->hw, 1 << hri_can_read_TXFQS_TFQPI_bf(dev->hw));
 	return ERR_NONE;
 }
@@ -299,11 +395,12 @@ void _can_async_set_irq_state(struct _can_async_device *const dev, enum can_asyn
 
 	if (type == CAN_ASYNC_RX_CB) {
 		hri_can_write_IE_RF0NE_bit(dev->hw, state);
+		hri_can_write_IE_RF1NE_bit(dev->hw, state);
 	} else if (type == CAN_ASYNC_TX_CB) {
 		hri_can_write_IE_TCE_bit(dev->hw, state);
 		hri_can_write_TXBTIE_reg(dev->hw, CAN_TXBTIE_MASK);
 	} else if (type == CAN_ASYNC_IRQ_CB) {
-		ie = hri_can_get_IE_reg(dev->hw, CAN_IE_RF0NE | CAN_IE_TCE);
+		ie = hri_can_get_IE_reg(dev->hw, CAN_IE_RF0NE | CAN_IE_RF1NE | CAN_IE_TCE);
 		hri_can_write_IE_reg(dev->hw, ie | CONF_CAN0_IE_REG);
 	}
 
@@ -352,10 +449,19 @@ int32_t _can_async_set_mode(struct _can_async_device *const dev, enum can_mode m
 }
 
 /**
- * \brief Set CAN to the specified mode
+ * \brief Set CAN filter, matching messages are stored in RX FIFO 0
  */
 int32_t _can_async_set_filter(struct _can_async_device *const dev, uint8_t index, enum can_format fmt,
                               struct can_filter *filter)
+{
+	return _can_async_set_filter_fifo(dev, index, fmt, filter, 0);
+}
+
+/**
+ * \brief Set CAN filter storing matching messages in the given RX FIFO
+ */
+int32_t _can_async_set_filter_fifo(struct _can_async_device *const dev, uint8_t index, enum can_format fmt,
+                                   struct can_filter *filter, uint8_t fifo)
 {
 	struct _can_standard_message_filter_element *sf;
 	struct _can_extended_message_filter_element *ef;
@@ -371,14 +477,14 @@ int32_t _can_async_set_filter(struct _can_async_device *const dev, uint8_t index
 		sf->S0.val       = filter->mask;
 		sf->S0.bit.SFID1 = filter->id;
 		sf->S0.bit.SFT   = _CAN_SFT_CLASSIC;
-		sf->S0.bit.SFEC  = _CAN_SFEC_STF0M;
+		sf->S0.bit.SFEC  = (fifo == 0) ? _CAN_SFEC_STF0M : _CAN_SFEC_STF1M;
 	} else if (fmt == CAN_FMT_EXTID) {
 		if (filter == NULL) {
 			ef->F0.val = 0;
 			return ERR_NONE;
 		}
 		ef->F0.val      = filter->id;
-		ef->F0.bit.EFEC = _CAN_EFEC_STF0M;
+		ef->F0.bit.EFEC = (fifo == 0) ? _CAN_EFEC_STF0M : _CAN_EFEC_STF1M;
 		ef->F1.val      = filter->mask;
 		ef->F1.bit.EFT  = _CAN_EFT_CLASSIC;
 	}
@@ -393,9 +499,13 @@ void CAN1_Handler(void)
 {
 	struct _can_async_device *dev = _can1_dev;
 	uint32_t                  ir;
+	RTOS_TRACE_ISR_ENTER();
 	ir = hri_can_read_IR_reg(dev->hw);
+	/* Acknowledge first, so a message arriving while the FIFOs are drained
+	 * raises the interrupt again instead of being cleared with this one */
+	hri_can_write_IR_reg(dev->hw, ir);
 
-	if (ir & CAN_IR_RF0N) {
+	if (ir & (CAN_IR_RF0N | CAN_IR_RF1N)) {
 		dev->cb.rx_done(dev);
 	}
 
@@ -415,9 +525,8 @@ void CAN1_Handler(void)
 		dev->cb.irq_handler(dev, hri_can_get_PSR_EP_bit(dev->hw) ? CAN_IRQ_EP : CAN_IRQ_EA);
 	}
 
-	if (ir & CAN_IR_RF0L) {
+	if (ir & (CAN_IR_RF0L | CAN_IR_RF1L)) {
 		dev->cb.irq_handler(dev, CAN_IRQ_DO);
 	}
-
-	hri_can_write_IR_reg(dev->hw, ir);
+	RTOS_TRACE_ISR_EXIT();
 }
@@ -35,6 +35,13 @@
 #include <utils_assert.h>
 #include <hpl_mac_async.h>
 #include <hpl_gmac_config.h>
+#include "FastCode.h"
+#include "NetMem.h"
+#include "Profiler.h"
+#include "RtosTrace.h"
+
+//descriptor handling of every frame
+FAST_CODE_FILE
 
 /**
  * @brief Transmit buffer descriptor
@@ -92,15 +99,22 @@ struct _mac_rxbuf_descriptor {
 	} status;
 };
 
-/* Transmit and Receive buffer descriptor array */
+/* Transmit and Receive buffer descriptor array, in the DMA section. Not
+ * zeroed at startup, _mac_init_bufdescr writes every descriptor. */
+COMPILER_SECTION(CONF_GMAC_DMA_SECTION ".descrs")
 COMPILER_ALIGNED(8) static struct _mac_txbuf_descriptor _txbuf_descrs[CONF_GMAC_TXDESCR_NUM];
+COMPILER_SECTION(CONF_GMAC_DMA_SECTION ".descrs")
 COMPILER_ALIGNED(8) static struct _mac_rxbuf_descriptor _rxbuf_descrs[CONF_GMAC_RXDESCR_NUM];
 
 /* Transmit buffer data array */
-COMPILER_ALIGNED(32)
+COMPILER_SECTION(CONF_GMAC_DMA_SECTION ".txbuf")
+COMPILER_ALIGNED(CONF_GMAC_DMA_ALIGN)
 static uint8_t _txbuf[CONF_GMAC_TXDESCR_NUM][CONF_GMAC_TXBUF_SIZE];
-COMPILER_ALIGNED(32)
+#if !CONF_GMAC_RX_ZERO_COPY
+COMPILER_SECTION(CONF_GMAC_DMA_SECTION ".rxbuf")
+COMPILER_ALIGNED(CONF_GMAC_DMA_ALIGN)
 static uint8_t _rxbuf[CONF_GMAC_RXDESCR_NUM][CONF_GMAC_RXBUF_SIZE];
+#endif
 
 COMPILER_PACK_RESET()
 
@@ -112,6 +126,26 @@ static volatile uint32_t _txbuf_index;
 static volatile uint32_t _last_txbuf_index;
 static volatile uint32_t _rxbuf_index;
 
+#if CONF_GMAC_TX_SCATTER_GATHER
+/* Oldest transmit descriptor not yet reclaimed, and how many are queued */
+static volatile uint32_t _txdone_index;
+static volatile uint32_t _txqueued_count;
+#endif
+
+#if CONF_GMAC_RX_ZERO_COPY
+/* Next receive descriptor to be given a buffer, and how many have none.
+ * The descriptors without a buffer always follow the ones with a buffer. */
+static volatile uint32_t _rxfill_index;
+static volatile uint32_t _rxempty_count;
+#endif
+
+/* Ring statistics, the GMAC's own counters are added when they are read */
+static struct mac_async_ring_stats _ring_stats;
+
+/* The DMA stopped or overran since the head of the ring last held a frame,
+ * it may have gone on past the head */
+static volatile bool _rx_resync;
+
 /**
  * \internal Initialize the Transmit and receive buffer descriptor array
  *
@@ -131,15 +165,35 @@ static void _mac_init_bufdescr(struct _mac_async_device *const dev)
 	_txbuf_descrs[CONF_GMAC_TXDESCR_NUM - 1].status.bm.wrap = 1;
 	_txbuf_index                                            = 0;
 	_last_txbuf_index                                       = 0;
+#if CONF_GMAC_TX_SCATTER_GATHER
+	_txdone_index   = 0;
+	_txqueued_count = 0;
+#endif
 
 	/* RX buffer descriptor */
 	for (i = 0; i < CONF_GMAC_RXDESCR_NUM; i++) {
+#if CONF_GMAC_RX_ZERO_COPY
+		/* Owned by software until a buffer is given, so the DMA stops here */
+		_rxbuf_descrs[i].address.val          = 0;
+		_rxbuf_descrs[i].address.bm.ownership = 1;
+#else
 		_rxbuf_descrs[i].address.val = (uint32_t)_rxbuf[i];
-		_rxbuf_descrs[i].status.val  = 0;
+#endif
+		_rxbuf_descrs[i].status.val = 0;
 	}
 
 	_rxbuf_descrs[CONF_GMAC_RXDESCR_NUM - 1].address.bm.wrap = 1;
 	_rxbuf_index                                             = 0;
+#if CONF_GMAC_RX_ZERO_COPY
+	_rxfill_index  = 0;
+	_rxempty_count = CONF_GMAC_RXDESCR_NUM;
+#endif
+
+	memset(&_ring_stats, 0, sizeof(_ring_stats));
+	_ring_stats.rx_descriptors = CONF_GMAC_RXDESCR_NUM;
+	_ring_stats.rx_filled_min  = CONF_GMAC_RXDESCR_NUM;
+	_ring_stats.tx_descriptors = CONF_GMAC_TXDESCR_NUM;
+	_rx_resync                 = false;
 
 	hri_gmac_write_TBQB_reg(dev->hw, (uint32_t)_txbuf_descrs);
 	hri_gmac_write_RBQB_reg(dev->hw, (uint32_t)_rxbuf_descrs);
@@ -152,7 +206,9 @@ void GMAC_Handler(void)
 {
 	volatile uint32_t tsr;
 	volatile uint32_t rsr;
+	uint32_t          start = ProfilerStart();
 
+	RTOS_TRACE_ISR_ENTER();
 	tsr = hri_gmac_read_TSR_reg(_gmac_dev->hw);
 	rsr = hri_gmac_read_RSR_reg(_gmac_dev->hw);
 	/* Must be Clear ISR (Clear on read) */
@@ -172,7 +228,11 @@ void GMAC_Handler(void)
 			_gmac_dev->cb.received(_gmac_dev);
 		}
 	}
-	hri_gmac_write_RSR_reg(_gmac_dev->hw, rsr);
+	/* Buffer not available and overrun stay set for _mac_rx_stalled, which
+	 * also sees them while receive complete is masked */
+	hri_gmac_write_RSR_reg(_gmac_dev->hw, rsr & ~(GMAC_RSR_BNA | GMAC_RSR_RXOVR));
+	ProfilerEnd(PROFILER_STAGE_GMAC_ISR, start);
+	RTOS_TRACE_ISR_EXIT();
 }
 
 int32_t _mac_async_init(struct _mac_async_device *const dev, void *const hw)
@@ -242,6 +302,13 @@ int32_t _mac_async_disable(struct _mac_async_device *const dev)
 
 int32_t _mac_async_write(struct _mac_async_device *const dev, uint8_t *buf, uint32_t len)
 {
+#if CONF_GMAC_TX_SCATTER_GATHER
+	/* Frames queued here would never be reclaimed, use _mac_async_write_sg */
+	(void)dev;
+	(void)buf;
+	(void)len;
+	return ERR_UNSUPPORTED_OP;
+#else
 	uint32_t pos;
 	uint32_t blen;
 	uint32_t i;
@@ -288,7 +355,7 @@ int32_t _mac_async_write(struct _mac_async_device *const dev, uint8_t *buf, uint
 	/* Write data to transmit buffer */
 	for (i = 0; i < CONF_GMAC_TXDESCR_NUM; i++) {
 		blen = min(len, CONF_GMAC_TXBUF_SIZE);
-		memcpy(_txbuf[_txbuf_index], buf + (i * CONF_GMAC_TXBUF_SIZE), blen);
+		NET_MEMCPY(_txbuf[_txbuf_index], buf + (i * CONF_GMAC_TXBUF_SIZE), blen);
 		len -= blen;
 
 		if (len > 0) {
@@ -315,10 +382,189 @@ int32_t _mac_async_write(struct _mac_async_device *const dev, uint8_t *buf, uint
 	hri_gmac_set_NCR_reg(dev->hw, GMAC_NCR_TSTART);
 
 	return ERR_NONE;
+#endif
+}
+
+#if CONF_GMAC_TX_SCATTER_GATHER
+/**
+ * \internal Fill one transmit descriptor, leaving it owned by software
+ */
+static inline void _mac_fill_txdescr(uint32_t index, uint8_t *buf, uint32_t len)
+{
+	union gmac_tx_status status;
+
+	status.val     = 0;
+	status.bm.len  = len;
+	status.bm.wrap = (index == CONF_GMAC_TXDESCR_NUM - 1);
+	status.bm.used = 1;
+
+	_txbuf_descrs[index].address    = (uint32_t)buf;
+	_txbuf_descrs[index].status.val = status.val;
+}
+#endif
+
+int32_t _mac_async_write_sg(struct _mac_async_device *const dev, const struct mac_async_tx_segment *segs,
+                            uint32_t count)
+{
+#if CONF_GMAC_TX_SCATTER_GATHER
+	uint32_t needed = 0;
+	uint32_t first  = _txbuf_index;
+	uint32_t index  = first;
+	uint32_t last   = first;
+	uint32_t i;
+	uint32_t pos;
+	uint32_t blen;
+
+	for (i = 0; i < count; i++) {
+		if (segs[i].copy) {
+			needed += (segs[i].len + CONF_GMAC_TXBUF_SIZE - 1) / CONF_GMAC_TXBUF_SIZE;
+		} else {
+			needed++;
+		}
+	}
+
+	if (needed == 0 || needed > CONF_GMAC_TXDESCR_NUM - _txqueued_count) {
+		_ring_stats.tx_full++;
+		return ERR_NO_RESOURCE;
+	}
+
+	for (i = 0; i < count; i++) {
+		for (pos = 0; pos < segs[i].len; pos += blen) {
+			if (segs[i].copy) {
+				blen = min(segs[i].len - pos, CONF_GMAC_TXBUF_SIZE);
+				NET_MEMCPY(_txbuf[index], segs[i].buf + pos, blen);
+				_mac_fill_txdescr(index, _txbuf[index], blen);
+			} else {
+				blen = segs[i].len;
+				_mac_fill_txdescr(index, segs[i].buf, blen);
+			}
+
+			last = index;
+			index++;
+			if (index == CONF_GMAC_TXDESCR_NUM) {
+				index = 0;
+			}
+		}
+	}
+
+	_txbuf_descrs[last].status.bm.last_buf = 1;
+
+	/* Hand the rest of the frame over before the first descriptor, the DMA
+	 * starts on the frame as soon as the first used flag is clear */
+	for (pos = first; pos != last;) {
+		pos++;
+		if (pos == CONF_GMAC_TXDESCR_NUM) {
+			pos = 0;
+		}
+		_txbuf_descrs[pos].status.bm.used = 0;
+	}
+	__DMB();
+	_txbuf_descrs[first].status.bm.used = 0;
+
+	_txqueued_count += needed;
+	_txbuf_index = index;
+	if (_txqueued_count > _ring_stats.tx_queued_max) {
+		_ring_stats.tx_queued_max = _txqueued_count;
+	}
+
+	/* Data synchronization barrier */
+	__DSB();
+
+	/* Active Transmit */
+	hri_gmac_set_NCR_reg(dev->hw, GMAC_NCR_TSTART);
+
+	return ERR_NONE;
+#else
+	(void)dev;
+	(void)segs;
+	(void)count;
+	return ERR_UNSUPPORTED_OP;
+#endif
+}
+
+uint32_t _mac_async_tx_reclaim(struct _mac_async_device *const dev)
+{
+	uint32_t frames = 0;
+#if CONF_GMAC_TX_SCATTER_GATHER
+	bool last;
+
+	(void)dev;
+
+	/* The DMA only sets the used flag of the first descriptor of a frame */
+	while (_txqueued_count > 0 && _txbuf_descrs[_txdone_index].status.bm.used) {
+		do {
+			last = _txbuf_descrs[_txdone_index].status.bm.last_buf;
+
+			_txbuf_descrs[_txdone_index].status.bm.used = 1;
+			_txqueued_count--;
+			_txdone_index++;
+			if (_txdone_index == CONF_GMAC_TXDESCR_NUM) {
+				_txdone_index = 0;
+			}
+		} while (!last);
+
+		frames++;
+	}
+#else
+	(void)dev;
+#endif
+	return frames;
+}
+
+/**
+ * \internal Whether the ring has to be checked for having fallen behind the
+ * DMA: the DMA found no buffer or overran its FIFO since the head of the ring
+ * last held a frame. Clears and counts the status bits.
+ */
+static bool _mac_rx_stalled(struct _mac_async_device *const dev)
+{
+	uint32_t rsr = hri_gmac_read_RSR_reg(dev->hw) & (GMAC_RSR_BNA | GMAC_RSR_RXOVR);
+
+	if (rsr) {
+		hri_gmac_write_RSR_reg(dev->hw, rsr);
+		_ring_stats.rx_stalls++;
+		_rx_resync = true;
+	}
+	return _rx_resync;
+}
+
+/**
+ * \internal Descriptors from the head of the ring, which the DMA has not
+ * handed over, to the first later one it has handed over with the start of
+ * a frame: the DMA went on past the head, and the ring would wait at it
+ * forever. 0 when the ring is in step.
+ *
+ * \param[in] limit Descriptors after the head that can hold a frame
+ */
+static uint32_t _mac_rx_resync_offset(uint32_t limit)
+{
+	uint32_t i;
+	uint32_t pos;
+
+	for (i = 1; i < limit; i++) {
+		pos = _rxbuf_index + i;
+		if (pos >= CONF_GMAC_RXDESCR_NUM) {
+			pos -= CONF_GMAC_RXDESCR_NUM;
+		}
+		if (_rxbuf_descrs[pos].address.bm.ownership) {
+			__DMB();
+			if (_rxbuf_descrs[pos].status.bm.sof) {
+				return i;
+			}
+		}
+	}
+	return 0;
 }
 
 uint32_t _mac_async_read(struct _mac_async_device *const dev, uint8_t *buf, uint32_t len)
 {
+#if CONF_GMAC_RX_ZERO_COPY
+	/* Frames are only available through _mac_async_rx_take */
+	(void)dev;
+	(void)buf;
+	(void)len;
+	return 0;
+#else
 	uint32_t i;
 	uint32_t j;
 	uint32_t pos;
@@ -366,7 +612,7 @@ uint32_t _mac_async_read(struct _mac_async_device *const dev, uint8_t *buf, uint
 	for (i = 0; i < j; i++) {
 		if (eof != 0xFFFFFFFF && i >= sof && i <= eof && len > 0) {
 			n = min(len, CONF_GMAC_RXBUF_SIZE);
-			memcpy(buf, _rxbuf[_rxbuf_index], n);
+			NET_MEMCPY(buf, _rxbuf[_rxbuf_index], n);
 			buf += n;
 			total_len += n;
 			len -= n;
@@ -381,16 +627,36 @@ uint32_t _mac_async_read(struct _mac_async_device *const dev, uint8_t *buf, uint
 	}
 
 	return total_len;
+#endif
 }
 
 uint32_t _mac_async_read_len(struct _mac_async_device *const dev)
 {
+#if CONF_GMAC_RX_ZERO_COPY
+	(void)dev;
+	return 0;
+#else
 	uint32_t i;
 	uint32_t pos;
 	bool     sof       = false; /* Start of Frame */
 	uint32_t total_len = 0;     /* Total length of received package */
 
-	(void)dev;
+	/* Behind the DMA the descriptors skipped are only given back, their
+	 * ownership bits are already clear */
+	if (!_rxbuf_descrs[_rxbuf_index].address.bm.ownership) {
+		if (_mac_rx_stalled(dev)) {
+			i = _mac_rx_resync_offset(CONF_GMAC_RXDESCR_NUM);
+			if (i != 0) {
+				_rxbuf_index = (_rxbuf_index + i) % CONF_GMAC_RXDESCR_NUM;
+				_ring_stats.rx_resyncs++;
+				_rx_resync = false;
+			}
+		}
+		if (!_rxbuf_descrs[_rxbuf_index].address.bm.ownership) {
+			return 0;
+		}
+	}
+	_rx_resync = false;
 
 	for (i = 0; i < CONF_GMAC_RXDESCR_NUM; i++) {
 		pos = _rxbuf_index + i;
@@ -418,6 +684,142 @@ uint32_t _mac_async_read_len(struct _mac_async_device *const dev)
 	}
 
 	return total_len;
+#endif
+}
+
+int32_t _mac_async_rx_give(struct _mac_async_device *const dev, uint8_t *buf)
+{
+#if CONF_GMAC_RX_ZERO_COPY
+	union _gmac_rx_addr addr;
+	uint32_t            index = _rxfill_index;
+
+	(void)dev;
+
+	if (_rxempty_count == 0) {
+		return -1;
+	}
+
+	_rxbuf_descrs[index].status.val = 0;
+
+	addr.val          = (uint32_t)buf;
+	addr.bm.wrap      = (index == CONF_GMAC_RXDESCR_NUM - 1);
+	addr.bm.ownership = 0;
+
+	/* Address, wrap and ownership go out in one store, the DMA may use the
+	 * descriptor as soon as it sees the ownership bit cleared */
+	__DMB();
+	_rxbuf_descrs[index].address.val = addr.val;
+
+	_rxempty_count--;
+	_rxfill_index = (index + 1 == CONF_GMAC_RXDESCR_NUM) ? 0 : index + 1;
+
+	return index;
+#else
+	(void)dev;
+	(void)buf;
+	return -1;
+#endif
+}
+
+int32_t _mac_async_rx_take(struct _mac_async_device *const dev, uint32_t *len, uint32_t *count)
+{
+#if CONF_GMAC_RX_ZERO_COPY
+	uint32_t index  = _rxbuf_index;
+	uint32_t filled = CONF_GMAC_RXDESCR_NUM - _rxempty_count;
+	uint32_t pos    = index;
+	uint32_t next;
+	uint32_t n;
+
+	if (filled == 0) {
+		return -1;
+	}
+	if (!_rxbuf_descrs[index].address.bm.ownership) {
+		/* Behind the DMA the descriptors skipped are taken back from it and
+		 * handed up as a broken frame, their buffers go back to the pool */
+		if (!_mac_rx_stalled(dev) || (n = _mac_rx_resync_offset(filled)) == 0) {
+			return -1;
+		}
+		for (pos = 0; pos < n; pos++) {
+			_rxbuf_descrs[(index + pos) % CONF_GMAC_RXDESCR_NUM].address.bm.ownership = 1;
+		}
+		__DMB();
+		_ring_stats.rx_resyncs++;
+		_ring_stats.rx_broken++;
+		_rx_resync = false;
+		*len   = 0;
+		*count = n;
+		_rxempty_count += n;
+		_rxbuf_index = (index + n) % CONF_GMAC_RXDESCR_NUM;
+		return index;
+	}
+	_rx_resync = false;
+
+	/* Make sure the status is read after the ownership bit */
+	__DMB();
+
+	/* The DMA hands a frame over buffer by buffer, it is whole once the
+	 * buffer with the end of frame is owned by software. A buffer without
+	 * the start of frame, or a new start before the end, is what is left of
+	 * a frame the DMA gave up on: it is taken alone or up to that start and
+	 * handed back. */
+	*len = 0;
+	n    = 1;
+	if (_rxbuf_descrs[pos].status.bm.sof) {
+		while (!_rxbuf_descrs[pos].status.bm.eof) {
+			if (n == filled) {
+				/* The rest of the frame needs buffers still to be given,
+				 * unless every descriptor already has one */
+				if (filled < CONF_GMAC_RXDESCR_NUM) {
+					return -1;
+				}
+				break;
+			}
+			next = (pos + 1 == CONF_GMAC_RXDESCR_NUM) ? 0 : pos + 1;
+			if (!_rxbuf_descrs[next].address.bm.ownership) {
+				return -1;
+			}
+			__DMB();
+			if (_rxbuf_descrs[next].status.bm.sof) {
+				break;
+			}
+			pos = next;
+			n++;
+		}
+		if (_rxbuf_descrs[pos].status.bm.eof) {
+			*len = _rxbuf_descrs[pos].status.bm.len;
+		}
+	}
+	if (*len != 0 && n > 1) {
+		_ring_stats.rx_chained++;
+	}
+	if (*len == 0) {
+		_ring_stats.rx_broken++;
+	}
+	_ring_stats.rx_frames++;
+	if (filled < _ring_stats.rx_filled_min) {
+		_ring_stats.rx_filled_min = filled;
+	}
+
+	/* The descriptors stay owned by software until given new buffers */
+	*count = n;
+	_rxempty_count += n;
+	_rxbuf_index = (index + n) % CONF_GMAC_RXDESCR_NUM;
+
+	return index;
+#else
+	(void)dev;
+	(void)len;
+	(void)count;
+	return -1;
+#endif
+}
+
+void _mac_async_get_ring_stats(struct _mac_async_device *const dev, struct mac_async_ring_stats *stats)
+{
+	/* Both clear on read and saturate, read often enough that they never do */
+	_ring_stats.rx_overruns += hri_gmac_read_ROE_reg(dev->hw);
+	_ring_stats.rx_no_buffer += hri_gmac_read_RRE_reg(dev->hw);
+	*stats = _ring_stats;
 }
 
 void _mac_async_enable_irq(struct _mac_async_device *const dev)
@@ -502,6 +904,14 @@ int32_t _mac_async_set_filter_ex(struct _mac_async_device *const dev, uint8_t ma
 	return ERR_NONE;
 }
 
+int32_t _mac_async_write_hash(struct _mac_async_device *const dev, uint64_t hash)
+{
+	hri_gmac_write_HRB_reg(dev->hw, (uint32_t)hash);
+	hri_gmac_write_HRT_reg(dev->hw, (uint32_t)(hash >> 32));
+
+	return ERR_NONE;
+}
+
 int32_t _mac_async_write_phy_reg(struct _mac_async_device *const dev, uint16_t addr, uint16_t reg, uint16_t data)
 {
 	hri_gmac_set_NCR_reg(dev->hw, GMAC_NCR_MPE);
@@ -40,7 +40,105 @@
 #include <lwip/snmp.h>
 #include "netif/etharp.h"
 #include "netif/ppp_oe.h"
+#include "lwip/igmp.h"
 #include <string.h>
+#include <hpl_gmac_config.h>
+#include "FastCode.h"
+#include "NetLatency.h"
+
+//every frame in and out goes through here
+FAST_CODE_FILE
+
+#if CONF_GMAC_RX_ZERO_COPY
+#if CONF_GMAC_NCFGR_RXBUFO != ETH_PAD_SIZE
+#error "GMAC receive buffer offset must match ETH_PAD_SIZE"
+#endif
+#if PBUF_POOL_BUFSIZE < CONF_GMAC_RXBUF_SIZE
+#error "A pool pbuf must hold a whole GMAC receive buffer"
+#endif
+#if PBUF_POOL_SIZE <= CONF_GMAC_RXDESCR_NUM
+#error "The pbuf pool must fill every receive descriptor and have pbufs left for the stack"
+#endif
+
+/* Pool pbuf whose payload is attached to each receive descriptor */
+static struct pbuf *rx_pbufs[CONF_GMAC_RXDESCR_NUM];
+static u16_t        rx_pbufs_given;
+
+static void low_level_rx_refill(struct mac_async_descriptor *mac);
+#endif
+
+#if CONF_GMAC_TX_SCATTER_GATHER
+/* Frames queued on the GMAC, oldest first, freed once sent */
+static struct pbuf *tx_pbufs[CONF_GMAC_TXDESCR_NUM];
+static u16_t        tx_pbufs_head;
+static u16_t        tx_pbufs_count;
+#endif
+
+#if LWIP_IGMP
+/* Groups joined per bin of the GMAC hash filter, several groups can share a bin */
+static u8_t hash_refs[64];
+
+/**
+ * Bin of the GMAC hash filter for a MAC address: bit n of the bin is the
+ * XOR of address bits n, n + 6, ... n + 42, counting from the LSB of the
+ * first byte.
+ */
+static u8_t low_level_hash_index(const u8_t *mac)
+{
+	u8_t index = 0;
+	u8_t bit;
+
+	for (bit = 0; bit < 48; bit++) {
+		if (mac[bit / 8] & (1 << (bit % 8))) {
+			index ^= 1 << (bit % 6);
+		}
+	}
+	return index;
+}
+
+/**
+ * igmp_mac_filter of the netif, lets the multicast MAC address of group
+ * through the hash filter while at least one group mapping to its bin is
+ * joined. Bins are shared, so ip_input still drops datagrams for groups
+ * that were not joined.
+ */
+static err_t low_level_igmp_mac_filter(struct netif *netif, ip_addr_t *group, u8_t action)
+{
+	struct mac_async_descriptor *mac = (struct mac_async_descriptor *)(netif->state);
+	u32_t                        addr = ntohl(ip4_addr_get_u32(group));
+	u8_t                         hwaddr[ETHARP_HWADDR_LEN];
+	uint64_t                     hash = 0;
+	u8_t                         index;
+	u8_t                         i;
+
+	/* 01:00:5e followed by the low 23 bits of the group */
+	hwaddr[0] = 0x01;
+	hwaddr[1] = 0x00;
+	hwaddr[2] = 0x5e;
+	hwaddr[3] = (addr >> 16) & 0x7f;
+	hwaddr[4] = (addr >> 8) & 0xff;
+	hwaddr[5] = addr & 0xff;
+	index     = low_level_hash_index(hwaddr);
+
+	if (action == IGMP_ADD_MAC_FILTER) {
+		if (hash_refs[index] == 0xff) {
+			return ERR_MEM;
+		}
+		hash_refs[index]++;
+	} else if (hash_refs[index] > 0) {
+		hash_refs[index]--;
+	}
+
+	for (i = 0; i < 64; i++) {
+		if (hash_refs[i] != 0) {
+			hash |= (uint64_t)1 << i;
+		}
+	}
+	mac_async_write_hash(mac, hash);
+
+	return ERR_OK;
+}
+#endif
 
 /**
  * \brief Initialize the MAC hardware
@@ -56,8 +154,176 @@ void mac_low_level_init(struct netif *netif)
 	memcpy(filter.mac, netif->hwaddr, NETIF_MAX_HWADDR_LEN);
 	filter.tid_enable = false;
 	mac_async_set_filter(mac, 0, &filter);
+
+#if LWIP_IGMP
+	/* nothing gets through the hash filter until a group is joined */
+	memset(hash_refs, 0, sizeof(hash_refs));
+	mac_async_write_hash(mac, 0);
+	netif_set_igmp_mac_filter(netif, low_level_igmp_mac_filter);
+#endif
+
+#if CONF_GMAC_RX_ZERO_COPY
+	low_level_rx_refill(mac);
+#endif
+}
+
+#if CONF_GMAC_TX_SCATTER_GATHER
+/**
+ * Frees the pbufs of frames the GMAC has finished sending.
+ */
+static void low_level_tx_reclaim(struct mac_async_descriptor *mac)
+{
+	uint32_t frames = mac_async_tx_reclaim(mac);
+
+	while (frames-- > 0 && tx_pbufs_count > 0) {
+		pbuf_free(tx_pbufs[tx_pbufs_head]);
+		tx_pbufs[tx_pbufs_head] = NULL;
+		tx_pbufs_head           = (tx_pbufs_head + 1) % CONF_GMAC_TXDESCR_NUM;
+		tx_pbufs_count--;
+	}
 }
 
+/**
+ * Hands the segments of a frame to the GMAC and keeps a reference on frame
+ * until it has been sent. The caller owns that reference up to here and
+ * has to drop it when this fails.
+ */
+static err_t low_level_queue(struct mac_async_descriptor *mac, struct pbuf *frame, struct mac_async_tx_segment *segs,
+                             uint32_t count)
+{
+	if (tx_pbufs_count == CONF_GMAC_TXDESCR_NUM || mac_async_write_sg(mac, segs, count) != ERR_NONE) {
+		LINK_STATS_INC(link.drop);
+		return ERR_MEM;
+	}
+
+	tx_pbufs[(tx_pbufs_head + tx_pbufs_count) % CONF_GMAC_TXDESCR_NUM] = frame;
+	tx_pbufs_count++;
+
+	LINK_STATS_INC(link.xmit);
+
+	return ERR_OK;
+}
+
+/**
+ * PBUF_ROM segments in SRAM are only made by tcp_write without
+ * TCP_WRITE_FLAG_COPY, whose caller keeps the data until it has been
+ * acknowledged, which is after it has been sent: the DMA reads them in place
+ * (BulkChannel.c sends the PID trace that way). Those in flash are copied.
+ */
+static inline bool pbuf_needs_copy(const struct pbuf *q)
+{
+	if (q->type == PBUF_REF) {
+		return true;
+	}
+	if (q->type == PBUF_ROM) {
+		return (uint32_t)q->payload < HSRAM_ADDR || (uint32_t)q->payload >= HSRAM_ADDR + HSRAM_SIZE;
+	}
+	return false;
+}
+
+/**
+ * Queues the pbuf chain with one GMAC transmit descriptor per segment, the
+ * chain is referenced until the frame has been sent. PBUF_REF segments point
+ * at memory the caller gets back as soon as this returns (e.g. the data
+ * passed to lwip_sendto), and PBUF_ROM data may live in flash, so those are
+ * copied into the driver's buffers (see pbuf_needs_copy).
+ * Chains with more segments than there are descriptors are flattened into a
+ * single PBUF_RAM first.
+ */
+err_t mac_low_level_output(struct netif *netif, struct pbuf *p)
+{
+	struct mac_async_descriptor *mac;
+	struct mac_async_tx_segment  segs[CONF_GMAC_TXDESCR_NUM];
+	struct pbuf *                frame;
+	struct pbuf *                q;
+	uint32_t                     count = 0;
+	err_t                        err   = ERR_OK;
+
+	mac = (struct mac_async_descriptor *)(netif->state);
+
+	low_level_tx_reclaim(mac);
+
+#if ETH_PAD_SIZE
+	pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
+#endif
+
+	frame = p;
+	if (pbuf_clen(p) > CONF_GMAC_TXDESCR_NUM) {
+		frame = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+		if (frame == NULL || pbuf_copy(frame, p) != ERR_OK) {
+			if (frame != NULL) {
+				pbuf_free(frame);
+			}
+			err = ERR_MEM;
+			goto out;
+		}
+	} else {
+		pbuf_ref(frame);
+	}
+
+	for (q = frame; q != NULL; q = q->next) {
+		if (q->len == 0) {
+			continue;
+		}
+		segs[count].buf  = q->payload;
+		segs[count].len  = q->len;
+		segs[count].copy = pbuf_needs_copy(q);
+		count++;
+	}
+
+	err = low_level_queue(mac, frame, segs, count);
+	if (err != ERR_OK) {
+		pbuf_free(frame);
+	}
+
+out:
+#if ETH_PAD_SIZE
+	pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+#endif
+
+	return err;
+}
+
+err_t ethernetif_mac_output_prefixed(struct netif *netif, const void *header, u16_t header_len, struct pbuf *p)
+{
+	struct mac_async_descriptor *mac;
+	struct mac_async_tx_segment  segs[CONF_GMAC_TXDESCR_NUM];
+	struct pbuf *                q;
+	uint32_t                     count = 0;
+	err_t                        err;
+
+	mac = (struct mac_async_descriptor *)(netif->state);
+
+	low_level_tx_reclaim(mac);
+
+	/* the caller rewrites the header for its next frame, so that one is copied */
+	segs[count].buf  = (uint8_t *)header;
+	segs[count].len  = header_len;
+	segs[count].copy = true;
+	count++;
+
+	for (q = p; q != NULL; q = q->next) {
+		if (q->len == 0) {
+			continue;
+		}
+		if (count == CONF_GMAC_TXDESCR_NUM) {
+			LINK_STATS_INC(link.drop);
+			return ERR_ARG;
+		}
+		segs[count].buf  = q->payload;
+		segs[count].len  = q->len;
+		segs[count].copy = pbuf_needs_copy(q);
+		count++;
+	}
+
+	pbuf_ref(p);
+	err = low_level_queue(mac, p, segs, count);
+	if (err != ERR_OK) {
+		pbuf_free(p);
+	}
+	return err;
+}
+#else
 /**
  * \berif Transmission packet though the MAC hardware.
  */
@@ -98,7 +364,99 @@ err_t mac_low_level_output(struct netif *netif, struct pbuf *p)
 
 	return ERR_OK;
 }
+#endif
 
+#if CONF_GMAC_RX_ZERO_COPY
+/**
+ * Give a pool pbuf to every receive descriptor that has none. Descriptors
+ * that cannot get one because the pool is empty are retried on the next call.
+ */
+static void low_level_rx_refill(struct mac_async_descriptor *mac)
+{
+	struct pbuf *p;
+	int32_t      index;
+
+	while (rx_pbufs_given < CONF_GMAC_RXDESCR_NUM) {
+		p = pbuf_alloc(PBUF_RAW, CONF_GMAC_RXBUF_SIZE, PBUF_POOL);
+		if (p == NULL) {
+			return;
+		}
+
+		index = mac_async_rx_give(mac, p->payload);
+		if (index < 0) {
+			pbuf_free(p);
+			return;
+		}
+		rx_pbufs[index] = p;
+		rx_pbufs_given++;
+	}
+}
+
+/**
+ * Takes the next received frame straight out of the receive ring. The GMAC
+ * DMA wrote it into the pbuf after the ETH_PAD_SIZE padding, so the pbuf is
+ * passed up as is and its descriptor gets a fresh pbuf from the pool. A
+ * frame longer than one buffer continues in the pbufs of the descriptors
+ * that follow and is passed up as their chain.
+ */
+static struct pbuf *low_level_input(struct netif *netif)
+{
+	struct mac_async_descriptor *mac;
+	struct pbuf *                p;
+	struct pbuf *                q;
+	uint32_t                     len;
+	uint32_t                     count;
+	uint32_t                     rest;
+	uint32_t                     i;
+	int32_t                      index;
+
+	mac = (struct mac_async_descriptor *)(netif->state);
+
+	while (1) {
+		index = mac_async_rx_take(mac, &len, &count);
+		if (index < 0) {
+			low_level_rx_refill(mac);
+			return NULL;
+		}
+
+		/* Shrink each pbuf from the whole buffer down to its part of the frame */
+		p    = NULL;
+		rest = len == 0 ? 0 : len + ETH_PAD_SIZE;
+		for (i = 0; i < count; i++) {
+			q               = rx_pbufs[index];
+			rx_pbufs[index] = NULL;
+			rx_pbufs_given--;
+			index = (index + 1 == CONF_GMAC_RXDESCR_NUM) ? 0 : index + 1;
+
+			if (rest == 0) {
+				pbuf_free(q);
+				continue;
+			}
+			q->len = q->tot_len = LWIP_MIN(rest, CONF_GMAC_RXBUF_SIZE);
+			rest -= q->len;
+			if (p == NULL) {
+				p = q;
+			} else {
+				pbuf_cat(p, q);
+			}
+		}
+
+		if (p == NULL) {
+			LINK_STATS_INC(link.drop);
+		}
+
+		low_level_rx_refill(mac);
+
+		if (p != NULL) {
+			break;
+		}
+	}
+
+	LINK_STATS_INC(link.recv);
+
+	return p;
+}
+#else
 /**
  * Should allocate a pbuf and transfer the bytes of the incoming
  * packet from the interface into the pbuf.
@@ -147,46 +505,172 @@ static struct pbuf *low_level_input(struct netif *netif)
 
 	return p;
 }
+#endif
+
+#if CONF_GMAC_RX_PRIORITY
+/* Frames held back per pass. Half the ring, so the pool keeps pbufs to
+ * refill the receive descriptors with while they wait. */
+#define RX_DEFERRED_MAX (CONF_GMAC_RXDESCR_NUM / 2)
+#endif
+
+static ethernetif_rx_classifier_t rx_classifier;
+
+#if CONF_GMAC_RX_ZERO_COPY
+/* Normal frames freed because the ring was short of buffers */
+static u32_t rx_shed;
+
+u32_t ethernetif_mac_rx_shed(void)
+{
+	return rx_shed;
+}
 
 /**
- * \brief Process incoming ethernet packet.
+ * Whether a frame of this class is freed rather than passed on: a normal
+ * one while fewer than CONF_GMAC_RX_SHED_LEVEL receive descriptors have a
+ * buffer. Its pbufs go back to the pool before the stack holds on to them,
+ * and refill the ring for the priority frames behind it. Without a
+ * classifier nothing is told apart and nothing is shed.
  */
-void ethernetif_mac_input(struct netif *netif)
+static bool ethernetif_mac_shed(enum ethernetif_rx_class rx_class)
 {
-	struct eth_hdr *ethhdr;
-	struct pbuf *   p;
+	if (rx_class != ETHERNETIF_RX_NORMAL || rx_classifier == NULL || rx_pbufs_given >= CONF_GMAC_RX_SHED_LEVEL) {
+		return false;
+	}
+	rx_shed++;
+	return true;
+}
+#else
+u32_t ethernetif_mac_rx_shed(void)
+{
+	return 0;
+}
 
-	/* move received packet into a new pbuf */
-	do {
-		p = low_level_input(netif);
-		/* no packet could be read, silently ignore this */
-		if (p == NULL) {
-			return;
-		}
-		/* points to packet payload, which starts with an Ethernet header */
-		ethhdr = p->payload;
+static bool ethernetif_mac_shed(enum ethernetif_rx_class rx_class)
+{
+	(void)rx_class;
+	return false;
+}
+#endif
 
-		switch (htons(ethhdr->type)) {
-		/* IP or ARP packet? */
-		case ETHTYPE_IP:
-		case ETHTYPE_ARP:
+void ethernetif_mac_set_classifier(ethernetif_rx_classifier_t classifier)
+{
+	rx_classifier = classifier;
+}
+
+static ethernetif_link_handler_t link_handler;
+static u16_t                     link_type;
+
+void ethernetif_mac_set_link_handler(u16_t type, ethernetif_link_handler_t handler)
+{
+	link_type    = type;
+	link_handler = handler;
+}
+
+static enum ethernetif_rx_class ethernetif_mac_classify(struct netif *netif, struct pbuf *p)
+{
+	/* points to packet payload, which starts with an Ethernet header */
+	struct eth_hdr *ethhdr = p->payload;
+
+	switch (htons(ethhdr->type)) {
+	/* IP or ARP packet? */
+	case ETHTYPE_IP:
+	case ETHTYPE_ARP:
 #if PPPOE_SUPPORT
-			/* PPPoE packet? */
-		case ETHTYPE_PPPOEDISC:
-		case ETHTYPE_PPPOE:
+		/* PPPoE packet? */
+	case ETHTYPE_PPPOEDISC:
+	case ETHTYPE_PPPOE:
 #endif /* PPPOE_SUPPORT */
-			/* full packet send to tcpip_thread to process */
-			if (netif->input(p, netif) != ERR_OK) {
-				LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_mac_input: IP input error\n"));
+		if (rx_classifier != NULL) {
+			return rx_classifier(p, netif);
+		}
+		return ETHERNETIF_RX_NORMAL;
+
+	default:
+		if (link_handler != NULL && htons(ethhdr->type) == link_type) {
+			return ETHERNETIF_RX_LINK;
+		}
+		return ETHERNETIF_RX_DROP;
+	}
+}
+
+static void ethernetif_mac_deliver(struct netif *netif, struct pbuf *p)
+{
+	/* full packet send to tcpip_thread to process, or processed right
+	   here under the core lock with LWIP_TCPIP_CORE_LOCKING_INPUT */
+	NetLatencyInput();
+	if (netif->input(p, netif) != ERR_OK) {
+		LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_mac_input: IP input error\n"));
+		pbuf_free(p);
+	}
+}
+
+/**
+ * \brief Process incoming ethernet packet.
+ */
+u16_t ethernetif_mac_input(struct netif *netif)
+{
+	struct pbuf *            p;
+	enum ethernetif_rx_class rx_class;
+	u16_t                    frames = 0;
+#if CONF_GMAC_RX_PRIORITY
+	struct pbuf *deferred[RX_DEFERRED_MAX];
+	u16_t        deferred_count;
+	u16_t        i;
+
+	/* Priority frames go to the stack as they are taken off the ring, the rest
+	 * in arrival order once the ring is empty or enough of them are waiting. */
+	do {
+		deferred_count = 0;
+		while (deferred_count < RX_DEFERRED_MAX && (p = low_level_input(netif)) != NULL) {
+			frames++;
+			rx_class = ethernetif_mac_classify(netif, p);
+			if (ethernetif_mac_shed(rx_class)) {
+				rx_class = ETHERNETIF_RX_DROP;
+			}
+			switch (rx_class) {
+			case ETHERNETIF_RX_PRIORITY:
+				ethernetif_mac_deliver(netif, p);
+				break;
+			case ETHERNETIF_RX_NORMAL:
+				deferred[deferred_count++] = p;
+				break;
+			case ETHERNETIF_RX_LINK:
+				NetLatencyInput();
+				link_handler(p, netif);
+				break;
+			default:
+				LINK_STATS_INC(link.drop);
 				pbuf_free(p);
-				p = NULL;
+				break;
 			}
-			break;
+		}
 
-		default:
+		for (i = 0; i < deferred_count; i++) {
+			ethernetif_mac_deliver(netif, deferred[i]);
+		}
+	} while (deferred_count == RX_DEFERRED_MAX);
+#else
+	/* move received packet into a new pbuf */
+	while ((p = low_level_input(netif)) != NULL) {
+		frames++;
+		rx_class = ethernetif_mac_classify(netif, p);
+		if (ethernetif_mac_shed(rx_class)) {
+			rx_class = ETHERNETIF_RX_DROP;
+		}
+		switch (rx_class) {
+		case ETHERNETIF_RX_DROP:
+			LINK_STATS_INC(link.drop);
 			pbuf_free(p);
-			p = NULL;
+			break;
+		case ETHERNETIF_RX_LINK:
+			NetLatencyInput();
+			link_handler(p, netif);
+			break;
+		default:
+			ethernetif_mac_deliver(netif, p);
 			break;
 		}
-	} while (true);
+	}
+#endif
+	return frames;
 }
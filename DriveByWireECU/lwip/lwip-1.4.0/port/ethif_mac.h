@@ -42,6 +42,7 @@ extern "C" {
 /* Workaround for redefined macro */
 #undef ERR_TIMEOUT
 #include <lwip/netif.h>
+#include <hpl_gmac_config.h>
 
 /**
  * \brief Process incoming ethernet packet.
@@ -53,8 +54,57 @@ extern "C" {
  * the appropriate input function is called.
  *
  * @param netif the lwip network interface structure
+ * @return the frames taken off the receive ring, dropped ones included
  */
-void ethernetif_mac_input(struct netif *netif);
+u16_t ethernetif_mac_input(struct netif *netif);
+
+/** What ethernetif_mac_input() does with a received IP or ARP frame */
+enum ethernetif_rx_class {
+	ETHERNETIF_RX_NORMAL,   /**< to the stack, after the priority frames of the pass */
+	ETHERNETIF_RX_PRIORITY, /**< to the stack as soon as it is taken off the ring */
+	ETHERNETIF_RX_DROP,     /**< freed without reaching the stack, counted in link.drop */
+	ETHERNETIF_RX_LINK      /**< to the link handler, never returned by a classifier */
+};
+
+/** Sorts a received frame, p->payload points at the Ethernet header */
+typedef enum ethernetif_rx_class (*ethernetif_rx_classifier_t)(struct pbuf *p, struct netif *netif);
+
+/**
+ * \brief Install the receive classifier.
+ *
+ * Called from gmac_task for every IP or ARP frame. Without CONF_GMAC_RX_PRIORITY
+ * priority frames are treated as normal ones. NULL passes everything as normal.
+ *
+ * @param classifier the classifier, or NULL
+ */
+void ethernetif_mac_set_classifier(ethernetif_rx_classifier_t classifier);
+
+/**
+ * \brief Normal frames shed since boot.
+ *
+ * With zero copy receive, ethernetif_mac_input() frees the frames the
+ * classifier calls normal while fewer than CONF_GMAC_RX_SHED_LEVEL receive
+ * descriptors have a buffer, and counts them here and in link.drop. Priority
+ * and link frames are never shed.
+ */
+u32_t ethernetif_mac_rx_shed(void);
+
+/** Takes a received frame of the link handler's EtherType, p->payload points
+ * at the Ethernet header. It owns p and has to free it. */
+typedef void (*ethernetif_link_handler_t)(struct pbuf *p, struct netif *netif);
+
+/**
+ * \brief Install the handler of one EtherType other than IP and ARP.
+ *
+ * Called from gmac_task for every frame of that type as soon as it is taken
+ * off the ring, ahead of the classifier and the priority frames, and without
+ * going through netif->input. Without a handler those frames are dropped like
+ * any other unknown type. NULL removes it.
+ *
+ * @param type the EtherType, in host order
+ * @param handler the handler, or NULL
+ */
+void ethernetif_mac_set_link_handler(u16_t type, ethernetif_link_handler_t handler);
 
 /**
  * \berif Transmission packet though the MAC hardware.
@@ -75,6 +125,28 @@ void ethernetif_mac_input(struct netif *netif);
  */
 err_t mac_low_level_output(struct netif *netif, struct pbuf *p);
 
+#if CONF_GMAC_TX_SCATTER_GATHER
+/**
+ * \brief Transmit a frame whose headers were built by the caller.
+ *
+ * For senders that keep the Ethernet, IP and UDP headers of a flow themselves
+ * instead of going through udp_sendto, ip_output and etharp_output. The header
+ * is copied into a GMAC transmit buffer, so the caller can change it as soon
+ * as this returns. The chain p is sent in place like with mac_low_level_output
+ * and referenced until the frame has gone out.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param header Ethernet header and whatever follows it up to the payload,
+ *        without the ETH_PAD_SIZE padding
+ * @param header_len bytes in header
+ * @param p the payload
+ * @return ERR_OK if the frame was queued
+ *         ERR_MEM if the transmit ring is full
+ *         ERR_ARG if p has more segments than there are descriptors
+ */
+err_t ethernetif_mac_output_prefixed(struct netif *netif, const void *header, u16_t header_len, struct pbuf *p);
+#endif
+
 /**
  * \brief Initialize the MAC hardware
  *
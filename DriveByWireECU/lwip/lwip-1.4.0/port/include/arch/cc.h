@@ -36,6 +36,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 /* Define platform endianness */
 #if BYTE_ORDER != LITTLE_ENDIAN
@@ -85,8 +86,14 @@ typedef uintptr_t mem_ptr_t;
 /* define LWIP_COMPAT_MUTEX
     to let sys.h use binary semaphores instead of mutexes - as before in 1.3.2
     Refer CHANGELOG
+    sys_arch.c implements real mutexes, which the core lock needs for
+    priority inheritance.
 */
-#define LWIP_COMPAT_MUTEX 1
+#define LWIP_COMPAT_MUTEX 0
+
+/* IGMP only uses it to spread its reports over the query response time,
+   the C library generator is good enough for that */
+#define LWIP_RAND() ((u32_t)rand())
 
 /* Make lwip/arch.h define the codes which are used throughout */
 #define LWIP_PROVIDE_ERRNO
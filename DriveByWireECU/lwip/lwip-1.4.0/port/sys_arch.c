@@ -37,10 +37,17 @@
 #include "lwip/opt.h"
 #include "lwip/stats.h"
 #include "lwip_macif_config.h"
+#include "lwip/tcpip.h"
 #include <compiler.h>
+#include "LockProfiler.h"
 
 #define SYS_ARCH_BLOCKING_TICKTIMEOUT    ((portTickType)10000)
 
+/* Depth of the sys_arch_protect() regions entered. Every interrupt allowed to
+ * call into lwIP or the kernel is masked inside one, so only one context can be
+ * in a region at a time. */
+static volatile u32_t protect_depth;
+
 /* Structure associating a thread to a struct sys_timeouts */
 struct TimeoutlistPerThread {
 	sys_thread_t pid;        /* The thread id */
@@ -136,7 +143,15 @@ void sys_sem_signal(sys_sem_t *sem)
 {
 	/* Sanity check */
 	if (sem != NULL) {
-		xSemaphoreGive( *sem );
+		if ((SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) || protect_depth) {
+			/* A switch to the woken task is only taken once the region or
+			   interrupt ends. */
+			portBASE_TYPE task_woken = 0;
+			xSemaphoreGiveFromISR( *sem, &task_woken );
+			portEND_SWITCHING_ISR(task_woken);
+		} else {
+			xSemaphoreGive( *sem );
+		}
 	}
 }
 
@@ -173,11 +188,11 @@ u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout)
 		if (0 == TickElapsed) {
 			TickStart = xTaskGetTickCount();
 			/* If timeout=0, then the function should block indefinitely */
-			while (pdFALSE == xSemaphoreTake( *sem,	SYS_ARCH_BLOCKING_TICKTIMEOUT )) {
+			while (pdFALSE == LockProfileTake(LOCK_PROFILE_LWIP_SEM, *sem, SYS_ARCH_BLOCKING_TICKTIMEOUT)) {
 			}
 		} else {
 			TickStart = xTaskGetTickCount();
-			if (pdFALSE == xSemaphoreTake( *sem, TickElapsed )) {
+			if (pdFALSE == LockProfileTake(LOCK_PROFILE_LWIP_SEM, *sem, TickElapsed)) {
 				/* if the function times out, it should return SYS_ARCH_TIMEOUT */
 				return(SYS_ARCH_TIMEOUT);
 			}
@@ -308,7 +323,7 @@ err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
 
 	/* Sanity check */
 	if (mbox != NULL) {
-		if (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) {
+		if ((SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) || protect_depth) {
 			portBASE_TYPE task_woken = 0;
 			if (errQUEUE_FULL != xQueueSendFromISR( *mbox, &msg, &task_woken )) {
 				err_mbox = ERR_OK;
@@ -320,6 +335,10 @@ err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
 			}
 		}
 	}
+	/* A full mbox, the post is dropped. Counted for NetHealth.h. */
+	if (err_mbox != ERR_OK) {
+		SYS_STATS_INC(mbox.err);
+	}
 	return (err_mbox);
 }
 
@@ -503,6 +522,24 @@ sys_thread_t sys_thread_new(const char *name, lwip_thread_fn thread, void *arg,
  */
 err_t sys_mutex_new(sys_mutex_t *pxMutex)
 {
+	/* A real mutex rather than a binary semaphore, so a low priority thread
+	   holding the core lock inherits the priority of a thread waiting for it. */
+	*pxMutex = xSemaphoreCreateMutex();
+	if (*pxMutex == NULL) {
+  #if SYS_STATS
+		lwip_stats.sys.mutex.err++;
+  #endif /* SYS_STATS */
+		return ERR_MEM;
+	}
+
+  #if SYS_STATS
+	lwip_stats.sys.mutex.used++;
+	if (lwip_stats.sys.mutex.used > lwip_stats.sys.mutex.max) {
+		lwip_stats.sys.mutex.max = lwip_stats.sys.mutex.used;
+	}
+  #endif /* SYS_STATS */
+
+	return ERR_OK;
 }
 
 /**
@@ -510,8 +547,22 @@ err_t sys_mutex_new(sys_mutex_t *pxMutex)
  *
  * \param mutex the mutex to lock.
  */
+/* The core lock is told apart from the heap's mutex by its address, for the
+ * lock profiler (LockProfiler.h). */
+static inline lock_profile_id_t mutex_profile_id(sys_mutex_t *pxMutex)
+{
+#if LWIP_TCPIP_CORE_LOCKING
+	if (pxMutex == &lock_tcpip_core) {
+		return LOCK_PROFILE_TCPIP_CORE;
+	}
+#endif
+	return LOCK_PROFILE_LWIP_MUTEX;
+}
+
 void sys_mutex_lock(sys_mutex_t *pxMutex)
 {
+	while (pdFALSE == LockProfileTake(mutex_profile_id(pxMutex), *pxMutex, SYS_ARCH_BLOCKING_TICKTIMEOUT)) {
+	}
 }
 
 /**
@@ -521,6 +572,7 @@ void sys_mutex_lock(sys_mutex_t *pxMutex)
  */
 void sys_mutex_unlock(sys_mutex_t *pxMutex)
 {
+	LockProfileGive(mutex_profile_id(pxMutex), *pxMutex);
 }
 
 /**
@@ -530,6 +582,10 @@ void sys_mutex_unlock(sys_mutex_t *pxMutex)
  */
 void sys_mutex_free(sys_mutex_t *pxMutex)
 {
+  #if SYS_STATS
+	lwip_stats.sys.mutex.used--;
+  #endif /* SYS_STATS */
+	vQueueDelete( *pxMutex );
 }
 
 #ifndef sys_mutex_valid
@@ -569,16 +625,25 @@ void sys_mutex_set_invalid(sys_mutex_t *mutex)
  * function should support recursive calls from the same task or interrupt. In
  * other words, sys_arch_protect() could be called while already protected. In
  * that case the return value indicates that it is already protected.*/
-extern volatile unsigned portLONG ulCriticalNesting;
+
 /**
  * \brief Protect the system.
  *
- * \return 1 on success.
+ * Raises BASEPRI to configMAX_SYSCALL_INTERRUPT_PRIORITY and returns the level
+ * it had, which nests without a counter and works from interrupts too. Unlike
+ * vPortEnterCritical() the kernel's critical nesting count is not kept, so no
+ * kernel call may leave a critical section inside the region: the kernel would
+ * lower BASEPRI to 0 on the way out. lwIP only signals semaphores and posts to
+ * mailboxes while protected, sys_sem_signal() and sys_mbox_trypost() use the
+ * FromISR calls, which restore BASEPRI instead.
+ *
+ * \return The previous BASEPRI, for sys_arch_unprotect().
  */
 sys_prot_t sys_arch_protect(void)
 {
-	vPortEnterCritical();
-	return 1; /* Not used */
+	sys_prot_t pval = portSET_INTERRUPT_MASK_FROM_ISR();
+	protect_depth++;
+	return pval;
 }
 
 /**
@@ -588,6 +653,6 @@ sys_prot_t sys_arch_protect(void)
  */
 void sys_arch_unprotect(sys_prot_t pval)
 {
-	(void) pval;
-	vPortExitCritical();
+	protect_depth--;
+	portCLEAR_INTERRUPT_MASK_FROM_ISR(pval);
 }
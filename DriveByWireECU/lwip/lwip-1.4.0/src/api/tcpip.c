@@ -80,11 +80,10 @@ static void tcpip_thread(void *arg)
 
 	LOCK_TCPIP_CORE();
 	while (1) { /* MAIN Loop */
-		UNLOCK_TCPIP_CORE();
 		LWIP_TCPIP_THREAD_ALIVE();
-		/* wait for a message, timeouts are processed while waiting */
+		/* wait for a message, timeouts are processed while waiting.
+		   The core lock is only released while blocked on the mbox. */
 		sys_timeouts_mbox_fetch(&mbox, (void **)&msg);
-		LOCK_TCPIP_CORE();
 		switch (msg->type) {
 #if LWIP_NETCONN
 		case TCPIP_MSG_API:
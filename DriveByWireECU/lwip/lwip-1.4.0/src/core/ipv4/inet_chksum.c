@@ -43,6 +43,10 @@
 
 #include <stddef.h>
 #include <string.h>
+#include "FastCode.h"
+
+/* every IP header and UDP datagram is summed here */
+FAST_CODE_FILE
 
 /* These are some reference implementations of the checksum algorithm, with the
  * aim of being simple, correct and fully portable. Checksumming is the
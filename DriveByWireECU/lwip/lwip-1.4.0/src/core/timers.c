@@ -400,62 +400,78 @@ void sys_restart_timeouts(void)
  * Wait (forever) for a message to arrive in an mbox.
  * While waiting, timeouts are processed.
  *
+ * With LWIP_TCPIP_CORE_LOCKING the caller holds the core lock. It is only
+ * released while blocked on the mbox, so other threads holding the lock may
+ * add timeouts (tcp_timer_needed() from tcpip_input with
+ * LWIP_TCPIP_CORE_LOCKING_INPUT) but never while the list is being walked.
+ * A timeout added during the wait counts from the start of that wait and may
+ * fire up to that much early, never late.
+ *
  * @param mbox the mbox to fetch the message from
  * @param msg the place to store the message
  */
 void sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
 {
 	u32_t               time_needed;
+	u32_t               wait;
+	u32_t               elapsed;
 	struct sys_timeo *  tmptimeout;
 	sys_timeout_handler handler;
 	void *              arg;
 
 again:
 	if (!next_timeout) {
-		time_needed = sys_arch_mbox_fetch(mbox, msg, 0);
-	} else {
-		if (next_timeout->time > 0) {
-			time_needed = sys_arch_mbox_fetch(mbox, msg, next_timeout->time);
-		} else {
-			time_needed = SYS_ARCH_TIMEOUT;
-		}
+		UNLOCK_TCPIP_CORE();
+		sys_arch_mbox_fetch(mbox, msg, 0);
+		LOCK_TCPIP_CORE();
+		return;
+	}
 
-		if (time_needed == SYS_ARCH_TIMEOUT) {
-			/* If time == SYS_ARCH_TIMEOUT, a timeout occured before a message
-			   could be fetched. We should now call the timeout handler and
-			   deallocate the memory allocated for the timeout. */
-			tmptimeout   = next_timeout;
-			next_timeout = tmptimeout->next;
-			handler      = tmptimeout->h;
-			arg          = tmptimeout->arg;
+	if (next_timeout->time == 0) {
+		/* The timeout at the head is due. Call the timeout handler and
+		   deallocate the memory allocated for the timeout. */
+		tmptimeout   = next_timeout;
+		next_timeout = tmptimeout->next;
+		handler      = tmptimeout->h;
+		arg          = tmptimeout->arg;
 #if LWIP_DEBUG_TIMERNAMES
-			if (handler != NULL) {
-				LWIP_DEBUGF(TIMERS_DEBUG, ("stmf calling h=%s arg=%p\n", tmptimeout->handler_name, arg));
-			}
+		if (handler != NULL) {
+			LWIP_DEBUGF(TIMERS_DEBUG, ("stmf calling h=%s arg=%p\n", tmptimeout->handler_name, arg));
+		}
 #endif /* LWIP_DEBUG_TIMERNAMES */
-			memp_free(MEMP_SYS_TIMEOUT, tmptimeout);
-			if (handler != NULL) {
-				/* For LWIP_TCPIP_CORE_LOCKING, lock the core before calling the
-				   timeout handler function. */
-				LOCK_TCPIP_CORE();
-				handler(arg);
-				UNLOCK_TCPIP_CORE();
-			}
-			LWIP_TCPIP_THREAD_ALIVE();
+		memp_free(MEMP_SYS_TIMEOUT, tmptimeout);
+		if (handler != NULL) {
+			handler(arg);
+		}
+		LWIP_TCPIP_THREAD_ALIVE();
+
+		/* We try again to fetch a message from the mbox. */
+		goto again;
+	}
 
-			/* We try again to fetch a message from the mbox. */
-			goto again;
+	wait = next_timeout->time;
+	UNLOCK_TCPIP_CORE();
+	time_needed = sys_arch_mbox_fetch(mbox, msg, wait);
+	LOCK_TCPIP_CORE();
+
+	/* If time == SYS_ARCH_TIMEOUT, the whole wait passed before a message
+	   could be fetched. Otherwise time is the number of milliseconds we
+	   waited for the message. The list holds deltas, whatever is left after
+	   the head runs out is charged to the timeouts behind it. */
+	elapsed = (time_needed == SYS_ARCH_TIMEOUT) ? wait : time_needed;
+	for (tmptimeout = next_timeout; tmptimeout != NULL && elapsed > 0; tmptimeout = tmptimeout->next) {
+		if (elapsed < tmptimeout->time) {
+			tmptimeout->time -= elapsed;
+			elapsed = 0;
 		} else {
-			/* If time != SYS_ARCH_TIMEOUT, a message was received before the timeout
-			   occured. The time variable is set to the number of
-			   milliseconds we waited for the message. */
-			if (time_needed < next_timeout->time) {
-				next_timeout->time -= time_needed;
-			} else {
-				next_timeout->time = 0;
-			}
+			elapsed -= tmptimeout->time;
+			tmptimeout->time = 0;
 		}
 	}
+
+	if (time_needed == SYS_ARCH_TIMEOUT) {
+		goto again;
+	}
 }
 
 #endif /* NO_SYS */
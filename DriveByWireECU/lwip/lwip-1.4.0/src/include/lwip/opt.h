@@ -141,6 +141,14 @@
 #define MEMP_SEPARATE_POOLS 0
 #endif
 
+/**
+ * MEMP_MEMORY_ATTRIBUTE: attributes of the one big pool array, such as the
+ * section it is placed in. Empty by default
+ */
+#ifndef MEMP_MEMORY_ATTRIBUTE
+#define MEMP_MEMORY_ATTRIBUTE
+#endif
+
 /**
  * MEMP_OVERFLOW_CHECK: memp overflow protection reserves a configurable
  * amount of bytes before and after each memp element in every pool and fills
@@ -32,10 +32,6 @@
 #ifndef SOCKET_API_H_
 #define SOCKET_API_H_
 
-#define HTTP_PORT 80
-
-void basic_socket();
-void socket_basic_ethernet(void *p);
 void print_ipaddress(void);
 
 #endif /* SOCKET_API_H_ */
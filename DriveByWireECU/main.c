@@ -41,306 +41,233 @@
 #include "EthernetIO.h"
 #include "FreeRTOS.h"
 #include "main_context.h"
-#include "PID.h"
+#include "ControlCore.h"
+#include "ControlScheduler.h"
+#include "PIDBenchmark.h"
+#include "FilterBenchmark.h"
+#include "Profiler.h"
+#include "RtosTrace.h"
+#include "PcSampler.h"
+#include "CacheMonitor.h"
+#include "TaskMonitor.h"
+#include "task_config.h"
+#include "IdleSleep.h"
+#include "FastCode.h"
+#include "Log.h"
+#include "EventLog.h"
+#include "ParamStore.h"
+#include "IntegrityMonitor.h"
+#include "SensorHub.h"
+#include "NodeIdentity.h"
+#include "DacThrottle.h"
+#include "BootProfile.h"
+#include "SdLogger.h"
+#include "Imu.h"
+#include "BlackBox.h"
+#include "Service.h"
+#include "SelfTest.h"
+#include "Console.h"
+#include "TimeTrigger.h"
+#include "UsbDebug.h"
+#include "RamEcc.h"
+#include "Crc32.h"
+#include "CommandAuth.h"
+#include "Watchdog.h"
+#include "BenchImage.h"
+#include "FirmwareUpdate.h"
+#include "CanGateway.h"
+#include "Redundancy.h"
+#include "Peripherals.h"
+#include "webserver_tasks.h"
+
+//The Performance configuration passes floats in FPU registers. This
+//catches its flags losing -mfloat-abi=hard, the linker refuses any object
+//built for the other ABI.
+#if defined(PERFORMANCE_BUILD) && !defined(__ARM_PCS_VFP)
+#error The Performance configuration needs -mfloat-abi=hard
+#endif
 
 /* define to avoid compilation warning */
 #define LWIP_TIMEVAL_PRIVATE 0
 
-#define MAIN_TASK_LOOP_TIME 1 //milliseconds
-
-#define PARKING_BRAKE_DUTY_CYCLE 0.25
-#define COME_TO_STOP_BRAKE_DUTY_CYCLE 0.5
-#define EMERGENCY_STOP_BRAKE_DUTY_CYCLE 1.0
-
-#define MAX_STEERING_ANGLE 50.0
-#define MIN_STEERING_ANGLE -50.0
-
-#define MAX_VEHICLE_SPEED 12.0
-#define MIN_VEHICLE_SPEED -1.0
-
-#define MAX_STEERING_DUTY_CYCLE 1.0
-#define MAX_ACCEL_DUTY_CYCLE 1.0
-#define MIN_ACCEL_DUTY_CYCLE -0.25
-
-//duty cycle (0.0 - 1.0) / degrees
-#define STEERING_P_GAIN (1.0 / 30.0) //100% duty cycle at angles greater than 60 deg
-//duty cycle / degrees
-#define STEERING_I_GAIN (0.05 / (1 * 1000)) //5% duty cycle for every second we are 1 deg off.
-#define STEERING_D_GAIN 0.0
-
-//duty cycle (0.0 - 1.0) / m/s
-#define SPEED_P_GAIN (1.0 / 1.0) //100% duty cycle at speed errors > 2.2 MPH
-#define SPEED_I_GAIN (0.05 / (0.1 * 1000)) //5% duty cycle for every second we are .2 MPH off of our target.
-#define SPEED_D_GAIN 0.0
-
 static main_context_t ctx;
+//main_task runs for the life of the ECU, so its stack never has to come from
+//the RTOS heap. A task with a static stack must never be deleted, the kernel
+//would hand the stack to vPortFree.
+static StackType_t main_task_stack[TASK_STACK_CONTROL] __attribute__((aligned(portBYTE_ALIGNMENT)));
 
-void print_ipaddress(void)
+//Logged by octet, a rendered address string would be gone by the time
+//the log service prints it
+static void LogAddress(const char* format, const ip_addr_t* address)
 {
-	static char tmp_buff[16];
-	printf("IP_ADDR    : %s\r\n",
-	       ipaddr_ntoa_r((const ip_addr_t *)&(TCPIP_STACK_INTERFACE_0_desc.ip_addr), tmp_buff, 16));
-	printf("NET_MASK   : %s\r\n",
-	       ipaddr_ntoa_r((const ip_addr_t *)&(TCPIP_STACK_INTERFACE_0_desc.netmask), tmp_buff, 16));
-	printf("GATEWAY_IP : %s\r\n", ipaddr_ntoa_r((const ip_addr_t *)&(TCPIP_STACK_INTERFACE_0_desc.gw), tmp_buff, 16));
+	LOG(format, ip4_addr1(address), ip4_addr2(address), ip4_addr3(address), ip4_addr4(address));
 }
 
-uint32_t GetCurrentTime()
-{
-	return xTaskGetTickCount();
-}
-int ConvertAngleToPIDInt(float angle)
-{
-	return (int)(angle * 1000.0);
-}
-int ConvertSpeedToPIDInt(float speed)
-{
-	return (int)(speed * 1000.0);
-}
-float ConvertPIDIntToDutyCycle(int PID_int)
-{
-	return ((float)PID_int) / 1000.0;
-}
-int ConvertDutyCycleToPIDInt(float duty_cycle)
-{
-	return ((int)duty_cycle) * 1000.0;
-}
-//PID Callback functions
-int SteeringPIDSource()
-{
-	return ConvertAngleToPIDInt(ctx.steering_angle_commanded);
-}
-int SpeedPIDSource()
-{
-	return ConvertSpeedToPIDInt(ctx.vehicle_speed_commanded);
-}
-void SteeringPIDOutput(int pid_output)
-{
-	ctx.steering_torque_pid_out = ConvertPIDIntToDutyCycle(pid_output);
-}
-void SpeedPIDOutput(int pid_output)
-{
-	ctx.acceleration_pid_out = ConvertPIDIntToDutyCycle(pid_output);
-}
-unsigned long GetPIDTime()
-{
-	return (unsigned long) GetCurrentTime();
-}
-void OverridePID()
+void print_ipaddress(void)
 {
-	if( !ctx.override_pid )
-		return;
-
-	ctx.speed_controller.p = ctx.speed_p_gain_override;
-	ctx.speed_controller.i = ctx.speed_i_gain_override;
-	ctx.speed_controller.d = ctx.speed_d_gain_override;
-
-	ctx.steering_controller.p = ctx.steer_p_gain_override;
-	ctx.steering_controller.i = ctx.steer_i_gain_override;
-	ctx.steering_controller.d = ctx.steer_d_gain_override;
+	LogAddress("IP_ADDR    : %lu.%lu.%lu.%lu", (const ip_addr_t *)&TCPIP_STACK_INTERFACE_0_desc.ip_addr);
+	LogAddress("NET_MASK   : %lu.%lu.%lu.%lu", (const ip_addr_t *)&TCPIP_STACK_INTERFACE_0_desc.netmask);
+	LogAddress("GATEWAY_IP : %lu.%lu.%lu.%lu", (const ip_addr_t *)&TCPIP_STACK_INTERFACE_0_desc.gw);
 }
 
-
-void ProcessAlgorithms(main_context_t* ctx)
+//Atmel START enables its interrupts at the NVIC's reset priority 0, above
+//the estop. Every one starts at the lowest, the modules set their own from
+//irq_config.h as they start.
+static void SetDefaultInterruptPriorities()
 {
-	ctx->estop_indicator = 0;
-	OverridePID();
-	setEnabled(&ctx->steering_controller, ctx->autonomous_mode && !ctx->estop_in && !ctx->park_brake_commanded);
-	setEnabled(&ctx->speed_controller, ctx->autonomous_mode && !ctx->estop_in && !ctx->park_brake_commanded);
-	tick(&ctx->steering_controller);
-	tick(&ctx->speed_controller);
-
-	if( ctx->last_eth_input_rx_time - ctx->current_time > 250)
-	{
-		ctx->pc_comm_active = 0;
-		ctx->autonomous_mode = 0;
-	}
-	
-	if(ctx->autonomous_mode)
-	{
-		SetEStopState(ctx->estop_in);
-		SetSafetyLight1On(1);
-		
-		if(ctx->estop_in)
-		{
-			SetFrontBrake(EMERGENCY_STOP_BRAKE_DUTY_CYCLE);
-			SetAcceleration(0.0);
-			ctx->estop_indicator = 1;
-		}
-		else if(ctx->park_brake_commanded)
-		{
-			SetFrontBrake(PARKING_BRAKE_DUTY_CYCLE);
-			SetAcceleration(0.0);
-		}
-		else
-		{
-			//regular autonomous mode
-			float accel = ctx->acceleration_pid_out;
-			
-			//if reverse commanded
-			if( accel < 0.0 )
-			{
-				//if we are moving forward
-				if(ctx->vehicle_speed > 0)
-				{
-					//Don't engage reverse while we are moving forward.
-					accel = 0.0;
-					SetFrontBrake(COME_TO_STOP_BRAKE_DUTY_CYCLE);
-				}
-				else //not moving forward and reverse commanded
-				{
-					SetReverseDrive(1);
-					accel = -accel;
-				}
-			}
-			else //reverse not commanded
-			{
-				SetReverseDrive(0);
-			}
-			if( accel > 1.0)
-				accel = 1.0;
-			SetAcceleration( accel );
-
-			float SteeringTorqueFromPID = ctx->steering_torque_pid_out;
-			SetSteerDirection(SteeringTorqueFromPID < 0.0);
-
-			//limit the torque 0 to 1
-			if( SteeringTorqueFromPID < 0.0 )
-				SteeringTorqueFromPID = -SteeringTorqueFromPID;
-			if( SteeringTorqueFromPID > 1.0 )
-				SteeringTorqueFromPID = 1.0;
-
-			SetSteeringTorque( SteeringTorqueFromPID );
-		}
-	}
-	else //not in autonomous mode
-	{
-		SetSafetyLight1On(0);
-		SetSteeringTorque(0.0);
-		SetAcceleration(0.0);
-		SetReverseDrive(0);
-	}
-}
-uint32_t last_test_tick = 0;
-int tick_tock = 0;
-void TestSystems(main_context_t* ctx)
-{
-	if( ctx->current_time - last_test_tick > 2000)
-	{
-		last_test_tick = ctx->current_time;
-		tick_tock = !tick_tock;
-		
-		//alternate these signals
-		if(tick_tock)
-		{
-			SetAcceleration(0.40);
-			SetFrontBrake(0.0);
-			SetReverseDrive(0);
-			SetSteerDirection(0);
-		}
-		else
-		{
-			SetAcceleration(0.40);
-			SetReverseDrive(1);
-			SetFrontBrake(0.2);
-			SetSteerDirection(1);
-		}
-		SetSafetyLight1On(1);
-		SetSteeringTorque(0.40);
-	}
-	
+	for(int irq = 0; irq < PERIPH_COUNT_IRQn; ++irq)
+		NVIC_SetPriority((IRQn_Type)irq, IRQ_PRIORITY_DEFAULT);
 }
 
-void TeleOperation(main_context_t* ctx)
+uint32_t GetCurrentTime()
 {
-	if(ctx->tele_operation_enabled && ctx->current_time - ctx->last_eth_input_rx_time < 100)
-	{
-		SetSafetyLight1On(1);
-		SetAcceleration(ctx->vehicle_speed_commanded);
-		if(ctx->steering_angle_commanded > 0)
-		{
-			SetSteeringTorque(ctx->steering_angle_commanded);
-			SetSteerDirection(0);
-		}
-		else
-		{
-			SetSteeringTorque(ctx->steering_angle_commanded * -1);
-			SetSteerDirection(1);
-		}
-		
-	}
-	else
-	{
-		SetAcceleration(0.0);
-		SetSafetyLight1On(0);
-	}
+	return xTaskGetTickCount();
 }
 
-void main_task(void* p)
+FAST_CODE void main_task(void* p)
 {
 	main_context_t* context = (main_context_t*)p; 
-	
+
+	ControlSchedulerInit(&context->scheduler);
+
 	while (1)
 	{
-		if(xSemaphoreTake(context->sem, 5) != pdTRUE)
-		{
-			printf("Failed to take IO semaphore!\n");
-			vTaskDelay(1);
-		}
-		
-		context->current_time = GetCurrentTime();
-		/*ProcessCurrentInputs(context);
-		ProcessAlgorithms(context);
-		ProcessCurrentOutputs(context);*/
-		//TestSystems(context);
-		TeleOperation(context);
-		
-		xSemaphoreGive(context->sem);
-		vTaskDelay(MAIN_TASK_LOOP_TIME);
+		//released at a fixed phase every CONTROL_CORE_CYCLE_US regardless of how long the cycle took
+		ControlSchedulerWaitForNextCycle(&context->scheduler);
+		//first, the burst runs while the cycle gets to where it is read
+		ImuStartRead();
+#if CONTROL_SCHEDULER_TIMER
+		ProfilerAdd(PROFILER_STAGE_WAKE, ControlSchedulerSinceRelease());
+#else
+		ProfilerEndSinceTick(PROFILER_STAGE_WAKE);
+#endif
+#if FAST_CODE_CACHE_LOCK
+		if( context->scheduler.cycle_count == FAST_CODE_CAPTURE_CYCLE )
+			FastCodeCacheCaptureBegin();
+#endif
+
+		uint32_t cycle_start = ProfilerStart();
+		CacheMonitorBegin(CACHE_MONITOR_CONTROL);
+		ControlCoreStep(context, GetCurrentTime());
+		RedundancyCycleEnd(context);
+		WatchdogHeartbeat(WATCHDOG_CONTROL);
+		EthernetCycleEnd();
+		SdLoggerRecord(context);
+		BlackBoxRecord(context);
+		CacheMonitorEnd(CACHE_MONITOR_CONTROL);
+		ProfilerEnd(PROFILER_STAGE_CYCLE, cycle_start);
+		if( context->scheduler.cycle_count == 1 )
+			BootProfileMark(BOOT_STAGE_FIRST_CYCLE);
+		if( context->scheduler.cycle_count == FIRMWARE_UPDATE_CONFIRM_CYCLES )
+			FirmwareUpdateConfirm();
+#if FAST_CODE_CACHE_LOCK
+		if( context->scheduler.cycle_count == FAST_CODE_CAPTURE_CYCLE )
+			FastCodeCacheCaptureEnd();
+#endif
 	}
 }
 
 int main(void)
 {
+	//before the interrupts run on the main stack
+	TaskMonitorPaintInterruptStack();
+	//times everything after it
+	BootProfileInit();
+	//before anything can log an event
+	EventLogInit();
+	//an image on trial that keeps failing goes back to the previous one here
+	FirmwareUpdateBoot();
 	/* Initializes MCU, drivers and middleware */
 	atmel_start_init();
-	
-	//Initialize PID controllers.
-	ctx.steering_controller.p = STEERING_P_GAIN;
-	ctx.steering_controller.i = STEERING_I_GAIN;
-	ctx.steering_controller.d = STEERING_D_GAIN;
-	ctx.steering_controller.pidSource = SteeringPIDSource;
-	ctx.steering_controller.pidOutput = SteeringPIDOutput;
-	setInputBounds(&(ctx.steering_controller), ConvertAngleToPIDInt(MIN_STEERING_ANGLE), ConvertAngleToPIDInt(MAX_STEERING_ANGLE));
-	setOutputBounds(&(ctx.steering_controller), ConvertDutyCycleToPIDInt(MAX_STEERING_DUTY_CYCLE)*-1, ConvertDutyCycleToPIDInt(MAX_STEERING_DUTY_CYCLE));
-	ctx.steering_controller.getSystemTime = GetPIDTime;
+	SetDefaultInterruptPriorities();
+	InitializeDriveByWireIO();
+	BootProfileMark(BOOT_STAGE_IO);
+	//the PHY's reset is the longest wait of the boot, after the outputs
+	//are safe
+	PeripheralRequire(PERIPHERAL_ETHERNET_PHY);
+	ProfilerInit();
+	RtosTraceInit();
+	PcSamplerInit();
+	IdleSleepInit();
+	RamEccInit();
+	//the DMAC is up since atmel_start_init
+	Crc32Init();
+	CommandAuthInit();
 
-	ctx.speed_controller.p = SPEED_P_GAIN;
-	ctx.speed_controller.i = SPEED_I_GAIN;
-	ctx.speed_controller.d = SPEED_D_GAIN;
-	ctx.speed_controller.pidSource = SpeedPIDSource;
-	ctx.speed_controller.pidOutput = SpeedPIDOutput;
-	setInputBounds(&(ctx.speed_controller), ConvertSpeedToPIDInt(MIN_VEHICLE_SPEED), ConvertSpeedToPIDInt(MAX_VEHICLE_SPEED));
-	setOutputBounds(&(ctx.speed_controller), ConvertDutyCycleToPIDInt(MIN_ACCEL_DUTY_CYCLE), ConvertDutyCycleToPIDInt(MAX_ACCEL_DUTY_CYCLE));
-	ctx.speed_controller.getSystemTime = GetPIDTime;
+#if PID_BENCHMARK
+	ReportPIDBenchmark();
+#endif
+#if FILTER_BENCHMARK
+	ReportFilterBenchmark();
+#endif
 	
-	memset(&ctx, 0, sizeof(ctx));
-	ctx.sem = xSemaphoreCreateBinary();
-	xSemaphoreGive(ctx.sem);
+	ControlCoreInit(&ctx);
+	//tuned gains from the first cycle on
+	ParamStoreInit(&ctx.params);
+	//the addresses the network comes up on
+	NodeIdentityInit(&ctx.params);
+	LOG("node %u", NodeIdentity()->id);
+	//its slot follows from the node
+	TimeTriggerInit();
+	//CAN is up since InitializeDriveByWireIO, the pair settles within the
+	//listen time once main_task runs
+	RedundancyInit();
+	//the throttle volts, DriveByWireIO started the DAC on the defaults
+	DacThrottleCalibrate(&ctx.params);
+	*BeginParamsWrite(&ctx.exchange) = ctx.params;
+	PublishParams(&ctx.exchange);
+	BootProfileMark(BOOT_STAGE_CONTROL);
 
-	xTaskCreate(ethernet_thread,
+	//ethernet_thread deletes itself in the raw UDP build, its stack stays on the heap
+	BaseType_t ethernet_created = xTaskCreate(ethernet_thread,
 		"Ethernet_Task",
-		2048,
+		TASK_STACK_ETHERNET,
 		&ctx,
-		0,
+		TASK_PRIORITY_ETHERNET,
 		NULL);
 
-	xTaskCreate(main_task,
+#if BENCH_IMAGE
+	//the catalogue takes the control loop's place, stack and priority
+	BaseType_t main_created = xTaskGenericCreate(BenchImageTask,
+		"Bench_Task",
+		TASK_STACK_CONTROL,
+		&ctx,
+		TASK_PRIORITY_CONTROL,
+		NULL,
+		main_task_stack,
+		NULL);
+#else
+	BaseType_t main_created = xTaskGenericCreate(main_task,
 		"Main_Task",
-		2048,
+		TASK_STACK_CONTROL,
 		&ctx,
-		2,
+		TASK_PRIORITY_CONTROL,
+		NULL,
+		main_task_stack,
 		NULL);
+#endif
+
+	LogStart();
+	ConsoleStart();
+	SdLoggerStart();
+	BlackBoxStart();
+	FirmwareUpdateInit();
+	CanGatewayInit();
+	UsbDebugStart();
+	TaskMonitorStart();
+	led_timer_start();
+	SelfTestStart();
+	IntegrityMonitorStart();
+	SensorHubStart();
+	//once the services of the Start calls above are added
+	ServiceStart();
+
+	//never start half a system
+	configASSERT(ethernet_created == pdPASS && main_created == pdPASS);
+
+	BootProfileMark(BOOT_STAGE_SCHEDULER);
+	//from here on a stalled task resets the ECU
+	WatchdogStart();
 
 	vTaskStartScheduler();
 	
@@ -6,49 +6,170 @@
  */ 
 #ifndef MAIN_CONTEXT_H_
 #define MAIN_CONTEXT_H_
-#include "FreeRTOS.h"
-#include "semphr.h"
-#include "EthernetIO.h"
 #include "PID.h"
+#include "ControlScheduler.h"
+#include "ControlExchange.h"
+#include "PIDTrace.h"
+#include "DeadlineMonitor.h"
+#include "GainSchedule.h"
+#include "SteeringLimits.h"
+#include "CommandShaper.h"
+#include "CommandHold.h"
+#include "TrajectoryBuffer.h"
+#include "Odometry.h"
+#include "ActuatorFault.h"
+#include "TractionControl.h"
+#include "SteeringCompensation.h"
+#include "ActuatorCommand.h"
+#include "ControlPipeline.h"
+#include "VehicleMode.h"
+#include "ControlRecord.h"
 
+//Laid out by how often main_task touches each part. The scalars of the
+//control cycle come first, so every one of them is a load or store
+//straight off the context pointer: the M4's float loads reach 1020 bytes
+//and its integer loads 4095, and behind the trace's samples or the
+//exchange's buffers every access would first need its address built. The
+//SAME54 has no data cache, what this saves is instructions and padding.
+//The cycle's booleans share one word of single bits, always 0 or 1.
+//What main_task only touches when a parameter set is applied, or hands
+//to other tasks, comes last.
 typedef struct main_context_t
 {
-	SemaphoreHandle_t sem;
-
-	uint32_t last_eth_input_rx_time;
-	uint32_t current_time;
-
-	//commanded from the driving agent
-	float vehicle_speed_commanded;
-	float steering_angle_commanded;
-	uint8_t park_brake_commanded;
-	uint8_t reverse_commanded;
-	uint8_t autonomous_mode;
-
-	//actual measured / current values 
-	float vehicle_speed;
-	float steering_angle;
-	uint8_t reverse;
-	uint8_t safety_lights_1_on;
-	uint8_t safety_lights_2_on;
-	uint8_t estop_in;
-	uint8_t estop_indicator;
-	uint8_t pc_comm_active;
-	uint8_t debug_led_1;
-	uint8_t debug_led_2;
-	uint8_t tele_operation_enabled;
+	//hot, every control cycle
+	struct
+	{
+		uint32_t current_time;
+		//PTP us the inputs were sampled at, 0 while not synced
+		uint32_t input_time;
+		//us of the time base (TimeBase.h) the inputs were sampled at, low
+		//32 bits, and of the cycle before
+		uint32_t sample_time;
+		uint32_t last_sample_time;
+		//the sample interval for the loops, with CONTROL_TIMED_PID
+		pid_timing_t pid_timing;
+		//PTP us of the press behind estop_in, 0 while not synced or released
+		uint32_t estop_time;
+		uint32_t last_eth_input_rx_time;
+		//level of the command last applied, a trend is only taken within one
+		uint8_t applied_priority;
 
+		//actual measured / current values
+		float vehicle_speed;
+		float steering_angle;
+		//m/s of each wheel (WheelSpeed.h), the front ones as of the last
+		//valid frame
+		float wheel_speeds[WHEEL_SPEED_SENSOR_COUNT];
+		//share of the full front brake pressure, with BRAKE_PRESSURE_LOOP
+		float brake_pressure;
+		//V with ADC_SAMPLER_SUPPLY_VOLTAGE, and the gain of the supply
+		//compensation (DriveByWireIO.h), 1 without it
+		float supply_voltage;
+		float supply_gain;
+		//for the steering sweep (SteeringSweep.h): the potentiometer code at
+		//ADC_SAMPLER_FINE_FULL_SCALE and, with STEERING_ENCODER_ENABLE, the
+		//encoder counts since boot
+		uint16_t steering_code;
+		int32_t steering_encoder_count;
+		//deg/s counter clockwise and m/s^2 forward and to the left, from the
+		//IMU (Imu.h), as of the last cycle imu_valid was set
+		float yaw_rate;
+		float longitudinal_accel;
+		float lateral_accel;
+		//as last received from the driving agent, held or extrapolated between
+		//commands (CommandHold.h)
+		float vehicle_speed_requested;
+		float steering_angle_requested;
+		//the requests shaped to the slew and jerk limits, what the controls follow
+		float vehicle_speed_commanded;
+		float steering_angle_commanded;
+		float steering_torque_pid_out;
+		//deg/s, what the position loop commands the rate loop with STEERING_RATE_LOOP
+		float steering_rate_pid_out;
+		float acceleration_pid_out;
+		//what the steering may be shaped to at the measured speed, the
+		//autonomous commands only
+		steering_limit_point_t steering_limit;
+
+		uint32_t estop_in : 1;
+		//the IMU values are this cycle's
+		uint32_t imu_valid : 1;
+		//the front wheel speeds are, WheelSpeedFrontValid
+		uint32_t front_wheels_valid : 1;
+		uint32_t reverse : 1;
+		//commanded from the driving agent
+		uint32_t park_brake_commanded : 1;
+		uint32_t reverse_commanded : 1;
+		uint32_t autonomous_mode : 1;
+		uint32_t tele_operation_enabled : 1;
+		//limits the shapers have, 1 for tele operation's
+		uint32_t shaping_tele_operation : 1;
+		//from the stored parameters (ParamStore.h)
+		uint32_t override_pid : 1;
+		uint32_t estop_indicator : 1;
+		uint32_t pc_comm_active : 1;
+		//the requests come from trajectory rather than the holds
+		uint32_t following_trajectory : 1;
+		uint32_t debug_led_1 : 1;
+		uint32_t debug_led_2 : 1;
+		//whose outputs the cycle runs
+		vehicle_mode_state_t mode;
+
+		//what the outputs were last committed to, a cycle changes what it decides
+		//and leaves the rest as it was
+		actuator_command_t actuators;
+		command_shaper_t speed_shaper;
+		command_shaper_t steering_shaper;
+		command_hold_t speed_hold;
+		command_hold_t steering_hold;
+		//pose dead reckoned from the measured speed and steering angle
+		odometry_t odometry;
+		//speed gains by measured speed and feedforward by commanded speed
+		gain_schedule_t speed_schedule;
+		steering_limits_t steering_limits;
+		//throttle and brake held back while the wheels slip
+		traction_control_t traction;
+		//deadband, friction and play between the steering PID and the motor
+		steering_compensation_t steering_compensation;
+		control_scheduler_t scheduler;
+		//comm, sensor and actuator feedback timeouts
+		deadline_monitor_t deadlines;
+	};
+
+	//every cycle as well, each through its own pointer
 	PIDController steering_controller;
 	PIDController speed_controller;
-	float steering_torque_pid_out;
-	float acceleration_pid_out;
-	uint8_t override_pid;
-	float steer_p_gain_override;
-	float steer_i_gain_override;
-	float steer_d_gain_override;
-	float speed_p_gain_override;
-	float speed_i_gain_override;
-	float speed_d_gain_override;
+	//front brake duty cycle for the brake pressure, with BRAKE_PRESSURE_LOOP
+	PIDController brake_controller;
+	//the stages of the cycle and their timings
+	control_pipeline_t pipeline;
+	//setpoints of the trajectory commands, by PTP time
+	trajectory_buffer_t trajectory;
+	//the actuators' responses against their models
+	actuator_fault_t actuator_fault;
+
+	//cold
+	struct
+	{
+		//state as last recorded in the event log
+		uint8_t logged_estop;
+		float steer_p_gain_override;
+		float steer_i_gain_override;
+		float steer_d_gain_override;
+		float speed_p_gain_override;
+		float speed_i_gain_override;
+		float speed_d_gain_override;
+
+		//the parameters as last published, owned by whichever task runs the
+		//control channel once main_task runs
+		param_set_t params;
+		//lock-free hand-off of commands and telemetry between ethernet_thread and main_task
+		control_exchange_t exchange;
+		//per cycle PID history for gain tuning, read out by ethernet_thread
+		pid_trace_t trace;
+		//the cycle's inputs and outputs, with CONTROL_RECORD_ENABLE (ControlRecord.h)
+		control_record_t record;
+	};
 } main_context_t;
 
 #endif /* MAIN_CONTEXT_H_ */
\ No newline at end of file
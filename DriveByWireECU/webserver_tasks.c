@@ -31,27 +31,41 @@
  *
  */
 
+#include <string.h>
 #include "atmel_start.h"
 #include "webserver_tasks.h"
 #include "lwip/tcpip.h"
+#include "timers.h"
+#include "lwip_socket_api.h"
+#include "Log.h"
+#include "BootProfile.h"
+#include "PhyMonitor.h"
+#include "NetHealth.h"
+#include "CanHealth.h"
+#include "LockProfiler.h"
+#include "Ptp.h"
+#include "NetLatency.h"
+#include "LatencyProbe.h"
+#include "NodeIdentity.h"
+#include "SignalBus.h"
 
 uint16_t led_blink_rate = BLINK_NORMAL;
 
 gmac_device          gs_gmac_dev;
-static bool          link_up   = false;
 volatile static bool recv_flag = false;
 
-static TaskHandle_t xLed_Task;
-
 /**
- * OS task that blinks LED
+ * Timer service callback that blinks LED
  */
-static void led_task(void *p)
+static void led_timer_cb(TimerHandle_t timer)
 {
-	(void)p;
-	for (;;) {
-		gpio_toggle_pin_level(LED0);
-		os_sleep(led_blink_rate);
+	static uint16_t period = BLINK_NORMAL;
+
+	gpio_toggle_pin_level(LED0);
+	/* led_blink_rate can be changed at any time */
+	if (period != led_blink_rate) {
+		period = led_blink_rate;
+		xTimerChangePeriod(timer, pdMS_TO_TICKS(period), 0);
 	}
 }
 
@@ -62,41 +76,66 @@ void mac_receive_cb(struct mac_async_descriptor *desc)
 
 /**
  * \brief Callback for GMAC interrupt.
- * Give semaphore for which gmac_task waits
+ * Masks receive complete and notifies gmac_task. The rest of a burst raises
+ * no more interrupts, gmac_task takes every frame in one pass and unmasks
+ * receive complete again when the ring is empty, or leaves it masked while
+ * it polls under load (GMAC_RX_ADAPTIVE).
  */
 void gmac_handler_cb(void)
 {
 	portBASE_TYPE xGMACTaskWoken = pdFALSE;
-	xSemaphoreGiveFromISR(gs_gmac_dev.rx_sem, &xGMACTaskWoken);
+	NetLatencyInterrupt();
+	LatencyProbeInterrupt();
+	hri_gmac_clear_IMR_RCOMP_bit(COMMUNICATION_IO.dev.hw);
+	if (gs_gmac_dev.rx_task != NULL) {
+		vTaskNotifyGiveFromISR(gs_gmac_dev.rx_task, &xGMACTaskWoken);
+	}
 	portEND_SWITCHING_ISR(xGMACTaskWoken);
 }
 
+/**
+ * \brief Logs the address once the interface is up, with DHCP that is when
+ * a lease was bound.
+ */
+static void netif_status_cb(struct netif *netif)
+{
+	if (netif_is_up(netif)) {
+		print_ipaddress();
+	}
+}
+
 /**
  * \brief Invoked after completion of TCP/IP init
+ * Does not wait for the link. The interface starts with the link down, and
+ * PhyMonitor brings it up whenever the PHY has negotiated one, so the boot
+ * and the control loop never wait on a cable. The MAC and the static IP
+ * are this node's (NodeIdentity.h).
  */
 void tcpip_init_done(void *arg)
 {
 	sys_sem_t *sem;
 	sem         = (sys_sem_t *)arg;
-	u8_t mac[6] = {0x00, 0x00, 0x00, 0x00, 0x20, 0x76};
+	const node_identity_t* node = NodeIdentity();
+	u8_t mac[6];
+	memcpy(mac, node->mac, sizeof(mac));
 	mac_async_register_callback(&COMMUNICATION_IO, MAC_ASYNC_RECEIVE_CB, gmac_handler_cb);
 	hri_gmac_set_IMR_RCOMP_bit(COMMUNICATION_IO.dev.hw);
 
-	while ((ethernet_phy_get_link_status(&ETHERNET_PHY_0_desc, &link_up)) != ERR_NONE && !(link_up)) {
-		os_sleep(20);
-	}
-
-	printf("\r\nEthernet link up\r\n\r\n");
-
 	/* Enable NVIC GMAC interrupt. */
 	/* Interrupt priorities. (lowest value = highest priority) */
 	/* ISRs using FreeRTOS *FromISR APIs must have priorities below or equal to */
-	/* configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY. */
-	NVIC_SetPriority(GMAC_IRQn, 4);
+	/* configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY. The network shares the */
+	/* kernel's level so a flood never delays the control loop (irq_config.h). */
+	NVIC_SetPriority(GMAC_IRQn, IRQ_PRIORITY_NETWORK);
 	NVIC_EnableIRQ(GMAC_IRQn);
 	mac_async_enable(&COMMUNICATION_IO);
 
 	TCPIP_STACK_INTERFACE_0_init(mac);
+#if !CONF_TCPIP_STACK_INTERFACE_0_DHCP
+	ip_addr_t ip;
+	IP4_ADDR(&ip, node->ip[0], node->ip[1], node->ip[2], node->ip[3]);
+	netif_set_ipaddr(&TCPIP_STACK_INTERFACE_0_desc, &ip);
+#endif
 
 	TCPIP_STACK_INTERFACE_0_desc.input = tcpip_input;
 
@@ -104,13 +143,11 @@ void tcpip_init_done(void *arg)
 
 	sys_thread_t id;
 
-	/* Incoming packet notification semaphore. */
-	gs_gmac_dev.rx_sem = xSemaphoreCreateCounting(CONF_GMAC_RXDESCR_NUM, 0);
-
 	id = sys_thread_new("GMAC", gmac_task, &gs_gmac_dev, netifINTERFACE_TASK_STACK_SIZE, netifINTERFACE_TASK_PRIORITY);
 	LWIP_ASSERT("ethernetif_init: GMAC Task allocation ERROR!\n", (id != 0));
 
 	netif_set_default(&TCPIP_STACK_INTERFACE_0_desc);
+	netif_set_status_callback(&TCPIP_STACK_INTERFACE_0_desc, netif_status_cb);
 
 #if CONF_TCPIP_STACK_INTERFACE_0_DHCP
 	/* DHCP mode. */
@@ -122,6 +159,14 @@ void tcpip_init_done(void *arg)
 
 #endif
 
+	/* A link that is already up is picked up right away. */
+	PhyMonitorStart(&TCPIP_STACK_INTERFACE_0_desc);
+	NetHealthStart(&TCPIP_STACK_INTERFACE_0_desc);
+	CanHealthStart();
+	LockProfilerStart();
+	PtpStart(&TCPIP_STACK_INTERFACE_0_desc);
+	BootProfileMark(BOOT_STAGE_NETWORK);
+
 	sys_sem_signal(sem); /* Signal the waiting thread that the TCP/IP init is done. */
 }
 
@@ -132,24 +177,62 @@ void tcpip_init_done(void *arg)
 void gmac_task(void *pvParameters)
 {
 	gmac_device *ps_gmac_dev = pvParameters;
+#if GMAC_RX_ADAPTIVE
+	TickType_t window_start  = xTaskGetTickCount();
+	uint16_t   window_frames = 0;
+	uint8_t    polling       = 0;
+#endif
 
-	while (1) {
-		/* Wait for the counting RX notification semaphore. */
-		xSemaphoreTake(ps_gmac_dev->rx_sem, portMAX_DELAY);
+	/* Set here rather than by the creator, this task preempts it and
+	 * unmasks receive complete right away. */
+	ps_gmac_dev->rx_task = xTaskGetCurrentTaskHandle();
 
-		/* Process the incoming packet. */
+	while (1) {
+#if GMAC_RX_ADAPTIVE
+		window_frames += ethernetif_mac_input(ps_gmac_dev->netif);
+		if (xTaskGetTickCount() - window_start >= GMAC_RX_LOAD_WINDOW) {
+			uint8_t busy = window_frames >= (polling ? GMAC_RX_POLL_EXIT : GMAC_RX_POLL_ENTER);
+			if (busy != polling) {
+				polling = busy;
+				SignalPublishUint(SIGNAL_NET_RX_POLLING, polling);
+			}
+			window_start  = xTaskGetTickCount();
+			window_frames = 0;
+		}
+		if (polling) {
+			/* Receive complete stays masked as the interrupt that woke
+			 * the task left it, the next pass is a control ms away. */
+			vTaskDelay(GMAC_RX_POLL_TICKS);
+			NetLatencyWake();
+			continue;
+		}
+		hri_gmac_set_IMR_RCOMP_bit(COMMUNICATION_IO.dev.hw);
+		window_frames += ethernetif_mac_input(ps_gmac_dev->netif);
+#else
+		/* Process every ready descriptor, then take receive interrupts
+		 * again. A frame completing in between is picked up by the pass
+		 * after unmasking. */
+		ethernetif_mac_input(ps_gmac_dev->netif);
+		hri_gmac_set_IMR_RCOMP_bit(COMMUNICATION_IO.dev.hw);
 		ethernetif_mac_input(ps_gmac_dev->netif);
+#endif
+
+		/* Every interrupt since the last pass wakes the task once. The
+		 * timeout lets receive descriptors that found the pbuf pool empty
+		 * get refilled even when no more frames arrive to trigger it. */
+		ulTaskNotifyTake(pdTRUE, GMAC_RX_REFILL_TICKS);
+		NetLatencyWake();
 	}
 }
 
 /**
- * \brief Create OS task for LED blinking
+ * \brief Start the timer that blinks the LED
+ * Runs in the timer service with the other housekeeping, no task of its own.
  */
-void task_led_create(void)
+void led_timer_start(void)
 {
-
-	/* Create task to make led blink */
-	if (xTaskCreate(led_task, "Led", TASK_LED_STACK_SIZE, NULL, TASK_LED_TASK_PRIORITY, &xLed_Task) != pdPASS) {
+	TimerHandle_t timer = xTimerCreate("Led", pdMS_TO_TICKS(led_blink_rate), pdTRUE, NULL, led_timer_cb);
+	if (timer == NULL || xTimerStart(timer, 0) != pdPASS) {
 		while (1) {
 			;
 		}
@@ -36,15 +36,18 @@
 #include "hpl_gmac_config.h"
 #include "lwip_macif_config.h"
 #include "arch/sys_arch.h"
+#include "task_config.h"
 
-#define TASK_LED_STACK_SIZE (512 / sizeof(portSTACK_TYPE))
-#define TASK_LED_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
 
 #define TASK_ETHERNETBASIC_STACK_SIZE (1024 / sizeof(portSTACK_TYPE))
 #define TASK_ETHERNETBASIC_STACK_PRIORITY (tskIDLE_PRIORITY + 2)
 
-#define netifINTERFACE_TASK_STACK_SIZE 512
-#define netifINTERFACE_TASK_PRIORITY (tskIDLE_PRIORITY + 2)
+#if LWIP_TCPIP_CORE_LOCKING_INPUT
+#define netifINTERFACE_TASK_STACK_SIZE TASK_STACK_GMAC_INPUT
+#else
+#define netifINTERFACE_TASK_STACK_SIZE TASK_STACK_GMAC
+#endif
+#define netifINTERFACE_TASK_PRIORITY TASK_PRIORITY_GMAC
 
 /** Number of buffer for RX */
 #define GMAC_RX_BUFFERS 5
@@ -52,6 +55,34 @@
 /** Number of buffer for TX */
 #define GMAC_TX_BUFFERS 3
 
+/** Longest gmac_task sleeps without a receive interrupt */
+#define GMAC_RX_REFILL_TICKS pdMS_TO_TICKS(10)
+
+/** Adaptive receive. gmac_task counts the frames it takes over every
+ * GMAC_RX_LOAD_WINDOW. Once a window brings GMAC_RX_POLL_ENTER of them it
+ * leaves receive complete masked and drains the ring every
+ * GMAC_RX_POLL_TICKS instead, until a window brings fewer than
+ * GMAC_RX_POLL_EXIT. A flood then costs a pass per control ms, whatever
+ * its packet rate, and no interrupt or context switch per burst. What the
+ * ring cannot hold for a ms overruns and is counted in SIGNAL_NET_OVERRUNS.
+ * This GMAC has no interrupt moderation of its own. */
+#ifndef GMAC_RX_ADAPTIVE
+#define GMAC_RX_ADAPTIVE 1
+#endif
+#define GMAC_RX_LOAD_WINDOW pdMS_TO_TICKS(10)
+/** Frames per window, 4000 and 1000 per second */
+#ifndef GMAC_RX_POLL_ENTER
+#define GMAC_RX_POLL_ENTER 40
+#endif
+#ifndef GMAC_RX_POLL_EXIT
+#define GMAC_RX_POLL_EXIT 10
+#endif
+/** One ms, a control period at CONTROL_RATE_HZ 1000 and the shortest the
+ * tick can sleep at any rate. The receive ring (CONF_GMAC_RXDESCR_NUM) has
+ * to hold what arrives in that time, a ms of the small command frames the
+ * ECU is sent is a handful of descriptors. */
+#define GMAC_RX_POLL_TICKS pdMS_TO_TICKS(1)
+
 #define SYS_THREAD_MAX 8
 
 #define BLINK_NORMAL 500
@@ -60,15 +91,15 @@ void mac_receive_cb(struct mac_async_descriptor *desc);
 void gmac_handler_cb(void);
 void tcpip_init_done(void *arg);
 void gmac_task(void *pvParameters);
-void task_led_create();
+void led_timer_start();
 
 typedef struct tag_gmac_device {
 	/** Reference to lwIP netif structure. */
 	struct netif *netif;
 
 #if NO_SYS == 0
-	/** RX task notification semaphore. */
-	sys_sem_t rx_sem;
+	/** gmac_task, notified by the receive interrupt. */
+	TaskHandle_t rx_task;
 #endif
 } gmac_device;
 
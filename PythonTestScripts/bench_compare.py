@@ -0,0 +1,94 @@
+"""Reads the results of the Bench image (BenchImage.h) and gates them against a baseline.
+
+    python bench_compare.py console.log --save baseline.json
+    python bench_compare.py console.log --compare baseline.json
+    python usb_debug.py | python bench_compare.py - --compare baseline.json --threshold 5
+
+The Bench configuration runs its microbenchmark catalogue once at boot and
+logs one "bench <name> <min> <mean> <max>" line per case, in core cycles
+less the cost of timing an empty call, followed by "bench done". The
+network cases (BenchNetwork.h) are bench lines as well, their "net" rate
+lines are left out. The input is a capture of that log, a file or - for
+stdin, read until the done line. Every case is printed; --save keeps them
+as JSON, --compare prints the change in min and mean against a saved run
+and exits with 1 if either grew by more than --threshold percent, or a case
+failed or went missing. The min is the one to trust, the mean and max take
+whatever interrupts hit the case. Standard library only.
+"""
+
+import argparse
+import json
+import sys
+
+
+def parse(lines):
+    """{name: {min, mean, max, failed}} of every result line, up to bench done."""
+    cases = {}
+    for line in lines:
+        fields = line.split()
+        if "bench" not in fields:
+            continue
+        fields = fields[fields.index("bench") + 1:]
+        if fields == ["done"]:
+            break
+        if len(fields) < 4 or not all(field.isdigit() for field in fields[1:4]):
+            continue
+        failed = int(fields[5]) if len(fields) >= 6 and fields[4] == "failed" and fields[5].isdigit() else 0
+        cases[fields[0]] = {"min": int(fields[1]), "mean": int(fields[2]), "max": int(fields[3]), "failed": failed}
+    return cases
+
+
+def change(new, old):
+    return 100.0 * new / old - 100 if old else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="captured log, - for stdin")
+    parser.add_argument("--save", metavar="FILE", help="keep the results as JSON")
+    parser.add_argument("--compare", metavar="FILE", help="results saved from the baseline build")
+    parser.add_argument("--threshold", type=float, default=10.0, help="percent a min or mean may grow by")
+    args = parser.parse_args()
+
+    if args.log == "-":
+        cases = parse(sys.stdin)
+    else:
+        with open(args.log, errors="replace") as f:
+            cases = parse(f)
+    if not cases:
+        sys.exit("no bench lines in %s" % args.log)
+
+    baseline = {}
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+
+    regressions = []
+    print("%-24s %8s %8s %8s" % ("cycles", "min", "mean", "max"))
+    for name, case in cases.items():
+        line = "%-24s %8d %8d %8d" % (name, case["min"], case["mean"], case["max"])
+        if case["failed"]:
+            line += "   %d failed" % case["failed"]
+            regressions.append(name)
+        elif name in baseline:
+            low, mean = change(case["min"], baseline[name]["min"]), change(case["mean"], baseline[name]["mean"])
+            line += "   min %+6.1f%%  mean %+6.1f%%" % (low, mean)
+            if low > args.threshold or mean > args.threshold:
+                line += "  regression"
+                regressions.append(name)
+        print(line)
+    for name in sorted(set(baseline) - set(cases)):
+        print("%-24s missing" % name)
+        regressions.append(name)
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(cases, f, indent=1)
+    if regressions:
+        print("%d of %d cases regressed: %s" % (len(regressions), len(cases), ", ".join(regressions)), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,242 @@
+"""Compares two builds of the ECU, Release (-Os) against Performance (-O2, LTO),
+or two build profiles (feature_config.h), Performance against Production.
+
+    python build_compare.py size Release/DriveByWireECU.elf Performance/DriveByWireECU.elf
+    python build_compare.py profile --save os.json
+    python build_compare.py profile --save o2.json --compare os.json
+    python build_compare.py boot --save full.json
+    python build_compare.py boot --save production.json --compare full.json
+
+size prints the flash and RAM each build takes, from arm-none-eabi-size,
+and the functions whose size changed most, from arm-none-eabi-nm.
+
+profile resets the ECU's control loop stage timings (Profiler.h), waits
+--wait seconds of running and reads them back with the profile request
+(ControlProtocol.h, version 16). It prints the samples, min, mean and max
+core cycles of every stage that ran. Run it once against each build on
+the same bench setup; --save keeps the result, --compare prints the change
+in mean and max against a saved one. The cycle stage is also put against
+the budget of one control cycle at --rate Hz (CONTROL_RATE_HZ), by default
+the rate its samples came at over the wait; a max over the budget fails.
+
+boot reads the boot profile (BootProfile.h) with the boot request and
+prints the us from main to every boot stage, up to the link. Power cycle
+the ECU before each run, the times are those of the boot it is running;
+--save and --compare work as for profile. PID_BENCHMARK and FILTER_BENCHMARK
+builds print their own cycle counts at boot. Standard library only.
+"""
+
+import argparse
+import json
+import socket
+import struct
+import subprocess
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_PROFILE_REQUEST = 6
+FRAME_PROFILE_DATA = 7
+FRAME_BOOT_REQUEST = 14
+FRAME_BOOT_DATA = 15
+BOOT_NOT_REACHED = 0xFFFFFFFF
+PROFILE_READ = 0
+PROFILE_RESET = 1
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+COMMAND_PORT = 12090
+
+# in profiler_stage_t order
+STAGES = ("cycle", "inputs", "algorithms", "steering_pid", "speed_pid", "outputs",
+          "eth_receive", "eth_send", "wake", "steering_rate", "estop", "gmac_isr",
+          "can_receive", "steering_rate_jitter", "command_auth", "traction")
+# the CONTROL_RATE_HZ a build can have
+CONTROL_RATES = (1000, 2000, 4000, 5000)
+# in boot_stage_t order
+BOOT_STAGES = ("main", "mcu", "pins", "adc", "target_io", "pwm", "can", "mac", "phy", "stdio", "io",
+               "control", "scheduler", "first_cycle", "network", "link_up",
+               "first_command")
+# arm-none-eabi-size -A sections that end up in flash and in RAM
+FLASH_SECTIONS = (".text", ".relocate")
+RAM_SECTIONS = (".relocate", ".bss", ".stack", ".noinit", ".gmac")
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def sections(tool, elf):
+    sizes = {}
+    for line in subprocess.check_output([tool + "size", "-A", elf], text=True).splitlines():
+        fields = line.split()
+        # debug info never reaches the target
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit() \
+                and not fields[0].startswith((".debug", ".comment", ".ARM.attributes")):
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def functions(tool, elf):
+    sizes = {}
+    for line in subprocess.check_output([tool + "nm", "-S", "--size-sort", elf], text=True).splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in "tTwW":
+            sizes[fields[3]] = sizes.get(fields[3], 0) + int(fields[1], 16)
+    return sizes
+
+
+def compare_size(args):
+    old, new = sections(args.tool, args.old), sections(args.tool, args.new)
+    print("%-12s %10s %10s %8s" % ("", args.old.split("/")[0], args.new.split("/")[0], "change"))
+    for name in sorted(set(old) | set(new)):
+        a, b = old.get(name, 0), new.get(name, 0)
+        print("%-12s %10d %10d %+8d" % (name, a, b, b - a))
+    for label, names in (("flash", FLASH_SECTIONS), ("ram", RAM_SECTIONS)):
+        a, b = sum(old.get(n, 0) for n in names), sum(new.get(n, 0) for n in names)
+        print("%-12s %10d %10d %+8d" % (label, a, b, b - a))
+
+    old, new = functions(args.tool, args.old), functions(args.tool, args.new)
+    changed = sorted(set(old) | set(new), key=lambda f: -abs(new.get(f, 0) - old.get(f, 0)))
+    print("\nfunctions that changed most, 0 where LTO inlined them all")
+    for name in changed[:args.top]:
+        a, b = old.get(name, 0), new.get(name, 0)
+        if a != b:
+            print("%-40s %8d %8d %+8d" % (name, a, b, b - a))
+    return 0
+
+
+def request(sock, args, frame_type, payload, answer_type, sequence):
+    sock.sendto(frame(frame_type, sequence, payload), (args.ecu, args.port))
+    deadline = time.monotonic() + args.timeout
+    while time.monotonic() < deadline:
+        try:
+            data = sock.recv(4096)
+        except socket.timeout:
+            break
+        if len(data) < HEADER.size + 6 + CRC.size:
+            continue
+        version, frame_type, length, _, _ = HEADER.unpack_from(data)
+        if version != PROTOCOL_VERSION or frame_type != answer_type or len(data) < HEADER.size + length + CRC.size:
+            continue
+        if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+            continue
+        return data[HEADER.size:HEADER.size + length]
+    sys.exit("no answer from %s" % args.ecu)
+
+
+def profile_request(sock, args, action, sequence):
+    return request(sock, args, FRAME_PROFILE_REQUEST, bytes([action]), FRAME_PROFILE_DATA, sequence)
+
+
+def parse_profile(payload):
+    core_clock, count, bins = struct.unpack_from("<IBB", payload)
+    stages = {}
+    offset = 6
+    for index in range(count):
+        samples, low, high, mean = struct.unpack_from("<IIII", payload, offset)
+        offset += 16 + 4 * bins
+        name = STAGES[index] if index < len(STAGES) else str(index)
+        if samples:
+            stages[name] = {"samples": samples, "min": low, "mean": mean, "max": high}
+    return {"core_clock": core_clock, "stages": stages}
+
+
+def run_profile(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+    profile_request(sock, args, PROFILE_RESET, 1)
+    time.sleep(args.wait)
+    result = parse_profile(profile_request(sock, args, PROFILE_READ, 2))
+
+    baseline = None
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)["stages"]
+    print("core clock %d Hz, cycles" % result["core_clock"])
+    for name, stage in result["stages"].items():
+        line = "%-14s %8d %8d %8d %8d" % (name, stage["samples"], stage["min"], stage["mean"], stage["max"])
+        if baseline and name in baseline and baseline[name]["mean"] and baseline[name]["max"]:
+            line += "   mean %+6.1f%%  max %+6.1f%%" % (100.0 * stage["mean"] / baseline[name]["mean"] - 100,
+                                                     100.0 * stage["max"] / baseline[name]["max"] - 100)
+        print(line)
+    over = check_budget(result, args)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(result, f, indent=1)
+    return 1 if over else 0
+
+
+def check_budget(result, args):
+    cycle = result["stages"].get("cycle")
+    if cycle is None:
+        return False
+    rate = args.rate or min(CONTROL_RATES, key=lambda r: abs(r - cycle["samples"] / args.wait))
+    budget = result["core_clock"] // rate
+    print("budget %d cycles at %d Hz, mean %.1f%%  max %.1f%%" % (
+        budget, rate, 100.0 * cycle["mean"] / budget, 100.0 * cycle["max"] / budget))
+    if cycle["max"] > budget:
+        print("the cycle ran over its budget")
+        return True
+    return False
+
+
+def run_boot(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+    payload = request(sock, args, FRAME_BOOT_REQUEST, b"", FRAME_BOOT_DATA, 1)
+    reset_cause, count = payload[0], payload[1]
+    stages = {}
+    for index in range(count):
+        us = struct.unpack_from("<I", payload, 2 + 4 * index)[0]
+        if us != BOOT_NOT_REACHED:
+            stages[BOOT_STAGES[index] if index < len(BOOT_STAGES) else str(index)] = us
+
+    baseline = None
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)["stages"]
+    print("reset cause 0x%02x, us since main" % reset_cause)
+    for name, us in stages.items():
+        line = "%-12s %10d" % (name, us)
+        if baseline and name in baseline:
+            line += "   %+10d" % (us - baseline[name])
+        print(line)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump({"reset_cause": reset_cause, "stages": stages}, f, indent=1)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    size = commands.add_parser("size", help="flash, RAM and function sizes of two ELF files")
+    size.add_argument("old")
+    size.add_argument("new")
+    size.add_argument("--tool", default="arm-none-eabi-", help="binutils prefix")
+    size.add_argument("--top", type=int, default=20, help="functions to list")
+    profile = commands.add_parser("profile", help="stage timings of the running build")
+    profile.add_argument("--ecu", default="192.168.2.100")
+    profile.add_argument("--port", type=int, default=COMMAND_PORT)
+    profile.add_argument("--timeout", type=float, default=1.0)
+    profile.add_argument("--wait", type=float, default=10.0, help="seconds between the reset and the read")
+    profile.add_argument("--save", metavar="FILE", help="keep the result as JSON")
+    profile.add_argument("--compare", metavar="FILE", help="a result saved from the other build")
+    profile.add_argument("--rate", type=int, default=0, help="control cycles per second, 0 to tell from the samples")
+    boot = commands.add_parser("boot", help="boot stage times of the running build")
+    boot.add_argument("--ecu", default="192.168.2.100")
+    boot.add_argument("--port", type=int, default=COMMAND_PORT)
+    boot.add_argument("--timeout", type=float, default=1.0)
+    boot.add_argument("--save", metavar="FILE", help="keep the result as JSON")
+    boot.add_argument("--compare", metavar="FILE", help="a result saved from the other build")
+    args = parser.parse_args()
+    if args.command == "size":
+        return compare_size(args)
+    return run_profile(args) if args.command == "profile" else run_boot(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
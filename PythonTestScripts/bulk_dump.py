@@ -0,0 +1,170 @@
+"""Dumps the ECU's frozen PID trace, its event log or its frozen black box over the bulk channel (BulkChannel.h).
+
+    python bulk_dump.py trace trace.csv
+    python bulk_dump.py trace-packed trace.csv
+    python bulk_dump.py events events.csv
+    python bulk_dump.py blackbox blackbox.csv
+    python bulk_dump.py rearm
+
+Connects to the ECU's bulk port, asks for one dump and writes it out as
+CSV, one row per sample or event, with the time the transfer took. The
+trace has to be frozen already, trigger it with the control channel's
+trace request. trace-packed gets the same samples packed (DeltaCodec.h)
+and unpacks them with delta_codec.py. Events that were overwritten before they were sent are
+left out, as are the unused entries of the black box. rearm starts the
+black box recording again and writes nothing. Standard library only.
+"""
+
+import argparse
+import csv
+import socket
+import struct
+import sys
+import time
+
+import delta_codec
+
+BULK_PORT = 12092
+BULK_VERSION = 1
+HEADER = struct.Struct("<4sBBHIIBBxx")
+REQUESTS = {"trace": 1, "events": 2, "blackbox": 3, "rearm": 4, "trace-packed": 5}
+
+TRACE_STATES = ("armed", "triggered", "frozen")
+TERMS = ("setpoint", "feedback", "error", "integral", "p", "i", "d", "output")
+CONTROLLERS = ("steering", "speed")
+SAMPLE = struct.Struct("<I16i")
+EVENT = struct.Struct("<IIHHI")
+EVENT_NAMES = {1: "boot", 2: "estop", 3: "mode", 4: "deadline", 5: "overrun", 6: "params", 7: "link",
+               8: "ram_ecc", 9: "watchdog", 10: "stack_overflow", 11: "firmware",
+               12: "redundancy", 13: "calibration", 14: "autotune", 15: "excitation",
+               16: "actuator_fault", 17: "self_test", 18: "integrity"}
+
+BLACK_BOX_STATES = ("off", "recording", "triggered", "frozen")
+BLACK_BOX_ENTRY = struct.Struct("<BBHI24s")
+BLACK_BOX_CONTROL = struct.Struct("<6f")
+BLACK_BOX_SECTOR = struct.Struct("<III12x")
+BLACK_BOX_TYPES = {1: "sector", 2: "control", 3: "event", 4: "freeze"}
+CONTROL_FIELDS = ("vehicle_speed", "steering_angle", "vehicle_speed_commanded", "steering_angle_commanded",
+                  "acceleration", "steering_torque")
+
+
+def receive_all(sock):
+    chunks = []
+    while True:
+        data = sock.recv(65536)
+        if not data:
+            return b"".join(chunks)
+        chunks.append(data)
+
+
+def write_trace(writer, header, body):
+    _, _, _, entry_size, count, trigger_tick, reason, state = header
+    if state != 2:
+        state_name = TRACE_STATES[state] if state < len(TRACE_STATES) else str(state)
+        sys.exit("trace is %s, nothing to dump" % state_name)
+    if entry_size == 0:
+        samples = delta_codec.unpack(body, SAMPLE.format, count)
+    elif entry_size == SAMPLE.size:
+        samples = (SAMPLE.unpack_from(body, i * entry_size) for i in range(count))
+    else:
+        sys.exit("trace samples are %d bytes, expected %d" % (entry_size, SAMPLE.size))
+    writer.writerow(["tick"] + ["%s_%s" % (c, t) for c in CONTROLLERS for t in TERMS])
+    for sample in samples:
+        writer.writerow(sample)
+    packed = " packed in %d bytes, %.1fx" % (len(body), count * SAMPLE.size / len(body)) if entry_size == 0 and body else ""
+    return "%d samples%s, trigger 0x%02x at tick %d" % (count, packed, reason, trigger_tick)
+
+
+def write_events(writer, header, body):
+    _, _, _, entry_size, count, first, _, _ = header
+    if entry_size != EVENT.size:
+        sys.exit("events are %d bytes, expected %d" % (entry_size, EVENT.size))
+    writer.writerow(["sequence", "tick", "event", "arg", "value"])
+    kept = 0
+    for i in range(count):
+        sequence, tick, event_id, arg, value = EVENT.unpack_from(body, i * entry_size)
+        if sequence == 0:
+            continue
+        writer.writerow([sequence, tick, EVENT_NAMES.get(event_id, event_id), arg, value])
+        kept += 1
+    return "%d events from %d, %d overwritten" % (kept, first, count - kept)
+
+
+def write_black_box(writer, header, body):
+    _, _, _, entry_size, count, cause_sequence, cause, state = header
+    if state != 3:
+        state_name = BLACK_BOX_STATES[state] if state < len(BLACK_BOX_STATES) else str(state)
+        sys.exit("black box is %s, nothing to dump" % state_name)
+    if entry_size != BLACK_BOX_ENTRY.size:
+        sys.exit("black box entries are %d bytes, expected %d" % (entry_size, BLACK_BOX_ENTRY.size))
+    writer.writerow(["type", "tick", "flags", "front_brake"] + list(CONTROL_FIELDS)
+                    + ["event_sequence", "event", "arg", "value", "sector_sequence", "session"])
+    empty = [""] * len(CONTROL_FIELDS)
+    kept = 0
+    for i in range(count):
+        entry_type, flags, arg, tick, data = BLACK_BOX_ENTRY.unpack_from(body, i * entry_size)
+        name = BLACK_BOX_TYPES.get(entry_type)
+        if name is None:
+            continue
+        row = [name, tick]
+        if name == "control":
+            row += [flags, arg / 65535.0] + list(BLACK_BOX_CONTROL.unpack_from(data)) + [""] * 6
+        elif name == "sector":
+            _, sequence, session = BLACK_BOX_SECTOR.unpack_from(data)
+            row += ["", ""] + empty + ["", "", "", "", sequence, session]
+        else:
+            sequence, _, event_id, event_arg, value = EVENT.unpack_from(data)
+            row += ["", ""] + empty + [sequence, EVENT_NAMES.get(event_id, event_id), event_arg, value, "", ""]
+        writer.writerow(row)
+        kept += 1
+    return "%d entries in %d sectors, frozen by %s %d" % (kept, count * entry_size // 4096,
+                                                          EVENT_NAMES.get(cause, cause), cause_sequence)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", choices=sorted(REQUESTS))
+    parser.add_argument("output", nargs="?", help="CSV file to write, not for rearm")
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--port", type=int, default=BULK_PORT)
+    parser.add_argument("--timeout", type=float, default=5.0)
+    args = parser.parse_args()
+    if (args.output is None) != (args.dump == "rearm"):
+        parser.error("rearm takes no output, the dumps need one")
+
+    start = time.monotonic()
+    with socket.create_connection((args.ecu, args.port), timeout=args.timeout) as sock:
+        sock.sendall(bytes([REQUESTS[args.dump]]))
+        data = receive_all(sock)
+    elapsed = time.monotonic() - start
+
+    if len(data) < HEADER.size:
+        sys.exit("short dump from %s, %d bytes" % (args.ecu, len(data)))
+    header = HEADER.unpack_from(data)
+    magic, version, dump_type, entry_size, count = header[:5]
+    if magic != b"DBWB" or version != BULK_VERSION or dump_type != REQUESTS[args.dump]:
+        sys.exit("not a version %d %s dump" % (BULK_VERSION, args.dump))
+    body = data[HEADER.size:]
+    # packed, the size only shows when it is unpacked
+    if entry_size != 0 and len(body) != count * entry_size:
+        sys.exit("dump cut short, %d of %d bytes" % (len(body), count * entry_size))
+    if args.dump == "rearm":
+        state = header[7]
+        print("black box %s" % (BLACK_BOX_STATES[state] if state < len(BLACK_BOX_STATES) else state))
+        return 0 if state == 1 else 1
+
+    with open(args.output, "w", newline="") as output:
+        writer = csv.writer(output)
+        if args.dump in ("trace", "trace-packed"):
+            summary = write_trace(writer, header, body)
+        elif args.dump == "blackbox":
+            summary = write_black_box(writer, header, body)
+        else:
+            summary = write_events(writer, header, body)
+    rate = len(data) / elapsed / 1000 if elapsed > 0 else 0
+    print("%s, %d bytes in %.3f s, %.0f kB/s" % (summary, len(data), elapsed, rate))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
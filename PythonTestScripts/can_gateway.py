@@ -0,0 +1,160 @@
+"""Logs the cart's CAN bus through the ECU and puts frames on it (CanGateway.h).
+
+    python can_gateway.py
+    python can_gateway.py --filter 0x100/0x700 --filter x0x18FF0000/0x1FFF0000 --flush 2
+    python can_gateway.py --send 0x123#11223344 --send x0x18FF1234#00
+
+Configures the gateway to forward the frames that pass the filters to this
+PC, renews the config inside the ECU's lease and prints every frame in
+candump's style with the time it started on the bus, PTP time once the ECU
+has synced, its time base (marked with a *) until then. Frames given with
+--send go out in one TX batch after the config. An x before an id makes it
+extended. No filter forwards every standard id. Ctrl-C stops forwarding.
+Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+GATEWAY_PORT = 12096
+GATEWAY_VERSION = 1
+CONFIG, STATUS, RX_BATCH, TX_BATCH = 1, 2, 3, 4
+HEADER = struct.Struct("<4sBBH")
+CONFIG_PAYLOAD = struct.Struct("<B4sHHB")
+FILTER = struct.Struct("<II")
+STATUS_PAYLOAD = struct.Struct("<BBIIII")
+RX_BATCH_PAYLOAD = struct.Struct("<BI")
+RX_FRAME = struct.Struct("<IIB")
+ID_EXTENDED = 0x80000000
+ID_TIME_BASE = 0x40000000
+RENEW = 1.0
+
+
+def parse_id(text):
+    if text.startswith("x"):
+        return int(text[1:], 0) | ID_EXTENDED
+    return int(text, 0)
+
+
+def parse_filter(text):
+    id_text, _, mask_text = text.partition("/")
+    extended = id_text.startswith("x")
+    mask = int(mask_text, 0) if mask_text else (0x1FFFFFFF if extended else 0x7FF)
+    return parse_id(id_text), mask
+
+
+def parse_frame(text):
+    id_text, _, data = text.partition("#")
+    return parse_id(id_text), bytes.fromhex(data)
+
+
+class Gateway:
+    def __init__(self, ecu, port):
+        self.ecu = (ecu, port)
+        self.sequence = 0
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        self.sock.bind(("", 0))
+
+    def send(self, kind, payload):
+        self.sock.sendto(HEADER.pack(b"DBWG", GATEWAY_VERSION, kind, self.sequence & 0xFFFF) + payload, self.ecu)
+        self.sequence += 1
+
+    def configure(self, forward, filters, flush):
+        payload = CONFIG_PAYLOAD.pack(forward, b"\0\0\0\0", 0, flush, len(filters))
+        self.send(CONFIG, payload + b"".join(FILTER.pack(*f) for f in filters))
+
+    def transmit(self, frames):
+        payload = bytes([len(frames)])
+        for frame_id, data in frames:
+            payload += struct.pack("<IB", frame_id, len(data)) + data
+        self.send(TX_BATCH, payload)
+
+
+def print_status(payload):
+    forwarding, hardware, forwarded, lost, sent, dropped = STATUS_PAYLOAD.unpack_from(payload)
+    print("# forwarding %d, %d filters in hardware, forwarded %d lost %d, sent %d dropped %d" % (
+        forwarding, hardware, forwarded, lost, sent, dropped), file=sys.stderr)
+
+
+def print_batch(payload, lost_before):
+    count, lost = RX_BATCH_PAYLOAD.unpack_from(payload)
+    if lost != lost_before:
+        print("# %d frames lost in the ECU" % (lost - lost_before), file=sys.stderr)
+    offset = RX_BATCH_PAYLOAD.size
+    for _ in range(count):
+        us, frame_id, length = RX_FRAME.unpack_from(payload, offset)
+        data = payload[offset + RX_FRAME.size:offset + RX_FRAME.size + length]
+        offset += RX_FRAME.size + length
+        if frame_id & ID_EXTENDED:
+            text = "%08X" % (frame_id & 0x1FFFFFFF)
+        else:
+            text = "%03X" % (frame_id & 0x7FF)
+        mark = "*" if frame_id & ID_TIME_BASE else " "
+        print("(%10.6f)%s can0 %s [%d] %s" % (us / 1e6, mark, text, length, " ".join("%02X" % b for b in data)))
+    return lost
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--port", type=int, default=GATEWAY_PORT)
+    parser.add_argument("--filter", action="append", default=[], help="[x]id[/mask], up to 16")
+    parser.add_argument("--flush", type=int, default=0, help="ms a frame waits for its batch, 0 for the ECU's")
+    parser.add_argument("--send", action="append", default=[], help="[x]id#hexdata")
+    parser.add_argument("--duration", type=float, default=0, help="s, 0 until Ctrl-C")
+    args = parser.parse_args()
+
+    filters = [parse_filter(f) for f in args.filter] or [(0, 0)]
+    if len(filters) > 16:
+        sys.exit("at most 16 filters")
+    frames = [parse_frame(f) for f in args.send]
+
+    gateway = Gateway(args.ecu, args.port)
+    gateway.sock.settimeout(0.2)
+    gateway.configure(1, filters, args.flush)
+    if frames:
+        gateway.transmit(frames)
+
+    start = renewed = time.monotonic()
+    lost = None
+    try:
+        while not args.duration or time.monotonic() - start < args.duration:
+            if time.monotonic() - renewed >= RENEW:
+                gateway.configure(1, filters, args.flush)
+                renewed = time.monotonic()
+            try:
+                data = gateway.sock.recv(2048)
+            except socket.timeout:
+                continue
+            if len(data) < HEADER.size:
+                continue
+            magic, version, kind, _ = HEADER.unpack_from(data)
+            if magic != b"DBWG" or version != GATEWAY_VERSION:
+                continue
+            payload = data[HEADER.size:]
+            if kind == STATUS and lost is None:
+                print_status(payload)
+                lost = STATUS_PAYLOAD.unpack_from(payload)[3]
+            elif kind == RX_BATCH:
+                lost = print_batch(payload, lost if lost is not None else RX_BATCH_PAYLOAD.unpack_from(payload)[1])
+    except KeyboardInterrupt:
+        pass
+    finally:
+        gateway.configure(0, [], 0)
+        gateway.sock.settimeout(1.0)
+        try:
+            while True:
+                data = gateway.sock.recv(2048)
+                if HEADER.unpack_from(data)[2] == STATUS:
+                    print_status(data[HEADER.size:])
+                    break
+        except (socket.timeout, struct.error):
+            pass
+
+
+if __name__ == "__main__":
+    main()
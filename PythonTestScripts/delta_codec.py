@@ -0,0 +1,45 @@
+"""Decoder for the ECU's packed records (DeltaCodec.h).
+
+Records are fixed sets of 32-bit words. Each word is the zigzag folded
+difference to the same word of the record before as a varint, 7 bits a
+byte, low bits first, the top bit set on every byte but the last. Decoding
+starts where the ECU reset its codec, with the words of the record before
+all zero. Standard library only.
+"""
+
+import struct
+
+
+def decode(data, fields, count=None, offset=0):
+    """Yields each record of data from offset on as a tuple of fields
+    unsigned words, count of them or until data ends."""
+    last = [0] * fields
+    end = len(data)
+    decoded = 0
+    while (count is None or decoded < count) and offset < end:
+        for i in range(fields):
+            value = 0
+            shift = 0
+            while True:
+                if offset >= end:
+                    raise ValueError("packed record %d cut short" % decoded)
+                byte = data[offset]
+                offset += 1
+                value |= (byte & 0x7F) << shift
+                shift += 7
+                if byte < 0x80:
+                    break
+            delta = (value >> 1) ^ -(value & 1)
+            last[i] = (last[i] + delta) & 0xFFFFFFFF
+        decoded += 1
+        yield tuple(last)
+    if count is not None and decoded < count:
+        raise ValueError("%d of %d packed records" % (decoded, count))
+
+
+def unpack(data, layout, count=None, offset=0):
+    """decode(), each record's words read back as the struct layout."""
+    layout = struct.Struct(layout)
+    words = struct.Struct("<%dI" % (layout.size // 4))
+    for record in decode(data, layout.size // 4, count, offset):
+        yield layout.unpack(words.pack(*record))
@@ -0,0 +1,137 @@
+"""Finds the ECUs on the network and the addresses each node answers on (NodeIdentity.h).
+
+    python ecu_discover.py
+    python ecu_discover.py --node 1 --address
+    python param_tool.py read --ecu $(python ecu_discover.py --node 1 --address)
+    python ecu_discover.py --listen
+
+Broadcasts a discover request of the UDP control protocol (ControlProtocol.h,
+version 16) to the discovery port and prints the announce frame of every
+node that answers within --timeout: node id, IP, MAC, ports and boot count.
+--node only asks that node, and with --address only its IP is printed, so
+the other scripts can be pointed at one ECU of a vehicle by its node id.
+--listen instead joins the telemetry group and prints the announces the
+nodes send on their own every few seconds, and when a node's boot count
+changes. Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_DISCOVER = 20
+FRAME_ANNOUNCE = 21
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+ANNOUNCE = struct.Struct("<B6s4sHHI")
+
+DISCOVERY_PORT = 12092
+TELEMETRY_GROUP = "239.192.2.100"
+NODE_ANY = 0xFF
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def parse_announce(data):
+    """{node, ip, mac, command_port, param_port, boot_count} or None."""
+    if len(data) < HEADER.size + ANNOUNCE.size + CRC.size:
+        return None
+    version, frame_type, length, _, _ = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or frame_type != FRAME_ANNOUNCE or len(data) != HEADER.size + length + CRC.size:
+        return None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None
+    node, mac, ip, command_port, param_port, boot_count = ANNOUNCE.unpack_from(data, HEADER.size)
+    return {"node": node, "ip": socket.inet_ntoa(ip), "mac": mac.hex(":"), "command_port": command_port,
+            "param_port": param_port, "boot_count": boot_count}
+
+
+def describe(announce):
+    return "node %3d  %-15s  %s  command %d  param %d  boot %d" % (
+        announce["node"], announce["ip"], announce["mac"], announce["command_port"], announce["param_port"],
+        announce["boot_count"])
+
+
+def discover(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    sock.settimeout(args.timeout)
+    node = NODE_ANY if args.node is None else args.node
+    sock.sendto(frame(FRAME_DISCOVER, 1, struct.pack("<B", node)), (args.broadcast, args.port))
+
+    found = {}
+    deadline = time.monotonic() + args.timeout
+    while time.monotonic() < deadline:
+        sock.settimeout(max(0.001, deadline - time.monotonic()))
+        try:
+            data = sock.recv(2048)
+        except socket.timeout:
+            break
+        announce = parse_announce(data)
+        if announce is not None:
+            found[announce["node"]] = announce
+            # one answer is all there is to wait for
+            if args.node is not None:
+                break
+    return found
+
+
+def listen(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", args.port))
+    membership = struct.pack("4s4s", socket.inet_aton(args.group), socket.inet_aton(args.interface))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+
+    boots = {}
+    try:
+        while True:
+            announce = parse_announce(sock.recv(2048))
+            if announce is None or (args.node is not None and announce["node"] != args.node):
+                continue
+            previous = boots.get(announce["node"])
+            boots[announce["node"]] = announce["boot_count"]
+            note = "  rebooted" if previous is not None and previous != announce["boot_count"] else ""
+            print("%s  %s%s" % (time.strftime("%H:%M:%S"), describe(announce), note))
+    except KeyboardInterrupt:
+        return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--node", type=int, help="only this node id")
+    parser.add_argument("--address", action="store_true", help="print only the IP of --node")
+    parser.add_argument("--listen", action="store_true", help="print the announces sent to the telemetry group")
+    parser.add_argument("--broadcast", default="255.255.255.255")
+    parser.add_argument("--port", type=int, default=DISCOVERY_PORT)
+    parser.add_argument("--group", default=TELEMETRY_GROUP)
+    parser.add_argument("--interface", default="0.0.0.0", help="local address to join the group on")
+    parser.add_argument("--timeout", type=float, default=1.0)
+    args = parser.parse_args()
+
+    if args.address and args.node is None:
+        parser.error("--address needs --node")
+    if args.listen:
+        return listen(args)
+
+    found = discover(args)
+    if not found:
+        sys.exit("no ECU answered" if args.node is None else "node %d did not answer" % args.node)
+    if args.address:
+        print(found[args.node]["ip"])
+        return 0
+    for node in sorted(found):
+        print(describe(found[node]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
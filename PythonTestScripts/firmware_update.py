@@ -0,0 +1,86 @@
+"""Flashes a new image into the ECU's other flash bank over Ethernet and swaps to it (FirmwareUpdate.h).
+
+    python firmware_update.py Performance/DriveByWireECU.bin
+    python firmware_update.py Release/DriveByWireECU.bin --ecu $(python ecu_discover.py --node 2 --address)
+
+Sends the .bin of a build to the ECU's update port, behind a header with
+its length and CRC-32, and waits for the answer. The ECU programs the
+image as it arrives, so the transfer runs at the speed of the flash, then
+checks the CRC of what is in it and swaps banks, which resets it into the
+new image. Only taken while the cart is Disabled or in Estop. The new
+image runs on trial: if it resets before it has run its control loop for
+10 s a few times in a row the ECU goes back to the old one, the event log
+shows which happened. Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+UPDATE_PORT = 12094
+UPDATE_VERSION = 1
+HEADER = struct.Struct("<4sBxxxII")
+REPLY = struct.Struct("<BxxxI")
+MAX_IMAGE = 0x80000 - 2 * 8192
+
+STATUSES = ("ok, swapping banks", "bad header", "image too large", "cart not stopped", "flash error at 0x%08x",
+            "CRC mismatch, flash has 0x%08x", "another update is running")
+
+
+def receive_reply(sock):
+    data = b""
+    while len(data) < REPLY.size:
+        chunk = sock.recv(REPLY.size - len(data))
+        if not chunk:
+            break
+        data += chunk
+    return REPLY.unpack(data) if len(data) == REPLY.size else None
+
+
+def describe(status, value):
+    if status >= len(STATUSES):
+        return "status %d" % status
+    text = STATUSES[status]
+    return text % value if "%" in text else text
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image", help=".bin of the build to flash")
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--port", type=int, default=UPDATE_PORT)
+    parser.add_argument("--timeout", type=float, default=10.0)
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if not image or len(image) > MAX_IMAGE:
+        sys.exit("%s is %d bytes, an image has to fit a bank, 1 to %d" % (args.image, len(image), MAX_IMAGE))
+    crc = zlib.crc32(image) & 0xFFFFFFFF
+
+    start = time.monotonic()
+    with socket.create_connection((args.ecu, args.port), timeout=args.timeout) as sock:
+        sock.sendall(HEADER.pack(b"DBWF", UPDATE_VERSION, len(image), crc))
+        try:
+            sock.sendall(image)
+        except OSError:
+            # refused early, the answer is still there to read
+            pass
+        sent = time.monotonic() - start
+        sock.shutdown(socket.SHUT_WR)
+        reply = receive_reply(sock)
+    elapsed = time.monotonic() - start
+
+    if reply is None:
+        sys.exit("no answer from %s" % args.ecu)
+    status, value = reply
+    print("%d bytes, CRC 0x%08x, sent in %.2f s (%.0f KB/s), answered after %.2f s: %s" % (
+        len(image), crc, sent, len(image) / 1024.0 / max(sent, 1e-6), elapsed, describe(status, value)))
+    return 0 if status == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
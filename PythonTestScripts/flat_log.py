@@ -0,0 +1,190 @@
+"""Reader of the ECU's flat logs (FlatLog.h), the format of the SD card log
+and of what else the ECU records in bulk.
+
+    python flat_log.py info card.img --offset 4194304
+    python flat_log.py check card.img --offset 4194304
+
+As a library:
+
+    with flat_log.FlatLog("card.img", offset=8192 * 512) as log:
+        for index in range(log.seek(session, time), log.blocks):
+            for record in log.records(index, "<II7fB3x"):
+                ...
+
+The image, or the device itself, is memory mapped and only the pages of
+the blocks read are touched, so a log of any size opens at once. The end of
+the log is found by bisecting the block headers as the ECU does, a time by
+bisecting them on (session, time). Packed blocks (record_size 0) are
+unpacked with delta_codec.py. Standard library only.
+"""
+
+import argparse
+import collections
+import mmap
+import struct
+import sys
+import zlib
+
+import delta_codec
+
+MAGIC = 0x46574244
+VERSION = 1
+MIN_BLOCK = 512
+HEADER = struct.Struct("<IBBHQQ7I8xI")
+# the CRC covers the header up to itself
+CRC_OFFSET = HEADER.size - 4
+SCHEMAS = {1: "sd_log_record_t", 2: "control_record_t"}
+
+Block = collections.namedtuple("Block", ("magic", "version", "header_size", "record_size", "first_time", "last_time",
+                                         "block_size", "schema", "session", "sequence", "count", "bytes", "dropped",
+                                         "crc"))
+
+
+class FlatLog:
+    """A flat log from offset bytes into path. The block size is read from
+    the first header unless given. blocks is how many there are."""
+
+    def __init__(self, path, offset=0, block_size=None):
+        self._file = open(path, "rb")
+        self._file.seek(0, 2)
+        # devices have no size to fstat, seeking to the end works for both
+        size = self._file.tell()
+        self._map = mmap.mmap(self._file.fileno(), size, access=mmap.ACCESS_READ) if size else b""
+        self.offset = offset
+        if block_size is None:
+            block_size = 0
+            if offset + HEADER.size <= size:
+                first = Block(*HEADER.unpack_from(self._map, offset))
+                if first.magic == MAGIC and first.block_size >= MIN_BLOCK \
+                        and first.block_size & (first.block_size - 1) == 0:
+                    block_size = first.block_size
+        self.block_size = block_size
+        self.blocks = 0
+        if block_size:
+            low = 0
+            high = max(0, (size - offset) // block_size)
+            while low < high:
+                middle = (low + high) // 2
+                if self.header(middle) is not None:
+                    low = middle + 1
+                else:
+                    high = middle
+            self.blocks = low
+
+    def close(self):
+        if isinstance(self._map, mmap.mmap):
+            self._map.close()
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __len__(self):
+        return self.blocks
+
+    def _start(self, index):
+        return self.offset + index * self.block_size
+
+    def header(self, index):
+        """Header of block index, None if it is not one of the log's."""
+        start = self._start(index)
+        if index < 0 or start + self.block_size > len(self._map):
+            return None
+        block = Block(*HEADER.unpack_from(self._map, start))
+        if block.magic != MAGIC or block.version != VERSION or block.header_size != HEADER.size \
+                or block.block_size != self.block_size or block.sequence != index \
+                or block.bytes > self.block_size - HEADER.size:
+            return None
+        return block
+
+    def data(self, index):
+        """The record bytes of block index."""
+        block = self.header(index)
+        start = self._start(index) + HEADER.size
+        return self._map[start:start + block.bytes]
+
+    def valid(self, index):
+        """Whether block index is the log's and its CRC is right."""
+        block = self.header(index)
+        if block is None:
+            return False
+        start = self._start(index)
+        crc = zlib.crc32(self._map[start:start + CRC_OFFSET])
+        return zlib.crc32(self.data(index), crc) == block.crc
+
+    def records(self, index, layout=None):
+        """Yields the records of block index, each unpacked with the struct
+        layout or as bytes without one. Packed blocks need the layout."""
+        block = self.header(index)
+        data = self.data(index)
+        if block.record_size == 0:
+            if layout is None:
+                raise ValueError("block %d is packed, its records need a layout" % index)
+            yield from delta_codec.unpack(data, layout, block.count)
+        elif layout is not None:
+            yield from struct.iter_unpack(layout, data[:block.count * block.record_size])
+        else:
+            for i in range(block.count):
+                yield bytes(data[i * block.record_size:(i + 1) * block.record_size])
+
+    def seek(self, session, time=0):
+        """Index of the first block of session with records from time us on,
+        blocks if there is none."""
+        low = 0
+        high = self.blocks
+        while low < high:
+            middle = (low + high) // 2
+            block = self.header(middle)
+            if (block.session, block.last_time) < (session, time):
+                low = middle + 1
+            else:
+                high = middle
+        return low
+
+
+def sessions(log):
+    """Per session: blocks, records, first and last time and records dropped,
+    in the order of the log."""
+    result = collections.OrderedDict()
+    for index in range(log.blocks):
+        block = log.header(index)
+        summary = result.setdefault(block.session, [0, 0, block.first_time, block.last_time, 0])
+        summary[0] += 1
+        summary[1] += block.count
+        summary[3] = block.last_time
+        summary[4] = block.dropped
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=("info", "check"),
+                        help="info lists the sessions, check also checks the CRC of every block")
+    parser.add_argument("image", help="image, dump or device")
+    parser.add_argument("--offset", type=int, default=0, help="bytes from the start of the image to the log")
+    parser.add_argument("--block-size", type=int, help="instead of the first header's")
+    args = parser.parse_args()
+
+    with FlatLog(args.image, args.offset, args.block_size) as log:
+        if log.blocks == 0:
+            sys.exit("%s: no flat log at %d" % (args.image, args.offset))
+        schemas = sorted(set(log.header(i).schema for i in range(log.blocks)))
+        print("%d blocks of %d bytes, %s" % (log.blocks, log.block_size,
+                                             ", ".join(SCHEMAS.get(s, "schema %d" % s) for s in schemas)))
+        for session, (blocks, records, first, last, dropped) in sessions(log).items():
+            print("session %d: %d blocks, %d records, %.3f s to %.3f s, %d dropped"
+                  % (session, blocks, records, first / 1e6, last / 1e6, dropped))
+        if args.command == "check":
+            bad = [i for i in range(log.blocks) if not log.valid(i)]
+            for index in bad:
+                print("block %d: CRC wrong" % index)
+            print("%d of %d blocks with a wrong CRC" % (len(bad), log.blocks))
+            return 1 if bad else 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,539 @@
+"""Command latency benchmark against the ECU's UDP control protocol.
+
+Sends command frames (ControlProtocol.h, version 16) at a fixed rate,
+subscribes to the status telemetry from the same socket and matches every
+echoed command sequence number to the time it was sent. Reports round trip
+percentiles, command loss and jitter.
+
+With --phc the command send times are also read from the PC's PTP hardware
+clock, the one ptp4l serves the ECU from. A synced ECU echoes when it
+received each command on that clock, which gives the one way latency from
+the PC's send call to the ECU's receive callback besides the round trip.
+
+--slot-us holds every command until the PHC is in the PC's slot of the
+time-triggered schedule (TimeTrigger.h), the first slot-us of each control
+cycle, for ECUs built with TIME_TRIGGER_ENABLE. Needs --phc.
+
+The echo leaves the ECU once ethernet_thread has accepted the command, and
+main_task did not have to act on it yet. For command to actuation, give
+--marker-serial. Every --flip-every commands the tele operation bit flips,
+which switches SafetyLights1Enable within one control cycle, and at the same
+moment the serial port's RTS line flips. Capture RTS and the light output on
+a logic analyzer, export the capture as CSV and run --analyze on it.
+
+The ECU drives the cart in tele operation mode. Run with the drive
+disconnected or the cart up on stands. Speed and steering are commanded 0
+by default.
+
+    python latency_bench.py --rate 1000 --duration 30
+    python latency_bench.py --rate 500 --marker-serial /dev/ttyUSB0
+    python latency_bench.py --rate 1000 --phc /dev/ptp0
+    python latency_bench.py --rate 1000 --phc /dev/ptp0 --slot-us 200
+    python latency_bench.py --analyze capture.csv --marker-col 1 --actuator-col 2
+
+--probe sets the latency probe bit on every --probe-every command, for an
+ECU built with LATENCY_PROBE_ENABLE (LatencyProbe.h). The ECU times each
+marked command from its receive interrupt to the decode, to main_task
+applying it, to the compare write and to the first PWM edge at the new
+duty, the edge captured by a timer of its own, and publishes the stages on
+the signal bus with the command's sequence. The bench subscribes to them and
+reports each stage besides the round trip, and --csv adds them to the rows
+of the marked commands. The steering torque output has to switch for an
+edge: command some steering and wire the output back to the capture pin.
+The probe pin shows the same stages on a logic analyzer.
+
+    python latency_bench.py --rate 500 --steering 0.2 --tele-operation --probe
+
+--link sends the commands as raw Ethernet frames on the given interface
+instead, for an ECU built with ETHERNET_LINK_COMMANDS and cabled straight
+to this PC (EthernetIO.h). --ecu-mac is the ECU's MAC. The subscription
+and the telemetry stay on UDP. Linux only, and raw sockets need root or
+CAP_NET_RAW.
+
+    sudo python latency_bench.py --rate 1000 --link eth1 --ecu-mac 02:04:25:1c:a0:02
+
+--save writes the percentiles of every series reported, round trip, one way,
+probe stages or --analyze delays, as JSON for perf_history.py.
+
+--marker-serial needs pyserial, everything else only the standard library.
+--probe imports signal_watch.py from beside this script.
+"""
+
+import argparse
+import csv
+import json
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_COMMAND = 1
+FRAME_TELEMETRY = 2
+FRAME_SUBSCRIBE = 3
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+
+COMMAND_PORT = 12090
+# ETHERNET_LINK_ETHERTYPE
+LINK_ETHERTYPE = 0x88B5
+GROUP_STATUS = 0
+# wire size of each telemetry field, in field order
+TELEMETRY_FIELD_SIZES = (4, 4, 2, 2, 1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 2)
+FIELD_SEQUENCE = 0
+FIELD_COMMAND_PTP_TIME = 11
+
+FLAG_AUTONOMOUS = 0x4
+FLAG_TELE_OPERATION = 0x10
+FLAG_LATENCY_PROBE = 0x20
+# SignalBus.h, in the order the probe publishes them, the sequence last
+PROBE_SIGNALS = ("latency_probe_received", "latency_probe_applied", "latency_probe_committed", "latency_probe_edge",
+                 "latency_probe_sequence")
+PROBE_STAGES = ("receive interrupt to decode", "decode to applied", "applied to compare write",
+                "compare write to PWM edge")
+# signal set of the probe's subscription
+PROBE_TAG = 7
+
+# the subscription lease is 3000 ms
+SUBSCRIBE_INTERVAL = 1.0
+# how long to keep listening for echoes after the last command
+DRAIN_TIME = 0.5
+# CONTROL_CORE_CYCLE_US, the time-triggered cycle
+CYCLE_NS = 1000000
+
+
+def frame(frame_type, sequence, timestamp, payload):
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp & 0xFFFFFFFF) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def command_payload(flags, speed, steering, priority, lease):
+    speed_raw = max(0, min(0xFFFF, int(round(speed * 0xFFFF))))
+    steering_raw = max(0, min(0xFFFF, int(round(steering * 0x7FFF + 0x7FFF))))
+    payload = struct.pack("<HHH", flags, speed_raw, steering_raw)
+    if priority is not None:
+        payload += struct.pack("<BH", priority, lease)
+    return payload
+
+
+def subscribe_payload(status_period):
+    # address and port 0: telemetry comes back to the socket that subscribed
+    return struct.pack("<4sHHH", b"\0\0\0\0", 0, status_period, 0)
+
+
+def parse_telemetry(data):
+    """Returns the echoed command sequence of a status frame and the PTP us the
+    ECU received that command at, or None for either that is not in it."""
+    if len(data) < HEADER.size + 3 + CRC.size:
+        return None, None
+    version, frame_type, length, _, _ = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or frame_type != FRAME_TELEMETRY:
+        return None, None
+    if len(data) != HEADER.size + length + CRC.size:
+        return None, None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None, None
+    group, mask = struct.unpack_from("<BH", data, HEADER.size)
+    if group != GROUP_STATUS:
+        return None, None
+    # fields follow in order, each only when its mask bit is set
+    values = {}
+    offset = HEADER.size + 3
+    for field, size in enumerate(TELEMETRY_FIELD_SIZES):
+        if mask & (1 << field):
+            values[field] = int.from_bytes(data[offset:offset + size], "little")
+            offset += size
+    # 0 until the ECU has synced
+    return values.get(FIELD_SEQUENCE), values.get(FIELD_COMMAND_PTP_TIME) or None
+
+
+def phc_clock(path):
+    """clock id of a PTP hardware clock device for time.clock_gettime_ns"""
+    fd = os.open(path, os.O_RDONLY)
+    return (~fd << 3) | 3
+
+
+def percentile(values, fraction):
+    if not values:
+        return float("nan")
+    index = min(len(values) - 1, int(round(fraction * (len(values) - 1))))
+    return values[index]
+
+
+def report(name, samples_us):
+    """Prints the percentiles of samples_us and returns them for --save,
+    None without samples."""
+    samples = sorted(samples_us)
+    if not samples:
+        print("%s: no samples" % name)
+        return None
+    mean = sum(samples) / len(samples)
+    deviation = (sum((s - mean) ** 2 for s in samples) / len(samples)) ** 0.5
+    print("%s: %d samples, us" % (name, len(samples)))
+    print("  min %.0f  p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  max %.0f" % (
+        samples[0], percentile(samples, 0.5), percentile(samples, 0.9), percentile(samples, 0.99),
+        percentile(samples, 0.999), samples[-1]))
+    print("  mean %.0f  stddev %.0f  p99-p50 %.0f" % (mean, deviation, percentile(samples, 0.99) - percentile(samples, 0.5)))
+    return {"samples": len(samples), "min": samples[0], "p50": percentile(samples, 0.5),
+            "p90": percentile(samples, 0.9), "p99": percentile(samples, 0.99), "p99.9": percentile(samples, 0.999),
+            "max": samples[-1], "mean": mean}
+
+
+def save(path, args, series, **counts):
+    """Writes the percentiles of every series that had samples as JSON, what
+    perf_history.py records."""
+    with open(path, "w") as f:
+        json.dump(dict(counts, rate=args.rate, series={name: stats for name, stats in series.items() if stats}),
+                  f, indent=1)
+
+
+class Marker(object):
+    """Flips the RTS line of a serial port, for the logic analyzer."""
+
+    def __init__(self, port):
+        import serial
+        self.serial = serial.Serial(port)
+        self.level = False
+        self.serial.rts = self.level
+
+    def flip(self):
+        self.level = not self.level
+        self.serial.rts = self.level
+
+
+class Benchmark(object):
+
+    def __init__(self, args):
+        self.args = args
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        self.sock.bind(("", args.local_port))
+        self.sock.settimeout(0.1)
+        self.ecu = (args.ecu, args.port)
+        self.marker = Marker(args.marker_serial) if args.marker_serial else None
+        self.phc = phc_clock(args.phc) if args.phc else None
+        self.link = None
+        if args.link:
+            self.link = socket.socket(socket.AF_PACKET, socket.SOCK_RAW)
+            self.link.bind((args.link, LINK_ETHERTYPE))
+            source = self.link.getsockname()[4]
+            self.link_header = bytes.fromhex(args.ecu_mac.replace(":", "")) + source + struct.pack(">H", LINK_ETHERTYPE)
+
+        self.start = time.perf_counter()
+        self.sequence = 0
+        self.send_times = {}
+        # low 32 bits of the PHC in us, like the ECU's PTP times
+        self.phc_times = {}
+        self.one_way = []
+        self.send_intervals = []
+        self.latencies = []
+        self.echoed = set()
+        self.out_of_order = 0
+        self.highest_echo = -1
+        # sequence: stage us in PROBE_SIGNALS order, for the marked commands
+        self.probed = set()
+        self.probe_results = {}
+        self.probe_schema = None
+        if args.probe:
+            self.probe_schema = self.fetch_probe_schema()
+        self.running = True
+        self.lock = threading.Lock()
+
+    def fetch_probe_schema(self):
+        """(schema id, [signal]) of the probe's signals in PROBE_SIGNALS order"""
+        import signal_watch
+        schema_id, signals = signal_watch.fetch_schema(self.sock, self.args.ecu, self.args.port, 1.0)
+        self.sock.settimeout(0.1)
+        by_name = {signal["name"]: signal for signal in signals}
+        if any(name not in by_name for name in PROBE_SIGNALS):
+            sys.exit("%s has no latency probe signals, flash it with LATENCY_PROBE_ENABLE" % self.args.ecu)
+        return schema_id, [by_name[name] for name in PROBE_SIGNALS]
+
+    def subscribe_probe(self, period):
+        import signal_watch
+        ids = [] if period == 0 else [signal["id"] for signal in self.probe_schema[1]]
+        payload = signal_watch.SIGNAL_SUBSCRIBE.pack(b"\0\0\0\0", 0, PROBE_TAG, period, len(ids)) + bytes(ids)
+        self.send(signal_watch.FRAME_SIGNAL_SUBSCRIBE, payload)
+
+    def receive_probe(self, data):
+        """Records the stages of a signal data frame of the probe's set,
+        returns whether data was one."""
+        import signal_watch
+        reply = signal_watch.parse(data, signal_watch.FRAME_SIGNAL_DATA)
+        if reply is None:
+            return False
+        try:
+            values = signal_watch.decode_data(reply[1], self.probe_schema[0], PROBE_TAG, self.probe_schema[1])
+        except KeyError:
+            values = None
+        if values is not None:
+            sequence = int(values[-1])
+            with self.lock:
+                if sequence in self.probed and sequence not in self.probe_results:
+                    self.probe_results[sequence] = values[:-1]
+        return True
+
+    def now_ms(self):
+        return int((time.perf_counter() - self.start) * 1000)
+
+    def send(self, frame_type, payload):
+        self.sequence += 1
+        data = frame(frame_type, self.sequence, self.now_ms(), payload)
+        if self.link is not None and frame_type == FRAME_COMMAND:
+            self.link.send(self.link_header + data)
+        else:
+            self.sock.sendto(data, self.ecu)
+        return self.sequence
+
+    def receive(self):
+        while self.running:
+            try:
+                data, _ = self.sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            received = time.perf_counter()
+            if self.probe_schema is not None and self.receive_probe(data):
+                continue
+            sequence, ecu_received = parse_telemetry(data)
+            if sequence is None:
+                continue
+            with self.lock:
+                sent = self.send_times.get(sequence)
+                if sent is None or sequence in self.echoed:
+                    continue
+                self.echoed.add(sequence)
+                if sequence < self.highest_echo:
+                    self.out_of_order += 1
+                self.highest_echo = max(self.highest_echo, sequence)
+                self.latencies.append((sequence, (received - sent) * 1e6))
+                phc_sent = self.phc_times.get(sequence)
+                if phc_sent is not None and ecu_received is not None:
+                    # both wrap at 32 bits
+                    self.one_way.append(((ecu_received - phc_sent + (1 << 31)) & 0xFFFFFFFF) - (1 << 31))
+
+    def wait_for_slot(self):
+        """spins until the PHC is in the PC's slot, at the start of a cycle"""
+        slot_ns = self.args.slot_us * 1000
+        while time.clock_gettime_ns(self.phc) % CYCLE_NS >= slot_ns:
+            pass
+
+    def run(self):
+        args = self.args
+        period = 1.0 / args.rate
+        receiver = threading.Thread(target=self.receive)
+        receiver.daemon = True
+        receiver.start()
+
+        flags = FLAG_TELE_OPERATION if args.tele_operation else 0
+        commands = 0
+        next_send = time.perf_counter()
+        next_subscribe = next_send
+        last_send = None
+        end = next_send + args.duration
+        while True:
+            now = time.perf_counter()
+            if now >= end:
+                break
+            if now >= next_subscribe:
+                self.send(FRAME_SUBSCRIBE, subscribe_payload(args.telemetry_period))
+                if args.probe:
+                    self.subscribe_probe(1)
+                next_subscribe += SUBSCRIBE_INTERVAL
+            if now < next_send:
+                # sleep coarse, spin the last stretch
+                if next_send - now > 0.002:
+                    time.sleep(next_send - now - 0.001)
+                continue
+
+            if self.marker and commands % args.flip_every == 0:
+                flags ^= FLAG_TELE_OPERATION
+                self.marker.flip()
+            probe = args.probe and commands % args.probe_every == 0
+            payload = command_payload(flags | (FLAG_LATENCY_PROBE if probe else 0), args.speed, args.steering,
+                                      args.priority, args.lease)
+            if args.slot_us:
+                self.wait_for_slot()
+            with self.lock:
+                sequence = self.sequence + 1
+                if probe:
+                    self.probed.add(sequence)
+                self.send_times[sequence] = time.perf_counter()
+                if self.phc is not None:
+                    self.phc_times[sequence] = (time.clock_gettime_ns(self.phc) // 1000) & 0xFFFFFFFF
+            self.send(FRAME_COMMAND, payload)
+            sent = self.send_times[sequence]
+            if last_send is not None:
+                self.send_intervals.append((sent - last_send) * 1e6)
+            last_send = sent
+            commands += 1
+            next_send += period
+            # fell a whole period behind, e.g. descheduled: do not burst to catch up
+            if time.perf_counter() - next_send > period:
+                next_send = time.perf_counter()
+
+        time.sleep(DRAIN_TIME)
+        self.running = False
+        receiver.join()
+        if args.probe:
+            self.subscribe_probe(0)
+        return commands
+
+    def summarize(self, commands):
+        args = self.args
+        with self.lock:
+            latencies = list(self.latencies)
+            one_way = list(self.one_way)
+            command_sequences = set(self.send_times)
+            highest = self.highest_echo
+            probe_results = dict(self.probe_results)
+
+        echoed = len(latencies)
+        # A command the ECU accepted but replaced with a newer one before the
+        # next status frame is never echoed either, so with telemetry slower
+        # than the command rate only the echoes after the last one count as lost.
+        missing = sorted(s for s in command_sequences if s not in self.echoed)
+        lost_tail = [s for s in missing if s > highest]
+        print("commands sent %d at %d Hz over %.1f s" % (commands, args.rate, args.duration))
+        print("echoed %d (%.2f%%), not echoed %d, none echoed after the last %d, out of order %d" % (
+            echoed, 100.0 * echoed / max(1, commands), len(missing), len(lost_tail), self.out_of_order))
+        if args.telemetry_period * args.rate <= 1000:
+            print("telemetry keeps up with the command rate, not echoed is loss: %.3f%%" %
+                  (100.0 * len(missing) / max(1, commands)))
+        series = {"round_trip": report("round trip, command to telemetry echo", [l for _, l in latencies])}
+        if self.phc is not None:
+            series["one_way"] = report("one way, PC send to ECU receive on the PTP clock", one_way)
+        report("send interval", self.send_intervals)
+        if latencies:
+            # RFC 3550 style: smoothed change in latency between consecutive echoes
+            jitter = 0.0
+            previous = None
+            for _, latency in sorted(latencies):
+                if previous is not None:
+                    jitter += (abs(latency - previous) - jitter) / 16.0
+                previous = latency
+            print("latency jitter (RFC 3550) %.0f us" % jitter)
+
+        if args.probe:
+            # an edge of 0 did not come, the duty had none
+            edged = [stages for stages in probe_results.values() if stages[-1] > 0]
+            print("probed %d, stages back for %d, PWM edge for %d" % (len(self.probed), len(probe_results),
+                                                                     len(edged)))
+            for index, name in enumerate(PROBE_STAGES[:-1]):
+                series[PROBE_SIGNALS[index]] = report(name, [stages[index] for stages in probe_results.values()])
+            series[PROBE_SIGNALS[3]] = report(PROBE_STAGES[-1], [stages[-1] for stages in edged])
+            series["latency_probe_total"] = report("receive interrupt to PWM edge", [sum(stages) for stages in edged])
+
+        if args.save:
+            save(args.save, args, series, commands=commands, echoed=echoed)
+
+        if args.csv:
+            with open(args.csv, "w") as f:
+                writer = csv.writer(f)
+                writer.writerow(["sequence", "round_trip_us"] + (["%s_us" % name for name in PROBE_SIGNALS[:-1]]
+                                                                 if args.probe else []))
+                for sequence, latency in sorted(latencies):
+                    stages = ["%.1f" % stage for stage in probe_results.get(sequence, ())]
+                    writer.writerow([sequence, "%.1f" % latency] + stages)
+
+
+def analyze_capture(args):
+    """Marker edge to actuator edge delays from a logic analyzer CSV export.
+
+    The first column is the time in seconds, --marker-col and --actuator-col
+    are the columns of the two channels, 0 or 1. Rows before the first that
+    parses as numbers, a header for example, are skipped.
+    """
+    marker_edges = []
+    actuator_edges = []
+    last_marker = None
+    last_actuator = None
+    with open(args.analyze) as f:
+        for row in csv.reader(f):
+            try:
+                t = float(row[0])
+                marker = int(float(row[args.marker_col]))
+                actuator = int(float(row[args.actuator_col]))
+            except (ValueError, IndexError):
+                continue
+            if last_marker is not None and marker != last_marker:
+                marker_edges.append(t)
+            if last_actuator is not None and actuator != last_actuator:
+                actuator_edges.append(t)
+            last_marker = marker
+            last_actuator = actuator
+
+    delays = []
+    missed = 0
+    a = 0
+    for i, t in enumerate(marker_edges):
+        limit = marker_edges[i + 1] if i + 1 < len(marker_edges) else float("inf")
+        while a < len(actuator_edges) and actuator_edges[a] < t:
+            a += 1
+        if a < len(actuator_edges) and actuator_edges[a] < limit:
+            delays.append((actuator_edges[a] - t) * 1e6)
+            a += 1
+        else:
+            missed += 1
+    print("%d marker edges, %d actuator edges, %d markers without a response" % (
+        len(marker_edges), len(actuator_edges), missed))
+    stats = report("command to actuation", delays)
+    if args.save:
+        save(args.save, args, {"command_to_actuation": stats}, markers=len(marker_edges), missed=missed)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--ecu", default="192.168.2.100", help="ECU address")
+    parser.add_argument("--port", type=int, default=COMMAND_PORT, help="ECU command port")
+    parser.add_argument("--local-port", type=int, default=0, help="port to send from and receive telemetry on")
+    parser.add_argument("--rate", type=int, default=100, help="commands per second, 100 to 2000")
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds")
+    parser.add_argument("--telemetry-period", type=int, default=1, help="status telemetry period in ms")
+    parser.add_argument("--speed", type=float, default=0.0, help="commanded speed, 0 to 1")
+    parser.add_argument("--steering", type=float, default=0.0, help="commanded steering, -1 to 1")
+    parser.add_argument("--tele-operation", action="store_true", help="command tele operation mode throughout")
+    parser.add_argument("--priority", type=int, help="commander priority, left out of the frame if not given")
+    parser.add_argument("--lease", type=int, default=0, help="lease in ms with --priority, 0 for the default")
+    parser.add_argument("--marker-serial", help="serial port whose RTS flips with every tele operation flip")
+    parser.add_argument("--flip-every", type=int, default=50, help="commands between tele operation flips")
+    parser.add_argument("--probe", action="store_true", help="time marked commands through the ECU to the PWM edge")
+    parser.add_argument("--probe-every", type=int, default=50, help="commands between marked ones with --probe")
+    parser.add_argument("--phc", help="PTP hardware clock the ECU is synced to, for one way latency")
+    parser.add_argument("--slot-us", type=int, default=0,
+                        help="us at the start of each cycle to send in, the PC's time-triggered slot, needs --phc")
+    parser.add_argument("--link", help="interface to send the commands on as raw Ethernet frames")
+    parser.add_argument("--ecu-mac", help="ECU MAC with --link, as aa:bb:cc:dd:ee:ff")
+    parser.add_argument("--csv", help="write every round trip to this file")
+    parser.add_argument("--save", metavar="FILE", help="write the percentiles as JSON, for perf_history.py")
+    parser.add_argument("--analyze", help="logic analyzer CSV export to analyze instead of running")
+    parser.add_argument("--marker-col", type=int, default=1, help="marker channel column in --analyze")
+    parser.add_argument("--actuator-col", type=int, default=2, help="actuator channel column in --analyze")
+    args = parser.parse_args()
+
+    if args.analyze:
+        analyze_capture(args)
+        return 0
+    if not 100 <= args.rate <= 2000:
+        parser.error("--rate must be between 100 and 2000")
+    if args.flip_every < 1:
+        parser.error("--flip-every must be at least 1")
+    if args.probe_every < 1:
+        parser.error("--probe-every must be at least 1")
+    if args.link and not args.ecu_mac:
+        parser.error("--link needs --ecu-mac")
+    if args.slot_us and not args.phc:
+        parser.error("--slot-us needs --phc")
+    if not 0 <= args.slot_us < CYCLE_NS // 1000:
+        parser.error("--slot-us must be shorter than the cycle")
+
+    benchmark = Benchmark(args)
+    commands = benchmark.run()
+    benchmark.summarize(commands)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
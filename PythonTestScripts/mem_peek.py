@@ -0,0 +1,163 @@
+"""Reads variables out of the running ECU's RAM by symbol name (MemoryWindow.h).
+
+    python mem_peek.py DriveByWireECU.elf ptp
+    python mem_peek.py DriveByWireECU.elf raw_channel+8:4:u32 event_log:16
+    python mem_peek.py DriveByWireECU.elf net_latency+4:4:u32 --rate 10
+
+Every argument is symbol[+offset][:length[:type]], or an address in hex
+instead of the symbol. Without a length the symbol's whole size is read,
+from arm-none-eabi-nm, offset and length in bytes. The type is one of
+u8, i8, u16, i16, u32, i32, f32 and decodes the bytes little endian,
+without one they are printed in hex. All ranges go in one memory request
+of the UDP control protocol (ControlProtocol.h, version 16) and come back
+in one memory data frame. The ECU only answers for .data, .bss, .noinit
+and the backup RAM, anything else comes back denied. --rate polls at that
+many requests per second until interrupted. The ELF file has to be the one
+running. Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import subprocess
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_MEMORY_REQUEST = 18
+FRAME_MEMORY_DATA = 19
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+RANGE = struct.Struct("<IH")
+RANGE_DATA = struct.Struct("<IHB")
+
+COMMAND_PORT = 12090
+MAX_RANGES = 16
+MAX_DATA = 1024
+
+STATUSES = ("ok", "denied", "no room")
+TYPES = {"u8": "B", "i8": "b", "u16": "H", "i16": "h", "u32": "I", "i32": "i", "f32": "f"}
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def symbols(tool, elf):
+    """{name: (address, size)} of the data objects in elf."""
+    found = {}
+    for line in subprocess.check_output([tool + "nm", "-S", elf], text=True).splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in "bBdDgGsSvV":
+            found[fields[3]] = (int(fields[0], 16), int(fields[1], 16))
+    return found
+
+
+def parse_range(text, table):
+    """(label, address, length, type) of one argument."""
+    parts = text.split(":")
+    if len(parts) > 3:
+        sys.exit("%s is not symbol[+offset][:length[:type]]" % text)
+    name, _, offset = parts[0].partition("+")
+    offset = int(offset, 0) if offset else 0
+    if name.lower().startswith("0x"):
+        address, size = int(name, 16), 0
+    elif name in table:
+        address, size = table[name]
+    else:
+        sys.exit("no data symbol %s in the ELF file" % name)
+
+    length = int(parts[1], 0) if len(parts) > 1 and parts[1] else size - offset
+    value_type = parts[2] if len(parts) > 2 else None
+    if value_type is not None and value_type not in TYPES:
+        sys.exit("unknown type %s, one of %s" % (value_type, ", ".join(sorted(TYPES))))
+    if length <= 0 or length > MAX_DATA:
+        sys.exit("%s: length %d is not 1 to %d" % (text, length, MAX_DATA))
+    return text, address + offset, length, value_type
+
+
+def parse_memory_data(data):
+    """[(address, status, bytes)] or None."""
+    if len(data) < HEADER.size + 1 + CRC.size:
+        return None
+    version, frame_type, length, _, _ = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or frame_type != FRAME_MEMORY_DATA or len(data) != HEADER.size + length + CRC.size:
+        return None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None
+    count = data[HEADER.size]
+    offset = HEADER.size + 1
+    ranges = []
+    for _ in range(count):
+        address, size, status = RANGE_DATA.unpack_from(data, offset)
+        offset += RANGE_DATA.size
+        ranges.append((address, status, data[offset:offset + size]))
+        offset += size
+    return ranges
+
+
+def format_bytes(raw, value_type):
+    if value_type is None:
+        return raw.hex(" ")
+    code = TYPES[value_type]
+    width = struct.calcsize(code)
+    values = struct.unpack("<%d%s" % (len(raw) // width, code), raw[:len(raw) // width * width])
+    return " ".join("%g" % value if code == "f" else "%d" % value for value in values)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf")
+    parser.add_argument("ranges", nargs="+", help="symbol[+offset][:length[:type]]")
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--port", type=int, default=COMMAND_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0)
+    parser.add_argument("--rate", type=float, help="requests per second, once without")
+    parser.add_argument("--tool", default="arm-none-eabi-", help="prefix of the binutils to run")
+    args = parser.parse_args()
+
+    if len(args.ranges) > MAX_RANGES:
+        parser.error("at most %d ranges per request" % MAX_RANGES)
+    table = symbols(args.tool, args.elf)
+    ranges = [parse_range(text, table) for text in args.ranges]
+    if sum(length for _, _, length, _ in ranges) > MAX_DATA:
+        parser.error("at most %d bytes per request" % MAX_DATA)
+    payload = struct.pack("<B", len(ranges)) + b"".join(RANGE.pack(address, length) for _, address, length, _ in ranges)
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+    sequence = 0
+    try:
+        while True:
+            started = time.monotonic()
+            sequence += 1
+            sock.sendto(frame(FRAME_MEMORY_REQUEST, sequence, payload), (args.ecu, args.port))
+            reply = None
+            deadline = started + args.timeout
+            while reply is None and time.monotonic() < deadline:
+                try:
+                    reply = parse_memory_data(sock.recv(2048))
+                except socket.timeout:
+                    break
+            if reply is None:
+                print("no memory data from %s" % args.ecu, file=sys.stderr)
+                if not args.rate:
+                    return 1
+            else:
+                for (label, _, _, value_type), (address, status, raw) in zip(ranges, reply):
+                    if status != 0:
+                        print("%-24s 0x%08x %s" % (label, address, STATUSES[status] if status < len(STATUSES) else status))
+                    else:
+                        print("%-24s 0x%08x %s" % (label, address, format_bytes(raw, value_type)))
+            if not args.rate:
+                return 0
+            time.sleep(max(0.0, started + 1.0 / args.rate - time.monotonic()))
+    except KeyboardInterrupt:
+        return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,243 @@
+"""Splits the ECU's RAM and flash by subsystem and module, from the linker map.
+
+    python memory_budget.py Release/DriveByWireECU.map
+    python memory_budget.py Release/DriveByWireECU.map --modules 15
+    python memory_budget.py Release/DriveByWireECU.map --save Release/DriveByWireECU.memory.json
+    python memory_budget.py Release/DriveByWireECU.map --baseline memory_baseline/Release.json
+
+Every input section the linker placed is charged to the object file it
+came from and that to a subsystem: the RTOS heap (which holds all task
+stacks but main_task's, the queues and semaphores), the lwIP pools,
+lwIP's code and state, the Ethernet driver with its GMAC descriptors and
+buffers, FreeRTOS, the Atmel START HAL, the C library and the application.
+The main stack (.stack, STACK_SIZE in the linker script) is the interrupts'
+once the scheduler runs. Alignment gaps are charged as padding. Flash
+counts code, constants and the initial values of .relocate, RAM counts
+.relocate, .bss, .noinit, the main stack and .gmac, the GMAC's DMA memory.
+
+--save writes the result as JSON, the artifact a build keeps. --baseline
+prints the change in every subsystem and the modules that changed most
+against a saved one, and with --limit exits with 1 when RAM or flash grew
+by more than that many bytes. The Atmel Studio project runs this after
+every build (the MemoryBudget target in DriveByWireECU.cproj), copy a
+build's JSON to memory_baseline/<configuration>.json to accept it as the
+new baseline. Standard library only.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+# linker script output sections, the debug sections are never loaded
+FLASH_SECTIONS = (".text", ".ARM.exidx")
+RAM_SECTIONS = (".relocate", ".bss", ".noinit", ".stack", ".gmac")
+# initial values in flash, copied to RAM by the startup code
+LOADED_SECTIONS = (".relocate",)
+OTHER_SECTIONS = (".bkupram", ".qspi")
+
+# names of the variables that are a subsystem of their own, whatever object holds them
+SYMBOL_SUBSYSTEMS = (
+    ("ucHeap", "rtos heap"),
+    ("memp_memory", "lwip pools"),
+    ("ram_heap", "lwip heap"),
+    ("main_task_stack", "task stacks"),
+)
+# object paths, relative to the build directory, first match wins
+OBJECT_SUBSYSTEMS = (
+    (r"(^|[/\\])(hpl[/\\]gmac|ethernet_phy|lwip[/\\]lwip-[^/\\]+[/\\]port)[/\\]|hal_mac_async|ethernet_phy_main", "ethernet driver"),
+    (r"(^|[/\\])lwip[/\\]", "lwip"),
+    (r"(^|[/\\])thirdparty[/\\]RTOS[/\\]", "freertos"),
+    (r"(^|[/\\])(hal|hpl|hri|Device_Startup|stdio_redirect|examples)[/\\]|driver_init|atmel_start|stdio_start", "atmel start"),
+    (r"\.a\(|[/\\]lib[/\\]gcc[/\\]|arm-none-eabi", "libc"),
+    (r".", "application"),
+)
+
+OUTPUT_SECTION = re.compile(r"^(\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+load address 0x[0-9a-fA-F]+)?)?\s*$")
+INPUT_SECTION = re.compile(r"^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+))?\s*$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+(.+))?\s*$")
+REGION = re.compile(r"^(\w+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+
+
+def subsystem(section, obj):
+    for symbol, name in SYMBOL_SUBSYSTEMS:
+        if section.rsplit(".", 1)[-1] == symbol:
+            return name
+    for pattern, name in OBJECT_SUBSYSTEMS:
+        if re.search(pattern, obj):
+            return name
+    return "application"
+
+
+def module(obj):
+    """libc_nano.a(lib_a-printf.o) as libc_nano.a, a path as its object file name"""
+    obj = obj.replace("\\", "/")
+    member = re.search(r"([^/]+\.a)\([^()]+\)$", obj)
+    return member.group(1) if member else obj.rsplit("/", 1)[-1]
+
+
+def parse_map(path):
+    regions = {}
+    sections = []
+    with open(path, errors="replace") as f:
+        lines = f.read().splitlines()
+
+    index = 0
+    while index < len(lines) and not lines[index].startswith("Memory Configuration"):
+        index += 1
+    while index < len(lines) and not lines[index].startswith("Linker script and memory map"):
+        match = REGION.match(lines[index])
+        if match and match.group(1) != "Name":
+            regions[match.group(1)] = int(match.group(3), 16)
+        index += 1
+
+    output = None
+    pending = None
+    for line in lines[index:]:
+        if not line.strip():
+            continue
+        if not line.startswith(" "):
+            match = OUTPUT_SECTION.match(line)
+            output = None
+            pending = None
+            if match and match.group(1) in FLASH_SECTIONS + RAM_SECTIONS + OTHER_SECTIONS:
+                output = {"name": match.group(1), "size": int(match.group(3), 16) if match.group(3) else None, "inputs": []}
+                sections.append(output)
+            continue
+        if output is None:
+            continue
+        if output["size"] is None:
+            match = CONTINUATION.match(line)
+            if match:
+                output["size"] = int(match.group(2), 16)
+            continue
+
+        match = INPUT_SECTION.match(line)
+        if match and not match.group(1).startswith("*(") and not match.group(1).startswith("0x"):
+            if match.group(2):
+                output["inputs"].append((match.group(1), int(match.group(3), 16), match.group(4).strip()))
+            else:
+                # a long section name, the address, size and file follow on the next line
+                pending = match.group(1)
+            continue
+        match = CONTINUATION.match(line)
+        if pending and match and match.group(3):
+            output["inputs"].append((pending, int(match.group(2), 16), match.group(3).strip()))
+        pending = None
+    return regions, sections
+
+
+def budget(regions, sections):
+    result = {"regions": regions, "flash": 0, "ram": 0, "subsystems": {}, "modules": {}}
+
+    def charge(memory, name, mod, size):
+        result[memory] += size
+        entry = result["subsystems"].setdefault(name, {"flash": 0, "ram": 0})
+        entry[memory] += size
+        if mod:
+            entry = result["modules"].setdefault(mod, {"subsystem": name, "flash": 0, "ram": 0})
+            entry[memory] += size
+
+    for section in sections:
+        name = section["name"]
+        memories = []
+        if name in FLASH_SECTIONS or name in LOADED_SECTIONS:
+            memories.append("flash")
+        if name in RAM_SECTIONS:
+            memories.append("ram")
+        if not memories or not section["size"]:
+            continue
+
+        placed = 0
+        for input_name, size, obj in section["inputs"]:
+            placed += size
+            if input_name == "*fill*":
+                for memory in memories:
+                    charge(memory, "padding", None, size)
+                continue
+            for memory in memories:
+                charge(memory, subsystem(input_name, obj), module(obj), size)
+        rest = section["size"] - placed
+        if rest > 0:
+            for memory in memories:
+                charge(memory, "main stack" if name == ".stack" else "padding", None, rest)
+    return result
+
+
+def change(new, old):
+    return "%+8d" % (new - old) if old is not None else ""
+
+
+def report(result, baseline, top):
+    old = baseline["subsystems"] if baseline else {}
+    print("%-16s %10s %10s" % ("", "flash", "ram"))
+    for name, entry in sorted(result["subsystems"].items(), key=lambda item: -item[1]["ram"] - item[1]["flash"]):
+        line = "%-16s %10d %10d" % (name, entry["flash"], entry["ram"])
+        if baseline:
+            before = old.get(name, {"flash": 0, "ram": 0})
+            line += "  %s %s" % (change(entry["flash"], before["flash"]), change(entry["ram"], before["ram"]))
+        print(line)
+    for memory, region in (("flash", "rom"), ("ram", "ram")):
+        size = result["regions"].get(region)
+        line = "%-16s %10d of %d, %d free" % (memory, result[memory], size, size - result[memory]) if size else \
+            "%-16s %10d" % (memory, result[memory])
+        if baseline:
+            line += "  %s" % change(result[memory], baseline[memory])
+        print(line)
+
+    if top:
+        print("\nlargest modules")
+        modules = sorted(result["modules"].items(), key=lambda item: -item[1]["ram"] - item[1]["flash"])
+        for name, entry in modules[:top]:
+            print("%-32s %-16s %8d %8d" % (name, entry["subsystem"], entry["flash"], entry["ram"]))
+
+    if baseline:
+        before = baseline["modules"]
+        names = set(result["modules"]) | set(before)
+        empty = {"flash": 0, "ram": 0}
+
+        def delta(name):
+            a, b = before.get(name, empty), result["modules"].get(name, empty)
+            return b["flash"] - a["flash"], b["ram"] - a["ram"]
+
+        changed = [name for name in sorted(names, key=lambda n: -sum(map(abs, delta(n)))) if delta(name) != (0, 0)]
+        if changed:
+            print("\nmodules that changed most against the baseline")
+            for name in changed[:top or 10]:
+                flash, ram = delta(name)
+                print("%-32s %+8d %+8d" % (name, flash, ram))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="the .map file the link wrote")
+    parser.add_argument("--modules", type=int, default=0, metavar="N", help="also list the N largest modules")
+    parser.add_argument("--save", metavar="FILE", help="write the result as JSON")
+    parser.add_argument("--baseline", metavar="FILE", help="a result saved from an earlier build")
+    parser.add_argument("--limit", type=int, metavar="BYTES", help="with --baseline, the growth that fails")
+    args = parser.parse_args()
+
+    regions, sections = parse_map(args.map)
+    if not sections:
+        sys.exit("%s has no memory map" % args.map)
+    result = budget(regions, sections)
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    report(result, baseline, args.modules)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(result, f, indent=1, sort_keys=True)
+
+    if baseline and args.limit is not None:
+        grown = [memory for memory in ("flash", "ram") if result[memory] - baseline[memory] > args.limit]
+        if grown:
+            print("\n%s grew by more than %d bytes" % (" and ".join(grown), args.limit))
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,317 @@
+"""Network load stress test, proves a flood cannot upset the ECU's control loop.
+
+    python net_stress.py --duration 30
+    python net_stress.py --broadcast 5000 --udp 0 --syn 0
+    sudo python net_stress.py --iface eth0 --arp 2000 --syn 2000
+    python net_stress.py --udp 2000 --udp-size 8000 --save flood.json
+
+Reads the control loop stage timings (Profiler.h) and the load counters
+from the profile data frame (ControlProtocol.h, version 16) twice: after
+--quiet seconds with no extra traffic, then after --duration seconds of
+flood. The flood mixes, each at its own rate in frames per second, 0 to
+leave it out:
+
+    --broadcast   UDP broadcasts to the ports Windows discovery uses
+                  (NetBIOS, SSDP, LLMNR, WS-Discovery), what a laptop on
+                  the bench sends on its own
+    --arp         ARP requests, broadcast, half of them for the ECU's address
+    --udp         UDP datagrams of --udp-size bytes to the ECU, above 1472
+                  bytes they arrive as IP fragments
+    --syn         TCP SYNs from random ports to the ECU's --syn-port
+
+--arp needs --iface and --syn a raw socket, both need root on Linux.
+
+The test fails, with exit code 1, when any control cycle overran during
+the flood, when the control loop was released later than --max-wake us
+after its tick or the steering rate loop (STEERING_RATE_LOOP builds) was
+off its period by more than --max-jitter us. The GMAC and lwIP drop
+counts are printed but do not fail it, dropping a flood is allowed.
+Run with the drive disconnected or the cart up on stands. Standard library
+only.
+"""
+
+import argparse
+import json
+import os
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_PROFILE_REQUEST = 6
+FRAME_PROFILE_DATA = 7
+PROFILE_READ = 0
+PROFILE_RESET = 1
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+COMMAND_PORT = 12090
+
+# in profiler_stage_t order
+STAGES = ("cycle", "inputs", "algorithms", "steering_pid", "speed_pid", "outputs",
+          "eth_receive", "eth_send", "wake", "steering_rate", "estop", "gmac_isr",
+          "can_receive", "steering_rate_jitter", "command_auth", "traction")
+# the stages the report shows
+REPORT_STAGES = ("cycle", "wake", "steering_rate", "steering_rate_jitter", "gmac_isr", "eth_receive", "can_receive")
+# CONTROL_PROFILE_CACHE_SIZE, two events per section
+CACHE_SECTION_SIZE = 28
+LOAD = struct.Struct("<IIIII")
+LOAD_FIELDS = ("cycles", "overruns", "rx_frames", "rx_dropped", "link_dropped")
+
+# NetBIOS name and datagram, SSDP, LLMNR, WS-Discovery
+BROADCAST_PORTS = (137, 138, 1900, 5355, 3702)
+# IP header without options and UDP header
+UDP_PAYLOAD_MAX = 1500 - 20 - 8
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def profile_request(sock, args, action, sequence):
+    """The profile data payload, the request is repeated in case one got lost in a flood"""
+    for _ in range(args.retries):
+        sock.sendto(frame(FRAME_PROFILE_REQUEST, sequence, bytes([action])), (args.ecu, args.port))
+        deadline = time.monotonic() + args.timeout
+        while time.monotonic() < deadline:
+            try:
+                data = sock.recv(4096)
+            except socket.timeout:
+                break
+            if len(data) < HEADER.size + 6 + CRC.size:
+                continue
+            version, frame_type, length, _, _ = HEADER.unpack_from(data)
+            if version != PROTOCOL_VERSION or frame_type != FRAME_PROFILE_DATA or len(data) < HEADER.size + length + CRC.size:
+                continue
+            if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+                continue
+            return data[HEADER.size:HEADER.size + length]
+    sys.exit("no profile data from %s" % args.ecu)
+
+
+def parse_profile(payload):
+    core_clock, count, bins = struct.unpack_from("<IBB", payload)
+    stages = {}
+    offset = 6
+    for index in range(count):
+        samples, low, high, mean = struct.unpack_from("<IIII", payload, offset)
+        offset += 16 + 4 * bins
+        name = STAGES[index] if index < len(STAGES) else str(index)
+        if samples:
+            stages[name] = {"samples": samples, "min": low, "mean": mean, "max": high}
+    offset += 1 + payload[offset] * CACHE_SECTION_SIZE
+    load = dict(zip(LOAD_FIELDS, LOAD.unpack_from(payload, offset)))
+    return {"core_clock": core_clock, "stages": stages, "load": load}
+
+
+def measure(sock, args, seconds, flood=None):
+    """Stage timings over seconds, with flood running, and the load counters' change"""
+    before = parse_profile(profile_request(sock, args, PROFILE_RESET, 1))["load"]
+    if flood:
+        flood.start()
+    time.sleep(seconds)
+    sent = flood.stop() if flood else {}
+    # the ECU works through what is still queued before it answers
+    time.sleep(0.2)
+    result = parse_profile(profile_request(sock, args, PROFILE_READ, 2))
+    result["load"] = {name: (result["load"][name] - before[name]) & 0xFFFFFFFF for name in LOAD_FIELDS}
+    result["sent"] = sent
+    return result
+
+
+def checksum(data):
+    if len(data) & 1:
+        data += b"\0"
+    total = sum(struct.unpack("!%dH" % (len(data) // 2), data))
+    while total >> 16:
+        total = (total & 0xFFFF) + (total >> 16)
+    return ~total & 0xFFFF
+
+
+def local_address(ecu):
+    """The address the PC reaches the ECU from"""
+    probe = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    probe.connect((ecu, COMMAND_PORT))
+    address = probe.getsockname()[0]
+    probe.close()
+    return address
+
+
+class Sender(threading.Thread):
+    """Sends one kind of traffic at rate frames per second until stopped"""
+
+    def __init__(self, name, rate, send, stop):
+        super().__init__(daemon=True)
+        self.kind, self.rate, self.send, self.stop_event = name, rate, send, stop
+        self.sent = 0
+        self.errors = 0
+
+    def run(self):
+        start = time.monotonic()
+        while not self.stop_event.is_set():
+            ahead = start + self.sent / self.rate - time.monotonic()
+            if ahead > 0.001:
+                time.sleep(ahead)
+                continue
+            try:
+                self.send(self.sent)
+            except OSError:
+                # a full socket buffer, the PC cannot send any faster
+                self.errors += 1
+            self.sent += 1
+
+
+class Flood:
+    def __init__(self, args):
+        self.stop_event = threading.Event()
+        self.senders = []
+        self.factories = []
+        source = local_address(args.ecu)
+        ecu = socket.inet_aton(args.ecu)
+
+        if args.broadcast:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+            payload = os.urandom(args.broadcast_size)
+
+            def broadcast(n):
+                sock.sendto(payload, (args.broadcast_address, BROADCAST_PORTS[n % len(BROADCAST_PORTS)]))
+            self.factories.append(("broadcast", args.broadcast, broadcast))
+
+        if args.arp:
+            if not args.iface:
+                sys.exit("--arp needs --iface")
+            sock = socket.socket(socket.AF_PACKET, socket.SOCK_RAW)
+            sock.bind((args.iface, 0))
+            with open("/sys/class/net/%s/address" % args.iface) as f:
+                mac = bytes.fromhex(f.read().strip().replace(":", ""))
+            prefix = ecu[:3]
+
+            def arp(n):
+                # every other request asks for the ECU, the rest for its neighbours
+                target = ecu if n & 1 else prefix + bytes([random.randint(1, 254)])
+                sock.send(b"\xff" * 6 + mac + struct.pack("!H", 0x0806) +
+                          struct.pack("!HHBBH", 1, 0x0800, 6, 4, 1) + mac + socket.inet_aton(source) + b"\0" * 6 + target)
+            self.factories.append(("arp", args.arp, arp))
+
+        if args.udp:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            payload = os.urandom(args.udp_size)
+
+            def udp(n):
+                sock.sendto(payload, (args.ecu, args.udp_port))
+            self.factories.append(("udp", args.udp, udp))
+
+        if args.syn:
+            # the kernel adds the IP header and answers the ECU's SYN-ACKs with a reset
+            sock = socket.socket(socket.AF_INET, socket.SOCK_RAW, socket.IPPROTO_TCP)
+            pseudo = socket.inet_aton(source) + ecu + struct.pack("!BBH", 0, socket.IPPROTO_TCP, 20)
+
+            def syn(n):
+                header = struct.pack("!HHIIBBHHH", random.randint(1024, 65535), args.syn_port,
+                                     random.getrandbits(32), 0, 5 << 4, 0x02, 64240, 0, 0)
+                header = header[:16] + struct.pack("!H", checksum(pseudo + header)) + header[18:]
+                sock.sendto(header, (args.ecu, 0))
+            self.factories.append(("syn", args.syn, syn))
+
+    def start(self):
+        self.stop_event.clear()
+        self.senders = [Sender(name, rate, send, self.stop_event) for name, rate, send in self.factories]
+        for sender in self.senders:
+            sender.start()
+
+    def stop(self):
+        self.stop_event.set()
+        for sender in self.senders:
+            sender.join()
+        return {sender.kind: {"sent": sender.sent, "errors": sender.errors} for sender in self.senders}
+
+
+def us(cycles, core_clock):
+    return 1e6 * cycles / core_clock
+
+
+def report(quiet, flood):
+    clock = flood["core_clock"]
+    print("flood sent: " + ", ".join("%s %d (%d refused)" % (kind, sent["sent"], sent["errors"])
+                                     for kind, sent in flood["sent"].items()))
+    print("\n%-22s %21s   %21s" % ("us", "quiet mean / max", "flood mean / max"))
+    for name in REPORT_STAGES:
+        if name not in quiet["stages"] and name not in flood["stages"]:
+            continue
+        line = "%-22s" % name
+        for result in (quiet, flood):
+            stage = result["stages"].get(name)
+            line += "   %9.2f / %9.2f" % (us(stage["mean"], clock), us(stage["max"], clock)) if stage else "   %21s" % "-"
+        print(line)
+    print("\n%-22s %10s %10s" % ("", "quiet", "flood"))
+    for name in LOAD_FIELDS:
+        print("%-22s %10d %10d" % (name, quiet["load"][name], flood["load"][name]))
+
+
+def verdict(flood, args):
+    clock = flood["core_clock"]
+    failures = []
+    load, stages = flood["load"], flood["stages"]
+    if not load["cycles"]:
+        failures.append("the control loop did not run")
+    if load["overruns"] > args.max_overruns:
+        failures.append("%d control cycles overran" % load["overruns"])
+    if "wake" in stages and us(stages["wake"]["max"], clock) > args.max_wake:
+        failures.append("the control loop was released %.1f us late" % us(stages["wake"]["max"], clock))
+    if "steering_rate_jitter" in stages and us(stages["steering_rate_jitter"]["max"], clock) > args.max_jitter:
+        failures.append("the steering rate loop was %.1f us off its period" % us(stages["steering_rate_jitter"]["max"], clock))
+    if not load["rx_frames"]:
+        failures.append("the ECU received none of the flood")
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--port", type=int, default=COMMAND_PORT)
+    parser.add_argument("--timeout", type=float, default=0.5)
+    parser.add_argument("--retries", type=int, default=5, help="profile requests before giving up")
+    parser.add_argument("--quiet", type=float, default=10.0, help="seconds measured without the flood")
+    parser.add_argument("--duration", type=float, default=30.0, help="seconds of flood")
+    parser.add_argument("--broadcast", type=float, default=2000, metavar="FPS")
+    parser.add_argument("--broadcast-address", default="255.255.255.255")
+    parser.add_argument("--broadcast-size", type=int, default=200, help="UDP payload bytes")
+    parser.add_argument("--arp", type=float, default=0, metavar="FPS")
+    parser.add_argument("--iface", help="the interface the ECU is on, for --arp")
+    parser.add_argument("--udp", type=float, default=2000, metavar="FPS")
+    parser.add_argument("--udp-size", type=int, default=UDP_PAYLOAD_MAX, help="UDP payload bytes")
+    parser.add_argument("--udp-port", type=int, default=9, help="the discard port, nothing listens on it")
+    parser.add_argument("--syn", type=float, default=0, metavar="FPS")
+    parser.add_argument("--syn-port", type=int, default=80)
+    parser.add_argument("--max-overruns", type=int, default=0)
+    parser.add_argument("--max-wake", type=float, default=100.0, metavar="US")
+    parser.add_argument("--max-jitter", type=float, default=10.0, metavar="US")
+    parser.add_argument("--save", metavar="FILE", help="keep both results as JSON")
+    args = parser.parse_args()
+
+    flood = Flood(args)
+    if not flood.factories:
+        sys.exit("every kind of traffic is off")
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+
+    quiet = measure(sock, args, args.quiet)
+    flooded = measure(sock, args, args.duration, flood)
+    report(quiet, flooded)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump({"quiet": quiet, "flood": flooded}, f, indent=1)
+
+    failures = verdict(flooded, args)
+    print("\n" + ("FAIL: " + "; ".join(failures) if failures else "PASS"))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
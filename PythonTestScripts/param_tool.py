@@ -0,0 +1,187 @@
+"""Reads and changes the ECU's stored tuning parameters (ParamStore.h).
+
+    python param_tool.py read
+    python param_tool.py read speed_p_gain speed_i_gain
+    python param_tool.py set override_pid=1 speed_p_gain=0.8 speed_i_gain=0.0004
+    python param_tool.py save
+    python param_tool.py defaults
+    python param_tool.py set node_id=1 node_ip=192.168.2.120 --ecu 192.168.2.100
+    python param_tool.py set shadow_pid=1 shadow_steer_p_gain=0.02
+    python param_tool.py set peer_ip=192.168.2.1 peer_mac_high=0x3cecef peer_mac_low=0x1a2b3c
+
+Uses the param request of the UDP control protocol (ControlProtocol.h,
+version 16) on the ECU's param port. All parameters of one set are applied
+together at the start of the same control cycle, or none of them if any is
+rejected. Only a save keeps them over a power cycle. Every request prints
+the parameters the ECU sent back. The node and peer parameters (NodeIdentity.h)
+and the DAC throttle volts (DacThrottle.h) only take effect at the ECU's
+next boot, save them first. The shadow gains (ShadowController.h) are only
+run beside the live ones, signal_watch.py streams how far they diverge. With --usb the request goes through the ECU's
+USB debug port instead (usb_debug.py). Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_PARAM_REQUEST = 12
+FRAME_PARAM_DATA = 13
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+
+PARAM_PORT = 12091
+BATCH_MAX = 16
+
+ACTIONS = {"read": 0, "set": 1, "save": 2, "defaults": 3}
+# in param_id_t order
+PARAMS = ("override_pid", "speed_p_gain", "speed_i_gain", "speed_d_gain",
+          "steer_p_gain", "steer_i_gain", "steer_d_gain", "node_id", "node_ip", "node_mac",
+          "throttle_zero", "throttle_full", "shadow_pid", "shadow_speed_p_gain", "shadow_speed_i_gain",
+          "shadow_speed_d_gain", "shadow_steer_p_gain", "shadow_steer_i_gain", "shadow_steer_d_gain",
+          "peer_ip", "peer_mac_high", "peer_mac_low")
+# parameters that are not floats
+UINT_PARAMS = {"override_pid", "node_id", "node_ip", "node_mac", "shadow_pid", "peer_ip", "peer_mac_high",
+               "peer_mac_low"}
+# set and shown as a dotted address, 0 for the one node_id gives or the
+# firmware's PC address
+ADDRESS_PARAMS = {"node_ip", "peer_ip"}
+TYPE_FLOAT = 1
+RESULTS = ("done", "rejected", "no NVM to save to", "unknown action")
+STORE_STATES = ("idle", "saving", "unavailable")
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def param_id(name):
+    if name.isdigit():
+        return int(name)
+    try:
+        return PARAMS.index(name)
+    except ValueError:
+        sys.exit("unknown parameter %s, one of %s" % (name, ", ".join(PARAMS)))
+
+
+def param_name(index):
+    return PARAMS[index] if index < len(PARAMS) else str(index)
+
+
+def encode_value(name, text):
+    if name in ADDRESS_PARAMS and "." in text:
+        return struct.unpack(">I", socket.inet_aton(text))[0]
+    if name in UINT_PARAMS:
+        return int(text, 0)
+    return struct.unpack("<I", struct.pack("<f", float(text)))[0]
+
+
+def request_payload(action, entries):
+    payload = struct.pack("<BB", ACTIONS[action], len(entries))
+    for entry in entries:
+        if action == "set":
+            name, _, text = entry.partition("=")
+            if not text:
+                sys.exit("set takes name=value, got %s" % entry)
+            payload += struct.pack("<BI", param_id(name), encode_value(name, text))
+        else:
+            payload += struct.pack("<B", param_id(entry))
+    return payload
+
+
+def parse_param_data(data):
+    """Returns (result, rejected, state, sequence, [(id, type, raw value)]) or None."""
+    if len(data) < HEADER.size + 8 + CRC.size:
+        return None
+    version, frame_type, length, _, _ = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or frame_type != FRAME_PARAM_DATA or len(data) != HEADER.size + length + CRC.size:
+        return None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None
+    result, rejected, state, sequence, count = struct.unpack_from("<BBBIB", data, HEADER.size)
+    entries = [struct.unpack_from("<BBI", data, HEADER.size + 8 + 6 * i) for i in range(count)]
+    return result, rejected, state, sequence, entries
+
+
+def udp_request(args, request):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+    sock.sendto(request, (args.ecu, args.port))
+
+    deadline = time.monotonic() + args.timeout
+    while time.monotonic() < deadline:
+        try:
+            data = sock.recv(2048)
+        except socket.timeout:
+            break
+        reply = parse_param_data(data)
+        if reply is not None:
+            return reply
+    return None
+
+
+def usb_request(device, request, timeout):
+    # termios, the UDP path still works where there is none
+    import usb_debug
+    port = usb_debug.UsbDebugPort(device)
+    try:
+        port.send(usb_debug.KIND_FRAME, request)
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            record = port.receive(deadline - time.monotonic())
+            if record is None:
+                break
+            if record[0] == usb_debug.KIND_FRAME:
+                reply = parse_param_data(record[1])
+                if reply is not None:
+                    return reply
+    finally:
+        port.close()
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("action", choices=sorted(ACTIONS))
+    parser.add_argument("entries", nargs="*", help="read: parameter names or ids, set: name=value")
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--port", type=int, default=PARAM_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0)
+    parser.add_argument("--usb", metavar="DEVICE", help="the USB debug port, /dev/ttyACM0 on Linux")
+    args = parser.parse_args()
+
+    if args.action == "set" and not args.entries:
+        parser.error("set needs at least one name=value")
+    if args.action in ("save", "defaults") and args.entries:
+        parser.error("%s takes no parameters" % args.action)
+    if len(args.entries) > BATCH_MAX:
+        parser.error("at most %d parameters per request" % BATCH_MAX)
+
+    request = frame(FRAME_PARAM_REQUEST, 1, request_payload(args.action, args.entries))
+    reply = usb_request(args.usb, request, args.timeout) if args.usb else udp_request(args, request)
+    if reply is None:
+        sys.exit("no param data from %s" % (args.usb or args.ecu))
+
+    result, rejected, state, sequence, entries = reply
+    result_name = RESULTS[result] if result < len(RESULTS) else str(result)
+    if result == 1 and args.action == "set":
+        result_name += " at %s, nothing applied" % args.entries[rejected] if rejected < len(args.entries) else ""
+    state_name = STORE_STATES[state] if state < len(STORE_STATES) else str(state)
+    print("%s, store %s, last save %d" % (result_name, state_name, sequence))
+    for index, value_type, value in entries:
+        if param_name(index) in ADDRESS_PARAMS and value != 0:
+            print("  %-14s %s" % (param_name(index), socket.inet_ntoa(struct.pack(">I", value))))
+        elif value_type == TYPE_FLOAT:
+            print("  %-14s %g" % (param_name(index), struct.unpack("<f", struct.pack("<I", value))[0]))
+        else:
+            print("  %-14s %d" % (param_name(index), value))
+    return 0 if result == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
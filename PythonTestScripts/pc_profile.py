@@ -0,0 +1,103 @@
+"""Profiles the ECU with its PC sampler (PcSampler.h) and resolves the histogram against the ELF file.
+
+    python pc_profile.py DriveByWireECU.elf --duration 10
+    python pc_profile.py DriveByWireECU.elf --read --top 40
+    python pc_profile.py DriveByWireECU.elf --load samples.json
+
+Starts the sampler over the diagnostics server (/samples/start), lets it
+run for --duration seconds, stops it and reads the histogram back from
+/samples. --read only reads what the sampler holds, running or not, and
+--load a histogram saved with --save. Every bin is charged to the
+function its first byte is in, from arm-none-eabi-nm, so a bin that
+straddles two small functions goes to the first. The functions with the
+most samples are printed with their share of all samples. The firmware
+has to be built with PC_SAMPLER_ENABLE, and the ELF file has to be the
+one running. Standard library only.
+"""
+
+import argparse
+import bisect
+import json
+import subprocess
+import sys
+import time
+import urllib.request
+
+
+def fetch(ecu, page, timeout):
+    with urllib.request.urlopen("http://%s%s" % (ecu, page), timeout=timeout) as response:
+        return json.load(response)
+
+
+def symbols(tool, elf):
+    """Sorted (address, size, name) of the functions in elf."""
+    found = []
+    for line in subprocess.check_output([tool + "nm", "-S", "-n", elf], text=True).splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in "tTwW":
+            # Thumb function addresses have bit 0 set in some builds
+            found.append((int(fields[0], 16) & ~1, int(fields[1], 16), fields[3]))
+    return found
+
+
+def resolve(histogram, functions):
+    starts = [address for address, _, _ in functions]
+    counts = {}
+    bin_size = histogram["bin_size"]
+    for region in histogram["regions"]:
+        for index, count in region["bins"]:
+            if count == 0:
+                continue
+            address = region["base"] + index * bin_size
+            i = bisect.bisect_right(starts, address) - 1
+            if i >= 0 and address < functions[i][0] + max(functions[i][1], 1):
+                name = functions[i][2]
+            else:
+                name = "%s 0x%08x" % (region["name"], address)
+            counts[name] = counts.get(name, 0) + count
+    return counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf")
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--duration", type=float, default=10.0, help="s to sample for")
+    parser.add_argument("--read", action="store_true", help="read the histogram without starting the sampler")
+    parser.add_argument("--load", help="histogram saved with --save, nothing is asked of the ECU")
+    parser.add_argument("--save", help="also write the histogram as JSON")
+    parser.add_argument("--top", type=int, default=25)
+    parser.add_argument("--tool", default="arm-none-eabi-", help="binutils prefix")
+    parser.add_argument("--timeout", type=float, default=5.0)
+    args = parser.parse_args()
+
+    if args.load:
+        with open(args.load) as saved:
+            histogram = json.load(saved)
+    else:
+        if not args.read:
+            fetch(args.ecu, "/samples/start", args.timeout)
+            time.sleep(args.duration)
+            fetch(args.ecu, "/samples/stop", args.timeout)
+        histogram = fetch(args.ecu, "/samples", args.timeout)
+    if not histogram["built"]:
+        sys.exit("the firmware is built without PC_SAMPLER_ENABLE")
+    if args.save:
+        with open(args.save, "w") as output:
+            json.dump(histogram, output)
+
+    samples = histogram["samples"]
+    if samples == 0:
+        sys.exit("no samples")
+    counts = resolve(histogram, symbols(args.tool, args.elf))
+    print("%d samples at %d Hz, %.1f s%s, %d outside the histogram"
+          % (samples, histogram["rate"], samples / histogram["rate"],
+             ", stopped by a full bin" if histogram["saturated"] else "", histogram["other"]))
+    print("%8s %6s  %s" % ("samples", "share", "function"))
+    for name, count in sorted(counts.items(), key=lambda item: -item[1])[:args.top]:
+        print("%8d %5.1f%%  %s" % (count, 100.0 * count / samples, name))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,307 @@
+"""Keeps the ECU's performance results build over build and flags regressions against a baseline.
+
+    python perf_history.py record perf.jsonl --bench bench.json --profile profile.json
+    python perf_history.py record perf.jsonl --build v1.4-17-gabc1234 --memory Release/DriveByWireECU.memory.json
+    python perf_history.py record perf.jsonl --latency latency.json
+    python perf_history.py baseline perf.jsonl v1.4-17-gabc1234
+    python perf_history.py report perf.jsonl --html perf.html
+    python perf_history.py report perf.jsonl --limit bench.=2 --limit latency.round_trip.p99.9=50
+
+The history is a JSON lines file, one line per build, that only grows and
+is kept beside the builds. record turns what the other scripts saved into
+named metrics of a build, lower is better for every one:
+
+    bench.<case>.min, .mean, .failed    bench_compare.py --save, core cycles
+    profile.<stage>.mean, .max          build_compare.py profile --save, core
+                                        cycles, profile.cycle.max is the
+                                        control loop's measured WCET
+    memory.flash, .ram,                 memory_budget.py --save, bytes
+    memory.<subsystem>.flash, .ram
+    latency.<series>.p50, .p99, .p99.9  latency_bench.py --save, us
+
+The build is named by git describe of the tree unless --build is given.
+Recording a build that is in the history already adds to and replaces its
+metrics, so the results of one build can come in from separate runs.
+
+baseline marks a build as the one the others are held against, the first
+recorded build until one is. report holds a build, the last recorded by
+default, against the baseline: every metric with its change in percent,
+and a regression where it grew by more than its limit or went missing
+from a group the build has results of. A limit is set per metric name
+prefix, the longest one that matches counts, LIMITS gives the defaults.
+Exits with 1 on a regression, to gate a build on. --html also writes the
+report as a page with every metric's history over the last --last builds.
+Standard library only.
+"""
+
+import argparse
+import datetime
+import html
+import json
+import os
+import subprocess
+import sys
+
+# percent a metric may grow by, per name prefix. The bench min and the
+# memory do not move without a change, the means, maxes and latencies take
+# whatever interrupts and the network do.
+LIMITS = {
+    "": 10.0,
+    "bench.": 10.0,
+    "bench.min.": 3.0,
+    "profile.": 10.0,
+    "memory.": 2.0,
+    "latency.": 20.0,
+}
+LATENCY_PERCENTILES = ("p50", "p99", "p99.9")
+
+
+def load(path):
+    """The builds of the history, oldest first."""
+    if not os.path.exists(path):
+        return []
+    with open(path) as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+def store(path, builds):
+    with open(path + ".tmp", "w") as f:
+        for build in builds:
+            f.write(json.dumps(build, sort_keys=True) + "\n")
+    os.replace(path + ".tmp", path)
+
+
+def describe():
+    try:
+        return subprocess.check_output(["git", "describe", "--always", "--dirty"],
+                                       cwd=os.path.dirname(os.path.abspath(__file__)),
+                                       stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def read_json(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def bench_metrics(result):
+    metrics = {}
+    for name, case in result.items():
+        metrics["bench.%s.min" % name] = case["min"]
+        metrics["bench.%s.mean" % name] = case["mean"]
+        metrics["bench.%s.failed" % name] = case.get("failed", 0)
+    return metrics
+
+
+def profile_metrics(result):
+    metrics = {}
+    for name, stage in result["stages"].items():
+        metrics["profile.%s.mean" % name] = stage["mean"]
+        metrics["profile.%s.max" % name] = stage["max"]
+    return metrics
+
+
+def memory_metrics(result):
+    metrics = {"memory.flash": result["flash"], "memory.ram": result["ram"]}
+    for name, entry in result["subsystems"].items():
+        metrics["memory.%s.flash" % name] = entry["flash"]
+        metrics["memory.%s.ram" % name] = entry["ram"]
+    return metrics
+
+
+def latency_metrics(result):
+    metrics = {}
+    for name, stats in result["series"].items():
+        for percentile in LATENCY_PERCENTILES:
+            metrics["latency.%s.%s" % (name, percentile)] = stats[percentile]
+    return metrics
+
+
+def group(name):
+    return name.split(".", 1)[0]
+
+
+def limit(name, limits):
+    """Percent name may grow by, from the longest prefix of limits it has.
+    bench.min. matches the min of every case."""
+    parts = name.split(".")
+    # bench.<case>.min is limited as bench.min.<case>
+    if len(parts) == 3 and parts[0] == "bench":
+        name = "%s.%s.%s" % (parts[0], parts[2], parts[1])
+    return limits[max((prefix for prefix in limits if name.startswith(prefix)), key=len)]
+
+
+def compare(build, baseline, limits):
+    """(name, baseline value, build value, change in percent, regressed) of
+    every metric of either, regressions first."""
+    new = build["metrics"]
+    old = baseline["metrics"]
+    groups = set(group(name) for name in new)
+    rows = []
+    for name in sorted(set(new) | set(old)):
+        before = old.get(name)
+        after = new.get(name)
+        if after is None:
+            rows.append((name, before, None, None, group(name) in groups))
+            continue
+        if before is None:
+            rows.append((name, None, after, None, False))
+            continue
+        if before:
+            change = 100.0 * after / before - 100
+            regressed = change > limit(name, limits)
+        else:
+            change = 0.0 if after == 0 else float("inf")
+            regressed = after > 0
+        rows.append((name, before, after, change, regressed))
+    rows.sort(key=lambda row: not row[4])
+    return rows
+
+
+def format_value(value):
+    if value is None:
+        return "-"
+    return "%d" % value if value == int(value) and abs(value) < 1e12 else "%.1f" % value
+
+
+def format_change(change):
+    if change is None:
+        return ""
+    return "new" if change == float("inf") else "%+.1f%%" % change
+
+
+def sparkline(values, width=160, height=24):
+    """An inline SVG of values, builds without the metric left out."""
+    points = [(i, v) for i, v in enumerate(values) if v is not None]
+    if len(points) < 2:
+        return ""
+    low = min(v for _, v in points)
+    high = max(v for _, v in points)
+    span = (high - low) or 1
+    step = width / max(1, len(values) - 1)
+    path = " ".join("%.1f,%.1f" % (i * step, height - 2 - (v - low) / span * (height - 4)) for i, v in points)
+    return ('<svg width="%d" height="%d"><polyline fill="none" stroke="#36c" stroke-width="1.5" points="%s"/>'
+            '</svg>' % (width, height, path))
+
+
+def write_html(path, build, baseline, rows, history):
+    lines = [
+        "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>ECU performance %s</title>" % html.escape(build["build"]),
+        "<style>body{font-family:sans-serif}td,th{padding:2px 8px;text-align:right}td:first-child{text-align:left}"
+        "tr.regressed{background:#fcc}</style></head><body>",
+        "<h1>%s against %s</h1>" % (html.escape(build["build"]), html.escape(baseline["build"])),
+        "<p>%d metrics, %d regressed. History over the last %d builds, %s to %s.</p>" % (
+            len(rows), sum(1 for row in rows if row[4]), len(history), html.escape(history[0]["build"]),
+            html.escape(history[-1]["build"])),
+        "<table><tr><th>metric</th><th>baseline</th><th>build</th><th>change</th><th>history</th></tr>",
+    ]
+    for name, before, after, change, regressed in rows:
+        lines.append("<tr%s><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td></tr>" % (
+            ' class="regressed"' if regressed else "", html.escape(name), format_value(before),
+            format_value(after), format_change(change), sparkline([b["metrics"].get(name) for b in history])))
+    lines.append("</table></body></html>")
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def find(builds, name):
+    for build in builds:
+        if build["build"] == name:
+            return build
+    sys.exit("no build %s in the history" % name)
+
+
+def run_record(args):
+    name = args.build or describe()
+    if not name:
+        sys.exit("no git describe of the tree, give --build")
+    metrics = {}
+    for path, convert in ((args.bench, bench_metrics), (args.profile, profile_metrics),
+                          (args.memory, memory_metrics), (args.latency, latency_metrics)):
+        if path:
+            metrics.update(convert(read_json(path)))
+    if not metrics:
+        sys.exit("nothing to record, give the results of at least one run")
+
+    builds = load(args.history)
+    existing = [build for build in builds if build["build"] == name]
+    if existing:
+        existing[0]["metrics"].update(metrics)
+    else:
+        builds.append({"build": name, "time": datetime.datetime.now(datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ"),
+                       "baseline": False, "metrics": metrics})
+    store(args.history, builds)
+    print("%s: %d metrics recorded, %d builds in %s" % (name, len(metrics), len(builds), args.history))
+    return 0
+
+
+def run_baseline(args):
+    builds = load(args.history)
+    find(builds, args.build)
+    for build in builds:
+        build["baseline"] = build["build"] == args.build
+    store(args.history, builds)
+    print("%s is the baseline" % args.build)
+    return 0
+
+
+def run_report(args):
+    builds = load(args.history)
+    if not builds:
+        sys.exit("%s has no builds" % args.history)
+    build = find(builds, args.build) if args.build else builds[-1]
+    marked = [b for b in builds if b.get("baseline")]
+    baseline = find(builds, args.against) if args.against else (marked[-1] if marked else builds[0])
+
+    limits = dict(LIMITS)
+    for entry in args.limit:
+        prefix, _, percent = entry.rpartition("=")
+        limits[prefix] = float(percent)
+
+    rows = compare(build, baseline, limits)
+    print("%s against %s" % (build["build"], baseline["build"]))
+    width = max([len(row[0]) for row in rows] + [6])
+    for name, before, after, change, regressed in rows:
+        if not args.all and not regressed and (change is None or abs(change) < args.show):
+            continue
+        print("%-*s %12s %12s %9s%s" % (width, name, format_value(before), format_value(after),
+                                        format_change(change), "  REGRESSED" if regressed else ""))
+    regressions = sum(1 for row in rows if row[4])
+    print("%d metrics, %d regressed" % (len(rows), regressions))
+
+    if args.html:
+        end = builds.index(build) + 1
+        write_html(args.html, build, baseline, rows, builds[max(0, end - args.last):end])
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    record = commands.add_parser("record", help="add the results of a build")
+    record.add_argument("history", help="JSON lines file of the builds")
+    record.add_argument("--build", help="name of the build, git describe of the tree if not given")
+    record.add_argument("--bench", metavar="FILE", help="bench_compare.py --save")
+    record.add_argument("--profile", metavar="FILE", help="build_compare.py profile --save")
+    record.add_argument("--memory", metavar="FILE", help="memory_budget.py --save")
+    record.add_argument("--latency", metavar="FILE", help="latency_bench.py --save")
+    baseline = commands.add_parser("baseline", help="hold the other builds against this one")
+    baseline.add_argument("history")
+    baseline.add_argument("build")
+    report = commands.add_parser("report", help="hold a build against the baseline")
+    report.add_argument("history")
+    report.add_argument("--build", help="build to report, the last recorded if not given")
+    report.add_argument("--against", help="build to hold it against instead of the baseline")
+    report.add_argument("--limit", action="append", default=[], metavar="PREFIX=PERCENT",
+                        help="growth that regresses, for metrics whose name starts with PREFIX")
+    report.add_argument("--show", type=float, default=1.0, help="percent of change a metric is listed from")
+    report.add_argument("--all", action="store_true", help="list every metric")
+    report.add_argument("--html", metavar="FILE", help="also write the report as a page")
+    report.add_argument("--last", type=int, default=30, help="builds of history on the page")
+    args = parser.parse_args()
+    return {"record": run_record, "baseline": run_baseline, "report": run_report}[args.command](args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,160 @@
+"""Runs a relay autotune of the steering or the speed loop of an ECU and
+prints the gains it suggests (PIDAutotune.h).
+
+    python pid_autotune.py start steering --ecu 192.168.2.100
+    python pid_autotune.py start speed --ecu 192.168.2.100
+    python pid_autotune.py status --ecu 192.168.2.100
+    python pid_autotune.py abort --ecu 192.168.2.100
+
+Sends autotune requests of the UDP control protocol (ControlProtocol.h,
+version 16) to the command port. start asks for a tune of the loop, then
+polls every --interval s and prints the periods as they are measured until
+the tune ends, then the result and the gains. Ctrl-C asks the ECU to abort.
+status prints the last result, abort ends a tune that runs. The ECU has to be
+Autonomous, with an agent commanding the setpoint to tune around, and for
+the speed loop moving. The gains are per cycle, in the units of the loop's
+parameters, and are not applied. Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_AUTOTUNE_REQUEST = 28
+FRAME_AUTOTUNE_DATA = 29
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+AUTOTUNE_DATA = struct.Struct("<BBBBIffff3f3f")
+
+COMMAND_PORT = 12090
+
+ACTION_READ = 0
+ACTION_START = 1
+ACTION_ABORT = 2
+
+LOOPS = ("steering", "speed")
+UNITS = ("deg", "m/s")
+STATES = ("idle", "settle", "measure")
+RESULTS = ("none", "done", "rejected", "aborted", "timeout", "runaway")
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def parse(data, frame_type):
+    """The payload of an intact frame of frame_type, or None."""
+    if len(data) < HEADER.size + CRC.size:
+        return None
+    version, received_type, length, _, _ = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or received_type != frame_type or len(data) != HEADER.size + length + CRC.size:
+        return None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None
+    return data[HEADER.size:HEADER.size + length]
+
+
+def name(names, value):
+    return names[value] if value < len(names) else str(value)
+
+
+class Ecu:
+    def __init__(self, args):
+        self.address = (args.ecu, args.port)
+        self.timeout = args.timeout
+        self.sequence = 1
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    def request(self, action, loop=0):
+        """The autotune data as a dict, as of before the ECU took action up."""
+        self.sock.sendto(frame(FRAME_AUTOTUNE_REQUEST, self.sequence, struct.pack("<BB", action, loop)), self.address)
+        self.sequence += 1
+        deadline = time.monotonic() + self.timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                sys.exit("%s did not answer the autotune request" % self.address[0])
+            self.sock.settimeout(remaining)
+            try:
+                payload = parse(self.sock.recv(2048), FRAME_AUTOTUNE_DATA)
+            except socket.timeout:
+                continue
+            if payload is not None:
+                return decode(payload)
+
+
+def decode(payload):
+    fields = AUTOTUNE_DATA.unpack_from(payload)
+    return {"state": fields[0], "loop": fields[1], "result": fields[2], "periods": fields[3],
+            "elapsed": fields[4], "bias": fields[5], "oscillation": fields[6], "ultimate_gain": fields[7],
+            "ultimate_period": fields[8], "ziegler_nichols": fields[9:12], "tyreus_luyben": fields[12:15]}
+
+
+def print_result(data):
+    print("last tune: %s of the %s loop after %.1f s" % (name(RESULTS, data["result"]),
+          name(LOOPS, data["loop"]), data["elapsed"] / 1000.0))
+    if not data["ultimate_period"]:
+        return
+    print("relay bias %.4f, oscillation +-%.4f %s" % (data["bias"], data["oscillation"],
+          name(UNITS, data["loop"])))
+    print("Ku %.5g, Tu %.1f ms" % (data["ultimate_gain"], data["ultimate_period"]))
+    for rule, gains in (("Ziegler-Nichols", data["ziegler_nichols"]), ("Tyreus-Luyben", data["tyreus_luyben"])):
+        print("  %-16s p %.5g  i %.5g  d %.5g" % (rule, gains[0], gains[1], gains[2]))
+
+
+def start(ecu, args):
+    loop = LOOPS.index(args.loop)
+    data = ecu.request(ACTION_START, loop)
+    if data["state"] != 0:
+        sys.exit("a tune of the %s loop is running already" % name(LOOPS, data["loop"]))
+    # the answer is of before main_task took the start up
+    time.sleep(args.interval)
+    state = None
+    periods = None
+    try:
+        while True:
+            data = ecu.request(ACTION_READ)
+            if data["state"] != state or data["periods"] != periods:
+                state, periods = data["state"], data["periods"]
+                if state != 0:
+                    print("%6.1f s  %s, %d periods" % (data["elapsed"] / 1000.0, name(STATES, state), periods))
+            if state == 0:
+                break
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        ecu.request(ACTION_ABORT)
+        print("abort requested")
+        time.sleep(args.interval)
+        data = ecu.request(ACTION_READ)
+    print_result(data)
+    return 0 if data["result"] == 1 else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=("start", "status", "abort"))
+    parser.add_argument("loop", nargs="?", choices=LOOPS, default="steering", help="loop to start a tune of")
+    parser.add_argument("--ecu", required=True, help="ECU address")
+    parser.add_argument("--port", type=int, default=COMMAND_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0)
+    parser.add_argument("--interval", type=float, default=0.5, help="s between polls")
+    args = parser.parse_args()
+
+    ecu = Ecu(args)
+    if args.command == "start":
+        return start(ecu, args)
+    if args.command == "abort":
+        ecu.request(ACTION_ABORT)
+        time.sleep(args.interval)
+    print_result(ecu.request(ACTION_READ))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,248 @@
+"""Pulls the ECU's RTOS trace (RtosTrace.h) over the bulk channel and writes a timeline a trace viewer opens.
+
+    python rtos_trace.py timeline.json
+    python rtos_trace.py timeline.json --raw events.csv
+
+Asks the bulk port for the RTOS trace, which stops the ECU recording for
+the dump and starts it over afterwards, and the diagnostics server's
+/tasks page for the task names. The timeline is Chrome trace event JSON:
+open it in https://ui.perfetto.dev or chrome://tracing. Every task is a
+row of the slices it ran, every traced interrupt a row of its handler
+runs, and queue traffic shows as instant events on the task or interrupt
+that made it.
+
+The cycle counter stamping the events stops while the core sleeps, so
+events are placed at the tick before them plus the cycles since, and
+anything before the first tick in the ring is left out. A summary of run
+time, switches and preemptions for every task and handler times for every
+interrupt is printed, with the cost the ECU measured for one event and
+what the trace itself took of the core. Firmware built without
+RTOS_TRACE_ENABLE answers with an empty trace. Standard library only.
+"""
+
+import argparse
+import csv
+import json
+import socket
+import struct
+import sys
+import urllib.request
+
+BULK_PORT = 12092
+BULK_VERSION = 1
+REQUEST_RTOS_TRACE = 6
+HEADER = struct.Struct("<4sBBHIIBBH")
+EVENT = struct.Struct("<IBBH")
+
+TASK_IN, TASK_OUT, TICK, ISR_ENTER, ISR_EXIT = 1, 2, 3, 4, 5
+QUEUE_TYPES = {6: "send", 7: "send_from_isr", 8: "receive", 9: "block_send", 10: "block_receive"}
+TYPE_NAMES = {TASK_IN: "task_in", TASK_OUT: "task_out", TICK: "tick", ISR_ENTER: "isr_enter", ISR_EXIT: "isr_exit"}
+TYPE_NAMES.update(QUEUE_TYPES)
+# SAME54 interrupt numbers of the traced handlers
+IRQ_NAMES = {15: "EIC_3 estop", 79: "CAN1", 84: "GMAC"}
+
+TASKS_PID = 1
+IRQS_PID = 2
+
+
+def receive_all(sock):
+    chunks = []
+    while True:
+        data = sock.recv(65536)
+        if not data:
+            return b"".join(chunks)
+        chunks.append(data)
+
+
+def fetch_trace(ecu, port, timeout):
+    with socket.create_connection((ecu, port), timeout=timeout) as sock:
+        sock.sendall(bytes([REQUEST_RTOS_TRACE]))
+        data = receive_all(sock)
+    if len(data) < HEADER.size:
+        sys.exit("short dump from %s, %d bytes" % (ecu, len(data)))
+    magic, version, dump_type, entry_size, count, clock, event_cycles, enabled, tick_hz = HEADER.unpack_from(data)
+    if magic != b"DBWB" or version != BULK_VERSION or dump_type != REQUEST_RTOS_TRACE:
+        sys.exit("not a version %d RTOS trace dump" % BULK_VERSION)
+    if not enabled:
+        sys.exit("the firmware is built without RTOS_TRACE_ENABLE")
+    if entry_size != EVENT.size:
+        sys.exit("events are %d bytes, expected %d" % (entry_size, EVENT.size))
+    body = data[HEADER.size:]
+    if len(body) != count * entry_size:
+        sys.exit("dump cut short, %d of %d bytes" % (len(body), count * entry_size))
+    events = [EVENT.unpack_from(body, i * entry_size) for i in range(count)]
+    return events, clock, event_cycles, tick_hz
+
+
+def fetch_task_names(ecu, timeout):
+    """Task number to name from /tasks, empty if the page is not there."""
+    try:
+        with urllib.request.urlopen("http://%s/tasks" % ecu, timeout=timeout) as response:
+            page = json.load(response)
+    except (OSError, ValueError) as error:
+        print("no task names from %s: %s" % (ecu, error), file=sys.stderr)
+        return {}
+    return {task["number"]: task["name"] for task in page.get("tasks", [])}
+
+
+def timestamps(events, clock, tick_hz):
+    """us of every event from the first tick, None before it."""
+    times = []
+    anchor_us = None
+    anchor_cycles = 0
+    last_tick = None
+    ticks = 0
+    for cycles, event_type, _, arg in events:
+        if event_type == TICK:
+            if last_tick is not None:
+                ticks += (arg - last_tick) & 0xFFFF
+            last_tick = arg
+            anchor_us = ticks * 1e6 / tick_hz
+            anchor_cycles = cycles
+        if anchor_us is None:
+            times.append(None)
+        else:
+            times.append(anchor_us + ((cycles - anchor_cycles) & 0xFFFFFFFF) * 1e6 / clock)
+    return times
+
+
+class Timeline:
+    def __init__(self, task_names):
+        self.task_names = task_names
+        self.trace = []
+        self.tasks = {}
+        self.irqs = {}
+        self.running = None
+        self.running_since = None
+        self.out = None
+        self.isr_stack = []
+
+    def task_name(self, number):
+        return self.task_names.get(number, "task %d" % number)
+
+    def task_stats(self, number):
+        return self.tasks.setdefault(number, {"run_us": 0.0, "switches": 0, "preempted": 0, "priority": None})
+
+    def close_slice(self, end):
+        if self.running is None or self.running_since is None:
+            return
+        self.task_stats(self.running)["run_us"] += end - self.running_since
+        self.trace.append({"name": self.task_name(self.running), "ph": "X", "pid": TASKS_PID, "tid": self.running,
+                           "ts": self.running_since, "dur": end - self.running_since})
+
+    def add(self, t, event_type, event_id, arg):
+        if event_type == TASK_OUT:
+            # the kernel chooses again on every switch, often the same task
+            self.out = (t, event_id, arg)
+        elif event_type == TASK_IN:
+            stats = self.task_stats(event_id)
+            stats["priority"] = arg
+            if self.out is not None and self.out[1] == event_id and self.running == event_id:
+                self.out = None
+                return
+            if self.out is not None:
+                out_time, out_task, still_ready = self.out
+                self.close_slice(out_time)
+                if still_ready and self.running is not None:
+                    self.task_stats(out_task)["preempted"] += 1
+                self.out = None
+            stats["switches"] += 1
+            self.running = event_id
+            self.running_since = t
+        elif event_type == ISR_ENTER:
+            self.isr_stack.append((event_id, t))
+        elif event_type == ISR_EXIT:
+            if not self.isr_stack or self.isr_stack[-1][0] != event_id:
+                return
+            irq, start = self.isr_stack.pop()
+            stats = self.irqs.setdefault(irq, {"count": 0, "total_us": 0.0, "max_us": 0.0})
+            stats["count"] += 1
+            stats["total_us"] += t - start
+            stats["max_us"] = max(stats["max_us"], t - start)
+            self.trace.append({"name": IRQ_NAMES.get(irq, "IRQ %d" % irq), "ph": "X", "pid": IRQS_PID, "tid": irq,
+                               "ts": start, "dur": t - start})
+        elif event_type in QUEUE_TYPES:
+            if self.isr_stack:
+                pid, tid = IRQS_PID, self.isr_stack[-1][0]
+            elif self.running is not None:
+                pid, tid = TASKS_PID, self.running
+            else:
+                return
+            self.trace.append({"name": "queue " + QUEUE_TYPES[event_type], "ph": "i", "s": "t", "pid": pid, "tid": tid,
+                               "ts": t, "args": {"queue": "0x%04x" % arg, "waiting": event_id}})
+
+    def finish(self, end):
+        if self.out is not None:
+            self.close_slice(self.out[0])
+        else:
+            self.close_slice(end)
+
+    def json(self):
+        meta = [{"name": "process_name", "ph": "M", "pid": TASKS_PID, "args": {"name": "tasks"}},
+                {"name": "process_name", "ph": "M", "pid": IRQS_PID, "args": {"name": "interrupts"}}]
+        for number in self.tasks:
+            meta.append({"name": "thread_name", "ph": "M", "pid": TASKS_PID, "tid": number,
+                         "args": {"name": self.task_name(number)}})
+            # higher priorities on top
+            priority = self.tasks[number]["priority"] or 0
+            meta.append({"name": "thread_sort_index", "ph": "M", "pid": TASKS_PID, "tid": number,
+                         "args": {"sort_index": -priority}})
+        for irq in self.irqs:
+            meta.append({"name": "thread_name", "ph": "M", "pid": IRQS_PID, "tid": irq,
+                         "args": {"name": IRQ_NAMES.get(irq, "IRQ %d" % irq)}})
+        return {"traceEvents": meta + self.trace, "displayTimeUnit": "ns"}
+
+
+def write_raw(path, events, times):
+    with open(path, "w", newline="") as output:
+        writer = csv.writer(output)
+        writer.writerow(["us", "cycles", "type", "id", "arg"])
+        for (cycles, event_type, event_id, arg), t in zip(events, times):
+            writer.writerow(["" if t is None else "%.3f" % t, cycles, TYPE_NAMES.get(event_type, event_type),
+                             event_id, arg])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("output", help="Chrome trace event JSON to write")
+    parser.add_argument("--raw", help="also write every event as CSV")
+    parser.add_argument("--ecu", default="192.168.2.100")
+    parser.add_argument("--port", type=int, default=BULK_PORT)
+    parser.add_argument("--timeout", type=float, default=5.0)
+    parser.add_argument("--no-names", action="store_true", help="number the tasks instead of asking /tasks")
+    args = parser.parse_args()
+
+    names = {} if args.no_names else fetch_task_names(args.ecu, args.timeout)
+    events, clock, event_cycles, tick_hz = fetch_trace(args.ecu, args.port, args.timeout)
+    times = timestamps(events, clock, tick_hz)
+    if args.raw:
+        write_raw(args.raw, events, times)
+
+    timeline = Timeline(names)
+    placed = [(t, event) for t, event in zip(times, events) if t is not None]
+    for t, (_, event_type, event_id, arg) in placed:
+        timeline.add(t, event_type, event_id, arg)
+    if not placed:
+        sys.exit("%d events, none after a tick" % len(events))
+    span = placed[-1][0] - placed[0][0]
+    timeline.finish(placed[-1][0])
+    with open(args.output, "w") as output:
+        json.dump(timeline.json(), output)
+
+    print("%d events over %.1f ms, %d cycles an event, %.2f%% of the core for the trace"
+          % (len(events), span / 1000, event_cycles,
+             100.0 * len(placed) * event_cycles / clock / (span / 1e6) if span > 0 else 0))
+    print("%-16s %4s %10s %6s %9s %9s" % ("task", "prio", "run ms", "load", "switches", "preempted"))
+    for number, stats in sorted(timeline.tasks.items(), key=lambda item: -item[1]["run_us"]):
+        print("%-16s %4s %10.3f %5.1f%% %9d %9d" % (timeline.task_name(number)[:16], stats["priority"],
+                                                     stats["run_us"] / 1000,
+                                                     100.0 * stats["run_us"] / span if span > 0 else 0,
+                                                     stats["switches"], stats["preempted"]))
+    for irq, stats in sorted(timeline.irqs.items()):
+        print("%-16s %6d runs, mean %.2f us, max %.2f us" % (IRQ_NAMES.get(irq, "IRQ %d" % irq), stats["count"],
+                                                               stats["total_us"] / stats["count"], stats["max_us"]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
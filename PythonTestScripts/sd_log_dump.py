@@ -0,0 +1,73 @@
+"""Converts the ECU's SD card log (SdLogger.h) to CSV.
+
+    python sd_log_dump.py card.img log.csv
+    python sd_log_dump.py /dev/sdX log.csv --session 3
+
+Reads a raw image of the card, or the card itself, with flat_log.py from
+the log's first block on and writes one row per control cycle until the first
+chunk that is not part of the log. All sessions unless one is picked, from
+the chunk that has --start s of it on with one. Packed chunks
+(SD_LOGGER_PACK) are unpacked with delta_codec.py. Standard library only.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+import flat_log
+
+BLOCK_SIZE = 512
+FIRST_BLOCK = 8192
+SCHEMA = 1
+CONTROL_SCHEMA = 2
+RECORD = struct.Struct("<II7fB3x")
+FIELDS = ("vehicle_speed", "steering_angle", "vehicle_speed_commanded", "steering_angle_commanded",
+          "acceleration", "front_brake", "steering_torque")
+FLAGS = ("estop", "autonomous", "tele_operation", "reverse", "steer_right")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image", help="card image or device")
+    parser.add_argument("output", help="CSV file to write")
+    parser.add_argument("--session", type=int, help="only this session")
+    parser.add_argument("--start", type=float, default=0.0, help="s into the session, with --session")
+    parser.add_argument("--first-block", type=int, default=FIRST_BLOCK)
+    args = parser.parse_args()
+
+    chunks = rows = 0
+    # records dropped before each session's last chunk
+    dropped = {}
+    with flat_log.FlatLog(args.image, args.first_block * BLOCK_SIZE) as log, \
+            open(args.output, "w", newline="") as output:
+        if log.blocks == 0:
+            sys.exit("no log at block %d" % args.first_block)
+        writer = csv.writer(output)
+        writer.writerow(["session", "cycle", "input_time"] + list(FIELDS) + list(FLAGS))
+        first = 0
+        if args.session is not None:
+            first = log.seek(args.session, int(args.start * 1e6))
+        for index in range(first, log.blocks):
+            chunk = log.header(index)
+            if args.session is not None and chunk.session != args.session:
+                break
+            chunks += 1
+            if chunk.schema == CONTROL_SCHEMA:
+                sys.exit("chunk %d holds the control core's inputs (CONTROL_RECORD_ENABLE), "
+                         "host/ControlReplay reads those" % index)
+            if chunk.schema != SCHEMA or chunk.record_size not in (0, RECORD.size):
+                sys.exit("chunk %d is schema %d with %d byte records, expected schema %d and %d or packed"
+                         % (index, chunk.schema, chunk.record_size, SCHEMA, RECORD.size))
+            dropped[chunk.session] = chunk.dropped
+            for record in log.records(index, RECORD.format):
+                flags = record[-1]
+                writer.writerow([chunk.session] + list(record[:-1]) + [(flags >> b) & 1 for b in range(len(FLAGS))])
+                rows += 1
+
+    print("%d records in %d chunks, %d sessions, %d dropped" % (rows, chunks, len(dropped), sum(dropped.values())))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
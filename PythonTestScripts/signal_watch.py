@@ -0,0 +1,225 @@
+"""Lists the signals an ECU has and streams the ones asked for (SignalBus.h).
+
+    python signal_watch.py schema --ecu 192.168.2.100
+    python signal_watch.py watch --ecu 192.168.2.100 vehicle_speed yaw_rate --period 10
+    python signal_watch.py watch --ecu 192.168.2.100 odometry_x odometry_y odometry_heading --period 1 --csv > pose.csv
+
+schema asks for the telemetry schema of the UDP control protocol
+(ControlProtocol.h, version 16) on the command port and prints every signal:
+id, name, type, unit and how it is sent. watch fetches the schema, subscribes
+to a set of the named signals at --period ms and prints a line per signal
+data frame, the ECU timestamp then the values in the order named, scaled
+back to their units. The subscription is renewed every second and stopped on
+exit. A schema id in the data that differs from the fetched one means the ECU
+was flashed with other signals, watch stops. Several watches can run against
+one ECU at once with their own --tag. Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_SCHEMA_REQUEST = 22
+FRAME_SCHEMA = 23
+FRAME_SIGNAL_SUBSCRIBE = 24
+FRAME_SIGNAL_DATA = 25
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+SCHEMA = struct.Struct("<IBBB")
+SIGNAL_SUBSCRIBE = struct.Struct("<4sHBHB")
+SIGNAL_DATA = struct.Struct("<BIB")
+
+COMMAND_PORT = 12090
+SIGNAL_SET_MAX = 32
+SUBSCRIBE_INTERVAL = 1.0
+
+TYPE_UINT = 0
+TYPE_FLOAT = 1
+TYPE_NAMES = {TYPE_UINT: "uint", TYPE_FLOAT: "float"}
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def parse(data, frame_type):
+    """(timestamp, payload) of an intact frame of frame_type, or None."""
+    if len(data) < HEADER.size + CRC.size:
+        return None
+    version, received_type, length, _, timestamp = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or received_type != frame_type or len(data) != HEADER.size + length + CRC.size:
+        return None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None
+    return timestamp, data[HEADER.size:HEADER.size + length]
+
+
+def parse_schema(payload):
+    """(schema id, signal count, first id, [signal]), a signal being a dict
+    of id, name, type, size, scale and unit."""
+    schema_id, count, first, entries = SCHEMA.unpack_from(payload)
+    signals = []
+    offset = SCHEMA.size
+    for i in range(entries):
+        signal_type, size, scale = struct.unpack_from("<BBf", payload, offset)
+        name_length = payload[offset + 6]
+        name = payload[offset + 7:offset + 7 + name_length].decode("ascii", "replace")
+        unit_length = payload[offset + 7 + name_length]
+        unit_start = offset + 8 + name_length
+        unit = payload[unit_start:unit_start + unit_length].decode("ascii", "replace")
+        offset = unit_start + unit_length
+        signals.append({"id": first + i, "name": name, "type": signal_type, "size": size, "scale": scale,
+                        "unit": unit})
+    return schema_id, count, first, signals
+
+
+def fetch_schema(sock, ecu, port, timeout):
+    """(schema id, [signal]) of every signal, a request per schema frame."""
+    signals = []
+    schema_id = None
+    sequence = 1
+    while True:
+        sock.sendto(frame(FRAME_SCHEMA_REQUEST, sequence, struct.pack("<B", len(signals))), (ecu, port))
+        sequence += 1
+        deadline = time.monotonic() + timeout
+        reply = None
+        while reply is None:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                sys.exit("%s did not answer the schema request" % ecu)
+            sock.settimeout(remaining)
+            try:
+                reply = parse(sock.recv(2048), FRAME_SCHEMA)
+            except socket.timeout:
+                continue
+        frame_id, count, first, entries = parse_schema(reply[1])
+        # reflashed between two requests, start over
+        if schema_id is not None and frame_id != schema_id:
+            signals = []
+        schema_id = frame_id
+        if first == len(signals):
+            signals.extend(entries)
+        if len(signals) >= count or not entries:
+            return schema_id, signals
+
+
+def decode_value(signal, data, offset):
+    size = signal["size"]
+    if signal["type"] == TYPE_FLOAT and signal["scale"] == 0:
+        return struct.unpack_from("<f", data, offset)[0]
+    raw = int.from_bytes(data[offset:offset + size], "little", signed=signal["type"] == TYPE_FLOAT)
+    return raw * signal["scale"] if signal["type"] == TYPE_FLOAT else raw
+
+
+def decode_data(payload, schema_id, tag, signals):
+    """The values of a signal data frame of this set, None for another
+    set's, KeyError if the ECU codes them by another schema."""
+    data_tag, data_schema, count = SIGNAL_DATA.unpack_from(payload)
+    if data_tag != tag:
+        return None
+    if data_schema != schema_id:
+        raise KeyError(data_schema)
+    values = []
+    offset = SIGNAL_DATA.size
+    for signal in signals[:count]:
+        values.append(decode_value(signal, payload, offset))
+        offset += signal["size"]
+    return values
+
+
+def describe(signal):
+    if signal["type"] == TYPE_UINT:
+        wire = "%d byte uint" % signal["size"]
+    elif signal["scale"] == 0:
+        wire = "float"
+    else:
+        wire = "%d byte signed * %g" % (signal["size"], signal["scale"])
+    return "%3d  %-28s %-6s %-8s %s" % (signal["id"], signal["name"], TYPE_NAMES.get(signal["type"], "?"),
+                                        signal["unit"] or "-", wire)
+
+
+def subscribe(sock, args, ids, period, sequence):
+    payload = SIGNAL_SUBSCRIBE.pack(b"\0\0\0\0", 0, args.tag, period, len(ids)) + bytes(ids)
+    sock.sendto(frame(FRAME_SIGNAL_SUBSCRIBE, sequence, payload), (args.ecu, args.port))
+
+
+def schema(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    schema_id, signals = fetch_schema(sock, args.ecu, args.port, args.timeout)
+    print("schema 0x%08x, %d signals" % (schema_id, len(signals)))
+    for signal in signals:
+        print(describe(signal))
+    return 0
+
+
+def watch(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    schema_id, signals = fetch_schema(sock, args.ecu, args.port, args.timeout)
+    by_name = {signal["name"]: signal for signal in signals}
+    unknown = [name for name in args.signals if name not in by_name]
+    if unknown:
+        sys.exit("unknown signals %s, see the schema command" % ", ".join(unknown))
+    if len(args.signals) > SIGNAL_SET_MAX:
+        sys.exit("at most %d signals per set" % SIGNAL_SET_MAX)
+    wanted = [by_name[name] for name in args.signals]
+    ids = [signal["id"] for signal in wanted]
+
+    separator = "," if args.csv else "  "
+    print(separator.join(["timestamp"] + args.signals))
+    sequence = 1
+    subscribe(sock, args, ids, args.period, sequence)
+    renew = time.monotonic() + SUBSCRIBE_INTERVAL
+    try:
+        while True:
+            sock.settimeout(max(0.001, renew - time.monotonic()))
+            try:
+                reply = parse(sock.recv(2048), FRAME_SIGNAL_DATA)
+            except socket.timeout:
+                reply = None
+            if time.monotonic() >= renew:
+                sequence += 1
+                subscribe(sock, args, ids, args.period, sequence)
+                renew += SUBSCRIBE_INTERVAL
+            if reply is None:
+                continue
+            try:
+                values = decode_data(reply[1], schema_id, args.tag, wanted)
+            except KeyError as error:
+                sys.stderr.write("schema changed to 0x%08x, fetch it again\n" % error.args[0])
+                return 1
+            if values is not None:
+                print(separator.join(["%d" % reply[0]] + ["%.6g" % value for value in values]))
+    except KeyboardInterrupt:
+        return 0
+    finally:
+        subscribe(sock, args, [], 0, sequence + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    for name in ("schema", "watch"):
+        command = commands.add_parser(name)
+        command.add_argument("--ecu", required=True, help="ECU address")
+        command.add_argument("--port", type=int, default=COMMAND_PORT)
+        command.add_argument("--timeout", type=float, default=1.0)
+    watch_parser = commands.choices["watch"]
+    watch_parser.add_argument("signals", nargs="+", help="signal names, in the order to print them")
+    watch_parser.add_argument("--period", type=int, default=10, help="ms between frames")
+    watch_parser.add_argument("--tag", type=int, default=1, help="set number, one per watch against an ECU")
+    watch_parser.add_argument("--csv", action="store_true", help="comma separated")
+    args = parser.parse_args()
+
+    if args.command == "schema":
+        return schema(args)
+    return watch(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
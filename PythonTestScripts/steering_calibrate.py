@@ -0,0 +1,152 @@
+"""Runs the steering calibration sweep of an ECU and prints the table it fits
+(SteeringSweep.h).
+
+    python steering_calibrate.py start --ecu 192.168.2.100
+    python steering_calibrate.py status --ecu 192.168.2.100
+    python steering_calibrate.py abort --ecu 192.168.2.100
+
+Sends calibration requests of the UDP control protocol (ControlProtocol.h,
+version 16) to the command port. start asks for a sweep, then polls every
+--interval s and prints each stage as it is entered until the sweep ends,
+then the result and the table in use. Ctrl-C asks the ECU to abort. status
+prints the last result and the table, abort ends a sweep that runs. The cart
+has to be Disabled and standing, with the steering free to turn from stop
+to stop. Standard library only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_CALIBRATION_REQUEST = 26
+FRAME_CALIBRATION_DATA = 27
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+CALIBRATION_DATA = struct.Struct("<BBIHHfBB")
+POINT = struct.Struct("<ff")
+
+COMMAND_PORT = 12090
+
+ACTION_READ = 0
+ACTION_START = 1
+ACTION_ABORT = 2
+
+STATES = ("idle", "seek", "find", "sweep", "center", "saving")
+RESULTS = ("none", "done", "rejected", "aborted", "timeout", "no travel", "flash error")
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def parse(data, frame_type):
+    """The payload of an intact frame of frame_type, or None."""
+    if len(data) < HEADER.size + CRC.size:
+        return None
+    version, received_type, length, _, _ = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or received_type != frame_type or len(data) != HEADER.size + length + CRC.size:
+        return None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None
+    return data[HEADER.size:HEADER.size + length]
+
+
+def name(names, value):
+    return names[value] if value < len(names) else str(value)
+
+
+class Ecu:
+    def __init__(self, args):
+        self.address = (args.ecu, args.port)
+        self.timeout = args.timeout
+        self.sequence = 1
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    def request(self, action):
+        """The calibration data as a dict, as of before the ECU took action up."""
+        self.sock.sendto(frame(FRAME_CALIBRATION_REQUEST, self.sequence, struct.pack("<B", action)), self.address)
+        self.sequence += 1
+        deadline = time.monotonic() + self.timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                sys.exit("%s did not answer the calibration request" % self.address[0])
+            self.sock.settimeout(remaining)
+            try:
+                payload = parse(self.sock.recv(2048), FRAME_CALIBRATION_DATA)
+            except socket.timeout:
+                continue
+            if payload is not None:
+                return decode(payload)
+
+
+def decode(payload):
+    state, result, elapsed, left, right, span, from_record, count = CALIBRATION_DATA.unpack_from(payload)
+    points = [POINT.unpack_from(payload, CALIBRATION_DATA.size + i * POINT.size) for i in range(count)]
+    return {"state": state, "result": result, "elapsed": elapsed, "left": left, "right": right, "span": span,
+            "from_record": from_record, "points": points}
+
+
+def print_table(data):
+    print("last sweep: %s after %.1f s" % (name(RESULTS, data["result"]), data["elapsed"] / 1000.0))
+    if data["left"] or data["right"]:
+        print("stops: left 0x%04x, right 0x%04x%s" % (data["left"], data["right"],
+              ", %.1f deg apart" % data["span"] if data["span"] else ""))
+    print("table in use: %d points, %s" % (len(data["points"]), "from NVM" if data["from_record"] else "defaults"))
+    for voltage, position in data["points"]:
+        print("  %6.4f V  %8.3f deg" % (voltage, position))
+
+
+def start(ecu, args):
+    data = ecu.request(ACTION_START)
+    if data["state"] != 0:
+        sys.exit("a sweep is running already, in %s" % name(STATES, data["state"]))
+    # the answer is of before main_task took the start up
+    time.sleep(args.interval)
+    state = None
+    try:
+        while True:
+            data = ecu.request(ACTION_READ)
+            if data["state"] != state:
+                state = data["state"]
+                if state != 0:
+                    print("%6.1f s  %s" % (data["elapsed"] / 1000.0, name(STATES, state)))
+            if state == 0:
+                break
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        ecu.request(ACTION_ABORT)
+        print("abort requested")
+        time.sleep(args.interval)
+        data = ecu.request(ACTION_READ)
+    print_table(data)
+    return 0 if data["result"] == 1 else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=("start", "status", "abort"))
+    parser.add_argument("--ecu", required=True, help="ECU address")
+    parser.add_argument("--port", type=int, default=COMMAND_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0)
+    parser.add_argument("--interval", type=float, default=0.5, help="s between polls")
+    args = parser.parse_args()
+
+    ecu = Ecu(args)
+    if args.command == "start":
+        return start(ecu, args)
+    if args.command == "abort":
+        ecu.request(ACTION_ABORT)
+        time.sleep(args.interval)
+    print_table(ecu.request(ACTION_READ))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
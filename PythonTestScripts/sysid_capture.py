@@ -0,0 +1,218 @@
+"""Runs an excitation of the steering torque or the throttle of an ECU and
+saves the input/output samples as CSV for system identification
+(Excitation.h).
+
+    python sysid_capture.py start chirp.csv --ecu 192.168.2.100 --waveform chirp --offset 0.1 --amplitude 0.08 --start-hz 0.5 --end-hz 40
+    python sysid_capture.py start prbs.csv --ecu 192.168.2.100 --waveform prbs --hold 30 --start-hz 50
+    python sysid_capture.py status --ecu 192.168.2.100
+    python sysid_capture.py abort --ecu 192.168.2.100
+
+Sends excitation requests of the UDP control protocol (ControlProtocol.h,
+version 16) to the command port. start asks for a run, polls every
+--interval s until it ends, then fetches the samples over the bulk channel
+(BulkChannel.h, request 7) into the CSV: time s, duty, steering position and
+current ADC counts. Each sample's ADC values are those converted in the
+last PWM period of its hold, the pairing is fixed by the DMA. Ctrl-C asks
+the ECU to abort. status prints the last run, abort ends one that runs.
+
+The ECU has to be Disabled and standing with no command in force. A
+steering run turns one way only, --right picks the direction. A throttle
+run drives the wheels, the cart has to be on stands. Standard library only.
+"""
+
+import argparse
+import csv
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_EXCITATION_REQUEST = 30
+FRAME_EXCITATION_DATA = 31
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+EXCITATION_REQUEST = struct.Struct("<BBBBHHffff")
+EXCITATION_DATA = struct.Struct("<BBBBIHHHf")
+
+COMMAND_PORT = 12090
+BULK_PORT = 12092
+BULK_REQUEST_EXCITATION = 7
+BULK_HEADER = struct.Struct("<4sBBHIIBBxx")
+SAMPLE = struct.Struct("<fHH")
+
+ACTION_READ = 0
+ACTION_START = 1
+ACTION_ABORT = 2
+
+OUTPUTS = ("steering", "throttle")
+WAVEFORMS = ("chirp", "prbs")
+STATES = ("idle", "prepare", "run")
+RESULTS = ("none", "done", "rejected", "aborted", "limit", "timeout", "no_dma")
+RESULT_DONE = 1
+
+
+def frame(frame_type, sequence, payload):
+    timestamp = int(time.monotonic() * 1000) & 0xFFFFFFFF
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def parse(data, frame_type):
+    """The payload of an intact frame of frame_type, or None."""
+    if len(data) < HEADER.size + CRC.size:
+        return None
+    version, received_type, length, _, _ = HEADER.unpack_from(data)
+    if version != PROTOCOL_VERSION or received_type != frame_type or len(data) != HEADER.size + length + CRC.size:
+        return None
+    if CRC.unpack_from(data, HEADER.size + length)[0] != zlib.crc32(data[:HEADER.size + length]) & 0xFFFFFFFF:
+        return None
+    return data[HEADER.size:HEADER.size + length]
+
+
+def name(names, value):
+    return names[value] if value < len(names) else str(value)
+
+
+class Ecu:
+    def __init__(self, args):
+        self.host = args.ecu
+        self.address = (args.ecu, args.port)
+        self.bulk_port = args.bulk_port
+        self.timeout = args.timeout
+        self.sequence = 1
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    def request(self, action, config=(0, 0, 0, 1, 1, 0.0, 0.0, 0.0, 0.0)):
+        """The excitation data as a dict, as of before the ECU took action up."""
+        payload = EXCITATION_REQUEST.pack(action, *config)
+        self.sock.sendto(frame(FRAME_EXCITATION_REQUEST, self.sequence, payload), self.address)
+        self.sequence += 1
+        deadline = time.monotonic() + self.timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                sys.exit("%s did not answer the excitation request" % self.host)
+            self.sock.settimeout(remaining)
+            try:
+                payload = parse(self.sock.recv(2048), FRAME_EXCITATION_DATA)
+            except socket.timeout:
+                continue
+            if payload is not None:
+                return decode(payload)
+
+    def samples(self):
+        """The bulk header fields and the samples of the last run that was done."""
+        with socket.create_connection((self.host, self.bulk_port), timeout=10.0) as sock:
+            sock.sendall(bytes([BULK_REQUEST_EXCITATION]))
+            chunks = []
+            while True:
+                data = sock.recv(65536)
+                if not data:
+                    break
+                chunks.append(data)
+        data = b"".join(chunks)
+        if len(data) < BULK_HEADER.size:
+            sys.exit("the bulk channel closed before the header")
+        magic, _, request, entry_size, count, rate, output, result = BULK_HEADER.unpack_from(data)
+        if magic != b"DBWB" or request != BULK_REQUEST_EXCITATION or (count and entry_size != SAMPLE.size):
+            sys.exit("not an excitation dump")
+        body = data[BULK_HEADER.size:]
+        if len(body) < count * SAMPLE.size:
+            sys.exit("the dump ended after %d of %d samples" % (len(body) // SAMPLE.size, count))
+        samples = [SAMPLE.unpack_from(body, i * SAMPLE.size) for i in range(count)]
+        return rate / 1000.0, output, result, samples
+
+
+def decode(payload):
+    fields = EXCITATION_DATA.unpack_from(payload)
+    return {"state": fields[0], "result": fields[1], "output": fields[2], "waveform": fields[3],
+            "elapsed": fields[4], "samples": fields[5], "hold": fields[6], "captured": fields[7],
+            "sample_rate": fields[8]}
+
+
+def print_status(data):
+    print("last run: %s, %s %s of %d samples held %d periods at %.1f Hz, %d captured in %.2f s" % (
+          name(RESULTS, data["result"]), name(WAVEFORMS, data["waveform"]), name(OUTPUTS, data["output"]),
+          data["samples"], data["hold"], data["sample_rate"], data["captured"], data["elapsed"] / 1000.0))
+
+
+def save(ecu, path):
+    rate, output, result, samples = ecu.samples()
+    if result != RESULT_DONE or not samples:
+        sys.exit("no samples of a run that was done")
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["time", "duty", "position", "current"])
+        for i, (duty, position, current) in enumerate(samples):
+            writer.writerow(["%.6f" % (i / rate), "%.5f" % duty, position, current])
+    print("%d %s samples at %.1f Hz written to %s" % (len(samples), name(OUTPUTS, output), rate, path))
+
+
+def start(ecu, args):
+    if args.output_file is None:
+        sys.exit("start needs a CSV file to write")
+    config = (OUTPUTS.index(args.output), WAVEFORMS.index(args.waveform), 1 if args.right else 0, args.hold,
+              args.samples, args.offset, args.amplitude, args.start_hz, args.end_hz)
+    data = ecu.request(ACTION_START, config)
+    if data["state"] != 0:
+        sys.exit("a run of the %s is on already" % name(OUTPUTS, data["output"]))
+    # the answer is of before main_task took the start up
+    time.sleep(args.interval)
+    state = None
+    try:
+        while True:
+            data = ecu.request(ACTION_READ)
+            if data["state"] != state:
+                state = data["state"]
+                if state != 0:
+                    print("%6.2f s  %s, %d of %d samples" % (data["elapsed"] / 1000.0, name(STATES, state),
+                          data["captured"], data["samples"]))
+            if state == 0:
+                break
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        ecu.request(ACTION_ABORT)
+        print("abort requested")
+        time.sleep(args.interval)
+        data = ecu.request(ACTION_READ)
+    print_status(data)
+    if data["result"] != RESULT_DONE:
+        return 1
+    save(ecu, args.output_file)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=("start", "status", "abort"))
+    parser.add_argument("output_file", nargs="?", help="CSV file to write the samples of a start to")
+    parser.add_argument("--ecu", required=True, help="ECU address")
+    parser.add_argument("--port", type=int, default=COMMAND_PORT)
+    parser.add_argument("--bulk-port", type=int, default=BULK_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0)
+    parser.add_argument("--interval", type=float, default=0.25, help="s between polls")
+    parser.add_argument("--output", choices=OUTPUTS, default="steering", help="actuator to excite")
+    parser.add_argument("--waveform", choices=WAVEFORMS, default="chirp")
+    parser.add_argument("--right", action="store_true", help="steering runs: turn right instead of left")
+    parser.add_argument("--hold", type=int, default=30, help="PWM periods a sample is held for")
+    parser.add_argument("--samples", type=int, default=4096)
+    parser.add_argument("--offset", type=float, default=0.1, help="duty cycle the waveform swings around")
+    parser.add_argument("--amplitude", type=float, default=0.05, help="duty cycle it swings by")
+    parser.add_argument("--start-hz", type=float, default=1.0, help="chirp start frequency, PRBS bit rate")
+    parser.add_argument("--end-hz", type=float, default=50.0, help="chirp end frequency")
+    args = parser.parse_args()
+
+    ecu = Ecu(args)
+    if args.command == "start":
+        return start(ecu, args)
+    if args.command == "abort":
+        ecu.request(ACTION_ABORT)
+        time.sleep(args.interval)
+    print_status(ecu.request(ACTION_READ))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
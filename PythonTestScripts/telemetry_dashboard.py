@@ -0,0 +1,335 @@
+"""Plots the PID terms and setpoint versus feedback live, every control cycle.
+
+    python telemetry_dashboard.py --ecu 192.168.2.100
+    python telemetry_dashboard.py --ecu 192.168.2.100 --window 30 --batch 20
+    python telemetry_dashboard.py --ecu 192.168.2.100 --extra yaw_rate lateral_accel
+
+Two streams are subscribed at the ECU (ControlProtocol.h, version 16) and
+renewed every second: batched telemetry, every control cycle's sample, for
+the speed and steering PID terms, and a signal set (SignalBus.h) every ms of
+the steering angle and vehicle speed next to what they were commanded, and
+of the --extra signals. The frames are checked and decoded as
+telemetry_recorder.py and signal_watch.py do, on a thread of their own that
+writes the samples into ring buffers allocated at start for --window
+seconds.
+
+A ring holds every sample twice, at i and at i + capacity, so the newest
+window is always one contiguous slice and is drawn without a copy. A redraw,
+--fps times a second, cuts that slice into a bucket per pixel column of the
+plots and draws the minimum and the maximum of each, so a 1 kHz trace costs
+two points per pixel whatever the window, and a spike one sample wide still
+shows. The buckets go into arrays also allocated at start, a dashboard left
+running for hours holds the memory it held after the first second. The
+plots are drawn through OpenGL unless --no-opengl.
+
+The x axis is seconds before the newest sample of each stream, counted by
+the sample numbers for the PID terms and by the ECU's ms timestamps for the
+signals. Samples the ECU overwrote before it got to send them, sample
+numbers that never arrived and frames that failed their checks are counted
+in the title. Needs numpy, pyqtgraph and a Qt binding (PyQt5, PyQt6 or
+PySide6).
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+try:
+    import numpy as np
+    import pyqtgraph as pg
+    from pyqtgraph.Qt import QtCore
+except ImportError as error:
+    sys.exit("the dashboard needs numpy, pyqtgraph and a Qt binding: %s" % error)
+
+import signal_watch
+import telemetry_recorder
+from telemetry_recorder import BATCH_FIELDS, BATCH_SAMPLE_SIZE, HEADER, MAX_BATCH, MAX_FRAME
+
+SUBSCRIBE_INTERVAL = 1.0
+# ms between signal data frames, the fastest the ECU sends
+SIGNAL_PERIOD = 1
+# s of samples the rings hold past the window, what the receiver may write
+# while a redraw reads
+RING_MARGIN = 1.0
+MAX_PIXELS = 4096
+
+# signal names of each setpoint versus feedback plot, feedback first
+TRACKING = (
+    ("steering angle", "deg", ("steering_angle", "steering_angle_commanded")),
+    ("vehicle speed", "m/s", ("vehicle_speed", "vehicle_speed_commanded")),
+)
+PID_TERMS = (
+    ("steering PID", ("steering_p_term", "steering_i_term", "steering_d_term")),
+    ("speed PID", ("speed_p_term", "speed_i_term", "speed_d_term")),
+)
+BATCH_COLUMNS = ("sample_number",) + tuple(name for _, names in PID_TERMS for name in names)
+
+# a batched sample as laid out on the wire
+BATCH_DTYPE = np.dtype({
+    "names": [name for name, _, _, _ in BATCH_FIELDS],
+    "formats": [dtype for _, _, dtype, _ in BATCH_FIELDS],
+    "offsets": [offset for _, offset, _, _ in BATCH_FIELDS],
+    "itemsize": BATCH_SAMPLE_SIZE,
+})
+BATCH_PREFIX = struct.Struct("<BII")
+COLORS = ("y", "c", "m", "g", "r", "w")
+
+
+class Ring(object):
+    """Columns of float64 of fixed capacity, the first one the time."""
+
+    def __init__(self, columns, capacity):
+        self.capacity = capacity
+        self.data = np.zeros((columns, 2 * capacity))
+        self.count = 0
+
+    def extend(self, block):
+        """Appends the samples of block, (columns, k), k at most capacity."""
+        k = block.shape[1]
+        i = self.count % self.capacity
+        # the first copy runs on into the second one's start past the end,
+        # which mirrors the wrapped part of the second copy
+        self.data[:, i:i + k] = block
+        upper = min(k, self.capacity - i)
+        self.data[:, i + self.capacity:i + self.capacity + upper] = block[:, :upper]
+        self.data[:, :k - upper] = block[:, upper:]
+        # counted last, a redraw never takes a sample half written
+        self.count += k
+
+    def newest(self, length):
+        """View of the newest samples, at most length of them."""
+        count = self.count
+        n = min(length, count, self.capacity)
+        end = (count - 1) % self.capacity + self.capacity + 1
+        return self.data[:, end - n:end]
+
+
+class Decimator(object):
+    """The minimum and maximum of every pixel column's samples, of all the
+    columns of a ring, into arrays allocated once."""
+
+    def __init__(self, columns):
+        self.y = np.empty((columns, 2 * MAX_PIXELS))
+        self.x = np.empty(2 * MAX_PIXELS)
+
+    def reduce(self, window, pixels, seconds_per_step):
+        """Points to draw of window, (columns, n), over pixels columns.
+        Leaves the x of each in self.x, in seconds before the newest sample,
+        and the values in self.y."""
+        n = window.shape[1]
+        if n == 0:
+            return 0
+        pixels = max(1, min(pixels, MAX_PIXELS))
+        if n <= 2 * pixels:
+            # no more samples than points, drawn as they are
+            points = n
+            self.y[:, :n] = window
+        else:
+            # the oldest n % pixels samples are left out, under a pixel
+            bucket = n // pixels
+            buckets = window[:, n - bucket * pixels:].reshape(window.shape[0], pixels, bucket)
+            points = 2 * pixels
+            np.min(buckets, axis=2, out=self.y[:, 0:points:2])
+            np.max(buckets, axis=2, out=self.y[:, 1:points:2])
+        # the time is the first column, its minimum the first sample of a
+        # bucket and its maximum the last
+        np.subtract(self.y[0, :points], window[0, n - 1], out=self.x[:points])
+        self.x[:points] *= seconds_per_step
+        return points
+
+
+class Receiver(threading.Thread):
+    """Keeps both subscriptions and fills the rings."""
+
+    def __init__(self, args, sock, signals):
+        threading.Thread.__init__(self, daemon=True)
+        self.args = args
+        self.sock = sock
+        self.signals = signals
+        self.ids = [signal["id"] for signal in signals]
+        self.batches = Ring(len(BATCH_COLUMNS), int((args.window + RING_MARGIN) * args.rate))
+        self.samples = Ring(1 + len(signals), int((args.window + RING_MARGIN) * 1000 / SIGNAL_PERIOD))
+        self.stopping = threading.Event()
+
+        self.buffer = bytearray(MAX_FRAME)
+        self.view = memoryview(self.buffer)
+        self.block = np.empty((len(BATCH_COLUMNS), MAX_BATCH))
+        self.steps = np.arange(MAX_BATCH, dtype=np.float64)
+        self.row = np.empty((1 + len(signals), 1))
+
+        self.sequence = 0
+        self.next_sample = None
+        self.lost = 0
+        self.missing = 0
+        self.rejected = 0
+
+    def subscribe(self, batch, period, ids):
+        self.sequence += 1
+        payload = struct.pack("<4sHHHB", b"\0\0\0\0", 0, 0, 0, batch)
+        self.sock.sendto(telemetry_recorder.frame(telemetry_recorder.FRAME_SUBSCRIBE, self.sequence,
+                                                  int(time.time() * 1000), payload), (self.args.ecu, self.args.port))
+        self.sequence += 1
+        signal_watch.subscribe(self.sock, self.args, ids, period, self.sequence)
+
+    def batch(self, length):
+        if not telemetry_recorder.valid_telemetry(self.view[:length], length):
+            self.rejected += 1
+            return
+        count, first, lost = BATCH_PREFIX.unpack_from(self.buffer, HEADER.size)
+        samples = np.frombuffer(self.buffer, dtype=BATCH_DTYPE, count=count, offset=HEADER.size + BATCH_PREFIX.size)
+        skipped = (first - self.next_sample) & 0xFFFFFFFF if self.next_sample is not None else 0
+        # a number further back is a resubscribe or a reboot, not a gap
+        if skipped < 0x80000000:
+            self.missing += skipped
+        self.next_sample = (first + count) & 0xFFFFFFFF
+        self.lost = lost
+
+        block = self.block[:, :count]
+        np.add(self.steps[:count], first, out=block[0])
+        for row, name in enumerate(BATCH_COLUMNS[1:], 1):
+            block[row] = samples[name]
+        self.batches.extend(block)
+
+    def signal_data(self, length):
+        reply = signal_watch.parse(self.view[:length], signal_watch.FRAME_SIGNAL_DATA)
+        if reply is None:
+            self.rejected += 1
+            return
+        try:
+            values = signal_watch.decode_data(reply[1], self.args.schema_id, self.args.tag, self.signals)
+        except KeyError:
+            # reflashed with other signals, the names no longer hold
+            self.rejected += 1
+            return
+        if values is None or len(values) != len(self.signals):
+            return
+        self.row[0, 0] = reply[0]
+        self.row[1:, 0] = values
+        self.samples.extend(self.row)
+
+    def run(self):
+        renew = time.monotonic()
+        self.sock.settimeout(0.1)
+        while not self.stopping.is_set():
+            if time.monotonic() >= renew:
+                self.subscribe(self.args.batch, SIGNAL_PERIOD, self.ids)
+                renew += SUBSCRIBE_INTERVAL
+            try:
+                length = self.sock.recv_into(self.buffer)
+            except socket.timeout:
+                continue
+            if length < HEADER.size:
+                self.rejected += 1
+            elif self.buffer[1] == telemetry_recorder.FRAME_TELEMETRY_BATCH:
+                self.batch(length)
+            elif self.buffer[1] == signal_watch.FRAME_SIGNAL_DATA:
+                self.signal_data(length)
+        self.subscribe(0, 0, [])
+
+
+class Panel(object):
+    """A plot of some of a ring's columns."""
+
+    def __init__(self, plot, ring, decimator, seconds_per_step, rows, names):
+        self.plot = plot
+        self.ring = ring
+        self.decimator = decimator
+        self.seconds_per_step = seconds_per_step
+        self.curves = []
+        plot.addLegend(offset=(10, 10))
+        for k, (row, name) in enumerate(zip(rows, names)):
+            curve = plot.plot(pen=COLORS[k % len(COLORS)], name=name)
+            self.curves.append((row, curve))
+
+
+def dashboard(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, args.socket_buffer)
+    sock.bind(("", 0))
+    args.schema_id, schema = signal_watch.fetch_schema(sock, args.ecu, args.port, args.timeout)
+    by_name = {signal["name"]: signal for signal in schema}
+    names = [name for _, _, pair in TRACKING for name in pair] + args.extra
+    unknown = [name for name in names if name not in by_name]
+    if unknown:
+        sys.exit("unknown signals %s, see signal_watch.py schema" % ", ".join(unknown))
+    if len(names) > signal_watch.SIGNAL_SET_MAX:
+        sys.exit("at most %d signals" % signal_watch.SIGNAL_SET_MAX)
+    receiver = Receiver(args, sock, [by_name[name] for name in names])
+
+    app = pg.mkQApp("telemetry dashboard")
+    pg.setConfigOptions(antialias=False, useOpenGL=not args.no_opengl)
+    window = pg.GraphicsLayoutWidget(show=True)
+    window.resize(1200, 900)
+    signal_decimator = Decimator(1 + len(names))
+    batch_decimator = Decimator(len(BATCH_COLUMNS))
+    panels = []
+
+    def add(title, ring, decimator, seconds_per_step, rows, row_names):
+        plot = window.addPlot(title=title)
+        window.nextRow()
+        plot.showGrid(x=True, y=True, alpha=0.3)
+        plot.setXRange(-args.window, 0, padding=0)
+        plot.enableAutoRange(x=False, y=True)
+        if panels:
+            plot.setXLink(panels[0].plot)
+        panels.append(Panel(plot, ring, decimator, seconds_per_step, rows, row_names))
+
+    for (title, unit, pair), (pid_title, terms) in zip(TRACKING, PID_TERMS):
+        add("%s, %s" % (title, unit), receiver.samples, signal_decimator, 0.001,
+            [1 + names.index(name) for name in pair], pair)
+        add(pid_title, receiver.batches, batch_decimator, 1.0 / args.rate,
+            [BATCH_COLUMNS.index(name) for name in terms], terms)
+    if args.extra:
+        add("signals", receiver.samples, signal_decimator, 0.001,
+            [1 + names.index(name) for name in args.extra], args.extra)
+    first = panels[0].plot
+
+    def redraw():
+        pixels = int(first.getViewBox().width())
+        # every ring is reduced once for all the panels that draw from it
+        reduced = {}
+        for panel in panels:
+            key = id(panel.ring)
+            if key not in reduced:
+                length = int(args.window / panel.seconds_per_step)
+                reduced[key] = panel.decimator.reduce(panel.ring.newest(length), pixels, panel.seconds_per_step)
+            points = reduced[key]
+            for row, curve in panel.curves:
+                curve.setData(panel.decimator.x[:points], panel.decimator.y[row, :points])
+        window.setWindowTitle("%s: %d lost by the ECU, %d missing, %d rejected" % (
+            args.ecu, receiver.lost, receiver.missing, receiver.rejected))
+
+    timer = QtCore.QTimer()
+    timer.timeout.connect(redraw)
+    timer.start(int(1000 / args.fps))
+    receiver.start()
+    try:
+        app.exec() if hasattr(app, "exec") else app.exec_()
+    finally:
+        receiver.stopping.set()
+        receiver.join()
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--ecu", required=True, help="ECU address")
+    parser.add_argument("--port", type=int, default=signal_watch.COMMAND_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0, help="s to wait for the schema")
+    parser.add_argument("--extra", nargs="*", default=[], metavar="SIGNAL", help="more signals to plot, by name")
+    parser.add_argument("--window", type=float, default=10.0, help="seconds shown")
+    parser.add_argument("--batch", type=int, default=10, choices=range(1, MAX_BATCH + 1), metavar="N",
+                        help="samples per batched telemetry frame")
+    parser.add_argument("--rate", type=float, default=1000.0, help="control cycles per second, CONTROL_RATE_HZ")
+    parser.add_argument("--fps", type=float, default=30.0, help="redraws per second")
+    parser.add_argument("--tag", type=int, default=2, help="signal set number, one per tool against an ECU")
+    parser.add_argument("--no-opengl", action="store_true", help="draw without OpenGL")
+    parser.add_argument("--socket-buffer", type=int, default=4 << 20, help="SO_RCVBUF in bytes")
+    return dashboard(parser.parse_args())
+
+
+if __name__ == "__main__":
+    sys.exit(main())
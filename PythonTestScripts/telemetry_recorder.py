@@ -0,0 +1,457 @@
+"""Records ECU telemetry to a flat binary log and exports it as columns.
+
+    python telemetry_recorder.py record run.tlm
+    python telemetry_recorder.py record run.tlm --subscribe 192.168.2.100 --status-period 1 --pid-period 1
+    python telemetry_recorder.py record run.tlm --subscribe 192.168.2.100 --status-period 10 --pid-period 0 --batch 20
+    python telemetry_recorder.py info run.tlm
+    python telemetry_recorder.py export run.tlm run.npz
+    python telemetry_recorder.py export run.tlm run.parquet
+
+record listens on the telemetry port, 12089, in the group the ECU sends to
+before anybody subscribes (ControlProtocol.h, version 16). With --subscribe it
+asks the ECU for its own stream instead and renews the subscription every
+second. --batch N also asks for batched telemetry frames, every control
+cycle's sample, N of them per datagram. Datagrams are read straight into a large buffer, as many as are
+queued per wakeup, and only checked for version, type and CRC on the way. The
+buffer goes to disk in one write when full, so nothing is decoded while
+recording. On Linux the kernel's count of datagrams dropped on a full socket
+buffer is reported (SO_RXQ_OVFL).
+
+Log format, little-endian:
+
+    header  8 bytes "DBWTLM" 0 2, 1 byte protocol version, 7 bytes 0
+    record  8 bytes receive time in ns since the epoch, 2 bytes frame
+            length, the frame as received
+    index   8 bytes file offset of every record
+    footer  8 bytes offset of the index, 8 bytes record count, "DBWTLMIX"
+
+A log cut short, without index and footer, is still read by walking the
+records.
+
+export turns the delta-coded frames back into full samples with numpy: one
+table per telemetry group, a row per frame received, every field carrying its
+last value forward from the frame that last sent it. Batched frames make
+a table of their own with a row per sample, numbered by the ECU, so gaps
+show as jumps in sample_number. The record offsets from
+the index are used to gather each field of every frame at once from a memory
+map of the log. .npz needs only numpy, .parquet needs pyarrow and writes one
+file per group. info and record need only the standard library.
+"""
+
+import argparse
+import array
+import os
+import select
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 16
+FRAME_TELEMETRY = 2
+FRAME_SUBSCRIBE = 3
+FRAME_TELEMETRY_BATCH = 16
+HEADER = struct.Struct("<BBHII")
+CRC = struct.Struct("<I")
+
+TELEMETRY_PORT = 12089
+TELEMETRY_GROUP = "239.192.2.100"
+COMMAND_PORT = 12090
+
+FILE_MAGIC = b"DBWTLM\x00\x02"
+FILE_HEADER = struct.Struct("<8sB7x")
+RECORD_HEADER = struct.Struct("<QH")
+FOOTER = struct.Struct("<QQ8s")
+INDEX_MAGIC = b"DBWTLMIX"
+
+# largest batched telemetry frame is 1401 bytes, anything longer is not
+# telemetry
+MAX_FRAME = 1472
+MAX_BATCH = 32
+BUFFER_SIZE = 1 << 20
+SUBSCRIBE_INTERVAL = 1.0
+REPORT_INTERVAL = 10.0
+# Linux, not exported by the socket module
+SO_RXQ_OVFL = 40
+
+# (name, wire size, numpy dtype, group, scale) of each telemetry field, in
+# field order. scale None keeps the integer.
+FIELDS = (
+    ("command_sequence", 4, "<u4", 0, None),
+    ("command_timestamp", 4, "<u4", 0, None),
+    ("vehicle_speed", 2, "<i2", 0, 0.01),
+    ("steering_angle", 2, "<i2", 0, 0.1),
+    ("states", 1, "u1", 0, None),
+    ("speed_p_term", 4, "<i4", 1, None),
+    ("speed_i_term", 4, "<i4", 1, None),
+    ("speed_d_term", 4, "<i4", 1, None),
+    ("steering_p_term", 4, "<i4", 1, None),
+    ("steering_i_term", 4, "<i4", 1, None),
+    ("steering_d_term", 4, "<i4", 1, None),
+    ("command_ptp_time", 4, "<u4", 0, None),
+    ("sample_ptp_time", 4, "<u4", 0, None),
+    ("ram_corrected", 4, "<u4", 0, None),
+    ("ram_uncorrectable", 2, "<u2", 0, None),
+)
+GROUPS = ("status", "pid")
+
+# (name, offset, numpy dtype, scale) of each field of a batched sample
+BATCH_SAMPLE_SIZE = 43
+BATCH_FIELDS = (
+    ("sample_ptp_time", 0, "<u4", None),
+    ("vehicle_speed", 4, "<i2", 0.01),
+    ("steering_angle", 6, "<i2", 0.1),
+    ("states", 8, "u1", None),
+    ("speed_p_term", 9, "<i4", None),
+    ("speed_i_term", 13, "<i4", None),
+    ("speed_d_term", 17, "<i4", None),
+    ("steering_p_term", 21, "<i4", None),
+    ("steering_i_term", 25, "<i4", None),
+    ("steering_d_term", 29, "<i4", None),
+    ("odometry_x", 33, "<i4", 0.001),
+    ("odometry_y", 37, "<i4", 0.001),
+    ("odometry_heading", 41, "<i2", 0.0001),
+)
+
+
+def frame(frame_type, sequence, timestamp, payload):
+    body = HEADER.pack(PROTOCOL_VERSION, frame_type, len(payload), sequence, timestamp & 0xFFFFFFFF) + payload
+    return body + CRC.pack(zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def valid_telemetry(view, length):
+    if length < HEADER.size + 3 + CRC.size or view[0] != PROTOCOL_VERSION:
+        return False
+    payload_length = view[2] | (view[3] << 8)
+    if length != HEADER.size + payload_length + CRC.size:
+        return False
+    if view[1] == FRAME_TELEMETRY_BATCH:
+        if payload_length < 9 or payload_length != 9 + view[HEADER.size] * BATCH_SAMPLE_SIZE:
+            return False
+    elif view[1] != FRAME_TELEMETRY:
+        return False
+    return CRC.unpack_from(view, length - CRC.size)[0] == zlib.crc32(view[:length - CRC.size]) & 0xFFFFFFFF
+
+
+class Recorder(object):
+
+    def __init__(self, args):
+        self.args = args
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, args.socket_buffer)
+        self.sock.bind(("", args.port))
+        if args.group:
+            membership = struct.pack("4s4s", socket.inet_aton(args.group), socket.inet_aton(args.interface))
+            self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+        self.overflow = sys.platform.startswith("linux")
+        if self.overflow:
+            try:
+                self.sock.setsockopt(socket.SOL_SOCKET, SO_RXQ_OVFL, 1)
+            except OSError:
+                self.overflow = False
+        self.sock.setblocking(False)
+        self.ecu = (args.subscribe, COMMAND_PORT) if args.subscribe else None
+
+        self.file = open(args.log, "wb")
+        self.file.write(FILE_HEADER.pack(FILE_MAGIC, PROTOCOL_VERSION))
+        self.file_offset = FILE_HEADER.size
+        self.buffer = bytearray(BUFFER_SIZE)
+        self.view = memoryview(self.buffer)
+        self.used = 0
+        self.index = array.array("Q")
+
+        self.sequence = 0
+        self.recorded = 0
+        self.rejected = 0
+        self.kernel_dropped = 0
+
+    def subscribe(self):
+        self.sequence += 1
+        payload = struct.pack("<4sHHHB", b"\0\0\0\0", 0, self.args.status_period, self.args.pid_period, self.args.batch)
+        self.sock.sendto(frame(FRAME_SUBSCRIBE, self.sequence, int(time.time() * 1000), payload), self.ecu)
+
+    def flush(self):
+        self.file.write(self.view[:self.used])
+        self.file_offset += self.used
+        self.used = 0
+
+    def drain(self):
+        """Reads every queued datagram into the buffer."""
+        ancillary = socket.CMSG_SPACE(4) if self.overflow else 0
+        while True:
+            if self.used + RECORD_HEADER.size + MAX_FRAME > BUFFER_SIZE:
+                self.flush()
+            start = self.used + RECORD_HEADER.size
+            try:
+                length, ancdata, flags, _ = self.sock.recvmsg_into([self.view[start:start + MAX_FRAME]], ancillary)
+            except BlockingIOError:
+                return
+            received = time.time_ns()
+            for level, kind, data in ancdata:
+                if level == socket.SOL_SOCKET and kind == SO_RXQ_OVFL and len(data) >= 4:
+                    # running total for the socket
+                    self.kernel_dropped = struct.unpack("<I", data[:4])[0]
+            if flags & socket.MSG_TRUNC or not valid_telemetry(self.view[start:start + length], length):
+                self.rejected += 1
+                continue
+            RECORD_HEADER.pack_into(self.buffer, self.used, received, length)
+            self.index.append(self.file_offset + self.used)
+            self.used = start + length
+            self.recorded += 1
+
+    def close(self):
+        self.flush()
+        index_offset = self.file_offset
+        if sys.byteorder != "little":
+            self.index.byteswap()
+        self.index.tofile(self.file)
+        self.file.write(FOOTER.pack(index_offset, len(self.index), INDEX_MAGIC))
+        self.file.close()
+
+    def run(self):
+        start = time.monotonic()
+        next_subscribe = start
+        next_report = start + REPORT_INTERVAL
+        end = start + self.args.duration if self.args.duration else None
+        try:
+            while end is None or time.monotonic() < end:
+                now = time.monotonic()
+                if self.ecu and now >= next_subscribe:
+                    self.subscribe()
+                    next_subscribe += SUBSCRIBE_INTERVAL
+                if now >= next_report:
+                    self.report(now - start)
+                    next_report += REPORT_INTERVAL
+                readable, _, _ = select.select([self.sock], [], [], 0.2)
+                if readable:
+                    self.drain()
+        except KeyboardInterrupt:
+            pass
+        self.close()
+        self.report(time.monotonic() - start)
+
+    def report(self, elapsed):
+        print("%.0f s: %d frames recorded, %d rejected, %s dropped by the kernel" % (
+            elapsed, self.recorded, self.rejected, self.kernel_dropped if self.overflow else "unknown"))
+        sys.stdout.flush()
+
+
+def read_offsets(path):
+    """Offsets of every record, from the index or by walking the records."""
+    size = os.path.getsize(path)
+    with open(path, "rb") as f:
+        magic, version = FILE_HEADER.unpack(f.read(FILE_HEADER.size))
+        if magic != FILE_MAGIC:
+            raise ValueError("%s is not a telemetry log" % path)
+        if size >= FILE_HEADER.size + FOOTER.size:
+            f.seek(size - FOOTER.size)
+            index_offset, count, index_magic = FOOTER.unpack(f.read(FOOTER.size))
+            if index_magic == INDEX_MAGIC and index_offset + count * 8 + FOOTER.size == size:
+                f.seek(index_offset)
+                offsets = array.array("Q")
+                offsets.fromfile(f, count)
+                if sys.byteorder != "little":
+                    offsets.byteswap()
+                return offsets, index_offset
+
+        # no index, the recorder did not get to close the log
+        offsets = array.array("Q")
+        f.seek(FILE_HEADER.size)
+        offset = FILE_HEADER.size
+        while True:
+            header = f.read(RECORD_HEADER.size)
+            if len(header) < RECORD_HEADER.size:
+                break
+            _, length = RECORD_HEADER.unpack(header)
+            # a partly written index or record ends the log
+            frame_data = f.read(length)
+            if len(frame_data) < length or not valid_telemetry(memoryview(frame_data), length):
+                break
+            offsets.append(offset)
+            offset += RECORD_HEADER.size + length
+        return offsets, offset
+
+
+def info(args):
+    offsets, _ = read_offsets(args.log)
+    if not offsets:
+        print("no frames")
+        return
+    groups = [0] * len(GROUPS)
+    batches = 0
+    samples = 0
+    gaps = 0
+    last_sequence = None
+    with open(args.log, "rb") as f:
+        first = None
+        for offset in offsets:
+            f.seek(offset)
+            record = f.read(RECORD_HEADER.size + HEADER.size + 1)
+            received, _ = RECORD_HEADER.unpack_from(record)
+            _, frame_type, _, sequence, _ = HEADER.unpack_from(record, RECORD_HEADER.size)
+            group = record[RECORD_HEADER.size + HEADER.size]
+            if frame_type == FRAME_TELEMETRY_BATCH:
+                batches += 1
+                samples += group
+            elif group < len(groups):
+                groups[group] += 1
+            if last_sequence is not None and sequence != (last_sequence + 1) & 0xFFFFFFFF:
+                gaps += 1
+            last_sequence = sequence
+            if first is None:
+                first = received
+    duration = (received - first) * 1e-9
+    print("%d frames over %.1f s, %.0f per second" % (len(offsets), duration, len(offsets) / max(duration, 1e-9)))
+    print("  " + ", ".join("%s %d" % (name, count) for name, count in zip(GROUPS, groups)))
+    if batches:
+        print("  %d batched frames, %d samples" % (batches, samples))
+    # the ECU numbers every frame it sends, to any subscriber
+    print("  %d gaps in the ECU's frame sequence, frames to other subscribers included" % gaps)
+
+
+def decode(path):
+    """Columns of every group as numpy arrays, {group: {name: array}}."""
+    import numpy as np
+
+    offsets, _ = read_offsets(path)
+    data = np.memmap(path, dtype=np.uint8, mode="r")
+    offsets = np.frombuffer(offsets, dtype=np.uint64).astype(np.int64)
+
+    def gather(starts, size, dtype):
+        return data[starts[:, None] + np.arange(size)].view(dtype).reshape(-1)
+
+    batched = data[offsets + RECORD_HEADER.size + 1] == FRAME_TELEMETRY_BATCH
+    tables = {"batch": decode_batches(data, offsets[batched], gather)}
+    offsets = offsets[~batched]
+
+    frames = offsets + RECORD_HEADER.size
+    received = gather(offsets, 8, "<u8")
+    ecu_sequence = gather(frames + 4, 4, "<u4")
+    ecu_timestamp = gather(frames + 8, 4, "<u4")
+    group = data[frames + HEADER.size]
+    mask = gather(frames + HEADER.size + 1, 2, "<u2")
+
+    # fields follow in order, each only when its mask bit is set
+    position = frames + HEADER.size + 3
+    present = []
+    raw = []
+    for k, (name, size, dtype, _, _) in enumerate(FIELDS):
+        has = ((mask >> k) & 1).astype(bool)
+        values = np.zeros(len(frames), dtype=dtype)
+        values[has] = gather(position[has], size, dtype)
+        position = position + has * size
+        present.append(has)
+        raw.append(values)
+
+    for g, group_name in enumerate(GROUPS):
+        rows = group == g
+        count = int(rows.sum())
+        table = {
+            "received_ns": received[rows],
+            "ecu_sequence": ecu_sequence[rows],
+            "ecu_timestamp": ecu_timestamp[rows],
+        }
+        for k, (name, _, _, field_group, scale) in enumerate(FIELDS):
+            if field_group != g:
+                continue
+            # index of the latest frame that sent the field, -1 before the first
+            last = np.where(present[k][rows], np.arange(count), -1)
+            last = np.maximum.accumulate(last) if count else last
+            values = raw[k][rows][np.maximum(last, 0)]
+            if scale is None:
+                column = values.astype(np.int64)
+                column[last < 0] = -1
+            else:
+                column = values.astype(np.float64) * scale
+                column[last < 0] = np.nan
+            table[name] = column
+        tables[group_name] = table
+    return tables
+
+
+def decode_batches(data, offsets, gather):
+    """A row per sample of the batched frames at offsets."""
+    import numpy as np
+
+    frames = offsets + RECORD_HEADER.size
+    payload = frames + HEADER.size
+    counts = data[payload].astype(np.int64)
+    # index of each sample's frame and its place in the frame
+    frame_of = np.repeat(np.arange(len(frames)), counts)
+    within = np.arange(len(frame_of)) - np.repeat(np.cumsum(counts) - counts, counts)
+    samples = payload[frame_of] + 9 + within * BATCH_SAMPLE_SIZE
+
+    table = {
+        "received_ns": gather(offsets, 8, "<u8")[frame_of],
+        "ecu_sequence": gather(frames + 4, 4, "<u4")[frame_of],
+        "sample_number": (gather(payload + 1, 4, "<u4").astype(np.int64)[frame_of] + within),
+        "lost": gather(payload + 5, 4, "<u4")[frame_of],
+    }
+    for name, offset, dtype, scale in BATCH_FIELDS:
+        values = gather(samples + offset, np.dtype(dtype).itemsize, dtype)
+        table[name] = values.astype(np.int64) if scale is None else values.astype(np.float64) * scale
+    return table
+
+
+def export(args):
+    tables = decode(args.log)
+    stem, extension = os.path.splitext(args.output)
+    if extension == ".npz":
+        import numpy as np
+        np.savez_compressed(args.output, **dict(("%s_%s" % (group, name), column)
+                                                for group, table in tables.items() for name, column in table.items()))
+        print("wrote %s" % args.output)
+    elif extension == ".parquet":
+        import pyarrow
+        import pyarrow.parquet
+        for group, table in tables.items():
+            path = "%s.%s.parquet" % (stem, group)
+            pyarrow.parquet.write_table(pyarrow.table(table), path)
+            print("wrote %s" % path)
+    else:
+        raise SystemExit("export writes .npz or .parquet")
+    for group, table in tables.items():
+        print("  %s: %d rows" % (group, len(table["received_ns"])))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command")
+
+    record = commands.add_parser("record", help="record telemetry until interrupted or --duration")
+    record.add_argument("log")
+    record.add_argument("--port", type=int, default=TELEMETRY_PORT, help="port to listen on")
+    record.add_argument("--group", default=TELEMETRY_GROUP, help="multicast group to join, empty for none")
+    record.add_argument("--interface", default="0.0.0.0", help="address of the interface to join the group on")
+    record.add_argument("--subscribe", metavar="ECU", help="subscribe at this ECU address instead of only listening")
+    record.add_argument("--status-period", type=int, default=1, help="status group period in ms with --subscribe")
+    record.add_argument("--pid-period", type=int, default=1, help="PID group period in ms with --subscribe")
+    record.add_argument("--batch", type=int, default=0, choices=range(MAX_BATCH + 1), metavar="N",
+                        help="samples per batched telemetry frame with --subscribe, 0 for none")
+    record.add_argument("--duration", type=float, default=0, help="seconds, 0 until interrupted")
+    record.add_argument("--socket-buffer", type=int, default=8 << 20, help="SO_RCVBUF in bytes")
+
+    info_parser = commands.add_parser("info", help="frame counts and gaps of a log")
+    info_parser.add_argument("log")
+
+    export_parser = commands.add_parser("export", help="write a log's columns to .npz or .parquet")
+    export_parser.add_argument("log")
+    export_parser.add_argument("output")
+
+    args = parser.parse_args()
+    if args.command == "record":
+        Recorder(args).run()
+    elif args.command == "info":
+        info(args)
+    elif args.command == "export":
+        export(args)
+    else:
+        parser.print_help()
+        return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
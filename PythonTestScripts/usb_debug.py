@@ -0,0 +1,108 @@
+"""Shows the ECU's log from its USB debug port (UsbDebug.h).
+
+    python usb_debug.py /dev/ttyACM0
+    python usb_debug.py /dev/ttyACM0 --binary
+
+Prints the log lines as they come. With --binary, for an ECU built with
+LOG_BINARY, prints each record's format address, tick and arguments
+instead. Other scripts import UsbDebugPort to send their requests through
+the port, see param_tool.py --usb. POSIX serial ports, standard library
+only.
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+
+SYNC = 0xA6
+KIND_LOG = 1
+KIND_FRAME = 2
+RECORD = struct.Struct("<BBH")
+LOG_BINARY_SYNC = 0xA5
+
+
+class UsbDebugPort:
+    """The ECU's CDC ACM port in raw mode, records in and out."""
+
+    def __init__(self, device):
+        self.fd = os.open(device, os.O_RDWR | os.O_NOCTTY)
+        attributes = termios.tcgetattr(self.fd)
+        # raw: no echo, no line editing, no translation, 8 bit bytes
+        attributes[0] = 0
+        attributes[1] = 0
+        attributes[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attributes[3] = 0
+        attributes[6][termios.VMIN] = 0
+        attributes[6][termios.VTIME] = 0
+        termios.tcsetattr(self.fd, termios.TCSANOW, attributes)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.buffer = b""
+
+    def close(self):
+        os.close(self.fd)
+
+    def send(self, kind, payload):
+        os.write(self.fd, RECORD.pack(SYNC, kind, len(payload)) + payload)
+
+    def receive(self, timeout):
+        """The next (kind, payload), or None once timeout seconds passed."""
+        deadline = time.monotonic() + timeout
+        while True:
+            start = self.buffer.find(bytes([SYNC]))
+            if start < 0:
+                self.buffer = b""
+            else:
+                self.buffer = self.buffer[start:]
+                if len(self.buffer) >= RECORD.size:
+                    _, kind, length = RECORD.unpack_from(self.buffer)
+                    if len(self.buffer) >= RECORD.size + length:
+                        payload = self.buffer[RECORD.size:RECORD.size + length]
+                        self.buffer = self.buffer[RECORD.size + length:]
+                        return kind, payload
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            if select.select([self.fd], [], [], left)[0]:
+                self.buffer += os.read(self.fd, 4096)
+
+
+def print_binary(payload):
+    offset = 0
+    while offset + 10 <= len(payload) and payload[offset] == LOG_BINARY_SYNC:
+        count = payload[offset + 1]
+        address, tick = struct.unpack_from("<II", payload, offset + 2)
+        args = struct.unpack_from("<%dI" % count, payload, offset + 10)
+        print("%8d 0x%08x %s" % (tick, address, " ".join("0x%x" % a for a in args)))
+        offset += 10 + 4 * count
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("device", help="the ECU's port, /dev/ttyACM0 on Linux")
+    parser.add_argument("--binary", action="store_true", help="the ECU logs with LOG_BINARY")
+    args = parser.parse_args()
+
+    port = UsbDebugPort(args.device)
+    try:
+        while True:
+            record = port.receive(1.0)
+            if record is None or record[0] != KIND_LOG:
+                continue
+            if args.binary:
+                print_binary(record[1])
+            else:
+                sys.stdout.write(record[1].decode("ascii", "replace").replace("\r\n", "\n"))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        port.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())